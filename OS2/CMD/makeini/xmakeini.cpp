@@ -390,8 +390,11 @@ int main(int argc, char* argv[])
     {
         printf("xmakeini V" BLDLEVEL_VERSION " built " __DATE__ "\n");
         printf("(C) 2002 Ulrich Moeller\n\n");
-        printf("Syntax: xmakeini <inifile> [-s sedfile] [-d <dir>] <rcfile> [<rcfile> ...]\n");
+        printf("Syntax: xmakeini <inifile> [-n] [-s sedfile] [-d <dir>] <rcfile> [<rcfile> ...]\n");
         printf("with <inifile>: the INI file to create or update; must not be in use!\n");
+        printf("        When updating, only the part from the first changed application\n");
+        printf("        on is rewritten, and nothing if nothing has changed\n");
+        printf("     -n: build <inifile> from scratch, dropping its current contents\n");
         printf("     -s <sedfile>: a file in very simply sed syntax with string replacements\n");
         printf("        to apply on the rc file where each line must be \"s/find/replace/\"\n");
         printf("        (regular expressions are not yet supported)\n");
@@ -408,10 +411,22 @@ int main(int argc, char* argv[])
     xstrInitCopy(&G_strEsc1, "\\\\", 0);
     xstrInitCopy(&G_strEsc2, "\\", 0);
 
+    // -n must be known before the profile is opened
+    BOOL    fNew = FALSE;
+    int     i;
+    for (i = 2; i < argc; i++)
+        if (!strcmp(argv[i], "-n"))
+            fNew = TRUE;
+
     // open the profile file
     PXINI pIni;
-    if (arc = xprfOpenProfile(argv[1],
-                              &pIni))
+    if (fNew)
+        arc = xprfCreateProfile(argv[1],
+                                &pIni);
+    else
+        arc = xprfOpenProfile(argv[1],
+                              &pIni);
+    if (arc)
     {
         printf("Error %d occured opening \"%s\"\n", arc, argv[1]);
     }
@@ -420,12 +435,16 @@ int main(int argc, char* argv[])
         ULONG   cKeysTotal = 0;
         CHAR    szDirectory[CCHMAXPATH] = "";
 
-        int i = 2;
+        i = 2;
         while (i < argc)
         {
             ULONG   cKeysThis = 0;
 
-            if (!strcmp(argv[i], "-q"))
+            if (!strcmp(argv[i], "-n"))
+            {
+                // handled above
+            }
+            else if (!strcmp(argv[i], "-q"))
             {
                 G_ulVerbosity = 0;
             }
@@ -102,6 +102,7 @@
 
 #include "linklist.h"
 #include "prfh.h"
+#include "tree.h"
 #include "xprf.h"
 
 #pragma hdrstop
@@ -120,13 +121,26 @@
 /*
  *@@ XINIAPPDATA:
  *      application structure in XINI.
+ *
+ *      Applications are kept on XINI.llApps in file order,
+ *      which is the order they are written back in, and
+ *      in XINI.pAppsTree, sorted by name, for lookups.
+ *      The same goes for the keys in each application.
+ *
+ *      Names and data read from the file point into
+ *      XINI.pbFileData and are not copied. Only keys
+ *      written with xprfWriteProfileData get their own
+ *      memory.
  */
 
 typedef struct _XINIAPPDATA
 {
+    TREE        Tree;               // ulKey is pszAppName
     PSZ         pszAppName;
+    BOOL        fInPlace;           // TRUE if pszAppName points into XINI.pbFileData
     LINKLIST    llKeys;             // contains PXINIKEYDATA pointers
     ULONG       cKeys;              // count of items on list
+    TREE        *pKeysTree;         // XINIKEYDATA's sorted by name
 } XINIAPPDATA, *PXINIAPPDATA;
 
 /*
@@ -136,9 +150,12 @@ typedef struct _XINIAPPDATA
 
 typedef struct _XINIKEYDATA
 {
+    TREE        Tree;               // ulKey is pszKeyName
     PSZ         pszKeyName;
     PBYTE       pbData;
     ULONG       cbData;
+    BOOL        fInPlace;           // TRUE if pszKeyName and pbData point
+                                    // into XINI.pbFileData
 } XINIKEYDATA, *PXINIKEYDATA;
 
 /* ******************************************************************
@@ -162,17 +179,14 @@ STATIC APIRET FindApp(PXINI pXIni,           // in: profile opened with xprfOpen
                       const char *pcszApp,
                       PXINIAPPDATA *ppAppData)
 {
-    PLISTNODE pAppNode = lstQueryFirstNode(&pXIni->llApps);
-    while (pAppNode)
-    {
-        PXINIAPPDATA pAppDataThis = (PXINIAPPDATA)pAppNode->pItemData;
-        if (!strcmp(pAppDataThis->pszAppName, pcszApp))
-        {
-            *ppAppData = pAppDataThis;
-            return NO_ERROR;
-        }
+    PXINIAPPDATA pAppData;
 
-        pAppNode = pAppNode->pNext;
+    if (pAppData = (PXINIAPPDATA)treeFind(pXIni->pAppsTree,
+                                          (ULONG)pcszApp,
+                                          treeCompareStrings))
+    {
+        *ppAppData = pAppData;
+        return NO_ERROR;
     }
 
     return PRFERR_INVALID_APP_NAME;
@@ -183,7 +197,12 @@ STATIC APIRET FindApp(PXINI pXIni,           // in: profile opened with xprfOpen
  *      creates a new application in the specified
  *      profile structure and appends it to the list.
  *      This does NOT check for whether the app is
- *      already in the profile.
+ *      already in the profile. If it is, the new one
+ *      is written back to disk, but only the first
+ *      one can be found.
+ *
+ *      If fInPlace is TRUE, pcszApp must point into
+ *      XINI.pbFileData and is not copied.
  *
  *      Private helper.
  *
@@ -192,17 +211,31 @@ STATIC APIRET FindApp(PXINI pXIni,           // in: profile opened with xprfOpen
 
 STATIC APIRET CreateApp(PXINI pXIni,         // in: profile opened with xprfOpenProfile
                         const char *pcszApp,
+                        BOOL fInPlace,
                         PXINIAPPDATA *ppAppData)
 {
     PXINIAPPDATA pAppData;
     if (pAppData = (PXINIAPPDATA)malloc(sizeof(XINIAPPDATA)))
     {
-        pAppData->pszAppName = strdup(pcszApp);
+        if (fInPlace)
+            pAppData->pszAppName = (PSZ)pcszApp;
+        else if (!(pAppData->pszAppName = strdup(pcszApp)))
+        {
+            free(pAppData);
+            return ERROR_NOT_ENOUGH_MEMORY;
+        }
+        pAppData->fInPlace = fInPlace;
         lstInit(&pAppData->llKeys, FALSE);
         pAppData->cKeys = 0;
+        treeInit(&pAppData->pKeysTree, NULL);
 
-        // store in INI's apps list
+        // store in INI's apps list and tree
         lstAppendItem(&pXIni->llApps, pAppData);
+        pAppData->Tree.ulKey = (ULONG)pAppData->pszAppName;
+        treeInsert(&pXIni->pAppsTree,
+                   NULL,
+                   (TREE*)pAppData,
+                   treeCompareStrings);
 
         *ppAppData = pAppData;
         return NO_ERROR;
@@ -226,17 +259,14 @@ STATIC APIRET FindKey(PXINIAPPDATA pAppData,
                       const char *pcszKey,
                       PXINIKEYDATA *ppKeyData)
 {
-    PLISTNODE pKeyNode = lstQueryFirstNode(&pAppData->llKeys);
-    while (pKeyNode)
-    {
-        PXINIKEYDATA pKeyDataThis = (PXINIKEYDATA)pKeyNode->pItemData;
-        if (!strcmp(pKeyDataThis->pszKeyName, pcszKey))
-        {
-            *ppKeyData = pKeyDataThis;
-            return NO_ERROR;
-        }
+    PXINIKEYDATA pKeyData;
 
-        pKeyNode = pKeyNode->pNext;
+    if (pKeyData = (PXINIKEYDATA)treeFind(pAppData->pKeysTree,
+                                          (ULONG)pcszKey,
+                                          treeCompareStrings))
+    {
+        *ppKeyData = pKeyData;
+        return NO_ERROR;
     }
 
     return PRFERR_INVALID_KEY_NAME;
@@ -247,7 +277,12 @@ STATIC APIRET FindKey(PXINIAPPDATA pAppData,
  *      creates a new key in the specified application
  *      structure and appends it to the list.
  *      This does NOT check for whether the key is
- *      already in the application.
+ *      already in the application. If it is, the new
+ *      one is written back to disk, but only the first
+ *      one can be found.
+ *
+ *      If fInPlace is TRUE, pcszKey and pbData must
+ *      point into XINI.pbFileData and are not copied.
  *
  *      Private helper.
  *
@@ -258,27 +293,45 @@ STATIC APIRET CreateKey(PXINIAPPDATA pAppData,
                         const char *pcszKey,        // in: key name
                         PBYTE pbData,               // in: data for key
                         ULONG cbData,               // in: sizeof (*pbData)
+                        BOOL fInPlace,
                         PXINIKEYDATA *ppKeyData)    // out: new key data
 {
     PXINIKEYDATA pKeyData;
     if (pKeyData = (PXINIKEYDATA)malloc(sizeof(XINIKEYDATA)))
     {
-        pKeyData->pszKeyName = strdup(pcszKey);
+        if (fInPlace)
+        {
+            pKeyData->pszKeyName = (PSZ)pcszKey;
+            pKeyData->pbData = pbData;
+        }
+        else
+        {
+            pKeyData->pszKeyName = strdup(pcszKey);
+            if (pKeyData->pbData = (PBYTE)malloc(cbData))
+                memcpy(pKeyData->pbData, pbData, cbData);
+        }
 
-        if (pKeyData->pbData = (PBYTE)malloc(cbData))
+        if (pKeyData->pszKeyName && pKeyData->pbData)
         {
-            memcpy(pKeyData->pbData, pbData, cbData);
             pKeyData->cbData = cbData;
-            // store in app's keys list
+            pKeyData->fInPlace = fInPlace;
+            // store in app's keys list and tree
             lstAppendItem(&pAppData->llKeys, pKeyData);
             pAppData->cKeys++;
+            pKeyData->Tree.ulKey = (ULONG)pKeyData->pszKeyName;
+            treeInsert(&pAppData->pKeysTree,
+                       NULL,
+                       (TREE*)pKeyData,
+                       treeCompareStrings);
 
             *ppKeyData = pKeyData;
             return NO_ERROR;
         }
-        else
-            // malloc failed:
-            free(pKeyData);
+
+        // malloc failed:
+        if (pKeyData->pszKeyName)
+            free(pKeyData->pszKeyName);
+        free(pKeyData);
     }
 
     return ERROR_NOT_ENOUGH_MEMORY;
@@ -295,10 +348,13 @@ STATIC APIRET CreateKey(PXINIAPPDATA pAppData,
 
 STATIC VOID FreeKey(PXINIKEYDATA pKeyDataThis)
 {
-    if (pKeyDataThis->pszKeyName)
-        free(pKeyDataThis->pszKeyName);
-    if (pKeyDataThis->pbData)
-        free(pKeyDataThis->pbData);
+    if (!pKeyDataThis->fInPlace)
+    {
+        if (pKeyDataThis->pszKeyName)
+            free(pKeyDataThis->pszKeyName);
+        if (pKeyDataThis->pbData)
+            free(pKeyDataThis->pbData);
+    }
     free(pKeyDataThis);
 }
 
@@ -319,11 +375,12 @@ STATIC VOID FreeKeyIfExists(PXINI pXIni,         // in: profile opened with xprf
                  pcszKey,
                  &pKeyData))
     {
-        // key exists: kill that
-        FreeKey(pKeyData);
-        // and remove from app's keys list
+        // key exists: remove from app's keys tree and list
+        treeDelete(&pAppData->pKeysTree, NULL, (TREE*)pKeyData);
         lstRemoveItem(&pAppData->llKeys, pKeyData);
         pAppData->cKeys--;
+        // and kill that
+        FreeKey(pKeyData);
 
         // rewrite profile on close
         pXIni->fDirty = TRUE;
@@ -332,6 +389,51 @@ STATIC VOID FreeKeyIfExists(PXINI pXIni,         // in: profile opened with xprf
     // nothing to do
 }
 
+/*
+ * ReplaceKeyData:
+ *      gives an existing key new data. The key stays
+ *      where it is on the application's list.
+ *
+ *      Private helper.
+ */
+
+STATIC APIRET ReplaceKeyData(PXINI pXIni,        // in: profile opened with xprfOpenProfile
+                             PXINIKEYDATA pKeyData,
+                             PBYTE pbData,
+                             ULONG cbData)
+{
+    PBYTE   pbNew;
+
+    if (!(pbNew = (PBYTE)malloc(cbData)))
+        return ERROR_NOT_ENOUGH_MEMORY;
+    memcpy(pbNew, pbData, cbData);
+
+    if (pKeyData->fInPlace)
+    {
+        // the name is in XINI.pbFileData too; give the
+        // key its own copy so FreeKey can free both
+        PSZ pszName;
+        if (!(pszName = strdup(pKeyData->pszKeyName)))
+        {
+            free(pbNew);
+            return ERROR_NOT_ENOUGH_MEMORY;
+        }
+        pKeyData->pszKeyName = pszName;
+        pKeyData->Tree.ulKey = (ULONG)pszName;
+        pKeyData->fInPlace = FALSE;
+    }
+    else
+        free(pKeyData->pbData);
+
+    pKeyData->pbData = pbNew;
+    pKeyData->cbData = cbData;
+
+    // rewrite profile on close
+    pXIni->fDirty = TRUE;
+
+    return NO_ERROR;
+}
+
 /*
  * FreeApp:
  *      frees the specified application. Does not remove
@@ -353,7 +455,9 @@ STATIC VOID FreeApp(PXINIAPPDATA pAppDataThis)
         pKeyNode = pKeyNode->pNext;
     }
 
-    if (pAppDataThis->pszAppName)
+    if (    (pAppDataThis->pszAppName)
+         && (!pAppDataThis->fInPlace)
+       )
         free(pAppDataThis->pszAppName);
 
     lstClear(&pAppDataThis->llKeys);
@@ -383,6 +487,8 @@ STATIC VOID FreeINI(PXINI pXIni)       // in: profile opened with xprfOpenProfil
         }
 
         lstClear(&pXIni->llApps);
+        if (pXIni->pbFileData)
+            free(pXIni->pbFileData);
         free(pXIni);
     }
 }
@@ -398,6 +504,11 @@ STATIC VOID FreeINI(PXINI pXIni)       // in: profile opened with xprfOpenProfil
  *      reads in the entire INI file from disk and
  *      initializes all internal data structures.
  *
+ *      The file data is read with a single DosRead and
+ *      kept in XINI.pbFileData until the profile is
+ *      closed; the names and data of all applications
+ *      and keys point into it.
+ *
  *      Private helper.
  *
  *@@changed V1.0.0 (2002-09-17) [umoeller]: now returning APIRET
@@ -420,6 +531,10 @@ STATIC APIRET ReadINI(PXINI pXIni)      // in: profile opened with xprfOpenProfi
         {
             ULONG ulSet = 0;
 
+            // freed by FreeINI
+            pXIni->pbFileData = pbFileData;
+            pXIni->cbFileData = fs3.cbFile;
+
             if (!(arc = DosSetFilePtr(pXIni->hFile,
                                       0,
                                       FILE_BEGIN,
@@ -450,6 +565,7 @@ STATIC APIRET ReadINI(PXINI pXIni)      // in: profile opened with xprfOpenProfi
 
                                 if (arc = CreateApp(pXIni,
                                                     (PCHAR)(pbFileData + pApp->offAppName),
+                                                    TRUE,       // in place
                                                     &pIniApp))
                                     break;
 
@@ -464,6 +580,7 @@ STATIC APIRET ReadINI(PXINI pXIni)      // in: profile opened with xprfOpenProfi
                                                         (PSZ)(pbFileData + pKey->offKeyName),
                                                         (PBYTE)(pbFileData + pKey->offKeyData),
                                                         pKey->lenKeyData,
+                                                        TRUE,   // in place
                                                         &pIniKey))
                                         break;
 
@@ -478,8 +595,6 @@ STATIC APIRET ReadINI(PXINI pXIni)      // in: profile opened with xprfOpenProfi
                     }
                 }
             }
-
-            free(pbFileData);
         }
     }
 
@@ -491,6 +606,14 @@ STATIC APIRET ReadINI(PXINI pXIni)      // in: profile opened with xprfOpenProfi
  *      writes the entire data structure back to disk.
  *      Does not close the file.
  *
+ *      The new file image is compared with the file
+ *      data read on open, and only the part from the
+ *      first changed byte on is written. Since
+ *      applications and keys keep their file order,
+ *      applications before the first changed one are
+ *      not rewritten, and if nothing has changed,
+ *      nothing is written at all.
+ *
  *      Private helper.
  *
  *@@changed V1.0.0 (2002-09-17) [umoeller]: now returning APIRET
@@ -667,23 +790,56 @@ STATIC APIRET WriteINI(PXINI pXIni)      // in: profile opened with xprfOpenProf
             pAppNode = pAppNode->pNext;
         }
 
-        // write out everything
-        if (!(arc = DosSetFilePtr(pXIni->hFile,
-                                  0,
-                                  FILE_BEGIN,
-                                  &ulSet)))
+        // skip what is on disk already; the header has the
+        // file length, so it is compared and written separately
+        ULONG   ulFirstChanged = 0;
+        if (    (pXIni->pbFileData)
+             && (pXIni->cbFileData >= sizeof(INIFILE_HEADER))
+           )
         {
+            ULONG cbCompare = __min(ulTotalFileSize, pXIni->cbFileData);
             ULONG cbWritten = 0;
-            if (!(arc = DosWrite(pXIni->hFile,
-                                 pbData2Write,
-                                 ulTotalFileSize,
-                                 &cbWritten)))
+
+            ulFirstChanged = sizeof(INIFILE_HEADER);
+            while (    (ulFirstChanged < cbCompare)
+                    && (pbData2Write[ulFirstChanged] == pXIni->pbFileData[ulFirstChanged])
+                  )
+                ulFirstChanged++;
+
+            if (    (memcmp(pbData2Write, pXIni->pbFileData, sizeof(INIFILE_HEADER)))
+                 && (!(arc = DosSetFilePtr(pXIni->hFile,
+                                           0,
+                                           FILE_BEGIN,
+                                           &ulSet)))
+               )
+                arc = DosWrite(pXIni->hFile,
+                               pbData2Write,
+                               sizeof(INIFILE_HEADER),
+                               &cbWritten);
+        }
+
+        // write out the rest
+        if (    (!arc)
+             && (    (ulFirstChanged < ulTotalFileSize)
+                  || (ulTotalFileSize != pXIni->cbFileData)
+                )
+           )
+            if (!(arc = DosSetFilePtr(pXIni->hFile,
+                                      ulFirstChanged,
+                                      FILE_BEGIN,
+                                      &ulSet)))
             {
-                if (!(arc = DosSetFileSize(pXIni->hFile,
-                                           ulTotalFileSize)))
-                    ;
+                ULONG cbWritten = 0;
+                if (!(arc = DosWrite(pXIni->hFile,
+                                     pbData2Write + ulFirstChanged,
+                                     ulTotalFileSize - ulFirstChanged,
+                                     &cbWritten)))
+                {
+                    if (!(arc = DosSetFileSize(pXIni->hFile,
+                                               ulTotalFileSize)))
+                        ;
+                }
             }
-        }
 
         free(pbData2Write);
     }
@@ -767,6 +923,7 @@ APIRET xprfOpenProfile(const char *pcszFilename,    // in: profile name
                 // pXIni->hLock = hLock;
 
                 lstInit(&pXIni->llApps, FALSE);
+                treeInit(&pXIni->pAppsTree, NULL);
 
                 if (ulAction == FILE_CREATED)
                     // file newly created: rewrite on close
@@ -788,6 +945,77 @@ APIRET xprfOpenProfile(const char *pcszFilename,    // in: profile name
     return arc;
 }
 
+/*
+ *@@ xprfCreateProfile:
+ *      like xprfOpenProfile, but always starts out with
+ *      an empty profile; an existing file is not read
+ *      and is replaced on xprfCloseProfile.
+ *
+ *      This is for building a profile from scratch: all
+ *      data is collected in memory and written to disk
+ *      in one go.
+ */
+
+APIRET xprfCreateProfile(const char *pcszFilename,  // in: profile name
+                         PXINI *ppxini)             // out: profile handle
+{
+    APIRET  arc = NO_ERROR;
+    PXINI   pXIni = NULL;
+    ULONG   ulFilenameLen;
+
+    if (    (!pcszFilename)
+         || (!ppxini)
+         || (!(ulFilenameLen = strlen(pcszFilename)))
+       )
+        arc = ERROR_INVALID_PARAMETER;
+    else if (ulFilenameLen >= CCHMAXPATH - 1)
+        arc = ERROR_FILENAME_EXCED_RANGE;
+    else
+    {
+        HFILE   hFile = NULLHANDLE;
+        ULONG   ulAction = 0;
+
+        if (!(arc = DosOpen((PSZ)pcszFilename,
+                            &hFile,
+                            &ulAction,
+                            1024,          // initial size
+                            FILE_NORMAL,
+                            OPEN_ACTION_CREATE_IF_NEW
+                               | OPEN_ACTION_REPLACE_IF_EXISTS,
+                            OPEN_FLAGS_FAIL_ON_ERROR
+                               | OPEN_FLAGS_SEQUENTIAL
+                               | OPEN_SHARE_DENYREADWRITE
+                               | OPEN_ACCESS_READWRITE,
+                            NULL)))
+        {
+            if (!(pXIni = (PXINI)malloc(sizeof(XINI))))
+            {
+                arc = ERROR_NOT_ENOUGH_MEMORY;
+                DosClose(hFile);
+            }
+            else
+            {
+                memset(pXIni, 0, sizeof(XINI));
+                memcpy(pXIni->acMagic, XINI_MAGIC_BYTES, sizeof(XINI_MAGIC_BYTES));
+                memcpy(pXIni->szFilename,
+                       pcszFilename,
+                       ulFilenameLen + 1);
+                pXIni->hFile = hFile;
+
+                lstInit(&pXIni->llApps, FALSE);
+                treeInit(&pXIni->pAppsTree, NULL);
+
+                // always write on close
+                pXIni->fDirty = TRUE;
+
+                *ppxini = pXIni;
+            }
+        }
+    }
+
+    return arc;
+}
+
 /*
  *@@ xprfQueryProfileSize:
  *      returns the size of INI data, similarly to
@@ -1022,6 +1250,11 @@ APIRET xprfQueryProfileData(PXINI pXIni,          // in: profile opened with xpr
  *      You cannot specify HINI_SYSTEM or HINI_USER for
  *      hINi.
  *
+ *      Writing the data a key has already is a no-op,
+ *      and a key whose data changes keeps its place in
+ *      its application, so that the file is only
+ *      rewritten from the first real change on.
+ *
  *      Note that if data has been added or removed,
  *      the INI file on disk is not updated automatically.
  *      Instead, our memory copy of it is only marked
@@ -1062,10 +1295,11 @@ APIRET xprfWriteProfileData(PXINI pXIni,          // in: profile opened with xpr
             // yes, delete application: did we find it?
             if (pAppData)
             {
-                // yes: kill that
-                FreeApp(pAppData);
-                // and remove from list
+                // yes: remove from tree and list
+                treeDelete(&pXIni->pAppsTree, NULL, (TREE*)pAppData);
                 lstRemoveItem(&pXIni->llApps, pAppData);
+                // and kill that
+                FreeApp(pAppData);
 
                 // rewrite profile on close
                 pXIni->fDirty = TRUE;
@@ -1099,25 +1333,35 @@ APIRET xprfWriteProfileData(PXINI pXIni,          // in: profile opened with xpr
                     // create
                     arc = CreateApp(pXIni,
                                     pcszApp,
+                                    FALSE,      // copy
                                     &pAppData);
 
                 if (!arc)
                 {
                     // found or created app:
-
-                    // delete existing key if it exists
                     PXINIKEYDATA pKeyData;
 
-                    FreeKeyIfExists(pXIni,
-                                    pAppData,
-                                    (PCHAR)pcszKey);
-
+                    if (!FindKey(pAppData,
+                                 pcszKey,
+                                 &pKeyData))
+                    {
+                        // key exists: replace its data in place
+                        if (    (pKeyData->cbData != ulDataLen)
+                             || (memcmp(pKeyData->pbData, pData, ulDataLen))
+                           )
+                            arc = ReplaceKeyData(pXIni,
+                                                 pKeyData,
+                                                 (PBYTE)pData,
+                                                 ulDataLen);
+                        // else same data: nothing to do
+                    }
                     // now create new key
-                    if (!(arc = CreateKey(pAppData,
-                                          pcszKey,
-                                          (PBYTE)pData,
-                                          ulDataLen,
-                                          &pKeyData)))
+                    else if (!(arc = CreateKey(pAppData,
+                                               pcszKey,
+                                               (PBYTE)pData,
+                                               ulDataLen,
+                                               FALSE,    // copy
+                                               &pKeyData)))
                        // mark as dirty
                        pXIni->fDirty = TRUE;
                 }
@@ -164,6 +164,11 @@ extern "C" {
 
             // applications list
             LINKLIST    llApps;             // contains PXINIAPPDATA items
+
+            struct _TREE *pAppsTree;        // the same XINIAPPDATA's sorted by name
+            PBYTE       pbFileData;         // file contents as read on open;
+                                            // app and key data points into this
+            ULONG       cbFileData;         // size of pbFileData
         } XINI, *PXINI;
     #else
         typedef void* PXINI;
@@ -172,6 +177,9 @@ extern "C" {
     APIRET xprfOpenProfile(const char *pcszFilename,
                            PXINI *ppxini);
 
+    APIRET xprfCreateProfile(const char *pcszFilename,
+                             PXINI *ppxini);
+
     APIRET xprfCloseProfile(PXINI hIni);
 
     APIRET xprfQueryProfileSize(PXINI pXIni,
@@ -6,15 +6,60 @@ BUILTIN commands[] =
   "exit", exit_cmd,
   "help", cmds_cmd,
   "cd", chdir_cmd,
-  "chdir", chdir_cmd
+  "chdir", chdir_cmd,
+  "rem", rem_cmd,
+  NULL, NULL
 };
 
+// Built-in lookup table. Names are hashed into a table with more slots
+// than there are commands, so a lookup mostly costs one hash and one
+// strcmp instead of a strcmp per command. Collisions go to the next slot.
+#define BUILTIN_SLOTS 16
+
+static BUILTIN *builtin_table[BUILTIN_SLOTS];
+static BOOL builtin_table_ready = FALSE;
+
+static unsigned int builtin_hash(char *name)
+{
+  unsigned int h = 0;
+
+  while (*name)
+    h = h * 31 + (unsigned char)*name++;
+
+  return h % BUILTIN_SLOTS;
+}
+
+BUILTIN *find_builtin(char *name)
+{
+  unsigned int i, h;
+
+  if (!builtin_table_ready)
+  {
+    for (i=0;commands[i].cmdname;i++)
+    {
+      h = builtin_hash(commands[i].cmdname);
+      while (builtin_table[h])
+        h = (h + 1) % BUILTIN_SLOTS;
+      builtin_table[h] = &commands[i];
+    }
+    builtin_table_ready = TRUE;
+  }
+
+  for (h = builtin_hash(name); builtin_table[h]; h = (h + 1) % BUILTIN_SLOTS)
+  {
+    if (!strcmp(name, builtin_table[h]->cmdname))
+      return builtin_table[h];
+  }
+
+  return NULL;
+}
+
 int cmds_cmd(int argc, char **argv)
 {
   unsigned int i;
 
   VioWrtTTY("Commands:\r\n", 11, 0);
-  for (i=0;i<5;i++)
+  for (i=0;commands[i].cmdname;i++)
   {
     VioWrtTTY(commands[i].cmdname, strlen(commands[i].cmdname), 0);
     VioWrtTTY("\x9", 1, 0);
@@ -28,6 +73,11 @@ int exit_cmd(int argc, char **argv)
   return 0;
 }
 
+int rem_cmd(int argc, char **argv)
+{
+  return 0;
+}
+
 
 int chdir_cmd(int argc, char **argv)
 {
@@ -30,31 +30,236 @@ int QueryDriveReady( int drive )
 }
 
 
-void execute_external(int argc, char **argv)
+// External commands are looked up in the current directory first and
+// then along PATH. PATH lookups are remembered for the session, so a
+// batch file calling the same programs over and over searches PATH once
+// per program. The cache is dropped whenever PATH is not the value it
+// was filled for.
+#define PATHCACHE_SIZE  32
+#define PATHENV_MAX     1024
+
+typedef struct
+{
+  char name[CCHMAXPATH];                // command as typed
+  char path[CCHMAXPATH];                // where it was found
+} PATHCACHE;
+
+static PATHCACHE pathcache[PATHCACHE_SIZE];
+static int pathcache_count = 0;
+static int pathcache_next = 0;          // entry replaced when full
+static char pathcache_env[PATHENV_MAX]; // PATH the cache belongs to
+static BOOL pathcache_valid = FALSE;
+
+BOOL file_exists(char *name)
+{
+  FILESTATUS3 fs;
+
+  return (( DosQueryPathInfo(name, FIL_STANDARD, &fs, sizeof(fs)) == NO_ERROR ) &&
+          !( fs.attrFile & FILE_DIRECTORY ));
+}
+
+void pathcache_check(void)
+{
+  PSZ path;
+
+  if (DosScanEnv("PATH", &path) != NO_ERROR)
+    path = "";
+
+  if (pathcache_valid && !strcmp(pathcache_env, path))
+    return;
+
+  pathcache_count = 0;
+  pathcache_next = 0;
+
+  // a PATH we can't keep a copy of just isn't cached
+  pathcache_valid = ( strlen(path) < PATHENV_MAX );
+  if (pathcache_valid)
+    strcpy(pathcache_env, path);
+}
+
+BOOL resolve_external(char *name, char *result)
+{
+  char cand[2][CCHMAXPATH];
+  int  ncand, i;
+  char *p;
+
+  if (strlen(name) >= CCHMAXPATH - 4)
+    return FALSE;
+
+  // without an extension try .EXE and .CMD
+  p = name + strlen(name);
+  while (( p > name ) && ( p[-1] != '\\' ) && ( p[-1] != '/' ) && ( p[-1] != ':' ) && ( *p != '.' ))
+    p--;
+
+  if (*p == '.')
+  {
+    strcpy(cand[0], name);
+    ncand = 1;
+  } else {
+    strcpy(cand[0], name); strcat(cand[0], ".EXE");
+    strcpy(cand[1], name); strcat(cand[1], ".CMD");
+    ncand = 2;
+  }
+
+  for (i=0;i<ncand;i++)
+  {
+    if (file_exists(cand[i]))
+    {
+      strcpy(result, cand[i]);
+      return TRUE;
+    }
+  }
+
+  // names with a path aren't searched for
+  if (strchr(name, '\\') || strchr(name, '/') || strchr(name, ':'))
+    return FALSE;
+
+  pathcache_check();
+  for (i=0;i<pathcache_count;i++)
+  {
+    if (!stricmp(pathcache[i].name, name))
+    {
+      strcpy(result, pathcache[i].path);
+      return TRUE;
+    }
+  }
+
+  for (i=0;i<ncand;i++)
+  {
+    if (DosSearchPath(SEARCH_IGNORENETERRS | SEARCH_ENVIRONMENT, "PATH",
+                      cand[i], result, CCHMAXPATH) == NO_ERROR)
+    {
+      if (pathcache_valid)
+      {
+        strcpy(pathcache[pathcache_next].name, name);
+        strcpy(pathcache[pathcache_next].path, result);
+        pathcache_next = (pathcache_next + 1) % PATHCACHE_SIZE;
+        if (pathcache_count < PATHCACHE_SIZE)
+          pathcache_count++;
+      }
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+BOOL is_batch(char *name)
+{
+  int len = strlen(name);
+
+  return (( len > 4 ) && !stricmp(name + len - 4, ".CMD"));
+}
+
+BOOL execute_external(int argc, char **argv)
 {
   UCHAR       LoadError[255];
-  PSZ         Args;
-  PSZ         Envs;
+  UCHAR       ProgName[CCHMAXPATH];
+  UCHAR       Args[1024];
   RESULTCODES ChildRC;
   APIRET      rc;  /* Return code */
+  ULONG       cb, len;
+  int         i;
+
+  if (!resolve_external(argv[0], ProgName))
+  {
+    VioWrtTTY("Bad command or file name\r\n", 26, 0);
+    return FALSE;
+  }
+
+  if (is_batch(ProgName))
+    return run_batch(ProgName);
+
+  // argument string: program name, NUL, arguments, NUL, NUL
+  len = strlen(ProgName);
+  memcpy(Args, ProgName, len + 1);
+  cb = len + 1;
+  for (i=1;i<argc;i++)
+  {
+    len = strlen(argv[i]);
+    if (cb + len + 3 > sizeof(Args))
+      break;
+    if (i > 1)
+      Args[cb++] = ' ';
+    memcpy(Args + cb, argv[i], len);
+    cb += len;
+  }
+  Args[cb++] = '\0';
+  Args[cb] = '\0';
 
   rc = DosExecPgm(LoadError,           /* Object name buffer           */
                   sizeof(LoadError),   /* Length of object name buffer */
                   EXEC_SYNC,           /* Asynchronous/Trace flags     */
-                  argv[1], //Args,                /* Argument string              */
+                  Args,                /* Argument string              */
                   NULL, //Envs,                /* Environment string           */
                   &ChildRC,            /* Termination codes            */
-                  argv[0]);                /* Program file name            */
+                  ProgName);           /* Program file name            */
 
   if (rc != NO_ERROR) {
 //     printf("DosExecPgm error: return code = %u\n",rc);
      VioWrtTTY("DosExecPgm error\r\n", 18, 0); //: return code = %u\n",rc);
-     return ;
   } else {
 //     printf("DosExecPgm complete.  Termination Code: %u  Return Code: %u\n",
 //             ChildRC.codeTerminate,
 //             ChildRC.codeResult);  /* This is explicitly set by other pgm */
   } /* endif */
+
+  return FALSE;
+}
+
+// Batch files are read with one DosRead and run line by line from
+// memory. Returns TRUE if the batch file said EXIT.
+BOOL run_batch(char *file)
+{
+  HFILE       hf;
+  ULONG       ulAction, cbRead;
+  FILESTATUS3 fs;
+  char        *buf, *line, *end, *eol;
+  BOOL        exitflag = FALSE;
+
+  if (DosOpen(file, &hf, &ulAction, 0, FILE_NORMAL,
+              OPEN_ACTION_FAIL_IF_NEW | OPEN_ACTION_OPEN_IF_EXISTS,
+              OPEN_FLAGS_SEQUENTIAL | OPEN_SHARE_DENYWRITE | OPEN_ACCESS_READONLY,
+              NULL) != NO_ERROR)
+  {
+    VioWrtTTY("Can't open batch file\r\n", 23, 0);
+    return FALSE;
+  }
+
+  if (( DosQueryFileInfo(hf, FIL_STANDARD, &fs, sizeof(fs)) != NO_ERROR ) ||
+      !( buf = malloc(fs.cbFile + 1) ))
+  {
+    DosClose(hf);
+    return FALSE;
+  }
+
+  if (DosRead(hf, buf, fs.cbFile, &cbRead) != NO_ERROR)
+    cbRead = 0;
+  DosClose(hf);
+
+  end = buf + cbRead;
+  *end = '\0';
+
+  for (line = buf; ( line < end ) && !exitflag; line = eol + 1)
+  {
+    if (!( eol = memchr(line, '\n', end - line) ))
+      eol = end;
+    *eol = '\0';
+    if (( eol > line ) && ( eol[-1] == '\r' ))
+      eol[-1] = '\0';
+
+    // ^Z ends the file
+    if (*line == '\x1a')
+      break;
+
+    while (( *line == ' ' ) || ( *line == '\t' ) || ( *line == '@' ))
+      line++;
+
+    exitflag = parse_cmd(line);
+  }
+
+  free(buf);
+  return exitflag;
 }
 
 
@@ -65,10 +270,10 @@ int isdelim( char c )
 
 BOOL parse_cmd(char *cmd)
 {
-  unsigned int i, rc;
   int Argc;                // argument count
   char *Argv[10];      // argument pointers
   char *pszTemp;
+  BUILTIN *builtin;
 
   if (strlen(cmd)==0)
   {
@@ -110,23 +315,16 @@ BOOL parse_cmd(char *cmd)
 
   Argv[Argc] = NULL;
 
-  if (!strcmp(Argv[0], "exit"))
+  if (( builtin = find_builtin(Argv[0]) ))
   {
-    return TRUE;
-  }
+    if (builtin->func == exit_cmd)
+      return TRUE;
 
-  for (i=0;i<5;i++)
-  {
-    if (!strcmp(Argv[0], commands[i].cmdname))
-    {
-      (*(commands[i].func))(Argc, Argv);
-      return FALSE;
-    }
+    (*(builtin->func))(Argc, Argv);
+    return FALSE;
   }
 
-  execute_external(Argc, Argv);
-
-  return FALSE;
+  return execute_external(Argc, Argv);
 }
 
 void read_cmd(char *cmd)
@@ -166,10 +364,31 @@ void showpath(void)
   VioWrtTTY(">", 1, 0);
 }
 
-void main(void)
+void main(int argc, char **argv)
 {
   UCHAR cmd[255];
   BOOL exitflag;
+  int i, first;
+
+  // "minicmd [/c] command" runs one command (or batch file) and exits
+  if (argc > 1)
+  {
+    first = 1;
+    if (!stricmp(argv[1], "/c"))
+      first = 2;
+
+    cmd[0] = '\0';
+    for (i = first; i < argc; i++)
+    {
+      if (strlen(cmd) + strlen(argv[i]) + 2 > sizeof(cmd))
+        break;
+      if (i > first)
+        strcat(cmd, " ");
+      strcat(cmd, argv[i]);
+    }
+    parse_cmd(cmd);
+    exit(0);
+  }
 
   hello();
 
@@ -22,5 +22,11 @@ typedef struct
 int cmds_cmd(int argc, char **argv);
 int exit_cmd(int argc, char **argv);
 int chdir_cmd(int argc, char **argv);
+int rem_cmd(int argc, char **argv);
 
 extern BUILTIN commands[];
+
+BUILTIN *find_builtin(char *name);
+
+BOOL parse_cmd(char *cmd);
+BOOL run_batch(char *file);
@@ -16,6 +16,13 @@
    Version 2.0: Completely ignores carriage return characters, but on a
    line feed, does both line feed and carriage return.
 
+   Input is read in large blocks with DosRead instead of fgetc.  When
+   the input is a file, the offsets of its lines are indexed as they
+   are read, so the 0-9 keys jump to 0%-90% of it, paging back beyond
+   the lines kept in memory re-reads them, and only a few screens of
+   lines are kept.  When the output is not the screen, the input is
+   copied straight to it.
+
    KNOWN BUGS:
 
    Version 1.1: The disappering cursor thingy.  Icky formatting issues.
@@ -24,6 +31,7 @@
    */
 
 /* #define INCL_DOS */
+#define INCL_DOSFILEMGR
 #define INCL_VIO
 #define INCL_KBD
 #include <osfree.h>
@@ -33,9 +41,23 @@
 
 typedef struct _dllist {
         char *string;
+        ULONG offset;                   /* file offset of the line */
         struct _dllist *next,*previous;
 } dllist, *pdllist, **ppdllist;
 
+typedef struct _morefile {
+        HFILE hf;
+        BOOL seekable;                  /* a file: lines are indexed */
+        BOOL eof;                       /* DosRead returned 0 */
+        CHAR *buf;                      /* unread input is buf[pos..len) */
+        ULONG pos,len;
+        ULONG bufoff;                   /* file offset of buf[0] */
+        ULONG size;
+        ULONG *lines;                   /* offsets of the line starts */
+        ULONG nlines,maxlines;
+        ULONG indexed;                  /* lines[] covers [0,indexed) */
+} morefile, *pmorefile;
+
 
 #define CONTROL_S 19
 #define PROMPT "-- MORE v2.0 (C)1993 --"
@@ -50,6 +72,16 @@ typedef struct _dllist {
 
 #define MORE_EOF 1
 
+#define BLOCKSIZE 0x10000
+#define KEEP_LINES 1000                 /* kept behind the screen top */
+
+#ifndef HANDTYPE_FILE
+#define HANDTYPE_FILE   0x0000
+#define HANDTYPE_DEVICE 0x0001
+#endif
+
+#define MORE_FEOF(mf) ((mf)->eof && (mf)->pos>=(mf)->len)
+
 int tabsize,options,scrollup;
 CHAR bright[2],attrib[2],blankcell[2],colorcell[2],underscore,bold;
 
@@ -68,72 +100,298 @@ void add_dllist(ppdllist first, ppdllist prev, ppdllist new) {
         }
 }
 
-char *get_single_line(FILE *input,int width) {
-        char *result,readin;
-        int counter,j,end,reread;
+/* add the line starts in a block read at file offset 'off' */
+void index_block(pmorefile mf, ULONG off, CHAR *block, ULONG n) {
+        CHAR *p,*nl;
+        ULONG *grown;
+
+        if (!mf->seekable || off>mf->indexed || off+n<=mf->indexed) return;
+        p=block+(mf->indexed-off);
+        while ((nl=memchr(p,'\n',n-(p-block)))!=NULL) {
+                if (mf->nlines==mf->maxlines) {
+                        grown=(ULONG*)realloc(mf->lines,
+                                              mf->maxlines*2*sizeof(ULONG));
+                        if (!grown) {
+                                mf->seekable=FALSE;
+                                return;
+                        }
+                        mf->lines=grown;
+                        mf->maxlines*=2;
+                }
+                p=nl+1;
+                mf->lines[mf->nlines++]=off+(p-block);
+        }
+        mf->indexed=off+n;
+}
 
-        result=(char*)malloc((width+1)*2*sizeof(char));
-        for (counter=0;counter<width*2;counter++) {
-                result[counter++]=' ';
-                result[counter]=attrib[0];
+/* read 'n' bytes at 'off' without moving the block reader */
+ULONG read_at(pmorefile mf, ULONG off, CHAR *dest, ULONG n) {
+        ULONG got,pos;
+
+        got=0;
+        if (DosSetFilePtr(mf->hf,off,FILE_BEGIN,&pos)==0)
+                DosRead(mf->hf,dest,n,&got);
+        DosSetFilePtr(mf->hf,mf->bufoff+mf->len,FILE_BEGIN,&pos);
+        return(got);
+}
+
+/* index the file up to offset 'upto' (or its end) */
+void index_to(pmorefile mf, ULONG upto) {
+        CHAR *block;
+        ULONG got;
+
+        block=(CHAR*)malloc(BLOCKSIZE);
+        if (!block) return;
+        while (mf->seekable && mf->indexed<upto && mf->indexed<mf->size) {
+                got=read_at(mf,mf->indexed,block,BLOCKSIZE);
+                if (!got) break;
+                index_block(mf,mf->indexed,block,got);
         }
-        counter=0;
-        end=FALSE;
-        reread=TRUE;
-        while(counter<width*2 && !end) {
-                if (reread) readin=fgetc(input);
-                switch (readin) {
+        free(block);
+}
+
+/* index of the last line starting before 'off' */
+ULONG find_line(pmorefile mf, ULONG off) {
+        ULONG lo,hi,mid;
+
+        lo=0;
+        hi=mf->nlines;
+        while (hi-lo>1) {
+                mid=(lo+hi)/2;
+                if (mf->lines[mid]<off) lo=mid;
+                else hi=mid;
+        }
+        return(lo);
+}
+
+/* continue the block reader at 'off' */
+void seek_to(pmorefile mf, ULONG off) {
+        ULONG pos;
+
+        DosSetFilePtr(mf->hf,off,FILE_BEGIN,&pos);
+        mf->bufoff=off;
+        mf->pos=mf->len=0;
+        mf->eof=FALSE;
+}
+
+/* keep the unread bytes and read another block after them */
+void fill_buffer(pmorefile mf) {
+        ULONG got;
+
+        if (mf->eof) return;
+        memmove(mf->buf,mf->buf+mf->pos,mf->len-mf->pos);
+        mf->bufoff+=mf->pos;
+        mf->len-=mf->pos;
+        mf->pos=0;
+        if (DosRead(mf->hf,mf->buf+mf->len,BLOCKSIZE-mf->len,&got) || !got) {
+                mf->eof=TRUE;
+                return;
+        }
+        index_block(mf,mf->bufoff+mf->len,mf->buf+mf->len,got);
+        mf->len+=got;
+}
+
+BOOL open_input(pmorefile mf, HFILE hf) {
+        ULONG type,attr;
+
+        memset(mf,0,sizeof(morefile));
+        mf->hf=hf;
+        mf->buf=(CHAR*)malloc(BLOCKSIZE);
+        if (!mf->buf) return(FALSE);
+        if (DosQueryHType(hf,&type,&attr)==0 &&
+            (type&0xff)==HANDTYPE_FILE &&
+            DosSetFilePtr(hf,0,FILE_END,&mf->size)==0) {
+                DosSetFilePtr(hf,0,FILE_BEGIN,&attr);
+                mf->maxlines=1024;
+                mf->lines=(ULONG*)malloc(mf->maxlines*sizeof(ULONG));
+                if (mf->lines) {
+                        mf->lines[mf->nlines++]=0;
+                        mf->seekable=TRUE;
+                }
+        }
+        return(TRUE);
+}
+
+void close_input(pmorefile mf) {
+        if (mf->hf) DosClose(mf->hf);
+        free(mf->buf);
+        free(mf->lines);
+}
+
+/* expand text from 'src' into the cells of a line, up to its end or
+   the screen width.  Returns the bytes used; '\b' at the end of 'src'
+   is left alone if 'more' input can follow it. */
+ULONG expand_line(CHAR *result, int width, int *counter,
+                  CHAR *src, ULONG n, BOOL more, BOOL *end) {
+        ULONG i;
+        int j;
+
+        for (i=0;i<n && *counter<width*2;i++) {
+                switch (src[i]) {
                 case '\t':
-                        for (j=0;j<tabsize;j++) {
-                                result[counter]=' ';
-                                counter+=CELLSIZE;
+                        for (j=0;j<tabsize && *counter<width*2;j++) {
+                                result[*counter]=' ';
+                                *counter+=CELLSIZE;
                         }
                         break;
                 case '\b':
-                        readin=fgetc(input);
-                        switch(result[counter-CELLSIZE]) {
+                        if (i+1>=n) {
+                                if (more) return(i);
+                                break;
+                        }
+                        if (*counter<CELLSIZE) break;
+                        switch(result[*counter-CELLSIZE]) {
                         case '_':
-                                result[counter-CELLSIZE+1]=underscore;
+                                result[*counter-CELLSIZE+1]=underscore;
                                 break;
                         default:
-                                result[counter-CELLSIZE+1]=bold;
+                                result[*counter-CELLSIZE+1]=bold;
                                 break;
                         }
-                        result[counter-CELLSIZE]=readin;
+                        result[*counter-CELLSIZE]=src[++i];
                         break;
                 case '\r':
                         break;
                 case '\n':
-                        end=TRUE;
-                        break;
+                        *end=TRUE;
+                        return(i+1);
                 default:
-                        result[counter]=readin;
-                        counter+=CELLSIZE;
+                        result[*counter]=src[i];
+                        *counter+=CELLSIZE;
                         break;
                 }
         }
+        /* a line that just fills the screen takes its line feed along */
+        while (i<n && src[i]=='\r') i++;
+        if (i<n && src[i]=='\n') {
+                *end=TRUE;
+                i++;
+        }
+        return(i);
+}
+
+CHAR *new_line(int width) {
+        CHAR *result;
+        int counter;
+
+        result=(char*)malloc((width+1)*2*sizeof(char));
+        for (counter=0;counter<width*2;counter++) {
+                result[counter++]=' ';
+                result[counter]=attrib[0];
+        }
+        return(result);
+}
+
+char *get_single_line(pmorefile mf,int width,ULONG *offset) {
+        char *result,*nl;
+        int counter,end;
+        ULONG n;
+
+        result=new_line(width);
+        counter=0;
+        end=FALSE;
+        if (mf->pos>=mf->len) fill_buffer(mf);
+        *offset=mf->bufoff+mf->pos;
+        while(counter<width*2 && !end && mf->pos<mf->len) {
+                /* the tail of the line in the buffer */
+                nl=memchr(mf->buf+mf->pos,'\n',mf->len-mf->pos);
+                n=nl ? nl-(mf->buf+mf->pos)+1 : mf->len-mf->pos;
+                n=expand_line(result,width,&counter,mf->buf+mf->pos,n,
+                              !nl && !mf->eof,&end);
+                mf->pos+=n;
+                if (!end && counter<width*2) {
+                        if (mf->eof) break;
+                        fill_buffer(mf);
+                }
+        }
         return(result);
 }
 
-int get_screenful(FILE *input,
+int get_screenful(pmorefile mf,
                                   ppdllist first,
                                   ppdllist after,
                                   int width,
                                   int height) {
         int counter;
-        char *temp;
         pdllist new_element;
 
         counter=0;
-        while (counter<height && !feof(input)) {
+        if (mf->pos>=mf->len) fill_buffer(mf);
+        while (counter<height && !MORE_FEOF(mf)) {
                 new_element=(pdllist)malloc(sizeof(dllist));
-                new_element->string=get_single_line(input,width);
+                new_element->string=get_single_line(mf,width,
+                                                    &new_element->offset);
                 add_dllist(first,after,&new_element);
                 counter++;
+                if (mf->pos>=mf->len) fill_buffer(mf);
         }
         return(counter);
 }
 
+/* re-read the lines of the file just before 'head', the first line in
+   memory, and link them in front of it */
+BOOL extend_back(pmorefile mf, pdllist head, int width) {
+        pdllist first,last,new_element;
+        CHAR *text;
+        ULONG start,n,used;
+        int counter,end;
+
+        if (!mf->seekable || !head || !head->offset) return(FALSE);
+        start=mf->lines[find_line(mf,head->offset)];
+        n=head->offset-start;
+        text=(CHAR*)malloc(n);
+        if (!text) return(FALSE);
+        if (read_at(mf,start,text,n)!=n) {
+                free(text);
+                return(FALSE);
+        }
+        first=last=NULL;
+        used=0;
+        while (used<n) {
+                new_element=(pdllist)malloc(sizeof(dllist));
+                new_element->string=new_line(width);
+                new_element->offset=start+used;
+                counter=0;
+                end=FALSE;
+                used+=expand_line(new_element->string,width,&counter,
+                                  text+used,n-used,FALSE,&end);
+                add_dllist(&first,&last,&new_element);
+        }
+        free(text);
+        if (!first) return(FALSE);
+        last->next=head;
+        head->previous=last;
+        return(TRUE);
+}
+
+void free_dllist(pdllist any) {
+        pdllist next;
+
+        if (!any) return;
+        while (any->previous) any=any->previous;
+        while (any) {
+                next=any->next;
+                free(any->string);
+                free(any);
+                any=next;
+        }
+}
+
+/* drop the lines more than KEEP_LINES before 'top'; they can be read
+   again from the file */
+void trim_dllist(pmorefile mf, pdllist top) {
+        pdllist keep;
+        int i;
+
+        if (!mf->seekable || !top) return;
+        keep=top;
+        for (i=0;i<KEEP_LINES && keep->previous;i++) keep=keep->previous;
+        if (!keep->previous) return;
+        keep->previous->next=NULL;
+        free_dllist(keep->previous);
+        keep->previous=NULL;
+}
+
 void display_screenful(pdllist first,int height,int width, int read) {
         int i;
         char *display;
@@ -173,9 +431,10 @@ void display_screenful(pdllist first,int height,int width, int read) {
         free(display);
 }
 
-int backup(ppdllist which, int n) {
+int backup(pmorefile mf, ppdllist which, int n, int width) {
         int i=0;
-        while ((*which)->previous && n) {
+        while (n && ((*which)->previous ||
+                     extend_back(mf,*which,width))) {
                 (*which)=(*which)->previous;
                 n--;
                 i++;
@@ -185,7 +444,7 @@ int backup(ppdllist which, int n) {
 
 void forward_search(ppdllist list,
                                         ppdllist end_of_list,
-                                        FILE *input,
+                                        pmorefile mf,
                                         char *string,
                                         int rows,
                                         int cols,
@@ -201,20 +460,21 @@ void forward_search(ppdllist list,
         }
         while(1) {
                 if (strstr((*list)->string,expanded)) break;
-                if (feof(input) && (*end_of_list)->next==NULL) break;
+                if (MORE_FEOF(mf) && (*end_of_list)->next==NULL) break;
                 if ((*list)->next) {
                         (*list)=(*list)->next;
                         (*offscreen)--;
                 } else {
                         new_element=(pdllist)malloc(sizeof(dllist));
-                        new_element->string=get_single_line(input,cols);
+                        new_element->string=get_single_line(mf,cols,
+                                                    &new_element->offset);
                         add_dllist(list,end_of_list,&new_element);
                 }
         }
-        backup(end_of_list,rows);
+        backup(mf,end_of_list,rows,cols);
 }
 
-void more_file(FILE *input) {
+void more_file(pmorefile mf) {
         PVIOMODEINFO vmi;
         KBDKEYINFO kbdi;
         SHORT rows,cols;
@@ -226,6 +486,7 @@ void more_file(FILE *input) {
         int i,val,read,lines,offscreen;
         USHORT rc,upval,r,c;
         KBDINFO kbdinfo;
+        ULONG upto;
 
         KbdGetStatus(&kbdinfo,0);
         vmi=(PVIOMODEINFO)malloc(sizeof(VIOMODEINFO));
@@ -241,23 +502,23 @@ void more_file(FILE *input) {
         end_of_list=NULL;
         lines=rows;
         offscreen=0;
-        while (options&MORE_EOF?1:!feof(input)) {
+        while (options&MORE_EOF?1:!MORE_FEOF(mf)) {
                 if (lines-offscreen>0) {
-                        read=get_screenful(input,
+                        read=get_screenful(mf,
                                                            &whole_list,
                                                            &end_of_list,
                                                            cols,
                                                            lines-offscreen);
                         if (read!=lines-offscreen)
-                                backup(&whole_list,lines-offscreen-read);
+                                backup(mf,&whole_list,lines-offscreen-read,cols);
                         display_screenful(whole_list,rows,cols,read);
                 } else {
                         display_screenful(whole_list,rows,cols,lines);
                 }
                 if (lines>0) offscreen-=lines;
                 if (offscreen<0) offscreen=0;
-                if (options&MORE_EOF?1:!feof(input))  {
-                        if (feof(input))
+                if (options&MORE_EOF?1:!MORE_FEOF(mf))  {
+                        if (MORE_FEOF(mf))
                                 VioWrtCharStrAtt(EOF_STRING,strlen(EOF_STRING),
                                                                  rows,0,bright,0);
                         else VioWrtCharStrAtt(PROMPT,strlen(PROMPT),rows,0,bright,0);
@@ -267,7 +528,7 @@ void more_file(FILE *input) {
                                 case 72:
                                         /* Up arrow */
                                         lines=scrollup;
-                                        offscreen+=lines=backup(&whole_list,lines);
+                                        offscreen+=lines=backup(mf,&whole_list,lines,cols);
                                         lines=-lines;
                                         break;
                                 case 80:
@@ -277,7 +538,7 @@ void more_file(FILE *input) {
                                 case 73:
                                         /* Page up */
                                         lines=rows;
-                                        offscreen+=lines=backup(&whole_list,lines);
+                                        offscreen+=lines=backup(mf,&whole_list,lines,cols);
                                         lines=-lines;
                                         break;
                                 case 81:
@@ -285,7 +546,7 @@ void more_file(FILE *input) {
                                         lines=rows;
                                         break;
                                 default:
-                                        if (feof(input)) return;
+                                        if (MORE_FEOF(mf)) return;
                                         break;
                                 }
                         } else
@@ -328,16 +589,39 @@ void more_file(FILE *input) {
                                 case 'b':
                                 case 'B':
                                         lines=scrollup;
-                                        offscreen+=lines=backup(&whole_list,lines);
+                                        offscreen+=lines=backup(mf,&whole_list,lines,cols);
                                         lines=-lines;
                                         break;
                                 case 13:
                                         lines=scrollup;
                                         break;
+                                case '0': case '1': case '2': case '3':
+                                case '4': case '5': case '6': case '7':
+                                case '8': case '9':
+                                        /* jump to 0%-90% of a file */
+                                        if (!mf->seekable) {
+                                                lines=rows;
+                                                break;
+                                        }
+                                        upto=(ULONG)((double)mf->size*
+                                                     (kbdi.chChar-'0')/10);
+                                        index_to(mf,upto);
+                                        free_dllist(whole_list);
+                                        whole_list=end_of_list=NULL;
+                                        seek_to(mf,mf->lines[find_line(mf,
+                                                             upto+1)]);
+                                        read=get_screenful(mf,&whole_list,
+                                                           &end_of_list,
+                                                           cols,rows);
+                                        if (!whole_list) return;
+                                        if (read<rows)
+                                                backup(mf,&whole_list,
+                                                       rows-read,cols);
+                                        /* redraw the whole screen */
+                                        lines=offscreen=rows;
+                                        continue;
                                 case 'n':
                                 case 'N':
-                                        while (input==stdin && !feof(input)) fgetc(input);
-                                        fclose(input);
                                         VioWrtNCell(blankcell,cols,rows,0,0);
                                         KbdFlushBuffer(0);
                                         return;
@@ -345,23 +629,34 @@ void more_file(FILE *input) {
 
                                 case 'q':
                                 case 'Q':
-                                        while (input==stdin && !feof(input)) fgetc(input);
-                                        fclose(input);
                                         VioWrtNCell(blankcell,cols,rows,0,0);
                                         KbdFlushBuffer(0);
                                         return;
                                 default:
                                         lines=rows;
-                                        if (feof(input)) return;
+                                        if (MORE_FEOF(mf)) return;
                                         break;
                                 }
                         for (i=0;i<lines && whole_list->next;i++)
                                 whole_list=whole_list->next;
+                        trim_dllist(mf,whole_list);
                 }
         }
         KbdFlushBuffer(0);
 }
 
+/* output is not the screen: copy the input to it */
+void copy_file(HFILE hf) {
+        CHAR *block;
+        ULONG got,written;
+
+        block=(CHAR*)malloc(BLOCKSIZE);
+        if (!block) return;
+        while (DosRead(hf,block,BLOCKSIZE,&got)==0 && got)
+                DosWrite(1,block,got,&written);
+        free(block);
+}
+
 char *strupper(char *string) {
         int i;
         char *original;
@@ -375,7 +670,10 @@ char *strupper(char *string) {
 }
 
 void main (int argc, char *argv[]) {
-        FILE *input;
+        morefile input;
+        HFILE hf;
+        ULONG action,type,devattr;
+        BOOL to_screen;
         USHORT row, col;
         pdllist file_list,current,new;
         HDIR hdirDir;
@@ -400,6 +698,8 @@ void main (int argc, char *argv[]) {
         colorcell[0]=' ';
         colorcell[1]=DEFAULT_ATTRIB;
 
+        to_screen=DosQueryHType(1,&type,&devattr)!=0 ||
+                  (type&0xff)==HANDTYPE_DEVICE;
         options=MORE_EOF;
         file_list=current=NULL;
         KbdGetStatus(&kbdinfo,0);
@@ -407,17 +707,33 @@ void main (int argc, char *argv[]) {
         kbdinfo.fsMask|=KEYBOARD_BINARY_MODE;
         KbdSetStatus(&kbdinfo,0);
         if (argc==1) {
-                more_file(stdin);
+                if (!to_screen) copy_file(0);
+                else if (open_input(&input,0)) {
+                        more_file(&input);
+                        close_input(&input);
+                }
         }
         else {
                 for (i=1;i<argc;i++) {
-                        input=fopen(argv[i],"r");
-                        if (input==NULL) {
+                        if (DosOpen(argv[i],&hf,&action,0,FILE_NORMAL,
+                                    OPEN_ACTION_FAIL_IF_NEW|OPEN_ACTION_OPEN_IF_EXISTS,
+                                    OPEN_ACCESS_READONLY|OPEN_SHARE_DENYNONE,
+                                    NULL)) {
                                 printf("Error opening file '%s'.\n",argv[i]);
                                 printf("Most likely, file non-existant.\n");
                                 exit(0);
                         }
-                        more_file(input);
+                        if (!to_screen) {
+                                copy_file(hf);
+                                DosClose(hf);
+                                continue;
+                        }
+                        if (!open_input(&input,hf)) {
+                                DosClose(hf);
+                                exit(0);
+                        }
+                        more_file(&input);
+                        close_input(&input);
                         if (i<argc-1) {
                                 sprintf(prompt,"-- BEGIN FILE %s --",strupper(argv[i+1]));
                                 VioGetCurPos(&row,&col,0);
@@ -435,6 +751,7 @@ void main (int argc, char *argv[]) {
                 }
         }
 
+        if (!to_screen) return;
         VioGetCurPos(&row,&col,0);
         VioSetCurPos(row-1,0,0);
 }
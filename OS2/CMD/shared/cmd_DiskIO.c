@@ -0,0 +1,569 @@
+/*!
+   @file cmd_diskio.c
+
+   @brief sector I/O, readahead, parallel scanning and progress reporting
+   for the file system utilities, shared along all command line tools
+
+   (c) osFree Project 2002, <http://www.osFree.org>
+   for licence see licence.txt in root directory, or project website
+
+   The volume is opened as a DASD handle and read with DSK_READTRACK.
+   Requests are not limited to one track: as long as the driver accepts
+   it, up to cmd_DISK_MAXTRANSFER sectors go out with one IOCtl; after
+   the first refusal every request is split at track boundaries.
+*/
+
+#define INCL_DOSFILEMGR
+#define INCL_DOSDEVICES
+#define INCL_DOSDEVIOCTL
+#define INCL_DOSPROCESS
+#define INCL_DOSSEMAPHORES
+#define INCL_DOSMEMMGR
+#define INCL_DOSMISC
+#define INCL_DOSERRORS
+
+/* C standard library headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmd_shared.h> /* command line tools' shared functions and defines */
+#include <cmd_DiskIO.h>
+
+/* largest first-sector index within a track; DSK_READTRACK addresses
+   sectors as an index into the track table */
+#define MAX_SECTORS_PER_TRACK 255
+
+/* track layout with a table long enough for the largest transfer
+   starting anywhere in a track */
+typedef struct _CMDLAYOUT
+{
+  TRACKLAYOUT tl;
+  USHORT      ausMore[(cmd_DISK_MAXTRANSFER + MAX_SECTORS_PER_TRACK - 1) * 2];
+} CMDLAYOUT;
+
+/* one DSK_READTRACK; the layout lives on the caller's stack, so several
+   threads may read through the same handle at once */
+static APIRET ReadSectorsIOCtl(PCMDDISK pDisk, ULONG ulSector, ULONG cSectors,
+                               PVOID pBuf)
+{
+  CMDLAYOUT layout;
+  ULONG     ulTrack;
+  ULONG     cbParm, cbData;
+  ULONG     i, cEntries;
+  APIRET    rc;
+
+  ulTrack = ulSector / pDisk->cSectorsPerTrack;
+
+  layout.tl.bCommand      = 1; /* table starts with sector 1, consecutive */
+  layout.tl.usHead        = (USHORT)(ulTrack % pDisk->cHeads);
+  layout.tl.usCylinder    = (USHORT)(ulTrack / pDisk->cHeads);
+  layout.tl.usFirstSector = (USHORT)(ulSector % pDisk->cSectorsPerTrack);
+  layout.tl.cSectors      = (USHORT)cSectors;
+
+  cEntries = layout.tl.usFirstSector + cSectors;
+  for (i = 0; i < cEntries; i++)
+  {
+    layout.tl.TrackTable[i].usSectorNumber = (USHORT)(i + 1);
+    layout.tl.TrackTable[i].usSectorSize   = (USHORT)pDisk->cbSector;
+  }
+
+  cbParm = sizeof(TRACKLAYOUT) + (cEntries - 1) * 2 * sizeof(USHORT);
+  cbData = cSectors * pDisk->cbSector;
+
+  rc = DosDevIOCtl(pDisk->hDisk, IOCTL_DISK, DSK_READTRACK,
+                   &layout, cbParm, &cbParm,
+                   pBuf, cbData, &cbData);
+
+  if ((rc == NO_ERROR) && (cbData != cSectors * pDisk->cbSector))
+    rc = ERROR_READ_FAULT;
+
+  return rc;
+}
+
+/*!
+  Opens a volume for sector reads
+
+  @param pszDrive  drive (eg.: "c:")
+  @param fLock     lock the volume (FORMAT, CHKDSK /F), otherwise it is
+                   opened for reading only and other processes may keep
+                   using it
+  @param pDisk     disk structure to fill in
+
+  @return
+        - 0 - if completed successully
+        - rc from DosOpen/DosDevIOCtl, when error
+*/
+APIRET cmd_DiskOpen(PSZ pszDrive, BOOL fLock, PCMDDISK pDisk)
+{
+  BIOSPARAMETERBLOCK bpb;
+  BYTE   abParm[2];
+  BYTE   bCmd = 0;
+  ULONG  ulAction, cbParm, cbData;
+  CHAR   szDrive[3];
+  APIRET rc;
+
+  memset(pDisk, 0, sizeof(*pDisk));
+
+  szDrive[0] = pszDrive[0];
+  szDrive[1] = ':';
+  szDrive[2] = '\0';
+
+  rc = DosOpen(szDrive, &pDisk->hDisk, &ulAction, 0, FILE_NORMAL,
+               OPEN_ACTION_OPEN_IF_EXISTS | OPEN_ACTION_FAIL_IF_NEW,
+               OPEN_FLAGS_DASD | OPEN_FLAGS_FAIL_ON_ERROR |
+               (fLock ? (OPEN_SHARE_DENYREADWRITE | OPEN_ACCESS_READWRITE)
+                      : (OPEN_SHARE_DENYNONE | OPEN_ACCESS_READONLY)),
+               NULL);
+  if (rc != NO_ERROR)
+    return rc;
+
+  if (fLock)
+  {
+    cbParm = sizeof(bCmd);
+    rc = DosDevIOCtl(pDisk->hDisk, IOCTL_DISK, DSK_LOCKDRIVE,
+                     &bCmd, cbParm, &cbParm, NULL, 0, NULL);
+    if (rc != NO_ERROR)
+    {
+      DosClose(pDisk->hDisk);
+      return rc;
+    }
+    pDisk->fLocked = TRUE;
+  }
+
+  /* geometry of the volume as it is now */
+  abParm[0] = 1;
+  abParm[1] = 0;
+  cbParm = sizeof(abParm);
+  cbData = sizeof(bpb);
+  rc = DosDevIOCtl(pDisk->hDisk, IOCTL_DISK, DSK_GETDEVICEPARAMS,
+                   abParm, cbParm, &cbParm, &bpb, cbData, &cbData);
+  if ((rc == NO_ERROR) &&
+      ((!bpb.usBytesPerSector) || (!bpb.usSectorsPerTrack) || (!bpb.cHeads) ||
+       (bpb.usSectorsPerTrack > MAX_SECTORS_PER_TRACK)))
+    rc = ERROR_NOT_SUPPORTED;
+  if (rc != NO_ERROR)
+  {
+    cmd_DiskClose(pDisk);
+    return rc;
+  }
+
+  pDisk->cbSector         = bpb.usBytesPerSector;
+  pDisk->cSectorsPerTrack = bpb.usSectorsPerTrack;
+  pDisk->cHeads           = bpb.cHeads;
+  pDisk->cSectors         = bpb.cSectors ? bpb.cSectors : bpb.cLargeSectors;
+  pDisk->fLargeIO         = TRUE;
+
+  return NO_ERROR;
+}
+
+/* reads sectors straight from the volume: in cmd_DISK_MAXTRANSFER pieces
+   while the driver takes them, track by track after that */
+static APIRET ReadSectors(PCMDDISK pDisk, ULONG ulSector, ULONG cSectors,
+                          PBYTE pb)
+{
+  ULONG  cTransfer, cLeftInTrack;
+  APIRET rc = NO_ERROR;
+
+  while ((cSectors > 0) && (pDisk->fLargeIO))
+  {
+    cTransfer = (cSectors > cmd_DISK_MAXTRANSFER) ? cmd_DISK_MAXTRANSFER : cSectors;
+    if (ReadSectorsIOCtl(pDisk, ulSector, cTransfer, pb) != NO_ERROR)
+    {
+      /* the driver does not do multi-track reads, or there is a bad
+         sector; either way, the track by track path below sorts it out
+         and reports the error, if any */
+      pDisk->fLargeIO = FALSE;
+      break;
+    }
+    ulSector += cTransfer;
+    cSectors -= cTransfer;
+    pb       += cTransfer * pDisk->cbSector;
+  }
+
+  while (cSectors > 0)
+  {
+    cLeftInTrack = pDisk->cSectorsPerTrack - (ulSector % pDisk->cSectorsPerTrack);
+    cTransfer = (cSectors > cLeftInTrack) ? cLeftInTrack : cSectors;
+    if ((rc = ReadSectorsIOCtl(pDisk, ulSector, cTransfer, pb)) != NO_ERROR)
+      break;
+    ulSector += cTransfer;
+    cSectors -= cTransfer;
+    pb       += cTransfer * pDisk->cbSector;
+  }
+
+  return rc;
+}
+
+/*!
+  Reads sectors from a volume opened by cmd_DiskOpen
+
+  If the sectors are in a region given to cmd_DiskReadAhead, they are
+  copied from there (waiting for the readahead thread to finish if it
+  has not yet). May be called from several threads at once.
+
+  @param pDisk     disk from cmd_DiskOpen
+  @param ulSector  first sector, relative to the start of the volume
+  @param cSectors  sector count
+  @param pBuf      buffer for cSectors * pDisk->cbSector bytes
+
+  @return
+        - 0 - if completed successully
+        - ERROR_SECTOR_NOT_FOUND if the sectors are not on the volume
+        - rc from DosDevIOCtl, when error
+*/
+APIRET cmd_DiskRead(PCMDDISK pDisk, ULONG ulSector, ULONG cSectors, PVOID pBuf)
+{
+  PCMDREADAHEAD pRA;
+  ULONG i;
+
+  if ((ulSector >= pDisk->cSectors) || (cSectors > pDisk->cSectors - ulSector))
+    return ERROR_SECTOR_NOT_FOUND;
+
+  for (i = 0; i < cmd_DISK_READAHEADS; i++)
+  {
+    pRA = &pDisk->aReadAhead[i];
+    if ((pRA->pbData) &&
+        (ulSector >= pRA->ulSector) &&
+        (ulSector + cSectors <= pRA->ulSector + pRA->cSectors))
+    {
+      /* stays posted once the thread is done */
+      DosWaitEventSem(pRA->hevDone, SEM_INDEFINITE_WAIT);
+      if (pRA->rc != NO_ERROR)
+        break; /* read again below to get the error for these sectors */
+      memcpy(pBuf, pRA->pbData + (ulSector - pRA->ulSector) * pDisk->cbSector,
+             cSectors * pDisk->cbSector);
+      return NO_ERROR;
+    }
+  }
+
+  return ReadSectors(pDisk, ulSector, cSectors, (PBYTE)pBuf);
+}
+
+/* readahead thread: reads one region */
+static VOID APIENTRY ReadAheadThread(ULONG ulArg)
+{
+  PCMDREADAHEAD pRA = (PCMDREADAHEAD)ulArg;
+
+  pRA->rc = ReadSectors(pRA->pDisk, pRA->ulSector, pRA->cSectors, pRA->pbData);
+  DosPostEventSem(pRA->hevDone);
+}
+
+/*!
+  Starts reading a region of the volume in the background
+
+  Meant for the regions a checker reads first and all of: the FATs, the
+  HPFS bitmaps and directory band, the JFS allocation maps. cmd_DiskRead
+  calls within the region are then served from memory. At most
+  cmd_DISK_READAHEADS regions can be pending; they are freed by
+  cmd_DiskClose.
+
+  @param pDisk     disk from cmd_DiskOpen
+  @param ulSector  first sector of the region
+  @param cSectors  sector count
+
+  @return
+        - 0 - if the read was started
+        - ERROR_SECTOR_NOT_FOUND if the region is not on the volume
+        - ERROR_TOO_MANY_OPEN_FILES if all readahead slots are in use
+        - rc from DosAllocMem/DosCreateThread, when error
+*/
+APIRET cmd_DiskReadAhead(PCMDDISK pDisk, ULONG ulSector, ULONG cSectors)
+{
+  PCMDREADAHEAD pRA = NULL;
+  ULONG  i;
+  APIRET rc;
+
+  if ((!cSectors) || (ulSector >= pDisk->cSectors) ||
+      (cSectors > pDisk->cSectors - ulSector))
+    return ERROR_SECTOR_NOT_FOUND;
+
+  for (i = 0; i < cmd_DISK_READAHEADS; i++)
+    if (!pDisk->aReadAhead[i].pbData)
+    {
+      pRA = &pDisk->aReadAhead[i];
+      break;
+    }
+  if (!pRA)
+    return ERROR_TOO_MANY_OPEN_FILES;
+
+  /* page aligned, so the driver need not bounce the transfers */
+  rc = DosAllocMem((PPVOID)&pRA->pbData, cSectors * pDisk->cbSector,
+                   PAG_COMMIT | PAG_READ | PAG_WRITE);
+  if (rc != NO_ERROR)
+  {
+    pRA->pbData = NULL;
+    return rc;
+  }
+
+  rc = DosCreateEventSem(NULL, &pRA->hevDone, 0, FALSE);
+  if (rc == NO_ERROR)
+  {
+    pRA->pDisk    = pDisk;
+    pRA->ulSector = ulSector;
+    pRA->cSectors = cSectors;
+    pRA->rc       = NO_ERROR;
+    rc = DosCreateThread(&pRA->tid, (PFNTHREAD)ReadAheadThread, (ULONG)pRA,
+                         CREATE_READY | STACK_SPARSE, 65536);
+    if (rc != NO_ERROR)
+      DosCloseEventSem(pRA->hevDone);
+  }
+
+  if (rc != NO_ERROR)
+  {
+    DosFreeMem(pRA->pbData);
+    memset(pRA, 0, sizeof(*pRA));
+  }
+
+  return rc;
+}
+
+/*!
+  Closes a volume opened by cmd_DiskOpen
+
+  Waits for pending readaheads, frees them and unlocks the volume.
+
+  @param pDisk     disk from cmd_DiskOpen
+*/
+VOID cmd_DiskClose(PCMDDISK pDisk)
+{
+  PCMDREADAHEAD pRA;
+  BYTE  bCmd = 0;
+  ULONG cbParm;
+  ULONG i;
+
+  for (i = 0; i < cmd_DISK_READAHEADS; i++)
+  {
+    pRA = &pDisk->aReadAhead[i];
+    if (!pRA->pbData)
+      continue;
+    DosWaitThread(&pRA->tid, DCWW_WAIT);
+    DosCloseEventSem(pRA->hevDone);
+    DosFreeMem(pRA->pbData);
+    memset(pRA, 0, sizeof(*pRA));
+  }
+
+  if (pDisk->fLocked)
+  {
+    cbParm = sizeof(bCmd);
+    DosDevIOCtl(pDisk->hDisk, IOCTL_DISK, DSK_UNLOCKDRIVE,
+                &bCmd, cbParm, &cbParm, NULL, 0, NULL);
+    pDisk->fLocked = FALSE;
+  }
+
+  if (pDisk->hDisk)
+  {
+    DosClose(pDisk->hDisk);
+    pDisk->hDisk = 0;
+  }
+}
+
+/* state shared by the cmd_DiskScanGroups threads */
+typedef struct _CMDSCAN
+{
+  PCMDDISK       pDisk;
+  PCMDSCANFN     pfnScan;
+  PVOID          pUser;
+  PCMDPROGRESS   pProgress;
+  ULONG          cGroups;
+  ULONG          ulNext;      /* next group to hand out */
+  APIRET         rc;          /* first error */
+  HMTX           hmtx;
+} CMDSCAN, *PCMDSCAN;
+
+static VOID APIENTRY ScanThread(ULONG ulArg)
+{
+  PCMDSCAN pScan = (PCMDSCAN)ulArg;
+  ULONG    ulGroup;
+  APIRET   rc;
+
+  for (;;)
+  {
+    DosRequestMutexSem(pScan->hmtx, SEM_INDEFINITE_WAIT);
+    ulGroup = pScan->ulNext;
+    if ((pScan->rc == NO_ERROR) && (ulGroup < pScan->cGroups))
+      pScan->ulNext++;
+    else
+      ulGroup = pScan->cGroups;
+    DosReleaseMutexSem(pScan->hmtx);
+
+    if (ulGroup >= pScan->cGroups)
+      break;
+
+    rc = pScan->pfnScan(pScan->pDisk, ulGroup, pScan->pUser);
+
+    if (pScan->pProgress)
+      cmd_ProgressAdd(pScan->pProgress, 1);
+
+    if (rc != NO_ERROR)
+    {
+      DosRequestMutexSem(pScan->hmtx, SEM_INDEFINITE_WAIT);
+      if (pScan->rc == NO_ERROR)
+        pScan->rc = rc;
+      DosReleaseMutexSem(pScan->hmtx);
+    }
+  }
+}
+
+/*!
+  Scans independent parts of a volume on several threads
+
+  For file systems which keep their metadata in independent allocation
+  groups (JFS allocation groups, HPFS bands), the checker's per-group
+  work can overlap: while one thread waits for the disk, another checks
+  what it has read. pfnScan is called once for every group number from
+  0 to cGroups-1, in no particular order and from up to cThreads threads
+  at once, so anything it shares with other groups must be locked by the
+  caller. After the first failing group no new groups are started.
+
+  @param pDisk      disk from cmd_DiskOpen
+  @param cGroups    number of groups
+  @param cThreads   number of threads (1 scans on the calling thread)
+  @param pfnScan    called for every group
+  @param pUser      passed to pfnScan
+  @param pProgress  if not NULL, advanced by one for every group done
+
+  @return
+        - 0 - if all groups were scanned
+        - the first error returned by pfnScan
+        - rc from DosCreateMutexSem/DosCreateThread, when error
+*/
+APIRET cmd_DiskScanGroups(PCMDDISK pDisk, ULONG cGroups, ULONG cThreads,
+                          PCMDSCANFN pfnScan, PVOID pUser,
+                          PCMDPROGRESS pProgress)
+{
+  CMDSCAN scan;
+  TID     atid[cmd_DISK_MAXTHREADS];
+  ULONG   cStarted = 0;
+  ULONG   i;
+  APIRET  rc;
+
+  if (cThreads > cmd_DISK_MAXTHREADS)
+    cThreads = cmd_DISK_MAXTHREADS;
+  if (cThreads > cGroups)
+    cThreads = cGroups;
+  if (cThreads < 1)
+    cThreads = 1;
+
+  memset(&scan, 0, sizeof(scan));
+  scan.pDisk     = pDisk;
+  scan.pfnScan   = pfnScan;
+  scan.pUser     = pUser;
+  scan.pProgress = pProgress;
+  scan.cGroups   = cGroups;
+
+  if ((rc = DosCreateMutexSem(NULL, &scan.hmtx, 0, FALSE)) != NO_ERROR)
+    return rc;
+
+  /* the calling thread is one of the workers */
+  for (i = 1; i < cThreads; i++)
+  {
+    if (DosCreateThread(&atid[cStarted], (PFNTHREAD)ScanThread, (ULONG)&scan,
+                        CREATE_READY | STACK_SPARSE, 65536) != NO_ERROR)
+      break; /* fewer threads just take longer */
+    cStarted++;
+  }
+
+  ScanThread((ULONG)&scan);
+
+  for (i = 0; i < cStarted; i++)
+    DosWaitThread(&atid[i], DCWW_WAIT);
+
+  DosCloseMutexSem(scan.hmtx);
+
+  return scan.rc;
+}
+
+/*!
+  Sets up progress reporting
+
+  cmd_ProgressAdd calls pfnShow only when the percentage has changed
+  and at least cmd_PROGRESS_INTERVAL milliseconds have passed since the
+  last call, so a checker can report every cluster or sector without
+  paying for a screen update each time. 100% is always shown.
+
+  @param pProgress  progress structure to fill in
+  @param ulTotal    units of work (sectors, groups, ...)
+  @param pfnShow    called with the percentage; cmd_ProgressPrint if NULL
+  @param pUser      passed to pfnShow
+
+  @return
+        - 0 - if completed successully
+        - rc from DosCreateMutexSem, when error
+*/
+APIRET cmd_ProgressInit(PCMDPROGRESS pProgress, ULONG ulTotal,
+                        PCMDPROGRESSFN pfnShow, PVOID pUser)
+{
+  memset(pProgress, 0, sizeof(*pProgress));
+  pProgress->ulTotal  = ulTotal ? ulTotal : 1;
+  pProgress->ulShown  = (ULONG)-1;
+  pProgress->pfnShow  = pfnShow ? pfnShow : cmd_ProgressPrint;
+  pProgress->pUser    = pUser;
+
+  return DosCreateMutexSem(NULL, &pProgress->hmtx, 0, FALSE);
+}
+
+/*!
+  Adds done units of work; may be called from several threads
+
+  @param pProgress  from cmd_ProgressInit
+  @param ulDone     units done since the last call
+*/
+VOID cmd_ProgressAdd(PCMDPROGRESS pProgress, ULONG ulDone)
+{
+  ULONG ulPercent, ulNow;
+
+  DosRequestMutexSem(pProgress->hmtx, SEM_INDEFINITE_WAIT);
+
+  pProgress->ulDone += ulDone;
+  if (pProgress->ulDone > pProgress->ulTotal)
+    pProgress->ulDone = pProgress->ulTotal;
+
+  /* done * 100 may not fit in a ULONG on large volumes */
+  if (pProgress->ulTotal > 0xFFFFFFFFUL / 100)
+    ulPercent = pProgress->ulDone / (pProgress->ulTotal / 100);
+  else
+    ulPercent = pProgress->ulDone * 100 / pProgress->ulTotal;
+  if (ulPercent > 100)
+    ulPercent = 100;
+
+  if (ulPercent != pProgress->ulShown)
+  {
+    DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ulNow, sizeof(ulNow));
+    if ((ulPercent == 100) ||
+        (pProgress->ulShown == (ULONG)-1) ||
+        (ulNow - pProgress->ulLastTime >= cmd_PROGRESS_INTERVAL))
+    {
+      pProgress->ulShown    = ulPercent;
+      pProgress->ulLastTime = ulNow;
+      pProgress->pfnShow(ulPercent, pProgress->pUser);
+    }
+  }
+
+  DosReleaseMutexSem(pProgress->hmtx);
+}
+
+/*!
+  Ends progress reporting
+
+  @param pProgress  from cmd_ProgressInit
+*/
+VOID cmd_ProgressDone(PCMDPROGRESS pProgress)
+{
+  DosCloseMutexSem(pProgress->hmtx);
+  pProgress->hmtx = 0;
+}
+
+/*!
+  Default progress output: the percentage, overwritten in place
+
+  @param ulPercent  0..100
+  @param pUser      not used
+*/
+VOID APIENTRY cmd_ProgressPrint(ULONG ulPercent, PVOID pUser)
+{
+  printf("\r%3lu%%", ulPercent);
+  if (ulPercent == 100)
+    printf("\n");
+  fflush(stdout);
+}
@@ -255,6 +255,7 @@ CHARTYPE *params;
          if (curr->next == NULL)
             break;
       }
+      scope_changed();
       CURRENT_VIEW->display_low = 0;
       CURRENT_VIEW->display_high = 0;
       build_screen(current_screen);
@@ -313,6 +314,7 @@ CHARTYPE *params;
          break;
       curr = curr->next;
    }
+   scope_changed();
    /*
     * If at least one line matches the target, set DISPLAY to 1 1,
     * otherwise reset the select levels as they were before the command.
@@ -348,6 +350,7 @@ CHARTYPE *params;
          if (curr->next == NULL)
             break;
       }
+      scope_changed();
       if (status == RC_TARGET_NOT_FOUND)
       {
          display_error(17,params,FALSE);
@@ -1420,6 +1423,7 @@ CHARTYPE *params;
       if (CURRENT_VIEW->scope_all)
       {
          curr->select = CURRENT_VIEW->display_low;
+         scope_changed();
          if (use_current)
          {
             CURRENT_VIEW->current_column = match_col+1;
@@ -2155,6 +2155,7 @@ CHARTYPE *params;
     else
        curr = curr->prev;
    }
+ scope_changed();
 #else
  rc = execute_select(word[1],relative,off);
 #endif
@@ -4065,6 +4066,9 @@ DESCRIPTION
 
      With TYPEAHEAD ON, curses will abort screen display if a keystroke
      is pending.
+     THE itself also leaves the screen alone between keystrokes that
+     have already been typed, and only brings it up to date once it has
+     caught up with them. This helps most over slow remote sessions.
 
      With TYPEAHEAD OFF, curses will not abort screen display if a
      keystroke is pending.
@@ -48,7 +48,9 @@ $Id: defines.h,v 1.5 2001/12/18 08:23:27 mark Exp $
 #  define HAVE_DOUPDATE 1
 #  define HAVE_KEYPAD 1
 #  define HAVE_NOCBREAK 1
+#  define HAVE_NODELAY 1
 #  define HAVE_NOTIMEOUT 1
+#  define HAVE_UNGETCH 1
 #  ifndef HAVE_PROTO
 #    define HAVE_PROTO 1
 #  endif
@@ -39,6 +39,52 @@ static char RCSid[] = "$Id: edit.c,v 1.12 2002/06/09 09:26:16 mark Exp $";
 
 bool prefix_changed=FALSE;
 
+#if defined(HAVE_NODELAY) && defined(HAVE_UNGETCH)
+static WINDOW *typeahead_win=NULL; /* only ever read from, never shown */
+#endif
+
+/***********************************************************************/
+#ifdef HAVE_PROTO
+static bool key_is_queued(void)
+#else
+static bool key_is_queued()
+#endif
+/***********************************************************************/
+{
+   /*
+    * With TYPEAHEAD ON, tell process_key() whether the user has already
+    * typed another key, so that it can leave updating the screen to the
+    * last key of a burst. Keys are peeked at through a window of our own
+    * which is never written to or refreshed; wgetch() on any of the real
+    * windows would refresh it, and so flush the very update being saved.
+    */
+#if defined(HAVE_NODELAY) && defined(HAVE_UNGETCH)
+   int key;
+
+   if (!TYPEAHEADx)
+      return(FALSE);
+   if (typeahead_win == NULL)
+   {
+      if ((typeahead_win = newwin(1,1,0,0)) == NULL)
+         return(FALSE);
+      leaveok(typeahead_win,TRUE);
+# ifdef HAVE_KEYPAD
+      keypad(typeahead_win,TRUE);
+# endif
+# ifdef HAVE_NOTIMEOUT
+      notimeout(typeahead_win,TRUE);
+# endif
+      nodelay(typeahead_win,TRUE);
+   }
+   if ((key = wgetch(typeahead_win)) == ERR)
+      return(FALSE);
+   ungetch(key);
+   return(TRUE);
+#else
+   return(FALSE);
+#endif
+}
+
 /***********************************************************************/
 #ifdef HAVE_PROTO
 void editor(void)
@@ -184,6 +230,18 @@ bool mouse_details_present;
       }
    }
 
+   /*
+    * If another key is already waiting, it will bring the screen up to
+    * date after it has been processed; don't do it twice. A message is
+    * always shown, as the next key would clear it unseen.
+    */
+   if (!error_on_screen
+   &&  key_is_queued())
+   {
+      TRACE_RETURN();
+      return(RC_OK);
+   }
+
    show_statarea();
 
    if ( FILETABSx )
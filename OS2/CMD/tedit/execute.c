@@ -2947,6 +2947,7 @@ short off;
     if (curr == NULL)
        break;
    }
+ scope_changed();
  free_target(&target);
  if (CURRENT_TOF || CURRENT_BOF)
     rc = RC_TOF_EOF_REACHED;
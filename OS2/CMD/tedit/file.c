@@ -53,6 +53,12 @@ static char RCSid[] = "$Id: file.c,v 1.9 2002/04/17 07:39:48 mark Exp $";
 #define stricmp strcasecmp
 #endif
 
+/*
+ * Size of the stdio buffer save_file() writes through. Kept below 64K
+ * for the 16 bit DOS builds.
+ */
+#define SAVE_BUFFER_SIZE 32768
+
 #ifdef HAVE_PROTO
 static short write_line(CHARTYPE *,LENGTHTYPE,FILE *,short);
 static short write_char(CHARTYPE,FILE *);
@@ -693,6 +699,7 @@ bool called_from_get_command;
    int extra=0;
    LENGTHTYPE read_start=0;
    LINETYPE total_lines_read=0L,actual_lines_read=0L;
+   CHARTYPE *end=NULL,*next_cr=NULL,*next_lf=NULL;
 
    TRACE_FUNCTION("file.c:    read_file");
    temp = curr;
@@ -724,21 +731,41 @@ bool called_from_get_command;
       if (feof(fp))
       {
          eof_reached = TRUE;
-         for (;*(trec+read_start+chars_read-1)==DOSEOF;chars_read--)
+         for (;chars_read+read_start && *(trec+read_start+chars_read-1)==DOSEOF;chars_read--)
             ;
       }
       /*
        * For each character remaining from the previous read in an incomplete
        * line and each character read from the last fread()...
+       * Rather than test every character, memchr() finds the next CR and the
+       * next LF; each is only searched for again once i has passed it, so
+       * the buffer is scanned at most twice whatever the line endings are.
        */
+      next_cr = next_lf = NULL;
       for (i=read_start;i<chars_read+read_start;i++)
       {
+         end = trec+chars_read+read_start;
+         if (next_cr == NULL
+         || (next_cr < trec+i && next_cr != end))
+         {
+            next_cr = (CHARTYPE *)memchr(trec+i,CR,end-(trec+i));
+            if (next_cr == NULL)
+               next_cr = end;
+         }
+         if (next_lf == NULL
+         || (next_lf < trec+i && next_lf != end))
+         {
+            next_lf = (CHARTYPE *)memchr(trec+i,LF,end-(trec+i));
+            if (next_lf == NULL)
+               next_lf = end;
+         }
          /*
-          * If the character is a CR or LF we have a new line...
+          * If there is no CR or LF left, the rest is an incomplete line...
           */
-         if (*(trec+i) != CR
-         &&  *(trec+i) != LF)
-            continue;
+         if (next_cr == end
+         &&  next_lf == end)
+            break;
+         i = (next_cr < next_lf ? next_cr : next_lf) - trec;
          {
             /*
              * If we have read all the lines in the file that has been requested,
@@ -760,7 +787,14 @@ bool called_from_get_command;
                   if (feof(fp))
                      eof_reached = TRUE;
                   else
+                  {
                      chars_read++;
+                     /*
+                      * The buffer has grown by the character just read, so
+                      * any "none left" found for CR or LF no longer holds.
+                      */
+                     next_cr = next_lf = NULL;
+                  }
                }
                ch = *(trec+i+1);
                if (ch == LF)
@@ -855,8 +889,7 @@ bool called_from_get_command;
             }
             else
             {
-               for (i=0;i<len;i++)
-                  *(trec+i) = *(trec+i+line_start);
+               memmove(trec,trec+line_start,len*sizeof(CHARTYPE));
                read_start = len;
             }
          }
@@ -1268,6 +1301,12 @@ bool autosave;
       TRACE_RETURN();
       return(RC_ACCESS_DENIED);
    }
+   /*
+    * Lines are written a few bytes at a time, so have stdio gather them
+    * into large writes rather than its default of a buffer of BUFSIZ.
+    * If it can't, the default buffering still works.
+    */
+   setvbuf(fp,NULL,_IOFBF,SAVE_BUFFER_SIZE);
    /*
     * Determine where to start writing from in the linked list.
     */
@@ -1509,7 +1548,8 @@ short trailing;
    if ( fwrite( line, sizeof(CHARTYPE), newlen, fp ) != newlen )
    {
       display_error( 57, (CHARTYPE *)"", FALSE );
-      rc = RC_DISK_FULL;
+      TRACE_RETURN();
+      return RC_DISK_FULL;
    }
    switch( trailing )
    {
@@ -37,6 +37,20 @@ static char RCSid[] = "$Id: linked.c,v 1.5 2002/03/26 10:04:01 mark Exp $";
 #include <the.h>
 #include <proto.h>
 
+/*
+ * lll_find() remembers the last line it found, so that finding a line
+ * near it (the usual case: the current line, the lines on the screen)
+ * walks from there instead of from the top or bottom of the file.
+ * lll_generation is bumped whenever any _LINE list changes shape; the
+ * remembered position is only used while it is unchanged.
+ */
+static unsigned long lll_generation=0L;
+static unsigned long lll_cache_generation=0L;
+static _LINE *lll_cache_first=NULL;
+static _LINE *lll_cache_last=NULL;
+static _LINE *lll_cache_line=NULL;
+static LINETYPE lll_cache_line_number=0L;
+
 #if 0 /* TBD */
 struct llstruct
 {
@@ -179,6 +193,7 @@ unsigned short size;
  _LINE *next=NULL;
 /*--------------------------- processing ------------------------------*/
  TRACE_FUNCTION("linked.c:    lll_add");
+ lll_generation++;
 
  if ((next=(_LINE *)(*the_malloc)(size)) != (_LINE *)NULL)
    {
@@ -238,6 +253,7 @@ short direction;
  _LINE *new_curr=NULL;
 /*--------------------------- processing ------------------------------*/
  TRACE_FUNCTION("linked.c:    lll_del");
+ lll_generation++;
 /*---------------------------------------------------------------------*/
 /* Delete the only record                                              */
 /*---------------------------------------------------------------------*/
@@ -310,6 +326,7 @@ _LINE *first;
  _LINE *new_curr=NULL;
 /*--------------------------- processing ------------------------------*/
  TRACE_FUNCTION("linked.c:    lll_free");
+ lll_generation++;
  curr = first;
  while (curr != NULL)
    {
@@ -335,9 +352,31 @@ LINETYPE line_number,max_lines;
 /*--------------------------- local data ------------------------------*/
  _LINE *curr=NULL;
  LINETYPE i=0L;
+ LINETYPE from_cache=0L;
+ bool use_cache=FALSE;
 /*--------------------------- processing ------------------------------*/
  TRACE_FUNCTION("linked.c:    lll_find");
- if (line_number < (max_lines/2))
+ /*
+  * If the last line found is in the same, unchanged list and is nearer
+  * than both ends, walk from there.
+  */
+ if (lll_cache_line != NULL
+ &&  lll_cache_generation == lll_generation
+ &&  lll_cache_first == first
+ &&  lll_cache_last == last)
+ {
+    from_cache = line_number - lll_cache_line_number;
+    if (from_cache < 0L)
+       from_cache = -from_cache;
+    use_cache = (from_cache < line_number && from_cache < max_lines+1L-line_number);
+ }
+ if (use_cache)
+ {
+    curr = lll_cache_line;
+    for(i=lll_cache_line_number;i<line_number; i++, curr=curr->next);
+    for(;i>line_number; i--, curr=curr->prev);
+ }
+ else if (line_number < (max_lines/2))
  {
     curr = first;
     if (curr != NULL)
@@ -355,11 +394,55 @@ LINETYPE line_number,max_lines;
        for(i=max_lines+1L;i>line_number; i--, curr=curr->prev); /* FGC - removed check for NULL */
     }
  }
+ if (curr != NULL)
+ {
+    lll_cache_generation = lll_generation;
+    lll_cache_first = first;
+    lll_cache_last = last;
+    lll_cache_line = curr;
+    lll_cache_line_number = line_number;
+ }
  TRACE_RETURN();
  return(curr);
 }
 /***********************************************************************/
 #ifdef HAVE_PROTO
+void lll_changed(void)
+#else
+void lll_changed()
+#endif
+/***********************************************************************/
+/* Must be called by code that relinks _LINE nodes itself instead of   */
+/* using lll_add() and lll_del(), so that lll_find() forgets where the */
+/* line it found last is.                                              */
+/***********************************************************************/
+{
+/*--------------------------- local data ------------------------------*/
+/*--------------------------- processing ------------------------------*/
+ TRACE_FUNCTION("linked.c:    lll_changed");
+ lll_generation++;
+ TRACE_RETURN();
+ return;
+}
+/***********************************************************************/
+#ifdef HAVE_PROTO
+unsigned long lll_get_generation(void)
+#else
+unsigned long lll_get_generation()
+#endif
+/***********************************************************************/
+/* Returns a number that changes whenever any _LINE list changes       */
+/* shape, for code that keeps its own index of lines.                  */
+/***********************************************************************/
+{
+/*--------------------------- local data ------------------------------*/
+/*--------------------------- processing ------------------------------*/
+ TRACE_FUNCTION("linked.c:    lll_get_generation");
+ TRACE_RETURN();
+ return(lll_generation);
+}
+/***********************************************************************/
+#ifdef HAVE_PROTO
 _LINE *lll_locate(_LINE *first,CHARTYPE *value)
 #else
 _LINE *lll_locate(first,value)
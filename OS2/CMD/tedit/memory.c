@@ -164,6 +164,10 @@ void init_memory_table( void )
 void the_free_flists( void )
 {
 }
+
+void the_memory_stats( FILE *fp )
+{
+}
 #else
 
 #define FLISTS
@@ -189,16 +193,18 @@ void the_free_flists( void )
 #define MAX_INTERNAL_SIZE (4096)
 
 /* 
- * MEMINFO_HASHSIZE is the size of the 'hashtable' used to find the size
- * of a chunk of memory, given an address of a byte within that chunk. 
- * Actually, this isn't much of a real hashtable, but still. Allocating
- * large value will not make much harm other than wasting memory. Using 
- * too small value can seriously degrade execution. The optimal size
- * is such that MEMINFO_HASHSIZE * CHUNK_SIZE is only slight bigger 
- * than the actual use of memory in your rexx script (including the 
- * memory that will be wasted)
+ * MEMINFO_HASHSIZE is the initial size of the 'hashtable' used to find
+ * the size of a chunk of memory, given an address of a byte within that
+ * chunk. Using too small value can seriously degrade execution, since
+ * give_a_block() walks a bucket on every call; the optimal size is such
+ * that hashtable size * CHUNK_SIZE is only slight bigger than the memory
+ * in use. A fixed size can only be right for one file size, so the
+ * table starts at this size and is doubled by grow_hashtable() whenever
+ * it holds more than MEMINFO_LOAD entries per bucket. It must be a
+ * power of 2.
  */
-#define MEMINFO_HASHSIZE (499)
+#define MEMINFO_HASHSIZE (512)
+#define MEMINFO_LOAD (2)
 
 /* 
  * GET_SIZE() is a 'function' that returns a index into the 'hash' 
@@ -215,12 +221,11 @@ void the_free_flists( void )
  * 8192 == 1<<13, which is the optimal size. If you change one of them
  * be sure to change the other. 
  * 
- * Maybe we could eliminate a division by letting MEMINFO_HASHSIZE have
- * a number equal to a binary 'round' number (e.g. 512). There is no
- * need to keep the size a prime number, since the elements in the 
- * table *will* be well distributed.
+ * The table size is always a power of 2, so folding is a mask rather
+ * than a division. There is no need to keep the size a prime number,
+ * since the elements in the table *will* be well distributed.
  */
-#define mem_hash_func(a) (((a)>>13)%MEMINFO_HASHSIZE)
+#define mem_hash_func(a) (((a)>>13)&hashmask)
 
 /* 
  * Here are the list of the 'approved' sizes. Memory is only allocatable
@@ -258,16 +263,29 @@ static char *theflists[NUMBER_SIZES] = { NULL } ;
 typedef struct meminfo_type 
 {
    char *start ;                /* start of memory's address */
-   char *last ;                 /* end of memory's address */
+   char *last ;                 /* address registered under */
    struct meminfo_type *next ;  /* next ptr in linked list */
    int size ;                   /* size of chunks at that address */
 } meminfo ;
 
 /* 
  * The 'hashtable'. Used for quick access to the size of a chunk of
- * memory, given its address.
+ * memory, given its address. 'hashmask' is its size less 1, and
+ * 'hashentries' the number of entries in it.
+ */
+static meminfo **hashtable = NULL ;
+static unsigned long hashmask = 0 ;
+static unsigned long hashentries = 0 ;
+
+/*
+ * Usage counts, for the_memory_stats(). For each bin, the number of
+ * CHUNK_SIZE chunks carved up for it and the number of its pieces
+ * currently handed out; and the number of blocks handed straight to
+ * malloc() because they were bigger than MAX_INTERNAL_SIZE.
  */
-static meminfo *hashtable[ MEMINFO_HASHSIZE ] = { NULL } ;
+static unsigned long chunks_in_bin[NUMBER_SIZES] = { 0 } ;
+static unsigned long used_in_bin[NUMBER_SIZES] = { 0 } ;
+static long big_blocks = 0 ;
 
 /* 
  * Array used for rounding a number to an 'approved' size, i.e. a size
@@ -316,8 +334,10 @@ static int show_a_free_list(int bin, char *str)
 #endif
 /*
  * This function stores in a singly linked list all chunks of memory
- * that are allocated with malloc(). This is so that they can all be
- * free()ed by the_free_flists().
+ * that are allocated with malloc() and kept by this module. This is so
+ * that they can all be free()ed by the_free_flists(). Blocks bigger
+ * than MAX_INTERNAL_SIZE are not registered; they are free()ed as soon
+ * as they are given back.
  */
 /******************************************************************************/
 #ifdef HAVE_PROTO
@@ -443,6 +463,82 @@ void init_memory_table()
       hash[3] = 2 ;
    memset( theflists, 0, NUMBER_SIZES * sizeof(char *) );
 
+   /*
+    * If this fails, add_entry() will try again, and fail the allocation
+    * that needs it.
+    */
+   if ((hashtable = (meminfo **)calloc( MEMINFO_HASHSIZE, sizeof(meminfo *) )) != NULL)
+      hashmask = MEMINFO_HASHSIZE - 1;
+   hashentries = 0;
+}
+
+/*
+ * Doubles the size of 'hashtable', moving every entry to its bucket in
+ * the new table. Each entry records the address it was registered under
+ * in 'last', since that may be the end of the chunk rather than 'start'.
+ * If there is no memory for a bigger table, the old one is kept; it
+ * still works, just more slowly.
+ */
+/******************************************************************************/
+#ifdef HAVE_PROTO
+static void grow_hashtable( void )
+#else
+static void grow_hashtable()
+#endif
+/******************************************************************************/
+{
+   meminfo **newtable ;
+   meminfo **oldtable = hashtable ;
+   meminfo *ptr ;
+   meminfo *next ;
+   unsigned long oldsize = hashmask + 1 ;
+   unsigned long i ;
+
+   if ((newtable = (meminfo **)calloc( oldsize * 2, sizeof(meminfo *) )) == NULL)
+      return;
+   hashtable = newtable ;
+   hashmask = (oldsize * 2) - 1 ;
+   for (i=0; i<oldsize; i++)
+   {
+      for (ptr=oldtable[i]; ptr; ptr=next)
+      {
+         next = ptr->next ;
+         ptr->next = hashtable[mem_hash_func((unsigned long)ptr->last)] ;
+         hashtable[mem_hash_func((unsigned long)ptr->last)] = ptr ;
+      }
+   }
+   free( oldtable );
+}
+
+/*
+ * Returns the entry in 'hashtable' for the chunk containing the address
+ * 'cptr', or NULL if that memory is not one of ours.
+ */
+/******************************************************************************/
+#ifdef HAVE_PROTO
+static meminfo *find_entry( char *cptr )
+#else
+static meminfo *find_entry( cptr )
+char *cptr;
+#endif
+/******************************************************************************/
+{
+   meminfo *mptr ;
+
+   if (hashtable == NULL)
+      return NULL;
+   mptr = hashtable[ mem_hash_func( ((unsigned long)cptr) ) ] ;
+
+   /* 
+    * For each element in the list attached to the specific hashvalue, 
+    * loop through the list, and stop at the entry which has a start 
+    * address _less_ than 'cptr' and a stop address _higher_ than 
+    * 'cptr' (i.e. cptr is within the chunk.)
+    */
+   for ( ; (mptr) && 
+        ((mptr->start+CHUNK_SIZE<=cptr) || (mptr->start>cptr)) ;
+        mptr = mptr->next) ;
+   return mptr;
 }
 
 
@@ -498,6 +594,15 @@ int bin_no;
     * forces upon us at the first invocation. Allocate space for 128
     * at a time.
     */
+   if (hashtable == NULL)
+   {
+      if ((hashtable = (meminfo **)calloc( MEMINFO_HASHSIZE, sizeof(meminfo *) )) == NULL)
+         return(1);
+      hashmask = MEMINFO_HASHSIZE - 1;
+   }
+   else if (hashentries >= (hashmask + 1) * MEMINFO_LOAD)
+      grow_hashtable();
+
    if (indeks>=128)
    {
       /* Stupid SunOS acc gives incorrect warning for the next line */
@@ -516,7 +621,9 @@ int bin_no;
    ptr->next = hashtable[tmp=mem_hash_func((unsigned long)addr)] ;
    ptr->size = bin_no ;
    ptr->start = start ;
+   ptr->last = addr ;
    hashtable[tmp] = ptr ;
+   hashentries++ ;
    return(0);
 }
 
@@ -549,13 +656,8 @@ int size;
    if (size>MAX_INTERNAL_SIZE) 
    {
       if ((result=malloc( size )))
-      {
-         if (register_mem( result ))
-            return(NULL);
-         return result ;
-      }
-      else
-          return NULL;
+         big_blocks++ ;
+      return result ;
    }
 
    /*
@@ -594,6 +696,7 @@ int size;
          return(NULL);
       if (add_entry( vptr, vptr + CHUNK_SIZE, bin ))
          return(NULL);
+      chunks_in_bin[bin]++ ;
 
       /*
        * Then loop through the individual pieced of memory within the 
@@ -619,6 +722,7 @@ int size;
    before = show_a_free_list( bin, NULL);
 #endif
    theflists[bin] = (*((char**)(vptr))) ;
+   used_in_bin[bin]++ ;
 #ifdef THE_DEBUG_MEMORY2
    after = show_a_free_list( bin, NULL );
    if ( before - 1 != after )
@@ -654,21 +758,11 @@ void *ptr;
 
    /*
     * initialize a few values, 'cptr' is easy, while 'mptr' is the
-    * list of values for this piece of memory, that is in the 
-    * hashtable that returns memory size given a specific address
+    * entry for this piece of memory, that is in the hashtable that
+    * returns memory size given a specific address
     */
    cptr = (char*)ptr ;
-   mptr = hashtable[ mem_hash_func( ((unsigned long)cptr) ) ] ;
-
-   /* 
-    * For each element in the list attached to the specific hashvalue, 
-    * loop through the list, and stop at the entry which has a start 
-    * address _less_ than 'cptr' and a stop address _higher_ than 
-    * 'cptr' (i.e. cptr is within the chunk.)
-    */
-   for ( ; (mptr) && 
-        ((mptr->start+CHUNK_SIZE<=cptr) || (mptr->start>cptr)) ;
-        mptr = mptr->next) ;
+   mptr = find_entry( cptr ) ;
 
    /*
     * Now, there are two possibilities, either is mptr==NULL, in which
@@ -687,6 +781,7 @@ void *ptr;
 #endif
       *((char**)cptr) = theflists[mptr->size] ;
       theflists[mptr->size] = cptr ;
+      used_in_bin[mptr->size]-- ;
 #ifdef THE_DEBUG_MEMORY2
       after = show_a_free_list( mptr->size, NULL );
       if ( before + 1 != after )
@@ -694,7 +789,10 @@ void *ptr;
 #endif
    }
    else
+   {
+      big_blocks-- ;
       free( ptr ) ; 
+   }
 }
 
 /*
@@ -719,21 +817,11 @@ int size;
 
    /*
     * initialize a few values, 'cptr' is easy, while 'mptr' is the
-    * list of values for this piece of memory, that is in the 
-    * hashtable that returns memory size given a specific address
+    * entry for this piece of memory, that is in the hashtable that
+    * returns memory size given a specific address
     */
    cptr = (char*)ptr ;
-   mptr = hashtable[ mem_hash_func( ((unsigned long)cptr) ) ] ;
-
-   /* 
-    * For each element in the list attached to the specific hashvalue, 
-    * loop through the list, and stop at the entry which has a start 
-    * address _less_ than 'cptr' and a stop address _higher_ than 
-    * 'cptr' (i.e. cptr is within the chunk.)
-    */
-   for ( ; (mptr) && 
-        ((mptr->start+CHUNK_SIZE<=cptr) || (mptr->start>cptr)) ;
-        mptr = mptr->next) ;
+   mptr = find_entry( cptr ) ;
 
    /*
     * Now, there are two possibilities, either mptr==NULL, in which
@@ -746,7 +834,13 @@ int size;
     * appropriate freelist.
     */
    if (!mptr)
+   {
+      /*
+       * A block that is shrinking to MAX_INTERNAL_SIZE or less stays
+       * with malloc(), since it can only be given back to free().
+       */
       return ( realloc(ptr, size) ) ;
+   }
 
    /*
     * If the size of the block being resized is within the current
@@ -772,6 +866,7 @@ int size;
     */
    *((char**)cptr) = theflists[mptr->size] ;
    theflists[mptr->size] = cptr ;
+   used_in_bin[mptr->size]-- ;
 
    return result;
 }
@@ -787,6 +882,8 @@ void the_free_flists()
    meminfo *ptr = first_chunk;
    meminfo *next = NULL;
 
+   if (getenv("THE_MEMORY_STATS"))
+      the_memory_stats( stderr );
    while( ptr )
    {
       next = ptr->next;
@@ -796,4 +893,43 @@ void the_free_flists()
    first_chunk = curr_chunk = NULL;
    return;
 }
+
+/*
+ * Writes a table of how the memory handled here is used: for each size,
+ * the number of chunks carved up for it, the pieces in use, the pieces
+ * lying free and the share of that size's memory they waste. A size
+ * with a lot of free pieces is fragmented; its chunks can't be given
+ * back while any one piece in them is in use. Set THE_MEMORY_STATS in
+ * the environment to have it written to stderr when THE exits.
+ */
+/******************************************************************************/
+#ifdef HAVE_PROTO
+void the_memory_stats( FILE *fp )
+#else
+void the_memory_stats( fp )
+FILE *fp;
+#endif
+/******************************************************************************/
+{
+   int bin ;
+   unsigned long pieces, unused ;
+   unsigned long total_chunks = 0, total_unused = 0 ;
+
+   fprintf( fp, "  size  chunks    used    free  free%%\n" );
+   for (bin=0; bin<NUMBER_SIZES; bin++)
+   {
+      if (chunks_in_bin[bin] == 0)
+         continue;
+      pieces = chunks_in_bin[bin] * (CHUNK_SIZE / sizes[bin]) ;
+      unused = pieces - used_in_bin[bin] ;
+      fprintf( fp, "%6d %7lu %7lu %7lu %5lu\n",
+               sizes[bin], chunks_in_bin[bin], used_in_bin[bin], unused,
+               (unused * 100) / pieces );
+      total_chunks += chunks_in_bin[bin] ;
+      total_unused += unused * sizes[bin] ;
+   }
+   fprintf( fp, "%lu KB in chunks, %lu KB free in them; %ld blocks over %d bytes; hashtable %lu entries in %lu buckets\n",
+            (total_chunks * CHUNK_SIZE) / 1024, total_unused / 1024,
+            big_blocks, MAX_INTERNAL_SIZE, hashentries, hashmask + 1 );
+}
 #endif /* __BOUNDS_CHECKING_ON */
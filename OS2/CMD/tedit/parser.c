@@ -73,6 +73,33 @@ static int number_blanks=0;
 static CHARTYPE *work;
 static char tmp[100];
 
+/*
+ * Cache of highlighting already worked out for a line, so that a line
+ * that has not changed is not parsed again every time the screen is
+ * rebuilt. Entries are keyed on the line's contents and everything else
+ * parse_line() looks at; an edited line simply misses.
+ */
+#define PARSE_CACHE_SIZE 256
+
+typedef struct
+{
+   unsigned long hash;
+   unsigned long colours;
+   unsigned long generation;
+   FILE_DETAILS *fd;
+   PARSER_DETAILS *parser;
+   LINETYPE syntax_headers;
+   LENGTHTYPE verify_col;
+   LENGTHTYPE length;
+   LENGTHTYPE size;
+   bool is_current_line;
+   CHARTYPE *contents;
+   chtype highlighting[260];
+} PARSE_CACHE;
+
+static PARSE_CACHE *parse_cache[PARSE_CACHE_SIZE];
+static unsigned long parse_cache_generation=0;
+
 /***********************************************************************/
 #ifdef HAVE_PROTO
 static long find_comment( FILE_DETAILS *fd, LENGTHTYPE start, LENGTHTYPE length, CHARTYPE *ptr, CHARTYPE *start_delim, CHARTYPE *end_delim, int *type )
@@ -2260,13 +2287,12 @@ SHOW_LINE *scurr;
 
 /***********************************************************************/
 #ifdef HAVE_PROTO
-short parse_line(CHARTYPE scrno,FILE_DETAILS *fd,SHOW_LINE *scurr,short start_row)
+static short parse_line_uncached(CHARTYPE scrno,FILE_DETAILS *fd,SHOW_LINE *scurr)
 #else
-short parse_line(scrno,fd,scurr,start_row)
+static short parse_line_uncached(scrno,fd,scurr)
 CHARTYPE scrno;
 FILE_DETAILS *fd;
 SHOW_LINE *scurr;
-short start_row;
 #endif
 /***********************************************************************/
 {
@@ -2275,7 +2301,7 @@ short start_row;
    LENGTHTYPE len=scurr->length;
    chtype normal_colour;
 /*--------------------------- processing ------------------------------*/
-   TRACE_FUNCTION("parser.c:  parse_line");
+   TRACE_FUNCTION("parser.c:  parse_line_uncached");
    if (len == 0)
    {
       TRACE_RETURN();
@@ -2470,6 +2496,135 @@ short start_row;
    return RC_OK;
 }
 
+/***********************************************************************/
+#ifdef HAVE_PROTO
+static unsigned long parse_colours_hash(FILE_DETAILS *fd)
+#else
+static unsigned long parse_colours_hash(fd)
+FILE_DETAILS *fd;
+#endif
+/***********************************************************************/
+{
+/*--------------------------- local data ------------------------------*/
+   unsigned long hash=colour_support;
+   unsigned char *p;
+   int i;
+/*--------------------------- processing ------------------------------*/
+   /*
+    * Every colour parse_line() can put into the highlighting array
+    * comes from the file's ECOLOURs or its CURLINE/FILEAREA colours.
+    */
+   p = (unsigned char *)fd->ecolour;
+   for (i=0;i<ECOLOUR_MAX*sizeof(COLOUR_ATTR);i++)
+      hash = (hash * 31) + p[i];
+   p = (unsigned char *)(fd->attr+ATTR_CURLINE);
+   for (i=0;i<sizeof(COLOUR_ATTR);i++)
+      hash = (hash * 31) + p[i];
+   p = (unsigned char *)(fd->attr+ATTR_FILEAREA);
+   for (i=0;i<sizeof(COLOUR_ATTR);i++)
+      hash = (hash * 31) + p[i];
+   return hash;
+}
+
+/***********************************************************************/
+#ifdef HAVE_PROTO
+short parse_line(CHARTYPE scrno,FILE_DETAILS *fd,SHOW_LINE *scurr,short start_row)
+#else
+short parse_line(scrno,fd,scurr,start_row)
+CHARTYPE scrno;
+FILE_DETAILS *fd;
+SHOW_LINE *scurr;
+short start_row;
+#endif
+/***********************************************************************/
+{
+/*--------------------------- local data ------------------------------*/
+   LENGTHTYPE len=scurr->length;
+   LENGTHTYPE i;
+   unsigned long hash=2166136261UL;
+   unsigned long colours;
+   PARSE_CACHE *entry;
+   CHARTYPE *contents;
+   short rc;
+/*--------------------------- processing ------------------------------*/
+   TRACE_FUNCTION("parser.c:  parse_line");
+   if (len == 0)
+   {
+      TRACE_RETURN();
+      return RC_OK;
+   }
+   for (i=0;i<len;i++)
+      hash = (hash ^ scurr->contents[i]) * 16777619UL;
+   hash ^= scurr->is_current_line;
+   colours = parse_colours_hash(fd);
+   /*
+    * The paired comment pass in display_screen() works across the
+    * rows on screen and is run after this, so what is cached here is
+    * only ever the state of the line taken on its own.
+    */
+   entry = parse_cache[hash & (PARSE_CACHE_SIZE-1)];
+   if (entry
+   &&  entry->hash == hash
+   &&  entry->length == len
+   &&  entry->fd == fd
+   &&  entry->parser == fd->parser
+   &&  entry->generation == parse_cache_generation
+   &&  entry->is_current_line == scurr->is_current_line
+   &&  entry->verify_col == SCREEN_VIEW(scrno)->verify_col
+   &&  entry->syntax_headers == CURRENT_VIEW->syntax_headers
+   &&  entry->colours == colours
+   &&  memcmp(entry->contents,scurr->contents,len) == 0)
+   {
+      memcpy(scurr->highlighting,entry->highlighting,sizeof(scurr->highlighting));
+      TRACE_RETURN();
+      return RC_OK;
+   }
+   rc = parse_line_uncached(scrno,fd,scurr);
+   /*
+    * Remember the result. If the memory can't be had, the line is
+    * still highlighted; it just gets parsed again next time.
+    */
+   if (entry == NULL)
+   {
+      entry = (PARSE_CACHE *)(*the_malloc)(sizeof(PARSE_CACHE));
+      if (entry == NULL)
+      {
+         TRACE_RETURN();
+         return rc;
+      }
+      entry->contents = NULL;
+      entry->size = 0;
+      parse_cache[hash & (PARSE_CACHE_SIZE-1)] = entry;
+   }
+   if (entry->size < len)
+   {
+      contents = (CHARTYPE *)(*the_malloc)(len*sizeof(CHARTYPE));
+      if (contents == NULL)
+      {
+         entry->length = 0;
+         TRACE_RETURN();
+         return rc;
+      }
+      if (entry->contents)
+         (*the_free)(entry->contents);
+      entry->contents = contents;
+      entry->size = len;
+   }
+   memcpy(entry->contents,scurr->contents,len);
+   memcpy(entry->highlighting,scurr->highlighting,sizeof(entry->highlighting));
+   entry->hash = hash;
+   entry->length = len;
+   entry->fd = fd;
+   entry->parser = fd->parser;
+   entry->generation = parse_cache_generation;
+   entry->is_current_line = scurr->is_current_line;
+   entry->verify_col = SCREEN_VIEW(scrno)->verify_col;
+   entry->syntax_headers = CURRENT_VIEW->syntax_headers;
+   entry->colours = colours;
+   TRACE_RETURN();
+   return rc;
+}
+
 /***********************************************************************/
 #ifdef HAVE_PROTO
 static short construct_case(CHARTYPE *line, int line_length, PARSER_DETAILS *parser, int lineno)
@@ -4204,6 +4359,11 @@ PARSER_DETAILS *parser;
    short rc=RC_OK;
 /*--------------------------- processing ------------------------------*/
    TRACE_FUNCTION("parser.c:  destroy_parser");
+   /*
+    * A new parser may be given this one's address; make sure nothing
+    * cached against the old one can be found again.
+    */
+   parse_cache_generation++;
    if (parser->first_comments)
    {
       parser->first_comments = parse_commentsll_free(parser->first_comments);
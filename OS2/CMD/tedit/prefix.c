@@ -667,6 +667,7 @@ LINETYPE number_lines;
             break;
       }
    }
+   scope_changed();
    return(rc);
 }
 /***********************************************************************/
@@ -717,6 +718,7 @@ LINETYPE number_lines;
          curr = curr->prev;
       number_lines -= direction;
    }
+   scope_changed();
    /*
     * Determine if current line is now not in scope...
     */
@@ -1286,6 +1288,7 @@ LINETYPE number_lines;
          curr->select = (short)CURRENT_VIEW->display_high + 1;
       curr = curr->next;
    }
+   scope_changed();
    /*
     * Determine if current line is now not in scope...
     */
@@ -108,6 +108,8 @@ short find_rtarget_target Args((_LINE *,TARGET *,LINETYPE,LINETYPE,LINETYPE *));
 bool find_rtarget_column_target Args((CHARTYPE *,LENGTHTYPE,TARGET *,LENGTHTYPE,LENGTHTYPE,LINETYPE *));
 LINETYPE find_next_in_scope Args((VIEW_DETAILS *,_LINE *,LINETYPE,short));
 LINETYPE find_last_not_in_scope Args((VIEW_DETAILS *,_LINE *,LINETYPE,short));
+void scope_changed Args((void));
+LINETYPE skip_scope_run Args((VIEW_DETAILS *,_LINE **,LINETYPE,short));
 short validate_target Args((CHARTYPE *,TARGET *,short,LINETYPE,bool,bool));
 void calculate_scroll_values Args((short *,LINETYPE *,LINETYPE *,bool *,bool *,bool *,short));
 short find_first_focus_line Args((unsigned short *));
@@ -343,6 +345,8 @@ _LINE *lll_add Args((_LINE *,_LINE *,unsigned short ));
 _LINE *lll_del Args((_LINE **,_LINE **,_LINE *,short ));
 _LINE *lll_free Args((_LINE *));
 _LINE *lll_find Args((_LINE *,_LINE *,LINETYPE,LINETYPE));
+void lll_changed Args((void));
+unsigned long lll_get_generation Args((void));
 _LINE *lll_locate Args((_LINE *,CHARTYPE *));
 VIEW_DETAILS *vll_add Args((VIEW_DETAILS *,VIEW_DETAILS *,unsigned short ));
 VIEW_DETAILS *vll_del Args((VIEW_DETAILS **,VIEW_DETAILS **,VIEW_DETAILS *,short ));
@@ -467,6 +471,7 @@ void *get_a_block Args(( int ));
 void give_a_block Args(( void * ));
 void *resize_a_block Args(( void *, int ));
 void the_free_flists  Args(( void ));
+void the_memory_stats  Args(( FILE * ));
                                                            /* single.c */
 int initialise_fifo Args(( _LINE *first_file_name, LINETYPE startup_line, LENGTHTYPE startup_column, bool ro ));
 int process_fifo_input Args(( int key ));
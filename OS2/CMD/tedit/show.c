@@ -1064,6 +1064,8 @@ short rows,start_row;
    */
    RESERVED *curr_rsrvd;
    LINETYPE num_shadow_lines=0;
+   LINETYPE skip_line,walked;
+   _LINE *skip_curr;
    short tab_actual_row;
    short scale_actual_row;
    short hexshow_actual_start_row=0;
@@ -1275,6 +1277,7 @@ short rows,start_row;
             if (direction == DIRECTION_FORWARD)
             {
                curr = curr->next; /* belonging to above shadow */
+               walked = 0;
                for (;;)
                { /* like above useful checks */
                   if (curr->next == NULL)
@@ -1286,6 +1289,22 @@ short rows,start_row;
                   || cline == screen_view->current_line)
 /*                  || curr->pre != NULL)*/
                      break;
+                  /*
+                   * Well into a long run: step over the rest of it at
+                   * once unless the current line is inside it.
+                   */
+                  if (++walked == SCOPE_RUN_MIN/2)
+                  {
+                     skip_curr = curr;
+                     skip_line = skip_scope_run(screen_view,&skip_curr,cline,direction);
+                     if (screen_view->current_line < cline
+                     ||  screen_view->current_line > skip_line)
+                     {
+                        num_shadow_lines += skip_line - cline;
+                        cline = skip_line;
+                        curr = skip_curr;
+                     }
+                  }
                   num_shadow_lines++;
                   cline++;
                   curr = curr->next;
@@ -1294,6 +1313,7 @@ short rows,start_row;
             else
             {
                curr = curr->prev; /* belonging to above shadow */
+               walked = 0;
                for (;;)
                { /* like above useful checks */
                   if (curr->prev == NULL)
@@ -1305,6 +1325,18 @@ short rows,start_row;
                   || cline == screen_view->current_line)
 /*                  || curr->pre != NULL)*/
                      break;
+                  if (++walked == SCOPE_RUN_MIN/2)
+                  {
+                     skip_curr = curr;
+                     skip_line = skip_scope_run(screen_view,&skip_curr,cline,direction);
+                     if (screen_view->current_line > cline
+                     ||  screen_view->current_line < skip_line)
+                     {
+                        num_shadow_lines += cline - skip_line;
+                        cline = skip_line;
+                        curr = skip_curr;
+                     }
+                  }
                   num_shadow_lines++;
                   cline--;
                   curr = curr->prev;
@@ -52,13 +52,31 @@ struct sort_field
  };
 typedef struct sort_field SORT_FIELD;
 
-CHARTYPE *sort_field_1;
-CHARTYPE *sort_field_2;
+/*
+ * The sort key of each line is worked out once, before the sort, as a
+ * pointer to and the length of the part of the line in each sort field.
+ * cmp() then compares these in place, with no copying per comparison.
+ */
+struct sort_key
+ {
+  CHARTYPE *ptr;                            /* start of field in line */
+  LENGTHTYPE len;            /* chars of line in field; rest is blank */
+ };
+typedef struct sort_key SORT_KEY;
+
+struct sort_line
+ {
+  _LINE *line;                                      /* line to relink */
+  SORT_KEY *key;                            /* one key per sort field */
+ };
+typedef struct sort_line SORT_LINE;
 
 SORT_FIELD sort_fields[MAX_SORT_FIELDS];
 
 short num_fields;
 
+static CHARTYPE sort_trans[256];        /* uppercases for CASE IGNORE */
+
 #ifdef __STDC__
 static int cmp(const void *,const void *);
 #else
@@ -75,11 +93,12 @@ void *first,*second;
 /***********************************************************************/
 {
 /*--------------------------- local data ------------------------------*/
- register short i=0,j=0;
- short len=0,rc=RC_OK;
- LENGTHTYPE right_col=0,left_col=0;
- _LINE *one = *(_LINE **)first;
- _LINE *two = *(_LINE **)second;
+ register LENGTHTYPE j=0;
+ register int c1=0,c2=0;
+ short i=0;
+ LENGTHTYPE maxlen=0;
+ SORT_KEY *one = ((SORT_LINE *)first)->key;
+ SORT_KEY *two = ((SORT_LINE *)second)->key;
 /*--------------------------- processing ------------------------------*/
 /*---------------------------------------------------------------------*/
 /* For each sort field defined in the array sort_fields, compare the   */
@@ -88,60 +107,21 @@ void *first,*second;
  for (i=0;i<num_fields;i++)
     {
 /*---------------------------------------------------------------------*/
-/* Calculate the length of the sort field.                             */
-/*---------------------------------------------------------------------*/
-     len = sort_fields[i].right_col - sort_fields[i].left_col + 1;
-/*---------------------------------------------------------------------*/
-/* Set the two temporary fields to blanks.                             */
-/*---------------------------------------------------------------------*/
-     memset(sort_field_1,' ',len);
-     memset(sort_field_2,' ',len);
-/*---------------------------------------------------------------------*/
-/* For the first line to be compared, extract the portion of the line  */
-/* that corresponds with the current sort column...                    */
-/*---------------------------------------------------------------------*/
-     right_col = min(sort_fields[i].right_col,one->length);
-     left_col = min(sort_fields[i].left_col,one->length);
-/*---------------------------------------------------------------------*/
-/* If the sort column lies after the end of the line, leave the        */
-/* contents of the sort field blank.                                   */
+/* Compare as if each field had been copied out of its line, padded    */
+/* with blanks past the end of the line and uppercased if CASE IGNORE  */
+/* is on, then compared with strncmp(). Once both lines have run out   */
+/* the rest of the field is blanks in both, so stop there.             */
 /*---------------------------------------------------------------------*/
-     if (sort_fields[i].left_col <= one->length)
-        memcpy(sort_field_1,one->line+left_col-1,right_col-left_col+1);
-/*---------------------------------------------------------------------*/
-/* For the next  line to be compared, extract the portion of the line  */
-/* that corresponds with the current sort column...                    */
-/*---------------------------------------------------------------------*/
-     right_col = min(sort_fields[i].right_col,two->length);
-     left_col = min(sort_fields[i].left_col,two->length);
-/*---------------------------------------------------------------------*/
-/* If the sort column lies after the end of the line, leave the        */
-/* contents of the sort field blank.                                   */
-/*---------------------------------------------------------------------*/
-     if (sort_fields[i].left_col <= two->length)
-        memcpy(sort_field_2,two->line+left_col-1,right_col-left_col+1);
-/*---------------------------------------------------------------------*/
-/* If CASE IGNORE is on for the current view, set both sort fields to  */
-/* uppercase for the comparison.                                       */
-/*---------------------------------------------------------------------*/
-     if (CURRENT_VIEW->case_sort == CASE_IGNORE)
+     maxlen = max(one[i].len,two[i].len);
+     for (j=0;j<maxlen;j++)
        {
-        for (j=0;j<len;j++)
-          {
-           if (islower(sort_field_1[j]))
-              sort_field_1[j] = toupper(sort_field_1[j]);
-           if (islower(sort_field_2[j]))
-              sort_field_2[j] = toupper(sort_field_2[j]);
-          }
+        c1 = (j < one[i].len) ? sort_trans[one[i].ptr[j]] : ' ';
+        c2 = (j < two[i].len) ? sort_trans[two[i].ptr[j]] : ' ';
+        if (c1 != c2)
+           return((sort_fields[i].order == 'A') ? c1 - c2 : c2 - c1);
+        if (c1 == '\0')
+           break;
        }
-/*---------------------------------------------------------------------*/
-/* If the two sort fields are equal, continue the sort with the next   */
-/* sort field value. If the sort fields are different, return with the */
-/* the comparison value (if ASCENDING) or the comparison value negated */
-/* (if DESCENDING).                                                    */
-/*---------------------------------------------------------------------*/
-     if ((rc = strncmp((DEFCHAR *)sort_field_1,(DEFCHAR *)sort_field_2,len)) != 0)
-        return((sort_fields[i].order == 'A') ? rc : -rc);
     }
 /*---------------------------------------------------------------------*/
 /* To get to here, the result of sorting on all fields has resulted in */
@@ -149,7 +129,6 @@ void *first,*second;
 /*---------------------------------------------------------------------*/
  return(0);
 }
-
 /***********************************************************************/
 #ifdef HAVE_PROTO
 short execute_sort(CHARTYPE *params)
@@ -168,6 +147,8 @@ short execute_sort(params)
    unsigned short num_params=0;
    _LINE **lfirst=NULL,**lp=NULL;
    _LINE **origfirst=NULL,**origlp=NULL;
+   SORT_LINE *sort_lines=NULL;
+   SORT_KEY *sort_keys=NULL,*key=NULL;
    _LINE *curr=NULL,*first=NULL,*last=NULL;
    _LINE *curr_prev=NULL,*curr_next=NULL;
    LINETYPE true_line=0L,dest_line=0L;
@@ -176,7 +157,7 @@ short execute_sort(params)
    LINETYPE num_actual_lines=0L;
    LINETYPE num_sorted_lines=0L,save_num_sorted_lines=0L;
    short rc=RC_OK,direction=DIRECTION_FORWARD;
-   LENGTHTYPE left_col=0,right_col=0,max_column_width=0;
+   LENGTHTYPE left_col=0,right_col=0;
    CHARTYPE order='A';
    TARGET target;
    short target_type=TARGET_NORMAL|TARGET_BLOCK_CURRENT|TARGET_ALL|TARGET_SPARE;
@@ -368,28 +349,15 @@ short execute_sort(params)
          break;
    }
    /*
-    * Determine the maximum length of a sort field.
-    */
-   for (i=0;i<num_fields;i++)
-      max_column_width = max(max_column_width,
-                sort_fields[i].right_col - sort_fields[i].left_col + 1);
-   /*
-    * Allocate memory for each of the temporary sort fields to the length
-    * of the maximum field width.
+    * Set up the table cmp() uses to fold the case of sort fields.
     */
-   if ((sort_field_1 = (CHARTYPE *)(*the_malloc)(max_column_width)) == NULL)
-   {
-      free_target(&target);
-      display_error(30,(CHARTYPE *)"",FALSE);
-      TRACE_RETURN();
-      return(RC_OUT_OF_MEMORY);
-   }
-   if ((sort_field_2 = (CHARTYPE *)(*the_malloc)(max_column_width)) == NULL)
+   for (i=0;i<256;i++)
    {
-      free_target(&target);
-      display_error(30,(CHARTYPE *)"",FALSE);
-      TRACE_RETURN();
-      return(RC_OUT_OF_MEMORY);
+      if (CURRENT_VIEW->case_sort == CASE_IGNORE
+      &&  islower(i))
+         sort_trans[i] = toupper(i);
+      else
+         sort_trans[i] = i;
    }
    /*
     * Assign the values of the newly allocated array to the LINE pointers
@@ -475,10 +443,56 @@ short execute_sort(params)
    }
    else
    {
+      /*
+       * Work out the sort key of each line once, up front...
+       */
+      sort_lines = (SORT_LINE *)(*the_malloc)(num_sorted_lines*sizeof(SORT_LINE));
+      sort_keys = (SORT_KEY *)(*the_malloc)(num_sorted_lines*num_fields*sizeof(SORT_KEY));
+      if (sort_lines == NULL
+      ||  sort_keys == NULL)
+      {
+         if (sort_lines)
+            (*the_free)(sort_lines);
+         if (sort_keys)
+            (*the_free)(sort_keys);
+         (*the_free)(lfirst);
+         (*the_free)(origfirst);
+         free_target(&target);
+         display_error(30,(CHARTYPE *)"",FALSE);
+         TRACE_RETURN();
+         return(RC_OUT_OF_MEMORY);
+      }
+      for (j=0L,key=sort_keys;j<num_sorted_lines;j++)
+      {
+         curr = lfirst[j];
+         sort_lines[j].line = curr;
+         sort_lines[j].key = key;
+         for (i=0;i<num_fields;i++,key++)
+         {
+            /*
+             * If the sort column lies after the end of the line, the
+             * whole field is blank.
+             */
+            if (sort_fields[i].left_col <= curr->length)
+            {
+               key->ptr = curr->line + sort_fields[i].left_col - 1;
+               key->len = min(sort_fields[i].right_col,curr->length) - sort_fields[i].left_col + 1;
+            }
+            else
+            {
+               key->ptr = NULL;
+               key->len = 0;
+            }
+         }
+      }
       /*
        * Sort the target array...
        */
-      qsort(lfirst,num_sorted_lines,sizeof(_LINE *),cmp);
+      qsort(sort_lines,num_sorted_lines,sizeof(SORT_LINE),cmp);
+      for (j=0L;j<num_sorted_lines;j++)
+         lfirst[j] = sort_lines[j].line;
+      (*the_free)(sort_lines);
+      (*the_free)(sort_keys);
       /*
        * Merge  the sorted array pointers into the linked list...
        */
@@ -564,6 +578,10 @@ short execute_sort(params)
          if (curr == NULL)
             break;
       }
+      /*
+       * The lines have been relinked behind lll_find()'s back...
+       */
+      lll_changed();
       /*
        * If STAY is OFF, change the current and focus lines by the number
        * of lines calculated from the target.
@@ -583,8 +601,6 @@ short execute_sort(params)
    /*
     * Free up the memory used for the sort fields and the target array.
     */
-   (*the_free)(sort_field_1);
-   (*the_free)(sort_field_2);
    (*the_free)(lfirst);
    (*the_free)(origfirst);
    free_target(&target);
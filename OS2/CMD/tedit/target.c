@@ -55,10 +55,38 @@ static char RCSid[] = "$Id: target.c,v 1.12 2002/06/07 22:25:05 mark Exp $";
 
 #ifdef HAVE_PROTO
 static bool is_blank(_LINE *);
+static void build_scope_runs(VIEW_DETAILS *);
 #else
 static bool is_blank();
+static void build_scope_runs();
 #endif
 
+/*
+ * Index of the runs of lines that are out of scope for one view of one
+ * file. It is rebuilt when the file's lines change shape, when any
+ * line's select level changes (see scope_changed()), or when a
+ * different view or DISPLAY range asks for it.
+ */
+typedef struct
+{
+   LINETYPE first_number;                /* line number of first line */
+   LINETYPE length;                      /* number of lines in the run */
+   _LINE *first;                         /* first line out of scope */
+   _LINE *last;                          /* last line out of scope */
+} SCOPE_RUN;
+
+static SCOPE_RUN *scope_runs=NULL;
+static LINETYPE scope_runs_count=0L;
+static LINETYPE scope_runs_size=0L;
+static bool scope_runs_valid=FALSE;
+static unsigned long scope_runs_generation=0L;
+static unsigned long scope_runs_lll_generation=0L;
+static unsigned long scope_generation=0L;
+static FILE_DETAILS *scope_runs_file=NULL;
+static _LINE *scope_runs_first_line=NULL;
+static SELECTTYPE scope_runs_low=0;
+static SELECTTYPE scope_runs_high=0;
+
 /***********************************************************************/
 #ifdef HAVE_PROTO
 short split_change_params(CHARTYPE *cmd_line,CHARTYPE **old_str,CHARTYPE **new_str,
@@ -954,6 +982,13 @@ bool display_parse_error,allow_error_display,column_target;
              * Compile the RE
              */
             memset( &target->rt[i].pattern_buffer, 0, sizeof(struct re_pattern_buffer) );
+            /*
+             * Give the RE a fastmap so that re_search() in find_regexp()
+             * can skip characters that cannot start a match. It is freed
+             * with free() in the_regfree(), so must come from malloc().
+             * If it can't be allocated, re_search() just does without.
+             */
+            target->rt[i].pattern_buffer.fastmap = (char *)malloc( 256 );
             ptr = (CHARTYPE *)re_compile_pattern( (DEFCHAR *)target->rt[i].string, REGEXPx, strlen( (DEFCHAR *)target->rt[i].string ), &target->rt[i].pattern_buffer );
             if (ptr)
             {
@@ -1448,9 +1483,10 @@ RTARGET *rt;
 {
 /*--------------------------- local data ------------------------------*/
    CHARTYPE *haystack=NULL;
-   LENGTHTYPE len,i,haystack_length=0,real_start=0,real_end=0;
+   LENGTHTYPE len,haystack_length=0,real_start=0,real_end=0;
    short rc=RC_TARGET_NOT_FOUND;
    long re_len;
+   int pos;
 /*--------------------------- processing ------------------------------*/
    TRACE_FUNCTION("target.c:  find_regexp");
    /*
@@ -1476,18 +1512,26 @@ RTARGET *rt;
       len = real_end - real_start + 1;
    }
 
-   for (i=0;i<len;)
+   /*
+    * re_search() uses the fastmap to skip to the next column that could
+    * start a match, then re_match() gives the length of the match there.
+    * The line is passed up to the end of the zone, so that ^ and $ still
+    * anchor to the start of the line and the end of the zone. An empty
+    * match does not count, so search again from the next column.
+    */
+   for (pos=real_start;len && pos<=(int)real_end;pos++)
    {
-      re_len = re_match( &rt->pattern_buffer, (DEFCHAR *)haystack+i,len-i,0,0);
+      pos = re_search( &rt->pattern_buffer, (DEFCHAR *)haystack, real_end+1, pos, real_end-pos, 0 );
+      if ( pos < 0 )
+         break;
+      re_len = re_match( &rt->pattern_buffer, (DEFCHAR *)haystack, real_end+1, pos, 0 );
       if ( re_len > 0 )
       {
          rt->length = re_len;
-         rt->start = real_start+i; /* ?? */
+         rt->start = pos;
          rc = RC_OK;
          break;
       }
-      else
-         i++;
    }
 
    TRACE_RETURN();
@@ -1784,6 +1828,7 @@ short direction;
 {
 /*--------------------------- local data ------------------------------*/
  _LINE *curr=in_curr;
+ LINETYPE walked=0L;
 /*--------------------------- processing ------------------------------*/
  TRACE_FUNCTION("target.c:  find_next_in_scope");
  if (in_curr == NULL)
@@ -1792,6 +1837,8 @@ short direction;
    {
     if (IN_SCOPE(view,curr))
        break;
+    if (++walked == SCOPE_RUN_MIN/2)
+       line_number = skip_scope_run(view,&curr,line_number,direction);
     if (direction == DIRECTION_FORWARD)
        curr = curr->next;
     else
@@ -1817,6 +1864,7 @@ short direction;
 /*--------------------------- local data ------------------------------*/
  _LINE *curr=in_curr;
  LINETYPE offset=0L;
+ LINETYPE walked=0L;
 /*--------------------------- processing ------------------------------*/
  TRACE_FUNCTION("target.c:  find_last_not_in_scope");
  if (in_curr == NULL)
@@ -1825,6 +1873,8 @@ short direction;
    {
     if (IN_SCOPE(view,curr))
        break;
+    if (++walked == SCOPE_RUN_MIN/2)
+       line_number = skip_scope_run(view,&curr,line_number,direction);
     if (direction == DIRECTION_FORWARD)
       {
        curr = curr->next;
@@ -1843,6 +1893,185 @@ short direction;
 }
 /***********************************************************************/
 #ifdef HAVE_PROTO
+void scope_changed(void)
+#else
+void scope_changed()
+#endif
+/***********************************************************************/
+/* Must be called after changing the select level of any file line, so */
+/* that skip_scope_run() does not use runs that are no longer true.    */
+/***********************************************************************/
+{
+/*--------------------------- local data ------------------------------*/
+/*--------------------------- processing ------------------------------*/
+ TRACE_FUNCTION("target.c:  scope_changed");
+ scope_generation++;
+ TRACE_RETURN();
+ return;
+}
+/***********************************************************************/
+#ifdef HAVE_PROTO
+static void build_scope_runs(VIEW_DETAILS *view)
+#else
+static void build_scope_runs(view)
+VIEW_DETAILS *view;
+#endif
+/***********************************************************************/
+{
+/*--------------------------- local data ------------------------------*/
+ FILE_DETAILS *fd=view->file_for_view;
+ _LINE *curr=NULL;
+ _LINE *first=NULL;
+ _LINE *last=NULL;
+ LINETYPE line_number=1L;
+ LINETYPE first_number=0L;
+ SCOPE_RUN *new_runs=NULL;
+ LINETYPE new_size=0L;
+/*--------------------------- processing ------------------------------*/
+ TRACE_FUNCTION("target.c:  build_scope_runs");
+ scope_runs_count = 0L;
+ scope_runs_valid = TRUE;
+ scope_runs_generation = scope_generation;
+ scope_runs_lll_generation = lll_get_generation();
+ scope_runs_file = fd;
+ scope_runs_first_line = fd->first_line;
+ scope_runs_low = view->display_low;
+ scope_runs_high = view->display_high;
+ /*
+  * TOF and EOF are never part of a run.
+  */
+ curr = fd->first_line->next;
+ while (curr != NULL
+ &&     curr->next != NULL)
+   {
+    if (IN_SCOPE(view,curr))
+      {
+       curr = curr->next;
+       line_number++;
+       continue;
+      }
+    first = curr;
+    first_number = line_number;
+    while (curr->next != NULL
+    &&     !IN_SCOPE(view,curr))
+      {
+       last = curr;
+       curr = curr->next;
+       line_number++;
+      }
+    if (line_number - first_number < SCOPE_RUN_MIN)
+       continue;
+    if (scope_runs_count == scope_runs_size)
+      {
+       new_size = (scope_runs_size) ? scope_runs_size * 2 : 64L;
+       if (scope_runs == NULL)
+          new_runs = (SCOPE_RUN *)(*the_malloc)(new_size*sizeof(SCOPE_RUN));
+       else
+          new_runs = (SCOPE_RUN *)(*the_realloc)(scope_runs,new_size*sizeof(SCOPE_RUN));
+       if (new_runs == NULL)
+         {
+          /*
+           * Without the memory every line is simply walked.
+           */
+          scope_runs_count = 0L;
+          break;
+         }
+       scope_runs = new_runs;
+       scope_runs_size = new_size;
+      }
+    scope_runs[scope_runs_count].first_number = first_number;
+    scope_runs[scope_runs_count].length = line_number - first_number;
+    scope_runs[scope_runs_count].first = first;
+    scope_runs[scope_runs_count].last = last;
+    scope_runs_count++;
+   }
+ TRACE_RETURN();
+ return;
+}
+/***********************************************************************/
+#ifdef HAVE_PROTO
+LINETYPE skip_scope_run(VIEW_DETAILS *view,_LINE **curr,LINETYPE line_number,short direction)
+#else
+LINETYPE skip_scope_run(view,curr,line_number,direction)
+VIEW_DETAILS *view;
+_LINE **curr;
+LINETYPE line_number;
+short direction;
+#endif
+/***********************************************************************/
+/* Called by code walking over lines that are out of scope. If         */
+/* line_number is inside a run of at least SCOPE_RUN_MIN such lines,   */
+/* *curr is set to the last line of the run in the given direction     */
+/* and its line number is returned; otherwise line_number is returned  */
+/* and *curr is left alone. Callers should only ask once they have     */
+/* already walked some way, as the index costs a pass over the file    */
+/* to build after any change.                                          */
+/***********************************************************************/
+{
+/*--------------------------- local data ------------------------------*/
+ FILE_DETAILS *fd=view->file_for_view;
+ LINETYPE low=0L,high=0L,mid=0L;
+ SCOPE_RUN *run=NULL;
+/*--------------------------- processing ------------------------------*/
+ TRACE_FUNCTION("target.c:  skip_scope_run");
+ if (!scope_runs_valid
+ ||  scope_runs_generation != scope_generation
+ ||  scope_runs_lll_generation != lll_get_generation()
+ ||  scope_runs_file != fd
+ ||  scope_runs_first_line != fd->first_line
+ ||  scope_runs_low != view->display_low
+ ||  scope_runs_high != view->display_high)
+    build_scope_runs(view);
+ /*
+  * Find the last run starting at or before line_number.
+  */
+ low = 0L;
+ high = scope_runs_count;
+ while (low < high)
+   {
+    mid = low + (high - low) / 2;
+    if (scope_runs[mid].first_number <= line_number)
+       low = mid + 1;
+    else
+       high = mid;
+   }
+ if (low == 0L)
+   {
+    TRACE_RETURN();
+    return(line_number);
+   }
+ run = scope_runs + low - 1;
+ if (line_number >= run->first_number + run->length)
+   {
+    TRACE_RETURN();
+    return(line_number);
+   }
+ /*
+  * A select level changed without scope_changed() being called would
+  * make this run wrong; check its ends before trusting it.
+  */
+ if (IN_SCOPE(view,run->first)
+ ||  IN_SCOPE(view,run->last))
+   {
+    scope_runs_valid = FALSE;
+    TRACE_RETURN();
+    return(line_number);
+   }
+ if (direction == DIRECTION_FORWARD)
+   {
+    *curr = run->last;
+    line_number = run->first_number + run->length - 1L;
+   }
+ else
+   {
+    *curr = run->first;
+    line_number = run->first_number;
+   }
+ TRACE_RETURN();
+ return(line_number);
+}
+/***********************************************************************/
+#ifdef HAVE_PROTO
 short validate_target(CHARTYPE *string,TARGET *target,short target_type,LINETYPE true_line,bool display_parse_error,bool allow_error_display)
 #else
 short validate_target(string,target,target_type,true_line,display_parse_error,allow_error_display)
@@ -1772,6 +1772,11 @@ struct regexp_syntax
 #define     FOCUS_BOF           ((CURRENT_VIEW->focus_line == CURRENT_FILE->number_lines+1L) ? TRUE : FALSE)
 #define     IN_VIEW(view,line)   ((line >= (view->current_line - (LINETYPE)view->current_row)) && (line <= (view->current_line + ((LINETYPE)CURRENT_SCREEN.rows[WINDOW_FILEAREA] - (LINETYPE)view->current_row))))
 #define     IN_SCOPE(view,line) ((line)->select >= (view)->display_low && (line)->select <= (view)->display_high)
+/*
+ * Runs of at least this many lines out of scope are indexed so that
+ * skip_scope_run() can step over them without walking each line.
+ */
+#define     SCOPE_RUN_MIN       256
 /*---------------------- system specific redefines --------------------*/
 #ifdef VAX
 #define     wattrset     wsetattr
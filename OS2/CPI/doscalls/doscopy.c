@@ -9,13 +9,12 @@
 
    @author Yuri Prokushev <prokushev@freemail.ru>
 
-   @todo Add support of EAs
-
 */
 
 #include <string.h>
 #include <sys/stat.h>
 
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 // Safe functions
@@ -44,6 +43,13 @@
      DosRead
      DosWrite
      DosSetFilePtrL
+     DosSetFileSizeL
+     DosQueryFileInfo
+     DosSetFileInfo
+     DosEnumAttribute
+     DosQueryFSInfo
+     DosFSCtl
+     DosCreateThread
      DosCreateDir
      DosDeleteDir
      DosDelete
@@ -57,10 +63,310 @@
 //APIRET __cdecl   KalMove(PCSZ  pszOld,
 //                         PCSZ  pszNew);
 
-#define IOBUF_SIZ       32768U                  /* enough? (performance)
-                                                   Most probably here
-                                                   we must automatically
-                                                   detect size of buffer */
+// transfer buffer: a whole number of clusters within these bounds
+#define IOBUF_MIN       65536U
+#define IOBUF_MAX       (1024U * 1024U)
+#define IOBUF_CLUSTERS  32
+
+// files larger than one buffer are copied by a reader and a writer thread
+#define COPY_STACK      16384
+
+// FSD-private DosFSCtl function: copy an open file server side.
+// Other file systems fail it and the data is copied here instead.
+#define FSCTL_COPYFILE  0x8001
+
+typedef unsigned long long ULL;
+
+#define LL2ULL(ll)      (((ULL)(ll).ulHi << 32) | (ll).ulLo)
+
+static void ULL2LL(ULL v, LONGLONG *ll)
+{
+  ll->ulLo = (ULONG)v;
+  ll->ulHi = (ULONG)(v >> 32);
+}
+
+/*
+ *  FSCTL_COPYFILE parameters, sent on the target handle
+ */
+typedef struct _COPYFSCTL
+{
+  HFILE    hSrc;
+  LONGLONG cbFile;
+} COPYFSCTL;
+
+/*
+ *  Double buffer shared by the reading and the writing thread.
+ *  hevEmpty[i] is posted while buffer i may be filled, hevFull[i]
+ *  once it holds cbData[i] bytes to write; 0 bytes ends the copy.
+ */
+typedef struct _COPYPIPE
+{
+  HFILE  hDst;
+  ULONG  cbBuf;
+  PBYTE  pBuf[2];
+  ULONG  cbData[2];
+  HEV    hevFull[2];
+  HEV    hevEmpty[2];
+  APIRET rc;                // first write error
+} COPYPIPE;
+
+/*
+ *  Transfer size for a copy between two drives: big enough to
+ *  keep the disks streaming, a cluster multiple on both ends
+ */
+static ULONG CopyBufSize(PSZ pszSrc, PSZ pszDst)
+{
+  FSALLOCATE fsa;
+  ULONG cbCluster = 0;
+  ULONG cbBuf;
+  ULONG c;
+  int   i;
+  PSZ   psz;
+
+  for (i = 0; i < 2; i++)
+  {
+    psz = i ? pszDst : pszSrc;
+
+    if (psz[0] && psz[1] == ':')
+      c = (psz[0] | 0x20) - 'a' + 1;
+    else
+      c = 0;                // current drive
+
+    if (DosQueryFSInfo(c, FSIL_ALLOC, &fsa, sizeof(fsa)))
+      continue;
+
+    c = fsa.cSectorUnit * fsa.cbSector;
+
+    if (c > cbCluster)
+      cbCluster = c;
+  }
+
+  if (!cbCluster)
+    return IOBUF_MIN;
+
+  cbBuf = cbCluster * IOBUF_CLUSTERS;
+
+  if (cbBuf < IOBUF_MIN)
+    cbBuf = IOBUF_MIN;
+  if (cbBuf > IOBUF_MAX)
+    cbBuf = IOBUF_MAX;
+
+  return cbBuf - cbBuf % cbCluster;
+}
+
+/*
+ *  Copies all EAs of the source with one query and one set
+ */
+static APIRET CopyEAs(HFILE hSrc, HFILE hDst, ULONG ulOptions)
+{
+  FILESTATUS4L fs;
+  EAOP2  eaop;
+  PDENA2 pDena;
+  PGEA2  pGea;
+  PBYTE  pMem;
+  ULONG  cEAs = (ULONG)-1;
+  ULONG  cbGea, cbList, i;
+  APIRET rc;
+
+  rc = DosQueryFileInfo(hSrc, FIL_QUERYEASIZEL, &fs, sizeof(fs));
+
+  // no EAs (an empty FEA2LIST is just its length)
+  if (rc || fs.cbList <= sizeof(ULONG))
+    return NO_ERROR;
+
+  // names, a GEA2LIST built from them, and the FEA2LIST
+  cbList = fs.cbList * 3;
+
+  rc = DosAllocMem((void **)&pMem, cbList, fPERM | PAG_COMMIT);
+
+  if (rc)
+    return rc;
+
+  pDena = (PDENA2)pMem;
+
+  rc = DosEnumAttribute(ENUMEA_REFTYPE_FHANDLE, &hSrc, 1,
+                        pDena, fs.cbList, &cEAs,
+                        ENUMEA_LEVEL_NO_VALUE);
+
+  if (rc || !cEAs)
+    goto COPYEAS_EXIT;
+
+  eaop.fpGEA2List = (PGEA2LIST)(pMem + fs.cbList);
+  eaop.fpFEA2List = (PFEA2LIST)(pMem + fs.cbList * 2);
+  eaop.oError = 0;
+
+  pGea = eaop.fpGEA2List->list;
+
+  for (i = 0; i < cEAs; i++)
+  {
+    cbGea = (sizeof(GEA2) + pDena->cbName + 3) & ~3;
+
+    pGea->oNextEntryOffset = (i + 1 < cEAs) ? cbGea : 0;
+    pGea->cbName = pDena->cbName;
+    memcpy(pGea->szName, pDena->szName, pDena->cbName + 1);
+
+    pGea = (PGEA2)((PBYTE)pGea + cbGea);
+    pDena = (PDENA2)((PBYTE)pDena + pDena->oNextEntryOffset);
+  }
+
+  eaop.fpGEA2List->cbList = (PBYTE)pGea - (PBYTE)eaop.fpGEA2List;
+  eaop.fpFEA2List->cbList = fs.cbList;
+
+  rc = DosQueryFileInfo(hSrc, FIL_QUERYEASFROMLIST, &eaop, sizeof(eaop));
+
+  if (rc)
+    goto COPYEAS_EXIT;
+
+  rc = DosSetFileInfo(hDst, FIL_QUERYEASIZE, &eaop, sizeof(eaop));
+
+  // the target cannot hold them: drop them unless told to fail
+  if (rc == ERROR_EAS_NOT_SUPPORTED && !(ulOptions & DCPY_FAILEAS))
+    rc = NO_ERROR;
+
+  DosFreeMem(pMem);
+  return rc;
+
+COPYEAS_EXIT:
+  // EAs the source cannot give us leave the data copy standing
+  DosFreeMem(pMem);
+  return NO_ERROR;
+}
+
+/*
+ *  Writer side of the double buffer
+ */
+static VOID APIENTRY CopyWriter(ULONG ulArg)
+{
+  COPYPIPE *p = (COPYPIPE *)ulArg;
+  ULONG ulWritten;
+  ULONG ulPosts;
+  int   i = 0;
+
+  for (;;)
+  {
+    DosWaitEventSem(p->hevFull[i], SEM_INDEFINITE_WAIT);
+    DosResetEventSem(p->hevFull[i], &ulPosts);
+
+    if (!p->cbData[i])
+      break;
+
+    // after an error, just keep the reader moving until it stops
+    if (!p->rc)
+    {
+      p->rc = DosWrite(p->hDst, p->pBuf[i], p->cbData[i], &ulWritten);
+
+      if (!p->rc && ulWritten != p->cbData[i])
+        p->rc = ERROR_WRITE_FAULT;
+    }
+
+    DosPostEventSem(p->hevEmpty[i]);
+    i ^= 1;
+  }
+
+  // acknowledge the end
+  DosPostEventSem(p->hevEmpty[i]);
+}
+
+/*
+ *  Reads on this thread while the previous buffer is written on
+ *  another.  Returns ERROR_INVALID_FUNCTION, having transferred
+ *  nothing, if the writer cannot be started.
+ */
+static APIRET CopyOverlapped(HFILE hSrc, HFILE hDst, PBYTE pIOBuf,
+                             ULONG cbBuf, ULL *pcbCopied)
+{
+  COPYPIPE pipe;
+  ULONG  ulPosts;
+  TID    tid;
+  APIRET rc = NO_ERROR;
+  int    i, n = 0;
+
+  memset(&pipe, 0, sizeof(pipe));
+  pipe.hDst    = hDst;
+  pipe.cbBuf   = cbBuf;
+  pipe.pBuf[0] = pIOBuf;
+  pipe.pBuf[1] = pIOBuf + cbBuf;
+
+  for (i = 0; i < 2; i++, n++)
+  {
+    if (DosCreateEventSem(NULL, &pipe.hevFull[i], 0, FALSE))
+      break;
+    if (DosCreateEventSem(NULL, &pipe.hevEmpty[i], 0, TRUE))
+    {
+      DosCloseEventSem(pipe.hevFull[i]);
+      break;
+    }
+  }
+
+  if (n < 2 || DosCreateThread(&tid, CopyWriter, (ULONG)&pipe,
+                               0, COPY_STACK))
+  {
+    rc = ERROR_INVALID_FUNCTION;
+    goto COPYOVERLAPPED_EXIT;
+  }
+
+  for (i = 0;; i ^= 1)
+  {
+    DosWaitEventSem(pipe.hevEmpty[i], SEM_INDEFINITE_WAIT);
+    DosResetEventSem(pipe.hevEmpty[i], &ulPosts);
+
+    if (pipe.rc || rc)
+      pipe.cbData[i] = 0;
+    else if ((rc = DosRead(hSrc, pipe.pBuf[i], cbBuf, &pipe.cbData[i])))
+      pipe.cbData[i] = 0;
+    else
+      *pcbCopied += pipe.cbData[i];
+
+    DosPostEventSem(pipe.hevFull[i]);
+
+    if (!pipe.cbData[i])
+      break;
+  }
+
+  // wait for the writer to drain and stop
+  DosWaitEventSem(pipe.hevEmpty[i], SEM_INDEFINITE_WAIT);
+
+  if (!rc)
+    rc = pipe.rc;
+
+COPYOVERLAPPED_EXIT:
+  for (i = 0; i < n; i++)
+  {
+    DosCloseEventSem(pipe.hevFull[i]);
+    DosCloseEventSem(pipe.hevEmpty[i]);
+  }
+
+  return rc;
+}
+
+/*
+ *  Plain read/write loop
+ */
+static APIRET CopySerial(HFILE hSrc, HFILE hDst, PBYTE pIOBuf,
+                         ULONG cbBuf, ULL *pcbCopied)
+{
+  ULONG  ulTransfer;
+  ULONG  ulWritten;
+  APIRET rc;
+
+  for (;;)
+  {
+    rc = DosRead(hSrc, pIOBuf, cbBuf, &ulTransfer);
+
+    if (rc || !ulTransfer)
+      return rc;
+
+    rc = DosWrite(hDst, pIOBuf, ulTransfer, &ulWritten);
+
+    if (rc)
+      return rc;
+
+    if (ulTransfer != ulWritten)
+      return ERROR_WRITE_FAULT;
+
+    *pcbCopied += ulTransfer;
+  }
+}
 
 APIRET CopyFile(PSZ pszSrc, PSZ pszDst, ULONG ulOptions)
 {
@@ -68,21 +374,21 @@ APIRET CopyFile(PSZ pszSrc, PSZ pszDst, ULONG ulOptions)
   HFILE  hSrc;
   HFILE  hDst;
   ULONG  ulAction;
-  //PCHAR
-  void **pIOBuf;
-  ULONG  ulTransfer;
-  ULONG  ulWritten;
+  PBYTE  pIOBuf = NULL;
+  ULONG  cbBuf;
   ULONG  ulOpenType;
+  ULONG  cbParms, cbData;
   LONGLONG llZero;
+  LONGLONG llSize;
+  FILESTATUS3L fsSrc;
+  FILESTATUS3L fsDst;
+  COPYFSCTL fsctl;
+  ULL    cbBase = 0;
+  ULL    cbCopied = 0;
 
   llZero.ulLo=0;
   llZero.ulHi=0;
 
-  rc = DosAllocMem(pIOBuf,
-                   IOBUF_SIZ,
-                   fPERM|PAG_COMMIT);
-  if (rc) return rc;
-
   rc = DosOpenL(pszSrc,             // Address of ASCIIZ with source path
                 &hSrc,              // Handle
                 &ulAction,          // Action was taken (not used)
@@ -91,14 +397,11 @@ APIRET CopyFile(PSZ pszSrc, PSZ pszDst, ULONG ulOptions)
                 OPEN_ACTION_FAIL_IF_NEW |
                 OPEN_ACTION_OPEN_IF_EXISTS, // Open type
                 OPEN_SHARE_DENYNONE |
+                OPEN_FLAGS_SEQUENTIAL |
                 OPEN_ACCESS_READONLY, // Open mode
                 NULL);
   if (rc)
-  {
-    DosClose(hSrc);
-    DosFreeMem(pIOBuf);
     return rc;
-  }
 
   if (!(ulOptions&DCPY_EXISTING))
   {
@@ -124,16 +427,18 @@ APIRET CopyFile(PSZ pszSrc, PSZ pszDst, ULONG ulOptions)
                 OPEN_ACTION_CREATE_IF_NEW |
                 ulOpenType, // Open type
                 OPEN_SHARE_DENYREADWRITE |
+                OPEN_FLAGS_SEQUENTIAL |
                 OPEN_ACCESS_WRITEONLY, // Open mode
                 NULL);
   if (rc)
   {
-    DosClose(hDst);
     DosClose(hSrc);
-    DosFreeMem(pIOBuf);
     return rc;
   }
 
+  rc = DosQueryFileInfo(hSrc, FIL_STANDARDL, &fsSrc, sizeof(fsSrc));
+  if (rc)
+    goto COPYFILE_EXIT;
 
   // If append mode move file pointer to the end
   // We can be here only if not DCY_EXISTING flag
@@ -142,48 +447,71 @@ APIRET CopyFile(PSZ pszSrc, PSZ pszDst, ULONG ulOptions)
   // with OPEN_ACCESS_OPEN_IF_EXISTS) otherwise
   if (ulOptions&DCPY_APPEND)
   {
+    if (!DosQueryFileInfo(hDst, FIL_STANDARDL, &fsDst, sizeof(fsDst)))
+      cbBase = LL2ULL(fsDst.cbFile);
+
     DosSetFilePtrL (hDst,
                     llZero,
                     FILE_END,
                     NULL);
   }
-
-  rc = DosRead(hSrc, pIOBuf, IOBUF_SIZ, &ulTransfer);
-  if (rc)
+  else
   {
-    DosClose(hDst);
-    DosClose(hSrc);
-    DosFreeMem(pIOBuf);
-    return rc;
+    // let the file system copy it without moving the data through us
+    fsctl.hSrc = hSrc;
+    fsctl.cbFile = fsSrc.cbFile;
+    cbParms = sizeof(fsctl);
+    cbData = 0;
+
+    if (!DosFSCtl(NULL, 0, &cbData,
+                  &fsctl, sizeof(fsctl), &cbParms,
+                  FSCTL_COPYFILE, NULL, hDst, FSCTL_HANDLE))
+      goto COPYFILE_EAS;
   }
 
-  while(ulTransfer)
-  {
-    rc = DosWrite(hDst, pIOBuf, ulTransfer, &ulWritten);
-    if (rc)
-    {
-      DosClose(hDst);
-      DosClose(hSrc);
-      DosFreeMem(pIOBuf);
-      return rc;
-    }
+  // allocate the whole target up front: one extent, no growth per write
+  ULL2LL(cbBase + LL2ULL(fsSrc.cbFile), &llSize);
+  if (LL2ULL(fsSrc.cbFile))
+    DosSetFileSizeL(hDst, llSize);
 
-    if (ulTransfer!=ulWritten) return ERROR_WRITE_FAULT;
+  cbBuf = CopyBufSize(pszSrc, pszDst);
 
-    rc = DosRead(hSrc, pIOBuf, IOBUF_SIZ, &ulTransfer);
-    if (rc)
-    {
-      DosClose(hDst);
-      DosClose(hSrc);
-      DosFreeMem(pIOBuf);
-      return rc;
-    }
+  rc = DosAllocMem((void **)&pIOBuf,
+                   cbBuf * 2,
+                   fPERM|PAG_COMMIT);
+  if (rc)
+    goto COPYFILE_EXIT;
+
+  rc = ERROR_INVALID_FUNCTION;
+
+  if (LL2ULL(fsSrc.cbFile) > cbBuf)
+    rc = CopyOverlapped(hSrc, hDst, pIOBuf, cbBuf, &cbCopied);
+
+  if (rc == ERROR_INVALID_FUNCTION)
+    rc = CopySerial(hSrc, hDst, pIOBuf, cbBuf, &cbCopied);
+
+  if (rc)
+    goto COPYFILE_EXIT;
+
+  // the source changed size under us: cut back what was preallocated
+  if (cbCopied != LL2ULL(fsSrc.cbFile))
+  {
+    ULL2LL(cbBase + cbCopied, &llSize);
+    DosSetFileSizeL(hDst, llSize);
   }
 
+COPYFILE_EAS:
+  if (!(ulOptions&DCPY_APPEND))
+    rc = CopyEAs(hSrc, hDst, ulOptions);
+
+COPYFILE_EXIT:
   DosClose(hDst);
   DosClose(hSrc);
-  DosFreeMem(pIOBuf);
-  return NO_ERROR;
+
+  if (pIOBuf)
+    DosFreeMem(pIOBuf);
+
+  return rc;
 }
 
 /*#
@@ -510,6 +838,12 @@ APIRET APIENTRY  DosMove(PCSZ  pszOld,
       rc = DosDelete(pszOld);
     }
   }
+  else
+  {
+    // renamed in place
+    rc = NO_ERROR;
+    PvtPathCacheInvalidate();
+  }
 
 DOSMOVE_EXIT:
   log("%s exit => %lx\n", __FUNCTION__, rc);
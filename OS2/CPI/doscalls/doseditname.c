@@ -19,6 +19,7 @@
 
 #include <string.h>
 
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 #if 0
@@ -1,6 +1,7 @@
 //#define  INCL_DOSPROCESS
 //#include <os2.h>
 
+#define TRACE_SUBSYS TRC_PROC
 #include "kal.h"
 
 APIRET APIENTRY DosExecPgm(PCHAR pObjname,
@@ -1,3 +1,4 @@
+#define TRACE_SUBSYS TRC_PROC
 #include "kal.h"
 
 VOID APIENTRY DosExit(const ULONG action, const ULONG result)
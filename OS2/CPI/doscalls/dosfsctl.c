@@ -11,6 +11,7 @@
 
 
 */
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 APIRET APIENTRY  DosFSCtl(PVOID pData,
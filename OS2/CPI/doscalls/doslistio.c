@@ -1,16 +1,502 @@
+/*
+ *  DosListIO / DosListIOL
+ *
+ *  The list is planned before anything is transferred: every entry's
+ *  seek is resolved to an absolute offset, in list order, then the
+ *  entries are sorted by file and offset (LISTIO_UNORDERED only) and
+ *  runs of adjacent reads or writes on one file are coalesced into a
+ *  single transfer.  A run whose buffers are contiguous in memory
+ *  goes straight to KalRead/KalWrite; otherwise it is gathered to, or
+ *  scattered from, one bounce buffer.
+ *
+ *  LISTIO_NOWAIT (osFree extension) queues the list to a small pool
+ *  of completion threads and returns at once.  Every RetCode reads
+ *  LISTIO_PENDING until its entry is done; if the first entry's
+ *  Reserved field holds an event semaphore, it is posted once the
+ *  whole list has completed.  The caller's list must stay valid
+ *  until then.
+ */
+
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
+#include <string.h>
+
+#ifndef LISTIO_ORDERED
+#define LISTIO_ORDERED    0x0001
+#define LISTIO_UNORDERED  0x0002
+#define LISTIO_READ       0x0004
+#define LISTIO_WRITE      0x0008
+#endif
+
+#ifndef LISTIO_NOWAIT
+#define LISTIO_NOWAIT     0x8000
+#endif
+
+#define LISTIO_PENDING    0xFFFFFFFF
+
+#define LISTIO_SEEK_MASK  0x0003
+
+// largest coalesced transfer
+#define LISTIO_MAX_RUN    (256 * 1024)
+
+// completion threads
+#define LISTIO_THREADS    4
+
+typedef unsigned long long ULL;
+
+#define LL2ULL(ll)        (((ULL)(ll).ulHi << 32) | (ll).ulLo)
+
+static void ULL2LL(ULL v, LONGLONG *ll)
+{
+  ll->ulLo = (ULONG)v;
+  ll->ulHi = (ULONG)(v >> 32);
+}
+
+/*
+ *  Planned entry
+ */
+typedef struct _LIOENT
+{
+  PLISTIOL p;
+  ULONG    idx;              // position in the caller's list
+  ULL      off;              // absolute offset
+} LIOENT;
+
+/*
+ *  Queued LISTIO_NOWAIT list
+ */
+typedef struct _LIOJOB
+{
+  struct _LIOJOB *next;
+  ULONG    ulCmdMode;
+  ULONG    cEntries;
+  PLISTIOL pList;
+  PLISTIO  pBack;            // DosListIO: copy results here, then free pList
+  HEV      hevDone;
+} LIOJOB;
+
+// queue and threads belong to this process, not the shared DATA segment
+#pragma data_seg("PRIV_DATA", "PRIVDATA")
+static volatile HMTX hmtxQueue = 0;
+static volatile HEV  hevQueue = 0;
+static LIOJOB *pQueueHead = 0;
+static LIOJOB *pQueueTail = 0;
+static ULONG   cThreads = 0;
+#pragma data_seg()
+
+ULONG LioCmpXchg(volatile ULONG *p, ULONG ulOld, ULONG ulNew);
+#pragma aux LioCmpXchg = \
+  "lock cmpxchg [edx], ecx" \
+  parm [edx] [eax] [ecx] \
+  value [eax] \
+  modify exact [eax];
+
+/*
+ *  Resolve FILE_CURRENT / FILE_END to absolute offsets, as if the
+ *  entries ran one after another in list order
+ */
+static APIRET ListIOResolve(LIOENT *e, PLISTIOL pList, ULONG n)
+{
+  LONGLONG zero, pos;
+  ULL cur, end;
+  APIRET rc;
+  ULONG i, j;
+
+  zero.ulLo = 0;
+  zero.ulHi = 0;
+
+  for (i = 0; i < n; i++)
+  {
+    PLISTIOL p = &pList[i];
+    ULL base;
+
+    if (!(p->CmdFlag & (LISTIO_READ | LISTIO_WRITE)) ||
+        (p->CmdFlag & (LISTIO_READ | LISTIO_WRITE)) == (LISTIO_READ | LISTIO_WRITE))
+      return ERROR_INVALID_PARAMETER;
+
+    e[i].p = p;
+    e[i].idx = i;
+
+    switch (p->CmdFlag & LISTIO_SEEK_MASK)
+    {
+      case FILE_BEGIN:
+        base = 0;
+        break;
+
+      case FILE_CURRENT:
+      case FILE_END:
+        // where the last entry on this file left the pointer
+        for (j = i; j > 0 && pList[j - 1].hFile != p->hFile; j--)
+          ;
+        if (j > 0)
+          cur = e[j - 1].off + pList[j - 1].NumBytes;
+        else
+        {
+          if ((rc = DosSetFilePtrL(p->hFile, zero, FILE_CURRENT, &pos)))
+            return rc;
+          cur = LL2ULL(pos);
+        }
+
+        if ((p->CmdFlag & LISTIO_SEEK_MASK) == FILE_CURRENT)
+        {
+          base = cur;
+          break;
+        }
+
+        if ((rc = DosSetFilePtrL(p->hFile, zero, FILE_END, &pos)))
+          return rc;
+        end = LL2ULL(pos);
+
+        // earlier writes in the list may extend the file
+        for (j = 0; j < i; j++)
+        {
+          if (pList[j].hFile == p->hFile && (pList[j].CmdFlag & LISTIO_WRITE) &&
+              e[j].off + pList[j].NumBytes > end)
+            end = e[j].off + pList[j].NumBytes;
+        }
+        base = end;
+        break;
+
+      default:
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    e[i].off = base + (long long)LL2ULL(p->Offset);
+  }
+
+  return NO_ERROR;
+}
+
+static int ListIOCompare(LIOENT *a, LIOENT *b)
+{
+  if (a->p->hFile != b->p->hFile)
+    return a->p->hFile < b->p->hFile ? -1 : 1;
+  if (a->off != b->off)
+    return a->off < b->off ? -1 : 1;
+  return a->idx < b->idx ? -1 : (a->idx > b->idx);
+}
+
+/*
+ *  Shell sort - lists are at most a few thousand entries
+ */
+static void ListIOSort(LIOENT *e, ULONG n)
+{
+  ULONG gap, i, j;
+  LIOENT t;
+
+  for (gap = n / 2; gap > 0; gap /= 2)
+  {
+    for (i = gap; i < n; i++)
+    {
+      t = e[i];
+      for (j = i; j >= gap && ListIOCompare(&e[j - gap], &t) > 0; j -= gap)
+        e[j] = e[j - gap];
+      e[j] = t;
+    }
+  }
+}
+
+/*
+ *  Transfer e[0..cnt-1], which are adjacent on one file and of one
+ *  direction, with a single read or write
+ */
+static void ListIORun(LIOENT *e, ULONG cnt, ULL total, PBYTE pBounce)
+{
+  HFILE hf = e[0].p->hFile;
+  BOOL write = (e[0].p->CmdFlag & LISTIO_WRITE) != 0;
+  BOOL direct = TRUE;
+  LONGLONG pos, actualpos;
+  PBYTE buf, q;
+  ULONG done = 0, i, n;
+  APIRET rc;
+
+  for (i = 1; i < cnt; i++)
+  {
+    if ((PBYTE)e[i].p->pBuffer !=
+        (PBYTE)e[i - 1].p->pBuffer + e[i - 1].p->NumBytes)
+      direct = FALSE;
+  }
+
+  buf = direct ? (PBYTE)e[0].p->pBuffer : pBounce;
+
+  if (!direct && write)
+  {
+    for (i = 0, q = buf; i < cnt; q += e[i].p->NumBytes, i++)
+      memcpy(q, e[i].p->pBuffer, e[i].p->NumBytes);
+  }
+
+  ULL2LL(e[0].off, &pos);
+  rc = DosSetFilePtrL(hf, pos, FILE_BEGIN, &actualpos);
+
+  if (!rc)
+  {
+    if (write)
+      rc = KalWrite(hf, buf, (ULONG)total, &done);
+    else
+      rc = KalRead(hf, buf, (ULONG)total, &done);
+  }
+
+  // hand each entry its share of what was transferred
+  for (i = 0, q = buf; i < cnt; q += e[i].p->NumBytes, i++)
+  {
+    n = done > e[i].p->NumBytes ? e[i].p->NumBytes : done;
+    done -= n;
+
+    if (!direct && !write && n)
+      memcpy(e[i].p->pBuffer, q, n);
+
+    ULL2LL(e[i].off, &e[i].p->Offset);
+    e[i].p->Actual = n;
+    e[i].p->RetCode = rc;
+  }
+}
+
+/*
+ *  Plan and run a whole list synchronously
+ */
+static APIRET ListIOProcess(ULONG ulCmdMode, ULONG n, PLISTIOL pList)
+{
+  LIOENT *e;
+  PBYTE pBounce = 0;
+  ULL run;
+  ULONG i, j;
+  APIRET rc;
+
+  if ((rc = DosAllocMem((void **)&e, n * sizeof(LIOENT),
+                        PAG_COMMIT | PAG_READ | PAG_WRITE)))
+    return rc;
+
+  if ((rc = ListIOResolve(e, pList, n)))
+    goto LISTIOPROCESS_EXIT;
 
-APIRET unimplemented(char *func);
+  if ((ulCmdMode & ~LISTIO_NOWAIT) == LISTIO_UNORDERED)
+    ListIOSort(e, n);
+
+  for (i = 0; i < n; i = j)
+  {
+    // grow the run while the next entry continues it
+    run = e[i].p->NumBytes;
+    for (j = i + 1; j < n; j++)
+    {
+      if (e[j].p->hFile != e[i].p->hFile ||
+          (e[j].p->CmdFlag & (LISTIO_READ | LISTIO_WRITE)) !=
+          (e[i].p->CmdFlag & (LISTIO_READ | LISTIO_WRITE)) ||
+          e[j].off != e[j - 1].off + e[j - 1].p->NumBytes ||
+          run + e[j].p->NumBytes > LISTIO_MAX_RUN)
+        break;
+      run += e[j].p->NumBytes;
+    }
+
+    if (j - i > 1 && !pBounce &&
+        DosAllocMem((void **)&pBounce, LISTIO_MAX_RUN,
+                    PAG_COMMIT | PAG_READ | PAG_WRITE))
+    {
+      // no bounce buffer - one entry at a time still works
+      pBounce = 0;
+      j = i + 1;
+      run = e[i].p->NumBytes;
+    }
+
+    ListIORun(&e[i], j - i, run, pBounce);
+  }
+
+  // file pointers end up where list order would leave them
+  for (i = n; i-- > 0; )
+  {
+    LONGLONG pos, actual;
+
+    for (j = i + 1; j < n && pList[j].hFile != pList[i].hFile; j++)
+      ;
+    if (j < n)
+      continue;
+
+    ULL2LL(LL2ULL(pList[i].Offset) + pList[i].Actual, &pos);
+    DosSetFilePtrL(pList[i].hFile, pos, FILE_BEGIN, &actual);
+  }
+
+  // report the first failure in list order
+  for (i = 0; i < n; i++)
+  {
+    if (pList[i].RetCode)
+    {
+      rc = pList[i].RetCode;
+      break;
+    }
+  }
+
+LISTIOPROCESS_EXIT:
+  if (pBounce)
+    DosFreeMem(pBounce);
+  DosFreeMem(e);
+  return rc;
+}
+
+static void ListIOComplete(LIOJOB *job)
+{
+  PLISTIOL p;
+  PLISTIO q;
+  ULONG i;
+
+  if (job->pBack)
+  {
+    for (i = 0, p = job->pList, q = job->pBack; i < job->cEntries; i++, p++, q++)
+    {
+      q->Offset  = p->Offset.ulLo;
+      q->Actual  = p->Actual;
+      q->RetCode = p->RetCode;
+    }
+    DosFreeMem(job->pList);
+  }
+
+  if (job->hevDone)
+    DosPostEventSem(job->hevDone);
+
+  DosFreeMem(job);
+}
+
+/*
+ *  Completion thread - takes one list at a time off the queue
+ */
+static VOID APIENTRY ListIOThread(ULONG ul)
+{
+  LIOJOB *job;
+  ULONG cPosts;
+
+  for (;;)
+  {
+    DosWaitEventSem(hevQueue, SEM_INDEFINITE_WAIT);
+
+    DosRequestMutexSem(hmtxQueue, SEM_INDEFINITE_WAIT);
+    job = pQueueHead;
+    if (job)
+    {
+      pQueueHead = job->next;
+      if (!pQueueHead)
+        pQueueTail = 0;
+    }
+    if (!pQueueHead)
+      DosResetEventSem(hevQueue, &cPosts);
+    DosReleaseMutexSem(hmtxQueue);
+
+    if (!job)
+      continue;
+
+    ListIOProcess(job->ulCmdMode, job->cEntries, job->pList);
+    ListIOComplete(job);
+  }
+}
+
+/*
+ *  Queue a list for the completion threads, starting them on first use
+ */
+static APIRET ListIOSubmit(ULONG ulCmdMode, ULONG n, PLISTIOL pList,
+                           PLISTIO pBack, HEV hevDone)
+{
+  LIOJOB *job;
+  HMTX hmtx;
+  HEV hev;
+  TID tid;
+  APIRET rc;
+  ULONG i;
+
+  // first use: racing threads each create the semaphores, one set
+  // is installed and the rest closed; the event goes in first, so
+  // it is there whenever the mutex is
+  if (!hmtxQueue)
+  {
+    if (!hevQueue)
+    {
+      if ((rc = DosCreateEventSem(NULL, &hev, 0, FALSE)))
+        return rc;
+      if (LioCmpXchg((volatile ULONG *)&hevQueue, 0, hev))
+        DosCloseEventSem(hev);
+    }
+
+    if ((rc = DosCreateMutexSem(NULL, &hmtx, 0, FALSE)))
+      return rc;
+    if (LioCmpXchg((volatile ULONG *)&hmtxQueue, 0, hmtx))
+      DosCloseMutexSem(hmtx);
+  }
+
+  if ((rc = DosAllocMem((void **)&job, sizeof(LIOJOB),
+                        PAG_COMMIT | PAG_READ | PAG_WRITE)))
+    return rc;
+
+  job->next      = 0;
+  job->ulCmdMode = ulCmdMode;
+  job->cEntries  = n;
+  job->pList     = pList;
+  job->pBack     = pBack;
+  job->hevDone   = hevDone;
+
+  for (i = 0; i < n; i++)
+    pList[i].RetCode = LISTIO_PENDING;
+
+  DosRequestMutexSem(hmtxQueue, SEM_INDEFINITE_WAIT);
+
+  while (cThreads < LISTIO_THREADS &&
+         !DosCreateThread(&tid, ListIOThread, 0, 0, 16384))
+    cThreads++;
+
+  if (!cThreads)
+  {
+    DosReleaseMutexSem(hmtxQueue);
+    DosFreeMem(job);
+    return ERROR_TOO_MANY_THREADS;
+  }
+
+  if (pQueueTail)
+    pQueueTail->next = job;
+  else
+    pQueueHead = job;
+  pQueueTail = job;
+
+  DosPostEventSem(hevQueue);
+  DosReleaseMutexSem(hmtxQueue);
+
+  return NO_ERROR;
+}
+
+static APIRET ListIOCheckMode(ULONG ulCmdMode, ULONG ulNumentries, PVOID pList)
+{
+  ULONG mode = ulCmdMode & ~LISTIO_NOWAIT;
+
+  if (mode != LISTIO_ORDERED && mode != LISTIO_UNORDERED)
+    return ERROR_INVALID_PARAMETER;
+  if (!ulNumentries || !pList)
+    return ERROR_INVALID_PARAMETER;
+  return NO_ERROR;
+}
 
 APIRET APIENTRY  DosListIOL(LONG  ulCmdMode,
                             LONG  ulNumentries,
                             PVOID pListIOL)
 {
+  PLISTIOL pList = (PLISTIOL)pListIOL;
   APIRET rc;
+
   log("%s enter\n", __FUNCTION__);
   log("ulCmdMode=%lx\n", ulCmdMode);
   log("ulNumentries=%lx\n", ulNumentries);
-  rc = unimplemented(__FUNCTION__);
+
+  if ((rc = ListIOCheckMode(ulCmdMode, ulNumentries, pList)))
+    goto DOSLISTIOL_EXIT;
+
+  if (ulCmdMode & LISTIO_NOWAIT)
+  {
+    rc = ListIOSubmit(ulCmdMode, ulNumentries, pList, NULL,
+                      (HEV)pList->Reserved);
+    // no completion threads - do it now rather than fail
+    if (rc != ERROR_TOO_MANY_THREADS)
+      goto DOSLISTIOL_EXIT;
+  }
+
+  rc = ListIOProcess(ulCmdMode, ulNumentries, pList);
+
+  if ((ulCmdMode & LISTIO_NOWAIT) && pList->Reserved)
+    DosPostEventSem((HEV)pList->Reserved);
+
+DOSLISTIOL_EXIT:
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -26,6 +512,10 @@ APIRET  APIENTRY        DosListIO(ULONG ulCmdMode,
   int i;
 
   log("%s enter\n", __FUNCTION__);
+
+  if ((rc = ListIOCheckMode(ulCmdMode, ulNumentries, pListIO)))
+    goto DOSLISTIO_EXIT;
+
   rc2 = DosAllocMem((void **)&pListIOL, ulNumentries * sizeof(LISTIOL),
                    PAG_COMMIT | PAG_READ | PAG_WRITE);
 
@@ -39,23 +529,42 @@ APIRET  APIENTRY        DosListIO(ULONG ulCmdMode,
   {
     p->hFile         = q->hFile;
     p->CmdFlag       = q->CmdFlag;
+    // sign-extend, FILE_CURRENT/FILE_END offsets may be negative
     p->Offset.ulLo   = q->Offset;
-    p->Offset.ulHi   = 0;
+    p->Offset.ulHi   = q->Offset < 0 ? 0xFFFFFFFF : 0;
     p->pBuffer       = q->pBuffer;
     p->NumBytes      = q->NumBytes;
+    p->Reserved      = q->Reserved;
   }
 
-  rc = DosListIOL(ulCmdMode,
-                  ulNumentries,
-                  pListIOL);
+  if (ulCmdMode & LISTIO_NOWAIT)
+  {
+    // results are copied back, and pListIOL freed, on completion
+    for (i = 0, q = pListIO; i < ulNumentries; i++, q++)
+      q->RetCode = LISTIO_PENDING;
+
+    rc = ListIOSubmit(ulCmdMode, ulNumentries, pListIOL, pListIO,
+                      (HEV)pListIO->Reserved);
+    if (rc != ERROR_TOO_MANY_THREADS)
+    {
+      if (rc)
+        DosFreeMem(pListIOL);
+      goto DOSLISTIO_EXIT;
+    }
+  }
+
+  rc = ListIOProcess(ulCmdMode, ulNumentries, pListIOL);
 
   for (i = 0, p = pListIOL, q = pListIO; i < ulNumentries; i++, p++, q++)
   {
     q->Offset  = p->Offset.ulLo;
-    q->pBuffer = p->pBuffer;
     q->Actual  = p->Actual;
+    q->RetCode = p->RetCode;
   }
 
+  if ((ulCmdMode & LISTIO_NOWAIT) && pListIO->Reserved)
+    DosPostEventSem((HEV)pListIO->Reserved);
+
   rc2 = DosFreeMem(pListIOL);
 
   if (rc2)
@@ -1,3 +1,4 @@
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 
@@ -27,6 +28,8 @@ APIRET APIENTRY  DosOpenL(PCSZ     pszFileName,
                 peaop2);
   log("hf=%lx\n", *pHf);
   log("ulAction=%lx\n", *pulAction);
+  if (!rc && *pulAction == FILE_CREATED)
+    PvtPathCacheInvalidate();
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -0,0 +1,142 @@
+#include "kal.h"
+
+/*
+ * Counter pages the kernel keeps per CPU and per node.
+ * Layout is osfree-fork/include/os3/perf_page.h.
+ */
+#define PERF_PAGE_NAME    "\\SHAREMEM\\OS3PERF"
+#define PERF_PAGE_MAGIC   0x46524550
+
+#define CMD_PERF_INFO     0x41
+#define CMD_KI_ENABLE     0x60
+#define CMD_KI_DISABLE    0x61
+#define CMD_KI_RDCNT      0x63
+
+typedef struct _CPUUTIL
+{
+  ULONG ulTimeLow;
+  ULONG ulTimeHigh;
+  ULONG ulIdleLow;
+  ULONG ulIdleHigh;
+  ULONG ulBusyLow;
+  ULONG ulBusyHigh;
+  ULONG ulIntrLow;
+  ULONG ulIntrHigh;
+} CPUUTIL, *PCPUUTIL;
+
+typedef struct _PERFHEADER
+{
+  ULONG magic;
+  ULONG version;
+  ULONG record_size;
+  ULONG cpu_offset;             // from the header, in bytes
+  ULONG cpu_count;
+  ULONG node_offset;
+  ULONG node_count;
+  ULONG node_orders;
+} PERFHEADER;
+
+// 64-bit counters as low, high
+typedef struct _PERFCPU
+{
+  volatile ULONG seq;           // odd while the CPU updates it
+  ULONG cpu;
+  ULONG node;
+  ULONG online;
+  ULONG timeLow, timeHigh;      // ns
+  ULONG busyLow, busyHigh;
+  ULONG idleLow, idleHigh;
+  ULONG irqsLow, irqsHigh;
+  ULONG ipisSentLow, ipisSentHigh;
+  ULONG ipisRecvLow, ipisRecvHigh;
+  ULONG switchesLow, switchesHigh;
+  ULONG wakeupsLow, wakeupsHigh;
+  ULONG stealsLow, stealsHigh;
+  ULONG loadLow, loadHigh;
+  ULONG nr_running;
+  ULONG idle;
+} PERFCPU;
+
+static PERFHEADER *pPerf = 0;
+static BOOL fPerfChecked = FALSE;
+
+static PERFHEADER *QueryPerfPage(void)
+{
+  if (!fPerfChecked)
+  {
+    PVOID pb;
+
+    if (!KalGetNamedSharedMem(&pb, PERF_PAGE_NAME, PAG_READ) &&
+        ((PERFHEADER *)pb)->magic == PERF_PAGE_MAGIC)
+      pPerf = (PERFHEADER *)pb;
+    fPerfChecked = TRUE;
+  }
+
+  return pPerf;
+}
+
+/*
+ * One CPUUTIL per CPU, copied consistently from that CPU's record.
+ * The kernel does not split out interrupt time, so that stays 0.
+ */
+static void ReadCPUUtils(PERFHEADER *pHdr, PCPUUTIL pcu)
+{
+  ULONG seq, i;
+
+  for (i = 0; i < pHdr->cpu_count; i++, pcu++)
+  {
+    PERFCPU *pCpu = (PERFCPU *)((PBYTE)pHdr + pHdr->cpu_offset +
+                                i * pHdr->record_size);
+
+    // retry if the CPU was updating, or did so under us
+    do
+    {
+      seq = pCpu->seq;
+      pcu->ulTimeLow  = pCpu->timeLow;
+      pcu->ulTimeHigh = pCpu->timeHigh;
+      pcu->ulIdleLow  = pCpu->idleLow;
+      pcu->ulIdleHigh = pCpu->idleHigh;
+      pcu->ulBusyLow  = pCpu->busyLow;
+      pcu->ulBusyHigh = pCpu->busyHigh;
+    } while ((seq & 1) || seq != pCpu->seq);
+
+    pcu->ulIntrLow  = 0;
+    pcu->ulIntrHigh = 0;
+  }
+}
+
+/*
+ * The CPU utilization subset monitors use: CMD_KI_ENABLE and
+ * CMD_KI_DISABLE (counters are always on), CMD_PERF_INFO for the
+ * CPU count and CMD_KI_RDCNT for the counters.  None of them enter
+ * the kernel.
+ */
+APIRET APIENTRY DosPerfSysCall(ULONG ulCommand, ULONG ulParm1,
+                               ULONG ulParm2, ULONG ulParm3)
+{
+  PERFHEADER *pHdr = QueryPerfPage();
+
+  if (!pHdr)
+    return ERROR_INVALID_FUNCTION;
+
+  switch (ulCommand)
+  {
+    case CMD_KI_ENABLE:
+    case CMD_KI_DISABLE:
+      return NO_ERROR;
+
+    case CMD_PERF_INFO:
+      if (!ulParm2)
+        return ERROR_INVALID_PARAMETER;
+      *(PULONG)ulParm2 = pHdr->cpu_count;
+      return NO_ERROR;
+
+    case CMD_KI_RDCNT:
+      if (!ulParm1)
+        return ERROR_INVALID_PARAMETER;
+      ReadCPUUtils(pHdr, (PCPUUTIL)ulParm1);
+      return NO_ERROR;
+  }
+
+  return ERROR_INVALID_FUNCTION;
+}
@@ -1,3 +1,4 @@
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 APIRET APIENTRY  DosProtectSetFilePtr(HFILE hFile,
@@ -22,6 +22,83 @@ the following restrictions:
 ---------------------------------------------------*/	
 #include "kal.h"
 
+/*
+ * Read-only page the kernel keeps the polled QSV values in.
+ * Layout is osfree-fork/include/os3/sysinfo_page.h.
+ */
+#define SYSINFO_PAGE_NAME   "\\SHAREMEM\\OS3SYSINF"
+#define SYSINFO_PAGE_MAGIC  0x464E4953
+
+typedef struct _SYSINFOPAGE
+{
+  ULONG magic;
+  ULONG version;
+  volatile ULONG seq;           // odd while the kernel updates it
+  volatile ULONG ms_count;
+  volatile ULONG time_low;
+  volatile ULONG time_high;
+  volatile ULONG boot_drive;
+  volatile ULONG num_processors;
+} SYSINFOPAGE;
+
+static SYSINFOPAGE *pSysInfo = 0;
+static BOOL fSysInfoChecked = FALSE;
+
+/*
+ * Serve iStart..iLast straight from the page, without a kernel call.
+ * Returns FALSE if the page is missing or does not hold them all.
+ */
+static BOOL QuerySysInfoPage(ULONG iStart, ULONG iLast, ULONG *pul)
+{
+  ULONG seq, i;
+
+  if (!fSysInfoChecked)
+  {
+    PVOID pb;
+
+    if (!KalGetNamedSharedMem(&pb, SYSINFO_PAGE_NAME, PAG_READ) &&
+        ((SYSINFOPAGE *)pb)->magic == SYSINFO_PAGE_MAGIC)
+      pSysInfo = (SYSINFOPAGE *)pb;
+    fSysInfoChecked = TRUE;
+  }
+
+  if (!pSysInfo)
+    return FALSE;
+
+  for (i = iStart; i <= iLast; i++)
+  {
+    if (i != QSV_BOOT_DRIVE && i != 26 &&  // 26 = QSV_NUMPROCESSORS
+        (i < QSV_MS_COUNT || i > QSV_TIME_HIGH))
+      return FALSE;
+  }
+
+  // retry if the kernel was updating, or did so under us
+  do
+  {
+    seq = pSysInfo->seq;
+    for (i = iStart; i <= iLast; i++)
+    {
+      switch (i)
+      {
+        case QSV_BOOT_DRIVE: pul[i - iStart] = pSysInfo->boot_drive;     break;
+        case QSV_MS_COUNT:   pul[i - iStart] = pSysInfo->ms_count;       break;
+        case QSV_TIME_LOW:   pul[i - iStart] = pSysInfo->time_low;       break;
+        case QSV_TIME_HIGH:  pul[i - iStart] = pSysInfo->time_high;      break;
+        case 26:             pul[i - iStart] = pSysInfo->num_processors; break;
+      }
+    }
+  } while ((seq & 1) || seq != pSysInfo->seq);
+
+  return TRUE;
+}
+
+ULONG PvtQueryMsCount(void)
+{
+  ULONG ms;
+
+  return QuerySysInfoPage(QSV_MS_COUNT, QSV_MS_COUNT, &ms) ? ms : 0;
+}
+
 APIRET APIENTRY
 DosQuerySysInfo(ULONG iStart, ULONG iLast,
                 PVOID pBuf, ULONG cbBuf)
@@ -30,6 +107,12 @@ DosQuerySysInfo(ULONG iStart, ULONG iLast,
   ULONG *pul;
   ULONG i;
 
+  // fast path for the counters apps poll in loops - no logging either
+  if (pBuf && iStart <= iLast && iLast <= 26 &&
+      cbBuf >= (iLast - iStart + 1) * sizeof(ULONG) &&
+      QuerySysInfoPage(iStart, iLast, (ULONG *)pBuf))
+    return NO_ERROR;
+
   log("%s enter\n", __FUNCTION__);
   log("iStart=%lu\n", iStart);
   log("iLast=%lu\n", iLast);
@@ -51,7 +134,7 @@ DosQuerySysInfo(ULONG iStart, ULONG iLast,
     goto DOSQUERYSYSINFO_EXIT;
   }
 
-  if((iLast-iStart+1)*sizeof(ULONG) < cbBuf)
+  if(cbBuf < (iLast-iStart+1)*sizeof(ULONG))
   {
     rc = 111; //buffer overflow
     goto DOSQUERYSYSINFO_EXIT;
@@ -2,6 +2,7 @@
  *   by valerius, 2010, Jun 18
  */
 
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 
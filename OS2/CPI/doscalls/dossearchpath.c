@@ -17,17 +17,207 @@
     Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <io.h>
 #include <stdio.h>
+#include <ctype.h>
 
 #include "token.h"
 #include "strnlen.h"
 #include "strlcpy.h"
 
+// lookups remembered per process
+#define PATHCACHE_SIZE    64
+
+// distinct search path values (PATH, DPATH, LIBPATH...) they refer to
+#define PATHCACHE_PATHS   8
+
+typedef struct
+{
+  ULONG ulHash;                // 0 - free slot
+  ULONG ulGeneration;          // ulPathGeneration when looked up
+  ULONG flag;
+  ULONG iPath;                 // index into apszPath
+  char  szName[CCHMAXPATH];
+  char  szResult[CCHMAXPATH];
+} PATHCACHE;
+
+// the cache belongs to this process, not the shared DATA segment
+#pragma data_seg("PRIV_DATA", "PRIVDATA")
+static PATHCACHE     aPathCache[PATHCACHE_SIZE] = { 0 };
+static char          *apszPath[PATHCACHE_PATHS] = { 0 };
+static volatile HMTX hmtxPathCache = 0;
+static ULONG         ulPathGeneration = 1;
+#pragma data_seg()
+
+ULONG PathCmpXchg(volatile ULONG *p, ULONG ulOld, ULONG ulNew);
+#pragma aux PathCmpXchg = \
+  "lock cmpxchg [edx], ecx" \
+  parm [edx] [eax] [ecx] \
+  value [eax] \
+  modify exact [eax];
+
+/*!
+  @brief  Forgets all cached lookups.  Called by everything in this
+          process that creates, removes or renames files, or changes
+          the current directory
+*/
+void PvtPathCacheInvalidate(void)
+{
+  ulPathGeneration++;
+}
+
+static ULONG PathCacheHash(ULONG flag, ULONG iPath, PCSZ pszName)
+{
+  ULONG h = 2166136261U ^ flag ^ (iPath << 8);
+
+  // file names are case insensitive
+  while (*pszName)
+    h = (h ^ (ULONG)toupper(*pszName++)) * 16777619U;
+
+  return h ? h : 1;
+}
+
+/*
+  The cache mutex, created on first use.  Of threads racing to
+  create it, one installs its own and the others close theirs.
+*/
+static BOOL PathCacheLock(void)
+{
+  HMTX hmtx;
+
+  if (!hmtxPathCache && !DosCreateMutexSem(NULL, &hmtx, 0, FALSE) &&
+      PathCmpXchg((volatile ULONG *)&hmtxPathCache, 0, hmtx))
+    DosCloseMutexSem(hmtx);
+
+  return hmtxPathCache &&
+         !DosRequestMutexSem(hmtxPathCache, SEM_INDEFINITE_WAIT);
+}
+
+/*
+  Index of the path value in apszPath, adding it if asked to.
+  A full table is emptied, along with the lookups made on it.
+*/
+static int PathCachePath(PCSZ pszPath, BOOL fAdd)
+{
+  ULONG cb = strlen(pszPath) + 1;
+  int   i;
+
+  for (i = 0; i < PATHCACHE_PATHS && apszPath[i]; i++)
+  {
+    if (!strcmp(apszPath[i], pszPath))
+      return i;
+  }
+
+  if (!fAdd)
+    return -1;
+
+  if (i == PATHCACHE_PATHS)
+  {
+    for (i = 0; i < PATHCACHE_PATHS; i++)
+    {
+      DosFreeMem(apszPath[i]);
+      apszPath[i] = NULL;
+    }
+
+    memset(aPathCache, 0, sizeof(aPathCache));
+    i = 0;
+  }
+
+  if (DosAllocMem((void **)&apszPath[i], cb,
+                  PAG_READ | PAG_WRITE | PAG_COMMIT))
+  {
+    apszPath[i] = NULL;
+    return -1;
+  }
+
+  memcpy(apszPath[i], pszPath, cb);
+  return i;
+}
+
+/*
+  Looks a file up in the cache.  If it is known, returns TRUE and
+  the DosSearchPath result in *prc.
+*/
+static BOOL PathCacheLookup(ULONG flag, PCSZ pszPath, PCSZ pszName,
+                            PBYTE pBuf, ULONG cbBuf, APIRET *prc)
+{
+  PATHCACHE   *pc;
+  FILESTATUS3 fs;
+  char  szResult[CCHMAXPATH];
+  ULONG h;
+  int   iPath;
+
+  if (!PathCacheLock())
+    return FALSE;
+
+  szResult[0] = '\0';
+
+  if ((iPath = PathCachePath(pszPath, FALSE)) >= 0)
+  {
+    h  = PathCacheHash(flag, iPath, pszName);
+    pc = &aPathCache[h % PATHCACHE_SIZE];
+
+    if (pc->ulHash == h && pc->flag == flag && pc->iPath == iPath &&
+        pc->ulGeneration == ulPathGeneration &&
+        !stricmp(pc->szName, pszName))
+      strcpy(szResult, pc->szResult);
+  }
+
+  DosReleaseMutexSem(hmtxPathCache);
+
+  // another process may have deleted it since - then search again
+  if (!szResult[0] ||
+      DosQueryPathInfo(szResult, FIL_STANDARD, &fs, sizeof(fs)) ||
+      (fs.attrFile & FILE_DIRECTORY))
+    return FALSE;
+
+  if (strlcpy(pBuf, szResult, cbBuf) >= cbBuf)
+    *prc = ERROR_BUFFER_OVERFLOW;
+  else
+    *prc = NO_ERROR;
+
+  return TRUE;
+}
+
+/*
+  Remembers where a file was found
+*/
+static void PathCacheStore(ULONG flag, PCSZ pszPath, PCSZ pszName,
+                           PCSZ pszResult, ULONG ulGeneration)
+{
+  PATHCACHE *pc;
+  ULONG h;
+  int   iPath;
+
+  if (strnlen(pszName, CCHMAXPATH) == CCHMAXPATH ||
+      strnlen(pszResult, CCHMAXPATH) == CCHMAXPATH)
+    return;
+
+  if (!PathCacheLock())
+    return;
+
+  if ((iPath = PathCachePath(pszPath, TRUE)) >= 0)
+  {
+    h  = PathCacheHash(flag, iPath, pszName);
+    pc = &aPathCache[h % PATHCACHE_SIZE];
+
+    pc->ulHash       = h;
+    pc->flag         = flag;
+    pc->iPath        = iPath;
+    // something changed while we searched: born stale
+    pc->ulGeneration = ulGeneration;
+    strcpy(pc->szName, pszName);
+    strcpy(pc->szResult, pszResult);
+  }
+
+  DosReleaseMutexSem(hmtxPathCache);
+}
+
 /*!
   @brief     Searches for a file on a path. Path is explicitly specified,
              or by path name
@@ -56,6 +246,13 @@
     DosClose
     DosScanEnv
 
+  Where a file was found is cached per search path value and file
+  name until this process changes the file namespace, so repeated
+  searches of a long path cost one DosQueryPathInfo.  That check
+  catches a file another process deleted; one it created earlier
+  on the path is not seen until the entry goes.  Misses are not
+  cached, the file may turn up any time.
+
   note: StrTok* functions are not multithread-aware, probably
 */
 
@@ -76,6 +273,7 @@ APIRET APIENTRY  DosSearchPath(ULONG flag,
   ULONG  len;
   char   curdir[260];
   HFILE  hf;
+  ULONG  ulGeneration;
   APIRET rc = NO_ERROR;
 
   log("%s enter\n", __FUNCTION__);
@@ -116,7 +314,12 @@ APIRET APIENTRY  DosSearchPath(ULONG flag,
   // search for path on the environment
   if (flag & SEARCH_ENVIRONMENT)
   {
-    rc = DosScanEnv(pszPathOrName, &pathtmp);
+    if (DosScanEnv(pszPathOrName, &pathtmp))
+    {
+      rc = ERROR_ENVVAR_NOT_FOUND;
+      goto DOSSEARCHPATH_EXIT;
+    }
+
     pathlen = strlen(pathtmp) + 1;
   }
   else
@@ -127,6 +330,15 @@ APIRET APIENTRY  DosSearchPath(ULONG flag,
 
   log("pathtmp=%s\n", pathtmp);
 
+  if (PathCacheLookup(flag, pathtmp, pszFilename, pBuf, cbBuf, &rc))
+  {
+    log("cached pBuf=%s\n", pBuf);
+    goto DOSSEARCHPATH_EXIT;
+  }
+
+  // taken before the search, so a change during it is not missed
+  ulGeneration = ulPathGeneration;
+
   if (flag & SEARCH_CUR_DIRECTORY)
     pathlen += 2;
 
@@ -134,6 +346,9 @@ APIRET APIENTRY  DosSearchPath(ULONG flag,
   rc = DosAllocMem((void **)&path, pathlen,
                    PAG_READ | PAG_WRITE | PAG_COMMIT);
 
+  if (rc)
+    goto DOSSEARCHPATH_EXIT;
+
   p = path;
 
   if (flag & SEARCH_CUR_DIRECTORY)
@@ -147,7 +362,7 @@ APIRET APIENTRY  DosSearchPath(ULONG flag,
   strcpy(p, pathtmp);
   StrTokSave(&st);
 
-  DosQueryCurrentDir(0, curdir, &len);
+  len = sizeof(curdir);
   DosQueryCurrentDir(0, curdir, &len);
 
   if (p = StrTokenize(path, psep))
@@ -193,6 +408,8 @@ APIRET APIENTRY  DosSearchPath(ULONG flag,
       DosFreeMem(path);
       log("pBuf=%s\n", pBuf);
 
+      PathCacheStore(flag, pathtmp, pszFilename, pBuf, ulGeneration);
+
       rc = NO_ERROR;
       goto DOSSEARCHPATH_EXIT;
     } while (p = StrTokenize(0, psep));
@@ -202,7 +419,6 @@ APIRET APIENTRY  DosSearchPath(ULONG flag,
   DosFreeMem(path);
   *pBuf = '\0';
 
-
   rc = ERROR_FILE_NOT_FOUND;
 
 DOSSEARCHPATH_EXIT:
@@ -1,3 +1,4 @@
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 
@@ -7,6 +8,8 @@ APIRET APIENTRY  DosSetCurrentDir(PCSZ  pszDir)
   log("%s enter\n", __FUNCTION__);
   log("pszDir=%s\n", pszDir);
   rc = KalSetCurrentDir((PSZ)pszDir);
+  if (!rc)
+    PvtPathCacheInvalidate();
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -1,3 +1,4 @@
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 
@@ -7,6 +8,8 @@ APIRET APIENTRY DosSetDefaultDisk(ULONG disknum)
   log("%s enter\n", __FUNCTION__);
   log("disknum=%lu\n", disknum);
   rc = KalSetDefaultDisk(disknum);
+  if (!rc)
+    PvtPathCacheInvalidate();
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
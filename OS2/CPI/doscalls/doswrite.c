@@ -12,6 +12,7 @@
 
 */
 
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 /*
@@ -16,6 +16,151 @@ APIRET APIENTRY DosGetInfoBlocks(PTIB *pptib,
   return rc;
 }
 
+/*
+ *  Hash index over the environment block, built on the first
+ *  DosScanEnv and again whenever pib_pchenv points elsewhere.  An
+ *  inherited block is indexed the same way the first time the child
+ *  scans it.  Builds run under a sequence count; a lookup that races
+ *  one, or finds more variables than fit, scans the block instead.
+ */
+#define ENV_SLOTS   512               // power of two
+#define ENV_MAXVARS (ENV_SLOTS / 2)
+
+typedef struct _ENVSLOT
+{
+  ULONG ulHash;
+  ULONG off;                          // offset of "NAME=value" + 1, 0 empty
+} ENVSLOT;
+
+// one index per process, not in the shared DATA segment
+#pragma data_seg("PRIV_DATA", "PRIVDATA")
+static ENVSLOT aEnvIndex[ENV_SLOTS] = { 0 };
+static char * volatile pEnvIndexed = NULL;
+static volatile ULONG ulEnvSeq = 0;   // odd while building
+static BOOL fEnvOverflow = FALSE;
+static PPIB pEnvPib = NULL;
+#pragma data_seg()
+
+ULONG EnvCmpXchg(volatile ULONG *p, ULONG ulOld, ULONG ulNew);
+#pragma aux EnvCmpXchg = \
+  "lock cmpxchg [edx], ecx" \
+  parm [edx] [eax] [ecx] \
+  value [eax] \
+  modify exact [eax];
+
+#define ENV_UPPER(c) ((c) >= 'a' && (c) <= 'z' ? (c) - 'a' + 'A' : (c))
+
+// hash of the name, up to '=' or the end; *pcch gets its length
+static ULONG EnvHash(const char *p, ULONG *pcch)
+{
+  ULONG h = 2166136261UL;
+  ULONG i;
+
+  for (i = 0; p[i] && p[i] != '='; i++)
+    h = (h ^ (UCHAR)ENV_UPPER(p[i])) * 16777619UL;
+
+  *pcch = i;
+  return h;
+}
+
+// does entry p name the variable pszName, cch long?
+static BOOL EnvMatch(const char *p, PCSZ pszName, ULONG cch)
+{
+  return !strnicmp(p, pszName, cch) && (p[cch] == '=' || !p[cch]);
+}
+
+static void EnvBuildIndex(char *env)
+{
+  char  *p;
+  ULONG seq, h, cch, i, cVars = 0;
+
+  // taking the sequence count odd makes us the only builder; a
+  // thread that loses scans the block meanwhile
+  seq = ulEnvSeq;
+  if ((seq & 1) || EnvCmpXchg(&ulEnvSeq, seq, seq + 1) != seq)
+    return;
+
+  if (pEnvIndexed != env)
+  {
+    pEnvIndexed = NULL;
+    memset(aEnvIndex, 0, sizeof(aEnvIndex));
+    fEnvOverflow = FALSE;
+
+    for (p = env; *p; p += strlen(p) + 1)
+    {
+      if (++cVars > ENV_MAXVARS)
+      {
+        fEnvOverflow = TRUE;
+        break;
+      }
+
+      h = EnvHash(p, &cch);
+
+      // the first of duplicate names wins, as with a scan
+      for (i = h & (ENV_SLOTS - 1); aEnvIndex[i].off;
+           i = (i + 1) & (ENV_SLOTS - 1))
+      {
+        if (aEnvIndex[i].ulHash == h &&
+            EnvMatch(env + aEnvIndex[i].off - 1, p, cch))
+          break;
+      }
+
+      if (!aEnvIndex[i].off)
+      {
+        aEnvIndex[i].ulHash = h;
+        aEnvIndex[i].off = p - env + 1;
+      }
+    }
+
+    pEnvIndexed = env;
+  }
+
+  ulEnvSeq++;
+}
+
+/*
+ *  Look pszName up in the index; FALSE if the index cannot answer
+ */
+static BOOL EnvLookup(char *env, PCSZ pszName, char **ppEntry)
+{
+  ULONG seq, h, cch, i;
+  char  *p;
+
+  if (pEnvIndexed != env)
+    EnvBuildIndex(env);
+
+  seq = ulEnvSeq;
+  if ((seq & 1) || pEnvIndexed != env || fEnvOverflow)
+    return FALSE;
+
+  h = EnvHash(pszName, &cch);
+  *ppEntry = NULL;
+
+  for (i = h & (ENV_SLOTS - 1); aEnvIndex[i].off;
+       i = (i + 1) & (ENV_SLOTS - 1))
+  {
+    p = env + aEnvIndex[i].off - 1;
+    if (aEnvIndex[i].ulHash == h && EnvMatch(p, pszName, cch))
+    {
+      *ppEntry = p;
+      break;
+    }
+  }
+
+  // rebuilt under us
+  if (seq != ulEnvSeq)
+    return FALSE;
+
+  // the block was edited in place - reindex and let the scan answer
+  if (*ppEntry && !EnvMatch(*ppEntry, pszName, cch))
+  {
+    pEnvIndexed = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
 /*!
   @brief         Gets an environment variable by name
 
@@ -38,16 +183,33 @@ APIRET APIENTRY  DosScanEnv(PCSZ  pszName,
   PTIB tib;
   int  i;
   char *p, *q, *env;
-  APIRET rc;
+  APIRET rc = ERROR_ENVVAR_NOT_FOUND;
 
   log("%s enter\n", __FUNCTION__);
   log("pszName=%s\n", pszName);
 
-  /* Get application info blocks */
-  DosGetInfoBlocks(&tib, &pib);
+  /* Get application info blocks; the PIB stays put */
+  if (!pEnvPib)
+  {
+    DosGetInfoBlocks(&tib, &pib);
+    pEnvPib = pib;
+  }
 
   /* get the environment */
-  env = pib->pib_pchenv;
+  env = pEnvPib->pib_pchenv;
+
+  if (EnvLookup(env, pszName, &p))
+  {
+    if (p)
+    {
+      for (q = p; *q && *q != '='; q++) ;
+      *ppszValue = q + 1;
+
+      log("pszValue=%s\n", *ppszValue);
+      rc = NO_ERROR;
+    }
+    goto DOSSCANENV_EXIT;
+  }
 
   /* search for needed env variable */
   for (p = env; *p; p += strlen(p) + 1)
@@ -71,11 +233,9 @@ APIRET APIENTRY  DosScanEnv(PCSZ  pszName,
     }
   }
 
+DOSSCANENV_EXIT:
   if (rc)
-  {
     log("not found\n");
-    rc = ERROR_ENVVAR_NOT_FOUND;
-  }
 
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
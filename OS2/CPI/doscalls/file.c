@@ -1,3 +1,4 @@
+#define TRACE_SUBSYS TRC_FILE
 #include "kal.h"
 
 #if 0
@@ -97,6 +98,8 @@ APIRET APIENTRY  DosDelete(PCSZ  pszFile)
   log("%s enter\n", __FUNCTION__);
   log("pszFile=%s\n", pszFile);
   rc = KalDelete((PSZ)pszFile);
+  if (!rc)
+    PvtPathCacheInvalidate();
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -107,6 +110,8 @@ APIRET APIENTRY  DosForceDelete(PCSZ  pszFile)
   log("%s enter\n", __FUNCTION__);
   log("pszFile=%s\n", pszFile);
   rc = KalForceDelete((PSZ)pszFile);
+  if (!rc)
+    PvtPathCacheInvalidate();
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -117,6 +122,8 @@ APIRET APIENTRY  DosDeleteDir(PCSZ  pszDir)
   log("%s enter\n", __FUNCTION__);
   log("pszDir=%s\n", pszDir);
   rc = KalDeleteDir((PSZ)pszDir);
+  if (!rc)
+    PvtPathCacheInvalidate();
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -128,6 +135,8 @@ APIRET APIENTRY  DosCreateDir(PCSZ  pszDirName,
   log("%s enter\n", __FUNCTION__);
   log("pszDirName=%s\n", pszDirName);
   rc = KalCreateDir((PSZ)pszDirName, peaop2);
+  if (!rc)
+    PvtPathCacheInvalidate();
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
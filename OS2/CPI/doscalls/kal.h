@@ -12,8 +12,45 @@
 
 void log(const char *fmt, ...);
 
+/*
+ * Trace subsystems.  A source file may set TRACE_SUBSYS before it
+ * includes this header; its log() calls then cost a load and a test
+ * unless that bit is in ulTraceMask (DOSCALLS_TRACE, see log.c).
+ * Building with NO_TRACE compiles them out.
+ */
+#define TRC_FILE     0x00000001
+#define TRC_MEM      0x00000002
+#define TRC_MOD      0x00000004
+#define TRC_MSG      0x00000008
+#define TRC_NLS      0x00000010
+#define TRC_SEM      0x00000020
+#define TRC_PROC     0x00000040
+#define TRC_MISC     0x00000080
+#define TRC_TEXT     0x80000000   // also format into the system log
+
+#ifndef TRACE_SUBSYS
+#define TRACE_SUBSYS TRC_MISC
+#endif
+
+extern volatile ULONG ulTraceMask;
+
+void PvtTrace(ULONG ulSubsys, const char *fmt, ...);
+
+#ifdef NO_TRACE
+#define log(...) ((void)0)
+#else
+#define log(...) \
+  ((ulTraceMask & TRACE_SUBSYS) ? PvtTrace(TRACE_SUBSYS, __VA_ARGS__) : (void)0)
+#endif
+
 APIRET unimplemented(char *func);
 
+/* Drops cached DosSearchPath results after a namespace change */
+void PvtPathCacheInvalidate(void);
+
+/* Millisecond count from the system information page, 0 without it */
+ULONG PvtQueryMsCount(void);
+
 APIRET __cdecl
 KalOpenL (PSZ pszFileName,
           HFILE *phFile,
@@ -84,6 +121,9 @@ KalLoadModule(PSZ pszName,
                   char const *pszModname,
                   PULONG phmod);
 
+APIRET __cdecl
+KalFreeModule(ULONG hmod);
+
 APIRET __cdecl
 KalQueryProcType(HMODULE hmod,
                  ULONG ordinal,
@@ -255,6 +295,21 @@ KalCreateEventSem(PSZ pszName,
                   ULONG flags,
                   BOOL32 fState);
 
+/*
+ * Sleep while *pWord == ulExpected, at most ulTimeout ms (thread_block_if).
+ * Returns NO_ERROR when woken or if the word had already changed,
+ * ERROR_TIMEOUT or ERROR_INTERRUPT.
+ */
+APIRET __cdecl
+KalSemWait(volatile ULONG *pWord,
+           ULONG ulExpected,
+           ULONG ulTimeout);
+
+/* Wake up to cWake threads sleeping on pWord, 0 for all */
+APIRET __cdecl
+KalSemWake(volatile ULONG *pWord,
+           ULONG cWake);
+
 APIRET __cdecl
 KalCreateThread(PTID ptid,
                 PFNTHREAD pfn,
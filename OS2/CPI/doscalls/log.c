@@ -1,9 +1,415 @@
-/*  Output to system log
+/*  Output to system log, and the doscalls trace buffer
  *
+ *  log() calls are gated per subsystem by ulTraceMask (see kal.h), so
+ *  a disabled call costs a load and a test.  Enabled ones are recorded
+ *  in binary - format string index, thread, milliseconds and the raw
+ *  argument words - into a ring in named shared memory, without any
+ *  formatting.  tools/trcdump snapshots the ring from a running process
+ *  and decodes it.  The mask comes from DOSCALLS_TRACE, a list of
+ *  subsystem names (file,mem,mod,msg,nls,sem,proc,misc or all), plus
+ *  "text" to also format each record into the system log as before.
  */
 
 #include "kal.h"
 
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strnlen.h>
+
+#undef log
+
+// layout shared with tools/trcdump/trcdump.c - only ever append fields
+#define TRACE_NAME      "\\SHAREMEM\\DOSTRC\\"  // + pid in hex
+#define TRACE_MAGIC     0x43525444              // 'DTRC'
+#define TRACE_VERSION   1
+
+#define TRACE_RECS      1024                    // power of two
+#define TRACE_FMTS      512                     // power of two
+#define TRACE_POOL      16384
+#define TRACE_ARGS      6                       // argument words kept
+#define TRACE_STR       28                      // bytes of %s text kept
+
+// TRACEREC.aul[] for a %s argument that was NULL or did not fit
+#define TRACE_STR_NULL  0xFFFFFFFF
+#define TRACE_STR_LOST  0xFFFFFFFE
+
+// TRACEREC.iFmt and TRACEFMT.offText when the table or pool was full
+#define TRACE_NONE      0xFFFF
+
+typedef struct _TRACEREC
+{
+  volatile ULONG ulSeq;         // record number + 1, 0 while written
+  ULONG  ulMs;
+  USHORT usTid;
+  USHORT iFmt;
+  ULONG  aul[TRACE_ARGS];       // argument words; %s: offset into ach
+  CHAR   ach[TRACE_STR];
+} TRACEREC;                     // 64 bytes
+
+typedef struct _TRACEFMT
+{
+  volatile ULONG ulFmt;         // caller's format string, set last
+  ULONG  ulSubsys;
+  USHORT offText;               // copy of the format in achPool
+  USHORT fsStr;                 // argument words that are strings
+  USHORT cWords;
+  USHORT usPad;
+} TRACEFMT;                     // 16 bytes
+
+typedef struct _TRACEHDR
+{
+  ULONG ulMagic;
+  ULONG ulVersion;
+  ULONG cRecs;
+  ULONG cFmts;
+  ULONG cbPool;
+  ULONG pid;
+  ULONG ulMask;
+  volatile ULONG ulNext;        // records taken so far
+  volatile ULONG cbPoolUsed;
+  volatile ULONG ulLock;        // format table insertions
+  ULONG aulReserved[6];
+  TRACEFMT aFmt[TRACE_FMTS];
+  CHAR     achPool[TRACE_POOL];
+  TRACEREC aRec[TRACE_RECS];
+} TRACEHDR;
+
+// all on until the first call has read DOSCALLS_TRACE
+volatile ULONG ulTraceMask = 0xFFFFFFFF;
+
+static TRACEHDR *pTrace = NULL;
+static volatile ULONG ulTraceInit = 0;  // 0 no, 1 in progress, 2 done
+
+static const struct
+{
+  const char *pszName;
+  ULONG ulBit;
+} aTraceNames[] =
+{
+  {"file", TRC_FILE},
+  {"mem",  TRC_MEM},
+  {"mod",  TRC_MOD},
+  {"msg",  TRC_MSG},
+  {"nls",  TRC_NLS},
+  {"sem",  TRC_SEM},
+  {"proc", TRC_PROC},
+  {"misc", TRC_MISC},
+  {"all",  ~TRC_TEXT},
+  {"text", TRC_TEXT}
+};
+
+ULONG TraceXchg(volatile ULONG *p, ULONG ul);
+#pragma aux TraceXchg = \
+  "xchg [edx], eax" \
+  parm [edx] [eax] \
+  value [eax] \
+  modify exact [eax];
+
+ULONG TraceXAdd(volatile ULONG *p, ULONG ul);
+#pragma aux TraceXAdd = \
+  "lock xadd [edx], eax" \
+  parm [edx] [eax] \
+  value [eax] \
+  modify exact [eax];
+
+// current thread id, from the TIB: fs:[0Ch] -> TIB2, tib2_ultid first
+TID TraceTid(void);
+#pragma aux TraceTid = \
+  "mov eax, fs:[0Ch]" \
+  "mov eax, [eax]" \
+  value [eax] \
+  modify exact [eax];
+
+void TracePause(void);
+#pragma aux TracePause = 0xf3 0x90;
+
+/*
+ *  Mask from DOSCALLS_TRACE, and the ring if anything is traced.
+ *  Runs with the mask clear, so calls it makes are not traced.
+ */
+static void TraceInit(void)
+{
+  PTIB  ptib;
+  PPIB  ppib;
+  PCSZ  psz;
+  ULONG ulMask = 0;
+  ULONG cch, i;
+  char  szName[32];
+
+  ulTraceMask = 0;
+
+  if (!DosScanEnv("DOSCALLS_TRACE", &psz))
+  {
+    while (*psz)
+    {
+      for (cch = 0; psz[cch] && psz[cch] != ',' && psz[cch] != ' '; cch++)
+        ;
+
+      for (i = 0; i < sizeof(aTraceNames) / sizeof(aTraceNames[0]); i++)
+      {
+        if (strlen(aTraceNames[i].pszName) == cch &&
+            !strnicmp(psz, aTraceNames[i].pszName, cch))
+          ulMask |= aTraceNames[i].ulBit;
+      }
+
+      psz += cch;
+      while (*psz == ',' || *psz == ' ')
+        psz++;
+    }
+  }
+
+  if ((ulMask & ~TRC_TEXT) && !DosGetInfoBlocks(&ptib, &ppib))
+  {
+    sprintf(szName, "%s%lX", TRACE_NAME, ppib->pib_ulpid);
+
+    if (!DosAllocSharedMem((void **)&pTrace, szName, sizeof(TRACEHDR),
+                           PAG_READ | PAG_WRITE | PAG_COMMIT))
+    {
+      memset(pTrace, 0, sizeof(TRACEHDR));
+      pTrace->ulVersion = TRACE_VERSION;
+      pTrace->cRecs = TRACE_RECS;
+      pTrace->cFmts = TRACE_FMTS;
+      pTrace->cbPool = TRACE_POOL;
+      pTrace->pid = ppib->pib_ulpid;
+      pTrace->ulMask = ulMask;
+      pTrace->ulMagic = TRACE_MAGIC;
+    }
+    else
+      pTrace = NULL;
+  }
+
+  ulTraceInit = 2;
+  ulTraceMask = ulMask;
+}
+
+/*
+ *  Argument words a format consumes, and which of them are strings.
+ *  trcdump walks formats the same way to decode them.
+ */
+static void TraceParseFmt(const char *fmt, USHORT *pcWords, USHORT *pfsStr)
+{
+  ULONG cWords = 0, fsStr = 0, cLong;
+
+  while (*fmt)
+  {
+    if (*fmt++ != '%')
+      continue;
+    if (*fmt == '%')
+    {
+      fmt++;
+      continue;
+    }
+
+    while (*fmt && strchr("-+ #0", *fmt))
+      fmt++;
+    if (*fmt == '*')
+      cWords++, fmt++;
+    while (*fmt >= '0' && *fmt <= '9')
+      fmt++;
+    if (*fmt == '.')
+    {
+      fmt++;
+      if (*fmt == '*')
+        cWords++, fmt++;
+      while (*fmt >= '0' && *fmt <= '9')
+        fmt++;
+    }
+
+    for (cLong = 0; *fmt && strchr("hlLwNFIj", *fmt); fmt++)
+    {
+      if (*fmt == 'L' || (*fmt == 'l' && fmt[1] == 'l'))
+        cLong = 1;
+      if (*fmt == 'I' && fmt[1] == '6' && fmt[2] == '4')
+        cLong = 1, fmt += 2;
+    }
+
+    if (!*fmt)
+      break;
+
+    if (*fmt == 's' && cWords < 16)
+      fsStr |= 1 << cWords;
+    if (strchr("eEfgG", *fmt))
+      cLong = 1;
+    cWords += 1 + cLong;
+    fmt++;
+  }
+
+  *pcWords = (USHORT)(cWords > TRACE_ARGS ? TRACE_ARGS : cWords);
+  *pfsStr = (USHORT)fsStr;
+}
+
+/*
+ *  Format table slot for fmt, adding it on first use
+ */
+static ULONG TraceFmtIndex(ULONG ulSubsys, const char *fmt)
+{
+  TRACEFMT *pf;
+  ULONG h, i, cb;
+
+  h = ((ULONG)fmt * 2654435761UL) >> 23;        // 9 bits, TRACE_FMTS
+
+  for (i = 0; i < TRACE_FMTS; i++, h = (h + 1) & (TRACE_FMTS - 1))
+  {
+    pf = &pTrace->aFmt[h];
+
+    if (pf->ulFmt == (ULONG)fmt)
+      return h;
+
+    if (pf->ulFmt)
+      continue;
+
+    while (TraceXchg(&pTrace->ulLock, 1))
+      TracePause();
+
+    // another thread may have taken the slot meanwhile
+    if (!pf->ulFmt)
+    {
+      cb = strlen(fmt) + 1;
+      if (pTrace->cbPoolUsed + cb <= TRACE_POOL)
+      {
+        memcpy(pTrace->achPool + pTrace->cbPoolUsed, fmt, cb);
+        pf->offText = (USHORT)pTrace->cbPoolUsed;
+        pTrace->cbPoolUsed += cb;
+      }
+      else
+        pf->offText = TRACE_NONE;
+
+      pf->ulSubsys = ulSubsys;
+      TraceParseFmt(fmt, &pf->cWords, &pf->fsStr);
+      pf->ulFmt = (ULONG)fmt;
+    }
+
+    pTrace->ulLock = 0;
+
+    if (pf->ulFmt == (ULONG)fmt)
+      return h;
+  }
+
+  return TRACE_NONE;
+}
+
+/*
+ *  Record one log() call
+ */
+static void TraceRecord(ULONG ulSubsys, const char *fmt, va_list arg_ptr)
+{
+  TRACEREC *pr;
+  TRACEFMT *pf;
+  ULONG n, i, cb, off = 0;
+  char  *psz;
+
+  n = TraceXAdd(&pTrace->ulNext, 1);
+  pr = &pTrace->aRec[n & (TRACE_RECS - 1)];
+
+  pr->ulSeq = 0;
+  pr->ulMs = PvtQueryMsCount();
+  pr->usTid = (USHORT)TraceTid();
+  pr->iFmt = (USHORT)TraceFmtIndex(ulSubsys, fmt);
+
+  if (pr->iFmt != TRACE_NONE)
+  {
+    pf = &pTrace->aFmt[pr->iFmt];
+
+    for (i = 0; i < pf->cWords; i++)
+    {
+      pr->aul[i] = va_arg(arg_ptr, ULONG);
+
+      if (!(pf->fsStr & (1 << i)))
+        continue;
+
+      if (!(psz = (char *)pr->aul[i]))
+      {
+        pr->aul[i] = TRACE_STR_NULL;
+        continue;
+      }
+
+      if (off >= TRACE_STR - 1)
+      {
+        pr->aul[i] = TRACE_STR_LOST;
+        continue;
+      }
+
+      cb = strnlen(psz, TRACE_STR - off - 1);
+
+      memcpy(pr->ach + off, psz, cb);
+      pr->ach[off + cb] = '\0';
+      pr->aul[i] = off;
+      off += cb + 1;
+    }
+  }
+
+  pr->ulSeq = n + 1;
+}
+
+/*
+ *  Settle the mask on first use; FALSE if ulSubsys is not traced
+ */
+static BOOL TraceReady(ULONG ulSubsys)
+{
+  if (ulTraceInit != 2)
+  {
+    // the first caller reads the settings, others drop meanwhile
+    if (TraceXchg(&ulTraceInit, 1))
+      return FALSE;
+    TraceInit();
+  }
+
+  return (ulTraceMask & ulSubsys) != 0;
+}
+
+static void TraceText(const char *fmt, va_list arg_ptr)
+{
+  char buf[1024];
+
+  vsprintf(buf, fmt, arg_ptr);
+  KalLogWrite(buf);
+}
+
+void PvtTrace(ULONG ulSubsys, const char *fmt, ...)
+{
+  va_list arg_ptr;
+
+  if (!TraceReady(ulSubsys))
+    return;
+
+  if (pTrace)
+  {
+    va_start(arg_ptr, fmt);
+    TraceRecord(ulSubsys, fmt, arg_ptr);
+    va_end(arg_ptr);
+  }
+
+  if (ulTraceMask & TRC_TEXT)
+  {
+    va_start(arg_ptr, fmt);
+    TraceText(fmt, arg_ptr);
+    va_end(arg_ptr);
+  }
+}
+
+// for callers that do not include kal.h, as misc
+void log(const char *fmt, ...)
+{
+  va_list arg_ptr;
+
+  if (!(ulTraceMask & TRC_MISC) || !TraceReady(TRC_MISC))
+    return;
+
+  if (pTrace)
+  {
+    va_start(arg_ptr, fmt);
+    TraceRecord(TRC_MISC, fmt, arg_ptr);
+    va_end(arg_ptr);
+  }
+
+  if (ulTraceMask & TRC_TEXT)
+  {
+    va_start(arg_ptr, fmt);
+    TraceText(fmt, arg_ptr);
+    va_end(arg_ptr);
+  }
+}
 
 APIRET APIENTRY DosLogWrite(PSZ s)
 {
@@ -1,3 +1,4 @@
+#define TRACE_SUBSYS TRC_MEM
 #include "kal.h"
 
 
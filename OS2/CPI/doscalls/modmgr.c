@@ -1,20 +1,285 @@
 /*  Module manager
  *
+ *  Modules loaded through DosLoadModule are kept in a per-process
+ *  table, so loading one again only counts a reference, and each
+ *  module remembers the entry points already resolved in a hash
+ *  table keyed by name or ordinal.  Only misses go to the loader.
+ *  A table entry holds one loader reference, returned with
+ *  KalFreeModule when its last DosLoadModule is freed.
  */
 
+#define TRACE_SUBSYS TRC_MOD
 #include "kal.h"
 
+#include <string.h>
+
+// modules remembered per process
+#define MODTAB_SIZE     64
+
+// resolved entry points remembered per module, a power of 2
+#define PROCTAB_SIZE    256
+
+// longest entry point name that is cached
+#define PROCNAME_MAX    48
+
+typedef struct
+{
+  PFN   pfn;                     // NULL - free slot
+  ULONG ulOrdinal;               // 0 - looked up by name
+  char  szName[PROCNAME_MAX];
+} PROCENT;
+
+typedef struct
+{
+  HMODULE hmod;                  // 0 - free slot
+  ULONG   cRef;                  // DosLoadModule calls not yet freed
+  ULONG   cProcs;                // used slots in pProcs
+  char    szName[CCHMAXPATH];    // name it was loaded by, or empty
+  PROCENT *pProcs;               // allocated on first lookup
+} MODENT;
+
+// the table belongs to this process, not the shared DATA segment
+#pragma data_seg("PRIV_DATA", "PRIVDATA")
+static MODENT aModTab[MODTAB_SIZE] = { 0 };
+static volatile HMTX hmtxModTab = 0;
+#pragma data_seg()
+
+ULONG ModCmpXchg(volatile ULONG *p, ULONG ulOld, ULONG ulNew);
+#pragma aux ModCmpXchg = \
+  "lock cmpxchg [edx], ecx" \
+  parm [edx] [eax] [ecx] \
+  value [eax] \
+  modify exact [eax];
+
+/*
+ *  FALSE if the table cannot be used; callers then go to the
+ *  loader directly.  The mutex is created once per process: of
+ *  threads racing to create it, one installs its own and the
+ *  others close theirs.
+ */
+static BOOL ModLock(void)
+{
+  HMTX hmtx;
+
+  if (!hmtxModTab && !DosCreateMutexSem(NULL, &hmtx, 0, FALSE) &&
+      ModCmpXchg((volatile ULONG *)&hmtxModTab, 0, hmtx))
+    DosCloseMutexSem(hmtx);
+
+  return hmtxModTab &&
+         !DosRequestMutexSem(hmtxModTab, SEM_INDEFINITE_WAIT);
+}
+
+static void ModUnlock(void)
+{
+  DosReleaseMutexSem(hmtxModTab);
+}
+
+static ULONG ProcHash(ULONG ordinal, PCSZ pszName)
+{
+  ULONG h = 2166136261U;
+
+  if (!pszName)
+    return ordinal * 2654435761U;
+
+  while (*pszName)
+    h = (h ^ (unsigned char)*pszName++) * 16777619U;
+
+  return h;
+}
+
+/*
+ *  Module table entries
+ */
+static MODENT *ModFind(HMODULE hmod)
+{
+  int i;
+
+  for (i = 0; i < MODTAB_SIZE; i++)
+  {
+    if (aModTab[i].hmod == hmod)
+      return &aModTab[i];
+  }
+
+  return NULL;
+}
+
+static MODENT *ModFindName(PCSZ pszModname)
+{
+  int i;
+
+  for (i = 0; i < MODTAB_SIZE; i++)
+  {
+    if (aModTab[i].hmod && aModTab[i].cRef &&
+        !stricmp(aModTab[i].szName, pszModname))
+      return &aModTab[i];
+  }
+
+  return NULL;
+}
+
+static void ModDrop(MODENT *pm)
+{
+  if (pm->pProcs)
+    DosFreeMem(pm->pProcs);
+
+  memset(pm, 0, sizeof(MODENT));
+}
+
+/*
+ *  An entry for hmod, taking a free slot or one nobody holds
+ *  a reference to.  NULL if all are loaded modules.
+ */
+static MODENT *ModAdd(HMODULE hmod)
+{
+  MODENT *pm;
+  int i;
+
+  if ((pm = ModFind(hmod)))
+    return pm;
+
+  if (!(pm = ModFind(0)))
+  {
+    for (i = 0; i < MODTAB_SIZE; i++)
+    {
+      if (!aModTab[i].cRef)
+      {
+        pm = &aModTab[i];
+        ModDrop(pm);
+        break;
+      }
+    }
+  }
+
+  if (pm)
+    pm->hmod = hmod;
+
+  return pm;
+}
+
+/*
+ *  Resolved entry points
+ */
+static PROCENT *ProcFind(MODENT *pm, ULONG ordinal, PCSZ pszName)
+{
+  PROCENT *pp;
+  ULONG   i, n;
+
+  if (!pm->pProcs)
+    return NULL;
+
+  i = ProcHash(ordinal, pszName);
+
+  for (n = 0; n < PROCTAB_SIZE; n++, i++)
+  {
+    pp = &pm->pProcs[i & (PROCTAB_SIZE - 1)];
+
+    if (!pp->pfn)
+      break;
+
+    if (pszName ? (!pp->ulOrdinal && !strcmp(pp->szName, pszName)) :
+                  pp->ulOrdinal == ordinal)
+      return pp;
+  }
+
+  return NULL;
+}
+
+static void ProcAdd(MODENT *pm, ULONG ordinal, PCSZ pszName, PFN pfn)
+{
+  PROCENT *pp;
+  ULONG   i;
+
+  if (pszName && strlen(pszName) >= PROCNAME_MAX)
+    return;
+
+  // probes stay short while the table is at most 3/4 full
+  if (pm->cProcs >= PROCTAB_SIZE * 3 / 4)
+    return;
+
+  if (!pm->pProcs &&
+      DosAllocMem((void **)&pm->pProcs, PROCTAB_SIZE * sizeof(PROCENT),
+                  PAG_READ | PAG_WRITE | PAG_COMMIT))
+  {
+    pm->pProcs = NULL;
+    return;
+  }
+
+  i = ProcHash(ordinal, pszName);
+
+  while (pm->pProcs[i & (PROCTAB_SIZE - 1)].pfn)
+    i++;
+
+  pp = &pm->pProcs[i & (PROCTAB_SIZE - 1)];
+  pp->pfn = pfn;
+
+  if (pszName)
+  {
+    pp->ulOrdinal = 0;
+    strcpy(pp->szName, pszName);
+  }
+  else
+    pp->ulOrdinal = ordinal;
+
+  pm->cProcs++;
+}
+
 APIRET APIENTRY  DosLoadModule(PSZ  pszName,
                                ULONG cbName,
                                PCSZ  pszModname,
                                PHMODULE phmod)
 {
+  MODENT *pm;
+  BOOL   fDup = FALSE;
   APIRET rc;
   log("%s enter\n", __FUNCTION__);
   log("cbName=%lu\n", cbName);
   log("pszModname=%s\n", pszModname);
+
+  if (!pszModname || !phmod)
+  {
+    rc = ERROR_INVALID_PARAMETER;
+    goto DOSLOADMODULE_EXIT;
+  }
+
+  if (ModLock())
+  {
+    // already loaded by this process: just count it
+    if ((pm = ModFindName(pszModname)))
+    {
+      pm->cRef++;
+      *phmod = pm->hmod;
+      ModUnlock();
+      rc = NO_ERROR;
+      goto DOSLOADMODULE_EXIT;
+    }
+
+    ModUnlock();
+  }
+
   rc = KalLoadModule(pszName, cbName, pszModname, phmod);
   log("pszName=%s\n", pszName);
+
+  if (!rc && strlen(pszModname) < CCHMAXPATH && ModLock())
+  {
+    if ((pm = ModAdd(*phmod)))
+    {
+      // first load by name, or a module we only knew by handle;
+      // otherwise the entry already holds a loader reference
+      if (!pm->cRef)
+        strcpy(pm->szName, pszModname);
+      else
+        fDup = TRUE;
+
+      pm->cRef++;
+    }
+
+    ModUnlock();
+
+    if (fDup)
+      KalFreeModule(*phmod);
+  }
+
+DOSLOADMODULE_EXIT:
   log("hmod=%lx\n", *phmod);
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
@@ -22,10 +287,26 @@ APIRET APIENTRY  DosLoadModule(PSZ  pszName,
 
 APIRET APIENTRY DosQueryModuleHandle(const PCSZ pszModname, PHMODULE phmod)
 {
+  MODENT *pm;
   APIRET rc;
   log("%s enter\n", __FUNCTION__);
   log("pszModname=%s\n", pszModname);
-  rc = KalQueryModuleHandle(pszModname, phmod);
+
+  pm = NULL;
+
+  if (pszModname && ModLock())
+  {
+    if ((pm = ModFindName(pszModname)))
+      *phmod = pm->hmod;
+
+    ModUnlock();
+  }
+
+  if (pm)
+    rc = NO_ERROR;
+  else
+    rc = KalQueryModuleHandle(pszModname, phmod);
+
   log("hmod=%lx\n", *phmod);
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
@@ -45,12 +326,45 @@ APIRET APIENTRY DosQueryModuleName(HMODULE hmod, ULONG cbName, PCHAR pch)
 
 APIRET APIENTRY DosQueryProcAddr(HMODULE hmod, ULONG ordinal, const PCSZ pszName, PFN *  ppfn)
 {
+  MODENT  *pm;
+  PROCENT *pp;
   APIRET rc;
   log("%s enter\n", __FUNCTION__);
   log("hmod=%lx\n", hmod);
   log("ordinal=%lx\n", ordinal);
   log("pszName=%s\n", pszName);
+
+  // a name, if given, takes precedence over the ordinal
+  if (!hmod || (!pszName && !ordinal))
+  {
+    rc = KalQueryProcAddr(hmod, ordinal, (PSZ)pszName, (void **)ppfn);
+    goto DOSQUERYPROCADDR_EXIT;
+  }
+
+  if (ModLock())
+  {
+    if ((pm = ModFind(hmod)) && (pp = ProcFind(pm, ordinal, pszName)))
+    {
+      *ppfn = pp->pfn;
+      ModUnlock();
+      rc = NO_ERROR;
+      goto DOSQUERYPROCADDR_EXIT;
+    }
+
+    ModUnlock();
+  }
+
   rc = KalQueryProcAddr(hmod, ordinal, (PSZ)pszName, (void **)ppfn);
+
+  if (!rc && *ppfn && ModLock())
+  {
+    if ((pm = ModAdd(hmod)) && !ProcFind(pm, ordinal, pszName))
+      ProcAdd(pm, ordinal, pszName, *ppfn);
+
+    ModUnlock();
+  }
+
+DOSQUERYPROCADDR_EXIT:
   log("pfn=%lx\n", *ppfn);
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
@@ -83,9 +397,31 @@ APIRET APIENTRY DosQueryAppType(PCSZ pszName,
 
 APIRET APIENTRY DosFreeModule(HMODULE hmod)
 {
+  MODENT *pm;
+  BOOL   fLoader = TRUE;
   APIRET rc = NO_ERROR;
   log("%s enter\n", __FUNCTION__);
   log("hmod=%lx\n", hmod);
+
+  if (ModLock())
+  {
+    // the last reference takes the resolved addresses, and the
+    // entry's loader reference, with it
+    if ((pm = ModFind(hmod)) && pm->cRef)
+    {
+      if (--pm->cRef)
+        fLoader = FALSE;
+      else
+        ModDrop(pm);
+    }
+
+    ModUnlock();
+  }
+
+  // also a module this table does not count
+  if (fLoader)
+    rc = KalFreeModule(hmod);
+
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -9,6 +9,7 @@
 
 */
 
+#define TRACE_SUBSYS TRC_MSG
 #include "kal.h"
 
 #include <stdio.h>
@@ -20,7 +21,6 @@
 
 #include "msg.h"
 
-void log(const char *fmt, ...);
 
 /*!
    @brief Outputs a message to file
@@ -242,20 +242,57 @@ DOSINSERTMESSAGE_EXIT:
 }
 
 
-APIRET APIENTRY      PvtLoadMsgFile(PSZ pszFile, PVOID *buf, PULONG pcbFile)
+/* Message files kept loaded per process */
+#define MSGCACHE_MAX      8
+
+/* How long a cached file is trusted before its timestamp is rechecked, ms */
+#define MSGCACHE_RECHECK  1000
+
+/* A loaded message file */
+typedef struct
+{
+  char  szName[CCHMAXPATH];  // name as the caller passed it
+  char  szPath[CCHMAXPATH];  // where it was found, DPATH resolved
+  FDATE fdateLastWrite;      // timestamp when loaded
+  FTIME ftimeLastWrite;
+  ULONG cbFile;
+  ULONG ulChecked;           // ms count at the last timestamp check
+  ULONG ulUsed;              // ms count at the last lookup, for eviction
+  char  *pData;              // file contents
+  ULONG *pulIdx;             // msgs_no + 1 offsets, the last one ends the last message
+} MSGFILE;
+
+/* The cache belongs to this process, not the shared DATA segment */
+#pragma data_seg("PRIV_DATA", "PRIVDATA")
+static MSGFILE       aMsgCache[MSGCACHE_MAX] = { 0 };
+static volatile HMTX hmtxMsgCache = 0;
+#pragma data_seg()
+
+ULONG MsgCmpXchg(volatile ULONG *p, ULONG ulOld, ULONG ulNew);
+#pragma aux MsgCmpXchg = \
+  "lock cmpxchg [edx], ecx" \
+  parm [edx] [eax] [ecx] \
+  value [eax] \
+  modify exact [eax];
+
+APIRET APIENTRY      PvtChkMsgFileFmt(void *msgSeg);
+
+/*
+   Reads a message file into memory, returning where it was found
+   and its size and timestamp
+*/
+APIRET APIENTRY      PvtLoadMsgFile(PSZ pszFile, PSZ pszPath, PVOID *buf,
+                                    PULONG pcbFile, FILESTATUS3 *pfs)
 {
-  FILESTATUS3 fileinfo;
   HFILE    hf;
   ULONG    ulAction;
   LONGLONG ll;
-  char     fn[CCHMAXPATH] = "";
-  ULONG    len;
-  ULONG    fisize;
   ULONG    ulActual;
   APIRET   rc;
 
   ll.ulLo = 0;
   ll.ulHi = 0;
+  *buf = NULL;
 
   if (!pszFile || !*pszFile)
     return ERROR_INVALID_PARAMETER;
@@ -263,6 +300,8 @@ APIRET APIENTRY      PvtLoadMsgFile(PSZ pszFile, PVOID *buf, PULONG pcbFile)
   if (strnlen(pszFile, CCHMAXPATH) == CCHMAXPATH)
     return ERROR_FILENAME_EXCED_RANGE;
 
+  strcpy(pszPath, pszFile);
+
   // try opening the file from the root dir/as is
   rc = DosOpenL(pszFile,                    // File name
                 &hf,                        // File handle
@@ -288,14 +327,14 @@ APIRET APIENTRY      PvtLoadMsgFile(PSZ pszFile, PVOID *buf, PULONG pcbFile)
                        SEARCH_CUR_DIRECTORY,
                        "DPATH",
                        pszFile,
-                       fn,
+                       pszPath,
                        CCHMAXPATH); // returns .\OSO001.MSG, which is incorrect
 
     if (rc)
       return rc;
 
     // open it
-    rc = DosOpenL(fn,
+    rc = DosOpenL(pszPath,
                   &hf,
                   &ulAction,
                   ll,
@@ -310,49 +349,224 @@ APIRET APIENTRY      PvtLoadMsgFile(PSZ pszFile, PVOID *buf, PULONG pcbFile)
   if (rc)
     return rc;
 
-  if (! fn[0])
-    strcpy(fn, pszFile);
-
   // file is found, so get file size
-  rc = DosQueryPathInfo(fn,
+  rc = DosQueryPathInfo(pszPath,
                         FIL_STANDARD,
-                        &fileinfo,
+                        pfs,
                         sizeof(FILESTATUS3));
 
   if (rc)
-    return rc;
+    goto PVTLOADMSGFILE_EXIT;
 
-  if (!fileinfo.cbFile)
+  if (!pfs->cbFile)
   {
     log("DosQueryPathInfo returned zero .msg file size!\n");
-    return ERROR_INVALID_PARAMETER;
+    rc = ERROR_INVALID_PARAMETER;
+    goto PVTLOADMSGFILE_EXIT;
   }
   else
-    log("fileinfo.cbFile=%x\n", fileinfo.cbFile);
+    log("fileinfo.cbFile=%x\n", pfs->cbFile);
 
   // allocate a buffer for the file
-  rc = DosAllocMem(buf, fileinfo.cbFile,
+  rc = DosAllocMem(buf, pfs->cbFile,
                    PAG_READ | PAG_WRITE | PAG_COMMIT);
 
   if (rc)
-    return rc;
+    goto PVTLOADMSGFILE_EXIT;
 
   // read the file into memory
   rc = DosRead(hf,
                *buf,
-               fileinfo.cbFile,
+               pfs->cbFile,
                &ulActual);
 
+  if (!rc && ulActual != pfs->cbFile)
+    rc = ERROR_MR_UN_ACC_MSGF;
+
   if (rc)
-    return rc;
+  {
+    DosFreeMem(*buf);
+    *buf = NULL;
+  }
+  else
+    *pcbFile = pfs->cbFile;
 
+PVTLOADMSGFILE_EXIT:
   // close file
   DosClose(hf);
-  *pcbFile = fileinfo.cbFile;
 
   return rc;
 }
 
+static ULONG PvtMsgTicks(void)
+{
+  ULONG ms = 0;
+
+  // a shared page read, not a kernel call
+  DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ms, sizeof(ms));
+  return ms;
+}
+
+static void PvtMsgCacheDrop(MSGFILE *pmf)
+{
+  if (pmf->pulIdx)
+    DosFreeMem(pmf->pulIdx);
+
+  if (pmf->pData)
+    DosFreeMem(pmf->pData);
+
+  memset(pmf, 0, sizeof(MSGFILE));
+}
+
+/*
+   Builds the message number to offset table: 16 or 32 bit offsets
+   widened, plus an end entry, so that a lookup is two array reads
+*/
+static APIRET PvtMsgBuildIndex(MSGFILE *pmf)
+{
+  msghdr_t *hdr = (msghdr_t *)pmf->pData;
+  ULONG    cbIdx, end, i;
+  APIRET   rc;
+
+  if (pmf->cbFile < sizeof(msghdr_t) || PvtChkMsgFileFmt(pmf->pData))
+    return ERROR_MR_INV_MSGF_FORMAT;
+
+  cbIdx = (hdr->is_offs_16bits ? 2 : 4) * (ULONG)hdr->msgs_no;
+
+  if (hdr->idx_ofs + cbIdx > pmf->cbFile)
+    return ERROR_MR_INV_MSGF_FORMAT;
+
+  rc = DosAllocMem((PVOID *)&pmf->pulIdx,
+                   (hdr->msgs_no + 1) * sizeof(ULONG),
+                   PAG_READ | PAG_WRITE | PAG_COMMIT);
+
+  if (rc)
+    return rc;
+
+  for (i = 0; i < hdr->msgs_no; i++)
+  {
+    if (hdr->is_offs_16bits) // if offset is 16 bits
+      pmf->pulIdx[i] = *(unsigned short *)(pmf->pData + hdr->idx_ofs + 2 * i);
+    else // it is 32 bits
+      pmf->pulIdx[i] = *(unsigned long *)(pmf->pData + hdr->idx_ofs + 4 * i);
+  }
+
+  // the last message ends at the next country block or at EOF
+  end = hdr->next_ctry_info ? hdr->next_ctry_info : pmf->cbFile;
+  pmf->pulIdx[hdr->msgs_no] = end;
+
+  return NO_ERROR;
+}
+
+/*
+   Finds a message file in the cache, loading it on a miss.  A hit
+   costs no file I/O; at most once a MSGCACHE_RECHECK the timestamp
+   is compared, and a changed or vanished file is reloaded, searching
+   DPATH again.  On success the cache stays locked until
+   PvtMsgCacheRelease(), so the entry cannot be evicted while in use.
+*/
+static APIRET PvtMsgCacheGet(PSZ pszFile, MSGFILE **ppmf)
+{
+  FILESTATUS3 fs;
+  MSGFILE  *pmf = NULL;
+  MSGFILE  *victim = NULL;
+  HMTX     hmtx;
+  ULONG    now, i;
+  APIRET   rc;
+
+  if (!pszFile || !*pszFile)
+    return ERROR_INVALID_PARAMETER;
+
+  if (strnlen(pszFile, CCHMAXPATH) == CCHMAXPATH)
+    return ERROR_FILENAME_EXCED_RANGE;
+
+  // first use: of threads racing to create the mutex, one installs
+  // its own and the others close theirs
+  if (!hmtxMsgCache)
+  {
+    if ((rc = DosCreateMutexSem(NULL, &hmtx, 0, FALSE)))
+      return rc;
+    if (MsgCmpXchg((volatile ULONG *)&hmtxMsgCache, 0, hmtx))
+      DosCloseMutexSem(hmtx);
+  }
+
+  DosRequestMutexSem(hmtxMsgCache, SEM_INDEFINITE_WAIT);
+
+  now = PvtMsgTicks();
+
+  for (i = 0; i < MSGCACHE_MAX; i++)
+  {
+    if (!aMsgCache[i].pData)
+    {
+      if (!victim || victim->pData)
+        victim = &aMsgCache[i];
+      continue;
+    }
+
+    if (!strcmp(aMsgCache[i].szName, pszFile))
+    {
+      pmf = &aMsgCache[i];
+      break;
+    }
+
+    // evict the least recently used one if the cache is full
+    if (!victim || (victim->pData &&
+        now - aMsgCache[i].ulUsed > now - victim->ulUsed))
+      victim = &aMsgCache[i];
+  }
+
+  if (pmf && now - pmf->ulChecked >= MSGCACHE_RECHECK)
+  {
+    rc = DosQueryPathInfo(pmf->szPath, FIL_STANDARD,
+                          &fs, sizeof(FILESTATUS3));
+
+    if (rc || fs.cbFile != pmf->cbFile ||
+        memcmp(&fs.fdateLastWrite, &pmf->fdateLastWrite, sizeof(FDATE)) ||
+        memcmp(&fs.ftimeLastWrite, &pmf->ftimeLastWrite, sizeof(FTIME)))
+    {
+      log("%s changed, reloading\n", pmf->szPath);
+      victim = pmf;
+      pmf = NULL;
+    }
+    else
+      pmf->ulChecked = now;
+  }
+
+  if (!pmf)
+  {
+    pmf = victim;
+    PvtMsgCacheDrop(pmf);
+
+    rc = PvtLoadMsgFile(pszFile, pmf->szPath, (PVOID *)&pmf->pData,
+                        &pmf->cbFile, &fs);
+
+    if (!rc)
+      rc = PvtMsgBuildIndex(pmf);
+
+    if (rc)
+    {
+      PvtMsgCacheDrop(pmf);
+      DosReleaseMutexSem(hmtxMsgCache);
+      return rc;
+    }
+
+    strcpy(pmf->szName, pszFile);
+    pmf->fdateLastWrite = fs.fdateLastWrite;
+    pmf->ftimeLastWrite = fs.ftimeLastWrite;
+    pmf->ulChecked = now;
+  }
+
+  pmf->ulUsed = now;
+  *ppmf = pmf;
+
+  return NO_ERROR;
+}
+
+static void PvtMsgCacheRelease(void)
+{
+  DosReleaseMutexSem(hmtxMsgCache);
+}
+
 APIRET APIENTRY      PvtChkMsgFileFmt(void *msgSeg)
 {
 
@@ -399,9 +613,8 @@ APIRET APIENTRY      DosIQueryMessageCP(PCHAR pb, ULONG cb,
                                         PULONG cbBuf, void *msgSeg)
 {
   APIRET   rc = NO_ERROR;
-  ULONG    cbFile;
+  MSGFILE  *pmf = NULL;
   int      cp_cnt, i;
-  void     *buf;
   char     *msg, *p = pb;
   msghdr_t *hdr;
   ctry_block_t *ctry;
@@ -431,9 +644,11 @@ APIRET APIENTRY      DosIQueryMessageCP(PCHAR pb, ULONG cb,
 
   if (! msgSeg)
   {
-    // try opening file from DASD
-    rc = PvtLoadMsgFile(pszFile, &buf, &cbFile);
-    msgSeg = buf;
+    // try the cache, then opening file from DASD
+    rc = PvtMsgCacheGet(pszFile, &pmf);
+
+    if (! rc)
+      msgSeg = pmf->pData;
   }
 
   if (! msgSeg || rc)
@@ -496,10 +711,11 @@ APIRET APIENTRY      DosIQueryMessageCP(PCHAR pb, ULONG cb,
   *cbBuf =  p - pb;
   log("*cbBuf=%lu\n", *cbBuf);
 
-  // finally, free file buffer
-  DosFreeMem(buf);
-
 DOSIQUERYMESSAGECP:
+  // the file stays cached for the next call
+  if (pmf)
+    PvtMsgCacheRelease();
+
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -544,13 +760,13 @@ APIRET APIENTRY DosTrueGetMessage(void *msgSeg, PCHAR *pTable, ULONG cTable, PCH
                                   PSZ pszFile, PULONG pcbMsg)
 {
   APIRET rc = NO_ERROR;
-  ULONG  cbFile;
-  void   *buf;
+  MSGFILE *pmf = NULL;
   char   *msg;
   char   id[4];
   char   str[CCHMAXPATH];
   msghdr_t *hdr = (msghdr_t *)msgSeg;
-  int    msgoff, msgend, msglen, i;
+  ULONG  msgoff, msgend;
+  int    msglen, i;
 
   ULONG  len;
 
@@ -592,9 +808,11 @@ APIRET APIENTRY DosTrueGetMessage(void *msgSeg, PCHAR *pTable, ULONG cTable, PCH
 
   if (!msgSeg)
   {
-    // try opening file from DASD
-    rc = PvtLoadMsgFile(pszFile, &buf, &cbFile);
-    msgSeg = buf;
+    // try the cache, then opening file from DASD
+    rc = PvtMsgCacheGet(pszFile, &pmf);
+
+    if (! rc)
+      msgSeg = pmf->pData;
   }
 
   if (! msgSeg || rc)
@@ -614,38 +832,39 @@ APIRET APIENTRY DosTrueGetMessage(void *msgSeg, PCHAR *pTable, ULONG cTable, PCH
   hdr = (msghdr_t *)msg; // message header
   msgnumber -= hdr->firstmsgno;
 
-  if (msgnumber > hdr->msgs_no)
+  if (msgnumber >= hdr->msgs_no)
   {
     rc = ERROR_MR_MID_NOT_FOUND; // ???
     goto DOSTRUEGETMESSAGE_EXIT;
   }
 
-  // get message offset
-  if (hdr->is_offs_16bits) // if offset is 16 bits
-    msgoff = (int)(*(unsigned short *)(msg + hdr->idx_ofs + 2 * msgnumber));
-  else // it is 32 bits
-    msgoff = (int)(*(unsigned long *)(msg + hdr->idx_ofs + 4 * msgnumber));
-
-  if (msgnumber + 1 == hdr->msgs_no) // last message
+  if (pmf)
   {
-    if (hdr->next_ctry_info)
-      msgend = hdr->next_ctry_info;
-    else
-      msgend = cbFile; // EOF
+    // file: from the prebuilt index
+    msgoff = pmf->pulIdx[msgnumber];
+    msgend = pmf->pulIdx[msgnumber + 1];
   }
   else
   {
-    // get next message offset
+    // bound message segment: from its own index
     if (hdr->is_offs_16bits) // if offset is 16 bits
-      msgend = (int)(*(unsigned short *)(msg + hdr->idx_ofs + 2 * (msgnumber + 1)));
+      msgoff = *(unsigned short *)(msg + hdr->idx_ofs + 2 * msgnumber);
     else // it is 32 bits
-      msgend = (int)(*(unsigned long *)(msg + hdr->idx_ofs + 4 * (msgnumber + 1)));
+      msgoff = *(unsigned long *)(msg + hdr->idx_ofs + 4 * msgnumber);
+
+    if (msgnumber + 1 == hdr->msgs_no) // last message
+      msgend = hdr->next_ctry_info ? hdr->next_ctry_info :
+               msgoff + strlen(msg + msgoff) + 1; // no size, NUL-terminated
+    else if (hdr->is_offs_16bits)
+      msgend = *(unsigned short *)(msg + hdr->idx_ofs + 2 * (msgnumber + 1));
+    else
+      msgend = *(unsigned long *)(msg + hdr->idx_ofs + 4 * (msgnumber + 1));
   }
 
   log("msgoff=0x%lx\n", msgoff);
   log("msgend=0x%lx\n", msgend);
 
-  if (msgoff > cbFile || msgend > cbFile)
+  if (msgend <= msgoff || (pmf && msgend > pmf->cbFile))
   {
     rc = ERROR_MR_MSG_TOO_LONG;
     goto DOSTRUEGETMESSAGE_EXIT;
@@ -692,10 +911,11 @@ APIRET APIENTRY DosTrueGetMessage(void *msgSeg, PCHAR *pTable, ULONG cTable, PCH
                         pBuf, cbBuf,
                         pcbMsg);
 
-  // finally, free file buffer
-  DosFreeMem(buf);
-
 DOSTRUEGETMESSAGE_EXIT:
+  // the file stays cached for the next call
+  if (pmf)
+    PvtMsgCacheRelease();
+
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -1,5 +1,265 @@
+#define TRACE_SUBSYS TRC_NLS
 #include "kal.h"
 
+#include <string.h>
+
+#include "nlstab.h"
+
+/*
+ *  Case map, collating and DBCS tables, built once per code page.
+ *  Those of the built-in code pages live in a named shared segment
+ *  that the first process fills and then makes read-only; others are
+ *  built on first use into a few private slots.  Slots are published
+ *  by setting ulCp last and are never reused, so lookups take no lock.
+ *  Tables depend on the code page only: there is no per-country data.
+ */
+
+#define NLS_SHARED_NAME   "\\SHAREMEM\\DOSNLS"
+#define NLS_MAGIC         0x534C4E44      // 'DNLS'
+#define NLS_BUILTINS      (sizeof(aNlsBuiltin) / sizeof(aNlsBuiltin[0]))
+#define NLS_PRIVATE       8
+#define NLS_DBCSENV       24              // 11 ranges and the 0,0 end
+
+typedef struct _NLSTAB
+{
+  volatile ULONG ulCp;              // 0 while free
+  BOOL   fDbcs;
+  APIRET rcDbcs;                    // DosQueryDBCSEnv result
+  ULONG  cbDbcsEnv;
+  UCHAR  abDbcsEnv[NLS_DBCSENV];    // as DosQueryDBCSEnv returns it
+  UCHAR  abLead[32];                // DBCS lead byte bitmap
+  UCHAR  achUpper[256];
+  UCHAR  achCollate[256];
+} NLSTAB;
+
+typedef struct _NLSSHARED
+{
+  volatile ULONG ulMagic;           // set once all tables are built
+  ULONG  cTabs;
+  NLSTAB aTab[1];
+} NLSSHARED;
+
+// per process, not in the shared DATA segment: each process must
+// attach to the shared tables itself, and owns its private slots
+#pragma data_seg("PRIV_DATA", "PRIVDATA")
+static NLSSHARED *pNlsShared = NULL;
+static BOOL fNlsSharedChecked = FALSE;
+
+static NLSTAB aNlsPrivate[NLS_PRIVATE] = { 0 };
+static volatile HMTX hmtxNls = NULLHANDLE;
+
+// the process code page; DosSetProcessCp does not change it yet
+static ULONG ulNlsProcessCp = 0;
+#pragma data_seg()
+
+ULONG NlsCmpXchg(volatile ULONG *p, ULONG ulOld, ULONG ulNew);
+#pragma aux NlsCmpXchg = \
+  "lock cmpxchg [edx], ecx" \
+  parm [edx] [eax] [ecx] \
+  value [eax] \
+  modify exact [eax];
+
+#define NLS_ISLEAD(pt, c)  ((pt)->abLead[(UCHAR)(c) >> 3] & (1 << ((c) & 7)))
+
+static void NlsBuild(NLSTAB *pt, ULONG ulCp)
+{
+  COUNTRYCODE cc;
+  ULONG i, c;
+
+  for (i = 0; i < 128; i++)
+  {
+    pt->achUpper[i] = (UCHAR)(i >= 'a' && i <= 'z' ? i - 'a' + 'A' : i);
+    pt->achCollate[i] = pt->achUpper[i];
+    pt->achUpper[i + 128] = (UCHAR)(i + 128);
+    pt->achCollate[i + 128] = (UCHAR)(i + 128);
+  }
+
+  for (i = 0; i < NLS_BUILTINS; i++)
+  {
+    if (aNlsBuiltin[i].ulCp == ulCp)
+    {
+      memcpy(pt->achUpper + 128, aNlsBuiltin[i].achUpper, 128);
+      memcpy(pt->achCollate + 128, aNlsBuiltin[i].achCollate, 128);
+      break;
+    }
+  }
+
+  cc.country = 0;
+  cc.codepage = ulCp;
+  memset(pt->abDbcsEnv, 0, sizeof(pt->abDbcsEnv));
+  memset(pt->abLead, 0, sizeof(pt->abLead));
+  pt->fDbcs = FALSE;
+  pt->rcDbcs = KalQueryDBCSEnv(sizeof(pt->abDbcsEnv), &cc, pt->abDbcsEnv);
+
+  for (i = 0; !pt->rcDbcs && i + 1 < NLS_DBCSENV; i += 2)
+  {
+    if (!pt->abDbcsEnv[i] && !pt->abDbcsEnv[i + 1])
+      break;
+
+    for (c = pt->abDbcsEnv[i]; c <= pt->abDbcsEnv[i + 1]; c++)
+      pt->abLead[c >> 3] |= 1 << (c & 7);
+    pt->fDbcs = TRUE;
+  }
+  pt->cbDbcsEnv = i + 2 <= NLS_DBCSENV ? i + 2 : NLS_DBCSENV;
+
+  // case mapping must not touch lead bytes
+  for (c = 0; c < 256; c++)
+  {
+    if (NLS_ISLEAD(pt, c))
+      pt->achUpper[c] = (UCHAR)c;
+  }
+
+  pt->ulCp = ulCp;
+}
+
+/*
+ *  Attach to the shared tables, creating them if this is the first
+ *  process.  A segment another process is still filling is skipped.
+ */
+static NLSSHARED *NlsShared(void)
+{
+  NLSSHARED *p;
+  ULONG cb, i;
+
+  if (!fNlsSharedChecked)
+  {
+    fNlsSharedChecked = TRUE;
+    cb = sizeof(NLSSHARED) + (NLS_BUILTINS - 1) * sizeof(NLSTAB);
+
+    if (!DosGetNamedSharedMem((void **)&p, NLS_SHARED_NAME, PAG_READ))
+      pNlsShared = p;
+    else if (!DosAllocSharedMem((void **)&p, NLS_SHARED_NAME, cb,
+                                PAG_READ | PAG_WRITE | PAG_COMMIT))
+    {
+      p->cTabs = NLS_BUILTINS;
+      for (i = 0; i < NLS_BUILTINS; i++)
+        NlsBuild(&p->aTab[i], aNlsBuiltin[i].ulCp);
+      p->ulMagic = NLS_MAGIC;
+      DosSetMem(p, cb, PAG_READ);
+      pNlsShared = p;
+    }
+  }
+
+  return pNlsShared && pNlsShared->ulMagic == NLS_MAGIC ? pNlsShared : NULL;
+}
+
+/*
+ *  Tables for pcc's code page.  pTmp is filled and returned if all
+ *  private slots are taken.
+ */
+static const NLSTAB *NlsGetTable(COUNTRYCODE *pcc, NLSTAB *pTmp)
+{
+  NLSSHARED *ps;
+  NLSTAB *pt;
+  HMTX hmtx;
+  ULONG ulCp, aulCp[1], cb, i;
+
+  if (!(ulCp = pcc->codepage))
+  {
+    if (!ulNlsProcessCp && !KalQueryCp(sizeof(aulCp), aulCp, &cb) && cb)
+      ulNlsProcessCp = aulCp[0];
+    ulCp = ulNlsProcessCp;
+  }
+
+  if ((ps = NlsShared()))
+  {
+    for (i = 0; i < ps->cTabs; i++)
+    {
+      if (ps->aTab[i].ulCp == ulCp)
+        return &ps->aTab[i];
+    }
+  }
+
+  for (i = 0; i < NLS_PRIVATE && aNlsPrivate[i].ulCp; i++)
+  {
+    if (aNlsPrivate[i].ulCp == ulCp)
+      return &aNlsPrivate[i];
+  }
+
+  pt = pTmp;
+
+  // first use: of threads racing to create the mutex, one installs
+  // its own and the others close theirs
+  if (!hmtxNls && !DosCreateMutexSem(NULL, &hmtx, 0, FALSE) &&
+      NlsCmpXchg((volatile ULONG *)&hmtxNls, 0, hmtx))
+    DosCloseMutexSem(hmtx);
+
+  if (hmtxNls && !DosRequestMutexSem(hmtxNls, SEM_INDEFINITE_WAIT))
+  {
+    // somebody may have built it meanwhile
+    for (i = 0; i < NLS_PRIVATE && aNlsPrivate[i].ulCp; i++)
+    {
+      if (aNlsPrivate[i].ulCp == ulCp)
+        break;
+    }
+
+    if (i < NLS_PRIVATE)
+    {
+      pt = &aNlsPrivate[i];
+      if (!pt->ulCp)
+        NlsBuild(pt, ulCp);
+    }
+
+    DosReleaseMutexSem(hmtxNls);
+  }
+
+  if (pt == pTmp)
+    NlsBuild(pt, ulCp);
+
+  return pt;
+}
+
+/*
+ *  Upper-case cb bytes in place.  Aligned words of plain ASCII, the
+ *  bulk of names and paths, are done four bytes at a time: a byte is
+ *  a small letter exactly when it carries into bit 7 after adding
+ *  0x1F but not after adding 0x05, and then loses 0x20.
+ */
+static void NlsMapBuf(const NLSTAB *pt, PCHAR pch, ULONG cb)
+{
+  UCHAR *p = (UCHAR *)pch;
+  ULONG w, m;
+
+  if (pt->fDbcs)
+  {
+    while (cb)
+    {
+      if (NLS_ISLEAD(pt, *p) && cb > 1)
+      {
+        p += 2;
+        cb -= 2;
+        continue;
+      }
+      *p = pt->achUpper[*p];
+      p++;
+      cb--;
+    }
+    return;
+  }
+
+  for (; cb && ((ULONG)p & 3); p++, cb--)
+    *p = pt->achUpper[*p];
+
+  for (; cb >= 4; p += 4, cb -= 4)
+  {
+    w = *(ULONG *)p;
+
+    if (!(w & 0x80808080))
+    {
+      m = ((w + 0x1F1F1F1F) ^ (w + 0x05050505)) & 0x80808080;
+      *(ULONG *)p = w - (m >> 2);
+      continue;
+    }
+
+    p[0] = pt->achUpper[p[0]];
+    p[1] = pt->achUpper[p[1]];
+    p[2] = pt->achUpper[p[2]];
+    p[3] = pt->achUpper[p[3]];
+  }
+
+  for (; cb; p++, cb--)
+    *p = pt->achUpper[*p];
+}
 
 APIRET APIENTRY      DosQueryCp(ULONG   cb,
                                 PULONG  arCP,
@@ -21,13 +281,31 @@ APIRET APIENTRY      DosQueryDBCSEnv(ULONG cb,
                                      COUNTRYCODE *pcc,
                                      PBYTE pBuf)
 {
+  const NLSTAB *pt;
+  NLSTAB tmp;
   APIRET rc;
   log("%s enter\n", __FUNCTION__);
   log("cb=%lu\n", cb);
   log("pcc=%lx\n", pcc);
-  rc = KalQueryDBCSEnv(cb, pcc, pBuf);
+
+  if (!pcc || !pBuf)
+  {
+    rc = ERROR_INVALID_PARAMETER;
+    goto DOSQUERYDBCSENV_EXIT;
+  }
+
+  pt = NlsGetTable(pcc, &tmp);
+
+  // a short buffer gets the kernel's own answer
+  if ((rc = pt->rcDbcs) || cb < pt->cbDbcsEnv)
+    rc = KalQueryDBCSEnv(cb, pcc, pBuf);
+  else
+    memcpy(pBuf, pt->abDbcsEnv, pt->cbDbcsEnv);
+
   log("*pcc=%lx\n", *pcc);
   log("pBuf=%lx\n", pBuf);
+
+DOSQUERYDBCSENV_EXIT:
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -39,11 +317,18 @@ PCHAR           pch;   //  The string of binary characters to be case-mapped.
 */
 APIRET DosMapCase(ULONG cb, PCOUNTRYCODE pcc, PCHAR pch)
 {
+  NLSTAB tmp;
   APIRET rc = NO_ERROR;
   log("%s enter\n", __FUNCTION__);
   log("cb=%lu\n", cb);
   log("pcc=%lx\n", pcc);
   log("pch=%lx\n", pch);
+
+  if (!pcc || (cb && !pch))
+    rc = ERROR_INVALID_PARAMETER;
+  else if (cb)
+    NlsMapBuf(NlsGetTable(pcc, &tmp), pch, cb);
+
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -56,12 +341,29 @@ PULONG          pcch;  //  The length, in bytes, of the collating sequence table
 */
 APIRET DosQueryCollate(ULONG cb, PCOUNTRYCODE pcc, PCHAR pch, PULONG pcch)
 {
+  const NLSTAB *pt;
+  NLSTAB tmp;
   APIRET rc = NO_ERROR;
   log("%s enter\n", __FUNCTION__);
   log("cb=%lu\n", cb);
   log("pcc=%lx\n", pcc);
   log("pch=%lx\n", pch);
   log("pcch=%lx\n", pcch);
+
+  if (!pcc || !pch || !pcch)
+  {
+    rc = ERROR_INVALID_PARAMETER;
+    goto DOSQUERYCOLLATE_EXIT;
+  }
+
+  pt = NlsGetTable(pcc, &tmp);
+
+  if (cb > sizeof(pt->achCollate))
+    cb = sizeof(pt->achCollate);
+  memcpy(pch, pt->achCollate, cb);
+  *pcch = cb;
+
+DOSQUERYCOLLATE_EXIT:
   log("%s exit => %lx\n", __FUNCTION__, rc);
-  return rc;  
+  return rc;
 }
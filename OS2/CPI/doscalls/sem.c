@@ -1,14 +1,260 @@
+/*  Semaphores
+ *
+ *  Private (unnamed, non-shared) event and mutex semaphores live in
+ *  this process' memory.  Posting, resetting, and uncontended
+ *  requests and releases are atomic operations on the semaphore
+ *  word; the kernel is only entered to sleep on the word when a
+ *  thread has to wait, and to wake it.  Shared and named semaphores
+ *  go to the kernel as before.
+ */
+
+#define TRACE_SUBSYS TRC_SEM
 #include "kal.h"
 
+#include <string.h>
+
+// private semaphore handles: tag, generation and pool index
+#define SEM_TAG           0x53000000
+#define SEM_TAG_MASK      0xFF000000
+#define SEM_GEN_MASK      0x00FFF000
+#define SEM_GEN_ONE       0x00001000
+#define SEM_INDEX_MASK    0x00000FFF
+
+#define SemIsPrivate(h)   (((ULONG)(h) & SEM_TAG_MASK) == SEM_TAG)
+
+#define SEM_MAGIC_EVENT   0x56455653      // 'SEVE'
+#define SEM_MAGIC_MUTEX   0x544D5653      // 'SVMT'
+
+// OS/2 limits
+#define SEM_MAX_POSTS     0xFFFF
+#define SEM_MAX_NEST      0xFFFF
+
+// spins before a contended mutex request sleeps
+#define SEM_SPIN          100
+
+// mutex states
+#define MTX_FREE          0
+#define MTX_OWNED         1
+#define MTX_CONTENDED     2               // owned, maybe with sleepers
+
+typedef struct _SEMOBJ
+{
+  ULONG          ulMagic;
+  ULONG          ulHandle;    // current handle of this slot
+  volatile ULONG ulState;     // event: post count; mutex: MTX_*
+  volatile ULONG cWaiters;    // event: threads sleeping on ulState
+  TID            tidOwner;    // mutex: owning thread
+  ULONG          cNest;       // mutex: owner's request count
+  struct _SEMOBJ *pNext;      // free list
+} SEMOBJ;
+
+#define SEM_PER_PAGE      (4096 / sizeof(SEMOBJ))
+#define SEM_MAX_PAGES     ((SEM_INDEX_MASK + 1) / SEM_PER_PAGE)
+
+// private semaphores belong to one process, and so does their pool
+#pragma data_seg("PRIV_DATA", "PRIVDATA")
+static SEMOBJ *apSemPages[SEM_MAX_PAGES] = { 0 };
+static ULONG  cSemPages = 0;
+static SEMOBJ *pSemFree = NULL;
+static volatile ULONG ulSemPoolLock = 0;
+#pragma data_seg()
+
+ULONG SemCmpXchg(volatile ULONG *p, ULONG ulOld, ULONG ulNew);
+#pragma aux SemCmpXchg = \
+  "lock cmpxchg [edx], ecx" \
+  parm [edx] [eax] [ecx] \
+  value [eax] \
+  modify exact [eax];
+
+ULONG SemXchg(volatile ULONG *p, ULONG ul);
+#pragma aux SemXchg = \
+  "xchg [edx], eax" \
+  parm [edx] [eax] \
+  value [eax] \
+  modify exact [eax];
+
+ULONG SemXAdd(volatile ULONG *p, ULONG ul);
+#pragma aux SemXAdd = \
+  "lock xadd [edx], eax" \
+  parm [edx] [eax] \
+  value [eax] \
+  modify exact [eax];
+
+// current thread id, from the TIB: fs:[0Ch] -> TIB2, tib2_ultid first
+TID SemTid(void);
+#pragma aux SemTid = \
+  "mov eax, fs:[0Ch]" \
+  "mov eax, [eax]" \
+  value [eax] \
+  modify exact [eax];
+
+// pause
+void SemPause(void);
+#pragma aux SemPause = 0xf3 0x90;
+
+static ULONG SemTicks(void)
+{
+  ULONG ms = 0;
+
+  DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ms, sizeof(ms));
+  return ms;
+}
+
+#ifndef NO_KAL_SEMWAIT
+#define SemWait(p, ul, t) KalSemWait(p, ul, t)
+#define SemWake(p, c)     KalSemWake(p, c)
+#else
+/*
+ *  For a KAL without KalSemWait/KalSemWake (NO_KAL_SEMWAIT):
+ *  waiters poll the word and wakes are implicit.  The callers
+ *  loop and recheck the timeout.
+ */
+static APIRET SemWait(volatile ULONG *pWord, ULONG ulExpected, ULONG ulTimeout)
+{
+  if (*pWord == ulExpected)
+    DosSleep(1);
+
+  return NO_ERROR;
+}
+
+#define SemWake(p, c)     ((void)0)
+#endif
+
+/*
+ *  Private semaphore objects, carved out of whole pages.  Handles
+ *  are indexes into the pages, so a stale or garbage handle is
+ *  caught by the bounds, magic and generation checks.
+ */
+static SEMOBJ *SemAlloc(ULONG ulMagic)
+{
+  SEMOBJ *p;
+  ULONG  ulHandle;
+  ULONG  i;
+
+  while (SemXchg(&ulSemPoolLock, 1))
+    SemPause();
+
+  if (!pSemFree && cSemPages < SEM_MAX_PAGES &&
+      !DosAllocMem((void **)&p, 4096, PAG_READ | PAG_WRITE | PAG_COMMIT))
+  {
+    apSemPages[cSemPages] = p;
+
+    for (i = 0; i < SEM_PER_PAGE; i++, p++)
+    {
+      p->ulMagic  = 0;
+      p->ulHandle = SEM_TAG | (cSemPages * SEM_PER_PAGE + i);
+      p->pNext    = pSemFree;
+      pSemFree    = p;
+    }
+
+    cSemPages++;
+  }
+
+  if ((p = pSemFree))
+    pSemFree = p->pNext;
+
+  ulSemPoolLock = 0;
+
+  if (p)
+  {
+    ulHandle = p->ulHandle;
+    memset(p, 0, sizeof(SEMOBJ));
+    p->ulHandle = ulHandle;
+    p->ulMagic = ulMagic;
+  }
+
+  return p;
+}
+
+static void SemFree(SEMOBJ *p)
+{
+  // new generation, so the old handle no longer validates
+  p->ulMagic = 0;
+  p->ulHandle = (p->ulHandle & ~SEM_GEN_MASK) |
+                ((p->ulHandle + SEM_GEN_ONE) & SEM_GEN_MASK);
+
+  // a wrapped generation would bring back handles already given
+  // out, so the slot is retired instead
+  if (!(p->ulHandle & SEM_GEN_MASK))
+    return;
+
+  while (SemXchg(&ulSemPoolLock, 1))
+    SemPause();
+
+  p->pNext = pSemFree;
+  pSemFree = p;
+
+  ulSemPoolLock = 0;
+}
+
+/*
+ *  Object of a private handle, NULL if it is not a live one
+ */
+static SEMOBJ *SemObj(ULONG hsem, ULONG ulMagic)
+{
+  ULONG  ulIndex = hsem & SEM_INDEX_MASK;
+  SEMOBJ *p;
+
+  if (!SemIsPrivate(hsem) || ulIndex / SEM_PER_PAGE >= cSemPages)
+    return NULL;
+
+  p = apSemPages[ulIndex / SEM_PER_PAGE] + ulIndex % SEM_PER_PAGE;
+
+  if (p->ulMagic != ulMagic || p->ulHandle != hsem)
+    return NULL;
+
+  return p;
+}
+
+/*
+ *  Time left of ulTimeout ms started at ulStart
+ */
+static ULONG SemTimeLeft(ULONG ulTimeout, ULONG ulStart)
+{
+  ULONG ulSpent;
+
+  if (ulTimeout == SEM_INDEFINITE_WAIT)
+    return SEM_INDEFINITE_WAIT;
+
+  ulSpent = SemTicks() - ulStart;
+
+  return ulSpent < ulTimeout ? ulTimeout - ulSpent : 0;
+}
+
 APIRET APIENTRY DosCreateEventSem(PCSZ pszName, PHEV phev, ULONG flAttr, BOOL32 fState)
 {
+  SEMOBJ *p;
   APIRET rc;
   log("%s enter\n", __FUNCTION__);
   log("pszName=%s\n", pszName);
   log("flAttr=%lu\n", flAttr);
   log("fState=%lu\n", fState);
-  rc = KalCreateEventSem((PSZ)pszName, phev, flAttr, fState);
-  log("hev=%lu\n", *phev);
+
+  if (!phev)
+  {
+    rc = ERROR_INVALID_PARAMETER;
+    goto DOSCREATEEVENTSEM_EXIT;
+  }
+
+  if ((pszName && *pszName) || (flAttr & DC_SEM_SHARED))
+  {
+    rc = KalCreateEventSem((PSZ)pszName, phev, flAttr, fState);
+    goto DOSCREATEEVENTSEM_EXIT;
+  }
+
+  if (!(p = SemAlloc(SEM_MAGIC_EVENT)))
+  {
+    rc = ERROR_NOT_ENOUGH_MEMORY;
+    goto DOSCREATEEVENTSEM_EXIT;
+  }
+
+  p->ulState = fState ? 1 : 0;
+  *phev = (HEV)p->ulHandle;
+  rc = NO_ERROR;
+
+DOSCREATEEVENTSEM_EXIT:
+  if (phev)
+    log("hev=%lu\n", *phev);
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -19,8 +265,15 @@ APIRET APIENTRY DosOpenEventSem(PCSZ pszName, PHEV phev)
   APIRET rc;
   log("%s enter\n", __FUNCTION__);
   log("pszName=%s\n", pszName);
-  rc = KalOpenEventSem((PSZ)pszName, phev);
-  log("hev=%lu\n", *phev);
+
+  // a private semaphore is already usable by every thread
+  if (!pszName && phev && SemIsPrivate(*phev))
+    rc = SemObj(*phev, SEM_MAGIC_EVENT) ? NO_ERROR : ERROR_INVALID_HANDLE;
+  else
+    rc = KalOpenEventSem((PSZ)pszName, phev);
+
+  if (phev)
+    log("hev=%lu\n", *phev);
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
@@ -28,10 +281,333 @@ APIRET APIENTRY DosOpenEventSem(PCSZ pszName, PHEV phev)
 
 APIRET APIENTRY DosCloseEventSem(HEV hev)
 {
+  SEMOBJ *p;
   APIRET rc;
   log("%s enter\n", __FUNCTION__);
   log("hev=%lu\n", hev);
-  rc = KalCloseEventSem(hev);
+
+  if (!SemIsPrivate(hev))
+    rc = KalCloseEventSem(hev);
+  else if (!(p = SemObj(hev, SEM_MAGIC_EVENT)))
+    rc = ERROR_INVALID_HANDLE;
+  else if (p->cWaiters)
+    rc = ERROR_SEM_BUSY;
+  else
+  {
+    SemFree(p);
+    rc = NO_ERROR;
+  }
+
   log("%s exit => %lx\n", __FUNCTION__, rc);
   return rc;
 }
+
+
+APIRET APIENTRY DosPostEventSem(HEV hev)
+{
+  SEMOBJ *p;
+  ULONG  ulOld;
+
+  if (!SemIsPrivate(hev))
+    return unimplemented(__FUNCTION__);
+
+  if (!(p = SemObj(hev, SEM_MAGIC_EVENT)))
+    return ERROR_INVALID_HANDLE;
+
+  // bounded increment; a plain check and add would let
+  // concurrent posters overflow the count
+  do
+  {
+    ulOld = p->ulState;
+
+    if (ulOld >= SEM_MAX_POSTS)
+      return ERROR_TOO_MANY_POSTS;
+  } while (SemCmpXchg(&p->ulState, ulOld, ulOld + 1) != ulOld);
+
+  // the locked cmpxchg orders this read after the new count
+  if (p->cWaiters)
+    SemWake(&p->ulState, 0);
+
+  return ulOld ? ERROR_ALREADY_POSTED : NO_ERROR;
+}
+
+
+APIRET APIENTRY DosResetEventSem(HEV hev, PULONG pulPostCt)
+{
+  SEMOBJ *p;
+  ULONG  ulOld;
+
+  if (!SemIsPrivate(hev))
+    return unimplemented(__FUNCTION__);
+
+  if (!(p = SemObj(hev, SEM_MAGIC_EVENT)))
+    return ERROR_INVALID_HANDLE;
+
+  if (!pulPostCt)
+    return ERROR_INVALID_PARAMETER;
+
+  ulOld = SemXchg(&p->ulState, 0);
+  *pulPostCt = ulOld;
+
+  return ulOld ? NO_ERROR : ERROR_ALREADY_RESET;
+}
+
+
+APIRET APIENTRY DosWaitEventSem(HEV hev, ULONG ulTimeout)
+{
+  SEMOBJ *p;
+  ULONG  ulStart = 0;
+  ULONG  ulLeft;
+  APIRET rc = NO_ERROR;
+
+  if (!SemIsPrivate(hev))
+    return unimplemented(__FUNCTION__);
+
+  if (!(p = SemObj(hev, SEM_MAGIC_EVENT)))
+    return ERROR_INVALID_HANDLE;
+
+  if (p->ulState)
+    return NO_ERROR;
+
+  if (ulTimeout == SEM_IMMEDIATE_RETURN)
+    return ERROR_TIMEOUT;
+
+  if (ulTimeout != SEM_INDEFINITE_WAIT)
+    ulStart = SemTicks();
+
+  SemXAdd(&p->cWaiters, 1);
+
+  // sleep only while the count is still zero; a post after the
+  // waiter count went up either is seen here or wakes us
+  while (!p->ulState)
+  {
+    if (!(ulLeft = SemTimeLeft(ulTimeout, ulStart)))
+    {
+      rc = ERROR_TIMEOUT;
+      break;
+    }
+
+    if ((rc = SemWait(&p->ulState, 0, ulLeft)) &&
+        rc != ERROR_TIMEOUT)
+      break;
+
+    rc = NO_ERROR;
+  }
+
+  SemXAdd(&p->cWaiters, (ULONG)-1);
+
+  return rc;
+}
+
+
+APIRET APIENTRY DosQueryEventSem(HEV hev, PULONG pulPostCt)
+{
+  SEMOBJ *p;
+
+  if (!SemIsPrivate(hev))
+    return unimplemented(__FUNCTION__);
+
+  if (!(p = SemObj(hev, SEM_MAGIC_EVENT)))
+    return ERROR_INVALID_HANDLE;
+
+  if (!pulPostCt)
+    return ERROR_INVALID_PARAMETER;
+
+  *pulPostCt = p->ulState;
+  return NO_ERROR;
+}
+
+
+APIRET APIENTRY DosCreateMutexSem(PCSZ pszName, PHMTX phmtx, ULONG flAttr, BOOL32 fState)
+{
+  SEMOBJ *p;
+  APIRET rc;
+  log("%s enter\n", __FUNCTION__);
+  log("pszName=%s\n", pszName);
+  log("flAttr=%lu\n", flAttr);
+  log("fState=%lu\n", fState);
+
+  if (!phmtx)
+  {
+    rc = ERROR_INVALID_PARAMETER;
+    goto DOSCREATEMUTEXSEM_EXIT;
+  }
+
+  if ((pszName && *pszName) || (flAttr & DC_SEM_SHARED))
+  {
+    rc = unimplemented(__FUNCTION__);
+    goto DOSCREATEMUTEXSEM_EXIT;
+  }
+
+  if (!(p = SemAlloc(SEM_MAGIC_MUTEX)))
+  {
+    rc = ERROR_NOT_ENOUGH_MEMORY;
+    goto DOSCREATEMUTEXSEM_EXIT;
+  }
+
+  if (fState)
+  {
+    p->ulState  = MTX_OWNED;
+    p->tidOwner = SemTid();
+    p->cNest    = 1;
+  }
+
+  *phmtx = (HMTX)p->ulHandle;
+  rc = NO_ERROR;
+
+DOSCREATEMUTEXSEM_EXIT:
+  if (phmtx)
+    log("hmtx=%lu\n", *phmtx);
+  log("%s exit => %lx\n", __FUNCTION__, rc);
+  return rc;
+}
+
+
+APIRET APIENTRY DosOpenMutexSem(PCSZ pszName, PHMTX phmtx)
+{
+  if (!pszName && phmtx && SemIsPrivate(*phmtx))
+    return SemObj(*phmtx, SEM_MAGIC_MUTEX) ? NO_ERROR : ERROR_INVALID_HANDLE;
+
+  return unimplemented(__FUNCTION__);
+}
+
+
+APIRET APIENTRY DosCloseMutexSem(HMTX hmtx)
+{
+  SEMOBJ *p;
+
+  if (!SemIsPrivate(hmtx))
+    return unimplemented(__FUNCTION__);
+
+  if (!(p = SemObj(hmtx, SEM_MAGIC_MUTEX)))
+    return ERROR_INVALID_HANDLE;
+
+  if (p->ulState != MTX_FREE)
+    return ERROR_SEM_BUSY;
+
+  SemFree(p);
+  return NO_ERROR;
+}
+
+
+APIRET APIENTRY DosRequestMutexSem(HMTX hmtx, ULONG ulTimeout)
+{
+  SEMOBJ *p;
+  TID    tid = SemTid();
+  ULONG  ulStart = 0;
+  ULONG  ulLeft;
+  APIRET rc;
+  int    i;
+
+  if (!SemIsPrivate(hmtx))
+    return unimplemented(__FUNCTION__);
+
+  if (!(p = SemObj(hmtx, SEM_MAGIC_MUTEX)))
+    return ERROR_INVALID_HANDLE;
+
+  // uncontended: one locked instruction
+  if (SemCmpXchg(&p->ulState, MTX_FREE, MTX_OWNED) == MTX_FREE)
+    goto DOSREQUESTMUTEXSEM_OWNED;
+
+  // nested request by the owner
+  if (p->tidOwner == tid)
+  {
+    if (p->cNest >= SEM_MAX_NEST)
+      return ERROR_TOO_MANY_SEM_REQUESTS;
+
+    p->cNest++;
+    return NO_ERROR;
+  }
+
+  if (ulTimeout == SEM_IMMEDIATE_RETURN)
+    return ERROR_TIMEOUT;
+
+  // short critical sections are usually over before a sleep would be
+  for (i = 0; i < SEM_SPIN; i++)
+  {
+    SemPause();
+
+    if (p->ulState == MTX_FREE &&
+        SemCmpXchg(&p->ulState, MTX_FREE, MTX_OWNED) == MTX_FREE)
+      goto DOSREQUESTMUTEXSEM_OWNED;
+  }
+
+  if (ulTimeout != SEM_INDEFINITE_WAIT)
+    ulStart = SemTicks();
+
+  // mark it contended, so the release wakes someone, and sleep;
+  // taking it here leaves it contended, which costs at most one
+  // needless wake
+  while (SemXchg(&p->ulState, MTX_CONTENDED) != MTX_FREE)
+  {
+    if (!(ulLeft = SemTimeLeft(ulTimeout, ulStart)))
+      return ERROR_TIMEOUT;
+
+    rc = SemWait(&p->ulState, MTX_CONTENDED, ulLeft);
+
+    if (rc && rc != ERROR_TIMEOUT)
+      return rc;
+  }
+
+DOSREQUESTMUTEXSEM_OWNED:
+  p->tidOwner = tid;
+  p->cNest = 1;
+  return NO_ERROR;
+}
+
+
+APIRET APIENTRY DosReleaseMutexSem(HMTX hmtx)
+{
+  SEMOBJ *p;
+
+  if (!SemIsPrivate(hmtx))
+    return unimplemented(__FUNCTION__);
+
+  if (!(p = SemObj(hmtx, SEM_MAGIC_MUTEX)))
+    return ERROR_INVALID_HANDLE;
+
+  if (p->ulState == MTX_FREE || p->tidOwner != SemTid())
+    return ERROR_NOT_OWNER;
+
+  if (--p->cNest)
+    return NO_ERROR;
+
+  p->tidOwner = 0;
+
+  if (SemXchg(&p->ulState, MTX_FREE) == MTX_CONTENDED)
+    SemWake(&p->ulState, 1);
+
+  return NO_ERROR;
+}
+
+
+APIRET APIENTRY DosQueryMutexSem(HMTX hmtx, PPID ppid, PTID ptid, PULONG pulCount)
+{
+  SEMOBJ *p;
+  PTIB   ptib;
+  PPIB   ppib;
+
+  if (!SemIsPrivate(hmtx))
+    return unimplemented(__FUNCTION__);
+
+  if (!(p = SemObj(hmtx, SEM_MAGIC_MUTEX)))
+    return ERROR_INVALID_HANDLE;
+
+  if (!ppid || !ptid || !pulCount)
+    return ERROR_INVALID_PARAMETER;
+
+  if (p->ulState == MTX_FREE)
+  {
+    *ppid = 0;
+    *ptid = 0;
+    *pulCount = 0;
+    return NO_ERROR;
+  }
+
+  // private: the owner is in this process
+  DosGetInfoBlocks(&ptib, &ppib);
+  *ppid = ppib->pib_ulpid;
+  *ptid = p->tidOwner;
+  *pulCount = p->cNest;
+  return NO_ERROR;
+}
@@ -21,26 +21,176 @@ the following restrictions:
     3. This notice may not be removed or altered from any source distribution.
 ---------------------------------------------------*/	
 
+/* Altered for osFree: segregated size-class bins and O(1) free.
+
+   The caller hands the size back on free and OS/2 keeps nothing per
+   allocated block - pools are sized as blocks plus the 64 byte header
+   - so there is no room for boundary tags.  Instead a free block goes
+   straight onto the bin for its size, and neighbours are only merged,
+   all at once in address order, when an allocation finds no block big
+   enough.  Allocation takes the head of the first non-empty bin that
+   is certain to fit, scanning at most SUB_SCAN blocks of its own
+   range bin first to keep the fit tight. */
+
 #define INCL_DOSSPINLOCK
 
 #include "kal.h"
 
+#define SUB_BINS        12      //bins 0-3: 8..32 bytes exact, then ranges
+#define SUB_SCAN        8       //blocks of the own bin tried before a larger bin
+
 struct FreeHeapBlock;
 
 struct HeapHeader {
         ULONG flags;            //flags to DosSubSetMem
         ULONG size;             //in bytes
-        struct FreeHeapBlock *firstFree;
-		HSPINLOCK lock;
+        HSPINLOCK lock;
 //        SpinMutexSemaphore lock;
-        char _filler[ 64 - sizeof(ULONG)*2 - sizeof(struct FreeHeapBlock*) - sizeof(HSPINLOCK /*SpinMutexSemaphore*/) ];
+        ULONG binmap;           //bit n set: bins[n] is not empty
+        struct FreeHeapBlock *bins[SUB_BINS];
 };
 
+//OS/2 documents 64 bytes of pool overhead and callers size pools by it
+typedef char HeapHeaderIs64Bytes[sizeof(struct HeapHeader) == 64 ? 1 : -1];
+
 struct FreeHeapBlock {
         struct FreeHeapBlock *next;
         ULONG size;
 };
 
+//size is a multiple of 8, at least 8
+static int BinOf(ULONG size)
+{
+        if(size <= 32)
+                return size/8 - 1;
+        if(size < 64)
+                return 4;
+        if(size < 128)
+                return 5;
+        if(size < 256)
+                return 6;
+        if(size < 512)
+                return 7;
+        if(size < 1024)
+                return 8;
+        if(size < 4096)
+                return 9;
+        if(size < 16384)
+                return 10;
+        return 11;
+}
+
+static void BinPush(struct HeapHeader *hh, struct FreeHeapBlock *p, ULONG size)
+{
+        int b = BinOf(size);
+
+        p->size = size;
+        p->next = hh->bins[b];
+        hh->bins[b] = p;
+        hh->binmap |= 1UL << b;
+}
+
+//take the first block of at least cb from bin b, trying at most max blocks
+static struct FreeHeapBlock *BinTake(struct HeapHeader *hh, int b, ULONG cb, ULONG max)
+{
+        struct FreeHeapBlock **pp = &hh->bins[b], *p;
+
+        for(; (p = *pp) && max; pp = &p->next, max--) {
+                if(p->size >= cb) {
+                        *pp = p->next;
+                        if(!hh->bins[b])
+                                hh->binmap &= ~(1UL << b);
+                        return p;
+                }
+        }
+        return 0;
+}
+
+//sort a free list by address (bottom-up merge sort)
+static struct FreeHeapBlock *SortByAddress(struct FreeHeapBlock *list)
+{
+        struct FreeHeapBlock *p, *q, *e, *tail;
+        ULONG k = 1, merges, psize, qsize, i;
+
+        if(!list)
+                return 0;
+
+        do {
+                p = list;
+                list = tail = 0;
+                merges = 0;
+                while(p) {
+                        merges++;
+                        q = p;
+                        for(psize = 0, i = 0; i < k && q; i++, psize++)
+                                q = q->next;
+                        qsize = k;
+                        while(psize || (qsize && q)) {
+                                if(!psize)
+                                        e = q, q = q->next, qsize--;
+                                else if(!qsize || !q || (char*)p <= (char*)q)
+                                        e = p, p = p->next, psize--;
+                                else
+                                        e = q, q = q->next, qsize--;
+                                if(tail)
+                                        tail->next = e;
+                                else
+                                        list = e;
+                                tail = e;
+                        }
+                        p = q;
+                }
+                tail->next = 0;
+                k *= 2;
+        } while(merges > 1);
+
+        return list;
+}
+
+//merge all adjacent free blocks and rebin them
+static void Coalesce(struct HeapHeader *hh)
+{
+        struct FreeHeapBlock *all = 0, *p, *n;
+        int b;
+
+        for(b = 0; b < SUB_BINS; b++) {
+                while((p = hh->bins[b])) {
+                        hh->bins[b] = p->next;
+                        p->next = all;
+                        all = p;
+                }
+        }
+        hh->binmap = 0;
+
+        p = SortByAddress(all);
+        while(p) {
+                n = p->next;
+                while(n && (char*)p + p->size == (char*)n) {
+                        p->size += n->size;
+                        n = n->next;
+                }
+                BinPush(hh, p, p->size);
+                p = n;
+        }
+}
+
+static struct FreeHeapBlock *FindBlock(struct HeapHeader *hh, ULONG cb, ULONG scan)
+{
+        struct FreeHeapBlock *p;
+        ULONG m;
+        int b = BinOf(cb);
+
+        if((p = BinTake(hh, b, cb, scan)))
+                return p;
+
+        //any block of a larger bin fits: take a head
+        for(m = hh->binmap >> (b + 1), b++; m; m >>= 1, b++) {
+                if(m & 1)
+                        return BinTake(hh, b, cb, 1);
+        }
+        return 0;
+}
+
 APIRET APIENTRY  DosSubSetMem(PVOID pbBase,
                               ULONG flag,
                               ULONG cb)
@@ -61,25 +211,18 @@ APIRET APIENTRY  DosSubSetMem(PVOID pbBase,
                 } else if(cb==hh->size) {
                         rc = 0;
                 } else {
-                        //find end
-                        struct FreeHeapBlock *p=hh->firstFree,*prev=0;
-                        while(p && p->next)
-                                prev=p, p=p->next;
-                        if(p)
-                                p->size += cb - hh->size;
-                        else {
-                                struct FreeHeapBlock *end = (struct FreeHeapBlock*)(((char*)pbBase)+hh->size);
-                                end->next = 0;
-                                end->size = cb - hh->size;
-                                hh->firstFree = end;
-                        }
+                        //the new tail is one free block; it merges with
+                        //the old last block on the next coalesce
+                        BinPush(hh, (struct FreeHeapBlock*)(((char*)pbBase)+hh->size), cb - hh->size);
                         hh->size = cb;
+                        rc = 0;
                 }
                 if(hh->flags&DOSSUB_SERIALIZE)
                         DosReleaseSpinLock(hh->lock);//hh->lock.Release();
                 return rc;
         } else if(flag&DOSSUB_INIT) {
                 struct HeapHeader *hh=(struct HeapHeader*)pbBase;
+                int b;
                 if(cb<sizeof(struct HeapHeader))
                 return 87; //too small
 
@@ -89,9 +232,11 @@ APIRET APIENTRY  DosSubSetMem(PVOID pbBase,
 					if (DosCreateSpinLock(&hh->lock))
 					//if(!hh->lock.Initialize())
                                 return 1;//(APIRET)GetLastError();
-                hh->firstFree = (struct FreeHeapBlock*)(hh+1);
-                hh->firstFree->next = 0;
-                hh->firstFree->size = cb - sizeof(*hh);
+                hh->binmap = 0;
+                for(b = 0; b < SUB_BINS; b++)
+                        hh->bins[b] = 0;
+                if(cb > sizeof(*hh))
+                        BinPush(hh, (struct FreeHeapBlock*)(hh+1), cb - sizeof(*hh));
 
                 return 0;
         } else
@@ -104,7 +249,7 @@ APIRET APIENTRY  DosSubAllocMem(PVOID pbBase,
                                 ULONG cb)
 {
         struct HeapHeader *hh=(struct HeapHeader*)pbBase;
-        struct FreeHeapBlock *p=hh->firstFree,*prev=0;
+        struct FreeHeapBlock *p;
         APIRET rc;
 
         if(!pbBase)
@@ -117,28 +262,16 @@ APIRET APIENTRY  DosSubAllocMem(PVOID pbBase,
         if(hh->flags&DOSSUB_SERIALIZE)
                 DosAcquireSpinLock(hh->lock);//hh->lock.Request();
 
-        while(p) {
-                if(p->size>=cb)
-                        break;
-                prev=p, p=p->next;
+        if(!(p = FindBlock(hh, cb, SUB_SCAN))) {
+                //fragmented: merge neighbours, then look harder
+                Coalesce(hh);
+                p = FindBlock(hh, cb, 0xFFFFFFFF);
         }
 
         if(p) {
                 if(p->size>cb) {
                         //split free block
-                        struct FreeHeapBlock *n = (struct FreeHeapBlock*)(((char*)p)+cb);
-                        n->next = p->next;
-                        n->size = p->size - cb;
-                        if(prev)
-                                prev->next = n;
-                        else
-                                hh->firstFree = n;
-                } else {
-                        //use block
-                        if(prev)
-                                prev->next = p->next;
-                        else
-                                hh->firstFree = p->next;
+                        BinPush(hh, (struct FreeHeapBlock*)(((char*)p)+cb), p->size - cb);
                 }
                 *ppb = (PVOID)p;
                 rc = 0;
@@ -164,49 +297,21 @@ APIRET APIENTRY  DosSubFreeMem(PVOID pbBase,
                 return 87; //invalid parameter
         if(cb==0)
                 return 0;
-        if((char*)pb < (char*)pbBase+sizeof(struct HeapHeader))
+        if((char*)pb < (char*)pbBase+sizeof(struct HeapHeader) ||
+           (((char*)pb - (char*)pbBase) & 7))
                 return 87; //invalid parameter FixMe
 
+        //blocks were handed out in multiples of 8
+        cb = (cb+7)&0xFFFFFFF8;
+
         if(hh->flags&DOSSUB_SERIALIZE)
                 DosAcquireSpinLock(hh->lock);//hh->lock.Request();
 
 
-        if((char*)pb+cb >= (char*)pbBase+hh->size) {
+        if((char*)pb+cb > (char*)pbBase+hh->size) {
                 rc = 87; //FixMe
         } else {
-                struct FreeHeapBlock *p;
-                if(hh->firstFree) {
-                        p = hh->firstFree;
-                        if((char*)p < (char*)pb) {
-                                while(p->next && (char*)p->next<(char*)pb)
-                                        p=p->next;
-                                if((char*)pb == (char*)p+p->size) {
-                                        //join with previous
-                                        p->size += cb;
-                                } else {
-                                        ((struct FreeHeapBlock*)pb)->next = p->next;
-                                        ((struct FreeHeapBlock*)pb)->size = cb;
-                                        p->next = (struct FreeHeapBlock*)pb;
-                                        p=p->next;
-                                }
-                        } else {
-                                //insert at front
-                                p = (struct FreeHeapBlock*)pb;
-                                p->size = cb;
-                                p->next = hh->firstFree;
-                                hh->firstFree = p;
-                        }
-                        if((char*)p+p->size == (char*)p->next) {
-                                //join with next
-                                p->size += p->next->size;
-                                p->next = p->next->next;
-                        }
-                } else {
-                        p = (struct FreeHeapBlock*)pb;
-                        p->next = hh->firstFree;
-                        p->size = cb;
-                        hh->firstFree = p;
-                }
+                BinPush(hh, (struct FreeHeapBlock*)pb, cb);
                 rc = 0;
         }
 
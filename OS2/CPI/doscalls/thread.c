@@ -1,3 +1,4 @@
+#define TRACE_SUBSYS TRC_PROC
 #include "kal.h"
 
 typedef VOID (APIENTRY *PFNTHREAD)(const ULONG ul);
@@ -15,8 +15,6 @@
 #include <stdio.h>
 #include <stdarg.h>
 
-APIRET __cdecl KalLogWrite(PSZ s);
-
 typedef struct _QMRESULT{
     USHORT seg;
     USHORT htme;
@@ -25,17 +23,7 @@ typedef struct _QMRESULT{
 
 typedef QMRESULT *PQMRESULT;
 
-void log(const char *fmt, ...)
-{
-  va_list arg_ptr;
-  char buf[1024];
-
-  va_start(arg_ptr, fmt);
-  vsprintf(buf, fmt, arg_ptr);
-  va_end(arg_ptr);
-
-  KalLogWrite (buf);
-}
+void log(const char *fmt, ...);
 
 APIRET unimplemented(char *func)
 {
@@ -552,66 +540,6 @@ APIRET APIENTRY DosDebug(PVOID pdbgbuf)
 }
 
 
-APIRET APIENTRY DosResetEventSem(HEV hev, PULONG pulPostCt)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
-APIRET APIENTRY DosPostEventSem(HEV hev)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
-APIRET APIENTRY DosWaitEventSem(HEV hev, ULONG ulTimeout)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
-APIRET APIENTRY DosQueryEventSem(HEV hev, PULONG pulPostCt)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
-APIRET APIENTRY DosCreateMutexSem(PCSZ pszName, PHMTX phmtx, ULONG flAttr, BOOL32 fState)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
-APIRET APIENTRY DosOpenMutexSem(PCSZ pszName, PHMTX phmtx)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
-APIRET APIENTRY DosCloseMutexSem(HMTX hmtx)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
-APIRET APIENTRY DosRequestMutexSem(HMTX hmtx, ULONG ulTimeout)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
-APIRET APIENTRY DosReleaseMutexSem(HMTX hmtx)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
-APIRET APIENTRY DosQueryMutexSem(HMTX hmtx, PPID ppid, PTID ptid, PULONG pulCount)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
 APIRET APIENTRY DosCreateMuxWaitSem(PCSZ pszName, PHMUX phmux, ULONG cSemRec, PSEMRECORD pSemRec, ULONG flAttr)
 {
   return unimplemented(__FUNCTION__);
@@ -1700,12 +1628,6 @@ APIRET APIENTRY      DosSGQueryTopmost(void)
 }
 
 
-APIRET APIENTRY      DosPerfSysCall(ULONG ulCommand, ULONG ulParm1, ULONG ulParm2, ULONG ulParm3)
-{
-  return unimplemented(__FUNCTION__);
-}
-
-
 APIRET APIENTRY  DosProtectOpenL(PCSZ  pszFileName,
                                  PHFILE phf,
                                  PULONG pulAction,
@@ -1,3 +1,4 @@
+#define TRACE_SUBSYS TRC_PROC
 #include "kal.h"
 
 APIRET APIENTRY      DosSetExceptionHandler(PEXCEPTIONREGISTRATIONRECORD pERegRec)
@@ -8,6 +8,8 @@
 #include <os2.h>
 #include <stdio.h>
 
+#include "lvb.h"
+
 /* Copy declaration so we don't need INCL_KBD */
 //#define  DO_KBD
 //#include <copied_decl.h>
@@ -32,6 +34,9 @@ KbdStringIn (PCH pch,
   if (!pch || !pchin || !pchin->cb)
     return 373; //ERROR_KBD_PARAMETER
 
+  // Show the screen before waiting for the user
+  LvbFlush(TRUE);
+
   if (DosRead (0, pch, pchin->cb, &nread) == 0 /* NO_ERROR */)
   {
     if (nread)
@@ -0,0 +1,644 @@
+/*!
+
+   @file lvb.c
+
+   @brief Logical video buffer of sub32.
+
+   VioWrtCellStr, VioWrtCharStr, VioWrtN* and the VioScroll* calls on
+   the default handle only change a shadow cell array here and mark the
+   touched span of each row dirty.  LvbFlush compares the dirty spans
+   with a copy of what was last sent and writes just the changed runs
+   to the console as ANSI sequences, in one DosWrite per buffer full.
+   Timed flushes happen at most every LVB_FLUSH_MS; VioWrtTTY, keyboard
+   input, VioShowBuf and process exit flush at once, so a full screen
+   application pays for device output once per frame instead of once
+   per call.
+
+   The buffer is per process (sub32 has manyautodata).
+
+   (c) osFree Project, <http://www.osFree.org>
+   for licence see legal file in same directory as this source
+
+*/
+
+#define INCL_BSE
+#define INCL_VIO
+#define INCL_DOSERRORS
+#define INCL_DOSSEMAPHORES
+#define INCL_DOSPROCESS
+#define INCL_DOSMISC
+#include <os2.h>
+
+#include <string.h>
+#include <stdio.h>
+
+#include "lvb.h"
+
+#define LVB_GAP         4       /* unchanged cells worth rewriting to save a cursor move */
+#define LVB_OUTSIZE     4096    /* escape sequence buffer */
+
+static BYTE   Cells[LVB_MAXROWS * LVB_MAXCOLS * 2];   /* char, attr pairs */
+static BYTE   Shown[LVB_MAXROWS * LVB_MAXCOLS * 2];   /* what the console has */
+static BOOL   fRowShown[LVB_MAXROWS];                 /* Shown is valid for the row */
+static USHORT usDirtyLo[LVB_MAXROWS];                 /* dirty columns, lo > hi if clean */
+static USHORT usDirtyHi[LVB_MAXROWS];
+static BOOL   fDirty = FALSE;
+
+static USHORT usRows = 25;
+static USHORT usCols = 80;
+static USHORT usCurRow = 0;
+static USHORT usCurCol = 0;
+static BOOL   fCurKnown = FALSE;       /* VioSetCurPos was called since the last TTY output */
+
+static BOOL   fInit = FALSE;
+static HMTX   hmtxLvb = NULLHANDLE;
+static ULONG  ulLastFlush = 0;
+
+static CHAR   achOut[LVB_OUTSIZE];
+static ULONG  cbOut = 0;
+static BYTE   bOutAttr = 0;
+static BOOL   fOutAttr = FALSE;        /* bOutAttr is what the console uses */
+
+/* CGA colour index to ANSI colour index */
+static const CHAR achAnsiColor[8] = {'0', '4', '2', '6', '1', '5', '3', '7'};
+
+static VOID APIENTRY LvbExit(ULONG ulReason);
+
+static VOID LvbClearRows(USHORT usFrom, USHORT usTo)
+{
+  USHORT i;
+
+  for (i = usFrom * usCols * 2; i < usTo * usCols * 2; i += 2)
+  {
+    Cells[i] = ' ';
+    Cells[i + 1] = 0x07;
+  }
+}
+
+static VOID LvbMarkAllDirty(VOID)
+{
+  USHORT i;
+
+  for (i = 0; i < usRows; i++)
+  {
+    usDirtyLo[i] = 0;
+    usDirtyHi[i] = usCols - 1;
+  }
+  fDirty = TRUE;
+}
+
+static VOID LvbInit(VOID)
+{
+  USHORT i;
+
+  DosCreateMutexSem(NULL, &hmtxLvb, 0, FALSE);
+  LvbClearRows(0, usRows);
+  for (i = 0; i < LVB_MAXROWS; i++)
+  {
+    fRowShown[i] = FALSE;
+    usDirtyLo[i] = 1;
+    usDirtyHi[i] = 0;
+  }
+  DosExitList(EXLST_ADD | 0x9F00, (PFNEXITLIST)LvbExit);
+  fInit = TRUE;
+}
+
+static VOID LvbLock(VOID)
+{
+  if (!fInit)
+    LvbInit();
+  DosRequestMutexSem(hmtxLvb, SEM_INDEFINITE_WAIT);
+}
+
+static VOID LvbUnlock(VOID)
+{
+  DosReleaseMutexSem(hmtxLvb);
+}
+
+static VOID LvbTouch(USHORT usRow, USHORT usLo, USHORT usHi)
+{
+  if (usDirtyLo[usRow] > usDirtyHi[usRow])
+  {
+    usDirtyLo[usRow] = usLo;
+    usDirtyHi[usRow] = usHi;
+  } else {
+    if (usLo < usDirtyLo[usRow]) usDirtyLo[usRow] = usLo;
+    if (usHi > usDirtyHi[usRow]) usDirtyHi[usRow] = usHi;
+  }
+  fDirty = TRUE;
+}
+
+/* Marks the cells from offset ulFrom to ulTo (cell numbers) dirty */
+static VOID LvbTouchRange(ULONG ulFrom, ULONG ulTo)
+{
+  USHORT usRow;
+
+  for (usRow = (USHORT)(ulFrom / usCols); usRow <= ulTo / usCols; usRow++)
+    LvbTouch(usRow,
+             (USHORT)(usRow == ulFrom / usCols ? ulFrom % usCols : 0),
+             (USHORT)(usRow == ulTo / usCols ? ulTo % usCols : usCols - 1));
+}
+
+static VOID LvbOutFlush(VOID)
+{
+  ULONG ulActual;
+
+  if (cbOut)
+    DosWrite(1, achOut, cbOut, &ulActual);
+  cbOut = 0;
+}
+
+static VOID LvbOut(const CHAR *pch, ULONG cb)
+{
+  if (cbOut + cb > LVB_OUTSIZE)
+    LvbOutFlush();
+  memcpy(achOut + cbOut, pch, cb);
+  cbOut += cb;
+}
+
+static VOID LvbOutPos(USHORT usRow, USHORT usCol)
+{
+  CHAR achSeq[16];
+
+  LvbOut(achSeq, sprintf(achSeq, "\x1b[%u;%uH", usRow + 1, usCol + 1));
+}
+
+static VOID LvbOutAttr(BYTE bAttr)
+{
+  CHAR achSeq[24];
+  ULONG cb;
+
+  if (fOutAttr && bAttr == bOutAttr)
+    return;
+
+  cb = sprintf(achSeq, "\x1b[0;%s%s3%c;4%cm",
+               (bAttr & 0x08) ? "1;" : "",
+               (bAttr & 0x80) ? "5;" : "",
+               achAnsiColor[bAttr & 0x07],
+               achAnsiColor[(bAttr >> 4) & 0x07]);
+  LvbOut(achSeq, cb);
+  bOutAttr = bAttr;
+  fOutAttr = TRUE;
+}
+
+/* Sends one run of cells of a row; the caller has positioned the cursor */
+static VOID LvbOutRun(USHORT usRow, USHORT usLo, USHORT usHi)
+{
+  BYTE *pCell = Cells + (usRow * usCols + usLo) * 2;
+  USHORT usCol;
+  CHAR ch;
+
+  /* the console scrolls after the bottom right cell, so that one is left out */
+  if (usRow == usRows - 1 && usHi == usCols - 1)
+    usHi--;
+
+  for (usCol = usLo; usCol <= usHi && usHi < usCols; usCol++, pCell += 2)
+  {
+    LvbOutAttr(pCell[1]);
+    ch = pCell[0];
+    if ((BYTE)ch < ' ' || ch == 0x7f)   /* keep control codes off the console */
+      ch = ' ';
+    LvbOut(&ch, 1);
+  }
+}
+
+/* Sends the changed runs of one dirty row and updates Shown */
+static VOID LvbFlushRow(USHORT usRow)
+{
+  ULONG  ulBase = usRow * usCols * 2;
+  USHORT usLo = usDirtyLo[usRow];
+  USHORT usHi = usDirtyHi[usRow];
+  USHORT usCol, usRunLo, usRunHi, usSame;
+
+  if (usHi >= usCols)
+    usHi = usCols - 1;
+
+  if (!fRowShown[usRow])
+  {
+    LvbOutPos(usRow, usLo);
+    LvbOutRun(usRow, usLo, usHi);
+  } else {
+    usCol = usLo;
+    while (usCol <= usHi)
+    {
+      /* skip cells the console already shows */
+      while (usCol <= usHi &&
+             *(USHORT *)(Cells + ulBase + usCol * 2) ==
+             *(USHORT *)(Shown + ulBase + usCol * 2))
+        usCol++;
+      if (usCol > usHi)
+        break;
+
+      /* extend the run over short stretches of unchanged cells */
+      usRunLo = usRunHi = usCol;
+      for (usSame = 0, usCol++; usCol <= usHi && usSame <= LVB_GAP; usCol++)
+        if (*(USHORT *)(Cells + ulBase + usCol * 2) ==
+            *(USHORT *)(Shown + ulBase + usCol * 2))
+          usSame++;
+        else {
+          usSame = 0;
+          usRunHi = usCol;
+        }
+
+      LvbOutPos(usRow, usRunLo);
+      LvbOutRun(usRow, usRunLo, usRunHi);
+      usCol = usRunHi + 1;
+    }
+  }
+
+  memcpy(Shown + ulBase + usLo * 2, Cells + ulBase + usLo * 2,
+         (usHi - usLo + 1) * 2);
+  if (usLo == 0 && usHi == usCols - 1)
+    fRowShown[usRow] = TRUE;
+
+  usDirtyLo[usRow] = 1;
+  usDirtyHi[usRow] = 0;
+}
+
+/* Flushes with the lock held */
+static VOID LvbFlushLocked(BOOL fForce)
+{
+  ULONG  ulNow;
+  USHORT usRow;
+
+  if (!fDirty)
+    return;
+
+  DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ulNow, sizeof(ulNow));
+  if (!fForce && ulNow - ulLastFlush < LVB_FLUSH_MS)
+    return;
+  ulLastFlush = ulNow;
+
+  for (usRow = 0; usRow < usRows; usRow++)
+    if (usDirtyLo[usRow] <= usDirtyHi[usRow])
+      LvbFlushRow(usRow);
+
+  if (fCurKnown)
+    LvbOutPos(usCurRow, usCurCol);
+
+  LvbOutFlush();
+  fDirty = FALSE;
+}
+
+/*!
+  Pushes the dirty spans to the console, at most every LVB_FLUSH_MS
+  unless fForce is set
+*/
+VOID LvbFlush(BOOL fForce)
+{
+  if (!fInit)
+    return;
+
+  LvbLock();
+  LvbFlushLocked(fForce);
+  LvbUnlock();
+}
+
+/*!
+  Forgets what the console shows, after output that did not go through
+  the buffer (VioWrtTTY): every dirty span is then sent in full
+*/
+VOID LvbInvalidate(VOID)
+{
+  USHORT i;
+
+  if (!fInit)
+    return;
+
+  LvbLock();
+  for (i = 0; i < LVB_MAXROWS; i++)
+    fRowShown[i] = FALSE;
+  fOutAttr = FALSE;
+  fCurKnown = FALSE;
+  LvbUnlock();
+}
+
+static VOID APIENTRY LvbExit(ULONG ulReason)
+{
+  LvbFlush(TRUE);
+  DosExitList(EXLST_EXIT, NULL);
+}
+
+/* Checks a position, the way the Vio calls report it */
+static USHORT LvbCheckPos(USHORT usRow, USHORT usCol)
+{
+  if (usRow >= usRows)
+    return ERROR_VIO_ROW;
+  if (usCol >= usCols)
+    return ERROR_VIO_COL;
+  return NO_ERROR;
+}
+
+/*!
+  VioWrtCellStr: cb bytes of char, attr pairs, wrapping at the end of a
+  row and stopping at the end of the screen
+*/
+USHORT LvbWriteCells(const BYTE *pCells, ULONG cb, USHORT usRow, USHORT usCol)
+{
+  ULONG ulStart, ulCount;
+  USHORT rc;
+
+  if ((rc = LvbCheckPos(usRow, usCol)) != NO_ERROR)
+    return rc;
+
+  LvbLock();
+  ulStart = usRow * usCols + usCol;
+  ulCount = cb / 2;
+  if (ulStart + ulCount > (ULONG)usRows * usCols)
+    ulCount = (ULONG)usRows * usCols - ulStart;
+  if (ulCount)
+  {
+    memcpy(Cells + ulStart * 2, pCells, ulCount * 2);
+    LvbTouchRange(ulStart, ulStart + ulCount - 1);
+    LvbFlushLocked(FALSE);
+  }
+  LvbUnlock();
+
+  return NO_ERROR;
+}
+
+/*!
+  VioWrtCharStr (pAttr NULL, attributes stay) and VioWrtCharStrAtt
+*/
+USHORT LvbWriteChars(const CHAR *pch, ULONG cb, USHORT usRow, USHORT usCol,
+                     const BYTE *pAttr)
+{
+  ULONG ulStart, ulCount, i;
+  BYTE *pCell;
+  USHORT rc;
+
+  if ((rc = LvbCheckPos(usRow, usCol)) != NO_ERROR)
+    return rc;
+
+  LvbLock();
+  ulStart = usRow * usCols + usCol;
+  ulCount = cb;
+  if (ulStart + ulCount > (ULONG)usRows * usCols)
+    ulCount = (ULONG)usRows * usCols - ulStart;
+  pCell = Cells + ulStart * 2;
+  for (i = 0; i < ulCount; i++, pCell += 2)
+  {
+    pCell[0] = pch[i];
+    if (pAttr)
+      pCell[1] = *pAttr;
+  }
+  if (ulCount)
+  {
+    LvbTouchRange(ulStart, ulStart + ulCount - 1);
+    LvbFlushLocked(FALSE);
+  }
+  LvbUnlock();
+
+  return NO_ERROR;
+}
+
+/*!
+  VioWrtNCell, VioWrtNChar and VioWrtNAttr: cCells copies of a char
+  and/or attribute, -1 leaves that half of the cell alone
+*/
+USHORT LvbFill(ULONG cCells, USHORT usRow, USHORT usCol, SHORT sChar, SHORT sAttr)
+{
+  ULONG ulStart, i;
+  BYTE *pCell;
+  USHORT rc;
+
+  if ((rc = LvbCheckPos(usRow, usCol)) != NO_ERROR)
+    return rc;
+
+  LvbLock();
+  ulStart = usRow * usCols + usCol;
+  if (ulStart + cCells > (ULONG)usRows * usCols)
+    cCells = (ULONG)usRows * usCols - ulStart;
+  pCell = Cells + ulStart * 2;
+  for (i = 0; i < cCells; i++, pCell += 2)
+  {
+    if (sChar >= 0)
+      pCell[0] = (BYTE)sChar;
+    if (sAttr >= 0)
+      pCell[1] = (BYTE)sAttr;
+  }
+  if (cCells)
+  {
+    LvbTouchRange(ulStart, ulStart + cCells - 1);
+    LvbFlushLocked(FALSE);
+  }
+  LvbUnlock();
+
+  return NO_ERROR;
+}
+
+/*!
+  VioReadCellStr (fCells) and VioReadCharStr, straight from the shadow
+*/
+USHORT LvbRead(CHAR *pch, USHORT *pcb, USHORT usRow, USHORT usCol, BOOL fCells)
+{
+  ULONG ulStart, ulCount, i;
+  USHORT rc;
+
+  if ((rc = LvbCheckPos(usRow, usCol)) != NO_ERROR)
+    return rc;
+
+  LvbLock();
+  ulStart = usRow * usCols + usCol;
+  ulCount = fCells ? *pcb / 2 : *pcb;
+  if (ulStart + ulCount > (ULONG)usRows * usCols)
+    ulCount = (ULONG)usRows * usCols - ulStart;
+  if (fCells)
+  {
+    memcpy(pch, Cells + ulStart * 2, ulCount * 2);
+    *pcb = (USHORT)(ulCount * 2);
+  } else {
+    for (i = 0; i < ulCount; i++)
+      pch[i] = Cells[(ulStart + i) * 2];
+    *pcb = (USHORT)ulCount;
+  }
+  LvbUnlock();
+
+  return NO_ERROR;
+}
+
+/*!
+  VioScrollUp/Dn/Lf/Rt: moves the rectangle by cLines rows (or columns)
+  and fills the freed part with pCell.  Too large counts (0xFFFF) clear
+  the rectangle; edges beyond the screen are clipped.
+*/
+USHORT LvbScroll(USHORT usTop, USHORT usLeft, USHORT usBot, USHORT usRight,
+                 USHORT cLines, const BYTE *pCell, ULONG ulDir)
+{
+  USHORT usRow, usCol, usHeight, usWidth, usShift;
+  BYTE *pDst;
+
+  if (pCell == NULL)
+    return ERROR_VIO_INVALID_PARMS;
+
+  if (usBot >= usRows)   usBot = usRows - 1;
+  if (usRight >= usCols) usRight = usCols - 1;
+  if (usTop > usBot || usLeft > usRight)
+    return ERROR_VIO_INVALID_PARMS;
+  if (cLines == 0)
+    return NO_ERROR;
+
+  LvbLock();
+  usHeight = usBot - usTop + 1;
+  usWidth = usRight - usLeft + 1;
+  usShift = cLines;
+
+  switch (ulDir)
+  {
+    case LVB_UP:
+    case LVB_DOWN:
+      if (usShift > usHeight)
+        usShift = usHeight;
+      for (usRow = 0; usRow < usHeight - usShift; usRow++)
+      {
+        if (ulDir == LVB_UP)
+          memmove(Cells + ((usTop + usRow) * usCols + usLeft) * 2,
+                  Cells + ((usTop + usRow + usShift) * usCols + usLeft) * 2,
+                  usWidth * 2);
+        else
+          memmove(Cells + ((usBot - usRow) * usCols + usLeft) * 2,
+                  Cells + ((usBot - usRow - usShift) * usCols + usLeft) * 2,
+                  usWidth * 2);
+      }
+      for (usRow = 0; usRow < usShift; usRow++)
+      {
+        pDst = Cells + (((ulDir == LVB_UP) ? usBot - usRow : usTop + usRow) *
+                        usCols + usLeft) * 2;
+        for (usCol = 0; usCol < usWidth; usCol++, pDst += 2)
+        {
+          pDst[0] = pCell[0];
+          pDst[1] = pCell[1];
+        }
+      }
+      break;
+
+    default:
+      if (usShift > usWidth)
+        usShift = usWidth;
+      for (usRow = usTop; usRow <= usBot; usRow++)
+      {
+        pDst = Cells + (usRow * usCols + usLeft) * 2;
+        if (ulDir == LVB_LEFT)
+        {
+          memmove(pDst, pDst + usShift * 2, (usWidth - usShift) * 2);
+          pDst += (usWidth - usShift) * 2;
+        } else {
+          memmove(pDst + usShift * 2, pDst, (usWidth - usShift) * 2);
+        }
+        for (usCol = 0; usCol < usShift; usCol++, pDst += 2)
+        {
+          pDst[0] = pCell[0];
+          pDst[1] = pCell[1];
+        }
+      }
+      break;
+  }
+
+  for (usRow = usTop; usRow <= usBot; usRow++)
+    LvbTouch(usRow, usLeft, usRight);
+  LvbFlushLocked(FALSE);
+  LvbUnlock();
+
+  return NO_ERROR;
+}
+
+/*!
+  VioSetCurPos: remembered, and sent at the end of the next flush
+*/
+USHORT LvbSetCurPos(USHORT usRow, USHORT usCol)
+{
+  USHORT rc;
+
+  if ((rc = LvbCheckPos(usRow, usCol)) != NO_ERROR)
+    return rc;
+
+  LvbLock();
+  usCurRow = usRow;
+  usCurCol = usCol;
+  fCurKnown = TRUE;
+  fDirty = TRUE;
+  LvbFlushLocked(FALSE);
+  LvbUnlock();
+
+  return NO_ERROR;
+}
+
+/*!
+  VioGetCurPos: ERROR_VIO_INVALID_HANDLE if the position is not known
+  (never set, or lost to TTY output), so the caller can ask elsewhere
+*/
+USHORT LvbGetCurPos(USHORT *pusRow, USHORT *pusCol)
+{
+  if (!fInit || !fCurKnown)
+    return ERROR_VIO_INVALID_HANDLE;
+
+  *pusRow = usCurRow;
+  *pusCol = usCurCol;
+
+  return NO_ERROR;
+}
+
+/*!
+  VioSetMode: takes the new text size, clears and repaints the buffer
+*/
+USHORT LvbSetSize(USHORT usNewRows, USHORT usNewCols)
+{
+  USHORT i;
+
+  if (usNewRows == 0 || usNewRows > LVB_MAXROWS ||
+      usNewCols == 0 || usNewCols > LVB_MAXCOLS)
+    return ERROR_VIO_INVALID_PARMS;
+
+  LvbLock();
+  usRows = usNewRows;
+  usCols = usNewCols;
+  LvbClearRows(0, usRows);
+  for (i = 0; i < LVB_MAXROWS; i++)
+    fRowShown[i] = FALSE;
+  LvbMarkAllDirty();
+  if (usCurRow >= usRows || usCurCol >= usCols)
+    usCurRow = usCurCol = 0;
+  LvbFlushLocked(TRUE);
+  LvbUnlock();
+
+  return NO_ERROR;
+}
+
+/*!
+  VioGetBuf: hands out the shadow itself; the application shows its
+  changes with VioShowBuf
+*/
+USHORT LvbGetBuf(PULONG pLVB, PUSHORT pcbLVB)
+{
+  if (!fInit)
+  {
+    LvbLock();
+    LvbUnlock();
+  }
+
+  *pLVB = (ULONG)Cells;
+  *pcbLVB = usRows * usCols * 2;
+
+  return NO_ERROR;
+}
+
+/*!
+  VioShowBuf: cb bytes from offset offLVB changed behind our back
+*/
+USHORT LvbShowBuf(USHORT offLVB, USHORT cb)
+{
+  if (offLVB >= usRows * usCols * 2)
+    return ERROR_VIO_INVALID_PARMS;
+
+  if (offLVB + cb > usRows * usCols * 2)
+    cb = usRows * usCols * 2 - offLVB;
+  if (cb == 0)
+    return NO_ERROR;
+
+  LvbLock();
+  LvbTouchRange(offLVB / 2, (offLVB + cb - 1) / 2);
+  LvbFlushLocked(TRUE);
+  LvbUnlock();
+
+  return NO_ERROR;
+}
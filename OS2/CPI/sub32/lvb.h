@@ -0,0 +1,43 @@
+/*!
+
+   @file lvb.h
+
+   @brief Logical video buffer of sub32: a shadow of the text screen
+   that the Vio text calls update for the default handle, and that is
+   pushed to the console in changed spans only.
+
+   (c) osFree Project, <http://www.osFree.org>
+   for licence see legal file in same directory as this source
+
+*/
+
+#ifndef _LVB_H_
+#define _LVB_H_
+
+#define LVB_MAXROWS     60      /* largest text mode kept */
+#define LVB_MAXCOLS     132
+
+#define LVB_FLUSH_MS    30      /* least time between two timed flushes */
+
+/* LvbScroll directions */
+#define LVB_UP          0
+#define LVB_DOWN        1
+#define LVB_LEFT        2
+#define LVB_RIGHT       3
+
+USHORT LvbWriteCells(const BYTE *pCells, ULONG cb, USHORT usRow, USHORT usCol);
+USHORT LvbWriteChars(const CHAR *pch, ULONG cb, USHORT usRow, USHORT usCol,
+                     const BYTE *pAttr);
+USHORT LvbFill(ULONG cCells, USHORT usRow, USHORT usCol, SHORT sChar, SHORT sAttr);
+USHORT LvbRead(CHAR *pch, USHORT *pcb, USHORT usRow, USHORT usCol, BOOL fCells);
+USHORT LvbScroll(USHORT usTop, USHORT usLeft, USHORT usBot, USHORT usRight,
+                 USHORT cLines, const BYTE *pCell, ULONG ulDir);
+USHORT LvbSetCurPos(USHORT usRow, USHORT usCol);
+USHORT LvbGetCurPos(USHORT *pusRow, USHORT *pusCol);
+USHORT LvbSetSize(USHORT usRows, USHORT usCols);
+USHORT LvbGetBuf(PULONG pLVB, PUSHORT pcbLVB);
+USHORT LvbShowBuf(USHORT offLVB, USHORT cb);
+VOID   LvbFlush(BOOL fForce);
+VOID   LvbInvalidate(VOID);
+
+#endif /* _LVB_H_ */
@@ -21,6 +21,8 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+#include "lvb.h"
+
 APIRET APIENTRY DosLogWrite(PSZ s);
 
 void log(const char *fmt, ...)
@@ -59,6 +61,7 @@ USHORT APIENTRY KbdDeRegister(VOID)
 
 USHORT APIENTRY KbdCharIn(KBDKEYINFO * pkbci, const USHORT fWait, const HKBD hkbd)
 {
+  LvbFlush(TRUE);
   return unimplemented(__FUNCTION__);
 }
 
@@ -2,6 +2,9 @@
 #define INCL_PMAVIO
 #include <os2.h>
 #include "bvs.h"
+#include "lvb.h"
+
+#include <stddef.h>
 
 APIRET unimplemented(char *func);
 //APIRET APIENTRY BVSMain(ULONG fn, ARGS args);
@@ -170,6 +173,9 @@ USHORT APIENTRY VioGetCp(const USHORT Reserved, USHORT * IdCodePage, const HVIO
 USHORT APIENTRY VioGetCurPos(USHORT * Row, USHORT * Column, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0 && LvbGetCurPos(Row, Column)==NO_ERROR)
+		return NO_ERROR;
 	
 	args.GetCurPos.Row=Row;
 	args.GetCurPos.Column=Column;
@@ -204,6 +210,9 @@ USHORT APIENTRY VioGetMode(VIOMODEINFO * ModeInfo, const HVIO Handle)
 USHORT APIENTRY VioReadCellStr(CHAR * CellStr, USHORT * Count, const USHORT Row, const USHORT Column, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbRead(CellStr, Count, Row, Column, TRUE);
 	
 	args.ReadCellStr.CellStr=CellStr;
 	args.ReadCellStr.Count=Count;
@@ -218,6 +227,9 @@ USHORT APIENTRY VioReadCellStr(CHAR * CellStr, USHORT * Count, const USHORT Row,
 USHORT APIENTRY VioReadCharStr(CHAR * CellStr, USHORT * Count, const USHORT Row, const USHORT Column, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbRead(CellStr, Count, Row, Column, FALSE);
 	
 	args.ReadCharStr.CellStr=CellStr;
 	args.ReadCharStr.Count=Count;
@@ -232,6 +244,9 @@ USHORT APIENTRY VioReadCharStr(CHAR * CellStr, USHORT * Count, const USHORT Row,
 USHORT APIENTRY VioScrollDn(const USHORT TopRow, const USHORT LeftCol, const USHORT BotRow, const USHORT RightCol, const USHORT Lines, const PBYTE Cell, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbScroll(TopRow, LeftCol, BotRow, RightCol, Lines, Cell, LVB_DOWN);
 	
 	args.ScrollDn.TopRow=TopRow;
 	args.ScrollDn.LeftCol=LeftCol;
@@ -249,6 +264,9 @@ USHORT APIENTRY VioScrollLf(const USHORT TopRow, const USHORT LeftCol, const USH
 {
 	ARGS args;
 
+	if (Handle==0)
+		return LvbScroll(TopRow, LeftCol, BotRow, RightCol, Columns, Cell, LVB_LEFT);
+
 
 	args.ScrollLf.usTopRow=TopRow;
 	args.ScrollLf.usLeftCol=LeftCol;
@@ -265,6 +283,9 @@ USHORT APIENTRY VioScrollLf(const USHORT TopRow, const USHORT LeftCol, const USH
 USHORT APIENTRY VioScrollUp(const USHORT TopRow, const USHORT LeftCol, const USHORT BotRow, const USHORT RightCol, const USHORT Lines, const PBYTE Cell, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbScroll(TopRow, LeftCol, BotRow, RightCol, Lines, Cell, LVB_UP);
 	
 	args.ScrollUp.TopRow=TopRow;
 	args.ScrollUp.LeftCol=LeftCol;
@@ -303,6 +324,9 @@ USHORT APIENTRY VioSetCp(const USHORT Reserved, const USHORT IdCodePage, const H
 USHORT APIENTRY VioSetCurPos(const USHORT Row, const USHORT Column, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbSetCurPos(Row, Column);
 	
 	args.SetCurPos.Row=Row;
 	args.SetCurPos.Column=Column;
@@ -326,6 +350,10 @@ USHORT APIENTRY VioSetCurType(const PVIOCURSORINFO CursorInfo, const HVIO Handle
 USHORT APIENTRY VioSetMode(const PVIOMODEINFO ModeInfo, const HVIO hvio)
 {
 	ARGS args;
+
+	if (hvio==0 && ModeInfo!=NULL && ModeInfo->cb>=offsetof(VIOMODEINFO, row)+sizeof(ModeInfo->row) &&
+	    !(ModeInfo->fbType & VGMT_GRAPHICS))
+		LvbSetSize(ModeInfo->row, ModeInfo->col);
 	
 	args.SetMode.ModeInfo=ModeInfo;
 	args.SetMode.hvio=hvio;
@@ -337,6 +365,9 @@ USHORT APIENTRY VioSetMode(const PVIOMODEINFO ModeInfo, const HVIO hvio)
 USHORT APIENTRY VioWrtCellStr(const PCHAR CellStr, const USHORT Count, const USHORT Row, const USHORT Column, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbWriteCells((const BYTE *)CellStr, Count, Row, Column);
 	
 	args.WrtCellStr.CellStr=CellStr;
 	args.WrtCellStr.Count=Count;
@@ -351,6 +382,9 @@ USHORT APIENTRY VioWrtCellStr(const PCHAR CellStr, const USHORT Count, const USH
 USHORT APIENTRY VioWrtCharStr(const PCHAR Str, const USHORT Count, const USHORT Row, const USHORT Column, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbWriteChars(Str, Count, Row, Column, NULL);
 	
 	args.WrtCharStr.Str=Str;
 	args.WrtCharStr.Count=Count;
@@ -365,6 +399,9 @@ USHORT APIENTRY VioWrtCharStr(const PCHAR Str, const USHORT Count, const USHORT
 USHORT APIENTRY VioWrtCharStrAtt(const PCHAR Str, const USHORT Count, const USHORT Row, const USHORT Column, const PBYTE pAttr, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbWriteChars(Str, Count, Row, Column, pAttr);
 	
 	args.WrtCharStrAtt.Str=Str;
 	args.WrtCharStrAtt.Count=Count;
@@ -380,6 +417,9 @@ USHORT APIENTRY VioWrtCharStrAtt(const PCHAR Str, const USHORT Count, const USHO
 USHORT APIENTRY VioWrtNAttr(const PBYTE Attr, const USHORT Count, const USHORT Row, const USHORT Column, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbFill(Count, Row, Column, -1, *Attr);
 	
 	args.WrtNAttr.Attr=Attr;
 	args.WrtNAttr.Count=Count;
@@ -394,6 +434,9 @@ USHORT APIENTRY VioWrtNAttr(const PBYTE Attr, const USHORT Count, const USHORT R
 USHORT APIENTRY VioWrtNCell(const PBYTE Cell, const USHORT Count, const USHORT Row, const USHORT Column, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbFill(Count, Row, Column, Cell[0], Cell[1]);
 	
 	args.WrtNCell.Cell=Cell;
 	args.WrtNCell.Count=Count;
@@ -408,6 +451,9 @@ USHORT APIENTRY VioWrtNCell(const PBYTE Cell, const USHORT Count, const USHORT R
 USHORT APIENTRY VioWrtNChar(const PCHAR Char, const USHORT Count, const USHORT Row, const USHORT Column, const HVIO Handle)
 {
 	ARGS args;
+
+	if (Handle==0)
+		return LvbFill(Count, Row, Column, (BYTE)*Char, -1);
 	
 	args.WrtNChar.Char=Char;
 	args.WrtNChar.Count=Count;
@@ -498,6 +544,9 @@ USHORT APIENTRY VioScrollRt (USHORT usTopRow,
                             HVIO hvio)
 {
 	ARGS args;
+
+	if (hvio==0)
+		return LvbScroll(usTopRow, usLeftCol, usBotRow, usRightCol, cbCol, pCell, LVB_RIGHT);
 	
 	args.ScrollRt.usTopRow=usTopRow;
 	args.ScrollRt.usLeftCol=usLeftCol;
@@ -590,6 +639,9 @@ USHORT APIENTRY VioGetBuf (PULONG pLVB,
                           HVIO hvio)
 {
 	ARGS args;
+
+	if (hvio==0)
+		return LvbGetBuf(pLVB, pcbLVB);
 	
 	args.GetBuf.pLVB=pLVB;
 	args.GetBuf.pcbLVB=pcbLVB;
@@ -630,6 +682,9 @@ USHORT APIENTRY VioShowBuf (USHORT offLVB,
                              HVIO hvio)
 {
 	ARGS args;
+
+	if (hvio==0)
+		return LvbShowBuf(offLVB, cb);
 	
 	args.ShowBuf.offLVB=offLVB;
 	args.ShowBuf.cb=cb;
@@ -3,6 +3,8 @@
 #define INCL_DOSERRORS
 #include <os2.h>
 
+#include "lvb.h"
+
 /* Copy declaration so we don't need INCL_VIO */
 //#define  DO_VIO
 //#include <copied_decl.h>
@@ -20,7 +22,11 @@ USHORT APIENTRY VioWrtTTY(const PCHAR Str, const USHORT Count, const HVIO Handle
 
   if (Handle==0)
   {
+    // Cell writes still in the buffer go first, and what the console
+    // shows afterwards is no longer known to it
+    LvbFlush(TRUE);
     rc=DosWrite(1, Str, Count, &ulActual);
+    LvbInvalidate();
   } else {
     rc=ERROR_VIO_INVALID_HANDLE;
   }
@@ -1,5 +1,8 @@
 #define INCL_OS2MM
 #define INCL_MMIOOS2
+#define INCL_DOSSEMAPHORES
+#define INCL_DOSPROCESS
+#define INCL_DOSMISC
 
 #ifdef DEBUG
 #define INCL_MCIOS2
@@ -10,10 +13,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <memory.h>
+#include <string.h>
+#include <process.h>
 #include <time.h>
 
 #include <ctype.h>
 #include <FLAC/seekable_stream_decoder.h>
+#include <FLAC/stream_decoder.h>
 #include <FLAC/seekable_stream_encoder.h>
 #include <FLAC/ordinals.h>
 #include <FLAC/format.h>
@@ -49,12 +55,14 @@ typedef struct _Mdata {
     unsigned sample_rate;
     unsigned channels;
     unsigned bits_per_sample;
+    unsigned min_blocksize, max_blocksize;
     FLAC__uint64 total_samples;
     LONG byteAt;
     signed char *buffer;
     long bufat;
     long bufsize;
     size_t bufend;
+    struct _Mpool *pool;      /* frames decoded ahead, or NULL */
 } Mdata;
 
 typedef struct _Mencode {
@@ -166,17 +174,39 @@ FLAC__bool meof
    return (mdata->eof);
 }
 
+/* FLAC samples to little endian PCM bytes, 8 bit ones unsigned as in WAVE */
+static long PackPcm(signed char *out, const FLAC__int32 * const buffer[],
+                    unsigned blocksize, unsigned channels, unsigned bps)
+{
+   unsigned i, j;
+   long n = 0;
+
+   for (i = 0; i < blocksize; i++) {
+       for (j = 0; j < channels; j++) {
+           FLAC__int32 s = buffer[j][i];
+           if (bps <= 8) {
+               out[n++] = (s + (1 << (bps-1))) & 0xFF;
+               continue;
+           }
+           out[n++] = s & 0xFF;
+           out[n++] = (s >> 8) & 0xFF;
+           if (bps > 16) out[n++] = (s >> 16) & 0xFF;
+           if (bps > 24) out[n++] = (s >> 24) & 0xFF;
+       }
+   }
+   return n;
+}
+
 FLAC__StreamDecoderWriteStatus mwrite
     (const FLAC__SeekableStreamDecoder *decoder, 
     const FLAC__Frame *frame, const FLAC__int32 * const buffer[], void *client_data)
 {
    Mdata *mdata = client_data;
-   unsigned i,j;
    size_t newend;
 
    if (!mdata) { return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;} 
 
-   newend = frame->header.blocksize*frame->header.channels*(frame->header.bits_per_sample/8);
+   newend = frame->header.blocksize*frame->header.channels*((frame->header.bits_per_sample+7)/8);
    if (mdata->bufend < newend) {
         if (mdata->buffer) {
             free(mdata->buffer);
@@ -195,28 +225,8 @@ FLAC__StreamDecoderWriteStatus mwrite
 			fprintf(file,"size_t: %ld\n",sizeof(size_t));
      fprintf(file,"heap: %d\n",_heapchk());
 #endif
-   mdata->bufsize=0;
-   for(i=0;i<frame->header.blocksize;i++) {
-       for(j=0;j<frame->header.channels;j++) {
-           mdata->buffer[mdata->bufsize] = (buffer[j][i] & 0xFF);
-           if (mdata->bits_per_sample <= 8) {
-              mdata->buffer[mdata->bufsize]+=1<<(mdata->bits_per_sample-1);
-           }
-           mdata->bufsize++;
-           if (mdata->bits_per_sample > 8) {
-               mdata->buffer[mdata->bufsize] = ((buffer[j][i] & 0xFF00) >> 8);
-               mdata->bufsize++;
-           } /* endif */
-           if (mdata->bits_per_sample > 16) {
-               mdata->buffer[mdata->bufsize] = ((buffer[j][i] & 0xFF0000) >> 8);
-               mdata->bufsize++;
-           } /* endif */
-           if (mdata->bits_per_sample > 24) {
-               mdata->buffer[mdata->bufsize] = ((buffer[j][i] & 0xFF000000) >> 8);
-               mdata->bufsize++;
-           } /* endif */
-       }
-   }
+   mdata->bufsize = PackPcm(mdata->buffer, buffer, frame->header.blocksize,
+                            frame->header.channels, frame->header.bits_per_sample);
    mdata->bufat=0;
 #ifdef DEBUG
      fprintf(file,"write post-heap: %d\n",_heapchk());
@@ -239,6 +249,8 @@ void mmetadata
         mdata->channels = metadata->data.stream_info.channels;
         mdata->bits_per_sample = metadata->data.stream_info.bits_per_sample;
         mdata->total_samples = metadata->data.stream_info.total_samples;
+        mdata->min_blocksize = metadata->data.stream_info.min_blocksize;
+        mdata->max_blocksize = metadata->data.stream_info.max_blocksize;
     } /* endif */
 }
 
@@ -252,6 +264,707 @@ void merror(const FLAC__SeekableStreamDecoder *decoder,
  return; 
 }
 
+/* The seekable decoder, a frame at a time on the caller's thread */
+static LONG SerialRead(Mdata *mdata, PCHAR pOut, LONG cb)
+{
+    LONG total = 0;
+
+    while (1) {
+        if (total==cb) {
+#ifdef DEBUG
+			fprintf(file,"decoded all %ld %ld %ld\n",total, mdata->bufat, mdata->bufsize);
+     fprintf(file,"heap: %d\n",_heapchk());
+#endif
+            return total;
+        } /* endif */
+        if (mdata->bufsize==mdata->bufat) {
+            FLAC__bool rc;
+#ifdef DEBUG
+			fprintf(file,"process single, %d\n",FLAC__seekable_stream_decoder_get_state(mdata->decoder));
+     fprintf(file,"heap: %d\n",_heapchk());
+#endif
+            rc = FLAC__seekable_stream_decoder_process_single(mdata->decoder);
+#ifdef DEBUG
+     fprintf(file,"post-heap: %d\n",_heapchk());
+#endif
+            if (false==rc) {
+#ifdef DEBUG
+			fprintf(file,"unexpected state:%d\n",FLAC__seekable_stream_decoder_get_state(mdata->decoder));
+#endif
+                if (FLAC__STREAM_DECODER_END_OF_STREAM==FLAC__seekable_stream_decoder_get_state(mdata->decoder)) {
+                    return total;
+                } /* endif */
+                return MMIO_ERROR;
+            } /* endif */
+        } /* endif */
+        if (mdata->bufsize==mdata->bufat) {
+#ifdef DEBUG
+			fprintf(file,"failed to get more data.\n");
+#endif
+            return total;
+        }
+        if (cb-total >= mdata->bufsize-mdata->bufat) {
+            memcpy(pOut+total,mdata->buffer+mdata->bufat,mdata->bufsize-mdata->bufat);
+            total+=mdata->bufsize-mdata->bufat;
+            mdata->byteAt+=mdata->bufsize-mdata->bufat;
+            mdata->bufat=mdata->bufsize;
+        } else {
+            memcpy(pOut+total,mdata->buffer+mdata->bufat,cb-total);
+            mdata->bufat+=cb-total;
+            mdata->byteAt+=cb-total;
+            total=cb;
+        }
+    } /* endwhile */
+}
+
+/*
+ * Parallel decoding. FLAC frames do not depend on one another, so any
+ * decoder that has seen STREAMINFO can decode a frame once its bytes are
+ * known. MMIOM_READ cuts the file into frames (a candidate header must
+ * carry the next frame number and a good CRC-8, so sync codes inside
+ * audio data are passed over), queues up to RINGSIZE of them and worker
+ * threads decode them into PCM that READ hands out in order. The frame
+ * offsets found on the way, helped by SEEKTABLE, serve MMIOM_SEEK.
+ * Streams with a variable block size, and any frame a worker fails on,
+ * are left to the seekable decoder.
+ */
+
+#define MAXWORKERS  4
+#define RINGSIZE    16            /* frames queued or decoded ahead */
+#define INCHUNK     65536         /* file bytes read at a time */
+#define FRAMEMAX    (4*1024*1024) /* no frame is anywhere near this long */
+
+#ifndef QSV_NUMPROCESSORS
+#define QSV_NUMPROCESSORS 26
+#endif
+
+#define SLOT_FREE     0
+#define SLOT_QUEUED   1
+#define SLOT_DECODING 2
+#define SLOT_DONE     3
+#define SLOT_ERROR    4
+
+typedef struct _Mslot {
+    int state;
+    ULONG frame;
+    FLAC__byte *data;             /* the frame as found in the file */
+    LONG dataLen, dataAlloc;
+    signed char *pcm;             /* and decoded */
+    long pcmLen, pcmAlloc;
+    long pcmAt;                   /* bytes handed out (or skipped by a seek) */
+} Mslot;
+
+typedef struct _Mworker {
+    struct _Mpool *pool;
+    FLAC__StreamDecoder *decoder;
+    int tid;
+    Mslot *slot;                  /* being decoded */
+    const FLAC__byte *src;        /* what the read callback hands out */
+    unsigned srcLen;
+    FLAC__bool written;
+} Mworker;
+
+typedef struct _Mpool {
+    HMTX hmtx;                    /* slot states, head and count */
+    HEV hevWork;                  /* a slot was queued, or quit */
+    HEV hevDone;                  /* a slot was decoded */
+    int quit;
+    int nWorkers;
+    Mworker worker[MAXWORKERS];
+    Mslot ring[RINGSIZE];
+    int head, count;
+
+    unsigned blocksize, channels, bps;
+    LONG sampleBytes;             /* one sample of all channels */
+    FLAC__byte header[8+FLAC__STREAM_METADATA_STREAMINFO_LENGTH];
+
+    LONG firstFrame;              /* file offset of frame 0 */
+    ULONG nFrames;                /* 0 if the length is not known */
+    ULONG *offsets;               /* of frames 0..nIndexed-1 */
+    ULONG nIndexed, indexAlloc;
+    FLAC__uint64 *seekSample;     /* SEEKTABLE points on frame starts */
+    ULONG *seekOffset;
+    ULONG nSeek;
+
+    ULONG nextFrame;              /* what gets queued next */
+    LONG nextOffset;
+    int eof;                      /* nothing more to queue */
+    int broken;                   /* ... because the frames could not be found */
+    LONG skip;                    /* bytes of nextFrame passed by a seek */
+
+    FLAC__byte *in;               /* file bytes in[inStart..], from inPos on */
+    LONG inStart, inLen, inAlloc, inPos;
+} Mpool;
+
+static FLAC__StreamDecoderReadStatus wread
+    (const FLAC__StreamDecoder *decoder, FLAC__byte buffer[],
+     unsigned *bytes, void *client_data)
+{
+    Mworker *w = client_data;
+    unsigned n = *bytes;
+
+    if (n > w->srcLen) n = w->srcLen;
+    *bytes = n;
+    if (!n) return FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM;
+    memcpy(buffer, w->src, n);
+    w->src += n;
+    w->srcLen -= n;
+    return FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+}
+
+static FLAC__StreamDecoderWriteStatus wwrite
+    (const FLAC__StreamDecoder *decoder, const FLAC__Frame *frame,
+     const FLAC__int32 * const buffer[], void *client_data)
+{
+    Mworker *w = client_data;
+    Mpool *pool = w->pool;
+    Mslot *slot = w->slot;
+    long need;
+
+    if (w->written || frame->header.channels != pool->channels ||
+        frame->header.bits_per_sample != pool->bps ||
+        frame->header.number.sample_number != (FLAC__uint64)slot->frame*pool->blocksize)
+        return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+
+    need = frame->header.blocksize*pool->sampleBytes;
+    if (slot->pcmAlloc < need) {
+        signed char *p = realloc(slot->pcm, need);
+        if (!p) return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+        slot->pcm = p;
+        slot->pcmAlloc = need;
+    }
+    slot->pcmLen = PackPcm(slot->pcm, buffer, frame->header.blocksize, pool->channels, pool->bps);
+    w->written = true;
+    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+}
+
+static void wmetadata
+    (const FLAC__StreamDecoder *decoder,
+     const FLAC__StreamMetadata *metadata, void *client_data)
+{
+}
+
+static void werror(const FLAC__StreamDecoder *decoder,
+    FLAC__StreamDecoderErrorStatus status, void *client_data)
+{
+}
+
+static void PoolWorker(void *arg)
+{
+    Mworker *w = arg;
+    Mpool *pool = w->pool;
+    Mslot *slot;
+    ULONG cnt;
+    int i;
+
+    DosRequestMutexSem(pool->hmtx, SEM_INDEFINITE_WAIT);
+    while (!pool->quit) {
+        slot = NULL;
+        for (i = 0; i < pool->count; i++) {
+            Mslot *s = &pool->ring[(pool->head + i) % RINGSIZE];
+            if (SLOT_QUEUED == s->state) {
+                slot = s;
+                break;
+            }
+        }
+        if (!slot) {
+            DosResetEventSem(pool->hevWork, &cnt);
+            DosReleaseMutexSem(pool->hmtx);
+            DosWaitEventSem(pool->hevWork, SEM_INDEFINITE_WAIT);
+            DosRequestMutexSem(pool->hmtx, SEM_INDEFINITE_WAIT);
+            continue;
+        }
+        slot->state = SLOT_DECODING;
+        DosReleaseMutexSem(pool->hmtx);
+
+        w->slot = slot;
+        w->src = slot->data;
+        w->srcLen = slot->dataLen;
+        w->written = false;
+        FLAC__stream_decoder_flush(w->decoder);
+        FLAC__stream_decoder_process_single(w->decoder);
+
+        DosRequestMutexSem(pool->hmtx, SEM_INDEFINITE_WAIT);
+        slot->state = w->written ? SLOT_DONE : SLOT_ERROR;
+        DosPostEventSem(pool->hevDone);
+    }
+    DosReleaseMutexSem(pool->hmtx);
+}
+
+static void PoolClose(Mdata *mdata)
+{
+    Mpool *pool = mdata->pool;
+    TID tid;
+    int i;
+
+    if (!pool) return;
+    if (pool->hmtx) {
+        DosRequestMutexSem(pool->hmtx, SEM_INDEFINITE_WAIT);
+        pool->quit = 1;
+        if (pool->hevWork) DosPostEventSem(pool->hevWork);
+        DosReleaseMutexSem(pool->hmtx);
+    }
+    for (i = 0; i < MAXWORKERS; i++) {
+        if (pool->worker[i].tid > 0) {
+            tid = pool->worker[i].tid;
+            DosWaitThread(&tid, DCWW_WAIT);
+        }
+        if (pool->worker[i].decoder)
+            FLAC__stream_decoder_delete(pool->worker[i].decoder);
+    }
+    for (i = 0; i < RINGSIZE; i++) {
+        free(pool->ring[i].data);
+        free(pool->ring[i].pcm);
+    }
+    if (pool->hevDone) DosCloseEventSem(pool->hevDone);
+    if (pool->hevWork) DosCloseEventSem(pool->hevWork);
+    if (pool->hmtx) DosCloseMutexSem(pool->hmtx);
+    free(pool->in);
+    free(pool->offsets);
+    free(pool->seekSample);
+    free(pool->seekOffset);
+    free(pool);
+    mdata->pool = NULL;
+}
+
+static ULONG GetBE(const FLAC__byte *p, int n)
+{
+    ULONG x = 0;
+    while (n--) x = (x << 8) | *p++;
+    return x;
+}
+
+/* Find STREAMINFO, SEEKTABLE and where the frames start */
+static BOOL PoolHeader(Mdata *mdata, Mpool *pool)
+{
+    FLAC__byte b[18];
+    LONG off = 0, len;
+    ULONG i, n;
+    int last = 0;
+
+    if (mmioSeek(mdata->hmmio, 0, SEEK_SET) != 0) return FALSE;
+    if (mmioRead(mdata->hmmio, (PCHAR)b, 4) != 4) return FALSE;
+    if (b[0] == 'I' && b[1] == 'D' && b[2] == '3') {
+        /* ID3v2 tag in front, as the decoder allows */
+        if (mmioRead(mdata->hmmio, (PCHAR)b + 4, 6) != 6) return FALSE;
+        off = 10 + ((b[6] & 0x7F) << 21 | (b[7] & 0x7F) << 14 | (b[8] & 0x7F) << 7 | (b[9] & 0x7F));
+        if (b[5] & 0x10) off += 10;
+        if (mmioSeek(mdata->hmmio, off, SEEK_SET) != off) return FALSE;
+        if (mmioRead(mdata->hmmio, (PCHAR)b, 4) != 4) return FALSE;
+    }
+    if (memcmp(b, "fLaC", 4)) return FALSE;
+    off += 4;
+
+    while (!last) {
+        if (mmioSeek(mdata->hmmio, off, SEEK_SET) != off) return FALSE;
+        if (mmioRead(mdata->hmmio, (PCHAR)b, 4) != 4) return FALSE;
+        last = b[0] & 0x80;
+        len = GetBE(b + 1, 3);
+        off += 4;
+        if (FLAC__METADATA_TYPE_STREAMINFO == (b[0] & 0x7F)) {
+            if (FLAC__STREAM_METADATA_STREAMINFO_LENGTH != len) return FALSE;
+            if (mmioRead(mdata->hmmio, (PCHAR)pool->header + 8, len) != len) return FALSE;
+        } else if (FLAC__METADATA_TYPE_SEEKTABLE == (b[0] & 0x7F) && !pool->nSeek) {
+            n = len/18;
+            pool->seekSample = malloc(n*sizeof(FLAC__uint64) + 1);
+            pool->seekOffset = malloc(n*sizeof(ULONG) + 1);
+            if (!pool->seekSample || !pool->seekOffset) return FALSE;
+            for (i = 0; i < n; i++) {
+                if (mmioRead(mdata->hmmio, (PCHAR)b, 18) != 18) return FALSE;
+                /* placeholders, points off frame starts and offsets
+                   beyond what mmioSeek takes are no use here */
+                if (GetBE(b, 4) || GetBE(b + 8, 4) || GetBE(b + 12, 4) > 0x7FFFFFFFUL) continue;
+                pool->seekSample[pool->nSeek] = GetBE(b + 4, 4);
+                if (pool->seekSample[pool->nSeek] % pool->blocksize) continue;
+                pool->seekOffset[pool->nSeek++] = GetBE(b + 12, 4);
+            }
+        }
+        off += len;
+    }
+    pool->firstFrame = off;
+
+    /* what the workers' decoders are fed before any frame. The length
+       is left out: a decoder that has counted that many samples will
+       not look at another frame, and any of them may get the last */
+    pool->header[8+13] &= 0xF0;
+    memset(pool->header + 8+14, 0, 4);
+    memcpy(pool->header, "fLaC", 4);
+    pool->header[4] = 0x80 | FLAC__METADATA_TYPE_STREAMINFO;
+    pool->header[5] = 0;
+    pool->header[6] = 0;
+    pool->header[7] = FLAC__STREAM_METADATA_STREAMINFO_LENGTH;
+    return TRUE;
+}
+
+/* Start the pool if the stream allows it; on failure the seekable
+   decoder carries on where it was */
+static void PoolOpen(Mdata *mdata)
+{
+    Mpool *pool;
+    Mworker *w;
+    ULONG cpus;
+    LONG pos;
+    int i;
+
+    if (mdata->min_blocksize != mdata->max_blocksize || !mdata->min_blocksize ||
+        !mdata->channels || !mdata->bits_per_sample) return;
+    /* one processor gains nothing but copies */
+    if (DosQuerySysInfo(QSV_NUMPROCESSORS, QSV_NUMPROCESSORS, &cpus, sizeof(cpus)) || cpus < 2)
+        return;
+    pos = mmioSeek(mdata->hmmio, 0, SEEK_CUR);
+    if (pos < 0) return;
+
+    pool = calloc(1, sizeof(Mpool));
+    if (!pool) return;
+    mdata->pool = pool;
+    pool->nWorkers = cpus < MAXWORKERS ? cpus : MAXWORKERS;
+    pool->blocksize = mdata->min_blocksize;
+    pool->channels = mdata->channels;
+    pool->bps = mdata->bits_per_sample;
+    pool->sampleBytes = mdata->channels*((mdata->bits_per_sample + 7)/8);
+    pool->nFrames = (mdata->total_samples + pool->blocksize - 1)/pool->blocksize;
+    pool->inPos = -1;
+
+    if (!PoolHeader(mdata, pool)) goto fail;
+    pool->indexAlloc = 1024;
+    pool->offsets = malloc(pool->indexAlloc*sizeof(ULONG));
+    if (!pool->offsets) goto fail;
+    pool->offsets[0] = pool->firstFrame;
+    pool->nIndexed = 1;
+    pool->nextOffset = pool->firstFrame;
+
+    for (i = 0; i < pool->nWorkers; i++) {
+        w = &pool->worker[i];
+        w->pool = pool;
+        w->decoder = FLAC__stream_decoder_new();
+        if (!w->decoder ||
+            !FLAC__stream_decoder_set_read_callback(w->decoder, wread) ||
+            !FLAC__stream_decoder_set_write_callback(w->decoder, wwrite) ||
+            !FLAC__stream_decoder_set_metadata_callback(w->decoder, wmetadata) ||
+            !FLAC__stream_decoder_set_error_callback(w->decoder, werror) ||
+            !FLAC__stream_decoder_set_client_data(w->decoder, w) ||
+            FLAC__STREAM_DECODER_SEARCH_FOR_METADATA != FLAC__stream_decoder_init(w->decoder))
+            goto fail;
+        w->src = pool->header;
+        w->srcLen = sizeof(pool->header);
+        if (!FLAC__stream_decoder_process_until_end_of_metadata(w->decoder)) goto fail;
+    }
+
+    if (DosCreateMutexSem(NULL, &pool->hmtx, 0, FALSE) ||
+        DosCreateEventSem(NULL, &pool->hevWork, 0, FALSE) ||
+        DosCreateEventSem(NULL, &pool->hevDone, 0, FALSE)) goto fail;
+    for (i = 0; i < pool->nWorkers; i++) {
+        pool->worker[i].tid = _beginthread(PoolWorker, NULL, 65536, &pool->worker[i]);
+        if (pool->worker[i].tid <= 0) goto fail;
+    }
+#ifdef DEBUG
+    fprintf(file,"pool: %d workers, frames from %ld, %lu seek points\n",
+            pool->nWorkers, pool->firstFrame, pool->nSeek);
+#endif
+    return;
+
+fail:
+    PoolClose(mdata);
+    mmioSeek(mdata->hmmio, pos, SEEK_SET);
+}
+
+/* Have the file bytes from off on, want of them if the file has that
+   many; returns how many there are */
+static LONG InFill(Mdata *mdata, LONG off, LONG want)
+{
+    Mpool *pool = mdata->pool;
+    LONG rc;
+
+    if (off < pool->inPos || off > pool->inPos + pool->inLen) {
+        if (mmioSeek(mdata->hmmio, off, SEEK_SET) != off) return 0;
+        pool->inPos = off;
+        pool->inStart = pool->inLen = 0;
+    } else {
+        pool->inStart += off - pool->inPos;
+        pool->inLen -= off - pool->inPos;
+        pool->inPos = off;
+    }
+    if (pool->inLen >= want) return pool->inLen;
+
+    if (pool->inStart) {
+        memmove(pool->in, pool->in + pool->inStart, pool->inLen);
+        pool->inStart = 0;
+    }
+    if (pool->inAlloc < want) {
+        FLAC__byte *p = realloc(pool->in, want);
+        if (!p) return pool->inLen;
+        pool->in = p;
+        pool->inAlloc = want;
+    }
+    while (pool->inLen < want) {
+        rc = mmioRead(mdata->hmmio, (PCHAR)pool->in + pool->inLen, want - pool->inLen);
+        if (rc <= 0) break;
+        pool->inLen += rc;
+    }
+    return pool->inLen;
+}
+
+/* CRC-8, polynomial x^8 + x^2 + x + 1, as frame headers carry */
+static FLAC__byte Crc8(const FLAC__byte *p, int len)
+{
+    FLAC__byte crc = 0;
+    int i;
+
+    while (len--) {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+/* Is there a header of frame number `frame` at p? 1 yes, 0 no, -1 cannot
+   tell from len bytes */
+static int FrameHeader(const FLAC__byte *p, LONG len, ULONG frame)
+{
+    ULONG x;
+    int n, i, hlen;
+
+    if (len < 5) return -1;
+    if (p[0] != 0xFF || p[1] != 0xF8) return 0;
+    if (!(p[2] >> 4) || (p[2] & 0x0F) == 15) return 0;
+    if ((p[3] >> 4) > 10 || (p[3] & 0x01)) return 0;
+    if (((p[3] >> 1) & 7) == 3 || ((p[3] >> 1) & 7) == 7) return 0;
+
+    /* the frame number, UTF-8 coded */
+    x = p[4];
+    if (!(x & 0x80)) n = 0;
+    else if ((x & 0xE0) == 0xC0) { n = 1; x &= 0x1F; }
+    else if ((x & 0xF0) == 0xE0) { n = 2; x &= 0x0F; }
+    else if ((x & 0xF8) == 0xF0) { n = 3; x &= 0x07; }
+    else if ((x & 0xFC) == 0xF8) { n = 4; x &= 0x03; }
+    else if ((x & 0xFE) == 0xFC) { n = 5; x &= 0x01; }
+    else return 0;
+    hlen = 5 + n;
+    if (p[2] >> 4 == 6) hlen += 1;
+    if (p[2] >> 4 == 7) hlen += 2;
+    if ((p[2] & 0x0F) == 12) hlen += 1;
+    if ((p[2] & 0x0F) == 13 || (p[2] & 0x0F) == 14) hlen += 2;
+    if (len < hlen + 1) return -1;
+    for (i = 0; i < n; i++) {
+        if ((p[5+i] & 0xC0) != 0x80) return 0;
+        x = (x << 6) | (p[5+i] & 0x3F);
+    }
+    if (x != frame) return 0;
+    return Crc8(p, hlen) == p[hlen];
+}
+
+static void IndexAdd(Mpool *pool, ULONG frame, LONG off)
+{
+    if (frame != pool->nIndexed) return;
+    if (pool->nIndexed == pool->indexAlloc) {
+        ULONG *p = realloc(pool->offsets, 2*pool->indexAlloc*sizeof(ULONG));
+        if (!p) return;
+        pool->offsets = p;
+        pool->indexAlloc *= 2;
+    }
+    pool->offsets[pool->nIndexed++] = off;
+}
+
+/* Length of frame `frame` at off: up to the header of the frame after
+   it, or to the end of the file. 0 past the end, -1 if no end is found */
+static LONG FrameSpan(Mdata *mdata, ULONG frame, LONG off)
+{
+    Mpool *pool = mdata->pool;
+    LONG i = 2, avail, want = INCHUNK;
+    FLAC__byte *p;
+    int r;
+
+    for (;;) {
+        avail = InFill(mdata, off, want);
+        p = pool->in + pool->inStart;
+        for ( ; i + 1 < avail; i++) {
+            if (p[i] != 0xFF || p[i+1] != 0xF8) continue;
+            r = FrameHeader(p + i, avail - i, frame + 1);
+            if (r > 0) {
+                IndexAdd(pool, frame + 1, off + i);
+                return i;
+            }
+            if (r < 0 && avail == want) break;  /* read on to see the rest */
+        }
+        if (avail < want)                       /* end of file */
+            return pool->nFrames && frame + 1 < pool->nFrames ? -1 : avail;
+        if (want > FRAMEMAX) return -1;
+        want += INCHUNK;
+    }
+}
+
+/* Queue frames until the ring is full */
+static void PoolFill(Mdata *mdata)
+{
+    Mpool *pool = mdata->pool;
+    Mslot *slot;
+    LONG len;
+    int queued = 0;
+
+    while (!pool->eof && pool->count < RINGSIZE) {
+        if (pool->nFrames && pool->nextFrame >= pool->nFrames) {
+            pool->eof = 1;
+            break;
+        }
+        len = FrameSpan(mdata, pool->nextFrame, pool->nextOffset);
+        if (len <= 0) {
+            pool->eof = 1;
+            pool->broken = len < 0;
+            break;
+        }
+        slot = &pool->ring[(pool->head + pool->count) % RINGSIZE];
+        if (slot->dataAlloc < len) {
+            FLAC__byte *p = realloc(slot->data, len);
+            if (!p) {
+                pool->eof = pool->broken = 1;
+                break;
+            }
+            slot->data = p;
+            slot->dataAlloc = len;
+        }
+        memcpy(slot->data, pool->in + pool->inStart, len);
+        slot->dataLen = len;
+        slot->frame = pool->nextFrame;
+        slot->pcmLen = 0;
+        slot->pcmAt = pool->skip;
+        pool->skip = 0;
+        pool->nextFrame++;
+        pool->nextOffset += len;
+
+        DosRequestMutexSem(pool->hmtx, SEM_INDEFINITE_WAIT);
+        slot->state = SLOT_QUEUED;
+        pool->count++;
+        DosReleaseMutexSem(pool->hmtx);
+        queued = 1;
+    }
+    if (queued) DosPostEventSem(pool->hevWork);
+}
+
+/* Stop the pool and let the seekable decoder go on from sample */
+static BOOL PoolFallback(Mdata *mdata, FLAC__uint64 sample)
+{
+#ifdef DEBUG
+    fprintf(file,"pool: back to the seekable decoder at %lu\n", (ULONG)sample);
+#endif
+    PoolClose(mdata);
+    mdata->bufsize = 0;
+    mdata->bufat = 0;
+    return FLAC__seekable_stream_decoder_seek_absolute(mdata->decoder, sample);
+}
+
+static LONG PoolRead(Mdata *mdata, PCHAR pOut, LONG cb)
+{
+    Mpool *pool = mdata->pool;
+    Mslot *slot;
+    LONG total = 0, n;
+    ULONG cnt;
+    FLAC__uint64 sample;
+
+    while (total < cb) {
+        PoolFill(mdata);
+        if (!pool->count) {
+            if (!pool->broken) break;
+            sample = (FLAC__uint64)pool->nextFrame*pool->blocksize + pool->skip/pool->sampleBytes;
+            if (!PoolFallback(mdata, sample)) return total ? total : MMIO_ERROR;
+            n = SerialRead(mdata, pOut + total, cb - total);
+            return n < 0 ? (total ? total : n) : total + n;
+        }
+
+        slot = &pool->ring[pool->head];
+        DosRequestMutexSem(pool->hmtx, SEM_INDEFINITE_WAIT);
+        while (SLOT_DONE != slot->state && SLOT_ERROR != slot->state) {
+            DosResetEventSem(pool->hevDone, &cnt);
+            DosReleaseMutexSem(pool->hmtx);
+            DosWaitEventSem(pool->hevDone, SEM_INDEFINITE_WAIT);
+            DosRequestMutexSem(pool->hmtx, SEM_INDEFINITE_WAIT);
+        }
+        DosReleaseMutexSem(pool->hmtx);
+
+        if (SLOT_ERROR == slot->state) {
+            sample = (FLAC__uint64)slot->frame*pool->blocksize + slot->pcmAt/pool->sampleBytes;
+            if (!PoolFallback(mdata, sample)) return total ? total : MMIO_ERROR;
+            n = SerialRead(mdata, pOut + total, cb - total);
+            return n < 0 ? (total ? total : n) : total + n;
+        }
+
+        if (slot->pcmAt < slot->pcmLen) {
+            n = slot->pcmLen - slot->pcmAt;
+            if (n > cb - total) n = cb - total;
+            memcpy(pOut + total, slot->pcm + slot->pcmAt, n);
+            slot->pcmAt += n;
+            total += n;
+            mdata->byteAt += n;
+        }
+        if (slot->pcmAt >= slot->pcmLen) {
+            DosRequestMutexSem(pool->hmtx, SEM_INDEFINITE_WAIT);
+            slot->state = SLOT_FREE;
+            pool->head = (pool->head + 1) % RINGSIZE;
+            pool->count--;
+            DosReleaseMutexSem(pool->hmtx);
+        }
+    }
+    return total;
+}
+
+/* Move the pool to sample: drop what is queued and start queueing from
+   the frame holding it. FALSE if the frame cannot be found */
+static BOOL PoolSeek(Mdata *mdata, FLAC__uint64 sample)
+{
+    Mpool *pool = mdata->pool;
+    ULONG frame = sample/pool->blocksize, f, i;
+    ULONG cnt;
+    LONG off, len;
+    int busy;
+
+    DosRequestMutexSem(pool->hmtx, SEM_INDEFINITE_WAIT);
+    for (;;) {
+        busy = 0;
+        for (i = 0; i < RINGSIZE; i++) {
+            if (SLOT_QUEUED == pool->ring[i].state) pool->ring[i].state = SLOT_FREE;
+            if (SLOT_DECODING == pool->ring[i].state) busy = 1;
+        }
+        if (!busy) break;
+        DosResetEventSem(pool->hevDone, &cnt);
+        DosReleaseMutexSem(pool->hmtx);
+        DosWaitEventSem(pool->hevDone, SEM_INDEFINITE_WAIT);
+        DosRequestMutexSem(pool->hmtx, SEM_INDEFINITE_WAIT);
+    }
+    for (i = 0; i < RINGSIZE; i++) pool->ring[i].state = SLOT_FREE;
+    pool->head = 0;
+    pool->count = 0;
+    DosReleaseMutexSem(pool->hmtx);
+
+    /* start from the nearest frame known, at or before the one wanted */
+    if (frame < pool->nIndexed) {
+        f = frame;
+        off = pool->offsets[frame];
+    } else {
+        f = pool->nIndexed - 1;
+        off = pool->offsets[f];
+        for (i = 0; i < pool->nSeek; i++) {
+            ULONG pf = pool->seekSample[i]/pool->blocksize;
+            if (pf > f && pf <= frame) {
+                f = pf;
+                off = pool->firstFrame + pool->seekOffset[i];
+            }
+        }
+        while (f < frame) {
+            len = FrameSpan(mdata, f, off);
+            if (len <= 0) return FALSE;
+            off += len;
+            f++;
+        }
+    }
+
+    pool->nextFrame = frame;
+    pool->nextOffset = off;
+    pool->skip = (LONG)(sample - (FLAC__uint64)frame*pool->blocksize)*pool->sampleBytes;
+    pool->eof = 0;
+    pool->broken = 0;
+    return TRUE;
+}
+
 FLAC__StreamEncoderWriteStatus encodeWrite
 	(const FLAC__SeekableStreamEncoder *encoder, const FLAC__byte buffer[], 
 	 unsigned bytes, unsigned samples, unsigned current_frame, void *client_data)
@@ -394,6 +1107,7 @@ LONG APIENTRY IOProc_Entry(PVOID pmmioStr, USHORT usMsg, LONG lParam1,
  	           			return MMIO_ERROR;
              		}
             	}
+				PoolOpen(mdata);
 #ifdef DEBUG
 				fprintf(file,"Open successfull\n");
 #endif
@@ -452,57 +1166,12 @@ LONG APIENTRY IOProc_Entry(PVOID pmmioStr, USHORT usMsg, LONG lParam1,
      		return MMIO_ERROR;
      	} else {
     		Mdata *mdata;
-            LONG total = 0;
     
       		mdata = (Mdata*)pmmioinfo->pExtraInfoStruct;
 			if (READNUM != mdata->t) return MMIO_ERROR;
 
-            while (1) {
-                if (total==lParam2) {
-#ifdef DEBUG
-			fprintf(file,"decoded all %ld %ld %ld\n",total, mdata->bufat, mdata->bufsize);
-     fprintf(file,"heap: %d\n",_heapchk());
-#endif
-                    return total;
-                } /* endif */
-                if (mdata->bufsize==mdata->bufat) {
-                    FLAC__bool rc;
-#ifdef DEBUG
-			fprintf(file,"process single, %d\n",FLAC__seekable_stream_decoder_get_state(mdata->decoder));
-     fprintf(file,"heap: %d\n",_heapchk());
-#endif
-                    rc = FLAC__seekable_stream_decoder_process_single(mdata->decoder);
-#ifdef DEBUG
-     fprintf(file,"post-heap: %d\n",_heapchk());
-#endif
-                    if (false==rc) {
-#ifdef DEBUG
-			fprintf(file,"unexpected state:%d\n",FLAC__seekable_stream_decoder_get_state(mdata->decoder));
-#endif
-                        if (FLAC__STREAM_DECODER_END_OF_STREAM==FLAC__seekable_stream_decoder_get_state(mdata->decoder)) {
-                            return total;
-                        } /* endif */
-                        return MMIO_ERROR;
-                    } /* endif */
-                } /* endif */
-                if (mdata->bufsize==mdata->bufat) {
-#ifdef DEBUG
-			fprintf(file,"failed to get more data.\n");
-#endif
-                    return total;
-                }
-                if (lParam2-total >= mdata->bufsize-mdata->bufat) {
-                    memcpy((PSZ)lParam1+total,mdata->buffer+mdata->bufat,mdata->bufsize-mdata->bufat);
-                    total+=mdata->bufsize-mdata->bufat;
-                    mdata->byteAt+=mdata->bufsize-mdata->bufat;
-                    mdata->bufat=mdata->bufsize;
-                } else {
-                    memcpy((PSZ)lParam1+total,mdata->buffer+mdata->bufat,lParam2-total);
-                    mdata->bufat+=lParam2-total;
-                    mdata->byteAt+=lParam2-total;
-                    total=lParam2;
-                }
-            } /* endwhile */
+            if (mdata->pool) return PoolRead(mdata, (PCHAR)lParam1, lParam2);
+            return SerialRead(mdata, (PCHAR)lParam1, lParam2);
         }
    	}
 	break;
@@ -527,12 +1196,20 @@ LONG APIENTRY IOProc_Entry(PVOID pmmioStr, USHORT usMsg, LONG lParam1,
 
             posDesired += lParam1/(mdata->bits_per_sample*mdata->channels/8);
 
-            rc = FLAC__seekable_stream_decoder_seek_absolute (mdata->decoder, posDesired);
+            if (!mdata->pool) {
+                /* the seek hands the rest of the target frame to mwrite */
+                mdata->bufsize = 0;
+                mdata->bufat = 0;
+                rc = FLAC__seekable_stream_decoder_seek_absolute (mdata->decoder, posDesired);
+            } else if (PoolSeek(mdata, posDesired)) {
+                mdata->byteAt=posDesired*(mdata->bits_per_sample*mdata->channels/8);
+                return mdata->byteAt;
+            } else {
+                rc = PoolFallback(mdata, posDesired);
+            }
 
             if (rc) {
                 mdata->byteAt=posDesired*(mdata->bits_per_sample*mdata->channels/8);
-                mdata->bufsize = 0;
-                mdata->bufat = 0;
                 return mdata->byteAt;
             } else {
                 return MMIO_ERROR;
@@ -551,6 +1228,7 @@ LONG APIENTRY IOProc_Entry(PVOID pmmioStr, USHORT usMsg, LONG lParam1,
 #ifdef DEBUG
        	    fprintf(file,"pre CLOSE\n");
 #endif		
+            PoolClose(mdata);
             if (mdata->decoder) {
 //                FLAC__seekable_stream_decoder_finish (mdata->decoder);
                 FLAC__seekable_stream_decoder_delete (mdata->decoder);
@@ -1,4 +1,5 @@
 #define INCL_DOSERRORS
+#define INCL_DOSFILEMGR
 #define INCL_OS2MM
 #define INCL_MMIOOS2
 
@@ -10,6 +11,7 @@
 #include <os2me.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <string.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <mad.h>
@@ -22,9 +24,30 @@
 #include "xing.h"
 
 #define BUFSIZE 16384
+#define READAHEAD 131072		/* bytes read from the file at a time */
 #define BYTES_PER_SAMPLE 2
 #define BITS_PER_SAMPLE 8*BYTES_PER_SAMPLE
 
+/* Seeking goes through an index holding the file offset of every
+   INDEXSTEP'th frame. It is built as frames go by, in playback or when
+   a seek runs past its end, and once it covers the whole of a local
+   file it is kept in an EA so the next open can seek straight away */
+#define INDEXSTEP 32
+#define INDEXPRIME 8			/* frames decoded ahead of a seek target to fill the bit reservoir */
+#define INDEXEA "MMIOMP3.INDEX"
+#define INDEXMAGIC 0x3150334D	/* 'M3P1' */
+#define INDEXEAMAX 60000		/* largest EA value written */
+#define NOFRAME ((unsigned long)-1)	/* frame number not known */
+
+typedef struct _MP3INDEXEA {
+	ULONG magic;
+	ULONG fileSize;
+	ULONG dataStart;
+	ULONG frames;
+	ULONG step;
+	ULONG count;				/* offsets following this header */
+} MP3INDEXEA;
+
 #ifdef DEBUG
 static FILE *file;
 void openDebugFile() {
@@ -175,8 +198,10 @@ typedef struct _MP3INFO {
   } sync;
   
     BOOL local;
- 	unsigned char buf[BUFSIZE];
+ 	unsigned char buf[READAHEAD];
  	int bufend;
+	long bufpos;				/* file offset of buf[0] */
+	long filepos;				/* file offset of the next read */
  	unsigned char out[4];
  	int outsize;
 	int ptr;
@@ -184,6 +209,15 @@ typedef struct _MP3INFO {
 	long datasize;
 	unsigned long location;
 	unsigned long totalFrames;
+	unsigned long frameNo;		/* number of the next frame in the stream */
+
+	ULONG *index;
+	ULONG indexCount;
+	ULONG indexAlloc;
+	unsigned long indexFrames;	/* frames in the file once complete */
+	BOOL indexComplete;
+	BOOL indexLoaded;			/* read from the EA, no need to write it back */
+	char fileName[CCHMAXPATH];
 
 	unsigned long vbr;
 	unsigned int frames;
@@ -202,6 +236,7 @@ void reInit(MP3INFO *mp3info) {
 	mp3info->bufend = 0;
 	mp3info->vbr = 0;
 	mp3info->frames = 0;
+	mp3info->frameNo = NOFRAME;
   	mad_stream_init(&mp3info->sync.stream);
  	mad_frame_init(&mp3info->sync.frame);
 	mad_synth_init(&mp3info->sync.synth);   			
@@ -256,16 +291,167 @@ static LONG fillStream(MP3INFO *mp3info) {
 #endif
 		memmove(mp3info->buf,mp3info->sync.stream.next_frame, extrasize);
 	}
-	rc = mmioRead(mp3info->hmmioSS, mp3info->buf + extrasize, BUFSIZE-extrasize);
+	mp3info->bufpos = mp3info->filepos - extrasize;
+	rc = mmioRead(mp3info->hmmioSS, mp3info->buf + extrasize, READAHEAD-extrasize);
 	if (rc > 0) {
+		mp3info->filepos += rc;
     	mp3info->bufend = rc + extrasize;
 		mad_stream_buffer(&(mp3info->sync.stream), mp3info->buf, mp3info->bufend );
 	} else {
     	mp3info->bufend = 0;
     }
+	if (rc == 0 && mp3info->frameNo != NOFRAME && !mp3info->indexComplete) {
+		mp3info->indexComplete = TRUE;
+		mp3info->indexFrames = mp3info->frameNo;
+	}
+	return rc;
+}
+
+/* Drop what is buffered and carry on reading at pos */
+static LONG seekStream(MP3INFO *mp3info, long pos) {
+	LONG rc;
+	mad_stream_finish(&mp3info->sync.stream);
+	mad_stream_init(&mp3info->sync.stream);
+	mp3info->sync.frame.header.flags &= ~MAD_FLAG_INCOMPLETE;
+	mp3info->bufend = 0;
+	rc = mmioSeek(mp3info->hmmioSS, pos, SEEK_SET);
+	mp3info->filepos = mp3info->bufpos = rc;
+	return rc;
+}
+
+static BOOL indexNote(MP3INFO *mp3info, unsigned long frame, ULONG offset) {
+	ULONG *p;
+	if (frame != mp3info->indexCount*INDEXSTEP) return TRUE;
+	if (mp3info->indexCount == mp3info->indexAlloc) {
+		p = (ULONG *)realloc(mp3info->index, (mp3info->indexAlloc+1024)*sizeof(ULONG));
+		if (!p) return FALSE;
+		mp3info->index = p;
+		mp3info->indexAlloc += 1024;
+	}
+	mp3info->index[mp3info->indexCount++] = offset;
+	return TRUE;
+}
+
+/* Count the frame whose header was just decoded */
+static BOOL frameDone(MP3INFO *mp3info) {
+	BOOL rc;
+	if (mp3info->frameNo == NOFRAME) return TRUE;
+	rc = indexNote(mp3info, mp3info->frameNo,
+		mp3info->bufpos + (mp3info->sync.stream.this_frame - mp3info->buf));
+	mp3info->frameNo++;
 	return rc;
 }
 
+/* A frame whose header was good but whose data was not still counts */
+#define FRAMEERROR(stream) ((stream)->error >= MAD_ERROR_BADCRC)
+
+/* Extend the index with header-only decoding until it covers frame */
+static LONG indexReach(MP3INFO *mp3info, unsigned long frame) {
+	int rc;
+	if (mp3info->indexComplete || frame < mp3info->indexCount*INDEXSTEP) return MMIO_SUCCESS;
+	if (seekStream(mp3info, mp3info->index[mp3info->indexCount-1]) < 0) return MMIO_ERROR;
+	mp3info->frameNo = (mp3info->indexCount-1)*INDEXSTEP;
+	while (frame >= mp3info->indexCount*INDEXSTEP) {
+  		rc = mad_header_decode(&mp3info->sync.frame.header, &mp3info->sync.stream);
+		if (-1 == rc) {
+			if (MAD_ERROR_BUFLEN == mp3info->sync.stream.error ||
+			    MAD_ERROR_BUFPTR == mp3info->sync.stream.error) {
+				rc = fillStream(mp3info);
+				if (0 == rc) return MMIO_SUCCESS;
+				if (rc < 0) return MMIO_ERROR;
+			} else if(!MAD_RECOVERABLE(mp3info->sync.stream.error)) {
+				return MMIO_ERROR;
+			}
+		} else if (!frameDone(mp3info)) {
+			return MMIO_ERROR;
+		}
+	}
+	return MMIO_SUCCESS;
+}
+
+static void indexLoad(MP3INFO *mp3info) {
+	UCHAR geabuff[64];
+	EAOP2 eaop;
+	PGEA2 pgea;
+	PFEA2 pfea;
+	PVOID fealist;
+	PBYTE p;
+	MP3INDEXEA hdr;
+	ULONG cb = 0x00010000L + 256;
+
+	fealist = calloc(cb, 1);
+	if (!fealist) return;
+	eaop.fpGEA2List = (PGEA2LIST)geabuff;
+	eaop.fpFEA2List = (PFEA2LIST)fealist;
+	eaop.oError = 0;
+	pgea = &eaop.fpGEA2List->list[0];
+	eaop.fpGEA2List->cbList = sizeof(ULONG) + sizeof(GEA2) + strlen(INDEXEA);
+	eaop.fpFEA2List->cbList = cb;
+	pgea->cbName = (BYTE)strlen(INDEXEA);
+	strcpy(pgea->szName, INDEXEA);
+	pgea->oNextEntryOffset = 0;
+	if (DosQueryPathInfo(mp3info->fileName, FIL_QUERYEASFROMLIST, &eaop, sizeof(EAOP2)) ||
+	    eaop.fpFEA2List->cbList <= sizeof(ULONG)) {
+		free(fealist);
+		return;
+	}
+	pfea = &eaop.fpFEA2List->list[0];
+	p = (PBYTE)pfea->szName + pfea->cbName + 1;
+	if (pfea->cbValue >= 4 + sizeof(hdr) && *(USHORT *)p == EAT_BINARY) {
+		memcpy(&hdr, p + 4, sizeof(hdr));
+		/* a file changed since the index was made does not match it */
+		if (hdr.magic == INDEXMAGIC && hdr.step == INDEXSTEP && hdr.count > 0 &&
+		    hdr.fileSize == (ULONG)mp3info->datasize &&
+		    hdr.dataStart == (ULONG)mp3info->datastart &&
+		    *(USHORT *)(p + 2) == sizeof(hdr) + hdr.count*sizeof(ULONG) &&
+		    (mp3info->index = (ULONG *)malloc(hdr.count*sizeof(ULONG))) != NULL) {
+			memcpy(mp3info->index, p + 4 + sizeof(hdr), hdr.count*sizeof(ULONG));
+			mp3info->indexCount = mp3info->indexAlloc = hdr.count;
+			mp3info->indexFrames = hdr.frames;
+			mp3info->indexComplete = mp3info->indexLoaded = TRUE;
+			if (0 == mp3info->totalFrames) mp3info->totalFrames = hdr.frames;
+		}
+	}
+	free(fealist);
+}
+
+static void indexSave(MP3INFO *mp3info) {
+	EAOP2 eaop;
+	PFEA2LIST fealist;
+	PFEA2 pfea;
+	PBYTE p;
+	MP3INDEXEA hdr;
+	ULONG cbValue = 4 + sizeof(hdr) + mp3info->indexCount*sizeof(ULONG);
+
+	/* roughly four hours at 44.1 kHz; longer files just scan again */
+	if (cbValue > INDEXEAMAX) return;
+	fealist = (PFEA2LIST)calloc(sizeof(FEA2LIST) + sizeof(INDEXEA) + cbValue, 1);
+	if (!fealist) return;
+	hdr.magic = INDEXMAGIC;
+	hdr.fileSize = mp3info->datasize;
+	hdr.dataStart = mp3info->datastart;
+	hdr.frames = mp3info->indexFrames;
+	hdr.step = INDEXSTEP;
+	hdr.count = mp3info->indexCount;
+	pfea = &fealist->list[0];
+	pfea->oNextEntryOffset = 0;
+	pfea->fEA = 0;
+	pfea->cbName = (BYTE)strlen(INDEXEA);
+	pfea->cbValue = (USHORT)cbValue;
+	strcpy(pfea->szName, INDEXEA);
+	p = (PBYTE)pfea->szName + pfea->cbName + 1;
+	*(USHORT *)p = EAT_BINARY;
+	*(USHORT *)(p + 2) = (USHORT)(cbValue - 4);
+	memcpy(p + 4, &hdr, sizeof(hdr));
+	memcpy(p + 4 + sizeof(hdr), mp3info->index, mp3info->indexCount*sizeof(ULONG));
+	fealist->cbList = sizeof(ULONG) + sizeof(FEA2) + pfea->cbName + pfea->cbValue;
+	eaop.fpGEA2List = NULL;
+	eaop.fpFEA2List = fealist;
+	eaop.oError = 0;
+	DosSetPathInfo(mp3info->fileName, FIL_QUERYEASIZE, &eaop, sizeof(EAOP2), DSPI_WRTTHRU);
+	free(fealist);
+}
+
 static LONG getHeader(MP3INFO *mp3info) {
 	int rc;
 	do {
@@ -282,8 +468,11 @@ fprintf(file, "err: %s\n", mad_stream_errorstr(&mp3info->sync.stream));
            		if (0 == fillStream(mp3info)) return MMIO_ERROR;
    			} else if(!MAD_RECOVERABLE(mp3info->sync.stream.error)) {
           		return MMIO_ERROR;
-        	} 
+        	} else if (FRAMEERROR(&mp3info->sync.stream)) {
+        		frameDone(mp3info);
+        	}
         } else {
+             frameDone(mp3info);
              mp3info->haveHeader = TRUE;
              mp3info->firstHeader = mp3info->sync.frame.header;
 			 {
@@ -353,9 +542,8 @@ fprintf(file, "seekToEnd: err: %s\n", mad_stream_errorstr(&mp3info->sync.stream)
 static LONG seekToLocation(MP3INFO *mp3info, unsigned long location) {
     int rc;
     int bytesPerFrame, alignment;
-    unsigned long frames;
+    unsigned long frames, start, entry;
     int remainder;
-    unsigned long curFrame = 0;
     
 	if (!mp3info->haveHeader) {
 #ifdef DEBUG
@@ -369,11 +557,17 @@ fprintf(file, "seek: no header\n");
             alignment;
     frames = location/bytesPerFrame;
     remainder = location%bytesPerFrame;
-	mmioSeek(mp3info->hmmioSS, mp3info->datastart, SEEK_SET);
 #ifdef DEBUG
 fprintf(file, "seek request: %ld\n",location);
 #endif
-	while(curFrame+29 < frames) {
+	/* start from the closest indexed frame ahead of the priming frames */
+	start = (frames > INDEXPRIME) ? frames-INDEXPRIME : 0;
+	if (MMIO_SUCCESS != indexReach(mp3info, start)) return MMIO_ERROR;
+	entry = start/INDEXSTEP;
+	if (entry >= mp3info->indexCount) entry = mp3info->indexCount-1;
+	if (seekStream(mp3info, mp3info->index[entry]) < 0) return MMIO_ERROR;
+	mp3info->frameNo = entry*INDEXSTEP;
+	while(mp3info->frameNo < start) {
   		rc = mad_header_decode(&mp3info->sync.frame.header, &mp3info->sync.stream);
 		if (-1 == rc) {
 			if (MAD_ERROR_BUFLEN == mp3info->sync.stream.error ||
@@ -392,7 +586,7 @@ fprintf(file, "seekToLocation: err: %s\n", mad_stream_errorstr(&mp3info->sync.st
           		return MMIO_ERROR;
         	}
         } else {
-            curFrame++;
+            frameDone(mp3info);
 			mp3info->vbr += mp3info->sync.frame.header.bitrate/1000;
 			mp3info->frames++;
 		}
@@ -400,7 +594,7 @@ fprintf(file, "seekToLocation: err: %s\n", mad_stream_errorstr(&mp3info->sync.st
 #ifdef DEBUG
 fprintf(file, "seek: almost there\n");
 #endif
-	while(curFrame < frames) {
+	while(mp3info->frameNo < frames) {
   		rc = mad_header_decode(&mp3info->sync.frame.header, &mp3info->sync.stream);
 		if (-1 == rc) {
 			if (MAD_ERROR_BUFLEN == mp3info->sync.stream.error ||
@@ -419,8 +613,8 @@ fprintf(file, "seekToLocation: err: %s\n", mad_stream_errorstr(&mp3info->sync.st
           		return MMIO_ERROR;
         	}
         } else {
+            frameDone(mp3info);
             mad_frame_decode(&mp3info->sync.frame, &mp3info->sync.stream);
-            curFrame++;
 			mp3info->vbr += mp3info->sync.frame.header.bitrate/1000;
 			mp3info->frames++;
 		}
@@ -428,7 +622,7 @@ fprintf(file, "seekToLocation: err: %s\n", mad_stream_errorstr(&mp3info->sync.st
 #ifdef DEBUG
 fprintf(file, "seek: really close now\n");
 #endif
-    if (curFrame > 0) {
+    if (frames > 0) {
 		mad_synth_frame(&mp3info->sync.synth, &mp3info->sync.frame);
     } /* endif */
     while (1) {
@@ -437,10 +631,10 @@ fprintf(file, "seek: really close now\n");
 			if (MAD_ERROR_BUFLEN == mp3info->sync.stream.error ||
 			    MAD_ERROR_BUFPTR == mp3info->sync.stream.error) {
   	     	    rc = fillStream(mp3info);
-  	     	    if (rc == 0 && curFrame>=mp3info->totalFrames) return bytesPerFrame*curFrame;
+  	     	    if (rc == 0 && frames>=mp3info->totalFrames) return bytesPerFrame*frames;
            		if (rc <= 0) {
 #ifdef DEBUG
-fprintf(file, "cur: %ld, total :%ld\n", curFrame, mp3info->totalFrames);
+fprintf(file, "cur: %ld, total :%ld\n", mp3info->frameNo, mp3info->totalFrames);
 fprintf(file, "seekToLocation: rcerr: %d\n", rc);
 #endif
            			return MMIO_ERROR;
@@ -450,8 +644,11 @@ fprintf(file, "seekToLocation: rcerr: %d\n", rc);
 fprintf(file, "seekToLocation: err: %s\n", mad_stream_errorstr(&mp3info->sync.stream));
 #endif
           		return MMIO_ERROR;
+        	} else if (FRAMEERROR(&mp3info->sync.stream)) {
+        		frameDone(mp3info);
         	}
         } else {
+            frameDone(mp3info);
 			mad_synth_frame(&mp3info->sync.synth, &mp3info->sync.frame);
 #ifdef DEBUG
 if (0 != remainder%(BYTES_PER_SAMPLE*MAD_NCHANNELS(&(mp3info->firstHeader)))) {
@@ -461,8 +658,8 @@ if (0 != remainder%(BYTES_PER_SAMPLE*MAD_NCHANNELS(&(mp3info->firstHeader)))) {
 } /* endif */
 #endif
 			remainder = (remainder/alignment)*alignment;
-		    mp3info->ptr = (remainder/alignment)*alignment;
-		    mp3info->location = remainder+bytesPerFrame*curFrame;
+		    mp3info->ptr = remainder/alignment;
+		    mp3info->location = remainder+bytesPerFrame*frames;
 		    return mp3info->location;
         }
     }
@@ -587,6 +784,16 @@ if (mp3info->local) {
 			skipId3v2(hmmioSS);
 			mp3info->datastart = mmioSeek(hmmioSS,0L,SEEK_CUR);
 			mp3info->location = 0;
+			mp3info->filepos = mp3info->bufpos = mp3info->datastart;
+			mp3info->frameNo = 0;
+			strncpy(mp3info->fileName, pszFileName, CCHMAXPATH-1);
+			if (mp3info->local) indexLoad(mp3info);
+			if (0 == mp3info->indexCount && !indexNote(mp3info, 0, mp3info->datastart)) {
+            	mmioClose(hmmioSS, 0);
+            	free(mp3info);
+            	pmmioinfo->pExtraInfoStruct = 0;
+            	return MMIO_ERROR;
+			}
 #ifdef DEBUG
 			fprintf(file,"Open successfull: %ld\n",mp3info->sync.stream.next_frame-mp3info->buf);
 #endif
@@ -606,6 +813,7 @@ if (mp3info->local) {
      		return mmioRead (mp3info->hmmioSS, (PVOID) lParam1, (ULONG) lParam2);
      	} else {
          	int total;
+         	unsigned char *pOut = (unsigned char *)lParam1;
          	
 			if (!mp3info->haveHeader) {
 	         	LONG rc;
@@ -648,9 +856,12 @@ fprintf(file, "fill error: %d\n", rc);
 fprintf(file, "0 err: %s\n", mad_stream_errorstr(&mp3info->sync.stream));
 #endif
     			      		return MMIO_ERROR;
+      			    	} else if (FRAMEERROR(&mp3info->sync.stream)) {
+      			    		frameDone(mp3info);
       			    	}
 		      	  }
 			 	} while (-1 == rc);
+			 	frameDone(mp3info);
 			 	mp3info->vbr += mp3info->sync.frame.header.bitrate/1000;
 			 	mp3info->frames++;
 #ifdef DEBUG
@@ -663,6 +874,8 @@ fprintf(file, "0 err: %s\n", mad_stream_errorstr(&mp3info->sync.stream));
 			while (1) {
 				signed int sample;
 				int sampleSize = (mp3info->sync.synth.pcm.channels == 2)?4:2;
+				mad_fixed_t const *left, *right;
+				int n;
 				while (mp3info->outsize > 0) {
 					if (total >= lParam2) {
 						mp3info->location += total;
@@ -672,29 +885,45 @@ fprintf(file, "location: %ld\n",mp3info->location);
 						return total;
 					}
 					mp3info->outsize--;
-					*((unsigned char *)lParam1) = mp3info->out[mp3info->outsize];
-					lParam1++;
+					*pOut++ = mp3info->out[mp3info->outsize];
 					total++;
 				}
-
+
 				if (mp3info->ptr >= mp3info->sync.synth.pcm.length) {
        				mp3info->ptr = -1;
 					break;
 				}
 				
-				/* output sample(s) in 16-bit signed little-endian PCM */
-
-			    sample = scale(mp3info->sync.synth.pcm.samples[0][mp3info->ptr]);
+				/* output sample(s) in 16-bit signed little-endian PCM,
+				   as many whole ones as fit straight into the caller's buffer */
+
+				n = (lParam2 - total)/sampleSize;
+				if (n > mp3info->sync.synth.pcm.length - mp3info->ptr)
+					n = mp3info->sync.synth.pcm.length - mp3info->ptr;
+				mad_pcm_s16(pOut, &mp3info->sync.synth.pcm, mp3info->ptr, n);
+				pOut += n*sampleSize;
+				total += n*sampleSize;
+				mp3info->ptr += n;
+				if (total >= lParam2) {
+					mp3info->location += total;
+					return total;
+				}
+				if (mp3info->ptr >= mp3info->sync.synth.pcm.length) continue;
+
+				/* the buffer ends inside this sample; what does not fit waits in out */
+				left = &mp3info->sync.synth.pcm.samples[0][mp3info->ptr];
+				right = &mp3info->sync.synth.pcm.samples[1][mp3info->ptr];
+			    sample = scale(left[0]);
    				if (mp3info->sync.synth.pcm.channels == 2) {
-				    mp3info->out[3] = (sample >> 0) & 0xff;
+				    mp3info->out[3] = (sample >> 0) & 0xff;
 				    mp3info->out[2] = (sample >> 8) & 0xff;
 				} else {
 				    mp3info->out[1] = (sample >> 0) & 0xff;
 				    mp3info->out[0] = (sample >> 8) & 0xff;
        			}
-
-   				if (mp3info->sync.synth.pcm.channels == 2) {
-				    sample = scale(mp3info->sync.synth.pcm.samples[1][mp3info->ptr]);
+
+   				if (mp3info->sync.synth.pcm.channels == 2) {
+				    sample = scale(right[0]);
 				    mp3info->out[1] = (sample >> 0) & 0xff;
 				    mp3info->out[0] = (sample >> 8) & 0xff;
 				}
@@ -774,6 +1003,7 @@ fprintf(file, "location: %ld\n",mp3info->location);
 			fprintf(file,"File Seeked\n");
 #endif
 			mp3info->location = lNewPos;
+			mp3info->filepos = lNewPos;
 		
 			fillStream(mp3info);
 		
@@ -787,6 +1017,7 @@ fprintf(file, "location: %ld\n",mp3info->location);
 	case MMIOM_CLOSE: {
 		MP3INFO *mp3info;
 		HMMIO hmmioSS;
+		LONG rc;
 		if (!pmmioinfo) return MMIO_ERROR;
 		
 		mp3info = (MP3INFO*)pmmioinfo->pExtraInfoStruct;
@@ -796,13 +1027,19 @@ fprintf(file, "location: %ld\n",mp3info->location);
    			mad_frame_finish(&mp3info->sync.frame);
    			mad_synth_finish(&mp3info->sync.synth);
  		    mp3info->haveHeader = FALSE;
+			rc = mmioClose(hmmioSS, 0);
+			/* the file is closed now, so the EA can be written */
+			if (mp3info->local && mp3info->indexComplete && !mp3info->indexLoaded) {
+				indexSave(mp3info);
+			}
+			free (mp3info->index);
      		free (mp3info);
 			pmmioinfo->pExtraInfoStruct = 0;
 			mp3info = 0;
 #ifdef DEBUG
        	    fprintf(file,"CLOSE\n");
 #endif
-	       	return mmioClose(hmmioSS, 0);
+	       	return rc;
      	}
      	return MMIO_ERROR;
     }
@@ -17,6 +17,7 @@
 #include <vorbis/vorbisenc.h>
 #include <float.h>
 #include "mmioVorbis.h"
+#include "mmiobuf.h"
 
 #ifdef DEBUG
 static FILE *file;
@@ -64,6 +65,74 @@ long mtell(void *datasource) {
    	return mmioSeek((HMMIO)datasource, 0, SEEK_CUR);
 }
 
+/*
+ * The same on top of mmiobuf: vorbisfile asks for a few KB at a time,
+ * which on a network share means waiting on the server for every page.
+ */
+
+#define VORBIS_READBUF 65536L
+
+size_t bread(void *ptr, size_t size, size_t nmemb, void *datasource)
+{
+	if (!ptr || !datasource) return -1;
+	return mmioBufRead((PMMIOBUF)datasource, ptr, nmemb);
+}
+
+int bseek(void *datasource, ogg_int64_t offset, int whence) {
+ 	long rc = mmioBufSeek((PMMIOBUF)datasource, offset, whence);
+ 	if (rc < 0) return rc;
+ 	return 0;
+}
+
+int bclose(void *datasource){
+	if (!datasource) return -1;
+	return mmioBufClose((PMMIOBUF)datasource, 0);
+}
+
+long btell(void *datasource) {
+   	return mmioBufSeek((PMMIOBUF)datasource, 0, SEEK_CUR);
+}
+
+/*
+ * Float PCM from the decoder straight into the caller's buffer as 16-bit
+ * samples. ov_read() does the same, but built with Watcom its float to
+ * int cast goes through the runtime a sample at a time.
+ */
+
+int  __cdecl ov_sse2_present(void);
+void __cdecl ov_pcm_s16_sse2(short *, float const *, float const *, unsigned int);
+
+static int volatile sse2 = -1;
+
+/* Round to nearest without touching the FPU control word: adding 1.5*2^23
+   leaves the integer in the low bits of the float. The sum is exact even
+   in the FPU's wider format, so storing it rounds just once */
+static short s16(float f)
+{
+    union { float f; long i; } u;
+
+    if (f >= 32767.0f/32768.0f) return 32767;
+    if (f <= -1.0f) return -32768;
+    u.f = f*32768.0f + 12582912.0f;
+    return (short)(u.i - 0x4B400000L);
+}
+
+static void pcm_s16(short *out, float **pcm, int channels, long samples)
+{
+    long j = 0;
+    int i;
+
+    if (sse2 < 0) sse2 = ov_sse2_present();
+    if (sse2 && channels <= 2) {
+        j = samples & ~7L;
+        ov_pcm_s16_sse2(out, pcm[0], 2 == channels ? pcm[1] : NULL, j);
+        out += j*channels;
+    }
+    for ( ; j < samples; j++)
+        for (i = 0; i < channels; i++)
+            *out++ = s16(pcm[i][j]);
+}
+
 typedef struct _DecInfo {
   int t; /*Always READNUM */
   PVORBISOPTIONS vorbisOptions;
@@ -194,13 +263,22 @@ static LONG APIENTRY IOProc_Entry2(PVOID pmmioStr, USHORT usMsg, LONG lParam1,
  	      		pmmioinfo->pExtraInfoStruct = (PVOID)decInfo;
   	     		{
             		ov_callbacks cb;
-   	         		cb.read_func = mread;
-            		cb.seek_func = mseek;
-            		cb.close_func = mclose;
-            		cb.tell_func = mtell;
-	       			if(0 != ov_open_callbacks((void *)hmmioSS, &decInfo->oggfile, 0, 0, cb)) {
+            		void *src = mmioBufOpen(hmmioSS, VORBIS_READBUF, MMIOBUF_READAHEAD);
+            		if (src) {
+   	         			cb.read_func = bread;
+            			cb.seek_func = bseek;
+            			cb.close_func = bclose;
+            			cb.tell_func = btell;
+            		} else {
+            			src = (void *)hmmioSS;
+   	         			cb.read_func = mread;
+            			cb.seek_func = mseek;
+            			cb.close_func = mclose;
+            			cb.tell_func = mtell;
+            		}
+	       			if(0 != ov_open_callbacks(src, &decInfo->oggfile, 0, 0, cb)) {
            	  			free(decInfo);
-	            		mmioClose(hmmioSS, 0);
+	            		cb.close_func(src);
  	           			return MMIO_ERROR;
              		}
             	}
@@ -238,21 +316,36 @@ static LONG APIENTRY IOProc_Entry2(PVOID pmmioStr, USHORT usMsg, LONG lParam1,
 //     		return mmioRead (ogginfo->hmmioSS, (PVOID) lParam1, (ULONG) lParam2);
      	} else {
 			OggVorbis_File *oggfile;
+			vorbis_info *vi;
+			float **pcm;
 			long rc = 0;
 			int current_section;
 			long total = 0;
+			long frame;
 			
 			oggfile = &((DecInfo *)pmmioinfo->pExtraInfoStruct)->oggfile;
 			if (READNUM != ((DecInfo *)pmmioinfo->pExtraInfoStruct)->t) return MMIO_ERROR;
-			while (lParam2 > 0) {
-	         	rc = ov_read(oggfile, (char *)lParam1, (int)lParam2, 0, 2, 1,  &current_section);
-	         	if (rc < 0) {
+			/* fill the whole buffer, a decoded block at a time */
+			while (1) {
+				vi = ov_info(oggfile, -1);
+				if (!vi) break;
+				frame = 2*vi->channels;
+				if (lParam2 < frame) break;
+	         	rc = ov_read_float(oggfile, &pcm, lParam2/frame, &current_section);
+	         	if (OV_HOLE == rc) {
 #ifdef DEBUG
 fprintf(file, "Read failed once\n");
 #endif
 				continue;
 				}
 				if (rc <= 0) break;
+				/* a chained stream may have just switched links */
+				vi = ov_info(oggfile, -1);
+				if (!vi) break;
+				frame = 2*vi->channels;
+				if (rc > lParam2/frame) rc = lParam2/frame;
+				pcm_s16((short *)lParam1, pcm, vi->channels, rc);
+				rc *= frame;
 				lParam2 -= rc;
 				lParam1 += rc;
 				total += rc;
@@ -260,7 +353,7 @@ fprintf(file, "Read failed once\n");
 #ifdef DEBUG
 fprintf(file,"Read rc:%ld total:%ld\n",rc,total);
 #endif
-         	if (rc < 0) return MMIO_ERROR;
+         	if (rc < 0 && !total) return MMIO_ERROR;
          	return total;
         }
    	}
@@ -0,0 +1,133 @@
+;
+; mmioVorbis - SSE2 float to 16-bit PCM for x86
+;
+; Vorbis decodes to one float array per channel, nominally -1.0..1.0.
+; Samples are scaled by 32768, clipped to -32768..32767 while still
+; floats and converted with the rounding of MXCSR (to nearest unless
+; someone changed it), 8 per round.
+;
+; All routines use the __cdecl convention.
+;
+
+        name    pcm_sse2
+
+.686p
+IFDEF __JWASM__
+.xmm
+ELSE
+.xmm2
+ENDIF
+
+_TEXT   segment use32 dword public 'CODE'
+
+        assume  cs:_TEXT
+
+        public  _ov_sse2_present
+        public  _ov_pcm_s16_sse2
+
+;
+; Scale, clip and convert the 4 floats at src into dst
+;
+CVT4    macro   dst, src
+        movups  dst, src
+        mulps   dst, xmm5
+        minps   dst, xmm6
+        maxps   dst, xmm7
+        cvtps2dq dst, dst
+        endm
+
+;
+; int ov_sse2_present(void);
+;
+; Nonzero if the CPU has CPUID and reports FXSR and SSE2
+;
+_ov_sse2_present proc near
+        push    ebx
+        pushfd
+        pop     eax
+        mov     ecx, eax
+        xor     eax, 200000h            ; can the ID flag be changed?
+        push    eax
+        popfd
+        pushfd
+        pop     eax
+        push    ecx
+        popfd
+        xor     eax, ecx
+        and     eax, 200000h
+        jz      no_sse2
+        mov     eax, 1
+        cpuid
+        and     edx, 05000000h          ; SSE2 and FXSR
+        xor     eax, eax
+        cmp     edx, 05000000h
+        jne     no_sse2
+        inc     eax
+no_sse2:
+        pop     ebx
+        ret
+_ov_sse2_present endp
+
+;
+; void ov_pcm_s16_sse2(short *out, float const *left, float const *right,
+;                      unsigned int n);
+;
+; Store n (a multiple of 8) samples as 16-bit PCM, interleaved if right
+; is not NULL
+;
+_ov_pcm_s16_sse2 proc near
+        push    esi
+        push    edi
+        mov     edi, [esp+12]           ; out
+        mov     esi, [esp+16]           ; left
+        mov     edx, [esp+20]           ; right
+        mov     ecx, [esp+24]           ; n
+        mov     eax, 47000000h          ; 32768.0
+        movd    xmm5, eax
+        pshufd  xmm5, xmm5, 0
+        mov     eax, 46FFFE00h          ; 32767.0
+        movd    xmm6, eax
+        pshufd  xmm6, xmm6, 0
+        mov     eax, 0C7000000h         ; -32768.0
+        movd    xmm7, eax
+        pshufd  xmm7, xmm7, 0
+        shr     ecx, 3
+        jz      s16_done
+        test    edx, edx
+        jz      s16_mono
+s16_stereo:
+        CVT4    xmm0, [esi]
+        CVT4    xmm1, [esi+16]
+        CVT4    xmm2, [edx]
+        CVT4    xmm3, [edx+16]
+        packssdw xmm0, xmm1
+        packssdw xmm2, xmm3
+        movdqa  xmm1, xmm0
+        punpcklwd xmm0, xmm2
+        punpckhwd xmm1, xmm2
+        movdqu  [edi], xmm0
+        movdqu  [edi+16], xmm1
+        add     esi, 32
+        add     edx, 32
+        add     edi, 32
+        dec     ecx
+        jnz     s16_stereo
+        jmp     s16_done
+s16_mono:
+        CVT4    xmm0, [esi]
+        CVT4    xmm1, [esi+16]
+        packssdw xmm0, xmm1
+        movdqu  [edi], xmm0
+        add     esi, 32
+        add     edi, 16
+        dec     ecx
+        jnz     s16_mono
+s16_done:
+        pop     edi
+        pop     esi
+        ret
+_ov_pcm_s16_sse2 endp
+
+_TEXT   ends
+
+        end
@@ -0,0 +1,18 @@
+/* Common I/O Procedure behind all GBM formats */
+
+#ifndef GBMPROC_H
+#define GBMPROC_H
+
+/* What tells one GBM format proc from another */
+typedef struct _GBMPROCFMT
+{
+  PSZ     pszShortName;           /* GBM file type the proc handles */
+  PSZ     pszFormatName;          /* MMIOM_GETFORMATNAME answer    */
+  FOURCC  fccIOProc;
+  ULONG   ulFlags;                /* MMIO_CAN... flags             */
+  PSZ     pszExt;                 /* default file extension        */
+} GBMPROCFMT;
+
+LONG GbmIOProc(GBMPROCFMT *pFmt, PVOID pmmioStr, USHORT usMsg, LONG lParam1, LONG lParam2);
+
+#endif
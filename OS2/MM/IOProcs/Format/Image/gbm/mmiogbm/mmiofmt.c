@@ -0,0 +1,533 @@
+/* Generated by makeproc: one GBMPROCFMT and entry point per extension */
+#define INCL_32
+#include <os2.h>
+#include <mmioos2.h>
+#include "gbmproc.h"
+static GBMPROCFMT fmtBMP =
+{
+  "Bitmap",
+  "OS/2 / Windows bitmap (BMP)",
+  0x20504d42,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "BMP"
+};
+LONG EXPENTRY BMPproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtBMP, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtVGA =
+{
+  "Bitmap",
+  "OS/2 / Windows bitmap (VGA)",
+  0x20414756,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "VGA"
+};
+LONG EXPENTRY VGAproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtVGA, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtBGA =
+{
+  "Bitmap",
+  "OS/2 / Windows bitmap (BGA)",
+  0x20414742,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "BGA"
+};
+LONG EXPENTRY BGAproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtBGA, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtRLE =
+{
+  "Bitmap",
+  "OS/2 / Windows bitmap (RLE)",
+  0x20454c52,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "RLE"
+};
+LONG EXPENTRY RLEproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtRLE, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtDIB =
+{
+  "Bitmap",
+  "OS/2 / Windows bitmap (DIB)",
+  0x20424944,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "DIB"
+};
+LONG EXPENTRY DIBproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtDIB, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtRL4 =
+{
+  "Bitmap",
+  "OS/2 / Windows bitmap (RL4)",
+  0x20344c52,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "RL4"
+};
+LONG EXPENTRY RL4proc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtRL4, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtRL8 =
+{
+  "Bitmap",
+  "OS/2 / Windows bitmap (RL8)",
+  0x20384c52,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "RL8"
+};
+LONG EXPENTRY RL8proc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtRL8, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtGIF =
+{
+  "GIF",
+  "CompuServe Graphics Interchange Format (GIF)",
+  0x20464947,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "GIF"
+};
+LONG EXPENTRY GIFproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtGIF, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPCX =
+{
+  "PCX",
+  "ZSoft PC Paintbrush Image format (PCX)",
+  0x20584350,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PCX"
+};
+LONG EXPENTRY PCXproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPCX, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPCC =
+{
+  "PCX",
+  "ZSoft PC Paintbrush Image format (PCC)",
+  0x20434350,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PCC"
+};
+LONG EXPENTRY PCCproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPCC, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtTIF =
+{
+  "TIFF",
+  "Tagged Image File Format support (TIFF 6.0) (TIF)",
+  0x20464954,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "TIF"
+};
+LONG EXPENTRY TIFproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtTIF, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtTIFF =
+{
+  "TIFF",
+  "Tagged Image File Format support (TIFF 6.0) (TIFF)",
+  0x46464954,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "TIFF"
+};
+LONG EXPENTRY TIFFproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtTIFF, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtTGA =
+{
+  "Targa",
+  "Truevision Targa/Vista bitmap (TGA)",
+  0x20414754,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "TGA"
+};
+LONG EXPENTRY TGAproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtTGA, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtVST =
+{
+  "Targa",
+  "Truevision Targa/Vista bitmap (VST)",
+  0x20545356,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "VST"
+};
+LONG EXPENTRY VSTproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtVST, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtAFI =
+{
+  "Targa",
+  "Truevision Targa/Vista bitmap (AFI)",
+  0x20494641,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "AFI"
+};
+LONG EXPENTRY AFIproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtAFI, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtIFF =
+{
+  "ILBM",
+  "Amiga IFF / ILBM Interleaved bitmap (IFF)",
+  0x20464649,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "IFF"
+};
+LONG EXPENTRY IFFproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtIFF, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtLBM =
+{
+  "ILBM",
+  "Amiga IFF / ILBM Interleaved bitmap (LBM)",
+  0x204d424c,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "LBM"
+};
+LONG EXPENTRY LBMproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtLBM, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtVID =
+{
+  "YUV12C",
+  "YUV12C M-Motion Video Frame Buffer (VID)",
+  0x20444956,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "VID"
+};
+LONG EXPENTRY VIDproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtVID, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPBM =
+{
+  "Bit-map",
+  "Portable Bit-map (PBM)",
+  0x204d4250,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PBM"
+};
+LONG EXPENTRY PBMproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPBM, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPGM =
+{
+  "Greymap",
+  "Portable Greyscale-map (PGM)",
+  0x204d4750,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PGM"
+};
+LONG EXPENTRY PGMproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPGM, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPPM =
+{
+  "Pixmap",
+  "Portable Pixel-map (PPM)",
+  0x204d5050,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PPM"
+};
+LONG EXPENTRY PPMproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPPM, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPNM =
+{
+  "Anymap",
+  "Portable Any-map (PNM)",
+  0x204d4e50,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PNM"
+};
+LONG EXPENTRY PNMproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPNM, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtKPS =
+{
+  "KIPS",
+  "IBM KIPS (KPS)",
+  0x2053504b,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "KPS"
+};
+LONG EXPENTRY KPSproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtKPS, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtIAX =
+{
+  "IAX",
+  "IBM Image Access eXecutive (IAX)",
+  0x20584149,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "IAX"
+};
+LONG EXPENTRY IAXproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtIAX, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtXBM =
+{
+  "XBitmap",
+  "X Windows Bitmap (XBM)",
+  0x204d4258,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "XBM"
+};
+LONG EXPENTRY XBMproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtXBM, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtXPM =
+{
+  "XPixMap",
+  "X Windows PixMap (XPM)",
+  0x204d5058,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "XPM"
+};
+LONG EXPENTRY XPMproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtXPM, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtSPR =
+{
+  "Sprite",
+  "Archimedes Sprite from RiscOS (SPR)",
+  0x20525053,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "SPR"
+};
+LONG EXPENTRY SPRproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtSPR, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtSPRITE =
+{
+  "Sprite",
+  "Archimedes Sprite from RiscOS (SPRITE)",
+  0x49525053,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "SPRITE"
+};
+LONG EXPENTRY SPRITEproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtSPRITE, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPSE =
+{
+  "PSEG",
+  "IBM Printer Page Segment (PSE)",
+  0x20455350,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PSE"
+};
+LONG EXPENTRY PSEproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPSE, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPSEG =
+{
+  "PSEG",
+  "IBM Printer Page Segment (PSEG)",
+  0x47455350,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PSEG"
+};
+LONG EXPENTRY PSEGproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPSEG, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPSEG38PP =
+{
+  "PSEG",
+  "IBM Printer Page Segment (PSEG38PP)",
+  0x47455350,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PSEG38PP"
+};
+LONG EXPENTRY PSEG38PPproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPSEG38PP, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPSEG3820 =
+{
+  "PSEG",
+  "IBM Printer Page Segment (PSEG3820)",
+  0x47455350,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PSEG3820"
+};
+LONG EXPENTRY PSEG3820proc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPSEG3820, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtIMG =
+{
+  "GemRas",
+  "GEM Raster (IMG)",
+  0x20474d49,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "IMG"
+};
+LONG EXPENTRY IMGproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtIMG, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtXIMG =
+{
+  "GemRas",
+  "GEM Raster (XIMG)",
+  0x474d4958,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "XIMG"
+};
+LONG EXPENTRY XIMGproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtXIMG, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtCVP =
+{
+  "Portrait",
+  "Portrait (CVP)",
+  0x20505643,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "CVP"
+};
+LONG EXPENTRY CVPproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtCVP, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtPNG =
+{
+  "PNG",
+  "Portable Network Graphics Format (PNG)",
+  0x20474e50,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "PNG"
+};
+LONG EXPENTRY PNGproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtPNG, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtJPG =
+{
+  "JPEG",
+  "JPEG Interchange File Format (JPG)",
+  0x2047504a,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "JPG"
+};
+LONG EXPENTRY JPGproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtJPG, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtJPEG =
+{
+  "JPEG",
+  "JPEG Interchange File Format (JPEG)",
+  0x4745504a,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "JPEG"
+};
+LONG EXPENTRY JPEGproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtJPEG, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtJPE =
+{
+  "JPEG",
+  "JPEG Interchange File Format (JPE)",
+  0x2045504a,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "JPE"
+};
+LONG EXPENTRY JPEproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtJPE, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtJP2 =
+{
+  "JP2",
+  "JPEG2000 Graphics File Format (JP2)",
+  0x2032504a,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "JP2"
+};
+LONG EXPENTRY JP2proc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtJP2, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtJ2C =
+{
+  "JP2",
+  "JPEG2000 Graphics File Format (J2C)",
+  0x2043324a,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "J2C"
+};
+LONG EXPENTRY J2Cproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtJ2C, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtJ2K =
+{
+  "J2K",
+  "JPEG2000 Codestream (J2K)",
+  0x204b324a,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "J2K"
+};
+LONG EXPENTRY J2Kproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtJ2K, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtJPC =
+{
+  "J2K",
+  "JPEG2000 Codestream (JPC)",
+  0x2043504a,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED|MMIO_CANWRITETRANSLATED,
+  "JPC"
+};
+LONG EXPENTRY JPCproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtJPC, pmmioStr, usMsg, lParam1, lParam2);
+}
+static GBMPROCFMT fmtJPT =
+{
+  "JPT",
+  "JPT Stream (JPEG2000, JPIP) (JPT)",
+  0x2054504a,
+  MMIO_CANREADTRANSLATED|MMIO_CANSEEKTRANSLATED,
+  "JPT"
+};
+LONG EXPENTRY JPTproc(PVOID pmmioStr,USHORT usMsg,LONG lParam1,LONG lParam2)
+{
+  return GbmIOProc(&fmtJPT, pmmioStr, usMsg, lParam1, lParam2);
+}
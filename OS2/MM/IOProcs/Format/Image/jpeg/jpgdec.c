@@ -0,0 +1,556 @@
+/*
+ * JPEG decoding for the JPEG IOProc straight through the IJG library
+ *
+ * GBM always decodes at full size, a scanline at a time. Here the file
+ * is read into memory once and decoded with libjpeg directly, which
+ * allows two things GBM does not:
+ *
+ * - DCT scaling. If the caller passes a JPGOPTIONS with a maximum size
+ *   the image is decoded at 1/2, 1/4 or 1/8 of its size, whichever is
+ *   smallest while still no smaller than asked. The IDCT then works out
+ *   only the coefficients that matter and everything after it handles
+ *   a quarter to a sixty-fourth of the pixels.
+ *
+ * - Decoding bands of the image on several threads. With restart
+ *   markers the entropy-coded data falls into intervals that decode on
+ *   their own. Where an interval boundary meets the start of an MCU row
+ *   the image can be cut: each band becomes a JPEG of its own (the
+ *   headers with the frame height patched, its intervals with the
+ *   restart markers renumbered, EOI) and goes to a separate
+ *   decompressor. One row group above and below each band is decoded
+ *   too and thrown away, so chroma upsampling sees the same neighbours
+ *   it would in one piece and the result is that of a single decode.
+ *
+ * If anything does not fit (progressive or multi-scan files, CMYK, no
+ * restart markers, a band that fails) the whole image is decoded in one
+ * piece, and files libjpeg cannot take at all are left to GBM.
+ */
+
+#define INCL_DOS
+#include <os2.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <process.h>
+#include <jpeglib.h>
+#include <jerror.h>
+#include "jpgproc.h"
+
+#define MAXBANDS    8
+#define BANDGROUPS  4             /* row groups per band at least */
+
+#ifndef QSV_NUMPROCESSORS
+#define QSV_NUMPROCESSORS 26
+#endif
+
+typedef struct _JPGDEC
+{
+  PBYTE   pbFile;                 /* the whole file                */
+  ULONG   cbFile;
+  int     iScale;                 /* scale_num, over 8             */
+  ULONG   ulWidth, ulHeight;      /* as decoded                    */
+  int     nComp;                  /* 1 grey, 3 colour              */
+
+  /* Where the image can be cut, 0 intervals if it can't */
+  ULONG   cbHead;                 /* SOI up to the end of SOS      */
+  ULONG   offSOF;                 /* frame height in the SOF       */
+  ULONG   ulImgH;                 /* frame height in pixels        */
+  ULONG   ulMcuH;                 /* MCU height in pixels          */
+  ULONG   ulMcusPerRow, ulMcuRows;
+  ULONG   ulInterval;             /* restart interval, in MCUs     */
+  ULONG   nIntervals;
+  ULONG  *pulStart, *pulEnd;      /* entropy data of each interval */
+} JPGDEC;
+
+typedef struct _JPGBAND
+{
+  JPGDEC *pDec;
+  PBYTE   pbSrc;                  /* JPEG stream to decode         */
+  ULONG   cbSrc;
+  ULONG   ulSkip;                 /* output rows only for context  */
+  ULONG   ulFirst;                /* image row of the first kept   */
+  ULONG   ulRows;                 /* rows kept                     */
+  PBYTE   pbDst;
+  ULONG   cbStride;
+  int     tid;
+  BOOL    fOk;
+} JPGBAND;
+
+typedef struct _JPGERR
+{
+  struct jpeg_error_mgr pub;
+  jmp_buf jb;
+} JPGERR;
+
+static void JpgErrorExit(j_common_ptr cinfo)
+{
+  longjmp(((JPGERR *)cinfo->err)->jb, 1);
+}
+
+static void JpgMessage(j_common_ptr cinfo)
+{
+#ifdef DEBUG
+  char buf[JMSG_LENGTH_MAX];
+
+  (*cinfo->err->format_message)(cinfo, buf);
+  writeLog("jpgdec: %s\n", buf);
+#endif
+}
+
+/* Source manager reading from memory */
+
+static void MemInit(j_decompress_ptr cinfo)
+{
+}
+
+static boolean MemFill(j_decompress_ptr cinfo)
+{
+  static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+
+  WARNMS(cinfo, JWRN_JPEG_EOF);
+  cinfo->src->next_input_byte = eoi;
+  cinfo->src->bytes_in_buffer = 2;
+  return TRUE;
+}
+
+static void MemSkip(j_decompress_ptr cinfo, long num_bytes)
+{
+  struct jpeg_source_mgr *src = cinfo->src;
+
+  if (num_bytes <= 0)
+    return;
+  while (num_bytes > (long)src->bytes_in_buffer)
+    {
+      num_bytes -= (long)src->bytes_in_buffer;
+      MemFill(cinfo);
+    }
+  src->next_input_byte += num_bytes;
+  src->bytes_in_buffer -= num_bytes;
+}
+
+static void MemTerm(j_decompress_ptr cinfo)
+{
+}
+
+static void MemSrc(j_decompress_ptr cinfo, struct jpeg_source_mgr *src,
+                   PBYTE pb, ULONG cb)
+{
+  src->init_source = MemInit;
+  src->fill_input_buffer = MemFill;
+  src->skip_input_data = MemSkip;
+  src->resync_to_restart = jpeg_resync_to_restart;
+  src->term_source = MemTerm;
+  src->next_input_byte = pb;
+  src->bytes_in_buffer = cb;
+  cinfo->src = src;
+}
+
+static ULONG GetBE16(PBYTE p)
+{
+  return ((ULONG)p[0] << 8) | p[1];
+}
+
+/*
+ * Decode pBand->pbSrc and put its rows, bottom-up and in BGR order as
+ * GBM would, into the bitmap.
+ */
+static BOOL DecodeBand(JPGBAND *pBand)
+{
+  JPGDEC *pDec = pBand->pDec;
+  struct jpeg_decompress_struct cinfo;
+  struct jpeg_source_mgr src;
+  JPGERR err;
+  JSAMPARRAY rows;
+  ULONG y, x;
+  PBYTE s, d;
+
+  cinfo.err = jpeg_std_error(&err.pub);
+  err.pub.error_exit = JpgErrorExit;
+  err.pub.output_message = JpgMessage;
+  if (setjmp(err.jb))
+    {
+      jpeg_destroy_decompress(&cinfo);
+      return FALSE;
+    }
+  jpeg_create_decompress(&cinfo);
+  MemSrc(&cinfo, &src, pBand->pbSrc, pBand->cbSrc);
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.scale_num = pDec->iScale;
+  cinfo.scale_denom = 8;
+  cinfo.out_color_space = (pDec->nComp == 1) ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_start_decompress(&cinfo);
+  if (cinfo.output_width != pDec->ulWidth ||
+      cinfo.output_height < pBand->ulSkip + pBand->ulRows)
+    {
+      jpeg_destroy_decompress(&cinfo);
+      return FALSE;
+    }
+
+  rows = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE,
+                                    cinfo.output_width * cinfo.output_components, 1);
+  while (cinfo.output_scanline < pBand->ulSkip + pBand->ulRows)
+    {
+      y = cinfo.output_scanline;
+      jpeg_read_scanlines(&cinfo, rows, 1);
+      if (y < pBand->ulSkip)
+        continue;
+      y = pBand->ulFirst + y - pBand->ulSkip;
+      d = pBand->pbDst + (pDec->ulHeight - 1 - y) * pBand->cbStride;
+      s = rows[0];
+      if (pDec->nComp == 1)
+        memcpy(d, s, pDec->ulWidth);
+      else
+        for (x = 0; x < pDec->ulWidth; x++, s += 3, d += 3)
+          {
+            d[0] = s[2];
+            d[1] = s[1];
+            d[2] = s[0];
+          }
+    }
+  jpeg_destroy_decompress(&cinfo);
+  return TRUE;
+}
+
+static void BandThread(void *arg)
+{
+  JPGBAND *pBand = arg;
+
+  pBand->fOk = DecodeBand(pBand);
+}
+
+/*
+ * Walk the markers up to the scan and the restart markers in it to see
+ * where the image could be cut. Leaves nIntervals 0 if it can't.
+ */
+static void FindIntervals(JPGDEC *pDec)
+{
+  PBYTE p = pDec->pbFile;
+  ULONG n = pDec->cbFile;
+  ULONG i = 2, j, k, len, w = 0, nf = 0, ns = 0, hmax = 1, vmax = 1;
+  ULONG nIntervals;
+  BOOL fSOF = FALSE;
+  BYTE m;
+
+  if (n < 4 || p[0] != 0xFF || p[1] != 0xD8)
+    return;
+  for (;;)
+    {
+      while (i + 1 < n && p[i] == 0xFF && p[i + 1] == 0xFF)
+        i++;
+      if (i + 4 > n || p[i] != 0xFF)
+        return;
+      m = p[i + 1];
+      len = GetBE16(p + i + 2);
+      if (len < 2 || i + 2 + len > n)
+        return;
+      if (m == 0xC0 || m == 0xC1)         /* baseline or extended, Huffman */
+        {
+          if (len < 8)
+            return;
+          pDec->offSOF = i + 5;
+          pDec->ulImgH = GetBE16(p + i + 5);
+          w = GetBE16(p + i + 7);
+          nf = p[i + 9];
+          if (len < 8 + 3 * nf)
+            return;
+          for (k = 0; k < nf; k++)
+            {
+              if ((ULONG)(p[i + 11 + 3 * k] >> 4) > hmax) hmax = p[i + 11 + 3 * k] >> 4;
+              if ((ULONG)(p[i + 11 + 3 * k] & 15) > vmax) vmax = p[i + 11 + 3 * k] & 15;
+            }
+          fSOF = TRUE;
+        }
+      else if (m >= 0xC2 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC)
+        return;                           /* progressive, lossless, arithmetic */
+      else if (m == 0xDD && len >= 4)
+        pDec->ulInterval = GetBE16(p + i + 4);
+      else if (m == 0xDA)
+        {
+          ns = p[i + 4];
+          pDec->cbHead = i + 2 + len;
+          break;
+        }
+      i += 2 + len;
+    }
+  if (!fSOF || !pDec->ulInterval || !pDec->ulImgH || !w || ns != nf)
+    return;
+  if (nf == 1)
+    hmax = vmax = 1;
+  pDec->ulMcuH = 8 * vmax;
+  pDec->ulMcusPerRow = (w + 8 * hmax - 1) / (8 * hmax);
+  pDec->ulMcuRows = (pDec->ulImgH + pDec->ulMcuH - 1) / pDec->ulMcuH;
+  nIntervals = (pDec->ulMcusPerRow * pDec->ulMcuRows + pDec->ulInterval - 1) /
+               pDec->ulInterval;
+
+  pDec->pulStart = malloc(2 * nIntervals * sizeof(ULONG));
+  if (!pDec->pulStart)
+    return;
+  pDec->pulEnd = pDec->pulStart + nIntervals;
+
+  /* Every RSTn in order and then EOI, or no cutting */
+  k = 0;
+  m = 0;
+  pDec->pulStart[0] = i = pDec->cbHead;
+  while (i + 1 < n)
+    {
+      if (p[i] != 0xFF)
+        {
+          i++;
+          continue;
+        }
+      for (j = i; j + 1 < n && p[j + 1] == 0xFF; j++)
+        ;
+      if (j + 1 >= n)
+        break;
+      m = p[j + 1];
+      if (!m && j == i)
+        {
+          i += 2;                         /* stuffed zero */
+          continue;
+        }
+      if (m == 0xD9)
+        {
+          pDec->pulEnd[k++] = i;
+          break;
+        }
+      if (m < 0xD0 || m > 0xD7 || m != 0xD0 + (k & 7) || k + 1 >= nIntervals)
+        break;
+      pDec->pulEnd[k++] = i;
+      pDec->pulStart[k] = i = j + 2;
+    }
+  if (k == nIntervals && m == 0xD9)
+    pDec->nIntervals = nIntervals;
+}
+
+/*
+ * Read the file in and its header. Returns NULL if libjpeg can't give
+ * what GBM reported in gbm, which is then updated to the size the image
+ * will be decoded at.
+ */
+PJPGDEC jpgDecOpen(int fd, PJPGOPTIONS pOpt, GBM *gbm)
+{
+  struct jpeg_decompress_struct cinfo;
+  struct jpeg_source_mgr src;
+  JPGERR err;
+  JPGDEC *pDec;
+  long cb;
+  int got, rc;
+
+  if ((cb = gbm_io_lseek(fd, 0, GBM_SEEK_END)) <= 0 ||
+      gbm_io_lseek(fd, 0, GBM_SEEK_SET) != 0)
+    return NULL;
+  if (!(pDec = calloc(1, sizeof(JPGDEC))))
+    return NULL;
+  if (!(pDec->pbFile = malloc(cb)))
+    {
+      free(pDec);
+      return NULL;
+    }
+  for (got = 0; got < cb; got += rc)
+    if ((rc = gbm_io_read(fd, pDec->pbFile + got, cb - got)) <= 0)
+      break;
+  pDec->cbFile = got;
+
+  cinfo.err = jpeg_std_error(&err.pub);
+  err.pub.error_exit = JpgErrorExit;
+  err.pub.output_message = JpgMessage;
+  if (setjmp(err.jb))
+    {
+      jpeg_destroy_decompress(&cinfo);
+      jpgDecClose(pDec);
+      return NULL;
+    }
+  jpeg_create_decompress(&cinfo);
+  MemSrc(&cinfo, &src, pDec->pbFile, pDec->cbFile);
+  jpeg_read_header(&cinfo, TRUE);
+
+  if (cinfo.num_components == 1 && cinfo.jpeg_color_space == JCS_GRAYSCALE &&
+      gbm->bpp == 8)
+    pDec->nComp = 1;
+  else if (cinfo.num_components == 3 && gbm->bpp == 24 &&
+           (cinfo.jpeg_color_space == JCS_YCbCr || cinfo.jpeg_color_space == JCS_RGB))
+    pDec->nComp = 3;
+  else
+    ERREXIT(&cinfo, JERR_CONVERSION_NOTIMPL);
+
+  /* The smallest scale that still fills the box the caller gave */
+  pDec->iScale = 8;
+  if (pOpt && pOpt->ulCookie == JPG_COOKIE &&
+      (pOpt->ulMaxWidth || pOpt->ulMaxHeight))
+    for (pDec->iScale = 1; pDec->iScale < 8; pDec->iScale <<= 1)
+      if ((pOpt->ulMaxWidth &&
+           cinfo.image_width * pDec->iScale >= 8 * pOpt->ulMaxWidth) ||
+          (pOpt->ulMaxHeight &&
+           cinfo.image_height * pDec->iScale >= 8 * pOpt->ulMaxHeight))
+        break;
+  cinfo.scale_num = pDec->iScale;
+  cinfo.scale_denom = 8;
+  cinfo.out_color_space = (pDec->nComp == 1) ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_calc_output_dimensions(&cinfo);
+  pDec->ulWidth = cinfo.output_width;
+  pDec->ulHeight = cinfo.output_height;
+  jpeg_destroy_decompress(&cinfo);
+
+  FindIntervals(pDec);
+
+#ifdef DEBUG
+  writeLog("jpgdec: %dx%d at %d/8, %d restart intervals\n",
+           pDec->ulWidth, pDec->ulHeight, pDec->iScale, pDec->nIntervals);
+#endif
+  gbm->w = pDec->ulWidth;
+  gbm->h = pDec->ulHeight;
+  return pDec;
+}
+
+/*
+ * Make band pBand of nBands out of the restart intervals: rows of MCUs
+ * are taken in groups that start on an interval, the band's own groups
+ * plus one either side for context.
+ */
+static BOOL MakeBand(JPGDEC *pDec, JPGBAND *pBand, ULONG ulGroup, ULONG nGroups,
+                     ULONG iBand, ULONG nBands)
+{
+  ULONG g0 = iBand * nGroups / nBands;
+  ULONG g1 = (iBand + 1) * nGroups / nBands;
+  ULONG r0 = g0 * ulGroup;
+  ULONG r1 = g1 * ulGroup;
+  ULONG c0, c1, a, b, k, cb, h, ulOut;
+  PBYTE q;
+
+  if (r1 > pDec->ulMcuRows) r1 = pDec->ulMcuRows;
+  c0 = g0 ? r0 - ulGroup : 0;
+  c1 = r1 + ulGroup;
+  if (c1 > pDec->ulMcuRows) c1 = pDec->ulMcuRows;
+  a = c0 * pDec->ulMcusPerRow / pDec->ulInterval;
+  b = (c1 == pDec->ulMcuRows) ? pDec->nIntervals :
+      c1 * pDec->ulMcusPerRow / pDec->ulInterval;
+  h = c1 * pDec->ulMcuH;
+  if (h > pDec->ulImgH) h = pDec->ulImgH;
+  h -= c0 * pDec->ulMcuH;
+
+  cb = pDec->cbHead + 2 * (b - a);
+  for (k = a; k < b; k++)
+    cb += pDec->pulEnd[k] - pDec->pulStart[k];
+  if (!(pBand->pbSrc = malloc(cb)))
+    return FALSE;
+  q = pBand->pbSrc;
+  memcpy(q, pDec->pbFile, pDec->cbHead);
+  q[pDec->offSOF] = (BYTE)(h >> 8);
+  q[pDec->offSOF + 1] = (BYTE)h;
+  q += pDec->cbHead;
+  for (k = a; k < b; k++)
+    {
+      if (k > a)
+        {
+          *q++ = 0xFF;
+          *q++ = (BYTE)(0xD0 + ((k - a - 1) & 7));
+        }
+      memcpy(q, pDec->pbFile + pDec->pulStart[k], pDec->pulEnd[k] - pDec->pulStart[k]);
+      q += pDec->pulEnd[k] - pDec->pulStart[k];
+    }
+  *q++ = 0xFF;
+  *q++ = JPEG_EOI;
+  pBand->cbSrc = q - pBand->pbSrc;
+
+  /* An MCU row is ulMcuH * iScale / 8 rows of output */
+  ulOut = pDec->ulMcuH * pDec->iScale / 8;
+  pBand->ulSkip = (r0 - c0) * ulOut;
+  pBand->ulFirst = r0 * ulOut;
+  pBand->ulRows = (iBand == nBands - 1) ? pDec->ulHeight - pBand->ulFirst :
+                  (r1 - r0) * ulOut;
+  return TRUE;
+}
+
+/*
+ * Decode into pbBuf, a bottom-up bitmap with rows cbStride apart. The
+ * file copy is let go of afterwards.
+ */
+LONG jpgDecRead(PJPGDEC pDec, PBYTE pbBuf, ULONG cbStride)
+{
+  JPGBAND band[MAXBANDS];
+  ULONG nBands = 0, nGroups = 0, ulGroup = 0, ulCpus = 1, a, b, i;
+  TID tid;
+  BOOL fOk = FALSE;
+
+  if (!pDec->pbFile)
+    return MMIO_ERROR;
+  memset(band, 0, sizeof(band));
+
+  if (pDec->nIntervals)
+    {
+      /* MCU rows from one cut to the next */
+      a = pDec->ulInterval;
+      b = pDec->ulMcusPerRow;
+      while (b)
+        {
+          i = a % b;
+          a = b;
+          b = i;
+        }
+      ulGroup = pDec->ulInterval / a;
+      nGroups = (pDec->ulMcuRows + ulGroup - 1) / ulGroup;
+      if (DosQuerySysInfo(QSV_NUMPROCESSORS, QSV_NUMPROCESSORS, &ulCpus, sizeof(ulCpus)))
+        ulCpus = 1;
+      nBands = nGroups / BANDGROUPS;
+      if (nBands > ulCpus) nBands = ulCpus;
+      if (nBands > MAXBANDS) nBands = MAXBANDS;
+    }
+
+  if (nBands > 1)
+    {
+      fOk = TRUE;
+      for (i = 0; i < nBands && fOk; i++)
+        {
+          band[i].pDec = pDec;
+          band[i].pbDst = pbBuf;
+          band[i].cbStride = cbStride;
+          fOk = MakeBand(pDec, &band[i], ulGroup, nGroups, i, nBands);
+        }
+      for (i = 1; i < nBands && fOk; i++)
+        if ((band[i].tid = _beginthread(BandThread, NULL, 65536, &band[i])) <= 0)
+          band[i].fOk = DecodeBand(&band[i]);
+      if (fOk)
+        fOk = DecodeBand(&band[0]);
+      for (i = 1; i < nBands; i++)
+        {
+          if (band[i].tid > 0)
+            {
+              tid = band[i].tid;
+              DosWaitThread(&tid, DCWW_WAIT);
+            }
+          fOk = fOk && band[i].fOk;
+        }
+      for (i = 0; i < nBands; i++)
+        free(band[i].pbSrc);
+#ifdef DEBUG
+      writeLog("jpgdec: %d bands %s\n", nBands, fOk ? "decoded" : "failed");
+#endif
+    }
+
+  if (!fOk)
+    {
+      band[0].pDec = pDec;
+      band[0].pbSrc = pDec->pbFile;
+      band[0].cbSrc = pDec->cbFile;
+      band[0].ulSkip = 0;
+      band[0].ulFirst = 0;
+      band[0].ulRows = pDec->ulHeight;
+      band[0].pbDst = pbBuf;
+      band[0].cbStride = cbStride;
+      fOk = DecodeBand(&band[0]);
+    }
+
+  free(pDec->pbFile);
+  pDec->pbFile = NULL;
+  return fOk ? MMIO_SUCCESS : MMIO_ERROR;
+}
+
+void jpgDecClose(PJPGDEC pDec)
+{
+  if (!pDec)
+    return;
+  free(pDec->pbFile);
+  free(pDec->pulStart);
+  free(pDec);
+}
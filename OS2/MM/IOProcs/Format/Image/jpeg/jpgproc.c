@@ -80,8 +80,14 @@ ULONG readImageData( PJPGFILESTATUS pJPGInfo)
       writeLog("readImagedata(): allocated %d bytes for image data.\n", pJPGInfo->ulRGBTotalBytes);
 #endif
 
-  if ( (rcGBM = gbm_read_data(pJPGInfo->fHandleGBM, pJPGInfo->ft,
-                              &pJPGInfo->gbm, pJPGInfo->lpRGBBuf)) != GBM_ERR_OK )
+  if (pJPGInfo->pDec)
+    rcGBM = (jpgDecRead(pJPGInfo->pDec, pJPGInfo->lpRGBBuf,
+                        ((pJPGInfo->gbm.w * pJPGInfo->gbm.bpp + 31)/32) * 4) == MMIO_SUCCESS) ?
+            GBM_ERR_OK : GBM_ERR_READ;
+  else
+    rcGBM = gbm_read_data(pJPGInfo->fHandleGBM, pJPGInfo->ft,
+                          &pJPGInfo->gbm, pJPGInfo->lpRGBBuf);
+  if ( rcGBM != GBM_ERR_OK )
     {
       DosFreeMem ((PVOID) pJPGInfo->lpRGBBuf);
 #ifdef DEBUG
@@ -300,6 +306,7 @@ LONG EXPENTRY IOProc_Entry (PVOID  pmmioStr,
               {
                 DosFreeMem ((PVOID) pJPGInfo->lpRGBBuf);
               }
+            jpgDecClose(pJPGInfo->pDec);
             /***********************************************************
              * Close the file
              ***********************************************************/
@@ -527,6 +534,7 @@ LONG EXPENTRY IOProc_Entry (PVOID  pmmioStr,
             BOOL bValidJPG= FALSE;
             int fOpenFlags;
             GBM_ERR     rc;
+            PJPGOPTIONS pOpt;
 
 #ifdef DEBUG
             writeLog("MMIO_OPEN\n");
@@ -602,7 +610,9 @@ LONG EXPENTRY IOProc_Entry (PVOID  pmmioStr,
             /************************************************************
              * Store pointer to our JPGFILESTATUS structure in
              * pExtraInfoStruct field that is provided for our use.
+             * The caller may have put a JPGOPTIONS there.
              ************************************************************/
+            pOpt = (PJPGOPTIONS)pmmioinfo->pExtraInfoStruct;
             pmmioinfo->pExtraInfoStruct = (PVOID)pJPGInfo;
 
             /************************************************************
@@ -732,6 +742,25 @@ LONG EXPENTRY IOProc_Entry (PVOID  pmmioStr,
 
 
             }
+
+            /************************************************************
+             * Decode with libjpeg directly where it can be done, at a
+             * reduced size if asked. Otherwise GBM is put back to read
+             * from the start.
+             ************************************************************/
+            if(!(pJPGInfo->pDec = jpgDecOpen(fd, pOpt, &pJPGInfo->gbm))) {
+              GBMRGB gbmrgb[0x100];
+
+              if ( gbm_read_header((PSZ) lParam1, fd, pJPGInfo->ft, &pJPGInfo->gbm, "") != GBM_ERR_OK ||
+                   (pJPGInfo->gbm.bpp==8 &&
+                    gbm_read_palette(fd, pJPGInfo->ft, &pJPGInfo->gbm, gbmrgb) != GBM_ERR_OK) )
+                {
+                  DosFreeMem(pJPGInfo);
+                  gbm_io_close(fd);
+                  gbm_deinit();
+                  return (MMIO_ERROR);
+                }
+            }
             /************************************************************
              * If the app intends to read in translation mode, we must
              * allocate and set-up the buffer that will contain the RGB data
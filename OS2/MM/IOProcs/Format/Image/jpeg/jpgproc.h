@@ -62,6 +62,25 @@ static char     pszJPGExt  [] = "JPG";
 
 typedef RGB FAR *PRGB;
 
+/****************************************
+ * Passed in pExtraInfoStruct to mmioOpen() to have the image read
+ * at a reduced size, for thumbnails and icons. The image is scaled by
+ * 1/2, 1/4 or 1/8, as far as it goes while staying at least as large
+ * as ulMaxWidth across or ulMaxHeight down (0 if either doesn't matter).
+ * The header then reports the reduced size.
+ ****************************************/
+#define JPG_COOKIE 0x4A504730L
+
+typedef struct _JPGOPTIONS
+{
+  ULONG   ulCookie;               /* JPG_COOKIE                    */
+  ULONG   ulMaxWidth;
+  ULONG   ulMaxHeight;
+} JPGOPTIONS;
+typedef JPGOPTIONS FAR *PJPGOPTIONS;
+
+typedef struct _JPGDEC *PJPGDEC;
+
 
 /****************************************
  * IOProc information structure, used for every file opened
@@ -82,6 +101,8 @@ typedef struct _JPGFILESTATUS
   BOOL    bSetHeader;             /* TRUE if header set in WRITE mode*/
 
   MMIMAGEHEADER   mmImgHdr;       /* Standard image header         */
+
+  PJPGDEC pDec;                   /* decoding without GBM, if set  */
 } JPGFILESTATUS;
 typedef JPGFILESTATUS FAR *PJPGFILESTATUS;
 
@@ -117,6 +138,10 @@ LONG GetFormatStringLength (LONG  lSearchId,
 
 ULONG APIENTRY GetNLSData (PULONG, PULONG);
 
+PJPGDEC jpgDecOpen(int fd, PJPGOPTIONS pOpt, GBM *gbm);
+LONG    jpgDecRead(PJPGDEC pDec, PBYTE pbBuf, ULONG cbStride);
+void    jpgDecClose(PJPGDEC pDec);
+
 #define DEBUG
 
 #ifdef DEBUG
@@ -0,0 +1,329 @@
+/*
+ * Buffered, read-ahead access to an MMIO file for I/O procedures
+ *
+ * Two buffers of cbBuffer bytes. The caller reads out of one while the
+ * other is filled with what comes after it; when the caller moves on the
+ * roles swap. Reads the buffers do not cover, and seeks outside them,
+ * queue a fill at the new position. With MMIOBUF_READAHEAD the fills
+ * are done by a thread of the wrapper's own and only the caller waits
+ * for them when it has caught up; without it they are done in line and
+ * the buffers merely turn many small reads into a few large ones.
+ *
+ * Only the filling side touches the child handle, and there is only ever
+ * one: the thread, or the caller if there is no thread.
+ */
+
+#define INCL_DOS
+#define INCL_OS2MM
+#define INCL_MMIOOS2
+#include <os2.h>
+#include <os2me.h>
+#include <stdlib.h>
+#include <string.h>
+#include <process.h>
+#include "mmiobuf.h"
+
+#define SLOT_EMPTY   0
+#define SLOT_WANTED  1            /* queued for the filling side */
+#define SLOT_BUSY    2            /* being filled */
+#define SLOT_FULL    3
+
+typedef struct _MMIOBUFSLOT {
+    PCHAR pch;
+    LONG  lPos;                   /* file offset of pch[0] */
+    LONG  cch;                    /* bytes in pch, short at the end, -1 on error */
+    ULONG ulState;
+    ULONG ulUsed;                 /* when it was last read or queued */
+} MMIOBUFSLOT;
+
+typedef struct _MMIOBUF {
+    HMMIO hmmio;
+    ULONG ulFlags;
+    LONG  cbBuffer;
+    LONG  lPos;                   /* where the caller is */
+    LONG  lSize;                  /* file size at open, for SEEK_END */
+    LONG  lFile;                  /* where the child handle is, -1 if not known */
+    ULONG ulClock;
+    HMTX  hmtx;                   /* slot states, lPos */
+    HEV   hevWork;                /* a slot was queued, or quit */
+    HEV   hevDone;                /* a slot was filled */
+    int   tid;                    /* 0 if fills are done in line */
+    int   quit;
+    MMIOBUFSLOT slot[2];
+} MMIOBUF;
+
+/*
+ * Read cbBuffer bytes at lPos into pch. Children may hand back less than
+ * asked for before the end of the file, so go on until they return 0.
+ */
+static LONG BufFill(MMIOBUF *pbuf, PCHAR pch, LONG lPos)
+{
+    LONG got = 0;
+    LONG cch;
+
+    if (pbuf->lFile != lPos) {
+        if (mmioSeek(pbuf->hmmio, lPos, SEEK_SET) != lPos) {
+            pbuf->lFile = -1;
+            return MMIO_ERROR;
+        }
+        pbuf->lFile = lPos;
+    }
+    while (got < pbuf->cbBuffer) {
+        cch = mmioRead(pbuf->hmmio, pch + got, pbuf->cbBuffer - got);
+        if (cch < 0) {
+            pbuf->lFile = -1;
+            return got ? got : MMIO_ERROR;
+        }
+        if (!cch) break;
+        got += cch;
+    }
+    pbuf->lFile = lPos + got;
+    return got;
+}
+
+/* The slot whose range takes in lPos, filled or on its way, else NULL */
+static MMIOBUFSLOT *BufFind(MMIOBUF *pbuf, LONG lPos)
+{
+    MMIOBUFSLOT *found = NULL;
+    MMIOBUFSLOT *s;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        s = &pbuf->slot[i];
+        if (SLOT_EMPTY == s->ulState ||
+            lPos < s->lPos || lPos - s->lPos >= pbuf->cbBuffer) continue;
+        if (SLOT_FULL == s->ulState) return s;
+        found = s;
+    }
+    return found;
+}
+
+/*
+ * Queue a fill at lPos into the slot used least recently, leaving alone
+ * the one being filled and keep. Returns NULL if there is no such slot.
+ */
+static MMIOBUFSLOT *BufWant(MMIOBUF *pbuf, LONG lPos, MMIOBUFSLOT *keep)
+{
+    MMIOBUFSLOT *s = NULL;
+    MMIOBUFSLOT *t;
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        t = &pbuf->slot[i];
+        if (t == keep || SLOT_BUSY == t->ulState) continue;
+        if (!s || t->ulUsed < s->ulUsed) s = t;
+    }
+    if (!s) return NULL;
+    s->lPos = lPos;
+    s->cch = 0;
+    s->ulState = SLOT_WANTED;
+    s->ulUsed = ++pbuf->ulClock;
+    if (pbuf->tid > 0) DosPostEventSem(pbuf->hevWork);
+    return s;
+}
+
+/* The queued slot to fill first: the one the caller waits on, if any */
+static MMIOBUFSLOT *BufNext(MMIOBUF *pbuf)
+{
+    MMIOBUFSLOT *s = BufFind(pbuf, pbuf->lPos);
+    int i;
+
+    if (s && SLOT_WANTED == s->ulState) return s;
+    for (i = 0; i < 2; i++)
+        if (SLOT_WANTED == pbuf->slot[i].ulState) return &pbuf->slot[i];
+    return NULL;
+}
+
+static void BufThread(void *arg)
+{
+    MMIOBUF *pbuf = arg;
+    MMIOBUFSLOT *s;
+    LONG lPos;
+    LONG cch;
+    ULONG cnt;
+
+    DosRequestMutexSem(pbuf->hmtx, SEM_INDEFINITE_WAIT);
+    while (!pbuf->quit) {
+        s = BufNext(pbuf);
+        if (!s) {
+            DosResetEventSem(pbuf->hevWork, &cnt);
+            DosReleaseMutexSem(pbuf->hmtx);
+            DosWaitEventSem(pbuf->hevWork, SEM_INDEFINITE_WAIT);
+            DosRequestMutexSem(pbuf->hmtx, SEM_INDEFINITE_WAIT);
+            continue;
+        }
+        s->ulState = SLOT_BUSY;
+        lPos = s->lPos;
+        DosReleaseMutexSem(pbuf->hmtx);
+
+        cch = BufFill(pbuf, s->pch, lPos);
+
+        DosRequestMutexSem(pbuf->hmtx, SEM_INDEFINITE_WAIT);
+        s->cch = cch;
+        s->ulState = SLOT_FULL;
+        DosPostEventSem(pbuf->hevDone);
+    }
+    DosReleaseMutexSem(pbuf->hmtx);
+}
+
+static void BufStop(MMIOBUF *pbuf)
+{
+    TID tid;
+
+    if (pbuf->tid > 0) {
+        DosRequestMutexSem(pbuf->hmtx, SEM_INDEFINITE_WAIT);
+        pbuf->quit = 1;
+        DosPostEventSem(pbuf->hevWork);
+        DosReleaseMutexSem(pbuf->hmtx);
+        tid = pbuf->tid;
+        DosWaitThread(&tid, DCWW_WAIT);
+        pbuf->tid = 0;
+    }
+    if (pbuf->hevDone) DosCloseEventSem(pbuf->hevDone);
+    if (pbuf->hevWork) DosCloseEventSem(pbuf->hevWork);
+    if (pbuf->hmtx) DosCloseMutexSem(pbuf->hmtx);
+    pbuf->hevDone = pbuf->hevWork = 0;
+    pbuf->hmtx = 0;
+}
+
+/*
+ * Wrap hmmio, which is read from where it stands. cbBuffer 0 takes
+ * MMIOBUF_DEFAULTSIZE. If the thread cannot be had the wrapper works
+ * without it. Returns NULL if out of memory or if the child cannot seek;
+ * hmmio is then still the caller's.
+ */
+PMMIOBUF mmioBufOpen(HMMIO hmmio, LONG cbBuffer, ULONG ulFlags)
+{
+    MMIOBUF *pbuf;
+
+    if (!hmmio) return NULL;
+    if (cbBuffer <= 0) cbBuffer = MMIOBUF_DEFAULTSIZE;
+    pbuf = calloc(1, sizeof(MMIOBUF));
+    if (!pbuf) return NULL;
+    pbuf->slot[0].pch = malloc(2 * cbBuffer);
+    if (!pbuf->slot[0].pch) {
+        free(pbuf);
+        return NULL;
+    }
+    pbuf->slot[1].pch = pbuf->slot[0].pch + cbBuffer;
+    pbuf->hmmio = hmmio;
+    pbuf->ulFlags = ulFlags;
+    pbuf->cbBuffer = cbBuffer;
+
+    pbuf->lPos = mmioSeek(hmmio, 0L, SEEK_CUR);
+    pbuf->lSize = mmioSeek(hmmio, 0L, SEEK_END);
+    if (pbuf->lPos < 0 || pbuf->lSize < 0 ||
+        mmioSeek(hmmio, pbuf->lPos, SEEK_SET) != pbuf->lPos) {
+        free(pbuf->slot[0].pch);
+        free(pbuf);
+        return NULL;
+    }
+    pbuf->lFile = pbuf->lPos;
+
+    if (ulFlags & MMIOBUF_READAHEAD) {
+        BufWant(pbuf, pbuf->lPos, NULL);  /* the thread starts on it */
+        if (DosCreateMutexSem(NULL, &pbuf->hmtx, 0, FALSE) ||
+            DosCreateEventSem(NULL, &pbuf->hevWork, 0, FALSE) ||
+            DosCreateEventSem(NULL, &pbuf->hevDone, 0, FALSE) ||
+            (pbuf->tid = _beginthread(BufThread, NULL, 32768, pbuf)) <= 0) {
+            pbuf->tid = 0;
+            BufStop(pbuf);
+        }
+    }
+    return pbuf;
+}
+
+LONG mmioBufRead(PMMIOBUF pbuf, PCHAR pchBuffer, LONG cBytes)
+{
+    MMIOBUFSLOT *s;
+    LONG total = 0;
+    LONG n;
+    ULONG cnt;
+    int err = 0;
+
+    if (!pbuf || !pchBuffer || cBytes < 0) return MMIO_ERROR;
+    if (pbuf->tid > 0) DosRequestMutexSem(pbuf->hmtx, SEM_INDEFINITE_WAIT);
+    while (cBytes > 0) {
+        s = BufFind(pbuf, pbuf->lPos);
+        if (!s) s = BufWant(pbuf, pbuf->lPos, NULL);
+        if (SLOT_FULL != s->ulState) {
+            if (pbuf->tid > 0) {
+                DosResetEventSem(pbuf->hevDone, &cnt);
+                DosReleaseMutexSem(pbuf->hmtx);
+                DosWaitEventSem(pbuf->hevDone, SEM_INDEFINITE_WAIT);
+                DosRequestMutexSem(pbuf->hmtx, SEM_INDEFINITE_WAIT);
+            } else {
+                s->cch = BufFill(pbuf, s->pch, s->lPos);
+                s->ulState = SLOT_FULL;
+            }
+            continue;
+        }
+        if (s->cch < 0) {
+            s->ulState = SLOT_EMPTY;  /* try again on the next call */
+            err = 1;
+            break;
+        }
+        n = s->lPos + s->cch - pbuf->lPos;
+        if (n <= 0) break;            /* end of file */
+        if (n > cBytes) n = cBytes;
+        memcpy(pchBuffer + total, s->pch + (pbuf->lPos - s->lPos), n);
+        total += n;
+        cBytes -= n;
+        pbuf->lPos += n;
+        s->ulUsed = ++pbuf->ulClock;
+
+        /* the caller is in s now: have the other buffer take what follows */
+        if (pbuf->tid > 0 && s->cch == pbuf->cbBuffer &&
+            !BufFind(pbuf, s->lPos + pbuf->cbBuffer))
+            BufWant(pbuf, s->lPos + pbuf->cbBuffer, s);
+    }
+    if (pbuf->tid > 0) DosReleaseMutexSem(pbuf->hmtx);
+    if (!total && err) return MMIO_ERROR;
+    return total;
+}
+
+/*
+ * Moving outside the buffers queues a fill at the new position straight
+ * away, so it overlaps whatever the caller does before reading there.
+ */
+LONG mmioBufSeek(PMMIOBUF pbuf, LONG lOffset, LONG lOrigin)
+{
+    LONG lPos;
+
+    if (!pbuf) return MMIO_ERROR;
+    switch (lOrigin) {
+    case SEEK_SET:
+        lPos = lOffset;
+        break;
+    case SEEK_CUR:
+        lPos = pbuf->lPos + lOffset;
+        break;
+    case SEEK_END:
+        lPos = pbuf->lSize + lOffset;
+        break;
+    default:
+        return MMIO_ERROR;
+    }
+    if (lPos < 0) return MMIO_ERROR;
+
+    if (pbuf->tid > 0) DosRequestMutexSem(pbuf->hmtx, SEM_INDEFINITE_WAIT);
+    pbuf->lPos = lPos;
+    if (pbuf->tid > 0) {
+        if (!BufFind(pbuf, lPos)) BufWant(pbuf, lPos, NULL);
+        DosReleaseMutexSem(pbuf->hmtx);
+    }
+    return lPos;
+}
+
+/* Stops the thread and closes the child handle with usFlags */
+USHORT mmioBufClose(PMMIOBUF pbuf, USHORT usFlags)
+{
+    HMMIO hmmio;
+
+    if (!pbuf) return MMIOERR_INVALID_HANDLE;
+    BufStop(pbuf);
+    hmmio = pbuf->hmmio;
+    free(pbuf->slot[0].pch);
+    free(pbuf);
+    return mmioClose(hmmio, usFlags);
+}
@@ -0,0 +1,29 @@
+/*
+ * Buffered, read-ahead access to an MMIO file for I/O procedures
+ *
+ * An IOProc opens its child file as usual and wraps the handle with
+ * mmioBufOpen(). Reads are then served from two buffers of cbBuffer
+ * bytes each. With MMIOBUF_READAHEAD a thread of the wrapper's own fills
+ * the buffer after the one being read, so on a network share the next
+ * request is usually in memory before it is made. A seek starts filling
+ * at the new position at once.
+ *
+ * A wrapped handle is read only and must be used from one thread at a
+ * time. The child handle belongs to the wrapper until mmioBufClose().
+ */
+
+#ifndef MMIOBUF_H
+#define MMIOBUF_H
+
+#define MMIOBUF_DEFAULTSIZE  65536L
+
+#define MMIOBUF_READAHEAD    0x00000001L   /* fill on a thread of its own */
+
+typedef struct _MMIOBUF *PMMIOBUF;
+
+PMMIOBUF mmioBufOpen(HMMIO hmmio, LONG cbBuffer, ULONG ulFlags);
+LONG     mmioBufRead(PMMIOBUF pbuf, PCHAR pchBuffer, LONG cBytes);
+LONG     mmioBufSeek(PMMIOBUF pbuf, LONG lOffset, LONG lOrigin);
+USHORT   mmioBufClose(PMMIOBUF pbuf, USHORT usFlags);
+
+#endif
@@ -0,0 +1,101 @@
+//
+// CFGSYS.DLL - CONFIG.SYS changes for MINSTALL
+// (c) osFree project
+//
+// This file is part of MINSTALL.DLL for OS/2 / eComStation
+//
+// MINSTALL.DLL is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+// MINSTALL.DLL is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+//  along with MINSTALL.DLL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#define INCL_DOSERRORS
+#include <os2.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "setup.h"
+#include "xstring.h"
+#include "configsys.h"
+
+#include <cfgsys.h>
+
+// All changes of one package are applied to one in-memory copy of
+//  CONFIG.SYS (see csysEditOpen) and the file is written once at the end,
+//  instead of rescanning and rewriting CONFIG.SYS for every change.
+//
+//  x is the drive of CONFIG.SYS as a letter, 0 means the boot drive.
+//  str is put in front of the first line added at the bottom of the file.
+ULONG CONFIGSYS_Process (ULONG x, ULONG ChangeCount, PCONFIGSYSACTION ChangeArrayPtr, PSZ str) {
+   CHAR        ConfigSysFile[CCHMAXPATH];
+   CHAR        BackupFile[CCHMAXPATH];
+   PCSYSEDIT   EditPtr = NULL;
+   CONFIGMANIP Manip;
+   PSZ         NewLinePtr;
+   ULONG       CurNo;
+   APIRET      rc;
+
+   if (x) {
+      sprintf (ConfigSysFile, "%c:\\CONFIG.SYS", (CHAR)x);
+      rc = csysEditOpen(ConfigSysFile, str, &EditPtr);
+    } else {
+      rc = csysEditOpen(NULL, str, &EditPtr);
+    }
+   if (rc) return 0;
+
+   for (CurNo=0; CurNo<ChangeCount; CurNo++, ChangeArrayPtr++) {
+      NewLinePtr = malloc(strlen(ChangeArrayPtr->CommandStrPtr)+strlen(ChangeArrayPtr->ValueStrPtr)+2);
+      if (!NewLinePtr) {
+         rc = ERROR_NOT_ENOUGH_MEMORY; break; }
+      sprintf (NewLinePtr, "%s=%s", ChangeArrayPtr->CommandStrPtr, ChangeArrayPtr->ValueStrPtr);
+
+      memset (&Manip, 0, sizeof(Manip));
+      Manip.iVertical  = CFGVRT_BOTTOM;
+      Manip.pszNewLine = NewLinePtr;
+      if (ChangeArrayPtr->Flags & CONFIGSYSACTION_Flags_Merge) {
+         // Add the missing entries to the end of the existing line
+         Manip.iReplaceMode = CFGRPL_ADDRIGHT;
+       } else {
+         // Replace the line for the same file (DEVICE, RUN, BASEDEV) or
+         //  the same command (SET xxx)
+         Manip.iReplaceMode = CFGRPL_UNIQUE;
+         if ((ChangeArrayPtr->MatchStrPtr) && (ChangeArrayPtr->MatchStrPtr[0]))
+            Manip.pszUniqueSearchString2 = ChangeArrayPtr->MatchStrPtr;
+       }
+
+      rc = csysEditManipulate(EditPtr, &Manip, NULL);
+      free (NewLinePtr);
+      if (rc) break;
+    }
+
+   if (rc) {
+      csysEditClose(EditPtr);
+      return 0;
+    }
+   if (!csysEditIsDirty(EditPtr)) {
+      csysEditClose(EditPtr);
+      return CONFIGSYS_DONE;
+    }
+
+   rc = csysEditCommit(EditPtr, BackupFile);
+   csysEditClose(EditPtr);
+   switch (rc) {
+    case NO_ERROR:
+      return CONFIGSYS_DONE_BackUp;
+    case ERROR_ACCESS_DENIED:
+      return CONFIGSYS_ERR_IsReadOnly;
+    default:
+      return CONFIGSYS_ERR_FailedBackUp;
+    }
+ }
@@ -1083,6 +1083,918 @@ LABEL_CFGRPL_ADD:
     return arc;
 }
 
+/* ******************************************************************
+ *
+ *   Transactional CONFIG.SYS editor
+ *
+ ********************************************************************/
+
+/*
+ *      csysManipulate works on the whole CONFIG.SYS text: every
+ *      change searches the buffer from the top and reallocates it,
+ *      and the caller writes the file after each package. The
+ *      csysEdit* functions below parse CONFIG.SYS once into a list
+ *      of lines which is indexed by keyword ("SET xxx" for SET
+ *      lines), apply any number of CONFIGMANIP's to that in memory,
+ *      and write the file once, with a rename, on csysEditCommit.
+ *
+ *      Usage:
+ *
+ +          PCSYSEDIT pEdit;
+ +          if (!csysEditOpen(NULL, NULL, &pEdit))
+ +          {
+ +              csysEditManipulate(pEdit, &Manip1, NULL);
+ +              csysEditManipulate(pEdit, &Manip2, NULL);
+ +              ...
+ +              csysEditCommit(pEdit, szBackup);
+ +              csysEditClose(pEdit);
+ +          }
+ */
+
+#define CSYS_HASHSIZE       256
+#define CSYS_ORDERSTEP      0x100
+
+/*
+ *@@ CSYSLINE:
+ *      one line of CONFIG.SYS in CSYSEDIT.
+ */
+
+typedef struct _CSYSLINE
+{
+    struct _CSYSLINE    *pPrev,
+                        *pNext,         // file order
+                        *pNextHashed;   // same hash bucket
+    ULONG               ulHash;         // hash of the line's keyword
+    ULONG               ulOrder;        // increases in file order
+    PSZ                 psz;            // line text without line break
+} CSYSLINE, *PCSYSLINE;
+
+/*
+ *@@ CSYSEDIT:
+ *      CONFIG.SYS opened with csysEditOpen.
+ */
+
+typedef struct _CSYSEDIT
+{
+    CHAR        szFile[CCHMAXPATH];
+    PCSYSLINE   pFirst,
+                pLast;
+    PCSYSLINE   apHash[CSYS_HASHSIZE];
+    PSZ         pszBottomMarker;        // added before the first new
+                                        // line at the bottom, or NULL
+    BOOL        fDirty,
+                fEndsWithEOL;
+} CSYSEDIT;
+
+/*
+ * KeyHash:
+ *      hashes the keyword of a CONFIG.SYS line, that is
+ *      its first word or, for SET lines, "SET" and the
+ *      variable name; case is ignored. This gives the
+ *      same result for a line and for the command part
+ *      of a CONFIGMANIP line.
+ *
+ *      Private helper.
+ */
+
+STATIC ULONG KeyHash(PCSZ pcsz)
+{
+    ULONG   ulHash = 0;
+    ULONG   cWords = 1;
+    PCSZ    pStart;
+
+    while ((*pcsz == ' ') || (*pcsz == '\t'))
+        pcsz++;
+
+    pStart = pcsz;
+    while (TRUE)
+    {
+        CHAR c = *pcsz;
+        if (    (!c)
+             || (c == '=')
+             || (c == ' ')
+             || (c == '\t')
+           )
+        {
+            // end of a word: take the next one only after "SET"
+            if (    (cWords == 1)
+                 && (pcsz - pStart == 3)
+                 && (!strnicmp(pStart, "SET", 3))
+                 && ((c == ' ') || (c == '\t'))
+               )
+            {
+                while ((*pcsz == ' ') || (*pcsz == '\t'))
+                    pcsz++;
+                ulHash = ulHash * 31 + ' ';
+                cWords++;
+                continue;
+            }
+            break;
+        }
+
+        ulHash = ulHash * 31 + toupper(c);
+        pcsz++;
+    }
+
+    return ulHash;
+}
+
+/*
+ * LineHasKey:
+ *      returns TRUE if the line starts with pcszKey
+ *      the way csysFindKey wants it.
+ *
+ *      Private helper.
+ */
+
+STATIC BOOL LineHasKey(PCSZ pcszLine,
+                       PCSZ pcszKey,
+                       ULONG ulKeyLength)
+{
+    CHAR    c;
+
+    while ((*pcszLine == ' ') || (*pcszLine == '\t'))
+        pcszLine++;
+
+    if (strnicmp(pcszLine, pcszKey, ulKeyLength))
+        return FALSE;
+
+    c = pcszLine[ulKeyLength];
+    return (    (strchr(pcszKey, '='))
+             || (c == ' ')
+             || (c == '=')
+             || (c == '\t')
+             || (!c)
+           );
+}
+
+/*
+ * HashLine:
+ *      puts a line into its hash bucket.
+ *
+ *      Private helper.
+ */
+
+STATIC VOID HashLine(PCSYSEDIT pEdit,
+                     PCSYSLINE pLine)
+{
+    ULONG   ul = (pLine->ulHash = KeyHash(pLine->psz)) % CSYS_HASHSIZE;
+    pLine->pNextHashed = pEdit->apHash[ul];
+    pEdit->apHash[ul] = pLine;
+}
+
+/*
+ * UnhashLine:
+ *      removes a line from its hash bucket.
+ *
+ *      Private helper.
+ */
+
+STATIC VOID UnhashLine(PCSYSEDIT pEdit,
+                       PCSYSLINE pLine)
+{
+    PCSYSLINE   *pp = &pEdit->apHash[pLine->ulHash % CSYS_HASHSIZE];
+    while (*pp)
+    {
+        if (*pp == pLine)
+        {
+            *pp = pLine->pNextHashed;
+            break;
+        }
+        pp = &(*pp)->pNextHashed;
+    }
+}
+
+/*
+ * InsertLine:
+ *      creates a line with a copy of pcszText and links
+ *      it in before pBefore, or at the bottom if pBefore
+ *      is NULL.
+ *
+ *      Private helper.
+ */
+
+STATIC PCSYSLINE InsertLine(PCSYSEDIT pEdit,
+                            PCSYSLINE pBefore,
+                            PCSZ pcszText,
+                            ULONG cbText)
+{
+    PCSYSLINE   pLine,
+                pAfter = (pBefore) ? pBefore->pPrev : pEdit->pLast;
+
+    if (!(pLine = NEW(CSYSLINE)))
+        return NULL;
+    if (!(pLine->psz = (PSZ)malloc(cbText + 1)))
+    {
+        free(pLine);
+        return NULL;
+    }
+    memcpy(pLine->psz, pcszText, cbText);
+    pLine->psz[cbText] = '\0';
+
+    // give it an order number between its neighbors;
+    // number all lines anew if there is no gap left
+    if (    (pAfter)
+         && (pBefore)
+         && (pBefore->ulOrder - pAfter->ulOrder < 2)
+       )
+    {
+        PCSYSLINE   p;
+        ULONG       ul = CSYS_ORDERSTEP;
+        for (p = pEdit->pFirst; p; p = p->pNext, ul += CSYS_ORDERSTEP)
+            p->ulOrder = ul;
+    }
+    else if (    (!pAfter)
+              && (pBefore)
+              && (pBefore->ulOrder < 2)
+            )
+    {
+        PCSYSLINE   p;
+        ULONG       ul = 2 * CSYS_ORDERSTEP;
+        for (p = pEdit->pFirst; p; p = p->pNext, ul += CSYS_ORDERSTEP)
+            p->ulOrder = ul;
+    }
+
+    if (!pBefore)
+        pLine->ulOrder = (pAfter) ? pAfter->ulOrder + CSYS_ORDERSTEP : CSYS_ORDERSTEP;
+    else if (!pAfter)
+        pLine->ulOrder = pBefore->ulOrder / 2;
+    else
+        pLine->ulOrder = pAfter->ulOrder + (pBefore->ulOrder - pAfter->ulOrder) / 2;
+
+    pLine->pPrev = pAfter;
+    pLine->pNext = pBefore;
+    if (pAfter)
+        pAfter->pNext = pLine;
+    else
+        pEdit->pFirst = pLine;
+    if (pBefore)
+        pBefore->pPrev = pLine;
+    else
+        pEdit->pLast = pLine;
+
+    HashLine(pEdit, pLine);
+
+    return pLine;
+}
+
+/*
+ * DeleteLine:
+ *      unlinks and frees a line.
+ *
+ *      Private helper.
+ */
+
+STATIC VOID DeleteLine(PCSYSEDIT pEdit,
+                       PCSYSLINE pLine)
+{
+    UnhashLine(pEdit, pLine);
+
+    if (pLine->pPrev)
+        pLine->pPrev->pNext = pLine->pNext;
+    else
+        pEdit->pFirst = pLine->pNext;
+    if (pLine->pNext)
+        pLine->pNext->pPrev = pLine->pPrev;
+    else
+        pEdit->pLast = pLine->pPrev;
+
+    free(pLine->psz);
+    free(pLine);
+}
+
+/*
+ * SetLineText:
+ *      replaces the text of a line.
+ *
+ *      Private helper.
+ */
+
+STATIC APIRET SetLineText(PCSYSEDIT pEdit,
+                          PCSYSLINE pLine,
+                          PSZ pszNew)       // in: malloc()'d text, taken over
+{
+    if (!strcmp(pLine->psz, pszNew))
+    {
+        free(pszNew);
+        return NO_ERROR;
+    }
+
+    UnhashLine(pEdit, pLine);
+    free(pLine->psz);
+    pLine->psz = pszNew;
+    HashLine(pEdit, pLine);
+
+    pEdit->fDirty = TRUE;
+    return NO_ERROR;
+}
+
+/*
+ * FindKeyLine:
+ *      returns the first line which has pcszKey, and
+ *      pcszUnique2 after its "=" if that is not NULL.
+ *
+ *      Private helper.
+ */
+
+STATIC PCSYSLINE FindKeyLine(PCSYSEDIT pEdit,
+                             PCSZ pcszKey,
+                             PCSZ pcszUnique2)
+{
+    ULONG       ulHash = KeyHash(pcszKey),
+                ulKeyLength = strlen(pcszKey);
+    PCSYSLINE   p,
+                pFound = NULL;
+
+    for (p = pEdit->apHash[ulHash % CSYS_HASHSIZE]; p; p = p->pNextHashed)
+    {
+        PSZ     pEq;
+
+        if (    (p->ulHash != ulHash)
+             || ((pFound) && (p->ulOrder > pFound->ulOrder))
+             || (!LineHasKey(p->psz, pcszKey, ulKeyLength))
+           )
+            continue;
+
+        if (    (pcszUnique2)
+             && (    (!(pEq = strchr(p->psz, '=')))
+                  || (!strhistr(pEq, pcszUnique2))
+                )
+           )
+            continue;
+
+        pFound = p;
+    }
+
+    return pFound;
+}
+
+/*
+ * FindTextLine:
+ *      returns the first line which contains pcszText
+ *      anywhere.
+ *
+ *      Private helper.
+ */
+
+STATIC PCSYSLINE FindTextLine(PCSYSEDIT pEdit,
+                              PCSZ pcszText)
+{
+    PCSYSLINE   p;
+
+    for (p = pEdit->pFirst; p; p = p->pNext)
+        if (strhistr(p->psz, pcszText))
+            break;
+
+    return p;
+}
+
+/*
+ * FindEntry:
+ *      finds an entry of length cbEntry in a ';'-separated
+ *      list like the argument of SET PATH; case and a
+ *      trailing backslash are ignored.
+ *
+ *      Private helper.
+ */
+
+STATIC PCSZ FindEntry(PCSZ pcszList,
+                      PCSZ pcszEntry,
+                      ULONG cbEntry)
+{
+    if (cbEntry && (pcszEntry[cbEntry - 1] == '\\'))
+        cbEntry--;
+
+    while (*pcszList)
+    {
+        PCSZ    pEnd = strchr(pcszList, ';');
+        ULONG   cb = (pEnd) ? pEnd - pcszList : strlen(pcszList);
+        ULONG   cbCompare = cb;
+
+        if (cbCompare && (pcszList[cbCompare - 1] == '\\'))
+            cbCompare--;
+        if (    (cbCompare == cbEntry)
+             && (cbEntry)
+             && (!strnicmp(pcszList, pcszEntry, cbEntry))
+           )
+            return pcszList;
+
+        if (!pEnd)
+            break;
+        pcszList = pEnd + 1;
+    }
+
+    return NULL;
+}
+
+/*
+ * MergeEntries:
+ *      returns a new line for CFGRPL_ADDLEFT/ADDRIGHT:
+ *      the entries of pcszArgNew which are not in the
+ *      argument of pcszOldLine yet are added to the left
+ *      or right of it. Returns NULL if there is nothing
+ *      to add.
+ *
+ *      Private helper.
+ */
+
+STATIC PSZ MergeEntries(PCSZ pcszOldLine,
+                        PCSZ pcszArgOld,        // in: after the "=" in pcszOldLine
+                        PCSZ pcszArgNew,
+                        BOOL fLeft)
+{
+    XSTRING strAdd,
+            strLine;
+    PCSZ    p = pcszArgNew;
+    ULONG   cbArgOld = strlen(pcszArgOld);
+
+    xstrInit(&strAdd, 0);
+    while (*p)
+    {
+        PCSZ    pEnd = strchr(p, ';');
+        ULONG   cb = (pEnd) ? pEnd - p : strlen(p);
+
+        if (    (cb)
+             && (!FindEntry(pcszArgOld, p, cb))
+             && (!FindEntry(strAdd.psz ? strAdd.psz : "", p, cb))
+           )
+        {
+            if (strAdd.ulLength)
+                xstrcatc(&strAdd, ';');
+            xstrcat(&strAdd, p, cb);
+        }
+
+        if (!pEnd)
+            break;
+        p = pEnd + 1;
+    }
+
+    if (!strAdd.ulLength)
+    {
+        xstrClear(&strAdd);
+        return NULL;
+    }
+
+    xstrInit(&strLine, 0);
+    xstrcat(&strLine, pcszOldLine, pcszArgOld - pcszOldLine);
+    if (fLeft)
+    {
+        xstrcat(&strLine, strAdd.psz, strAdd.ulLength);
+        if (cbArgOld)
+            xstrcatc(&strLine, ';');
+        xstrcat(&strLine, pcszArgOld, cbArgOld);
+    }
+    else
+    {
+        xstrcat(&strLine, pcszArgOld, cbArgOld);
+        if (cbArgOld && (pcszArgOld[cbArgOld - 1] != ';'))
+            xstrcatc(&strLine, ';');
+        xstrcat(&strLine, strAdd.psz, strAdd.ulLength);
+        // keep the trailing ';' style of the new argument
+        if (pcszArgNew[strlen(pcszArgNew) - 1] == ';')
+            xstrcatc(&strLine, ';');
+    }
+
+    xstrClear(&strAdd);
+    return strLine.psz;
+}
+
+/*
+ * RemoveEntries:
+ *      returns a new line for CFGRPL_REMOVEPART: the
+ *      entries of pcszArgDel are removed from the
+ *      argument of pcszOldLine. If none of them is an
+ *      entry, pcszArgDel is removed as a substring like
+ *      csysManipulate does it. Returns NULL if nothing
+ *      was found.
+ *
+ *      Private helper.
+ */
+
+STATIC PSZ RemoveEntries(PCSZ pcszOldLine,
+                         PCSZ pcszArgOld,
+                         PCSZ pcszArgDel)
+{
+    XSTRING strLine;
+    PCSZ    p = pcszArgOld;
+    BOOL    fRemoved = FALSE;
+
+    xstrInit(&strLine, 0);
+    xstrcat(&strLine, pcszOldLine, pcszArgOld - pcszOldLine);
+    while (*p)
+    {
+        PCSZ    pEnd = strchr(p, ';');
+        ULONG   cb = (pEnd) ? pEnd - p : strlen(p);
+
+        if ((cb) && (FindEntry(pcszArgDel, p, cb)))
+            fRemoved = TRUE;
+        else if (pEnd)
+            xstrcat(&strLine, p, cb + 1);
+        else
+            xstrcat(&strLine, p, cb);
+
+        if (!pEnd)
+            break;
+        p = pEnd + 1;
+    }
+
+    if (!fRemoved)
+    {
+        PSZ     pArgToDel;
+        xstrClear(&strLine);
+
+        if (pArgToDel = strhistr(pcszOldLine, pcszArgDel))
+        {
+            PCSZ    pAfter = pArgToDel + strlen(pcszArgDel);
+            while (*pAfter == ';')
+                ++pAfter;
+            xstrcat(&strLine, pcszOldLine, pArgToDel - pcszOldLine);
+            xstrcat(&strLine, pAfter, 0);
+        }
+    }
+
+    return strLine.psz;
+}
+
+/*
+ *@@ csysEditOpen:
+ *      loads CONFIG.SYS for csysEditManipulate. pcszFile
+ *      is as with csysLoadConfigSys.
+ *
+ *      If pcszBottomMarker is not NULL, it is added (with
+ *      all its lines) before the first line which is added
+ *      at the bottom of the file, if any.
+ */
+
+APIRET csysEditOpen(PCSZ pcszFile,              // in: CONFIG.SYS filename or NULL
+                    PCSZ pcszBottomMarker,      // in: text before lines added at the bottom or NULL
+                    PCSYSEDIT *ppEdit)          // out: editor
+{
+    APIRET      arc;
+    PSZ         pszContents = NULL;
+    PCSYSEDIT   pEdit;
+
+    if (!(pEdit = NEW(CSYSEDIT)))
+        return ERROR_NOT_ENOUGH_MEMORY;
+    ZERO(pEdit);
+
+    if (pcszFile)
+        strhncpy0(pEdit->szFile, pcszFile, sizeof(pEdit->szFile));
+    else
+        sprintf(pEdit->szFile, "%c:\\CONFIG.SYS", doshQueryBootDrive());
+
+    if (    (pcszBottomMarker)
+         && (!(pEdit->pszBottomMarker = strdup(pcszBottomMarker)))
+       )
+        arc = ERROR_NOT_ENOUGH_MEMORY;
+    else if (!(arc = csysLoadConfigSys(pEdit->szFile,
+                                       &pszContents)))
+    {
+        // split into lines; csysLoadConfigSys has
+        // made all line breaks \n
+        PSZ     p = pszContents;
+        while (*p)
+        {
+            PSZ     pEOL = strchr(p, '\n');
+            ULONG   cb = (pEOL) ? pEOL - p : strlen(p);
+
+            if (!InsertLine(pEdit, NULL, p, cb))
+            {
+                arc = ERROR_NOT_ENOUGH_MEMORY;
+                break;
+            }
+
+            if (!pEOL)
+                break;
+            p = pEOL + 1;
+        }
+        pEdit->fEndsWithEOL = (    (!*pszContents)
+                                || (pszContents[strlen(pszContents) - 1] == '\n')
+                              );
+        free(pszContents);
+    }
+
+    if (arc)
+        csysEditClose(pEdit);
+    else
+        *ppEdit = pEdit;
+
+    return arc;
+}
+
+/*
+ *@@ csysEditManipulate:
+ *      makes a single change according to the CONFIGMANIP
+ *      in the CONFIG.SYS loaded with csysEditOpen. This
+ *      does what csysManipulate does, with the same return
+ *      codes and pstrChanged entries, with the following
+ *      differences:
+ *
+ *      --  Lines are found with the keyword index, not by
+ *          searching the text.
+ *
+ *      --  With CFGRPL_ADDLEFT and CFGRPL_ADDRIGHT, the
+ *          argument is taken as a ';'-separated list, and
+ *          only the entries which the line does not have
+ *          yet are added (csysManipulate adds nothing if
+ *          the argument is found anywhere in the line as
+ *          a substring, and everything otherwise).
+ *
+ *      --  CFGRPL_REMOVEPART removes matching entries the
+ *          same way and falls back to removing a substring.
+ *
+ *      --  A change which leaves a line as it was does not
+ *          make the file dirty.
+ */
+
+APIRET csysEditManipulate(PCSYSEDIT pEdit,          // in: from csysEditOpen
+                          PCONFIGMANIP pManip,      // in: CONFIG.SYS manipulation instructions
+                          PXSTRING pstrChanged)     // out: description of changes or NULL
+{
+    APIRET      arc = NO_ERROR;
+    PSZ         pszCommand,
+                pszArgNew = NULL,
+                pSep;
+    PCSYSLINE   pLine = NULL;
+    PSZ         pszNewText = NULL;
+    PCSZ        pcszLog = NULL,         // log entry type
+                pcszLogText = NULL;     // and text
+    BOOL        fDeletedOld = FALSE;
+
+    if (pSep = strchr(pManip->pszNewLine, '='))
+    {
+        pszCommand = strhSubstr(pManip->pszNewLine, pSep);
+        pszArgNew = strdup(pSep + 1);
+    }
+    else
+        pszCommand = strdup(pManip->pszNewLine);
+
+    if (pManip->iReplaceMode != CFGRPL_ADD)
+        pLine = FindKeyLine(pEdit,
+                            pszCommand,
+                            pManip->pszUniqueSearchString2);
+
+    if (pLine)
+    {
+        // line found: update it in place
+        PSZ     pszOld = pLine->psz,
+                pEq = strchr(pszOld, '=');
+
+        switch (pManip->iReplaceMode)
+        {
+            case CFGRPL_UNIQUE:
+                if (strcmp(pszOld, pManip->pszNewLine))
+                {
+                    if (pstrChanged)
+                    {
+                        xstrcat(pstrChanged, "DLL ", 0);
+                        xstrcat(pstrChanged, pszOld, 0);
+                        xstrcatc(pstrChanged, '\n');
+                    }
+                    arc = SetLineText(pEdit, pLine, strdup(pManip->pszNewLine));
+                }
+                pcszLog = "NWL ";
+                pcszLogText = pManip->pszNewLine;
+            break;
+
+            case CFGRPL_ADDLEFT:
+            case CFGRPL_ADDRIGHT:
+                if (!pEq)
+                    arc = CFGERR_NOSEPARATOR;
+                else if (    (pszArgNew)
+                          && (pszNewText = MergeEntries(pszOld,
+                                                        pEq + 1,
+                                                        pszArgNew,
+                                                        (pManip->iReplaceMode == CFGRPL_ADDLEFT)))
+                        )
+                    arc = SetLineText(pEdit, pLine, pszNewText);
+                pcszLog = "NWP ";
+                pcszLogText = pManip->pszNewLine;
+            break;
+
+            case CFGRPL_REMOVELINE:
+                if (pstrChanged)
+                {
+                    xstrcat(pstrChanged, "DLL ", 0);
+                    xstrcat(pstrChanged, pszOld, 0);
+                    xstrcatc(pstrChanged, '\n');
+                }
+                DeleteLine(pEdit, pLine);
+                pEdit->fDirty = TRUE;
+                fDeletedOld = TRUE;
+            break;
+
+            case CFGRPL_REMOVEPART:
+                if (    (pszArgNew)
+                     && (pszNewText = RemoveEntries(pszOld,
+                                                    (pEq) ? pEq + 1 : pszOld,
+                                                    pszArgNew))
+                   )
+                    arc = SetLineText(pEdit, pLine, pszNewText);
+                pcszLog = "DLP ";
+                pcszLogText = pManip->pszNewLine;
+            break;
+        }
+    }
+    else if (    (pManip->iReplaceMode != CFGRPL_REMOVELINE)
+              && (pManip->iReplaceMode != CFGRPL_REMOVEPART)
+            )
+    {
+        // not found or CFGRPL_ADD: add a new line
+        PCSYSLINE   pBefore = NULL;     // NULL means bottom
+        PCSYSLINE   pFound;
+
+        switch (pManip->iVertical)
+        {
+            case CFGVRT_TOP:
+                pBefore = pEdit->pFirst;
+            break;
+
+            case CFGVRT_BEFORE:
+                if (pFound = FindTextLine(pEdit, pManip->pszVerticalSearchString))
+                    pBefore = pFound;
+                else
+                    pBefore = pEdit->pFirst;
+            break;
+
+            case CFGVRT_AFTER:
+                if (pFound = FindTextLine(pEdit, pManip->pszVerticalSearchString))
+                    pBefore = pFound->pNext;
+            break;
+        }
+
+        if (    (!pBefore)
+             && (pEdit->pszBottomMarker)
+           )
+        {
+            // first line added at the bottom: add the marker first
+            PSZ     p = pEdit->pszBottomMarker;
+            while (*p)
+            {
+                PSZ     pEOL = strchr(p, '\n');
+                ULONG   cb = (pEOL) ? pEOL - p : strlen(p);
+
+                // a leading line break means an empty line,
+                // unless the file ends in one already
+                if (    (cb || pEOL)
+                     && (    (cb)
+                          || (p != pEdit->pszBottomMarker)
+                          || ((pEdit->pLast) && (*pEdit->pLast->psz))
+                        )
+                     && (!InsertLine(pEdit, NULL, p, cb))
+                   )
+                    arc = ERROR_NOT_ENOUGH_MEMORY;
+
+                if (!pEOL)
+                    break;
+                p = pEOL + 1;
+            }
+            free(pEdit->pszBottomMarker);
+            pEdit->pszBottomMarker = NULL;
+        }
+
+        if (!InsertLine(pEdit, pBefore, pManip->pszNewLine, strlen(pManip->pszNewLine)))
+            arc = ERROR_NOT_ENOUGH_MEMORY;
+        else
+        {
+            if (!pBefore)
+                pEdit->fEndsWithEOL = TRUE;
+            pEdit->fDirty = TRUE;
+        }
+
+        pcszLog = "NWL ";
+        pcszLogText = pManip->pszNewLine;
+    }
+
+    if (    (!arc)
+         && (pstrChanged)
+         && (pcszLog)
+         && (!fDeletedOld)
+       )
+    {
+        xstrcat(pstrChanged, pcszLog, 0);
+        xstrcat(pstrChanged, pcszLogText, 0);
+        xstrcatc(pstrChanged, '\n');
+    }
+
+    free(pszCommand);
+    if (pszArgNew)
+        free(pszArgNew);
+
+    return arc;
+}
+
+/*
+ *@@ csysEditIsDirty:
+ *      returns TRUE if csysEditManipulate has changed
+ *      anything.
+ */
+
+BOOL csysEditIsDirty(PCSYSEDIT pEdit)
+{
+    return pEdit->fDirty;
+}
+
+/*
+ *@@ csysEditCommit:
+ *      writes the edited CONFIG.SYS back to disk if
+ *      anything was changed.
+ *
+ *      The new file is written under a temporary name
+ *      in the same directory first and then renamed, so
+ *      CONFIG.SYS is never left half written. If
+ *      pszBackup is not NULL, the old file is renamed to
+ *      a backup name (see doshCreateBackupFileName), which
+ *      is copied to pszBackup.
+ *
+ *      Returns ERROR_ACCESS_DENIED if CONFIG.SYS is
+ *      read-only.
+ */
+
+APIRET csysEditCommit(PCSYSEDIT pEdit,          // in: from csysEditOpen
+                      PSZ pszBackup)            // out: backup file name or NULL
+{
+    APIRET      arc = NO_ERROR;
+    FILESTATUS3 fs3;
+    XSTRING     strText;
+    PCSYSLINE   p;
+    PSZ         pszTemp = NULL,
+                pszBak = NULL;
+
+    if (!pEdit->fDirty)
+        return NO_ERROR;
+
+    if (    (!DosQueryPathInfo(pEdit->szFile,
+                               FIL_STANDARD,
+                               &fs3,
+                               sizeof(fs3)))
+         && (fs3.attrFile & FILE_READONLY)
+       )
+        return ERROR_ACCESS_DENIED;
+
+    xstrInit(&strText, 0);
+    for (p = pEdit->pFirst; p; p = p->pNext)
+    {
+        xstrcat(&strText, p->psz, 0);
+        if ((p->pNext) || (pEdit->fEndsWithEOL))
+            xstrcat(&strText, "\r\n", 2);
+    }
+
+    if (!(pszTemp = doshCreateBackupFileName(pEdit->szFile)))
+        arc = ERROR_NOT_ENOUGH_MEMORY;
+    else if (!(arc = doshWriteTextFile(pszTemp,
+                                       strText.psz ? strText.psz : "",
+                                       NULL,
+                                       NULL)))
+    {
+        // now swap the files
+        if (pszBackup)
+        {
+            if (!(pszBak = doshCreateBackupFileName(pEdit->szFile)))
+                arc = ERROR_NOT_ENOUGH_MEMORY;
+            else if (!(arc = DosMove(pEdit->szFile, pszBak)))
+                strcpy(pszBackup, pszBak);
+        }
+        else
+            arc = DosDelete(pEdit->szFile);
+
+        if (!arc)
+        {
+            if (arc = DosMove(pszTemp, pEdit->szFile))
+                // put the old file back
+                if (pszBak)
+                    DosMove(pszBak, pEdit->szFile);
+        }
+
+        if (arc)
+            DosDelete(pszTemp);
+        else
+            pEdit->fDirty = FALSE;
+    }
+
+    xstrClear(&strText);
+    if (pszTemp)
+        free(pszTemp);
+    if (pszBak)
+        free(pszBak);
+
+    return arc;
+}
+
+/*
+ *@@ csysEditClose:
+ *      frees the editor without writing anything.
+ */
+
+VOID csysEditClose(PCSYSEDIT pEdit)
+{
+    while (pEdit->pFirst)
+        DeleteLine(pEdit, pEdit->pFirst);
+    if (pEdit->pszBottomMarker)
+        free(pEdit->pszBottomMarker);
+    free(pEdit);
+}
+
 /* ******************************************************************
  *
  *   Swappath
@@ -119,6 +119,31 @@ extern "C" {
                               PXSTRING pstrChanged);
     #endif
 
+    /* ******************************************************************
+     *
+     *   Transactional CONFIG.SYS editor
+     *
+     ********************************************************************/
+
+    typedef struct _CSYSEDIT *PCSYSEDIT;
+
+    APIRET csysEditOpen(PCSZ pcszFile,
+                        PCSZ pcszBottomMarker,
+                        PCSYSEDIT *ppEdit);
+
+    #ifdef XSTRING_HEADER_INCLUDED
+        APIRET csysEditManipulate(PCSYSEDIT pEdit,
+                                  PCONFIGMANIP pManip,
+                                  PXSTRING pstrChanged);
+    #endif
+
+    BOOL csysEditIsDirty(PCSYSEDIT pEdit);
+
+    APIRET csysEditCommit(PCSYSEDIT pEdit,
+                          PSZ pszBackup);
+
+    VOID csysEditClose(PCSYSEDIT pEdit);
+
     /* ******************************************************************
      *
      *   Swappath
@@ -0,0 +1,463 @@
+/*
+ *  Multimedia IOProc benchmark
+ *
+ *  Opens each file through MMIO with header and data translation on,
+ *  the way the MCI drivers and viewers do, and times:
+ *    - ident: mmioIdentifyFile(), which asks each installed IOProc
+ *    - open: mmioOpen() with the IOProc that claimed the file
+ *    - first: open plus the first 4 KB of decoded data
+ *    - MB/s: decoded bytes per second over the whole file, and
+ *      file bytes per second over the same time
+ *    - seeks (audio only): mmioSeek() to a random sample, each followed
+ *      by a 4 KB read; the 50th, 90th and 99th percentile and the worst
+ *    - peak: the most private memory the process had committed above
+ *      what it had before the open
+ *  Each file is run several times. The median ident, open and first
+ *  times, the best throughput and the largest peak are reported, and
+ *  seek positions come from a fixed seed, so two builds run on the same
+ *  machine and corpus give numbers that compare line by line.
+ *
+ *  mmbench [-r runs] [-s seeks] [-p dll fourcc]... file|@list...
+ *
+ *  -p loads an IOProc DLL and installs it for this process only with
+ *  mmioInstallIOProc(), so a fresh build is measured without touching
+ *  MMPM2.INI. Procs installed this way are asked first. @list names a
+ *  text file with one file name per line.
+ */
+
+#define INCL_DOS
+#define INCL_DOSPROFILE
+#define INCL_DOSERRORS
+#define INCL_OS2MM
+#define INCL_MMIOOS2
+
+#include <os2.h>
+#include <os2me.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHUNK      65536
+#define FIRST      4096
+#define MAXRUNS    16
+#define MAXSEEKS   1000
+#define MAXPROCS   16
+#define ARENATOP   0x20000000     /* the private arena is below 512 MB */
+
+typedef struct _RUN
+{
+  double ident;                   /* ms */
+  double open;
+  double first;
+  double decode;                  /* ms from open to the end of data */
+  ULONG  cbOut;
+  ULONG  cbPeak;                  /* bytes above the baseline */
+} RUN;
+
+typedef struct _LOCALPROC
+{
+  FOURCC    fcc;
+  HMODULE   hmod;
+} LOCALPROC;
+
+static LOCALPROC aProcs[MAXPROCS];
+static ULONG     cProcs;
+
+static RUN    aRuns[MAXRUNS];
+static double adSeeks[MAXRUNS * MAXSEEKS];
+static ULONG  cSeeks;
+
+static CHAR   achBuf[CHUNK];
+static ULONG  ulSeed;
+static ULONG  ulTmrFreq;
+static ULONG  cbBase;
+
+static ULONG Random(ULONG n)
+{
+  ulSeed = ulSeed * 1103515245 + 12345;
+  return (ulSeed >> 16) % n;
+}
+
+/* A number in [0, n) for n past 64K */
+static ULONG BigRandom(ULONG n)
+{
+  ULONG hi = Random(65536);
+
+  return ((hi << 16) | Random(65536)) % n;
+}
+
+static double Now(VOID)
+{
+  QWORD qw;
+
+  DosTmrQueryTime(&qw);
+  return (qw.ulHi * 4294967296.0 + qw.ulLo) * 1000.0 / ulTmrFreq;
+}
+
+/*
+ *  Private memory the process has committed. Walks the private arena
+ *  one run of pages with like attributes at a time, so it costs about
+ *  as much as there are allocations; cheap next to a 64 KB decode.
+ */
+static ULONG Committed(VOID)
+{
+  ULONG p = 0x10000;
+  ULONG cb, fl;
+  ULONG total = 0;
+
+  while (p < ARENATOP)
+  {
+    cb = ARENATOP - p;
+    if (DosQueryMem((PVOID)p, &cb, &fl) || !cb)
+      break;
+
+    if ((fl & PAG_COMMIT) && !(fl & PAG_SHARED))
+      total += cb;
+
+    p += cb;
+  }
+
+  return total;
+}
+
+static VOID Sample(RUN *r)
+{
+  ULONG cb = Committed();
+
+  if (cb > cbBase && cb - cbBase > r->cbPeak)
+    r->cbPeak = cb - cbBase;
+}
+
+static int CompareDouble(const void *a, const void *b)
+{
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static double Percentile(double *ad, ULONG n, ULONG pct)
+{
+  ULONG i;
+
+  if (!n)
+    return 0.0;
+
+  i = (n * pct + 99) / 100;
+  return ad[i ? i - 1 : 0];
+}
+
+static double Median(ULONG offset, ULONG runs)
+{
+  double ad[MAXRUNS];
+  ULONG  i;
+
+  for (i = 0; i < runs; i++)
+    ad[i] = *(double *)((PCHAR)&aRuns[i] + offset);
+
+  qsort(ad, runs, sizeof(ad[0]), CompareDouble);
+  return ad[runs / 2];
+}
+
+/*
+ *  One pass over a file. Returns the media type, or 0 if the file could
+ *  not be identified or opened.
+ */
+static ULONG RunFile(PSZ pszFile, RUN *r, ULONG ulSeeks, FOURCC *pfcc)
+{
+  MMFORMATINFO fmt;
+  FOURCC       fccStorage;
+  MMIOINFO     mi;
+  HMMIO        hmmio;
+  union
+  {
+    MMAUDIOHEADER audio;
+    MMIMAGEHEADER image;
+  } hdr;
+  LONG   cbHdr = 0;
+  LONG   cbRead;
+  LONG   n;
+  ULONG  ulType = MMIO_MEDIATYPE_UNKNOWN;
+  ULONG  cbAudio = 0;
+  ULONG  cbAlign = 1;
+  ULONG  i;
+  double t0, t;
+
+  memset(r, 0, sizeof(*r));
+  memset(&fmt, 0, sizeof(fmt));
+  ulSeed = 12345;
+
+  t0 = Now();
+  if (mmioIdentifyFile(pszFile, NULL, &fmt, &fccStorage, 0, 0) != MMIO_SUCCESS)
+    return 0;
+  r->ident = Now() - t0;
+  *pfcc = fmt.fccIOProc;
+
+  memset(&mi, 0, sizeof(mi));
+  mi.fccIOProc = fmt.fccIOProc;
+  mi.ulTranslate = MMIO_TRANSLATEHEADER | MMIO_TRANSLATEDATA;
+
+  cbBase = Committed();
+
+  t0 = Now();
+  hmmio = mmioOpen(pszFile, &mi, MMIO_READ | MMIO_DENYWRITE);
+  if (!hmmio)
+    return 0;
+  t = Now();
+  r->open = t - t0;
+  Sample(r);
+
+  if (mmioQueryHeaderLength(hmmio, &cbHdr, 0, 0) == MMIO_SUCCESS &&
+      cbHdr > 0 && cbHdr <= sizeof(hdr) &&
+      mmioGetHeader(hmmio, &hdr, cbHdr, &cbRead, 0, 0) == MMIO_SUCCESS)
+  {
+    ulType = hdr.audio.ulMediaType;
+
+    if (ulType == MMIO_MEDIATYPE_AUDIO)
+    {
+      cbAudio = hdr.audio.mmXWAVHeader.XWAVHeaderInfo.ulAudioLengthInBytes;
+      cbAlign = hdr.audio.mmXWAVHeader.WAVEHeader.usBlockAlign;
+      if (!cbAlign)
+        cbAlign = 1;
+    }
+  }
+
+  // the header is parsed already, so this is the decoder's first output
+  n = mmioRead(hmmio, achBuf, FIRST);
+  r->first = Now() - t0;
+  if (n > 0)
+    r->cbOut += n;
+
+  while ((n = mmioRead(hmmio, achBuf, CHUNK)) > 0)
+  {
+    r->cbOut += n;
+    Sample(r);
+  }
+  r->decode = Now() - t;
+
+  if (ulType == MMIO_MEDIATYPE_AUDIO && cbAudio / cbAlign > 1)
+  {
+    for (i = 0; i < ulSeeks; i++)
+    {
+      LONG lPos = BigRandom(cbAudio / cbAlign) * cbAlign;
+
+      t = Now();
+      if (mmioSeek(hmmio, lPos, SEEK_SET) != lPos)
+        break;
+      mmioRead(hmmio, achBuf, FIRST);
+      adSeeks[cSeeks++] = Now() - t;
+      Sample(r);
+    }
+  }
+
+  mmioClose(hmmio, 0);
+  return ulType;
+}
+
+static VOID Report(PSZ pszFile, ULONG runs, ULONG ulSeeks)
+{
+  FILESTATUS3 fs;
+  FOURCC      fcc = 0;
+  ULONG       ulType = 0;
+  ULONG       cbPeak = 0;
+  double      best = 0.0;
+  double      mbOut, mbIn;
+  CHAR        szFcc[5];
+  PSZ         pszType;
+  ULONG       i;
+
+  memset(&fs, 0, sizeof(fs));
+  DosQueryPathInfo(pszFile, FIL_STANDARD, &fs, sizeof(fs));
+
+  cSeeks = 0;
+  for (i = 0; i < runs; i++)
+  {
+    ulType = RunFile(pszFile, &aRuns[i], ulSeeks, &fcc);
+    if (!ulType)
+    {
+      printf("%-4s %-5s %s: cannot open\n", "-", "-", pszFile);
+      return;
+    }
+
+    if (aRuns[i].decode > 0.0 && (!best || aRuns[i].decode < best))
+      best = aRuns[i].decode;
+    if (aRuns[i].cbPeak > cbPeak)
+      cbPeak = aRuns[i].cbPeak;
+  }
+
+  memcpy(szFcc, &fcc, 4);
+  szFcc[4] = '\0';
+
+  switch (ulType)
+  {
+    case MMIO_MEDIATYPE_AUDIO: pszType = "audio"; break;
+    case MMIO_MEDIATYPE_IMAGE: pszType = "image"; break;
+    default:                   pszType = "other"; break;
+  }
+
+  mbOut = best ? aRuns[0].cbOut / 1048576.0 / (best / 1000.0) : 0.0;
+  mbIn  = best ? fs.cbFile / 1048576.0 / (best / 1000.0) : 0.0;
+
+  qsort(adSeeks, cSeeks, sizeof(adSeeks[0]), CompareDouble);
+
+  printf("%-4s %-5s %8lu %8lu %7.2f %7.2f %7.2f %8.2f %7.2f "
+         "%7.2f %7.2f %7.2f %7.2f %7lu %s\n",
+         szFcc, pszType,
+         fs.cbFile / 1024, aRuns[0].cbOut / 1024,
+         Median(offsetof(RUN, ident), runs),
+         Median(offsetof(RUN, open), runs),
+         Median(offsetof(RUN, first), runs),
+         mbOut, mbIn,
+         Percentile(adSeeks, cSeeks, 50),
+         Percentile(adSeeks, cSeeks, 90),
+         Percentile(adSeeks, cSeeks, 99),
+         cSeeks ? adSeeks[cSeeks - 1] : 0.0,
+         cbPeak / 1024,
+         pszFile);
+}
+
+static VOID ReportList(PSZ pszList, ULONG runs, ULONG ulSeeks)
+{
+  FILE *f = fopen(pszList, "r");
+  CHAR  szLine[CCHMAXPATH];
+  PCHAR p;
+
+  if (!f)
+  {
+    printf("cannot open list %s\n", pszList);
+    return;
+  }
+
+  while (fgets(szLine, sizeof(szLine), f))
+  {
+    p = szLine + strlen(szLine);
+    while (p > szLine && (p[-1] == '\n' || p[-1] == '\r' || p[-1] == ' '))
+      *--p = '\0';
+
+    if (szLine[0] && szLine[0] != ';')
+      Report(szLine, runs, ulSeeks);
+  }
+
+  fclose(f);
+}
+
+static int LoadProc(PSZ pszDll, PSZ pszFcc)
+{
+  CHAR      szErr[CCHMAXPATH];
+  HMODULE   hmod;
+  PFN       pfn;
+  FOURCC    fcc;
+  APIRET    rc;
+
+  if (cProcs == MAXPROCS)
+    return 1;
+
+  rc = DosLoadModule(szErr, sizeof(szErr), pszDll, &hmod);
+  if (rc != NO_ERROR)
+  {
+    printf("cannot load %s (%s): return code = %lu\n", pszDll, szErr, rc);
+    return 1;
+  }
+
+  // every IOProc exports its entry point as ordinal 1
+  rc = DosQueryProcAddr(hmod, 1, NULL, &pfn);
+  if (rc != NO_ERROR)
+  {
+    printf("%s has no IOProc_Entry: return code = %lu\n", pszDll, rc);
+    DosFreeModule(hmod);
+    return 1;
+  }
+
+  fcc = mmioStringToFOURCC(pszFcc, MMIO_TOUPPER);
+  if (!mmioInstallIOProc(fcc, (PMMIOPROC)pfn, MMIO_INSTALLPROC))
+  {
+    printf("cannot install %s as %s\n", pszDll, pszFcc);
+    DosFreeModule(hmod);
+    return 1;
+  }
+
+  aProcs[cProcs].fcc = fcc;
+  aProcs[cProcs].hmod = hmod;
+  cProcs++;
+
+  return 0;
+}
+
+static VOID Usage(VOID)
+{
+  printf("usage: mmbench [-r runs] [-s seeks] [-p dll fourcc]... file|@list...\n");
+}
+
+int main(int argc, char *argv[])
+{
+  ULONG runs = 3;
+  ULONG ulSeeks = 100;
+  ULONG i;
+  int   a;
+
+  DosTmrQueryFreq(&ulTmrFreq);
+
+  for (a = 1; a < argc && argv[a][0] == '-'; a++)
+  {
+    switch (argv[a][1])
+    {
+      case 'r':
+        if (++a == argc)
+          break;
+        runs = atol(argv[a]);
+        continue;
+
+      case 's':
+        if (++a == argc)
+          break;
+        ulSeeks = atol(argv[a]);
+        continue;
+
+      case 'p':
+        if (a + 2 >= argc)
+          break;
+        if (LoadProc(argv[a + 1], argv[a + 2]))
+          return 1;
+        a += 2;
+        continue;
+    }
+
+    Usage();
+    return 1;
+  }
+
+  if (a == argc || !runs)
+  {
+    Usage();
+    return 1;
+  }
+
+  if (runs > MAXRUNS)
+    runs = MAXRUNS;
+  if (ulSeeks > MAXSEEKS)
+    ulSeeks = MAXSEEKS;
+
+  printf("mmbench: %lu runs, %lu seeks, timer %lu Hz\n", runs, ulSeeks, ulTmrFreq);
+  printf("%-4s %-5s %8s %8s %7s %7s %7s %8s %7s %7s %7s %7s %7s %7s %s\n",
+         "proc", "type", "in_KB", "out_KB", "ident", "open", "first",
+         "out_MB/s", "in_MB/s", "seek50", "seek90", "seek99", "seekmax",
+         "peak_KB", "file");
+
+  for (; a < argc; a++)
+  {
+    if (argv[a][0] == '@')
+      ReportList(argv[a] + 1, runs, ulSeeks);
+    else
+      Report(argv[a], runs, ulSeeks);
+  }
+
+  for (i = 0; i < cProcs; i++)
+  {
+    mmioInstallIOProc(aProcs[i].fcc, NULL, MMIO_REMOVEPROC);
+    DosFreeModule(aProcs[i].hmod);
+  }
+
+  return 0;
+}
@@ -0,0 +1,230 @@
+/* gpi.cpp */
+/* Client side GPI primitives of FreePM */
+/* DEBUG: section 10    GPI functions of FreePM */
+
+#include <string.h>
+
+#include <FreePM.hpp>
+#include <F_hab.hpp>
+#include <pmclient.h>
+
+#include "FreePM_err.hpp"
+#include "F_def.hpp"
+#include "debug.h"
+
+#include <os2.h>
+#include <PM_api.h>
+
+/* Primitives are not sent one by one: each HPS collects them in a
+   batch which goes to the server as one F_CMD_GPI_BATCH when it is
+   full, when the PS is released or painting ends, on a state query
+   or on F_GpiFlush. A drawing call therefore only reports errors it
+   can see here; a primitive the server rejects makes the flush fail */
+
+#define GPI_NUM_BATCHES  16    /* HPSs with a batch open at once */
+#define GPI_TEXT_PIECE   256   /* characters in one text record */
+
+struct GPIBATCH
+{
+   volatile int lock;
+   HPS  hps;                   /* 0 - slot is free */
+   LONG lColor;                /* last color set through this client */
+   int  fColor;
+   int  n;                     /* ints in buf */
+   int  buf[F_GPI_BATCH_LEN];
+};
+
+static struct GPIBATCH batches[GPI_NUM_BATCHES];
+
+static void BatchLock(struct GPIBATCH *b)
+{  int raz = 0;
+   while(__lxchg(&b->lock, LOCKED))
+   {  if(++raz < 3) DosSleep(0);
+      else          DosSleep(1);
+   }
+}
+
+static void BatchUnlock(struct GPIBATCH *b)
+{  __lxchg(&b->lock, UNLOCKED);
+}
+
+/* send what has been collected; called with the slot locked */
+static BOOL BatchSend(struct GPIBATCH *b)
+{  int rc;
+
+   if(b->n == 0)
+      return TRUE;
+   rc = F_SendGenCmdDataToServer(client_obj, F_CMD_GPI_BATCH, b->hps, b->buf, b->n);
+   debug(10, 3) (__FUNCTION__ " hps=%x, %i ints, rc=%x\n", b->hps, b->n, rc);
+   b->n = 0;
+   return rc;
+}
+
+/* Lock and return the batch of hps, taking the slot over from another
+   HPS (after sending its primitives) if need be */
+static struct GPIBATCH *BatchGet(HPS hps)
+{  struct GPIBATCH *b = &batches[(ULONG)hps % GPI_NUM_BATCHES];
+
+   BatchLock(b);
+   if(b->hps != hps)
+   {  BatchSend(b);
+      b->hps = hps;
+      b->fColor = 0;
+   }
+   return b;
+}
+
+static BOOL BatchAdd(HPS hps, int op, int *args, int nargs)
+{  struct GPIBATCH *b;
+   BOOL rc = TRUE;
+   int i;
+
+   if(hps == NULLHANDLE)
+      return FALSE;
+   b = BatchGet(hps);
+   if(b->n + 1 + nargs > F_GPI_BATCH_LEN)
+      rc = BatchSend(b);
+   b->buf[b->n++] = op;
+   for(i = 0; i < nargs; i++)
+      b->buf[b->n++] = args[i];
+   if(op == F_GPI_OP_SET_COLOR)
+   {  b->lColor = args[0];
+      b->fColor = 1;
+   }
+   BatchUnlock(b);
+   return rc;
+}
+
+/* A text record: op, args, the count, then the characters 4 to an int */
+static BOOL BatchAddText(HPS hps, int op, int *args, int nargs, PCH pch, int cch)
+{  struct GPIBATCH *b;
+   BOOL rc = TRUE;
+   int i, cInts = (cch + 3) / 4;
+
+   if(hps == NULLHANDLE)
+      return FALSE;
+   b = BatchGet(hps);
+   if(b->n + 2 + nargs + cInts > F_GPI_BATCH_LEN)
+      rc = BatchSend(b);
+   b->buf[b->n++] = op;
+   for(i = 0; i < nargs; i++)
+      b->buf[b->n++] = args[i];
+   b->buf[b->n++] = cch;
+   if(cInts)
+   {  b->buf[b->n + cInts - 1] = 0;
+      memcpy(&b->buf[b->n], pch, cch);
+      b->n += cInts;
+   }
+   BatchUnlock(b);
+   return rc;
+}
+
+extern "C" BOOL APIENTRY F_GpiFlush(HPS hps)
+{  struct GPIBATCH *b = &batches[(ULONG)hps % GPI_NUM_BATCHES];
+   BOOL rc = TRUE;
+
+   BatchLock(b);
+   if(b->hps == hps)
+      rc = BatchSend(b);
+   BatchUnlock(b);
+   return rc;
+}
+
+/* Flush and give the slot up, so the color known here does not carry
+   over to whatever HPS the server hands out under this number next */
+extern "C" BOOL APIENTRY F_GpiEndBatch(HPS hps)
+{  struct GPIBATCH *b = &batches[(ULONG)hps % GPI_NUM_BATCHES];
+   BOOL rc = TRUE;
+
+   BatchLock(b);
+   if(b->hps == hps)
+   {  rc = BatchSend(b);
+      b->hps = NULLHANDLE;
+      b->fColor = 0;
+   }
+   BatchUnlock(b);
+   return rc;
+}
+
+extern "C" BOOL APIENTRY F_GpiSetColor(HPS hps, LONG lColor)
+{  int args[1];
+
+   args[0] = lColor;
+   return BatchAdd(hps, F_GPI_OP_SET_COLOR, args, 1);
+}
+
+/* The server keeps no color this client could not know about, so after
+   the flush the answer comes from here */
+extern "C" LONG APIENTRY F_GpiQueryColor(HPS hps)
+{  struct GPIBATCH *b;
+   LONG lColor = CLR_DEFAULT;
+
+   if(hps == NULLHANDLE)
+      return CLR_ERROR;
+   b = BatchGet(hps);
+   if(!BatchSend(b))
+      lColor = CLR_ERROR;
+   else if(b->fColor)
+      lColor = b->lColor;
+   BatchUnlock(b);
+   return lColor;
+}
+
+extern "C" BOOL APIENTRY F_GpiMove(HPS hps, PPOINTL pptlPoint)
+{  int args[2];
+
+   args[0] = pptlPoint->x;
+   args[1] = pptlPoint->y;
+   return BatchAdd(hps, F_GPI_OP_MOVE, args, 2);
+}
+
+extern "C" LONG APIENTRY F_GpiLine(HPS hps, PPOINTL pptlEndPoint)
+{  int args[2];
+
+   args[0] = pptlEndPoint->x;
+   args[1] = pptlEndPoint->y;
+   return BatchAdd(hps, F_GPI_OP_LINE, args, 2) ? GPI_OK : GPI_ERROR;
+}
+
+extern "C" LONG APIENTRY F_GpiBox(HPS hps, LONG lControl, PPOINTL pptlPoint,
+                                  LONG lHRound, LONG lVRound)
+{  int args[5];
+
+   args[0] = lControl;
+   args[1] = pptlPoint->x;
+   args[2] = pptlPoint->y;
+   args[3] = lHRound;
+   args[4] = lVRound;
+   return BatchAdd(hps, F_GPI_OP_BOX, args, 5) ? GPI_OK : GPI_ERROR;
+}
+
+/* The server draws a string with one driver call per visible piece of
+   it, so text goes in as whole strings; long ones are cut into pieces
+   that carry on from the current position */
+extern "C" LONG APIENTRY F_GpiCharString(HPS hps, LONG lCount, PCH pchString)
+{  LONG n;
+   BOOL rc = TRUE;
+
+   if(lCount < 0 || (lCount && pchString == NULL))
+      return GPI_ERROR;
+   for( ; rc && lCount > 0; lCount -= n, pchString += n)
+   {  n = lCount > GPI_TEXT_PIECE ? GPI_TEXT_PIECE : lCount;
+      rc = BatchAddText(hps, F_GPI_OP_CHARSTR, NULL, 0, pchString, n);
+   }
+   return rc ? GPI_OK : GPI_ERROR;
+}
+
+extern "C" LONG APIENTRY F_GpiCharStringAt(HPS hps, PPOINTL pptlPoint,
+                                           LONG lCount, PCH pchString)
+{  int args[2];
+   LONG n;
+
+   if(lCount < 0 || (lCount && pchString == NULL))
+      return GPI_ERROR;
+   args[0] = pptlPoint->x;
+   args[1] = pptlPoint->y;
+   n = lCount > GPI_TEXT_PIECE ? GPI_TEXT_PIECE : lCount;
+   if(!BatchAddText(hps, F_GPI_OP_CHARSTR_AT, args, 2, pchString, n))
+      return GPI_ERROR;
+   return F_GpiCharString(hps, lCount - n, pchString + n);
+}
@@ -20,6 +20,8 @@
 #define Q_ORDINAL_HAB   0
 #define Q_ORDINAL_INDEX 1
 
+#define HAB_DISPATCH_CACHE 16  /* windows remembered by WinDispatchMsg */
+
 struct _FreePM_hwnd
 {
   HWND hwnd;       /* window handle */
@@ -52,6 +54,8 @@ struct _FreePM_HABinf
    int numWinClasses;
    int lAllocWinClasses;
    struct _FreePM_ClassInfo *pWinClassList; /* Private window classes list */
+   _FreePM_hwnd dispatch[HAB_DISPATCH_CACHE]; /* own windows by hwnd % size, */
+                        /* so dispatching does not search every pHwnd */
 };
 /*   lAllocpHwnd*sizeof(_FreePM_hwnd)  ᯨ᪮ hwnd , ਭ HAB */
   \
@@ -97,6 +101,7 @@ public:
    int QueryIndexesHwnd(HWND hwnd, int &indwind);
    int QueryHwnd(HWND hwnd);
    int QueryHwnd(HWND hwnd, int iHAB);
+   FPM_Window *DispatchWindow(int ind, HWND hwnd);
 
 };
 
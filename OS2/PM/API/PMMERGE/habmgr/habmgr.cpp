@@ -7,6 +7,7 @@
 /* DEBUG: section 4     client HAB manager */
 
 #include <stdio.h>
+#include <string.h>
 #include <malloc.h>
 #include <builtin.h>
 #include <time.h>
@@ -140,6 +141,7 @@ int _FreePM_HAB::AddHAB(int ordinal, int iHAB,  int clientId)
     hab[i].numWinClasses = 0;
     hab[i].pWinClassList = NULL;
     hab[i].lAllocWinClasses = 16;
+    memset(hab[i].dispatch, 0, sizeof(hab[i].dispatch));
 
     return 0;
 }
@@ -321,6 +323,34 @@ int _FreePM_HAB::QueryHwnd(HWND hwnd, int iHAB)
     return 0;
 }
 
+/* Window hwnd of hab[ind] (an index into hab[]) for WinDispatchMsg,
+   or NULL if it is not one of its windows. Found windows are cached,
+   DelHwnd forgets them again. */
+FPM_Window *_FreePM_HAB::DispatchWindow(int ind, HWND hwnd)
+{   FPM_Window *pw = NULL;
+    int i, j, rcS;
+
+    i = (ULONG)hwnd % HAB_DISPATCH_CACHE;
+   do
+   {  rcS =  __lxchg(&hab[ind].Access,LOCKED);
+      if(rcS) DosSleep(0);
+   } while(rcS);
+    if(hwnd != NULLHANDLE && hab[ind].dispatch[i].hwnd == hwnd)
+       pw = hab[ind].dispatch[i].pw;
+    else
+    {  for(j = 0; j < hab[ind].nHwnd; j++)
+       {  if(hab[ind].pHwnd[j].hwnd == hwnd)
+          {  pw = hab[ind].pHwnd[j].pw;
+             hab[ind].dispatch[i].hwnd = hwnd;
+             hab[ind].dispatch[i].pw = pw;
+             break;
+          }
+       }
+    }
+    __lxchg(&hab[ind].Access,UNLOCKED);
+    return pw;
+}
+
 /*  㤠   ᯨ᪠  ᪮  */
 /* Return:
    -1 - PMERR_INVALID_HWND
@@ -364,6 +394,11 @@ int _FreePM_HAB::DelHwnd(HWND hwnd, int iHAB)
         }
         hab[ind].nHwnd--;
     }
+    i = (ULONG)hwnd % HAB_DISPATCH_CACHE;
+    if(hab[ind].dispatch[i].hwnd == hwnd)
+    {  hab[ind].dispatch[i].hwnd = NULLHANDLE;
+       hab[ind].dispatch[i].pw = NULL;
+    }
     __lxchg(&hab[ind].Access,UNLOCKED);
     return 0;
 }
@@ -121,8 +121,8 @@ extern "C" BOOL    APIENTRY Win32GetMsg(HAB ihab,             /* Anchor-block ha
             return brc;
           }
        } else {
-//Query number of messages on server
-            rc = F_SendCmdToServer(client_obj, F_CMD_WINQUERY_MSG, ihab);
+//Query number of messages on server, waiting a while for one to arrive
+            rc = F_SendCmdToServer(client_obj, F_CMD_WINWAIT_MSG, ihab);
             if(rc)
             {
                if(rc == ERROR_BROKEN_PIPE)
@@ -153,9 +153,9 @@ extern "C" BOOL    APIENTRY Win32GetMsg(HAB ihab,             /* Anchor-block ha
                   }
             }
        }
-//No messages: Let's sleep
-       debug(3, 9)("WinGetMsg Sleep\n");
-       DosSleep(1);
+//No messages: the server has already waited FREEPMS_MSG_WAIT msec for one,
+//and a count from it may cover a message still being queued
+       nmsg = 0;
     } while (nmsg == 0);
 
     return brc;
@@ -165,9 +165,19 @@ extern "C" MRESULT APIENTRY Win32DispatchMsg(HAB hab,
                                    PQMSG pqmsg)
 { int ordinal, iHab, tid,iHABto, indiHabto, indpw;
   int rc,rcf;
+  FPM_Window *pw = NULL;
 
    debug(3, 0)("WinDispatchMsg call\n"); // 2
 
+/* Fast path: almost every message is for a window of hab itself */
+   rc = _hab.QueryHABexist(hab);
+   if(rc > 0)
+       pw = _hab.DispatchWindow(rc - 1, pqmsg->hwnd);
+   if(pw)
+   {   rcf = pw->proc(pqmsg);
+       return NULL;
+   }
+
    ordinal = QueryThreadOrdinal(tid);
    rc = _hab.QueryOrdinalUsed(ordinal,Q_ORDINAL_HAB);
    if(rc == -1)
@@ -91,7 +91,7 @@ int Fs_Queue::DelFirst(void)
       if(rcS) DosSleep(0);
    } while(rcS);     //  
 
-    start++; length--;
+    length--;
     start = (start + 1) % lQueuesize;
 
     __lxchg(&Access,UNLOCKED);
@@ -118,7 +118,7 @@ int Fs_Queue::Get(PSQMSG pmsg)
 
     *pmsg = queue[start];
 
-    start++; length--;
+    length--;
     start = (start + 1) % lQueuesize;
 
     __lxchg(&Access,UNLOCKED);
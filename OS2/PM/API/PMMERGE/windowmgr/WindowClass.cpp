@@ -368,25 +368,24 @@ WinSetWindowPos(HWND hwndInsertBehind,
              mp2 = (MPARAM) MAKELONG((short)_cx,(short)_cy);
              nx = _cx;
              ny = _cy;
-             data[0] = nx;
-             data[1] = ny;
              SendMsg_to_proc(WM_SIZE, mp1, mp2);
-             F_SendGenCmdDataToServer(client_obj, F_CMD_WIN_SET_WND_SIZE, handle, data, 2);
        }
        if(fl & SWP_MOVE) /* Change the window x,y position */
        {     x = _x;
              y = _y;
-             data[0] = x;
-             data[1] = y;
              SendMsg_to_proc(WM_MOVE, NULL, NULL);
-             F_SendGenCmdDataToServer(client_obj, F_CMD_WIN_SET_WND_SIZE, handle, data, 2);
        }
     }
 
-
-    if(fl & SWP_ZORDER) /* Change the relative window placement. */
-    {
-  debug(3, 1)(__FUNCTION__" call for SWP_ZORDER is not implemented yet\n");
+/* The server keeps position, size and z-order for clipping and repaint */
+    if(fl & (SWP_SIZE|SWP_MOVE|SWP_ZORDER))
+    {   data[0] = hwndInsertBehind;
+        data[1] = x;
+        data[2] = y;
+        data[3] = nx;
+        data[4] = ny;
+        data[5] = fl & (SWP_SIZE|SWP_MOVE|SWP_ZORDER);
+        F_SendGenCmdDataToServer(client_obj, F_CMD_WIN_SET_WND_POS, handle, data, 6);
     }
     if(fl & (SWP_SHOW|SWP_HIDE))
     {   mp1 = (MPARAM)TRUE; /* Show the window. */
@@ -301,15 +301,20 @@ extern "C" BOOL    APIENTRY Win32EnableWindow(HWND hwnd,  BOOL fEnable)
     return TRUE;
 }
 
+extern "C" BOOL    APIENTRY F_GpiFlush(HPS hps);
+extern "C" BOOL    APIENTRY F_GpiEndBatch(HPS hps);
+
 extern "C" BOOL    APIENTRY Win32EndPaint(HPS hps)
 {
  debug(6, 2)( __FUNCTION__ "is not yet implemented\n");
    //todo
+    F_GpiFlush(hps);
     return TRUE;
 }
 
 extern "C" BOOL    APIENTRY Win32ReleasePS(HPS hps)
 {   int rc;
+    F_GpiEndBatch(hps);
     rc =  F_SendGenCmdToServer(client_obj, F_CMD_RELEASE_HPS, hps);
     return rc;
 }
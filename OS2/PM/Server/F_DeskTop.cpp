@@ -115,6 +115,8 @@ int FreePM_DeskTop::Init(int nx, int ny, int bytesPerPixel)
    pWindow->CreateDeskTopWindow(0L,nx, ny,  NULL, NULL); /* bytesPerPixel */
    hwnd = AddWindow(pWindow);
    pWindow->SetHandle(hwnd);
+   /* top level windows are clipped to it */
+   _WndList.WinSetWindowPos(hwnd, 0, 0, 0, nx, ny, SWP_MOVE | SWP_SIZE);
 
 /* Init device i.e. memory, PM, gradd or else */
    rc = pSession->InitDevice(FPM_DEV_PMWIN, this);
@@ -256,21 +258,20 @@ extern "C" int  _DeskTopSendQueue(void *pDClass, QMSG  *pqmMsg)
 
      pDesktop->pWindow->proc(&qMsg);
     if(qMsg.msg == WM_PAINT)
-    {  int iwn;
+    {  int iwn, idesk;
        int ihab,rc;
 /* Send msg to all child windows */
-       for(iwn=0; iwn < _WndList.n; iwn++)
-       {  if( _WndList.pWND[iwn].iParent == pDesktop->hwnd)
-          {  DosBeep(3000,1);
+       idesk = _WndList.WndIndex(pDesktop->hwnd);
+       for(iwn = idesk ? _WndList.pWND[idesk].iFirstChild : 0; iwn; iwn = _WndList.pWND[iwn].iNextSibling)
+       {  DosBeep(3000,1);
 //todo
-             sqMsg.qmsg = qMsg;
-             sqMsg.qmsg.hwnd = _WndList.pWND[iwn].hwnd;
-             sqMsg.ihto   = _WndList.pWND[iwn].iHab;
-             rc = _WndList.QueryHab(pDesktop->hwnd,ihab);
-             sqMsg.ihfrom = ihab;
-             debug(8, 2) ("Add Msg WM_PAINT to Hwnd %x, hab=%i; habfrom=%i\n",sqMsg.qmsg.hwnd, sqMsg.ihto,ihab);
-             pDesktop->pSession->hab_list.Queue.Add(&sqMsg);
-          }
+          sqMsg.qmsg = qMsg;
+          sqMsg.qmsg.hwnd = _WndList.pWND[iwn].hwnd;
+          sqMsg.ihto   = _WndList.pWND[iwn].iHab;
+          rc = _WndList.QueryHab(pDesktop->hwnd,ihab);
+          sqMsg.ihfrom = ihab;
+          debug(8, 2) ("Add Msg WM_PAINT to Hwnd %x, hab=%i; habfrom=%i\n",sqMsg.qmsg.hwnd, sqMsg.ihto,ihab);
+          pDesktop->pSession->hab_list.Queue.Add(&sqMsg);
        }
     }
 
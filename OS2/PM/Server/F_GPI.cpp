@@ -20,6 +20,19 @@
 
 #define FREPM_SERVER
 
+#ifdef FREPM_SERVER
+#include "FreePMs.hpp"
+#include "Fs_WND.hpp"
+#include "Fs_HPS.hpp"
+#include "Fs_globals.hpp"
+
+/* in the server HPS is a generation-checked handle into _WndList.pPS */
+static struct F_PS *F_GetPS(HPS hps)
+{
+   return _WndList.PS(hps);
+}
+#endif  /* FREPM_SERVER */
+
 /*
  This function draws a rectangular box with the current position
  and a specified position at diagonally  opposite corners.
@@ -33,15 +46,23 @@ LONG   F_GpiBox(HPS hps,       /*  Presentation-space handle. */
                 PPOINTL pptlPoint,/*  Corner point. */
                 LONG lHRound,  /*  Corner-rounding control. */
                 LONG lVRound)  /*  Corner-rounding control. */
-{
+{  LONG rc = GPI_ERROR;
+#ifdef FREPM_SERVER
+   struct F_PS *ps = F_GetPS(hps);
+   if(ps && F_PS_GpiBox(ps, lControl, pptlPoint, lHRound, lVRound))
+      rc = GPI_OK;
+#else  /* FREPM_SERVER */
 //todo
-   return 0;
+#endif
+   return rc;
 }
 
 BOOL  F_GpiSetColor(HPS hps, LONG lColor)
-{   int rc;
+{   int rc = FALSE;
 #ifdef FREPM_SERVER
-    debug(10, 0) (__FUNCTION__ " WARNING: is not yet implemented in server mode\n");
+    struct F_PS *ps = F_GetPS(hps);
+    if(ps)
+       rc = F_PS_GpiSetColor(ps, lColor);
 
 #else  /* FREPM_SERVER */
     rc = _F_SendGenCmdDataToServer(F_CMD_GPI_SET_COLOR, hps, (void *)&lColor, 1);
@@ -59,15 +80,23 @@ LONG   F_GpiQueryColor(HPS hps)
 
 BOOL   F_GpiMove(HPS hps, PPOINTL pptlPoint)
 {   int rc = FALSE;
-    debug(10, 0) (__FUNCTION__ " WARNING: is not yet implemented in server mode\n");
+#ifdef FREPM_SERVER
+    struct F_PS *ps = F_GetPS(hps);
+    if(ps)
+       rc = F_PS_GpiMove(ps, pptlPoint);
+#else  /* FREPM_SERVER */
+    debug(10, 0) (__FUNCTION__ " WARNING: is not yet implemented in client mode\n");
+#endif
 
    return rc;
 }
 
 LONG  F_GpiLine(HPS hps,  PPOINTL pptlEndPoint)
-{   int rc = FALSE;
+{   int rc = GPI_ERROR;
 #ifdef FREPM_SERVER
-    debug(10, 0) (__FUNCTION__ " WARNING: is not yet implemented in server mode\n");
+    struct F_PS *ps = F_GetPS(hps);
+    if(ps && F_PS_GpiLine(ps, pptlEndPoint))
+       rc = GPI_OK;
 
 #else  /* FREPM_SERVER */
     rc = _F_SendGenCmdDataToServer(F_CMD_GPI_LINE, hps, (void *)pptlEndPoint, sizeof(POINTL)/sizeof(int));
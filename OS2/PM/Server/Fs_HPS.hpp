@@ -8,9 +8,25 @@
 #ifndef FREEPMS_HPS
   #define FREEPMS_HPS
 
+#ifndef GPI_OK
+  #define GPI_ERROR        0L
+  #define GPI_OK           1L
+#endif
+#ifndef DRO_FILL
+  #define DRO_FILL         1L
+  #define DRO_OUTLINE      2L
+  #define DRO_OUTLINEFILL  3L
+#endif
+
 BOOL F_PS_GpiSetColor(struct  F_PS *ps, LONG lColor);
 BOOL F_PS_GpiLine(struct  F_PS *ps, PPOINTL pptlPoint);
 BOOL F_PS_GpiMove(struct  F_PS *ps, PPOINTL pptlPoint);
+BOOL F_PS_GpiBox(struct  F_PS *ps, LONG lControl, PPOINTL pptlPoint,
+                 LONG lHRound, LONG lVRound);
+BOOL F_PS_ScrollRect(struct  F_PS *ps, PRECTL prcl, LONG dx, LONG dy, LONG lFill);
+BOOL F_PS_GpiCharString(struct  F_PS *ps, LONG lCount, PCH pchString);
+BOOL F_PS_GpiCharStringAt(struct  F_PS *ps, PPOINTL pptlPoint, LONG lCount, PCH pchString);
+void F_PS_AccelFlush(void);
 
 #endif
    /* FREEPMS_HPS */
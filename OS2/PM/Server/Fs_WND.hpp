@@ -6,6 +6,8 @@
 #ifndef FREEPMS_WND
 #define FREEPMS_WND
 
+#include "Fs_rgn.hpp"
+
 /* The Window Structure (WND) */
 /* This structure represents a window. It is created by WinCreateWindow.
     The WND has two main functions:
@@ -13,20 +15,59 @@
          It establishes the WND hierarchy.
 */
 
+/* Window, PS and DC handles are a slot index in the low FWND_INDEX_BITS
+   and the slot's generation above it. The generation moves on when the
+   slot is freed, so a stale handle stops matching instead of reaching
+   whatever took its slot. Handles stay positive and, with the
+   generation starting at 1, never equal HWND_DESKTOP or HWND_OBJECT */
+#define FWND_INDEX_BITS  16
+#define FWND_INDEX_MASK  0xFFFF
+#define FWND_GEN_MASK    0x7FFF
+#define FWND_HANDLE(gen, ind)  (((gen) << FWND_INDEX_BITS) | (ind))
+#define FWND_INDEX(h)          ((int)((ULONG)(h) & FWND_INDEX_MASK))
+#define FWND_GEN(h)            ((int)(((ULONG)(h) >> FWND_INDEX_BITS) & FWND_GEN_MASK))
+
+/* free slot stack and generations of one handle table; slot 0 is never used */
+class F_Slots
+{
+   int *gen;          /* generation of each slot */
+   int *freeStack;    /* slots given back, reused last in first out */
+   int  nFree;
+public:
+   int  n;            /* slots handed out at some time, 0 included */
+   int  nAllocated;   /* slots gen and freeStack have room for */
+
+   F_Slots(void)
+   {  gen = freeStack = NULL;
+      nFree = n = nAllocated = 0;
+   }
+   ~F_Slots()
+   {  if(gen) free(gen);
+      if(freeStack) free(freeStack);
+   }
+   int Get(void);                 /* free slot, or 0 when Grow() is due */
+   int Grow(int by);              /* new nAllocated, or 0 if out of memory or handles */
+   void Put(int ind);             /* give a slot back */
+   int Handle(int ind) { return FWND_HANDLE(gen[ind], ind); }
+   int Index(int h);              /* slot of a handle that is still current, or 0 */
+};
+
 struct WND
 {  int used;
-   int iNextSibling;   /* index of Next sibling WND */
+   int iNextSibling;   /* index of Next sibling WND (below in z-order) */
+   int iPrevSibling;   /* index of Previous sibling WND (above)        */
    int iParent;        /* index of Parent WND       */
-   int iFirstChild;    /* index of First Child WND  */
+   int iFirstChild;    /* index of First Child WND (top of z-order)    */
+   int iLastChild;     /* index of Last Child WND (bottom)             */
    int iOwner;         /* index of Owner WND        */
    int iUserId;        /* user specified id         */
 
    int pMQ;     /* ? The pointer to the MQ that will queue messages sent and posted to this window  */
-   int hwnd;    /* The windows's HWND  */
+   int hwnd;    /* The windows's HWND, i.e. generation and index  */
    int is16bit; /* ? A Boolean, which if non-zero, indicates that the window procedure address is a 16-bit far pointer  */
    int pWproc;  /* The address of the window procedure  */
    int iHab;    /* Window HAB  */
-   int iHDC;    /* Window DC   */
+   int iHDC;    /* Window DC handle  */
    int x,y,z; /* न 砫 -   㣫 */
               /* the coordinate of beginning - the left lower angle */
    int nx;    /* ࠧ  X  pixel' */
@@ -35,40 +76,52 @@ struct WND
               /* size on the Y in pixel'[akh] */
 
    int word;    /* Window word */
+
+   struct F_RGN rgnVis;    /* what shows, in screen coordinates */
+   struct F_RGN rgnUpdate; /* what shows and is not painted yet */
+   struct F_RGN rgnPaint;  /* what the PS got for painting may draw */
 };
 
 /* class F_WND_List control global WND List (array) */
+/* pWND, pPS and pDC are indexed by slot (FWND_INDEX of the handle);
+   Wnd(), PS() and DC() check a handle and find its entry in O(1). The
+   children of a window are a doubly linked sibling list in z-order.
+   Each window keeps its visible region up to date as windows move,
+   size, restack or go away; a PS draws through it with ClipPS() */
 class F_WND_List
 {
    volatile int wndAccess; /* fast access semaphor, use when pWND is realloced  */
    volatile int hpsAccess; /* fast access semaphor, use when pPS  is realloced  */
    volatile int dcAccess;  /* fast access semaphor, use when pDC  is realloced  */
-   int nAllocated;     /* Number of allocated array elements in pWND;*/
-   int nPSAllocated;   /* allocated array elements in pPS  */
-   int nDCAllocated;   /* allocated array elements in pDC  */
+   F_Slots wndSlots;
+   F_Slots psSlots;
+   F_Slots dcSlots;
+
+   void Unlink(int ind);            /* take a window out of its parent's child list */
+   void LinkAfter(int ind, int iParent, int iAfter); /* iAfter 0 - at the top */
+
+   void WndRect(int ind, PRECTL prcl);          /* in screen coordinates */
+   void Invalidate(int ind, struct F_RGN *rgn);
+   void VisCalc(int ind, int fAll);
+   void VisTree(int ind, int fAll);
+   void VisUpdate(int ind, int fAll);
+   void Uncover(int iParent, int iSkip, PRECTL prclOld, PRECTL prclNew);
 public:
-   int n;            /* Number of array elements in pWND;*/
    struct WND *pWND;
-   int iHwndCurrentDeskTop;  /* index of current desktop window */
+   int iHwndCurrentDeskTop;  /* handle of current desktop window */
 
-   int numPS;        /* number of PS */
    F_PS  *pPS;       /* array of PS structures */
 
-   int numDC;        /* number of F_DC */
    F_DC  *pDC;       /* array of FDC structures */
 
    F_WND_List(void)
-   {  n = nAllocated = 0;
-      pWND = NULL;
+   {  pWND = NULL;
       pDC  = NULL;
       pPS  = NULL;
       wndAccess = UNLOCKED;
       hpsAccess = UNLOCKED;
       dcAccess = UNLOCKED;
       iHwndCurrentDeskTop = 0;
-      numPS = nPSAllocated = 0;
-      numDC = nDCAllocated = 0;
-
    }
    ~F_WND_List()
    {  if(pDC)
@@ -78,10 +131,27 @@ public:
       { free(pPS);
       }
       if(pWND)
-      { free(pWND);
+      { for(int i = 1; i < wndSlots.n; i++)
+        {  if(!pWND[i].used) continue;
+           F_RgnFree(&pWND[i].rgnVis);
+           F_RgnFree(&pWND[i].rgnUpdate);
+           F_RgnFree(&pWND[i].rgnPaint);
+        }
+        free(pWND);
       }
    }
 
+   int WndIndex(int iHWND);   /* slot of a live window, 0 if none; HWND_DESKTOP allowed */
+   struct WND *Wnd(int iHWND) { int i = WndIndex(iHWND); return i ? &pWND[i] : NULL; }
+   struct F_PS *PS(HPS hps)
+   {  int i = psSlots.Index(hps);
+      return i && pPS[i].used ? &pPS[i] : NULL;
+   }
+   struct F_DC *DC(HDC hdc)
+   {  int i = dcSlots.Index(hdc);
+      return i && pDC[i].used ? &pDC[i] : NULL;
+   }
+
    int Add(int _ihab); /*   */
    int Del(int iHWND); /* 㤠   */
    int Query(int iHWND);
@@ -95,6 +165,11 @@ public:
    /* ⠭  */
    int WinSetWindowPos(int iHWND, int hwndInsertBehind, int x, int y, int nx, int ny, int flStyle);
 
+   /* Drawing of a PS, prcl in screen coordinates */
+   int ClipPS(struct F_PS *ps, PRECTL prcl, int (*pfn)(PRECTL prcl, void *pData), void *pData);
+   int PSRectVisible(struct F_PS *ps, PRECTL prcl);
+   void PSInvalidate(struct F_PS *ps, PRECTL prcl);
+
 };
 
 #endif
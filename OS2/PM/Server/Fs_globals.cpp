@@ -32,6 +32,8 @@ int _FreePM_detachedMode = 0;
 */
 
 PFPM_DeviceStart_FN FPM_DeviceStart;
+PFPM_DeviceQueryAccel_FN FPM_DeviceQueryAccel = NULL;
+PFPM_ACCEL FPM_Accel = NULL;
 
 /* debug support */
 extern "C" int _FreePM_db_level    = 7;
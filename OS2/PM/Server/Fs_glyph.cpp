@@ -0,0 +1,79 @@
+/* Fs_glyph.cpp */
+/* glyph cache of the FreePM server */
+/* DEBUG: section 10    GPI functions of FreePM */
+
+#include <malloc.h>
+#include <memory.h>
+#include "FreePM.hpp"
+#include "Fs_driver.h"
+#include "Fs_glyph.hpp"
+
+#define F_GLYPH_HASH      512
+#define F_GLYPH_MAXBYTES  (256 * 1024)  /* masks kept before starting over */
+
+static struct F_GLYPH *apGlyph[F_GLYPH_HASH];
+static long cbGlyphs = 0;
+
+static int GlyphHash(int font, int size, int ch)
+{
+   return (ch + font * 31 + size * 257) & (F_GLYPH_HASH - 1);
+}
+
+void F_GlyphFlush(void)
+{  struct F_GLYPH *p, *pNext;
+   int i;
+
+   for(i = 0; i < F_GLYPH_HASH; i++)
+   {  for(p = apGlyph[i]; p; p = pNext)
+      {  pNext = p->pNext;
+         if(p->pMask)
+            free(p->pMask);
+         free(p);
+      }
+      apGlyph[i] = NULL;
+   }
+   cbGlyphs = 0;
+}
+
+struct F_GLYPH *F_GlyphGet(PFPM_ACCEL pAccel, int font, int size, int ch)
+{  struct F_GLYPH *p;
+   int h = GlyphHash(font, size, ch), cb;
+
+   for(p = apGlyph[h]; p; p = p->pNext)
+   {  if(p->ch == ch && p->font == font && p->size == size)
+         return p;
+   }
+
+   /* text in a few fonts needs a few hundred glyphs; when the cache
+      has grown past that it is cheaper to start again than to age it */
+   if(cbGlyphs > F_GLYPH_MAXBYTES)
+      F_GlyphFlush();
+
+   if((p = (struct F_GLYPH *)calloc(1, sizeof(struct F_GLYPH))) == NULL)
+      return NULL;
+   p->font = font;
+   p->size = size;
+   p->ch = ch;
+   /* a blank like the space may have no mask, only a dx */
+   if(pAccel->Glyph == NULL || !pAccel->Glyph(font, size, ch, &p->g, NULL, 0))
+      memset((void *)&p->g, 0, sizeof(p->g));
+   else if(p->g.cx > 0 && p->g.cy > 0)
+   {  cb = p->g.cx * p->g.cy;
+      if((p->pMask = (unsigned char *)malloc(cb)) == NULL)
+      {  free(p);
+         return NULL;
+      }
+      if(pAccel->Glyph(font, size, ch, &p->g, p->pMask, cb))
+         cbGlyphs += cb;
+      else
+      {  free(p->pMask);
+         p->pMask = NULL;
+         memset((void *)&p->g, 0, sizeof(p->g)); /* draws nothing, does not move */
+      }
+   }
+   cbGlyphs += sizeof(struct F_GLYPH);
+
+   p->pNext = apGlyph[h];
+   apGlyph[h] = p;
+   return p;
+}
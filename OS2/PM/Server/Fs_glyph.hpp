@@ -0,0 +1,22 @@
+/* Fs_glyph.hpp */
+/* glyph cache of the FreePM server */
+
+#ifndef FREEPMS_GLYPH
+  #define FREEPMS_GLYPH
+
+/* Glyph masks got from the display driver, kept by (font, size, char)
+   so that text is not rasterized again on every repaint. A character
+   the driver has no glyph for is kept too, with no mask. */
+struct F_GLYPH
+{  int font, size, ch;
+   FPM_GLYPH g;
+   unsigned char *pMask;      /* g.cx * g.cy bytes, NULL if none */
+   struct F_GLYPH *pNext;     /* hash chain */
+};
+
+/* NULL only when out of memory; called with the driver lock held */
+struct F_GLYPH *F_GlyphGet(PFPM_ACCEL pAccel, int font, int size, int ch);
+void F_GlyphFlush(void);
+
+#endif
+   /* FREEPMS_GLYPH */
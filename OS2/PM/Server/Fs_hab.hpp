@@ -8,6 +8,68 @@
 #ifndef FREEPMS_HAB
   #define FREEPMS_HAB
 
+/*************************************************/
+/* Server message queues (Fs_queue.cpp)          */
+
+/* The messages for one iHAB: a bounded ring that any server thread
+   may post to.  A slot's seq says whose turn it is: seq == pos means
+   free for the writer claiming pos, seq == pos+1 means filled for the
+   reader at pos.  head and tail are claimed with lock cmpxchg, so
+   neither side ever waits for the other.
+
+   WM_MOUSEMOVE, WM_PAINT and WM_TIMER do not go into the ring but are
+   set aside under lockPend, as PM does: a move replaces the move not
+   yet read, and there is at most one WM_PAINT per window and one
+   WM_TIMER per window and timer id.  The move goes into the ring ahead
+   of the next other message, so input keeps its order; paints and then
+   timers are handed out only when the ring is empty.  The area to paint
+   is the window's update region, which the server unions. */
+
+#define FSQ_NPAINT   32     /* windows with a WM_PAINT set aside */
+#define FSQ_NTIMER   16     /* timers with a WM_TIMER set aside  */
+
+struct Fs_HabRing
+{
+   volatile ULONG head;                 /* next slot to fill     */
+   volatile ULONG tail;                 /* next slot to read     */
+   volatile ULONG seq[MAX_SQMSG_SIZE];
+   SQMSG   msg[MAX_SQMSG_SIZE];
+   HEV     hev;                         /* posted on every Add   */
+
+   volatile ULONG lockPend;
+   volatile int nPend;                  /* messages set aside    */
+   int     fMove;                       /* msgMove is set        */
+   SQMSG   msgMove;
+   int     nPaint;
+   SQMSG   msgPaint[FSQ_NPAINT];
+   int     nTimer;
+   SQMSG   msgTimer[FSQ_NTIMER];
+};
+
+#define FSQ_CHUNK    64     /* rings per directory chunk        */
+#define FSQ_DIRSIZE  256    /* chunks, so up to 16384 iHABs     */
+
+/* one ring per iHAB, created on first use; the directory only grows,
+   so a ring once found stays valid */
+class Fs_HabQueue
+{
+   Fs_HabRing ** volatile dir[FSQ_DIRSIZE];
+
+   Fs_HabRing *Ring(int iHab, int create);
+
+public:
+   Fs_HabQueue(void)
+   {  int i;
+      for(i = 0; i < FSQ_DIRSIZE; i++) dir[i] = NULL;
+   }
+   ~Fs_HabQueue(void);
+
+   int Add(PSQMSG pmsg);
+   int GetForIhab(PSQMSG pmsg, int iHab);
+   int WaitForIhab(int iHab, ULONG ms);
+   int QueryNmsg(int ihabto);
+};
+
 /*************************************************/
 /* Server side */
 struct _FreePM_HABserverinf
@@ -26,7 +88,7 @@ class _FreePM_HAB_serverlist
    struct _FreePM_HABserverinf *pHabSvrInf;
    volatile int Access;      /* fast access semaphor  */
 public:
-   Fs_Queue Queue;  /* server master queue */
+   Fs_HabQueue Queue;  /* server queues, one per iHAB */
 public:
    _FreePM_HAB_serverlist(void)
    { n = nAlloced = 0;
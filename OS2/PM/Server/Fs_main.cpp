@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <float.h>
+#include <limits.h>
 #include <time.h>
 
 #include "FreePM.hpp"
@@ -24,6 +25,8 @@
 #include "F_hab.hpp"
 #include "Fs_config.hpp"
 #include "Fs_driver.h"
+#include "Fs_glyph.hpp"
+#include <builtin.h>
 
 //#include <sys/time.h>
 #include "F_utils.hpp"
@@ -177,6 +180,10 @@ int main(int narg, char *arg[], char *envp[])
       exit(1);
     };
     debug(1, 0) ("Address found\n");
+    /* optional, NULL if the driver draws no accelerated primitives */
+    if (DosQueryProcAddr(hDeviceLib, 0, "FPM_DeviceQueryAccel",
+                        (PFN*)&FPM_DeviceQueryAccel))
+      FPM_DeviceQueryAccel = NULL;
 
   } else {
     debug(1, 0) ("Error loading driver module\n");
@@ -303,24 +310,361 @@ extern HPS     hpsDrawBMPBuffer = NULLHANDLE;
 
 
 // This functions must draw into bitmap which painted on WM_PAINT event
+// When the driver exports accelerated primitives they draw through those
+
+static volatile int accelAccess = UNLOCKED; /* driver calls are not reentrant */
+static int accelDirty = 0;                  /* drawn since the last Present */
+
+static void F_AccelLock(void)
+{   int ilps_raz = 0, ilps_rc;
+    do
+    {  ilps_rc =  __lxchg(&accelAccess,LOCKED);
+       if(ilps_rc)
+       { if(++ilps_raz  < 3)  DosSleep(0);
+          else                DosSleep(1);
+       }
+    } while(ilps_rc);
+}
+
+static void F_AccelUnlock(void)
+{   __lxchg(&accelAccess,UNLOCKED);
+}
+
+/* The driver fills its table in once FPM_DeviceStart has set the
+   display up, so keep asking until it is there */
+static PFPM_ACCEL F_GetAccel(void)
+{
+  if(FPM_Accel == NULL && FPM_DeviceQueryAccel != NULL)
+  {  FPM_Accel = FPM_DeviceQueryAccel();
+     if(FPM_Accel && FPM_Accel->cb < sizeof(FPM_ACCEL))
+        FPM_Accel = NULL;  /* older table layout */
+     if(FPM_Accel)
+        debug(10, 1) ("Accelerated drawing %ix%i%s\n", FPM_Accel->cx, FPM_Accel->cy,
+                      (FPM_Accel->fl & FPM_ACCEL_HW) ? " (hardware)" : "");
+  }
+  return FPM_Accel;
+}
+
+struct F_FILL
+{ PFPM_ACCEL pAccel;
+  unsigned long color;
+};
+
+/* one visible piece of a box, flipped to device coordinates (origin top left) */
+static int F_PS_FillPiece(PRECTL prcl, void *pData)
+{ struct F_FILL *f = (struct F_FILL *)pData;
+
+  return f->pAccel->FillRect(prcl->xLeft, f->pAccel->cy - prcl->yTop,
+                             prcl->xRight - prcl->xLeft, prcl->yTop - prcl->yBottom,
+                             f->color);
+}
+
+/* Fill a box given by inclusive corners in PS coordinates: clip to the PS,
+   then to what of its window shows, before anything is drawn */
+static BOOL F_PS_FillBox(struct  F_PS *ps, LONG x1, LONG y1, LONG x2, LONG y2)
+{ PFPM_ACCEL pAccel = F_GetAccel();
+  struct F_FILL fill;
+  RECTL rcl;
+  LONG t;
+
+  if(pAccel == NULL)
+     return FALSE;
+
+  if(x1 > x2) { t = x1; x1 = x2; x2 = t; }
+  if(y1 > y2) { t = y1; y1 = y2; y2 = t; }
+  if(x1 < 0) x1 = 0;
+  if(y1 < 0) y1 = 0;
+  if(x2 >= ps->nx) x2 = ps->nx - 1;
+  if(y2 >= ps->ny) y2 = ps->ny - 1;
+  if(x1 > x2 || y1 > y2)
+     return TRUE; /* clipped away */
+
+  rcl.xLeft   = ps->x0 + x1;
+  rcl.yBottom = ps->y0 + y1;
+  rcl.xRight  = ps->x0 + x2 + 1;
+  rcl.yTop    = ps->y0 + y2 + 1;
+  fill.pAccel = pAccel;
+  fill.color  = (unsigned long)ps->color;
+
+  F_AccelLock();
+  if(_WndList.ClipPS(ps, &rcl, F_PS_FillPiece, &fill))
+     accelDirty = 1;
+  F_AccelUnlock();
+  return TRUE;
+}
+
+/* Show what was drawn. Called when a client asks for its next message,
+   i.e. is done painting for now - one flip per burst, not per primitive */
+void F_PS_AccelFlush(void)
+{
+  if(!accelDirty || FPM_Accel == NULL)
+     return;
+  F_AccelLock();
+  accelDirty = 0;
+  FPM_Accel->Present();
+  F_AccelUnlock();
+}
+
 BOOL F_PS_GpiSetColor(struct  F_PS *ps, LONG lColor)
 {
   //GpiSetColor(hpsDrawBMPBuffer, lColor);
-  return 0;
+  ps->color = lColor;
+  return TRUE;
 }
 
+/* Line from the current position, which moves to the end point */
 BOOL F_PS_GpiLine(struct  F_PS *ps, PPOINTL pptlPoint)
-{
-  POINTL ptl[4] = { 0, 0, 100, 100, 0, 100, 100, 0 };
+{ LONG x = ps->x, y = ps->y;
+  LONG x1 = pptlPoint->x, y1 = pptlPoint->y;
+  LONG dx = labs(x1 - x), dy = labs(y1 - y);
+  LONG sx = x < x1 ? 1 : -1, sy = y < y1 ? 1 : -1;
+  LONG err, run;
+  BOOL rc = TRUE;
+
   //GpiLine(hpsDrawBMPBuffer, pptlPoint);
-  return 0;
+  if(F_GetAccel() == NULL)
+     return FALSE;
+
+  ps->x = x1;
+  ps->y = y1;
+
+  if(dx == 0 || dy == 0)
+     return F_PS_FillBox(ps, x, y, x1, y1);
+
+  /* Bresenham, filling each run along the major axis in one call */
+  if(dx >= dy)
+  {  err = dx / 2;
+     for(run = x; rc; x += sx)
+     {  if(x == x1)
+        {  rc = F_PS_FillBox(ps, run, y, x, y);
+           break;
+        }
+        err -= dy;
+        if(err < 0)
+        {  rc = F_PS_FillBox(ps, run, y, x, y);
+           y += sy;
+           err += dx;
+           run = x + sx;
+        }
+     }
+  } else {
+     err = dy / 2;
+     for(run = y; rc; y += sy)
+     {  if(y == y1)
+        {  rc = F_PS_FillBox(ps, x, run, x, y);
+           break;
+        }
+        err -= dx;
+        if(err < 0)
+        {  rc = F_PS_FillBox(ps, x, run, x, y);
+           x += sx;
+           err += dy;
+           run = y + sy;
+        }
+     }
+  }
+  return rc;
 }
 
 BOOL F_PS_GpiMove(struct  F_PS *ps, PPOINTL pptlPoint)
 {
-  POINTL ptl[4] = { 0, 0, 100, 100, 0, 100, 100, 0 };
   //GpiMove(hpsDrawBMPBuffer, pptlPoint);
-  return 0;
+  ps->x = pptlPoint->x;
+  ps->y = pptlPoint->y;
+  return TRUE;
+}
+
+/* Box between the current position and pptlPoint; the current position
+   does not change. Corner rounding is not done yet - boxes are square */
+BOOL F_PS_GpiBox(struct  F_PS *ps, LONG lControl, PPOINTL pptlPoint,
+                 LONG lHRound, LONG lVRound)
+{ LONG x1 = ps->x, y1 = ps->y;
+  LONG x2 = pptlPoint->x, y2 = pptlPoint->y;
+
+  switch(lControl)
+  {  case DRO_FILL:
+     case DRO_OUTLINEFILL: /* the outline has the fill color too */
+        return F_PS_FillBox(ps, x1, y1, x2, y2);
+     case DRO_OUTLINE:
+        return F_PS_FillBox(ps, x1, y1, x2, y1) &&
+               F_PS_FillBox(ps, x1, y2, x2, y2) &&
+               F_PS_FillBox(ps, x1, y1, x1, y2) &&
+               F_PS_FillBox(ps, x2, y1, x2, y2);
+  }
+  return FALSE;
+}
+
+/* Scroll the PS rectangle prcl (exclusive top right, as in WinScrollWindow)
+   by dx, dy and fill what it uncovers with lFill. A full-screen VIO window
+   scrolls with one driver call instead of redrawing every cell */
+BOOL F_PS_ScrollRect(struct  F_PS *ps, PRECTL prcl, LONG dx, LONG dy, LONG lFill)
+{ PFPM_ACCEL pAccel = F_GetAccel();
+  RECTL rcl = *prcl;
+
+  if(pAccel == NULL)
+     return FALSE;
+
+  if(rcl.xLeft < 0) rcl.xLeft = 0;
+  if(rcl.yBottom < 0) rcl.yBottom = 0;
+  if(rcl.xRight > ps->nx) rcl.xRight = ps->nx;
+  if(rcl.yTop > ps->ny) rcl.yTop = ps->ny;
+  if(rcl.xLeft >= rcl.xRight || rcl.yBottom >= rcl.yTop)
+     return TRUE;
+
+  /* screen coordinates from here on */
+  rcl.xLeft   += ps->x0;
+  rcl.xRight  += ps->x0;
+  rcl.yBottom += ps->y0;
+  rcl.yTop    += ps->y0;
+  /* a partly hidden rectangle would drag hidden pixels into view:
+     have it painted instead */
+  if(!_WndList.PSRectVisible(ps, &rcl))
+  {  _WndList.PSInvalidate(ps, &rcl);
+     return TRUE;
+  }
+
+  F_AccelLock();
+  /* PM y grows upwards, device y downwards */
+  pAccel->Scroll(rcl.xLeft, pAccel->cy - rcl.yTop,
+                 rcl.xRight - rcl.xLeft, rcl.yTop - rcl.yBottom,
+                 dx, -dy, (unsigned long)lFill);
+  accelDirty = 1;
+  F_AccelUnlock();
+  return TRUE;
+}
+
+
+struct F_TEXT
+{ PFPM_ACCEL pAccel;
+  unsigned long color;
+  unsigned char *pMask;     /* the whole run, top row first */
+  int stride;
+  LONG xLeft, yTop;         /* screen position of its top left corner */
+};
+
+/* one visible piece of a text run */
+static int F_PS_TextPiece(PRECTL prcl, void *pData)
+{ struct F_TEXT *t = (struct F_TEXT *)pData;
+  PFPM_ACCEL pAccel = t->pAccel;
+  unsigned char *pRow;
+  int cx = prcl->xRight - prcl->xLeft, cy = prcl->yTop - prcl->yBottom;
+  int y = pAccel->cy - prcl->yTop;
+  int i, j, run;
+
+  pRow = t->pMask + (t->yTop - prcl->yTop) * t->stride + (prcl->xLeft - t->xLeft);
+  if(pAccel->BlendMask)
+     return pAccel->BlendMask(prcl->xLeft, y, cx, cy, pRow, t->stride, t->color);
+
+  /* the driver cannot blend: fill what is more than half covered */
+  for(i = 0; i < cy; i++, pRow += t->stride)
+  {  for(j = 0; j < cx; )
+     {  if(pRow[j] < 128)
+        {  j++;
+           continue;
+        }
+        for(run = j; j < cx && pRow[j] >= 128; j++)
+           ;
+        pAccel->FillRect(prcl->xLeft + run, y + i, j - run, 1, t->color);
+     }
+  }
+  return 1;
+}
+
+#define F_TEXT_RUN  128   /* characters put together at a time */
+
+/* Characters from the current position along the baseline, which moves
+   on past them. The cached glyphs of a run are put together into one
+   mask first, so the driver is called once per visible piece of the
+   string, not once per character */
+BOOL F_PS_GpiCharString(struct  F_PS *ps, LONG lCount, PCH pchString)
+{ PFPM_ACCEL pAccel = F_GetAccel();
+  struct F_GLYPH *apg[F_TEXT_RUN];
+  struct F_TEXT text;
+  PFPM_GLYPH g;
+  RECTL rcl;
+  LONG xMin, xMax, yMin, yMax, x, l;
+  int i, n, row, col, r, c;
+  unsigned char *pDst, *pSrc;
+  BOOL rc = TRUE;
+
+  if(pAccel == NULL || pAccel->Glyph == NULL || lCount < 0)
+     return FALSE;
+
+  text.pAccel = pAccel;
+  text.color  = (unsigned long)ps->color;
+  for( ; rc && lCount > 0; lCount -= n, pchString += n)
+  {  n = lCount > F_TEXT_RUN ? F_TEXT_RUN : (int)lCount;
+
+     F_AccelLock();
+     /* where the masks go, relative to the pen and the baseline */
+     xMin = yMin = LONG_MAX;
+     xMax = yMax = LONG_MIN;
+     for(i = 0, x = 0; i < n; i++)
+     {  if((apg[i] = F_GlyphGet(pAccel, FPM_FONT_DEFAULT, FPM_FONT_DEFAULT,
+                                (unsigned char)pchString[i])) == NULL)
+        {  rc = FALSE;
+           break;
+        }
+        g = &apg[i]->g;
+        if(apg[i]->pMask)
+        {  if(x + g->xOrg < xMin) xMin = x + g->xOrg;
+           if(x + g->xOrg + g->cx > xMax) xMax = x + g->xOrg + g->cx;
+           if(g->yOrg > yMax) yMax = g->yOrg;
+           if(g->yOrg - g->cy < yMin) yMin = g->yOrg - g->cy;
+        }
+        x += g->dx;
+     }
+
+     text.pMask = NULL;
+     if(rc && xMin < xMax)
+     {  text.stride = (int)(xMax - xMin);
+        if((text.pMask = (unsigned char *)calloc(text.stride, yMax - yMin)) == NULL)
+           rc = FALSE;
+     }
+     if(text.pMask)
+     {  for(i = 0, x = 0; i < n; x += apg[i]->g.dx, i++)
+        {  if((pSrc = apg[i]->pMask) == NULL)
+              continue;
+           g = &apg[i]->g;
+           row = (int)(yMax - g->yOrg);
+           col = (int)(x + g->xOrg - xMin);
+           for(r = 0; r < g->cy; r++)
+           {  pDst = text.pMask + (row + r) * text.stride + col;
+              for(c = 0; c < g->cx; c++, pSrc++)
+                 if(*pSrc > pDst[c])    /* glyphs may overlap */
+                    pDst[c] = *pSrc;
+           }
+        }
+
+        text.xLeft = ps->x0 + ps->x + xMin;
+        text.yTop  = ps->y0 + ps->y + yMax;
+        rcl.xLeft   = text.xLeft;
+        rcl.xRight  = text.xLeft + text.stride;
+        rcl.yTop    = text.yTop;
+        rcl.yBottom = text.yTop - (yMax - yMin);
+        /* clip to the PS, then to what of its window shows */
+        if(rcl.xLeft < ps->x0) rcl.xLeft = ps->x0;
+        if(rcl.yBottom < ps->y0) rcl.yBottom = ps->y0;
+        if(rcl.xRight > ps->x0 + ps->nx) rcl.xRight = ps->x0 + ps->nx;
+        if(rcl.yTop > ps->y0 + ps->ny) rcl.yTop = ps->y0 + ps->ny;
+        if(rcl.xLeft < rcl.xRight && rcl.yBottom < rcl.yTop &&
+           _WndList.ClipPS(ps, &rcl, F_PS_TextPiece, &text))
+           accelDirty = 1;
+        free(text.pMask);
+     }
+     F_AccelUnlock();
+
+     if(rc)
+        ps->x += x;
+  }
+  return rc;
+}
+
+BOOL F_PS_GpiCharStringAt(struct  F_PS *ps, PPOINTL pptlPoint, LONG lCount, PCH pchString)
+{
+  ps->x = pptlPoint->x;
+  ps->y = pptlPoint->y;
+  return F_PS_GpiCharString(ps, lCount, pchString);
 }
 
 
@@ -406,18 +750,31 @@ void handler (ULONG obj, int ncmd, int data, int threadNum)
              int nmsg=0;
              int ihabto;
              ihabto = data;
+             F_PS_AccelFlush(); /* client is done drawing for now */
              nmsg = session.hab_list.Queue.QueryNmsg(ihabto);
              if (nmsg)
                 debug(0, 2) ("Fs_ClientWork: F_CMD_WINQUERY_MSG, nmsg=%i\n",nmsg);
              rc = F_SendDataToClient(obj, &nmsg , sizeof(int));
           }
            break;
+        case F_CMD_WINWAIT_MSG: /* Wait for messages for ihab = data */
+          {
+             int nmsg=0;
+             int ihabto;
+             ihabto = data;
+             F_PS_AccelFlush(); /* client is done drawing for now */
+             /* this thread serves only this client, so it may block */
+             nmsg = session.hab_list.Queue.WaitForIhab(ihabto, FREEPMS_MSG_WAIT);
+             rc = F_SendDataToClient(obj, &nmsg , sizeof(int));
+          }
+           break;
         case F_CMD_WINGET_MSG:  /* Get message for ihab = data */
           { 
             SQMSG sqmsg;
             int rc, ihabto;
             int nmsg=0;
             ihabto = data;
+            F_PS_AccelFlush();
             rc = session.hab_list.Queue.GetForIhab(&sqmsg, ihabto);
             if (rc == 0) nmsg = 1;
 
@@ -472,18 +829,20 @@ void handler (ULONG obj, int ncmd, int data, int threadNum)
           {   HWND hwnd = data;
               int par[2],rc1;
               rc = F_RecvDataFromClient(obj, (void *)&par[0], &len, sizeof(int)*2);
-              rc1 = 0;
-              //todo
+              rc1 = 1;
+              if(rc == 0 && len == sizeof(int)*2)
+                 rc1 = _WndList.WinSetWindowPos(hwnd, 0, 0, 0, par[0], par[1], SWP_SIZE);
               rc=  F_SendDataToClient(obj, &rc1, sizeof(int));
           }
            break;
 
-        case F_CMD_WIN_SET_WND_POS:
+        case F_CMD_WIN_SET_WND_POS: /* hwndInsertBehind, x, y, cx, cy, fl */
           {   HWND hwnd = data;
-              int par[2],rc1;
-              rc = F_RecvDataFromClient(obj, (void *)&par[0], &len, sizeof(int)*2);
-              rc1 = 0;
-              //todo
+              int par[6],rc1;
+              rc = F_RecvDataFromClient(obj, (void *)&par[0], &len, sizeof(int)*6);
+              rc1 = 1;
+              if(rc == 0 && len == sizeof(int)*6)
+                 rc1 = _WndList.WinSetWindowPos(hwnd, par[0], par[1], par[2], par[3], par[4], par[5]);
               rc=  F_SendDataToClient(obj, &rc1, sizeof(int));
           }
            break;
@@ -512,11 +871,9 @@ void handler (ULONG obj, int ncmd, int data, int threadNum)
               hps = data;
               rc = F_RecvDataFromClient(obj, (void *)&color, &len, sizeof(int));
               debug(0, 0) ("F_CMD_GPI_SET_COLOR: get hps=%x, color=%x, len=%i\n",hps,color,len);
-              if(hps >= 0 && hps < _WndList.numPS)
-              {  if(_WndList.pPS[hps].used)
-                                        /* rc1 = F_GpiSetColor(&_WndList.pPS[hps], color); */
-                     rc1 = F_PS_GpiSetColor(&_WndList.pPS[hps], color);
-              }
+              if(_WndList.PS(hps))
+                                        /* rc1 = F_GpiSetColor(_WndList.PS(hps), color); */
+                     rc1 = F_PS_GpiSetColor(_WndList.PS(hps), color);
               rc=  F_SendDataToClient(obj, &rc1, sizeof(int));
           }
            break;
@@ -528,10 +885,8 @@ void handler (ULONG obj, int ncmd, int data, int threadNum)
               rc = F_RecvDataFromClient(obj, (void *)&Point, &len, sizeof(POINTL));
               debug(0, 0) ("F_CMD_GPI_MOVE: get hps=%x,len=%i\n",hps,len);
 
-              if(hps >= 0 && hps < _WndList.numPS)
-              {  if(_WndList.pPS[hps].used)
-                    rc1 = F_PS_GpiMove(&_WndList.pPS[hps], &Point);
-              }
+              if(_WndList.PS(hps))
+                    rc1 = F_PS_GpiMove(_WndList.PS(hps), &Point);
               rc=  F_SendDataToClient(obj, &rc1, sizeof(int));
           }
            break;
@@ -542,9 +897,68 @@ void handler (ULONG obj, int ncmd, int data, int threadNum)
               hps = data;
               rc = F_RecvDataFromClient(obj, (void *)&Point, &len, sizeof(POINTL));
 
-              if(hps >= 0 && hps < _WndList.numPS)
-              {  if(_WndList.pPS[hps].used)
-                    rc1 = F_PS_GpiLine(&_WndList.pPS[hps], &Point);
+              if(_WndList.PS(hps))
+                    rc1 = F_PS_GpiLine(_WndList.PS(hps), &Point);
+              rc=  F_SendDataToClient(obj, &rc1, sizeof(int));
+          }
+           break;
+        case F_CMD_GPI_BATCH:
+          {   HPS hps;
+              int rc1=FALSE, i, n;
+              int ops[F_GPI_BATCH_LEN]; /* 4K, the threads have 64K stacks */
+              struct F_PS *ps = NULL;
+              POINTL Point;
+              hps = data;
+              rc = F_RecvDataFromClient(obj, (void *)ops, &len, sizeof(ops));
+              n = len / sizeof(int);
+              debug(0, 9) ("F_CMD_GPI_BATCH: get hps=%x, %i ints\n",hps,n);
+
+              if((ps = _WndList.PS(hps)) != NULL)
+                 rc1 = (rc == 0);
+              /* run the records in order; stop at the first bad one */
+              for(i = 0; ps && rc1 && i < n; )
+              {  switch(ops[i])
+                 {  case F_GPI_OP_SET_COLOR:
+                       if(i + 2 > n) { rc1 = FALSE; break; }
+                       rc1 = F_PS_GpiSetColor(ps, ops[i+1]);
+                       i += 2;
+                       break;
+                    case F_GPI_OP_MOVE:
+                    case F_GPI_OP_LINE:
+                       if(i + 3 > n) { rc1 = FALSE; break; }
+                       Point.x = ops[i+1];
+                       Point.y = ops[i+2];
+                       if(ops[i] == F_GPI_OP_MOVE)
+                          rc1 = F_PS_GpiMove(ps, &Point);
+                       else
+                          rc1 = F_PS_GpiLine(ps, &Point);
+                       i += 3;
+                       break;
+                    case F_GPI_OP_BOX:
+                       if(i + 6 > n) { rc1 = FALSE; break; }
+                       Point.x = ops[i+2];
+                       Point.y = ops[i+3];
+                       rc1 = F_PS_GpiBox(ps, ops[i+1], &Point, ops[i+4], ops[i+5]);
+                       i += 6;
+                       break;
+                    case F_GPI_OP_CHARSTR:
+                       if(i + 2 > n || ops[i+1] < 0 ||
+                          ops[i+1] > (n - i - 2) * 4) { rc1 = FALSE; break; }
+                       rc1 = F_PS_GpiCharString(ps, ops[i+1], (PCH)&ops[i+2]);
+                       i += 2 + (ops[i+1] + 3) / 4;
+                       break;
+                    case F_GPI_OP_CHARSTR_AT:
+                       if(i + 4 > n || ops[i+3] < 0 ||
+                          ops[i+3] > (n - i - 4) * 4) { rc1 = FALSE; break; }
+                       Point.x = ops[i+1];
+                       Point.y = ops[i+2];
+                       rc1 = F_PS_GpiCharStringAt(ps, &Point, ops[i+3], (PCH)&ops[i+4]);
+                       i += 4 + (ops[i+3] + 3) / 4;
+                       break;
+                    default:
+                       rc1 = FALSE;
+                       break;
+                 }
               }
               rc=  F_SendDataToClient(obj, &rc1, sizeof(int));
           }
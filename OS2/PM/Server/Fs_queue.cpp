@@ -2,130 +2,244 @@
  $Id: Fs_queue.cpp,v 1.2 2002/09/10 10:22:53 evgen2 Exp $
 */
 /* F_messages.cpp  */
-/* class  FreePM_Queue stuff */
+/* class  Fs_HabQueue stuff: server message queues, one ring per iHAB */
 /* ver 0.01 10.09.2002       */
+#include <malloc.h>
+#include <time.h>
 #include <builtin.h>
 
 #include "FreePM.hpp"
 
 #include "Fs_queue.hpp"
+#include "Fs_hab.hpp"
 
-/* Add message to queue */
-/* rc = 0 - Ok
-   rc = 1 - No space left
-   rc = 2 - pmsg is NULL
-   rc = 3 - First message was overwrited for circle queue
-*/
-int Fs_Queue::Add(PSQMSG pmsg)
-{   int ind,rc=0,rcS;
-    if(pmsg == NULL)
-           return 2;
-#if USE_CIRCLE_QUEUES
-   do
-   {  rcS =  __lxchg(&Access,LOCKED);
-      if(rcS) DosSleep(0);
-   } while(rcS);     //  
-
-    ind = (start + length) % lQueuesize;
-    queue[ind] = *pmsg;
-    if(length < lQueuesize)
-              length++;
-    else
-              rc = 3;
-#else
-    if(length >= lQueuesize)
-              return 1;  /* No space left */
-   do
-   {  rcS =  __lxchg(&Access,LOCKED);
-      if(rcS) DosSleep(0);
-   } while(rcS);     //  
-
-    ind = (start + length) % lQueuesize;
-    queue[ind] = *pmsg;
-    length++;
-#endif
-
-    __lxchg(&Access,UNLOCKED);
-
-    return rc;
+/* builtin.h's __lxchg is not atomic, so take the real instructions */
+ULONG QCmpXchg(volatile ULONG *p, ULONG ulOld, ULONG ulNew);
+#pragma aux QCmpXchg = \
+  "lock cmpxchg [edx], ecx" \
+  parm [edx] [eax] [ecx] \
+  value [eax] \
+  modify exact [eax];
+
+/* xchg is locked, so it also keeps the message copy ahead of the store */
+ULONG QXchg(volatile ULONG *p, ULONG ul);
+#pragma aux QXchg = \
+  "xchg [edx], eax" \
+  parm [edx] [eax] \
+  value [eax] \
+  modify exact [eax];
+
+Fs_HabQueue::~Fs_HabQueue(void)
+{  int i, j;
+   Fs_HabRing *r;
+
+   for(i = 0; i < FSQ_DIRSIZE; i++)
+   {  if(dir[i] == NULL)
+         continue;
+      for(j = 0; j < FSQ_CHUNK; j++)
+      {  if((r = dir[i][j]) != NULL)
+         {  DosCloseEventSem(r->hev);
+            free(r);
+         }
+      }
+      free(dir[i]);
+      dir[i] = NULL;
+   }
 }
-/* Delete message index ind from queue */
-/* rc = 0 - Ok
-   rc = 1 - no message (bad ind)
-*/
-int Fs_Queue::Del(int ind)
-{   int i,l, i_ind,i_ind1,rcS;
-    if(length == 0)
-             return 1;
-   do
-   {  rcS =  __lxchg(&Access,LOCKED);
-      if(rcS) DosSleep(0);
-   } while(rcS);     //  
-
-   if(ind == start)
-   {  length--;
-      start = (start + 1) % lQueuesize;
-   } else {
-      if(ind < start)
-           l = ind + lQueuesize - start;
-      else
-           l = ind - start;
-      for(i=0;i < l; i++)
-      {  i_ind  = (ind + i)   % lQueuesize;
-         i_ind1 = (ind + i+1) % lQueuesize;
-         queue[i_ind] = queue[i_ind1];
+
+/* Find the ring for iHab, creating it if asked to. Two threads may
+   race to create a chunk or ring; the loser frees its copy. */
+Fs_HabRing *Fs_HabQueue::Ring(int iHab, int create)
+{  Fs_HabRing **chunk, *r;
+   int i;
+
+   if(iHab < 0 || iHab >= FSQ_CHUNK * FSQ_DIRSIZE)
+      return NULL;
+
+   if((chunk = dir[iHab / FSQ_CHUNK]) == NULL)
+   {  if(!create)
+         return NULL;
+      if((chunk = (Fs_HabRing **)calloc(FSQ_CHUNK, sizeof(Fs_HabRing *))) == NULL)
+         return NULL;
+      if(QCmpXchg((volatile ULONG *)&dir[iHab / FSQ_CHUNK], 0, (ULONG)chunk) != 0)
+      {  free(chunk);
+         chunk = dir[iHab / FSQ_CHUNK];
       }
-      length--;
    }
-    __lxchg(&Access,UNLOCKED);
+
+   if((r = chunk[iHab % FSQ_CHUNK]) == NULL)
+   {  if(!create)
+         return NULL;
+      if((r = (Fs_HabRing *)calloc(1, sizeof(Fs_HabRing))) == NULL)
+         return NULL;
+      for(i = 0; i < MAX_SQMSG_SIZE; i++)
+         r->seq[i] = i;
+      /* private, so posting it is a user-space operation */
+      if(DosCreateEventSem(NULL, &r->hev, 0, FALSE))
+      {  free(r);
+         return NULL;
+      }
+      if(QCmpXchg((volatile ULONG *)&chunk[iHab % FSQ_CHUNK], 0, (ULONG)r) != 0)
+      {  DosCloseEventSem(r->hev);
+         free(r);
+         r = chunk[iHab % FSQ_CHUNK];
+      }
+   }
+
+   return r;
+}
+
+static void PendLock(Fs_HabRing *r)
+{  int raz = 0;
+   while(QXchg(&r->lockPend, LOCKED))
+   {  if(++raz < 3) DosSleep(0);
+      else          DosSleep(1);
+   }
+}
+
+static void PendUnlock(Fs_HabRing *r)
+{  QXchg(&r->lockPend, UNLOCKED);
+}
+
+/* rc = 0 - Ok, 1 - the ring is full */
+static int RingPut(Fs_HabRing *r, PSQMSG pmsg)
+{  ULONG pos, seq;
+   int ind;
+
+   for(;;)
+   {  pos = r->head;
+      ind = pos % MAX_SQMSG_SIZE;
+      seq = r->seq[ind];
+      if(seq == pos)
+      {  if(QCmpXchg(&r->head, pos, pos + 1) == pos)
+            break;
+      }
+      else if((LONG)(seq - pos) < 0)
+         return 1;   /* the reader is a whole ring behind */
+   }
+
+   r->msg[ind] = *pmsg;
+   QXchg(&r->seq[ind], pos + 1);
+
    return 0;
 }
 
-/* Delete first message ind from queue */
-/* rc = 0 - Ok
-   rc = 1 - no messages
+/* rc = 0 - Ok, 1 - the ring is empty */
+static int RingTake(Fs_HabRing *r, PSQMSG pmsg)
+{  ULONG pos, seq;
+   int ind;
+
+   for(;;)
+   {  pos = r->tail;
+      ind = pos % MAX_SQMSG_SIZE;
+      seq = r->seq[ind];
+      if(seq == pos + 1)
+      {  if(QCmpXchg(&r->tail, pos, pos + 1) == pos)
+            break;
+      }
+      else if((LONG)(seq - (pos + 1)) < 0)
+         return 1;   /* empty, or the writer has not finished the copy */
+   }
+
+   *pmsg = r->msg[ind];
+   QXchg(&r->seq[ind], pos + MAX_SQMSG_SIZE);
+
+   return 0;
+}
+
+/* Set a WM_PAINT or WM_TIMER aside, unless one for the same window
+   (and timer id) already is; called with lockPend held */
+/* rc = 0 - merged
+   rc = 1 - set aside
+   rc = 2 - no space left in tab
 */
-int Fs_Queue::DelFirst(void)
-{  int rcS;
-   if(length == 0)
-             return 1;
-   do
-   {  rcS =  __lxchg(&Access,LOCKED);
-      if(rcS) DosSleep(0);
-   } while(rcS);     //  
+static int PendPut(SQMSG *tab, int &n, int nmax, PSQMSG pmsg)
+{  int i;
 
-    start++; length--;
-    start = (start + 1) % lQueuesize;
+   for(i = 0; i < n; i++)
+   {  if(tab[i].qmsg.hwnd == pmsg->qmsg.hwnd &&
+         (pmsg->qmsg.msg == WM_PAINT || tab[i].qmsg.mp1 == pmsg->qmsg.mp1))
+         return 0;
+   }
+   if(n == nmax)
+      return 2;
+   tab[n++] = *pmsg;
+   return 1;
+}
 
-    __lxchg(&Access,UNLOCKED);
+/* take the oldest message of tab; called with lockPend held */
+static void PendTake(SQMSG *tab, int &n, PSQMSG pmsg)
+{  int i;
 
-    return 0;
+   *pmsg = tab[0];
+   n--;
+   for(i = 0; i < n; i++)
+      tab[i] = tab[i + 1];
 }
 
-/* Get and Delete first message ind from queue */
+/* Add message to the queue of pmsg->ihto */
 /* rc = 0 - Ok
-   rc = 1 - no messages
+   rc = 1 - No space left
    rc = 2 - pmsg is NULL
 */
-int Fs_Queue::Get(PSQMSG pmsg)
-{  int rcS;
-   if(length == 0)
-             return 1;
-    if(pmsg == NULL)
-           return 2;
-   do
-   {  rcS =  __lxchg(&Access,LOCKED);
-      if(rcS) DosSleep(0);
-   } while(rcS);     //  
+int Fs_HabQueue::Add(PSQMSG pmsg)
+{  Fs_HabRing *r;
+   int rc;
+
+   if(pmsg == NULL)
+      return 2;
 
-    *pmsg = queue[start];
+   if((r = Ring((int)pmsg->ihto, 1)) == NULL)
+      return 1;
 
-    start++; length--;
-    start = (start + 1) % lQueuesize;
+   switch(pmsg->qmsg.msg)
+   {  case WM_MOUSEMOVE:
+         PendLock(r);
+         if(!r->fMove)
+         {  r->fMove = 1;
+            r->nPend++;
+         }
+         r->msgMove = *pmsg;
+         PendUnlock(r);
+         rc = 0;
+         break;
 
-    __lxchg(&Access,UNLOCKED);
+      case WM_PAINT:
+      case WM_TIMER:
+         PendLock(r);
+         if(pmsg->qmsg.msg == WM_PAINT)
+            rc = PendPut(r->msgPaint, r->nPaint, FSQ_NPAINT, pmsg);
+         else
+            rc = PendPut(r->msgTimer, r->nTimer, FSQ_NTIMER, pmsg);
+         if(rc == 1)
+            r->nPend++;
+         PendUnlock(r);
+         if(rc == 2)   /* too many windows: queue it as it is */
+            rc = RingPut(r, pmsg);
+         else
+            rc = 0;
+         break;
 
-    return 0;
+      default:
+         /* fMove is read unlocked: a move posted at the same time as
+            this message has no order to keep anyway */
+         if(r->fMove)
+         {  PendLock(r);
+            if(r->fMove && RingPut(r, &r->msgMove) == 0)
+            {  r->fMove = 0;
+               r->nPend--;
+            }
+            rc = RingPut(r, pmsg);
+            PendUnlock(r);
+         } else
+            rc = RingPut(r, pmsg);
+         break;
+   }
+
+   if(rc == 0)
+      DosPostEventSem(r->hev);
+
+   return rc;
 }
 
 /* Get and Delete first message for iHab from queue */
@@ -133,63 +247,79 @@ int Fs_Queue::Get(PSQMSG pmsg)
    rc = 1 - no messages
    rc = 2 - pmsg is NULL
 */
-int Fs_Queue::GetForIhab(PSQMSG pmsg, int iHab)
-{
-   int i,rcS,rc=1,ind,ind1;
- 
-   if (length == 0)
-     return 1;
-
-   if (pmsg == NULL)
-     return 2;
-
-   do
-   {
-      rcS = __lxchg(&Access,LOCKED);
-      if (rcS) DosSleep(0);
-   } while (rcS);     //  
-
-   for (i = 0; i < length; i++)
-   { 
-      ind = (start+i) % lQueuesize;
-
-      if (queue[ind].ihto == iHab)
-      {  
-         *pmsg = queue[ind];
-         rc = 0;
-         break;
-      }
-   }
+int Fs_HabQueue::GetForIhab(PSQMSG pmsg, int iHab)
+{  Fs_HabRing *r;
+   int rc = 0;
 
-   if (rc == 0)  /* delete message from queue */
-   {
-     if (ind == start)
-     {
-       start = (start + 1) % lQueuesize;
-     } else {
-        for ( ; i < length-1; i++)
-        {
-           ind  = (start + i)   % lQueuesize;
-           ind1 = (start + i+1) % lQueuesize;
-           queue[ind] = queue[ind1];
-        }
-     }
-     length--;
-   }
+   if(pmsg == NULL)
+      return 2;
+
+   if((r = Ring(iHab, 0)) == NULL)
+      return 1;
 
-   __lxchg(&Access,UNLOCKED);
+   if(RingTake(r, pmsg) == 0)
+      return 0;
+   if(r->nPend == 0)
+      return 1;
+
+   PendLock(r);
+   /* a move may have gone into the ring ahead of a message meanwhile */
+   if(RingTake(r, pmsg) == 0)
+      rc = 0;
+   else if(r->fMove)
+   {  *pmsg = r->msgMove;
+      r->fMove = 0;
+      r->nPend--;
+   }
+   else if(r->nPaint)
+   {  PendTake(r->msgPaint, r->nPaint, pmsg);
+      r->nPend--;
+   }
+   else if(r->nTimer)
+   {  PendTake(r->msgTimer, r->nTimer, pmsg);
+      r->nPend--;
+   }
+   else
+      rc = 1;
+   PendUnlock(r);
 
    return rc;
 }
 
-/*  ⢮ ᮮ饭  ihabto */
-int Fs_Queue::QueryNmsg(int ihabto)
-{   int i, ind,rc = 0;
-    for(i=0; i < length; i++)
-    { ind = (start+i) % lQueuesize;
-      if(queue[ind].ihto == ihabto) rc++;
-    }
-    return rc;
+/* number of messages queued for ihabto */
+int Fs_HabQueue::QueryNmsg(int ihabto)
+{  Fs_HabRing *r;
+   LONG n;
+
+   if((r = Ring(ihabto, 0)) == NULL)
+      return 0;
+
+   n = (LONG)(r->head - r->tail);
+   if(n < 0)
+      n = 0;
+
+   return (int)n + r->nPend;
 }
 
+/* Wait at most ms msec for a message for iHab; returns the number queued */
+int Fs_HabQueue::WaitForIhab(int iHab, ULONG ms)
+{  Fs_HabRing *r;
+   ULONG ulCount;
+   int n;
+
+   if((r = Ring(iHab, 1)) == NULL)
+      return 0;
+
+   if((n = QueryNmsg(iHab)) != 0)
+      return n;
 
+   /* reset before the last look, so an Add after it still wakes us */
+   DosResetEventSem(r->hev, &ulCount);
+
+   if((n = QueryNmsg(iHab)) == 0)
+   {  DosWaitEventSem(r->hev, ms);
+      n = QueryNmsg(iHab);
+   }
+
+   return n;
+}
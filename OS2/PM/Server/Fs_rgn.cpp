@@ -0,0 +1,244 @@
+/* Fs_rgn.cpp */
+/* banded rectangle regions: window visible and update regions */
+/* DEBUG: section 2   server WND manager */
+
+#include <malloc.h>
+#include <memory.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "FreePM.hpp"
+#include "Fs_rgn.hpp"
+
+void F_RgnInit(struct F_RGN *rgn)
+{
+   memset((void *)rgn, 0, sizeof(struct F_RGN));
+}
+
+void F_RgnFree(struct F_RGN *rgn)
+{
+   if(rgn->prcl)
+      free(rgn->prcl);
+   F_RgnInit(rgn);
+}
+
+/* room for n more rectangles */
+static BOOL RgnReserve(struct F_RGN *rgn, int n)
+{  RECTL *p;
+   int nNew;
+
+   if(rgn->n + n <= rgn->nAllocated)
+      return TRUE;
+   nNew = rgn->nAllocated * 2;
+   if(nNew < rgn->n + n)
+      nNew = rgn->n + n + 8;
+   if((p = (RECTL *)realloc(rgn->prcl, nNew * sizeof(RECTL))) == NULL)
+      return FALSE;
+   rgn->prcl = p;
+   rgn->nAllocated = nNew;
+   return TRUE;
+}
+
+static void RgnBound(struct F_RGN *rgn)
+{  int i;
+
+   memset((void *)&rgn->rclBound, 0, sizeof(RECTL));
+   if(rgn->n == 0)
+      return;
+   rgn->rclBound = rgn->prcl[0];
+   rgn->rclBound.yTop = rgn->prcl[rgn->n - 1].yTop;
+   for(i = 1; i < rgn->n; i++)
+   {  if(rgn->prcl[i].xLeft < rgn->rclBound.xLeft)
+         rgn->rclBound.xLeft = rgn->prcl[i].xLeft;
+      if(rgn->prcl[i].xRight > rgn->rclBound.xRight)
+         rgn->rclBound.xRight = rgn->prcl[i].xRight;
+   }
+}
+
+BOOL F_RgnSetRect(struct F_RGN *rgn, PRECTL prcl)
+{
+   rgn->n = 0;
+   if(prcl->xLeft < prcl->xRight && prcl->yBottom < prcl->yTop)
+   {  if(!RgnReserve(rgn, 1))
+         return FALSE;
+      rgn->prcl[rgn->n++] = *prcl;
+   }
+   RgnBound(rgn);
+   return TRUE;
+}
+
+BOOL F_RgnCopy(struct F_RGN *rgnDst, struct F_RGN *rgnSrc)
+{
+   if(rgnDst == rgnSrc)
+      return TRUE;
+   rgnDst->n = 0;
+   if(!RgnReserve(rgnDst, rgnSrc->n))
+      return FALSE;
+   if(rgnSrc->n)
+      memcpy(rgnDst->prcl, rgnSrc->prcl, rgnSrc->n * sizeof(RECTL));
+   rgnDst->n = rgnSrc->n;
+   rgnDst->rclBound = rgnSrc->rclBound;
+   return TRUE;
+}
+
+void F_RgnOffset(struct F_RGN *rgn, LONG dx, LONG dy)
+{  int i;
+
+   for(i = 0; i < rgn->n; i++)
+   {  rgn->prcl[i].xLeft += dx;
+      rgn->prcl[i].xRight += dx;
+      rgn->prcl[i].yBottom += dy;
+      rgn->prcl[i].yTop += dy;
+   }
+   RgnBound(rgn);
+}
+
+/* Every line of prcl has to lie in one rectangle of its band */
+BOOL F_RgnContainsRect(struct F_RGN *rgn, PRECTL prcl)
+{  LONG y = prcl->yBottom;
+   int i, j;
+
+   if(prcl->xLeft >= prcl->xRight || prcl->yBottom >= prcl->yTop)
+      return TRUE;
+   for(i = 0; i < rgn->n; i = j)
+   {  for(j = i; j < rgn->n && rgn->prcl[j].yBottom == rgn->prcl[i].yBottom; j++) ;
+      if(rgn->prcl[i].yTop <= y)
+         continue;
+      if(rgn->prcl[i].yBottom > y)
+         return FALSE;              /* a gap between bands */
+      for(; i < j; i++)
+         if(rgn->prcl[i].xLeft <= prcl->xLeft && rgn->prcl[i].xRight >= prcl->xRight)
+            break;
+      if(i == j)
+         return FALSE;
+      y = rgn->prcl[i].yTop;
+      if(y >= prcl->yTop)
+         return TRUE;
+   }
+   return FALSE;
+}
+
+static int CmpLong(const void *p1, const void *p2)
+{  LONG l1 = *(const LONG *)p1, l2 = *(const LONG *)p2;
+
+   return l1 < l2 ? -1 : l1 > l2;
+}
+
+/* The band of rgn that covers line y: skips the bands below it, leaves
+   *pi at its first rectangle and returns its length, 0 when none does */
+static int RgnBand(struct F_RGN *rgn, int *pi, LONG y)
+{  int i = *pi, j;
+
+   while(i < rgn->n && rgn->prcl[i].yTop <= y)
+      i++;
+   *pi = i;
+   if(i == rgn->n || rgn->prcl[i].yBottom > y)
+      return 0;
+   for(j = i; j < rgn->n && rgn->prcl[j].yBottom == rgn->prcl[i].yBottom; j++) ;
+   return j - i;
+}
+
+/* op on the spans of two bands, walking their x edges in order; xs gets
+   the start and end of each resulting span */
+static int SpanOp(RECTL *a, int na, RECTL *b, int nb, int op, LONG *xs)
+{  int ia = 0, ib = 0, inA = 0, inB = 0, in, inPrev = 0, n = 0;
+   LONG x, xa, xb;
+
+   for(;;)
+   {  xa = ia < na ? (inA ? a[ia].xRight : a[ia].xLeft) : LONG_MAX;
+      xb = ib < nb ? (inB ? b[ib].xRight : b[ib].xLeft) : LONG_MAX;
+      x = xa < xb ? xa : xb;
+      if(x == LONG_MAX)
+         break;
+      if(xa == x)
+      {  if(inA) ia++;
+         inA = !inA;
+      }
+      if(xb == x)
+      {  if(inB) ib++;
+         inB = !inB;
+      }
+      switch(op)
+      {  case F_RGN_OR:  in = inA || inB;  break;
+         case F_RGN_AND: in = inA && inB;  break;
+         default:        in = inA && !inB; break;
+      }
+      if(in != inPrev)
+      {  xs[n++] = x;
+         inPrev = in;
+      }
+   }
+   return n;
+}
+
+/* The lines between two neighbouring band edges of either region are
+   alike in both, so each such strip is one span operation. A strip
+   with the spans of the band right below it just makes that taller */
+BOOL F_RgnCombine(struct F_RGN *rgnDst, struct F_RGN *rgn1, struct F_RGN *rgn2, int op)
+{  struct F_RGN rgn;
+   LONG *ys, *xs;
+   int  i, k, ny, nx, i1 = 0, i2 = 0, n1, n2, iPrev = 0, nPrev = 0;
+   RECTL *prcl;
+   BOOL rc = FALSE;
+
+   F_RgnInit(&rgn);
+   ny = 2 * (rgn1->n + rgn2->n);
+   ys = (LONG *)malloc((ny + 1) * sizeof(LONG));
+   xs = (LONG *)malloc((ny + 1) * sizeof(LONG));
+   if(ys == NULL || xs == NULL)
+      goto done;
+
+   for(ny = 0, i = 0; i < rgn1->n; i++)
+   {  ys[ny++] = rgn1->prcl[i].yBottom;
+      ys[ny++] = rgn1->prcl[i].yTop;
+   }
+   for(i = 0; i < rgn2->n; i++)
+   {  ys[ny++] = rgn2->prcl[i].yBottom;
+      ys[ny++] = rgn2->prcl[i].yTop;
+   }
+   qsort(ys, ny, sizeof(LONG), CmpLong);
+
+   for(i = 0; i + 1 < ny; i++)
+   {  if(ys[i] == ys[i+1])
+         continue;
+      n1 = RgnBand(rgn1, &i1, ys[i]);
+      n2 = RgnBand(rgn2, &i2, ys[i]);
+      if((nx = SpanOp(rgn1->prcl + i1, n1, rgn2->prcl + i2, n2, op, xs)) == 0)
+         continue;
+
+      if(nPrev == nx / 2 && rgn.prcl[iPrev].yTop == ys[i])
+      {  prcl = rgn.prcl + iPrev;
+         for(k = 0; k < nPrev; k++)
+            if(prcl[k].xLeft != xs[2*k] || prcl[k].xRight != xs[2*k+1])
+               break;
+         if(k == nPrev)
+         {  for(k = 0; k < nPrev; k++)
+               prcl[k].yTop = ys[i+1];
+            continue;
+         }
+      }
+
+      if(!RgnReserve(&rgn, nx / 2))
+         goto done;
+      iPrev = rgn.n;
+      nPrev = nx / 2;
+      for(k = 0; k < nx; k += 2)
+      {  prcl = &rgn.prcl[rgn.n++];
+         prcl->xLeft = xs[k];
+         prcl->xRight = xs[k+1];
+         prcl->yBottom = ys[i];
+         prcl->yTop = ys[i+1];
+      }
+   }
+
+   RgnBound(&rgn);
+   F_RgnFree(rgnDst);
+   *rgnDst = rgn;
+   F_RgnInit(&rgn);
+   rc = TRUE;
+
+done:
+   if(ys) free(ys);
+   if(xs) free(xs);
+   F_RgnFree(&rgn);
+   return rc;
+}
@@ -0,0 +1,34 @@
+/* Fs_rgn.hpp */
+/* banded rectangle regions of the FreePM server */
+
+#ifndef FREEPMS_RGN
+  #define FREEPMS_RGN
+
+/* A region is a list of rectangles, right and top exclusive, kept in
+   bands: sorted by yBottom, then by xLeft. The rectangles of a band
+   share yBottom and yTop and do not touch; bands do not overlap, and
+   two bands that touch have different x spans (else they would be one).
+   So a region has one representation, and a zeroed F_RGN is empty */
+struct F_RGN
+{  int    n;            /* rectangles in prcl */
+   int    nAllocated;
+   RECTL *prcl;
+   RECTL  rclBound;     /* all 0 when empty */
+};
+
+#define F_RGN_OR    1
+#define F_RGN_AND   2
+#define F_RGN_DIFF  3   /* first less second */
+
+void F_RgnInit(struct F_RGN *rgn);
+void F_RgnFree(struct F_RGN *rgn);       /* leaves it empty */
+BOOL F_RgnSetRect(struct F_RGN *rgn, PRECTL prcl);
+BOOL F_RgnCopy(struct F_RGN *rgnDst, struct F_RGN *rgnSrc);
+/* rgnDst may be rgn1 or rgn2; on FALSE (no memory) it is left alone */
+BOOL F_RgnCombine(struct F_RGN *rgnDst, struct F_RGN *rgn1, struct F_RGN *rgn2, int op);
+void F_RgnOffset(struct F_RGN *rgn, LONG dx, LONG dy);
+BOOL F_RgnContainsRect(struct F_RGN *rgn, PRECTL prcl);
+#define F_RgnIsEmpty(rgn)  ((rgn)->n == 0)
+
+#endif
+   /* FREEPMS_RGN */
@@ -24,281 +24,601 @@
 #include "debug.h"
 #include <pmclient.h>
 
-/*    HAB _ihab  ᯨ᮪ .
-   return:    ⮬ ᯨ᪥.
-           ᥩ  㤥 뢠 ⮬ 奭  (hwnd)
-*/
-int F_WND_List::Add(int _ihab)
-{   int i,rc,is,ind;
-    int ilps_raz = 0, ilps_rc;
+extern class FreePM_session session;
+
+static void WndLock(volatile int *pAccess)
+{   int ilps_raz = 0, ilps_rc;
     do
-    {  ilps_rc =  __lxchg(&wndAccess,LOCKED);
+    {  ilps_rc =  __lxchg(pAccess,LOCKED);
        if(ilps_rc)
        { if(++ilps_raz  < 3)  DosSleep(0);
           else                DosSleep(1);
        }
     } while(ilps_rc);
-/* 饬 ᯮ㥬  ᨢ pWND */
-    is = 0;
-    for(i=1;i<n;i++)  /* 0-element doesn't use */
-    { if(!pWND[i].used)
-      {  is= 1;
-         ind = i;
-      }
-    }
-    if(!is) /* free element not found  */
-    {  if(n+1 >= nAllocated)
-       {  nAllocated += 256;
-          if(pWND == NULL)
-          {        pWND = (WND *) calloc(nAllocated, sizeof(WND));
-           /*  pWND[0] is formal, not realy used */
-                   memset((void *)&pWND[0],0,sizeof(WND));
-                   n = 1;
-          }
-          else
-                  pWND = (WND *) realloc((void *)pWND, nAllocated * sizeof(WND));
-       }
-       ind = n++;
+}
+
+static void WndUnlock(volatile int *pAccess)
+{   __lxchg(pAccess,UNLOCKED);
+}
+
+/*+---------------------------------+*/
+/*| F_Slots                         |*/
+/*+---------------------------------+*/
+
+int F_Slots::Get(void)
+{
+   if(nFree)
+      return freeStack[--nFree];
+   if(n < nAllocated)
+      return n++;
+   return 0;
+}
+
+int F_Slots::Grow(int by)
+{  int i, newAllocated = nAllocated + by;
+   int *p;
+
+   if(newAllocated > FWND_INDEX_MASK + 1)
+      newAllocated = FWND_INDEX_MASK + 1;
+   if(newAllocated <= nAllocated)
+      return 0;                  /* all handles are out */
+   if((p = (int *)realloc(gen, newAllocated * sizeof(int))) == NULL)
+      return 0;
+   gen = p;
+   if((p = (int *)realloc(freeStack, newAllocated * sizeof(int))) == NULL)
+      return 0;
+   freeStack = p;
+   for(i = nAllocated; i < newAllocated; i++)
+      gen[i] = 1;
+   if(n == 0)
+      n = 1;                     /* slot 0 is formal, not realy used */
+   nAllocated = newAllocated;
+   return nAllocated;
+}
+
+void F_Slots::Put(int ind)
+{
+   gen[ind] = gen[ind] % FWND_GEN_MASK + 1;
+   freeStack[nFree++] = ind;
+}
+
+int F_Slots::Index(int h)
+{  int ind = FWND_INDEX(h);
+
+   if(h <= 0 || ind == 0 || ind >= n || FWND_GEN(h) != gen[ind])
+      return 0;
+   return ind;
+}
+
+/* Take a slot from slots, growing pArray (of cb byte elements) with it
+   when there is no free one. Called with the table locked */
+static int SlotAlloc(F_Slots &slots, void **pArray, int cb, int by)
+{  int ind, nOld, nNew;
+   void *p;
+
+   if((ind = slots.Get()) != 0)
+      return ind;
+   nOld = slots.nAllocated;
+   nNew = nOld + by;
+   if(nNew > FWND_INDEX_MASK + 1)
+      nNew = FWND_INDEX_MASK + 1;
+   if(nNew <= nOld)
+      return 0;                  /* all handles are out */
+/* the array first, so the slots never run ahead of it */
+   if((p = realloc(*pArray, nNew * cb)) == NULL)
+      return 0;
+   memset((char *)p + nOld * cb, 0, (nNew - nOld) * cb);
+   *pArray = p;
+   if(!slots.Grow(nNew - nOld))
+      return 0;
+   return slots.Get();
+}
+
+/*+---------------------------------+*/
+/*| F_WND_List                      |*/
+/*+---------------------------------+*/
+
+/*    HAB _ihab  ᯨ᮪ .
+   return:    ⮬ ᯨ᪥.
+           ᥩ  㤥 뢠 ⮬ 奭  (hwnd)
+*/
+int F_WND_List::Add(int _ihab)
+{   int ind;
+
+    WndLock(&wndAccess);
+    ind = SlotAlloc(wndSlots, (void **)&pWND, sizeof(WND), 256);
+    if(ind)
+    {  memset((void *)&pWND[ind],0,sizeof(WND));
+       pWND[ind].used = 1;
+       pWND[ind].iHab = _ihab;
+       pWND[ind].iHDC = NULL;
+       pWND[ind].hwnd = wndSlots.Handle(ind);
     }
-    __lxchg(&wndAccess,UNLOCKED);
-    memset((void *)&pWND[ind],0,sizeof(WND));
-    pWND[ind].used = 1;
-    pWND[ind].iHab = _ihab;
-    pWND[ind].iHDC = NULL;/*  த  ⥭  DC */
-    pWND[ind].hwnd = ind; /*  ஫     */
-debug(2, 0) ("WND_List::Add %i, n=%i\n",ind,n);
-    return ind;
+    WndUnlock(&wndAccess);
+    if(!ind)
+       return NULL;
+debug(2, 0) ("WND_List::Add %x, n=%i\n",pWND[ind].hwnd,wndSlots.n);
+    return pWND[ind].hwnd;
+}
+
+int F_WND_List::WndIndex(int iHWND)
+{  int ind;
+
+   if(iHWND == HWND_DESKTOP)
+      iHWND = iHwndCurrentDeskTop;
+   ind = wndSlots.Index(iHWND);
+   if(ind && pWND[ind].used)
+      return ind;
+   return 0;
 }
 
 int F_WND_List::Query(int iWND)
-{ int rc = 0;
-  if(iWND < 0 || iWND >= n) rc = -1;
-  if(pWND[iWND].used)       rc = 1;
-  return rc;
+{
+  if(iWND == HWND_DESKTOP)
+     iWND = iHwndCurrentDeskTop;
+  if(FWND_INDEX(iWND) == 0 || FWND_INDEX(iWND) >= wndSlots.n)
+     return -1;
+  return WndIndex(iWND) ? 1 : 0;
 }
 
 int F_WND_List::QueryHab(int iWND, int &ihab)
-{ int rc = 0;
-  if(iWND < 0 || iWND >= n) rc = -1;
-  if(pWND[iWND].used)  {     rc = 1;  ihab = pWND[iWND].iHab; }
+{ int rc = Query(iWND);
+  if(rc == 1)
+     ihab = Wnd(iWND)->iHab;
   return rc;
 }
 
+void F_WND_List::Unlink(int ind)
+{  struct WND *w = &pWND[ind];
+
+   if(w->iParent == 0)
+      return;
+   if(w->iPrevSibling)
+      pWND[w->iPrevSibling].iNextSibling = w->iNextSibling;
+   else
+      pWND[w->iParent].iFirstChild = w->iNextSibling;
+   if(w->iNextSibling)
+      pWND[w->iNextSibling].iPrevSibling = w->iPrevSibling;
+   else
+      pWND[w->iParent].iLastChild = w->iPrevSibling;
+   w->iParent = w->iPrevSibling = w->iNextSibling = 0;
+}
+
+void F_WND_List::LinkAfter(int ind, int iParent, int iAfter)
+{  struct WND *w = &pWND[ind];
+   struct WND *p = &pWND[iParent];
+
+   w->iParent = iParent;
+   w->iPrevSibling = iAfter;
+   if(iAfter)
+   {  w->iNextSibling = pWND[iAfter].iNextSibling;
+      pWND[iAfter].iNextSibling = ind;
+   } else {
+      w->iNextSibling = p->iFirstChild;
+      p->iFirstChild = ind;
+   }
+   if(w->iNextSibling)
+      pWND[w->iNextSibling].iPrevSibling = ind;
+   else
+      p->iLastChild = ind;
+}
+
 int F_WND_List::Del(int iWND)
-{  int ilps_raz = 0, ilps_rc;
+{  int ind, ich, next, ipar;
+   RECTL rclOld;
 
-   if(iWND < 0 || iWND >= n)
+   if(Query(iWND) < 0)
                  return 1;
-   if(!pWND[iWND].used)
+   if((ind = WndIndex(iWND)) == 0)
                  return 2;
-debug(2, 0) ("WND_List::Del %i\n",iWND);
-    do
-    {  ilps_rc =  __lxchg(&wndAccess,LOCKED);
-       if(ilps_rc)
-       { if(++ilps_raz  < 3)  DosSleep(0);
-          else            DosSleep(1);
-       }
-    } while(ilps_rc);
+debug(2, 0) ("WND_List::Del %x\n",iWND);
+    WndLock(&wndAccess);
 
 /* if window use HPS - del HPS's ?? */
 //todo
 
 /* if window have DC - close DC */
-    if(pWND[iWND].iHDC)  CloseDC(pWND[iWND].iHDC);
-    pWND[iWND].iHDC = NULL;
+    if(pWND[ind].iHDC)  CloseDC(pWND[ind].iHDC);
+    pWND[ind].iHDC = NULL;
 
-    pWND[iWND].used = 0;
-    if(iWND == n -1)
-    {   while(n>0 && (pWND[n].used))
-                     n--;
+/* the children are left without a parent */
+    for(ich = pWND[ind].iFirstChild; ich; ich = next)
+    {  next = pWND[ich].iNextSibling;
+       pWND[ich].iParent = pWND[ich].iPrevSibling = pWND[ich].iNextSibling = 0;
     }
-    __lxchg(&wndAccess,UNLOCKED);
+    pWND[ind].iFirstChild = pWND[ind].iLastChild = 0;
+
+/* the siblings below and the parent get back what it covered */
+    WndRect(ind, &rclOld);
+    ipar = pWND[ind].iParent;
+    next = pWND[ind].iNextSibling;
+    Unlink(ind);
+    for(; next; next = pWND[next].iNextSibling)
+       VisTree(next, 0);
+    if(ipar)
+       Uncover(ipar, 0, &rclOld, NULL);
+    F_RgnFree(&pWND[ind].rgnVis);
+    F_RgnFree(&pWND[ind].rgnUpdate);
+    F_RgnFree(&pWND[ind].rgnPaint);
+
+    pWND[ind].used = 0;
+    wndSlots.Put(ind);
+    WndUnlock(&wndAccess);
     return 0;
 }
 
 
+/* A new child goes on top of its siblings */
 int F_WND_List::SetParent(int iHWND, int iHWNDparent)
-{
-   if(iHWND == HWND_DESKTOP)
-                 iHWND = iHwndCurrentDeskTop;
-   if(iHWNDparent == HWND_DESKTOP)
-                 iHWNDparent = iHwndCurrentDeskTop;
+{  int ind, ipar, i, iold;
+   RECTL rclOld;
 
-   if(iHWND < 0 || iHWND >= n)
-                 return 1;
-   if(iHWNDparent < 0 || iHWNDparent >= n)
+   if(Query(iHWND) < 0 || Query(iHWNDparent) < 0)
                  return 1;
-   if(!pWND[iHWND].used)
+   ind  = WndIndex(iHWND);
+   ipar = WndIndex(iHWNDparent);
+   if(!ind || !ipar)
                  return 2;
-   if(!pWND[iHWNDparent].used)
-                 return 2;
-    pWND[iHWND].iParent = iHWNDparent;
+   WndLock(&wndAccess);
+/* a window can not become a child of itself or of one of its children */
+   for(i = ipar; i; i = pWND[i].iParent)
+   {  if(i == ind)
+      {  WndUnlock(&wndAccess);
+         return 1;
+      }
+   }
+   if(pWND[ind].iParent != ipar)
+   {  WndRect(ind, &rclOld);
+      iold = pWND[ind].iParent;
+      i = pWND[ind].iNextSibling;
+      Unlink(ind);
+      for(; i; i = pWND[i].iNextSibling)
+         VisTree(i, 0);
+      if(iold)
+         Uncover(iold, 0, &rclOld, NULL);
+      LinkAfter(ind, ipar, 0);
+      VisUpdate(ind, 1);
+   }
+   WndUnlock(&wndAccess);
 
     return 0;
 }
 
 /* Get "Cached presentation space" */
 HPS F_WND_List::GetHPS(int iHWND)
-{  int rc, ihab,is,i,ind;
-   int ilps_raz = 0, ilps_rc;
+{  int rc, ihab, ind, iwnd, fPaint = 0;
+   RECTL rcl;
+   HPS hps;
 
-   if(iHWND == HWND_DESKTOP)
-                 iHWND = iHwndCurrentDeskTop;
 /* Query ihab for iHWND */
    rc = QueryHab(iHWND, ihab);
    if(rc!=1)
    {   _shab.SetError(rc, PMERR_INVALID_HWND);
       return NULL;
    }
-   if(pWND[iHWND].iHDC)  /* window has open DC */
+   iwnd = WndIndex(iHWND);
+   if(!DC(pWND[iwnd].iHDC))  /* window has no open DC */
    {
-   } else {
-      rc = OpenDC(ihab, iHWND);
+      pWND[iwnd].iHDC = OpenDC(ihab, pWND[iwnd].hwnd);
    }
 
-    do
-    {  ilps_rc =  __lxchg(&hpsAccess,LOCKED);
-       if(ilps_rc)
-       { if(++ilps_raz  < 3)  DosSleep(0);
-          else                DosSleep(1);
-       }
-    } while(ilps_rc);
-
-/* 饬 ᯮ㥬  ᨢ pPS */
-    is = 0;
-    for(i=1;i<numPS;i++)  /* 0-element doesn't use */
-    { if(!pPS[i].used)
-      {  is= 1;
-         ind = i;
-      }
+/* With damage pending the client is about to paint it: this PS draws
+   only there, and the window counts as painted */
+    WndLock(&wndAccess);
+    WndRect(iwnd, &rcl);
+    if(!F_RgnIsEmpty(&pWND[iwnd].rgnUpdate) &&
+       F_RgnCombine(&pWND[iwnd].rgnPaint, &pWND[iwnd].rgnUpdate, &pWND[iwnd].rgnVis, F_RGN_AND))
+    {  F_RgnFree(&pWND[iwnd].rgnUpdate);
+       fPaint = 1;
     }
-    if(!is) /* free element not found  */
-    {  if(numPS+1 >= nPSAllocated)
-       {  nPSAllocated += 64;
-          if(numPS == NULL)
-          {        pPS = (F_PS  *) calloc(nPSAllocated, sizeof(F_PS ));
-           /*  pDC[0] is formal, not realy used */
-                   memset((void *)&pPS[0],0,sizeof(F_PS ));
-                   numPS = 1;
-          }
-          else
-                  pPS = (F_PS  *) realloc((void *)pPS,  sizeof(F_PS ));
-       }
-       ind = numPS++;
+    WndUnlock(&wndAccess);
+
+    WndLock(&hpsAccess);
+    ind = SlotAlloc(psSlots, (void **)&pPS, sizeof(F_PS), 64);
+    if(ind)
+    {  memset((void *)&pPS[ind],0,sizeof(F_PS));
+       pPS[ind].used = 1;
+       pPS[ind].iDC = pWND[iwnd].iHDC;
+       pPS[ind].x0 =  rcl.xLeft;
+       pPS[ind].y0 =  rcl.yBottom;
+       pPS[ind].z0 =  pWND[iwnd].z;
+       pPS[ind].nx =  pWND[iwnd].nx;
+       pPS[ind].ny =  pWND[iwnd].ny;
+       pPS[ind].hwnd = pWND[iwnd].hwnd;
+       pPS[ind].fPaint = fPaint;
     }
-    __lxchg(&hpsAccess,UNLOCKED);
-    memset((void *)&pDC[ind],0,sizeof(F_PS));
-    pPS[ind].used = 1;
-    pPS[ind].iDC = pWND[iHWND].iHDC;
-    pPS[ind].x0 =  pWND[iHWND].x;
-    pPS[ind].y0 =  pWND[iHWND].y;
-    pPS[ind].z0 =  pWND[iHWND].z;
-    pPS[ind].nx =  pWND[iHWND].nx;
-    pPS[ind].ny =  pWND[iHWND].ny;
-
-debug(2, 0) (__FUNCTION__" %i, n=%i\n",ind,numPS);
-
-    return ind;
+    hps = ind ? psSlots.Handle(ind) : NULL;
+    WndUnlock(&hpsAccess);
+
+debug(2, 0) (__FUNCTION__" %x, n=%i\n",hps,psSlots.n);
+
+    return hps;
 }
 
 int F_WND_List::ReleaseHPS(HPS ihps)
-{  int ilps_raz = 0, ilps_rc;
+{  int ind, hwnd = 0, iwnd;
 
-   if(ihps < 0 || ihps >= numPS)
+   if(FWND_INDEX(ihps) == 0 || FWND_INDEX(ihps) >= psSlots.n)
                  return 1;
-   if(!pPS[ihps].used)
+   if(PS(ihps) == NULL)
                  return 2;
-    debug(2, 0) (__FUNCTION__ " %i\n",ihps);
-    do
-    {  ilps_rc =  __lxchg(&hpsAccess,LOCKED);
-       if(ilps_rc)
-       { if(++ilps_raz  < 3)  DosSleep(0);
-          else            DosSleep(1);
-       }
-    } while(ilps_rc);
-    pPS[ihps].used = 0;
-    if(ihps == numPS -1)
-    {   while(numPS > 0 && (pPS[numPS].used))
-                     numPS--;
+    debug(2, 0) (__FUNCTION__ " %x\n",ihps);
+    WndLock(&hpsAccess);
+    ind = psSlots.Index(ihps);
+    if(ind && pPS[ind].used)
+    {  if(pPS[ind].fPaint)
+          hwnd = pPS[ind].hwnd;
+       pPS[ind].used = 0;
+       psSlots.Put(ind);
     }
-    __lxchg(&hpsAccess,UNLOCKED);
+    WndUnlock(&hpsAccess);
 
+    if(hwnd)
+    {  WndLock(&wndAccess);
+       if((iwnd = WndIndex(hwnd)) != 0)
+          F_RgnFree(&pWND[iwnd].rgnPaint);
+       WndUnlock(&wndAccess);
+    }
 
     return 0;
 }
 
 HDC F_WND_List::OpenDC(int _ihab, HWND ihwnd)
-{   int i,rc,is,ind;
-    int ilps_raz = 0, ilps_rc;
-    do
-    {  ilps_rc =  __lxchg(&dcAccess,LOCKED);
-       if(ilps_rc)
-       { if(++ilps_raz  < 3)  DosSleep(0);
-          else                DosSleep(1);
-       }
-    } while(ilps_rc);
-/* 饬 ᯮ㥬  ᨢ pDC */
-    is = 0;
-    for(i=1;i<numDC;i++)  /* 0-element doesn't use */
-    { if(!pDC[i].used)
-      {  is= 1;
-         ind = i;
-      }
-    }
-    if(!is) /* free element not found  */
-    {  if(numDC+1 >= nDCAllocated)
-       {  nDCAllocated += 64;
-          if(pDC == NULL)
-          {        pDC = (F_DC *) calloc(nDCAllocated, sizeof(F_DC));
-           /*  pDC[0] is formal, not realy used */
-                   memset((void *)&pDC[0],0,sizeof(F_DC));
-                   numDC = 1;
-          }
-          else
-                  pDC = (F_DC *) realloc((void *)pDC, nDCAllocated * sizeof(F_DC));
-       }
-       ind = numDC++;
+{   int ind;
+    HDC hdc;
+
+    WndLock(&dcAccess);
+    ind = SlotAlloc(dcSlots, (void **)&pDC, sizeof(F_DC), 64);
+    if(ind)
+    {  memset((void *)&pDC[ind],0,sizeof(F_DC));
+       pDC[ind].used = 1;
+       pDC[ind].iHab = _ihab;
+       pDC[ind].hwnd =  ihwnd;
     }
-    __lxchg(&dcAccess,UNLOCKED);
-    memset((void *)&pDC[ind],0,sizeof(F_DC));
-    pDC[ind].used = 1;
-    pDC[ind].iHab = _ihab;
-    pDC[ind].hwnd =  ihwnd;
-debug(2, 0) (__FUNCTION__" %i, n=%i\n",ind,numDC);
-    return ind;
+    hdc = ind ? dcSlots.Handle(ind) : NULL;
+    WndUnlock(&dcAccess);
+debug(2, 0) (__FUNCTION__" %x, n=%i\n",hdc,dcSlots.n);
+    return hdc;
 }
 
 int F_WND_List::CloseDC(int iDC)
-{  int ilps_raz = 0, ilps_rc;
+{  int ind;
 
-   if(iDC < 0 || iDC >= numDC)
+   if(FWND_INDEX(iDC) == 0 || FWND_INDEX(iDC) >= dcSlots.n)
                  return 1;
-   if(!pDC[iDC].used)
+   if(DC(iDC) == NULL)
                  return 2;
-    debug(2, 0) (__FUNCTION__ " %i\n",iDC);
-    do
-    {  ilps_rc =  __lxchg(&dcAccess,LOCKED);
-       if(ilps_rc)
-       { if(++ilps_raz  < 3)  DosSleep(0);
-          else            DosSleep(1);
-       }
-    } while(ilps_rc);
-    pDC[iDC].used = 0;
-    if(iDC == numDC -1)
-    {   while(numDC>0 && (pDC[numDC].used))
-                     numDC--;
+    debug(2, 0) (__FUNCTION__ " %x\n",iDC);
+    WndLock(&dcAccess);
+    ind = dcSlots.Index(iDC);
+    if(ind && pDC[ind].used)
+    {  pDC[ind].used = 0;
+       dcSlots.Put(ind);
     }
-    __lxchg(&dcAccess,UNLOCKED);
+    WndUnlock(&dcAccess);
 
     return 0;
 }
 
+/* Position, size and z-order among the siblings. hwndInsertBehind is
+   HWND_TOP, HWND_BOTTOM or a sibling to go just below */
 int F_WND_List::WinSetWindowPos(int iHWND, int hwndInsertBehind, int x, int y, int nx, int ny, int flStyle)
-{
-//todo or toredo
-return 0; /* Just to make OW compile it. */
+{  int ind, iafter, i, fMoved, fRestacked = 0;
+   struct WND *w;
+   RECTL rclOld, rclNew;
+
+   if((ind = WndIndex(iHWND)) == 0)
+      return 1;
+   WndLock(&wndAccess);
+   w = &pWND[ind];
+   WndRect(ind, &rclOld);
+   fMoved = (flStyle & SWP_MOVE) && (w->x != x || w->y != y);
+   if(flStyle & SWP_MOVE)
+   {  w->x = x;
+      w->y = y;
+   }
+   if(flStyle & SWP_SIZE)
+   {  w->nx = nx;
+      w->ny = ny;
+   }
+   if((flStyle & SWP_ZORDER) && w->iParent)
+   {  int ipar = w->iParent;
+      if(hwndInsertBehind == HWND_TOP)
+         iafter = 0;
+      else if(hwndInsertBehind == HWND_BOTTOM)
+         iafter = pWND[ipar].iLastChild;
+      else
+      {  iafter = wndSlots.Index(hwndInsertBehind);
+         if(!iafter || !pWND[iafter].used || pWND[iafter].iParent != ipar)
+            iafter = -1;          /* not a sibling: leave the order alone */
+      }
+      if(iafter != -1 && iafter != ind)
+      {  Unlink(ind);
+         LinkAfter(ind, ipar, iafter);
+         fRestacked = 1;
+      }
+   }
+
+/* Only the window and the siblings below it can see a change; after a
+   restack that may be any sibling. What moved repaints whole */
+   if(fRestacked)
+   {  for(i = pWND[w->iParent].iFirstChild; i; i = pWND[i].iNextSibling)
+         VisTree(i, i == ind && fMoved);
+   } else if(flStyle & (SWP_MOVE | SWP_SIZE))
+      VisUpdate(ind, fMoved);
+   if(w->iParent && (flStyle & (SWP_MOVE | SWP_SIZE)))
+   {  WndRect(ind, &rclNew);
+      Uncover(w->iParent, ind, &rclOld, &rclNew);
+   }
+   WndUnlock(&wndAccess);
+   return 0;
+}
+
+/*+---------------------------------+*/
+/*| Visible and update regions      |*/
+/*+---------------------------------+*/
+/* Window x, y are relative to the parent. Regions are in screen
+   coordinates, origin at the bottom left. All of these run with
+   wndAccess held */
+
+void F_WND_List::WndRect(int ind, PRECTL prcl)
+{  int i;
+
+   prcl->xLeft = prcl->yBottom = 0;
+   for(i = ind; i; i = pWND[i].iParent)
+   {  prcl->xLeft += pWND[i].x;
+      prcl->yBottom += pWND[i].y;
+   }
+   prcl->xRight = prcl->xLeft + pWND[ind].nx;
+   prcl->yTop = prcl->yBottom + pWND[ind].ny;
+}
+
+/* Add rgn to what the window has to paint; the first damage since it
+   last painted posts it a WM_PAINT. The desktop and windows without a
+   parent are painted by the server on the device's WM_PAINT */
+void F_WND_List::Invalidate(int ind, struct F_RGN *rgn)
+{  struct WND *w = &pWND[ind];
+   int wasEmpty = F_RgnIsEmpty(&w->rgnUpdate);
+   SQMSG sqMsg;
+
+   if(w->iParent == 0 || F_RgnIsEmpty(rgn))
+      return;
+   if(!F_RgnCombine(&w->rgnUpdate, &w->rgnUpdate, rgn, F_RGN_OR) || !wasEmpty)
+      return;
+   memset((void *)&sqMsg, 0, sizeof(SQMSG));
+   sqMsg.qmsg.hwnd = w->hwnd;
+   sqMsg.qmsg.msg  = WM_PAINT;
+   sqMsg.ihto      = w->iHab;
+   session.hab_list.Queue.Add(&sqMsg);
 }
 
+/* The window's rectangle within the parent's visible region, less the
+   siblings above it. Children are not cut out of their parent, as
+   without WS_CLIPCHILDREN. What shows now and did not before needs
+   painting - all of it if fAll */
+void F_WND_List::VisCalc(int ind, int fAll)
+{  struct WND *w = &pWND[ind];
+   struct F_RGN rgn, rgnT;
+   RECTL rcl;
+   int i;
+
+   F_RgnInit(&rgn);
+   F_RgnInit(&rgnT);
+   WndRect(ind, &rcl);
+   F_RgnSetRect(&rgn, &rcl);
+   if(w->iParent)
+   {  F_RgnCombine(&rgn, &rgn, &pWND[w->iParent].rgnVis, F_RGN_AND);
+      for(i = w->iPrevSibling; i && !F_RgnIsEmpty(&rgn); i = pWND[i].iPrevSibling)
+      {  WndRect(i, &rcl);
+         if(rcl.xLeft >= rgn.rclBound.xRight || rcl.xRight <= rgn.rclBound.xLeft ||
+            rcl.yBottom >= rgn.rclBound.yTop || rcl.yTop <= rgn.rclBound.yBottom)
+            continue;
+         F_RgnSetRect(&rgnT, &rcl);
+         F_RgnCombine(&rgn, &rgn, &rgnT, F_RGN_DIFF);
+      }
+   }
+   if(fAll)
+      Invalidate(ind, &rgn);
+   else if(F_RgnCombine(&rgnT, &rgn, &w->rgnVis, F_RGN_DIFF))
+      Invalidate(ind, &rgnT);
+   F_RgnFree(&w->rgnVis);
+   w->rgnVis = rgn;
+   F_RgnFree(&rgnT);
+}
 
+void F_WND_List::VisTree(int ind, int fAll)
+{  int i;
 
+   VisCalc(ind, fAll);
+   for(i = pWND[ind].iFirstChild; i; i = pWND[i].iNextSibling)
+      VisTree(i, fAll);
+}
 
+/* ind moved or changed size: windows above it and in other branches
+   see the same as before */
+void F_WND_List::VisUpdate(int ind, int fAll)
+{  int i;
+
+   VisTree(ind, fAll);
+   for(i = pWND[ind].iNextSibling; i; i = pWND[i].iNextSibling)
+      VisTree(i, 0);
+}
+
+/* The parent shows again where a child was (prclOld) and is no more
+   (prclNew, NULL if gone) - except under its other children */
+void F_WND_List::Uncover(int iParent, int iSkip, PRECTL prclOld, PRECTL prclNew)
+{  struct F_RGN rgn, rgnT;
+   RECTL rcl;
+   int i;
+
+   F_RgnInit(&rgn);
+   F_RgnInit(&rgnT);
+   F_RgnSetRect(&rgn, prclOld);
+   if(prclNew)
+   {  F_RgnSetRect(&rgnT, prclNew);
+      F_RgnCombine(&rgn, &rgn, &rgnT, F_RGN_DIFF);
+   }
+   for(i = pWND[iParent].iFirstChild; i && !F_RgnIsEmpty(&rgn); i = pWND[i].iNextSibling)
+   {  if(i == iSkip)
+         continue;
+      WndRect(i, &rcl);
+      F_RgnSetRect(&rgnT, &rcl);
+      F_RgnCombine(&rgn, &rgn, &rgnT, F_RGN_DIFF);
+   }
+   if(F_RgnCombine(&rgn, &rgn, &pWND[iParent].rgnVis, F_RGN_AND))
+      Invalidate(iParent, &rgn);
+   F_RgnFree(&rgn);
+   F_RgnFree(&rgnT);
+}
+
+/* Call pfn for each piece of prcl the PS may draw on: the visible
+   region, or what it got to paint. The list stays locked meanwhile so
+   the region can not change under the caller */
+int F_WND_List::ClipPS(struct F_PS *ps, PRECTL prcl, int (*pfn)(PRECTL prcl, void *pData), void *pData)
+{  struct F_RGN *rgn;
+   RECTL rcl, *r;
+   int ind, i, n = 0;
+
+   WndLock(&wndAccess);
+   if((ind = WndIndex(ps->hwnd)) != 0)
+   {  rgn = ps->fPaint ? &pWND[ind].rgnPaint : &pWND[ind].rgnVis;
+      /* bands go up, so stop at the first above prcl */
+      for(i = 0; i < rgn->n && rgn->prcl[i].yBottom < prcl->yTop; i++)
+      {  r = &rgn->prcl[i];
+         rcl.xLeft   = r->xLeft   > prcl->xLeft   ? r->xLeft   : prcl->xLeft;
+         rcl.yBottom = r->yBottom > prcl->yBottom ? r->yBottom : prcl->yBottom;
+         rcl.xRight  = r->xRight  < prcl->xRight  ? r->xRight  : prcl->xRight;
+         rcl.yTop    = r->yTop    < prcl->yTop    ? r->yTop    : prcl->yTop;
+         if(rcl.xLeft < rcl.xRight && rcl.yBottom < rcl.yTop)
+         {  pfn(&rcl, pData);
+            n++;
+         }
+      }
+   }
+   WndUnlock(&wndAccess);
+   return n;
+}
+
+int F_WND_List::PSRectVisible(struct F_PS *ps, PRECTL prcl)
+{  int ind, rc = 0;
+
+   WndLock(&wndAccess);
+   if((ind = WndIndex(ps->hwnd)) != 0)
+      rc = F_RgnContainsRect(ps->fPaint ? &pWND[ind].rgnPaint : &pWND[ind].rgnVis, prcl);
+   WndUnlock(&wndAccess);
+   return rc;
+}
+
+/* The part of prcl that shows gets painted again */
+void F_WND_List::PSInvalidate(struct F_PS *ps, PRECTL prcl)
+{  struct F_RGN rgn;
+   int ind;
+
+   F_RgnInit(&rgn);
+   WndLock(&wndAccess);
+   if((ind = WndIndex(ps->hwnd)) != 0 && F_RgnSetRect(&rgn, prcl) &&
+      F_RgnCombine(&rgn, &rgn, &pWND[ind].rgnVis, F_RGN_AND))
+      Invalidate(ind, &rgn);
+   WndUnlock(&wndAccess);
+   F_RgnFree(&rgn);
+}
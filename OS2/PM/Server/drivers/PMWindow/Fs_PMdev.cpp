@@ -22,6 +22,9 @@
  #include "FreePM.hpp"
  #include "FreePMs.hpp"
 
+ #define FPM_DRIVER
+ #include "Fs_driver.h"
+
 //#define F_INCL_DOS
 //#include "F_base.hpp"
 //#include "F_GPI.hpp"
@@ -46,15 +49,19 @@ MRESULT EXPENTRY ClientWndProc ( HWND hwndWnd,
 
 
 extern "C" void APIENTRY FPM_DeviceStart(void *param);
+extern "C" PFPM_ACCEL FPM_DeviceQueryAccel(void);
 
 LONG *GetVideoConfig(HDC hdc);
 int ErrInfoMsg2(char *str);
 int open_Vbuff(RECTL rclRect);
 int InitBuffer(void);
 void DisplayVbuf(HWND hwnd, HPS  hpsBuffer,RECTL rect, int isChange);
+static void DamageShow(HWND hwnd);
 
 #define LONGFromRGB(R,G,B) (LONG)(((LONG)R<<16)+((LONG)G<<8)+(LONG)B)
 #define MYM_SHOWMESSAGE 3333
+#define MYM_PRESENT     3334   /* the server has drawn, see DamageShow */
+#define TID_PRESENT     1
 
 static HAB     habAnchor;
 extern HPS     hpsDrawBMPBuffer = NULLHANDLE;
@@ -64,10 +71,13 @@ static HWND    hwndClient;
 //temporary static int     MainThreadOrdinal;
 static void    *pVBuffmem = NULL;
 static int     bytesPerPixel = 0;
+static HMTX    hmtxDamage = NULLHANDLE;
 FreePM_DeskTop *pDesktop;
 //extern class VideoPowerPresentation videopres;
 //extern const char *const _FreePM_Application_Name;
 
+extern HBITMAP hbm;
+
 typedef int  (*callback_t)(void *pDClass, QMSG  *pqmMsg);
 
 void APIENTRY FPM_DeviceStart(void *param)
@@ -110,6 +120,7 @@ void APIENTRY FPM_DeviceStart(void *param)
        exit(2);
    }
 
+   DosCreateMutexSem(NULL, &hmtxDamage, 0, FALSE);
    habAnchor = WinInitialize ( 0 ) ;
 
    HMQ         hmqQueue;
@@ -175,8 +186,9 @@ void APIENTRY FPM_DeviceStart(void *param)
    {
      WinDispatchMsg (habAnchor, &qmMsg);
 
-     /* translate only client messages */
-     if(qmMsg.hwnd == hwndClient)
+     /* translate only client messages, not our own repaint requests */
+     if(qmMsg.hwnd == hwndClient && qmMsg.msg != MYM_PRESENT &&
+        qmMsg.msg != WM_TIMER)
         _DeskTopSendQueue(pDesktop, &qmMsg);
    } /* endwhile */
 
@@ -213,6 +225,14 @@ MRESULT EXPENTRY ClientWndProc ( HWND hwndWnd,
    case WM_ERASEBACKGROUND:
       return MRFROMSHORT ( TRUE ) ;
 
+   case WM_TIMER:
+      if(SHORT1FROMMP(mpParm1) != TID_PRESENT)
+         return WinDefWindowProc ( hwndWnd, ulMsg, mpParm1, mpParm2 ) ;
+      /* fall through */
+   case MYM_PRESENT:
+      DamageShow(hwndWnd);
+      break;
+
    case WM_PAINT:
       {   RECTL rclClient;
           RECTL RectField;
@@ -224,9 +244,16 @@ MRESULT EXPENTRY ClientWndProc ( HWND hwndWnd,
 //      WinFillRect(hps, &rclClient, col);
       col = (col+1) % 16;
 //      printf("Rect= %i %i % i %i\n",rclClient.xLeft,rclClient.yBottom, rclClient.xRight,rclClient.yTop);
-          WinQueryWindowRect(hwndWnd,&RectField);
-          open_Vbuff( RectField);
-          DisplayVbuf(hwndWnd,hpsDrawBMPBuffer,RectField,1);
+          if(hbm == 0)
+          {   /* the bitmap covers the desktop, not the window */
+              RectField.xLeft = 0;
+              RectField.yBottom = 0;
+              RectField.xRight = pDesktop->nx - 1;
+              RectField.yTop = pDesktop->ny - 1;
+              open_Vbuff( RectField);
+              DisplayVbuf(hwndWnd,hpsDrawBMPBuffer,rclClient,1);
+          } else
+              DisplayVbuf(hwndWnd,hpsDrawBMPBuffer,rclClient,0);
 
       WinEndPaint(hps);
 
@@ -328,6 +355,355 @@ struct VideoDevConfigCaps
 
 struct VideoDevConfigCaps VideoDevConfig = { 0 };
 
+/*+---------------------------------+*/
+/*| Drawing and damage tracking.    |*/
+/*+---------------------------------+*/
+/* The server draws into pBmpBuffer through the FPM_ACCEL table below,
+   and every primitive records the rectangle it touched. Present() only
+   posts MYM_PRESENT; the window thread then uploads just the damaged
+   scanlines into the bitmap and blits just the damaged rectangles, at
+   most PMDEV_FPS times a second. Damage is kept in bitmap coordinates:
+   origin at the bottom left like the client window, right and top
+   exclusive. Too many rectangles get merged into the one that grows
+   least */
+#define PMDEV_MAXDAMAGE 16
+#define PMDEV_FPS       30
+
+#define BMP_PIXEL  (bmp.cBitCount / 8)
+#define BMP_LINE   (((bmp.cx * bmp.cBitCount + 31) / 32) * 4)
+
+static RECTL arclDamage[PMDEV_MAXDAMAGE];
+static int   nDamage = 0;
+static int   fPresentPosted = 0;
+static int   fPresentTimer = 0;
+static ULONG msLastPresent = 0;
+static FPM_ACCEL PMAccel = { 0 };
+
+static LONG RectArea(PRECTL prcl)
+{  return (prcl->xRight - prcl->xLeft) * (prcl->yTop - prcl->yBottom);
+}
+
+static void DamageAdd(LONG xLeft, LONG yBottom, LONG xRight, LONG yTop)
+{  RECTL rcl, rclU;
+   LONG  lGrow, lBest = 0x7fffffff;
+   int   i, iBest = 0;
+
+   rcl.xLeft = xLeft;
+   rcl.yBottom = yBottom;
+   rcl.xRight = xRight;
+   rcl.yTop = yTop;
+
+   DosRequestMutexSem(hmtxDamage, SEM_INDEFINITE_WAIT);
+   for(i = 0; i < nDamage; i++)
+   {  WinUnionRect(habAnchor, &rclU, &arclDamage[i], &rcl);
+      lGrow = RectArea(&rclU) - RectArea(&arclDamage[i]) - RectArea(&rcl);
+      if(lGrow <= 0)            /* contained, or lined up and touching */
+      {  arclDamage[i] = rclU;
+         break;
+      }
+      if(lGrow < lBest)
+      {  lBest = lGrow;
+         iBest = i;
+      }
+   }
+   if(i == nDamage)
+   {  if(nDamage < PMDEV_MAXDAMAGE)
+         arclDamage[nDamage++] = rcl;
+      else
+         WinUnionRect(habAnchor, &arclDamage[iBest], &arclDamage[iBest], &rcl);
+   }
+   DosReleaseMutexSem(hmtxDamage);
+}
+
+/* Runs on the window thread */
+static void DamageShow(HWND hwnd)
+{  RECTL arcl[PMDEV_MAXDAMAGE];
+   ULONG ms, msFrame = 1000 / PMDEV_FPS;
+   int   i, n;
+
+   DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ms, sizeof(ms));
+   if(ms - msLastPresent < msFrame)
+   {  /* too soon after the last one, the timer brings us back */
+      if(!fPresentTimer)
+      {  WinStartTimer(habAnchor, hwnd, TID_PRESENT, msFrame - (ms - msLastPresent));
+         fPresentTimer = 1;
+      }
+      return;
+   }
+   if(fPresentTimer)
+   {  WinStopTimer(habAnchor, hwnd, TID_PRESENT);
+      fPresentTimer = 0;
+   }
+   msLastPresent = ms;
+
+   DosRequestMutexSem(hmtxDamage, SEM_INDEFINITE_WAIT);
+   n = nDamage;
+   memcpy(arcl, arclDamage, n * sizeof(RECTL));
+   nDamage = 0;
+   fPresentPosted = 0;
+   DosReleaseMutexSem(hmtxDamage);
+
+   for(i = 0; i < n; i++)
+   {  if(hbm == 0)
+      {  /* first WM_PAINT has not been, it will upload everything */
+         WinInvalidateRect(hwnd, &arcl[i], FALSE);
+         continue;
+      }
+      GpiSetBitmapBits(hpsMem, arcl[i].yBottom, arcl[i].yTop - arcl[i].yBottom,
+                       pBmpBuffer + arcl[i].yBottom * BMP_LINE, pbmi);
+      DisplayVbuf(hwnd, hpsDrawBMPBuffer, arcl[i], 0);
+   }
+}
+
+/* Clip a rectangle in device coordinates to the bitmap */
+static int ClipDev(int *px, int *py, int *pcx, int *pcy)
+{  if(*px < 0) { *pcx += *px; *px = 0; }
+   if(*py < 0) { *pcy += *py; *py = 0; }
+   if(*px + *pcx > bmp.cx) *pcx = bmp.cx - *px;
+   if(*py + *pcy > bmp.cy) *pcy = bmp.cy - *py;
+   return *pcx > 0 && *pcy > 0;
+}
+
+/* Device y runs down, the bitmap is bottom up */
+#define DEV_LINE(y)  (pBmpBuffer + (bmp.cy - 1 - (y)) * BMP_LINE)
+
+static int PMDevFillRect(int x, int y, int cx, int cy, unsigned long color)
+{  PBYTE pLine, p;
+   int   i, cbPixel = BMP_PIXEL;
+
+   if(!ClipDev(&x, &y, &cx, &cy))
+      return 1;
+   /* one line pixel by pixel, the rest copied from it */
+   pLine = DEV_LINE(y) + x * cbPixel;
+   for(i = 0, p = pLine; i < cx; i++, p += cbPixel)
+   {  p[0] = (BYTE)color;
+      p[1] = (BYTE)(color >> 8);
+      p[2] = (BYTE)(color >> 16);
+   }
+   for(i = 1; i < cy; i++)
+      memcpy(DEV_LINE(y + i) + x * cbPixel, pLine, cx * cbPixel);
+   DamageAdd(x, bmp.cy - y - cy, x + cx, bmp.cy - y);
+   return 1;
+}
+
+static int PMDevCopyRect(int xSrc, int ySrc, int xDst, int yDst, int cx, int cy)
+{  int i, n, cbPixel = BMP_PIXEL;
+
+   if(xSrc < 0) { xDst -= xSrc; cx += xSrc; xSrc = 0; }
+   if(ySrc < 0) { yDst -= ySrc; cy += ySrc; ySrc = 0; }
+   if(xDst < 0) { xSrc -= xDst; cx += xDst; xDst = 0; }
+   if(yDst < 0) { ySrc -= yDst; cy += yDst; yDst = 0; }
+   if(xSrc + cx > bmp.cx) cx = bmp.cx - xSrc;
+   if(xDst + cx > bmp.cx) cx = bmp.cx - xDst;
+   if(ySrc + cy > bmp.cy) cy = bmp.cy - ySrc;
+   if(yDst + cy > bmp.cy) cy = bmp.cy - yDst;
+   if(cx <= 0 || cy <= 0)
+      return 1;
+
+   /* moving down: start with the last line so none is overwritten
+      before it is copied; memmove takes care of overlap within a line */
+   for(n = 0; n < cy; n++)
+   {  i = yDst > ySrc ? cy - 1 - n : n;
+      memmove(DEV_LINE(yDst + i) + xDst * cbPixel,
+              DEV_LINE(ySrc + i) + xSrc * cbPixel, cx * cbPixel);
+   }
+   DamageAdd(xDst, bmp.cy - yDst - cy, xDst + cx, bmp.cy - yDst);
+   return 1;
+}
+
+static int PMDevScroll(int x, int y, int cx, int cy, int dx, int dy,
+                       unsigned long fill)
+{  int adx = dx < 0 ? -dx : dx;
+   int ady = dy < 0 ? -dy : dy;
+   int xSrc, ySrc;
+
+   if(adx >= cx || ady >= cy)
+      return PMDevFillRect(x, y, cx, cy, fill);
+
+   /* the part that stays inside the rectangle, then the uncovered strips */
+   xSrc = x + (dx < 0 ? adx : 0);
+   ySrc = y + (dy < 0 ? ady : 0);
+   PMDevCopyRect(xSrc, ySrc, xSrc + dx, ySrc + dy, cx - adx, cy - ady);
+
+   if(dy > 0) PMDevFillRect(x, y, cx, dy, fill);
+   if(dy < 0) PMDevFillRect(x, y + cy - ady, cx, ady, fill);
+   if(dx > 0) PMDevFillRect(x, y, dx, cy, fill);
+   if(dx < 0) PMDevFillRect(x + cx - adx, y, adx, cy, fill);
+   return 1;
+}
+
+/* Called by the server, not on the window thread */
+static int PMDevPresent(void)
+{  int post;
+
+   DosRequestMutexSem(hmtxDamage, SEM_INDEFINITE_WAIT);
+   post = nDamage && !fPresentPosted;
+   if(post)
+      fPresentPosted = 1;
+   DosReleaseMutexSem(hmtxDamage);
+
+   if(post)
+      WinPostMsg(hwndClient, MYM_PRESENT, NULL, NULL);
+   return 1;
+}
+
+/*+---------------------------------+*/
+/*| Text.                           |*/
+/*+---------------------------------+*/
+/* The glyphs are those of the default font of the PM we run on. GPI
+   can only be used on this thread, so they are all drawn once, when
+   the bitmap is set up, and Glyph() just hands them out. PM's bitmap
+   fonts come out solid (255) or clear (0) */
+#define PMDEV_NGLYPHS 256
+
+static FPM_GLYPH aGlyph[PMDEV_NGLYPHS];
+static PBYTE     pGlyphMasks = NULL;  /* cxGlyph * cyGlyph bytes a glyph */
+static int       cxGlyph, cyGlyph;
+
+static void GlyphsMake(void)
+{  PSZ   pszData[4] = { "Display", NULL, NULL, NULL };
+   SIZEL sizl = { 0, 0 };
+   FONTMETRICS fm;
+   BITMAPINFOHEADER2 bmih;
+   BITMAPINFO2 bmi;
+   HDC   hdc;
+   HPS   hps;
+   HBITMAP hbmGlyph;
+   LONG  alWidth[PMDEV_NGLYPHS];
+   POINTL ptl;
+   RECTL rcl;
+   PBYTE pBits, pMask, p;
+   CHAR  ch;
+   int   cbLine, i, x, y;
+
+   hdc = DevOpenDC(habAnchor, OD_MEMORY, "*", 4, (PDEVOPENDATA)pszData, NULLHANDLE);
+   hps = GpiCreatePS(habAnchor, hdc, &sizl, PU_PELS | GPIA_ASSOC | GPIT_MICRO);
+   GpiQueryFontMetrics(hps, sizeof(fm), &fm);
+   GpiQueryWidthArray(hps, 0, PMDEV_NGLYPHS, alWidth);
+   cxGlyph = fm.lMaxCharInc;
+   cyGlyph = fm.lMaxAscender + fm.lMaxDescender;
+
+   memset(&bmih, 0, sizeof(bmih));
+   bmih.cbFix = sizeof(bmih);
+   bmih.cx = cxGlyph;
+   bmih.cy = cyGlyph;
+   bmih.cPlanes = 1;
+   bmih.cBitCount = 24;
+   memset(&bmi, 0, sizeof(bmi));
+   memcpy(&bmi, &bmih, sizeof(bmih));
+   hbmGlyph = GpiCreateBitmap(hps, &bmih, 0L, NULL, NULL);
+   GpiSetBitmap(hps, hbmGlyph);
+   GpiCreateLogColorTable(hps, 0, LCOLF_RGB, 0, 0, NULL);
+   GpiSetColor(hps, 0xFFFFFF);
+   GpiSetBackMix(hps, BM_LEAVEALONE);
+
+   cbLine = ((cxGlyph * 24 + 31) / 32) * 4;
+   pBits = (PBYTE)malloc(cbLine * cyGlyph);
+   pGlyphMasks = (PBYTE)malloc(PMDEV_NGLYPHS * cxGlyph * cyGlyph);
+   if(pBits == NULL || pGlyphMasks == NULL || hbmGlyph == GPI_ERROR)
+   {  free(pGlyphMasks);
+      pGlyphMasks = NULL;
+   }
+
+   for(i = 0; pGlyphMasks && i < PMDEV_NGLYPHS; i++)
+   {  rcl.xLeft = rcl.yBottom = 0;
+      rcl.xRight = cxGlyph;
+      rcl.yTop = cyGlyph;
+      WinFillRect(hps, &rcl, 0);
+      ptl.x = 0;
+      ptl.y = fm.lMaxDescender;
+      ch = (CHAR)i;
+      GpiCharStringAt(hps, &ptl, 1, &ch);
+      GpiQueryBitmapBits(hps, 0, cyGlyph, pBits, &bmi);
+
+      /* white on black, so any one channel is the coverage */
+      pMask = pGlyphMasks + i * cxGlyph * cyGlyph;
+      for(y = 0; y < cyGlyph; y++)
+      {  p = pBits + (cyGlyph - 1 - y) * cbLine;  /* bottom up */
+         for(x = 0; x < cxGlyph; x++, p += 3)
+            *pMask++ = p[1];
+      }
+      aGlyph[i].cx = cxGlyph;
+      aGlyph[i].cy = cyGlyph;
+      aGlyph[i].xOrg = 0;
+      aGlyph[i].yOrg = fm.lMaxAscender;
+      aGlyph[i].dx = alWidth[i];
+   }
+
+   free(pBits);
+   GpiSetBitmap(hps, NULLHANDLE);
+   if(hbmGlyph != GPI_ERROR)
+      GpiDeleteBitmap(hbmGlyph);
+   GpiDestroyPS(hps);
+   DevCloseDC(hdc);
+}
+
+static int PMDevGlyph(int font, int size, int ch, PFPM_GLYPH pg,
+                      unsigned char *pMask, int cbMask)
+{  int cb = cxGlyph * cyGlyph;
+
+   if(font != FPM_FONT_DEFAULT || size != FPM_FONT_DEFAULT ||
+      ch < 0 || ch >= PMDEV_NGLYPHS || pGlyphMasks == NULL)
+      return 0;
+   *pg = aGlyph[ch];
+   if(pMask)
+   {  if(cbMask < cb)
+         return 0;
+      memcpy(pMask, pGlyphMasks + ch * cb, cb);
+   }
+   return 1;
+}
+
+static int PMDevBlendMask(int x, int y, int cx, int cy,
+                          const unsigned char *pMask, int stride,
+                          unsigned long color)
+{  const unsigned char *m;
+   PBYTE p;
+   int   i, j, k, a, cbPixel = BMP_PIXEL;
+   BYTE  c[3];
+
+   /* clip, moving into the mask as well */
+   if(x < 0) { pMask -= x; cx += x; x = 0; }
+   if(y < 0) { pMask -= y * stride; cy += y; y = 0; }
+   if(!ClipDev(&x, &y, &cx, &cy))
+      return 1;
+
+   c[0] = (BYTE)color;
+   c[1] = (BYTE)(color >> 8);
+   c[2] = (BYTE)(color >> 16);
+   for(i = 0; i < cy; i++, pMask += stride)
+   {  m = pMask;
+      p = DEV_LINE(y + i) + x * cbPixel;
+      for(j = 0; j < cx; )
+      {  /* most of a text mask is clear: skip it four pels at a time */
+         if(j + 4 <= cx && (m[j] | m[j + 1] | m[j + 2] | m[j + 3]) == 0)
+         {  j += 4;
+            continue;
+         }
+         a = m[j];
+         if(a == 255)
+         {  p[j * cbPixel]     = c[0];
+            p[j * cbPixel + 1] = c[1];
+            p[j * cbPixel + 2] = c[2];
+         }
+         else if(a)
+         {  for(k = 0; k < 3; k++)
+               p[j * cbPixel + k] += (BYTE)(((c[k] - p[j * cbPixel + k]) * a) / 255);
+         }
+         j++;
+      }
+   }
+   DamageAdd(x, bmp.cy - y - cy, x + cx, bmp.cy - y);
+   return 1;
+}
+
+/* NULL until the first WM_PAINT has sized the bitmap; the server asks
+   again until it gets the table */
+PFPM_ACCEL FPM_DeviceQueryAccel(void)
+{
+   return PMAccel.cb ? &PMAccel : NULL;
+}
+
 #if POKA
 
 int VideoPowerPresentation::Draw(HWND hwnd, RECTL rect, HPS hps, int x,int y)
@@ -533,6 +909,18 @@ pbmi->cclrImportant = 0;
 
 //      prgb = (RGB2 *) (((PBYTE)pbmi)+bmp.cbFix);
 
+    PMAccel.fl = 0;
+    PMAccel.cx = bmp.cx;
+    PMAccel.cy = bmp.cy;
+    PMAccel.FillRect = PMDevFillRect;
+    PMAccel.CopyRect = PMDevCopyRect;
+    PMAccel.Scroll = PMDevScroll;
+    PMAccel.Present = PMDevPresent;
+    GlyphsMake();
+    PMAccel.Glyph = PMDevGlyph;
+    PMAccel.BlendMask = PMDevBlendMask;
+    PMAccel.cb = sizeof(FPM_ACCEL);
+
    return 0;
 }
 
@@ -542,7 +930,11 @@ void close_Vbuff(void)
     free(pBmpBuffer);
     pBmpBuffer = NULL;
 
-  if(hbm) GpiDeleteBitmap(hbm);
+  PMAccel.cb = 0;
+  if(hbm)
+  {  GpiSetBitmap(hpsMem,0);
+     GpiDeleteBitmap(hbm);
+  }
   hbm = 0;
   if(pbmi)
       free( pbmi);
@@ -563,31 +955,31 @@ void DisplayVbuf(HWND hwnd, HPS  hpsBuffer, RECTL rect, int isChange)
         return;
     }
 */
-    /* Create a bit map that is compatible with the display.            */
+    /* The bitmap is made once and stays selected into hpsMem; after the
+       first full upload DamageShow sends only the lines that changed */
     if (isChange)
     {
-        if (hbm) GpiDeleteBitmap(hbm);
-        hbm = GpiCreateBitmap(hpsMem, &bmp, CBM_INIT, (PBYTE) pBmpBuffer, pbmi);
-        GpiSetBitmap(hpsMem,hbm);
-        GpiSetBitmapBits(hpsMem, 0,bmp.cy,(PBYTE) pBmpBuffer, pbmi); //?????
-    }
-    else
-    {
-        // GpiSetBitmap(hpsBuffer,hbm);
-        // ii = GpiSetBitmapBits(hpsBuffer, 0,bmp.cy,(PBYTE) pBmpBuffer, pbmi);
-        GpiSetBitmap(hpsMem,hbm);
+        if (hbm == 0)
+        {   hbm = GpiCreateBitmap(hpsMem, &bmp, 0L, NULL, NULL);
+            GpiSetBitmap(hpsMem,hbm);
+        }
         GpiSetBitmapBits(hpsMem, 0,bmp.cy,(PBYTE) pBmpBuffer, pbmi);
     }
 
+    if (rect.xLeft < 0) rect.xLeft = 0;
+    if (rect.yBottom < 0) rect.yBottom = 0;
+    if (rect.xRight > bmp.cx) rect.xRight = bmp.cx;
+    if (rect.yTop > bmp.cy) rect.yTop = bmp.cy;
+    if (rect.xLeft >= rect.xRight || rect.yBottom >= rect.yTop)
+        return;
+
+    /* only the rectangle asked for, from the same place in the bitmap */
     aptl[0].x = rect.xLeft;       /* Lower-left corner of destination rectangle  */
     aptl[0].y = rect.yBottom;     /* Lower-left corner of destination rectangle  */
     aptl[1].x = rect.xRight;      /* Upper-right corner of destination rectangle */
     aptl[1].y = rect.yTop;        /* Upper-right corner of destination rectangle */
-    /* Source-rectangle dimensions (in device coordinates)                       */
-    aptl[2].x = 0;                /* Lower-left corner of source rectangle       */
-    aptl[2].y = 0;                /* Lower-left corner of source rectangle       */
-    aptl[3].x = bmp.cx;           //  bmp.cx;
-    aptl[3].y = bmp.cy;           // bmp.cy;
+    aptl[2].x = rect.xLeft;       /* Lower-left corner of source rectangle       */
+    aptl[2].y = rect.yBottom;     /* Lower-left corner of source rectangle       */
 
     pbmi->cy = bmp.cy;
 
@@ -602,8 +994,6 @@ void DisplayVbuf(HWND hwnd, HPS  hpsBuffer, RECTL rect, int isChange)
 //            ierr++;
 //       }
 
-    GpiSetBitmap(hpsMem,0);
-
 //  rc = GpiDeleteBitmap(hbm);
 }
 
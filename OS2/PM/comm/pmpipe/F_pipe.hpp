@@ -10,6 +10,7 @@
 #include <FreePM.hpp>
 
 #include "F_config.hpp"
+#include "F_shm.hpp"
 
 //#include <bsedos.h>
 //#include <bseerr.h>
@@ -67,9 +68,11 @@ public:
    int     mode;          /* SERVER_MODE - p  pp, CLIENT_MODE -   */
    ULONG ulActionTaken;
    int    nInstanse;
+   class ShmChannel *pShm; /* shared memory transport, NULL while on the pipe */
 
    NPipe()
    {  Hpipe=NULL;
+      pShm = NULL;
       name[0]=0;
       ulOpenMode   = DEFAULT_OPEN_MODE; /* DEFAULT_MAKE_MODE; for server */
       ulPipeMode   = DEFAULT_PIPE_MODE;
@@ -83,6 +86,7 @@ public:
    {
       strcpy(name, _name);
       Hpipe=NULL;
+      pShm = NULL;
       ulOpenMode   = DEFAULT_MAKE_MODE;
       ulPipeMode   = DEFAULT_PIPE_MODE;
       ulOutBufSize = DEFAULT_OUTB_SIZE;
@@ -98,6 +102,7 @@ public:
    {
       strcpy(name, _name);
       Hpipe=NULL;
+      pShm = NULL;
       ulOpenMode   = DEFAULT_MAKE_MODE;
       ulPipeMode   = DEFAULT_PIPE_MODE;
       ulOutBufSize = DEFAULT_OUTB_SIZE;
@@ -117,6 +122,7 @@ public:
    {
       strcpy(name, _name);
       Hpipe=NULL;
+      pShm = NULL;
       ulOpenMode   = OpenMode;
       ulPipeMode   = PipeMode;
       ulOutBufSize = OutBufSize;
@@ -129,7 +135,9 @@ public:
    }
 
    ~NPipe()
-   { if(Hpipe)
+   { delete pShm;
+     pShm = NULL;
+     if(Hpipe)
      {  DosClose(Hpipe);
      }
      Hpipe = NULL;
@@ -162,7 +170,9 @@ public:
    }
 
    int Close(void)
-   { if(Hpipe)
+   { delete pShm;
+     pShm = NULL;
+     if(Hpipe)
      {  DosClose(Hpipe);
      }
      Hpipe = NULL;
@@ -246,6 +256,63 @@ public:
       }
       return  rc;
    }
+/* Right after the handshake the client offers a shared memory area
+   (or nothing, for a remote server) and the server answers 0 if it
+   attached. From then on both ends talk through pShm; if anything
+   failed they both stay on the pipe */
+   int ShmAttachClient(int local)
+   {  struct ShmAttach req;
+      int rc, reply = -1;
+      ULONG ulBytesDone;
+
+      memset(&req, 0, sizeof(req));
+      if(local)
+      {  pShm = new ShmChannel(Hpipe, CLIENT_MODE);
+         if(pShm->Create())
+         {  delete pShm;
+            pShm = NULL;
+         } else {
+            req.magic = SHM_MAGIC;
+            strcpy(req.name, pShm->name);
+         }
+      }
+      rc = DosWrite(Hpipe, &req, sizeof(req), &ulBytesDone);
+      if(!rc)
+         rc = DosRead(Hpipe, &reply, sizeof(reply), &ulBytesDone);
+      if(rc || reply)
+      {  delete pShm;
+         pShm = NULL;
+      }
+      return rc;
+   }
+
+   int ShmAttachServer(void)
+   {  struct ShmAttach req;
+      int rc, reply = 0;
+      ULONG ulBytesDone;
+
+      rc = DosRead(Hpipe, &req, sizeof(req), &ulBytesDone);
+      if(rc)
+         return rc;
+      if(ulBytesDone != sizeof(req))
+         return HAND_SHAKE_ERROR;
+      if(req.magic == SHM_MAGIC)
+      {  req.name[SHM_NAME_LEN - 1] = 0;
+         pShm = new ShmChannel(Hpipe, SERVER_MODE);
+         reply = pShm->Open(req.name);
+         if(reply)
+         {  delete pShm;
+            pShm = NULL;
+         }
+      }
+      rc = DosWrite(Hpipe, &reply, sizeof(reply), &ulBytesDone);
+      if(rc)
+      {  delete pShm;
+         pShm = NULL;
+      }
+      return rc;
+   }
+
 /* ᫠  ncmd  묨 data */
    int SendCmdToServer(int ncmd, int data)
    {  char str[32];
@@ -255,6 +322,8 @@ public:
       pdata = (int *)&str[0];
       *pdata = ncmd;
       pdata[1] = data;
+      if(pShm)
+         return pShm->Write(pdata, sizeof(int)*2);
       rc = DosWrite(Hpipe,(void *)pdata,sizeof(int)*2, &ulBytesDone);
       if(ulBytesDone != sizeof(int)*2  && rc == 0)
          rc = -1;
@@ -264,6 +333,8 @@ public:
    int SendDataToServer(void *data, int len)
    {   int rc;
        ULONG ulBytesDone;
+     if(pShm)
+        return pShm->Write(data, len);
      if(len > 0x8000)
         return SendLongDataToServer(data, len);
 
@@ -298,6 +369,8 @@ public:
    { int rc,raz=0;
      int len0;
      char *pdata;
+     if(pShm)
+        return pShm->Read(data, len, maxlen);
      if(maxlen > 0x8000)
         return RecvLongDataFromClient(data, len, maxlen);
 
@@ -359,6 +432,16 @@ M:   rc =   DosRead(Hpipe, data, maxlen,(PULONG) &len0);
       maxlen = sizeof(int) * 2;
       len = 0;
 
+      if(pShm)
+      {  rc = pShm->Read(pdata, &len, maxlen);
+         pIntData = (int *)&str[0];
+         *ncmd = rc ? 0 : pIntData[0];
+         *data = pIntData[1];
+         if(rc == ERROR_MORE_DATA || (rc == 0 && len != maxlen))
+            rc = -1;
+         return rc;
+      }
+
 M:
       rc =  DosRead(Hpipe, (void *)pdata, maxlen,&ulBytesDone);
       if(rc == ERROR_MORE_DATA)
@@ -0,0 +1,272 @@
+/* F_shm.hpp */
+/* class ShmChannel: shared memory transport for one client connection.
+   The pipe still carries the handshake and the attach request; after
+   that commands and data go through two byte rings in a named shared
+   memory object, one ring each way. Records are a length word and the
+   bytes, so a read returns what one write sent, as with a message pipe.
+   Event semaphores are rung only when the other side said it is going
+   to sleep, so a burst of fire-and-forget commands costs one post. */
+#ifndef FREEPM_SHM
+  #define FREEPM_SHM
+
+#include <stdio.h>
+#include <string.h>
+
+#define SHM_BASE_NAME    "\\SHAREMEM\\FREEPM\\"
+#define SHM_MAGIC        0x314D4853    /* "SHM1" */
+#define SHM_RING_SIZE    0x10000       /* bytes each way, power of 2 */
+#define SHM_POLL         1000          /* ms between checks that the pipe is still up */
+#define SHM_NAME_LEN     64
+
+/* builtin.h's __lxchg is not atomic, so take the real instruction.
+   xchg is locked, so it also orders the copy ahead of the index store */
+ULONG ShmXchg(volatile ULONG *p, ULONG ul);
+#pragma aux ShmXchg = \
+  "xchg [edx], eax" \
+  parm [edx] [eax] \
+  value [eax] \
+  modify exact [eax];
+
+struct ShmRing
+{  volatile ULONG head;     /* bytes ever written */
+   volatile ULONG tail;     /* bytes ever read */
+   volatile ULONG rdWait;   /* reader is about to sleep on hevData */
+   volatile ULONG wrWait;   /* writer is about to sleep on hevSpace */
+   HEV   hevData;           /* shared, so the handle is the same in both processes */
+   HEV   hevSpace;
+   char  data[SHM_RING_SIZE];
+};
+
+struct ShmArea
+{  ULONG   magic;
+   ShmRing ring[2];         /* [0] client to server, [1] server to client */
+};
+
+/* sent through the pipe by the client right after the handshake */
+struct ShmAttach
+{  ULONG magic;             /* SHM_MAGIC, or 0 to stay on the pipe */
+   char  name[SHM_NAME_LEN];
+};
+
+class ShmChannel
+{
+   ShmArea *pArea;
+   ShmRing *pOut, *pIn;
+   ULONG    recLeft;        /* bytes of the current inbound record still unread */
+   HPIPE    Hpipe;          /* watched to notice the other side going away */
+   int      mode;
+   int      nsem;           /* semaphores created or opened so far */
+public:
+   char name[SHM_NAME_LEN];
+
+   ShmChannel(HPIPE _Hpipe, int _mode)
+   {  pArea = NULL;
+      pOut = pIn = NULL;
+      recLeft = 0;
+      Hpipe = _Hpipe;
+      mode = _mode;
+      nsem = 0;
+      name[0] = 0;
+   }
+
+   ~ShmChannel()
+   {  Detach();
+   }
+
+/* client side: make the area and its semaphores */
+   int Create(void)
+   {  PTIB ptib;
+      PPIB ppib;
+      int i, rc;
+
+      /* the pipe handle keeps names apart within the process */
+      DosGetInfoBlocks(&ptib, &ppib);
+      sprintf(name, SHM_BASE_NAME "%lX.%lX", ppib->pib_ulpid, (ULONG)Hpipe);
+      rc = DosAllocSharedMem((PPVOID)&pArea, name, sizeof(ShmArea),
+                             PAG_COMMIT | PAG_READ | PAG_WRITE);
+      if(rc)
+      {  pArea = NULL;
+         return rc;
+      }
+      for(i = 0; i < 2; i++)
+      {  rc = DosCreateEventSem(NULL, &pArea->ring[i].hevData, DC_SEM_SHARED, FALSE);
+         if(rc)
+            return rc;
+         nsem++;
+         rc = DosCreateEventSem(NULL, &pArea->ring[i].hevSpace, DC_SEM_SHARED, FALSE);
+         if(rc)
+            return rc;
+         nsem++;
+      }
+      pArea->magic = SHM_MAGIC;
+      pOut = &pArea->ring[0];
+      pIn  = &pArea->ring[1];
+      return 0;
+   }
+
+/* server side: get at the client's area and open its semaphores */
+   int Open(char *_name)
+   {  HEV hev;
+      int i, rc;
+
+      strncpy(name, _name, SHM_NAME_LEN - 1);
+      name[SHM_NAME_LEN - 1] = 0;
+      rc = DosGetNamedSharedMem((PPVOID)&pArea, name, PAG_READ | PAG_WRITE);
+      if(rc)
+      {  pArea = NULL;
+         return rc;
+      }
+      if(pArea->magic != SHM_MAGIC)
+         return ERROR_INVALID_DATA;
+      for(i = 0; i < 2; i++)
+      {  hev = pArea->ring[i].hevData;
+         if((rc = DosOpenEventSem(NULL, &hev)) != 0)
+            return rc;
+         nsem++;
+         hev = pArea->ring[i].hevSpace;
+         if((rc = DosOpenEventSem(NULL, &hev)) != 0)
+            return rc;
+         nsem++;
+      }
+      pOut = &pArea->ring[1];
+      pIn  = &pArea->ring[0];
+      return 0;
+   }
+
+   void Detach(void)
+   {  int i;
+
+      if(pArea == NULL)
+         return;
+      for(i = 0; i < nsem; i++)
+         DosCloseEventSem(i & 1 ? pArea->ring[i / 2].hevSpace : pArea->ring[i / 2].hevData);
+      nsem = 0;
+      DosFreeMem(pArea);
+      pArea = NULL;
+      pOut = pIn = NULL;
+   }
+
+/* send one record */
+   int Write(void *data, int len)
+   {  ULONG ul = len;
+      int rc;
+
+      if(len < 0)
+         return ERROR_INVALID_PARAMETER;
+      rc = Put((char *)&ul, sizeof(ul));
+      if(!rc)
+         rc = Put((char *)data, len);
+      return rc;
+   }
+
+/* receive one record, or the first maxlen bytes of it with ERROR_MORE_DATA;
+   the rest then comes with the next call */
+   int Read(void *data, int *len, int maxlen)
+   {  ULONG n;
+      int rc;
+
+      *len = 0;
+      if(recLeft == 0)
+      {  rc = Get((char *)&recLeft, sizeof(recLeft));
+         if(rc)
+            return rc;
+      }
+      n = recLeft;
+      if(maxlen >= 0 && n > (ULONG)maxlen)
+         n = maxlen;
+      rc = Get((char *)data, n);
+      if(rc)
+         return rc;
+      recLeft -= n;
+      *len = n;
+      return recLeft ? ERROR_MORE_DATA : NO_ERROR;
+   }
+
+private:
+   int Alive(void)
+   {  AVAILDATA avail;
+      ULONG cb, state;
+      char c;
+
+      if(DosPeekNPipe(Hpipe, &c, 0, &cb, &avail, &state))
+         return 0;
+      return state == NP_STATE_CONNECTED;
+   }
+
+/* sleep on hev until *pcond stops being true. The flag is set with a
+   locked xchg before the last look at the ring and the other side
+   stores its index with one before looking at the flag, so at least
+   one of the two sees the other and no wakeup is lost */
+   int Sleep(volatile ULONG *flag, HEV hev, volatile ULONG *a, volatile ULONG *b, ULONG diff)
+   {  ULONG cnt;
+      int rc;
+
+      for(;;)
+      {  if(*a - *b != diff)
+            return 0;
+         DosResetEventSem(hev, &cnt);
+         ShmXchg(flag, 1);
+         rc = 0;
+         if(*a - *b == diff)
+            rc = DosWaitEventSem(hev, SHM_POLL);
+         ShmXchg(flag, 0);
+         if(rc == ERROR_TIMEOUT && !Alive())
+            return ERROR_BROKEN_PIPE;
+      }
+   }
+
+   int Put(char *src, ULONG len)
+   {  ULONG head, n, off;
+      int rc;
+
+      while(len)
+      {  /* full when head - tail == SHM_RING_SIZE */
+         rc = Sleep(&pOut->wrWait, pOut->hevSpace, &pOut->head, &pOut->tail, SHM_RING_SIZE);
+         if(rc)
+            return rc;
+         head = pOut->head;
+         off  = head & (SHM_RING_SIZE - 1);
+         n    = SHM_RING_SIZE - (head - pOut->tail);
+         if(n > SHM_RING_SIZE - off)
+            n = SHM_RING_SIZE - off;
+         if(n > len)
+            n = len;
+         memcpy(&pOut->data[off], src, n);
+         ShmXchg(&pOut->head, head + n);
+         if(pOut->rdWait)
+            DosPostEventSem(pOut->hevData);
+         src += n;
+         len -= n;
+      }
+      return 0;
+   }
+
+   int Get(char *dst, ULONG len)
+   {  ULONG tail, n, off;
+      int rc;
+
+      while(len)
+      {  /* empty when head - tail == 0 */
+         rc = Sleep(&pIn->rdWait, pIn->hevData, &pIn->head, &pIn->tail, 0);
+         if(rc)
+            return rc;
+         tail = pIn->tail;
+         off  = tail & (SHM_RING_SIZE - 1);
+         n    = pIn->head - tail;
+         if(n > SHM_RING_SIZE - off)
+            n = SHM_RING_SIZE - off;
+         if(n > len)
+            n = len;
+         memcpy(dst, &pIn->data[off], n);
+         ShmXchg(&pIn->tail, tail + n);
+         if(pIn->wrWait)
+            DosPostEventSem(pIn->hevSpace);
+         dst += n;
+         len -= n;
+      }
+      return 0;
+   }
+};
+
+#endif
+    /* FREEPM_SHM */
@@ -53,6 +53,8 @@ static int nxDefault=800, nyDefault=600,  bytesPerPixelDefault=4;
 /*|     local constants.            |*/
 /*+---------------------------------+*/
 char PipeName[256];
+// shared memory can only be offered to a server on this machine
+static int ShmLocal = 1;
 
 // pipe object
 class NPipe *pF_pipe;
@@ -120,6 +122,7 @@ extern "C" APIRET APIENTRY _InitServerConnection(char *ExternMachine, ULONG *obj
      strcpy(buf, FREEPM_BASE_PIPE_NAME);
   }
   strcpy(PipeName, buf);
+  ShmLocal = (ExternMachine == NULL);
 
   pF_pipe = new NPipe(PipeName, CLIENT_MODE);
 
@@ -137,6 +140,16 @@ extern "C" APIRET APIENTRY _InitServerConnection(char *ExternMachine, ULONG *obj
 
       return rc;
   }
+
+  rc = pF_pipe->ShmAttachClient(ShmLocal);
+
+  if (rc)
+  {
+      pF_pipe->Close();
+      delete pF_pipe;
+
+      return rc;
+  }
   //todo
   *obj = (APIRET)pF_pipe;
 
@@ -179,7 +192,9 @@ extern "C" APIRET APIENTRY  _F_SendCmdToServer(void *recvobj, int ncmd, int data
            if(rc ==  HAND_SHAKE_ERROR)
            {   debug(1, 0)("Error handshake %i, pipe %s\n",rc,PipeName);
            } else {
-               break;
+               rc = ((class NPipe *)(recvobj))->ShmAttachClient(ShmLocal);
+               if(!rc)
+                   break;
            }
          }
       }
@@ -259,6 +274,9 @@ extern "C" APIRET APIENTRY  _F_SendDataToServer(void *recvobj, void *data, int l
 extern "C" APIRET APIENTRY  _F_SendDataToClient(void *recvobj, void *data, int len)
 {
    int rc;
+   // a shared memory channel belongs to the one thread serving its client
+   if(((class NPipe *)(recvobj))->pShm)
+      return ((class NPipe *)(recvobj))->SendDataToServer(data,  len);
    LOCK(AccessF_pipe_srv);
 
    rc = ((class NPipe *)(recvobj))->SendDataToServer(data,  len);
@@ -284,6 +302,8 @@ extern "C" APIRET APIENTRY  _F_RecvDataFromServer(void *recvobj, void *data, int
 extern "C" APIRET APIENTRY _F_RecvCmdFromClient(void *recvobj, int *ncmd, int *data)
 {
     int rc;
+    if(((class NPipe *)(recvobj))->pShm)
+       return ((class NPipe *)(recvobj))->RecvCmdFromClient(ncmd, data);
     LOCK(AccessF_pipe_srv);
 
     rc = ((class NPipe *)(recvobj))->RecvCmdFromClient(ncmd, data);
@@ -294,6 +314,8 @@ extern "C" APIRET APIENTRY _F_RecvCmdFromClient(void *recvobj, int *ncmd, int *d
 
 extern "C" APIRET APIENTRY _F_RecvDataFromClient(void *recvobj, void *sqmsg, int *l, int size)
 {    int rc;
+    if(((class NPipe *)(recvobj))->pShm)
+       return ((class NPipe *)(recvobj))->RecvDataFromClient(sqmsg, l, size);
     LOCK(AccessF_pipe_srv);
 
      rc = ((class NPipe *)(recvobj))->RecvDataFromClient(sqmsg, l, size);
@@ -406,6 +428,15 @@ M_CONNECT:
         goto M_CONNECT;
     }
     debug(0, 2) ("Fs_ClientWork%i: HandShake pipe: %s Ok\n",threadNum,FreePM_pipe[threadNum]->name);
+    rc = FreePM_pipe[threadNum]->ShmAttachServer();
+    if(rc)
+    {   debug(0, 0) ("WARNING: Error attaching client on pipe %s: %i\n",FreePM_pipe[threadNum]->name,rc);
+
+        rc = DosDisConnectNPipe(FreePM_pipe[threadNum]->Hpipe);
+        goto M_CONNECT;
+    }
+    debug(0, 2) ("Fs_ClientWork%i: transport %s\n",threadNum,
+                 FreePM_pipe[threadNum]->pShm ? FreePM_pipe[threadNum]->pShm->name : "pipe");
 
 /***********/
    for(i = 0; i < FREEPMS_MAX_NUM_THREADS; i++)
@@ -20,6 +20,11 @@ char Buf2[0x100];
 
 UCHAR chRead = 0;
 
+/* stdin is read in blocks; readChar hands it out a byte at a time */
+UCHAR InBuf[0x10000];
+ULONG cbInBuf = 0;
+ULONG ulInPos = 0;
+
 ULONG fFinished = 0;
 
 LONG lAddFlag = RXQUEUE_UNSET;
@@ -118,6 +123,31 @@ void showMsg(ULONG ulMsgNum, PSZ pszTableName)
     exit(rc);
 }
 
+APIRET readChar(char *pc, ULONG *pcbActual)
+{
+    APIRET rc;
+
+    if (ulInPos == cbInBuf)
+    {
+        ulInPos = cbInBuf = 0;
+
+        if ( (rc = DosRead(0, InBuf, sizeof(InBuf), &cbInBuf)) )
+        {
+            return rc;
+        }
+
+        if (! cbInBuf)
+        {
+            *pcbActual = 0;
+            return NO_ERROR;
+        }
+    }
+
+    *pc = InBuf[ulInPos++];
+    *pcbActual = 1;
+    return NO_ERROR;
+}
+
 int readData(PSZ pBuf, ULONG cbBuf, ULONG *cbRead)
 {
     char c;
@@ -138,7 +168,7 @@ int readData(PSZ pBuf, ULONG cbBuf, ULONG *cbRead)
         chRead = 0;
     }
 
-    while (! DosRead(0, &c, 1, &cbActual) )
+    while (! readChar(&c, &cbActual) )
     {
         if (! cbActual)
         {
@@ -157,7 +187,7 @@ int readData(PSZ pBuf, ULONG cbBuf, ULONG *cbRead)
         {
             *cbRead = len;
 
-            if (! DosRead(0, &c, 1, &cbActual) )
+            if (! readChar(&c, &cbActual) )
             {
                 if (cbActual)
                 {
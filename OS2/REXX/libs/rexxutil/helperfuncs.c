@@ -47,6 +47,8 @@
 /******************************************************************************/
 
 #define INCL_DOSMISC
+#define INCL_DOSPROCESS
+#define INCL_DOSSEMAPHORES
 
 #include <os2.h>
 #include <stdio.h>
@@ -170,6 +172,144 @@ unsigned long SetRexxVariable(char *name, char *value)
 
 
 
+/********************************************************************
+* Semaphore handle cache                                            *
+*                                                                   *
+* Scripts often create or open the same named semaphore over and    *
+* over, and every DosCreate*Sem on an existing name fails before    *
+* the DosOpen*Sem that works.  The cache keeps the handles this     *
+* process has open with a count of the Sys*Sem references to each,  *
+* so that only the first open and the last close reach the system.  *
+*                                                                   *
+* The list is guarded by a private mutex, which needs no system     *
+* call unless two threads want it at once.                          *
+*********************************************************************/
+
+typedef struct _SEMENTRY {
+    struct _SEMENTRY *next;
+    int               type;          /* SEMTYPE_EVENT or _MUTEX      */
+    char             *name;          /* NULL if opened by handle     */
+    unsigned long     handle;
+    unsigned long     refs;
+} SEMENTRY;
+
+static SEMENTRY *semcache = NULL;
+static HMTX      semlock = NULLHANDLE;
+
+static void SemCacheLock(void)
+{
+    if (semlock == NULLHANDLE) {
+        DosEnterCritSec();
+        if (semlock == NULLHANDLE) DosCreateMutexSem(NULL, &semlock, 0, FALSE);
+        DosExitCritSec();
+    }
+
+    DosRequestMutexSem(semlock, SEM_INDEFINITE_WAIT);
+}
+
+static void SemCacheUnlock(void)
+{
+    DosReleaseMutexSem(semlock);
+}
+
+/* SemCacheFind - handle of an open named semaphore, with a reference
+   added, or 0 if it is not open yet */
+
+unsigned long SemCacheFind(int type, char *name)
+{
+    SEMENTRY      *e;
+    unsigned long  handle = 0;
+
+    SemCacheLock();
+
+    for (e = semcache; e; e = e->next) {
+        if (e->type == type && e->name && !stricmp(e->name, name)) {
+            e->refs++;
+            handle = e->handle;
+            break;
+        }
+    }
+
+    SemCacheUnlock();
+
+    return handle;
+}
+
+/* SemCacheAdd - record a semaphore just created or opened; if memory
+   runs out it is simply not cached */
+
+void SemCacheAdd(int type, char *name, unsigned long handle)
+{
+    SEMENTRY *e;
+
+    if ((e = malloc(sizeof(SEMENTRY))) == NULL) return;
+
+    e->type = type;
+    e->handle = handle;
+    e->refs = 1;
+    e->name = NULL;
+
+    if (name && (e->name = strdup(name)) == NULL) {
+        free(e);
+        return;
+    }
+
+    SemCacheLock();
+    e->next = semcache;
+    semcache = e;
+    SemCacheUnlock();
+}
+
+/* SemCacheAddRef - add a reference to a cached handle; FALSE if it is
+   not in the cache */
+
+bool SemCacheAddRef(unsigned long handle)
+{
+    SEMENTRY *e;
+
+    SemCacheLock();
+
+    for (e = semcache; e; e = e->next) {
+        if (e->handle == handle) {
+            e->refs++;
+            break;
+        }
+    }
+
+    SemCacheUnlock();
+
+    return e != NULL;
+}
+
+/* SemCacheRelease - drop a reference; TRUE if others remain and the
+   semaphore must stay open, FALSE if the caller should close it */
+
+bool SemCacheRelease(unsigned long handle)
+{
+    SEMENTRY **pe, *e;
+    bool       keep = FALSE;
+
+    SemCacheLock();
+
+    for (pe = &semcache; (e = *pe) != NULL; pe = &e->next) {
+        if (e->handle == handle) {
+            if (--e->refs) keep = TRUE;
+            else *pe = e->next;
+            break;
+        }
+    }
+
+    SemCacheUnlock();
+
+    if (e && !keep) {
+        free(e->name);
+        free(e);
+    }
+
+    return keep;
+}
+
+
 void logmessage( char *entry)
 {
     int outFile = 0;
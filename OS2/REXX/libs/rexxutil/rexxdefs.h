@@ -163,6 +163,20 @@ bool string2ulong(char *string, unsigned long *number);
 
 unsigned long SetRexxVariable(char *name, char *value);
 
+/*********************************************************************/
+/* Semaphore handle cache                                            */
+/*   Each entry is one open of an event or mutex semaphore, shared   */
+/*   by the Sys*Sem calls that ask for the same name or handle.      */
+/*********************************************************************/
+
+#define  SEMTYPE_EVENT  0
+#define  SEMTYPE_MUTEX  1
+
+unsigned long SemCacheFind(int type, char *name);
+void SemCacheAdd(int type, char *name, unsigned long handle);
+bool SemCacheAddRef(unsigned long handle);
+bool SemCacheRelease(unsigned long handle);
+
 void logmessage( char *entry);
 
 #define RXNULLSTRING(r)     (!(r).strptr)
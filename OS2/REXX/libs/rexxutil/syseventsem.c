@@ -95,15 +95,24 @@ unsigned long SysCreateEventSem(unsigned char *name,
 
     if (numargs == 1) {
 
-        rc = DosCreateEventSem(args[0].strptr, &handle, DC_SEM_SHARED, 1);
-
-        /* may already be created try to open it */
-        if (rc != NO_ERROR) {
-            rc = DosOpenEventSem(args[0].strptr, &handle);
+        /* already open in this process - share the handle */
+        if ((handle = SemCacheFind(SEMTYPE_EVENT, args[0].strptr)) != NULLHANDLE) {
+            rc = NO_ERROR;
+        } else {
+            rc = DosCreateEventSem(args[0].strptr, &handle, DC_SEM_SHARED, 1);
+
+            /* may already be created try to open it */
+            if (rc != NO_ERROR) {
+                rc = DosOpenEventSem(args[0].strptr, &handle);
+            }
+
+            if (rc == NO_ERROR) SemCacheAdd(SEMTYPE_EVENT, args[0].strptr, handle);
         }
 
     } else {                                /* unnamed semaphore */
         rc = DosCreateEventSem(NULL, &handle, DC_SEM_SHARED, 1);
+
+        if (rc == NO_ERROR) SemCacheAdd(SEMTYPE_EVENT, NULL, handle);
     }
 
     if (!handle && rc != NO_ERROR) retstr->strlength = 0;  /* return null string */
@@ -141,7 +150,12 @@ unsigned long SysOpenEventSem(unsigned char *name,
 
                                        /* get a binary handle        */
                                        /* try to open it             */
-    rc = DosOpenEventSem(NULL, &handle);
+    if (SemCacheAddRef(handle)) rc = NO_ERROR;
+    else {
+        rc = DosOpenEventSem(NULL, &handle);
+
+        if (rc == NO_ERROR) SemCacheAdd(SEMTYPE_EVENT, NULL, handle);
+    }
 
     RETVAL(rc)
 }
@@ -171,7 +185,9 @@ unsigned long SysCloseEventSem(unsigned char *name,
 
     if (!string2ulong(args[0].strptr, &handle)) return INVALID_ROUTINE;
 
-    rc = DosCloseEventSem(handle);
+    /* other references in this process keep it open */
+    if (SemCacheRelease(handle)) rc = NO_ERROR;
+    else rc = DosCloseEventSem(handle);
 
     RETVAL(rc)
 }
@@ -70,6 +70,33 @@
 #include <rexxdefs.h>  // rexxsaa.h include in this header
 
 
+/*********************************************************************/
+/* SysFileTree asks DosFindFirst/DosFindNext for as many entries as  */
+/* fit in FIND_BUFLEN at a time, and sets the stem elements it finds */
+/* TREE_BATCH at a time through one chained RexxVariablePool call.   */
+/* TREE_POOL holds the names and values of the pending elements.     */
+/*********************************************************************/
+
+#define  FIND_BUFLEN    (63 * 1024)
+#define  SEARCH_BUFLEN  (256 * 1024)
+#define  FIND_COUNT     (FIND_BUFLEN / sizeof(FILEFINDBUF3))
+#define  TREE_BATCH     256
+#define  TREE_POOL      (64 * 1024)
+
+/*********************************************************************/
+/* Boyer-Moore-Horspool search data used by SysFileSearch.  fold maps */
+/* each byte to the form it is compared in (upper case unless the    */
+/* search is case sensitive, and NUL as blank as mystrstr used to).  */
+/*********************************************************************/
+
+typedef struct BmhData {
+    unsigned char pat[MAX];    /* Folded target                   */
+    unsigned long len;         /* Length of target                */
+    unsigned long skip[256];   /* Shift for each folded byte      */
+    unsigned char fold[256];   /* Byte folding table              */
+    bool single;               /* Target is one byte, unfolded    */
+} BMHDATA;
+
 /*********************************************************************/
 /* RxTree Structure used by SysTree.                                 */
 /*********************************************************************/
@@ -88,6 +115,11 @@ typedef struct RxTreeData {
     char varname[MAX];         /* Buffer for the variable name    */
     unsigned long j;           /* Temp counter                    */
     unsigned long nattrib;     /* New attrib, diff for each file  */
+    SHVBLOCK *batch;           /* Stem elements not yet set       */
+    unsigned long nbatch;      /* Number of them                  */
+    char *pool;                /* Their names and values          */
+    unsigned long poolused;    /* Bytes of pool in use            */
+    char *findbuf;             /* DosFindFirst/DosFindNext buffer */
 } RXTREEDATA;
 
 
@@ -98,8 +130,14 @@ static FILESTATUS3 FileInfo;
 
 static long RecursiveFindFile(char *FileSpec, char *path, RXTREEDATA *ldp,
                         int *smask, int *dmask, unsigned long options);
-static unsigned long mystrstr(char *haystack, char *needle,
-                          unsigned long hlen, unsigned long nlen, bool sensitive);
+static long FindInDir(char *spec, char *path, unsigned long attrib,
+                      RXTREEDATA *ldp, int *smask, int *dmask,
+                      unsigned long options);
+static unsigned long FlushTree(RXTREEDATA *ldp);
+static void BmhInit(BMHDATA *bmh, char *needle, unsigned long nlen,
+                    bool sensitive);
+static char *BmhFind(BMHDATA *bmh, char *text, unsigned long tlen);
+static unsigned long CountLines(char *text, unsigned long tlen);
 static void getpath(char *string, char *path, char *filename);
 static unsigned long SameAttr(int *mask, unsigned long attr);
 static unsigned long NewAttr(int *mask, unsigned long attr);
@@ -318,25 +356,38 @@ unsigned long SysFileSearch(unsigned char *name,
     PSZ         target;                  /* search string              */
     PSZ         file;                    /* search file                */
     PSZ         opts;                    /* option string              */
-    char        line[MAX];               /* Line read from file        */
-    ULONG       ptr;                     /* Pointer to char str found  */
-    ULONG       num = 0;                 /* Line number                */
-    ULONG       len;                     /* Length of string           */
+    char       *buf;                     /* Block read from file       */
+    char       *newbuf;                  /* Block after growing it     */
+    char       *hit;                     /* Where target was found     */
+    char       *value;                   /* Value of stem element      */
+    char       *eol;                     /* End of line with a hit     */
+    ULONG       buflen = SEARCH_BUFLEN;  /* Size of buf                */
+    ULONG       have = 0;                /* Bytes in buf               */
+    ULONG       end;                     /* Bytes in buf up to last \n */
+    ULONG       got;                     /* Bytes read this time       */
+    ULONG       pos;                     /* Start of line to search    */
+    ULONG       start;                   /* Start of line with a hit   */
+    ULONG       stop;                    /* End of line with a hit     */
+    ULONG       counted = 0;             /* Lines counted up to here   */
+    ULONG       num = 0;                 /* Lines before counted       */
+    ULONG       len;                     /* Length of line             */
     unsigned long       len2;                    /* Length of string           */
-//    ULONG       rc = 0;                  /* Return code of this func   */
     BOOL        linenums = FALSE;        /* Set TRUE for linenums in   */
                                          /* output                     */
     BOOL        sensitive = FALSE;       /* Set TRUE for case-sens     */
                                          /* search                     */
+    BOOL        eof = FALSE;             /* Whole file has been read   */
     FILE       *fp;                      /* Pointer to file to search  */
     RXSTEMDATA  ldp;                     /* stem data                  */
+    BMHDATA     bmh;                     /* target search data         */
 
     BUILDRXSTRING(retstr, NO_UTIL_ERROR);/* pass back result           */
                                          /* validate arguments         */
     if (numargs < 3 || numargs > 4 ||
         !RXVALIDSTRING(args[0]) ||
         !RXVALIDSTRING(args[1]) ||
-        !RXVALIDSTRING(args[2]))
+        !RXVALIDSTRING(args[2]) ||
+        args[0].strlength >= MAX)
       return INVALID_ROUTINE;            /* raise an error             */
 
     target = args[0].strptr;             /* get target pointer         */
@@ -355,50 +406,124 @@ unsigned long SysFileSearch(unsigned char *name,
 
     if (ldp.varname[ldp.stemlen-1] != '.') ldp.varname[ldp.stemlen++] = '.';
 
-    fp = fopen(file, "r");               /* Open the file              */
+    BmhInit(&bmh, target, args[0].strlength, sensitive);
+
+    buf = (char *)malloc(buflen);
+
+    if (buf == NULL) {
+        BUILDRXSTRING(retstr, ERROR_NOMEM);
+        return VALID_ROUTINE;
+    }
+
+    fp = fopen(file, "rb");              /* Open the file              */
 
     if (fp == NULL) {                    /* Open error?                */
+        free(buf);
         BUILDRXSTRING(retstr, ERROR_FILEOPEN);
         return VALID_ROUTINE;            /* finished                   */
     }
-                                         /* do the search...found lines*/
-                                         /* are saved in stem vars     */
-    while (fgets(line, MAX - 1, fp) != NULL) {
-        len = strlen(line);
-        num++;
-        ptr = mystrstr(line, target, len, args[0].strlength, sensitive);
-
-        if (ptr != '\0') {
+                                         /* we read into buf directly  */
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    /* The file is read in large blocks and only the complete lines in */
+    /* each are searched; the partial line at the end is carried over  */
+    /* to the next block.  Lines are only found, and counted, around   */
+    /* a hit.                                                          */
+    while (!eof || have) {
+        if (!eof) {
+            got = fread(buf+have, 1, buflen-have, fp);
+            if (got < buflen-have) eof = TRUE;
+                                         /* Ctrl-Z ends a text file    */
+            if ((hit = memchr(buf+have, 0x1a, got)) != NULL) {
+                got = hit-(buf+have);
+                eof = TRUE;
+            }
+            have += got;
+        }
+
+        end = have;
+        if (!eof) {
+            while (end && buf[end-1] != '\n') end--;
+            if (!end) {                  /* line longer than buf       */
+                newbuf = (char *)realloc(buf, buflen*2);
+                if (newbuf == NULL) {
+                    fclose(fp);
+                    free(buf);
+                    BUILDRXSTRING(retstr, ERROR_NOMEM);
+                    return VALID_ROUTINE;
+                }
+                buf = newbuf;
+                buflen *= 2;
+                continue;
+            }
+        }
+
+        pos = 0;
+        while (pos < end && (hit = BmhFind(&bmh, buf+pos, end-pos)) != NULL) {
+            start = hit-buf;
+            while (start > pos && buf[start-1] != '\n') start--;
+            eol = memchr(hit, '\n', end-(hit-buf));
+            stop = (eol != NULL) ? eol-buf : end;
+
+            len = stop-start;
+            if (len && buf[stop-1] == '\r') len--;
+
             if (linenums) {
-                sprintf(ldp.ibuf, "%d ", num);
+                num += CountLines(buf+counted, start-counted);
+                counted = start;
+                sprintf(ldp.ibuf, "%lu ", num+1);
                 len2 = strlen(ldp.ibuf);
-                memcpy(ldp.ibuf+len2, line, len);
+                if (len+len2 <= IBUF_LEN) value = ldp.ibuf;
+                else if ((value = (char *)malloc(len+len2)) == NULL) {
+                    fclose(fp);
+                    free(buf);
+                    BUILDRXSTRING(retstr, ERROR_NOMEM);
+                    return VALID_ROUTINE;
+                }
+                else memcpy(value, ldp.ibuf, len2);
+                memcpy(value+len2, buf+start, len);
                 ldp.vlen = len+len2;
             } else {
-                memcpy(ldp.ibuf, line, len);
+                value = buf+start;
                 ldp.vlen = len;
             }
 
             ldp.count++;
             sprintf(ldp.varname+ldp.stemlen, "%d", ldp.count);
 
-            if (ldp.ibuf[ldp.vlen-1] == '\n') ldp.vlen--;
             ldp.shvb.shvnext = NULL;
             ldp.shvb.shvname.strptr = ldp.varname;
             ldp.shvb.shvname.strlength = strlen(ldp.varname);
             ldp.shvb.shvnamelen = ldp.shvb.shvname.strlength;
-            ldp.shvb.shvvalue.strptr = ldp.ibuf;
+            ldp.shvb.shvvalue.strptr = value;
             ldp.shvb.shvvalue.strlength = ldp.vlen;
             ldp.shvb.shvvaluelen = ldp.vlen;
             ldp.shvb.shvcode = RXSHV_SET;
             ldp.shvb.shvret = 0;
 
+            got = RexxVariablePool(&ldp.shvb);
+
+            if (value != ldp.ibuf && value != buf+start) free(value);
+
             /* error on non-zero          */
-            if (RexxVariablePool(&ldp.shvb) == RXSHV_BADN) return INVALID_ROUTINE;
+            if (got == RXSHV_BADN) {
+                fclose(fp);
+                free(buf);
+                return INVALID_ROUTINE;
+            }
+
+            pos = stop+1;
         }
+
+        if (linenums) num += CountLines(buf+counted, end-counted);
+        counted = 0;
+
+        memmove(buf, buf+end, have-end);
+        have -= end;
     }
 
     fclose(fp);                        /* Close that file            */
+    free(buf);
                                        /* set stem.0 to lines read   */
     sprintf(ldp.ibuf, "%d", ldp.count);
     ldp.varname[ldp.stemlen] = '0';
@@ -792,10 +917,30 @@ unsigned long SysFileTree(unsigned char *name,
 
     }
 
+    ldp.batch = (SHVBLOCK *)malloc(TREE_BATCH * sizeof(SHVBLOCK) +
+                                   TREE_POOL + FIND_BUFLEN);
+    if (ldp.batch == NULL) {
+        if (FileSpec != buff1) {
+            free(FileSpec);
+            free(path);
+        }
+        BUILDRXSTRING(retstr, ERROR_NOMEM);
+        return VALID_ROUTINE;
+    }
+    ldp.pool = (char *)(ldp.batch + TREE_BATCH);
+    ldp.findbuf = ldp.pool + TREE_POOL;
+    ldp.nbatch = 0;
+    ldp.poolused = 0;
+
     getpath(FileSpec, path, ldp.TargetSpec);
 
-    if (RecursiveFindFile(FileSpec, path, &ldp, smask, dmask, options))
-              return INVALID_ROUTINE;
+    if (RecursiveFindFile(FileSpec, path, &ldp, smask, dmask, options) ||
+        FlushTree(&ldp)) {
+        free(ldp.batch);
+        return INVALID_ROUTINE;
+    }
+
+    free(ldp.batch);
 
     ltoa(ldp.count, ldp.Temp, 10);
     ldp.varname[ldp.stemlen] = '0';
@@ -820,47 +965,99 @@ unsigned long SysFileTree(unsigned char *name,
 /******************* Helpers follow ********************************/
 
 /********************************************************************
-* Function:  mystrstr(haystack, needle, hlen, nlen, sensitive)      *
-*                                                                   *
-* Purpose:   Determines if the string 'needle' is in the            *
-*            string 'haystack' by returning it's position or        *
-*            a NULL if not found.  The length of haystack and       *
-*            needle are given by 'hlen' and 'nlen' respectively.    *
+* Function:  BmhInit(bmh, needle, nlen, sensitive)                  *
 *                                                                   *
-*            If 'sensitive' is true, then the search is case        *
-*            sensitive, else it is case insensitive.                *
-*                                                                   *
-* RC:        num  - The pos where needle was found.                 *
-*            NULL - needle not found.                               *
+* Purpose:   Sets up bmh to search for the 'nlen' bytes at 'needle' *
+*            with BmhFind().  If 'sensitive' is false, the search   *
+*            is case insensitive.  NUL bytes match blanks.          *
 *                                                                   *
 * Used By:   SysFileSearch()                                        *
 *********************************************************************/
 
-static unsigned long mystrstr(char *haystack, char *needle, unsigned long hlen,
-                       unsigned long nlen, bool sensitive)
+static void BmhInit(BMHDATA *bmh, char *needle, unsigned long nlen,
+                    bool sensitive)
 {
-    char line[MAX];
-    char target[MAX];
     unsigned long p;
 
-    /* Copy line  - Change nulls to spaces and uppercase if needed      */
-    for (p = 0; p < hlen; p++) {
-        if (haystack[p] == '\0') line[p] = ' ';
-        else if (sensitive) line[p] = haystack[p];
-        else line[p] = (char)toupper(haystack[p]);
+    for (p = 0; p < 256; p++) {
+        bmh->fold[p] = (unsigned char)(sensitive ? p : toupper(p));
+        bmh->skip[p] = nlen;
     }
-    line[p] = '\0';
+    bmh->fold[0] = ' ';
+
+    for (p = 0; p < nlen; p++)
+        bmh->pat[p] = bmh->fold[(unsigned char)needle[p]];
+    bmh->len = nlen;
+
+    /* the last byte keeps its shift; a mismatch there moves by one  */
+    /* more than the distance to its previous occurrence             */
+    for (p = 0; p + 1 < nlen; p++)
+        bmh->skip[bmh->pat[p]] = nlen-1-p;
+
+    bmh->single = (nlen == 1);
+    for (p = 0; p < 256 && bmh->single; p++)
+        if (p != bmh->pat[0] && bmh->fold[p] == bmh->pat[0])
+            bmh->single = FALSE;
+}
+
+
+/********************************************************************
+* Function:  BmhFind(bmh, text, tlen)                               *
+*                                                                   *
+* Purpose:   Finds the target set up by BmhInit() in the 'tlen'     *
+*            bytes at 'text'.                                       *
+*                                                                   *
+* RC:        Pointer to the first match, or NULL if not found.      *
+*                                                                   *
+* Used By:   SysFileSearch()                                        *
+*********************************************************************/
+
+static char *BmhFind(BMHDATA *bmh, char *text, unsigned long tlen)
+{
+    unsigned char *t = (unsigned char *)text;
+    unsigned char *fold = bmh->fold;
+    unsigned char *pat = bmh->pat;
+    unsigned long last;
+    unsigned long i, j;
+    unsigned char c;
+
+    if (bmh->len == 0) return text;
+    if (tlen < bmh->len) return NULL;
+
+    /* a one byte target only one byte value matches is a memchr     */
+    if (bmh->single) return memchr(text, pat[0], tlen);
+
+    last = bmh->len-1;
+    for (i = 0; i <= tlen-bmh->len; i += bmh->skip[c]) {
+        c = fold[t[i+last]];
+        if (c != pat[last]) continue;
+        for (j = last; j && fold[t[i+j-1]] == pat[j-1]; j--);
+        if (!j) return text+i;
+    }
+
+    return NULL;
+}
 
-    /* Copy target  - Change nulls to spaces and uppercase if needed    */
 
-    for (p = 0; p < nlen; p++) {
-        if (needle[p] == '\0') target[p] = ' ';
-        else if (sensitive) target[p] = needle[p];
-        else target[p] = (char)toupper(needle[p]);
+/********************************************************************
+* Function:  CountLines(text, tlen)                                 *
+*                                                                   *
+* Purpose:   Returns the number of line ends in 'tlen' bytes.       *
+*                                                                   *
+* Used By:   SysFileSearch()                                        *
+*********************************************************************/
+
+static unsigned long CountLines(char *text, unsigned long tlen)
+{
+    unsigned long n = 0;
+    char *end = text+tlen;
+
+    while (text < end && (text = memchr(text, '\n', end-text)) != NULL) {
+        n++;
+        text++;
     }
-    target[p] = '\0';
 
-    return ((unsigned long)strstr(line, target));
+    return n;
 }
 
 
@@ -930,14 +1127,14 @@ static long RecursiveFindFile(char *FileSpec, char *path, RXTREEDATA *ldp,
 {
     char  tempfile[_MAX_PATH+1];
 
-    unsigned long FindCount   = 1;
+    unsigned long FindCount   = FIND_COUNT;
     unsigned long Attribute   = FILE_NORMAL | FILE_READONLY | FILE_HIDDEN | \
                                 FILE_SYSTEM | FILE_ARCHIVED;
     unsigned long AttribDir   = FILE_READONLY | FILE_HIDDEN | FILE_SYSTEM | \
                                 FILE_ARCHIVED | MUST_HAVE_DIRECTORY | FILE_DIRECTORY;
-    unsigned long fdBufLen    = sizeof(FILEFINDBUF3);
 
-    FILEFINDBUF3  fd;
+    FILEFINDBUF3  *fd;
+    char          *dirbuf;
 
     HDIR fHandle = HDIR_CREATE;
 
@@ -945,69 +1142,115 @@ static long RecursiveFindFile(char *FileSpec, char *path, RXTREEDATA *ldp,
     sprintf(tempfile, "%s%s", path, ldp->TargetSpec);
 
     if ((options & DO_FILES) &&
-        !DosFindFirst(tempfile, &fHandle, Attribute, &fd, fdBufLen, &FindCount, FIL_STANDARD)) {
-        do {
-            if (SameAttr(smask, fd.attrFile)) {
-                sprintf(ldp->truefile, "%s%s", path, fd.achName);
-
-                if (FormatFile(ldp, smask, dmask, options, &fd)) {
-                    DosFindClose(fHandle);
-                    return INVALID_ROUTINE;
-                }
-            }
-
-        FindCount = 1;
+        FindInDir(tempfile, path, Attribute, ldp, smask, dmask, options))
+        return INVALID_ROUTINE;
 
-        } while (!DosFindNext(fHandle, &fd, fdBufLen, &FindCount));
+    if ((options & DO_DIRS) &&
+        FindInDir(tempfile, path, AttribDir, ldp, smask, dmask, options))
+        return INVALID_ROUTINE;
 
-        DosFindClose(fHandle);
-    }
+    if (options&RECURSE) {
+        // each level needs its own buffer, as the recursion reuses ldp->findbuf
+        dirbuf = (char *)malloc(FIND_BUFLEN);
+        if (dirbuf == NULL) return INVALID_ROUTINE;
 
-    fHandle = HDIR_CREATE;
-    FindCount = 1;
+        sprintf(tempfile, "%s*", path);
 
-    if ((options & DO_DIRS)  &&
-        !DosFindFirst(tempfile, &fHandle, AttribDir, &fd, fdBufLen, &FindCount, FIL_STANDARD)) {
-        do {
-            if (!strcmp(fd.achName, ".") || !strcmp(fd.achName, "..")) continue;
-            if (SameAttr(smask, fd.attrFile)) {
-                sprintf(ldp->truefile, "%s%s", path, fd.achName);
-                if (FormatFile(ldp, smask, dmask, options, &fd)) {
-                    DosFindClose(fHandle);
-                    return INVALID_ROUTINE;
+        if (!DosFindFirst(tempfile, &fHandle, AttribDir, dirbuf, FIND_BUFLEN, &FindCount, FIL_STANDARD)) {
+            do {
+                fd = (FILEFINDBUF3 *)dirbuf;
+                while (FindCount--) {
+                    if (strcmp(fd->achName, ".") && strcmp(fd->achName, "..")) {
+                        sprintf(tempfile, "%s%s\\", path, fd->achName);
+                        if (RecursiveFindFile(ldp->TargetSpec, tempfile, ldp, smask, dmask, options)) {
+                            DosFindClose(fHandle);
+                            free(dirbuf);
+                            return INVALID_ROUTINE;
+                        }
+                    }
+                    if (!fd->oNextEntryOffset) break;
+                    fd = (FILEFINDBUF3 *)((char *)fd + fd->oNextEntryOffset);
                 }
-            }
-            FindCount = 1;
-        } while (!DosFindNext(fHandle, &fd, fdBufLen, &FindCount));
+                FindCount = FIND_COUNT;
+            } while (!DosFindNext(fHandle, dirbuf, FIND_BUFLEN, &FindCount));
+            DosFindClose(fHandle);
+        }
 
-        DosFindClose(fHandle);
+        free(dirbuf);
     }
+    return VALID_ROUTINE;
+}
 
-    fHandle = HDIR_CREATE;
 
-    FindCount = 1;
+/*****************************************************************************
+* Function: FindInDir( spec, path, attrib, ldp, smask, dmask, options )      *
+*                                                                            *
+* Purpose:  Adds every entry matching spec and attrib in one directory to    *
+*           the stem, taking as many entries per DosFindNext as fit in       *
+*           ldp->findbuf.                                                    *
+*                                                                            *
+* Used By:  RecursiveFindFile()                                              *
+*****************************************************************************/
 
-    if (options&RECURSE) {
-        sprintf(tempfile, "%s*", path);
+static long FindInDir(char *spec, char *path, unsigned long attrib,
+                      RXTREEDATA *ldp, int *smask, int *dmask,
+                      unsigned long options)
+{
+    unsigned long FindCount = FIND_COUNT;
+    FILEFINDBUF3  *fd;
+    HDIR fHandle = HDIR_CREATE;
 
-        if (!DosFindFirst(tempfile, &fHandle, AttribDir, &fd, fdBufLen, &FindCount, FIL_STANDARD)) {
-            do {
-                if (!strcmp(fd.achName, ".") || !strcmp(fd.achName, "..")) continue;
-                sprintf(tempfile, "%s%s\\", path, fd.achName);
-                if (RecursiveFindFile(ldp->TargetSpec, tempfile, ldp, smask, dmask, options)) {
+    if (DosFindFirst(spec, &fHandle, attrib, ldp->findbuf, FIND_BUFLEN, &FindCount, FIL_STANDARD))
+        return VALID_ROUTINE;
+
+    do {
+        fd = (FILEFINDBUF3 *)ldp->findbuf;
+        while (FindCount--) {
+            if (strcmp(fd->achName, ".") && strcmp(fd->achName, "..") &&
+                SameAttr(smask, fd->attrFile)) {
+                sprintf(ldp->truefile, "%s%s", path, fd->achName);
+                if (FormatFile(ldp, smask, dmask, options, fd)) {
                     DosFindClose(fHandle);
                     return INVALID_ROUTINE;
                 }
-                FindCount = 1;
-            } while (!DosFindNext(fHandle, &fd, fdBufLen, &FindCount));
-            DosFindClose(fHandle);
+            }
+            if (!fd->oNextEntryOffset) break;
+            fd = (FILEFINDBUF3 *)((char *)fd + fd->oNextEntryOffset);
         }
+        FindCount = FIND_COUNT;
+    } while (!DosFindNext(fHandle, ldp->findbuf, FIND_BUFLEN, &FindCount));
 
-    }
+    DosFindClose(fHandle);
     return VALID_ROUTINE;
 }
 
 
+/*********************************************************************
+* Function:  FlushTree(ldp)                                          *
+*                                                                    *
+* Purpose:   Sets the stem elements FormatFile() has queued up in    *
+*            ldp->batch with a single chained RexxVariablePool call. *
+*                                                                    *
+* Used By:   SysFileTree(), FormatFile()                             *
+*********************************************************************/
+
+static unsigned long FlushTree(RXTREEDATA *ldp)
+{
+    unsigned long rc;
+
+    if (!ldp->nbatch) return 0;
+
+    ldp->batch[ldp->nbatch-1].shvnext = NULL;
+    rc = RexxVariablePool(ldp->batch);
+    ldp->nbatch = 0;
+    ldp->poolused = 0;
+
+    if (rc & (RXSHV_BADN | RXSHV_MEMFL)) return INVALID_ROUTINE;
+
+    return 0;
+}
+
+
 /*****************************************************************
 * Function:  getpath(string, path, filename)                     *
 *                                                                *
@@ -1246,7 +1489,8 @@ unsigned long FormatFile(RXTREEDATA *ldp, int *smask, int *dmask,
                          unsigned long options, FILEFINDBUF3 *finfo)
 {
     unsigned long nattrib;
-    unsigned short rc;
+    unsigned long nlen;
+    SHVBLOCK *shv;
 
     nattrib = NewAttr((INT *)dmask, finfo->attrFile);
 
@@ -1296,18 +1540,26 @@ unsigned long FormatFile(RXTREEDATA *ldp, int *smask, int *dmask,
     ldp->vlen = strlen(ldp->Temp);
     ldp->count++;
     ltoa(ldp->count, ldp->varname+ldp->stemlen, 10);
-    ldp->shvb.shvnext = NULL;
-    ldp->shvb.shvname.strptr = ldp->varname;
-    ldp->shvb.shvname.strlength = strlen(ldp->varname);
-    ldp->shvb.shvvalue.strptr = ldp->Temp;
-    ldp->shvb.shvvalue.strlength = ldp->vlen;
-    ldp->shvb.shvnamelen = ldp->shvb.shvname.strlength;
-    ldp->shvb.shvvaluelen = ldp->vlen;
-    ldp->shvb.shvcode = RXSHV_SET;
-    ldp->shvb.shvret = 0;
-    rc = RexxVariablePool(&ldp->shvb);
-
-    if (rc & (RXSHV_BADN | RXSHV_MEMFL)) return INVALID_ROUTINE;
+    nlen = strlen(ldp->varname);
+
+    // queue the element; FlushTree() sets a whole batch at once
+    if (ldp->nbatch == TREE_BATCH || ldp->poolused + nlen + ldp->vlen > TREE_POOL)
+        if (FlushTree(ldp)) return INVALID_ROUTINE;
+
+    shv = ldp->batch + ldp->nbatch++;
+    shv->shvnext = shv + 1;
+    shv->shvname.strptr = ldp->pool + ldp->poolused;
+    shv->shvname.strlength = nlen;
+    memcpy(shv->shvname.strptr, ldp->varname, nlen);
+    ldp->poolused += nlen;
+    shv->shvvalue.strptr = ldp->pool + ldp->poolused;
+    shv->shvvalue.strlength = ldp->vlen;
+    memcpy(shv->shvvalue.strptr, ldp->Temp, ldp->vlen);
+    ldp->poolused += ldp->vlen;
+    shv->shvnamelen = nlen;
+    shv->shvvaluelen = ldp->vlen;
+    shv->shvcode = RXSHV_SET;
+    shv->shvret = 0;
 
     return 0;
 }
@@ -93,15 +93,24 @@ unsigned long SysCreateMutexSem(unsigned char *name,
     /* request for named sem      */
     if (numargs == 1) {
 
-        rc = DosCreateMutexSem(args[0].strptr, &handle, DC_SEM_SHARED, 1);
-
-        /* may already be created try to open it */
-        if (rc != NO_ERROR) {
-            rc = DosOpenMutexSem(args[0].strptr, &handle);
+        /* already open in this process - share the handle */
+        if ((handle = SemCacheFind(SEMTYPE_MUTEX, args[0].strptr)) != NULLHANDLE) {
+            rc = NO_ERROR;
+        } else {
+            rc = DosCreateMutexSem(args[0].strptr, &handle, DC_SEM_SHARED, 1);
+
+            /* may already be created try to open it */
+            if (rc != NO_ERROR) {
+                rc = DosOpenMutexSem(args[0].strptr, &handle);
+            }
+
+            if (rc == NO_ERROR) SemCacheAdd(SEMTYPE_MUTEX, args[0].strptr, handle);
         }
 
     } else {                                /* unnamed semaphore */
         rc = DosCreateMutexSem(NULL, &handle, DC_SEM_SHARED, 1);
+
+        if (rc == NO_ERROR) SemCacheAdd(SEMTYPE_MUTEX, NULL, handle);
     }
 
     if (!handle && rc != NO_ERROR) retstr->strlength = 0;  /* return null string */
@@ -139,7 +148,12 @@ unsigned long SysOpenMutexSem(unsigned char *name,
 
                                        /* get a binary handle        */
                                        /* try to open it             */
-    rc = DosOpenMutexSem(NULL, &handle);
+    if (SemCacheAddRef(handle)) rc = NO_ERROR;
+    else {
+        rc = DosOpenMutexSem(NULL, &handle);
+
+        if (rc == NO_ERROR) SemCacheAdd(SEMTYPE_MUTEX, NULL, handle);
+    }
 
     retstr->strlength = sprintf(retstr->strptr, "%lu", rc);
 
@@ -203,7 +217,9 @@ unsigned long SysCloseMutexSem(unsigned char *name,
 
     if (!string2ulong(args[0].strptr, &handle)) return INVALID_ROUTINE;
 
-    rc = DosCloseMutexSem(handle);
+    /* other references in this process keep it open */
+    if (SemCacheRelease(handle)) rc = NO_ERROR;
+    else rc = DosCloseMutexSem(handle);
 
     retstr->strlength = sprintf(retstr->strptr, "%lu", rc);
 
@@ -19,6 +19,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <signal.h>
+#include <ctype.h>
 
 static double cotan(const double arg);
 
@@ -56,9 +57,9 @@ static int findmathfunc(const void * const l, const void * const r)
     return strcasecmp((char *) l, ((struct funclist*)r)->name);
 }
 
-static int setresult(char * str, double dbl, int argc, PRXSTRING argv)
+static int getprecision(int argc, PRXSTRING argv)
 {
-   char * precisions, *c1, *c2;
+   char * precisions;
    int precision;
 
    if (argc > 0 && argv[0].strptr) {
@@ -73,7 +74,12 @@ static int setresult(char * str, double dbl, int argc, PRXSTRING argv)
       precision = 16;
    }
 
-   return sprintf(str, "%.*g", precision, dbl);
+   return precision;
+}
+
+static int setresult(char * str, double dbl, int argc, PRXSTRING argv)
+{
+   return sprintf(str, "%.*g", getprecision(argc, argv), dbl);
 }
 
 rxfunc(mathfunc1)
@@ -249,6 +255,351 @@ rxfunc(mathpi)
 }
 
 
+/* stem functions. These convert a whole numeric stem to doubles once,
+ * work on the array, and convert back once. The variable pool is called
+ * with a chain of STEMCHUNK requests at a time rather than once per
+ * element, since for large stems the calls into the interpreter cost
+ * more than the arithmetic. */
+
+#define STEMCHUNK 128
+#define STEMNAMELEN 256
+#define STEMVALLEN 64
+
+typedef struct {
+    SHVBLOCK shv[STEMCHUNK];
+    char names[STEMCHUNK][STEMNAMELEN];
+    char values[STEMCHUNK][STEMVALLEN];
+} stemchunk;
+
+/* copy a stem name, upper-cased and with the trailing period.
+ * returns -1 if it's too long to leave room for a tail */
+static int stemname(char * name, PRXSTRING stem)
+{
+    int i, len = RXSTRLEN(*stem);
+
+    if (len == 0 || len > STEMNAMELEN - 16)
+        return -1;
+
+    for (i = 0; i < len; i++)
+        name[i] = toupper((unsigned char)stem->strptr[i]);
+
+    if (name[len-1] != '.')
+        name[len++] = '.';
+
+    name[len] = 0;
+
+    return len;
+}
+
+/* fetch or set count elements of the stem, starting at element first. For
+ * RXSHV_SYFET the values are read into vals, otherwise they're formatted
+ * from it with the given precision */
+static int stemio(int code, const char * name, int first, int count, double * vals, int precision)
+{
+    stemchunk * sc;
+    SHVBLOCK * shv;
+    int i, base, n, rc = 0;
+
+    if (count == 0)
+        return 0;
+
+    sc = malloc(sizeof(*sc));
+    if (sc == NULL)
+        return NOMEMORY;
+
+    for (base = 0; base < count && !rc; base += n) {
+        n = min(count - base, STEMCHUNK);
+
+        for (i = 0; i < n; i++) {
+            shv = sc->shv + i;
+            shv->shvnext = (i + 1 < n) ? shv + 1 : NULL;
+            shv->shvcode = code;
+            shv->shvname.strptr = sc->names[i];
+            shv->shvname.strlength = sprintf(sc->names[i], "%s%d", name, first + base + i);
+            shv->shvnamelen = shv->shvname.strlength;
+            shv->shvvalue.strptr = sc->values[i];
+
+            if (code == RXSHV_SYFET)
+                shv->shvvalue.strlength = STEMVALLEN - 1;
+            else
+                shv->shvvalue.strlength = sprintf(sc->values[i], "%.*g", precision, vals[base + i]);
+
+            shv->shvvaluelen = shv->shvvalue.strlength;
+        }
+
+        RexxVariablePool(sc->shv);
+
+        for (i = 0; i < n; i++) {
+            shv = sc->shv + i;
+
+            if (shv->shvret & (RXSHV_BADN|RXSHV_MEMFL)) {
+                rc = BADARGS;
+                break;
+            }
+
+            if (code != RXSHV_SYFET)
+                continue;
+
+            /* an unset or over-long element isn't a number */
+            if (shv->shvret & (RXSHV_NEWV|RXSHV_TRUNC)) {
+                rc = BADARGS;
+                break;
+            }
+
+            sc->values[i][shv->shvvalue.strlength] = 0;
+            vals[base + i] = atof(sc->values[i]);
+        }
+    }
+
+    free(sc);
+
+    return rc;
+}
+
+/* read a whole stem into a new array of doubles. stem.0 holds the count */
+static int getstemvals(PRXSTRING stem, double ** pvals, int * pcount)
+{
+    char name[STEMNAMELEN];
+    double count;
+    int rc;
+
+    *pvals = NULL;
+    *pcount = 0;
+
+    if (stemname(name, stem) < 0)
+        return BADARGS;
+
+    rc = stemio(RXSHV_SYFET, name, 0, 1, &count, 0);
+
+    if (rc || count < 0 || count > 0x7fffffff / sizeof(double))
+        return BADARGS;
+
+    *pcount = (int)count;
+
+    /* keep a non-null pointer for empty stems */
+    *pvals = malloc((*pcount + 1) * sizeof(double));
+    if (*pvals == NULL)
+        return NOMEMORY;
+
+    rc = stemio(RXSHV_SYFET, name, 1, *pcount, *pvals, 0);
+
+    if (rc) {
+        free(*pvals);
+        *pvals = NULL;
+    }
+
+    return rc;
+}
+
+/* write an array of doubles to a stem, including stem.0 */
+static int setstemvals(PRXSTRING stem, double * vals, int count, int precision)
+{
+    char name[STEMNAMELEN];
+    double dcount = count;
+    int rc;
+
+    if (stemname(name, stem) < 0)
+        return BADARGS;
+
+    rc = stemio(RXSHV_SYSET, name, 1, count, vals, precision);
+
+    if (!rc)
+        rc = stemio(RXSHV_SYSET, name, 0, 1, &dcount, 16);
+
+    return rc;
+}
+
+/* four running sums, so the additions don't each wait on the last one */
+static double sumvals(const double * vals, int count)
+{
+    double s0 = 0., s1 = 0., s2 = 0., s3 = 0.;
+    int i;
+
+    for (i = 0; i + 4 <= count; i += 4) {
+        s0 += vals[i];
+        s1 += vals[i+1];
+        s2 += vals[i+2];
+        s3 += vals[i+3];
+    }
+
+    for (; i < count; i++)
+        s0 += vals[i];
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+/* rxcalcstemsum(stem. [,precision]) -- sum of stem.1 to stem.n */
+rxfunc(mathstemsum)
+{
+    double * vals;
+    int count, rc;
+
+    checkparam(1,2);
+
+    if ((rc = getstemvals(argv, &vals, &count)) != 0)
+        return rc;
+
+    result->strlength = setresult(result->strptr, sumvals(vals, count), argc - 1, argv+1);
+
+    free(vals);
+
+    return 0;
+}
+
+/* rxcalcstemmean(stem. [,precision]) -- arithmetic mean of stem.1 to stem.n */
+rxfunc(mathstemmean)
+{
+    double * vals;
+    int count, rc;
+
+    checkparam(1,2);
+
+    if ((rc = getstemvals(argv, &vals, &count)) != 0)
+        return rc;
+
+    if (count == 0) {
+        free(vals);
+        return BADARGS;
+    }
+
+    result->strlength = setresult(result->strptr, sumvals(vals, count) / count, argc - 1, argv+1);
+
+    free(vals);
+
+    return 0;
+}
+
+/* rxcalcstemdot(a., b. [,precision]) -- dot product of two stems of the
+ * same size */
+rxfunc(mathstemdot)
+{
+    double * a, * b;
+    double s0 = 0., s1 = 0., s2 = 0., s3 = 0.;
+    int count, countb, i, rc;
+
+    checkparam(2,3);
+
+    if ((rc = getstemvals(argv, &a, &count)) != 0)
+        return rc;
+
+    if ((rc = getstemvals(argv+1, &b, &countb)) != 0) {
+        free(a);
+        return rc;
+    }
+
+    if (count != countb) {
+        free(a);
+        free(b);
+        return BADARGS;
+    }
+
+    for (i = 0; i + 4 <= count; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i+1] * b[i+1];
+        s2 += a[i+2] * b[i+2];
+        s3 += a[i+3] * b[i+3];
+    }
+
+    for (; i < count; i++)
+        s0 += a[i] * b[i];
+
+    result->strlength = setresult(result->strptr, (s0 + s1) + (s2 + s3), argc - 2, argv+2);
+
+    free(a);
+    free(b);
+
+    return 0;
+}
+
+/* rxcalcstemfunc(func, in., out. [,precision [,unit]]) -- sets out.i to
+ * func(in.i) for each element of in. and returns the count. func is any of
+ * the single-argument functions above, with or without the rxcalc prefix
+ * (so either 'exp' or 'RxCalcExp'). unit is as for the trig functions and
+ * is ignored by the others */
+rxfunc(mathstemfunc)
+{
+    struct funclist * theFunc;
+    char * func, * name;
+    double inscale = 1., outscale = 1.;
+    double * vals;
+    int count, i, rc;
+
+    checkparam(3,5);
+
+    rxstrdup(func, argv[0]);
+    name = alloca(strlen(func) + 7);
+    sprintf(name, "rxcalc%s", func);
+
+    /* try the name as given, then with the prefix */
+    for (i = 0; i < 2; i++, func = name) {
+        if ((theFunc = bsearch(func, mathfuncs, DIM(mathfuncs), sizeof(*theFunc), findmathfunc)) != NULL)
+            break;
+        if ((theFunc = bsearch(func, trigfuncs, DIM(trigfuncs), sizeof(*theFunc), findmathfunc)) != NULL) {
+            inscale = PI/180.;
+            break;
+        }
+        if ((theFunc = bsearch(func, trigresults, DIM(trigresults), sizeof(*theFunc), findmathfunc)) != NULL) {
+            outscale = 180./PI;
+            break;
+        }
+    }
+
+    if (theFunc == NULL)
+        return BADARGS;
+
+    /* angles are in degrees unless the unit says otherwise */
+    if (inscale != 1. || outscale != 1.) {
+        if (argc > 4 && RXSTRLEN(argv[4])) {
+            switch (argv[4].strptr[0]) {
+                case 'd':
+                case 'D':
+                    break;
+
+                case 'r':
+                case 'R':
+                    inscale = outscale = 1.;
+                    break;
+
+                case 'g':
+                case 'G':
+                    if (inscale != 1.)
+                        inscale = PI/200.;
+                    else
+                        outscale = 200./PI;
+                    break;
+
+                default:
+                    return BADARGS;
+            }
+        }
+    }
+
+    if ((rc = getstemvals(argv+1, &vals, &count)) != 0)
+        return rc;
+
+    if (inscale != 1.)
+        for (i = 0; i < count; i++)
+            vals[i] = theFunc->fnptr(vals[i] * inscale);
+    else if (outscale != 1.)
+        for (i = 0; i < count; i++)
+            vals[i] = theFunc->fnptr(vals[i]) * outscale;
+    else
+        for (i = 0; i < count; i++)
+            vals[i] = theFunc->fnptr(vals[i]);
+
+    rc = setstemvals(argv+2, vals, count, getprecision(argc - 3, argv+3));
+
+    free(vals);
+
+    if (rc)
+        return rc;
+
+    result->strlength = sprintf(result->strptr, "%d", count);
+
+    return 0;
+}
+
+
 rxfunc(mathdropfuncs);
 rxfunc(mathloadfuncs);
 
@@ -258,6 +609,10 @@ static struct {
 } funclist[] = {
  "rxcalcpi", mathpi,
  "rxcalcpower", mathpow,
+ "rxcalcstemsum", mathstemsum,
+ "rxcalcstemmean", mathstemmean,
+ "rxcalcstemdot", mathstemdot,
+ "rxcalcstemfunc", mathstemfunc,
  "mathdropfuncs", mathdropfuncs,
  "mathloadfuncs", mathloadfuncs,
 };
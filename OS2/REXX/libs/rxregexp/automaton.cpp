@@ -58,13 +58,17 @@
 
 // constructor: initialize automaton
 automaton::automaton() : ch(NULL), next1(NULL), next2(NULL), final(-1), regexp(NULL),
-                         setArray(NULL), setSize(0), size(16), freeState(1), currentPos(0), minimal(false)
+                         setArray(NULL), setSize(0), size(16), freeState(1), currentPos(0), minimal(false),
+                         work(NULL), mark(NULL), workSize(0), lastRegexp(NULL), lastPos(0)
 {
   int bytes = sizeof(int)*size;
 
   ch    = (int*) malloc(bytes);
   next1 = (int*) malloc(bytes);
   next2 = (int*) malloc(bytes);
+
+  memset(dfas, 0x00, sizeof(dfas));
+  dfas[0].start = dfas[1].start = -1;
 }
 
 // destructor: free memory
@@ -80,7 +84,14 @@ automaton::~automaton()
       free(setArray[i]);
     free(setArray);
   }
-
+  for (int m=0;m<2;m++) {
+    dfaClear(m);
+    free(dfas[m].next);
+    free(dfas[m].sets);
+  }
+  free(work);
+  free(mark);
+  free(lastRegexp);
 }
 
 
@@ -116,6 +127,18 @@ void automaton::setMinimal(bool f)
 int automaton::parse(char *regexp)
 {
   int temp;
+
+  // the same expression again leaves the automaton and its DFA as
+  // they are (setMinimal keeps the final state up to date)
+  if (lastRegexp && !strcmp(lastRegexp, regexp)) {
+    currentPos = lastPos;
+    return 0;
+  }
+  free(lastRegexp);
+  lastRegexp = NULL;
+  dfaClear(0);
+  dfaClear(1);
+
   this->regexp = regexp;
   currentPos = 0;
   freeState  = 1;
@@ -194,6 +217,8 @@ int automaton::parse(char *regexp)
 
   this->regexp = NULL;  // contents only guaranteed during
                         // runtime of this method
+  lastRegexp = strdup(regexp);
+  lastPos = currentPos;
   return 0;
 }
 
@@ -643,45 +668,144 @@ int automaton::insertSet(char *range)
 /*                                               */
 /* try to match a string with the automaton.     */
 /* returns 1 on success and 0 on failure.        */
-/* matching is non-recursively done with a queue */
-/* that has a push, put and pop method.          */
+/* matching runs the DFA for the current mode,   */
+/* building the states it needs as it goes.      */
+/* like the automaton, it sees the string as     */
+/* zero-terminated.                              */
 /*************************************************/
 int automaton::match(char *a, int N)  // string length passed in
                                       // instead of strlen
 {
-  int n1, n2;
-  int j = 0;
-  int state = next1[0];  // get start state
-  doubleQueue dq(64);    // create a double queue
-                         // one SCAN symbol will be put into the queue
+  int mode = minimal ? 1 : 0;
+  dfa *d = &dfas[mode];
+  int state, next;
+  int c;
+  int j;
+
+  if (workSize < size) {
+    work = (int*) realloc(work, size*sizeof(int));
+    mark = (char*) realloc(mark, size);
+    memset(mark, 0x00, size);
+    workSize = size;
+  }
+
+  if (d->start < 0) {
+    dfaClose(next1[0]);
+    if (d->count == DFA_MAX) dfaClear(mode);
+    d->start = dfaAdd(mode);
+  }
+  state = d->start;
+
+  for (j=0;;j++) {
+    // end state (EOP) reached?
+    if (d->sets[state][0] && d->sets[state][1] == EOP) {
+      currentPos = (j > N) ? N : j;
+      return 1;
+    }
+    if ((minimal == true && j == N) || j > N) break;
+
+    c = (j < N) ? (int) a[j] : 0;
+    next = d->next[state*256 + (unsigned char) c];
+    if (next < 0) next = dfaStep(mode, state, c);
+    // no states left to go on with?
+    if (d->sets[next][0] == 0) break;
+    state = next;
+  }
+
+  currentPos = (j > N) ? N : j;
+  return 0;
+}
+
+/*************************************************************/
+/* automaton::dfaClose                                       */
+/*                                                           */
+/* mark the given NFA state and all states reachable from it */
+/* by epsilon transitions. epsilon states are only passed,   */
+/* they do not become part of the DFA state.                 */
+/*************************************************************/
+void automaton::dfaClose(int state)
+{
+  int top = 0;
+  int n;
+
+  if (mark[state]) return;
+  mark[state] = 1;
+  work[top++] = state;
+
+  while (top) {
+    state = work[--top];
+    // EOP ends the pattern, anything else but epsilon consumes
+    if (state == EOP || (ch[state] & SCAN) != EPSILON) continue;
+    mark[state] = 2;
+    n = next1[state];
+    if (!mark[n]) {
+      mark[n] = 1;
+      work[top++] = n;
+    }
+    n = next2[state];
+    if (!mark[n]) {
+      mark[n] = 1;
+      work[top++] = n;
+    }
+  }
+}
+
+/*************************************************************/
+/* automaton::dfaAdd                                         */
+/*                                                           */
+/* collect the marked NFA states into a DFA state and clear  */
+/* the marks. returns the number of the DFA state, which is  */
+/* only created if no state with the same set exists yet.    */
+/*************************************************************/
+int automaton::dfaAdd(int mode)
+{
+  dfa *d = &dfas[mode];
+  int n = 0;
   int i;
+
+  for (i=0;i<size;i++) {
+    if (mark[i] == 1) work[n++] = i;
+    mark[i] = 0;
+  }
+
+  for (i=0;i<d->count;i++)
+    if (d->sets[i][0] == n && !memcmp(d->sets[i]+1, work, n*sizeof(int)))
+      return i;
+
+  if (d->count == d->alloc) {
+    d->alloc = d->alloc ? d->alloc*2 : 16;
+    d->next = (int*) realloc(d->next, d->alloc*256*sizeof(int));
+    d->sets = (int**) realloc(d->sets, d->alloc*sizeof(int*));
+  }
+  d->sets[d->count] = (int*) malloc((n+1)*sizeof(int));
+  d->sets[d->count][0] = n;
+  memcpy(d->sets[d->count]+1, work, n*sizeof(int));
+  memset(d->next+d->count*256, 0xff, 256*sizeof(int));
+
+  return d->count++;
+}
+
+/*************************************************************/
+/* automaton::dfaStep                                        */
+/*                                                           */
+/* build the transition of a DFA state on character c the    */
+/* way the automaton would take it and return the new state. */
+/*************************************************************/
+int automaton::dfaStep(int mode, int from, int c)
+{
+  dfa *d = &dfas[mode];
+  int *nfa = d->sets[from];
+  int state;
   int set;
   int len;
+  int i, k;
   bool found;
 
-  // terminates when end state (==0) is reached
-  while (state) {
-#ifdef MYDEBUG
-    printf("double queue dump:\n");
-    dq.dump();
-#endif
-    // go to next character
-    if (state == SCAN) {
-      if (minimal == true && j == N) break; // for minimal match
-#ifdef MYDEBUG
-      printf("consume %2d %c\n",j,a[j]);
-#endif
-      j++;
-      dq.put(SCAN);
-    }
-    else
+  for (k=1;k<=nfa[0];k++) {
+    state = nfa[k];
+    if (state == EOP) continue;
+
     switch (ch[state] & SCAN) {
-    case EPSILON:        // epsilon transition
-      n1 = next1[state];
-      n2 = next2[state];
-      dq.push(n1);
-      if (n1 != n2) dq.push(n2);
-      break;
     case SET:            // inclusive set
     case SET|NOT:        // exclusive set
       set = (ch[state] & 0x0fff0000)>>16;   // get set number
@@ -689,45 +813,45 @@ int automaton::match(char *a, int N)  // string length passed in
       found = (ch[state]&NOT)?true:false;   // set default value
 
       for (i=1; i<=len; i++) {
-        if (setArray[set][i] == (int) a[j]) {
+        if (setArray[set][i] == c) {
           found = !found;
           break;
         }
       }
-      if (found) {
-        dq.put(next1[state]);
-      }
+      if (found) dfaClose(next1[state]);
       break;
     case ANY:            // just match any character
-      dq.put(next1[state]);
+      dfaClose(next1[state]);
       break;
-    default:
-      if (j < N) { // freeState: we can't read past end of string
-        // normal character?
-        if (ch[state] == (int) a[j]) {
-          dq.put(next1[state]);
-        }
-      } else if (j == N) {  // simulate zero-terminated string in any case
-        if (ch[state] == (int) 0) {
-          dq.put(next1[state]);
-        }
-      }
+    default:             // normal character
+      if (ch[state] == c) dfaClose(next1[state]);
       break;
     }
-#ifdef MYDEBUG
-    printf("dq is %s\n",dq.isEmpty()?"empty":"NOT empty");
-    dq.dump();
-#endif
-    // break out if we've reached the end of the string
-    // or no more states are available
-    if (dq.isEmpty() || (j>(N+1)) ) break;
-    state = dq.pop();
   }
 
-  currentPos = j;
+  // a full DFA is started over, which also drops the from state
+  if (d->count == DFA_MAX) {
+    dfaClear(mode);
+    return dfaAdd(mode);
+  }
+
+  // dfaAdd may move d->next
+  state = dfaAdd(mode);
+  d->next[from*256 + (unsigned char) c] = state;
+  return state;
+}
 
-  if (currentPos > N) currentPos = N;
+/*************************************************************/
+/* automaton::dfaClear                                       */
+/*                                                           */
+/* throw away the DFA states built for a matching mode.      */
+/*************************************************************/
+void automaton::dfaClear(int mode)
+{
+  dfa *d = &dfas[mode];
 
-  // return 1 if end state (EOP) has been reached
-  return state==EOP?1:0;
+  for (int i=0;i<d->count;i++)
+    free(d->sets[i]);
+  d->count = 0;
+  d->start = -1;
 }
@@ -47,6 +47,21 @@
 
 #include "dblqueue.hpp"
 
+// largest number of DFA states kept; a DFA that grows past this
+// is thrown away and built again from the current state
+#define DFA_MAX 256
+
+// a DFA built lazily from the automaton while matching. each DFA
+// state is a set of NFA states; state sets are kept sorted, so a
+// set holding EOP has it first.
+struct dfa {
+  int   count;    // number of DFA states
+  int   alloc;    // number of DFA states allocated
+  int   start;    // start state, -1 if not built yet
+  int  *next;     // 256 transitions per state, -1 if not built yet
+  int **sets;     // NFA states of each DFA state, [0] is the count
+};
+
 class automaton {
   public:
     automaton();              // CTOR
@@ -78,6 +93,12 @@ class automaton {
     // helper function for set building
     int checkRange(char*, int, char);
 
+    // methods to build the DFA
+    void dfaClose(int);
+    int  dfaAdd(int);
+    int  dfaStep(int, int, int);
+    void dfaClear(int);
+
     int *ch;        // characters to match
     int *next1;     // first transition possibility
     int *next2;     // second transition possibility
@@ -93,6 +114,14 @@ class automaton {
     int  freeState; // number of next free state
     int  currentPos;// current position in parsing
     bool minimal;   // minimal matching?
+
+    dfa  dfas[2];   // DFA for maximal and minimal matching
+    int *work;      // NFA state list while building the DFA
+    char *mark;     // NFA states in work (1) or passed (2)
+    int  workSize;  // number of elements in work and mark
+
+    char *lastRegexp; // last expression parsed successfully
+    int  lastPos;     // its parse position
 };
 
 #endif
@@ -355,130 +355,117 @@ int c2r_hostent(struct hostent const *value, PRXSTRING rx) {
 }
 
 /*======================================================
- = r2c_fd_setarray()
+ = r2c_stemvalue()
  ======================================================*/
-int r2c_fd_setarray(fd_set *ary, int *fdin, PRXSTRING rx, int *aryLen) {
-   int rAryLen;
-   char aryVal[256];   /* Should be plenty. */
-   char result[256];
+int r2c_stemvalue(PRXSTRING rx, int idx, char *buf, int bufLen) {
+   char name[MAXSTEMNAMELEN + 12];
    SHVBLOCK shv;
-   int rc;
-   int i,curr_fd;
-   int max_fd=0;
+   int len;
 
-   FD_ZERO(ary);
+   if (rx->strlength > MAXSTEMNAMELEN)
+      return -1;
 
-   strncpy(aryVal, rx->strptr, rx->strlength);
-   aryVal[rx->strlength] = '0';
-   aryVal[rx->strlength+1] = 0;
-   make_upper(aryVal);
+   memcpy(name, rx->strptr, rx->strlength);
+   name[rx->strlength] = 0;
+   make_upper(name);
 
    shv.shvnext = 0;
    shv.shvcode = RXSHV_SYFET;
-   shv.shvname.strptr = aryVal;
-   shv.shvname.strlength = rx->strlength + 1;
-   shv.shvvalue.strptr = result;
-   shv.shvvaluelen = sizeof(result);
-
-   rc = RexxVariablePool(&shv);
+   shv.shvname.strptr = name;
+   shv.shvname.strlength
+      = shv.shvnamelen
+      = sprintf(name + rx->strlength, "%d", idx) + rx->strlength;
+   shv.shvvalue.strptr = buf;
+   shv.shvvalue.strlength = bufLen - 1;
+   shv.shvvaluelen = bufLen - 1;
 
-   if (shv.shvret == RXSHV_TRUNC) {
-      shv.shvvalue.strptr[shv.shvvalue.strlength] = 0;
-   }
-   else
-      shv.shvvalue.strptr[shv.shvvaluelen] = 0;
-   rAryLen = atoi(result);
+   RexxVariablePool(&shv);
 
-   if (rAryLen > *aryLen) {
-      /* Rexx array too large.  Punt. */
-      return 0;
-   }
+   if (shv.shvret & (RXSHV_NEWV | RXSHV_BADN))
+      return -1;
 
-   for (i = 0; i < rAryLen; i++) {
-      shv.shvname.strlength
-         = shv.shvnamelen
-         = sprintf(shv.shvname.strptr + rx->strlength, "%d", i + 1)
-           + rx->strlength;
-      shv.shvvaluelen = sizeof(result);
-      rc = RexxVariablePool(&shv);
-      result[shv.shvvalue.strlength] = 0;
-      curr_fd = atoi(result);
-      FD_SET(curr_fd, ary);
-      *fdin = curr_fd;
-      if (curr_fd > max_fd)
-         max_fd = curr_fd;
-      fdin++;
-   }
+   len = shv.shvvalue.strlength;
+   if (len > bufLen - 1)
+      len = bufLen - 1;
+   buf[len] = 0;
 
-   *aryLen = rAryLen;
-   return max_fd;
+   return len;
 }
 
 /*======================================================
- = c2r_fd_setarray()
+ = c2r_stemvalue()
  ======================================================*/
-int c2r_fd_setarray(fd_set *ary, int *fdin, PRXSTRING rx,int numin) {
-   int rAryLen;
-   char rxName[256];   /* Should be plenty. */
-   char rxVal[256];
+int c2r_stemvalue(PRXSTRING rx, int idx, char *buf, int len) {
+   char name[MAXSTEMNAMELEN + 12];
    SHVBLOCK shv;
    int rc;
-   int i;
 
-   strncpy(rxName, rx->strptr, rx->strlength);
-   rxName[rx->strlength] = '0';
-   rxName[rx->strlength + 1] = 0;
-   make_upper(rxName);
+   if (rx->strlength > MAXSTEMNAMELEN)
+      return 0;
+
+   memcpy(name, rx->strptr, rx->strlength);
+   name[rx->strlength] = 0;
+   make_upper(name);
 
    shv.shvnext = 0;
-   shv.shvcode = RXSHV_SYSET;
-   shv.shvname.strptr = rxName;
+   shv.shvcode = buf ? RXSHV_SYSET : RXSHV_SYDRO;
+   shv.shvname.strptr = name;
+   shv.shvname.strlength
+      = shv.shvnamelen
+      = sprintf(name + rx->strlength, "%d", idx) + rx->strlength;
+   shv.shvvalue.strptr = buf;
+   shv.shvvalue.strlength = len;
+   shv.shvvaluelen = len;
 
-   shv.shvvalue.strptr = rxVal;
+   rc = RexxVariablePool(&shv);
 
-   /* Loop through the fd_set to find all of the FDs that are set. */
-   rAryLen = 0;
-#ifdef __WIN32__
-   for (i = 0; i < ary->fd_count; i++) {
-      rAryLen++;
-      shv.shvname.strlength
-         = sprintf(rxName + rx->strlength, "%d", rAryLen)
-         + rx->strlength;
+   return ((rc == RXSHV_OK) || (rc == RXSHV_NEWV)) ? 1 : 0;
+}
 
-      shv.shvvaluelen
-         = shv.shvvalue.strlength
-         = sprintf(rxVal, "%d", ary->fd_array[i]);
+/*======================================================
+ = r2c_stemcount()
+ ======================================================*/
+int r2c_stemcount(PRXSTRING rx) {
+   char result[32];
 
-      rc = RexxVariablePool(&shv);
-   }
-#else
-   for (i = 0; i < numin; i++) {
-      if ( FD_ISSET( fdin[i], ary ) ) {
-         rAryLen++;
-         shv.shvname.strlength
-            = sprintf(rxName + rx->strlength, "%d", rAryLen)
-            + rx->strlength;
-         shv.shvvaluelen
-            = shv.shvvalue.strlength
-            = sprintf(rxVal, "%d", fdin[i]);
-
-         rc = RexxVariablePool(&shv);
-      }
+   if (r2c_stemvalue(rx, 0, result, sizeof(result)) < 0)
+      return 0;
+
+   return atoi(result);
+}
+
+/*======================================================
+ = r2c_sockarray()
+ ======================================================*/
+void r2c_sockarray(int *socks, int num, PRXSTRING rx) {
+   char result[32];
+   int i;
+
+   for (i = 0; i < num; i++) {
+      if (r2c_stemvalue(rx, i + 1, result, sizeof(result)) < 0)
+         socks[i] = -1;
+      else
+         socks[i] = atoi(result);
    }
-#endif
+}
 
-   /* Set the 0th element of the Rexx array to the size. */
-   shv.shvname.strlength
-      = sprintf(rxName + rx->strlength, "%d", 0)
-      + rx->strlength;
-   
-   shv.shvvaluelen
-      = shv.shvvalue.strlength
-      = sprintf(rxVal, "%d", rAryLen);
+/*======================================================
+ = c2r_sockarray()
+ ======================================================*/
+int c2r_sockarray(int *socks, int num, PRXSTRING rx) {
+   char rxVal[32];
+   int count = 0;
+   int i;
 
-   rc = RexxVariablePool(&shv);
+   for (i = 0; i < num; i++) {
+      if (socks[i] != -1) {
+         count++;
+         if (!c2r_stemvalue(rx, count, rxVal, sprintf(rxVal, "%d", socks[i])))
+            return 0;
+      }
+   }
 
-   return 1;
+   return c2r_stemvalue(rx, 0, rxVal, sprintf(rxVal, "%d", count));
 }
 
 /*======================================================
@@ -207,22 +207,45 @@ int c2r_sockaddr_in(SOCKADDR_IN const *value, PRXSTRING rx);
 int c2r_hostent(struct hostent const *value, PRXSTRING rx);
 
 /*======================================================
- = r2c_fd_setarray()
- = Converts a Rexx stem array of integers to a C fd_set.
- = When called, aryLen should be the size of the array 'ary'.
- = On return, aryLen will be the number of members actually
- = converted.
- = If successful, returns the maximum value of all fds.  
- = Otherwise returns -1.
+ = r2c_stemvalue()
+ = Fetches element idx of the Rexx stem named by rx into
+ = buf, which holds bufLen bytes; the value is truncated
+ = to fit and zero-terminated.
+ = Returns the length of the value, or -1 if the element
+ = is not set.
  ======================================================*/
-int r2c_fd_setarray(fd_set *ary, int *fdin, PRXSTRING rx, int *aryLen);
+int r2c_stemvalue(PRXSTRING rx, int idx, char *buf, int bufLen);
 
 /*======================================================
- = c2r_fd_setarray()
- = Converts a C fd_set to a Rexx stem array of integers.
+ = c2r_stemvalue()
+ = Sets element idx of the Rexx stem named by rx to the
+ = len bytes at buf, or drops it if buf is NULL.
  = If successful, returns 1.  Otherwise returns 0.
  ======================================================*/
-int c2r_fd_setarray(fd_set *ary, int *fdin, PRXSTRING rx, int numin);
+int c2r_stemvalue(PRXSTRING rx, int idx, char *buf, int len);
+
+/*======================================================
+ = r2c_stemcount()
+ = Returns the number held in element 0 of a Rexx stem,
+ = or 0 if it is not set.
+ ======================================================*/
+int r2c_stemcount(PRXSTRING rx);
+
+/*======================================================
+ = r2c_sockarray()
+ = Converts the first num elements of a Rexx stem array
+ = of sockets to C.  Elements that are not set become -1.
+ ======================================================*/
+void r2c_sockarray(int *socks, int num, PRXSTRING rx);
+
+/*======================================================
+ = c2r_sockarray()
+ = Converts a C array of num sockets to a Rexx stem array,
+ = leaving out the ones that are -1, and sets element 0
+ = to the number of sockets stored.
+ = If successful, returns 1.  Otherwise returns 0.
+ ======================================================*/
+int c2r_sockarray(int *socks, int num, PRXSTRING rx);
 
 /*======================================================
  = setRexxVar()
@@ -70,6 +70,7 @@ RexxFunctionHandler SockAccept;
 RexxFunctionHandler SockBind;
 RexxFunctionHandler SockClose;
 RexxFunctionHandler SockConnect;
+RexxFunctionHandler SockConnectStem;
 RexxFunctionHandler SockDropFuncs;
 RexxFunctionHandler SockLoadFuncs;
 RexxFunctionHandler SockGetHostByAddr;
@@ -84,6 +85,7 @@ RexxFunctionHandler SockListen;
 RexxFunctionHandler SockPSock_Errno;
 RexxFunctionHandler SockRecv;
 RexxFunctionHandler SockRecvFrom;
+RexxFunctionHandler SockRecvStem;
 RexxFunctionHandler SockSelect;
 RexxFunctionHandler SockSend;
 RexxFunctionHandler SockSendTo;
@@ -106,6 +108,7 @@ RexxFunction RxSockFunctions[] = {
  { "SOCKBIND",         SockBind,           "SockBind"          , 1 },
  { "SOCKCLOSE",        SockClose,          "SockClose"         , 1 },
  { "SOCKCONNECT",      SockConnect,        "SockConnect"       , 1 },
+ { "SOCKCONNECTSTEM",  SockConnectStem,    "SockConnectStem"   , 1 },
  { "SOCKDROPFUNCS",    SockDropFuncs,      "SockDropFuncs"     , 1 },
  { "SOCKGETHOSTBYADDR",SockGetHostByAddr,  "SockGetHostByAddr" , 1 },
  { "SOCKGETHOSTBYNAME",SockGetHostByName,  "SockGetHostByName" , 1 },
@@ -119,6 +122,7 @@ RexxFunction RxSockFunctions[] = {
  { "SOCKPSOCK_ERRNO",  SockPSock_Errno,    "SockPSock_Errno"   , 1 },
  { "SOCKRECV",         SockRecv,           "SockRecv"          , 1 },
  { "SOCKRECVFROM",     SockRecvFrom,       "SockRecvFrom"      , 1 },
+ { "SOCKRECVSTEM",     SockRecvStem,       "SockRecvStem"      , 1 },
  { "SOCKSELECT",       SockSelect,         "SockSelect"        , 1 },
  { "SOCKSEND",         SockSend,           "SockSend"          , 1 },
  { "SOCKSENDTO",       SockSendTo,         "SockSendTo"        , 1 },
@@ -234,6 +238,75 @@ static int initializeSockets() {
 
 #define CHECK_INIT if (socksNotInitted) if (initializeSockets()) return 40
 
+#if defined(__WIN32__) && !defined(ETIMEDOUT)
+# define ETIMEDOUT WSAETIMEDOUT
+#endif
+
+/********************************************************************
+ * waitSockets()
+ *    Waits until sockets are ready, the way os2_select() does: socks
+ *    holds numRd sockets to check for reading, then numWr for writing
+ *    and numEx for exceptional conditions.  On return, the sockets
+ *    that are not ready are set to -1.  Waits at most ms milliseconds,
+ *    or without a limit if ms is negative.
+ *
+ *    Returns the number of ready sockets, 0 on timeout or -1 on error.
+ *    On OS/2 there is no limit on the number of sockets; elsewhere
+ *    they must fit an fd_set.
+ ********************************************************************/
+static int waitSockets(int *socks, int numRd, int numWr, int numEx, long ms) {
+#if defined(OS2) || defined(__OS2__)
+   return os2_select(socks, numRd, numWr, numEx, ms);
+#else
+   fd_set fds[3];
+   fd_set *fdsp[3] = { 0, 0, 0 };
+   int num[3];
+   struct timeval tim;
+   int max_fd = 0;
+   int i, j, k;
+   int rcode;
+
+   num[0] = numRd;
+   num[1] = numWr;
+   num[2] = numEx;
+
+   for (i = 0, k = 0; i < 3; i++) {
+      FD_ZERO(&fds[i]);
+#ifdef __WIN32__
+      if (num[i] > FD_SETSIZE)
+         return -1;
+#endif
+      for (j = 0; j < num[i]; j++, k++) {
+#ifndef __WIN32__
+         if (socks[k] < 0 || socks[k] >= FD_SETSIZE)
+            return -1;
+#endif
+         FD_SET(socks[k], &fds[i]);
+         if (socks[k] > max_fd)
+            max_fd = socks[k];
+      }
+      if (num[i])
+         fdsp[i] = &fds[i];
+   }
+
+   tim.tv_sec = ms / 1000;
+   tim.tv_usec = (ms % 1000) * 1000;
+
+   rcode = select(max_fd + 1, fdsp[0], fdsp[1], fdsp[2], (ms < 0) ? 0 : &tim);
+
+   if (rcode >= 0) {
+      for (i = 0, k = 0; i < 3; i++) {
+         for (j = 0; j < num[i]; j++, k++) {
+            if (!FD_ISSET(socks[k], &fds[i]))
+               socks[k] = -1;
+         }
+      }
+   }
+
+   return rcode;
+#endif
+}
+
 /********************************************************************
  * SockAccept()
  *    Calls the C accept() function on the socket.
@@ -429,6 +502,143 @@ RFH_RETURN_TYPE SockConnect(RFH_ARG0_TYPE name, RFH_ARG1_TYPE argc, RFH_ARG2_TYP
    return rc;
 }
 
+/********************************************************************
+ * SockConnectStem()
+ *    Connects a stem array of sockets at once.  socks.i is connected
+ *    to the address in the stem named by addrs.i, all without
+ *    blocking; then the call waits at most timeoutsecs seconds
+ *    (without a limit if not given) for the connections to complete.
+ *
+ *    results.i is set to 0 for each socket that is connected and to
+ *    its socket error otherwise: ETIMEDOUT if it was still connecting
+ *    when the time was up, EINVAL if the socket or address could not
+ *    be read.  results.0 is set to socks.0.  The sockets are left in
+ *    blocking mode.
+ *
+ *    Returns the number of sockets connected, or -1 if no memory.
+ *
+ * Rexx call syntax:
+ *    rc = SockConnectStem(socks., addrs., results. [, timeoutsecs])
+ ********************************************************************/
+RFH_RETURN_TYPE SockConnectStem(RFH_ARG0_TYPE name, RFH_ARG1_TYPE argc, RFH_ARG2_TYPE argv,
+                                RFH_ARG3_TYPE queuename, RFH_ARG4_TYPE retstr) {
+   APIRET rc = 40;
+
+   CHECK_INIT;
+
+   RxSockData.RxPackageGlobalData = FunctionPrologue( RxSockData.RxPackageGlobalData, NULL, (char *)name, argc, argv );
+
+   if (argc == 3 || argc == 4) {
+      int num = r2c_stemcount(&argv[0]);
+      int *socks;
+      int *wait;
+      int *pend;
+      int *err;
+      int numWait = 0;
+      int connected = 0;
+      int rcode = 0;
+      long ms = -1;
+      char rxVal[16];
+      int i, k;
+
+      rc = 0;
+
+      if (argc == 4) {
+         int secs;
+
+         if (!r2c_int(&secs, &argv[3]))
+            secs = 0;
+         ms = secs * 1000L;
+      }
+
+      socks = malloc(4 * (num + 1) * sizeof(int));
+      if (!socks) {
+         strcpy(retstr->strptr, "-1");
+         retstr->strlength = 2;
+         return 0;
+      }
+      wait = socks + num + 1;
+      pend = wait + num + 1;
+      err  = pend + num + 1;
+
+      r2c_sockarray(socks, num, &argv[0]);
+
+      /* Start all the connections. */
+      for (i = 0; i < num; i++) {
+         char addrName[MAXSTEMNAMELEN + 1];
+         RXSTRING addr;
+         struct sockaddr_in sockaddr;
+         u_long on = 1;
+
+         err[i] = EINVAL;
+
+         addr.strptr = addrName;
+         addr.strlength = r2c_stemvalue(&argv[1], i + 1, addrName, sizeof(addrName));
+
+         if (socks[i] == -1 || (int)addr.strlength <= 0
+             || !r2c_sockaddr_in(&sockaddr, &addr)) {
+            socks[i] = -1;     /* left alone */
+            continue;
+         }
+
+         ioctlsocket(socks[i], FIONBIO, &on);
+
+         if (connect(socks[i], (struct sockaddr *)&sockaddr,
+                     sizeof(struct sockaddr_in)) == 0)
+            err[i] = 0;
+         else {
+            err[i] = ETIMEDOUT;
+            pend[numWait] = i;
+            wait[numWait++] = socks[i];
+         }
+      }
+
+      /* Wait for the rest; a socket is writable once connect ends. */
+      if (numWait) {
+         rcode = waitSockets(wait, 0, numWait, 0, ms);
+         UPDATE_ERRNO;
+      }
+
+      for (k = 0; k < numWait; k++) {
+         i = pend[k];
+
+         if (rcode < 0)
+            err[i] = lastSockErrno;
+         else if (wait[k] != -1) {
+            int soErr = 0;
+            int soLen = sizeof(soErr);
+
+            if (getsockopt(socks[i], SOL_SOCKET, SO_ERROR,
+                           (char *)&soErr, &soLen) == 0)
+               err[i] = soErr;
+            else
+               err[i] = UPDATE_ERRNO;
+         }
+      }
+
+      for (i = 0; i < num; i++) {
+         if (socks[i] != -1) {
+            u_long off = 0;
+
+            ioctlsocket(socks[i], FIONBIO, &off);
+         }
+
+         if (err[i] == 0)
+            connected++;
+
+         c2r_stemvalue(&argv[2], i + 1, rxVal, sprintf(rxVal, "%d", err[i]));
+      }
+
+      c2r_stemvalue(&argv[2], 0, rxVal, sprintf(rxVal, "%d", num));
+
+      free(socks);
+
+      retstr->strlength = sprintf(retstr->strptr, "%d", connected);
+   }
+
+   return rc;
+}
+
 /********************************************************************
  * SockDropFuncs()
  *    Drops all the functions here, making them unavailable to Rexx.
@@ -1224,11 +1434,100 @@ RFH_RETURN_TYPE SockRecvFrom(RFH_ARG0_TYPE name, RFH_ARG1_TYPE argc, RFH_ARG2_TY
    return rc;
 }
 
+/********************************************************************
+ * SockRecvStem()
+ *    Receives from a stem array of sockets at once.  Waits at most
+ *    timeoutsecs seconds (without a limit if not given) until any of
+ *    socks.i has data, then calls recv() for up to len bytes on each
+ *    socket that has.
+ *
+ *    data.i is set to what was received from socks.i, which is empty
+ *    if the connection was closed; it is dropped for the sockets
+ *    that had nothing or failed.  data.0 is set to socks.0.
+ *
+ *    Returns the number of sockets received from, 0 on timeout or -1
+ *    on error.
+ *
+ * Rexx call syntax:
+ *    rc = SockRecvStem(socks., data., len [, timeoutsecs])
+ ********************************************************************/
+RFH_RETURN_TYPE SockRecvStem(RFH_ARG0_TYPE name, RFH_ARG1_TYPE argc, RFH_ARG2_TYPE argv,
+                             RFH_ARG3_TYPE queuename, RFH_ARG4_TYPE retstr) {
+   APIRET rc = 40;
+   int len;
+
+   CHECK_INIT;
+
+   RxSockData.RxPackageGlobalData = FunctionPrologue( RxSockData.RxPackageGlobalData, NULL, (char *)name, argc, argv );
+
+   if ((argc == 3 || argc == 4) && r2c_int(&len, &argv[2]) && len > 0) {
+      int num = r2c_stemcount(&argv[0]);
+      int *socks;
+      char *buf;
+      int rcode;
+      int numRd = 0;
+      long ms = -1;
+      char rxVal[16];
+      int i;
+
+      rc = 0;
+
+      if (argc == 4) {
+         int secs;
+
+         if (!r2c_int(&secs, &argv[3]))
+            secs = 0;
+         ms = secs * 1000L;
+      }
+
+      socks = malloc((num + 1) * sizeof(int));
+      buf = malloc(len);
+      if (!socks || !buf) {
+         free(socks);
+         free(buf);
+         strcpy(retstr->strptr, "-1");
+         retstr->strlength = 2;
+         return 0;
+      }
+
+      r2c_sockarray(socks, num, &argv[0]);
+
+      rcode = num ? waitSockets(socks, num, 0, 0, ms) : 0;
+      UPDATE_ERRNO;
+
+      for (i = 0; i < num; i++) {
+         int got = -1;
+
+         if (rcode > 0 && socks[i] != -1) {
+            got = recv(socks[i], buf, len, 0);
+            if (got < 0)
+               UPDATE_ERRNO;
+         }
+
+         if (got >= 0) {
+            c2r_stemvalue(&argv[1], i + 1, buf, got);
+            numRd++;
+         }
+         else
+            c2r_stemvalue(&argv[1], i + 1, NULL, 0);
+      }
+
+      c2r_stemvalue(&argv[1], 0, rxVal, sprintf(rxVal, "%d", num));
+
+      free(buf);
+      free(socks);
+
+      retstr->strlength = sprintf(retstr->strptr, "%d", (rcode < 0) ? -1 : numRd);
+   }
+
+   return rc;
+}
+
 /********************************************************************
  * SockSelect()
- *    Calls the C select() function.
+ *    Calls the C select() function; on OS/2, os2_select(), which has
+ *    no limit on the number of sockets.
  *
- * *** Max size for any of the fd_set's is 64. ***
  * *** THIS CALL MAY VARY SLIGHTLY FROM OS/2 RXSOCK's BEHAVIOUR. ***
  * *** SEE COMMENTS IN CODE BELOW FOR EXPLANATION.               ***
  *
@@ -1238,21 +1537,18 @@ RFH_RETURN_TYPE SockRecvFrom(RFH_ARG0_TYPE name, RFH_ARG1_TYPE argc, RFH_ARG2_TY
 RFH_RETURN_TYPE SockSelect(RFH_ARG0_TYPE name, RFH_ARG1_TYPE argc, RFH_ARG2_TYPE argv,
                            RFH_ARG3_TYPE queuename, RFH_ARG4_TYPE retstr) {
    APIRET rc = 40;
-   int max_fd=0;
 
    CHECK_INIT;
 
    RxSockData.RxPackageGlobalData = FunctionPrologue( RxSockData.RxPackageGlobalData, NULL, (char *)name, argc, argv );
 
    if (argc == 3 || argc == 4) {
-      fd_set fds[3];
-      fd_set *fdsp[3] = { 0, 0, 0 };
-      int fdin[3][FD_SETSIZE];
-      int numin[3];
-      int i;
-      struct timeval tim;
-      struct timeval *timp = 0;
-      int anyFds = 0;    /* Flag for: Are any non-empty fds specified? */
+      int *socks;
+      int num[3];
+      int total = 0;
+      int i, k;
+      long ms = -1;
+      int secs = 0;
 
       /*
        * Never return 'Invalid call' if number of parameters is
@@ -1260,50 +1556,16 @@ RFH_RETURN_TYPE SockSelect(RFH_ARG0_TYPE name, RFH_ARG1_TYPE argc, RFH_ARG2_TYPE
        */
       rc = 0;
 
-      /* Read the fd_sets */
+      /* Count the sockets in each set; unspecified sets are empty. */
       for (i = 0; i < 3; i++) {
-         if (argv[i].strlength != 0) {
-            /* This set was specified.  Convert it. */
-            int curr_max = 0;
-
-            numin[i] = FD_SETSIZE;
-            curr_max = r2c_fd_setarray(&fds[i], (int *)&fdin[i], &argv[i], &numin[i]);
-            if (curr_max == -1) {
-               /*
-                * Too many sockets specified.  Can't do much other
-                * than simply exit.
-                * NOTE:
-                *   This may be different that OS/2 RXSOCK's behavior.
-                *   OS/2 RXSOCK's max sockets and its behavior when
-                *   that maximum is exceeded is not documented and I
-                *   did not try to determine them experimentaly.
-                */
-               strcpy(retstr->strptr, "-1");
-               retstr->strlength = 2;
-               return 0;
-            }
-            else {
-               /*
-                * If numin[i] == 0, we are not using any sockets for this
-                * fd_set.  To get the same behaviour as OS/2's RXSOCK
-                * we can't set fdsp[i] to an empty fd_set, we must
-                * instead use the NULL pointer. (WinSock will return
-                * immediately, OS/2 doesn't).
-                */
-               if (curr_max > max_fd)
-                  max_fd = curr_max;
-               if (numin[i] != 0) {
-                  fdsp[i] = &fds[i];
-                  anyFds = 1;
-               }
-            }
-         }
+         num[i] = (argv[i].strlength != 0) ? r2c_stemcount(&argv[i]) : 0;
+         if (num[i] < 0)
+            num[i] = 0;
+         total += num[i];
       }
 
       /* Read the timeout if it was specified. */
       if (argc == 4) {
-         int secs;
-
          /*
           * OS/2's RXSOCK seems to consider an invalid timeval to be
           * be the same as specifying 0.
@@ -1312,52 +1574,60 @@ RFH_RETURN_TYPE SockSelect(RFH_ARG0_TYPE name, RFH_ARG1_TYPE argc, RFH_ARG2_TYPE
             secs = 0;
          }
 
-         timp = &tim;
-         tim.tv_sec = secs;
-         tim.tv_usec = 0;
+         ms = secs * 1000L;
       }
 
-      /* We are finally ready to make the call to select. */
       /*
        * WinSock select() returns immediatly if all fds are
        * unspecified or empty.  OS/2's RXSOCK waits for timeout
        * to expire before returning (this is documented behavior in
        * RXSOCK.INF).  Simulate OS/2 RXSOCK's behavior here.
        */
-      if (anyFds) {
+      if (total) {
          int rcode;
 
-         rcode = select(max_fd+1, fdsp[0], fdsp[1], fdsp[2], timp);
+         socks = malloc(total * sizeof(int));
+         if (!socks) {
+            strcpy(retstr->strptr, "-1");
+            retstr->strlength = 2;
+            return 0;
+         }
+
+         /* All three sets go into one array, as os2_select() takes them. */
+         for (i = 0, k = 0; i < 3; k += num[i++])
+            r2c_sockarray(socks + k, num[i], &argv[i]);
+
+         rcode = waitSockets(socks, num[0], num[1], num[2], ms);
          UPDATE_ERRNO;
 
          retstr->strlength
             = sprintf(retstr->strptr, "%d", rcode);
 
-         /* Now we have to copy the fd_array back to the Rexx arrays. */
-         for (i = 0; i < 3; i++) {
-#ifdef WIN32
-            if ((fdsp[i] != 0)
-                && (c2r_fd_setarray(fdsp[i], fdin[i], &argv[i], numin[i]) == 0)) {
-#else
-            if ((c2r_fd_setarray(fdsp[i], fdin[i], &argv[i], numin[i]) == 0)) {
-#endif
-               /* Conversion error.  exit. */
-               strcpy(retstr->strptr, "-1");
-               retstr->strlength = 2;
-               return 0;
+         /* Now we have to copy the ready sockets back to the Rexx arrays. */
+         if (rcode >= 0) {
+            for (i = 0, k = 0; i < 3; k += num[i++]) {
+               if ((argv[i].strlength != 0)
+                   && (c2r_sockarray(socks + k, num[i], &argv[i]) == 0)) {
+                  /* Conversion error.  exit. */
+                  strcpy(retstr->strptr, "-1");
+                  retstr->strlength = 2;
+                  break;
+               }
             }
          }
+
+         free(socks);
       }
       else {
          /* Return 0. */
          *retstr->strptr = '0';
          retstr->strlength = 1;
 
-         if (timp) {
+         if (argc == 4) {
 #if defined(_MSC_VER)
-            Sleep(timp->tv_sec*1000);
+            Sleep(secs*1000);
 #else
-            sleep(timp->tv_sec);
+            sleep(secs);
 #endif
          }
 
@@ -1808,6 +2078,7 @@ USHORT InitFunc( RXFUNCBLOCK **FuncBlock )
       { "SOCKBIND",         SockBind,           NULL                 },
       { "SOCKCLOSE",        SockClose,          NULL                 },
       { "SOCKCONNECT",      SockConnect,        NULL                 },
+      { "SOCKCONNECTSTEM",  SockConnectStem,    NULL                 },
       { "SOCKDROPFUNCS",    SockDropFuncs,      NULL                 },
       { "SOCKGETHOSTBYADDR",SockGetHostByAddr,  NULL                 },
       { "SOCKGETHOSTBYNAME",SockGetHostByName,  NULL                 },
@@ -1821,6 +2092,7 @@ USHORT InitFunc( RXFUNCBLOCK **FuncBlock )
       { "SOCKPSOCK_ERRNO",  SockPSock_Errno,    NULL                 },
       { "SOCKRECV",         SockRecv,           NULL                 },
       { "SOCKRECVFROM",     SockRecvFrom,       NULL                 },
+      { "SOCKRECVSTEM",     SockRecvStem,       NULL                 },
       { "SOCKSELECT",       SockSelect,         NULL                 },
       { "SOCKSEND",         SockSend,           NULL                 },
       { "SOCKSENDTO",       SockSendTo,         NULL                 },
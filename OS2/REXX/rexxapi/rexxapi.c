@@ -590,6 +590,11 @@ APIRET APIENTRY RexxQuerySubcom(
 
 /*
  * External functions
+ *
+ * These are passed straight to the interpreter, which keeps the
+ * registrations and resolves and loads the function DLLs itself.
+ * Results are not cached here: RxFuncAdd and RxFuncDrop in a script
+ * change the registrations without going through this DLL.
  */
 APIRET APIENTRY RexxRegisterFunctionExe(
    PCSZ name,
@@ -23,10 +23,52 @@
 
 #include <string.h>
 
+#ifdef __386__
+#define  INCL_DOSSEMAPHORES
+#include <process.h>
+#endif
+
 #include <all_shared.h> /* shared functions and defines */
 
 #define DONT_HAVE_DIRECTORY     0x2727    //!< Attribute to exclude directories
 
+#define FIND_BUFFER_SIZE        0x7f00    //!< Bytes per DosFindFirst/Next call
+#define FIND_ENTRIES            512       //!< Entries asked for per call
+#define ARENA_BLOCK_SIZE        0x1000    //!< Bytes per name arena block
+
+#ifdef __386__
+#define RECURSE_THREADS         4         //!< Threads for all_RECURSE_PARALLEL
+#define RECURSE_STACK_SIZE      0x10000   //!< Stack of each of these threads
+#endif
+
+/*!
+    @brief Block of the name arena
+
+    Names found in one directory are packed into a chain of these blocks,
+    so a directory costs a few allocations instead of one per entry.
+*/
+typedef struct __all_arena_block {
+    struct __all_arena_block *next;     //!< Next (older) block
+    ULONG used;                         //!< Bytes used in data
+    char data[ARENA_BLOCK_SIZE];        //!< The names
+} _all_arena_block;
+
+/*!
+    @brief Names found in one directory
+
+    Filled by _all_CollectSubdirs. All name strings live in the arena,
+    the three arrays just point into it.
+*/
+typedef struct __all_dir_entries {
+    _all_arena_block *arena;    //!< Name storage
+    char **dirs;                //!< Directories matching the mask
+    char **files;               //!< Files matching the mask
+    char **recurse;             //!< Directories to recurse into
+    ULONG num_dirs, max_dirs;
+    ULONG num_files, max_files;
+    ULONG num_recurse, max_recurse;
+} _all_dir_entries;
+
 /*!
     @brief State of the dynamic stack
 
@@ -36,25 +78,240 @@
 */
 typedef struct __all_traverse_state {
     char start[CCHMAXPATH];     //!< Where we start looking for subdirs
-    phList dirs;                //!< Pointer to the list of subdirectories
-    ULONG num_dirs;             //!< Number of subdirectories (excl files)
+    _all_dir_entries *entries;  //!< Subdirectories found there
     ULONG idx_dirs;             //!< Index to enumerate the directories
 } _all_traverse_state;
 
+#ifdef __386__
+/*!
+    @brief Directory waiting for a worker thread (all_RECURSE_PARALLEL)
+*/
+typedef struct __all_work_item {
+    struct __all_work_item *next;       //!< Next queued directory
+    ULONG level;                        //!< Depth level
+    char dir[CCHMAXPATH];               //!< Directory, ending in '\'
+} _all_work_item;
+#endif
+
+/*!
+    @brief Everything all_PerformRecursiveAction was asked to do
+*/
+typedef struct __all_recurse_ctx {
+    char *mask;
+    int actionOptions;
+    int fileAttrs;
+    int (*action_callback)(char*,char*,int,void *);
+    void *action_callback_data;
+    int (*error_callback)(ULONG,void *);
+    void *error_callback_data;
+#ifdef __386__
+    HMTX hmtx;                  //!< Guards the fields below
+    HEV hevWork;                //!< Posted when there is work or it ended
+    HEV hevDone;                //!< Posted when the last worker exits
+    _all_work_item *queue;      //!< Directories not started yet
+    ULONG pending;              //!< Queued plus in-progress directories
+    ULONG threads;              //!< Workers still running
+    int result;                 //!< First break, stops all workers
+#endif
+} _all_recurse_ctx;
+
+
+/*!
+  Copies name into the arena of entries
+
+  @return copy of name, NULL if out of memory
+*/
+static char *_all_ArenaSave(_all_dir_entries *entries, char *name)
+{
+  _all_arena_block *block = entries->arena;
+  ULONG len = strlen(name) + 1;
+  char *copy;
+
+  if (block == NULL || block->used + len > ARENA_BLOCK_SIZE)
+  {
+    block = malloc(sizeof(_all_arena_block));
+    if (block == NULL)
+      return NULL;
+    block->used = 0;
+    block->next = entries->arena;
+    entries->arena = block;
+  }
+
+  copy = block->data + block->used;
+  memcpy(copy, name, len);
+  block->used += len;
+
+  return copy;
+}
+
+/*!
+  Appends name (already in the arena) to a growing pointer array
+
+  @return NO_ERROR or ERROR_NOT_ENOUGH_MEMORY
+*/
+static APIRET _all_AddName(char ***parray, ULONG *pcount, ULONG *pmax,
+                           char *name)
+{
+  char **grown;
+
+  if (name == NULL)
+    return ERROR_NOT_ENOUGH_MEMORY;
+
+  if (*pcount == *pmax)
+  {
+    grown = realloc(*parray, (*pmax ? *pmax * 2 : 32) * sizeof(char *));
+    if (grown == NULL)
+      return ERROR_NOT_ENOUGH_MEMORY;
+    *parray = grown;
+    *pmax = *pmax ? *pmax * 2 : 32;
+  }
+
+  (*parray)[(*pcount)++] = name;
+
+  return NO_ERROR;
+}
+
+/*!
+  Releases the names and arrays of entries (not entries itself)
+*/
+static void _all_FreeEntries(_all_dir_entries *entries)
+{
+  _all_arena_block *block;
+
+  while (entries->arena != NULL)
+  {
+    block = entries->arena;
+    entries->arena = block->next;
+    free(block);
+  }
+
+  free(entries->dirs);
+  free(entries->files);
+  free(entries->recurse);
+  memset(entries, 0, sizeof(*entries));
+}
+
+/*!
+  Returns non zero, when mask matches every name (so the directories to
+  recurse into can be picked from the same find as the matching entries)
+*/
+static int _all_MaskMatchesAll(char *mask)
+{
+  return (strcmp(mask, "*") == 0) || (strcmp(mask, "*.*") == 0);
+}
+
+/* what _all_FindEntries should keep */
+#define FIND_KEEP_DIRS      0x01    //!< matching directories into dirs
+#define FIND_KEEP_FILES     0x02    //!< matching files into files
+#define FIND_KEEP_RECURSE   0x04    //!< directories (not . or ..) into recurse
+
+/*!
+  Runs one DosFindFirst/DosFindNext search for fileMask, asking for up to
+  FIND_ENTRIES entries per call, and sorts the results into entries
+
+  @return NO_ERROR, ERROR_NOT_ENOUGH_MEMORY or the error of DosFindFirst
+          or DosFindNext (ERROR_NO_MORE_FILES is not an error here)
+*/
+static APIRET _all_FindEntries(char *fileMask, ULONG ulAttr, int keep,
+                               _all_dir_entries *entries)
+{
+  HDIR hDir = HDIR_CREATE;
+#ifdef __386__
+  PFILEFINDBUF3 pffb;
+  ULONG ulEntries;
+#else
+  PFILEFINDBUF pffb;
+  USHORT ulEntries;
+#endif
+  char *pBuffer;
+  char *pName;
+  APIRET rc;
+  APIRET rcAdd = NO_ERROR;
+
+  pBuffer = malloc(FIND_BUFFER_SIZE);
+  if (pBuffer == NULL)
+    return ERROR_NOT_ENOUGH_MEMORY;
+
+  ulEntries = FIND_ENTRIES;
+  rc = DosFindFirst(fileMask,               /* dirs and/or files */
+                    &hDir,                  /* handle */
+                    ulAttr,                 /* attributes to match */
+                    (void *)pBuffer,        /* buffer */
+                    FIND_BUFFER_SIZE,       /* size of buffer */
+                    &ulEntries,             /* number of entries */
+                    FIL_STANDARD);          /* return only standard info (no EAs) */
+
+  while (rc == NO_ERROR && rcAdd == NO_ERROR)
+  {
+#ifdef __386__
+    pffb = (PFILEFINDBUF3)pBuffer;
+#else
+    pffb = (PFILEFINDBUF)pBuffer;
+#endif
+    for (; ulEntries > 0 && rcAdd == NO_ERROR; ulEntries--)
+    {
+      if (pffb->attrFile & FILE_DIRECTORY)
+      {
+        if (keep & FIND_KEEP_DIRS)
+        {
+          pName = _all_ArenaSave(entries, pffb->achName);
+          rcAdd = _all_AddName(&entries->dirs, &entries->num_dirs,
+                               &entries->max_dirs, pName);
+        }
+        if ((keep & FIND_KEEP_RECURSE) && rcAdd == NO_ERROR &&
+            (strcmp(pffb->achName, ".") != 0) &&
+            (strcmp(pffb->achName, "..") != 0))
+        {
+          pName = _all_ArenaSave(entries, pffb->achName);
+          rcAdd = _all_AddName(&entries->recurse, &entries->num_recurse,
+                               &entries->max_recurse, pName);
+        }
+      } else if (keep & FIND_KEEP_FILES)
+      {
+        pName = _all_ArenaSave(entries, pffb->achName);
+        rcAdd = _all_AddName(&entries->files, &entries->num_files,
+                             &entries->max_files, pName);
+      }
+
+#ifdef __386__
+      pffb = (PFILEFINDBUF3)((char *)pffb + pffb->oNextEntryOffset);
+#else
+      pffb = (PFILEFINDBUF)(pffb->achName + pffb->cchName + 1);
+#endif
+    }
+
+    ulEntries = FIND_ENTRIES;
+    rc = DosFindNext(hDir, (void *)pBuffer, FIND_BUFFER_SIZE, &ulEntries);
+  }
+
+  DosFindClose(hDir);
+  free(pBuffer);
+
+  if (rcAdd != NO_ERROR)
+    return rcAdd;
+
+  if (rc == ERROR_NO_MORE_FILES)
+    return NO_ERROR;
+
+  return rc;
+}
+
 
 /*!
-  Performs search for files/directories and fills up phlDirsList with results,
+  Performs search for files/directories and fills up entries with results,
   note: this internal function used by all_PerformRecursiveAction
-  Order of resulting data in list:
+  Resulting data:
   1. directories matching mask (if requested by all_RECURSE_DIRACTION file_options)
   2. files matching mask (if requested by all_RECURSE_FILEACTION file_options)
   3. directories for rucursion (if requested by all_RECURSE_DIRS via file_options)
 
+  Directories and files matching the mask come from a single search; when
+  the mask is '*' or '*.*' that same search also yields the directories
+  for recursion, otherwise a second search for '*' does.
+
   @param dir           directory to start searching from
   @param file          filemask
-  @param phlDirsList   Pointer to hList to be filled up, by function, note
-                       that functions first puts directories into list, and
-                       then files
+  @param entries       names found, to be released with _all_FreeEntries
   @param file_options  combination of all_RECURSE_* constants (use |), if
                        all_RECURSE_DIRS or all_RECURSE_DIRACTION are present,
                        function will search for directories, if
@@ -64,9 +321,6 @@ typedef struct __all_traverse_state {
                         searhing for files and directories, note that
                         presence of FILE_DIRECTORY has no effect
                         (it's overriden by function, while processing)
-  @param ulDirCount    count of directories returned in phlDirList
-  @param ulFileCount   count of files returned in phlDirList
-  @param ulRecurseDirCount count of directories to be recursed returned in phlDirList
 
   @return
          NO_ERROR - if completed succesfully
@@ -76,178 +330,294 @@ typedef struct __all_traverse_state {
 
   @todo allow passing 'requested attributes'
 */
-int _all_CollectSubdirs(char *dir,char *file, hList *phlDirsList,
-                        int file_options,int ulSearchAttr, ULONG *ulDirCount,
-                        ULONG *ulFileCount, ULONG *ulRecurseDirCount)
+int _all_CollectSubdirs(char *dir,char *file, _all_dir_entries *entries,
+                        int file_options,int ulSearchAttr)
 {
-  HDIR hDir;
-#ifdef __386__
-  FILEFINDBUF3 ffbFindBuf;
-#else
-  FILEFINDBUF ffbFindBuf;
-#endif
-  APIRET rc;
-  CHAR *pchDirElemt;
-//  ULONG ulSearchAttr=FILE_SYSTEM|FILE_READONLY|FILE_HIDDEN|FILE_ARCHIVED;
-#ifdef __386__
-  ULONG ulEntries;
-#else
-  USHORT ulEntries;
-#endif
   CHAR fileMask[CCHMAXPATH]="";
+  ULONG ulAttr;
+  int keep = 0;
+  APIRET rc;
 
   /* mask for searching directories, and/or files, when all_RECURSE_DIRACTION,
      and/or all_RECURSE_FILEACTION are present */
   strcat(fileMask,dir);
   strcat(fileMask,file);
 
-  *ulDirCount=0; /* reset dir, recurse dir and file count */
-  *ulFileCount=0;
-  *ulRecurseDirCount=0;
+  if (file_options & all_RECURSE_DIRACTION)
+    keep |= FIND_KEEP_DIRS;
+  if (file_options & all_RECURSE_FILEACTION)
+    keep |= FIND_KEEP_FILES;
+  if ((file_options & all_RECURSE_DIRS) && _all_MaskMatchesAll(file))
+    keep |= FIND_KEEP_RECURSE;
+
+  if (keep)
+  {
+    ulAttr = ulSearchAttr & DONT_HAVE_DIRECTORY;
+    if (keep & (FIND_KEEP_DIRS|FIND_KEEP_RECURSE))
+      ulAttr |= (keep & FIND_KEEP_FILES) ? FILE_DIRECTORY : MUST_HAVE_DIRECTORY;
+
+    rc = _all_FindEntries(fileMask, ulAttr, keep, entries);
+    if (rc != NO_ERROR)
+      return rc;
+  }
+
+  /* directories for recursing, when the first search could not find them */
+  if ((file_options & all_RECURSE_DIRS) && !(keep & FIND_KEEP_RECURSE))
+  {
+    memset(fileMask,0,sizeof(fileMask));
+    strcat(fileMask,dir);
+    strcat(fileMask,"*");
 
- /* if we should match directories against filemask */
- if (file_options & all_RECURSE_DIRACTION)
- {
-  hDir=HDIR_CREATE;
-  ulEntries = 1L;
+    rc = _all_FindEntries(fileMask, MUST_HAVE_DIRECTORY|ulSearchAttr,
+                          FIND_KEEP_RECURSE, entries);
+    if (rc != NO_ERROR)
+      return rc;
+  }
 
-  rc = DosFindFirst(fileMask,                  /* all dirs */
-                    &hDir,                  /* handle */
-                    MUST_HAVE_DIRECTORY|ulSearchAttr, /* return only directories */
-                    &ffbFindBuf,            /* buffer */
-                    sizeof(ffbFindBuf),   /* size of buffer */
-                    &ulEntries,             /* number of entries (1) */
-                    FIL_STANDARD);          /* return only standard info (no EAs) */
+  return(NO_ERROR);
+};
 
+/*!
+  Does everything all_PerformRecursiveAction does in one directory: the
+  all_RECURSE_IN callback, the search, the error callback and the actions
+  on matching directories and files
 
+  @return 0, all_ERR_RECURSE_ACTIONBREAK or all_ERR_RECURSE_ERRORBREAK
+*/
+static int _all_VisitDir(_all_recurse_ctx *ctx, char *dir, ULONG ulLevel,
+                         _all_dir_entries *entries)
+{
+  ULONG ulCounter;
+  APIRET rc;
 
-    if ((rc != NO_ERROR) && (rc != ERROR_NO_MORE_FILES))
-    {
-     DosFindClose(hDir);
-     return(rc);
-    }
+  /* call call-back only, when user requested that */
+  if (ctx->actionOptions&all_RECURSE_IN)
+    if (ctx->action_callback(dir,ctx->mask,all_RECURSE_IN,
+                             ctx->action_callback_data)!=0)
+      return all_ERR_RECURSE_ACTIONBREAK;
 
+  // Collect subdirs and files
+  rc=_all_CollectSubdirs(dir,ctx->mask,entries,ctx->actionOptions,
+                         ctx->fileAttrs);
+
+  if ((rc) && (ctx->error_callback!=NULL))
+    if (ctx->error_callback(rc,ctx->error_callback_data)!=0)
+      return all_ERR_RECURSE_ERRORBREAK;
+
+  /* if user requested actions on dirs */
+  if (ctx->actionOptions&all_RECURSE_DIRACTION)
+  {
+    /* there may be no dirs, execute callback only if requested */
+    if (entries->num_dirs==0 && (ctx->actionOptions&all_RECURSE_NODIRS))
+      if (ctx->action_callback(dir,ctx->mask,all_RECURSE_NODIRS,
+                               ctx->action_callback_data)!=0)
+        return all_ERR_RECURSE_ACTIONBREAK;
 
-    if (rc != ERROR_NO_MORE_FILES) {
-        do {
-                // allocate memory for a new list element
-                pchDirElemt = malloc(strlen(ffbFindBuf.achName) + 1);
-                if (pchDirElemt == NULL)
-                   return ERROR_NOT_ENOUGH_MEMORY;
+    for (ulCounter=0;ulCounter<entries->num_dirs;ulCounter++)
+      if (ctx->action_callback(dir,entries->dirs[ulCounter],
+                               all_RECURSE_DIRACTION,
+                               ctx->action_callback_data)!=0)
+        return all_ERR_RECURSE_ACTIONBREAK;
+  }
+
+  /* if user requested actions on files */
+  if (ctx->actionOptions&all_RECURSE_FILEACTION)
+  {
+    /* there may be no files, execute callback only if requested */
+    if (entries->num_files==0 && (ctx->actionOptions&all_RECURSE_NOFILES))
+      if (ctx->action_callback(dir,ctx->mask,all_RECURSE_NOFILES,
+                               ctx->action_callback_data)!=0)
+        return all_ERR_RECURSE_ACTIONBREAK;
 
-                // save the name to the new list element
-                strcpy(pchDirElemt, ffbFindBuf.achName);
+    for (ulCounter=0;ulCounter<entries->num_files;ulCounter++)
+      if (ctx->action_callback(dir,entries->files[ulCounter],
+                               all_RECURSE_FILEACTION,
+                               ctx->action_callback_data)!=0)
+        return all_ERR_RECURSE_ACTIONBREAK;
+  }
 
-                // add the new element to the list
-                rc = list_add(phlDirsList, pchDirElemt);
+  /* below the first level, tell about directories without subdirectories */
+  if ((ctx->actionOptions&all_RECURSE_DIRS) && (ulLevel>1) &&
+      (entries->num_recurse==0) && (ctx->actionOptions&all_RECURSE_NOSUBDIRS))
+    if (ctx->action_callback(dir,ctx->mask,all_RECURSE_NOSUBDIRS,
+                             ctx->action_callback_data)!=0)
+      return all_ERR_RECURSE_ACTIONBREAK;
 
-                //increase directory count
-                *ulDirCount+=1;
-        } while (DosFindNext(hDir, &ffbFindBuf, sizeof(ffbFindBuf), &ulEntries) != ERROR_NO_MORE_FILES);
-    }
+  return 0;
+}
 
-    DosFindClose(hDir);
-  }; /* END:  if (file_options & all_RECURSE_DIRACTION)  */
+/*!
+  Builds the path of subdirectory name of dir into child
+*/
+static void _all_SubdirPath(char *child, char *dir, char *name)
+{
+  strcpy(child, dir);
+  strcat(child, name);
+  if (child[strlen(child) - 1] != '\\') strcat(child, "\\");
+}
 
-    if (file_options & all_RECURSE_FILEACTION)
-    {
-      ulEntries=1;
-      hDir = HDIR_CREATE;
-
-      rc = DosFindFirst(fileMask,                  /* all dirs */
-                        &hDir,                  /* handle */
-                        ulSearchAttr&DONT_HAVE_DIRECTORY,                  /* no dirs, maybe readonly and/or archived files */
-                            &ffbFindBuf,            /* buffer */
-                            sizeof(ffbFindBuf),   /* size of buffer */
-                            &ulEntries,             /* number of entries (1) */
-                            FIL_STANDARD);          /* return only standard info (no EAs) */
-
-    if ((rc != NO_ERROR) && (rc != ERROR_NO_MORE_FILES))
+#ifdef __386__
+/*!
+  Worker thread of all_RECURSE_PARALLEL: takes directories off the queue,
+  visits them and queues their subdirectories, until the queue has run
+  dry with nothing in progress or a callback asked to stop
+*/
+static void _all_RecurseWorker(void *arg)
+{
+  _all_recurse_ctx *ctx = arg;
+  _all_work_item   *item;
+  _all_work_item   *child;
+  _all_work_item   *children;
+  _all_dir_entries  entries;
+  ULONG             ulIdx;
+  ULONG             ulCount;
+  ULONG             ulPosts;
+  int               rc;
+
+  for (;;)
+  {
+    DosRequestMutexSem(ctx->hmtx, SEM_INDEFINITE_WAIT);
+    while (ctx->queue == NULL && ctx->pending != 0 && ctx->result == 0)
     {
-     DosFindClose(hDir);
-     return(rc);
+      DosResetEventSem(ctx->hevWork, &ulPosts);
+      DosReleaseMutexSem(ctx->hmtx);
+      DosWaitEventSem(ctx->hevWork, SEM_INDEFINITE_WAIT);
+      DosRequestMutexSem(ctx->hmtx, SEM_INDEFINITE_WAIT);
     }
 
-
-    if (rc != ERROR_NO_MORE_FILES) {
-        do {
-
-         // allocate memory for a new list element
-            pchDirElemt = malloc(strlen(ffbFindBuf.achName) + 1);
-            if (pchDirElemt == NULL)
-               return ERROR_NOT_ENOUGH_MEMORY;
-
-            // save the name to the new list element
-            strcpy(pchDirElemt, ffbFindBuf.achName);
-
-            // add the new element to the list
-            rc = list_add(phlDirsList, pchDirElemt);
-
-            //increase file count
-            *ulFileCount+=1;
-        } while (DosFindNext(hDir, &ffbFindBuf, sizeof(ffbFindBuf), &ulEntries) != ERROR_NO_MORE_FILES);
-    };
-          DosFindClose(hDir);
-
-    }; /* END: if (file_options & all_RECURSE_FILEACTION) */
-
-
- /* if we should match directories against filemask */
- if (file_options & all_RECURSE_DIRS)
- {
-  /* prepare new mask, for directory recursing */
-    memset(fileMask,0,sizeof(fileMask));
-   strcat(fileMask,dir);
-   strcat(fileMask,"*");
-
-
-  hDir=HDIR_CREATE;
-  ulEntries = 1L;
-  rc = DosFindFirst(fileMask,                  /* all dirs */
-                    &hDir,                  /* handle */
-                    MUST_HAVE_DIRECTORY|ulSearchAttr, /* return only directories */
-                    &ffbFindBuf,            /* buffer */
-                    sizeof(ffbFindBuf),   /* size of buffer */
-                    &ulEntries,             /* number of entries (1) */
-                    FIL_STANDARD);          /* return only standard info (no EAs) */
-
-
-
-    if ((rc != NO_ERROR) && (rc != ERROR_NO_MORE_FILES))
+    if (ctx->queue == NULL || ctx->result != 0)
     {
-     DosFindClose(hDir);
-     return(rc);
+      DosReleaseMutexSem(ctx->hmtx);
+      break;
     }
 
+    item = ctx->queue;
+    ctx->queue = item->next;
+    DosReleaseMutexSem(ctx->hmtx);
 
-    if (rc != ERROR_NO_MORE_FILES) {
-        do {
-            if ((strcmp(ffbFindBuf.achName, ".") != 0)&&
-                (strcmp(ffbFindBuf.achName, "..") != 0))
-            {
-                // allocate memory for a new list element
-                pchDirElemt = malloc(strlen(ffbFindBuf.achName) + 1);
-                if (pchDirElemt == NULL)
-                   return ERROR_NOT_ENOUGH_MEMORY;
-
-                // save the name to the new list element
-                strcpy(pchDirElemt, ffbFindBuf.achName);
-
-                // add the new element to the list
-                rc = list_add(phlDirsList, pchDirElemt);
+    memset(&entries, 0, sizeof(entries));
+    rc = _all_VisitDir(ctx, item->dir, item->level, &entries);
 
-                //increase directory count
-                *ulRecurseDirCount+=1;
-            }
-        } while (DosFindNext(hDir, &ffbFindBuf, sizeof(ffbFindBuf), &ulEntries) != ERROR_NO_MORE_FILES);
+    children = NULL;
+    ulCount = 0;
+    for (ulIdx = 0; rc == 0 && ulIdx < entries.num_recurse; ulIdx++)
+    {
+      child = malloc(sizeof(_all_work_item));
+      if (child == NULL)
+      {
+        if (ctx->error_callback!=NULL &&
+            ctx->error_callback(ERROR_NOT_ENOUGH_MEMORY,
+                                ctx->error_callback_data)!=0)
+          rc = all_ERR_RECURSE_ERRORBREAK;
+        break;
+      }
+      _all_SubdirPath(child->dir, item->dir, entries.recurse[ulIdx]);
+      child->level = item->level + 1;
+      child->next = children;
+      children = child;
+      ulCount++;
     }
+    _all_FreeEntries(&entries);
 
-    DosFindClose(hDir);
-  }; /* END:  if (file_options & all_RECURSE_DIRS)  */
+    DosRequestMutexSem(ctx->hmtx, SEM_INDEFINITE_WAIT);
+    while (children != NULL)
+    {
+      child = children;
+      children = child->next;
+      child->next = ctx->queue;
+      ctx->queue = child;
+    }
+    ctx->pending += ulCount;
+    ctx->pending--;
+    if (rc != 0 && ctx->result == 0)
+      ctx->result = rc;
+    if (ulCount != 0 || ctx->pending == 0 || rc != 0)
+      DosPostEventSem(ctx->hevWork);
+    DosReleaseMutexSem(ctx->hmtx);
+
+    free(item);
+  }
+
+  /* post outside the mutex, the caller closes it once woken up */
+  DosRequestMutexSem(ctx->hmtx, SEM_INDEFINITE_WAIT);
+  ulCount = --ctx->threads;
+  DosReleaseMutexSem(ctx->hmtx);
+  if (ulCount == 0)
+    DosPostEventSem(ctx->hevDone);
+}
 
-    return(NO_ERROR);
-};
+/*!
+  Visits the subtrees below dir (already visited, its subdirectories in
+  entries) on RECURSE_THREADS threads, the calling one included
 
+  @return 0, all_ERR_RECURSE_ACTIONBREAK or all_ERR_RECURSE_ERRORBREAK
+*/
+static int _all_RecurseParallel(_all_recurse_ctx *ctx, char *dir,
+                                _all_dir_entries *entries)
+{
+  _all_work_item *item;
+  ULONG           ulIdx;
+  ULONG           ulThread;
+
+  ctx->queue = NULL;
+  ctx->pending = 0;
+  ctx->result = 0;
+  ctx->threads = 1;
+
+  for (ulIdx = entries->num_recurse; ulIdx > 0; ulIdx--)
+  {
+    item = malloc(sizeof(_all_work_item));
+    if (item == NULL)
+      break;
+    _all_SubdirPath(item->dir, dir, entries->recurse[ulIdx - 1]);
+    item->level = 2;
+    item->next = ctx->queue;
+    ctx->queue = item;
+    ctx->pending++;
+  }
+
+  if (DosCreateMutexSem(NULL, &ctx->hmtx, 0, FALSE) != NO_ERROR)
+    ctx->hmtx = NULLHANDLE;
+  if (DosCreateEventSem(NULL, &ctx->hevWork, 0, FALSE) != NO_ERROR)
+    ctx->hevWork = NULLHANDLE;
+  if (DosCreateEventSem(NULL, &ctx->hevDone, 0, FALSE) != NO_ERROR)
+    ctx->hevDone = NULLHANDLE;
+
+  /* without semaphores the calling thread does all the work */
+  if (ctx->hmtx != NULLHANDLE && ctx->hevWork != NULLHANDLE &&
+      ctx->hevDone != NULLHANDLE)
+  {
+    DosRequestMutexSem(ctx->hmtx, SEM_INDEFINITE_WAIT);
+    for (ulThread = 1; ulThread < RECURSE_THREADS; ulThread++)
+      if (_beginthread(_all_RecurseWorker, NULL, RECURSE_STACK_SIZE,
+                       ctx) != -1)
+        ctx->threads++;
+    DosReleaseMutexSem(ctx->hmtx);
+  }
+
+  _all_RecurseWorker(ctx);
+
+  if (ctx->hevDone != NULLHANDLE)
+  {
+    DosWaitEventSem(ctx->hevDone, SEM_INDEFINITE_WAIT);
+    DosCloseEventSem(ctx->hevDone);
+  }
+  if (ctx->hevWork != NULLHANDLE)
+    DosCloseEventSem(ctx->hevWork);
+  if (ctx->hmtx != NULLHANDLE)
+    DosCloseMutexSem(ctx->hmtx);
+
+  /* directories left over after a break */
+  while (ctx->queue != NULL)
+  {
+    item = ctx->queue;
+    ctx->queue = item->next;
+    free(item);
+  }
+
+  return ctx->result;
+}
+#endif /* __386__ */
 
 
 /*!
@@ -305,6 +675,13 @@ int _all_CollectSubdirs(char *dir,char *file, hList *phlDirsList,
                         depth directory, function returns (after processing
                         files and/or directories) with return code
                         all_ERR_RECURSE_NORECURSION
+                       all_RECURSE_PARALLEL - subdirectories of the starting
+                        directory are processed on several threads at once
+                        (32-bit only, ignored otherwise); callbacks are then
+                        called from those threads, in no particular order
+                        between directories, so only pass this for actions
+                        that are safe to run concurrently (attrib, delete,
+                        size counting with a protected total)
 
   @param fileAttrs      file attributes (FILE_* combination), to match when
                         searhing for files and directories, note that
@@ -365,215 +742,139 @@ int all_PerformRecursiveAction(char *fileMask,int actionOptions,int fileAttrs,
             int (*action_callback)(char*,char*,int,void *),void *action_callback_data,
             int (*error_callback)(ULONG,void *),void *error_callback_data)
 {
-    hList          *phlDirsList;    /* dynamic list of directories      */
     hStack         *phsStack;       /* dynamic stack                    */
-    _all_traverse_state *ptsState;       /* state to save on the dyn stack   */
+    _all_traverse_state *ptsState;  /* state to save on the dyn stack   */
+    _all_dir_entries *pEntries;     /* names found in a directory       */
+    _all_recurse_ctx ctx;
     ULONG           ulLevel = 1L;   /* depth level */
-    ULONG ulDirs, ulRecurseDirs, ulFiles;
-    ULONG ulrc, ulIdx;
-    ULONG ulCounter;
     CHAR dir[CCHMAXPATH] = "";
-    char *mask;
-    APIRET rc;
-    ULONG ulEntries;
     char *tmp;
+    int rc;
 
     /* check are the parameters correct */
     if ((actionOptions==0)||(action_callback==NULL))
      return all_ERR_RECURSE_BADPARAMS;
 
-    // Get a new dynamic stack handle
-    phsStack = stack_init();    /* @todo - check return code */
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.actionOptions = actionOptions;
+    ctx.fileAttrs = fileAttrs;
+    ctx.action_callback = action_callback;
+    ctx.action_callback_data = action_callback_data;
+    ctx.error_callback = error_callback;
+    ctx.error_callback_data = error_callback_data;
 
-    mask=all_GetFileFromPath(fileMask);
+    ctx.mask=all_GetFileFromPath(fileMask);
     tmp=all_GetDirFromPath(fileMask);
 
     strcpy(dir,tmp);
 
     free(tmp);
 
-lbl_begin:
-    // Get a new dynamic list handle
-    phlDirsList = list_init();  /* @todo - check return code */
-
-    /* call call-back only, when user requested that */
-    if (actionOptions&all_RECURSE_IN)
+    pEntries = calloc(1, sizeof(_all_dir_entries));
+    if (pEntries == NULL)
     {
-     if (action_callback(dir,mask,all_RECURSE_IN,action_callback_data)!=0)
-     {
-      /* @todo cleanup.. and set correct return value*/
-      free(mask);
-      return all_ERR_RECURSE_ACTIONBREAK;
-     };
-    };
-
-    // Collect subdirs and store them in the list
-    rc=_all_CollectSubdirs(dir,mask, phlDirsList, actionOptions,fileAttrs,
-                          &ulDirs,&ulFiles,&ulRecurseDirs);
-
-    if ((rc) && (error_callback!=NULL))
-      {
-        if (error_callback(rc,error_callback_data)!=0)
-        {
-         //! @todo: stack and list cleanup
-         free(mask);
-         return all_ERR_RECURSE_ERRORBREAK;
-        };
-      };
-
-    list_set_start(phlDirsList);
-
-
-
-    /* if user requested actions on files */
-    if (actionOptions&all_RECURSE_DIRACTION)
-    {
-     if (ulDirs==0) /* but there may be no files */
-     {
-       /* execute action callback only if requested */
-       if (actionOptions&all_RECURSE_NODIRS)
-       {
-         /* execute action callback */
-         if (action_callback(dir,mask,all_RECURSE_NODIRS,
-                             action_callback_data)!=0)
-         {
-          /* @todo cleanup.. and set correct return value */
-          free(mask);
-          return all_ERR_RECURSE_ACTIONBREAK;
-         };
-       };
-
-     } else /* if (ulDirs==0) */
-     {
-       /* if we are here, user requested actions on dirs and there are dirs!*/
-
-       for (ulCounter=0;ulCounter<ulDirs;ulCounter++)
-       {
-         if (action_callback(dir,list_get(phlDirsList),
-                           all_RECURSE_DIRACTION,action_callback_data)!=0)
-         {
-          /* @todo cleanup.. and set correct return value */
-          free(mask);
-          return all_ERR_RECURSE_ACTIONBREAK;
-         };
-        list_next(phlDirsList);
-       };
-     };  /*END: if (ulDirs==0) */
-    }; /* END: if (actionOptions&all_RECURSE_FILEACTION) */
-
-
-    /* if user requested actions on files */
-    if (actionOptions&all_RECURSE_FILEACTION)
-    {
-     if (ulFiles==0) /* but there may be no files */
-     {
-       /* execute action callback only when requested*/
-       if (actionOptions&all_RECURSE_NOFILES)
-       {
-         if (action_callback(dir,mask,all_RECURSE_NOFILES,
-                             action_callback_data)!=0)
-         {
-          /* @todo cleanup.. and set correct return value */
-          free(mask);
-          return all_ERR_RECURSE_ACTIONBREAK;
-         };
-       };
-
-     } else /* if (ulFiles==0) */
-     {
-       /* if we are here, user requested actions on files and there are files!*/
+      free(ctx.mask);
+      return all_ERR_RECURSE_ERRORBREAK;
+    }
 
-       for (ulCounter=0;ulCounter<ulFiles;ulCounter++)
-       {
-         if (action_callback(dir,list_get(phlDirsList),
-                           all_RECURSE_FILEACTION,action_callback_data)!=0)
-         {
-          /* @todo cleanup.. and set correct return value */
-          free(mask);
-          return all_ERR_RECURSE_ACTIONBREAK;
-         };
-        list_next(phlDirsList);
-       };
-     }; /*END: if (ulFiles==0) */
-    }; /* END: if (actionOptions&all_RECURSE_FILEACTION) */
+    rc = _all_VisitDir(&ctx, dir, ulLevel, pEntries);
 
     /* if no real recurse was requested quit without error */
-    if (!(actionOptions&all_RECURSE_DIRS))
-    {
-      //! @todo list and stack cleanup
-      return NO_ERROR;
-    };
-
-    /* but if it was, and we're at level 1, we need to check are there any
-       directories, and if not, return immediatly */
-    if ((ulLevel==1) && (ulRecurseDirs==0))
-      return all_ERR_RECURSE_NORECURSION;
-
-    if ((list_isempty(phlDirsList)) || (ulRecurseDirs == 0)) {
-        // End condition #1: no subdirs
-
-   /* execute callback, only when  requested by user */
-    if (actionOptions&all_RECURSE_NOSUBDIRS)
+    if (rc == 0 && !(actionOptions&all_RECURSE_DIRS))
+      rc = NO_ERROR;
+    /* but if it was, and there are no directories, return immediatly */
+    else if (rc == 0 && pEntries->num_recurse == 0)
+      rc = all_ERR_RECURSE_NORECURSION;
+#ifdef __386__
+    else if (rc == 0 && (actionOptions&all_RECURSE_PARALLEL))
+      rc = _all_RecurseParallel(&ctx, dir, pEntries);
+#endif
+    else if (rc == 0)
     {
-       if (action_callback(dir,mask,all_RECURSE_NOSUBDIRS,
-                           action_callback_data)!=0)
-       {
-        /* @todo cleanup.. and set correct return value */
-        free(mask);
-        return all_ERR_RECURSE_ACTIONBREAK;
-       };
-    };
+      // Get a new dynamic stack handle, and walk the tree depth first
+      phsStack = stack_init();
+      ptsState = malloc(sizeof(_all_traverse_state));
+      if ((phsStack == NULL) || (ptsState == NULL))
+      {
+        free(ptsState);
+        free(phsStack);
+        _all_FreeEntries(pEntries);
+        free(pEntries);
+        free(ctx.mask);
+        return all_ERR_RECURSE_ERRORBREAK;
+      }
+
+      strcpy(ptsState->start, dir);
+      ptsState->entries = pEntries;
+      ptsState->idx_dirs = 0;
+      stack_push(phsStack, ptsState);
+      pEntries = NULL;
+
+      while ((rc == 0) && ((ptsState = stack_top(phsStack)) != NULL))
+      {
+        if (ptsState->idx_dirs < ptsState->entries->num_recurse)
+        {
+          /* we go one level deeper */
+          _all_SubdirPath(dir, ptsState->start,
+                          ptsState->entries->recurse[ptsState->idx_dirs++]);
+
+          pEntries = calloc(1, sizeof(_all_dir_entries));
+          if (pEntries == NULL)
+          {
+            rc = all_ERR_RECURSE_ERRORBREAK;
+            break;
+          }
 
-        goto lbl_recur_back;
-    } else {
-        // recur in each directory
-        for (ulIdx = 1; ulIdx <= ulRecurseDirs; ulIdx++) {
-            goto lbl_recur;
+          rc = _all_VisitDir(&ctx, dir, ulLevel + 1, pEntries);
 
-lbl_continue:
-            if (ulLevel < 1) return(0);
-            list_next(phlDirsList);
+          if ((rc == 0) && (pEntries->num_recurse != 0))
+          {
+            ptsState = malloc(sizeof(_all_traverse_state));
+            if (ptsState == NULL)
+            {
+              rc = all_ERR_RECURSE_ERRORBREAK;
+              break;
+            }
+            strcpy(ptsState->start, dir);
+            ptsState->entries = pEntries;
+            ptsState->idx_dirs = 0;
+            stack_push(phsStack, ptsState);
+            pEntries = NULL;
+            ulLevel++;
+          } else
+          {
+            _all_FreeEntries(pEntries);
+            free(pEntries);
+            pEntries = NULL;
+          }
+        } else
+        {
+          /* all subdirectories done, back up one level */
+          stack_pop(phsStack, (void **)&ptsState);
+          _all_FreeEntries(ptsState->entries);
+          free(ptsState->entries);
+          free(ptsState);
+          ulLevel--;
         }
+      }
 
-        // End condition #2: no more subdirs
-        goto lbl_recur_back;
+      /* after a break, drop what is left on the stack */
+      while (stack_top(phsStack) != NULL)
+      {
+        stack_pop(phsStack, (void **)&ptsState);
+        _all_FreeEntries(ptsState->entries);
+        free(ptsState->entries);
+        free(ptsState);
+      }
+      free(phsStack);
     }
 
-//    printf("returning from continue\n");
-
-    free(mask);
-    return(NO_ERROR); // what's this?
-
-lbl_recur:
-    // Maintain the dynamic stack
-    ptsState = malloc(sizeof(_all_traverse_state));
-    strcpy(ptsState->start, dir);
-    ptsState->dirs = phlDirsList;
-    ptsState->num_dirs = ulRecurseDirs;
-    ptsState->idx_dirs = ulIdx;
-    stack_push(phsStack, ptsState);
-
-    strcat(dir, list_get(phlDirsList));
-
-    if (dir[strlen(dir) - 1] != '\\') strcat(dir, "\\");
-
-    // we go one level deeper
-    ulLevel++;
-    goto lbl_begin;
-
-lbl_recur_back:
-    // Maintain the dynamic stack
-    ulLevel--;
-    stack_pop(phsStack, (void **)&ptsState);
-    if(ptsState != NULL) {
-        strcpy(dir, ptsState->start);
-        if (dir[strlen(dir) - 1] != '\\') strcat(dir, "\\");
-        list_free(phlDirsList);
-        phlDirsList = ptsState->dirs;
-        ulRecurseDirs = ptsState->num_dirs;
-        ulIdx = ptsState->idx_dirs;
-        free(ptsState);
+    if (pEntries != NULL)
+    {
+      _all_FreeEntries(pEntries);
+      free(pEntries);
     }
-    goto lbl_continue;
-};
+    free(ctx.mask);
 
+    return rc;
+};
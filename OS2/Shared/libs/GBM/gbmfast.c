@@ -0,0 +1,734 @@
+/*
+
+gbmfast.c - Fast conversion and scaling paths
+
+The per-pixel loops of the generic code are replaced here by loops
+which move whole 32 bit words (4 pixels of 24 bpp data are exactly 3
+words), fixed-point arithmetic and precomputed filter tables. Work
+which has no dependency between rows is split into row bands, one per
+thread.
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "gbm.h"
+#include "gbmscale.h"
+#include "gbmfast.h"
+
+#if defined(__OS2__)
+  #define INCL_DOSMISC
+  #define INCL_DOSPROCESS
+  #include <os2.h>
+  #include <process.h>
+  #define GBM_FAST_THREADS
+  #ifndef QSV_NUMPROCESSORS
+  #define QSV_NUMPROCESSORS 26
+  #endif
+#endif
+
+/* the word-at-a-time paths need a little endian CPU that does not mind
+   unaligned access; GBM rows start on 4 byte boundaries anyway */
+#if defined(__386__) || defined(__i386__) || defined(_M_IX86) || defined(__x86_64__) || defined(_M_X64)
+  #define GBM_FAST_WORDS
+#endif
+
+#define MAXBANDS      8
+#define MINBANDROWS   32              /* rows per band at least */
+
+#define STRIDE(w, bpp) ((((w) * (bpp) + 31) / 32) * 4)
+
+/* ----------------------------------------------------------------------
+   Row bands
+   ---------------------------------------------------------------------- */
+
+typedef void (*BANDFN)(void *arg, int y0, int y1);
+
+typedef struct
+{
+    BANDFN fn;
+    void  *arg;
+    int    y0, y1;
+    int    tid;
+} BAND;
+
+static int fast_threads = 0;
+
+void gbm_fast_set_threads(int n)
+{
+    fast_threads = (n < 0) ? 0 : n;
+}
+
+static int num_cpus(void)
+{
+#ifdef GBM_FAST_THREADS
+    static ULONG ulCpus = 0;
+
+    if (ulCpus == 0)
+    {
+        if (DosQuerySysInfo(QSV_NUMPROCESSORS, QSV_NUMPROCESSORS, &ulCpus, sizeof(ulCpus)) ||
+            ulCpus == 0)
+        {
+            ulCpus = 1;
+        }
+    }
+    return (int) ulCpus;
+#else
+    return 1;
+#endif
+}
+
+#ifdef GBM_FAST_THREADS
+static void band_thread(void *p)
+{
+    BAND *band = (BAND *) p;
+    band->fn(band->arg, band->y0, band->y1);
+}
+#endif
+
+/* Calls fn for rows [0,h) split into bands; the bands may run at the
+   same time, so fn must only write rows of its own band. */
+static void run_bands(BANDFN fn, void *arg, int h)
+{
+    BAND band[MAXBANDS];
+    int  n = (fast_threads > 0) ? fast_threads : num_cpus();
+    int  i;
+
+    if (n > MAXBANDS)         n = MAXBANDS;
+    if (n > h / MINBANDROWS)  n = h / MINBANDROWS;
+    if (n < 2)
+    {
+        fn(arg, 0, h);
+        return;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        band[i].fn  = fn;
+        band[i].arg = arg;
+        band[i].y0  = (int) ((long) h *  i      / n);
+        band[i].y1  = (int) ((long) h * (i + 1) / n);
+        band[i].tid = 0;
+    }
+
+#ifdef GBM_FAST_THREADS
+    for (i = 1; i < n; i++)
+    {
+        band[i].tid = _beginthread(band_thread, NULL, 65536, &band[i]);
+    }
+#endif
+
+    /* this thread does the first band, and any band whose thread
+       could not be started */
+    fn(arg, band[0].y0, band[0].y1);
+    for (i = 1; i < n; i++)
+    {
+        if (band[i].tid <= 0)
+        {
+            fn(arg, band[i].y0, band[i].y1);
+        }
+    }
+
+#ifdef GBM_FAST_THREADS
+    for (i = 1; i < n; i++)
+    {
+        if (band[i].tid > 0)
+        {
+            TID tid = (TID) band[i].tid;
+            DosWaitThread(&tid, DCWW_WAIT);
+        }
+    }
+#endif
+}
+
+/* ----------------------------------------------------------------------
+   Swizzles
+   ---------------------------------------------------------------------- */
+
+typedef struct
+{
+    const gbm_u8 *src;
+    gbm_u8       *dst;
+    int           w;
+    int           src_stride, dst_stride;
+} CONVERT;
+
+static void swap_rb_24_rows(void *p, int y0, int y1)
+{
+    CONVERT *c = (CONVERT *) p;
+    int y, x;
+
+    for (y = y0; y < y1; y++)
+    {
+        gbm_u8 *row = c->dst + (long) y * c->dst_stride;
+        x = 0;
+#ifdef GBM_FAST_WORDS
+        {
+            gbm_u32 *pw = (gbm_u32 *) row;
+
+            /* b0 g0 r0 b1 | g1 r1 b2 g2 | r2 b3 g3 r3 */
+            for (; x + 4 <= c->w; x += 4, pw += 3)
+            {
+                gbm_u32 w0 = pw[0], w1 = pw[1], w2 = pw[2];
+
+                pw[0] = ((w0 >> 16) & 0xff)        | (w0 & 0xff00) |
+                        ((w0 & 0xff) << 16)        | (((w1 >> 8) & 0xff) << 24);
+                pw[1] = (w1 & 0xff)                | ((w0 >> 24) << 8) |
+                        ((w2 & 0xff) << 16)        | (w1 & 0xff000000);
+                pw[2] = ((w1 >> 16) & 0xff)        | ((w2 >> 24) << 8) |
+                        (w2 & 0xff0000)            | (((w2 >> 8) & 0xff) << 24);
+            }
+        }
+#endif
+        for (row += x * 3; x < c->w; x++, row += 3)
+        {
+            gbm_u8 t = row[0];
+            row[0] = row[2];
+            row[2] = t;
+        }
+    }
+}
+
+static void swap_rb_32_rows(void *p, int y0, int y1)
+{
+    CONVERT *c = (CONVERT *) p;
+    int y, x;
+
+    for (y = y0; y < y1; y++)
+    {
+        gbm_u8 *row = c->dst + (long) y * c->dst_stride;
+#ifdef GBM_FAST_WORDS
+        gbm_u32 *pw = (gbm_u32 *) row;
+
+        for (x = 0; x < c->w; x++)
+        {
+            gbm_u32 v = pw[x];
+            pw[x] = (v & 0xff00ff00) | ((v >> 16) & 0xff) | ((v & 0xff) << 16);
+        }
+#else
+        for (x = 0; x < c->w; x++, row += 4)
+        {
+            gbm_u8 t = row[0];
+            row[0] = row[2];
+            row[2] = t;
+        }
+#endif
+    }
+}
+
+void gbm_fast_swap_rb(const GBM *gbm, gbm_u8 *data)
+{
+    CONVERT c;
+
+    c.src        = data;
+    c.dst        = data;
+    c.w          = gbm->w;
+    c.src_stride = c.dst_stride = STRIDE(gbm->w, gbm->bpp);
+
+    if (gbm->bpp == 24)
+    {
+        run_bands(swap_rb_24_rows, &c, gbm->h);
+    }
+    else if (gbm->bpp == 32)
+    {
+        run_bands(swap_rb_32_rows, &c, gbm->h);
+    }
+}
+
+static void expand_24_32_rows(void *p, int y0, int y1)
+{
+    CONVERT *c = (CONVERT *) p;
+    int y, x;
+
+    for (y = y0; y < y1; y++)
+    {
+        const gbm_u8 *s = c->src + (long) y * c->src_stride;
+        gbm_u8       *d = c->dst + (long) y * c->dst_stride;
+        x = 0;
+#ifdef GBM_FAST_WORDS
+        {
+            const gbm_u32 *ps = (const gbm_u32 *) s;
+            gbm_u32       *pd = (gbm_u32 *) d;
+
+            for (; x + 4 <= c->w; x += 4, ps += 3, pd += 4)
+            {
+                gbm_u32 w0 = ps[0], w1 = ps[1], w2 = ps[2];
+
+                pd[0] = (w0 & 0xffffff)                      | 0xff000000;
+                pd[1] = (w0 >> 24) | ((w1 & 0xffff) << 8)    | 0xff000000;
+                pd[2] = (w1 >> 16) | ((w2 & 0xff) << 16)     | 0xff000000;
+                pd[3] = (w2 >> 8)                            | 0xff000000;
+            }
+        }
+#endif
+        for (s += x * 3, d += x * 4; x < c->w; x++, s += 3, d += 4)
+        {
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
+            d[3] = 0xff;
+        }
+    }
+}
+
+static void pack_32_24_rows(void *p, int y0, int y1)
+{
+    CONVERT *c = (CONVERT *) p;
+    int y, x;
+
+    for (y = y0; y < y1; y++)
+    {
+        const gbm_u8 *s = c->src + (long) y * c->src_stride;
+        gbm_u8       *d = c->dst + (long) y * c->dst_stride;
+        x = 0;
+#ifdef GBM_FAST_WORDS
+        {
+            const gbm_u32 *ps = (const gbm_u32 *) s;
+            gbm_u32       *pd = (gbm_u32 *) d;
+
+            for (; x + 4 <= c->w; x += 4, ps += 4, pd += 3)
+            {
+                gbm_u32 p0 = ps[0], p1 = ps[1], p2 = ps[2], p3 = ps[3];
+
+                pd[0] = (p0 & 0xffffff)         | (p1 << 24);
+                pd[1] = ((p1 >> 8) & 0xffff)    | (p2 << 16);
+                pd[2] = ((p2 >> 16) & 0xff)     | (p3 << 8);
+            }
+        }
+#endif
+        for (s += x * 4, d += x * 3; x < c->w; x++, s += 4, d += 3)
+        {
+            d[0] = s[0];
+            d[1] = s[1];
+            d[2] = s[2];
+        }
+    }
+}
+
+void gbm_fast_24_to_32(const GBM *gbm, const gbm_u8 *data24, gbm_u8 *data32)
+{
+    CONVERT c;
+
+    c.src        = data24;
+    c.dst        = data32;
+    c.w          = gbm->w;
+    c.src_stride = STRIDE(gbm->w, 24);
+    c.dst_stride = STRIDE(gbm->w, 32);
+    run_bands(expand_24_32_rows, &c, gbm->h);
+}
+
+void gbm_fast_32_to_24(const GBM *gbm, const gbm_u8 *data32, gbm_u8 *data24)
+{
+    CONVERT c;
+
+    c.src        = data32;
+    c.dst        = data24;
+    c.w          = gbm->w;
+    c.src_stride = STRIDE(gbm->w, 32);
+    c.dst_stride = STRIDE(gbm->w, 24);
+    run_bands(pack_32_24_rows, &c, gbm->h);
+}
+
+/* ----------------------------------------------------------------------
+   Error diffusion
+   ---------------------------------------------------------------------- */
+
+void gbm_fast_errdiff_pal_rgb(GBMRGB *gbmrgb, int nr, int ng, int nb)
+{
+    int r, g, b;
+
+    for (r = 0; r < nr; r++)
+    {
+        for (g = 0; g < ng; g++)
+        {
+            for (b = 0; b < nb; b++, gbmrgb++)
+            {
+                gbmrgb->r = (gbm_u8) (r * 255 / (nr - 1));
+                gbmrgb->g = (gbm_u8) (g * 255 / (ng - 1));
+                gbmrgb->b = (gbm_u8) (b * 255 / (nb - 1));
+            }
+        }
+    }
+}
+
+/* Level index and level value for every channel value -256..511
+   (value plus carried error), so the inner loop has no division. */
+typedef struct
+{
+    gbm_u8 index[768];
+    gbm_u8 level[768];
+} QUANT;
+
+static void make_quant(QUANT *q, int n)
+{
+    int v;
+
+    for (v = -256; v < 512; v++)
+    {
+        int c = (v < 0) ? 0 : (v > 255) ? 255 : v;
+        int i = (c * (n - 1) + 127) / 255;
+
+        q->index[v + 256] = (gbm_u8) i;
+        q->level[v + 256] = (gbm_u8) (i * 255 / (n - 1));
+    }
+}
+
+gbm_boolean gbm_fast_errdiff_rgb(const GBM *gbm, const gbm_u8 *data24, gbm_u8 *data8,
+                                 int nr, int ng, int nb)
+{
+    QUANT *q;
+    short *errs;
+    int    src_stride = STRIDE(gbm->w, 24);
+    int    dst_stride = STRIDE(gbm->w, 8);
+    int    y;
+
+    if (nr < 2 || ng < 2 || nb < 2 || nr * ng * nb > 256)
+    {
+        return GBM_FALSE;
+    }
+
+    /* errors for the current and the next row, with a pixel of slack
+       at both ends so the kernel needs no edge tests */
+    q    = (QUANT *) malloc(3 * sizeof(QUANT));
+    errs = (short *) calloc(2 * 3 * (gbm->w + 2), sizeof(short));
+    if (q == NULL || errs == NULL)
+    {
+        free(q);
+        free(errs);
+        return GBM_FALSE;
+    }
+    make_quant(&q[0], nb);
+    make_quant(&q[1], ng);
+    make_quant(&q[2], nr);
+
+    for (y = 0; y < gbm->h; y++)
+    {
+        const gbm_u8 *s   = data24 + (long) y * src_stride;
+        gbm_u8       *d   = data8  + (long) y * dst_stride;
+        short        *cur = errs + ((y & 1) ? 3 * (gbm->w + 2) : 0) + 3;
+        short        *nxt = errs + ((y & 1) ? 0 : 3 * (gbm->w + 2)) + 3;
+        int           x, k;
+
+        memset(nxt - 3, 0, 3 * (gbm->w + 2) * sizeof(short));
+
+        for (x = 0; x < gbm->w; x++, s += 3, cur += 3, nxt += 3)
+        {
+            int idx[3];
+
+            for (k = 0; k < 3; k++)
+            {
+                /* error from the left pixel is already in cur[k] */
+                int v = s[k] + cur[k];
+                int e, e7, e3, e5;
+
+                if (v < -256) v = -256; else if (v > 511) v = 511;
+                idx[k] = q[k].index[v + 256];
+                e      = v - q[k].level[v + 256];
+
+                /* 7/16 right, 3/16 down left, 5/16 down and the rest,
+                   about 1/16, down right, so no error is lost */
+                e7 = (e * 7) / 16;
+                e3 = (e * 3) / 16;
+                e5 = (e * 5) / 16;
+                cur[k + 3] += (short) e7;
+                nxt[k - 3] += (short) e3;
+                nxt[k]     += (short) e5;
+                nxt[k + 3] += (short) (e - e7 - e3 - e5);
+            }
+            *d++ = (gbm_u8) ((idx[2] * ng + idx[1]) * nb + idx[0]);
+        }
+    }
+
+    free(q);
+    free(errs);
+    return GBM_TRUE;
+}
+
+/* ----------------------------------------------------------------------
+   Separable scaler
+   ---------------------------------------------------------------------- */
+
+#define WBITS   14                    /* weight fraction bits */
+#define WONE    (1 << WBITS)
+#define IBITS   6                     /* fraction bits kept between passes */
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Filter taps of one output pixel */
+typedef struct
+{
+    int first;                        /* first source pixel */
+    int n;                            /* taps */
+    int w;                            /* offset into the weight table */
+} CONTRIB;
+
+typedef struct
+{
+    CONTRIB *c;
+    int     *weights;
+} CONTRIBS;
+
+static double filter_support(GBM_SCALE_FILTER f)
+{
+    switch (f)
+    {
+        case GBM_SCALE_FILTER_NEARESTNEIGHBOR: return 0.5;
+        case GBM_SCALE_FILTER_BILINEAR:        return 1.0;
+        case GBM_SCALE_FILTER_LANCZOS:         return 3.0;
+        default:                               return 2.0;
+    }
+}
+
+static double filter_value(GBM_SCALE_FILTER f, double x)
+{
+    if (x < 0) x = -x;
+    switch (f)
+    {
+        case GBM_SCALE_FILTER_NEARESTNEIGHBOR:
+            return (x <= 0.5) ? 1.0 : 0.0;
+
+        case GBM_SCALE_FILTER_BILINEAR:
+            return (x < 1.0) ? 1.0 - x : 0.0;
+
+        case GBM_SCALE_FILTER_BSPLINE:
+            if (x < 1.0) return (4.0 + x * x * (3.0 * x - 6.0)) / 6.0;
+            if (x < 2.0) { x = 2.0 - x; return x * x * x / 6.0; }
+            return 0.0;
+
+        case GBM_SCALE_FILTER_MITCHELL:       /* B = C = 1/3 */
+        case GBM_SCALE_FILTER_CATMULLROM:     /* B = 0, C = 1/2 */
+        {
+            double B = (f == GBM_SCALE_FILTER_MITCHELL) ? 1.0 / 3.0 : 0.0;
+            double C = (f == GBM_SCALE_FILTER_MITCHELL) ? 1.0 / 3.0 : 0.5;
+
+            if (x < 1.0)
+                return ((12 - 9 * B - 6 * C) * x * x * x +
+                        (-18 + 12 * B + 6 * C) * x * x + (6 - 2 * B)) / 6.0;
+            if (x < 2.0)
+                return ((-B - 6 * C) * x * x * x + (6 * B + 30 * C) * x * x +
+                        (-12 * B - 48 * C) * x + (8 * B + 24 * C)) / 6.0;
+            return 0.0;
+        }
+
+        case GBM_SCALE_FILTER_LANCZOS:
+            if (x == 0.0) return 1.0;
+            if (x >= 3.0) return 0.0;
+            return (sin(M_PI * x) / (M_PI * x)) * (sin(M_PI * x / 3.0) / (M_PI * x / 3.0));
+
+        default:
+            return 0.0;
+    }
+}
+
+/* Builds the taps for scaling sn pixels to dn pixels. When shrinking,
+   the filter is widened so every source pixel counts. Weights of a tap
+   set add up to exactly WONE. */
+static gbm_boolean make_contribs(CONTRIBS *cs, int sn, int dn, GBM_SCALE_FILTER f)
+{
+    double scale   = (double) dn / sn;
+    double fscale  = (scale < 1.0) ? scale : 1.0;
+    double support = filter_support(f) / fscale;
+    int    maxn    = (int) ceil(support * 2) + 1;
+    int    i, j;
+
+    cs->c       = (CONTRIB *) malloc(dn * sizeof(CONTRIB));
+    cs->weights = (int *) malloc((long) dn * maxn * sizeof(int));
+    if (cs->c == NULL || cs->weights == NULL)
+    {
+        free(cs->c);
+        free(cs->weights);
+        return GBM_FALSE;
+    }
+
+    for (i = 0; i < dn; i++)
+    {
+        double center = (i + 0.5) / scale - 0.5;
+        int    left   = (int) floor(center - support + 1.0);
+        int    right  = (int) floor(center + support);
+        int   *w      = cs->weights + (long) i * maxn;
+        double total  = 0.0, acc = 0.0;
+        int    sum = 0, n, big = 0;
+
+        if (f == GBM_SCALE_FILTER_NEARESTNEIGHBOR)
+        {
+            left = right = (int) floor(center + 0.5);
+        }
+        if (left  < 0)      left  = 0;
+        if (right > sn - 1) right = sn - 1;
+        if (right < left)   right = left;
+        n = right - left + 1;
+        if (n > maxn) n = maxn;
+
+        for (j = 0; j < n; j++)
+        {
+            total += (f == GBM_SCALE_FILTER_NEARESTNEIGHBOR) ? 1.0 :
+                     filter_value(f, (left + j - center) * fscale);
+        }
+        if (total == 0.0) total = 1.0;
+
+        for (j = 0; j < n; j++)
+        {
+            double v = (f == GBM_SCALE_FILTER_NEARESTNEIGHBOR) ? 1.0 :
+                       filter_value(f, (left + j - center) * fscale);
+
+            /* round the running sum, so the rounding errors don't add up */
+            acc += v / total;
+            w[j] = (int) floor(acc * WONE + 0.5) - sum;
+            sum += w[j];
+            if (w[j] > w[big]) big = j;
+        }
+        w[big] += WONE - sum;
+
+        cs->c[i].first = left;
+        cs->c[i].n     = n;
+        cs->c[i].w     = i * maxn;
+    }
+    return GBM_TRUE;
+}
+
+static void free_contribs(CONTRIBS *cs)
+{
+    free(cs->c);
+    free(cs->weights);
+}
+
+typedef struct
+{
+    const gbm_u8 *s;
+    gbm_u8       *d;
+    int           sw, sh, dw, dh;
+    int           ch;                 /* bytes per pixel */
+    int           s_stride, d_stride;
+    int          *tmp;                /* dw * ch per source row */
+    CONTRIBS      hc, vc;
+} SCALE;
+
+/* horizontal pass: source rows y0..y1 into tmp, IBITS fraction bits */
+static void scale_h_rows(void *p, int y0, int y1)
+{
+    SCALE *sc = (SCALE *) p;
+    int    y, x, j, k;
+
+    for (y = y0; y < y1; y++)
+    {
+        const gbm_u8 *srow = sc->s + (long) y * sc->s_stride;
+        int          *t    = sc->tmp + (long) y * sc->dw * sc->ch;
+
+        for (x = 0; x < sc->dw; x++, t += sc->ch)
+        {
+            const CONTRIB *c = &sc->hc.c[x];
+            const int     *w = sc->hc.weights + c->w;
+            const gbm_u8  *s = srow + c->first * sc->ch;
+            int acc[4] = { 0, 0, 0, 0 };
+
+            for (j = 0; j < c->n; j++, s += sc->ch)
+            {
+                for (k = 0; k < sc->ch; k++)
+                {
+                    acc[k] += s[k] * w[j];
+                }
+            }
+            for (k = 0; k < sc->ch; k++)
+            {
+                t[k] = (acc[k] + (1 << (WBITS - IBITS - 1))) >> (WBITS - IBITS);
+            }
+        }
+    }
+}
+
+/* vertical pass: destination rows y0..y1 from tmp */
+static void scale_v_rows(void *p, int y0, int y1)
+{
+    SCALE *sc  = (SCALE *) p;
+    int    row = sc->dw * sc->ch;
+    int    y, i, j;
+
+    for (y = y0; y < y1; y++)
+    {
+        const CONTRIB *c = &sc->vc.c[y];
+        const int     *w = sc->vc.weights + c->w;
+        gbm_u8        *d = sc->d + (long) y * sc->d_stride;
+
+        for (i = 0; i < row; i++)
+        {
+            const int *t   = sc->tmp + (long) c->first * row + i;
+            long       acc = 0;
+            int        v;
+
+            for (j = 0; j < c->n; j++, t += row)
+            {
+                acc += (long) *t * w[j];
+            }
+            v = (int) ((acc + (1L << (WBITS + IBITS - 1))) >> (WBITS + IBITS));
+            d[i] = (gbm_u8) ((v < 0) ? 0 : (v > 255) ? 255 : v);
+        }
+    }
+}
+
+GBM_ERR gbm_fast_scale_bgra(
+    const gbm_u8 *s, int sw, int sh,
+          gbm_u8 *d, int dw, int dh,
+          int  bpp,
+    const GBM_SCALE_FILTER filter)
+{
+    SCALE sc;
+
+    switch (filter)
+    {
+        case GBM_SCALE_FILTER_NEARESTNEIGHBOR:
+        case GBM_SCALE_FILTER_BILINEAR:
+        case GBM_SCALE_FILTER_BSPLINE:
+        case GBM_SCALE_FILTER_MITCHELL:
+        case GBM_SCALE_FILTER_CATMULLROM:
+        case GBM_SCALE_FILTER_LANCZOS:
+            break;
+        default:
+            return GBM_ERR_NOT_SUPP;
+    }
+    if (bpp != 24 && bpp != 32)
+    {
+        return GBM_ERR_NOT_SUPP;
+    }
+    if (sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0)
+    {
+        return GBM_ERR_BAD_SIZE;
+    }
+
+    sc.s        = s;
+    sc.d        = d;
+    sc.sw       = sw;
+    sc.sh       = sh;
+    sc.dw       = dw;
+    sc.dh       = dh;
+    sc.ch       = bpp / 8;
+    sc.s_stride = STRIDE(sw, bpp);
+    sc.d_stride = STRIDE(dw, bpp);
+
+    if (! make_contribs(&sc.hc, sw, dw, filter))
+    {
+        return GBM_ERR_MEM;
+    }
+    if (! make_contribs(&sc.vc, sh, dh, filter))
+    {
+        free_contribs(&sc.hc);
+        return GBM_ERR_MEM;
+    }
+    sc.tmp = (int *) malloc((long) sh * dw * sc.ch * sizeof(int));
+    if (sc.tmp == NULL)
+    {
+        free_contribs(&sc.hc);
+        free_contribs(&sc.vc);
+        return GBM_ERR_MEM;
+    }
+
+    run_bands(scale_h_rows, &sc, sh);
+    run_bands(scale_v_rows, &sc, dh);
+
+    free(sc.tmp);
+    free_contribs(&sc.hc);
+    free_contribs(&sc.vc);
+    return GBM_ERR_OK;
+}
@@ -81,6 +81,7 @@ int	PDC_color_content(short, short *, short *, short *);
 bool	PDC_check_key(void);
 int	PDC_curs_set(int);
 void	PDC_flushinp(void);
+void	PDC_flush_lines(void);
 int	PDC_get_columns(void);
 int	PDC_get_cursor_mode(void);
 int	PDC_get_key(void);
@@ -137,6 +137,7 @@ WINDOW *Xinitscr(int argc, char *argv[])
 	SP->cbreak	= TRUE;
 	SP->save_key_modifiers = FALSE;
 	SP->return_key_modifiers = FALSE;
+	SP->hash_lines = FALSE;
 	SP->echo	= TRUE;
 	SP->visibility	= 1;
 	SP->resized	= FALSE;
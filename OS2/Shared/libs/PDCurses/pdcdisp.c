@@ -13,6 +13,8 @@
 
 #include "pdcos2.h"
 
+#include <stdlib.h>
+
 RCSID("$Id: pdcdisp.c,v 1.47 2007/07/03 00:11:45 wmcbrine Exp $")
 
 /* ACS definitions originally by jshumate@wrdis01.robins.af.mil -- these 
@@ -56,6 +58,67 @@ chtype acs_map[128] =
 
 #endif
 
+#ifndef EMXVIDEO
+
+/* Cells sent to VIO, kept to batch the runs of PDC_transform_line():
+   a run that starts within PDC_CELL_GAP cells of the end of the 
+   pending one (on the same or the next line) is merged into it, the 
+   cells in between being rewritten from the copy of what the screen 
+   already shows.  VioWrtCellStr() wraps at the end of a line, so one 
+   call can cover several lines. */
+
+#define PDC_CELL_GAP 8
+
+static struct {unsigned char text, attr;} *pdc_cells = NULL;
+static unsigned char *pdc_cellvalid = NULL;	/* cell was sent by us */
+static long pdc_ncells = 0;
+static long pdc_pendlo = -1, pdc_pendhi = -1;	/* pending span, or -1 */
+
+static void _flush_cells(void)
+{
+	if (pdc_pendlo >= 0)
+	{
+		VioWrtCellStr((PCH)(pdc_cells + pdc_pendlo),
+			(USHORT)((pdc_pendhi - pdc_pendlo + 1) *
+			sizeof(unsigned short)),
+			(USHORT)(pdc_pendlo / SP->cols),
+			(USHORT)(pdc_pendlo % SP->cols), 0);
+
+		pdc_pendlo = pdc_pendhi = -1;
+	}
+}
+
+/* TRUE if the cells between the pending span and 'start' can be 
+   rewritten as they are */
+
+static bool _gap_known(long start)
+{
+	long i;
+
+	if (pdc_pendlo < 0 || start <= pdc_pendhi ||
+	    start - pdc_pendhi - 1 > PDC_CELL_GAP)
+		return FALSE;
+
+	for (i = pdc_pendhi + 1; i < start; i++)
+		if (!pdc_cellvalid[i])
+			return FALSE;
+
+	return TRUE;
+}
+
+#endif
+
+/* send the runs PDC_transform_line() has batched up */
+
+void PDC_flush_lines(void)
+{
+	PDC_LOG(("PDC_flush_lines() - called\n"));
+
+#ifndef EMXVIDEO
+	_flush_cells();
+#endif
+}
+
 /* position hardware cursor at (y, x) */
 
 void PDC_gotoyx(int row, int col)
@@ -65,6 +128,7 @@ void PDC_gotoyx(int row, int col)
 #ifdef EMXVIDEO
 	v_gotoxy(col, row);
 #else
+	_flush_cells();
 	VioSetCurPos(row, col, 0);
 #endif
 }
@@ -74,33 +138,77 @@ void PDC_gotoyx(int row, int col)
 
 void PDC_transform_line(int lineno, int x, int len, const chtype *srcp)
 {
+#ifdef EMXVIDEO
 	/* this should be enough for the maximum width of a screen. */
 
 	struct {unsigned char text, attr;} temp_line[256];
+#else
+	long start, needed;
+#endif
 	int j;
 
 	PDC_LOG(("PDC_transform_line() - called: line %d\n", lineno));
 
+#ifndef EMXVIDEO
+	needed = (long)SP->lines * SP->cols;
+
+	if (needed != pdc_ncells)
+	{
+		pdc_pendlo = pdc_pendhi = -1;
+
+		free(pdc_cells);
+		free(pdc_cellvalid);
+
+		pdc_cells = malloc(needed * sizeof(*pdc_cells));
+		pdc_cellvalid = calloc(needed, 1);
+		pdc_ncells = needed;
+
+		if (!pdc_cells || !pdc_cellvalid)
+		{
+			free(pdc_cells);
+			free(pdc_cellvalid);
+			pdc_cells = NULL;
+			pdc_cellvalid = NULL;
+			pdc_ncells = 0;
+			return;
+		}
+	}
+
+	start = (long)lineno * SP->cols + x;
+
+	if (!_gap_known(start))
+	{
+		_flush_cells();
+		pdc_pendlo = start;
+	}
+
+	pdc_pendhi = start + len - 1;
+#endif
+
 	/* replace the attribute part of the chtype with the 
 	   actual color value for each chtype in the line */
 
 	for (j = 0; j < len; j++)
 	{
 		chtype ch = srcp[j];
-
-		temp_line[j].attr = pdc_atrtab[ch >> PDC_ATTR_SHIFT];
+		unsigned char attr = pdc_atrtab[ch >> PDC_ATTR_SHIFT];
 
 #ifdef CHTYPE_LONG
 		if (ch & A_ALTCHARSET && !(ch & 0xff80))
 			ch = acs_map[ch & 0x7f];
 #endif
+
+#ifdef EMXVIDEO
+		temp_line[j].attr = attr;
 		temp_line[j].text = ch & 0xff;
+#else
+		pdc_cells[start + j].attr = attr;
+		pdc_cells[start + j].text = ch & 0xff;
+		pdc_cellvalid[start + j] = 1;
+#endif
 	}
 
 #ifdef EMXVIDEO
 	v_putline((char *)temp_line, x, lineno, len);
-#else
-	VioWrtCellStr((PCH)temp_line, (USHORT)(len * sizeof(unsigned short)),
-		(USHORT)lineno, (USHORT)x, 0);
 #endif
 }
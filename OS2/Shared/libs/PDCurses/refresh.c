@@ -27,6 +27,8 @@ RCSID("$Id: refresh.c,v 1.54 2007/07/10 20:56:03 wmcbrine Exp $")
 	int redrawwin(WINDOW *win);
 	int wredrawln(WINDOW *win, int beg_line, int num_lines);
 
+	int PDC_hash_lines(bool flag);
+
   Description:
 	wrefresh() copies the named window to the physical terminal 
 	screen, taking into account what is already there in order to 
@@ -47,6 +49,13 @@ RCSID("$Id: refresh.c,v 1.54 2007/07/10 20:56:03 wmcbrine Exp $")
 	wnoutrefresh() for each window, it is then possible to call 
 	doupdate() only once.
 
+	PDC_hash_lines(TRUE) makes doupdate() keep a hash of each line 
+	of the physical screen, and skip a changed line whose new hash 
+	matches it without comparing the cells.  This helps programs 
+	that touch much more than they change, like those redrawing the 
+	whole screen with touchwin(); the (tiny) price is that a change 
+	whose line hashes the same as before is not shown.
+
 	In PDCurses, redrawwin() is equivalent to touchwin(), and 
 	wredrawln() is the same as touchline(). In some other curses 
 	implementations, there's a subtle distinction, but it has no 
@@ -62,11 +71,43 @@ RCSID("$Id: refresh.c,v 1.54 2007/07/10 20:56:03 wmcbrine Exp $")
 	doupdate				Y	Y	Y
 	redrawwin				Y	-      4.0
 	wredrawln				Y	-      4.0
+	PDC_hash_lines				-	-       -
 
 **man-end****************************************************************/
 
+#include <stdlib.h>
 #include <string.h>
 
+/* hashes of the lines of pdc_lastscr, for SP->hash_lines */
+
+static unsigned long *pdc_linehash = NULL;
+static int pdc_nlinehash = 0;
+static bool pdc_linehash_ok = FALSE;	/* hashes match pdc_lastscr */
+
+static unsigned long _line_hash(const chtype *line, int len)
+{
+	unsigned long hash = 2166136261UL;	/* FNV-1a */
+	int i;
+
+	for (i = 0; i < len; i++)
+		hash = (hash ^ (unsigned long)line[i]) * 16777619UL;
+
+	return hash;
+}
+
+int PDC_hash_lines(bool flag)
+{
+	PDC_LOG(("PDC_hash_lines() - called\n"));
+
+	if (!SP)
+		return ERR;
+
+	SP->hash_lines = flag;
+	pdc_linehash_ok = FALSE;
+
+	return OK;
+}
+
 int wnoutrefresh(WINDOW *win)
 {
 	int begy, begx;		/* window's place on screen   */
@@ -138,13 +179,27 @@ int wnoutrefresh(WINDOW *win)
 int doupdate(void)
 {
 	int y;
-	bool clearall;
+	bool clearall, hashing;
+	unsigned long hash = 0;
 
 	PDC_LOG(("doupdate() - called\n"));
 
 	if (!curscr)
 		return ERR;
 
+	hashing = SP->hash_lines;
+
+	if (hashing && pdc_nlinehash != SP->lines)
+	{
+		free(pdc_linehash);
+		pdc_linehash = malloc(SP->lines * sizeof(unsigned long));
+		pdc_nlinehash = pdc_linehash ? SP->lines : 0;
+		pdc_linehash_ok = FALSE;
+
+		if (!pdc_linehash)
+			hashing = FALSE;
+	}
+
 	if (isendwin())			/* coming back after endwin() called */
 	{
 		reset_prog_mode();
@@ -154,6 +209,11 @@ int doupdate(void)
 	else
 		clearall = curscr->_clear;
 
+	/* a full redraw sets all the hashes */
+
+	if (clearall)
+		pdc_linehash_ok = hashing;
+
 	for (y = 0; y < SP->lines; y++)
 	{
 		PDC_LOG(("doupdate() - Transforming line %d of %d: %s\n",
@@ -167,6 +227,19 @@ int doupdate(void)
 			chtype *src = curscr->_y[y];
 			chtype *dest = pdc_lastscr->_y[y];
 
+			if (hashing)
+			{
+				hash = _line_hash(src, COLS);
+
+				if (!clearall && pdc_linehash_ok &&
+				    hash == pdc_linehash[y])
+				{
+					curscr->_firstch[y] = _NO_CHANGE;
+					curscr->_lastch[y] = _NO_CHANGE;
+					continue;
+				}
+			}
+
 			if (clearall)
 			{
 				first = 0;
@@ -222,9 +295,14 @@ int doupdate(void)
 
 			curscr->_firstch[y] = _NO_CHANGE;
 			curscr->_lastch[y] = _NO_CHANGE;
+
+			if (hashing)
+				pdc_linehash[y] = hash;
 		}
 	}
 
+	PDC_flush_lines();
+
 	curscr->_clear = FALSE;
 
 	if (SP->visibility)
@@ -871,6 +871,9 @@ void mad_synth_mute(struct mad_synth *);
 
 void mad_synth_frame(struct mad_synth *, struct mad_frame const *);
 
+void mad_pcm_s16(unsigned char *, struct mad_pcm const *,
+		 unsigned int, unsigned int);
+
 # endif
 
 /* Id: decoder.h,v 1.16 2003/05/27 22:40:36 rob Exp */
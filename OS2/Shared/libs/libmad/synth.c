@@ -550,6 +550,55 @@ mad_fixed_t const D[17][32] = {
 # include "D.dat"
 };
 
+# if defined(ASO_SSE2)
+#  if !defined(FPM_INTEL) || !defined(_MSC_VER)
+#   error "ASO_SSE2 matches the truncating FPM_INTEL multiply only"
+#  endif
+
+int  __cdecl mad_sse2_present(void);
+void __cdecl mad_synth_window_sse2(mad_fixed_t (*)[8], mad_fixed_t (*)[8],
+				   mad_fixed_t (*)[8], mad_fixed_t (*)[2][8],
+				   mad_fixed_t (*)[2][8], mad_fixed_t *);
+void __cdecl mad_pcm_s16_sse2(unsigned char *, mad_fixed_t const *,
+			      mad_fixed_t const *, unsigned int);
+
+/*
+ * W[p][sb] holds the coefficients of D[sb] that the window sums starting
+ * at p take, in the order of the filter values they go with: [0] those of
+ * ptr = D[sb] + p, [1] those of ptr = D[sb] - p. This turns each sum into
+ * two runs of 4 for the SSE2 code.
+ */
+
+static mad_fixed_t W[16][17][2][8];
+static int volatile sse2 = -1;
+
+/*
+ * NAME:	use_sse2()
+ * DESCRIPTION:	check once for SSE2 and set up the window table for it
+ */
+static
+int use_sse2(void)
+{
+  unsigned int p, sb, k;
+
+  if (sse2 < 0) {
+    for (p = 0; p < 16; ++p) {
+      for (sb = 0; sb < 17; ++sb) {
+	W[p][sb][0][0] = D[sb][p];
+	for (k = 1; k < 8; ++k)
+	  W[p][sb][0][k] = D[sb][p + 16 - 2 * k];
+	for (k = 0; k < 8; ++k)
+	  W[p][sb][1][k] = D[sb][15 - p + 2 * k];
+      }
+    }
+
+    sse2 = mad_sse2_present();
+  }
+
+  return sse2;
+}
+# endif
+
 # if defined(ASO_SYNTH)
 void synth_full(struct mad_synth *, struct mad_frame const *,
 		unsigned int, unsigned int);
@@ -569,6 +618,9 @@ void synth_full(struct mad_synth *synth, struct mad_frame const *frame,
   register mad_fixed_t const (*Dptr)[32], *ptr;
   register mad_fixed64hi_t hi;
   register mad_fixed64lo_t lo;
+# if defined(ASO_SSE2)
+  int simd = use_sse2();
+# endif
 
   for (ch = 0; ch < nch; ++ch) {
     sbsample = &frame->sbsample[ch];
@@ -589,6 +641,16 @@ void synth_full(struct mad_synth *synth, struct mad_frame const *frame,
       fx = &(*filter)[0][~phase & 1][0];
       fo = &(*filter)[1][~phase & 1][0];
 
+# if defined(ASO_SSE2)
+      if (simd) {
+	mad_synth_window_sse2(fe, fx, fo, W[pe], W[po], pcm1);
+	pcm1 += 32;
+
+	phase = (phase + 1) % 16;
+	continue;
+      }
+# endif
+
       Dptr = &D[0];
 
       ptr = *Dptr + po;
@@ -859,3 +921,61 @@ void mad_synth_frame(struct mad_synth *synth, struct mad_frame const *frame)
 
   synth->phase = (synth->phase + ns) % 16;
 }
+
+/*
+ * NAME:	s16()
+ * DESCRIPTION:	round, clip and quantize a sample to 16 bits
+ */
+static
+signed int s16(mad_fixed_t sample)
+{
+  sample += (1L << (MAD_F_FRACBITS - 16));
+
+  if (sample >= MAD_F_ONE)
+    sample = MAD_F_ONE - 1;
+  else if (sample < -MAD_F_ONE)
+    sample = -MAD_F_ONE;
+
+  return sample >> (MAD_F_FRACBITS + 1 - 16);
+}
+
+/*
+ * NAME:	pcm->s16()
+ * DESCRIPTION:	store count samples from first on as 16-bit signed little
+ *		endian PCM, channels interleaved
+ */
+void mad_pcm_s16(unsigned char *out, struct mad_pcm const *pcm,
+		 unsigned int first, unsigned int count)
+{
+  mad_fixed_t const *left, *right;
+  signed int sample;
+
+  left  = &pcm->samples[0][first];
+  right = pcm->channels == 2 ? &pcm->samples[1][first] : 0;
+
+# if defined(ASO_SSE2)
+  if (use_sse2() && count >= 8) {
+    unsigned int n = count & ~7;
+
+    mad_pcm_s16_sse2(out, left, right, n);
+
+    out   += n * (right ? 4 : 2);
+    left  += n;
+    if (right)
+      right += n;
+    count -= n;
+  }
+# endif
+
+  while (count--) {
+    sample = s16(*left++);
+    *out++ = (sample >> 0) & 0xff;
+    *out++ = (sample >> 8) & 0xff;
+
+    if (right) {
+      sample = s16(*right++);
+      *out++ = (sample >> 0) & 0xff;
+      *out++ = (sample >> 8) & 0xff;
+    }
+  }
+}
@@ -66,4 +66,7 @@ void mad_synth_mute(struct mad_synth *);
 
 void mad_synth_frame(struct mad_synth *, struct mad_frame const *);
 
+void mad_pcm_s16(unsigned char *, struct mad_pcm const *,
+		 unsigned int, unsigned int);
+
 # endif
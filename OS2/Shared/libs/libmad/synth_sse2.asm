@@ -0,0 +1,260 @@
+;
+; libmad - MPEG audio decoder library
+; SSE2 subband synthesis window and 16-bit PCM output for x86
+;
+; This program is free software; you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation; either version 2 of the License, or
+; (at your option) any later version.
+;
+; The results are bit for bit those of the C code built with FPM_INTEL:
+; every product is the 64-bit product shifted right by 28 and truncated
+; to 32 bits, and the sums wrap the way 32-bit adds do. SSE2 only has an
+; unsigned 32x32->64 multiply (pmuludq), so the signed product is made
+; from the unsigned one: for 32-bit x and y
+;
+;   (x * y) = (unsigned) x * (unsigned) y - 2^32 * ((x < 0 ? y : 0) + (y < 0 ? x : 0))
+;
+; and bits 28..59 of that are bits 28..59 of the unsigned product less
+; 16 times the correction. The corrections of all the products in a sum
+; are collected apart and taken off once at the end.
+;
+; All routines use the __cdecl convention.
+;
+
+        name    synth_sse2
+
+.686p
+IFDEF __JWASM__
+.xmm
+ELSE
+.xmm2
+ENDIF
+
+_TEXT   segment use32 dword public 'CODE'
+
+        assume  cs:_TEXT
+
+        public  _mad_sse2_present
+        public  _mad_synth_window_sse2
+        public  _mad_pcm_s16_sse2
+
+;
+; Add (op = paddq, opd = paddd) or take off (psubq, psubd) the products
+; of four fixed-point values at f with four at c. xmm6 gathers the
+; shifted unsigned products in the low dword of each qword, xmm7 the
+; sign corrections. Uses xmm0, xmm2, xmm4 and xmm5.
+;
+MAC4    macro   f, c, opq, opd
+        movdqu  xmm0, f
+        movdqu  xmm2, c
+        movdqa  xmm4, xmm0
+        psrad   xmm4, 31
+        pand    xmm4, xmm2
+        movdqa  xmm5, xmm2
+        psrad   xmm5, 31
+        pand    xmm5, xmm0
+        opd     xmm7, xmm4
+        opd     xmm7, xmm5
+        movdqa  xmm4, xmm0
+        pmuludq xmm4, xmm2
+        psrlq   xmm4, 28
+        opq     xmm6, xmm4
+        psrlq   xmm0, 32
+        psrlq   xmm2, 32
+        pmuludq xmm0, xmm2
+        psrlq   xmm0, 28
+        opq     xmm6, xmm0
+        endm
+
+;
+; Fold xmm6 and xmm7 into one sample, store it and clear both for the
+; next one
+;
+PUTSAMP macro   dst
+        pshufd  xmm4, xmm6, 0EEh
+        paddd   xmm6, xmm4
+        pshufd  xmm5, xmm7, 0EEh
+        paddd   xmm7, xmm5
+        pshufd  xmm5, xmm7, 055h
+        paddd   xmm7, xmm5
+        pslld   xmm7, 4
+        psubd   xmm6, xmm7
+        movd    dst, xmm6
+        pxor    xmm6, xmm6
+        pxor    xmm7, xmm7
+        endm
+
+;
+; int mad_sse2_present(void);
+;
+; Nonzero if the CPU has CPUID and reports FXSR and SSE2
+;
+_mad_sse2_present proc near
+        push    ebx
+        pushfd
+        pop     eax
+        mov     ecx, eax
+        xor     eax, 200000h            ; can the ID flag be changed?
+        push    eax
+        popfd
+        pushfd
+        pop     eax
+        push    ecx
+        popfd
+        xor     eax, ecx
+        and     eax, 200000h
+        jz      no_sse2
+        mov     eax, 1
+        cpuid
+        and     edx, 05000000h          ; SSE2 and FXSR
+        xor     eax, eax
+        cmp     edx, 05000000h
+        jne     no_sse2
+        inc     eax
+no_sse2:
+        pop     ebx
+        ret
+_mad_sse2_present endp
+
+;
+; void mad_synth_window_sse2(mad_fixed_t const (*fe)[8],
+;                            mad_fixed_t const (*fx)[8],
+;                            mad_fixed_t const (*fo)[8],
+;                            mad_fixed_t const (*wpe)[2][8],
+;                            mad_fixed_t const (*wpo)[2][8],
+;                            mad_fixed_t *pcm);
+;
+; The 32 samples of one synthesis slot. wpe and wpo point into the
+; window table made by synth.c: for each subband row the 8 coefficients
+; met going up ([0]) and going down ([1]) the D[] row from pe and po.
+;
+_mad_synth_window_sse2 proc near
+        push    ebp
+        push    ebx
+        push    esi
+        push    edi
+        mov     esi, [esp+20]           ; fe
+        mov     eax, [esp+24]           ; fx
+        mov     edx, [esp+28]           ; fo
+        mov     ebx, [esp+32]           ; wpe
+        mov     ebp, [esp+36]           ; wpo
+        mov     edi, [esp+40]           ; pcm
+        pxor    xmm6, xmm6
+        pxor    xmm7, xmm7
+
+        MAC4    [esi], [ebx], paddq, paddd
+        MAC4    [esi+16], [ebx+16], paddq, paddd
+        MAC4    [eax], [ebp], psubq, psubd
+        MAC4    [eax+16], [ebp+16], psubq, psubd
+        PUTSAMP [edi]
+
+        mov     ecx, 1
+sb_loop:
+        add     esi, 32
+        add     ebx, 64
+        add     ebp, 64
+
+        MAC4    [esi], [ebx], paddq, paddd
+        MAC4    [esi+16], [ebx+16], paddq, paddd
+        MAC4    [edx], [ebp], psubq, psubd
+        MAC4    [edx+16], [ebp+16], psubq, psubd
+        PUTSAMP [edi+ecx*4]
+
+        MAC4    [esi], [ebx+32], paddq, paddd
+        MAC4    [esi+16], [ebx+48], paddq, paddd
+        MAC4    [edx], [ebp+32], paddq, paddd
+        MAC4    [edx+16], [ebp+48], paddq, paddd
+        mov     eax, 32
+        sub     eax, ecx
+        PUTSAMP [edi+eax*4]
+
+        add     edx, 32
+        inc     ecx
+        cmp     ecx, 16
+        jb      sb_loop
+
+        add     ebp, 64
+        MAC4    [edx], [ebp], psubq, psubd
+        MAC4    [edx+16], [ebp+16], psubq, psubd
+        PUTSAMP [edi+64]
+
+        pop     edi
+        pop     esi
+        pop     ebx
+        pop     ebp
+        ret
+_mad_synth_window_sse2 endp
+
+;
+; void mad_pcm_s16_sse2(unsigned char *out, mad_fixed_t const *left,
+;                       mad_fixed_t const *right, unsigned int n);
+;
+; Round, clip and store n (a multiple of 8) samples as 16-bit little
+; endian PCM, interleaved if right is not NULL. Clipping to the 16-bit
+; range after the shift gives what clipping to +-MAD_F_ONE before it does.
+;
+_mad_pcm_s16_sse2 proc near
+        push    ebx
+        push    esi
+        push    edi
+        mov     edi, [esp+16]           ; out
+        mov     esi, [esp+20]           ; left
+        mov     ebx, [esp+24]           ; right
+        mov     ecx, [esp+28]           ; n
+        mov     eax, 1000h              ; 1 << (MAD_F_FRACBITS - 16)
+        movd    xmm7, eax
+        pshufd  xmm7, xmm7, 0
+        shr     ecx, 3
+        jz      s16_done
+        test    ebx, ebx
+        jz      s16_mono
+s16_stereo:
+        movdqu  xmm0, [esi]
+        movdqu  xmm1, [esi+16]
+        movdqu  xmm2, [ebx]
+        movdqu  xmm3, [ebx+16]
+        paddd   xmm0, xmm7
+        paddd   xmm1, xmm7
+        paddd   xmm2, xmm7
+        paddd   xmm3, xmm7
+        psrad   xmm0, 13
+        psrad   xmm1, 13
+        psrad   xmm2, 13
+        psrad   xmm3, 13
+        packssdw xmm0, xmm1
+        packssdw xmm2, xmm3
+        movdqa  xmm1, xmm0
+        punpcklwd xmm0, xmm2
+        punpckhwd xmm1, xmm2
+        movdqu  [edi], xmm0
+        movdqu  [edi+16], xmm1
+        add     esi, 32
+        add     ebx, 32
+        add     edi, 32
+        dec     ecx
+        jnz     s16_stereo
+        jmp     s16_done
+s16_mono:
+        movdqu  xmm0, [esi]
+        movdqu  xmm1, [esi+16]
+        paddd   xmm0, xmm7
+        paddd   xmm1, xmm7
+        psrad   xmm0, 13
+        psrad   xmm1, 13
+        packssdw xmm0, xmm1
+        movdqu  [edi], xmm0
+        add     esi, 32
+        add     edi, 16
+        dec     ecx
+        jnz     s16_mono
+s16_done:
+        pop     edi
+        pop     esi
+        pop     ebx
+        ret
+_mad_pcm_s16_sse2 endp
+
+_TEXT   ends
+
+        end
@@ -106,6 +106,15 @@ extern "C" {
         unsigned short  usHighestUni;
         unsigned short  *ausEntriesCPFromUni;   // usHighestUni + 1 entries
 
+        // abLeadBytes[c] is 1 if c starts a double-byte
+        // character; set up from the table by encCreateCodec
+        unsigned char   abLeadBytes[256];
+
+        // 1 if characters 0-0x7F map to themselves in
+        // both directions, which enables the ASCII fast
+        // paths in the bulk conversion functions
+        int             fASCII;
+
     } CONVERSION, *PCONVERSION;
 
     typedef enum _ENCBYTECOUNT
@@ -137,6 +146,15 @@ extern "C" {
 
     unsigned long encDecodeUTF8(const char **ppch);
 
+    unsigned long encCodepage2UTF8(PCONVERSION pTable,
+                                   const char *pcszCP,
+                                   unsigned long cbCP,
+                                   char *pszUTF8);
+
+    unsigned long encUTF82Codepage(PCONVERSION pTable,
+                                   const char *pcszUTF8,
+                                   char *pszCP);
+
     int encInitCase(void);
 
     unsigned long encToUpper(unsigned long ulUni);
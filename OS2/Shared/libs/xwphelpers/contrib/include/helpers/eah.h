@@ -99,8 +99,8 @@ extern "C" {
 
     /*
      *@@ EALIST:
-     *      list structure returned by eaPathReadAll and
-     *      eaHFileReadAll.
+     *      list structure returned by eaPathReadAll,
+     *      eaHFileReadAll, eaPathReadMany and eaHFileReadMany.
      */
 
     typedef struct _EALIST
@@ -135,6 +135,12 @@ extern "C" {
 
     PEABINDING eaPathReadOneByName(const char *pcszPath, const char *pcszEAName);
 
+    PEALIST eaHFileReadMany(HFILE hfile, const char **papcszEANames, ULONG cNames);
+
+    PEALIST eaPathReadMany(const char *pcszPath, const char **papcszEANames, ULONG cNames);
+
+    PEABINDING eaFindInList(PEALIST list, const char *pcszEAName);
+
     /* ******************************************************************
      *
      *   Write-EA functions
@@ -1248,6 +1248,14 @@ extern "C" {
         BOOL                    fOS2NEMapsLoaded;   // TRUE after good exehLoadOS2NEMaps
         POS2NERESTBLENTRY       paOS2NEResTblEntry;
         POS2NESEGMENT           paOS2NESegments;
+
+        // the following fields are set on demand by the table
+        // functions (NE and LX only); use exehClose to free
+        PBYTE                   pbTables;       // loader (and LX fixup) section,
+                                                // from the new header on
+        ULONG                   cbTables;
+        PBYTE                   pbNonResdNames; // non-resident name table
+        ULONG                   cbNonResdNames;
     } EXECUTABLE, *PEXECUTABLE;
 
     APIRET exehOpen(const char* pcszExecutable,
@@ -1344,6 +1352,8 @@ extern "C" {
 
     APIRET exehFreeResources(PFSYSRESOURCE paResources);
 
+    VOID exehFlushCache(VOID);
+
     APIRET exehLoadLXMaps(PEXECUTABLE pExec);
 
     VOID exehFreeLXMaps(PEXECUTABLE pExec);
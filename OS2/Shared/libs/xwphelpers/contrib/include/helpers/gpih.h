@@ -180,6 +180,66 @@ extern "C" {
                                           LONG lColorRight);
     typedef GPIHDRAW3DFRAME *PGPIHDRAW3DFRAME;
 
+    /*
+     *@@ GPIHBATCHITEM:
+     *      one primitive recorded in a GPIHBATCH.
+     */
+
+    typedef struct _GPIHBATCHITEM
+    {
+        LONG        lColor;         // RGB color to draw with
+        LONG        lControl;       // DRO_* for boxes, 0 for lines
+        ULONG       ulSeq;          // recording order, keeps the sort stable
+        POINTL      ptl1,           // box bottom left or line start
+                    ptl2;           // box top right (inclusive) or line end
+    } GPIHBATCHITEM, *PGPIHBATCHITEM;
+
+    /*
+     *@@ GPIHBATCH:
+     *      a buffer of drawing primitives for gpihBatchFlush.
+     *      Initialize with gpihBatchInit, free with
+     *      gpihBatchClear.
+     */
+
+    typedef struct _GPIHBATCH
+    {
+        ULONG           cItems,
+                        cAllocated;
+        PGPIHBATCHITEM  paItems;
+    } GPIHBATCH, *PGPIHBATCH;
+
+    VOID XWPENTRY gpihBatchInit(PGPIHBATCH pBatch);
+    typedef VOID XWPENTRY GPIHBATCHINIT(PGPIHBATCH pBatch);
+    typedef GPIHBATCHINIT *PGPIHBATCHINIT;
+
+    VOID XWPENTRY gpihBatchClear(PGPIHBATCH pBatch);
+    typedef VOID XWPENTRY GPIHBATCHCLEAR(PGPIHBATCH pBatch);
+    typedef GPIHBATCHCLEAR *PGPIHBATCHCLEAR;
+
+    BOOL XWPENTRY gpihBatchBox(PGPIHBATCH pBatch, LONG lColor, LONG lControl, PRECTL prcl);
+    typedef BOOL XWPENTRY GPIHBATCHBOX(PGPIHBATCH pBatch, LONG lColor, LONG lControl, PRECTL prcl);
+    typedef GPIHBATCHBOX *PGPIHBATCHBOX;
+
+    BOOL XWPENTRY gpihBatchLine(PGPIHBATCH pBatch, LONG lColor, LONG x1, LONG y1, LONG x2, LONG y2);
+    typedef BOOL XWPENTRY GPIHBATCHLINE(PGPIHBATCH pBatch, LONG lColor, LONG x1, LONG y1, LONG x2, LONG y2);
+    typedef GPIHBATCHLINE *PGPIHBATCHLINE;
+
+    BOOL XWPENTRY gpihBatch3DFrame(PGPIHBATCH pBatch,
+                                   PRECTL prcl,
+                                   USHORT usWidth,
+                                   LONG lColorLeft,
+                                   LONG lColorRight);
+    typedef BOOL XWPENTRY GPIHBATCH3DFRAME(PGPIHBATCH pBatch,
+                                           PRECTL prcl,
+                                           USHORT usWidth,
+                                           LONG lColorLeft,
+                                           LONG lColorRight);
+    typedef GPIHBATCH3DFRAME *PGPIHBATCH3DFRAME;
+
+    VOID XWPENTRY gpihBatchFlush(HPS hps, PGPIHBATCH pBatch);
+    typedef VOID XWPENTRY GPIHBATCHFLUSH(HPS hps, PGPIHBATCH pBatch);
+    typedef GPIHBATCHFLUSH *PGPIHBATCHFLUSH;
+
     LONG XWPENTRY gpihCharStringPosAt(HPS hps,
                                       PPOINTL pptlStart,
                                       PRECTL prclRect,
@@ -64,6 +64,8 @@ extern "C" {
                                 PSZ *ppsz,
                                 PULONG pulLength);
 
+    VOID XWPENTRY nlsPreloadStrings(VOID);
+
     PCSZ XWPENTRY nlsGetString(ULONG ulStringID);
 
 
@@ -767,6 +767,72 @@ extern "C" {
 
     #pragma pack()
 
+    /*
+     *@@ PRCTHREADTIME:
+     *      CPU times of one thread, as remembered by
+     *      a PRCSNAPSHOT from its previous refresh.
+     */
+
+    typedef struct _PRCTHREADTIME
+    {
+        USHORT  usPID,
+                usTID;
+        ULONG   ulSysTime,
+                ulUserTime;
+    } PRCTHREADTIME, *PPRCTHREADTIME;
+
+    /*
+     *@@ PRCNAMEINDEX:
+     *      one entry in PRCSNAPSHOT.paNames.
+     */
+
+    typedef struct _PRCNAMEINDEX
+    {
+        PCSZ        pcszName;       // executable name without path; points
+                                    // into the module data of pInfo
+        PQPROCESS32 pProcess;
+    } PRCNAMEINDEX, *PPRCNAMEINDEX;
+
+    /*
+     *@@ PRCSNAPSHOT:
+     *      a DosQuerySysState snapshot that can be shared
+     *      by several users on their own timers and
+     *      refreshed at most every ulMinAge milliseconds,
+     *      with processes indexed by PID and by name.
+     *      Created by prc32CreateSnapshot.
+     *
+     *      Since the snapshot remembers the thread times
+     *      from the previous refresh, prc32QuerySnapshotCPU
+     *      can tell how much CPU time each thread and
+     *      process used in between.
+     *
+     *      The snapshot is not serialized; if several
+     *      threads share one, they must serialize
+     *      prc32RefreshSnapshot against their lookups.
+     */
+
+    typedef struct _PRCSNAPSHOT
+    {
+        PQTOPLEVEL32    pInfo;          // current buffer from prc32GetInfo2
+        ULONG           fl;             // QS32_* flags for refreshes
+        ULONG           ulMinAge;       // minimum refresh interval (ms)
+        ULONG           ulTimestamp;    // QSV_MS_COUNT of the last refresh
+        ULONG           ulElapsed;      // ms between the last two refreshes;
+                                        // 0 after the first one
+
+        ULONG           cProcesses;
+        PQPROCESS32     *papProcesses;  // cProcesses items, sorted by PID
+        PPRCNAMEINDEX   paNames;        // cProcesses items, sorted by name
+
+        PPRCTHREADTIME  paTimes,        // thread times of this refresh
+                        paTimesOld;     // thread times of the previous one;
+                                        // both sorted by PID and TID
+        ULONG           cTimes,
+                        cTimesOld;
+        ULONG           ulTotalTime;    // CPU time used by all threads between
+                                        // the last two refreshes
+    } PRCSNAPSHOT, *PPRCSNAPSHOT;
+
     /********************************************************************
      *
      *   DosQProcStat (16-bit) interface
@@ -837,6 +903,31 @@ extern "C" {
 
     void prc32KillProcessTree2(PQPROCESS32 pProcThis, ULONG pid);
 
+    /********************************************************************
+     *
+     *   Process snapshots
+     *
+     ********************************************************************/
+
+    APIRET prc32CreateSnapshot(PPRCSNAPSHOT *ppSnap,
+                               ULONG fl,
+                               ULONG ulMinAge);
+
+    APIRET prc32RefreshSnapshot(PPRCSNAPSHOT pSnap,
+                                BOOL fForce);
+
+    VOID prc32FreeSnapshot(PPRCSNAPSHOT *ppSnap);
+
+    PQPROCESS32 prc32SnapshotFromPID(PPRCSNAPSHOT pSnap,
+                                     ULONG pid);
+
+    PQPROCESS32 prc32SnapshotFromName(PPRCSNAPSHOT pSnap,
+                                      const char *pcszName);
+
+    ULONG prc32QuerySnapshotCPU(PPRCSNAPSHOT pSnap,
+                                PQPROCESS32 pProcess,
+                                PQTHREAD32 pThread);
+
 #endif
 
 #if __cplusplus
@@ -366,6 +366,12 @@ extern "C" {
             LINKLIST    llRectangles;
                                 // list of TXVRECTANGLE, from top to bottom;
                                 // text pointers point into pszViewText
+            PTXVRECTANGLE *papRectangles;
+            ULONG       cRectangles;
+                                // the same rectangles as an array, so that
+                                // painting and hit-testing can binary-search
+                                // for the first visible line instead of
+                                // walking the list from the top
             LINKLIST    llWords;
                                 // list of TXVWORD's, in order of creation;
                                 // this is just for proper cleanup. The items
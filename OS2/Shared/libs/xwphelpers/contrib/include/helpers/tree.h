@@ -80,6 +80,10 @@ extern "C" {
                    ULONG key,
                    FNTREE_COMPARE *pfnCompare);
 
+    TREE* treeFindAtLeast(TREE *root,
+                          ULONG key,
+                          FNTREE_COMPARE *pfnCompare);
+
     TREE* treeFirst(TREE *r);
 
     TREE* treeLast(TREE *r);
@@ -91,6 +95,12 @@ extern "C" {
     TREE** treeBuildArray(TREE* pRoot,
                           PLONG plCount);
 
+    int treeBuildFromArray(TREE **root,
+                           PLONG plCount,
+                           TREE **papNodes,
+                           long cNodes,
+                           FNTREE_COMPARE *pfnCompare);
+
 #endif
 
 #if __cplusplus
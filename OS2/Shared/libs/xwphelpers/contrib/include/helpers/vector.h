@@ -0,0 +1,117 @@
+
+/*
+ *@@sourcefile vector.h:
+ *      header file for vector.c. See remarks there.
+ *
+ *@@include #include "helpers\vector.h"
+ */
+
+/*      This file is part of the "XWorkplace helpers" source package.
+ *      This is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published
+ *      by the Free Software Foundation, in version 2 as it comes in the
+ *      "COPYING" file of the XWorkplace main distribution.
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ */
+
+#if __cplusplus
+extern "C" {
+#endif
+
+#ifndef VECTOR_HEADER_INCLUDED
+    #define VECTOR_HEADER_INCLUDED
+
+    #ifndef XWPENTRY
+        #error You must define XWPENTRY to contain the standard linkage for the XWPHelpers.
+    #endif
+
+    #include "helpers/simples.h"
+    #include "helpers/linklist.h"       // for FNSORTLIST
+
+    /*
+     *@@ VECTOR:
+     *      a growable array of item pointers.
+     *
+     *      See vector.c for more on how to use these.
+     */
+
+    typedef struct _VECTOR
+    {
+        unsigned long   ulCount;         // no. of items in array
+        unsigned long   cAllocated;      // no. of slots allocated
+        void            **papItems;      // array of item pointers
+        BOOL            fItemsFreeable;  // as in vecInit()
+    } VECTOR, *PVECTOR;
+
+    #define VEC_NOT_FOUND       ((unsigned long)-1)
+
+    /*
+     *@@ VEC_ITEM:
+     *      returns the item at ulIndex without
+     *      range checking. Use vecItemFromIndex
+     *      if the index may be out of range.
+     */
+
+    #define VEC_ITEM(pvec, ulIndex) ((pvec)->papItems[(ulIndex)])
+
+    void XWPENTRY vecInit(PVECTOR pvec, BOOL fItemsFreeable);
+    typedef void XWPENTRY VECINIT(PVECTOR pvec, BOOL fItemsFreeable);
+    typedef VECINIT *PVECINIT;
+
+    void XWPENTRY vecClear(PVECTOR pvec);
+    typedef void XWPENTRY VECCLEAR(PVECTOR pvec);
+    typedef VECCLEAR *PVECCLEAR;
+
+    BOOL XWPENTRY vecReserve(PVECTOR pvec, unsigned long cItems);
+    typedef BOOL XWPENTRY VECRESERVE(PVECTOR pvec, unsigned long cItems);
+    typedef VECRESERVE *PVECRESERVE;
+
+    BOOL XWPENTRY vecAppend(PVECTOR pvec, void *pItem);
+    typedef BOOL XWPENTRY VECAPPEND(PVECTOR pvec, void *pItem);
+    typedef VECAPPEND *PVECAPPEND;
+
+    BOOL XWPENTRY vecInsert(PVECTOR pvec, void *pItem, unsigned long ulIndex);
+    typedef BOOL XWPENTRY VECINSERT(PVECTOR pvec, void *pItem, unsigned long ulIndex);
+    typedef VECINSERT *PVECINSERT;
+
+    void* XWPENTRY vecRemoveIndex(PVECTOR pvec, unsigned long ulIndex);
+    typedef void* XWPENTRY VECREMOVEINDEX(PVECTOR pvec, unsigned long ulIndex);
+    typedef VECREMOVEINDEX *PVECREMOVEINDEX;
+
+    BOOL XWPENTRY vecRemoveItem(PVECTOR pvec, void *pItem);
+    typedef BOOL XWPENTRY VECREMOVEITEM(PVECTOR pvec, void *pItem);
+    typedef VECREMOVEITEM *PVECREMOVEITEM;
+
+    void* XWPENTRY vecItemFromIndex(const VECTOR *pvec, unsigned long ulIndex);
+    typedef void* XWPENTRY VECITEMFROMINDEX(const VECTOR *pvec, unsigned long ulIndex);
+    typedef VECITEMFROMINDEX *PVECITEMFROMINDEX;
+
+    unsigned long XWPENTRY vecIndexFromItem(const VECTOR *pvec, void *pItem);
+    typedef unsigned long XWPENTRY VECINDEXFROMITEM(const VECTOR *pvec, void *pItem);
+    typedef VECINDEXFROMITEM *PVECINDEXFROMITEM;
+
+    BOOL XWPENTRY vecSort(PVECTOR pvec, PFNSORTLIST pfnSort, void *pStorage);
+    typedef BOOL XWPENTRY VECSORT(PVECTOR pvec, PFNSORTLIST pfnSort, void *pStorage);
+    typedef VECSORT *PVECSORT;
+
+    unsigned long XWPENTRY vecSearch(const VECTOR *pvec,
+                                     void *pKey,
+                                     PFNSORTLIST pfnSort,
+                                     void *pStorage,
+                                     unsigned long *pulInsert);
+    typedef unsigned long XWPENTRY VECSEARCH(const VECTOR *pvec,
+                                             void *pKey,
+                                             PFNSORTLIST pfnSort,
+                                             void *pStorage,
+                                             unsigned long *pulInsert);
+    typedef VECSEARCH *PVECSEARCH;
+
+#endif
+
+#if __cplusplus
+}
+#endif
+
@@ -670,7 +670,8 @@ extern "C" {
 
     /*
      *@@ XMLDOM:
-     *      DOM instance returned by xmlCreateDOM.
+     *      DOM instance returned by xmlCreateDOM or
+     *      xmlCreateStream.
      *
      *@@added V0.9.9 (2001-02-14) [umoeller]
      */
@@ -742,6 +743,10 @@ extern "C" {
                         PVOID pvCallbackUser,
                         PXMLDOM *ppDom);
 
+    APIRET xmlCreateStream(PFNGETCPDATA pfnGetCPData,
+                           PVOID pvCallbackUser,
+                           PXMLDOM *ppDom);
+
     APIRET xmlParse(PXMLDOM pDom,
                     const char *pcszBuf,
                     ULONG cb,
@@ -162,6 +162,10 @@ extern "C" {
 
             // applications list
             LINKLIST    llApps;             // contains PXINIAPPDATA items
+
+            struct _TREE *pAppsTree;        // the same XINIAPPDATA's sorted by name
+            PBYTE       pbFileData;         // file contents as read on open;
+                                            // app and key data points into this
         } XINI, *PXINI;
     #else
         typedef void* PXINI;
@@ -220,6 +220,25 @@ extern "C" {
                                             const char *pcszReplace);
     typedef XSTRFINDREPLACEC *PXSTRFINDREPLACEC;
 
+    /*
+     *@@ XSTRREPLACE:
+     *      one search/replace pair for xstrReplaceMulti.
+     */
+
+    typedef struct _XSTRREPLACE
+    {
+        const char      *pcszSearch;    // string to search for
+        const char      *pcszReplace;   // replacement or NULL to remove
+    } XSTRREPLACE, *PXSTRREPLACE;
+
+    ULONG XWPENTRY xstrReplaceMulti(PXSTRING pxstr,
+                                    const XSTRREPLACE *paReplace,
+                                    ULONG cReplace);
+    typedef ULONG XWPENTRY XSTRREPLACEMULTI(PXSTRING pxstr,
+                                            const XSTRREPLACE *paReplace,
+                                            ULONG cReplace);
+    typedef XSTRREPLACEMULTI *PXSTRREPLACEMULTI;
+
     ULONG XWPENTRY xstrEncode(PXSTRING pxstr, const char *pcszEncode);
     typedef ULONG XWPENTRY XSTRENCODE(PXSTRING pxstr, const char *pcszEncode);
     typedef XSTRENCODE *PXSTRENCODE;
@@ -122,7 +122,24 @@ BSUniCodec::BSUniCodec(unsigned short usCodepage)      // in: codepage
         }
     }
 
-    _pCodec = encCreateCodec(id);
+    if (    (_pCodec = encCreateCodec(id))
+         && (_fDouble)
+       )
+    {
+        // the codec only knows the lead bytes that appear
+        // in its table; add the ranges that OS/2 reports
+        PCONVERSION pTable = (PCONVERSION)_pCodec;
+        PSZ pachDBCS = _achDBCS;
+        while (pachDBCS[0])
+        {
+            ULONG c;
+            for (c = (UCHAR)pachDBCS[0];
+                 c <= (UCHAR)pachDBCS[1];
+                 ++c)
+                pTable->abLeadBytes[c] = 1;
+            pachDBCS += 2;
+        }
+    }
 }
 
 /*
@@ -142,27 +159,6 @@ BSUniCodec::~BSUniCodec()
     }
 }
 
-/*
- *@@ IsLeadByte:
- *      returns TRUE if c is a DBCS lead byte.
- *
- *@@added V0.9.19 (2002-04-02) [umoeller]
- */
-
-static BOOL IsLeadByte(CHAR c,          // in: character to test
-                       PSZ pachDBCS)    // in: DBCS array from DosQueryDBCSEnv
-{
-    while (*pachDBCS)
-    {
-        if (    (c >= *pachDBCS++)
-             && (c <= *pachDBCS++)
-           )
-            return TRUE;
-    }
-
-    return FALSE;
-}
-
 /*
  *@@ Codepage2Uni:
  *      converts the given string from codepage-specific
@@ -185,60 +181,14 @@ void BSUniCodec::Codepage2Uni(BSUString &ustr,           // out: target
 	return;
     }
 
+    // each codepage byte becomes at most three UTF-8 bytes
     XSTRING xstrNew;
-    xstrInit(&xstrNew, ulLength + 1);
+    xstrInit(&xstrNew, 3 * ulLength + 1);
 
-    ULONG ul;
-    for (ul = 0;
-         ul < ulLength;
-         ++ul)
-    {
-        unsigned short c = pcszCP[ul];
-
-        if (_fDouble)
-        {
-            // we're using a double-byte codepage:
-            // check if this is a DBCS char
-            if (IsLeadByte(c, _achDBCS))
-                c = (c << 8) | pcszCP[++ul];
-        }
-
-        // convert this char to Unicode, using the current codepage
-        unsigned long ulUni = encChar2Uni(pTable, c);
-
-        if (ulUni == 0xFFFF)
-            // shouldn't happen
-            xstrcatc(&xstrNew, '?');
-        else if (ulUni < 0x80)
-            xstrcatc(&xstrNew, (CHAR)ulUni);
-        else if (ulUni < 0x800)
-        {
-            xstrcatc(&xstrNew, (CHAR)(0xC0 | ulUni>>6));
-            xstrcatc(&xstrNew, (CHAR)(0x80 | ulUni & 0x3F));
-        }
-        else if (ulUni < 0x10000)
-        {
-            xstrcatc(&xstrNew, (CHAR)(0xE0 | ulUni>>12));
-            xstrcatc(&xstrNew, (CHAR)(0x80 | ulUni>>6 & 0x3F));
-            xstrcatc(&xstrNew, (CHAR)(0x80 | ulUni & 0x3F));
-        }
-        /* else if (ulUni < 0x200000)
-        {
-            xstrcatc(&xstrNew, (CHAR)(0xF0 | ulUni>>18));
-            xstrcatc(&xstrNew, (CHAR)(0x80 | ulUni>>12 & 0x3F));
-            xstrcatc(&xstrNew, (CHAR)(0x80 | ulUni>>6 & 0x3F));
-            xstrcatc(&xstrNew, (CHAR)(0x80 | ulUni & 0x3F));
-        } */
-        else
-        {
-            CHAR sz[100];
-            sprintf(sz,
-                    "Unsupported Unicode character %u at offset %u in string",
-                    ulUni,
-                    ul);
-            throw BSExcptBase(sz);
-        }
-    }
+    xstrNew.ulLength = encCodepage2UTF8(pTable,
+                                        pcszCP,
+                                        ulLength,
+                                        xstrNew.psz);
 
     // copy back
     ustr._take_from(xstrNew);
@@ -269,39 +219,13 @@ void BSUniCodec::Uni2Codepage(BSString &str,
 
     PCONVERSION pTable = (PCONVERSION)_pCodec;
 
+    // no character gets longer in the codepage than in UTF-8
     XSTRING xstrNew;
     xstrInit(&xstrNew, ulLength + 1);
 
-    const char *pFirst = pcszUni;
-
-    while (*pcszUni)
-    {
-        unsigned long ulUni = encDecodeUTF8(&pcszUni);
-        unsigned short us = encUni2Char(pTable, ulUni);
-        if (us > 0xFF)
-        {
-            if (us == 0xFFFF)
-                us = '?';
-            else if (_fDouble)
-            {
-                // we're using a double-byte codepage:
-                // store lead byte first
-                xstrcatc(&xstrNew, (CHAR)(us >> 8));
-            }
-            else
-            {
-                // not double-byte codepage: then we can't handle > 0xFF
-                CHAR sz[100];
-                sprintf(sz,
-                        "Unsupported Unicode character %u at offset %u in string",
-                        ulUni,
-                        pcszUni - pFirst);
-                throw BSExcptBase(sz);
-
-            }
-        }
-        xstrcatc(&xstrNew, (CHAR)us);
-    }
+    xstrNew.ulLength = encUTF82Codepage(pTable,
+                                        pcszUni,
+                                        xstrNew.psz);
 
     // copy back
     str._take_from(xstrNew);
@@ -3236,9 +3236,9 @@ APIRET doshLoadTextFile(PCSZ pcszFile,      // in: file name to read
                          &cbFile,
                          &pFile)))
     {
-        doshReadText(pFile,
-                     ppszContent,
-                     pcbRead);
+        arc = doshReadText(pFile,
+                           ppszContent,
+                           pcbRead);
         doshClose(&pFile);
     }
 
@@ -87,6 +87,7 @@
 #include <os2.h>
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "setup.h"                      // code generation and debugging options
@@ -117,12 +118,14 @@
 
 // forward declarations to helper funcs at bottom
 STATIC PEALIST      ReadEAList(ULONG, PVOID);
+STATIC PEALIST      ReadEAsByName(ULONG, PVOID, const char **, ULONG);
 STATIC EABINDING *  ReadEAByIndex(ULONG, PVOID, ULONG);
 STATIC EABINDING *  ReadEAByName(ULONG, PVOID, PSZ);
 STATIC PDENA2       ReadDenaByIndex(ULONG, PVOID, ULONG);
 STATIC PEABINDING   GetEAValue(ULONG, PVOID, PDENA2);
 STATIC void         SetupQueryEAInfo(PDENA2, PEAOP2);
 STATIC PEABINDING   ConvertFeal2Binding(PFEA2LIST);
+STATIC PEABINDING   ConvertFea2Binding(PFEA2);
 STATIC APIRET       WriteEAList(ULONG, PVOID, PEALIST);
 STATIC APIRET       WriteEA(ULONG, PVOID, PEABINDING);
 STATIC PFEA2LIST    ConvertBinding2Feal(PEABINDING);
@@ -312,6 +315,64 @@ PEABINDING eaHFileReadOneByName(HFILE hfile, const char *pcszEAName)
     return ReadEAByName(ENUMEA_REFTYPE_FHANDLE, (&hfile), (PSZ)pcszEAName);
 }
 
+/*
+ *@@ eaPathReadMany:
+ *      reads the EAs with the cNames names in papcszEANames
+ *      with a single DosQueryPathInfo call.
+ *
+ *      Returns an EALIST with a binding for each of the EAs
+ *      that exist on the file, in the order of papcszEANames,
+ *      or NULL if none of them exist. Use eaFindInList to
+ *      pick them out and eaFreeList to free the list.
+ *
+ *      If you need more than one EA from the same file, this
+ *      is a lot quicker than calling eaPathReadOneByName for
+ *      each of them.
+ */
+
+PEALIST eaPathReadMany(const char *pcszPath,
+                       const char **papcszEANames,
+                       ULONG cNames)
+{
+    return ReadEAsByName(ENUMEA_REFTYPE_PATH, (PSZ)pcszPath, papcszEANames, cNames);
+}
+
+/*
+ *@@ eaHFileReadMany:
+ *      like eaPathReadMany, but for an open file handle.
+ */
+
+PEALIST eaHFileReadMany(HFILE hfile,
+                        const char **papcszEANames,
+                        ULONG cNames)
+{
+    return ReadEAsByName(ENUMEA_REFTYPE_FHANDLE, (&hfile), papcszEANames, cNames);
+}
+
+/*
+ *@@ eaFindInList:
+ *      returns the binding for pcszEAName from the given
+ *      EA list or NULL if it's not in there. The binding
+ *      still belongs to the list.
+ */
+
+PEABINDING eaFindInList(PEALIST list,
+                        const char *pcszEAName)
+{
+    while (list)
+    {
+        PEABINDING peab = EA_LIST_BINDING(list);
+        if (    (peab)
+             && (!stricmp(EA_BINDING_NAME(peab), pcszEAName))
+           )
+            return peab;
+
+        list = EA_LIST_NEXT(list);
+    }
+
+    return NULL;
+}
+
 /* ******************************************************************
  *
  *   Write-EA functions
@@ -947,12 +1008,14 @@ PEABINDING eaCreateMVBindingFromPSZ(const char *pcszEAName,      // in: EA name
  */
 
 /*
- *@@ ReadEAList:
- *
+ *@@ ReadEAListByIndex:
+ *      reads all EAs one by one. This costs two API calls
+ *      per EA and is only used if ReadEAList can't get all
+ *      the names at once.
  */
 
-STATIC PEALIST ReadEAList(ULONG type, // in: ENUMEA_REFTYPE_FHANDLE or  ENUMEA_REFTYPE_PATH
-                          PVOID pfile)
+STATIC PEALIST ReadEAListByIndex(ULONG type, // in: ENUMEA_REFTYPE_FHANDLE or  ENUMEA_REFTYPE_PATH
+                                 PVOID pfile)
 {
     ULONG index = 1;
     PEALIST head = 0;
@@ -978,6 +1041,77 @@ STATIC PEALIST ReadEAList(ULONG type, // in: ENUMEA_REFTYPE_FHANDLE or  ENUMEA_R
     return head;
 }
 
+/*
+ *@@ ReadEAList:
+ *      reads all EAs of a file. This gets the total EA
+ *      size first, then all EA names with one
+ *      DosEnumAttribute call and then all values with
+ *      one FIL_QUERYEASFROMLIST query, so it takes three
+ *      API calls no matter how many EAs there are.
+ */
+
+STATIC PEALIST ReadEAList(ULONG type, // in: ENUMEA_REFTYPE_FHANDLE or  ENUMEA_REFTYPE_PATH
+                          PVOID pfile)
+{
+    PEALIST     head = NULL;
+    FILESTATUS4 fs4;
+    APIRET      arc;
+    ULONG       cb,
+                count = (ULONG)-1;      // all
+    PBYTE       pbDena;
+
+    if (type == ENUMEA_REFTYPE_FHANDLE)
+        arc = DosQueryFileInfo(*((PHFILE)pfile), FIL_QUERYEASIZE, &fs4, sizeof(fs4));
+    else
+        arc = DosQueryPathInfo((PSZ)pfile, FIL_QUERYEASIZE, &fs4, sizeof(fs4));
+
+    if (arc)
+        return ReadEAListByIndex(type, pfile);
+
+    if (fs4.cbList <= sizeof(ULONG))
+        // no EAs (cbList of an empty FEALIST is 4)
+        return NULL;
+
+    // fs4.cbList is the size of the packed FEALIST; a DENA2
+    // for the same EA is never more than twice as large
+    cb = fs4.cbList * 2 + 16;
+    if (!(pbDena = (PBYTE)malloc(cb)))
+        return NULL;
+
+    if (    (!(arc = DosEnumAttribute(type,
+                                      pfile,
+                                      1,
+                                      pbDena,
+                                      cb,
+                                      &count,
+                                      ENUMEA_LEVEL_NO_VALUE)))
+         && (count)
+       )
+    {
+        // collect the names
+        const char **papcszNames;
+        if (papcszNames = (const char **)malloc(count * sizeof(char*)))
+        {
+            PDENA2  pdena = (PDENA2)pbDena;
+            ULONG   ul;
+            for (ul = 0; ul < count; ul++)
+            {
+                papcszNames[ul] = pdena->szName;
+                pdena = (PDENA2)((PBYTE)pdena + pdena->oNextEntryOffset);
+            }
+
+            head = ReadEAsByName(type, pfile, papcszNames, count);
+            free(papcszNames);
+        }
+    }
+    else if (arc)
+        head = ReadEAListByIndex(type, pfile);
+
+    free(pbDena);
+
+    return head;
+}
+
 /*
  *@@ ReadEAByIndex:
  *
@@ -995,24 +1129,147 @@ STATIC PEABINDING ReadEAByIndex(ULONG type, // in: ENUMEA_REFTYPE_FHANDLE or  EN
 
 /*
  *@@ ReadEAByName:
- *
+ *      reads one EA by name with a single query instead of
+ *      enumerating the file's EAs until the name turns up.
  */
 
 STATIC PEABINDING ReadEAByName(ULONG type, // in: ENUMEA_REFTYPE_FHANDLE or  ENUMEA_REFTYPE_PATH
                                PVOID pfile,
                                PSZ name)
 {
-    ULONG index = 1;
+    PEABINDING  binding = NULL;
+    const char  *apcszNames[1];
+    PEALIST     list;
+
+    apcszNames[0] = name;
+    if (list = ReadEAsByName(type, pfile, apcszNames, 1))
+    {
+        // steal the binding from the list
+        binding = EA_LIST_BINDING(list);
+        EA_LIST_BINDING(list) = NULL;
+        eaFreeList(list);
+    }
+
+    return binding;
+}
+
+/*
+ *@@ ReadEAsByName:
+ *      reads the EAs with the given names with one
+ *      FIL_QUERYEASFROMLIST query and returns an EALIST
+ *      with those that exist, in the order of papcszNames.
+ *
+ *      The FEA2LIST buffer starts out at 4 KB, which holds
+ *      the usual type, longname and icon EAs; if the EAs
+ *      don't fit, the query is repeated once with a buffer
+ *      large enough for the 64 KB that a file can have.
+ */
+
+#define FEALIST_FIRSTTRY    0x1000
+#define FEALIST_MAX         0x20000
+
+STATIC PEALIST ReadEAsByName(ULONG type, // in: ENUMEA_REFTYPE_FHANDLE or  ENUMEA_REFTYPE_PATH
+                             PVOID pfile,
+                             const char **papcszNames,
+                             ULONG cNames)
+{
+    PEALIST     head = NULL,
+                tail = NULL;
+    EAOP2       eaop;
+    ULONG       cbGEA = sizeof(ULONG),
+                cbFEA = FEALIST_FIRSTTRY,
+                ul;
+    APIRET      arc;
+    PGEA2       pgea;
+
+    if (!cNames)
+        return NULL;
+
+    // build the GEA2LIST; entries must be dword-aligned
+    for (ul = 0; ul < cNames; ul++)
+        cbGEA += (offsetof(GEA2, szName) + strlen(papcszNames[ul]) + 1 + 3) & ~3;
+
+    if (!(eaop.fpGEA2List = (PGEA2LIST)malloc(cbGEA)))
+        return NULL;
+
+    eaop.fpGEA2List->cbList = cbGEA;
+    pgea = eaop.fpGEA2List->list;
+    for (ul = 0; ul < cNames; ul++)
+    {
+        ULONG cbName = strlen(papcszNames[ul]);
+        pgea->cbName = (BYTE)cbName;
+        memcpy(pgea->szName, papcszNames[ul], cbName + 1);
+        if (ul < cNames - 1)
+        {
+            pgea->oNextEntryOffset = (offsetof(GEA2, szName) + cbName + 1 + 3) & ~3;
+            pgea = (PGEA2)((PBYTE)pgea + pgea->oNextEntryOffset);
+        }
+        else
+            pgea->oNextEntryOffset = 0;
+    }
+
     while (1)
     {
-        PDENA2 dena = ReadDenaByIndex(type, pfile, index);
-        if (dena == 0)
-            return NULL;
-        if ((strcmp(name, (dena->szName))) == 0)
-            return GetEAValue(type, pfile, dena);
-        free(dena);
-        index += 1;
+        if (!(eaop.fpFEA2List = (PFEA2LIST)malloc(cbFEA)))
+        {
+            arc = ERROR_NOT_ENOUGH_MEMORY;
+            break;
+        }
+        eaop.fpFEA2List->cbList = cbFEA;
+        eaop.oError = 0;
+
+        if (type == ENUMEA_REFTYPE_FHANDLE)
+            arc = DosQueryFileInfo(*((PHFILE)pfile), FIL_QUERYEASFROMLIST, &eaop, sizeof(eaop));
+        else
+            arc = DosQueryPathInfo((PSZ)pfile, FIL_QUERYEASFROMLIST, &eaop, sizeof(eaop));
+
+        if (    (arc != ERROR_BUFFER_OVERFLOW)
+             || (cbFEA >= FEALIST_MAX)
+           )
+            break;
+
+        // too small: try once more with the maximum
+        free(eaop.fpFEA2List);
+        cbFEA = FEALIST_MAX;
     }
+
+    if (!arc)
+    {
+        PFEA2 fea = eaop.fpFEA2List->list;
+        while (1)
+        {
+            // EAs that don't exist come back with no value
+            if (fea->cbValue)
+            {
+                PEABINDING binding;
+                PEALIST list;
+                if (    (binding = ConvertFea2Binding(fea))
+                     && (list = (PEALIST)malloc(sizeof(EALIST)))
+                   )
+                {
+                    EA_LIST_BINDING(list) = binding;
+                    EA_LIST_NEXT(list) = NULL;
+                    if (!head)
+                        head = list;
+                    else
+                        EA_LIST_NEXT(tail) = list;
+                    tail = list;
+                }
+                else
+                    eaFreeBinding(binding);
+            }
+
+            if (!fea->oNextEntryOffset)
+                break;
+            fea = (PFEA2)((PBYTE)fea + fea->oNextEntryOffset);
+        }
+    }
+
+    if (eaop.fpFEA2List)
+        free(eaop.fpFEA2List);
+    free(eaop.fpGEA2List);
+
+    return head;
 }
 
 /*
@@ -1126,7 +1383,21 @@ STATIC void SetupQueryEAInfo(PDENA2 dena,  // in: buffer allocated by ReadDenaBy
 
 STATIC PEABINDING ConvertFeal2Binding(PFEA2LIST feal)
 {
-    PFEA2 fea = (&((feal->list) [0]));
+    PEABINDING binding;
+    if (binding = ConvertFea2Binding(&feal->list[0]))
+        free(feal);
+
+    return binding;
+}
+
+/*
+ *@@ ConvertFea2Binding:
+ *      creates a new EABINDING from the given FEA2.
+ *      Returns NULL upon errors.
+ */
+
+STATIC PEABINDING ConvertFea2Binding(PFEA2 fea)
+{
     PEABINDING binding = (PEABINDING)(malloc(sizeof (EABINDING)));
     if (binding)
     {
@@ -1139,7 +1410,6 @@ STATIC PEABINDING ConvertFeal2Binding(PFEA2LIST feal)
         memcpy ((EA_BINDING_VALUE (binding)),
                 (&((fea->szName) [(fea->cbName) + 1])),
                 (fea->cbValue));
-        free(feal);
     }
 
     return binding;
@@ -272,6 +272,10 @@ ENCID encFindIdForCodepage(unsigned short usCodepage,       // in: codepage to f
  *      systems (and Windows uses OS/2 codepage 1252),
  *      so for conversion between those, codecs are needed.
  *
+ *      For double-byte codepages, the codec also records
+ *      which bytes start a double-byte character, which
+ *      is what encCodepage2UTF8 uses to split the input.
+ *
  *      This works and is presently used in WarpIN.
  */
 
@@ -341,8 +345,25 @@ PCONVERSION encCreateCodec(ENCID id)
                         pTableNew->ausEntriesUniFromCP[pEntry->usCP] = pEntry->usUni;
 
                         pTableNew->ausEntriesCPFromUni[pEntry->usUni] = pEntry->usCP;
+
+                        if (pEntry->usCP > 0xFF)
+                            pTableNew->abLeadBytes[pEntry->usCP >> 8] = 1;
                     }
 
+                    // step 4: check whether ASCII passes through
+                    // unchanged; not so with e.g. cp864, which
+                    // has an Arabic percent sign at 0x25
+                    pTableNew->fASCII = (    (usHighestCP >= 0x7F)
+                                          && (usHighestUni >= 0x7F)
+                                        );
+                    for (ul = 0;
+                         (ul < 0x80) && (pTableNew->fASCII);
+                         ul++)
+                        if (    (pTableNew->ausEntriesUniFromCP[ul] != ul)
+                             || (pTableNew->ausEntriesCPFromUni[ul] != ul)
+                           )
+                            pTableNew->fASCII = 0;
+
                     return pTableNew;
                 }
 
@@ -553,6 +574,197 @@ unsigned long encDecodeUTF8(const char **ppch)
     return ulChar;
 }
 
+/*
+ *@@ CopyASCII:
+ *      copies the run of 7-bit characters at the start
+ *      of pcsz to psz, four bytes at a time, and returns
+ *      the number of bytes copied. Stops at the first
+ *      byte with bit 7 set, at cbMax, or, if fStopAtNull
+ *      is set, at the first null byte.
+ */
+
+STATIC unsigned long CopyASCII(const unsigned char *pcsz,
+                               unsigned long cbMax,
+                               int fStopAtNull,
+                               unsigned char *psz)
+{
+    unsigned long cb = 0;
+
+    // go byte by byte until the source is aligned; the
+    // aligned four-byte reads below then never cross
+    // into the next page when looking for the null byte
+    while (    (cb < cbMax)
+            && (((unsigned long)(pcsz + cb)) & 3)
+            && (!(pcsz[cb] & 0x80))
+            && ((pcsz[cb]) || (!fStopAtNull))
+          )
+    {
+        psz[cb] = pcsz[cb];
+        ++cb;
+    }
+
+    while (    (!(((unsigned long)(pcsz + cb)) & 3))
+            && (cb + 4 <= cbMax)
+          )
+    {
+        unsigned long ul = *(const unsigned long*)(pcsz + cb);
+        if (ul & 0x80808080UL)
+            break;
+        if (    (fStopAtNull)
+             && ((ul - 0x01010101UL) & ~ul & 0x80808080UL)
+           )
+            // one of the four is null
+            break;
+        *(unsigned long*)(psz + cb) = ul;
+        cb += 4;
+    }
+
+    while (    (cb < cbMax)
+            && (!(pcsz[cb] & 0x80))
+            && ((pcsz[cb]) || (!fStopAtNull))
+          )
+    {
+        psz[cb] = pcsz[cb];
+        ++cb;
+    }
+
+    return cb;
+}
+
+/*
+ *@@ encCodepage2UTF8:
+ *      converts a whole buffer of codepage-specific
+ *      characters to UTF-8, using the given codec from
+ *      encCreateCodec.
+ *
+ *      pszUTF8 must point to a buffer of at least
+ *      3 * cbCP + 1 bytes. The output is null-terminated.
+ *      Returns the length of the output without the
+ *      null terminator.
+ *
+ *      Characters without a Unicode equivalent are
+ *      replaced with '?', as are all characters if
+ *      pTable is NULL. Null bytes in the input are
+ *      converted like any other character.
+ *
+ *      This is much faster than calling encChar2Uni for
+ *      each character since runs of 7-bit characters are
+ *      copied four bytes at a time if the codepage
+ *      agrees with ASCII there.
+ */
+
+unsigned long encCodepage2UTF8(PCONVERSION pTable,         // in: codec from encCreateCodec
+                               const char *pcszCP,         // in: codepage characters
+                               unsigned long cbCP,         // in: length of pcszCP
+                               char *pszUTF8)              // out: UTF-8 (3 * cbCP + 1 bytes)
+{
+    const unsigned char *pcsz = (const unsigned char*)pcszCP,
+                        *pcszEnd = pcsz + cbCP;
+    unsigned char       *psz = (unsigned char*)pszUTF8;
+
+    while (pcsz < pcszEnd)
+    {
+        unsigned short  c;
+        unsigned long   ulUni;
+
+        if ((pTable) && (pTable->fASCII))
+        {
+            unsigned long cb = CopyASCII(pcsz,
+                                         pcszEnd - pcsz,
+                                         0,
+                                         psz);
+            pcsz += cb;
+            psz += cb;
+            if (pcsz >= pcszEnd)
+                break;
+        }
+
+        c = *pcsz++;
+        if (    (pTable)
+             && (pTable->abLeadBytes[c])
+             && (pcsz < pcszEnd)
+           )
+            c = (c << 8) | *pcsz++;
+
+        if (    (!pTable)
+             || (c > pTable->usHighestCP)
+             || ((ulUni = pTable->ausEntriesUniFromCP[c]) == 0xFFFF)
+           )
+            *psz++ = '?';
+        else if (ulUni < 0x80)
+            *psz++ = (unsigned char)ulUni;
+        else if (ulUni < 0x800)
+        {
+            *psz++ = (unsigned char)(0xC0 | ulUni >> 6);
+            *psz++ = (unsigned char)(0x80 | ulUni & 0x3F);
+        }
+        else
+        {
+            *psz++ = (unsigned char)(0xE0 | ulUni >> 12);
+            *psz++ = (unsigned char)(0x80 | ulUni >> 6 & 0x3F);
+            *psz++ = (unsigned char)(0x80 | ulUni & 0x3F);
+        }
+    }
+
+    *psz = '\0';
+
+    return psz - (unsigned char*)pszUTF8;
+}
+
+/*
+ *@@ encUTF82Codepage:
+ *      converts a null-terminated UTF-8 string to the
+ *      codepage of the given codec from encCreateCodec.
+ *
+ *      pszCP must point to a buffer of at least
+ *      strlen(pcszUTF8) + 1 bytes. The output is
+ *      null-terminated. Returns the length of the
+ *      output without the null terminator.
+ *
+ *      Characters that the codepage does not have are
+ *      replaced with '?'. Double-byte characters are
+ *      stored lead byte first.
+ */
+
+unsigned long encUTF82Codepage(PCONVERSION pTable,          // in: codec from encCreateCodec
+                               const char *pcszUTF8,        // in: UTF-8 string
+                               char *pszCP)                 // out: codepage string
+{
+    unsigned char       *psz = (unsigned char*)pszCP;
+
+    while (*pcszUTF8)
+    {
+        unsigned long   ulUni;
+        unsigned short  us;
+
+        if ((pTable) && (pTable->fASCII))
+        {
+            unsigned long cb = CopyASCII((const unsigned char*)pcszUTF8,
+                                         (unsigned long)-1,
+                                         1,
+                                         psz);
+            pcszUTF8 += cb;
+            psz += cb;
+            if (!*pcszUTF8)
+                break;
+        }
+
+        ulUni = encDecodeUTF8(&pcszUTF8);
+        if (    (!pTable)
+             || (ulUni > pTable->usHighestUni)
+             || ((us = pTable->ausEntriesCPFromUni[ulUni]) == 0xFFFF)
+           )
+            us = '?';
+        else if (us > 0xFF)
+            *psz++ = (unsigned char)(us >> 8);
+        *psz++ = (unsigned char)us;
+    }
+
+    *psz = '\0';
+
+    return psz - (unsigned char*)pszCP;
+}
+
 /*
  *@@ encInitCase:
  *      creates a casefold for later use with
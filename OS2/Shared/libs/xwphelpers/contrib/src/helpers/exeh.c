@@ -98,6 +98,15 @@
  *      and can thus profit from the caching that is
  *      implemented there (V0.9.16).
  *
+ *      Only the headers are read here. The NE and LX
+ *      loader tables are read in one block the first
+ *      time one of the table functions needs them and
+ *      are parsed in memory from then on (see
+ *      LoadTables). The imports, exports and resources
+ *      parsed from them are also cached per file (see
+ *      exehFlushCache), so opening the same unchanged
+ *      module again is cheap.
+ *
  *      If no error occurs, NO_ERROR is returned
  *      and a pointer to a new EXECUTABLE structure
  *      is stored in *ppExec. Consider this pointer a
@@ -1157,37 +1166,566 @@ PCSZ exehDescribeProgType(PROGCATEGORY progc)        // in: from PROGDETAILS.pro
     return NULL;
 }
 
-/*
- *@@ exehQueryImportedModules:
- *      returns an array of FSYSMODULE structure describing all
- *      imported modules.
+/********************************************************************
  *
- *      *pcModules receives the # of items in the array (not the
- *      array size!).  Use doshFreeImportedModules to clean up.
+ *   Loader tables
  *
- *      This returns a standard OS/2 error code, which might be
- *      any of the codes returned by DosSetFilePtr and DosRead.
- *      In addition, this may return:
+ ********************************************************************/
+
+/*
+ *      The NE and LX loader tables (entry table, name tables,
+ *      module and import tables, resource, segment and object
+ *      tables) all sit in one block behind the new header.
+ *      Instead of seeking and reading them a few bytes at a
+ *      time, the table functions below read that block in one
+ *      go on first use, keep it in EXECUTABLE.pbTables, and
+ *      parse it in memory. The non-resident name table lives
+ *      elsewhere in the file and gets a block of its own.
+ *
+ *      exehOpen does not read the block, so callers that only
+ *      need the headers or the BLDLEVEL string don't pay for it.
+ */
+
+/*
+ *@@ EXEHCURSOR:
+ *      read position in one of the table blocks.
+ */
+
+typedef struct _EXEHCURSOR
+{
+    const BYTE  *pb,            // current position
+                *pbEnd;         // end of block
+} EXEHCURSOR, *PEXEHCURSOR;
+
+/*
+ *@@ GetNewHeaderOfs:
+ *      returns the file offset of the NE or LX header,
+ *      which is 0 for NOSTUB executables.
+ */
+
+STATIC ULONG GetNewHeaderOfs(const EXECUTABLE *pExec)
+{
+    if (pExec->cbDosExeHeader)
+        // executable has DOS stub
+        return pExec->DosExeHeader.ulNewHeaderOfs;
+
+    return 0;
+}
+
+/*
+ *@@ LoadTables:
+ *      makes sure pExec->pbTables covers cb bytes at
+ *      ulOfs from the new header, reading or extending
+ *      the block as needed.
+ *
+ *      The first call reads the whole loader section
+ *      (plus the fixup section for LX, which has the
+ *      import module table), so this normally hits the
+ *      disk once per executable.
+ *
+ *      Note that this may move pbTables, so don't keep
+ *      cursors into it across calls.
+ */
+
+STATIC APIRET LoadTables(PEXECUTABLE pExec,
+                         ULONG ulOfs,       // in: table offset from new header
+                         ULONG cb)          // in: bytes needed at ulOfs
+{
+    APIRET  arc;
+    ULONG   ulHdrOfs = GetNewHeaderOfs(pExec),
+            cbFile = pExec->pFile->cbInitial,
+            cbWant = ulOfs + cb;
+    PBYTE   pbNew;
+
+    if (cbWant <= pExec->cbTables)
+        return NO_ERROR;
+
+    if (    (cbWant < ulOfs)            // overflow
+         || (ulHdrOfs >= cbFile)
+         || (cbWant > cbFile - ulHdrOfs)
+       )
+        return ERROR_BAD_EXE_FORMAT;
+
+    if (!pExec->cbTables)
+    {
+        // first call: take the whole section
+        ULONG cbSection = 0;
+
+        if (pExec->ulExeFormat == EXEFORMAT_LX)
+            cbSection =   pExec->pLXHeader->ulObjTblOfs
+                        + pExec->pLXHeader->ulLoaderLen
+                        + pExec->pLXHeader->ulFixupTblLen;
+        else if (pExec->ulExeFormat == EXEFORMAT_NE)
+            cbSection =   pExec->pNEHeader->usEntryTblOfs
+                        + pExec->pNEHeader->usEntryTblLen;
+
+        if (    (cbSection < cbWant)
+             || (cbSection > cbFile - ulHdrOfs)
+           )
+        {
+            // header sizes are bogus: read generously
+            cbSection = cbFile - ulHdrOfs;
+            if (cbSection - cbWant > 0x10000)
+                cbSection = cbWant + 0x10000;
+        }
+
+        cbWant = cbSection;
+    }
+
+    if (!(pbNew = (PBYTE)realloc(pExec->pbTables, cbWant)))
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    pExec->pbTables = pbNew;
+    cb = cbWant - pExec->cbTables;
+    if (!(arc = doshReadAt(pExec->pFile,
+                           ulHdrOfs + pExec->cbTables,
+                           &cb,
+                           pbNew + pExec->cbTables,
+                           DRFL_NOCACHE | DRFL_FAILIFLESS)))
+        pExec->cbTables = cbWant;
+
+    return arc;
+}
+
+/*
+ *@@ OpenTable:
+ *      sets up *pCur for the table at ulOfs from the
+ *      new header. cbMin bytes must exist there; the
+ *      cursor then runs to the end of the block.
+ */
+
+STATIC APIRET OpenTable(PEXECUTABLE pExec,
+                        ULONG ulOfs,            // in: table offset from new header
+                        ULONG cbMin,            // in: minimum table size
+                        PEXEHCURSOR pCur)       // out: cursor
+{
+    APIRET arc;
+
+    if (!(arc = LoadTables(pExec, ulOfs, cbMin)))
+    {
+        pCur->pb = pExec->pbTables + ulOfs;
+        pCur->pbEnd = pExec->pbTables + pExec->cbTables;
+    }
+
+    return arc;
+}
+
+/*
+ *@@ OpenNonResdNames:
+ *      sets up *pCur for the non-resident name table,
+ *      reading it on the first call. The cursor is
+ *      empty if the module has no such table.
+ */
+
+STATIC APIRET OpenNonResdNames(PEXECUTABLE pExec,
+                               PEXEHCURSOR pCur)
+{
+    APIRET arc = NO_ERROR;
+
+    if (!pExec->pbNonResdNames)
+    {
+        ULONG   ulOfs = 0,              // from beginning of file
+                cb = 0,
+                cbFile = pExec->pFile->cbInitial;
+
+        if (pExec->ulExeFormat == EXEFORMAT_LX)
+        {
+            ulOfs = pExec->pLXHeader->ulNonResdNameTblOfs;
+            cb = pExec->pLXHeader->ulNonResdNameTblLen;
+        }
+        else if (pExec->ulExeFormat == EXEFORMAT_NE)
+        {
+            ulOfs = pExec->pNEHeader->ulNonResdTblOfs;
+            cb = pExec->pNEHeader->usNonResdTblLen;
+        }
+
+        if (ulOfs && cb)
+        {
+            if (    (ulOfs >= cbFile)
+                 || (cb > cbFile - ulOfs)
+               )
+                arc = ERROR_BAD_EXE_FORMAT;
+            else if (!(pExec->pbNonResdNames = (PBYTE)malloc(cb)))
+                arc = ERROR_NOT_ENOUGH_MEMORY;
+            else if (!(arc = doshReadAt(pExec->pFile,
+                                        ulOfs,
+                                        &cb,
+                                        pExec->pbNonResdNames,
+                                        DRFL_NOCACHE | DRFL_FAILIFLESS)))
+                pExec->cbNonResdNames = cb;
+            else
+                FREE(pExec->pbNonResdNames);
+        }
+    }
+
+    pCur->pb = pExec->pbNonResdNames;
+    pCur->pbEnd = pExec->pbNonResdNames + pExec->cbNonResdNames;
+
+    return arc;
+}
+
+/*
+ *@@ CurRead:
+ *      copies cb bytes from the cursor and advances it.
+ *      Returns ERROR_BAD_EXE_FORMAT if the table runs
+ *      past the end of its block.
+ */
+
+STATIC APIRET CurRead(PEXEHCURSOR pCur,
+                      PVOID pv,
+                      ULONG cb)
+{
+    if ((ULONG)(pCur->pbEnd - pCur->pb) < cb)
+        return ERROR_BAD_EXE_FORMAT;
+
+    memcpy(pv, pCur->pb, cb);
+    pCur->pb += cb;
+
+    return NO_ERROR;
+}
+
+/*
+ *@@ CurSkip:
+ *      advances the cursor by cb bytes.
+ */
+
+STATIC APIRET CurSkip(PEXEHCURSOR pCur,
+                      ULONG cb)
+{
+    if ((ULONG)(pCur->pbEnd - pCur->pb) < cb)
+        return ERROR_BAD_EXE_FORMAT;
+
+    pCur->pb += cb;
+
+    return NO_ERROR;
+}
+
+/*
+ *@@ CopyTable:
+ *      copies cb bytes of the table at ulOfs from the
+ *      new header into pv.
+ */
+
+STATIC APIRET CopyTable(PEXECUTABLE pExec,
+                        ULONG ulOfs,
+                        ULONG cb,
+                        PVOID pv)
+{
+    APIRET arc;
+
+    if (!(arc = LoadTables(pExec, ulOfs, cb)))
+        memcpy(pv, pExec->pbTables + ulOfs, cb);
+
+    return arc;
+}
+
+/********************************************************************
  *
- *      --  ERROR_NOT_ENOUGH_MEMORY
+ *   Directory cache
  *
- *      --  ERROR_INVALID_EXE_SIGNATURE: exe is in a format other
- *          than LX or NE, which is not understood by this function.
+ ********************************************************************/
+
+/*
+ *      The WPS and XWorkplace ask for the imports, exports
+ *      and resources of the same modules over and over (the
+ *      "Module" pages, icon extraction). The parsed arrays
+ *      are kept in a small MRU cache keyed on the full path,
+ *      size and last-write time of the file, so a module
+ *      that hasn't changed is parsed only once. Callers
+ *      always get their own copy, which they free with the
+ *      exehFree* functions as before.
+ */
+
+#define CACHED_MODULES          0
+#define CACHED_FUNCTIONS        1
+#define CACHED_RESOURCES        2
+#define CACHED_KINDS            3
+
+#define EXE_CACHE_SLOTS         32
+
+/*
+ *@@ EXECACHEENTRY:
+ *      one module in the directory cache. The first
+ *      four fields are the file identity.
+ */
+
+typedef struct _EXECACHEENTRY
+{
+    CHAR        szFullName[CCHMAXPATH];
+    ULONG       cbFile;
+    FDATE       fdateLastWrite;
+    FTIME       ftimeLastWrite;
+
+    ULONG       ulLastUsed;                 // MRU stamp, 0 if slot is free
+    BOOL        afValid[CACHED_KINDS];
+    PVOID       apvArray[CACHED_KINDS];     // may be NULL for 0 items
+    ULONG       acItems[CACHED_KINDS];
+} EXECACHEENTRY, *PEXECACHEENTRY;
+
+STATIC const ULONG  G_acbCachedItem[CACHED_KINDS] =
+    {
+        sizeof(FSYSMODULE),
+        sizeof(FSYSFUNCTION),
+        sizeof(FSYSRESOURCE)
+    };
+
+STATIC HMTX             G_hmtxExeCache = NULLHANDLE;
+STATIC EXECACHEENTRY    G_aExeCache[EXE_CACHE_SLOTS];
+STATIC ULONG            G_ulExeCacheStamp = 0;
+
+/*
+ *@@ LockExeCache:
+ *      requests the directory cache mutex, creating it
+ *      on the first call.
+ */
+
+STATIC APIRET LockExeCache(VOID)
+{
+    if (!G_hmtxExeCache)
+        // first call: create
+        return DosCreateMutexSem(NULL,
+                                 &G_hmtxExeCache,
+                                 0,
+                                 TRUE);     // request!
+
+    // subsequent calls: request
+    return DosRequestMutexSem(G_hmtxExeCache, SEM_INDEFINITE_WAIT);
+}
+
+/*
+ *@@ UnlockExeCache:
  *
- *      Even if NO_ERROR is returned, the array pointer might still
- *      be NULL if the module contains no such data.
+ */
+
+STATIC VOID UnlockExeCache(VOID)
+{
+    DosReleaseMutexSem(G_hmtxExeCache);
+}
+
+/*
+ *@@ GetIdentity:
+ *      fills the identity fields of *pId for the given
+ *      executable. Returns FALSE if the file can't be
+ *      identified, in which case it isn't cached.
+ */
+
+STATIC BOOL GetIdentity(PEXECUTABLE pExec,
+                        PEXECACHEENTRY pId)
+{
+    FILESTATUS3 fs3;
+
+    if (    (pExec)
+         && (pExec->pFile)
+         && (!DosQueryPathInfo(pExec->pFile->pszFilename,
+                               FIL_QUERYFULLNAME,
+                               pId->szFullName,
+                               sizeof(pId->szFullName)))
+         && (!DosQueryFileInfo(pExec->pFile->hf,
+                               FIL_STANDARD,
+                               &fs3,
+                               sizeof(fs3)))
+       )
+    {
+        pId->cbFile = fs3.cbFile;
+        pId->fdateLastWrite = fs3.fdateLastWrite;
+        pId->ftimeLastWrite = fs3.ftimeLastWrite;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/*
+ *@@ FindCacheEntry:
+ *      returns the cache slot for the file identified by
+ *      pId or NULL. If fNameOnly is TRUE, a slot for an
+ *      older version of the same file is returned too.
  *
- *@@added V0.9.9 (2001-03-11) [lafaix]
- *@@changed V0.9.9 (2001-04-03) [umoeller]: added tons of error checking, changed prototype to return APIRET
- *@@changed V0.9.9 (2001-04-05) [lafaix]: rewritten error checking code
- *@@changed V0.9.10 (2001-04-10) [lafaix]: added Win16 and Win386 support
- *@@changed V0.9.10 (2001-04-13) [lafaix]: removed 127 characters limit
- *@@changed V0.9.12 (2001-05-03) [umoeller]: adjusted for new NOSTUB support
+ *      Caller must hold the cache mutex.
  */
 
-APIRET exehQueryImportedModules(PEXECUTABLE pExec,
-                                PFSYSMODULE *ppaModules,    // out: modules array
-                                PULONG pcModules)           // out: array item count
+STATIC PEXECACHEENTRY FindCacheEntry(const EXECACHEENTRY *pId,
+                                     BOOL fNameOnly)
+{
+    ULONG ul;
+
+    for (ul = 0;
+         ul < EXE_CACHE_SLOTS;
+         ul++)
+    {
+        PEXECACHEENTRY p = &G_aExeCache[ul];
+        if (    (p->ulLastUsed)
+             && (!stricmp(p->szFullName, pId->szFullName))
+           )
+        {
+            if (    (fNameOnly)
+                 || (    (p->cbFile == pId->cbFile)
+                      && (!memcmp(&p->fdateLastWrite, &pId->fdateLastWrite, sizeof(FDATE)))
+                      && (!memcmp(&p->ftimeLastWrite, &pId->ftimeLastWrite, sizeof(FTIME)))
+                    )
+               )
+                return p;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ *@@ FreeCacheEntry:
+ *      frees the arrays of a cache slot and marks it free.
+ */
+
+STATIC VOID FreeCacheEntry(PEXECACHEENTRY p)
+{
+    ULONG ul;
+
+    for (ul = 0; ul < CACHED_KINDS; ul++)
+        FREE(p->apvArray[ul]);
+
+    memset(p, 0, sizeof(EXECACHEENTRY));
+}
+
+/*
+ *@@ CacheLookup:
+ *      if the array of the given kind is cached for the
+ *      file identified by pId, stores a copy of it in *ppv
+ *      and the item count in *pc and returns NO_ERROR.
+ *      Returns ERROR_FILE_NOT_FOUND if it's not cached.
+ */
+
+STATIC APIRET CacheLookup(const EXECACHEENTRY *pId,
+                          ULONG ulKind,         // in: CACHED_* index
+                          PVOID *ppv,
+                          PULONG pc)
+{
+    APIRET arc = ERROR_FILE_NOT_FOUND;
+
+    if (!LockExeCache())
+    {
+        PEXECACHEENTRY p;
+
+        if (    (p = FindCacheEntry(pId, FALSE))
+             && (p->afValid[ulKind])
+           )
+        {
+            ULONG   cb = p->acItems[ulKind] * G_acbCachedItem[ulKind];
+            PVOID   pv = NULL;
+
+            if (    (cb)
+                 && (!(pv = malloc(cb)))
+               )
+                arc = ERROR_NOT_ENOUGH_MEMORY;
+            else
+            {
+                if (cb)
+                    memcpy(pv, p->apvArray[ulKind], cb);
+                *ppv = pv;
+                *pc = p->acItems[ulKind];
+                p->ulLastUsed = ++G_ulExeCacheStamp;
+                arc = NO_ERROR;
+            }
+        }
+
+        UnlockExeCache();
+    }
+
+    return arc;
+}
+
+/*
+ *@@ CacheStore:
+ *      stores a copy of the given array in the cache for
+ *      the file identified by pId. This replaces any entry
+ *      for an older version of the file, or else the least
+ *      recently used one if the cache is full.
+ */
+
+STATIC VOID CacheStore(const EXECACHEENTRY *pId,
+                       ULONG ulKind,            // in: CACHED_* index
+                       const void *pv,
+                       ULONG c)
+{
+    ULONG   cb = c * G_acbCachedItem[ulKind];
+    PVOID   pvCopy = NULL;
+
+    if (cb)
+    {
+        if (!(pvCopy = malloc(cb)))
+            return;
+        memcpy(pvCopy, pv, cb);
+    }
+
+    if (!LockExeCache())
+    {
+        PEXECACHEENTRY p;
+
+        if (!(p = FindCacheEntry(pId, FALSE)))
+        {
+            if (p = FindCacheEntry(pId, TRUE))
+                // file has changed: drop what we had
+                FreeCacheEntry(p);
+            else
+            {
+                // take a free slot or the LRU one
+                ULONG ul;
+                p = &G_aExeCache[0];
+                for (ul = 1;
+                     ul < EXE_CACHE_SLOTS && p->ulLastUsed;
+                     ul++)
+                {
+                    if (G_aExeCache[ul].ulLastUsed < p->ulLastUsed)
+                        p = &G_aExeCache[ul];
+                }
+                FreeCacheEntry(p);
+            }
+
+            memcpy(p->szFullName, pId->szFullName, sizeof(p->szFullName));
+            p->cbFile = pId->cbFile;
+            p->fdateLastWrite = pId->fdateLastWrite;
+            p->ftimeLastWrite = pId->ftimeLastWrite;
+        }
+
+        FREE(p->apvArray[ulKind]);
+        p->apvArray[ulKind] = pvCopy;
+        p->acItems[ulKind] = c;
+        p->afValid[ulKind] = TRUE;
+        p->ulLastUsed = ++G_ulExeCacheStamp;
+
+        UnlockExeCache();
+    }
+    else
+        free(pvCopy);
+}
+
+/*
+ *@@ exehFlushCache:
+ *      empties the cache of parsed import, export and
+ *      resource directories. That cache is only a speed-up;
+ *      call this to release its memory, e.g. before
+ *      unloading the module.
+ */
+
+VOID exehFlushCache(VOID)
+{
+    if (!LockExeCache())
+    {
+        ULONG ul;
+        for (ul = 0; ul < EXE_CACHE_SLOTS; ul++)
+            FreeCacheEntry(&G_aExeCache[ul]);
+
+        UnlockExeCache();
+    }
+}
+
+/*
+ *@@ ParseImportedModules:
+ *      implementation for exehQueryImportedModules.
+ */
+
+STATIC APIRET ParseImportedModules(PEXECUTABLE pExec,
+                                   PFSYSMODULE *ppaModules,
+                                   PULONG pcModules)
 {
     if (    (pExec)
          && (    (pExec->ulOS == EXEOS_OS2)
@@ -1199,14 +1737,8 @@ APIRET exehQueryImportedModules(PEXECUTABLE pExec,
         ENSURE_BEGIN;
         ULONG       cModules = 0;
         PFSYSMODULE paModules = NULL;
+        EXEHCURSOR  cur;
         int i;
-        HFILE hfExe = pExec->pFile->hf;
-
-        ULONG ulNewHeaderOfs = 0;       // V0.9.12 (2001-05-03) [umoeller]
-
-        if (pExec->cbDosExeHeader)
-            // executable has DOS stub: V0.9.12 (2001-05-03) [umoeller]
-            ulNewHeaderOfs = pExec->DosExeHeader.ulNewHeaderOfs;
 
         if (pExec->ulExeFormat == EXEFORMAT_LX)
         {
@@ -1216,7 +1748,6 @@ APIRET exehQueryImportedModules(PEXECUTABLE pExec,
             if (cModules)
             {
                 ULONG   cb = sizeof(FSYSMODULE) * cModules; // V0.9.9 (2001-04-03) [umoeller]
-                ULONG   ulDummy;
 
                 paModules = (PFSYSMODULE)malloc(cb);
                 if (!paModules)
@@ -1224,24 +1755,22 @@ APIRET exehQueryImportedModules(PEXECUTABLE pExec,
 
                 memset(paModules, 0, cb);   // V0.9.9 (2001-04-03) [umoeller]
 
-                ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                          pExec->pLXHeader->ulImportModTblOfs
-                                            + ulNewHeaderOfs, // V0.9.12 (2001-05-03) [umoeller]
-                                          FILE_BEGIN,
-                                          &ulDummy));
+                ENSURE_SAFE(OpenTable(pExec,
+                                      pExec->pLXHeader->ulImportModTblOfs,
+                                      cModules,     // one length byte each at least
+                                      &cur));
 
                 for (i = 0; i < cModules; i++)
                 {
                     BYTE bLen = 0;
 
                     // reading the length of the module name
-                    ENSURE_SAFE(DosRead(hfExe, &bLen, 1, &ulDummy));
+                    ENSURE_SAFE(CurRead(&cur, &bLen, 1));
 
                     // reading the module name
-                    ENSURE_SAFE(DosRead(hfExe,
+                    ENSURE_SAFE(CurRead(&cur,
                                         paModules[i].achModuleName,
-                                        bLen,
-                                        &ulDummy));
+                                        bLen));
 
                     // module names are not null terminated, so we must
                     // do it now
@@ -1264,39 +1793,38 @@ APIRET exehQueryImportedModules(PEXECUTABLE pExec,
 
                 memset(paModules, 0, cb);   // V0.9.9 (2001-04-03) [umoeller]
 
+                // make sure the module reference table is in
+                ENSURE_SAFE(LoadTables(pExec,
+                                       pExec->pNEHeader->usModRefTblOfs,
+                                       sizeof(USHORT) * cModules));
+
                 for (i = 0; i < cModules; i ++)
                 {
                     BYTE bLen;
                     USHORT usOfs;
-                    ULONG ulDummy;
 
                     // the module reference table contains offsets
                     // relative to the import table; we hence read
                     // the offset in the module reference table, and
                     // then we read the name in the import table
 
-                    ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                              pExec->pNEHeader->usModRefTblOfs
-                                                + ulNewHeaderOfs // V0.9.12 (2001-05-03) [umoeller]
-                                                + sizeof(usOfs) * i,
-                                              FILE_BEGIN,
-                                              &ulDummy));
-
-                    ENSURE_SAFE(DosRead(hfExe, &usOfs, 2, &ulDummy));
+                    ENSURE_SAFE(CopyTable(pExec,
+                                          pExec->pNEHeader->usModRefTblOfs
+                                            + sizeof(usOfs) * i,
+                                          sizeof(usOfs),
+                                          &usOfs));
 
-                    ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                              pExec->pNEHeader->usImportTblOfs
-                                                + ulNewHeaderOfs // V0.9.12 (2001-05-03) [umoeller]
-                                                + usOfs,
-                                              FILE_BEGIN,
-                                              &ulDummy));
+                    ENSURE_SAFE(OpenTable(pExec,
+                                          pExec->pNEHeader->usImportTblOfs
+                                            + usOfs,
+                                          1,
+                                          &cur));
 
-                    ENSURE_SAFE(DosRead(hfExe, &bLen, 1, &ulDummy));
+                    ENSURE_SAFE(CurRead(&cur, &bLen, 1));
 
-                    ENSURE_SAFE(DosRead(hfExe,
+                    ENSURE_SAFE(CurRead(&cur,
                                         paModules[i].achModuleName,
-                                        bLen,
-                                        &ulDummy));
+                                        bLen));
 
                     paModules[i].achModuleName[bLen] = 0;
                 } // end for
@@ -1320,6 +1848,61 @@ APIRET exehQueryImportedModules(PEXECUTABLE pExec,
     ENSURE_OK;
 }
 
+/*
+ *@@ exehQueryImportedModules:
+ *      returns an array of FSYSMODULE structure describing all
+ *      imported modules.
+ *
+ *      *pcModules receives the # of items in the array (not the
+ *      array size!).  Use doshFreeImportedModules to clean up.
+ *
+ *      The array comes from the directory cache if the same
+ *      file has been parsed before and has not changed since.
+ *
+ *      This returns a standard OS/2 error code, which might be
+ *      any of the codes returned by doshReadAt.
+ *      In addition, this may return:
+ *
+ *      --  ERROR_NOT_ENOUGH_MEMORY
+ *
+ *      --  ERROR_INVALID_EXE_SIGNATURE: exe is in a format other
+ *          than LX or NE, which is not understood by this function.
+ *
+ *      --  ERROR_BAD_EXE_FORMAT: a table runs past the end of
+ *          the file.
+ *
+ *      Even if NO_ERROR is returned, the array pointer might still
+ *      be NULL if the module contains no such data.
+ *
+ *@@added V0.9.9 (2001-03-11) [lafaix]
+ *@@changed V0.9.9 (2001-04-03) [umoeller]: added tons of error checking, changed prototype to return APIRET
+ *@@changed V0.9.9 (2001-04-05) [lafaix]: rewritten error checking code
+ *@@changed V0.9.10 (2001-04-10) [lafaix]: added Win16 and Win386 support
+ *@@changed V0.9.10 (2001-04-13) [lafaix]: removed 127 characters limit
+ *@@changed V0.9.12 (2001-05-03) [umoeller]: adjusted for new NOSTUB support
+ */
+
+APIRET exehQueryImportedModules(PEXECUTABLE pExec,
+                                PFSYSMODULE *ppaModules,    // out: modules array
+                                PULONG pcModules)           // out: array item count
+{
+    APIRET          arc;
+    EXECACHEENTRY   Id;
+    BOOL            fId;
+
+    if (    (fId = GetIdentity(pExec, &Id))
+         && (!CacheLookup(&Id, CACHED_MODULES, (PVOID*)ppaModules, pcModules))
+       )
+        return NO_ERROR;
+
+    if (    (!(arc = ParseImportedModules(pExec, ppaModules, pcModules)))
+         && (fId)
+       )
+        CacheStore(&Id, CACHED_MODULES, *ppaModules, *pcModules);
+
+    return arc;
+}
+
 /*
  *@@ exehFreeImportedModules:
  *      frees resources allocated by exehQueryImportedModules.
@@ -1350,23 +1933,15 @@ STATIC APIRET ScanLXEntryTable(PEXECUTABLE pExec,
                                PFSYSFUNCTION paFunctions,
                                PULONG pcEntries)        // out: entry table entry count; ptr can be NULL
 {
-    ULONG  ulDummy;
     USHORT usOrdinal = 1,
            usCurrent = 0;
     int    i;
+    EXEHCURSOR cur;
 
-    ULONG ulNewHeaderOfs = 0; // V0.9.12 (2001-05-03) [umoeller]
-    HFILE hfExe = pExec->pFile->hf;
-
-    if (pExec->cbDosExeHeader)
-        // executable has DOS stub: V0.9.12 (2001-05-03) [umoeller]
-        ulNewHeaderOfs = pExec->DosExeHeader.ulNewHeaderOfs;
-
-    ENSURE(DosSetFilePtr(hfExe,
-                         pExec->pLXHeader->ulEntryTblOfs
-                           + ulNewHeaderOfs, // V0.9.12 (2001-05-03) [umoeller]
-                         FILE_BEGIN,
-                         &ulDummy));
+    ENSURE(OpenTable(pExec,
+                     pExec->pLXHeader->ulEntryTblOfs,
+                     1,
+                     &cur));
 
     while (TRUE)
     {
@@ -1374,13 +1949,13 @@ STATIC APIRET ScanLXEntryTable(PEXECUTABLE pExec,
                bType,
                bFlag;
 
-        ENSURE(DosRead(hfExe, &bCnt, 1, &ulDummy));
+        ENSURE(CurRead(&cur, &bCnt, 1));
 
         if (bCnt == 0)
             // end of the entry table
             break;
 
-        ENSURE(DosRead(hfExe, &bType, 1, &ulDummy));
+        ENSURE(CurRead(&cur, &bType, 1));
 
         switch (bType & 0x7F)
         {
@@ -1402,14 +1977,11 @@ STATIC APIRET ScanLXEntryTable(PEXECUTABLE pExec,
              */
 
             case 1:
-                ENSURE(DosSetFilePtr(hfExe,
-                                     sizeof(USHORT),
-                                     FILE_CURRENT,
-                                     &ulDummy));
+                ENSURE(CurSkip(&cur, sizeof(USHORT)));
 
                 for (i = 0; i < bCnt; i ++)
                 {
-                    ENSURE(DosRead(hfExe, &bFlag, 1, &ulDummy));
+                    ENSURE(CurRead(&cur, &bFlag, 1));
 
                     if (bFlag & 0x01)
                     {
@@ -1424,10 +1996,7 @@ STATIC APIRET ScanLXEntryTable(PEXECUTABLE pExec,
 
                     usOrdinal++;
 
-                    ENSURE(DosSetFilePtr(hfExe,
-                                         sizeof(USHORT),
-                                         FILE_CURRENT,
-                                         &ulDummy));
+                    ENSURE(CurSkip(&cur, sizeof(USHORT)));
 
                 } // end for
             break;
@@ -1441,14 +2010,11 @@ STATIC APIRET ScanLXEntryTable(PEXECUTABLE pExec,
              */
 
             case 2:
-                ENSURE(DosSetFilePtr(hfExe,
-                                     sizeof(USHORT),
-                                     FILE_CURRENT,
-                                     &ulDummy));
+                ENSURE(CurSkip(&cur, sizeof(USHORT)));
 
                 for (i = 0; i < bCnt; i ++)
                 {
-                    ENSURE(DosRead(hfExe, &bFlag, 1, &ulDummy));
+                    ENSURE(CurRead(&cur, &bFlag, 1));
 
                     if (bFlag & 0x01)
                     {
@@ -1463,10 +2029,7 @@ STATIC APIRET ScanLXEntryTable(PEXECUTABLE pExec,
 
                     usOrdinal++;
 
-                    ENSURE(DosSetFilePtr(hfExe,
-                                         sizeof(USHORT) + sizeof(USHORT),
-                                         FILE_CURRENT,
-                                         &ulDummy));
+                    ENSURE(CurSkip(&cur, sizeof(USHORT) + sizeof(USHORT)));
 
                 } // end for
             break;
@@ -1480,14 +2043,11 @@ STATIC APIRET ScanLXEntryTable(PEXECUTABLE pExec,
              */
 
             case 3:
-                ENSURE(DosSetFilePtr(hfExe,
-                                     sizeof(USHORT),
-                                     FILE_CURRENT,
-                                     &ulDummy));
+                ENSURE(CurSkip(&cur, sizeof(USHORT)));
 
                 for (i = 0; i < bCnt; i ++)
                 {
-                    ENSURE(DosRead(hfExe, &bFlag, 1, &ulDummy));
+                    ENSURE(CurRead(&cur, &bFlag, 1));
 
                     if (bFlag & 0x01)
                     {
@@ -1502,10 +2062,7 @@ STATIC APIRET ScanLXEntryTable(PEXECUTABLE pExec,
 
                     usOrdinal++;
 
-                    ENSURE(DosSetFilePtr(hfExe,
-                                         sizeof(ULONG),
-                                         FILE_CURRENT,
-                                         &ulDummy));
+                    ENSURE(CurSkip(&cur, sizeof(ULONG)));
                 } // end for
             break;
 
@@ -1518,17 +2075,11 @@ STATIC APIRET ScanLXEntryTable(PEXECUTABLE pExec,
              */
 
             case 4:
-                ENSURE(DosSetFilePtr(hfExe,
-                                     sizeof(USHORT),
-                                     FILE_CURRENT,
-                                     &ulDummy));
+                ENSURE(CurSkip(&cur, sizeof(USHORT)));
 
                 for (i = 0; i < bCnt; i ++)
                 {
-                    ENSURE(DosSetFilePtr(hfExe,
-                                         sizeof(BYTE) + sizeof(USHORT) + sizeof(ULONG),
-                                         FILE_CURRENT,
-                                         &ulDummy));
+                    ENSURE(CurSkip(&cur, sizeof(BYTE) + sizeof(USHORT) + sizeof(ULONG)));
 
                     if (paFunctions)
                     {
@@ -1591,23 +2142,15 @@ STATIC APIRET ScanNEEntryTable(PEXECUTABLE pExec,
                                PFSYSFUNCTION paFunctions,
                                PULONG pcEntries)        // out: entry table entry count; ptr can be NULL
 {
-    ULONG  ulDummy;
     USHORT usOrdinal = 1,
            usCurrent = 0;
     int    i;
+    EXEHCURSOR cur;
 
-    ULONG ulNewHeaderOfs = 0;
-    HFILE hfExe = pExec->pFile->hf;
-
-    if (pExec->cbDosExeHeader)
-        // executable has DOS stub: V0.9.12 (2001-05-03) [umoeller]
-        ulNewHeaderOfs = pExec->DosExeHeader.ulNewHeaderOfs;
-
-    ENSURE(DosSetFilePtr(hfExe,
-                         pExec->pNEHeader->usEntryTblOfs
-                           + ulNewHeaderOfs, // V0.9.12 (2001-05-03) [umoeller]
-                         FILE_BEGIN,
-                         &ulDummy));
+    ENSURE(OpenTable(pExec,
+                     pExec->pNEHeader->usEntryTblOfs,
+                     1,
+                     &cur));
 
     while (TRUE)
     {
@@ -1615,22 +2158,19 @@ STATIC APIRET ScanNEEntryTable(PEXECUTABLE pExec,
              bType,
              bFlag;
 
-        ENSURE(DosRead(hfExe, &bCnt, 1, &ulDummy));
+        ENSURE(CurRead(&cur, &bCnt, 1));
 
         if (bCnt == 0)
             // end of the entry table
             break;
 
-        ENSURE(DosRead(hfExe, &bType, 1, &ulDummy));
+        ENSURE(CurRead(&cur, &bType, 1));
 
         if (bType)
         {
             for (i = 0; i < bCnt; i++)
             {
-                ENSURE(DosRead(hfExe,
-                               &bFlag,
-                               1,
-                               &ulDummy));
+                ENSURE(CurRead(&cur, &bFlag, 1));
 
                 if (bFlag & 0x01)
                 {
@@ -1645,22 +2185,10 @@ STATIC APIRET ScanNEEntryTable(PEXECUTABLE pExec,
 
                 usOrdinal++;
 
-                if (bType == 0xFF)
-                {
-                    // moveable segment
-                    ENSURE(DosSetFilePtr(hfExe,
-                                         5,
-                                         FILE_CURRENT,
-                                         &ulDummy));
-                }
-                else
-                {
-                    // fixed segment or constant (0xFE)
-                    ENSURE(DosSetFilePtr(hfExe,
-                                         2,
-                                         FILE_CURRENT,
-                                         &ulDummy));
-                }
+                ENSURE(CurSkip(&cur,
+                               (bType == 0xFF)
+                                    ? 5     // moveable segment
+                                    : 2));  // fixed segment or constant (0xFE)
 
             } // end for
         }
@@ -1703,6 +2231,7 @@ STATIC int /*_Optlink*/ Compare(const void *key,
  *      entries names.
  *
  *      This functions works for both NE and LX executables.
+ *      An empty cursor (no such table) is not an error.
  *
  *@@added V0.9.9 (2001-03-30) [lafaix]
  *@@changed V0.9.9 (2001-04-02) [lafaix]: the first entry is special
@@ -1711,32 +2240,28 @@ STATIC int /*_Optlink*/ Compare(const void *key,
  *@@changed V0.9.9 (2001-04-05) [lafaix]: rewritten error checking code
  */
 
-STATIC APIRET ScanNameTable(PEXECUTABLE pExec,
+STATIC APIRET ScanNameTable(PEXEHCURSOR pCur,
                             ULONG cFunctions,
                             PFSYSFUNCTION paFunctions)
 {
-    ULONG   ulDummy;
-
     USHORT        usOrdinal;
     PFSYSFUNCTION pFunction;
-    HFILE hfExe = pExec->pFile->hf;
 
-    while (TRUE)
+    while (pCur->pb < pCur->pbEnd)
     {
-        BYTE   bLen;
-        CHAR   achName[256];
-        // int    i;
+        BYTE        bLen;
+        const BYTE  *pbName;
 
-        ENSURE(DosRead(hfExe, &bLen, 1, &ulDummy));
+        ENSURE(CurRead(pCur, &bLen, 1));
 
         if (bLen == 0)
             // end of the name table
             break;
 
-        ENSURE(DosRead(hfExe, &achName, bLen, &ulDummy));
-        achName[bLen] = 0;
+        pbName = pCur->pb;
+        ENSURE(CurSkip(pCur, bLen));
 
-        ENSURE(DosRead(hfExe, &usOrdinal, sizeof(USHORT), &ulDummy));
+        ENSURE(CurRead(pCur, &usOrdinal, sizeof(USHORT)));
 
         if ((pFunction = (PFSYSFUNCTION)bsearch(&usOrdinal,
                                                 paFunctions,
@@ -1745,8 +2270,9 @@ STATIC APIRET ScanNameTable(PEXECUTABLE pExec,
                                                 Compare)))
         {
             memcpy(pFunction->achFunctionName,
-                   achName,
-                   bLen+1);
+                   pbName,
+                   bLen);
+            pFunction->achFunctionName[bLen] = 0;
         }
     }
 
@@ -1754,41 +2280,13 @@ STATIC APIRET ScanNameTable(PEXECUTABLE pExec,
 }
 
 /*
- *@@ exehQueryExportedFunctions:
- *      returns an array of FSYSFUNCTION structure describing all
- *      exported functions.
- *
- *      *pcFunctions receives the # of items in the array (not the
- *      array size!).  Use doshFreeExportedFunctions to clean up.
- *
- *      Note that the returned array only contains entry for exported
- *      functions.  Empty export entries are _not_ included.
- *
- *      This returns a standard OS/2 error code, which might be
- *      any of the codes returned by DosSetFilePtr and DosRead.
- *      In addition, this may return:
- *
- *      --  ERROR_NOT_ENOUGH_MEMORY
- *
- *      --  ERROR_INVALID_EXE_SIGNATURE: exe is in a format other
- *          than LX or NE, which is not understood by this function.
- *
- *      --  If ERROR_INVALID_LIST_FORMAT is returned, the format of an
- *          export entry wasn't understood here.
- *
- *      Even if NO_ERROR is returned, the array pointer might still
- *      be NULL if the module contains no such data.
- *
- *@@added V0.9.9 (2001-03-11) [lafaix]
- *@@changed V0.9.9 (2001-04-03) [umoeller]: added tons of error checking, changed prototype to return APIRET
- *@@changed V0.9.9 (2001-04-05) [lafaix]: rewritten error checking code
- *@@changed V0.9.10 (2001-04-10) [lafaix]: added Win16 and Win386 support
- *@@changed V0.9.12 (2001-05-03) [umoeller]: adjusted for new NOSTUB support
+ *@@ ParseExportedFunctions:
+ *      implementation for exehQueryExportedFunctions.
  */
 
-APIRET exehQueryExportedFunctions(PEXECUTABLE pExec,
-                                  PFSYSFUNCTION *ppaFunctions,  // out: functions array
-                                  PULONG pcFunctions)           // out: array item count
+STATIC APIRET ParseExportedFunctions(PEXECUTABLE pExec,
+                                     PFSYSFUNCTION *ppaFunctions,
+                                     PULONG pcFunctions)
 {
     if (    (pExec)
          && (    (pExec->ulOS == EXEOS_OS2)
@@ -1800,15 +2298,7 @@ APIRET exehQueryExportedFunctions(PEXECUTABLE pExec,
         ENSURE_BEGIN;
         ULONG         cFunctions = 0;
         PFSYSFUNCTION paFunctions = NULL;
-
-        ULONG ulDummy;
-
-        HFILE hfExe = pExec->pFile->hf;
-        ULONG ulNewHeaderOfs = 0; // V0.9.12 (2001-05-03) [umoeller]
-
-        if (pExec->cbDosExeHeader)
-            // executable has DOS stub: V0.9.12 (2001-05-03) [umoeller]
-            ulNewHeaderOfs = pExec->DosExeHeader.ulNewHeaderOfs;
+        EXEHCURSOR    cur;
 
         if (pExec->ulExeFormat == EXEFORMAT_LX)
         {
@@ -1831,30 +2321,26 @@ APIRET exehQueryExportedFunctions(PEXECUTABLE pExec,
                 if (!paFunctions)
                     ENSURE_FAIL(ERROR_NOT_ENOUGH_MEMORY);
 
-                // we rescan the entry table (the cost is not as bad
-                // as it may seem, due to disk caching)
+                // we rescan the entry table (cheap, it's in
+                // memory now)
 
                 ENSURE_SAFE(ScanLXEntryTable(pExec, paFunctions, NULL));
 
                 // we now scan the resident name table entries
 
-                ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                          pExec->pLXHeader->ulResdNameTblOfs
-                                            + ulNewHeaderOfs, // V0.9.12 (2001-05-03) [umoeller]
-                                          FILE_BEGIN,
-                                          &ulDummy));
+                ENSURE_SAFE(OpenTable(pExec,
+                                      pExec->pLXHeader->ulResdNameTblOfs,
+                                      1,
+                                      &cur));
 
-                ENSURE_SAFE(ScanNameTable(pExec, cFunctions, paFunctions));
+                ENSURE_SAFE(ScanNameTable(&cur, cFunctions, paFunctions));
 
                 // we now scan the non-resident name table entries,
                 // whose offset is _from the begining of the file_
 
-                ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                          pExec->pLXHeader->ulNonResdNameTblOfs,
-                                          FILE_BEGIN,
-                                          &ulDummy));
+                ENSURE_SAFE(OpenNonResdNames(pExec, &cur));
 
-                ENSURE_SAFE(ScanNameTable(pExec, cFunctions, paFunctions));
+                ENSURE_SAFE(ScanNameTable(&cur, cFunctions, paFunctions));
             } // end if (cFunctions)
         }
         else if (pExec->ulExeFormat == EXEFORMAT_NE)
@@ -1872,37 +2358,30 @@ APIRET exehQueryExportedFunctions(PEXECUTABLE pExec,
 
             if (cFunctions)
             {
-                // USHORT usOrdinal = 1;
-                       // usCurrent = 0;
-
                 paFunctions = (PFSYSFUNCTION)malloc(sizeof(FSYSFUNCTION) * cFunctions);
                 if (!paFunctions)
                     ENSURE_FAIL(ERROR_NOT_ENOUGH_MEMORY);
 
-                // we rescan the entry table (the cost is not as bad
-                // as it may seem, due to disk caching)
+                // we rescan the entry table (cheap, it's in
+                // memory now)
 
                 ENSURE_SAFE(ScanNEEntryTable(pExec, paFunctions, NULL));
 
                 // we now scan the resident name table entries
 
-                ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                          pExec->pNEHeader->usResdNameTblOfs
-                                            + ulNewHeaderOfs, // V0.9.12 (2001-05-03) [umoeller]
-                                          FILE_BEGIN,
-                                          &ulDummy));
+                ENSURE_SAFE(OpenTable(pExec,
+                                      pExec->pNEHeader->usResdNameTblOfs,
+                                      1,
+                                      &cur));
 
-                ENSURE_SAFE(ScanNameTable(pExec, cFunctions, paFunctions));
+                ENSURE_SAFE(ScanNameTable(&cur, cFunctions, paFunctions));
 
                 // we now scan the non-resident name table entries,
                 // whose offset is _from the begining of the file_
 
-                ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                          pExec->pNEHeader->ulNonResdTblOfs,
-                                          FILE_BEGIN,
-                                          &ulDummy));
+                ENSURE_SAFE(OpenNonResdNames(pExec, &cur));
 
-                ENSURE_SAFE(ScanNameTable(pExec, cFunctions, paFunctions));
+                ENSURE_SAFE(ScanNameTable(&cur, cFunctions, paFunctions));
             }
         }
         else
@@ -1924,29 +2403,21 @@ APIRET exehQueryExportedFunctions(PEXECUTABLE pExec,
 }
 
 /*
- *@@ exehFreeExportedFunctions:
- *      frees resources allocated by exehQueryExportedFunctions.
+ *@@ exehQueryExportedFunctions:
+ *      returns an array of FSYSFUNCTION structure describing all
+ *      exported functions.
  *
- *@@added V0.9.9 (2001-03-11)
- */
-
-APIRET exehFreeExportedFunctions(PFSYSFUNCTION paFunctions)
-{
-    free(paFunctions);
-
-    return NO_ERROR;
-}
-
-/*
- *@@ exehQueryResources:
- *      returns an array of FSYSRESOURCE structures describing all
- *      available resources in the module.
+ *      *pcFunctions receives the # of items in the array (not the
+ *      array size!).  Use doshFreeExportedFunctions to clean up.
  *
- *      *pcResources receives the no. of items in the array
- *      (not the array size!). Use exehFreeResources to clean up.
+ *      Note that the returned array only contains entry for exported
+ *      functions.  Empty export entries are _not_ included.
+ *
+ *      The array comes from the directory cache if the same
+ *      file has been parsed before and has not changed since.
  *
  *      This returns a standard OS/2 error code, which might be
- *      any of the codes returned by DosSetFilePtr and DosRead.
+ *      any of the codes returned by doshReadAt.
  *      In addition, this may return:
  *
  *      --  ERROR_NOT_ENOUGH_MEMORY
@@ -1954,18 +2425,65 @@ APIRET exehFreeExportedFunctions(PFSYSFUNCTION paFunctions)
  *      --  ERROR_INVALID_EXE_SIGNATURE: exe is in a format other
  *          than LX or NE, which is not understood by this function.
  *
+ *      --  ERROR_BAD_EXE_FORMAT: a table runs past the end of
+ *          the file.
+ *
+ *      --  If ERROR_INVALID_LIST_FORMAT is returned, the format of an
+ *          export entry wasn't understood here.
+ *
  *      Even if NO_ERROR is returned, the array pointer might still
  *      be NULL if the module contains no such data.
  *
- *@@added V0.9.7 (2000-12-18) [lafaix]
+ *@@added V0.9.9 (2001-03-11) [lafaix]
  *@@changed V0.9.9 (2001-04-03) [umoeller]: added tons of error checking, changed prototype to return APIRET
+ *@@changed V0.9.9 (2001-04-05) [lafaix]: rewritten error checking code
  *@@changed V0.9.10 (2001-04-10) [lafaix]: added Win16 and Win386 support
  *@@changed V0.9.12 (2001-05-03) [umoeller]: adjusted for new NOSTUB support
  */
 
-APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
-                          PFSYSRESOURCE *ppaResources,   // out: res's array
-                          PULONG pcResources)    // out: array item count
+APIRET exehQueryExportedFunctions(PEXECUTABLE pExec,
+                                  PFSYSFUNCTION *ppaFunctions,  // out: functions array
+                                  PULONG pcFunctions)           // out: array item count
+{
+    APIRET          arc;
+    EXECACHEENTRY   Id;
+    BOOL            fId;
+
+    if (    (fId = GetIdentity(pExec, &Id))
+         && (!CacheLookup(&Id, CACHED_FUNCTIONS, (PVOID*)ppaFunctions, pcFunctions))
+       )
+        return NO_ERROR;
+
+    if (    (!(arc = ParseExportedFunctions(pExec, ppaFunctions, pcFunctions)))
+         && (fId)
+       )
+        CacheStore(&Id, CACHED_FUNCTIONS, *ppaFunctions, *pcFunctions);
+
+    return arc;
+}
+
+/*
+ *@@ exehFreeExportedFunctions:
+ *      frees resources allocated by exehQueryExportedFunctions.
+ *
+ *@@added V0.9.9 (2001-03-11)
+ */
+
+APIRET exehFreeExportedFunctions(PFSYSFUNCTION paFunctions)
+{
+    free(paFunctions);
+
+    return NO_ERROR;
+}
+
+/*
+ *@@ ParseResources:
+ *      implementation for exehQueryResources.
+ */
+
+STATIC APIRET ParseResources(PEXECUTABLE pExec,
+                             PFSYSRESOURCE *ppaResources,
+                             PULONG pcResources)
 {
     if (    (pExec)
          && (    (pExec->ulOS == EXEOS_OS2)
@@ -1977,13 +2495,7 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
         ENSURE_BEGIN;
         ULONG           cResources = 0;
         PFSYSRESOURCE   paResources = NULL;
-
-        HFILE hfExe = pExec->pFile->hf;
-        ULONG           ulNewHeaderOfs = 0; // V0.9.12 (2001-05-03) [umoeller]
-
-        if (pExec->cbDosExeHeader)
-            // executable has DOS stub: V0.9.12 (2001-05-03) [umoeller]
-            ulNewHeaderOfs = pExec->DosExeHeader.ulNewHeaderOfs;
+        EXEHCURSOR      cur;
 
         if (pExec->ulExeFormat == EXEFORMAT_LX)
         {
@@ -2013,9 +2525,7 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
                 #pragma pack() // V0.9.9 (2001-04-03) [umoeller]
 
                 ULONG cb = sizeof(FSYSRESOURCE) * cResources;
-                ULONG ulDummy;
                 int i;
-                ULONG ulCurOfs;
 
                 paResources = (PFSYSRESOURCE)malloc(cb);
                 if (!paResources)
@@ -2023,15 +2533,14 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
 
                 memset(paResources, 0, cb); // V0.9.9 (2001-04-03) [umoeller]
 
-                ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                          pLXHeader->ulResTblOfs
-                                            + ulNewHeaderOfs, // V0.9.12 (2001-05-03) [umoeller]
-                                          FILE_BEGIN,
-                                          &ulDummy));
+                ENSURE_SAFE(OpenTable(pExec,
+                                      pLXHeader->ulResTblOfs,
+                                      14 * cResources,
+                                      &cur));
 
                 for (i = 0; i < cResources; i++)
                 {
-                    ENSURE_SAFE(DosRead(hfExe, &rs, 14, &ulDummy));
+                    ENSURE_SAFE(CurRead(&cur, &rs, 14));
 
                     paResources[i].ulID = rs.name;
                     paResources[i].ulType = rs.type;
@@ -2044,17 +2553,15 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
 
                 for (i = 0; i < cResources; i++)
                 {
-                    ULONG ulOfsThis =   pLXHeader->ulObjTblOfs
-                                      + ulNewHeaderOfs // V0.9.12 (2001-05-03) [umoeller]
-                                      + (   sizeof(ot)
-                                          * (paResources[i].ulFlag - 1));
-
-                    ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                              ulOfsThis,
-                                              FILE_BEGIN,
-                                              &ulDummy));
+                    if (!paResources[i].ulFlag)
+                        ENSURE_SAFEFAIL(ERROR_BAD_EXE_FORMAT);
 
-                    ENSURE_SAFE(DosRead(hfExe, &ot, sizeof(ot), &ulDummy));
+                    ENSURE_SAFE(CopyTable(pExec,
+                                          pLXHeader->ulObjTblOfs
+                                            + (   sizeof(ot)
+                                                * (paResources[i].ulFlag - 1)),
+                                          sizeof(ot),
+                                          &ot));
 
                     paResources[i].ulFlag  = ((ot.o32_flags & OBJWRITE)
                                                     ? 0
@@ -2094,7 +2601,6 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
                     #pragma pack()
 
                     ULONG cb = sizeof(FSYSRESOURCE) * cResources;
-                    ULONG ulDummy;
                     int i;
 
                     paResources = (PFSYSRESOURCE)malloc(cb);
@@ -2105,35 +2611,33 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
 
                     // we first read the resources IDs and types
 
-                    ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                              pNEHeader->usResTblOfs
-                                                + ulNewHeaderOfs, // V0.9.12 (2001-05-03) [umoeller]
-                                              FILE_BEGIN,
-                                              &ulDummy));
+                    ENSURE_SAFE(OpenTable(pExec,
+                                          pNEHeader->usResTblOfs,
+                                          sizeof(rti) * cResources,
+                                          &cur));
 
                     for (i = 0; i < cResources; i++)
                     {
-                        ENSURE_SAFE(DosRead(hfExe, &rti, sizeof(rti), &ulDummy));
+                        ENSURE_SAFE(CurRead(&cur, &rti, sizeof(rti)));
 
                         paResources[i].ulID = rti.name;
                         paResources[i].ulType = rti.type;
                     }
 
-                    // we then read their sizes and flags
+                    // we then read their sizes and flags; the resource
+                    // segments are the last ones in the segment table
+
+                    ENSURE_SAFE(OpenTable(pExec,
+                                          pNEHeader->usSegTblOfs
+                                            + (sizeof(ns)
+                                            * (  pNEHeader->usSegTblEntries
+                                               - pNEHeader->usResSegmCount)),
+                                          sizeof(ns) * cResources,
+                                          &cur));
 
                     for (i = 0; i < cResources; i++)
                     {
-                        ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                                  ulNewHeaderOfs // V0.9.12 (2001-05-03) [umoeller]
-                                                    + pNEHeader->usSegTblOfs
-                                                    + (sizeof(ns)
-                                                    * (  pNEHeader->usSegTblEntries
-                                                       - pNEHeader->usResSegmCount
-                                                       + i)),
-                                                    FILE_BEGIN,
-                                                    &ulDummy));
-
-                        ENSURE_SAFE(DosRead(hfExe, &ns, sizeof(ns), &ulDummy));
+                        ENSURE_SAFE(CurRead(&cur, &ns, sizeof(ns)));
 
                         paResources[i].ulSize = ns.ns_cbseg;
 
@@ -2148,49 +2652,38 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
             {
                 // 16-bit Windows executable
                 USHORT usAlignShift;
-                ULONG  ulDummy;
 
-                ENSURE(DosSetFilePtr(hfExe,
-                                     pNEHeader->usResTblOfs
-                                       + ulNewHeaderOfs, // V0.9.12 (2001-05-03) [umoeller]
-                                     FILE_BEGIN,
-                                     &ulDummy));
+                ENSURE(OpenTable(pExec,
+                                 pNEHeader->usResTblOfs,
+                                 sizeof(usAlignShift),
+                                 &cur));
 
-                ENSURE(DosRead(hfExe,
+                ENSURE(CurRead(&cur,
                                &usAlignShift,
-                               sizeof(usAlignShift),
-                               &ulDummy));
+                               sizeof(usAlignShift)));
 
                 while (TRUE)
                 {
                     USHORT usTypeID;
                     USHORT usCount;
 
-                    ENSURE(DosRead(hfExe,
+                    ENSURE(CurRead(&cur,
                                    &usTypeID,
-                                   sizeof(usTypeID),
-                                   &ulDummy));
+                                   sizeof(usTypeID)));
 
                     if (usTypeID == 0)
                         break;
 
-                    ENSURE(DosRead(hfExe,
+                    ENSURE(CurRead(&cur,
                                    &usCount,
-                                   sizeof(usCount),
-                                   &ulDummy));
+                                   sizeof(usCount)));
 
-                    ENSURE(DosSetFilePtr(hfExe,
-                                         sizeof(ULONG),
-                                         FILE_CURRENT,
-                                         &ulDummy));
+                    ENSURE(CurSkip(&cur, sizeof(ULONG)));
 
                     cResources += usCount;
 
                     // first pass, skip NAMEINFO table
-                    ENSURE(DosSetFilePtr(hfExe,
-                                         usCount*6*sizeof(USHORT),
-                                         FILE_CURRENT,
-                                         &ulDummy));
+                    ENSURE(CurSkip(&cur, usCount*6*sizeof(USHORT)));
                 }
 
                 if (cResources)
@@ -2204,16 +2697,13 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
 
                     memset(paResources, 0, cb);
 
-                    ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                              pNEHeader->usResTblOfs
-                                                + ulNewHeaderOfs,
-                                              FILE_BEGIN,
-                                              &ulDummy));
-
-                    ENSURE_SAFE(DosRead(hfExe,
-                                        &usAlignShift,
-                                        sizeof(usAlignShift),
-                                        &ulDummy));
+                    // second pass over the same table, which
+                    // we know is complete now
+                    ENSURE_SAFE(OpenTable(pExec,
+                                          pNEHeader->usResTblOfs
+                                            + sizeof(usAlignShift),
+                                          0,
+                                          &cur));
 
                     while (TRUE)
                     {
@@ -2221,23 +2711,18 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
                         USHORT usCount;
                         int i;
 
-                        ENSURE_SAFE(DosRead(hfExe,
+                        ENSURE_SAFE(CurRead(&cur,
                                             &usTypeID,
-                                            sizeof(usTypeID),
-                                            &ulDummy));
+                                            sizeof(usTypeID)));
 
                         if (usTypeID == 0)
                             break;
 
-                        ENSURE_SAFE(DosRead(hfExe,
+                        ENSURE_SAFE(CurRead(&cur,
                                             &usCount,
-                                            sizeof(usCount),
-                                            &ulDummy));
+                                            sizeof(usCount)));
 
-                        ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                                  sizeof(ULONG),
-                                                  FILE_CURRENT,
-                                                  &ulDummy));
+                        ENSURE_SAFE(CurSkip(&cur, sizeof(ULONG)));
 
                         // second pass, read NAMEINFO table
                         for (i = 0; i < usCount; i++)
@@ -2246,28 +2731,19 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
                                    usFlags,
                                    usID;
 
-                            ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                                      sizeof(USHORT),
-                                                      FILE_CURRENT,
-                                                      &ulDummy));
+                            ENSURE_SAFE(CurSkip(&cur, sizeof(USHORT)));
 
-                            ENSURE_SAFE(DosRead(hfExe,
+                            ENSURE_SAFE(CurRead(&cur,
                                                 &usLength,
-                                                sizeof(USHORT),
-                                                &ulDummy));
-                            ENSURE_SAFE(DosRead(hfExe,
+                                                sizeof(USHORT)));
+                            ENSURE_SAFE(CurRead(&cur,
                                                 &usFlags,
-                                                sizeof(USHORT),
-                                                &ulDummy));
-                            ENSURE_SAFE(DosRead(hfExe,
+                                                sizeof(USHORT)));
+                            ENSURE_SAFE(CurRead(&cur,
                                                 &usID,
-                                                sizeof(USHORT),
-                                                &ulDummy));
+                                                sizeof(USHORT)));
 
-                            ENSURE_SAFE(DosSetFilePtr(hfExe,
-                                                      2*sizeof(USHORT),
-                                                      FILE_CURRENT,
-                                                      &ulDummy));
+                            ENSURE_SAFE(CurSkip(&cur, 2*sizeof(USHORT)));
 
                             // !!! strings ids and types not handled yet
                             // !!! 15th bit is used to denotes strings
@@ -2300,6 +2776,59 @@ APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
     ENSURE_OK;
 }
 
+/*
+ *@@ exehQueryResources:
+ *      returns an array of FSYSRESOURCE structures describing all
+ *      available resources in the module.
+ *
+ *      *pcResources receives the no. of items in the array
+ *      (not the array size!). Use exehFreeResources to clean up.
+ *
+ *      The array comes from the directory cache if the same
+ *      file has been parsed before and has not changed since.
+ *
+ *      This returns a standard OS/2 error code, which might be
+ *      any of the codes returned by doshReadAt.
+ *      In addition, this may return:
+ *
+ *      --  ERROR_NOT_ENOUGH_MEMORY
+ *
+ *      --  ERROR_INVALID_EXE_SIGNATURE: exe is in a format other
+ *          than LX or NE, which is not understood by this function.
+ *
+ *      --  ERROR_BAD_EXE_FORMAT: a table runs past the end of
+ *          the file.
+ *
+ *      Even if NO_ERROR is returned, the array pointer might still
+ *      be NULL if the module contains no such data.
+ *
+ *@@added V0.9.7 (2000-12-18) [lafaix]
+ *@@changed V0.9.9 (2001-04-03) [umoeller]: added tons of error checking, changed prototype to return APIRET
+ *@@changed V0.9.10 (2001-04-10) [lafaix]: added Win16 and Win386 support
+ *@@changed V0.9.12 (2001-05-03) [umoeller]: adjusted for new NOSTUB support
+ */
+
+APIRET exehQueryResources(PEXECUTABLE pExec,     // in: executable from exehOpen
+                          PFSYSRESOURCE *ppaResources,   // out: res's array
+                          PULONG pcResources)    // out: array item count
+{
+    APIRET          arc;
+    EXECACHEENTRY   Id;
+    BOOL            fId;
+
+    if (    (fId = GetIdentity(pExec, &Id))
+         && (!CacheLookup(&Id, CACHED_RESOURCES, (PVOID*)ppaResources, pcResources))
+       )
+        return NO_ERROR;
+
+    if (    (!(arc = ParseResources(pExec, ppaResources, pcResources)))
+         && (fId)
+       )
+        CacheStore(&Id, CACHED_RESOURCES, *ppaResources, *pcResources);
+
+    return arc;
+}
+
 /*
  *@@ exehFreeResources:
  *      frees resources allocated by exehQueryResources.
@@ -2347,6 +2876,9 @@ APIRET exehFreeResources(PFSYSRESOURCE paResources)
  *
  *      --  ERROR_NOT_ENOUGH_MEMORY
  *
+ *      --  ERROR_BAD_EXE_FORMAT: a table runs past the
+ *          end of the file.
+ *
  *      plus the error codes of doshReadAt.
  *
  *      Call exehFreeLXMaps to clean up explicitly, but
@@ -2372,25 +2904,20 @@ APIRET exehLoadLXMaps(PEXECUTABLE pExec)
         arc = ERROR_INVALID_EXE_SIGNATURE;
     else
     {
-        PXFILE pFile = pExec->pFile;
-        ULONG ulNewHeaderOfs = 0;
         ULONG cb;
 
-        if (pExec->cbDosExeHeader)
-            // executable has DOS stub: V0.9.12 (2001-05-03) [umoeller]
-            ulNewHeaderOfs = pExec->DosExeHeader.ulNewHeaderOfs;
+        // all three are in the loader section, which
+        // LoadTables reads in one go
 
         // resource table
         if (    (!(arc = doshAllocArray(pLXHeader->ulResTblCnt,
                                         sizeof(RESOURCETABLEENTRY),
                                         (PBYTE*)&pExec->pRsTbl,
                                         &cb)))
-             && (!(arc = doshReadAt(pFile,
-                                    pLXHeader->ulResTblOfs
-                                      + ulNewHeaderOfs,
-                                    &cb,
-                                    (PBYTE)pExec->pRsTbl,
-                                    DRFL_FAILIFLESS)))
+             && (!(arc = CopyTable(pExec,
+                                   pLXHeader->ulResTblOfs,
+                                   cb,
+                                   pExec->pRsTbl)))
             )
         {
             // object table
@@ -2398,12 +2925,10 @@ APIRET exehLoadLXMaps(PEXECUTABLE pExec)
                                             sizeof(OBJECTTABLEENTRY),
                                             (PBYTE*)&pExec->pObjTbl,
                                             &cb)))
-                 && (!(arc = doshReadAt(pFile,
-                                        pLXHeader->ulObjTblOfs
-                                          + ulNewHeaderOfs,
-                                        &cb,
-                                        (PBYTE)pExec->pObjTbl,
-                                        DRFL_FAILIFLESS)))
+                 && (!(arc = CopyTable(pExec,
+                                       pLXHeader->ulObjTblOfs,
+                                       cb,
+                                       pExec->pObjTbl)))
                )
             {
                 // object page table
@@ -2411,12 +2936,10 @@ APIRET exehLoadLXMaps(PEXECUTABLE pExec)
                                                 sizeof(OBJECTPAGETABLEENTRY),
                                                 (PBYTE*)&pExec->pObjPageTbl,
                                                 &cb)))
-                     && (!(arc = doshReadAt(pFile,
-                                            pLXHeader->ulObjPageTblOfs
-                                              + ulNewHeaderOfs,
-                                            &cb,
-                                            (PBYTE)pExec->pObjPageTbl,
-                                            DRFL_FAILIFLESS)))
+                     && (!(arc = CopyTable(pExec,
+                                           pLXHeader->ulObjPageTblOfs,
+                                           cb,
+                                           pExec->pObjPageTbl)))
                    )
                 {
                 }
@@ -3245,6 +3768,9 @@ APIRET exehLoadLXResource(PEXECUTABLE pExec,     // in: executable from exehOpen
  *
  *      --  ERROR_NOT_ENOUGH_MEMORY
  *
+ *      --  ERROR_BAD_EXE_FORMAT: a table runs past the
+ *          end of the file.
+ *
  *      plus the error codes of doshReadAt.
  *
  *      Call exehFreeNEMaps to clean up explicitly, but
@@ -3271,39 +3797,31 @@ APIRET exehLoadOS2NEMaps(PEXECUTABLE pExec)
         arc = ERROR_INVALID_EXE_SIGNATURE;
     else
     {
-        PXFILE pFile = pExec->pFile;
-        ULONG ulNewHeaderOfs = 0;
         ULONG cb;
 
-        if (pExec->cbDosExeHeader)
-            // executable has DOS stub: V0.9.12 (2001-05-03) [umoeller]
-            ulNewHeaderOfs = pExec->DosExeHeader.ulNewHeaderOfs;
-
         // resource table
         if (    (!(arc = doshAllocArray(pNEHeader->usResSegmCount,
                                         sizeof(OS2NERESTBLENTRY),
                                         (PBYTE*)&pExec->paOS2NEResTblEntry,
                                         &cb)))
-             && (!(arc = doshReadAt(pFile,
-                                    pNEHeader->usResTblOfs
-                                      + ulNewHeaderOfs,
-                                    &cb,
-                                    (PBYTE)pExec->paOS2NEResTblEntry,
-                                    DRFL_FAILIFLESS)))
+             && (!(arc = CopyTable(pExec,
+                                   pNEHeader->usResTblOfs,
+                                   cb,
+                                   pExec->paOS2NEResTblEntry)))
             )
         {
-            // resource segments
+            // resource segments, which come right before
+            // the resource table
             if (    (!(arc = doshAllocArray(pNEHeader->usResSegmCount,
                                             sizeof(OS2NESEGMENT),
                                             (PBYTE*)&pExec->paOS2NESegments,
                                             &cb)))
-                 && (!(arc = doshReadAt(pFile,
-                                        pNEHeader->usResTblOfs
-                                          + ulNewHeaderOfs
-                                          - cb,
-                                        &cb,
-                                        (PBYTE)pExec->paOS2NESegments,
-                                        DRFL_FAILIFLESS)))
+                 && (!(arc = (pNEHeader->usResTblOfs < cb)
+                                ? ERROR_BAD_EXE_FORMAT
+                                : CopyTable(pExec,
+                                            pNEHeader->usResTblOfs - cb,
+                                            cb,
+                                            pExec->paOS2NESegments)))
                 )
             {
             }
@@ -3473,7 +3991,7 @@ APIRET exehLoadOS2NEResource(PEXECUTABLE pExec,     // in: executable from exehO
  *      exehOpen.
  *
  *      This automaticall calls exehFreeLXMaps and
- *      exehFreeNEMaps.
+ *      exehFreeNEMaps and frees the loader tables.
  *
  *@@added V0.9.0 [umoeller]
  *@@changed V0.9.16 (2001-12-08) [umoeller]: fixed memory leaks
@@ -3508,11 +4026,14 @@ APIRET exehClose(PEXECUTABLE *ppExec)
         papsz[11]=&pExec->pszCountry;
         papsz[12]=&pExec->pszRevision;
         papsz[13]=&pExec->pszUnknown;
-        papsz[15]=&pExec->pszFixpak;
+        papsz[14]=&pExec->pszFixpak;
 
         exehFreeLXMaps(pExec);
         exehFreeNEMaps(pExec);
 
+        FREE(pExec->pbTables);
+        FREE(pExec->pbNonResdNames);
+
         // fixed the memory leaks with the missing fields,
         // turned this into a loop
         for (ul = 0;
@@ -502,6 +502,14 @@ VOID gpihDrawThickFrame(HPS hps,            // in: presentation space for output
  *      the center of the rectangle by usWidth so you can call this several
  *      times with different colors.
  *
+ *      All lines of one color are drawn with a single
+ *      GpiPolyLineDisjoint, so this costs two GpiSetColor
+ *      calls regardless of usWidth. The frames for the
+ *      different widths don't overlap (unless usWidth is
+ *      too large for prcl, which is handled), so this
+ *      paints the same pixels as drawing them one after
+ *      the other.
+ *
  *@@changed V0.9.0 [umoeller]: changed function prototype to have colors specified
  *@@changed V0.9.7 (2000-12-20) [umoeller]: now really using inclusive rectangle...
  *@@changed V1.0.0 (2002-08-24) [umoeller]: renamed, now modifying prcl on output
@@ -513,35 +521,64 @@ VOID gpihDraw3DFrame2(HPS hps,              // in: presentation space for output
                       LONG lColorLeft,      // in: color to use for left and top; e.g. SYSCLR_BUTTONLIGHT
                       LONG lColorRight)     // in: color to use for right and bottom; e.g. SYSCLR_BUTTONDARK
 {
-    USHORT us;
-    POINTL ptl1;
+    #define FRAMES_PER_CALL     8
 
-    for (us = 0;
-         us < usWidth;
-         us++)
+    POINTL  aptlLeft[FRAMES_PER_CALL * 4],
+            aptlRight[FRAMES_PER_CALL * 4];
+
+    while (usWidth)
     {
+        ULONG   cFrames = (usWidth < FRAMES_PER_CALL) ? usWidth : FRAMES_PER_CALL,
+                ul;
+
+        for (ul = 0;
+             ul < cFrames;
+             ul++)
+        {
+            PPOINTL pptlL = &aptlLeft[ul * 4],
+                    pptlR = &aptlRight[ul * 4];
+
+            if (    (ul)
+                 && (    (prcl->xLeft > prcl->xRight)
+                      || (prcl->yBottom > prcl->yTop)
+                    )
+               )
+            {
+                // usWidth is too large for prcl, so the frames
+                // start to overlap: paint those one by one
+                cFrames = ul;
+                break;
+            }
+
+            // left line, then top
+            pptlL[0].x = prcl->xLeft;
+            pptlL[0].y = prcl->yBottom;
+            pptlL[1].x = prcl->xLeft;
+            pptlL[1].y = prcl->yTop;     // V0.9.7 (2000-12-20) [umoeller]
+            pptlL[2] = pptlL[1];
+            pptlL[3].x = prcl->xRight;   // V0.9.7 (2000-12-20) [umoeller]
+            pptlL[3].y = prcl->yTop;
+
+            // right line, then bottom; these overpaint the
+            // top right and bottom left corners as before
+            pptlR[0] = pptlL[3];
+            pptlR[1].x = prcl->xRight;
+            pptlR[1].y = prcl->yBottom;
+            pptlR[2] = pptlR[1];
+            pptlR[3] = pptlL[0];
+
+            prcl->xLeft++;
+            prcl->yBottom++;
+            prcl->xRight--;
+            prcl->yTop--;
+        }
+
         GpiSetColor(hps, lColorLeft);
-        // draw left line
-        ptl1.x = prcl->xLeft;
-        ptl1.y = prcl->yBottom;
-        GpiMove(hps, &ptl1);
-        ptl1.y = prcl->yTop;     // V0.9.7 (2000-12-20) [umoeller]
-        GpiLine(hps, &ptl1);
-        // go right -> draw top
-        ptl1.x = prcl->xRight;   // V0.9.7 (2000-12-20) [umoeller]
-        GpiLine(hps, &ptl1);
-        // go down -> draw right
+        GpiPolyLineDisjoint(hps, cFrames * 4, aptlLeft);
         GpiSetColor(hps, lColorRight);
-        ptl1.y = prcl->yBottom;
-        GpiLine(hps, &ptl1);
-        // go left -> draw bottom
-        ptl1.x = prcl->xLeft;
-        GpiLine(hps, &ptl1);
+        GpiPolyLineDisjoint(hps, cFrames * 4, aptlRight);
 
-        prcl->xLeft++;
-        prcl->yBottom++;
-        prcl->xRight--;
-        prcl->yTop--;
+        usWidth -= cFrames;
     }
 }
 
@@ -564,6 +601,296 @@ VOID gpihDraw3DFrame(HPS hps,           // in: presentation space for output
     gpihDraw3DFrame2(hps, &rcl2, usWidth, lColorLeft, lColorRight);
 }
 
+/*
+ *@@ gpihBatchInit:
+ *      initializes a GPIHBATCH.
+ *
+ *      With a batch, callers which paint many small
+ *      boxes and frames (one per container record or
+ *      status bar field, say) can record them first with
+ *      gpihBatchBox, gpihBatchLine and gpihBatch3DFrame
+ *      and then paint them all with gpihBatchFlush, which
+ *      switches colors once per color instead of once per
+ *      primitive and draws runs of lines with one
+ *      GpiPolyLineDisjoint.
+ */
+
+VOID gpihBatchInit(PGPIHBATCH pBatch)
+{
+    memset(pBatch, 0, sizeof(GPIHBATCH));
+}
+
+/*
+ *@@ gpihBatchClear:
+ *      frees the memory of a GPIHBATCH without painting.
+ *      The batch can be reused afterwards.
+ */
+
+VOID gpihBatchClear(PGPIHBATCH pBatch)
+{
+    if (pBatch->paItems)
+        free(pBatch->paItems);
+    memset(pBatch, 0, sizeof(GPIHBATCH));
+}
+
+/*
+ *@@ AddBatchItem:
+ *
+ */
+
+STATIC BOOL AddBatchItem(PGPIHBATCH pBatch,
+                         LONG lColor,
+                         LONG lControl,
+                         LONG x1,
+                         LONG y1,
+                         LONG x2,
+                         LONG y2)
+{
+    PGPIHBATCHITEM pItem;
+
+    if (pBatch->cItems >= pBatch->cAllocated)
+    {
+        ULONG           cNew = (pBatch->cAllocated) ? pBatch->cAllocated * 2 : 64;
+        PGPIHBATCHITEM  paNew;
+
+        if (!(paNew = (PGPIHBATCHITEM)realloc(pBatch->paItems,
+                                              cNew * sizeof(GPIHBATCHITEM))))
+            return FALSE;
+
+        pBatch->paItems = paNew;
+        pBatch->cAllocated = cNew;
+    }
+
+    pItem = &pBatch->paItems[pBatch->cItems];
+    pItem->lColor = lColor;
+    pItem->lControl = lControl;
+    pItem->ulSeq = pBatch->cItems++;
+    pItem->ptl1.x = x1;
+    pItem->ptl1.y = y1;
+    pItem->ptl2.x = x2;
+    pItem->ptl2.y = y2;
+
+    return TRUE;
+}
+
+/*
+ *@@ gpihBatchBox:
+ *      records a gpihBox call with the given color
+ *      in pBatch.
+ *
+ *      Returns FALSE if we ran out of memory.
+ */
+
+BOOL gpihBatchBox(PGPIHBATCH pBatch,
+                  LONG lColor,          // in: RGB color
+                  LONG lControl,        // in: one of DRO_OUTLINE, DRO_FILL, DRO_OUTLINEFILL
+                  PRECTL prcl)          // in: rectangle to draw (inclusive)
+{
+    return AddBatchItem(pBatch,
+                        lColor,
+                        lControl,
+                        prcl->xLeft,
+                        prcl->yBottom,
+                        prcl->xRight,
+                        prcl->yTop);
+}
+
+/*
+ *@@ gpihBatchLine:
+ *      records a line from (x1, y1) to (x2, y2) with
+ *      the given color in pBatch.
+ *
+ *      Returns FALSE if we ran out of memory.
+ */
+
+BOOL gpihBatchLine(PGPIHBATCH pBatch,
+                   LONG lColor,         // in: RGB color
+                   LONG x1,
+                   LONG y1,
+                   LONG x2,
+                   LONG y2)
+{
+    return AddBatchItem(pBatch, lColor, 0, x1, y1, x2, y2);
+}
+
+/*
+ *@@ gpihBatch3DFrame:
+ *      records the lines of a gpihDraw3DFrame call in
+ *      pBatch. As with gpihDraw3DFrame, prcl is not
+ *      modified.
+ *
+ *      Since gpihBatchFlush paints by color and not in
+ *      the order of recording, the lines are recorded so
+ *      that no two of them share a pixel; the corners get
+ *      the same colors as with gpihDraw3DFrame.
+ *
+ *      Returns FALSE if we ran out of memory.
+ */
+
+BOOL gpihBatch3DFrame(PGPIHBATCH pBatch,
+                      PRECTL prcl,          // in: rectangle (inclusive)
+                      USHORT usWidth,       // in: line width (>= 1)
+                      LONG lColorLeft,      // in: color to use for left and top
+                      LONG lColorRight)     // in: color to use for right and bottom
+{
+    RECTL   rcl = *prcl;
+    BOOL    brc = TRUE;
+
+    while (    (brc)
+            && (usWidth--)
+            && (rcl.xLeft <= rcl.xRight)
+            && (rcl.yBottom <= rcl.yTop)
+          )
+    {
+        if (    (rcl.xRight > rcl.xLeft)
+             && (rcl.yTop > rcl.yBottom)
+           )
+        {
+            // left line without the bottom left corner
+            brc = AddBatchItem(pBatch, lColorLeft, 0,
+                               rcl.xLeft, rcl.yBottom + 1,
+                               rcl.xLeft, rcl.yTop);
+            // top line without the corners
+            if (    (brc)
+                 && (rcl.xRight - rcl.xLeft >= 2)
+               )
+                brc = AddBatchItem(pBatch, lColorLeft, 0,
+                                   rcl.xLeft + 1, rcl.yTop,
+                                   rcl.xRight - 1, rcl.yTop);
+        }
+
+        // right line with both corners
+        if (brc)
+            brc = AddBatchItem(pBatch, lColorRight, 0,
+                               rcl.xRight, rcl.yTop,
+                               rcl.xRight, rcl.yBottom);
+        // bottom line without the bottom right corner
+        if (    (brc)
+             && (rcl.xRight > rcl.xLeft)
+           )
+            brc = AddBatchItem(pBatch, lColorRight, 0,
+                               rcl.xRight - 1, rcl.yBottom,
+                               rcl.xLeft, rcl.yBottom);
+
+        rcl.xLeft++;
+        rcl.yBottom++;
+        rcl.xRight--;
+        rcl.yTop--;
+    }
+
+    return brc;
+}
+
+/*
+ *@@ CompareBatchItems:
+ *      qsort callback for gpihBatchFlush. Filled boxes
+ *      come first, then outlines and lines; within those,
+ *      items are sorted by color and then by the order
+ *      in which they were recorded.
+ */
+
+STATIC int CompareBatchItems(const void *p1, const void *p2)
+{
+    PGPIHBATCHITEM  pi1 = (PGPIHBATCHITEM)p1,
+                    pi2 = (PGPIHBATCHITEM)p2;
+    int             iPass1 = (pi1->lControl & DRO_FILL) ? 0 : 1,
+                    iPass2 = (pi2->lControl & DRO_FILL) ? 0 : 1;
+
+    if (iPass1 != iPass2)
+        return iPass1 - iPass2;
+    if (pi1->lColor != pi2->lColor)
+        return (pi1->lColor < pi2->lColor) ? -1 : 1;
+    if (pi1->ulSeq != pi2->ulSeq)
+        return (pi1->ulSeq < pi2->ulSeq) ? -1 : 1;
+    return 0;
+}
+
+/*
+ *@@ gpihBatchFlush:
+ *      paints everything recorded in pBatch and empties
+ *      it. The memory is kept for the next round; call
+ *      gpihBatchClear when done.
+ *
+ *      This does not paint in the order of recording:
+ *      all filled boxes are painted first, then all
+ *      outlines and lines, each group sorted by color.
+ *      Only batch primitives where that order does
+ *      not matter, e.g. item backgrounds and the frames
+ *      around them.
+ *
+ *      Preconditions:
+ *
+ *      --  The hps is assumed to be in RGB mode.
+ *
+ *      Post conditions:
+ *
+ *      --  The color and the current position are
+ *          undefined after the call.
+ */
+
+VOID gpihBatchFlush(HPS hps,
+                    PGPIHBATCH pBatch)
+{
+    #define LINE_POINTS         64
+
+    POINTL  aptl[LINE_POINTS];
+    ULONG   cPoints = 0,
+            ul;
+
+    if (!pBatch->cItems)
+        return;
+
+    qsort(pBatch->paItems,
+          pBatch->cItems,
+          sizeof(GPIHBATCHITEM),
+          CompareBatchItems);
+
+    for (ul = 0;
+         ul < pBatch->cItems;
+         ul++)
+    {
+        PGPIHBATCHITEM pItem = &pBatch->paItems[ul];
+
+        if (    (!ul)
+             || (pItem->lColor != pItem[-1].lColor)
+           )
+        {
+            // color changes: paint the lines of the
+            // previous color first
+            if (cPoints)
+            {
+                GpiPolyLineDisjoint(hps, cPoints, aptl);
+                cPoints = 0;
+            }
+            GpiSetColor(hps, pItem->lColor);
+        }
+
+        if (pItem->lControl)
+        {
+            GpiMove(hps, &pItem->ptl1);
+            GpiBox(hps,
+                   pItem->lControl,
+                   &pItem->ptl2,
+                   0, 0);
+        }
+        else
+        {
+            if (cPoints == LINE_POINTS)
+            {
+                GpiPolyLineDisjoint(hps, cPoints, aptl);
+                cPoints = 0;
+            }
+            aptl[cPoints++] = pItem->ptl1;
+            aptl[cPoints++] = pItem->ptl2;
+        }
+    }
+
+    if (cPoints)
+        GpiPolyLineDisjoint(hps, cPoints, aptl);
+
+    pBatch->cItems = 0;
+}
+
 /*
  *@@ gpihCharStringPosAt:
  *      wrapper for GpiCharStringPosAt.
@@ -40,6 +40,7 @@
 #define INCL_DOSSEMAPHORES
 #define INCL_DOSEXCEPTIONS
 #define INCL_DOSPROCESS
+#define INCL_DOSRESOURCES
 #define INCL_DOSERRORS
 #define INCL_WINSHELLDATA
 #include <os2.h>
@@ -86,6 +87,26 @@ static HMTX        G_hmtxStringsCache = NULLHANDLE;
 static TREE        *G_StringsCache;
 static LONG        G_cStringsInCache = 0;
 
+/*
+ *@@ STRINGTABLE:
+ *      contiguous table of all strings in the NLS module,
+ *      built by nlsPreloadStrings. This is a single memory
+ *      block: the offsets array is followed by the strings
+ *      themselves.
+ */
+
+typedef struct _STRINGTABLE
+{
+    ULONG       ulFirstID;          // string ID of aulOffsets[0]
+    ULONG       cIDs;               // items in aulOffsets
+    ULONG       aulOffsets[1];      // offset of each string from the start
+                                    // of this structure, or 0 if there is
+                                    // no such string; the struct is dynamic
+                                    // in size
+} STRINGTABLE, *PSTRINGTABLE;
+
+static PSTRINGTABLE volatile G_pStringTable = NULL;
+
 
 /*
  *@@ nlsReplaceEntities:
@@ -242,6 +263,13 @@ STATIC VOID Unload(VOID)
     // reset the tree to "empty"
     treeInit(&G_StringsCache,
              &G_cStringsInCache);
+
+    if (G_pStringTable)
+    {
+        PSTRINGTABLE pTable = G_pStringTable;
+        G_pStringTable = NULL;
+        free(pTable);
+    }
 }
 
 /*
@@ -263,7 +291,9 @@ VOID nlsInitStrings(HAB hab,                    // in: anchor block
     {
         if (fLocked = LockStrings())
         {
-            if (G_cStringsInCache)
+            if (    (G_cStringsInCache)
+                 || (G_pStringTable)
+               )
                 // not first call:
                 Unload();
 
@@ -279,6 +309,155 @@ VOID nlsInitStrings(HAB hab,                    // in: anchor block
         UnlockStrings();
 }
 
+/*
+ *@@ nlsPreloadStrings:
+ *      loads all strings from the module that was given to
+ *      nlsInitStrings at once, into a single table which is
+ *      indexed by string ID. After this, nlsGetString returns
+ *      those strings with an array lookup and without taking
+ *      the strings lock, which matters for programs that
+ *      call it very frequently from several threads.
+ *
+ *      This trades the on-demand loading described with
+ *      nlsGetString for speed, so it is optional. Strings
+ *      which are not in the table (e.g. because they were
+ *      added to the module later) still go through the
+ *      cache as before.
+ *
+ *      String tables are stored in bundles of 16 strings,
+ *      where bundle n holds the IDs (n - 1) * 16 up to
+ *      n * 16 - 1. We only check which bundles exist first,
+ *      so the table covers exactly the range of string IDs
+ *      that the module has.
+ *
+ *      Call this after nlsInitStrings, again each time.
+ */
+
+VOID nlsPreloadStrings(VOID)
+{
+    volatile BOOL   fLocked = FALSE;
+    PSZ             *papsz = NULL;
+    PULONG          paulLengths = NULL;
+    ULONG           cIDs = 0;
+
+    TRY_LOUD(excpt1)
+    {
+        if (fLocked = LockStrings())
+        {
+            ULONG   ulBundle,
+                    ulFirstBundle = 0,
+                    ulLastBundle = 0,
+                    cb;
+
+            for (ulBundle = 1;
+                 ulBundle <= 0x1000;
+                 ++ulBundle)
+            {
+                if (!DosQueryResourceSize(G_hmod,
+                                          RT_STRING,
+                                          ulBundle,
+                                          &cb))
+                {
+                    if (!ulFirstBundle)
+                        ulFirstBundle = ulBundle;
+                    ulLastBundle = ulBundle;
+                }
+            }
+
+            if (    (ulFirstBundle)
+                 && (cIDs = (ulLastBundle - ulFirstBundle + 1) * 16)
+                 && (papsz = (PSZ*)calloc(cIDs, sizeof(PSZ)))
+                 && (paulLengths = (PULONG)calloc(cIDs, sizeof(ULONG)))
+               )
+            {
+                ULONG           ulFirstID = (ulFirstBundle - 1) * 16,
+                                ul,
+                                cbTable = sizeof(STRINGTABLE) + (cIDs - 1) * sizeof(ULONG);
+                BOOL            fBundle = FALSE;
+                PSTRINGTABLE    pTable;
+
+                // load everything first so we know the total size
+                for (ul = 0;
+                     ul < cIDs;
+                     ++ul)
+                {
+                    CHAR    szBuf[500];
+
+                    if (!(ul % 16))
+                        fBundle = !DosQueryResourceSize(G_hmod,
+                                                        RT_STRING,
+                                                        ulFirstBundle + ul / 16,
+                                                        &cb);
+
+                    if (    (fBundle)
+                         && (WinLoadString(G_hab,
+                                           G_hmod,
+                                           ulFirstID + ul,
+                                           sizeof(szBuf),
+                                           szBuf))
+                       )
+                    {
+                        XSTRING str;
+                        xstrInitCopy(&str, szBuf, 0);
+                        nlsReplaceEntities(&str);
+                        papsz[ul] = str.psz;
+                        paulLengths[ul] = str.ulLength;
+                        cbTable += str.ulLength + 1;
+                    }
+                }
+
+                if (pTable = (PSTRINGTABLE)malloc(cbTable))
+                {
+                    ULONG ulOfs = sizeof(STRINGTABLE) + (cIDs - 1) * sizeof(ULONG);
+
+                    pTable->ulFirstID = ulFirstID;
+                    pTable->cIDs = cIDs;
+                    for (ul = 0;
+                         ul < cIDs;
+                         ++ul)
+                    {
+                        if (papsz[ul])
+                        {
+                            pTable->aulOffsets[ul] = ulOfs;
+                            memcpy((PBYTE)pTable + ulOfs,
+                                   papsz[ul],
+                                   paulLengths[ul] + 1);
+                            ulOfs += paulLengths[ul] + 1;
+                        }
+                        else
+                            pTable->aulOffsets[ul] = 0;
+                    }
+
+                    // the table is complete, so readers
+                    // may see it now
+                    if (G_pStringTable)
+                        free(G_pStringTable);
+                    G_pStringTable = pTable;
+                }
+            }
+        }
+    }
+    CATCH(excpt1) {} END_CATCH();
+
+    if (fLocked)
+        UnlockStrings();
+
+    if (papsz)
+    {
+        ULONG ul;
+        for (ul = 0;
+             ul < cIDs;
+             ++ul)
+        {
+            if (papsz[ul])
+                free(papsz[ul]);
+        }
+        free(papsz);
+    }
+    if (paulLengths)
+        free(paulLengths);
+}
+
 /*
  *@@ nlsGetString:
  *      returns a resource NLS string.
@@ -329,6 +508,10 @@ VOID nlsInitStrings(HAB hab,                    // in: anchor block
  *
  *      This never releases the strings again.
  *
+ *      If nlsPreloadStrings has been called, strings that
+ *      are in its table are returned from there directly,
+ *      without taking the lock.
+ *
  *      This never returns NULL. Even if loading the string failed,
  *      a string is returned; in that case, it's a meaningful error
  *      message specifying the ID that failed.
@@ -343,6 +526,16 @@ PCSZ nlsGetString(ULONG ulStringID)
 {
     volatile BOOL    fLocked = FALSE; // XWP V1.0.4 (2005-10-09) [pr]
     PSZ     pszReturn = "Error";
+    PSTRINGTABLE pTable;
+    ULONG   ulIndex;
+
+    if (    (pTable = G_pStringTable)
+         && ((ulIndex = ulStringID - pTable->ulFirstID) < pTable->cIDs)
+                // this wraps for IDs below ulFirstID
+         && (pTable->aulOffsets[ulIndex])
+       )
+        // preloaded:
+        return (PCSZ)pTable + pTable->aulOffsets[ulIndex];
 
     TRY_LOUD(excpt1)
     {
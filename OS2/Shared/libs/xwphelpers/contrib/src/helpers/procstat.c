@@ -52,6 +52,7 @@
 #define INCL_DOSMODULEMGR
 #define INCL_DOSERRORS
 #define INCL_DOSPROCESS
+#define INCL_DOSMISC
 #include <os2.h>
 
 #include <stdlib.h>      // already #include'd
@@ -833,3 +834,475 @@ void prc32KillProcessTree2(PQPROCESS32 pProcThis, ULONG pid)
     }
 }
 
+/*
+ *@@category: Helpers\Control program helpers\Process status\Process snapshots
+ */
+
+/********************************************************************
+ *
+ *   Process snapshots
+ *
+ ********************************************************************/
+
+/*
+ *@@ NextProcess:
+ *      returns the process record after pProcess.
+ *      The next process block comes after the
+ *      threads of this one.
+ */
+
+STATIC PQPROCESS32 NextProcess(PQPROCESS32 pProcess)
+{
+    return (PQPROCESS32)(pProcess->pThreads + pProcess->usThreadCount);
+}
+
+/*
+ *@@ ComparePIDs:
+ *      qsort callback for PRCSNAPSHOT.papProcesses.
+ */
+
+STATIC int ComparePIDs(const void *p1, const void *p2)
+{
+    return    (int)(*(PQPROCESS32*)p1)->usPID
+            - (int)(*(PQPROCESS32*)p2)->usPID;
+}
+
+/*
+ *@@ CompareNames:
+ *      qsort callback for PRCSNAPSHOT.paNames.
+ */
+
+STATIC int CompareNames(const void *p1, const void *p2)
+{
+    return stricmp(((PPRCNAMEINDEX)p1)->pcszName,
+                   ((PPRCNAMEINDEX)p2)->pcszName);
+}
+
+/*
+ *@@ CompareModules:
+ *      qsort callback for the module index
+ *      built by IndexSnapshot.
+ */
+
+STATIC int CompareModules(const void *p1, const void *p2)
+{
+    return    (int)(*(PQMODULE32*)p1)->usHModule
+            - (int)(*(PQMODULE32*)p2)->usHModule;
+}
+
+/*
+ *@@ CompareTimes:
+ *      qsort callback for PRCSNAPSHOT.paTimes.
+ */
+
+STATIC int CompareTimes(const void *p1, const void *p2)
+{
+    PPRCTHREADTIME  pt1 = (PPRCTHREADTIME)p1,
+                    pt2 = (PPRCTHREADTIME)p2;
+
+    if (pt1->usPID != pt2->usPID)
+        return (int)pt1->usPID - (int)pt2->usPID;
+    return (int)pt1->usTID - (int)pt2->usTID;
+}
+
+/*
+ *@@ FindOldTime:
+ *      returns the thread times from the previous
+ *      refresh for the given thread, or NULL if the
+ *      thread didn't exist then.
+ */
+
+STATIC PPRCTHREADTIME FindOldTime(PPRCSNAPSHOT pSnap,
+                                  USHORT usPID,
+                                  USHORT usTID)
+{
+    PRCTHREADTIME   Key;
+
+    Key.usPID = usPID;
+    Key.usTID = usTID;
+
+    if (!pSnap->paTimesOld)
+        return NULL;
+
+    return (PPRCTHREADTIME)bsearch(&Key,
+                                   pSnap->paTimesOld,
+                                   pSnap->cTimesOld,
+                                   sizeof(PRCTHREADTIME),
+                                   CompareTimes);
+}
+
+/*
+ *@@ ThreadDelta:
+ *      returns the CPU time the given thread used
+ *      since the previous refresh. A thread which
+ *      didn't exist then used all of its time since.
+ */
+
+STATIC ULONG ThreadDelta(PPRCSNAPSHOT pSnap,
+                         USHORT usPID,
+                         PQTHREAD32 pThread)
+{
+    ULONG           ulNow = pThread->ulSystime + pThread->ulUsertime;
+    PPRCTHREADTIME  pOld;
+
+    if (!pSnap->ulElapsed)
+        // first refresh: nothing to compare with
+        return 0;
+
+    if (pOld = FindOldTime(pSnap, usPID, pThread->usTID))
+    {
+        ULONG ulOld = pOld->ulSysTime + pOld->ulUserTime;
+        if (ulNow >= ulOld)
+            return ulNow - ulOld;
+        // else the TID was reused by a new thread
+    }
+
+    return ulNow;
+}
+
+/*
+ *@@ IndexSnapshot:
+ *      builds the PID, name and thread time
+ *      indices for the current pSnap->pInfo.
+ */
+
+STATIC APIRET IndexSnapshot(PPRCSNAPSHOT pSnap)
+{
+    PQPROCESS32     pProcThis;
+    PQMODULE32      pModule,
+                    *papModules = NULL;
+    ULONG           cProcesses = 0,
+                    cThreads = 0,
+                    cModules = 0,
+                    ul;
+
+    // count everything first
+    pProcThis = pSnap->pInfo->pProcessData;
+    while (pProcThis && pProcThis->ulRecType == 1)
+    {
+        cProcesses++;
+        cThreads += pProcThis->usThreadCount;
+        pProcThis = NextProcess(pProcThis);
+    }
+
+    for (pModule = pSnap->pInfo->pModuleData;
+         pModule;
+         pModule = pModule->pNext)
+        cModules++;
+
+    if (    (!(pSnap->papProcesses = (PQPROCESS32*)malloc((cProcesses + 1) * sizeof(PQPROCESS32))))
+         || (!(pSnap->paNames = (PPRCNAMEINDEX)malloc((cProcesses + 1) * sizeof(PRCNAMEINDEX))))
+         || (!(pSnap->paTimes = (PPRCTHREADTIME)malloc((cThreads + 1) * sizeof(PRCTHREADTIME))))
+         || (!(papModules = (PQMODULE32*)malloc((cModules + 1) * sizeof(PQMODULE32))))
+       )
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    // index the modules by handle so that finding the
+    // executable of each process is no longer a list walk
+    ul = 0;
+    for (pModule = pSnap->pInfo->pModuleData;
+         pModule;
+         pModule = pModule->pNext)
+        papModules[ul++] = pModule;
+    qsort(papModules, cModules, sizeof(PQMODULE32), CompareModules);
+
+    pSnap->ulTotalTime = 0;
+    pProcThis = pSnap->pInfo->pProcessData;
+    while (pProcThis && pProcThis->ulRecType == 1)
+    {
+        QMODULE32   ModKey;
+        PQMODULE32  pKey = &ModKey,
+                    *ppModule;
+        PQTHREAD32  pThread = pProcThis->pThreads;
+        PCSZ        pcszName = "";
+
+        ModKey.usHModule = pProcThis->usHModule;
+        if (    (ppModule = (PQMODULE32*)bsearch(&pKey,
+                                                 papModules,
+                                                 cModules,
+                                                 sizeof(PQMODULE32),
+                                                 CompareModules))
+             && ((*ppModule)->pcName)
+           )
+        {
+            // the module name is fully qualified, so use
+            // the file name (after the last backslash)
+            PCSZ pLastBackslash;
+            if (pLastBackslash = strrchr((*ppModule)->pcName, '\\'))
+                pcszName = pLastBackslash + 1;
+            else
+                pcszName = (*ppModule)->pcName;
+        }
+
+        pSnap->papProcesses[pSnap->cProcesses] = pProcThis;
+        pSnap->paNames[pSnap->cProcesses].pcszName = pcszName;
+        pSnap->paNames[pSnap->cProcesses].pProcess = pProcThis;
+        pSnap->cProcesses++;
+
+        for (ul = 0;
+             ul < pProcThis->usThreadCount;
+             ul++, pThread++)
+        {
+            PPRCTHREADTIME pTime = &pSnap->paTimes[pSnap->cTimes++];
+            pTime->usPID = pProcThis->usPID;
+            pTime->usTID = pThread->usTID;
+            pTime->ulSysTime = pThread->ulSystime;
+            pTime->ulUserTime = pThread->ulUsertime;
+
+            pSnap->ulTotalTime += ThreadDelta(pSnap,
+                                              pProcThis->usPID,
+                                              pThread);
+        }
+
+        pProcThis = NextProcess(pProcThis);
+    }
+
+    free(papModules);
+
+    qsort(pSnap->papProcesses, pSnap->cProcesses, sizeof(PQPROCESS32), ComparePIDs);
+    qsort(pSnap->paNames, pSnap->cProcesses, sizeof(PRCNAMEINDEX), CompareNames);
+    qsort(pSnap->paTimes, pSnap->cTimes, sizeof(PRCTHREADTIME), CompareTimes);
+
+    return NO_ERROR;
+}
+
+/*
+ *@@ prc32CreateSnapshot:
+ *      creates a process snapshot (see PRCSNAPSHOT)
+ *      and refreshes it for the first time.
+ *
+ *      fl are the QS32_* flags for DosQuerySysState;
+ *      QS32_PROCESS and QS32_MTE are always added,
+ *      since the indices need them.
+ *
+ *      prc32RefreshSnapshot will not query the system
+ *      again before ulMinAge milliseconds have passed,
+ *      so several users with their own timers can
+ *      share one snapshot cheaply.
+ *
+ *      Use prc32FreeSnapshot to free the snapshot.
+ */
+
+APIRET prc32CreateSnapshot(PPRCSNAPSHOT *ppSnap,    // out: new snapshot
+                           ULONG fl,                // in: QS32_* flags
+                           ULONG ulMinAge)          // in: minimum refresh interval (ms)
+{
+    APIRET          arc;
+    PPRCSNAPSHOT    pSnap;
+
+    if (!ppSnap)
+        return ERROR_INVALID_PARAMETER;
+
+    if (!(pSnap = (PPRCSNAPSHOT)malloc(sizeof(PRCSNAPSHOT))))
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    memset(pSnap, 0, sizeof(PRCSNAPSHOT));
+    pSnap->fl = fl | QS32_PROCESS | QS32_MTE;
+    pSnap->ulMinAge = ulMinAge;
+
+    if (arc = prc32RefreshSnapshot(pSnap, TRUE))
+        prc32FreeSnapshot(&pSnap);
+
+    *ppSnap = pSnap;
+
+    return arc;
+}
+
+/*
+ *@@ prc32RefreshSnapshot:
+ *      takes a new DosQuerySysState snapshot for pSnap
+ *      and rebuilds its indices, unless the last one
+ *      is younger than pSnap->ulMinAge milliseconds
+ *      and fForce is FALSE.
+ *
+ *      All pointers previously returned from the
+ *      snapshot become invalid if a new snapshot
+ *      was taken.
+ *
+ *      If DosQuerySysState fails, the old snapshot
+ *      is kept. If we run out of memory while indexing,
+ *      the snapshot is empty until the next successful
+ *      refresh.
+ */
+
+APIRET prc32RefreshSnapshot(PPRCSNAPSHOT pSnap,
+                            BOOL fForce)            // in: refresh even if not yet ulMinAge old
+{
+    APIRET          arc;
+    ULONG           ulNow = 0;
+    PQTOPLEVEL32    pInfo;
+
+    DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ulNow, sizeof(ulNow));
+
+    if (    (!fForce)
+         && (pSnap->pInfo)
+         && (ulNow - pSnap->ulTimestamp < pSnap->ulMinAge)
+       )
+        return NO_ERROR;
+
+    if (!(pInfo = prc32GetInfo2(pSnap->fl, &arc)))
+        return arc;
+
+    // the thread times of the snapshot we're replacing
+    // become the base for the CPU time deltas
+    if (pSnap->paTimesOld)
+        free(pSnap->paTimesOld);
+    pSnap->paTimesOld = pSnap->paTimes;
+    pSnap->cTimesOld = pSnap->cTimes;
+    pSnap->paTimes = NULL;
+    pSnap->cTimes = 0;
+
+    if (pSnap->papProcesses)
+        free(pSnap->papProcesses);
+    if (pSnap->paNames)
+        free(pSnap->paNames);
+    pSnap->papProcesses = NULL;
+    pSnap->paNames = NULL;
+    pSnap->cProcesses = 0;
+
+    if (pSnap->pInfo)
+    {
+        prc32FreeInfo(pSnap->pInfo);
+        pSnap->ulElapsed = ulNow - pSnap->ulTimestamp;
+        if (!pSnap->ulElapsed)
+            pSnap->ulElapsed = 1;
+    }
+    pSnap->pInfo = pInfo;
+    pSnap->ulTimestamp = ulNow;
+
+    if (arc = IndexSnapshot(pSnap))
+    {
+        if (pSnap->papProcesses)
+            free(pSnap->papProcesses);
+        if (pSnap->paNames)
+            free(pSnap->paNames);
+        if (pSnap->paTimes)
+            free(pSnap->paTimes);
+        pSnap->papProcesses = NULL;
+        pSnap->paNames = NULL;
+        pSnap->paTimes = NULL;
+        pSnap->cProcesses = 0;
+        pSnap->cTimes = 0;
+        prc32FreeInfo(pSnap->pInfo);
+        pSnap->pInfo = NULL;
+        pSnap->ulElapsed = 0;
+    }
+
+    return arc;
+}
+
+/*
+ *@@ prc32FreeSnapshot:
+ *      frees a snapshot created by prc32CreateSnapshot
+ *      and sets *ppSnap to NULL.
+ */
+
+VOID prc32FreeSnapshot(PPRCSNAPSHOT *ppSnap)
+{
+    PPRCSNAPSHOT pSnap;
+
+    if (ppSnap && (pSnap = *ppSnap))
+    {
+        if (pSnap->pInfo)
+            prc32FreeInfo(pSnap->pInfo);
+        if (pSnap->papProcesses)
+            free(pSnap->papProcesses);
+        if (pSnap->paNames)
+            free(pSnap->paNames);
+        if (pSnap->paTimes)
+            free(pSnap->paTimes);
+        if (pSnap->paTimesOld)
+            free(pSnap->paTimesOld);
+        free(pSnap);
+        *ppSnap = NULL;
+    }
+}
+
+/*
+ *@@ prc32SnapshotFromPID:
+ *      like prc32FindProcessFromPID, but with a
+ *      binary search on the snapshot's PID index.
+ */
+
+PQPROCESS32 prc32SnapshotFromPID(PPRCSNAPSHOT pSnap,
+                                 ULONG pid)
+{
+    ULONG   ulLow = 0,
+            ulHigh = pSnap->cProcesses;
+
+    while (ulLow < ulHigh)
+    {
+        ULONG       ulMid = ulLow + (ulHigh - ulLow) / 2;
+        PQPROCESS32 pProcess = pSnap->papProcesses[ulMid];
+
+        if (pProcess->usPID == pid)
+            return pProcess;
+        if (pProcess->usPID < pid)
+            ulLow = ulMid + 1;
+        else
+            ulHigh = ulMid;
+    }
+
+    return NULL;
+}
+
+/*
+ *@@ prc32SnapshotFromName:
+ *      like prc32FindProcessFromName, but with a
+ *      binary search on the snapshot's name index.
+ *      If several processes run the same executable,
+ *      any one of them is returned.
+ */
+
+PQPROCESS32 prc32SnapshotFromName(PPRCSNAPSHOT pSnap,
+                                  const char *pcszName) // in: e.g. "pmshell.exe"
+{
+    PRCNAMEINDEX    Key;
+    PPRCNAMEINDEX   pFound;
+
+    Key.pcszName = pcszName;
+
+    if (    (pSnap->paNames)
+         && (pFound = (PPRCNAMEINDEX)bsearch(&Key,
+                                             pSnap->paNames,
+                                             pSnap->cProcesses,
+                                             sizeof(PRCNAMEINDEX),
+                                             CompareNames))
+       )
+        return pFound->pProcess;
+
+    return NULL;
+}
+
+/*
+ *@@ prc32QuerySnapshotCPU:
+ *      returns the CPU time (system plus user, in the
+ *      units of QTHREAD32.ulSystime) that pThread of
+ *      pProcess used between the last two refreshes of
+ *      pSnap. If pThread is NULL, this returns the sum
+ *      for all threads of pProcess.
+ *
+ *      Divide this by pSnap->ulTotalTime to get the
+ *      share of the CPU. Returns 0 after the first
+ *      refresh since there is nothing to compare with
+ *      yet. Threads which ended in between are not
+ *      counted for the time they ran before ending.
+ */
+
+ULONG prc32QuerySnapshotCPU(PPRCSNAPSHOT pSnap,
+                            PQPROCESS32 pProcess,   // in: process from pSnap
+                            PQTHREAD32 pThread)     // in: thread of pProcess or NULL
+{
+    ULONG   ulTime = 0,
+            ul;
+
+    if (pThread)
+        return ThreadDelta(pSnap, pProcess->usPID, pThread);
+
+    for (ul = 0, pThread = pProcess->pThreads;
+         ul < pProcess->usThreadCount;
+         ul++, pThread++)
+        ulTime += ThreadDelta(pSnap, pProcess->usPID, pThread);
+
+    return ulTime;
+}
@@ -273,6 +273,84 @@ VOID txvInitFormat(PXFORMATDATA pxfd)
     xstrInit(&pxfd->strViewText, 0);
 }
 
+/*
+ *@@ ClearRectangles:
+ *      frees all rectangles in pxfd together with
+ *      their word lists and the rectangles array.
+ *      The words themselves are in pxfd->llWords
+ *      and are left alone.
+ */
+
+STATIC VOID ClearRectangles(PXFORMATDATA pxfd)
+{
+    PLISTNODE pNode = lstQueryFirstNode(&pxfd->llRectangles);
+    while (pNode)
+    {
+        PTXVRECTANGLE pRect = (PTXVRECTANGLE)pNode->pItemData;
+        lstClear(&pRect->llWords);
+        pNode = pNode->pNext;
+    }
+    lstClear(&pxfd->llRectangles);
+
+    if (pxfd->papRectangles)
+    {
+        free(pxfd->papRectangles);
+        pxfd->papRectangles = NULL;
+    }
+    pxfd->cRectangles = 0;
+}
+
+/*
+ *@@ IndexRectangles:
+ *      builds the rectangles array from the rectangles
+ *      list after formatting. If we run out of memory,
+ *      the array stays empty, and nothing is painted.
+ */
+
+STATIC VOID IndexRectangles(PXFORMATDATA pxfd)
+{
+    ULONG cRects = lstCountItems(&pxfd->llRectangles);
+
+    if (    (cRects)
+         && (pxfd->papRectangles = (PTXVRECTANGLE*)malloc(cRects * sizeof(PTXVRECTANGLE)))
+       )
+    {
+        PLISTNODE pNode = lstQueryFirstNode(&pxfd->llRectangles);
+        while (pNode)
+        {
+            pxfd->papRectangles[pxfd->cRectangles++] = (PTXVRECTANGLE)pNode->pItemData;
+            pNode = pNode->pNext;
+        }
+    }
+}
+
+/*
+ *@@ FindFirstRectangleBelow:
+ *      returns the index of the first rectangle whose
+ *      bottom is at or below lY, or pxfd->cRectangles
+ *      if there is none. Rectangles run from top to
+ *      bottom, so their y coordinates only decrease
+ *      and we can use a binary search.
+ */
+
+STATIC ULONG FindFirstRectangleBelow(PXFORMATDATA pxfd,
+                                     LONG lY)
+{
+    ULONG   ulLow = 0,
+            ulHigh = pxfd->cRectangles;
+
+    while (ulLow < ulHigh)
+    {
+        ULONG ulMid = ulLow + (ulHigh - ulLow) / 2;
+        if (pxfd->papRectangles[ulMid]->rcl.yBottom > lY)
+            ulLow = ulMid + 1;
+        else
+            ulHigh = ulMid;
+    }
+
+    return ulLow;
+}
+
 /*
  *@@ SetSubFont:
  *
@@ -1114,7 +1192,7 @@ VOID txvFormatText(HPS hps,             // in: HPS whose font is used for
     /* ULONG   ulWinCX = (prclView->xRight - prclView->xLeft),
             ulWinCY = (prclView->yTop - prclView->yBottom); */
 
-    lstClear(&pxfd->llRectangles);
+    ClearRectangles(pxfd);
     if (fFullRecalc)
         lstClear(&pxfd->llWords);
 
@@ -1343,7 +1421,6 @@ VOID txvFormatText(HPS hps,             // in: HPS whose font is used for
                                 // store word in rectangle
                                 pWordThis->pRectangle = pRect;
                                 lstAppendItem(&pRect->llWords, pWordThis);
-                                            // @@todo memory leak right here!!!
                                 ulWordsInThisRect++;
 
                                 // store highest word width found for this rect
@@ -1429,6 +1506,8 @@ VOID txvFormatText(HPS hps,             // in: HPS whose font is used for
             }
         }
     }
+
+    IndexRectangles(pxfd);
 }
 
 /* ******************************************************************
@@ -1504,7 +1583,10 @@ STATIC VOID DrawListMarker(HPS hps,
  *      been formatted (using txvFormatText).
  *
  *      This only paints rectangles which are within
- *      prcl2Paint.
+ *      prcl2Paint. The first of those is found with a
+ *      binary search over XFORMATDATA.papRectangles,
+ *      so painting near the end of a long text costs
+ *      no more than painting its first page.
  *
  *      --  For WM_PAINT, set this to the
  *          update rectangle, and set fPaintHalfLines
@@ -1538,15 +1620,23 @@ BOOL txvPaintText(HAB hab,
             fAnyLinesPainted = FALSE;
     ULONG   ulCurrentLineIndex = *pulLineIndex;
     // LONG    lViewYOfsSaved = *plViewYOfs;
-    PLISTNODE pRectNode = lstNodeFromIndex(&pxfd->llRectangles,
-                                           ulCurrentLineIndex);
 
     LONG    lcidLast = -99;
     LONG    lPointSizeLast = -99;
 
-    while (pRectNode)
+    if (prcl2Paint)
     {
-        PTXVRECTANGLE   pLineRcl = (PTXVRECTANGLE)pRectNode->pItemData;
+        // skip all lines above the update rectangle; these
+        // have their bottom above prcl2Paint->yTop
+        ULONG ulFirstVisible = FindFirstRectangleBelow(pxfd,
+                                                       prcl2Paint->yTop - *plViewYOfs);
+        if (ulFirstVisible > ulCurrentLineIndex)
+            ulCurrentLineIndex = ulFirstVisible;
+    }
+
+    while (ulCurrentLineIndex < pxfd->cRectangles)
+    {
+        PTXVRECTANGLE   pLineRcl = pxfd->papRectangles[ulCurrentLineIndex];
         BOOL            fPaintThis = FALSE;
 
         // compose rectangle to draw for this line
@@ -1708,10 +1798,10 @@ BOOL txvPaintText(HAB hab,
                             ulCurrentLineIndex, rclLine.xLeft, rclLine.yBottom)); */
 
                 *pulLineIndex = ulCurrentLineIndex;
-                if (pRectNode->pNext)
+                if (ulCurrentLineIndex + 1 < pxfd->cRectangles)
                 {
                     // another line to paint:
-                    PTXVRECTANGLE   pLineRcl2 = (PTXVRECTANGLE)pRectNode->pNext->pItemData;
+                    PTXVRECTANGLE   pLineRcl2 = pxfd->papRectangles[ulCurrentLineIndex + 1];
                     // return TRUE
                     brc = TRUE;
                     // and set *plViewYOfs to the top of
@@ -1726,8 +1816,6 @@ BOOL txvPaintText(HAB hab,
         }
 
         // next line
-        pRectNode = pRectNode->pNext;
-        // raise index to return
         ulCurrentLineIndex++;
     }
 
@@ -1751,10 +1839,15 @@ PLISTNODE txvFindWordFromPoint(PXFORMATDATA pxfd,
 {
     PLISTNODE pWordNodeFound = NULL;
 
-    PLISTNODE pRectangleNode = lstQueryFirstNode(&pxfd->llRectangles);
-    while ((pRectangleNode) && (!pWordNodeFound))
+    // rectangles above the point have their bottom above it
+    ULONG ul = FindFirstRectangleBelow(pxfd, pptl->y);
+    while ((ul < pxfd->cRectangles) && (!pWordNodeFound))
     {
-        PTXVRECTANGLE prclThis = (PTXVRECTANGLE)pRectangleNode->pItemData;
+        PTXVRECTANGLE prclThis = pxfd->papRectangles[ul];
+        if (prclThis->rcl.yTop < pptl->y)
+            // this and all following lines are below the point
+            break;
+
         if (    (pptl->x >= prclThis->rcl.xLeft)
              && (pptl->x <= prclThis->rcl.xRight)
              && (pptl->y >= prclThis->rcl.yBottom)
@@ -1778,7 +1871,7 @@ PLISTNODE txvFindWordFromPoint(PXFORMATDATA pxfd,
                 pWordNode = pWordNode->pNext;
             }
         }
-        pRectangleNode = pRectangleNode->pNext;
+        ul++;
     }
 
     return pWordNodeFound;
@@ -3011,7 +3104,7 @@ STATIC MRESULT ProcessDestroy(HWND hwndTextView, MPARAM mp1, MPARAM mp2)
     {
         xstrClear(&ptxvd->xfd.strViewText);
         xstrClear(&ptxvd->xfd.strOrigText);  // WarpIN V1.0.18
-        lstClear(&ptxvd->xfd.llRectangles);
+        ClearRectangles(&ptxvd->xfd);
         lstClear(&ptxvd->xfd.llWords);
         GpiDestroyPS(ptxvd->hps);
         free(ptxvd);
@@ -3987,6 +4080,10 @@ BOOL txvPrint(HAB hab,
 
     prthEndDoc(hdc, hps);
 
+    ClearRectangles(&xfd);
+    lstClear(&xfd.llWords);
+    xstrClear(&xfd.strViewText);
+
     return TRUE;
 }
 
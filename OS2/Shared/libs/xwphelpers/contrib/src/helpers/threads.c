@@ -52,6 +52,7 @@
 
 #include "helpers/linklist.h"
 #include "helpers/threads.h"
+#include "helpers/vector.h"
 
 #pragma hdrstop
 
@@ -66,8 +67,8 @@
  *
  ********************************************************************/
 
-LINKLIST        G_llThreadInfos;
-            // linked list of all THREADINFOS ever created...
+VECTOR          G_vecThreadInfos;
+            // array of all THREADINFOS ever created...
             // no auto-free
 HMTX            G_hmtxThreadInfos = NULLHANDLE;
 
@@ -94,7 +95,7 @@ STATIC BOOL LockThreadInfos(VOID)
                                 &G_hmtxThreadInfos,
                                 0,        // unshared
                                 TRUE);    // request!
-        lstInit(&G_llThreadInfos, FALSE);
+        vecInit(&G_vecThreadInfos, FALSE);
     }
     else
         arc = DosRequestMutexSem(G_hmtxThreadInfos,
@@ -173,7 +174,7 @@ STATIC VOID _Optlink thr_fntGeneric(PVOID ptiMyself)
         // remove thread from global list
         if (LockThreadInfos())
         {
-            lstRemoveItem(&G_llThreadInfos, pti);
+            vecRemoveItem(&G_vecThreadInfos, pti);
             UnlockThreadInfos();
         }
 
@@ -375,7 +376,7 @@ ULONG thrCreate(PTHREADINFO pti,     // out: THREADINFO data
             {
                 if (LockThreadInfos())
                 {
-                    lstAppendItem(&G_llThreadInfos, pti);
+                    vecAppend(&G_vecThreadInfos, pti);
                     UnlockThreadInfos();
                 }
 
@@ -504,22 +505,14 @@ PTHREADINFO thrListThreads(PULONG pcThreads)
 
     if (LockThreadInfos())
     {
-        PTHREADINFO pThis;
-        PLISTNODE pNode;
-        *pcThreads = lstCountItems(&G_llThreadInfos);
+        ULONG ul;
+        *pcThreads = G_vecThreadInfos.ulCount;
         if (pArray = (PTHREADINFO)malloc(*pcThreads * sizeof(THREADINFO)))
         {
-            pThis = pArray;
-
-            pNode = lstQueryFirstNode(&G_llThreadInfos);
-            while (pNode)
-            {
-                memcpy(pThis,
-                       (PTHREADINFO)pNode->pItemData,
+            for (ul = 0; ul < *pcThreads; ul++)
+                memcpy(&pArray[ul],
+                       (PTHREADINFO)VEC_ITEM(&G_vecThreadInfos, ul),
                        sizeof(THREADINFO));
-                pThis++;
-                pNode = pNode->pNext;
-            }
         }
 
         UnlockThreadInfos();
@@ -543,17 +536,16 @@ BOOL thrFindThread(PTHREADINFO pti,
     BOOL brc = FALSE;
     if (LockThreadInfos())
     {
-        PLISTNODE pNode = lstQueryFirstNode(&G_llThreadInfos);
-        while (pNode)
+        ULONG ul;
+        for (ul = 0; ul < G_vecThreadInfos.ulCount; ul++)
         {
-            PTHREADINFO ptiThis = (PTHREADINFO)pNode->pItemData;
+            PTHREADINFO ptiThis = (PTHREADINFO)VEC_ITEM(&G_vecThreadInfos, ul);
             if (ptiThis->tid == tid)
             {
                 memcpy(pti, ptiThis, sizeof(THREADINFO));
                 brc = TRUE;
                 break;
             }
-            pNode = pNode->pNext;
         }
 
         UnlockThreadInfos();
@@ -241,6 +241,33 @@ STATIC VOID RemoveTimer(PXTIMERSET pSet,       // in: timer set (from tmrCreateS
     }
 }
 
+/*
+ *@@ NextFireTime:
+ *      returns the time at which a timer with the given
+ *      timeout should fire next.
+ *
+ *      Timers fire on multiples of their timeout (counted
+ *      from system boot), not at the time they were last
+ *      fired plus the timeout. This way all timers with
+ *      the same timeout (or with timeouts that are
+ *      multiples of each other) fire on the same tick of
+ *      the PM master timer, so that their owners update
+ *      and repaint together instead of on separate ticks,
+ *      and late ticks don't make the timers drift.
+ *
+ *      The next time is at least half a timeout away so
+ *      that a late tick or a newly started timer does not
+ *      fire twice in quick succession.
+ *
+ *      Internal function.
+ */
+
+STATIC ULONG NextFireTime(ULONG ulTimeNow,
+                          ULONG ulTimeout)
+{
+    return ((ulTimeNow + ulTimeout / 2) / ulTimeout + 1) * ulTimeout;
+}
+
 /*
  *@@ AdjustPMTimer:
  *      goes thru all XTimers in the sets and starts
@@ -557,7 +584,8 @@ VOID tmrTimerTick(PXTIMERSET pSet)      // in: timer set (from tmrCreateSet)
                                                                        QWP_PFNWP);
 
                                 // moved this up V0.9.14 (2001-08-01) [umoeller]
-                                pTimer->ulNextFire = ulTimeNow + pTimer->ulTimeout;
+                                pTimer->ulNextFire = NextFireTime(ulTimeNow,
+                                                                  pTimer->ulTimeout);
 
                                 // call the window proc DIRECTLY
                                 // V0.9.16 (2001-12-18) [umoeller]:
@@ -658,6 +686,10 @@ VOID tmrTimerTick(PXTIMERSET pSet)      // in: timer set (from tmrCreateSet)
  *      the master timer to be set to 25, which is
  *      overkill.
  *
+ *      The timer first fires between one half and one and
+ *      a half timeouts from now, aligned with the other
+ *      timers of the set; see NextFireTime.
+ *
  *@@changed V0.9.7 (2000-12-08) [umoeller]: got rid of dtGetULongTime
  *@@changed V0.9.12 (2001-05-12) [umoeller]: added mutex protection
  *@@changed V0.9.14 (2001-07-12) [umoeller]: now rounding freq's to multiples of 25
@@ -705,7 +737,7 @@ USHORT XWPENTRY tmrStartXTimer(PXTIMERSET pSet, // in: timer set (from tmrCreate
                                    usTimerID))
             {
                 // exists already: reset only
-                pTimer->ulNextFire = ulTimeNow + ulTimeout;
+                pTimer->ulNextFire = NextFireTime(ulTimeNow, ulTimeout);
                 usrc = usTimerID;
             }
             else
@@ -716,7 +748,7 @@ USHORT XWPENTRY tmrStartXTimer(PXTIMERSET pSet, // in: timer set (from tmrCreate
                     pTimer->usTimerID = usTimerID;
                     pTimer->hwndTarget = hwnd;
                     pTimer->ulTimeout = ulTimeout;
-                    pTimer->ulNextFire = ulTimeNow + ulTimeout;
+                    pTimer->ulNextFire = NextFireTime(ulTimeNow, ulTimeout);
 
                     lstAppendItem(pllXTimers,
                                   pTimer);
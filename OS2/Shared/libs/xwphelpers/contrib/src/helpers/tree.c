@@ -579,11 +579,17 @@ int treeInsert(TREE **root,                     // in: root of the tree
 
 /*
  *@@ deleteFixup:
+ *      private function during rebalancing.
  *
+ *      tree is the node which took the place of the
+ *      removed one and may be LEAF, so its parent is
+ *      passed separately; we cannot store it in the
+ *      sentinel, which is shared by all trees.
  */
 
 STATIC void deleteFixup(TREE **root,
-                        TREE *tree)
+                        TREE *tree,
+                        TREE *parent)
 {
     TREE    *s;
 
@@ -591,22 +597,23 @@ STATIC void deleteFixup(TREE **root,
             && tree->color == BLACK
           )
     {
-        if (tree == tree->parent->left)
+        if (tree == parent->left)
         {
-            s = tree->parent->right;
+            s = parent->right;
             if (s->color == RED)
             {
                 s->color = BLACK;
-                tree->parent->color = RED;
-                rotateLeft(root, tree->parent);
-                s = tree->parent->right;
+                parent->color = RED;
+                rotateLeft(root, parent);
+                s = parent->right;
             }
             if (    (s->left->color == BLACK)
                  && (s->right->color == BLACK)
                )
             {
                 s->color = RED;
-                tree = tree->parent;
+                tree = parent;
+                parent = tree->parent;
             }
             else
             {
@@ -615,31 +622,32 @@ STATIC void deleteFixup(TREE **root,
                     s->left->color = BLACK;
                     s->color = RED;
                     rotateRight(root, s);
-                    s = tree->parent->right;
+                    s = parent->right;
                 }
-                s->color = tree->parent->color;
-                tree->parent->color = BLACK;
+                s->color = parent->color;
+                parent->color = BLACK;
                 s->right->color = BLACK;
-                rotateLeft(root, tree->parent);
+                rotateLeft(root, parent);
                 tree = *root;
             }
         }
         else
         {
-            s = tree->parent->left;
+            s = parent->left;
             if (s->color == RED)
             {
                 s->color = BLACK;
-                tree->parent->color = RED;
-                rotateRight(root, tree->parent);
-                s = tree->parent->left;
+                parent->color = RED;
+                rotateRight(root, parent);
+                s = parent->left;
             }
             if (    (s->right->color == BLACK)
                  && (s->left->color == BLACK)
                )
             {
                 s->color = RED;
-                tree = tree->parent;
+                tree = parent;
+                parent = tree->parent;
             }
             else
             {
@@ -648,18 +656,19 @@ STATIC void deleteFixup(TREE **root,
                     s->right->color = BLACK;
                     s->color = RED;
                     rotateLeft(root, s);
-                    s = tree->parent->left;
+                    s = parent->left;
                 }
-                s->color = tree->parent->color;
-                tree->parent->color = BLACK;
+                s->color = parent->color;
+                parent->color = BLACK;
                 s->left->color = BLACK;
-                rotateRight (root, tree->parent);
+                rotateRight (root, parent);
                 tree = *root;
             }
         }
     }
 
-    tree->color = BLACK;
+    if (tree != LEAF)
+        tree->color = BLACK;
 }
 
 /*
@@ -681,7 +690,8 @@ int treeDelete(TREE **root,         // in: root of the tree
                TREE *tree)          // in: tree node to delete
 {
     TREE        *y,
-                *d;
+                *d,
+                *yParent;
     nodeColor   color;
 
     if (    (!tree)
@@ -708,7 +718,10 @@ int treeDelete(TREE **root,         // in: root of the tree
     else
         y = d->right;
 
-    // remove d from the parent chain
+    // remove d from the parent chain; if d is tree's
+    // successor and tree's child, d takes tree's place,
+    // so it is y's parent afterwards
+    yParent = (d->parent == tree) ? d : d->parent;
     if (y != LEAF)
         y->parent = d->parent;
 
@@ -750,11 +763,12 @@ int treeDelete(TREE **root,         // in: root of the tree
             d->right->parent = d;
     }
 
-    if (    (y != LEAF)
-         && (color == BLACK)
-       )
+    // removing a black node shortens the paths through
+    // y, also if y is LEAF
+    if (color == BLACK)
         deleteFixup(root,
-                    y);
+                    y,
+                    yParent);
 
     if (plCount)
         (*plCount)--;       // V0.9.16 (2001-10-19) [umoeller]
@@ -787,6 +801,53 @@ TREE* treeFind(TREE *root,                    // in: root of the tree
     return 0;
 }
 
+/*
+ *@@ treeFindAtLeast:
+ *      returns the first tree node whose key is equal
+ *      to or greater than the specified key, or NULL
+ *      if all keys in the tree are less.
+ *
+ *      Together with treeNext, this allows for iterating
+ *      over a range of keys without visiting the nodes
+ *      before it:
+ *
+ +          TREE *pNode = treeFindAtLeast(TreeRoot, ulLow, fnCompare);
+ +          while (    (pNode)
+ +                  && (fnCompare(pNode->ulKey, ulHigh) <= 0)
+ +                )
+ +          {
+ +              ...
+ +              pNode = treeNext(pNode);
+ +          }
+ */
+
+TREE* treeFindAtLeast(TREE *root,                    // in: root of the tree
+                      unsigned long key,             // in: lower bound
+                      FNTREE_COMPARE *pfnCompare)    // in: comparison func
+{
+    TREE *current = root,
+         *found = 0;
+
+    while (current != LEAF)
+    {
+        int iResult;
+        if (!(iResult = pfnCompare(key, current->ulKey)))
+            return current;
+
+        if (iResult < 0)
+        {
+            // this one is greater: remember it, but
+            // there might be a smaller one to the left
+            found = current;
+            current = current->left;
+        }
+        else
+            current = current->right;
+    }
+
+    return found;
+}
+
 /*
  *@@ treeFirst:
  *      finds and returns the first node in a (sub-)tree.
@@ -1001,6 +1062,139 @@ TREE** treeBuildArray(TREE* pRoot,
     return papNodes;
 }
 
+/*
+ *@@ treeBuildFromArray:
+ *      builds a balanced tree from an array of nodes
+ *      which is already sorted by key, in O(n) time and
+ *      without any comparisons (unless pfnCompare is
+ *      given) or rotations.
+ *
+ *      This is much faster than calling treeInsert for
+ *      each node when a tree is (re)built from data that
+ *      is sorted already, for example from the array
+ *      returned by treeBuildArray.
+ *
+ *      The tree must be empty (see treeInit). If
+ *      (plCount != NULL), *plCount is set to cNodes.
+ *
+ *      If pfnCompare is given, the array is checked for
+ *      being sorted first, and STATUS_DUPLICATE_KEY or
+ *      STATUS_INVALID_NODE is returned (and the tree is
+ *      left empty) if two keys are equal or out of order.
+ *      If pfnCompare is NULL, the caller guarantees this.
+ *
+ *      The tree is built without recursion. Each node is
+ *      placed in the middle of its subrange, so all paths
+ *      differ in length by at most one; the nodes on the
+ *      deepest level are colored red if that level is not
+ *      full, all others black, which satisfies the
+ *      red-black rules so that treeInsert and treeDelete
+ *      work on the result as usual.
+ */
+
+int treeBuildFromArray(TREE **root,                 // in/out: root of the (empty) tree
+                       PLONG plCount,               // out: item count (ptr can be NULL)
+                       TREE **papNodes,             // in: nodes sorted by key
+                       long cNodes,                 // in: item count of papNodes
+                       FNTREE_COMPARE *pfnCompare)  // in: comparison func for checking or NULL
+{
+    // the stack can never be deeper than the tree is
+    // high, which is at most 32 for 2^31 nodes
+    struct
+    {
+        long    lLow,           // subrange [lLow, lHigh) of papNodes
+                lHigh;
+        TREE    *parent;        // parent for the subrange's middle node
+        TREE    **ppLink;       // where to link that node in
+        long    lDepth;
+    }       aStack[40];
+    long    cStack = 0,
+            lFullDepth = 0,
+            l;
+
+    if (*root != LEAF)
+        return STATUS_INVALID_NODE;
+
+    if (pfnCompare)
+    {
+        for (l = 1;
+             l < cNodes;
+             l++)
+        {
+            int iResult = pfnCompare(papNodes[l - 1]->ulKey, papNodes[l]->ulKey);
+            if (!iResult)
+                return STATUS_DUPLICATE_KEY;
+            if (iResult > 0)
+                return STATUS_INVALID_NODE;
+        }
+    }
+
+    // find the depth of the deepest full level; with
+    // cNodes == 2^k - 1, all levels are full
+    for (l = cNodes + 1;
+         l > 1;
+         l >>= 1)
+        lFullDepth++;
+    // nodes with lDepth >= lFullDepth are on the
+    // partial deepest level then
+
+    if (cNodes > 0)
+    {
+        aStack[0].lLow = 0;
+        aStack[0].lHigh = cNodes;
+        aStack[0].parent = 0;
+        aStack[0].ppLink = root;
+        aStack[0].lDepth = 0;
+        cStack = 1;
+    }
+
+    while (cStack)
+    {
+        long    lLow, lHigh, lMid, lDepth;
+        TREE    *parent, **ppLink, *x;
+
+        cStack--;
+        lLow = aStack[cStack].lLow;
+        lHigh = aStack[cStack].lHigh;
+        parent = aStack[cStack].parent;
+        ppLink = aStack[cStack].ppLink;
+        lDepth = aStack[cStack].lDepth;
+
+        lMid = lLow + (lHigh - lLow) / 2;
+        x = papNodes[lMid];
+        x->parent = parent;
+        x->left = LEAF;
+        x->right = LEAF;
+        x->color = (lDepth >= lFullDepth) ? RED : BLACK;
+        *ppLink = x;
+
+        if (lMid + 1 < lHigh)
+        {
+            aStack[cStack].lLow = lMid + 1;
+            aStack[cStack].lHigh = lHigh;
+            aStack[cStack].parent = x;
+            aStack[cStack].ppLink = &x->right;
+            aStack[cStack].lDepth = lDepth + 1;
+            cStack++;
+        }
+
+        if (lLow < lMid)
+        {
+            aStack[cStack].lLow = lLow;
+            aStack[cStack].lHigh = lMid;
+            aStack[cStack].parent = x;
+            aStack[cStack].ppLink = &x->left;
+            aStack[cStack].lDepth = lDepth + 1;
+            cStack++;
+        }
+    }
+
+    if (plCount)
+        *plCount = cNodes;
+
+    return STATUS_OK;
+}
+
 /* void main(int argc, char **argv) {
     int maxnum, ct;
     recType rec;
@@ -0,0 +1,493 @@
+
+/*
+ *@@sourcefile vector.c:
+ *      contains helper functions for maintaining growable
+ *      arrays of item pointers ("vectors").
+ *
+ *      Usage: All C programs; not OS/2-specific.
+ *
+ *      Function prefixes:
+ *      --  vec*    vector helper functions
+ *
+ *      <B>Usage:</B>
+ *
+ *      A VECTOR stores the same kind of data as a LINKLIST
+ *      (see linklist.c), that is, a pointer to each item,
+ *      but keeps the pointers in one contiguous array
+ *      instead of allocating a LISTNODE for every item.
+ *      This makes vecItemFromIndex a single array access,
+ *      where lstItemFromIndex has to walk the list, and
+ *      iterating is a loop over an index:
+ *
+ +          VECTOR vec;
+ +          unsigned long ul;
+ +
+ +          vecInit(&vec, TRUE);
+ +          while ...
+ +              vecAppend(&vec, pYourData);
+ +
+ +          for (ul = 0; ul < vec.ulCount; ul++)
+ +          {
+ +              PYOURDATA pYourData = (PYOURDATA)VEC_ITEM(&vec, ul);
+ +              ...
+ +          }
+ +
+ +          vecClear(&vec);    // frees the items too, if TRUE had
+ +                             // been specified with vecInit
+ *
+ *      Use a vector if the items are mostly appended and then
+ *      accessed by index, sorted or searched. Inserting or
+ *      removing in the middle moves all following pointers,
+ *      so for lists that get reshuffled a lot and are only
+ *      ever walked from front to back, LINKLIST is still the
+ *      better choice.
+ *
+ *      Sort functions are compatible with those for lstQuickSort.
+ *
+ *@@header "helpers\vector.h"
+ */
+
+/*
+ *      This file is part of the "XWorkplace helpers" source package.
+ *      This is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published
+ *      by the Free Software Foundation, in version 2 as it comes in the
+ *      "COPYING" file of the XWorkplace main distribution.
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "setup.h"                      // code generation and debugging options
+
+#define DONT_REPLACE_LIST_MALLOC
+#include "helpers/linklist.h"
+#include "helpers/vector.h"
+
+#pragma hdrstop
+
+/*
+ *@@category: Helpers\C helpers\Vectors
+ *      See vector.c.
+ */
+
+/* ******************************************************************
+ *
+ *   Vector base functions
+ *
+ ********************************************************************/
+
+/*
+ *@@ vecInit:
+ *      initializes a new vector. Use this on a VECTOR
+ *      on the stack or a global variable before using
+ *      any of the other functions.
+ *
+ *      If (fItemsFreeable == TRUE), vecClear and the
+ *      remove functions will invoke free() on the items.
+ */
+
+void XWPENTRY vecInit(PVECTOR pvec,
+                      BOOL fItemsFreeable)
+{
+    if (pvec)
+    {
+        memset(pvec, 0, sizeof(VECTOR));
+        pvec->fItemsFreeable = fItemsFreeable;
+    }
+}
+
+/*
+ *@@ vecClear:
+ *      removes all items from the vector and frees the
+ *      pointer array. If the vector was initialized with
+ *      fItemsFreeable, the items are freed as well.
+ *
+ *      The vector can be reused afterwards.
+ */
+
+void XWPENTRY vecClear(PVECTOR pvec)
+{
+    if (pvec)
+    {
+        if (pvec->fItemsFreeable)
+        {
+            unsigned long ul;
+            for (ul = 0; ul < pvec->ulCount; ul++)
+                if (pvec->papItems[ul])
+                    free(pvec->papItems[ul]);
+        }
+
+        if (pvec->papItems)
+            free(pvec->papItems);
+
+        pvec->papItems = NULL;
+        pvec->ulCount = 0;
+        pvec->cAllocated = 0;
+    }
+}
+
+/*
+ *@@ vecReserve:
+ *      makes sure the vector has room for at least
+ *      cItems items without reallocating. Callers
+ *      that know how many items they are going to
+ *      append can use this to avoid growing the
+ *      array several times.
+ *
+ *      Returns FALSE if memory could not be allocated.
+ */
+
+BOOL XWPENTRY vecReserve(PVECTOR pvec,
+                         unsigned long cItems)
+{
+    void **papNew;
+
+    if (!pvec)
+        return FALSE;
+
+    if (cItems <= pvec->cAllocated)
+        return TRUE;
+
+    if (!(papNew = (void**)realloc(pvec->papItems,
+                                   cItems * sizeof(void*))))
+        return FALSE;
+
+    pvec->papItems = papNew;
+    pvec->cAllocated = cItems;
+
+    return TRUE;
+}
+
+/*
+ *@@ Grow:
+ *      makes room for one more item, doubling the
+ *      array if it is full.
+ */
+
+STATIC BOOL Grow(PVECTOR pvec)
+{
+    if (pvec->ulCount < pvec->cAllocated)
+        return TRUE;
+
+    return vecReserve(pvec,
+                      (pvec->cAllocated) ? pvec->cAllocated * 2 : 16);
+}
+
+/*
+ *@@ vecAppend:
+ *      appends a new item to the end of the vector.
+ *
+ *      Returns FALSE if memory could not be allocated.
+ */
+
+BOOL XWPENTRY vecAppend(PVECTOR pvec,
+                        void *pItem)
+{
+    if (    (!pvec)
+         || (!Grow(pvec))
+       )
+        return FALSE;
+
+    pvec->papItems[pvec->ulCount++] = pItem;
+
+    return TRUE;
+}
+
+/*
+ *@@ vecInsert:
+ *      inserts a new item so that it ends up at
+ *      ulIndex. If ulIndex is past the end, the
+ *      item is appended.
+ *
+ *      Returns FALSE if memory could not be allocated.
+ */
+
+BOOL XWPENTRY vecInsert(PVECTOR pvec,
+                        void *pItem,
+                        unsigned long ulIndex)
+{
+    if (    (!pvec)
+         || (!Grow(pvec))
+       )
+        return FALSE;
+
+    if (ulIndex > pvec->ulCount)
+        ulIndex = pvec->ulCount;
+
+    memmove(&pvec->papItems[ulIndex + 1],
+            &pvec->papItems[ulIndex],
+            (pvec->ulCount - ulIndex) * sizeof(void*));
+    pvec->papItems[ulIndex] = pItem;
+    pvec->ulCount++;
+
+    return TRUE;
+}
+
+/*
+ *@@ vecRemoveIndex:
+ *      removes the item at ulIndex and closes the
+ *      gap. If the vector was initialized with
+ *      fItemsFreeable, the item is freed and NULL
+ *      is returned; otherwise the removed item is
+ *      returned.
+ *
+ *      Returns NULL also if ulIndex is out of range.
+ */
+
+void* XWPENTRY vecRemoveIndex(PVECTOR pvec,
+                              unsigned long ulIndex)
+{
+    void *pItem;
+
+    if (    (!pvec)
+         || (ulIndex >= pvec->ulCount)
+       )
+        return NULL;
+
+    pItem = pvec->papItems[ulIndex];
+    pvec->ulCount--;
+    memmove(&pvec->papItems[ulIndex],
+            &pvec->papItems[ulIndex + 1],
+            (pvec->ulCount - ulIndex) * sizeof(void*));
+
+    if (pvec->fItemsFreeable)
+    {
+        if (pItem)
+            free(pItem);
+        pItem = NULL;
+    }
+
+    return pItem;
+}
+
+/*
+ *@@ vecRemoveItem:
+ *      finds pItem in the vector and removes it
+ *      like vecRemoveIndex. This has to search
+ *      the array, so it is O(n).
+ *
+ *      Returns FALSE if the item was not found.
+ */
+
+BOOL XWPENTRY vecRemoveItem(PVECTOR pvec,
+                            void *pItem)
+{
+    unsigned long ul;
+
+    if ((ul = vecIndexFromItem(pvec, pItem)) == VEC_NOT_FOUND)
+        return FALSE;
+
+    vecRemoveIndex(pvec, ul);
+
+    return TRUE;
+}
+
+/*
+ *@@ vecItemFromIndex:
+ *      returns the item at ulIndex or NULL if
+ *      ulIndex is out of range.
+ */
+
+void* XWPENTRY vecItemFromIndex(const VECTOR *pvec,
+                                unsigned long ulIndex)
+{
+    if (    (pvec)
+         && (ulIndex < pvec->ulCount)
+       )
+        return pvec->papItems[ulIndex];
+
+    return NULL;
+}
+
+/*
+ *@@ vecIndexFromItem:
+ *      returns the index of pItem or VEC_NOT_FOUND
+ *      if the vector does not contain it.
+ */
+
+unsigned long XWPENTRY vecIndexFromItem(const VECTOR *pvec,
+                                        void *pItem)
+{
+    if (pvec)
+    {
+        unsigned long ul;
+        for (ul = 0; ul < pvec->ulCount; ul++)
+            if (pvec->papItems[ul] == pItem)
+                return ul;
+    }
+
+    return VEC_NOT_FOUND;
+}
+
+/* ******************************************************************
+ *
+ *   Sorting and searching
+ *
+ ********************************************************************/
+
+/*
+ *@@ MergeSort:
+ *      sorts papItems[ulLeft..ulRight) into place,
+ *      using papTemp as scratch space of the same size.
+ */
+
+STATIC void MergeSort(void **papItems,
+                      void **papTemp,
+                      unsigned long ulLeft,
+                      unsigned long ulRight,
+                      PFNSORTLIST pfnSort,
+                      void *pStorage)
+{
+    unsigned long ulMid, ul1, ul2, ulOut;
+
+    if (ulRight - ulLeft < 2)
+        return;
+
+    // insertion sort for short runs; merging two-item
+    // runs costs more than it saves
+    if (ulRight - ulLeft <= 8)
+    {
+        for (ul1 = ulLeft + 1; ul1 < ulRight; ul1++)
+        {
+            void *p = papItems[ul1];
+            ul2 = ul1;
+            while (    (ul2 > ulLeft)
+                    && (pfnSort(papItems[ul2 - 1], p, pStorage) > 0)
+                  )
+            {
+                papItems[ul2] = papItems[ul2 - 1];
+                ul2--;
+            }
+            papItems[ul2] = p;
+        }
+        return;
+    }
+
+    ulMid = ulLeft + (ulRight - ulLeft) / 2;
+    MergeSort(papItems, papTemp, ulLeft, ulMid, pfnSort, pStorage);
+    MergeSort(papItems, papTemp, ulMid, ulRight, pfnSort, pStorage);
+
+    // already in order?
+    if (pfnSort(papItems[ulMid - 1], papItems[ulMid], pStorage) <= 0)
+        return;
+
+    ul1 = ulLeft;
+    ul2 = ulMid;
+    ulOut = ulLeft;
+    while ((ul1 < ulMid) && (ul2 < ulRight))
+    {
+        // take from the left run on ties to keep the sort stable
+        if (pfnSort(papItems[ul2], papItems[ul1], pStorage) < 0)
+            papTemp[ulOut++] = papItems[ul2++];
+        else
+            papTemp[ulOut++] = papItems[ul1++];
+    }
+    while (ul1 < ulMid)
+        papTemp[ulOut++] = papItems[ul1++];
+    while (ul2 < ulRight)
+        papTemp[ulOut++] = papItems[ul2++];
+
+    memcpy(&papItems[ulLeft],
+           &papTemp[ulLeft],
+           (ulRight - ulLeft) * sizeof(void*));
+}
+
+/*
+ *@@ vecSort:
+ *      sorts the vector using pfnSort, which works
+ *      exactly like the sort function for lstQuickSort:
+ *      it receives two items plus pStorage and must
+ *      return < 0, 0 or > 0.
+ *
+ *      This is a merge sort, so it is stable and takes
+ *      O(n log n) comparisons also for presorted input,
+ *      where the list quicksort degrades.
+ *
+ *      Returns FALSE if the scratch array could not be
+ *      allocated; the vector is unchanged then.
+ */
+
+BOOL XWPENTRY vecSort(PVECTOR pvec,
+                      PFNSORTLIST pfnSort,
+                      void *pStorage)
+{
+    void **papTemp;
+
+    if (    (!pvec)
+         || (!pfnSort)
+       )
+        return FALSE;
+
+    if (pvec->ulCount < 2)
+        return TRUE;
+
+    if (pvec->ulCount <= 8)
+        papTemp = NULL;     // insertion sort only, no scratch needed
+    else if (!(papTemp = (void**)malloc(pvec->ulCount * sizeof(void*))))
+        return FALSE;
+
+    MergeSort(pvec->papItems,
+              papTemp,
+              0,
+              pvec->ulCount,
+              pfnSort,
+              pStorage);
+
+    if (papTemp)
+        free(papTemp);
+
+    return TRUE;
+}
+
+/*
+ *@@ vecSearch:
+ *      binary search in a vector that has been sorted
+ *      with the same pfnSort. pfnSort gets called with
+ *      pKey as the first and a vector item as the second
+ *      argument.
+ *
+ *      Returns the index of a matching item or
+ *      VEC_NOT_FOUND. If pulInsert is not NULL, it
+ *      receives the index where pKey would have to be
+ *      inserted with vecInsert to keep the vector
+ *      sorted.
+ */
+
+unsigned long XWPENTRY vecSearch(const VECTOR *pvec,
+                                 void *pKey,
+                                 PFNSORTLIST pfnSort,
+                                 void *pStorage,
+                                 unsigned long *pulInsert)
+{
+    unsigned long ulLow = 0,
+                  ulHigh = (pvec) ? pvec->ulCount : 0;
+
+    while (ulLow < ulHigh)
+    {
+        unsigned long ulMid = ulLow + (ulHigh - ulLow) / 2;
+        signed short s = pfnSort(pKey, pvec->papItems[ulMid], pStorage);
+
+        if (s == 0)
+        {
+            if (pulInsert)
+                *pulInsert = ulMid;
+            return ulMid;
+        }
+
+        if (s < 0)
+            ulHigh = ulMid;
+        else
+            ulLow = ulMid + 1;
+    }
+
+    if (pulInsert)
+        *pulInsert = ulLow;
+
+    return VEC_NOT_FOUND;
+}
+
@@ -42,6 +42,7 @@
 
 #define INCL_DOSEXCEPTIONS
 #define INCL_DOSPROCESS
+#define INCL_DOSSEMAPHORES
 #define INCL_DOSERRORS
 
 #define INCL_WINSHELLDATA
@@ -429,6 +430,145 @@ APIRET wphRebuildNodeHashTable(HHANDLES hHandles,
     return arc;
 }
 
+/*
+ *@@ ReadBlocks:
+ *      reads all the BLOCKn keys of the given handles
+ *      application in OS2SYS.INI into one new buffer,
+ *      which the caller must free() on NO_ERROR.
+ */
+
+STATIC APIRET ReadBlocks(HINI hiniSystem,
+                         const char *pcszActiveHandles,
+                         PBYTE *ppbData,        // out: all blocks (new buffer)
+                         PULONG pcbData)        // out: size of *ppbData
+{
+    APIRET  arc;
+    PSZ     pszKeysList;
+
+    if (!(arc = prfhQueryKeysForApp(hiniSystem,
+                                    pcszActiveHandles,
+                                    &pszKeysList)))
+    {
+        ULONG   ulHighestBlock = 0,
+                ul,
+                cbTotal = 0;
+        PBYTE   pbData = NULL;
+
+        const char *pKey2 = pszKeysList;
+        while (*pKey2)
+        {
+            if (!memicmp((PVOID)pKey2, "BLOCK", 5))
+            {
+                ULONG ulBlockThis = atoi(pKey2 + 5);
+                if (ulBlockThis > ulHighestBlock)
+                    ulHighestBlock = ulBlockThis;
+            }
+
+            pKey2 += strlen(pKey2)+1; // next key
+        }
+
+        free(pszKeysList);
+
+        if (!ulHighestBlock)
+            arc = ERROR_WPH_NO_HANDLES_DATA;
+        else
+        {
+            // now go read the data
+            // (BLOCK1, BLOCK2, ..., BLOCKn)
+            for (ul = 1;
+                 ul <= ulHighestBlock;
+                 ul++)
+            {
+                ULONG   cbBlockThis;
+                CHAR    szBlockThis[10];
+                sprintf(szBlockThis, "BLOCK%d", ul);
+                if (!PrfQueryProfileSize(hiniSystem,
+                                         (PSZ)pcszActiveHandles,
+                                         szBlockThis,
+                                         &cbBlockThis))
+                {
+                    arc = ERROR_WPH_PRFQUERYPROFILESIZE_BLOCK;
+                    break;
+                }
+                else
+                {
+                    ULONG   cbTotalOld = cbTotal;
+                    PBYTE   pbNew;
+                    cbTotal += cbBlockThis;
+                    if (!(pbNew = (BYTE*)realloc(pbData, cbTotal)))
+                            // on first call, pbData is NULL and this
+                            // behaves like malloc()
+                    {
+                        arc = ERROR_NOT_ENOUGH_MEMORY;
+                        break;
+                    }
+                    pbData = pbNew;
+
+                    if (!PrfQueryProfileData(hiniSystem,
+                                             (PSZ)pcszActiveHandles,
+                                             szBlockThis,
+                                             pbData + cbTotalOld,
+                                             &cbBlockThis))
+                    {
+                        arc = ERROR_WPH_PRFQUERYPROFILEDATA_BLOCK;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (!arc)
+        {
+            *ppbData = pbData;
+            *pcbData = cbTotal;
+        }
+        else if (pbData)
+            free(pbData);
+    }
+
+    return arc;
+}
+
+/*
+ *@@ CreateHandlesBuf:
+ *      creates a HANDLESBUF for the given blocks data,
+ *      which it takes over, also on errors.
+ */
+
+STATIC APIRET CreateHandlesBuf(HINI hiniUser,
+                               PBYTE pbData,
+                               ULONG cbData,
+                               HHANDLES *phHandles)
+{
+    APIRET      arc;
+    PHANDLESBUF pReturn;
+
+    if (!(pReturn = NEW(HANDLESBUF)))
+    {
+        free(pbData);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    ZERO(pReturn);
+
+    treeInit(&pReturn->DrivesTree,
+             &pReturn->cDrives);
+
+    pReturn->pbData = pbData;
+    pReturn->cbData = cbData;
+
+    // and load the hiwords too
+    if (!(arc = wphQueryBaseClassesHiwords(hiniUser,
+                                           &pReturn->usHiwordAbstract,
+                                           &pReturn->usHiwordFileSystem)))
+        *phHandles = (HHANDLES)pReturn;
+    else
+        // error:
+        wphFreeHandles((HHANDLES*)&pReturn);
+
+    return arc;
+}
+
 /*
  *@@ wphLoadHandles:
  *      returns a HANDLESBUF structure which will hold
@@ -469,108 +609,17 @@ APIRET wphLoadHandles(HINI hiniUser,      // in: HINI_USER or other INI handle
         arc = ERROR_INVALID_PARAMETER;
     else
     {
-        PSZ pszKeysList;
-        if (!(arc = prfhQueryKeysForApp(hiniSystem,
-                                        pcszActiveHandles,
-                                        &pszKeysList)))
-        {
-            PHANDLESBUF pReturn = NULL;
-
-            ULONG   ulHighestBlock = 0,
-                    ul,
-                    cbTotal;
-            PBYTE   pbData;
-
-            const char *pKey2 = pszKeysList;
-            while (*pKey2)
-            {
-                if (!memicmp((PVOID)pKey2, "BLOCK", 5))
-                {
-                    ULONG ulBlockThis = atoi(pKey2 + 5);
-                    if (ulBlockThis > ulHighestBlock)
-                        ulHighestBlock = ulBlockThis;
-                }
-
-                pKey2 += strlen(pKey2)+1; // next key
-            }
-
-            free(pszKeysList);
-
-            if (!ulHighestBlock)
-                arc = ERROR_WPH_NO_HANDLES_DATA;
-            else
-            {
-                // now go read the data
-                // (BLOCK1, BLOCK2, ..., BLOCKn)
-                cbTotal = 0;
-                pbData = NULL;
-                for (ul = 1;
-                     ul <= ulHighestBlock;
-                     ul++)
-                {
-                    ULONG   cbBlockThis;
-                    CHAR    szBlockThis[10];
-                    sprintf(szBlockThis, "BLOCK%d", ul);
-                    if (!PrfQueryProfileSize(hiniSystem,
-                                             (PSZ)pcszActiveHandles,
-                                             szBlockThis,
-                                             &cbBlockThis))
-                    {
-                        arc = ERROR_WPH_PRFQUERYPROFILESIZE_BLOCK;
-                        break;
-                    }
-                    else
-                    {
-                        ULONG   cbTotalOld = cbTotal;
-                        cbTotal += cbBlockThis;
-                        if (!(pbData = (BYTE*)realloc(pbData, cbTotal)))
-                                // on first call, pbData is NULL and this
-                                // behaves like malloc()
-                        {
-                            arc = ERROR_NOT_ENOUGH_MEMORY;
-                            break;
-                        }
-
-                        if (!PrfQueryProfileData(hiniSystem,
-                                                 (PSZ)pcszActiveHandles,
-                                                 szBlockThis,
-                                                 pbData + cbTotalOld,
-                                                 &cbBlockThis))
-                        {
-                            arc = ERROR_WPH_PRFQUERYPROFILEDATA_BLOCK;
-                            break;
-                        }
-                    }
-                }
-            }
-
-            if (!arc)
-            {
-                // all went OK:
-                if (pReturn = NEW(HANDLESBUF))
-                {
-                    ZERO(pReturn);
-
-                    treeInit(&pReturn->DrivesTree,
-                             &pReturn->cDrives);
-
-                    pReturn->pbData = pbData;
-                    pReturn->cbData = cbTotal;
-
-                    // and load the hiwords too
-                    if (!(arc = wphQueryBaseClassesHiwords(hiniUser,
-                                                           &pReturn->usHiwordAbstract,
-                                                           &pReturn->usHiwordFileSystem)))
-                        *phHandles = (HHANDLES)pReturn;
-                }
-                else
-                    arc = ERROR_NOT_ENOUGH_MEMORY;
-            }
-
-            if (arc)
-                // error:
-                wphFreeHandles((HHANDLES*)&pReturn);
-        }
+        PBYTE   pbData;
+        ULONG   cbData;
+
+        if (!(arc = ReadBlocks(hiniSystem,
+                               pcszActiveHandles,
+                               &pbData,
+                               &cbData)))
+            arc = CreateHandlesBuf(hiniUser,
+                                   pbData,
+                                   cbData,
+                                   phHandles);
     }
 
     return arc;
@@ -609,6 +658,161 @@ APIRET wphFreeHandles(HHANDLES *phHandles)
     return arc;
 }
 
+/* ******************************************************************
+ *
+ *   Handles cache
+ *
+ ********************************************************************/
+
+/*
+ *      The one-shot functions wphQueryHandleFromPath and
+ *      wphQueryPathFromHandle used to load all the handles
+ *      and rebuild the node trees on every call. With many
+ *      thousands of handles, the rebuild (which allocates
+ *      one tree node per NODE) is by far the most expensive
+ *      part. We now keep the last handles buffer around
+ *      and only rebuild it if the blocks in OS2SYS.INI
+ *      have changed since.
+ *
+ *      To find out whether they have, we still have to
+ *      read the blocks, since the WPS can modify them at
+ *      any time. We compare their size and a checksum of
+ *      the raw data (the cached copy has been upper-cased
+ *      by wphRebuildNodeHashTable, so it can't be compared
+ *      directly).
+ */
+
+STATIC HMTX         G_hmtxHandlesCache = NULLHANDLE;
+STATIC HHANDLES     G_hCachedHandles = NULLHANDLE;
+STATIC HINI         G_hiniCachedUser = NULLHANDLE,
+                    G_hiniCachedSystem = NULLHANDLE;
+STATIC ULONG        G_cbCachedData = 0,
+                    G_ulCachedChecksum = 0;
+
+/*
+ *@@ LockHandlesCache:
+ *      requests the handles cache mutex, creating it
+ *      on the first call.
+ */
+
+STATIC APIRET LockHandlesCache(VOID)
+{
+    if (!G_hmtxHandlesCache)
+        // first call: create
+        return DosCreateMutexSem(NULL,
+                                 &G_hmtxHandlesCache,
+                                 0,
+                                 TRUE);     // request!
+
+    // subsequent calls: request
+    return DosRequestMutexSem(G_hmtxHandlesCache, SEM_INDEFINITE_WAIT);
+}
+
+/*
+ *@@ UnlockHandlesCache:
+ *
+ */
+
+STATIC VOID UnlockHandlesCache(VOID)
+{
+    DosReleaseMutexSem(G_hmtxHandlesCache);
+}
+
+/*
+ *@@ ChecksumBlocks:
+ *      FNV-1a over the raw blocks data.
+ */
+
+STATIC ULONG ChecksumBlocks(PBYTE pbData,
+                            ULONG cbData)
+{
+    ULONG   ulHash = 2166136261UL;
+    PBYTE   pbEnd = pbData + cbData;
+
+    while (pbData < pbEnd)
+        ulHash = (ulHash ^ *pbData++) * 16777619UL;
+
+    return ulHash;
+}
+
+/*
+ *@@ GetCachedHandles:
+ *      returns the cached handles buffer for the given
+ *      INI files, reloading it if OS2SYS.INI has changed.
+ *      The node trees are rebuilt lazily as with
+ *      wphLoadHandles.
+ *
+ *      Caller must hold the cache mutex and must not
+ *      free the returned buffer.
+ */
+
+STATIC APIRET GetCachedHandles(HINI hiniUser,
+                               HINI hiniSystem,
+                               HHANDLES *phHandles)
+{
+    APIRET  arc;
+    PSZ     pszActiveHandles;
+
+    if (!(arc = wphQueryActiveHandles(hiniSystem, &pszActiveHandles)))
+    {
+        PBYTE   pbData;
+        ULONG   cbData;
+
+        if (!(arc = ReadBlocks(hiniSystem,
+                               pszActiveHandles,
+                               &pbData,
+                               &cbData)))
+        {
+            ULONG   ulChecksum = ChecksumBlocks(pbData, cbData);
+
+            if (    (G_hCachedHandles)
+                 && (G_hiniCachedUser == hiniUser)
+                 && (G_hiniCachedSystem == hiniSystem)
+                 && (G_cbCachedData == cbData)
+                 && (G_ulCachedChecksum == ulChecksum)
+               )
+                // unchanged: keep the trees we have
+                free(pbData);
+            else
+            {
+                if (G_hCachedHandles)
+                    wphFreeHandles(&G_hCachedHandles);
+
+                if (!(arc = CreateHandlesBuf(hiniUser,
+                                             pbData,
+                                             cbData,
+                                             &G_hCachedHandles)))
+                {
+                    G_hiniCachedUser = hiniUser;
+                    G_hiniCachedSystem = hiniSystem;
+                    G_cbCachedData = cbData;
+                    G_ulCachedChecksum = ulChecksum;
+                }
+            }
+        }
+
+        free(pszActiveHandles);
+    }
+
+    if (!arc)
+        *phHandles = G_hCachedHandles;
+
+    return arc;
+}
+
+/*
+ *@@ DropCachedHandles:
+ *      frees the cached handles buffer after a crash,
+ *      since the trees may be half built. Caller must
+ *      hold the cache mutex.
+ */
+
+STATIC VOID DropCachedHandles(VOID)
+{
+    if (G_hCachedHandles)
+        wphFreeHandles(&G_hCachedHandles);
+}
+
 /* ******************************************************************
  *
  *   Get HOBJECT from filename
@@ -779,6 +983,10 @@ APIRET wphSearchBufferForHandle(HHANDLES hHandles,
  *      This is a one-shot function, using wphQueryActiveHandles,
  *      wphReadAllBlocks, and wphSearchBufferForHandle.
  *
+ *      The handles are cached between calls and only
+ *      reloaded if OS2SYS.INI has changed, see
+ *      GetCachedHandles.
+ *
  *      Returns:
  *
  *      --  NO_ERROR: *phobj has received the object handle.
@@ -797,22 +1005,20 @@ APIRET wphQueryHandleFromPath(HINI hiniUser,      // in: HINI_USER or other INI
 {
     APIRET      arc = NO_ERROR;
 
-    volatile PSZ         pszActiveHandles = NULL; // XWP V1.0.4 (2005-10-09) [pr]
-    volatile HHANDLES    hHandles = NULLHANDLE;
+    volatile BOOL   fLocked = FALSE;
 
     TRY_LOUD(excpt1)
     {
-        // not found there: check the handles then
+        HHANDLES    hHandles;
 
-        if (arc = wphQueryActiveHandles(hiniSystem, (PSZ *) &pszActiveHandles))
-            _Pmpf((__FUNCTION__ ": wphQueryActiveHandles returned %d", arc));
-        else
+        if (!(arc = LockHandlesCache()))
         {
-            if (arc = wphLoadHandles(hiniUser,
-                                     hiniSystem,
-                                     pszActiveHandles,
-                                     (HHANDLES *) &hHandles))
-                _Pmpf((__FUNCTION__ ": wphLoadHandles returned %d", arc));
+            fLocked = TRUE;
+
+            if (arc = GetCachedHandles(hiniUser,
+                                       hiniSystem,
+                                       &hHandles))
+                _Pmpf((__FUNCTION__ ": GetCachedHandles returned %d", arc));
             else
             {
                 USHORT      usObjID;
@@ -835,10 +1041,12 @@ APIRET wphQueryHandleFromPath(HINI hiniUser,      // in: HINI_USER or other INI
         arc = ERROR_PROTECTION_VIOLATION; // V0.9.19 (2002-07-01) [umoeller]
     } END_CATCH();
 
-    if (pszActiveHandles)
-        free(pszActiveHandles);
-    if (hHandles)
-        wphFreeHandles((HHANDLES *) &hHandles);
+    if (fLocked)
+    {
+        if (arc == ERROR_PROTECTION_VIOLATION)
+            DropCachedHandles();
+        UnlockHandlesCache();
+    }
 
     return arc;
 }
@@ -981,7 +1189,9 @@ APIRET wphComposePath(HHANDLES hHandles,
  *      filename for hObject.
  *      This is a one-shot function, using wphQueryActiveHandles,
  *      wphLoadHandles, and wphComposePath.
- *      As a result, this function is _very_ expensive.
+ *      As a result, this function is _very_ expensive,
+ *      unless the handles cached by a previous call are
+ *      still valid (see GetCachedHandles).
  *
  *      Returns:
  *
@@ -1002,19 +1212,20 @@ APIRET wphQueryPathFromHandle(HINI hiniUser,      // in: HINI_USER or other INI
 {
     APIRET arc = NO_ERROR;
 
+    volatile BOOL   fLocked = FALSE;
+
     TRY_LOUD(excpt1)
     {
-        PSZ pszActiveHandles;
-        if (arc = wphQueryActiveHandles(hiniSystem, &pszActiveHandles))
-            _Pmpf((__FUNCTION__ ": wphQueryActiveHandles returned %d", arc));
-        else
+        if (!(arc = LockHandlesCache()))
         {
             HHANDLES hHandles;
-            if (arc = wphLoadHandles(hiniUser,
-                                     hiniSystem,
-                                     pszActiveHandles,
-                                     &hHandles))
-                _Pmpf((__FUNCTION__ ": wphLoadHandles returned %d", arc));
+
+            fLocked = TRUE;
+
+            if (arc = GetCachedHandles(hiniUser,
+                                       hiniSystem,
+                                       &hHandles))
+                _Pmpf((__FUNCTION__ ": GetCachedHandles returned %d", arc));
             else
             {
                 USHORT usHiwordFileSystem = ((PHANDLESBUF)hHandles)->usHiwordFileSystem;
@@ -1036,11 +1247,7 @@ APIRET wphQueryPathFromHandle(HINI hiniUser,      // in: HINI_USER or other INI
                 }
                 else
                     arc = ERROR_WPH_NOT_FILESYSTEM_HANDLE;
-
-                wphFreeHandles(&hHandles);
             }
-
-            free(pszActiveHandles);
         }
     }
     CATCH(excpt1)
@@ -1048,6 +1255,13 @@ APIRET wphQueryPathFromHandle(HINI hiniUser,      // in: HINI_USER or other INI
         arc = ERROR_PROTECTION_VIOLATION; // V0.9.19 (2002-07-01) [umoeller]
     } END_CATCH();
 
+    if (fLocked)
+    {
+        if (arc == ERROR_PROTECTION_VIOLATION)
+            DropCachedHandles();
+        UnlockHandlesCache();
+    }
+
     return arc;
 }
 
@@ -2601,6 +2601,84 @@ APIRET xmlCreateDOM(ULONG flParserFlags,            // in: DF_* parser flags
     return arc;
 }
 
+/*
+ *@@ xmlCreateStream:
+ *      creates an XMLDOM instance for streaming parsing,
+ *      which does not build a @DOM tree at all.
+ *
+ *      For large documents that are processed front to back
+ *      anyway, building the tree only to walk it once costs
+ *      several allocations per node plus the teardown in
+ *      xmlFreeDOM. With this, the @expat callbacks are given
+ *      to the caller directly instead:
+ *
+ *      1) Create the instance.
+ *
+ +          PXMLDOM pDom = NULL;
+ +          APIRET arc = xmlCreateStream(NULL, pMyData, &pDom);
+ +
+ *      2) Install your own expat handlers on pDom->pParser,
+ *         for example
+ *
+ +          XML_SetElementHandler(pDom->pParser,
+ +                                MyStartElement,
+ +                                MyEndElement);
+ +          XML_SetCharacterDataHandler(pDom->pParser,
+ +                                      MyCharacterData);
+ +
+ *         The handlers receive the XMLDOM as their user data
+ *         pointer, so they get at pvCallbackUser through it.
+ *         A handler can set pDom->arcDOM to a non-zero error
+ *         code to make xmlParse fail with that code when the
+ *         current chunk has been parsed.
+ *
+ *      3) Feed the data to xmlParse as with xmlCreateDOM.
+ *
+ *      4) Call xmlFreeDOM when done.
+ *
+ *      pDom->pDocumentNode stays NULL throughout. DTDs are
+ *      not parsed or validated, and @external_entities are
+ *      ignored unless the caller installs an expat handler
+ *      for them. pfnGetCPData works as with xmlCreateDOM.
+ */
+
+APIRET xmlCreateStream(PFNGETCPDATA pfnGetCPData,      // in: codepage callback or NULL
+                       PVOID pvCallbackUser,           // in: user param for callbacks
+                       PXMLDOM *ppDom)                 // out: XMLDOM struct created
+{
+    PXMLDOM     pDom;
+
+    if (!(pDom = (PXMLDOM)malloc(sizeof(*pDom))))
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    memset(pDom, 0, sizeof(XMLDOM));
+
+    pDom->pfnGetCPData = pfnGetCPData;
+    pDom->pvCallbackUser = pvCallbackUser;
+
+    lstInit(&pDom->llElementStack,
+            TRUE);                 // auto-free, stays empty
+
+    if (!(pDom->pParser = XML_ParserCreate(NULL)))
+    {
+        xmlFreeDOM(pDom);
+        return ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    if (pfnGetCPData)
+        XML_SetUnknownEncodingHandler(pDom->pParser,
+                                      UnknownEncodingHandler,
+                                      pDom);        // user data
+
+    // pass the XMLDOM as user data to the handlers
+    XML_SetUserData(pDom->pParser,
+                    pDom);
+
+    *ppDom = pDom;
+
+    return NO_ERROR;
+}
+
 /*
  *@@ xmlParse:
  *      parses another chunk of XML data.
@@ -2629,6 +2707,10 @@ APIRET xmlCreateDOM(ULONG flParserFlags,            // in: DF_* parser flags
  *         With this error code, you will find specific
  *         error information in the XMLDOM fields.
  *
+ *      With an XMLDOM from xmlCreateStream, this can also
+ *      return whatever the caller's handlers put into
+ *      XMLDOM.arcDOM.
+ *
  *@@added V0.9.9 (2001-02-14) [umoeller]
  */
 
@@ -3150,19 +3232,20 @@ APIRET xmlCreateDocument(const char *pcszRootElementName,   // in: root element
 
 typedef struct _ESCAPES
 {
-    XSTRING strQuot1,       // "
-            strQuot2,       // &quot;
-            strAmp1,        // &
-            strAmp2,        // &amp;
-            strLT1,         // <
-            strLT2,         // &lt;
-            strGT1,         // >
-            strGT2;         // &gt;
-
     XSTRING strTemp;        // temp buffer
 
 } ESCAPES, *PESCAPES;
 
+// applied in one pass with xstrReplaceMulti, so
+// the ampersands in "&lt;" etc. don't get escaped again
+static const XSTRREPLACE G_aEscapes[] =
+    {
+        { "&", "&amp;" },
+        { "<", "&lt;" },
+        { ">", "&gt;" },
+        { "\"", "&quot;" }      // must be last, see DoEscapes
+    };
+
 /*
  *@@ DoEscapes:
  *
@@ -3172,53 +3255,11 @@ typedef struct _ESCAPES
 VOID DoEscapes(PESCAPES pEscapes,
                BOOL fQuotesToo)
 {
-    ULONG   ulOfs;
-    size_t  ShiftTable[256];
-    BOOL    fRepeat;
-
-    if (fQuotesToo)
-    {
-        ulOfs = 0;
-        fRepeat = FALSE;
-        while (xstrFindReplace(&pEscapes->strTemp,
-                               &ulOfs,
-                               &pEscapes->strQuot1,
-                               &pEscapes->strQuot2,
-                               ShiftTable,
-                               &fRepeat))
-            ;
-    }
-
-    ulOfs = 0;
-    fRepeat = FALSE;
-    while (xstrFindReplace(&pEscapes->strTemp,
-                           &ulOfs,
-                           &pEscapes->strLT1,
-                           &pEscapes->strLT2,
-                           ShiftTable,
-                           &fRepeat))
-        ;
-
-    ulOfs = 0;
-    fRepeat = FALSE;
-    while (xstrFindReplace(&pEscapes->strTemp,
-                           &ulOfs,
-                           &pEscapes->strGT1,
-                           &pEscapes->strGT2,
-                           ShiftTable,
-                           &fRepeat))
-        ;
-
-    // replace ampersands last
-    ulOfs = 0;
-    fRepeat = FALSE;
-    while (xstrFindReplace(&pEscapes->strTemp,
-                           &ulOfs,
-                           &pEscapes->strAmp1,
-                           &pEscapes->strAmp2,
-                           ShiftTable,
-                           &fRepeat))
-        ;
+    xstrReplaceMulti(&pEscapes->strTemp,
+                     G_aEscapes,
+                     (fQuotesToo)
+                        ? ARRAYITEMCOUNT(G_aEscapes)
+                        : ARRAYITEMCOUNT(G_aEscapes) - 1);
 }
 
 /*
@@ -3442,29 +3483,11 @@ APIRET xmlWriteDocument(PDOMDOCUMENTNODE pDocument,     // in: document node
             xstrcatc(pxstr, '\n');
         }
 
-        xstrInitCopy(&esc.strQuot1, "\"", 0);
-        xstrInitCopy(&esc.strQuot2, "&quot;", 0);
-        xstrInitCopy(&esc.strAmp1, "&", 0);
-        xstrInitCopy(&esc.strAmp2, "&amp;", 0);
-        xstrInitCopy(&esc.strLT1, "<", 0);
-        xstrInitCopy(&esc.strLT2, "&lt;", 0);
-        xstrInitCopy(&esc.strGT1, ">", 0);
-        xstrInitCopy(&esc.strGT2, "&gt;", 0);
-
         xstrInit(&esc.strTemp, 0);       // temp buffer
 
         // write out children
         WriteNodes(pxstr, &esc, (PDOMNODE)pDocument);
 
-        xstrClear(&esc.strQuot1);
-        xstrClear(&esc.strQuot2);
-        xstrClear(&esc.strAmp1);
-        xstrClear(&esc.strAmp2);
-        xstrClear(&esc.strLT1);
-        xstrClear(&esc.strLT2);
-        xstrClear(&esc.strGT1);
-        xstrClear(&esc.strGT2);
-
         xstrClear(&esc.strTemp);       // temp buffer
 
         xstrcatc(pxstr, '\n');
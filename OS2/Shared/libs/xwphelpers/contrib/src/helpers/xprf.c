@@ -102,6 +102,7 @@
 
 #include "helpers/linklist.h"
 #include "helpers/prfh.h"
+#include "helpers/tree.h"
 #include "helpers/xprf.h"
 
 #pragma hdrstop
@@ -120,13 +121,26 @@
 /*
  *@@ XINIAPPDATA:
  *      application structure in XINI.
+ *
+ *      Applications are kept on XINI.llApps in file order,
+ *      which is the order they are written back in, and
+ *      in XINI.pAppsTree, sorted by name, for lookups.
+ *      The same goes for the keys in each application.
+ *
+ *      Names and data read from the file point into
+ *      XINI.pbFileData and are not copied. Only keys
+ *      written with xprfWriteProfileData get their own
+ *      memory.
  */
 
 typedef struct _XINIAPPDATA
 {
+    TREE        Tree;               // ulKey is pszAppName
     PSZ         pszAppName;
+    BOOL        fInPlace;           // TRUE if pszAppName points into XINI.pbFileData
     LINKLIST    llKeys;             // contains PXINIKEYDATA pointers
     ULONG       cKeys;              // count of items on list
+    TREE        *pKeysTree;         // XINIKEYDATA's sorted by name
 } XINIAPPDATA, *PXINIAPPDATA;
 
 /*
@@ -136,9 +150,12 @@ typedef struct _XINIAPPDATA
 
 typedef struct _XINIKEYDATA
 {
+    TREE        Tree;               // ulKey is pszKeyName
     PSZ         pszKeyName;
     PBYTE       pbData;
     ULONG       cbData;
+    BOOL        fInPlace;           // TRUE if pszKeyName and pbData point
+                                    // into XINI.pbFileData
 } XINIKEYDATA, *PXINIKEYDATA;
 
 /* ******************************************************************
@@ -162,17 +179,14 @@ STATIC APIRET FindApp(PXINI pXIni,           // in: profile opened with xprfOpen
                       const char *pcszApp,
                       PXINIAPPDATA *ppAppData)
 {
-    PLISTNODE pAppNode = lstQueryFirstNode(&pXIni->llApps);
-    while (pAppNode)
-    {
-        PXINIAPPDATA pAppDataThis = (PXINIAPPDATA)pAppNode->pItemData;
-        if (!strcmp(pAppDataThis->pszAppName, pcszApp))
-        {
-            *ppAppData = pAppDataThis;
-            return NO_ERROR;
-        }
+    PXINIAPPDATA pAppData;
 
-        pAppNode = pAppNode->pNext;
+    if (pAppData = (PXINIAPPDATA)treeFind(pXIni->pAppsTree,
+                                          (ULONG)pcszApp,
+                                          treeCompareStrings))
+    {
+        *ppAppData = pAppData;
+        return NO_ERROR;
     }
 
     return PRFERR_INVALID_APP_NAME;
@@ -183,7 +197,12 @@ STATIC APIRET FindApp(PXINI pXIni,           // in: profile opened with xprfOpen
  *      creates a new application in the specified
  *      profile structure and appends it to the list.
  *      This does NOT check for whether the app is
- *      already in the profile.
+ *      already in the profile. If it is, the new one
+ *      is written back to disk, but only the first
+ *      one can be found.
+ *
+ *      If fInPlace is TRUE, pcszApp must point into
+ *      XINI.pbFileData and is not copied.
  *
  *      Private helper.
  *
@@ -192,17 +211,31 @@ STATIC APIRET FindApp(PXINI pXIni,           // in: profile opened with xprfOpen
 
 STATIC APIRET CreateApp(PXINI pXIni,         // in: profile opened with xprfOpenProfile
                         const char *pcszApp,
+                        BOOL fInPlace,
                         PXINIAPPDATA *ppAppData)
 {
     PXINIAPPDATA pAppData;
     if (pAppData = (PXINIAPPDATA)malloc(sizeof(XINIAPPDATA)))
     {
-        pAppData->pszAppName = strdup(pcszApp);
+        if (fInPlace)
+            pAppData->pszAppName = (PSZ)pcszApp;
+        else if (!(pAppData->pszAppName = strdup(pcszApp)))
+        {
+            free(pAppData);
+            return ERROR_NOT_ENOUGH_MEMORY;
+        }
+        pAppData->fInPlace = fInPlace;
         lstInit(&pAppData->llKeys, FALSE);
         pAppData->cKeys = 0;
+        treeInit(&pAppData->pKeysTree, NULL);
 
-        // store in INI's apps list
+        // store in INI's apps list and tree
         lstAppendItem(&pXIni->llApps, pAppData);
+        pAppData->Tree.ulKey = (ULONG)pAppData->pszAppName;
+        treeInsert(&pXIni->pAppsTree,
+                   NULL,
+                   (TREE*)pAppData,
+                   treeCompareStrings);
 
         *ppAppData = pAppData;
         return NO_ERROR;
@@ -226,17 +259,14 @@ STATIC APIRET FindKey(PXINIAPPDATA pAppData,
                       const char *pcszKey,
                       PXINIKEYDATA *ppKeyData)
 {
-    PLISTNODE pKeyNode = lstQueryFirstNode(&pAppData->llKeys);
-    while (pKeyNode)
-    {
-        PXINIKEYDATA pKeyDataThis = (PXINIKEYDATA)pKeyNode->pItemData;
-        if (!strcmp(pKeyDataThis->pszKeyName, pcszKey))
-        {
-            *ppKeyData = pKeyDataThis;
-            return NO_ERROR;
-        }
+    PXINIKEYDATA pKeyData;
 
-        pKeyNode = pKeyNode->pNext;
+    if (pKeyData = (PXINIKEYDATA)treeFind(pAppData->pKeysTree,
+                                          (ULONG)pcszKey,
+                                          treeCompareStrings))
+    {
+        *ppKeyData = pKeyData;
+        return NO_ERROR;
     }
 
     return PRFERR_INVALID_KEY_NAME;
@@ -247,7 +277,12 @@ STATIC APIRET FindKey(PXINIAPPDATA pAppData,
  *      creates a new key in the specified application
  *      structure and appends it to the list.
  *      This does NOT check for whether the key is
- *      already in the application.
+ *      already in the application. If it is, the new
+ *      one is written back to disk, but only the first
+ *      one can be found.
+ *
+ *      If fInPlace is TRUE, pcszKey and pbData must
+ *      point into XINI.pbFileData and are not copied.
  *
  *      Private helper.
  *
@@ -258,27 +293,45 @@ STATIC APIRET CreateKey(PXINIAPPDATA pAppData,
                         const char *pcszKey,        // in: key name
                         PBYTE pbData,               // in: data for key
                         ULONG cbData,               // in: sizeof (*pbData)
+                        BOOL fInPlace,
                         PXINIKEYDATA *ppKeyData)    // out: new key data
 {
     PXINIKEYDATA pKeyData;
     if (pKeyData = (PXINIKEYDATA)malloc(sizeof(XINIKEYDATA)))
     {
-        pKeyData->pszKeyName = strdup(pcszKey);
+        if (fInPlace)
+        {
+            pKeyData->pszKeyName = (PSZ)pcszKey;
+            pKeyData->pbData = pbData;
+        }
+        else
+        {
+            pKeyData->pszKeyName = strdup(pcszKey);
+            if (pKeyData->pbData = (PBYTE)malloc(cbData))
+                memcpy(pKeyData->pbData, pbData, cbData);
+        }
 
-        if (pKeyData->pbData = (PBYTE)malloc(cbData))
+        if (pKeyData->pszKeyName && pKeyData->pbData)
         {
-            memcpy(pKeyData->pbData, pbData, cbData);
             pKeyData->cbData = cbData;
-            // store in app's keys list
+            pKeyData->fInPlace = fInPlace;
+            // store in app's keys list and tree
             lstAppendItem(&pAppData->llKeys, pKeyData);
             pAppData->cKeys++;
+            pKeyData->Tree.ulKey = (ULONG)pKeyData->pszKeyName;
+            treeInsert(&pAppData->pKeysTree,
+                       NULL,
+                       (TREE*)pKeyData,
+                       treeCompareStrings);
 
             *ppKeyData = pKeyData;
             return NO_ERROR;
         }
-        else
-            // malloc failed:
-            free(pKeyData);
+
+        // malloc failed:
+        if (pKeyData->pszKeyName)
+            free(pKeyData->pszKeyName);
+        free(pKeyData);
     }
 
     return ERROR_NOT_ENOUGH_MEMORY;
@@ -295,10 +348,13 @@ STATIC APIRET CreateKey(PXINIAPPDATA pAppData,
 
 STATIC VOID FreeKey(PXINIKEYDATA pKeyDataThis)
 {
-    if (pKeyDataThis->pszKeyName)
-        free(pKeyDataThis->pszKeyName);
-    if (pKeyDataThis->pbData)
-        free(pKeyDataThis->pbData);
+    if (!pKeyDataThis->fInPlace)
+    {
+        if (pKeyDataThis->pszKeyName)
+            free(pKeyDataThis->pszKeyName);
+        if (pKeyDataThis->pbData)
+            free(pKeyDataThis->pbData);
+    }
     free(pKeyDataThis);
 }
 
@@ -319,11 +375,12 @@ STATIC VOID FreeKeyIfExists(PXINI pXIni,         // in: profile opened with xprf
                  pcszKey,
                  &pKeyData))
     {
-        // key exists: kill that
-        FreeKey(pKeyData);
-        // and remove from app's keys list
+        // key exists: remove from app's keys tree and list
+        treeDelete(&pAppData->pKeysTree, NULL, (TREE*)pKeyData);
         lstRemoveItem(&pAppData->llKeys, pKeyData);
         pAppData->cKeys--;
+        // and kill that
+        FreeKey(pKeyData);
 
         // rewrite profile on close
         pXIni->fDirty = TRUE;
@@ -353,7 +410,9 @@ STATIC VOID FreeApp(PXINIAPPDATA pAppDataThis)
         pKeyNode = pKeyNode->pNext;
     }
 
-    if (pAppDataThis->pszAppName)
+    if (    (pAppDataThis->pszAppName)
+         && (!pAppDataThis->fInPlace)
+       )
         free(pAppDataThis->pszAppName);
 
     lstClear(&pAppDataThis->llKeys);
@@ -383,6 +442,8 @@ STATIC VOID FreeINI(PXINI pXIni)       // in: profile opened with xprfOpenProfil
         }
 
         lstClear(&pXIni->llApps);
+        if (pXIni->pbFileData)
+            free(pXIni->pbFileData);
         free(pXIni);
     }
 }
@@ -398,6 +459,11 @@ STATIC VOID FreeINI(PXINI pXIni)       // in: profile opened with xprfOpenProfil
  *      reads in the entire INI file from disk and
  *      initializes all internal data structures.
  *
+ *      The file data is read with a single DosRead and
+ *      kept in XINI.pbFileData until the profile is
+ *      closed; the names and data of all applications
+ *      and keys point into it.
+ *
  *      Private helper.
  *
  *@@changed V1.0.0 (2002-09-17) [umoeller]: now returning APIRET
@@ -420,6 +486,9 @@ STATIC APIRET ReadINI(PXINI pXIni)      // in: profile opened with xprfOpenProfi
         {
             ULONG ulSet = 0;
 
+            // freed by FreeINI
+            pXIni->pbFileData = pbFileData;
+
             if (!(arc = DosSetFilePtr(pXIni->hFile,
                                       0,
                                       FILE_BEGIN,
@@ -450,6 +519,7 @@ STATIC APIRET ReadINI(PXINI pXIni)      // in: profile opened with xprfOpenProfi
 
                                 if (arc = CreateApp(pXIni,
                                                     (PBYTE)(pbFileData + pApp->offAppName),
+                                                    TRUE,       // in place
                                                     &pIniApp))
                                     break;
 
@@ -464,6 +534,7 @@ STATIC APIRET ReadINI(PXINI pXIni)      // in: profile opened with xprfOpenProfi
                                                         (PSZ)(pbFileData + pKey->offKeyName),
                                                         (PBYTE)(pbFileData + pKey->offKeyData),
                                                         pKey->lenKeyData,
+                                                        TRUE,   // in place
                                                         &pIniKey))
                                         break;
 
@@ -478,8 +549,6 @@ STATIC APIRET ReadINI(PXINI pXIni)      // in: profile opened with xprfOpenProfi
                     }
                 }
             }
-
-            free(pbFileData);
         }
     }
 
@@ -769,6 +838,7 @@ APIRET xprfOpenProfile(PCSZ pcszFilename,    // in: profile name
                 // pXIni->hLock = hLock;
 
                 lstInit(&pXIni->llApps, FALSE);
+                treeInit(&pXIni->pAppsTree, NULL);
 
                 if (ulAction == FILE_CREATED)
                     // file newly created: rewrite on close
@@ -1094,10 +1164,11 @@ APIRET xprfWriteProfileData(PXINI pXIni,          // in: profile opened with xpr
             // yes, delete application: did we find it?
             if (pAppData)
             {
-                // yes: kill that
-                FreeApp(pAppData);
-                // and remove from list
+                // yes: remove from tree and list
+                treeDelete(&pXIni->pAppsTree, NULL, (TREE*)pAppData);
                 lstRemoveItem(&pXIni->llApps, pAppData);
+                // and kill that
+                FreeApp(pAppData);
 
                 // rewrite profile on close
                 pXIni->fDirty = TRUE;
@@ -1131,6 +1202,7 @@ APIRET xprfWriteProfileData(PXINI pXIni,          // in: profile opened with xpr
                     // create
                     arc = CreateApp(pXIni,
                                     pcszApp,
+                                    FALSE,      // copy
                                     &pAppData);
 
                 if (!arc)
@@ -1149,6 +1221,7 @@ APIRET xprfWriteProfileData(PXINI pXIni,          // in: profile opened with xpr
                                           pcszKey,
                                           (PBYTE)pData,
                                           ulDataLen,
+                                          FALSE,    // copy
                                           &pKeyData)))
                        // mark as dirty
                        pXIni->fDirty = TRUE;
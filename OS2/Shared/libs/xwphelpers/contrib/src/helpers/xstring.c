@@ -117,6 +117,7 @@
 
 #include "setup.h"                      // code generation and debugging options
 
+#include "helpers/standards.h"
 #include "helpers/stringh.h"
 #define DONT_REPLACE_XSTR_MALLOC
 #include "helpers/xstring.h"            // extended string helpers
@@ -370,6 +371,60 @@ void xstrClear(PXSTRING pxstr)              // in/out: string
     memset(pxstr, 0, sizeof(XSTRING));
 }
 
+/*
+ *@@ CalcAllocate:
+ *      returns how many bytes to allocate for pxstr
+ *      if it needs cbNeeded bytes, which must be more
+ *      than pxstr->cbAllocated.
+ *
+ *      If pxstr->ulDelta is set, the buffer grows in
+ *      chunks of that, as before.
+ *
+ *      Otherwise an empty string gets exactly what it
+ *      needs (most XSTRINGs are filled once with xstrcpy
+ *      and never grow), but a buffer that has to grow
+ *      again gets at least 50% on top of its current
+ *      size. Without this, appending n characters with
+ *      xstrcatc reallocated n times and, whenever realloc
+ *      could not expand in place, copied O(n^2) bytes.
+ */
+
+STATIC ULONG CalcAllocate(PXSTRING pxstr,
+                          ULONG cbNeeded)
+{
+    ULONG cbAllocate;
+
+    if (pxstr->ulDelta)
+    {
+        // delta specified: allocate in chunks of that
+        // V0.9.9 (2001-03-07) [umoeller]
+        ULONG cbExtra = cbNeeded - pxstr->cbAllocated;
+        cbExtra = (   (cbExtra + pxstr->ulDelta)
+                    / pxstr->ulDelta
+                  )
+                  * pxstr->ulDelta;
+                // if we need 3 extra bytes and ulDelta is 10,
+                // this gives us 10 extra bytes
+                // if we need 3 extra bytes and ulDelta is 1000,
+                // this gives us 1000 extra bytes
+        cbAllocate = pxstr->cbAllocated + cbExtra;
+    }
+    else if (pxstr->cbAllocated)
+    {
+        // growing an existing buffer: grow geometrically,
+        // rounded up to 16 bytes
+        cbAllocate = pxstr->cbAllocated + pxstr->cbAllocated / 2;
+        if (cbAllocate < cbNeeded)
+            cbAllocate = cbNeeded;
+        cbAllocate = (cbAllocate + 15) & ~15;
+    }
+    else
+        // first allocation: exactly what's needed
+        cbAllocate = cbNeeded;
+
+    return cbAllocate;
+}
+
 /*
  *@@ xstrReserve:
  *      this function makes sure that the specified
@@ -384,7 +439,11 @@ void xstrClear(PXSTRING pxstr)              // in/out: string
  *      If ulBytes is smaller than the current allocation,
  *      this function does nothing.
  *
- *      pxstr->ulDelta has no effect here.
+ *      If the string already had memory allocated, the
+ *      buffer grows by at least half its size (or by
+ *      pxstr->ulDelta chunks, if that is set), so that a
+ *      loop of xstrcat or xstrcatc calls reallocates only
+ *      O(log n) times. See CalcAllocate.
  *
  *      The XSTRING must be initialized before the
  *      call.
@@ -405,25 +464,7 @@ ULONG xstrReserve(PXSTRING pxstr,
     {
         // we need more memory than we have previously
         // allocated:
-        ULONG cbAllocate;
-        if (pxstr->ulDelta)
-        {
-            // delta specified: allocate in chunks of that
-            // V0.9.9 (2001-03-07) [umoeller]
-            ULONG cbExtra = cbNeeded - pxstr->cbAllocated;
-            cbExtra = (   (cbExtra + pxstr->ulDelta)
-                        / pxstr->ulDelta
-                      )
-                      * pxstr->ulDelta;
-                    // if we need 3 extra bytes and ulDelta is 10,
-                    // this gives us 10 extra bytes
-                    // if we need 3 extra bytes and ulDelta is 1000,
-                    // this gives us 1000 extra bytes
-            cbAllocate = pxstr->cbAllocated + cbExtra;
-        }
-        else
-            // no delta specified:
-            cbAllocate = cbNeeded;
+        ULONG cbAllocate = CalcAllocate(pxstr, cbNeeded);
         // V0.9.9 (2001-03-05) [umoeller]: use realloc;
         // this gives the C runtime a chance to expand the
         // existing block
@@ -932,30 +973,11 @@ ULONG xstrrpl(PXSTRING pxstr,                   // in/out: string
         {
             // we need more memory than we have previously
             // allocated:
-            // reallocate using ulDelta V0.9.9 (2001-03-07) [umoeller]
-            ULONG cbAllocate;
+            ULONG cbAllocate = CalcAllocate(pxstr, cbNeeded);
             PSZ pszNew;
-            if (pxstr->ulDelta)
-            {
-                // delta specified: allocate in chunks of that
-                // V0.9.9 (2001-03-07) [umoeller]
-                ULONG cbExtra = cbNeeded - pxstr->cbAllocated;
-                cbExtra = (   (cbExtra + pxstr->ulDelta)
-                            / pxstr->ulDelta
-                          )
-                          * pxstr->ulDelta;
-                        // if we need 3 extra bytes and ulDelta is 10,
-                        // this gives us 10 extra bytes
-                        // if we need 3 extra bytes and ulDelta is 1000,
-                        // this gives us 1000 extra bytes
-                cbAllocate = pxstr->cbAllocated + cbExtra;
-            }
-            else
-                // no delta specified:
-                cbAllocate = cbNeeded;
             // allocate new buffer
-            pszNew = (PSZ)malloc(cbAllocate);
-            // end V0.9.9 (2001-03-07) [umoeller]
+            if (!(pszNew = (PSZ)malloc(cbAllocate)))
+                return 0;
 
             if (ulFirstReplOfs)
                 // "found" was not at the beginning:
@@ -1256,6 +1278,151 @@ ULONG xstrFindReplaceC(PXSTRING pxstr,              // in/out: string
     return xstrFindReplace(pxstr, pulOfs, &xstrFind, &xstrReplace, ShiftTable, &fRepeat);
 }
 
+/*
+ *@@ xstrReplaceMulti:
+ *      replaces all occurences of several search strings
+ *      in pxstr in a single pass.
+ *
+ *      paReplace points to an array of cReplace XSTRREPLACE
+ *      structures, each of which has a search string and
+ *      a replacement string (which may be NULL or empty to
+ *      have the search string removed).
+ *
+ *      pxstr is scanned once from the beginning. At each
+ *      position, the first entry in paReplace whose search
+ *      string matches is replaced, and scanning continues
+ *      after the match; the replacement text itself is never
+ *      searched again. So put longer search strings before
+ *      their prefixes (e.g. "\r\n" before "\r"), and it
+ *      doesn't matter whether a replacement contains other
+ *      search strings (as with "&" -> "&amp;" and
+ *      "<" -> "&lt;").
+ *
+ *      Returns the no. of replacements made. If that is
+ *      0, pxstr has not been touched.
+ *
+ *      Compared with looping over xstrFindReplace once for
+ *      every search string, this runs over the string only
+ *      once and builds the new buffer once instead of moving
+ *      the tail of the string with every replacement.
+ *
+ *      Example:
+ *
+ +          static const XSTRREPLACE aEscapes[] =
+ +              {
+ +                  { "&", "&amp;" },
+ +                  { "<", "&lt;" },
+ +                  { ">", "&gt;" }
+ +              };
+ +          xstrReplaceMulti(&str, aEscapes, ARRAYITEMCOUNT(aEscapes));
+ */
+
+ULONG xstrReplaceMulti(PXSTRING pxstr,                 // in/out: string
+                       const XSTRREPLACE *paReplace,   // in: search/replace pairs
+                       ULONG cReplace)                 // in: array item count
+{
+    ULONG   cReplaced = 0;
+    BYTE    abFirst[256];       // TRUE for first chars of search strings
+    ULONG   acbSearch[16],
+            acbReplace[16],
+            *pacbSearch = acbSearch,
+            *pacbReplace = acbReplace;
+    XSTRING strNew;
+    PCSZ    pStart,             // start of unchanged run
+            p,
+            pEnd;
+    ULONG   ul;
+
+    if (    (!pxstr)
+         || (!pxstr->ulLength)
+         || (!paReplace)
+         || (!cReplace)
+       )
+        return 0;
+
+    if (cReplace > ARRAYITEMCOUNT(acbSearch))
+    {
+        if (!(pacbSearch = (PULONG)malloc(cReplace * 2 * sizeof(ULONG))))
+            return 0;
+        pacbReplace = pacbSearch + cReplace;
+    }
+
+    memset(abFirst, 0, sizeof(abFirst));
+    for (ul = 0; ul < cReplace; ul++)
+    {
+        pacbSearch[ul] = (paReplace[ul].pcszSearch) ? strlen(paReplace[ul].pcszSearch) : 0;
+        pacbReplace[ul] = (paReplace[ul].pcszReplace) ? strlen(paReplace[ul].pcszReplace) : 0;
+        if (pacbSearch[ul])
+            abFirst[(BYTE)paReplace[ul].pcszSearch[0]] = TRUE;
+    }
+
+    xstrInit(&strNew, 0);
+
+    pStart = p = pxstr->psz;
+    pEnd = p + pxstr->ulLength;
+    while (p < pEnd)
+    {
+        if (abFirst[(BYTE)*p])
+        {
+            for (ul = 0; ul < cReplace; ul++)
+            {
+                ULONG cbSearch = pacbSearch[ul];
+                if (    (cbSearch)
+                     && (cbSearch <= (ULONG)(pEnd - p))
+                     && (!memcmp(p, paReplace[ul].pcszSearch, cbSearch))
+                   )
+                    break;
+            }
+
+            if (ul < cReplace)
+            {
+                if (!cReplaced)
+                    // first match: allocate the new buffer with
+                    // some room for the replacements
+                    xstrReserve(&strNew, pxstr->ulLength + pxstr->ulLength / 4 + 1);
+
+                // copy the unchanged run before the match
+                if (p > pStart)
+                    xstrcat(&strNew, pStart, p - pStart);
+                if (pacbReplace[ul])
+                    xstrcat(&strNew, paReplace[ul].pcszReplace, pacbReplace[ul]);
+
+                ++cReplaced;
+                p += pacbSearch[ul];
+                pStart = p;
+                continue;
+            }
+        }
+
+        ++p;
+    }
+
+    if (cReplaced)
+    {
+        if (p > pStart)
+            xstrcat(&strNew, pStart, p - pStart);
+
+        // strNew can still be empty if everything was removed
+        if (!strNew.ulLength)
+        {
+            xstrClear(&strNew);
+            xstrcpy(pxstr, NULL, 0);
+        }
+        else
+        {
+            free(pxstr->psz);
+            pxstr->psz = strNew.psz;
+            pxstr->ulLength = strNew.ulLength;
+            pxstr->cbAllocated = strNew.cbAllocated;
+        }
+    }
+
+    if (pacbSearch != acbSearch)
+        free(pacbSearch);
+
+    return cReplaced;
+}
+
 // static encoding table for xstrEncode
 static PSZ apszEncoding[] =
 {
@@ -388,6 +388,18 @@
                     // clearing out the container
                     // V1.0.0 (2002-09-13) [umoeller]
 
+            PMINIRECORDCORE precPartialFill;
+                    // while populate is running for the files cnr,
+                    // this holds the record being populated so that
+                    // the controller's WM_TIMER can insert the objects
+                    // that are already awake; reset to NULL by
+                    // FM_POPULATED_FILLFILES
+
+            ULONG           ulPartialFillMS;
+                    // current interval of that timer; this doubles
+                    // with every tick so that big folders do not
+                    // get scanned over and over
+
             BOOL            fSplitViewReady;
                     // while this is FALSE (during the initial setup),
                     // the split view refuses to react any changes in
@@ -79,6 +79,10 @@
 
     #endif
 
+    VOID fopsQueryObjectSizeDeep(WPObject *pObject,
+                                 BOOL fFoldersOnly,
+                                 PLONGLONG pllSize);
+
     /********************************************************************
      *
      *   "File exists" (title clash) dialog
@@ -41,6 +41,11 @@
 
         PSZ fsysQueryEAKeyphrases(WPFileSystem *somSelf);
 
+        VOID fsysQueryEAs(WPFileSystem *somSelf,
+                          PSZ *ppszSubject,
+                          PSZ *ppszComments,
+                          PSZ *ppszKeyphrases);
+
         BOOL fsysSetEASubject(WPFileSystem *somSelf, PCSZ psz);
 
         BOOL fsysSetEAComments(WPFileSystem *somSelf, PCSZ psz);
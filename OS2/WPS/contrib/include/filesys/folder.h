@@ -667,6 +667,10 @@
                     //    object handle (_wpQueryHandle)
             WPObject    *pobj;
                     // object pointer
+            ULONG       ulHash;
+                    // for file-system objects, hash of the
+                    // upper-cased real name in ulKey, for the
+                    // folder's FileSystemsHash
         } FDRCONTENTITEM, *PFDRCONTENTITEM;
 
     #endif
@@ -294,6 +294,8 @@
     ULONG objForAllDirtyObjects(FNFORALLDIRTIESCALLBACK *pCallback,
                                 PVOID pvUserForCallback);
 
+    WPObject** objLockDirtyObjects(PULONG pcObjects);
+
     /* ******************************************************************
      *
      *   Object hotkeys
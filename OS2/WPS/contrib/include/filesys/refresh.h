@@ -108,6 +108,12 @@
 
         PSZ             pShortName;     // ptr into CNInfo.szName to where short name starts
 
+        // the following are set by refrAddNotification
+        ULONG           ulHash;         // hash of pFolder and pShortName
+        struct _XWPNOTIFY *pNextHash;   // next notification in the same
+                                        // pending hash bucket
+        PVOID           pGlobalNode;    // PLISTNODE on the global list
+
         CNINFO          CNInfo;         // original CNINFO from DosResetChangeNotify
                                         // (find-notify thread)
 
@@ -170,6 +170,109 @@
                 // used except by LoadNLSResources in xwpdaemn.c
    } NLSDATA, *PNLSDATA;
 
+    /*
+     *@@ HOOKEVENT:
+     *      one slot in the HOOKQUEUE ring. msg, mp1 and mp2
+     *      are exactly what the hook would otherwise have
+     *      posted to the daemon object window.
+     *
+     *      ulSeq tells producers and the consumer who owns
+     *      the slot: it equals the ring position while the
+     *      slot is free for that position and the position
+     *      plus one once the event has been written.
+     */
+
+    typedef struct _HOOKEVENT
+    {
+        volatile ULONG  ulSeq;
+        ULONG           msg;
+        MPARAM          mp1,
+                        mp2;
+    } HOOKEVENT, *PHOOKEVENT;
+
+    #define HOOKQUEUE_SIZE      256         // must be a power of two
+    #define HOOKQUEUE_MASK      (HOOKQUEUE_SIZE - 1)
+
+    /*
+     *@@ HOOKQUEUE:
+     *      lock-free event ring between the hook, which can
+     *      run on any PM thread of any process, and the
+     *      daemon object window, which is the only consumer.
+     *
+     *      The hook claims a slot with a compare-exchange
+     *      on lTail, fills it in and publishes it via
+     *      HOOKEVENT.ulSeq. Only the first event after the
+     *      daemon has drained the ring costs a WinPostMsg
+     *      (XDM_HOOKEVENTS); fDoorbell suppresses the others.
+     *      If the ring is full, hookPostDaemon falls back to
+     *      posting the message directly.
+     *
+     *      See hookPostDaemon and ProcessHookEvents (xwpdaemn.c).
+     */
+
+    typedef struct _HOOKQUEUE
+    {
+        volatile LONG   lTail;
+                // next position to be claimed by the hook
+        volatile LONG   lHead;
+                // next position to be drained; daemon only
+        volatile LONG   fDoorbell;
+                // TRUE while XDM_HOOKEVENTS is in the daemon's queue
+        ULONG           cOverflows;
+                // no. of events posted directly because the
+                // ring was full (statistics only, not exact)
+        HOOKEVENT       aEvents[HOOKQUEUE_SIZE];
+    } HOOKQUEUE, *PHOOKQUEUE;
+
+    /*
+     *@@ HOTKEYSLOT:
+     *      one slot in the HOTKEYTABLE hash.
+     */
+
+    typedef struct _HOTKEYSLOT
+    {
+        BYTE        fUsed;
+        UCHAR       ucScanCode;
+        USHORT      usFlags;            // KC_CTRL | KC_ALT | KC_SHIFT only
+        ULONG       ulHandle;           // from GLOBALHOTKEY
+    } HOTKEYSLOT, *PHOTKEYSLOT;
+
+    #define HOTKEYHASH_SIZE     512     // must be a power of two
+    #define HOTKEYHASH_MASK     (HOTKEYHASH_SIZE - 1)
+    #define HOTKEYHASH_MAX      (HOTKEYHASH_SIZE * 3 / 4)
+
+    #define HOTKEYHASH(uc, fl) \
+        (((ULONG)(uc) * 8 + (((fl) & (KC_CTRL | KC_ALT | KC_SHIFT)) >> 3)) & HOTKEYHASH_MASK)
+
+    /*
+     *@@ HOTKEYTABLE:
+     *      copy of the object hotkeys and function keys,
+     *      kept by hookSetGlobalHotkeys in HOOKDATA so
+     *      that the pre-accel hook can look up a WM_CHAR
+     *      without opening the hotkeys mutex or the shared
+     *      memory blocks.
+     *
+     *      The hotkeys are hashed by scan code and shift
+     *      state (linear probing); the function keys are a
+     *      bitmap indexed by scan code.
+     *
+     *      hookSetGlobalHotkeys makes ulGeneration odd
+     *      while it rebuilds the table; readers retry if
+     *      ulGeneration was odd or has changed meanwhile.
+     *
+     *      fHashed is FALSE if there are more than
+     *      HOTKEYHASH_MAX hotkeys; the hook then uses the
+     *      shared memory lists as before.
+     */
+
+    typedef struct _HOTKEYTABLE
+    {
+        volatile ULONG  ulGeneration;
+        BOOL            fHashed;
+        BYTE            abFunctionKeys[256 / 8];
+        HOTKEYSLOT      aSlots[HOTKEYHASH_SIZE];
+    } HOTKEYTABLE, *PHOTKEYTABLE;
+
     /*
      *@@ HOOKDATA:
      *      global hook data structure. Only one instance
@@ -336,11 +439,36 @@
 
         // NLS strings V1.0.0 (2002-09-16) [lafaix]
         NLSDATA     NLSData;
+
+        // hook -> daemon event ring
+        HOOKQUEUE   Queue;
+
+        // hashed object hotkeys and function keys
+        HOTKEYTABLE Hotkeys;
+
+#ifndef __NOSLIDINGFOCUS__
+        // sliding focus mailbox: the hook stores the latest
+        // window under the mouse here and queues a single
+        // XDM_SLIDINGFOCUSCHECK until the daemon has looked
+        HWND        hwndSlidingUnderMouse;
+        volatile LONG fSlidingMouseMoved,
+                    fSlidingCheckQueued;
+#endif
     } HOOKDATA, *PHOOKDATA;
 
     // special key for WM_MOUSEMOVE with delayed sliding menus
     #define         HT_DELAYEDSLIDINGMENU   (HT_NORMAL + 2)
 
+    // frame classes whose changes are reported to the window
+    // list; checked by the daemon for XDM_WINDOWCHANGE and
+    // XDM_ICONCHANGE, and by the hook for WM_DESTROY only
+    #define IS_WINLIST_CLASS(psz)                                   \
+        (    (!strcmp((psz), "#1"))                                 \
+          || (!strcmp((psz), "wpFolder window"))                    \
+          || (!strcmp((psz), "Win32FrameClass")) /* Odin */         \
+          || (!strcmp((psz), "EFrame"))          /* EPM */          \
+        )
+
     /* ******************************************************************
      *
      *   XPager definitions needed by the hook
@@ -387,6 +515,10 @@
                           PCSZ pcszFormat,
                           ...);
 
+    BOOL _Optlink hookPostDaemon(ULONG msg,
+                                 MPARAM mp1,
+                                 MPARAM mp2);
+
     VOID _Optlink HackSwitchList(BOOL fInstall);
 
     VOID _Optlink StopMB3Scrolling(BOOL fSuccessPostMsgs);
@@ -415,8 +547,6 @@
     extern HMTX             G_hmtxGlobalHotkeys;
 
     extern HWND             G_hwndUnderMouse;
-    extern HWND             G_hwndLastFrameUnderMouse;
-    extern HWND             G_hwndLastSubframeUnderMouse;
     extern POINTS           G_ptsMousePosWin;
     extern POINTL           G_ptlMousePosDesktop;
     extern HWND             G_hwndRootMenu;
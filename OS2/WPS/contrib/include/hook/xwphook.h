@@ -615,6 +615,13 @@
 #endif
 
     #define XDM_NLSCHANGED          (WM_USER + 433) // V1.0.0 (2002-09-15) [lafaix]
+
+    // hook -> daemon only, see HOOKQUEUE in hook_private.h
+    #define XDM_HOOKEVENTS          (WM_USER + 434)
+
+#ifndef __NOSLIDINGFOCUS__
+    #define XDM_SLIDINGFOCUSCHECK   (WM_USER + 435)
+#endif
 #endif
 
 
@@ -1014,6 +1014,14 @@
     VOID XWPENTRY cmnRestoreSettings(PSETTINGSBACKUP paSettingsBackup,
                                      ULONG cItems);
 
+    ULONG XWPENTRY cmnSnapshotSettings(PSETTINGSBACKUP paSettings,
+                                       ULONG cItems);
+
+    ULONG XWPENTRY cmnQuerySettingsGeneration(VOID);
+
+    BOOL XWPENTRY cmnWaitSettingsChange(ULONG ulGeneration,
+                                        ULONG ulTimeout);
+
     /* ******************************************************************
      *
      *   Modules and paths
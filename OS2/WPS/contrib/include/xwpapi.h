@@ -80,6 +80,56 @@
                 // V1.0.0 (2002-09-15) [lafaix]
     } XWPGLOBALSHARED, *PXWPGLOBALSHARED;
 
+    /* ******************************************************************
+     *
+     *   XWPSETTINGSSHARED
+     *
+     ********************************************************************/
+
+    #define SHMEM_XWPSETTINGS        "\\SHAREMEM\\XWORKPLC\\SETTINGS.DAT"
+            // shared memory name of XWPSETTINGSSHARED structure
+
+    #define SEM_XWPSETTINGSCHANGED   "\\SEM32\\XWORKPLC\\SETTINGS.SEM"
+            // shared event semaphore, posted by XFLDR.DLL after
+            // each change to XWPSETTINGSSHARED
+
+    #define XWPSETTINGS_MAGIC        0x53505758     // "XWPS"
+
+    /*
+     *@@ XWPSETTINGSSHARED:
+     *      snapshot of the XWorkplace global settings (the
+     *      values cmnQuerySetting returns, indexed by the
+     *      XWPSETTING enumeration in shared\common.h) in
+     *      named shared memory, so that any process can
+     *      read them without going through OS2.INI.
+     *
+     *      This is allocated by cmnLoadGlobalSettings in
+     *      the WPS process, which is the only writer. Other
+     *      processes should request it with PAG_READ only
+     *      and check ulMagic and cSettings before use.
+     *
+     *      A single setting can be read directly. To read
+     *      several settings which belong together, read
+     *      ulSeq first, copy the values, and start over
+     *      if ulSeq was odd or has changed in the meantime.
+     *      ulSeq / 2 is the settings generation; to wait
+     *      for it to change, open SEM_XWPSETTINGSCHANGED.
+     */
+
+    typedef struct _XWPSETTINGSSHARED
+    {
+        ULONG           ulMagic;
+                // XWPSETTINGS_MAGIC
+        ULONG           cbStruct;
+                // size of this structure including aulSettings
+        ULONG           cSettings;
+                // items in aulSettings (___LAST_SETTING of the writer)
+        volatile ULONG  ulSeq;
+                // odd while XFLDR.DLL is updating the values
+        ULONG           aulSettings[1];
+                // setting values; the struct is dynamic in size
+    } XWPSETTINGSSHARED, *PXWPSETTINGSSHARED;
+
     #define APIM_FILEDLG            (WM_USER + 300)
 
     #define APIM_SHOWHELPPANEL      (WM_USER + 301)
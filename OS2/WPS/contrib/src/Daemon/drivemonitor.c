@@ -80,8 +80,24 @@ typedef struct _DISKWATCHITEM
     double      dFreeLast;
     APIRET      arcLast;
 
+    ULONG       ulInterval;         // current polling interval (ms)
+    ULONG       ulNextCheck;        // QSV_MS_COUNT when the drive is due again
+
 } DISKWATCHITEM, *PDISKWATCHITEM;
 
+// drive classes in G_abDriveClass
+#define DRVCLASS_UNKNOWN        0   // not checked yet, handled by the slow thread
+#define DRVCLASS_FAST           1   // local hard disk or VDISK
+#define DRVCLASS_SLOW           2   // everything else (LAN, CD-ROM, floppy, ...)
+
+// polling intervals; a drive is polled at the minimum interval
+// after its free space changed, and the interval then doubles
+// with every check that finds nothing new up to the maximum
+#define FAST_MIN_INTERVAL       500
+#define FAST_MAX_INTERVAL       4000
+#define SLOW_MIN_INTERVAL       2000
+#define SLOW_MAX_INTERVAL       30000
+
 /* ******************************************************************
  *
  *   Global variables
@@ -94,6 +110,17 @@ static LINKLIST    G_llDrives;         // linked list of DISKWATCHITEM structs,
 static HMTX        G_hmtxDrivesList = NULLHANDLE;
                                 // mutex protecting that list
 
+static BYTE        G_abDriveClass[27] = {0};
+                                // DRVCLASS_* for each logical drive (1-26),
+                                // protected by G_hmtxDrivesList
+
+static HEV         G_hevWakeFast = NULLHANDLE,
+                   G_hevWakeSlow = NULLHANDLE;
+                                // posted to have the watch threads check
+                                // their drives right away
+
+static THREADINFO  G_tiDiskWatchSlow;
+
 /* ******************************************************************
  *
  *   Drive monitoring
@@ -188,6 +215,8 @@ BOOL LockDrivesList(VOID)
 
     // first call:
     lstInit(&G_llDrives, TRUE);         // auto-free
+    DosCreateEventSem(NULL, &G_hevWakeFast, 0, FALSE);
+    DosCreateEventSem(NULL, &G_hevWakeSlow, 0, FALSE);
     return !DosCreateMutexSem(NULL,
                               &G_hmtxDrivesList,
                               0,
@@ -245,12 +274,22 @@ BOOL dmnAddDiskfreeMonitor(ULONG ulLogicalDrive,    // in: disk to be watched or
 
                     pNew->dFreeLast = 0;
 
+                    // due right away; the watch thread for the
+                    // drive picks it up when it wakes up
+                    DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT,
+                                    &pNew->ulNextCheck,
+                                    sizeof(ULONG));
+
                     // _Pmpf(("Added diskwatch for drive %d, hwnd 0x%lX",
                        //      ulLogicalDrive,
                           //   hwndNotify));
 
-                    brc = (lstAppendItem(&G_llDrives,
-                                         pNew) != 0);
+                    if (brc = (lstAppendItem(&G_llDrives,
+                                             pNew) != 0))
+                    {
+                        DosPostEventSem(G_hevWakeFast);
+                        DosPostEventSem(G_hevWakeSlow);
+                    }
                 }
             }
             else
@@ -341,32 +380,103 @@ BOOL dmnQueryDisks(ULONG ulLogicalDrive,
 }
 
 /*
- *@@ fntDiskWatch:
- *      drive monitor thread.
+ *@@ IsMyDrive:
+ *      returns TRUE if the given logical drive is handled
+ *      by the slow watch thread (fSlow == TRUE) or by the
+ *      fast one.
  *
- *@@added V0.9.14 (2001-08-01) [umoeller]
+ *      Drives start out as DRVCLASS_UNKNOWN and are handled
+ *      by the slow thread until it has classified them, so
+ *      the fast thread never touches a drive that might
+ *      block.
+ *
+ *      Caller must hold the drives list mutex.
  */
 
-void _Optlink fntDiskWatch(PTHREADINFO ptiMyself)
+STATIC BOOL IsMyDrive(ULONG ulLogicalDrive,
+                      BOOL fSlow)
 {
-    BOOL fLocked = FALSE;
+    if (ulLogicalDrive < 1 || ulLogicalDrive > 26)
+        return FALSE;
 
-    if (LockDrivesList())
-    {
-        // tell main() we're done
-        DosPostEventSem(ptiMyself->hevRunning);
+    if (fSlow)
+        return (G_abDriveClass[ulLogicalDrive] != DRVCLASS_FAST);
 
-        UnlockDrivesList();
-    }
+    return (G_abDriveClass[ulLogicalDrive] == DRVCLASS_FAST);
+}
+
+/*
+ *@@ ClassifyDrive:
+ *      determines whether a drive can be polled by the
+ *      fast watch thread. Only local hard disks and VDISKs
+ *      qualify; LAN drives, CD-ROMs and other removeable
+ *      media stay with the slow thread.
+ *
+ *      This can block on slow drives, so it is only called
+ *      on the slow thread, without holding the drives list
+ *      mutex.
+ */
+
+STATIC BYTE ClassifyDrive(ULONG ulLogicalDrive)
+{
+    XDISKINFO   xdi;
+
+    if (    (!doshGetDriveInfo(ulLogicalDrive, 0, &xdi))
+         && (xdi.fPresent)
+         && (!(xdi.flDevice & DFL_REMOTE))
+         && (    (xdi.bType == DRVTYPE_HARDDISK)
+              || (xdi.bType == DRVTYPE_VDISK)
+            )
+       )
+        return DRVCLASS_FAST;
+
+    return DRVCLASS_SLOW;
+}
+
+/*
+ *@@ WatchDrives:
+ *      implementation for both drive monitor threads.
+ *
+ *      Each pass collects the drives that are due from
+ *      the watch list, then queries their free space
+ *      with the list unlocked, so that a drive that takes
+ *      long to respond does not block dmnAddDiskfreeMonitor
+ *      on the daemon's PM thread. Every drive is queried
+ *      only once per pass no matter how many windows are
+ *      watching it.
+ *
+ *      Each watch backs off on its own while its drive does
+ *      not change, and is reset to the minimum interval when
+ *      it does. Between passes the thread sleeps until the
+ *      next watch is due or until a new watch has been added.
+ */
+
+STATIC VOID WatchDrives(PTHREADINFO ptiMyself,
+                        BOOL fSlow)
+{
+    volatile BOOL fLocked = FALSE;
+    HEV         hevWake = (fSlow) ? G_hevWakeSlow : G_hevWakeFast;
+    ULONG       ulMinInterval = (fSlow) ? SLOW_MIN_INTERVAL : FAST_MIN_INTERVAL,
+                ulMaxInterval = (fSlow) ? SLOW_MAX_INTERVAL : FAST_MAX_INTERVAL;
 
     TRY_LOUD(excpt1)
     {
         // run forever unless exit
         while (!ptiMyself->fExit)
         {
-            // go sleep a while
-            DosSleep(500);
-
+            ULONG       ulNow,
+                        ulWait = ulMaxInterval,
+                        flDue = 0,          // bit n set: drive n is due
+                        ul,
+                        ulPosts;
+            APIRET      aarc[27];
+            double      adFree[27];
+
+            DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT,
+                            &ulNow,
+                            sizeof(ulNow));
+
+            // 1) collect the drives that are due
             if (fLocked = LockDrivesList())
             {
                 PLISTNODE pNode = lstQueryFirstNode(&G_llDrives);
@@ -376,8 +486,6 @@ void _Optlink fntDiskWatch(PTHREADINFO ptiMyself)
 
                     PDISKWATCHITEM  pWatch = (PDISKWATCHITEM)pNode->pItemData;
 
-                    // _Pmpf(("processing watch for drive %d", pWatch->ulLogicalDrive));
-
                     if (!WinIsWindow(ptiMyself->hab,
                                      pWatch->hwndNotify))
                     {
@@ -386,53 +494,128 @@ void _Optlink fntDiskWatch(PTHREADINFO ptiMyself)
                                               pWatch->hwndNotify,
                                               -1);      // remove!
                     }
-                    else
+                    else if (IsMyDrive(pWatch->ulLogicalDrive, fSlow))
+                    {
+                        if ((LONG)(pWatch->ulNextCheck - ulNow) <= 0)
+                            flDue |= 1 << pWatch->ulLogicalDrive;
+                    }
+
+                    pNode = pNext;
+                }
+
+                UnlockDrivesList();
+                fLocked = FALSE;
+            }
+
+            // 2) query the drives without holding the list
+            for (ul = 1; ul <= 26; ul++)
+                if (flDue & (1 << ul))
+                {
+                    if (fSlow && !G_abDriveClass[ul])
+                    {
+                        BYTE bClass = ClassifyDrive(ul);
+                        if (fLocked = LockDrivesList())
+                        {
+                            G_abDriveClass[ul] = bClass;
+                            UnlockDrivesList();
+                            fLocked = FALSE;
+                        }
+                        if (bClass == DRVCLASS_FAST)
+                        {
+                            // hand it over to the fast thread
+                            flDue &= ~(1 << ul);
+                            DosPostEventSem(G_hevWakeFast);
+                            continue;
+                        }
+                    }
+
+                    adFree[ul] = 0;
+                    aarc[ul] = doshQueryDiskFree(ul, &adFree[ul]);
+                }
+
+            DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT,
+                            &ulNow,
+                            sizeof(ulNow));
+
+            // 3) report changes and reschedule
+            if (fLocked = LockDrivesList())
+            {
+                PLISTNODE pNode = lstQueryFirstNode(&G_llDrives);
+                while (pNode)
+                {
+                    PDISKWATCHITEM  pWatch = (PDISKWATCHITEM)pNode->pItemData;
+                    ULONG           ulDrive = pWatch->ulLogicalDrive;
+
+                    if (!IsMyDrive(ulDrive, fSlow))
+                        ;
+                    else if (flDue & (1 << ulDrive))
                     {
-                        APIRET          arc;
-                        double          dFree;
                         LONG            lKB = -1;
-                        if (!(arc = doshQueryDiskFree(pWatch->ulLogicalDrive,
-                                                      &dFree)))
+
+                        // _Pmpf(("processing watch for drive %d", ulDrive));
+
+                        if (!aarc[ulDrive])
                         {
-                            if (dFree != pWatch->dFreeLast)
+                            if (adFree[ulDrive] != pWatch->dFreeLast)
                             {
                                 // free space changed:
-                                // _PmpfF(("drive %d changed, old: %f, new: %f",
-                                //         pWatch->ulLogicalDrive,
-                                   //      pWatch->dFreeLast,
-                                      //   dFree));
-                                lKB = dFree / 1024L;
-                                pWatch->dFreeLast = dFree;
+                                lKB = adFree[ulDrive] / 1024L;
+                                pWatch->dFreeLast = adFree[ulDrive];
                                 pWatch->arcLast = NO_ERROR;
                             }
                         }
                         else
                         {
-                            if (arc != pWatch->arcLast)
+                            if (aarc[ulDrive] != pWatch->arcLast)
                             {
                                 // error code changed:
-                                lKB = -(LONG)arc;
+                                lKB = -(LONG)aarc[ulDrive];
                                 pWatch->dFreeLast = 0;
-                                pWatch->arcLast = arc;
+                                pWatch->arcLast = aarc[ulDrive];
                             }
                         }
 
                         if (lKB != -1)
+                        {
                             // we got something to report:
                             // well, report then
                             WinPostMsg(pWatch->hwndNotify,
                                        // post the msg that client wants from us
                                        pWatch->ulMessage,
-                                       (MPARAM)pWatch->ulLogicalDrive,
+                                       (MPARAM)ulDrive,
                                        (MPARAM)lKB);
+
+                            pWatch->ulInterval = ulMinInterval;
+                        }
+                        else if (pWatch->ulInterval < ulMinInterval)
+                            pWatch->ulInterval = ulMinInterval;
+                        else if ((pWatch->ulInterval *= 2) > ulMaxInterval)
+                            pWatch->ulInterval = ulMaxInterval;
+
+                        pWatch->ulNextCheck = ulNow + pWatch->ulInterval;
                     }
 
-                    pNode = pNext;
+                    // sleep until the first watch is due
+                    if (IsMyDrive(ulDrive, fSlow))
+                    {
+                        LONG lDue = (LONG)(pWatch->ulNextCheck - ulNow);
+                        if (lDue < (LONG)ulWait)
+                            ulWait = (lDue > 0) ? lDue : 0;
+                    }
+
+                    pNode = pNode->pNext;
                 }
 
                 UnlockDrivesList();
                 fLocked = FALSE;
             }
+
+            // go sleep a while; don't spin if a drive keeps
+            // failing right away
+            if (ulWait < 100)
+                ulWait = 100;
+            if (!DosWaitEventSem(hevWake, ulWait))
+                DosResetEventSem(hevWake, &ulPosts);
         }
     }
     CATCH(excpt1)
@@ -442,3 +625,63 @@ void _Optlink fntDiskWatch(PTHREADINFO ptiMyself)
     if (fLocked)
         UnlockDrivesList();
 }
+
+/*
+ *@@ fntDiskWatchSlow:
+ *      drive monitor thread for LAN drives, CD-ROMs and
+ *      other removeable media, and for drives that have
+ *      not been classified yet. Started by fntDiskWatch.
+ *
+ *      This runs at idle priority so that a drive that
+ *      takes long to respond only ever holds up this
+ *      thread.
+ */
+
+STATIC void _Optlink fntDiskWatchSlow(PTHREADINFO ptiMyself)
+{
+    DosSetPriority(PRTYS_THREAD,
+                   PRTYC_IDLETIME,
+                   PRTYD_MAXIMUM,
+                   0);
+
+    WatchDrives(ptiMyself, TRUE);
+}
+
+/*
+ *@@ fntDiskWatch:
+ *      drive monitor thread.
+ *
+ *      This polls the local hard disks only. Everything
+ *      else is polled by fntDiskWatchSlow, which this
+ *      starts.
+ *
+ *      OS/2 has no file system change notifications that
+ *      the daemon could wait on, so both threads poll,
+ *      but they back off while nothing changes and wake
+ *      up early when a watch is added.
+ *
+ *@@added V0.9.14 (2001-08-01) [umoeller]
+ */
+
+void _Optlink fntDiskWatch(PTHREADINFO ptiMyself)
+{
+    if (LockDrivesList())
+    {
+        // tell main() we're done
+        DosPostEventSem(ptiMyself->hevRunning);
+
+        UnlockDrivesList();
+    }
+
+    thrCreate(&G_tiDiskWatchSlow,
+              fntDiskWatchSlow,
+              NULL,
+              "DiskWatchSlow",
+              0,
+              0);
+
+    WatchDrives(ptiMyself, FALSE);
+
+    G_tiDiskWatchSlow.fExit = TRUE;
+    DosPostEventSem(G_hevWakeSlow);
+}
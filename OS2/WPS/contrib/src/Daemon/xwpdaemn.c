@@ -210,6 +210,7 @@
 #include "helpers\gpih.h"
 #include "helpers\linklist.h"           // linked list helper routines
 #include "helpers\regexp.h"             // extended regular expressions
+#include "helpers\sem.h"                // lockExchange for the hook event queue
 #include "helpers\shapewin.h"
 #include "helpers\standards.h"
 #include "helpers\threads.h"
@@ -334,6 +335,9 @@ ULONG           G_ulAutoScrollTick = 0;
 
 THREADINFO      G_tiWinlistThread = {0};
 
+// prototypes
+MRESULT EXPENTRY fnwpDaemonObject(HWND hwndObject, ULONG msg, MPARAM mp1, MPARAM mp2);
+
 /* ******************************************************************
  *
  *   Exception hooks (except.c)
@@ -1371,8 +1375,292 @@ STATIC VOID ProcessSlidingFocus(HWND hwndFrameInBetween, // in: != NULLHANDLE if
     }
 }
 
+/*
+ *@@ ProcessSlidingFocusCheck:
+ *      implementation for XDM_SLIDINGFOCUSCHECK in
+ *      fnwpDaemonObject.
+ *
+ *      This evaluates the window that was last under
+ *      the mouse (as stored in HOOKDATA by the hook's
+ *      WM_MOUSEMOVE processing) to find out whether
+ *      the mouse has moved over a new frame window.
+ *      If so, the XDM_SLIDINGFOCUS processing is run
+ *      directly, which does the actual focus and active
+ *      window processing (starting a timer, if delayed
+ *      focus is active).
+ *
+ *      Processing is fairly complicated because special
+ *      case checks are needed for certain window classes
+ *      (combo boxes, Win-OS/2 windows). Basically, this
+ *      function finds the frame window to which the window
+ *      under the mouse belongs. If another frame is found
+ *      between the main frame and that window, that frame
+ *      is used also.
+ *
+ *      This used to be WMMouseMove_SlidingFocus in the
+ *      hook, which ran these window class queries for
+ *      every mouse move in every PM process. The hook now
+ *      only stores the window and posts this message once
+ *      until it has been processed, so bursts of mouse
+ *      moves collapse into one check here.
+ *
+ *      Inspired by code from ProgramCommander (W) Roman Stangl.
+ *      Fixed a few problems with MDI frames.
+ *
+ *@@changed V0.9.3 (2000-05-22) [umoeller]: fixed combobox problems
+ *@@changed V0.9.3 (2000-05-22) [umoeller]: fixed MDI frames problems
+ *@@changed V0.9.4 (2000-06-12) [umoeller]: fixed Win-OS/2 menu problems
+ *@@changed V0.9.9 (2001-03-14) [lafaix]: disabling sliding when processing mouse switch
+ *@@changed V0.9.19 (2002-06-02) [umoeller]: fixed idiocy with Mozilla menus
+ */
+
+STATIC VOID ProcessSlidingFocusCheck(HWND hwndObject)
+{
+    static HWND hwndLastFrameUnderMouse = NULLHANDLE,
+                hwndLastSubframeUnderMouse = NULLHANDLE;
+
+    HWND    hwnd;
+    BOOL    fMouseMoved,
+            fStopTimers = FALSE;    // setting this to TRUE will stop timers
+
+    // rearm the hook first so that a mouse move that
+    // comes in while we're working posts another check
+    lockExchange((PLONG)&G_pHookData->fSlidingCheckQueued, FALSE);
+    hwnd = G_pHookData->hwndSlidingUnderMouse;
+    fMouseMoved = lockExchange((PLONG)&G_pHookData->fSlidingMouseMoved, FALSE);
+
+#ifndef __NOPAGER__
+    if (G_pHookData->fProcessingWraparound)
+        return;
+
+    do      // just a do for breaking, no loop
+    {
+        // get currently active window; this can only
+        // be a frame window (WC_FRAME)
+        HWND    hwndActiveNow;
+
+        // check 1: check if the active window is still the
+        //          the one which was activated by ourselves
+        //          previously (either by the hook during WM_BUTTON1DOWN
+        //          or by the daemon in sliding focus processing):
+        if (hwndActiveNow = WinQueryActiveWindow(HWND_DESKTOP))
+        {
+            if (hwndActiveNow != G_pHookData->hwndActivatedByUs)
+            {
+                // active window is not the one we set active:
+                // this probably means that some new
+                // window popped up which we haven't noticed
+                // and was explicitly made active either by the
+                // shell or by an application, so we use this
+                // for the below checks. Otherwise, sliding focus
+                // would be disabled after a new window has popped
+                // up until the mouse was moved over a new frame window.
+                hwndLastFrameUnderMouse = hwndActiveNow;
+                hwndLastSubframeUnderMouse = NULLHANDLE;
+                G_pHookData->hwndActivatedByUs = hwndActiveNow;
+
+                fStopTimers = TRUE;
+                        // this will be overridden if we start a new
+                        // timer below; but just in case an old timer
+                        // might still be running V0.9.4 (2000-08-03) [umoeller]
+            }
+        }
+
+        if (    (fMouseMoved)            // has mouse really moved?
+             && (hwnd)
+           )
+        {
+            // OK:
+            HWND    hwndDesktopChild = hwnd,
+                    hwndTempParent = NULLHANDLE,
+                    hwndFrameInBetween = NULLHANDLE;
+            HWND    hwndFocusNow = WinQueryFocus(HWND_DESKTOP);
+            CHAR    szClassName[30],
+                    szWindowText[30];
+
+            // check 2: make sure mouse is not captured
+            if (WinQueryCapture(HWND_DESKTOP) != NULLHANDLE)
+            {
+                // stop timers and quit
+                fStopTimers = TRUE;
+                break;
+            }
+
+            // check 3: quit if menu has the focus
+            if (hwndFocusNow)
+            {
+                CHAR    szFocusClass[MAXNAMEL+4] = "";
+                WinQueryClassName(hwndFocusNow,
+                                  sizeof(szFocusClass),
+                                  szFocusClass);
+
+                if (!strcmp(szFocusClass, "#4"))
+                {
+                    // menu:
+                    // stop timers and quit
+                    fStopTimers = TRUE;
+                    break;
+                }
+            }
+
+            // now climb up the parent window hierarchy of the
+            // window under the mouse (first: hwndDesktopChild)
+            // until we reach the Desktop; the last window we
+            // had is then in hwndDesktopChild
+            hwndTempParent = WinQueryWindow(hwndDesktopChild, QW_PARENT);
+            while (     (hwndTempParent != G_pHookData->hwndPMDesktop)
+                     && (hwndTempParent != NULLHANDLE)
+                  )
+            {
+                WinQueryClassName(hwndDesktopChild,
+                                  sizeof(szClassName), szClassName);
+                if (!strcmp(szClassName, "#1"))
+                    // it's a frame:
+                    hwndFrameInBetween = hwndDesktopChild;
+                hwndDesktopChild = hwndTempParent;
+                hwndTempParent = WinQueryWindow(hwndDesktopChild, QW_PARENT);
+            }
+
+            if (hwndFrameInBetween == hwndDesktopChild)
+                hwndFrameInBetween = NULLHANDLE;
+
+            // hwndDesktopChild now has the window which we need to activate
+            // (the topmost parent under the desktop of the window under the mouse)
+
+            WinQueryClassName(hwndDesktopChild,
+                              sizeof(szClassName), szClassName);
+
+            // check 4: skip certain window classes
+
+            if (    (!strcmp(szClassName, "#4"))
+                            // menu
+                 || (!strcmp(szClassName, "#7"))
+                         // listbox: as a desktop child, this must be a
+                         // a drop-down box which is currently open
+                 || (!strcmp(szClassName, "MozillaWindowClass"))
+                         // this fixes mozilla popup menus; those
+                         // are a MozillaWindowClass as child of
+                         // HWND_DESKTOP (this does not break the
+                         // main Mozilla windows because those have
+                         // a WC_FRAME)
+                         // V0.9.19 (2002-06-02) [umoeller]
+               )
+            {
+                // stop timers and quit
+                fStopTimers = TRUE;
+                break;
+            }
+
+            WinQueryWindowText(hwndDesktopChild, sizeof(szWindowText), szWindowText);
+            if (strstr(szWindowText, "Seamless"))
+                // ignore seamless Win-OS/2 menus; these are separate windows!
+            {
+                // stop timers and quit
+                fStopTimers = TRUE;
+                break;
+            }
+
+            // OK, enough checks.
+            // Now let's do the sliding focus if
+            // 1) the desktop window (hwndDesktopChild, highest parent) changed or
+            // 2) if hwndDesktopChild has several subframes and the subframe changed:
+
+            if (hwndDesktopChild)
+                if (    (hwndDesktopChild != hwndLastFrameUnderMouse)
+                     || (   (hwndFrameInBetween != NULLHANDLE)
+                         && (hwndFrameInBetween != hwndLastSubframeUnderMouse)
+                        )
+                   )
+                {
+                    // OK, mouse moved to a new desktop window:
+                    // store that for next time
+                    hwndLastFrameUnderMouse = hwndDesktopChild;
+                    hwndLastSubframeUnderMouse = hwndFrameInBetween;
+
+                    // do the rest (timer handling, window
+                    // activation etc.) right here
+                    fnwpDaemonObject(hwndObject,
+                                     XDM_SLIDINGFOCUS,
+                                     (MPARAM)hwndFrameInBetween,  // can be NULLHANDLE
+                                     (MPARAM)hwndDesktopChild);
+                    fStopTimers = FALSE;
+                }
+        }
+    } while (FALSE); // end do
+
+    if (fStopTimers)
+        fnwpDaemonObject(hwndObject,
+                         XDM_SLIDINGFOCUS,
+                         (MPARAM)NULLHANDLE,
+                         (MPARAM)NULLHANDLE);     // stop timers
+}
+
+
 #endif
 
+/*
+ *@@ ProcessHookEvents:
+ *      implementation for XDM_HOOKEVENTS in fnwpDaemonObject.
+ *
+ *      The hook does not post most notifications to us
+ *      directly any more but appends them to the
+ *      HOOKQUEUE ring in the shared HOOKDATA (see
+ *      hookPostDaemon). Only the first event after the
+ *      ring went empty rings the doorbell by posting
+ *      XDM_HOOKEVENTS, so we drain everything that has
+ *      been published since then in one go and dispatch
+ *      each event to ourselves as if it had been posted.
+ *
+ *      We are the only consumer, so lHead needs no
+ *      interlocked access. To keep the message queue
+ *      responsive, at most HOOKQUEUE_SIZE events are
+ *      processed per call; if more are pending, we post
+ *      XDM_HOOKEVENTS again.
+ */
+
+STATIC VOID ProcessHookEvents(HWND hwndObject)
+{
+    PHOOKQUEUE  pQueue = &G_pHookData->Queue;
+    ULONG       c = 0;
+
+    // clear the doorbell before looking at the ring, so
+    // that an event published after our last check
+    // posts a new XDM_HOOKEVENTS
+    lockExchange((PLONG)&pQueue->fDoorbell, FALSE);
+
+    while (c < HOOKQUEUE_SIZE)
+    {
+        LONG        lPos = pQueue->lHead;
+        PHOOKEVENT  pEvent = &pQueue->aEvents[lPos & HOOKQUEUE_MASK];
+        ULONG       msg;
+        MPARAM      mp1, mp2;
+
+        if (pEvent->ulSeq != (ULONG)(lPos + 1))
+            // not published yet: ring is empty
+            break;
+
+        msg = pEvent->msg;
+        mp1 = pEvent->mp1;
+        mp2 = pEvent->mp2;
+
+        // hand the slot back to the producers for the
+        // next lap around the ring
+        pEvent->ulSeq = lPos + HOOKQUEUE_SIZE;
+        pQueue->lHead = lPos + 1;
+
+        fnwpDaemonObject(hwndObject, msg, mp1, mp2);
+        ++c;
+    }
+
+    if (    (c == HOOKQUEUE_SIZE)
+         && (!lockExchange((PLONG)&pQueue->fDoorbell, TRUE))
+       )
+        WinPostMsg(hwndObject,
+                   XDM_HOOKEVENTS,
+                   0,
+                   0);
+}
+
 /*
  *@@ ProcessHotCorner:
  *      implementation for XDM_HOTCORNER in fnwpDaemonObject.
@@ -2301,6 +2589,26 @@ STATIC VOID ProcessNotifies(ULONG ulMsgOffset,
     }
 }
 
+/*
+ *@@ IsWinlistWindow:
+ *      returns TRUE if hwnd is of one of the window
+ *      classes that can appear in the window list
+ *      (see IS_WINLIST_CLASS in hook_private.h).
+ *
+ *      The hook's ProcessMsgsForWinlist used to check
+ *      this in every PM process; it now passes all
+ *      desktop children on and we check here.
+ */
+
+STATIC BOOL IsWinlistWindow(HWND hwnd)
+{
+    CHAR    szClass[30];
+
+    return (    (WinQueryClassName(hwnd, sizeof(szClass), szClass))
+             && (IS_WINLIST_CLASS(szClass))
+           );
+}
+
 /*
  *@@ ProcessWindowChange:
  *      implementation for XDM_WINDOWCHANGE in fnwpDaemonObject.
@@ -2316,6 +2624,12 @@ STATIC VOID ProcessWindowChange(MPARAM mp1, MPARAM mp2)
 {
     BOOL fPost = TRUE;
 
+    if (    ((ULONG)mp2 != WM_DESTROY)
+         && (!IsWinlistWindow((HWND)mp1))
+       )
+        // the hook no longer filters these
+        return;
+
     // refresh the list
     switch ((ULONG)mp2)
     {
@@ -2354,7 +2668,9 @@ STATIC VOID ProcessWindowChange(MPARAM mp1, MPARAM mp2)
 
 STATIC VOID ProcessIconChange(MPARAM mp1, MPARAM mp2)
 {
-    if (pgrIconChange((HWND)mp1, (HPOINTER)mp2))
+    if (    (IsWinlistWindow((HWND)mp1))
+         && (pgrIconChange((HWND)mp1, (HPOINTER)mp2))
+       )
     {
         // process notifies
         ProcessNotifies(PN_ICONCHANGE,
@@ -2752,8 +3068,36 @@ MRESULT EXPENTRY fnwpDaemonObject(HWND hwndObject, ULONG msg, MPARAM mp1, MPARAM
                         ProcessSlidingFocus(G_hwndSlidingUnderMouse,
                                             G_hwndSliding2Activate);
             break;
+
+            /*
+             *@@ XDM_SLIDINGFOCUSCHECK:
+             *      posted by the hook after WM_MOUSEMOVE when
+             *      sliding focus is enabled and no check is
+             *      pending yet. The window under the mouse is
+             *      in HOOKDATA; see ProcessSlidingFocusCheck.
+             *
+             *      No parameters.
+             */
+
+            case XDM_SLIDINGFOCUSCHECK:
+                ProcessSlidingFocusCheck(hwndObject);
+            break;
 #endif
 
+            /*
+             *@@ XDM_HOOKEVENTS:
+             *      posted by the hook (hookPostDaemon) when it
+             *      has put the first event into the HOOKQUEUE
+             *      ring in HOOKDATA after the ring went empty.
+             *      See ProcessHookEvents.
+             *
+             *      No parameters.
+             */
+
+            case XDM_HOOKEVENTS:
+                ProcessHookEvents(hwndObject);
+            break;
+
             /*
              *@@ XDM_SLIDINGMENU:
              *      message posted by the hook when the mouse
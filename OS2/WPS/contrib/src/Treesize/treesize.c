@@ -38,6 +38,7 @@
  */
 
 #define INCL_DOSPROCESS
+#define INCL_DOSSEMAPHORES
 #define INCL_DOSMODULEMGR
 #define INCL_DOSMISC
 #define INCL_DOSERRORS
@@ -68,13 +69,11 @@
 #include "helpers\pmprintf.h"
 #include "helpers\comctl.h"
 #include "helpers\cnrh.h"
-#include "helpers\eah.h"
 #include "helpers\dosh.h"
 #include "helpers\nls.h"
 #include "helpers\nlscache.h"       // added V1.0.4 (2005-02-24) [chennecke]: load NLS strings from resource DLL
 #include "helpers\standards.h"
 #include "helpers\stringh.h"
-#include "helpers\tree.h"
 #include "helpers\winh.h"
 
 #include "bldlevel.h"
@@ -107,6 +106,20 @@ HMQ         G_hmqCollect;
 // setting this to TRUE will stop the Collect thread
 BOOL        G_fStopThread = FALSE;
 
+// scanner threads started by the Collect thread
+#define SCANNER_THREADS     4
+TID         G_atidScanners[SCANNER_THREADS];
+// buffer size for DosFindFirst/Next in each scanner thread
+#define FINDBUF_SIZE        (60 * 1024)
+// protects the queue, the DIRINFO totals and the largest files
+HMTX        G_hmtxCollect = NULLHANDLE;
+// posted when directories have been queued or scanned
+HEV         G_hevQueue = NULLHANDLE;
+// directories waiting for a scanner thread
+PDIRINFO    G_pdiQueue = NULL;
+// directories being scanned right now
+ULONG       G_cScanning = 0;
+
 // DIRINFO struct for the directory to start with
 PDIRINFO    G_pdiRoot;
 
@@ -118,8 +131,10 @@ struct {
     BOOL        LowPriority;
 } G_Settings;
 
-TREE    *G_LargestFilesTree;
-LONG    G_cLargestFilesTree = 0;
+// min-heap of the largest files, see AddLargestFile
+#define LARGEST_FILES       100
+PFILEENTRY  G_apLargestFiles[LARGEST_FILES];
+ULONG       G_cLargestFiles = 0;
 
 const char      *G_pcszXFldTreesize = "XFldTreesize";
 
@@ -156,20 +171,160 @@ PRECORDCORE G_precParentOf100Largest = NULL;
  *
  ********************************************************************/
 
+/*
+ * QueueDirectory:
+ *      creates a DIRINFO for the subdirectory pszName
+ *      of pdiParent and puts it on the queue for the
+ *      scanner threads.
+ *
+ *      Each DIRINFO counts the directories that are not
+ *      done yet in cPending (itself plus each queued
+ *      subdirectory), so that FinishDirectory knows when
+ *      a whole subtree is done.
+ */
+
+VOID QueueDirectory(PDIRINFO pdiParent,
+                    PSZ pszParentDir,       // with trailing "\"
+                    PSZ pszName)
+{
+    PDIRINFO pdi;
+
+    if (pdi = malloc(sizeof(DIRINFO)))
+    {
+        pdi->ulFiles = 0;
+        pdi->dTotalSize0 = 0;
+        pdi->dTotalEASize = 0;
+        pdi->pParent = pdiParent;
+        strcpy(pdi->szThis, pszName);
+        sprintf(pdi->szFullPath, "%s%s", pszParentDir, pszName);
+        pdi->ulRecursionLevel = pdiParent->ulRecursionLevel + 1;
+        pdi->cPending = 1;
+
+        DosRequestMutexSem(G_hmtxCollect, SEM_INDEFINITE_WAIT);
+        pdiParent->cPending++;
+        // LIFO, so that we go depth-first like the recursion did
+        pdi->pNextQueued = G_pdiQueue;
+        G_pdiQueue = pdi;
+        DosReleaseMutexSem(G_hmtxCollect);
+
+        DosPostEventSem(G_hevQueue);
+    }
+}
+
+/*
+ * FinishDirectory:
+ *      called with G_hmtxCollect held when a directory has
+ *      been scanned or one of its subtrees is done. Posts
+ *      TSM_DONEDIRECTORY for every directory whose whole
+ *      subtree is now done.
+ */
+
+VOID FinishDirectory(PDIRINFO pdiThis)
+{
+    while (    (pdiThis)
+            && (!(--pdiThis->cPending))
+          )
+    {
+        // have record core updated with new total size
+        WinPostMsg(G_hwndMain, TSM_DONEDIRECTORY, (MPARAM)pdiThis, NULL);
+        pdiThis = pdiThis->pParent;
+    }
+}
+
+/*
+ * AddLargestFile:
+ *      adds a file to G_apLargestFiles if it is among the
+ *      LARGEST_FILES largest files found so far.
+ *
+ *      G_apLargestFiles is a min-heap by size, so the
+ *      smallest of them is always at the top and can be
+ *      replaced cheaply. This way we never keep more than
+ *      LARGEST_FILES entries, however many files there are.
+ */
+
+VOID AddLargestFile(PDIRINFO pdi,
+                    PSZ pszFilename,
+                    double dSize)
+{
+    PFILEENTRY  pEntry = NULL;
+    ULONG       ul;
+
+    DosRequestMutexSem(G_hmtxCollect, SEM_INDEFINITE_WAIT);
+
+    if (G_cLargestFiles < LARGEST_FILES)
+    {
+        // heap not full yet: append and sift up
+        if (pEntry = NEW(FILEENTRY))
+        {
+            pEntry->pDir = pdi;
+            pEntry->pszFilename = strdup(pszFilename);
+            pEntry->dSize = dSize;
+
+            ul = G_cLargestFiles++;
+            while (ul)
+            {
+                ULONG ulParent = (ul - 1) / 2;
+                if (G_apLargestFiles[ulParent]->dSize <= dSize)
+                    break;
+                G_apLargestFiles[ul] = G_apLargestFiles[ulParent];
+                ul = ulParent;
+            }
+            G_apLargestFiles[ul] = pEntry;
+        }
+    }
+    else if (dSize > G_apLargestFiles[0]->dSize)
+    {
+        // larger than the smallest we have: replace that
+        // and sift down
+        pEntry = G_apLargestFiles[0];
+        free(pEntry->pszFilename);
+        pEntry->pDir = pdi;
+        pEntry->pszFilename = strdup(pszFilename);
+        pEntry->dSize = dSize;
+
+        ul = 0;
+        while (TRUE)
+        {
+            ULONG ulChild = 2 * ul + 1;
+            if (ulChild >= G_cLargestFiles)
+                break;
+            if (    (ulChild + 1 < G_cLargestFiles)
+                 && (G_apLargestFiles[ulChild + 1]->dSize < G_apLargestFiles[ulChild]->dSize)
+               )
+                ulChild++;
+            if (G_apLargestFiles[ulChild]->dSize >= dSize)
+                break;
+            G_apLargestFiles[ul] = G_apLargestFiles[ulChild];
+            ul = ulChild;
+        }
+        G_apLargestFiles[ul] = pEntry;
+    }
+
+    DosReleaseMutexSem(G_hmtxCollect);
+}
+
 /*
  * CollectDirectory:
- *      initially called by the Collect thread (fntCollect)
- *      and then calls itself recursively for each
- *      directory it finds.
- *      Takes a DIRINFO structure, which is also initially
- *      created by the Collect thread.
+ *      called by a scanner thread (ScanQueue) for each
+ *      directory taken from the queue. This scans the
+ *      files of that directory and queues its
+ *      subdirectories for the scanner threads.
+ *
  *      This sends two messages to the main window (fnwpMain):
  *      WM_BEGINDIRECTORY, which causes the record core
- *      to be created, and WM_ENDDIRECTORY, which causes
- *      the record core to be updated with the directory size,
- *      when processing of this directory (and all the subdirs)
+ *      to be created, and WM_DONEDIRECTORY (through
+ *      FinishDirectory), which causes the record core
+ *      to be updated with the directory size, when
+ *      processing of this directory (and all the subdirs)
  *      is done with.
  *
+ *      pbFind is the scanner thread's FINDBUF_SIZE buffer
+ *      for DosFindFirst/Next, which now returns as many
+ *      entries per call as fit in there. If EAs are
+ *      collected, the EA sizes come with the same call
+ *      (FIL_QUERYEASIZEL) instead of one eaPathQueryTotalSize
+ *      per file.
+ *
  *@@changed V0.9.14 (2001-07-28) [umoeller]: added largest files collect
  *@@changed V0.9.14 (2001-07-28) [umoeller]: now using WinPostMsg, which is speedier
  *@@changed V1.0.4 (2005-02-24) [chennecke]: replaced hard-coded strings with corresponding nlsGetString() calls
@@ -177,15 +332,15 @@ PRECORDCORE G_precParentOf100Largest = NULL;
  *@@changed V1.0.9 (2010-07-22) [pr]: fix missing files caused by duplicate tree keys
  */
 
-VOID CollectDirectory(PDIRINFO pdiThis)
+VOID CollectDirectory(PDIRINFO pdiThis,
+                      PBYTE pbFind)
 {
     HDIR          hdirFindHandle = HDIR_CREATE;
-    FILEFINDBUF3L ffb3     = {0};      /* Returned from FindFirst/Next */
-    ULONG         cbFFB3 = sizeof(ffb3);
-    ULONG         ulFindCount    = 1;        /* Look for 1 file at a time    */
+    ULONG         ulFindCount;
     APIRET        rc             = NO_ERROR; /* Return code                  */
     CHAR          szCurrentDir[CCHMAXPATH],
                   szSearchMask[CCHMAXPATH];
+    BOOL          fEAs;
 
     ULONG         ulFilesThisDir = 0;
     double        dSizeThisDir = 0,
@@ -196,11 +351,17 @@ VOID CollectDirectory(PDIRINFO pdiThis)
     if (szCurrentDir[strlen(szCurrentDir)-1] != '\\')
         strcat(szCurrentDir, "\\");
 
+    fEAs = (    (G_Settings.CollectEAs)
+             && (strlen(szCurrentDir) > 3)
+           );
+
     // have record core inserted; since we're SENDing this
     // msg (and not posting), this also takes care of
     // thread synchronization so that the record cores don't
     // get messed up. Sending messages across threads blocks
     // the calling thread until the msg has been processed.
+    // Since subdirectories are only queued below, the
+    // parent record always exists before the child's.
     // Ah yes, and this is why we may only send this if our
     // thread hasn't been requested to terminate. In that case,
     // the main window might just be being destroyed, so this
@@ -208,101 +369,81 @@ VOID CollectDirectory(PDIRINFO pdiThis)
     if (!G_fStopThread)
         WinSendMsg(G_hwndMain, TSM_BEGINDIRECTORY, (MPARAM)pdiThis, NULL);
 
-    // now go for the first directory entry in our directory (szCurrentDir):
+    // now go for the first directory entries in our directory (szCurrentDir):
     strcpy(szSearchMask, szCurrentDir);
     strcat(szSearchMask, "*");
+    ulFindCount = FINDBUF_SIZE / sizeof(FILEFINDBUF4L);
     rc = DosFindFirst( szSearchMask,
                        &hdirFindHandle,
                        // find eeeeverything
                        FILE_ARCHIVED | FILE_HIDDEN | FILE_SYSTEM | FILE_READONLY | FILE_DIRECTORY,
-                       &ffb3,
-                       cbFFB3,
+                       pbFind,
+                       FINDBUF_SIZE,
                        &ulFindCount,
-                       FIL_STANDARDL);
+                       (fEAs) ? FIL_QUERYEASIZEL : FIL_STANDARDL);
 
     // and start looping
     while (     (rc == NO_ERROR)
             &&  (!G_fStopThread)      // if our thread hasn't been stopped
           )
     {
-        CHAR szFile[CCHMAXPATH];
-        ULONG ulEASize;
+        PBYTE pbEntry = pbFind;
 
-        sprintf(szFile, "%s%s", szCurrentDir, // always has trailing "\"
-                                ffb3.achName);
-
-        // get EA size
-        if (    (G_Settings.CollectEAs)
-             && (strlen(szCurrentDir) > 3)
-           )
+        while (ulFindCount--)
         {
-            ulEASize = eaPathQueryTotalSize(szFile);
-            _Pmpf(("EAs for %s: %d", ffb3.achName, ulEASize));
-            dEASizeThisDir += ulEASize;
-        }
+            // FILEFINDBUF3L and FILEFINDBUF4L are the same up to attrFile
+            PFILEFINDBUF3L  pffb3 = (PFILEFINDBUF3L)pbEntry;
+            PSZ             pszName;
 
-        if (ffb3.attrFile & FILE_DIRECTORY)
-        {
-            if (    (strcmp(ffb3.achName, ".") != 0)
-                 && (strcmp(ffb3.achName, "..") != 0)
-               )
+            if (fEAs)
             {
-                // subdirectory found: recurse!
-
-                // create new DIRINFO for the recursive call
-                PDIRINFO pdiRecurse = malloc(sizeof(DIRINFO));
-                pdiRecurse->ulFiles = 0;
-                pdiRecurse->dTotalSize0 = 0;
-                pdiRecurse->dTotalEASize = 0;
-                pdiRecurse->pParent = pdiThis;
-                strcpy(pdiRecurse->szThis, ffb3.achName);
-                strcpy(pdiRecurse->szFullPath, szFile);
-                pdiRecurse->ulRecursionLevel = pdiThis->ulRecursionLevel + 1;
-                // and go!
-                CollectDirectory(pdiRecurse);
+                PFILEFINDBUF4L pffb4 = (PFILEFINDBUF4L)pbEntry;
+                pszName = pffb4->achName;
+                // cbList is the size of the file's FEA2LIST, which
+                // is four bytes if the file has no EAs
+                if (pffb4->cbList > 4)
+                    dEASizeThisDir += pffb4->cbList;
             }
-        }
-        else
-        {
-            // regular file:
-            ulFilesThisDir++;
-            // add to total size
-            dSizeThisDir += 65536.0 * 65536.0 * ffb3.cbFile.ulHi
-                            + ffb3.cbFile.ulLo;  // V1.0.9
+            else
+                pszName = pffb3->achName;
 
-            if (ffb3.cbFile.ulLo > 1024)
+            if (pffb3->attrFile & FILE_DIRECTORY)
             {
-                // create entry for largest files tree
-                PFILEENTRY pFileEntry = NEW(FILEENTRY);
-                if (pFileEntry)
-                {
-                    // V1.0.9
-                    PCHAR pszSize = malloc(40);
-
-                    pFileEntry->pDir = pdiThis;
-                    pFileEntry->pszFilename = strdup(ffb3.achName);
-                    pFileEntry->dSize = 65536.0 * 65536.0 * ffb3.cbFile.ulHi +
-                        ffb3.cbFile.ulLo;
-                    sprintf(pszSize, "%020.0f", floor(pFileEntry->dSize + 0.5));
-                    pFileEntry->Tree.ulKey = (ULONG) pszSize;
-
-                    treeInsert(&G_LargestFilesTree,
-                               &G_cLargestFilesTree,
-                               (TREE*)pFileEntry,
-                               treeCompareStrings);
-                }
+                if (    (strcmp(pszName, ".") != 0)
+                     && (strcmp(pszName, "..") != 0)
+                   )
+                    // subdirectory found: have it scanned
+                    QueueDirectory(pdiThis, szCurrentDir, pszName);
+            }
+            else
+            {
+                double dSize =   65536.0 * 65536.0 * pffb3->cbFile.ulHi
+                               + pffb3->cbFile.ulLo;  // V1.0.9
+
+                // regular file:
+                ulFilesThisDir++;
+                // add to total size
+                dSizeThisDir += dSize;
+
+                if (dSize > 1024)
+                    AddLargestFile(pdiThis, pszName, dSize);
             }
+
+            pbEntry += pffb3->oNextEntryOffset;
         }
 
+        ulFindCount = FINDBUF_SIZE / sizeof(FILEFINDBUF4L);
         rc = DosFindNext(hdirFindHandle,
-                         &ffb3,
-                         cbFFB3,
+                         pbFind,
+                         FINDBUF_SIZE,
                          &ulFindCount);
 
     } /* endwhile */
 
     DosFindClose(hdirFindHandle);
 
+    DosRequestMutexSem(G_hmtxCollect, SEM_INDEFINITE_WAIT);
+
     // now that we're done with this directory:
     // store the sizes in the current DIRINFO
     pdiThis->ulFiles += ulFilesThisDir;
@@ -322,19 +463,100 @@ VOID CollectDirectory(PDIRINFO pdiThis)
             pdiParent->dTotalSize0 += dSizeThisDir;
             pdiParent->dTotalEASize += dEASizeThisDir;
             pdiParent = pdiParent->pParent;
-            // pdiThis2 = pdiThis2->pParent;
         }
 
-        // have record core updated with new total size
-        WinPostMsg(G_hwndMain, TSM_DONEDIRECTORY, (MPARAM)pdiThis, NULL);
+        FinishDirectory(pdiThis);
     }
 
-    // end of function: if this was a recursive call,
-    // this will continue collecting files in the parent
-    // directory. If this was the "root" call from fntCollect,
-    // the Collect thread will then terminate.
+    DosReleaseMutexSem(G_hmtxCollect);
 };
 
+/*
+ * ScanQueue:
+ *      loop of a scanner thread: takes directories off
+ *      the queue and scans them until the queue is empty
+ *      and no other scanner is busy any more (which could
+ *      still queue subdirectories), or until the Collect
+ *      thread is stopped.
+ */
+
+VOID ScanQueue(PBYTE pbFind)
+{
+    while (!G_fStopThread)
+    {
+        PDIRINFO pdi;
+        ULONG    ulPosts;
+
+        DosRequestMutexSem(G_hmtxCollect, SEM_INDEFINITE_WAIT);
+        if (pdi = G_pdiQueue)
+        {
+            G_pdiQueue = pdi->pNextQueued;
+            G_cScanning++;
+        }
+        else if (!G_cScanning)
+        {
+            // nothing queued and nobody left to queue more:
+            // wake up the other scanners so they see it too
+            DosReleaseMutexSem(G_hmtxCollect);
+            DosPostEventSem(G_hevQueue);
+            break;
+        }
+        else
+            DosResetEventSem(G_hevQueue, &ulPosts);
+        DosReleaseMutexSem(G_hmtxCollect);
+
+        if (pdi)
+        {
+            CollectDirectory(pdi, pbFind);
+
+            DosRequestMutexSem(G_hmtxCollect, SEM_INDEFINITE_WAIT);
+            G_cScanning--;
+            DosReleaseMutexSem(G_hmtxCollect);
+            DosPostEventSem(G_hevQueue);
+        }
+        else
+            // wait for more work; time out to check G_fStopThread
+            DosWaitEventSem(G_hevQueue, 100);
+    }
+}
+
+/*
+ * fntScanner:
+ *      scanner thread, started SCANNER_THREADS times
+ *      by the Collect thread.
+ */
+
+void _System fntScanner(ULONG ulDummy)
+{
+    HAB     hab;
+    HMQ     hmq;
+    PBYTE   pbFind;
+
+    // we need a msg queue for WinSendMsg
+    if (hab = WinInitialize(0))
+    {
+        if (hmq = WinCreateMsgQueue(hab, 0))
+        {
+            // low priority?
+            DosSetPriority(PRTYS_THREAD,
+                           (G_Settings.LowPriority)
+                                ? PRTYC_IDLETIME
+                                : PRTYC_REGULAR,
+                           0,       // delta
+                           0);      // current thread
+
+            if (pbFind = malloc(FINDBUF_SIZE))
+            {
+                ScanQueue(pbFind);
+                free(pbFind);
+            }
+
+            WinDestroyMsgQueue(hmq);
+        }
+        WinTerminate(hab);
+    }
+}
+
 /*
  * fntCollect:
  *      Collect thread, started by fnwpMain below.
@@ -343,11 +565,19 @@ VOID CollectDirectory(PDIRINFO pdiThis)
  *      whether (tidCollect != 0). There is never
  *      more than one "instance" of this thread running.
  *
+ *      This queues the root directory and starts the
+ *      scanner threads, which work off the directory
+ *      queue together, and waits for them to finish.
+ *
  *@@changed V1.0.9 (2010-07-22) [pr]: fix memory leaks
  */
 
 void _System fntCollect(ULONG ulDummy)
 {
+    ULONG       ul,
+                cScanners = 0;
+    PDIRINFO    pdi;
+
     // we need a msg queue for WinSendMsg
     if (!(G_habCollect = WinInitialize(0)))
         return;
@@ -362,9 +592,15 @@ void _System fntCollect(ULONG ulDummy)
                    0,       // delta
                    0);      // current thread
 
-    treeInit(&G_LargestFilesTree, &G_cLargestFilesTree);
+    if (!G_hmtxCollect)
+    {
+        DosCreateMutexSem(NULL, &G_hmtxCollect, 0, FALSE);
+        DosCreateEventSem(NULL, &G_hevQueue, 0, FALSE);
+    }
 
-    // prepare "root" DIRINFO structure for CollectDirectory()
+    G_cLargestFiles = 0;
+
+    // prepare "root" DIRINFO structure for the scanners
     G_pdiRoot = (PDIRINFO)malloc(sizeof(DIRINFO));
     if (G_pdiRoot)
     {
@@ -375,7 +611,52 @@ void _System fntCollect(ULONG ulDummy)
         strcpy(G_pdiRoot->szThis, G_szRootDir);
         strcpy(G_pdiRoot->szFullPath, G_szRootDir);
         G_pdiRoot->ulRecursionLevel = 1;
-        CollectDirectory(G_pdiRoot);
+        G_pdiRoot->cPending = 1;
+        G_pdiRoot->pNextQueued = NULL;
+
+        G_pdiQueue = G_pdiRoot;
+        G_cScanning = 0;
+
+        for (ul = 0;
+             ul < SCANNER_THREADS;
+             ul++)
+            if (!DosCreateThread(&G_atidScanners[cScanners],
+                                 fntScanner,
+                                 0,
+                                 CREATE_READY,
+                                 4*65536))
+                cScanners++;
+
+        if (cScanners)
+            for (ul = 0;
+                 ul < cScanners;
+                 ul++)
+            {
+                TID tid = G_atidScanners[ul];
+                DosWaitThread(&tid, DCWW_WAIT);
+                G_atidScanners[ul] = 0;
+            }
+        else
+        {
+            // no threads: scan on this one then
+            PBYTE pbFind;
+            if (pbFind = malloc(FINDBUF_SIZE))
+            {
+                ScanQueue(pbFind);
+                free(pbFind);
+            }
+        }
+
+        // if we were stopped, free the directories that
+        // never got scanned; they have no record cores
+        // for Cleanup() to find
+        while (pdi = G_pdiQueue)
+        {
+            G_pdiQueue = pdi->pNextQueued;
+            if (pdi == G_pdiRoot)
+                G_pdiRoot = NULL;
+            free(pdi);
+        }
     }
 
     // report that we're done completely
@@ -448,7 +729,7 @@ VOID Cleanup(PSIZERECORD preccParent)
 
             if (precc2->pFileEntry)
             {
-                free((void *) precc2->pFileEntry->Tree.ulKey);
+                free(precc2->pFileEntry->pszFilename);
                 free(precc2->pFileEntry);
             }
 
@@ -592,6 +873,22 @@ PSZ ComposeFilename(PSZ pszBuf,
     return pszBuf;
 }
 
+/*
+ *@@ CompareLargestFiles:
+ *      qsort comparison func for sorting G_apLargestFiles
+ *      by size, largest first.
+ */
+
+int CompareLargestFiles(const void *p1, const void *p2)
+{
+    double d1 = (*(PFILEENTRY*)p1)->dSize,
+           d2 = (*(PFILEENTRY*)p2)->dSize;
+
+    if (d1 > d2)
+        return -1;
+    return (d1 < d2);
+}
+
 /*
  *@@ Insert100LargestFiles:
  *
@@ -603,18 +900,24 @@ PSZ ComposeFilename(PSZ pszBuf,
 
 VOID Insert100LargestFiles(VOID)
 {
-    ULONG cFiles;
+    ULONG cFiles,
+          ul = 0;
     PSIZERECORD precFirst;
-    cFiles = G_cLargestFilesTree;
-    if (cFiles > 100)
-        cFiles = 100;
+    cFiles = G_cLargestFiles;
+
+    // the heap is only partially ordered
+    qsort(G_apLargestFiles,
+          cFiles,
+          sizeof(PFILEENTRY),
+          CompareLargestFiles);
+
     if (precFirst = (PSIZERECORD)cnrhAllocRecords(G_hwndCnr,
                                                   sizeof(SIZERECORD),
                                                   cFiles))
     {
         PSIZERECORD precThis = precFirst;
 
-        PFILEENTRY pEntry = (PFILEENTRY)treeLast(G_LargestFilesTree);
+        PFILEENTRY pEntry = (cFiles) ? G_apLargestFiles[0] : NULL;
 
         CHAR szSize[200];
         CHAR szFilename[400],
@@ -671,7 +974,7 @@ VOID Insert100LargestFiles(VOID)
                 = strdup(szTemp);
 
             precThis = (PSIZERECORD)precThis->recc.preccNextRecord;
-            pEntry = (PFILEENTRY)treePrev((TREE*)pEntry);
+            pEntry = (++ul < cFiles) ? G_apLargestFiles[ul] : NULL;
         }
 
         cnrhInsertRecords(G_hwndCnr,
@@ -1004,11 +1307,14 @@ MRESULT EXPENTRY fnwpMain(HWND hwndDlg, ULONG msg, MPARAM mp1, MPARAM mp2)
                         NULL);
 
             // scroll to make root record visible
-            G_preccScrollTo = G_pdiRoot->precc;
-            WinStartTimer(WinQueryAnchorBlock(hwndDlg),
-                          hwndDlg,
-                          2,
-                          100);
+            if (G_pdiRoot)
+            {
+                G_preccScrollTo = G_pdiRoot->precc;
+                WinStartTimer(WinQueryAnchorBlock(hwndDlg),
+                              hwndDlg,
+                              2,
+                              100);
+            }
         }
         break;
 
@@ -1635,10 +1941,18 @@ MRESULT EXPENTRY fnwpMain(HWND hwndDlg, ULONG msg, MPARAM mp1, MPARAM mp2)
                     SaveSettings();
 
                     if (G_tidCollect)
+                    {
                         // collect thread running:
+                        ULONG ul;
                         DosSetPriority(PRTYS_THREAD,
                                        (G_Settings.LowPriority) ? PRTYC_IDLETIME : PRTYC_REGULAR,
                                        0, G_tidCollect);
+                        for (ul = 0; ul < SCANNER_THREADS; ul++)
+                            if (G_atidScanners[ul])
+                                DosSetPriority(PRTYS_THREAD,
+                                               (G_Settings.LowPriority) ? PRTYC_IDLETIME : PRTYC_REGULAR,
+                                               0, G_atidScanners[ul]);
+                    }
                 break;
 
                 case ID_TSMI_COLLECTEAS:
@@ -42,6 +42,8 @@ typedef struct _DIRINFO
     double              dTotalEASize;
     ULONG               ulRecursionLevel;       // 1 for root level
     PRECORDCORE         precc;      // PSIZERECORD actually
+    struct _DIRINFO     *pNextQueued;           // next in the scanner queue
+    LONG                cPending;               // this dir + subdirs not done yet
 } DIRINFO, *PDIRINFO;
 
 /*
@@ -53,7 +55,6 @@ typedef struct _DIRINFO
 
 typedef struct _FILEENTRY
 {
-    TREE        Tree;
     PDIRINFO    pDir;
     PSZ         pszFilename;
     double      dSize;
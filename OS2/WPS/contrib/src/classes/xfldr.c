@@ -1657,6 +1657,7 @@ SOM_Scope void  SOMLINK xf_wpInitData(XFolder *somSelf)
 
     treeInit((TREE**)&_FileSystemsTreeRoot,
              &_cFileSystems);
+    _FileSystemsHash = NULL;
     treeInit((TREE**)&_AbstractsTreeRoot,
              &_cAbstracts);
 
@@ -1817,6 +1818,9 @@ SOM_Scope void  SOMLINK xf_wpUnInitData(XFolder *somSelf)
 
     wpshStore(somSelf, &_pWszDefaultDocDeferred, NULL, NULL);
 
+    // free the name hash of the content tree
+    FREE(_FileSystemsHash);
+
     // lock out the folder auto-refresh
     if (fdrGetNotifySem(SEM_INDEFINITE_WAIT))
     {
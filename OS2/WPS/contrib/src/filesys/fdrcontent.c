@@ -428,11 +428,181 @@ VOID fdrReleaseNotifySem(VOID)
  *
  ********************************************************************/
 
+/*
+ *@@ FDRCONTENTHASH:
+ *      open-addressing hash table over a folder's
+ *      FDRCONTENTITEM's for WPFileSystem objects,
+ *      stored in XFolder's FileSystemsHash.
+ *
+ *      The tree in FileSystemsTreeRoot remains the
+ *      master copy (it is needed for sorted iteration);
+ *      this only makes finding an object by name cheap,
+ *      which fdrQueryAwakeFSObject and the auto-refresh
+ *      code do all the time. treeFind has to run a
+ *      strcmp on every level of the tree, while this
+ *      compares the precomputed FDRCONTENTITEM.ulHash
+ *      first and runs a single strcmp in the usual case.
+ *
+ *      Slots use linear probing; removed items leave
+ *      a HASH_DELETED marker so that probe chains stay
+ *      intact until the next rebuild.
+ */
+
+typedef struct _FDRCONTENTHASH
+{
+    ULONG           cSlots;         // always a power of two
+    ULONG           cFilled;        // items plus HASH_DELETED markers
+    PFDRCONTENTITEM apItems[1];     // really cSlots items
+} FDRCONTENTHASH, *PFDRCONTENTHASH;
+
+#define HASH_DELETED        ((PFDRCONTENTITEM)-1)
+#define HASH_MINSLOTS       64
+
+/*
+ *@@ HashUpperName:
+ *      returns the hash value for an upper-cased
+ *      short real name (FNV-1a).
+ */
+
+STATIC ULONG HashUpperName(PCSZ pcszUpperName)
+{
+    ULONG ulHash = 2166136261UL;
+    const UCHAR *p = (const UCHAR*)pcszUpperName;
+
+    while (*p)
+    {
+        ulHash ^= *p++;
+        ulHash *= 16777619UL;
+    }
+
+    return ulHash;
+}
+
+/*
+ *@@ RebuildFSHash:
+ *      (re)creates the folder's name hash from the
+ *      file-system objects tree with enough slots
+ *      for twice the number of objects.
+ *
+ *      If we run out of memory, this leaves the hash
+ *      NULL, and FastFindFSFromUpperName falls back
+ *      to the tree.
+ *
+ *      Preconditions:
+ *
+ *      --  Caller must hold the folder write mutex sem.
+ */
+
+STATIC VOID RebuildFSHash(XFolderData *somThis)
+{
+    ULONG           cSlots = HASH_MINSLOTS;
+    PFDRCONTENTHASH pHash;
+
+    FREE(_FileSystemsHash);
+
+    while (cSlots < (ULONG)_cFileSystems * 2)
+        cSlots *= 2;
+
+    if (pHash = (PFDRCONTENTHASH)malloc(   sizeof(FDRCONTENTHASH)
+                                         + (cSlots - 1) * sizeof(PFDRCONTENTITEM)))
+    {
+        PFDRCONTENTITEM pNode;
+
+        memset(pHash->apItems, 0, cSlots * sizeof(PFDRCONTENTITEM));
+        pHash->cSlots = cSlots;
+        pHash->cFilled = 0;
+
+        for (pNode = (PFDRCONTENTITEM)treeFirst(_FileSystemsTreeRoot);
+             pNode;
+             pNode = (PFDRCONTENTITEM)treeNext((TREE*)pNode))
+        {
+            ULONG ul = pNode->ulHash & (cSlots - 1);
+            while (pHash->apItems[ul])
+                ul = (ul + 1) & (cSlots - 1);
+
+            pHash->apItems[ul] = pNode;
+            pHash->cFilled++;
+        }
+
+        _FileSystemsHash = pHash;
+    }
+}
+
+/*
+ *@@ AddToFSHash:
+ *      adds a node to the folder's name hash. The
+ *      node must already be in the tree since the
+ *      hash gets rebuilt from the tree when it is
+ *      too full.
+ *
+ *      Preconditions:
+ *
+ *      --  Caller must hold the folder write mutex sem.
+ */
+
+STATIC VOID AddToFSHash(XFolderData *somThis,
+                        PFDRCONTENTITEM pNode)
+{
+    PFDRCONTENTHASH pHash;
+
+    // keep the table at most three quarters full
+    if (    (!(pHash = (PFDRCONTENTHASH)_FileSystemsHash))
+         || ((pHash->cFilled + 1) * 4 > pHash->cSlots * 3)
+       )
+        // this picks up the new node from the tree
+        RebuildFSHash(somThis);
+    else
+    {
+        ULONG ul = pNode->ulHash & (pHash->cSlots - 1);
+        while (    (pHash->apItems[ul])
+                && (pHash->apItems[ul] != HASH_DELETED)
+              )
+            ul = (ul + 1) & (pHash->cSlots - 1);
+
+        if (!pHash->apItems[ul])
+            pHash->cFilled++;
+        pHash->apItems[ul] = pNode;
+    }
+}
+
+/*
+ *@@ RemoveFromFSHash:
+ *      removes a node from the folder's name hash.
+ *
+ *      Preconditions:
+ *
+ *      --  Caller must hold the folder write mutex sem.
+ */
+
+STATIC VOID RemoveFromFSHash(XFolderData *somThis,
+                             PFDRCONTENTITEM pNode)
+{
+    PFDRCONTENTHASH pHash;
+
+    if (pHash = (PFDRCONTENTHASH)_FileSystemsHash)
+    {
+        ULONG ul = pNode->ulHash & (pHash->cSlots - 1);
+        PFDRCONTENTITEM pThis;
+
+        while (pThis = pHash->apItems[ul])
+        {
+            if (pThis == pNode)
+            {
+                pHash->apItems[ul] = HASH_DELETED;
+                break;
+            }
+
+            ul = (ul + 1) & (pHash->cSlots - 1);
+        }
+    }
+}
+
 /*
  *@@ FastFindFSFromUpperName:
  *      retrieves the awake file-system object with the
  *      specified name (which _must_ be upper-cased)
- *      from the folder contents tree.
+ *      from the folder contents hash (see FDRCONTENTHASH),
+ *      or from the tree if there is no hash.
  *
  *      Preconditions:
  *
@@ -447,6 +617,28 @@ STATIC WPObject* FastFindFSFromUpperName(WPFolder *pFolder,
 {
     XFolderData *somThis = XFolderGetData(pFolder);
     PFDRCONTENTITEM pNode;
+    PFDRCONTENTHASH pHash;
+
+    if (pHash = (PFDRCONTENTHASH)_FileSystemsHash)
+    {
+        ULONG ulHash = HashUpperName(pcszUpperShortName),
+              ul = ulHash & (pHash->cSlots - 1);
+
+        while (pNode = pHash->apItems[ul])
+        {
+            if (    (pNode != HASH_DELETED)
+                 && (pNode->ulHash == ulHash)
+                 && (!strcmp((PCSZ)pNode->Tree.ulKey, pcszUpperShortName))
+               )
+                return pNode->pobj;
+
+            ul = (ul + 1) & (pHash->cSlots - 1);
+        }
+
+        return NULL;
+    }
+
+    // no hash (out of memory): use the tree
     if (pNode = (PFDRCONTENTITEM)treeFind(
                          _FileSystemsTreeRoot,
                          (ULONG)pcszUpperShortName,
@@ -695,11 +887,14 @@ BOOL fdrAddToContent(WPFolder *somSelf,
         {
             pNew->Tree.ulKey = (ULONG)pszUpperRealName;
             pNew->pobj = pObject;
+            pNew->ulHash = HashUpperName(pszUpperRealName);
 
-            if (treeInsert((TREE**)&_FileSystemsTreeRoot,
-                           &_cFileSystems,
-                           (TREE*)pNew,
-                           treeCompareStrings))
+            if (!treeInsert((TREE**)&_FileSystemsTreeRoot,
+                            &_cFileSystems,
+                            (TREE*)pNew,
+                            treeCompareStrings))
+                AddToFSHash(somThis, pNew);
+            else
             {
                 // wow, this failed:
                 PFDRCONTENTITEM pExisting;
@@ -812,6 +1007,8 @@ BOOL fdrRealNameChanged(WPFolder *somSelf,          // in: folder of pFSObject
                              (ULONG)pszOldRealName,
                              treeCompareStrings))
             {
+                RemoveFromFSHash(somThis, pNode);
+
                 // 1) remove that node from the tree
                 if (!treeDelete((TREE**)&_FileSystemsTreeRoot,
                                 &_cFileSystems,
@@ -827,6 +1024,7 @@ BOOL fdrRealNameChanged(WPFolder *somSelf,          // in: folder of pFSObject
                               NULL);
                     // refresh the tree node to point to the new buffer
                     pNode->Tree.ulKey = (ULONG)somThat->pWszUpperRealName;
+                    pNode->ulHash = HashUpperName(somThat->pWszUpperRealName);
 
                     // 3) re-insert
                     if (!treeInsert((TREE**)&_FileSystemsTreeRoot,
@@ -834,6 +1032,7 @@ BOOL fdrRealNameChanged(WPFolder *somSelf,          // in: folder of pFSObject
                                     (TREE*)pNode,
                                     treeCompareStrings))
                     {
+                        AddToFSHash(somThis, pNode);
                         brc = TRUE;
                     }
                     else
@@ -890,6 +1089,8 @@ BOOL fdrDeleteFromContent(WPFolder *somSelf,
                              (ULONG)_xwpQueryUpperRealName(pObject),
                              treeCompareStrings))
         {
+            RemoveFromFSHash(somThis, pNode);
+
             if (!treeDelete((TREE**)&_FileSystemsTreeRoot,
                             &_cFileSystems,
                             (TREE*)pNode))
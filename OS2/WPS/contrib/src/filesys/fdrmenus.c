@@ -177,6 +177,10 @@ extern POINTL   G_ptlMouseMenu = {0, 0};    // ptr position when menu was opened
                                             // moved this here from XFolder instance
                                             // data V0.9.16 (2001-10-23) [umoeller]
 
+// WPS menu settings from OS2.INI; -1 until first queried
+static LONG     G_lMenuBarVisible = -1,
+                G_lShortMenus = -1;
+
 /* ******************************************************************
  *
  *   Global WPS menu settings
@@ -189,20 +193,31 @@ extern POINTL   G_ptlMouseMenu = {0, 0};    // ptr position when menu was opened
  *      enabled for the system (globally).
  *      On Warp 3, returns FALSE always.
  *
+ *      This gets called for every folder view, so the
+ *      INI value is only read once and then kept; our
+ *      settings page changes it through
+ *      mnuSetDefaultMenuBarVisibility, which updates
+ *      the cached value too.
+ *
  *@@added V0.9.19 (2002-04-17) [umoeller]
  *@@changed V1.0.1 (2002-11-30) [umoeller]: removed Warp 3 check
  */
 
 BOOL mnuQueryDefaultMenuBarVisibility(VOID)
 {
-    CHAR    szTemp[20] = "";
-    PrfQueryProfileString(HINI_USER,
-                          (PSZ)WPINIAPP_WORKPLACE, // "PM_Workplace"
-                          (PSZ)WPINIKEY_MENUBAR, // "FolderMenuBar",
-                          "ON",         // V0.9.9 (2001-03-27) [umoeller]
-                          szTemp,
-                          sizeof(szTemp));
-    return (!strcmp(szTemp, "ON"));
+    if (G_lMenuBarVisible == -1)
+    {
+        CHAR    szTemp[20] = "";
+        PrfQueryProfileString(HINI_USER,
+                              (PSZ)WPINIAPP_WORKPLACE, // "PM_Workplace"
+                              (PSZ)WPINIKEY_MENUBAR, // "FolderMenuBar",
+                              "ON",         // V0.9.9 (2001-03-27) [umoeller]
+                              szTemp,
+                              sizeof(szTemp));
+        G_lMenuBarVisible = !strcmp(szTemp, "ON");
+    }
+
+    return G_lMenuBarVisible;
 }
 
 /*
@@ -217,6 +232,7 @@ BOOL mnuQueryDefaultMenuBarVisibility(VOID)
 
 BOOL mnuSetDefaultMenuBarVisibility(BOOL fVisible)
 {
+    G_lMenuBarVisible = !!fVisible;
     return PrfWriteProfileString(HINI_USER,
                                  (PSZ)WPINIAPP_WORKPLACE, // "PM_Workplace"
                                  (PSZ)WPINIKEY_MENUBAR, // "FolderMenuBar",
@@ -228,20 +244,28 @@ BOOL mnuSetDefaultMenuBarVisibility(BOOL fVisible)
  *      returns TRUE iff short menus are
  *      presently enabled for the system (globally).
  *
+ *      Like mnuQueryDefaultMenuBarVisibility, this
+ *      reads OS2.INI only once.
+ *
  *@@added V0.9.19 (2002-04-17) [umoeller]
  *@@changed V1.0.1 (2002-11-30) [umoeller]: removed Warp 3 check
  */
 
 BOOL mnuQueryShortMenuStyle(VOID)
 {
-    CHAR    szTemp[20] = "";
-    PrfQueryProfileString(HINI_USER,
-                          (PSZ)WPINIAPP_WORKPLACE, // "PM_Workplace"
-                          (PSZ)WPINIKEY_SHORTMENUS, // "FolderMenus"
-                          "",
-                          szTemp,
-                          sizeof(szTemp));
-    return (!strcmp(szTemp, "SHORT"));
+    if (G_lShortMenus == -1)
+    {
+        CHAR    szTemp[20] = "";
+        PrfQueryProfileString(HINI_USER,
+                              (PSZ)WPINIAPP_WORKPLACE, // "PM_Workplace"
+                              (PSZ)WPINIKEY_SHORTMENUS, // "FolderMenus"
+                              "",
+                              szTemp,
+                              sizeof(szTemp));
+        G_lShortMenus = !strcmp(szTemp, "SHORT");
+    }
+
+    return G_lShortMenus;
 }
 
 /*
@@ -256,6 +280,7 @@ BOOL mnuQueryShortMenuStyle(VOID)
 
 BOOL mnuSetShortMenuStyle(BOOL fShort)
 {
+    G_lShortMenus = !!fShort;
     return PrfWriteProfileString(HINI_USER,
                                  (PSZ)WPINIAPP_WORKPLACE, // "PM_Workplace"
                                  (PSZ)WPINIKEY_SHORTMENUS, // "FolderMenus"
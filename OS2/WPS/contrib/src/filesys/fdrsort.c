@@ -804,54 +804,24 @@ STATIC LONG EXPENTRY CompareDate(PCDATE pd1,     // ptr to ul1
            UCHAR     ucReserved;
         } CTIME; */
 
-    // compare years
-    if (pd1->year > pd2->year)
-        return CMP_GREATER;
-    else if (pd1->year < pd2->year)
-        return CMP_LESS;
-    else
+    // pack date and time into one ULONG each so that
+    // we need two comparisons instead of up to six
+    PCTIME  pt1 = (PCTIME)(pd1 + 1),
+            pt2 = (PCTIME)(pd2 + 1);
+    ULONG   ulDate1 = ((ULONG)pd1->year << 16) | ((ULONG)pd1->month << 8) | pd1->day,
+            ulDate2 = ((ULONG)pd2->year << 16) | ((ULONG)pd2->month << 8) | pd2->day;
+
+    if (ulDate1 == ulDate2)
     {
-        // compare months
-        if (pd1->month > pd2->month)
-            return CMP_GREATER;
-        else if (pd1->month < pd2->month)
-            return CMP_LESS;
-        else
-        {
-            // compare days
-            if (pd1->day > pd2->day)
-                return CMP_GREATER;
-            else if (pd1->day < pd2->day)
-                return CMP_LESS;
-            else
-            {
-                PCTIME pt1 = (PCTIME)(pd1 + 1);
-                PCTIME pt2 = (PCTIME)(pd2 + 1);
-                // compare hours
-                if (pt1->hours > pt2->hours)
-                    return CMP_GREATER;
-                else if (pt1->hours < pt2->hours)
-                    return CMP_LESS;
-                else
-                {
-                    // compare minutes
-                    if (pt1->minutes > pt2->minutes)
-                        return CMP_GREATER;
-                    else if (pt1->minutes < pt2->minutes)
-                        return CMP_LESS;
-                    else
-                    {
-                        // compare seconds
-                        if (pt1->seconds > pt2->seconds)
-                            return CMP_GREATER;
-                        else if (pt1->seconds < pt2->seconds)
-                            return CMP_LESS;
-                    }
-                }
-            }
-        }
+        ulDate1 = ((ULONG)pt1->hours << 16) | ((ULONG)pt1->minutes << 8) | pt1->seconds;
+        ulDate2 = ((ULONG)pt2->hours << 16) | ((ULONG)pt2->minutes << 8) | pt2->seconds;
     }
 
+    if (ulDate1 > ulDate2)
+        return CMP_GREATER;
+    if (ulDate1 < ulDate2)
+        return CMP_LESS;
+
     return CMP_EQUAL;
 }
 
@@ -1164,6 +1134,314 @@ PFN fdrQuerySortFunc(WPFolder *somSelf,
     return (PFN)fnCompareName;
 }
 
+/* ******************************************************************
+ *
+ *   One-shot details sort with precomputed keys
+ *
+ ********************************************************************/
+
+/*
+ *@@ SORTKEY:
+ *      one record of a container that SortDetailsOnce
+ *      is sorting. Everything that fnCompareDetailsColumn
+ *      has to find out through SOM calls on every single
+ *      comparison is looked up here once per record.
+ */
+
+typedef struct _SORTKEY
+{
+    PMINIRECORDCORE prec;
+    ULONG           ulRank;         // position after sorting
+    BOOL            fFolder;        // object is (or links to) a folder
+    BOOL            fSortClass;     // object is of the folder's sort class
+    PBYTE           pbData;         // details data of the sort column
+} SORTKEY, *PSORTKEY;
+
+/*
+ *@@ SORTKEYS:
+ *      passed as pStorage with CM_SORTRECORD to
+ *      fnCompareSortRanks.
+ */
+
+typedef struct _SORTKEYS
+{
+    ULONG           cKeys;
+    PSORTKEY        *papByRecord;   // keys sorted by record pointer
+} SORTKEYS, *PSORTKEYS;
+
+typedef LONG FNSORTKEYS(PSORTKEY p1, PSORTKEY p2, PVOID pUser);
+
+/*
+ *@@ MergeSortKeys:
+ *      stable bottom-up merge sort of an array of
+ *      SORTKEY pointers. papTemp must have room for
+ *      the same number of pointers.
+ */
+
+STATIC VOID MergeSortKeys(PSORTKEY *papKeys,
+                          PSORTKEY *papTemp,
+                          ULONG cKeys,
+                          FNSORTKEYS *pfnCompare,
+                          PVOID pUser)
+{
+    PSORTKEY    *papFrom = papKeys,
+                *papTo = papTemp;
+    ULONG       cRun;
+
+    for (cRun = 1;
+         cRun < cKeys;
+         cRun *= 2)
+    {
+        ULONG ulLeft;
+        PSORTKEY *papSwap;
+
+        for (ulLeft = 0;
+             ulLeft < cKeys;
+             ulLeft += 2 * cRun)
+        {
+            ULONG   ulMid = min(ulLeft + cRun, cKeys),
+                    ulEnd = min(ulLeft + 2 * cRun, cKeys),
+                    i = ulLeft,
+                    j = ulMid,
+                    k = ulLeft;
+
+            // take from the left run on ties to keep this stable
+            while (i < ulMid && j < ulEnd)
+                if (pfnCompare(papFrom[j], papFrom[i], pUser) < 0)
+                    papTo[k++] = papFrom[j++];
+                else
+                    papTo[k++] = papFrom[i++];
+
+            while (i < ulMid)
+                papTo[k++] = papFrom[i++];
+            while (j < ulEnd)
+                papTo[k++] = papFrom[j++];
+        }
+
+        papSwap = papFrom;
+        papFrom = papTo;
+        papTo = papSwap;
+    }
+
+    if (papFrom != papKeys)
+        memcpy(papKeys, papFrom, cKeys * sizeof(PSORTKEY));
+}
+
+/*
+ *@@ CompareKeysByRecord:
+ *      orders SORTKEYs by record pointer for
+ *      FindSortKey.
+ */
+
+STATIC LONG CompareKeysByRecord(PSORTKEY p1,
+                                PSORTKEY p2,
+                                PVOID pUser)
+{
+    if ((ULONG)p1->prec < (ULONG)p2->prec)
+        return -1;
+    if ((ULONG)p1->prec > (ULONG)p2->prec)
+        return 1;
+    return 0;
+}
+
+/*
+ *@@ CompareKeysByColumn:
+ *      same order as fnCompareDetailsColumn, but on
+ *      the precomputed SORTKEYs. pUser is the
+ *      folder's IBMSORTINFO.
+ */
+
+STATIC LONG CompareKeysByColumn(PSORTKEY p1,
+                                PSORTKEY p2,
+                                PVOID pUser)
+{
+    PIBMSORTINFO pSortInfo = (PIBMSORTINFO)pUser;
+
+    // fFolder is only set if "folders first" is on
+    if (p1->fFolder != p2->fFolder)
+        return (p1->fFolder) ? -1 : 1;
+
+    if (p1->fSortClass && p2->fSortClass)
+    {
+        LONG lResult = pSortInfo->pfnCompare(p1->pbData, p2->pbData);
+        if (lResult == CMP_LESS)
+            return -1;
+        return lResult;
+    }
+
+    if (!p1->fSortClass)
+        return (p2->fSortClass) ? 1 : 0;
+
+    return -1;
+}
+
+/*
+ *@@ FindSortKey:
+ *      binary search for the key of the given record.
+ */
+
+STATIC PSORTKEY FindSortKey(PSORTKEYS pKeys,
+                            PMINIRECORDCORE prec)
+{
+    ULONG   ulLow = 0,
+            ulHigh = pKeys->cKeys;
+
+    while (ulLow < ulHigh)
+    {
+        ULONG ulMid = (ulLow + ulHigh) / 2;
+        PSORTKEY pKey = pKeys->papByRecord[ulMid];
+
+        if (pKey->prec == prec)
+            return pKey;
+
+        if ((ULONG)pKey->prec < (ULONG)prec)
+            ulLow = ulMid + 1;
+        else
+            ulHigh = ulMid;
+    }
+
+    return NULL;
+}
+
+/*
+ *@@ fnCompareSortRanks:
+ *      container comparison func used by SortDetailsOnce
+ *      with CM_SORTRECORD. pStorage is the SORTKEYS.
+ *
+ *      Records that SortDetailsOnce did not see (in tree
+ *      views, the records below the first level) are
+ *      compared with fnCompareDetailsColumn.
+ */
+
+STATIC SHORT EXPENTRY fnCompareSortRanks(PMINIRECORDCORE pmrc1,
+                                         PMINIRECORDCORE pmrc2,
+                                         PVOID pStorage)
+{
+    PSORTKEY p1, p2;
+
+    if (    (p1 = FindSortKey((PSORTKEYS)pStorage, pmrc1))
+         && (p2 = FindSortKey((PSORTKEYS)pStorage, pmrc2))
+       )
+    {
+        if (p1->ulRank < p2->ulRank)
+            return -1;
+        return (p1->ulRank > p2->ulRank);
+    }
+
+    return fnCompareDetailsColumn(pmrc1, pmrc2, NULL);
+}
+
+/*
+ *@@ SortDetailsOnce:
+ *      sorts hwndCnr by a details column. fdrQuerySortFunc
+ *      must have returned fnCompareDetailsColumn, so that
+ *      the folder's IBMSORTINFO is set up.
+ *
+ *      Letting the container sort with fnCompareDetailsColumn
+ *      costs several SOM calls (_wpQueryFolder, _somIsA, and
+ *      for "folders first" _xwpResolveIfLink and objIsAFolder)
+ *      per comparison, i.e. O(n log n) of them. Instead, we
+ *      do those once per record, sort the records with a
+ *      stable merge sort ourselves, and then have the
+ *      container sort by the resulting ranks.
+ *
+ *      Returns FALSE if we ran out of memory; the caller
+ *      should then sort the old way.
+ */
+
+STATIC BOOL SortDetailsOnce(WPFolder *somSelf,
+                            HWND hwndCnr)
+{
+    BOOL            brc = FALSE;
+    XFolderData     *somThis = XFolderGetData(somSelf);
+    PIBMSORTINFO    pSortInfo = &((PIBMFOLDERDATA)_pvWPFolderData)->SortInfo;
+    CNRINFO         CnrInfo;
+    PSORTKEY        paKeys;
+    PSORTKEY        *papKeys;
+    ULONG           cKeys = 0;
+
+    cnrhQueryCnrInfo(hwndCnr, &CnrInfo);
+
+    if (!CnrInfo.cRecords)
+        return TRUE;
+
+    if (    (paKeys = (PSORTKEY)malloc(CnrInfo.cRecords * sizeof(SORTKEY)))
+         && (papKeys = (PSORTKEY*)malloc(3 * CnrInfo.cRecords * sizeof(PSORTKEY)))
+       )
+    {
+        PMINIRECORDCORE prec = NULL;
+        ULONG           ul;
+        SORTKEYS        Keys;
+
+        // collect the top-level records and their keys
+        while (    (cKeys < CnrInfo.cRecords)
+                && (prec = (PMINIRECORDCORE)WinSendMsg(hwndCnr,
+                                                       CM_QUERYRECORD,
+                                                       (MPARAM)prec,
+                                                       MPFROM2SHORT((prec) ? CMA_NEXT : CMA_FIRST,
+                                                                    CMA_ITEMORDER)))
+                && ((LONG)prec != -1)
+              )
+        {
+            PSORTKEY    pKey = &paKeys[cKeys];
+            WPObject    *pobj = OBJECT_FROM_PREC(prec);
+
+            pKey->prec = prec;
+            pKey->fFolder = FALSE;
+            if (_bCachedFoldersFirst)
+            {
+                WPObject *pobjDeref;
+                if (pobjDeref = _xwpResolveIfLink(pobj))
+                    pKey->fFolder = objIsAFolder(pobjDeref);
+            }
+            pKey->fSortClass = _somIsA(pobj, pSortInfo->Class);
+            pKey->pbData =   (PBYTE)prec
+                           + sizeof(MINIRECORDCORE)
+                           + pSortInfo->ulFieldOffset;
+
+            papKeys[cKeys] = pKey;
+            cKeys++;
+        }
+
+        // sort by column, then number the records
+        MergeSortKeys(papKeys,
+                      papKeys + 2 * cKeys,
+                      cKeys,
+                      CompareKeysByColumn,
+                      pSortInfo);
+        for (ul = 0;
+             ul < cKeys;
+             ul++)
+            papKeys[ul]->ulRank = ul;
+
+        // build the lookup array for fnCompareSortRanks
+        Keys.cKeys = cKeys;
+        Keys.papByRecord = papKeys + cKeys;
+        memcpy(Keys.papByRecord, papKeys, cKeys * sizeof(PSORTKEY));
+        MergeSortKeys(Keys.papByRecord,
+                      papKeys + 2 * cKeys,
+                      cKeys,
+                      CompareKeysByRecord,
+                      NULL);
+
+        WinSendMsg(hwndCnr,
+                   CM_SORTRECORD,
+                   (MPARAM)fnCompareSortRanks,
+                   (MPARAM)&Keys);
+
+        brc = TRUE;
+    }
+
+    if (paKeys)
+    {
+        if (papKeys)
+            free(papKeys);
+        free(paKeys);
+    }
+
+    return brc;
+}
+
 /* ******************************************************************
  *
  *   Interfaces, callbacks
@@ -1237,6 +1515,8 @@ BOOL _Optlink fdrSortAllViews(WPFolder *somSelf,
  *@@ fdrSortViewOnce:
  *      implementation for XFolder::xwpSortViewOnce.
  *
+ *      For details columns, this uses SortDetailsOnce.
+ *
  *@@added V0.9.19 (2002-04-24) [umoeller]
  */
 
@@ -1269,6 +1549,8 @@ BOOL fdrSortViewOnce(WPFolder *somSelf,
                 {
                     CNRINFO CnrInfo;
                     ULONG   ulStyle = 0;
+                    PFN     pfnSort = fdrQuerySortFunc(somSelf,
+                                                       lSort);
 
                     cnrhQueryCnrInfo(hwndCnr, &CnrInfo);
 
@@ -1280,12 +1562,15 @@ BOOL fdrSortViewOnce(WPFolder *somSelf,
                         WinSetWindowULong(hwndCnr, QWL_STYLE, ulStyle | CCS_AUTOPOSITION);
                     }
 
-                    // send sort msg with proper sort (comparison) func
-                    WinSendMsg(hwndCnr,
-                               CM_SORTRECORD,
-                               (MPARAM)fdrQuerySortFunc(somSelf,
-                                                        lSort),
-                               MPNULL);
+                    // details columns: sort on precomputed keys
+                    if (    (pfnSort != (PFN)fnCompareDetailsColumn)
+                         || (!SortDetailsOnce(somSelf, hwndCnr))
+                       )
+                        // send sort msg with proper sort (comparison) func
+                        WinSendMsg(hwndCnr,
+                                   CM_SORTRECORD,
+                                   (MPARAM)pfnSort,
+                                   MPNULL);
 
                     if ((CnrInfo.flWindowAttr & (CV_ICON | CV_TREE)) == CV_ICON)
                         // restore old cnr style
@@ -108,6 +108,12 @@
 PCSZ    WC_SPLITCONTROLLER  = "XWPSplitController",
         WC_SPLITPOPULATE   = "XWPSplitPopulate";
 
+// partial fill timer on the controller while the files
+// cnr is being populated; see WM_TIMER in fnwpSplitController
+#define TIMERID_PARTIALFILL     1
+#define PARTIALFILL_FIRST       250         // ms
+#define PARTIALFILL_MAX         4000        // ms
+
 /* ******************************************************************
  *
  *   Global variables
@@ -990,6 +996,7 @@ STATIC VOID SplitFillFolder(HWND hwndClient,
                                (pctl->fUnlockOnClear)
                                    ? CLEARFL_UNLOCKOBJECTS
                                    : 0);
+            pctl->precPartialFill = NULL;
 
             // if we had a previous view item for the
             // files cnr, remove it... since the entire
@@ -1026,6 +1033,17 @@ STATIC VOID SplitFillFolder(HWND hwndClient,
                 _wpAddToObjUseList(pctl->pobjUseList,
                                    &pctl->uiDisplaying);
 
+                // start the partial fill timer so that the user
+                // sees the objects that have been awakened so
+                // far while populate is still running; see
+                // WM_TIMER in fnwpSplitController
+                pctl->precPartialFill = prec;
+                pctl->ulPartialFillMS = PARTIALFILL_FIRST;
+                WinStartTimer(pctl->habGUI,
+                              hwndClient,
+                              TIMERID_PARTIALFILL,
+                              pctl->ulPartialFillMS);
+
                 PMPF_SPLITVIEW(("  calling fdrvSetupView for right half"));
 
                 fdrvSetupView(&pctl->cvFiles,
@@ -1376,6 +1394,15 @@ MRESULT EXPENTRY fnwpSplitController(HWND hwndClient, ULONG msg, MPARAM mp1, MPA
 
                         pctl->fUnlockOnClear = FALSE;
 
+                        // populate is done: stop the partial fill
+                        if (pctl->precPartialFill)
+                        {
+                            WinStopTimer(pctl->habGUI,
+                                         hwndClient,
+                                         TIMERID_PARTIALFILL);
+                            pctl->precPartialFill = NULL;
+                        }
+
                         if (    (!((ULONG)mp2 & FFL_POPULATEFAILED))
                              && (pFolder = fdrvGetFSFromRecord((PMINIRECORDCORE)mp1,
                                                                TRUE))
@@ -1435,6 +1462,74 @@ MRESULT EXPENTRY fnwpSplitController(HWND hwndClient, ULONG msg, MPARAM mp1, MPA
 
             break;
 
+            /*
+             * WM_TIMER:
+             *      TIMERID_PARTIALFILL gets started by SplitFillFolder
+             *      while the files cnr is being populated. Each tick
+             *      inserts all objects that have been awakened so
+             *      far and are not in the cnr yet with a single
+             *      _wpclsInsertMultipleObjects call (fdrInsertContents
+             *      skips the ones that are already in). Without this,
+             *      the files cnr stays empty until the last object
+             *      in the folder has been awakened.
+             *
+             *      We never unlock here since the objects are still
+             *      being awakened; FM_POPULATED_FILLFILES does the
+             *      final insert with INSERT_UNLOCKFILTERED.
+             *
+             *      The interval doubles with every tick (up to
+             *      PARTIALFILL_MAX) since every tick has to run
+             *      through the entire folder contents.
+             */
+
+            case WM_TIMER:
+
+                if (    ((ULONG)mp1 == TIMERID_PARTIALFILL)
+                     && (pctl = WinQueryWindowPtr(hwndClient, QWL_USER))
+                   )
+                {
+                    WPFolder    *pFolder;
+
+                    if (    (pctl->precPartialFill)
+                         && (pctl->viDisplaying.ulViewState & VIEWSTATE_OPENING)
+                         && (pFolder = fdrvGetFSFromRecord(pctl->precPartialFill,
+                                                           TRUE))
+                       )
+                    {
+                        PMPF_SPLITVIEW(("WM_TIMER partial fill %s",
+                                    pctl->precPartialFill->pszIcon));
+
+                        fdrInsertContents(pFolder,
+                                          pctl->cvFiles.hwndCnr,
+                                          NULL,        // parent
+                                          (pctl->pcszFileMask)
+                                              ? INSERT_FILESYSTEMS
+                                              : INSERT_ALL,
+                                          NULLHANDLE,  // no add first child
+                                          pctl->pcszFileMask);
+
+                        if (pctl->ulPartialFillMS < PARTIALFILL_MAX)
+                        {
+                            pctl->ulPartialFillMS *= 2;
+                            WinStartTimer(pctl->habGUI,
+                                          hwndClient,
+                                          TIMERID_PARTIALFILL,
+                                          pctl->ulPartialFillMS);
+                        }
+                    }
+                    else
+                    {
+                        WinStopTimer(pctl->habGUI,
+                                     hwndClient,
+                                     TIMERID_PARTIALFILL);
+                        pctl->precPartialFill = NULL;
+                    }
+                }
+                else
+                    mrc = WinDefWindowProc(hwndClient, msg, mp1, mp2);
+
+            break;
+
             /*
              * CM_UPDATEPOINTER:
              *      posted when threads exit etc. to update
@@ -172,10 +172,16 @@ STATIC VOID Add64(PLONGLONG pll1, PLONGLONG pll2, PLONGLONG pllResult)
  *      contents are not modified while we are working
  *      here.
  *
+ *      This asks DosFindFirst/Next for as many files
+ *      per call as fit into SNEAKY_FINDBUF_SIZE, which
+ *      makes a big difference on network drives.
+ *
  *@@added V0.9.6 (2000-10-25) [umoeller]
  *@@changed V1.0.9 (2010-07-17) [pr]: added large file support @@fixes 586
  */
 
+#define SNEAKY_FINDBUF_SIZE     (32 * 1024)
+
 APIRET fopsLoopSneaky(WPFolder *pFolder,       // in: folder
                       PULONG pulFilesCount,    // out: no. of dormant files found (raised!)
                       PLONGLONG pllSizeContents)  // out: total size of dormant files found (raised!)
@@ -190,55 +196,68 @@ APIRET fopsLoopSneaky(WPFolder *pFolder,       // in: folder
     // added yet, we need to add the file size...
     // V0.9.6 (2000-10-25) [umoeller]
 
+    PBYTE   pbFind;
+
     // get folder name
     if (!_wpQueryFilename(pFolder, szFolderPath, TRUE))
         frc = FOPSERR_WPQUERYFILENAME_FAILED;
+    else if (!(pbFind = (PBYTE)malloc(SNEAKY_FINDBUF_SIZE)))
+        frc = ERROR_NOT_ENOUGH_MEMORY;
     else
     {
         M_WPFileSystem  *pWPFileSystem = _WPFileSystem;
 
         CHAR            szSearchMask[CCHMAXPATH];
+        CHAR            szFullPath[2*CCHMAXPATH];
+        PSZ             pszName;
         HDIR            hdirFindHandle = HDIR_CREATE;
-        FILEFINDBUF3L   ffb3 = {0};      // returned from FindFirst/Next
-        ULONG           cbFFB3 = sizeof(ffb3);
-        ULONG           ulFindCount = 1;  // look for 1 file at a time
+        ULONG           ulFindCount = SNEAKY_FINDBUF_SIZE / sizeof(FILEFINDBUF3L);
 
         // _PmpfF(("doing DosFindFirst for %s", szFolderPath));
 
+        // compose the full paths in place behind the folder path
+        pszName = szFullPath + sprintf(szFullPath, "%s\\", szFolderPath);
+
         // now go find...
         sprintf(szSearchMask, "%s\\*", szFolderPath);
         frc = DosFindFirst(szSearchMask,
                            &hdirFindHandle,
                            // find everything except directories
                            FILE_ARCHIVED | FILE_HIDDEN | FILE_SYSTEM | FILE_READONLY,
-                           &ffb3,
-                           cbFFB3,
+                           pbFind,
+                           SNEAKY_FINDBUF_SIZE,
                            &ulFindCount,
                            FIL_STANDARDL);
         // and start looping...
         while (frc == NO_ERROR)
         {
-            // alright... we got the file's name in ffb3.achName
-            CHAR    szFullPath[2*CCHMAXPATH];
-            sprintf(szFullPath, "%s\\%s", szFolderPath, ffb3.achName);
-
-            // _Pmpf(("    got file %s", szFullPath));
+            PFILEFINDBUF3L pffb3 = (PFILEFINDBUF3L)pbFind;
 
-            if (!_wpclsQueryAwakeObject(pWPFileSystem,
-                                        szFullPath))
+            while (ulFindCount--)
             {
-                // object not awake yet: this means that
-                // the object was not added to the list above...
-                // add the file's size
-                // _Pmpf(("        not already instantiated"));
-                (*pulFilesCount)++;
-                Add64(pllSizeContents, &ffb3.cbFile, pllSizeContents);  // V1.0.9
+                // alright... we got the file's name in pffb3->achName
+                strcpy(pszName, pffb3->achName);
+
+                // _Pmpf(("    got file %s", szFullPath));
+
+                if (!_wpclsQueryAwakeObject(pWPFileSystem,
+                                            szFullPath))
+                {
+                    // object not awake yet: this means that
+                    // the object was not added to the list above...
+                    // add the file's size
+                    // _Pmpf(("        not already instantiated"));
+                    (*pulFilesCount)++;
+                    Add64(pllSizeContents, &pffb3->cbFile, pllSizeContents);  // V1.0.9
+                }
+
+                pffb3 = (PFILEFINDBUF3L)((PBYTE)pffb3 + pffb3->oNextEntryOffset);
             }
 
-            ulFindCount = 1;
+            ulFindCount = SNEAKY_FINDBUF_SIZE / sizeof(FILEFINDBUF3L);
             frc = DosFindNext(hdirFindHandle,
-                              &ffb3,
-                              cbFFB3,
+                              pbFind,
+                              SNEAKY_FINDBUF_SIZE,
                               &ulFindCount);
         } // while (arc == NO_ERROR)
 
@@ -246,6 +265,7 @@ APIRET fopsLoopSneaky(WPFolder *pFolder,       // in: folder
             frc = NO_ERROR;
 
         DosFindClose(hdirFindHandle);
+        free(pbFind);
     }
 
     return frc;
@@ -415,6 +435,72 @@ PEXPANDEDOBJECT fopsExpandObjectDeep(WPObject *pObject,
     return pSOI;
 }
 
+/*
+ *@@ fopsQueryObjectSizeDeep:
+ *      returns the size of pObject in *pllSize, including
+ *      everything in it if pObject is a folder.
+ *
+ *      This computes the same value as EXPANDEDOBJECT.llSizeThis
+ *      from fopsExpandObjectDeep, but adds up the sizes while
+ *      walking the folders instead of building an
+ *      EXPANDEDOBJECT for every object in the tree first.
+ *      Use this if you need the size only.
+ *
+ *      fFoldersOnly works as with fopsExpandObjectDeep.
+ */
+
+VOID fopsQueryObjectSizeDeep(WPObject *pObject,
+                             BOOL fFoldersOnly,
+                             PLONGLONG pllSize)     // out: total size
+{
+    pllSize->ulHi = pllSize->ulLo = 0;
+
+    if (wpshCheckObject(pObject))
+    {
+        if (_somIsA(pObject, _WPFolder))
+        {
+            BOOL        fFolderLocked = FALSE;
+
+            TRY_LOUD(excpt1)
+            {
+                // populate (either fully or with folders only)
+                if (    (fdrCheckIfPopulated(pObject,
+                                             fFoldersOnly))
+                     && (fFolderLocked = !_wpRequestFolderMutexSem(pObject, 5000))
+                   )
+                {
+                    WPObject *pSubObject;
+
+                    for (pSubObject = _wpQueryContent(pObject, NULL, QC_FIRST);
+                         pSubObject;
+                         pSubObject = *__get_pobjNext(pSubObject))
+                    {
+                        LONGLONG llSub;
+                        fopsQueryObjectSizeDeep(pSubObject,
+                                                fFoldersOnly,
+                                                &llSub);
+                        Add64(pllSize, &llSub, pllSize);
+                    }
+
+                    if (fFoldersOnly)
+                    {
+                        ULONG ulFilesCount = 0;
+                        fopsLoopSneaky(pObject,
+                                       &ulFilesCount,       // not needed
+                                       pllSize);
+                    }
+                }
+            }
+            CATCH(excpt1) {} END_CATCH();
+
+            if (fFolderLocked)
+                _wpReleaseFolderMutexSem(pObject);
+        }
+        else if (_somIsA(pObject, _WPFileSystem))
+            _wpQueryFileSizeL(pObject, pllSize);
+    }
+}
+
 /*
  *@@ fopsFreeExpandedList:
  *      frees a LINKLIST of EXPANDEDOBJECT items
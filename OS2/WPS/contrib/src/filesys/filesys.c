@@ -201,6 +201,56 @@ PSZ fsysQueryEAKeyphrases(WPFileSystem *somSelf)
     return psz;
 }
 
+/*
+ *@@ fsysQueryEAs:
+ *      returns the .SUBJECT, .COMMENTS and .KEYPHRASES
+ *      EAs like fsysQueryEASubject, fsysQueryEAComments
+ *      and fsysQueryEAKeyphrases, but reads all three
+ *      with a single query. Each output string must be
+ *      free()'d by the caller and is NULL if the EA
+ *      doesn't exist.
+ */
+
+VOID fsysQueryEAs(WPFileSystem *somSelf,
+                  PSZ *ppszSubject,       // out: .SUBJECT
+                  PSZ *ppszComments,      // out: .COMMENTS
+                  PSZ *ppszKeyphrases)    // out: .KEYPHRASES
+{
+    static const char *apcszNames[] =
+        {
+            ".SUBJECT",
+            ".COMMENTS",
+            ".KEYPHRASES"
+        };
+    CHAR    szFilename[CCHMAXPATH];
+
+    *ppszSubject = NULL;
+    *ppszComments = NULL;
+    *ppszKeyphrases = NULL;
+
+    if (_wpQueryFilename(somSelf, szFilename, TRUE))
+    {
+        PEALIST     peal;
+        if (peal = eaPathReadMany(szFilename,
+                                  apcszNames,
+                                  ARRAYITEMCOUNT(apcszNames)))
+        {
+            PEABINDING  peab;
+            if (peab = eaFindInList(peal, ".SUBJECT"))
+                *ppszSubject = eaCreatePSZFromBinding(peab);
+            if (peab = eaFindInList(peal, ".COMMENTS"))
+                *ppszComments = eaCreatePSZFromMVBinding(peab,
+                                                         "\r\n", // separator string
+                                                         NULL);  // codepage (not needed)
+            if (peab = eaFindInList(peal, ".KEYPHRASES"))
+                *ppszKeyphrases = eaCreatePSZFromMVBinding(peab,
+                                                           "\r\n", // separator string
+                                                           NULL);  // codepage (not needed)
+            eaFreeList(peal);
+        }
+    }
+}
+
 /*
  *@@ fsysSetEASubject:
  *      sets a new value for the .SUBJECT extended
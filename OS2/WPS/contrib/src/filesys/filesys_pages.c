@@ -427,9 +427,10 @@ VOID fsysFile1InitPage(PNOTEBOOKPAGE pnbp,    // notebook info struct
         pnbp->pUser = pfpd;
         pfpd->ulAttr = _wpQueryAttr(pnbp->inbp.somSelf);
         _wpQueryFilename(pnbp->inbp.somSelf, szFilename, TRUE);
-        pfpd->pszSubject = fsysQueryEASubject(pnbp->inbp.somSelf);
-        pfpd->pszComments = fsysQueryEAComments(pnbp->inbp.somSelf);
-        pfpd->pszKeyphrases = fsysQueryEAKeyphrases(pnbp->inbp.somSelf);
+        fsysQueryEAs(pnbp->inbp.somSelf,
+                     &pfpd->pszSubject,
+                     &pfpd->pszComments,
+                     &pfpd->pszKeyphrases);
 
         // insert the controls using the dialog formatter
         // V0.9.19 (2002-04-14) [umoeller]
@@ -473,7 +474,9 @@ VOID fsysFile1InitPage(PNOTEBOOKPAGE pnbp,    // notebook info struct
         // prepare file date/time etc. for display in window
         CHAR    szFilename[CCHMAXPATH];
         CHAR    szTemp[100];
-        PSZ     pszString = NULL;
+        PSZ     pszSubject,
+                pszComments,
+                pszKeyphrases;
         ULONG   ulAttr;
         FILESTATUS3L fs3;
 
@@ -547,32 +550,30 @@ VOID fsysFile1InitPage(PNOTEBOOKPAGE pnbp,    // notebook info struct
                               ID_XSDI_FILES_ATTR_SYSTEM,
                               ((ulAttr & FILE_SYSTEM) != 0));
 
-        // .SUBJECT EA; this is plain text
-        pszString = fsysQueryEASubject(pnbp->inbp.somSelf);
+        // .SUBJECT EA is plain text; .COMMENTS and .KEYPHRASES
+        // are multi-value multi-type, but all of the sub-types
+        // are EAT_ASCII, so fsysQueryEAs converts the sub-items
+        // into one string and separates the items with CR/LF.
+        // All three are read with a single query.
+        fsysQueryEAs(pnbp->inbp.somSelf,
+                     &pszSubject,
+                     &pszComments,
+                     &pszKeyphrases);
+
         WinSetDlgItemText(pnbp->hwndDlgPage, ID_XSDI_FILES_SUBJECT,
-                          pszString);
-        if (pszString)
-            free(pszString);
-
-        // .COMMENTS EA; this is multi-value multi-type, but all
-        // of the sub-types are EAT_ASCII. We need to convert
-        // the sub-items into one string and separate the items
-        // with CR/LF.
-        pszString = fsysQueryEAComments(pnbp->inbp.somSelf);
+                          pszSubject);
+        if (pszSubject)
+            free(pszSubject);
+
         WinSetDlgItemText(pnbp->hwndDlgPage, ID_XSDI_FILES_COMMENTS,
-                          pszString);
-        if (pszString)
-            free(pszString);
-
-        // .KEYPHRASES EA; this is multi-value multi-type, but all
-        // of the sub-types are EAT_ASCII. We need to convert
-        // the sub-items into one string and separate the items
-        // with CR/LF.
-        pszString = fsysQueryEAKeyphrases(pnbp->inbp.somSelf);
+                          pszComments);
+        if (pszComments)
+            free(pszComments);
+
         WinSetDlgItemText(pnbp->hwndDlgPage, ID_XSDI_FILES_KEYPHRASES,
-                        pszString);
-        if (pszString)
-            free(pszString);
+                          pszKeyphrases);
+        if (pszKeyphrases)
+            free(pszKeyphrases);
 
         WinSetPointer(HWND_DESKTOP, hptrOld);
     }
@@ -255,7 +255,10 @@
 #include "helpers\dosh.h"               // Control Program helper routines
 #include "helpers\except.h"             // exception handling
 #include "helpers\exeh.h"               // executable helpers
+#include "helpers\linklist.h"           // linked list helper routines
+#include "helpers\nls.h"                // National Language Support helpers
 #include "helpers\standards.h"          // some standard macros
+#include "helpers\tree.h"               // red-black binary trees
 #include "helpers\winh.h"               // PM helper routines
 
 // SOM headers which don't crash with prec. header files
@@ -1983,6 +1986,291 @@ APIRET LoadWinPEResource(PEXECUTABLE pExec,     // in: executable from exehOpen
     return arc;
 }
 
+/* ******************************************************************
+ *
+ *   Executable icons cache
+ *
+ ********************************************************************/
+
+/*
+ *@@ EXEICONCACHE:
+ *      one icon (or "no icon") that icoLoadExeIcon has
+ *      found in an executable. The entries are kept in
+ *      G_ExeIconsTreeRoot, sorted by szKey, and on
+ *      G_llExeIconsLRU, least recently used first.
+ *
+ *      Opening a folder full of executables otherwise
+ *      parses every executable's resource tables each
+ *      time its object is made awake again.
+ */
+
+typedef struct _EXEICONCACHE
+{
+    TREE        Tree;               // ulKey points to szKey
+
+    PLISTNODE   pLRUNode;           // node on G_llExeIconsLRU
+
+    // the entry is only valid if these still match the file
+    ULONG       cbFile;
+    FDATE       fdateLastWrite;
+    FTIME       ftimeLastWrite;
+
+    APIRET      arc;                // NO_ERROR, or what icoLoadExeIcon
+                                    // returned for the file
+    ULONG       cbData;             // size of icon data after szKey
+    PBYTE       pbData;             // icon data or NULL
+
+    CHAR        szKey[1];           // "resid:FULLPATH", upper-cased
+} EXEICONCACHE, *PEXEICONCACHE;
+
+// max. size of all icon data in the cache
+#define EXEICONCACHE_MAXBYTES   (2 * 1024 * 1024)
+
+static HMTX         G_hmtxExeIcons = NULLHANDLE;
+static TREE         *G_ExeIconsTreeRoot;
+static LONG         G_cExeIcons = 0;
+static LINKLIST     G_llExeIconsLRU;
+static ULONG        G_cbExeIcons = 0;
+
+/*
+ *@@ LockExeIcons:
+ *      locks G_hmtxExeIcons. Creates the mutex on
+ *      the first call.
+ *
+ *      Returns TRUE if the mutex was obtained.
+ */
+
+STATIC BOOL LockExeIcons(VOID)
+{
+    if (G_hmtxExeIcons)
+        return !DosRequestMutexSem(G_hmtxExeIcons, SEM_INDEFINITE_WAIT);
+
+    // first call:
+    if (!DosCreateMutexSem(NULL,
+                           &G_hmtxExeIcons,
+                           0,
+                           TRUE))      // request!
+    {
+        treeInit(&G_ExeIconsTreeRoot,
+                 &G_cExeIcons);
+        lstInit(&G_llExeIconsLRU,
+                FALSE);     // no auto-free
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/*
+ *@@ QueryExeIconKey:
+ *      builds the cache key for the given executable
+ *      and resource ID and gets the file's size and
+ *      last write stamp.
+ *
+ *      Returns FALSE if the executable cannot be
+ *      cached (.COM, .BAT, .CMD, or the file info
+ *      isn't available).
+ */
+
+STATIC BOOL QueryExeIconKey(PEXECUTABLE pExec,
+                            ULONG idResource,
+                            PSZ pszKey,             // out: key (CCHMAXPATH + 10 bytes)
+                            PFILESTATUS3 pfs3)      // out: file info
+{
+    if (    (pExec->pFile)
+         && (pExec->pFile->pszFilename)
+         && (strlen(pExec->pFile->pszFilename) < CCHMAXPATH)
+         && (!DosQueryFileInfo(pExec->pFile->hf,
+                               FIL_STANDARD,
+                               pfs3,
+                               sizeof(FILESTATUS3)))
+       )
+    {
+        sprintf(pszKey,
+                "%lX:%s",
+                idResource,
+                pExec->pFile->pszFilename);
+        nlsUpper(pszKey);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/*
+ *@@ FindCachedExeIcon:
+ *      returns TRUE if the cache has an up-to-date entry
+ *      for the given executable and resource ID. *parc
+ *      then receives what icoLoadExeIcon returned for it
+ *      before, and if that was NO_ERROR, *ppbData receives
+ *      a malloc'd copy of the icon data.
+ *
+ *      Stale entries are removed.
+ */
+
+STATIC BOOL FindCachedExeIcon(PEXECUTABLE pExec,
+                              ULONG idResource,
+                              APIRET *parc,         // out: cached return code
+                              PBYTE *ppbData,       // out: icon data (to be free()'d)
+                              PULONG pcbData)       // out: size of icon data
+{
+    BOOL        brc = FALSE;
+    CHAR        szKey[CCHMAXPATH + 10];
+    FILESTATUS3 fs3;
+    BOOL        fLocked = FALSE;
+
+    if (!QueryExeIconKey(pExec, idResource, szKey, &fs3))
+        return FALSE;
+
+    TRY_LOUD(excpt1)
+    {
+        if (fLocked = LockExeIcons())
+        {
+            PEXEICONCACHE pEntry;
+            if (pEntry = (PEXEICONCACHE)treeFind(G_ExeIconsTreeRoot,
+                                                 (ULONG)szKey,
+                                                 treeCompareStrings))
+            {
+                if (    (pEntry->cbFile == fs3.cbFile)
+                     && (!memcmp(&pEntry->fdateLastWrite, &fs3.fdateLastWrite, sizeof(FDATE)))
+                     && (!memcmp(&pEntry->ftimeLastWrite, &fs3.ftimeLastWrite, sizeof(FTIME)))
+                   )
+                {
+                    if (!(*parc = pEntry->arc))
+                    {
+                        if (*ppbData = (PBYTE)malloc(pEntry->cbData))
+                        {
+                            memcpy(*ppbData, pEntry->pbData, pEntry->cbData);
+                            *pcbData = pEntry->cbData;
+                        }
+                        else
+                            *parc = ERROR_NOT_ENOUGH_MEMORY;
+                    }
+
+                    // most recently used now
+                    lstRemoveNode(&G_llExeIconsLRU, pEntry->pLRUNode);
+                    pEntry->pLRUNode = lstAppendItem(&G_llExeIconsLRU, pEntry);
+
+                    brc = TRUE;
+                }
+                else
+                {
+                    // file has changed: drop the entry
+                    treeDelete(&G_ExeIconsTreeRoot, &G_cExeIcons, (TREE*)pEntry);
+                    lstRemoveNode(&G_llExeIconsLRU, pEntry->pLRUNode);
+                    G_cbExeIcons -= pEntry->cbData;
+                    free(pEntry);
+                }
+            }
+        }
+    }
+    CATCH(excpt1)
+    {
+        brc = FALSE;
+    } END_CATCH();
+
+    if (fLocked)
+        DosReleaseMutexSem(G_hmtxExeIcons);
+
+    return brc;
+}
+
+/*
+ *@@ CacheExeIcon:
+ *      stores the result of an icoLoadExeIcon call in
+ *      the cache, evicting the least recently used
+ *      entries if the cache gets too large.
+ *
+ *      Only results that depend on the file contents
+ *      are stored (icon found, no icon, unknown format).
+ */
+
+STATIC VOID CacheExeIcon(PEXECUTABLE pExec,
+                         ULONG idResource,
+                         APIRET arc,
+                         PBYTE pbData,
+                         ULONG cbData)
+{
+    CHAR        szKey[CCHMAXPATH + 10];
+    FILESTATUS3 fs3;
+    BOOL        fLocked = FALSE;
+    ULONG       cbKey;
+    PEXEICONCACHE pEntry;
+
+    if (    (arc != NO_ERROR)
+         && (arc != ERROR_NO_DATA)
+         && (arc != ERROR_INVALID_EXE_SIGNATURE)
+       )
+        return;
+
+    if (arc)
+        cbData = 0;
+    else if (!pbData || !cbData || cbData > EXEICONCACHE_MAXBYTES / 16)
+        return;
+
+    if (!QueryExeIconKey(pExec, idResource, szKey, &fs3))
+        return;
+
+    cbKey = strlen(szKey) + 1;
+    if (!(pEntry = (PEXEICONCACHE)malloc(sizeof(EXEICONCACHE) + cbKey + cbData)))
+        return;
+
+    memcpy(pEntry->szKey, szKey, cbKey);
+    pEntry->Tree.ulKey = (ULONG)pEntry->szKey;
+    pEntry->cbFile = fs3.cbFile;
+    pEntry->fdateLastWrite = fs3.fdateLastWrite;
+    pEntry->ftimeLastWrite = fs3.ftimeLastWrite;
+    pEntry->arc = arc;
+    pEntry->cbData = cbData;
+    if (cbData)
+    {
+        pEntry->pbData = (PBYTE)pEntry->szKey + cbKey;
+        memcpy(pEntry->pbData, pbData, cbData);
+    }
+    else
+        pEntry->pbData = NULL;
+
+    TRY_LOUD(excpt1)
+    {
+        if (fLocked = LockExeIcons())
+        {
+            PLISTNODE pNode;
+
+            if (treeInsert(&G_ExeIconsTreeRoot,
+                           &G_cExeIcons,
+                           (TREE*)pEntry,
+                           treeCompareStrings))
+            {
+                // another thread got there first
+                free(pEntry);
+            }
+            else
+            {
+                pEntry->pLRUNode = lstAppendItem(&G_llExeIconsLRU, pEntry);
+                G_cbExeIcons += cbData;
+
+                // evict least recently used entries
+                while (    (G_cbExeIcons > EXEICONCACHE_MAXBYTES)
+                        && (pNode = lstQueryFirstNode(&G_llExeIconsLRU))
+                      )
+                {
+                    PEXEICONCACHE pOld = (PEXEICONCACHE)pNode->pItemData;
+                    treeDelete(&G_ExeIconsTreeRoot, &G_cExeIcons, (TREE*)pOld);
+                    lstRemoveNode(&G_llExeIconsLRU, pNode);
+                    G_cbExeIcons -= pOld->cbData;
+                    free(pOld);
+                }
+            }
+        }
+    }
+    CATCH(excpt1)
+    {
+    } END_CATCH();
+
+    if (fLocked)
+        DosReleaseMutexSem(G_hmtxExeIcons);
+}
+
 /*
  *@@ icoLoadExeIcon:
  *      smarter replacement for WinLoadFileIcon.
@@ -2056,6 +2344,9 @@ APIRET LoadWinPEResource(PEXECUTABLE pExec,     // in: executable from exehOpen
  *
  *      plus the error codes of exehOpen and icoBuildPtrHandle.
  *
+ *      The icon data (or the fact that there is none) is
+ *      cached per file and resource ID; see EXEICONCACHE.
+ *
  *@@added V0.9.16 (2001-12-08) [umoeller]
  *@@changed V0.9.18 (2002-03-19) [umoeller]: no longer checking buffer size
  *@@changed V0.9.20 (2002-07-03) [umoeller]: fixed major screwup if pExec was NULL
@@ -2086,66 +2377,83 @@ APIRET icoLoadExeIcon(PEXECUTABLE pExec,        // in: EXECUTABLE from exehOpen
 
     TRY_LOUD(excpt1)
     {
-        // check the executable type
-        switch (pExec->ulExeFormat)
+        // look into the cache first
+        if (!FindCachedExeIcon(pExec,
+                               idResource,
+                               &arc,
+                               &pbDataFree,
+                               &cbData))
         {
-            case EXEFORMAT_LX:
-                // these two we can handle for now
-                if (!(arc = exehLoadLXResource(pExec,
-                                               RT_POINTER,
-                                               idResource,
-                                               &pbDataFree,
-                                               &ulOfs,
-                                               &cbData)))
-                    pbDataUse = pbDataFree + ulOfs;
-            break;
+            // check the executable type
+            switch (pExec->ulExeFormat)
+            {
+                case EXEFORMAT_LX:
+                    // these two we can handle for now
+                    if (!(arc = exehLoadLXResource(pExec,
+                                                   RT_POINTER,
+                                                   idResource,
+                                                   &pbDataFree,
+                                                   &ulOfs,
+                                                   &cbData)))
+                        pbDataUse = pbDataFree + ulOfs;
+                break;
+
+                case EXEFORMAT_NE:
+                    switch (pExec->ulOS)
+                    {
+                        case EXEOS_OS2:
+                            arc = exehLoadOS2NEResource(pExec,
+                                                        RT_POINTER,
+                                                        idResource,
+                                                        &pbDataFree,
+                                                        &cbData);
+                            #ifdef __DEBUG__
+                                if (arc)
+                                    PMPF_ICONREPLACEMENTS(("LoadOS2NEResource returned %d", arc));
+                            #endif
+                        break;
 
-            case EXEFORMAT_NE:
-                switch (pExec->ulOS)
-                {
-                    case EXEOS_OS2:
-                        arc = exehLoadOS2NEResource(pExec,
-                                                    RT_POINTER,
+                        case EXEOS_WIN16:
+                        case EXEOS_WIN386:
+                            arc = LoadWinNEResource(pExec,
+                                                    WINRT_ICON,
                                                     idResource,
                                                     &pbDataFree,
                                                     &cbData);
-                        #ifdef __DEBUG__
-                            if (arc)
-                                PMPF_ICONREPLACEMENTS(("LoadOS2NEResource returned %d", arc));
-                        #endif
-                    break;
+                            #ifdef __DEBUG__
+                                if (arc)
+                                    PMPF_ICONREPLACEMENTS(("LoadWinNEResource returned %d", arc));
+                            #endif
+                        break;
 
-                    case EXEOS_WIN16:
-                    case EXEOS_WIN386:
-                        arc = LoadWinNEResource(pExec,
-                                                WINRT_ICON,
-                                                idResource,
-                                                &pbDataFree,
-                                                &cbData);
-                        #ifdef __DEBUG__
-                            if (arc)
-                                PMPF_ICONREPLACEMENTS(("LoadWinNEResource returned %d", arc));
-                        #endif
-                    break;
+                        default:
+                            arc = ERROR_INVALID_EXE_SIGNATURE;
+                    }
+                break;
 
-                    default:
-                        arc = ERROR_INVALID_EXE_SIGNATURE;
-                }
-            break;
+                case EXEFORMAT_PE:
+                    arc = LoadWinPEResource(pExec,
+                                            WINRT_ICON,
+                                            idResource,
+                                            &pbDataFree,
+                                            &cbData);
 
-            case EXEFORMAT_PE:
-                arc = LoadWinPEResource(pExec,
-                                        WINRT_ICON,
-                                        idResource,
-                                        &pbDataFree,
-                                        &cbData);
+                    PMPF_ICONREPLACEMENTS(("LoadWinPEResource returned %d", arc));
+                break;
 
-                PMPF_ICONREPLACEMENTS(("LoadWinPEResource returned %d", arc));
-            break;
+                default:        // includes COM, BAT, CMD
+                    arc = ERROR_INVALID_EXE_SIGNATURE;
+                break;
+            }
 
-            default:        // includes COM, BAT, CMD
-                arc = ERROR_INVALID_EXE_SIGNATURE;
-            break;
+            if (!arc && !pbDataUse)
+                pbDataUse = pbDataFree;
+
+            CacheExeIcon(pExec,
+                         idResource,
+                         arc,
+                         pbDataUse,
+                         cbData);
         }
 
         // output data
@@ -849,6 +849,15 @@ BOOL objQuerySetup(WPObject *somSelf,
  *
  ********************************************************************/
 
+// line breaks in titles are written out as "^";
+// "\r\n" must come before "\r"
+static const XSTRREPLACE G_aLineBreaks[] =
+    {
+        { "\r\n", "^" },
+        { "\r", "^" },
+        { "\n", "^" }
+    };
+
 /*
  *@@ WriteOutObjectSetup:
  *
@@ -874,7 +883,6 @@ STATIC ULONG WriteOutObjectSetup(FILE *RexxFile,
 
         CHAR        szFolderName[CCHMAXPATH];
         XSTRING     strTitle;
-        ULONG       ulOfs;
         CHAR        cQuote = '\"';
 
         BOOL        fIsDisk = !strcmp(pszTrueClassName, G_pcszWPDisk);
@@ -889,15 +897,7 @@ STATIC ULONG WriteOutObjectSetup(FILE *RexxFile,
 
         // special hack for line breaks in titles: "^"
         xstrInitCopy(&strTitle, _wpQueryTitle(pobj), 0);
-        ulOfs = 0;
-        while (xstrFindReplaceC(&strTitle, &ulOfs, "\r\n", "^"))
-            ;
-        ulOfs = 0;
-        while (xstrFindReplaceC(&strTitle, &ulOfs, "\r", "^"))
-            ;
-        ulOfs = 0;
-        while (xstrFindReplaceC(&strTitle, &ulOfs, "\n", "^"))
-            ;
+        xstrReplaceMulti(&strTitle, G_aLineBreaks, ARRAYITEMCOUNT(G_aLineBreaks));
 
         // if we have a quote:
         if (strchr(strTitle.psz, '\"'))
@@ -1719,6 +1719,73 @@ ULONG objForAllDirtyObjects(FNFORALLDIRTIESCALLBACK *pCallback,  // in: callback
     return ulrc;
 }
 
+/*
+ *@@ objLockDirtyObjects:
+ *      returns a snapshot of the "dirty" list as a
+ *      malloc()'d array of object pointers and stores
+ *      the item count in *pcObjects. Each object on
+ *      the array has been locked with wpLockObject
+ *      so that it cannot go dormant while the caller
+ *      works on it.
+ *
+ *      Unlike with objForAllDirtyObjects, the "dirty"
+ *      list is not locked while the caller processes
+ *      the array, so several threads can safely invoke
+ *      wpSaveImmediate on the items. XShutdown uses this
+ *      to save objects while windows are still being
+ *      closed.
+ *
+ *      The caller must call wpUnlockObject on every
+ *      item and free() the array.
+ *
+ *      Returns NULL if the list is empty.
+ */
+
+WPObject** objLockDirtyObjects(PULONG pcObjects)      // out: array item count
+{
+    WPObject    **papObjects = NULL;
+    BOOL        fLocked = FALSE;
+
+    *pcObjects = 0;
+
+    TRY_LOUD(excpt1)
+    {
+        if (fLocked = LockDirtyList())
+        {
+            LONG        cObjects = G_lDirtyListItemsCount;
+            TREE        **papNodes;
+            if (    (cObjects)
+                 && (papNodes = treeBuildArray(G_DirtyList,
+                                               &cObjects))
+               )
+            {
+                if (papObjects = (WPObject**)malloc(cObjects * sizeof(WPObject*)))
+                {
+                    LONG    l;
+                    for (l = 0;
+                         l < cObjects;
+                         l++)
+                    {
+                        WPObject *pobj = (WPObject*)(papNodes[l]->ulKey);
+                        _wpLockObject(pobj);
+                        papObjects[l] = pobj;
+                    }
+
+                    *pcObjects = cObjects;
+                }
+
+                free(papNodes);
+            }
+        }
+    }
+    CATCH(excpt1) { } END_CATCH();
+
+    if (fLocked)
+        UnlockDirtyList();
+
+    return papObjects;
+}
+
 /* ******************************************************************
  *
  *   Object hotkeys
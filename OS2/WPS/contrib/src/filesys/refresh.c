@@ -113,6 +113,7 @@
 // C library headers
 #include <stdio.h>
 #include <setjmp.h>
+#include <ctype.h>
 
 // generic headers
 #include "setup.h"                      // code generation and debugging options
@@ -160,6 +161,15 @@ static HMTX            G_hmtxNotifyClients = NULLHANDLE;
 // global list of all notifications (auto-free)
 static LINKLIST        G_llAllNotifications;
 
+// the same notifications hashed by folder and short name
+// so that AddNotifyIfNotRedundant need not scan the list
+#define NOTIFY_HASH_SIZE        1024        // must be a power of two
+static PXWPNOTIFY      G_apNotifyHash[NOTIFY_HASH_SIZE];
+
+// if this many notifications are pending for one folder,
+// they are replaced with a single full refresh
+#define NOTIFY_FLOOD_THRESHOLD  300
+
 // global list of notification handles for notify server  V1.0.8 (2007-08-10) [pr]
 static LINKLIST        G_llNotifyHandles;
 
@@ -186,6 +196,55 @@ static BOOL            G_fExitAllRefreshThreads = FALSE;
  *
  ********************************************************************/
 
+/*
+ *@@ HashNotification:
+ *      returns the hash value for the given folder and
+ *      short name, without respect to case. pcszShortName
+ *      is NULL for RCNF_XWP_FULLREFRESH, so that every
+ *      folder has at most one full refresh slot.
+ */
+
+STATIC ULONG HashNotification(WPFolder *pFolder,
+                              PCSZ pcszShortName)
+{
+    ULONG ulHash = (ULONG)pFolder;
+
+    if (pcszShortName)
+        while (*pcszShortName)
+            ulHash = ulHash * 31 + toupper(*pcszShortName++);
+
+    return ulHash ^ (ulHash >> 10);
+}
+
+/*
+ *@@ FindFullRefresh:
+ *      returns the pending RCNF_XWP_FULLREFRESH
+ *      notification for the given folder, or NULL
+ *      if there is none.
+ *
+ *      Preconditions:
+ *
+ *      -- The caller must have the global WPS notify
+ *         mutex.
+ */
+
+STATIC PXWPNOTIFY FindFullRefresh(WPFolder *pFolder)
+{
+    ULONG       ulHash = HashNotification(pFolder, NULL);
+    PXWPNOTIFY  pNotify;
+
+    for (pNotify = G_apNotifyHash[ulHash & (NOTIFY_HASH_SIZE - 1)];
+         pNotify;
+         pNotify = pNotify->pNextHash)
+        if (    (pNotify->ulHash == ulHash)
+             && (pNotify->pFolder == pFolder)
+             && (pNotify->CNInfo.bAction == RCNF_XWP_FULLREFRESH)
+           )
+            return pNotify;
+
+    return NULL;
+}
+
 /*
  *@@ refrAddNotification:
  *      adds the specified notification to the linked
@@ -207,13 +266,24 @@ static BOOL            G_fExitAllRefreshThreads = FALSE;
 VOID refrAddNotification(PXWPNOTIFY pNotify)
 {
     XFolderData *somThis = XFolderGetData(pNotify->pFolder);
+    PXWPNOTIFY  *ppBucket;
+
     (_cNotificationsPending)++;
 
     // store current system time in pNotify
     pNotify->ulMS = doshQuerySysUptime();
 
     // append to the global list (auto-free)
-    lstAppendItem(&G_llAllNotifications, pNotify);
+    pNotify->pGlobalNode = lstAppendItem(&G_llAllNotifications, pNotify);
+
+    // and to the hash; pShortName is not valid for full refresh
+    pNotify->ulHash = HashNotification(pNotify->pFolder,
+                                       (pNotify->CNInfo.bAction == RCNF_XWP_FULLREFRESH)
+                                           ? NULL
+                                           : pNotify->pShortName);
+    ppBucket = &G_apNotifyHash[pNotify->ulHash & (NOTIFY_HASH_SIZE - 1)];
+    pNotify->pNextHash = *ppBucket;
+    *ppBucket = pNotify;
 
     // post the event sem for the pump thread
     // V0.9.16 (2002-01-09) [umoeller]: moved this here,
@@ -272,15 +342,26 @@ VOID refrTouchNotification(PXWPNOTIFY pNotify)
  */
 
 VOID refrRemoveNotification(PXWPNOTIFY pNotify,
-                            PLISTNODE pGlobalNode)      // or NULL if unknown (slower)
+                            PLISTNODE pGlobalNode)      // or NULL if unknown
 {
     XFolderData *somThis = XFolderGetData(pNotify->pFolder);
+    PXWPNOTIFY  *ppThis;
+
     (_cNotificationsPending)--;
 
+    // unlink from the hash bucket
+    for (ppThis = &G_apNotifyHash[pNotify->ulHash & (NOTIFY_HASH_SIZE - 1)];
+         *ppThis;
+         ppThis = &(*ppThis)->pNextHash)
+        if (*ppThis == pNotify)
+        {
+            *ppThis = pNotify->pNextHash;
+            break;
+        }
+
     if (!pGlobalNode)
-        // not specified: search it then
-        pGlobalNode = lstNodeFromItem(&G_llAllNotifications,
-                                      pNotify);
+        // not specified: refrAddNotification stored it
+        pGlobalNode = (PLISTNODE)pNotify->pGlobalNode;
 
     if (pGlobalNode)
         // remove from global list
@@ -616,9 +697,11 @@ STATIC BOOL PumpNotifications(VOID)
                 switch (PumpAgedNotification(pNotify))
                 {
                     case REMOVE_NODE:
-                        // ok, remove the node:
-                        lstRemoveNode(&G_llAllNotifications,
-                                      pGlobalNodeThis);
+                        // ok, remove the node (this also takes
+                        // it off the hash and fixes the folder's
+                        // pending count):
+                        refrRemoveNotification(pNotify,
+                                               pGlobalNodeThis);
                     break;
 
                     case REMOVE_FOLDER:
@@ -737,6 +820,12 @@ STATIC VOID _Optlink fntPumpThread(PTHREADINFO ptiMyself)
  *      list, we can simply ignore the new notification (and delete
  *      the old one as well).
  *
+ *      Pending notifications are found through G_apNotifyHash,
+ *      so this does not depend on the length of the list.
+ *      If more than NOTIFY_FLOOD_THRESHOLD notifications are
+ *      pending for the folder, they are all replaced with a
+ *      single RCNF_XWP_FULLREFRESH.
+ *
  *      Returns TRUE if the notification was important and
  *      added to the global list and the respective folder.
  *      In that case, the caller MUST NOT FREE the notification.
@@ -770,10 +859,11 @@ STATIC BOOL AddNotifyIfNotRedundant(PXWPNOTIFY pNotify)
     if (pNotify)
     {
         // hack the folder's instance data directly...
-        // XFolderData *somThat = XFolderGetData(pNotify->pFolder);
+        XFolderData *somThat = XFolderGetData(pNotify->pFolder);
 
         BYTE        bActionThis = pNotify->CNInfo.bAction;
         BYTE        bOpposite = 0;
+        PXWPNOTIFY  pNotifyThat;
 
         // let's say: add this one now
         fAddThis = TRUE;
@@ -783,53 +873,59 @@ STATIC BOOL AddNotifyIfNotRedundant(PXWPNOTIFY pNotify)
          *
          */
 
-        // for FILE_DELETED, drop previous FILE_ADDED (temp file)
-        if (bActionThis == RCNF_FILE_DELETED)
-            bOpposite = RCNF_FILE_ADDED;
-        // for DIR_DELETED, drop previous DIR_ADDED
-        else if (bActionThis == RCNF_DIR_DELETED)
-            bOpposite = RCNF_DIR_ADDED;
-
-        // besides, drop RCNF_CHANGED if we have a
-        // RCNF_FILE_ADDED in the queue already
-        if (    (bOpposite)
-             || (bActionThis == RCNF_CHANGED)
-             || (bActionThis == RCNF_XWP_FULLREFRESH) // V0.9.19 (2002-05-23) [umoeller]
-           )
+        // if we have a full refresh (due to overflow)
+        // pending for the folder, do not add any
+        // additional items, but touch the full refresh
+        // instead; this includes multiple full refresh
+        // notifications
+        // V0.9.19 (2002-05-23) [umoeller]
+        if (pNotifyThat = FindFullRefresh(pNotify->pFolder))
+        {
+            // drop the new notification
+            fAddThis = FALSE;
+            // reset the time of the old full
+            // refresh notification
+            refrTouchNotification(pNotifyThat);
+        }
+        else
         {
-            // yes, check redundancy:
-            PLISTNODE pNode = lstQueryFirstNode(&G_llAllNotifications);
-            while (pNode)
+            // for FILE_DELETED, drop previous FILE_ADDED (temp file)
+            if (bActionThis == RCNF_FILE_DELETED)
+                bOpposite = RCNF_FILE_ADDED;
+            // for DIR_DELETED, drop previous DIR_ADDED
+            else if (bActionThis == RCNF_DIR_DELETED)
+                bOpposite = RCNF_DIR_ADDED;
+
+            // besides, drop RCNF_CHANGED if we have a
+            // RCNF_FILE_ADDED in the queue already
+            if (    (bOpposite)
+                 || (bActionThis == RCNF_CHANGED)
+               )
             {
-                PLISTNODE pNext = pNode->pNext;
-                PXWPNOTIFY  pNotifyThat = (PXWPNOTIFY)pNode->pItemData;
-
-                // is this notification for the same folder?
-                // V0.9.19 (2002-05-23) [umoeller]
-                if (pNotify->pFolder == pNotifyThat->pFolder)
+                // yes, check redundancy: only notifications
+                // for the same folder and file name can be
+                // in the same bucket with the same hash
+                ULONG ulHash = HashNotification(pNotify->pFolder,
+                                                pNotify->pShortName);
+
+                for (pNotifyThat = G_apNotifyHash[ulHash & (NOTIFY_HASH_SIZE - 1)];
+                     pNotifyThat;
+                     pNotifyThat = pNotifyThat->pNextHash)
                 {
                     BYTE bActionThat = pNotifyThat->CNInfo.bAction;
 
-                    // if we have a full refresh (due to overflow)
-                    // pending for the folder, do not add any
-                    // additional items, but touch the full refresh
-                    // instead; this includes multiple full refresh
-                    // notifications
+                    // is this notification for the same file
+                    // in the same folder?
                     // V0.9.19 (2002-05-23) [umoeller]
-                    if (bActionThat == RCNF_XWP_FULLREFRESH)
-                    {
-                        // drop the new notification
-                        fAddThis = FALSE;
-                        // reset the time of the old full
-                        // refresh notification
-                        refrTouchNotification(pNotifyThat);
+                    if (    (pNotifyThat->ulHash != ulHash)
+                         || (pNotify->pFolder != pNotifyThat->pFolder)
+                         || (bActionThat == RCNF_XWP_FULLREFRESH)
+                         || (stricmp(pNotify->pShortName,
+                                     pNotifyThat->pShortName))
+                       )
+                        continue;
 
-                        break;
-                    }
-                    else if (    (bActionThat == bOpposite)
-                              && (!stricmp(pNotify->pShortName,
-                                           pNotifyThat->pShortName))
-                            )
+                    if (bActionThat == bOpposite)
                     {
                         // same file name:
                         // drop it, it's redundant
@@ -837,7 +933,7 @@ STATIC BOOL AddNotifyIfNotRedundant(PXWPNOTIFY pNotify)
 
                         // and remove the old notification as well
                         refrRemoveNotification(pNotifyThat,
-                                               pNode);
+                                               NULL);
 
                         break;
                     }
@@ -850,23 +946,30 @@ STATIC BOOL AddNotifyIfNotRedundant(PXWPNOTIFY pNotify)
                               || (bActionThis == bActionThat)
                             )
                     {
-                        if (!stricmp(pNotify->pShortName,
-                                     pNotifyThat->pShortName))
-                        {
-                            fAddThis = FALSE;
+                        fAddThis = FALSE;
 
-                            // reset the time of the old notification
-                            // V0.9.19 (2002-05-23) [umoeller]
-                            refrTouchNotification(pNotifyThat);
+                        // reset the time of the old notification
+                        // V0.9.19 (2002-05-23) [umoeller]
+                        refrTouchNotification(pNotifyThat);
 
-                            break;
-                        }
+                        break;
                     }
-                }
+                } // for (pNotifyThat...
+            }
 
-                pNode = pNext;
-            } // while (pFolderNode)
-        } // end if (somThat->pvllNotifications)
+            // if the folder is being flooded (make, unzip),
+            // replace everything pending for it with a single
+            // full refresh; all further notifications for the
+            // folder are then dropped by FindFullRefresh above
+            // until the pump thread has run the refresh
+            if (    (fAddThis)
+                 && (somThat->cNotificationsPending >= NOTIFY_FLOOD_THRESHOLD)
+               )
+            {
+                refrClearFolderNotifications(pNotify->pFolder);
+                pNotify->CNInfo.bAction = RCNF_XWP_FULLREFRESH;
+            }
+        }
 
         /*
          *  (2) append the notification:
@@ -1095,17 +1095,19 @@ VOID trshCalcTrashObjectSize(XWPTrashObject *pTrashObject,
     if (pTrashObject)
     {
         WPObject *pRelatedObject = _xwpQueryRelatedObject(pTrashObject);
-        // create structured file list for this object;
+        // add up the size of this object and everything in it;
         // if this is a folder, this can possibly take a
         // long time
-        PEXPANDEDOBJECT pSOI = fopsExpandObjectDeep(pRelatedObject,
-                                                    TRUE);  // folders only
-        if (pSOI)
+        LONGLONG llSize;
+
+        if (wpshCheckObject(pRelatedObject))
         {
+            fopsQueryObjectSizeDeep(pRelatedObject,
+                                    TRUE,          // folders only
+                                    &llSize);
             _xwpSetExpandedObjectSizeL(pTrashObject,
-                                       &pSOI->llSizeThis,  // V1.0.9
+                                       &llSize,  // V1.0.9
                                        pTrashCan);
-            fopsFreeExpandedObject(pSOI);
         }
     }
 
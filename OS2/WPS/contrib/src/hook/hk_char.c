@@ -192,10 +192,9 @@ BOOL WMChar_Hotkeys(USHORT usFlagsOrig,  // in: SHORT1FROMMP(mp1) from WM_CHAR
                 // only for the key-down event,
                 // notify daemon
                 if ((usFlagsOrig & KC_KEYUP) == 0)
-                    WinPostMsg(G_HookData.hwndDaemonObject,
-                               XDM_HOTKEYPRESSED,
-                               (MPARAM)(pKeyThis->ulHandle),
-                               (MPARAM)0);
+                    hookPostDaemon(XDM_HOTKEYPRESSED,
+                                   (MPARAM)(pKeyThis->ulHandle),
+                                   (MPARAM)0);
 
                 // reset return code: swallow this message
                 // (both key-down and key-up)
@@ -217,6 +216,267 @@ BOOL WMChar_Hotkeys(USHORT usFlagsOrig,  // in: SHORT1FROMMP(mp1) from WM_CHAR
     return brc;
 }
 
+/*
+ *@@ WMChar_HashedFunctionKey:
+ *      like WMChar_FunctionKeys, but uses the function
+ *      key bitmap in HOOKDATA.Hotkeys, so no semaphore
+ *      or shared memory is needed.
+ */
+
+BOOL WMChar_HashedFunctionKey(USHORT usFlags,  // in: SHORT1FROMMP(mp1) from WM_CHAR
+                              UCHAR ucScanCode) // in: CHAR4FROMMP(mp1) from WM_CHAR
+{
+    return (    (usFlags & KC_SCANCODE)
+             && (G_HookData.Hotkeys.abFunctionKeys[ucScanCode >> 3] & (1 << (ucScanCode & 7)))
+           );
+}
+
+/*
+ *@@ WMChar_HashedHotkeys:
+ *      like WMChar_Hotkeys, but looks up the key in the
+ *      hashed HOTKEYTABLE in HOOKDATA instead of scanning
+ *      the shared memory list.
+ *
+ *      The table may be rebuilt by hookSetGlobalHotkeys on
+ *      the daemon's thread while we are looking; we then
+ *      see a changed or odd ulGeneration and look again.
+ *      Matches are only posted once a consistent pass has
+ *      been made.
+ */
+
+BOOL WMChar_HashedHotkeys(USHORT usFlagsOrig,  // in: SHORT1FROMMP(mp1) from WM_CHAR
+                          UCHAR ucScanCode) // in: CHAR4FROMMP(mp1) from WM_CHAR
+{
+    PHOTKEYTABLE pTable = &G_HookData.Hotkeys;
+    USHORT  usFlags = usFlagsOrig & (KC_CTRL | KC_ALT | KC_SHIFT);
+    ULONG   aulHandles[8];
+    ULONG   cHandles = 0,
+            cTries,
+            ul;
+
+    for (cTries = 0;
+         cTries < 8;
+         cTries++)
+    {
+        ULONG   ulGeneration = pTable->ulGeneration,
+                ulSlot = HOTKEYHASH(ucScanCode, usFlags),
+                cProbed = 0;
+
+        if (ulGeneration & 1)
+            // being rebuilt right now
+            continue;
+
+        cHandles = 0;
+        while (    (pTable->aSlots[ulSlot].fUsed)
+                && (cProbed++ < HOTKEYHASH_SIZE)
+              )
+        {
+            if (    (pTable->aSlots[ulSlot].ucScanCode == ucScanCode)
+                 && (pTable->aSlots[ulSlot].usFlags == usFlags)
+                 && (cHandles < sizeof(aulHandles) / sizeof(aulHandles[0]))
+               )
+                aulHandles[cHandles++] = pTable->aSlots[ulSlot].ulHandle;
+
+            ulSlot = (ulSlot + 1) & HOTKEYHASH_MASK;
+        }
+
+        if (ulGeneration == pTable->ulGeneration)
+            break;
+    }
+
+    if (cTries >= 8)
+        // table kept changing under us; let the key through
+        return FALSE;
+
+    // only for the key-down event, notify daemon;
+    // swallow both key-down and key-up (see WMChar_Hotkeys)
+    if ((usFlagsOrig & KC_KEYUP) == 0)
+        for (ul = 0;
+             ul < cHandles;
+             ul++)
+            hookPostDaemon(XDM_HOTKEYPRESSED,
+                           (MPARAM)aulHandles[ul],
+                           (MPARAM)0);
+
+    return (cHandles != 0);
+}
+
+/*
+ *@@ WMChar_CheckHotkeys:
+ *      the object hotkey and function key part of
+ *      WM_CHAR processing, extracted from WMChar_Main.
+ *
+ *      If fHashed is TRUE, this uses the hashed
+ *      HOTKEYTABLE in HOOKDATA and needs no locks.
+ *      Otherwise the caller must hold the global
+ *      hotkeys mutex, and the shared memory lists
+ *      are scanned.
+ *
+ *      Returns TRUE if the message is to be swallowed.
+ */
+
+BOOL WMChar_CheckHotkeys(PQMSG pqmsg,       // in: from hookPreAccelHook
+                         BOOL fHashed)      // in: use HOOKDATA.Hotkeys
+{
+    BOOL brc = FALSE;
+
+    USHORT usFlags    = SHORT1FROMMP(pqmsg->mp1);
+    UCHAR  ucScanCode = CHAR4FROMMP(pqmsg->mp1);
+    USHORT usch       = SHORT1FROMMP(pqmsg->mp2);
+
+    // search the list of function keys
+    BOOL    fIsFunctionKey = (fHashed)
+                                ? WMChar_HashedFunctionKey(usFlags, ucScanCode)
+                                : WMChar_FunctionKeys(usFlags, ucScanCode);
+                // returns TRUE if ucScanCode represents one of the
+                // function keys
+
+    // global hotkeys enabled? This also gets called if XPager hotkeys are on!
+#ifndef __ALWAYSOBJHOTKEYS__
+    if (G_HookData.HookConfig.__fGlobalHotkeys)
+#endif
+    {
+        if (    // process only key-down messages
+                // ((usFlags & KC_KEYUP) == 0)
+                // check flags:
+                // do the list search only if the key could be
+                // a valid hotkey, that is:
+                (
+                    // 1) it's a function key
+                    (fIsFunctionKey)
+
+                    // or 2) it's a typical virtual key or Ctrl/alt/etc combination
+                ||  (     ((usFlags & KC_VIRTUALKEY) != 0)
+                          // Ctrl pressed?
+                       || ((usFlags & KC_CTRL) != 0)
+                          // Alt pressed?
+                       || ((usFlags & KC_ALT) != 0)
+                          // or one of the Win95 keys?
+                       || (   ((usFlags & KC_VIRTUALKEY) == 0)
+                           && (     (usch == 0xEC00)
+                                ||  (usch == 0xED00)
+                                ||  (usch == 0xEE00)
+                              )
+                          )
+                    )
+                )
+                // always filter out those ugly composite key (accents etc.),
+                // but make sure the scan code is valid V0.9.3 (2000-04-10) [umoeller]
+           &&   ((usFlags & (KC_DEADKEY
+                             | KC_COMPOSITE
+                             | KC_INVALIDCOMP
+                             | KC_SCANCODE))
+                  == KC_SCANCODE)
+           )
+        {
+              /*
+         In PM session:
+                                      usFlags         usvk usch       ucsk
+              Ctrl alone              VK SC CTRL       0a     0        1d
+              Ctrl-A                     SC CTRL        0    61        1e
+              Ctrl-Alt                VK SC CTRL ALT   0b     0        38
+              Ctrl-Alt-A                 SC CTRL ALT    0    61        1e
+
+              F11 alone               VK SC toggle     2a  8500        57
+              Ctrl alone              VK SC CTRL       0a     0        1d
+              Ctrl-Alt                VK SC CTRL ALT   0b     0        38
+              Ctrl-Alt-F11            VK SC CTRL ALT   2a  8b00        57
+
+         In VIO session:
+              Ctrl alone                 SC CTRL       07   0          1d
+              Ctrl-A                     SC CTRL        0   1e01       1e
+              Ctrl-Alt                   SC CTRL ALT   07   0          38
+              Ctrl-Alt-A                 SC CTRL ALT   20   1e00       1e
+
+              Alt-A                      SC      ALT   20   1e00
+              Ctrl-E                     SC CTRL        0   3002
+
+              F11 alone               ignored...
+              Ctrl alone              VK SC CTRL       07!    0        1d
+              Ctrl-Alt                VK SC CTRL ALT   07!    0        38
+              Ctrl-Alt-F11            !! SC CTRL ALT   20! 8b00        57
+
+              So apparently, for these keyboard combinations, in VIO
+              sessions, the KC_VIRTUALKEY flag is missing. Strange.
+
+              */
+
+            #ifdef _PMPRINTF_
+                    CHAR    szFlags[2000] = "";
+                    if (usFlags & KC_CHAR)                      // 0x0001
+                        strcat(szFlags, "KC_CHAR ");
+                    if (usFlags & KC_VIRTUALKEY)                // 0x0002
+                        strcat(szFlags, "KC_VIRTUALKEY ");
+                    if (usFlags & KC_SCANCODE)                  // 0x0004
+                        strcat(szFlags, "KC_SCANCODE ");
+                    if (usFlags & KC_SHIFT)                     // 0x0008
+                        strcat(szFlags, "KC_SHIFT ");
+                    if (usFlags & KC_CTRL)                      // 0x0010
+                        strcat(szFlags, "KC_CTRL ");
+                    if (usFlags & KC_ALT)                       // 0x0020
+                        strcat(szFlags, "KC_ALT ");
+                    if (usFlags & KC_KEYUP)                     // 0x0040
+                        strcat(szFlags, "KC_KEYUP ");
+                    if (usFlags & KC_PREVDOWN)                  // 0x0080
+                        strcat(szFlags, "KC_PREVDOWN ");
+                    if (usFlags & KC_LONEKEY)                   // 0x0100
+                        strcat(szFlags, "KC_LONEKEY ");
+                    if (usFlags & KC_DEADKEY)                   // 0x0200
+                        strcat(szFlags, "KC_DEADKEY ");
+                    if (usFlags & KC_COMPOSITE)                 // 0x0400
+                        strcat(szFlags, "KC_COMPOSITE ");
+                    if (usFlags & KC_INVALIDCOMP)               // 0x0800
+                        strcat(szFlags, "KC_INVALIDCOMP ");
+                    if (usFlags & KC_TOGGLE)                    // 0x1000
+                        strcat(szFlags, "KC_TOGGLE ");
+                    if (usFlags & KC_INVALIDCHAR)               // 0x2000
+                        strcat(szFlags, "KC_INVALIDCHAR ");
+                    if (usFlags & KC_DBCSRSRVD1)                // 0x4000
+                        strcat(szFlags, "KC_DBCSRSRVD1 ");
+                    if (usFlags & KC_DBCSRSRVD2)                // 0x8000
+                        strcat(szFlags, "KC_DBCSRSRVD2 ");
+
+                    _Pmpf(("  usFlags: 0x%lX -->", usFlags));
+                    _Pmpf(("    %s", szFlags));
+                    _Pmpf(("  usvk: 0x%lX", usvk));
+                    _Pmpf(("  usch: 0x%lX", usch));
+                    _Pmpf(("  ucScanCode: 0x%lX", ucScanCode));
+            #endif
+
+    /* #ifdef __DEBUG__
+            // debug code:
+            // enable Ctrl+Alt+Delete emergency exit
+            if (    (   (usFlags & (KC_CTRL | KC_ALT | KC_KEYUP))
+                         == (KC_CTRL | KC_ALT)
+                    )
+                  && (ucScanCode == 0x0e)    // delete
+               )
+            {
+                ULONG ul;
+                for (ul = 5000;
+                     ul > 100;
+                     ul -= 200)
+                    DosBeep(ul, 20);
+
+                WinPostMsg(G_HookData.hwndDaemonObject,
+                           WM_QUIT,
+                           0, 0);
+                brc = TRUE;     // swallow
+            }
+            else
+    #endif */
+
+            if (    (fHashed)
+                        ? WMChar_HashedHotkeys(usFlags, ucScanCode)
+                        : WMChar_Hotkeys(usFlags, ucScanCode)
+               )
+                // returns TRUE (== swallow) if hotkey was found
+                brc = TRUE;
+        }
+    }
+    return brc;
+}
+
 /*
  *@@ WMChar_Main:
  *      WM_CHAR processing in hookPreAccelHook.
@@ -262,163 +522,22 @@ BOOL WMChar_Main(PQMSG pqmsg)       // in/out: from hookPreAccelHook
     // V0.9.16 (2001-12-06) [umoeller]
     if (!G_HookData.fHotkeysDisabledTemp)
     {
-        // request access to the hotkeys mutex:
+        if (G_HookData.Hotkeys.fHashed)
+            // hashed copy in HOOKDATA: no mutex and no
+            // shared memory access needed for this key
+            brc = WMChar_CheckHotkeys(pqmsg, TRUE);
+        // otherwise request access to the hotkeys mutex:
         // first we need to open it, because this
         // code can be running in any PM thread in
         // any process
-        if (!(arc = DosOpenMutexSem(NULL,       // unnamed
-                                    &G_hmtxGlobalHotkeys)))
+        else if (!(arc = DosOpenMutexSem(NULL,       // unnamed
+                                         &G_hmtxGlobalHotkeys)))
         {
             // OK, semaphore opened: request access
             if (!(arc = DosRequestMutexSem(G_hmtxGlobalHotkeys,
                                            TIMEOUT_HMTX_HOTKEYS)))
             {
-                // OK, we got the mutex:
-                // search the list of function keys
-                BOOL    fIsFunctionKey = WMChar_FunctionKeys(usFlags, ucScanCode);
-                            // returns TRUE if ucScanCode represents one of the
-                            // function keys
-
-                // global hotkeys enabled? This also gets called if XPager hotkeys are on!
-#ifndef __ALWAYSOBJHOTKEYS__
-                if (G_HookData.HookConfig.__fGlobalHotkeys)
-#endif
-                {
-                    if (    // process only key-down messages
-                            // ((usFlags & KC_KEYUP) == 0)
-                            // check flags:
-                            // do the list search only if the key could be
-                            // a valid hotkey, that is:
-                            (
-                                // 1) it's a function key
-                                (fIsFunctionKey)
-
-                                // or 2) it's a typical virtual key or Ctrl/alt/etc combination
-                            ||  (     ((usFlags & KC_VIRTUALKEY) != 0)
-                                      // Ctrl pressed?
-                                   || ((usFlags & KC_CTRL) != 0)
-                                      // Alt pressed?
-                                   || ((usFlags & KC_ALT) != 0)
-                                      // or one of the Win95 keys?
-                                   || (   ((usFlags & KC_VIRTUALKEY) == 0)
-                                       && (     (usch == 0xEC00)
-                                            ||  (usch == 0xED00)
-                                            ||  (usch == 0xEE00)
-                                          )
-                                      )
-                                )
-                            )
-                            // always filter out those ugly composite key (accents etc.),
-                            // but make sure the scan code is valid V0.9.3 (2000-04-10) [umoeller]
-                       &&   ((usFlags & (KC_DEADKEY
-                                         | KC_COMPOSITE
-                                         | KC_INVALIDCOMP
-                                         | KC_SCANCODE))
-                              == KC_SCANCODE)
-                       )
-                    {
-                          /*
-                     In PM session:
-                                                  usFlags         usvk usch       ucsk
-                          Ctrl alone              VK SC CTRL       0a     0        1d
-                          Ctrl-A                     SC CTRL        0    61        1e
-                          Ctrl-Alt                VK SC CTRL ALT   0b     0        38
-                          Ctrl-Alt-A                 SC CTRL ALT    0    61        1e
-
-                          F11 alone               VK SC toggle     2a  8500        57
-                          Ctrl alone              VK SC CTRL       0a     0        1d
-                          Ctrl-Alt                VK SC CTRL ALT   0b     0        38
-                          Ctrl-Alt-F11            VK SC CTRL ALT   2a  8b00        57
-
-                     In VIO session:
-                          Ctrl alone                 SC CTRL       07   0          1d
-                          Ctrl-A                     SC CTRL        0   1e01       1e
-                          Ctrl-Alt                   SC CTRL ALT   07   0          38
-                          Ctrl-Alt-A                 SC CTRL ALT   20   1e00       1e
-
-                          Alt-A                      SC      ALT   20   1e00
-                          Ctrl-E                     SC CTRL        0   3002
-
-                          F11 alone               ignored...
-                          Ctrl alone              VK SC CTRL       07!    0        1d
-                          Ctrl-Alt                VK SC CTRL ALT   07!    0        38
-                          Ctrl-Alt-F11            !! SC CTRL ALT   20! 8b00        57
-
-                          So apparently, for these keyboard combinations, in VIO
-                          sessions, the KC_VIRTUALKEY flag is missing. Strange.
-
-                          */
-
-                        #ifdef _PMPRINTF_
-                                CHAR    szFlags[2000] = "";
-                                if (usFlags & KC_CHAR)                      // 0x0001
-                                    strcat(szFlags, "KC_CHAR ");
-                                if (usFlags & KC_VIRTUALKEY)                // 0x0002
-                                    strcat(szFlags, "KC_VIRTUALKEY ");
-                                if (usFlags & KC_SCANCODE)                  // 0x0004
-                                    strcat(szFlags, "KC_SCANCODE ");
-                                if (usFlags & KC_SHIFT)                     // 0x0008
-                                    strcat(szFlags, "KC_SHIFT ");
-                                if (usFlags & KC_CTRL)                      // 0x0010
-                                    strcat(szFlags, "KC_CTRL ");
-                                if (usFlags & KC_ALT)                       // 0x0020
-                                    strcat(szFlags, "KC_ALT ");
-                                if (usFlags & KC_KEYUP)                     // 0x0040
-                                    strcat(szFlags, "KC_KEYUP ");
-                                if (usFlags & KC_PREVDOWN)                  // 0x0080
-                                    strcat(szFlags, "KC_PREVDOWN ");
-                                if (usFlags & KC_LONEKEY)                   // 0x0100
-                                    strcat(szFlags, "KC_LONEKEY ");
-                                if (usFlags & KC_DEADKEY)                   // 0x0200
-                                    strcat(szFlags, "KC_DEADKEY ");
-                                if (usFlags & KC_COMPOSITE)                 // 0x0400
-                                    strcat(szFlags, "KC_COMPOSITE ");
-                                if (usFlags & KC_INVALIDCOMP)               // 0x0800
-                                    strcat(szFlags, "KC_INVALIDCOMP ");
-                                if (usFlags & KC_TOGGLE)                    // 0x1000
-                                    strcat(szFlags, "KC_TOGGLE ");
-                                if (usFlags & KC_INVALIDCHAR)               // 0x2000
-                                    strcat(szFlags, "KC_INVALIDCHAR ");
-                                if (usFlags & KC_DBCSRSRVD1)                // 0x4000
-                                    strcat(szFlags, "KC_DBCSRSRVD1 ");
-                                if (usFlags & KC_DBCSRSRVD2)                // 0x8000
-                                    strcat(szFlags, "KC_DBCSRSRVD2 ");
-
-                                _Pmpf(("  usFlags: 0x%lX -->", usFlags));
-                                _Pmpf(("    %s", szFlags));
-                                _Pmpf(("  usvk: 0x%lX", usvk));
-                                _Pmpf(("  usch: 0x%lX", usch));
-                                _Pmpf(("  ucScanCode: 0x%lX", ucScanCode));
-                        #endif
-
-    /* #ifdef __DEBUG__
-                        // debug code:
-                        // enable Ctrl+Alt+Delete emergency exit
-                        if (    (   (usFlags & (KC_CTRL | KC_ALT | KC_KEYUP))
-                                     == (KC_CTRL | KC_ALT)
-                                )
-                              && (ucScanCode == 0x0e)    // delete
-                           )
-                        {
-                            ULONG ul;
-                            for (ul = 5000;
-                                 ul > 100;
-                                 ul -= 200)
-                                DosBeep(ul, 20);
-
-                            WinPostMsg(G_HookData.hwndDaemonObject,
-                                       WM_QUIT,
-                                       0, 0);
-                            brc = TRUE;     // swallow
-                        }
-                        else
-    #endif */
-
-                        if (WMChar_Hotkeys(usFlags, ucScanCode))
-                            // returns TRUE (== swallow) if hotkey was found
-                            brc = TRUE;
-                    }
-                }
+                brc = WMChar_CheckHotkeys(pqmsg, FALSE);
 
                 DosReleaseMutexSem(G_hmtxGlobalHotkeys);
 
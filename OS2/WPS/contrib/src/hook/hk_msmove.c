@@ -46,6 +46,8 @@
 #define DONT_REPLACE_MALLOC         // in case mem debug is enabled
 #include "setup.h"
 
+#include "helpers\sem.h"               // lockExchange
+
 #include "hook\xwphook.h"
 #include "hook\hook_private.h"          // private hook and daemon definitions
 
@@ -211,218 +213,6 @@ VOID SelectMenuItem(HWND hwndMenu,
     }
 }
 
-#ifndef __NOSLIDINGFOCUS__
-
-/*
- *@@ WMMouseMove_SlidingFocus:
- *      this gets called when hookInputHook intercepts
- *      WM_MOUSEMOVE to do the "sliding focus" processing.
- *
- *      This function evaluates hwnd to find out whether
- *      the mouse has moved over a new frame window.
- *      If so, XDM_SLIDINGFOCUS is posted to the daemon's
- *      object window, which will then do the actual focus
- *      and active window processing (starting a timer, if
- *      delayed focus is active).
- *
- *      Processing is fairly complicated because special
- *      case checks are needed for certain window classes
- *      (combo boxes, Win-OS/2 windows). Basically, this
- *      function finds the frame window to which hwnd
- *      (the window under the mouse, from the hook) belongs
- *      and passes that frame to the daemon. If another
- *      frame is found between the main frame and hwnd,
- *      that frame is passed to the daemon also.
- *
- *      Frame activation is then not done from the hook, but
- *      from the daemon instead.
- *
- *      Inspired by code from ProgramCommander (W) Roman Stangl.
- *      Fixed a few problems with MDI frames.
- *
- *@@changed V0.9.3 (2000-05-22) [umoeller]: fixed combobox problems
- *@@changed V0.9.3 (2000-05-22) [umoeller]: fixed MDI frames problems
- *@@changed V0.9.4 (2000-06-12) [umoeller]: fixed Win-OS/2 menu problems
- *@@changed V0.9.9 (2001-03-14) [lafaix]: disabling sliding when processing mouse switch
- *@@changed V0.9.19 (2002-06-02) [umoeller]: fixed idiocy with Mozilla menus
- */
-
-VOID WMMouseMove_SlidingFocus(HWND hwnd,        // in: wnd under mouse, from hookInputHook
-                              BOOL fMouseMoved, // in: TRUE if mouse has been moved since previous WM_MOUSEMOVE
-                                                // (determined by hookInputHook)
-                              PSZ pszClassUnderMouse) // in: window class of hwnd (determined
-                                                      // by hookInputHook)
-{
-    BOOL    fStopTimers = FALSE;    // setting this to TRUE will stop timers
-
-#ifndef __NOPAGER__
-    if (G_HookData.fProcessingWraparound)
-        return;
-#endif
-
-    do      // just a do for breaking, no loop
-    {
-        // get currently active window; this can only
-        // be a frame window (WC_FRAME)
-        HWND    hwndActiveNow;
-
-        // check 1: check if the active window is still the
-        //          the one which was activated by ourselves
-        //          previously (either by the hook during WM_BUTTON1DOWN
-        //          or by the daemon in sliding focus processing):
-        if (hwndActiveNow = WinQueryActiveWindow(HWND_DESKTOP))
-        {
-            if (hwndActiveNow != G_HookData.hwndActivatedByUs)
-            {
-                // active window is not the one we set active:
-                // this probably means that some new
-                // window popped up which we haven't noticed
-                // and was explicitly made active either by the
-                // shell or by an application, so we use this
-                // for the below checks. Otherwise, sliding focus
-                // would be disabled after a new window has popped
-                // up until the mouse was moved over a new frame window.
-                G_hwndLastFrameUnderMouse = hwndActiveNow;
-                G_hwndLastSubframeUnderMouse = NULLHANDLE;
-                G_HookData.hwndActivatedByUs = hwndActiveNow;
-
-                fStopTimers = TRUE;
-                        // this will be overridden if we start a new
-                        // timer below; but just in case an old timer
-                        // might still be running V0.9.4 (2000-08-03) [umoeller]
-            }
-        }
-
-        if (fMouseMoved)            // has mouse really moved?
-        {
-            // OK:
-            HWND    hwndDesktopChild = hwnd,
-                    hwndTempParent = NULLHANDLE,
-                    hwndFrameInBetween = NULLHANDLE;
-            HWND    hwndFocusNow = WinQueryFocus(HWND_DESKTOP);
-            CHAR    szClassName[30],
-                    szWindowText[30];
-
-            // check 2: make sure mouse is not captured
-            if (WinQueryCapture(HWND_DESKTOP) != NULLHANDLE)
-            {
-                // stop timers and quit
-                fStopTimers = TRUE;
-                break;
-            }
-
-            // check 3: quit if menu has the focus
-            if (hwndFocusNow)
-            {
-                CHAR    szFocusClass[MAXNAMEL+4] = "";
-                WinQueryClassName(hwndFocusNow,
-                                  sizeof(szFocusClass),
-                                  szFocusClass);
-
-                if (!strcmp(szFocusClass, "#4"))
-                {
-                    // menu:
-                    // stop timers and quit
-                    fStopTimers = TRUE;
-                    break;
-                }
-            }
-
-            // now climb up the parent window hierarchy of the
-            // window under the mouse (first: hwndDesktopChild)
-            // until we reach the Desktop; the last window we
-            // had is then in hwndDesktopChild
-            hwndTempParent = WinQueryWindow(hwndDesktopChild, QW_PARENT);
-            while (     (hwndTempParent != G_HookData.hwndPMDesktop)
-                     && (hwndTempParent != NULLHANDLE)
-                  )
-            {
-                WinQueryClassName(hwndDesktopChild,
-                                  sizeof(szClassName), szClassName);
-                if (!strcmp(szClassName, "#1"))
-                    // it's a frame:
-                    hwndFrameInBetween = hwndDesktopChild;
-                hwndDesktopChild = hwndTempParent;
-                hwndTempParent = WinQueryWindow(hwndDesktopChild, QW_PARENT);
-            }
-
-            if (hwndFrameInBetween == hwndDesktopChild)
-                hwndFrameInBetween = NULLHANDLE;
-
-            // hwndDesktopChild now has the window which we need to activate
-            // (the topmost parent under the desktop of the window under the mouse)
-
-            WinQueryClassName(hwndDesktopChild,
-                              sizeof(szClassName), szClassName);
-
-            // check 4: skip certain window classes
-
-            if (    (!strcmp(szClassName, "#4"))
-                            // menu
-                 || (!strcmp(szClassName, "#7"))
-                         // listbox: as a desktop child, this must be a
-                         // a drop-down box which is currently open
-                 || (!strcmp(szClassName, "MozillaWindowClass"))
-                         // this fixes mozilla popup menus; those
-                         // are a MozillaWindowClass as child of
-                         // HWND_DESKTOP (this does not break the
-                         // main Mozilla windows because those have
-                         // a WC_FRAME)
-                         // V0.9.19 (2002-06-02) [umoeller]
-               )
-            {
-                // stop timers and quit
-                fStopTimers = TRUE;
-                break;
-            }
-
-            WinQueryWindowText(hwndDesktopChild, sizeof(szWindowText), szWindowText);
-            if (strstr(szWindowText, "Seamless"))
-                // ignore seamless Win-OS/2 menus; these are separate windows!
-            {
-                // stop timers and quit
-                fStopTimers = TRUE;
-                break;
-            }
-
-            // OK, enough checks.
-            // Now let's do the sliding focus if
-            // 1) the desktop window (hwndDesktopChild, highest parent) changed or
-            // 2) if hwndDesktopChild has several subframes and the subframe changed:
-
-            if (hwndDesktopChild)
-                if (    (hwndDesktopChild != G_hwndLastFrameUnderMouse)
-                     || (   (hwndFrameInBetween != NULLHANDLE)
-                         && (hwndFrameInBetween != G_hwndLastSubframeUnderMouse)
-                        )
-                   )
-                {
-                    // OK, mouse moved to a new desktop window:
-                    // store that for next time
-                    G_hwndLastFrameUnderMouse = hwndDesktopChild;
-                    G_hwndLastSubframeUnderMouse = hwndFrameInBetween;
-
-                    // notify daemon of the change;
-                    // it is the daemon which does the rest
-                    // (timer handling, window activation etc.)
-                    WinPostMsg(G_HookData.hwndDaemonObject,
-                               XDM_SLIDINGFOCUS,
-                               (MPARAM)hwndFrameInBetween,  // can be NULLHANDLE
-                               (MPARAM)hwndDesktopChild);
-                    fStopTimers = FALSE;
-                }
-        }
-    } while (FALSE); // end do
-
-    if (fStopTimers)
-        WinPostMsg(G_HookData.hwndDaemonObject,
-                   XDM_SLIDINGFOCUS,
-                   (MPARAM)NULLHANDLE,
-                   (MPARAM)NULLHANDLE);     // stop timers
-}
-
-#endif
-
 /*
  *@@ WMMouseMove_SlidingMenus:
  *      this gets called when hookInputHook intercepts
@@ -768,10 +558,9 @@ BOOL WMMouseMove_SlidingMenus(HWND hwndCurrentMenu,  // in: menu wnd under mouse
                     // f) notify daemon of the change, which
                     // will start the timer and post WM_MOUSEMOVE
                     // back to us
-                    WinPostMsg(G_HookData.hwndDaemonObject,
-                               XDM_SLIDINGMENU,
-                               mp1,
-                               0);
+                    hookPostDaemon(XDM_SLIDINGMENU,
+                                   mp1,
+                                   0);
 
                     // 3)  When the timer elapses, the daemon posts a special
                     //     WM_MOUSEMOVE to the same menu control for which
@@ -959,9 +748,17 @@ BOOL WMMouseMove(PQMSG pqmsg,
                 {
                     // sliding focus enabled?
                     // V0.9.5 (2000-08-22) [umoeller]
-                    WMMouseMove_SlidingFocus(pqmsg->hwnd,
-                                             fGlobalMouseMoved,
-                                             szClassUnderMouse);
+                    // The frame lookup (ProcessSlidingFocusCheck) runs
+                    // in the daemon; we only leave the latest window
+                    // in the mailbox and queue one check until the
+                    // daemon has picked it up.
+                    G_HookData.hwndSlidingUnderMouse = pqmsg->hwnd;
+                    if (fGlobalMouseMoved)
+                        G_HookData.fSlidingMouseMoved = TRUE;
+                    if (!lockExchange((PLONG)&G_HookData.fSlidingCheckQueued, TRUE))
+                        hookPostDaemon(XDM_SLIDINGFOCUSCHECK,
+                                       0,
+                                       0);
                 }
 #endif
 
@@ -1029,10 +826,9 @@ BOOL WMMouseMove(PQMSG pqmsg,
                             // notify thread-1 object window, which
                             // will start the user-configured action
                             // (if any)
-                            WinPostMsg(G_HookData.hwndDaemonObject,
-                                       XDM_HOTCORNER,
-                                       (MPARAM)bHotCorner,
-                                       (MPARAM)NULL);
+                            hookPostDaemon(XDM_HOTCORNER,
+                                           (MPARAM)bHotCorner,
+                                           (MPARAM)NULL);
 
                     } // end if (!G_HookData.hwndLockupFrame)    // system not locked up V0.9.14
 
@@ -75,6 +75,20 @@
  *          hotkeys are changed, the daemon changes the structure by
  *          calling hookSetGlobalHotkeys.
  *
+ *          hookSetGlobalHotkeys also keeps a hashed copy of both key
+ *          lists in HOOKDATA (HOTKEYTABLE), so that the pre-accel hook
+ *          normally needs neither the mutex nor the shared memory for
+ *          a keystroke.
+ *
+ *      --  Whatever the hook has to tell the daemon goes through
+ *          hookPostDaemon, which queues the XDM_* message in the
+ *          HOOKQUEUE ring in HOOKDATA instead of posting it. The daemon
+ *          gets a single XDM_HOOKEVENTS per burst and drains the ring
+ *          on its own thread. Work that needs no answer from the
+ *          hook, such as the sliding focus window classification and
+ *          the window list class checks, is done by the daemon after
+ *          it has taken an event off the ring.
+ *
  *      --  The exported hook* functions may only be used by one
  *          single process. It is not possible for one process to
  *          call hookInit and for another to call another hook*
@@ -148,6 +162,8 @@
 #define DONT_REPLACE_MALLOC         // in case mem debug is enabled
 #include "setup.h"
 
+#include "helpers\sem.h"               // lockCompareExchange, lockExchange
+
 #include "hook\xwphook.h"
 #include "hook\hook_private.h"          // private hook and daemon definitions
 
@@ -195,8 +211,6 @@ HMTX            G_hmtxGlobalHotkeys = NULLHANDLE;
  ******************************************************************/
 
 HWND    G_hwndUnderMouse = NULLHANDLE;
-HWND    G_hwndLastFrameUnderMouse = NULLHANDLE;
-HWND    G_hwndLastSubframeUnderMouse = NULLHANDLE;
 POINTS  G_ptsMousePosWin = {0};
 POINTL  G_ptlMousePosDesktop = {0};
 HWND    G_hwndRootMenu = NULLHANDLE; // V0.9.14 (2001-08-01) [lafaix]
@@ -297,6 +311,157 @@ VOID hookLog(PCSZ pcszSourceFile, // in: source file name
     }
 }
 
+/*
+ *@@ hookPostDaemon:
+ *      queues msg for the daemon object window in the
+ *      HOOKQUEUE ring. Use this instead of WinPostMsg
+ *      for every notification from the hook to the daemon
+ *      which does not need to be sent.
+ *
+ *      This can run on any PM thread on the system, so it
+ *      never blocks: a slot is claimed with a compare-exchange
+ *      on the ring tail, and if the ring is full, msg is
+ *      posted directly as before.
+ *
+ *      Only the first event after the daemon has drained the
+ *      ring posts XDM_HOOKEVENTS, so a burst of mouse or
+ *      window events costs a single cross-process post.
+ *
+ *      Returns what WinPostMsg would have returned.
+ */
+
+BOOL hookPostDaemon(ULONG msg,
+                    MPARAM mp1,
+                    MPARAM mp2)
+{
+    PHOOKQUEUE  pQueue = &G_HookData.Queue;
+    PHOOKEVENT  pEvent;
+    LONG        lPos,
+                lDiff;
+
+    for (;;)
+    {
+        lPos = pQueue->lTail;
+        pEvent = &pQueue->aEvents[lPos & HOOKQUEUE_MASK];
+        lDiff = (LONG)pEvent->ulSeq - lPos;
+
+        if (lDiff == 0)
+        {
+            // slot is free for this position: try to claim it
+            if (lockCompareExchange((PLONG)&pQueue->lTail,
+                                    lPos + 1,
+                                    lPos)
+                        == lPos)
+                break;
+        }
+        else if (lDiff < 0)
+        {
+            // ring is full: don't wait in somebody else's thread
+            ++pQueue->cOverflows;
+            return WinPostMsg(G_HookData.hwndDaemonObject,
+                              msg,
+                              mp1,
+                              mp2);
+        }
+        // else another thread claimed lPos meanwhile: reload
+    }
+
+    pEvent->msg = msg;
+    pEvent->mp1 = mp1;
+    pEvent->mp2 = mp2;
+    // publish
+    pEvent->ulSeq = lPos + 1;
+
+    if (!lockExchange((PLONG)&pQueue->fDoorbell, TRUE))
+        if (!WinPostMsg(G_HookData.hwndDaemonObject,
+                        XDM_HOOKEVENTS,
+                        0,
+                        0))
+        {
+            // daemon queue is full; let the next event try again
+            pQueue->fDoorbell = FALSE;
+            return FALSE;
+        }
+
+    return TRUE;
+}
+
+/*
+ *@@ InitHookQueue:
+ *      resets the HOOKQUEUE ring. Called from hookInit
+ *      before the hooks are installed.
+ */
+
+VOID InitHookQueue(VOID)
+{
+    ULONG ul;
+
+    G_HookData.Queue.lTail = 0;
+    G_HookData.Queue.lHead = 0;
+    G_HookData.Queue.fDoorbell = FALSE;
+    for (ul = 0;
+         ul < HOOKQUEUE_SIZE;
+         ul++)
+        G_HookData.Queue.aEvents[ul].ulSeq = ul;
+}
+
+/*
+ *@@ BuildHotkeyTable:
+ *      rebuilds the HOTKEYTABLE in HOOKDATA from the
+ *      given lists. Called from hookSetGlobalHotkeys
+ *      with the hotkeys mutex held, so there is only
+ *      ever one writer; readers in the pre-accel hook
+ *      retry while ulGeneration is odd.
+ */
+
+VOID BuildHotkeyTable(PGLOBALHOTKEY paHotkeys,
+                      ULONG cHotkeys,
+                      PFUNCTIONKEY paFunctionKeys,
+                      ULONG cFunctionKeys)
+{
+    PHOTKEYTABLE pTable = &G_HookData.Hotkeys;
+    ULONG       ul;
+
+    // odd: table is being changed
+    ++pTable->ulGeneration;
+
+    memset(pTable->abFunctionKeys, 0, sizeof(pTable->abFunctionKeys));
+    memset(pTable->aSlots, 0, sizeof(pTable->aSlots));
+
+    for (ul = 0;
+         ul < cFunctionKeys;
+         ul++)
+    {
+        UCHAR uc = paFunctionKeys[ul].ucScanCode;
+        pTable->abFunctionKeys[uc >> 3] |= (BYTE)(1 << (uc & 7));
+    }
+
+    if (pTable->fHashed = (cHotkeys <= HOTKEYHASH_MAX))
+    {
+        for (ul = 0;
+             ul < cHotkeys;
+             ul++)
+        {
+            USHORT  usFlags = paHotkeys[ul].usFlags & (KC_CTRL | KC_ALT | KC_SHIFT);
+            UCHAR   ucScanCode = paHotkeys[ul].ucScanCode;
+            ULONG   ulSlot = HOTKEYHASH(ucScanCode, usFlags);
+
+            // linear probing; duplicates get a slot each since
+            // several objects can share one hotkey
+            while (pTable->aSlots[ulSlot].fUsed)
+                ulSlot = (ulSlot + 1) & HOTKEYHASH_MASK;
+
+            pTable->aSlots[ulSlot].fUsed = TRUE;
+            pTable->aSlots[ulSlot].ucScanCode = ucScanCode;
+            pTable->aSlots[ulSlot].usFlags = usFlags;
+            pTable->aSlots[ulSlot].ulHandle = paHotkeys[ul].ulHandle;
+        }
+    }
+
+    // even again: table is consistent
+    ++pTable->ulGeneration;
+}
+
 /*
  *@@ InitializeGlobalsForHooks:
  *      this gets called from hookInit to initialize
@@ -473,6 +638,11 @@ PHOOKDATA EXPENTRY hookInit(HWND hwndDaemonObject)  // in: daemon object window
             // initialize globals needed by the hook
             InitializeGlobalsForHooks();
 
+            // no hook is installed yet, so nobody can be
+            // writing to the event ring
+            if (!G_HookData.fInputHooked)
+                InitHookQueue();
+
             // install hooks, but only once...
             if (!G_HookData.fSendMsgHooked)
                 G_HookData.fSendMsgHooked = WinSetHook(G_HookData.habDaemonObject,
@@ -648,6 +818,10 @@ BOOL EXPENTRY hookKill(void)
  *      daemon), because otherwise the shared memory cannot
  *      be properly freed.
  *
+ *      The hashed HOTKEYTABLE in HOOKDATA is rebuilt from
+ *      the new lists as well; that is what the hook normally
+ *      uses (see WMChar_Main).
+ *
  *      This returns the DOS error code of the various
  *      semaphore and shared mem API calls.
  *
@@ -719,6 +893,12 @@ APIRET EXPENTRY hookSetGlobalHotkeys(PGLOBALHOTKEY pNewHotkeys, // in: new hotke
             G_cFunctionKeys = cNewFunctionKeys;
             _Pmpf(("hookSetGlobalHotkeys: G_cFunctionKeys = %d", G_cFunctionKeys));
         }
+
+        // 3) hashed copy for the pre-accel hook
+        BuildHotkeyTable(pNewHotkeys,
+                         cNewHotkeys,
+                         pNewFunctionKeys,
+                         cNewFunctionKeys);
     }
 
     if (fLocked)
@@ -744,11 +924,13 @@ APIRET EXPENTRY hookSetGlobalHotkeys(PGLOBALHOTKEY pNewHotkeys, // in: new hotke
  *      and hookSendMsgHook.
  *
  *      This intercepts all messages that the window
- *      list needs to record changes. We then post
+ *      list needs to record changes. We then queue
  *      either XDM_WINDOWCHANGE or XDM_ICONCHANGE
- *      to the daemon, which will notify all its
+ *      for the daemon, which will notify all its
  *      clients -- most importantly the pager and
- *      the XCenter window list widget.
+ *      the XCenter window list widget. Except for
+ *      WM_DESTROY, the daemon does the window class
+ *      check (IS_WINLIST_CLASS).
  *
  *      See pg_winlist.c for details.
  *
@@ -788,28 +970,26 @@ VOID ProcessMsgsForWinlist(HWND hwnd,
         {
             CHAR    szClass[30];
 
-            if (WinQueryClassName(hwnd, sizeof(szClass), szClass))
-            {
-                if (    (!strcmp(szClass, "#1"))
-                     || (!strcmp(szClass, "wpFolder window"))
-                     || (!strcmp(szClass, "Win32FrameClass"))
-                                // that's for Odin V0.9.7 (2001-01-18) [umoeller]
-                     || (!strcmp(szClass, "EFrame"))
-                                // that's for EPM V0.9.7 (2001-01-19) [dk]
-                   )
-                {
-                    if (msg == WM_SETICON)
-                        WinPostMsg(G_HookData.hwndDaemonObject,
-                                   XDM_ICONCHANGE,
-                                   (MPARAM)hwnd,
-                                   (MPARAM)mp1);        // HPOINTER
-                    else
-                        WinPostMsg(G_HookData.hwndDaemonObject,
-                                   XDM_WINDOWCHANGE,
-                                   (MPARAM)hwnd,
-                                   (MPARAM)msg);
-                } // end if (    (strcmp(szClass, ...
-            } // end if (WinQueryClassName(hwnd, sizeof(szClass), szClass))
+            if (msg == WM_SETICON)
+                hookPostDaemon(XDM_ICONCHANGE,
+                               (MPARAM)hwnd,
+                               (MPARAM)mp1);        // HPOINTER
+            else if (msg != WM_DESTROY)
+                // the daemon checks the window class when it
+                // takes this off the ring (ProcessWindowChange),
+                // which keeps WinQueryClassName out of every
+                // WM_WINDOWPOSCHANGED on the system
+                hookPostDaemon(XDM_WINDOWCHANGE,
+                               (MPARAM)hwnd,
+                               (MPARAM)msg);
+            else if (    (WinQueryClassName(hwnd, sizeof(szClass), szClass))
+                      && (IS_WINLIST_CLASS(szClass))
+                    )
+                // the window is gone by the time the daemon
+                // gets to it, so check the class here
+                hookPostDaemon(XDM_WINDOWCHANGE,
+                               (MPARAM)hwnd,
+                               (MPARAM)msg);
         } // end if (WinQueryWindow(hwnd, QW_PARENT) == HookData.hwndPMDesktop)
     }
 }
@@ -924,10 +1104,9 @@ VOID EXPENTRY hookSendMsgHook(HAB hab,
        )
     {
         // yes: stop the delayed-select timer NOW
-        WinPostMsg(G_HookData.hwndDaemonObject,
-                   XDM_SLIDINGMENU,
-                   (MPARAM)-1,          // stop timer
-                   0);
+        hookPostDaemon(XDM_SLIDINGMENU,
+                       (MPARAM)-1,          // stop timer
+                       0);
     }
 #ifndef __NOMOVEMENT2FEATURES__
     else
@@ -1029,10 +1208,9 @@ VOID EXPENTRY hookSendMsgHook(HAB hab,
         if (hwndDefButton = (HWND)WinQueryWindowULong(psmh->hwnd,
                                                       QWL_DEFBUTTON))
         {
-            WinPostMsg(G_HookData.hwndDaemonObject,
-                       XDM_MOVEPTRTOBUTTON,
-                       (MPARAM)hwndDefButton,
-                       0);
+            hookPostDaemon(XDM_MOVEPTRTOBUTTON,
+                           (MPARAM)hwndDefButton,
+                           0);
         }
         // if the dialog contains no default button, center the
         // pointer over the window
@@ -1047,10 +1225,9 @@ VOID EXPENTRY hookSendMsgHook(HAB hab,
                   && (WinQueryWindow(psmh->hwnd, QW_PARENT) == G_HookData.hwndPMDesktop)
                 )
         {
-            WinPostMsg(G_HookData.hwndDaemonObject,
-                       XDM_MOVEPTRTOBUTTON,
-                       (MPARAM)psmh->hwnd,
-                       0);
+            hookPostDaemon(XDM_MOVEPTRTOBUTTON,
+                           (MPARAM)psmh->hwnd,
+                           0);
         }
     }
 #endif
@@ -1282,10 +1459,9 @@ BOOL EXPENTRY hookInputHook(HAB hab,        // in: anchor block of receiver wnd
          && (G_HookData.hwndPagerFrame)
        )
     {
-        WinPostMsg(G_HookData.hwndDaemonObject,
-                   XDM_TOGGLETRANSIENTSTICKY,
-                   MPFROMHWND(pqmsg->hwnd),
-                   0);
+        hookPostDaemon(XDM_TOGGLETRANSIENTSTICKY,
+                       MPFROMHWND(pqmsg->hwnd),
+                       0);
 
         // Netscape 4.61 enters in an endless loop if we swallow the
         // message.  V1.0.0 (2002-09-14) [lafaix]
@@ -1449,9 +1625,9 @@ BOOL EXPENTRY hookInputHook(HAB hab,        // in: anchor block of receiver wnd
                 // make sure that the mouse is not currently captured
                 if (WinQueryCapture(HWND_DESKTOP) == NULLHANDLE)
                 {
-                    WinPostMsg(G_HookData.hwndDaemonObject,
-                               XDM_WMCHORDWINLIST,
-                               0, 0);
+                    hookPostDaemon(XDM_WMCHORDWINLIST,
+                                   0,
+                                   0);
                     // WMChord_WinList();
                     // brc = TRUE;         // swallow message
                     // we must not swallow the message, or PMMail
@@ -1506,10 +1682,9 @@ BOOL EXPENTRY hookInputHook(HAB hab,        // in: anchor block of receiver wnd
             case WM_BUTTON3DOWN:
             case WM_BUTTON3UP:
             case WM_BUTTON3DBLCLK:
-                WinPostMsg(G_HookData.hwndDaemonObject,
-                           XDM_MOUSECLICKED,
-                           (MPARAM)pqmsg->msg,
-                           pqmsg->mp1);             // POINTS pointer pos
+                hookPostDaemon(XDM_MOUSECLICKED,
+                               (MPARAM)pqmsg->msg,
+                               pqmsg->mp1);             // POINTS pointer pos
         }
 
     #if 0
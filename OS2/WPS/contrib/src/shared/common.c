@@ -53,6 +53,7 @@
  */
 
 #define INCL_DOSMODULEMGR
+#define INCL_DOSMEMMGR
 #define INCL_DOSSEMAPHORES
 #define INCL_DOSEXCEPTIONS
 #define INCL_DOSPROCESS
@@ -178,8 +179,21 @@ static CHAR             G_szMessageFile[CCHMAXPATH] = "";
 // static GLOBALSETTINGS  G_GlobalSettings = {0};
             // removed V0.9.16 (2002-01-05) [umoeller]
 // array of ULONGs with values for cmnGetSetting; this
-// is filled on startup
-static ULONG            G_aulSettings[___LAST_SETTING];
+// is filled on startup. It is used until cmnLoadGlobalSettings
+// has moved the settings into shared memory, or if that fails
+static struct
+{
+    XWPSETTINGSSHARED   Hdr;
+    ULONG               aulMore[___LAST_SETTING - 1];
+                            // Hdr.aulSettings has the first one
+} G_SettingsPrivate;
+static PXWPSETTINGSSHARED G_pSettings = &G_SettingsPrivate.Hdr;
+            // settings snapshot cmnQuerySetting reads from; this
+            // points to the SHMEM_XWPSETTINGS block once that exists
+static HEV              G_hevSettingsChanged = NULLHANDLE;
+            // SEM_XWPSETTINGSCHANGED
+static HMTX             G_hmtxSettings = NULLHANDLE;
+            // serializes writers of the settings; readers never take it
 extern ULONG            *G_pulVarMenuOfs = NULL; // V1.0.0 (2002-08-28) [umoeller]
 
 #ifndef __NOTURBOFOLDERS__
@@ -971,6 +985,7 @@ HMODULE cmnQueryNLSModuleHandle(BOOL fEnforceReload)
                                G_hmodNLS,
                                G_aEntities,
                                ARRAYITEMCOUNT(G_aEntities));
+                nlsPreloadStrings();
 
                 // close TMF message file to force reload
                 // V0.9.19 (2002-04-02) [umoeller]
@@ -1183,6 +1198,10 @@ VOID cmnInitEntities(VOID)
                    cmnQueryNLSModuleHandle(FALSE),
                    G_aEntities,
                    ARRAYITEMCOUNT(G_aEntities));
+
+    // status bars, menus and the like ask for strings all
+    // the time, so load them all into one table right away
+    nlsPreloadStrings();
 }
 
 /*
@@ -1228,6 +1247,12 @@ VOID cmnInitEntities(VOID)
  *      this uses a binary tree (balanced according to string IDs)
  *      internally, so this is quite fast still.
  *
+ *      Since cmnInitEntities now has nlsPreloadStrings load
+ *      all strings of the NLS DLL into a single table, this
+ *      is in fact an array lookup again, without taking the
+ *      strings lock. The tree only serves strings
+ *      which are missing from the table.
+ *
  *      This never releases the strings again, unless the
  *      NLS DLL is reloaded (see cmnQueryNLSModuleHandle).
  *
@@ -3109,6 +3134,147 @@ STATIC VOID ConvertOldGlobalSettings(POLDGLOBALSETTINGS pOld)
     }
 }
 
+/*
+ *@@ LockSettings:
+ *      serializes writers of the settings snapshot.
+ *      Readers never take this.
+ */
+
+STATIC APIRET LockSettings(VOID)
+{
+    if (G_hmtxSettings)
+        return DosRequestMutexSem(G_hmtxSettings, SEM_INDEFINITE_WAIT);
+
+    // first call:
+    return DosCreateMutexSem(NULL,
+                             &G_hmtxSettings,
+                             0,
+                             TRUE);         // request
+}
+
+/*
+ *@@ UnlockSettings:
+ *
+ */
+
+STATIC VOID UnlockSettings(VOID)
+{
+    DosReleaseMutexSem(G_hmtxSettings);
+}
+
+/*
+ *@@ BeginSettingsUpdate:
+ *      locks the settings and makes the sequence count
+ *      odd, so that readers of several settings at once
+ *      (cmnSnapshotSettings) wait until EndSettingsUpdate.
+ *      Single settings can still be read at any time.
+ *
+ *      Returns FALSE if the lock could not be taken; the
+ *      caller must not call EndSettingsUpdate then.
+ */
+
+STATIC BOOL BeginSettingsUpdate(VOID)
+{
+    if (LockSettings())
+        return FALSE;
+
+    G_pSettings->ulSeq++;
+    return TRUE;
+}
+
+/*
+ *@@ EndSettingsUpdate:
+ *      reverse to BeginSettingsUpdate. This publishes
+ *      a new settings generation and posts
+ *      SEM_XWPSETTINGSCHANGED for waiters in any process.
+ */
+
+STATIC VOID EndSettingsUpdate(VOID)
+{
+    G_pSettings->ulSeq++;
+    UnlockSettings();
+
+    if (G_hevSettingsChanged)
+        DosPostEventSem(G_hevSettingsChanged);
+}
+
+/*
+ *@@ AttachSharedSettings:
+ *      moves the settings from our private array into
+ *      the SHMEM_XWPSETTINGS shared memory block (see
+ *      XWPSETTINGSSHARED in xwpapi.h), so that other
+ *      processes can read them too.
+ *
+ *      The block is allocated on the first Desktop
+ *      startup. If another process still has it
+ *      requested on a Desktop restart, we reuse it,
+ *      provided it was made by an XFLDR.DLL with the
+ *      same settings layout. If anything fails, we
+ *      simply stay with the private array.
+ *
+ *      Gets called on thread 1 from cmnLoadGlobalSettings.
+ */
+
+STATIC VOID AttachSharedSettings(VOID)
+{
+    PXWPSETTINGSSHARED  p = NULL;
+    ULONG               cb = sizeof(G_SettingsPrivate);
+    APIRET              arc;
+
+    if (G_pSettings != &G_SettingsPrivate.Hdr)
+        // not first call:
+        return;
+
+    if (!(arc = DosAllocSharedMem((PVOID*)&p,
+                                  SHMEM_XWPSETTINGS,
+                                  cb,
+                                  PAG_COMMIT | PAG_READ | PAG_WRITE)))
+    {
+        memset(p, 0, cb);
+        p->ulMagic = XWPSETTINGS_MAGIC;
+        p->cbStruct = cb;
+        p->cSettings = ___LAST_SETTING;
+    }
+    else if (    (arc != ERROR_ALREADY_EXISTS)
+              || (DosGetNamedSharedMem((PVOID*)&p,
+                                       SHMEM_XWPSETTINGS,
+                                       PAG_READ | PAG_WRITE))
+            )
+        p = NULL;
+    else if (    (p->ulMagic != XWPSETTINGS_MAGIC)
+              || (p->cSettings != ___LAST_SETTING)
+            )
+    {
+        // left over from a different XWorkplace build
+        DosFreeMem(p);
+        p = NULL;
+    }
+
+    if (!p)
+        return;
+
+    if (arc = DosCreateEventSem(SEM_XWPSETTINGSCHANGED,
+                                &G_hevSettingsChanged,
+                                0,
+                                FALSE))
+    {
+        G_hevSettingsChanged = NULLHANDLE;
+        if (arc == ERROR_DUPLICATE_NAME)
+            DosOpenEventSem(SEM_XWPSETTINGSCHANGED,
+                            &G_hevSettingsChanged);
+    }
+
+    // take over what we have loaded so far, then switch
+    // all readers over to the shared copy
+    p->ulSeq |= 1;
+    memcpy(p->aulSettings,
+           G_SettingsPrivate.Hdr.aulSettings,
+           ___LAST_SETTING * sizeof(ULONG));
+    p->ulSeq++;
+
+    G_pSettings = p;
+}
+
 /*
  *@@ cmnLoadOneSetting:
  *      loads the data for the given SETTINGINFO from OS2.INI
@@ -3120,7 +3286,7 @@ STATIC VOID ConvertOldGlobalSettings(POLDGLOBALSETTINGS pOld)
 
 ULONG cmnLoadOneSetting(PCSETTINGINFO pThis)
 {
-    PULONG  pulThis = &G_aulSettings[pThis->s];
+    ULONG ulThis;
     ULONG cb = sizeof(ULONG);
     ULONG ulDefaultValue = pThis->ulDefaultValue;
 
@@ -3150,20 +3316,24 @@ ULONG cmnLoadOneSetting(PCSETTINGINFO pThis)
     if (!PrfQueryProfileData(HINI_USER,
                              (PSZ)INIAPP_XWORKPLACE,
                              (PSZ)pThis->pcszIniKey,
-                             pulThis,
+                             &ulThis,
                              &cb))
     {
         // data not found: use default then
         // _Pmpf(("            PrfQueryProfileData failed"));
-        *pulThis = ulDefaultValue;
+        ulThis = ulDefaultValue;
     }
     else if (cb != sizeof(ULONG))
     {
         // _Pmpf(("            cb is %d", cb));
-        *pulThis = ulDefaultValue;
+        ulThis = ulDefaultValue;
     }
 
-    return *pulThis;
+    // store only the final value, other processes may be
+    // reading the snapshot
+    G_pSettings->aulSettings[pThis->s] = ulThis;
+
+    return ulThis;
 }
 
 /*
@@ -3185,6 +3355,7 @@ VOID cmnLoadGlobalSettings(VOID)
     ULONG       cb,
                 ul2;
     POLDGLOBALSETTINGS pSettings;
+    BOOL        fUpdating;
 
     #ifdef __DEBUG__
         // in debug mode, load debug flags, if we have any
@@ -3198,6 +3369,8 @@ VOID cmnLoadGlobalSettings(VOID)
                             &cb);
     #endif
 
+    AttachSharedSettings();
+
     if (    (PrfQueryProfileSize(HINI_USER,
                                  (PSZ)INIAPP_XWORKPLACE,
                                  (PSZ)INIKEY_GLOBALSETTINGS,
@@ -3214,6 +3387,7 @@ VOID cmnLoadGlobalSettings(VOID)
 
         // we can't use cmnSetDefaultSettings here
         // because that would modify the INI entries
+        fUpdating = BeginSettingsUpdate();
         for (ul2 = 0;
              ul2 < ARRAYITEMCOUNT(G_aSettingInfos);
              ul2++)
@@ -3243,8 +3417,10 @@ VOID cmnLoadGlobalSettings(VOID)
 #endif
             }
 
-            G_aulSettings[pThis->s] = ulDefaultValue;
+            G_pSettings->aulSettings[pThis->s] = ulDefaultValue;
         }
+        if (fUpdating)
+            EndSettingsUpdate();
 
         ZERO(pSettings);
         cb = sizeof(OLDGLOBALSETTINGS);
@@ -3269,17 +3445,104 @@ VOID cmnLoadGlobalSettings(VOID)
         // no GLOBALSETTINGS structure any more:
         // load settings explicitly
         // _PmpfF(("no old settings, loading new"));
+        fUpdating = BeginSettingsUpdate();
         for (ul2 = 0;
              ul2 < ARRAYITEMCOUNT(G_aSettingInfos);
              ul2++)
         {
             cmnLoadOneSetting(&G_aSettingInfos[ul2]);
         }
+        if (fUpdating)
+            EndSettingsUpdate();
     }
 
     // set global variable to var menu offset
     // V1.0.0 (2002-08-28) [umoeller]
-    G_pulVarMenuOfs = &G_aulSettings[sulVarMenuOfs];
+    G_pulVarMenuOfs = &G_pSettings->aulSettings[sulVarMenuOfs];
+}
+
+/*
+ *@@ StoreSettings:
+ *      implementation for cmnSetSetting, cmnSetDefaultSettings
+ *      and cmnRestoreSettings.
+ *
+ *      This is copy-on-write in that the callers prepare
+ *      all new values in a private array first, and they
+ *      are then published in the settings snapshot within
+ *      a single update. So even a reader in another process
+ *      never sees half of a settings page reset. Waiters
+ *      in cmnWaitSettingsChange get woken up once.
+ *
+ *      The values are then written to OS2.INI, still
+ *      under the lock so that the INI always ends up
+ *      with the values from the snapshot. If a value
+ *      is the default value, we delete the key instead;
+ *      the default value will then be used by
+ *      cmnLoadGlobalSettings, and this allows us to
+ *      change defaults between releases.
+ *
+ *      Returns FALSE if any of the "s" values was invalid
+ *      or an INI write failed.
+ */
+
+STATIC BOOL StoreSettings(const SETTINGSBACKUP *paNew,
+                          ULONG cItems)         // in: array item count (NOT array size)
+{
+    BOOL    brc = TRUE;
+    ULONG   ul;
+
+    if (!BeginSettingsUpdate())
+        return FALSE;
+
+    for (ul = 0;
+         ul < cItems;
+         ul++)
+    {
+        XWPSETTING s = paNew[ul].s;
+        if (    (s < ___LAST_SETTING)
+             && (cmnFindSettingInfo(s))
+           )
+            G_pSettings->aulSettings[s] = paNew[ul].ul;
+    }
+
+    G_pSettings->ulSeq++;
+
+    for (ul = 0;
+         ul < cItems;
+         ul++)
+    {
+        XWPSETTING      s = paNew[ul].s;
+        ULONG           ulValue = paNew[ul].ul;
+        PCSETTINGINFO   pStore;
+
+        if (    (s < ___LAST_SETTING)
+             && (pStore = cmnFindSettingInfo(s))
+           )
+        {
+            if (!PrfWriteProfileData(HINI_USER,
+                                     (PSZ)INIAPP_XWORKPLACE,
+                                     (PSZ)pStore->pcszIniKey,
+                                     (ulValue != pStore->ulDefaultValue)
+                                        ? &ulValue
+                                        : NULL,
+                                     sizeof(ULONG)))
+                brc = FALSE;
+        }
+        else
+        {
+            cmnLog(__FILE__, __LINE__, __FUNCTION__,
+                   "Warning: Invalid setting %d set.", s);
+            brc = FALSE;
+        }
+    }
+
+    // the sequence count is even already
+    UnlockSettings();
+
+    if (G_hevSettingsChanged)
+        DosPostEventSem(G_hevSettingsChanged);
+
+    return brc;
 }
 
 /*
@@ -3303,8 +3566,13 @@ VOID cmnLoadGlobalSettings(VOID)
 
 BOOL cmnSetDefaultSettings(USHORT usSettingsPage)
 {
+    // collect the defaults for the page first, so that
+    // they get published as one update
+    SETTINGSBACKUP  aNew[ARRAYITEMCOUNT(G_aSettingInfos)];
+    ULONG           ul2,
+                    cNew = 0;
+
     // run through all setting infos
-    ULONG ul2;
     for (ul2 = 0;
          ul2 < ARRAYITEMCOUNT(G_aSettingInfos);
          ul2++)
@@ -3315,11 +3583,14 @@ BOOL cmnSetDefaultSettings(USHORT usSettingsPage)
            )
         {
             // data must be reset:
-            cmnSetSetting(pThis->s,
-                          pThis->ulDefaultValue);
+            aNew[cNew].s = pThis->s;
+            aNew[cNew].ul = pThis->ulDefaultValue;
+            ++cNew;
         }
     }
 
+    StoreSettings(aNew, cNew);
+
     return TRUE;
 }
 
@@ -3336,7 +3607,7 @@ ULONG cmnQuerySettingDebug(XWPSETTING s,
 #endif
 
     if (s < ___LAST_SETTING)
-        return G_aulSettings[s];
+        return G_pSettings->aulSettings[s];
 
 #ifdef __DEBUG__
     cmnLog(pcszSourceFile, ulLine, pcszFunction,
@@ -3374,6 +3645,11 @@ ULONG cmnQuerySettingDebug(XWPSETTING s,
  *      can do an array lookup. By contrast, cmnSetSetting
  *      might take a while.
  *
+ *      The array is the XWPSETTINGSSHARED snapshot in
+ *      shared memory, which is never locked for reading.
+ *      To read several settings which must match each
+ *      other, use cmnSnapshotSettings instead.
+ *
  *@@added V0.9.16 (2001-10-11) [umoeller]
  */
 
@@ -3385,7 +3661,7 @@ ULONG cmnQuerySetting(XWPSETTING s)
 #endif
 
     if (s < ___LAST_SETTING)
-        return G_aulSettings[s];
+        return G_pSettings->aulSettings[s];
 
 #ifdef __DEBUG__
     cmnLog(__FILE__, __LINE__, __FUNCTION__,
@@ -3413,38 +3689,12 @@ ULONG cmnQuerySetting(XWPSETTING s)
 BOOL cmnSetSetting(XWPSETTING s,
                    ULONG ulValue)
 {
-    if (s < ___LAST_SETTING)
-    {
-        PCSETTINGINFO pStore;
-        if (pStore = cmnFindSettingInfo(s))
-        {
-            PULONG pulWrite;
-
-            // store value
-            G_aulSettings[s] = ulValue;
-
-            // if this is a non-default value, write to OS2.INI;
-            // otherwise delete the key... the default value
-            // will then be used by cmnLoadGlobalSettings, and
-            // this allows us to change defaults between releases
-            if (ulValue != pStore->ulDefaultValue)
-                pulWrite = &ulValue;
-            else
-                pulWrite = NULL;
-
-            return PrfWriteProfileData(HINI_USER,
-                                       (PSZ)INIAPP_XWORKPLACE,
-                                       (PSZ)pStore->pcszIniKey,
-                                       pulWrite,
-                                       sizeof(ULONG));
-                // return was missing V0.9.19 (2002-06-02) [umoeller]
-        }
-    }
+    SETTINGSBACKUP  New;
 
-    cmnLog(__FILE__, __LINE__, __FUNCTION__,
-           "Warning: Invalid setting %d set.", s);
+    New.s = s;
+    New.ul = ulValue;
 
-    return FALSE;
+    return StoreSettings(&New, 1);
 }
 
 /*
@@ -3467,6 +3717,9 @@ BOOL cmnSetSetting(XWPSETTING s,
  *      which is returned in the NOTEBOOKPAGE.pUser
  *      parameter to be cleaned up automatically.
  *
+ *      The values are taken with cmnSnapshotSettings,
+ *      so they all stem from the same settings generation.
+ *
  *@@added V0.9.16 (2002-01-05) [umoeller]
  */
 
@@ -3477,15 +3730,15 @@ PSETTINGSBACKUP cmnBackupSettings(const XWPSETTING *paSettings,
 
     if (p1 = (PSETTINGSBACKUP)malloc(sizeof(SETTINGSBACKUP) * cItems))
     {
-        PSETTINGSBACKUP p = p1;
         ULONG ul;
         for (ul = 0;
              ul < cItems;
-             ++ul, ++p)
+             ++ul)
         {
-            p->s = paSettings[ul];
-            p->ul = cmnQuerySetting(p->s);
+            p1[ul].s = paSettings[ul];
         }
+
+        cmnSnapshotSettings(p1, cItems);
     }
 
     return p1;
@@ -3507,17 +3760,107 @@ VOID cmnRestoreSettings(PSETTINGSBACKUP paSettingsBackup,
                         ULONG cItems)           // in: array item count (NOT array size)
 {
     if (paSettingsBackup)
+        StoreSettings(paSettingsBackup, cItems);
+}
+
+/*
+ *@@ cmnSnapshotSettings:
+ *      reads several settings at once. On input, set
+ *      the "s" member of each of the cItems SETTINGSBACKUP
+ *      structures; on output, each "ul" has the value,
+ *      like cmnQuerySetting would return it.
+ *
+ *      As opposed to calling cmnQuerySetting for each,
+ *      this guarantees that all values stem from the same
+ *      settings generation, even if another thread is
+ *      changing them concurrently. This never locks; if
+ *      an update is in progress, we retry.
+ *
+ *      Returns the settings generation the values are
+ *      from (see cmnQuerySettingsGeneration).
+ */
+
+ULONG cmnSnapshotSettings(PSETTINGSBACKUP paSettings,
+                          ULONG cItems)         // in: array item count (NOT array size)
+{
+    PXWPSETTINGSSHARED  p = G_pSettings;
+    volatile ULONG      *paul = p->aulSettings;
+    ULONG               ulSeq,
+                        ul;
+
+    do
     {
-        ULONG ul;
+        while ((ulSeq = p->ulSeq) & 1)
+            // writer is busy
+            DosSleep(0);
+
         for (ul = 0;
              ul < cItems;
              ul++)
         {
-            cmnSetSetting(paSettingsBackup->s,
-                          paSettingsBackup->ul);
-            paSettingsBackup++;
+            XWPSETTING s = paSettings[ul].s;
+#ifndef __NOTURBOFOLDERS__
+            if (s == sfTurboFolders)
+                paSettings[ul].ul = G_fTurboSettingsEnabled;
+            else
+#endif
+            if (s < ___LAST_SETTING)
+                paSettings[ul].ul = paul[s];
+            else
+                paSettings[ul].ul = 0;
         }
+    } while (ulSeq != p->ulSeq);
+
+    return ulSeq / 2;
+}
+
+/*
+ *@@ cmnQuerySettingsGeneration:
+ *      returns the current settings generation, which
+ *      increases with every change to the global settings.
+ *
+ *      Code that derives expensive data from settings
+ *      (e.g. menus or status bar layouts) can store the
+ *      generation with that data and compare it instead
+ *      of querying all settings again.
+ */
+
+ULONG cmnQuerySettingsGeneration(VOID)
+{
+    return G_pSettings->ulSeq / 2;
+}
+
+/*
+ *@@ cmnWaitSettingsChange:
+ *      blocks the calling thread until the settings
+ *      generation is different from ulGeneration,
+ *      or until ulTimeout milliseconds have elapsed.
+ *      Returns TRUE if the settings have changed.
+ *
+ *      Since all waiters share SEM_XWPSETTINGSCHANGED,
+ *      a wakeup can be lost if another waiter resets
+ *      the semaphore just before we wait. So do not
+ *      use SEM_INDEFINITE_WAIT but wait in a loop,
+ *      which will then pick up the change.
+ *
+ *      If the settings could not be put into shared
+ *      memory, there is no semaphore, and this returns
+ *      right away.
+ */
+
+BOOL cmnWaitSettingsChange(ULONG ulGeneration,
+                           ULONG ulTimeout)
+{
+    ULONG   ulPostCount;
+
+    if (G_hevSettingsChanged)
+    {
+        DosResetEventSem(G_hevSettingsChanged, &ulPostCount);
+        if (cmnQuerySettingsGeneration() == ulGeneration)
+            DosWaitEventSem(G_hevSettingsChanged, ulTimeout);
     }
+
+    return (cmnQuerySettingsGeneration() != ulGeneration);
 }
 
 #ifndef __NOTURBOFOLDERS__
@@ -3533,7 +3876,7 @@ VOID cmnRestoreSettings(PSETTINGSBACKUP paSettingsBackup,
 
 BOOL cmnTurboFoldersEnabled(VOID)
 {
-    return G_aulSettings[sfTurboFolders];
+    return G_pSettings->aulSettings[sfTurboFolders];
 }
 
 /*
@@ -3549,7 +3892,7 @@ BOOL cmnTurboFoldersEnabled(VOID)
 
 VOID cmnEnableTurboFolders(VOID)
 {
-    if (G_aulSettings[sfTurboFolders])
+    if (G_pSettings->aulSettings[sfTurboFolders])
         G_fTurboSettingsEnabled = TRUE;
 }
 
@@ -145,6 +145,7 @@
 #include "helpers\linklist.h"           // linked list helper routines
 #include "helpers\standards.h"          // some standard macros
 #include "helpers\stringh.h"            // string helper routines
+#include "helpers\vector.h"             // array helper routines
 #include "helpers\winh.h"               // PM helper routines
 
 // SOM headers which don't crash with prec. header files
@@ -183,10 +184,12 @@ extern SHORT            G_sNextMenuId = 0;      // next menu item ID to use
 // llContentMenuItems contains ONLY folder content menus
 static LINKLIST         G_llContentMenuItems; // changed V0.9.0
 
-// linked lists / counts for variable context menu items
-// llVarMenuItems contains ALL variable items ever inserted
-// (i.e. config folder items AND folder content items)
-static LINKLIST         G_llVarMenuItems;     // changed V0.9.0
+// array / counts for variable context menu items
+// vecVarMenuItems contains ALL variable items ever inserted
+// (i.e. config folder items AND folder content items);
+// this is looked up by index for every WM_MEASUREITEM and
+// WM_DRAWITEM, so it's an array, not a linked list
+static VECTOR           G_vecVarMenuItems;
 
 // icon for drawing the little triangle in
 // folder content menus (subfolders)
@@ -450,7 +453,7 @@ VOID cmnuInitItemCache(VOID)
     {
         // first call: initialize lists
         lstInit(&G_llContentMenuItems, TRUE);
-        lstInit(&G_llVarMenuItems, TRUE);
+        vecInit(&G_vecVarMenuItems, TRUE);
     }
     else
     {
@@ -458,7 +461,7 @@ VOID cmnuInitItemCache(VOID)
         // (this might take a while)
         HPOINTER    hptrOld = winhSetWaitPointer();
         lstClear(&G_llContentMenuItems);
-        lstClear(&G_llVarMenuItems);
+        vecClear(&G_vecVarMenuItems);
         WinSetPointer(HWND_DESKTOP, hptrOld);
     }
 }
@@ -466,7 +469,7 @@ VOID cmnuInitItemCache(VOID)
 /*
  *@@ cmnuAppendMi2List:
  *      this stores a variable XFolder menu item in the
- *      respective global linked list (llVarMenuItems)
+ *      respective global array (vecVarMenuItems)
  *      and increases sNextMenuId for the next item.
  *      Returns FALSE if too many items have already been
  *      used and menus should be closed.
@@ -524,7 +527,7 @@ BOOL cmnuAppendMi2List(WPObject *pObject,
 
         pNewItem->ulTitleLen = ulTitleLen;
 
-        lstAppendItem(&G_llVarMenuItems, pNewItem);
+        vecAppend(&G_vecVarMenuItems, pNewItem);
 
         if (G_sNextMenuId < 0x7800)       // lowered V0.9.0
         {
@@ -1133,7 +1136,7 @@ VOID cmnuFillContentSubmenu(SHORT sMenuId, // in: menu ID of selected folder con
 
 PVARMENULISTITEM cmnuGetVarItem(ULONG ulOfs)
 {
-    return (PVARMENULISTITEM)lstItemFromIndex(&G_llVarMenuItems,
+    return (PVARMENULISTITEM)vecItemFromIndex(&G_vecVarMenuItems,
                                               ulOfs);
 }
 
@@ -1263,9 +1266,9 @@ MRESULT cmnuMeasureItem(POWNERITEM poi)     // owner-draw info structure
         G_bInitNeeded = FALSE;
     }
 
-    // get the item from the linked list of variable menu items
+    // get the item from the array of variable menu items
     // which corresponds to the menu item whose size is being queried
-    if (pItem = (PVARMENULISTITEM)lstItemFromIndex(&G_llVarMenuItems,
+    if (pItem = (PVARMENULISTITEM)vecItemFromIndex(&G_vecVarMenuItems,
                                                    (   poi->idItem
                                                      - (  *G_pulVarMenuOfs
                                                         + ID_XFMI_OFS_VARIABLE))))
@@ -1366,12 +1369,12 @@ BOOL cmnuDrawItem(MPARAM mp1,     // from WM_DRAWITEM: USHORT menu item id
     POWNERITEM poi = (POWNERITEM)mp2;
     POINTL     ptl;
 
-    // get the item from the linked list of variable menu items
+    // get the item from the array of variable menu items
     // which corresponds to the menu item being drawn
     PVARMENULISTITEM pItem;
     HPOINTER hptrIcon;
 
-    if (pItem = (PVARMENULISTITEM)lstItemFromIndex(&G_llVarMenuItems,
+    if (pItem = (PVARMENULISTITEM)vecItemFromIndex(&G_vecVarMenuItems,
                                                    (poi->idItem
                                                       - (   *G_pulVarMenuOfs
                                                           + ID_XFMI_OFS_VARIABLE))))
@@ -103,6 +103,7 @@
 #include "helpers\linklist.h"           // linked list helper routines
 #include "helpers\prfh.h"               // INI file helper routines
 #include "helpers\procstat.h"           // DosQProcStat handling
+#include "helpers\sem.h"                // lockExchangeAdd for the save threads
 #include "helpers\standards.h"          // some standard macros
 #include "helpers\stringh.h"            // string helper routines
 #include "helpers\threads.h"            // thread helpers
@@ -149,6 +150,11 @@
 static THREADINFO       G_tiShutdownThread = {0},
                         G_tiUpdateThread = {0};
 
+#define XSD_SAVETHREADS         3
+                // no. of threads saving dirty objects while
+                // windows are being closed
+static THREADINFO       G_atiSaveThreads[XSD_SAVETHREADS] = {0};
+
 static ULONG            G_ulShutdownState = XSD_IDLE;
                 // V0.9.19 (2002-04-24) [umoeller]
                 // -- XSD_* flag signalling status
@@ -709,6 +715,35 @@ APIRET xsdFlushWPS2INI(VOID)
  *
  ********************************************************************/
 
+#define XSD_MAXCLOSING          8
+                // max. no. of items that are being closed
+                // at the same time
+#define XSD_MAXTRACKED          64
+                // size of SHUTDOWNDATA.aClosing, which also
+                // holds items that have timed out
+#define XSD_CLOSETIMEOUT        15000
+                // ms after which an item that hasn't closed
+                // yet no longer holds back the others
+#define TIMERID_CLOSETIMEOUT    1
+
+/*
+ *@@ CLOSINGITEM:
+ *      item in SHUTDOWNDATA.aClosing for an item on the
+ *      shutdown list for which closing has been initiated
+ *      (by CloseNextItems), but which is still on the
+ *      list. SHUTLISTITEMs get rebuilt with every list
+ *      update, so we remember the identity only.
+ */
+
+typedef struct _CLOSINGITEM
+{
+    WPObject        *pObject;       // from SHUTLISTITEM; NULL for non-WPS windows
+    HWND            hwnd;           // swctl.hwnd from SHUTLISTITEM
+    PID             pid;            // swctl.idProcess from SHUTLISTITEM
+    ULONG           ulStarted;      // QSV_MS_COUNT when closing was initiated
+    BOOL            fTimedOut;      // TRUE after XSD_CLOSETIMEOUT has elapsed
+} CLOSINGITEM, *PCLOSINGITEM;
+
 /*
  *@@ SHUTDOWNDATA:
  *      shutdown instance data allocated from the heap
@@ -766,6 +801,18 @@ typedef struct _SHUTDOWNDATA
 
     SHUTDOWNCONSTS  SDConsts;
 
+    // items being closed in parallel (see CloseNextItems)
+    CLOSINGITEM     aClosing[XSD_MAXTRACKED];
+    ULONG           cClosing;
+    BOOL            fCloseTimer;
+
+    // dirty objects saved by the save threads while
+    // windows are being closed (see StartSaveThreads)
+    WPObject        **papSaveObjects;
+    ULONG           cSaveObjects;
+    LONG            lNextSaveObject,
+                    cSavedEarly;
+
 } SHUTDOWNDATA, *PSHUTDOWNDATA;
 
 VOID xsdFinishShutdown(PSHUTDOWNDATA pShutdownData);
@@ -1588,27 +1635,21 @@ VOID xsdWaitForExceptions(PSHUTDOWNDATA pShutdownData)
 }
 
 /*
- *@@ fncbSaveImmediate:
- *      callback for objForAllDirtyObjects to save
- *      the WPS.
+ *@@ SaveOneObject:
+ *      saves one dirty object, unless it is the active
+ *      Desktop (which gets saved separately) or belongs
+ *      to a foreign desktop.
+ *
+ *      Used by both fncbSaveImmediate and the save threads.
  *
  *@@added V0.9.9 (2001-04-04) [umoeller]
  *@@changed V0.9.16 (2001-12-06) [umoeller]: now skipping saving objects from foreign desktops
  */
 
-BOOL _Optlink fncbSaveImmediate(WPObject *pobjThis,
-                                ULONG ulIndex,
-                                ULONG cObjects,
-                                PVOID pvUser)
+STATIC BOOL SaveOneObject(PSHUTDOWNDATA pShutdownData,
+                          WPObject *pobjThis)
 {
     BOOL    brc = FALSE;
-    PSHUTDOWNDATA pShutdownData = (PSHUTDOWNDATA)pvUser;
-
-    // update progress bar
-    WinSendMsg(pShutdownData->hwndProgressBar,
-               WM_UPDATEPROGRESSBAR,
-               (MPARAM)ulIndex,
-               (MPARAM)cObjects);
 
     TRY_QUIET(excpt1)
     {
@@ -1651,6 +1692,144 @@ BOOL _Optlink fncbSaveImmediate(WPObject *pobjThis,
     return brc;
 }
 
+/*
+ *@@ fncbSaveImmediate:
+ *      callback for objForAllDirtyObjects to save
+ *      the WPS.
+ *
+ *@@added V0.9.9 (2001-04-04) [umoeller]
+ *@@changed V0.9.16 (2001-12-06) [umoeller]: now skipping saving objects from foreign desktops
+ */
+
+BOOL _Optlink fncbSaveImmediate(WPObject *pobjThis,
+                                ULONG ulIndex,
+                                ULONG cObjects,
+                                PVOID pvUser)
+{
+    PSHUTDOWNDATA pShutdownData = (PSHUTDOWNDATA)pvUser;
+
+    // update progress bar
+    WinSendMsg(pShutdownData->hwndProgressBar,
+               WM_UPDATEPROGRESSBAR,
+               (MPARAM)ulIndex,
+               (MPARAM)cObjects);
+
+    return SaveOneObject(pShutdownData, pobjThis);
+}
+
+/*
+ *@@ fntSaveThread:
+ *      one of the XSD_SAVETHREADS threads started by
+ *      StartSaveThreads. Each thread takes the next
+ *      object from the SHUTDOWNDATA.papSaveObjects
+ *      snapshot and saves it until the snapshot is
+ *      exhausted or the thread is told to exit.
+ *
+ *      Objects the thread has taken are unlocked here;
+ *      StopSaveThreads unlocks the rest.
+ */
+
+STATIC void _Optlink fntSaveThread(PTHREADINFO ptiMyself)
+{
+    PSHUTDOWNDATA   pShutdownData = (PSHUTDOWNDATA)ptiMyself->ulData;
+
+    while (!ptiMyself->fExit)
+    {
+        LONG        l = lockExchangeAdd(&pShutdownData->lNextSaveObject, 1);
+        WPObject    *pobj;
+
+        if (l >= (LONG)pShutdownData->cSaveObjects)
+            break;
+
+        pobj = pShutdownData->papSaveObjects[l];
+        if (SaveOneObject(pShutdownData, pobj))
+            lockIncrement(&pShutdownData->cSavedEarly);
+
+        _wpUnlockObject(pobj);
+    }
+}
+
+/*
+ *@@ StartSaveThreads:
+ *      takes a snapshot of the "dirty" objects list
+ *      (objLockDirtyObjects) and starts the save threads
+ *      on it. This gets called when we start closing
+ *      windows so that most of the objects have been
+ *      written by the time all windows are closed; only
+ *      objects that became dirty meanwhile are then left
+ *      for objForAllDirtyObjects in fntShutdownThread.
+ */
+
+STATIC VOID StartSaveThreads(PSHUTDOWNDATA pShutdownData)
+{
+    ULONG   ul;
+
+    if (!(pShutdownData->papSaveObjects = objLockDirtyObjects(&pShutdownData->cSaveObjects)))
+        return;
+
+    pShutdownData->lNextSaveObject = 0;
+    pShutdownData->cSavedEarly = 0;
+
+    for (ul = 0;
+         (ul < XSD_SAVETHREADS) && (ul < pShutdownData->cSaveObjects);
+         ul++)
+        thrCreate(&G_atiSaveThreads[ul],
+                  fntSaveThread,
+                  NULL, // running flag
+                  "ShutdownSave",
+                  0,    // no msgq
+                  (ULONG)pShutdownData);
+
+    doshWriteLogEntry(pShutdownData->ShutdownLogFile,
+           __FUNCTION__ ": %d save threads started for %d dirty objects",
+           ul,
+           pShutdownData->cSaveObjects);
+}
+
+/*
+ *@@ StopSaveThreads:
+ *      waits for the save threads to finish. If fCancel
+ *      is TRUE, the threads are told to stop after the
+ *      object they are currently saving.
+ *
+ *      Unlocks the objects that were not taken by a save
+ *      thread and frees the snapshot. Safe to call if the
+ *      threads were never started.
+ */
+
+STATIC VOID StopSaveThreads(PSHUTDOWNDATA pShutdownData,
+                            BOOL fCancel)
+{
+    ULONG   ul;
+
+    if (!pShutdownData->papSaveObjects)
+        return;
+
+    for (ul = 0;
+         ul < XSD_SAVETHREADS;
+         ul++)
+    {
+        if (fCancel)
+            thrClose(&G_atiSaveThreads[ul]);
+        thrWait(&G_atiSaveThreads[ul]);
+    }
+
+    // the threads are gone, so no more interlocked access
+    for (ul = pShutdownData->lNextSaveObject;
+         ul < pShutdownData->cSaveObjects;
+         ul++)
+        _wpUnlockObject(pShutdownData->papSaveObjects[ul]);
+
+    doshWriteLogEntry(pShutdownData->ShutdownLogFile,
+           __FUNCTION__ ": save threads done, %d of %d objects saved",
+           pShutdownData->cSavedEarly,
+           pShutdownData->cSaveObjects);
+
+    free(pShutdownData->papSaveObjects);
+    pShutdownData->papSaveObjects = NULL;
+    pShutdownData->cSaveObjects = 0;
+}
+
 /* ******************************************************************
  *
  *   Shutdown thread
@@ -1717,9 +1896,13 @@ BOOL _Optlink fncbSaveImmediate(WPObject *pobjThis,
  *              first ID_SDMI_CLOSEITEM.
  *
  *          d)  ID_SDMI_CLOSEITEM will now undertake the necessary
- *              actions for closing the first / next item on the list
+ *              actions for closing the next items on the list
  *              of items to close, that is, post WM_CLOSE to the window
- *              or kill the process or whatever.
+ *              or kill the process or whatever. Up to XSD_MAXCLOSING
+ *              items from different processes are closed at the same
+ *              time (see CloseNextItems); meanwhile, the save threads
+ *              started by ID_SDDI_BEGINSHUTDOWN already write the
+ *              dirty Desktop objects (see StartSaveThreads).
  *              If no more items are left to close, we post
  *              ID_SDMI_PREPARESAVEWPS (go to g)).
  *              Otherwise, after this, the Shutdown thread is idle.
@@ -2142,6 +2325,19 @@ STATIC void _Optlink fntShutdownThread(PTHREADINFO ptiMyself)
              *
              *************************************************/
 
+            // let the save threads finish what they have
+            // started, or stop them if we were cancelled
+            StopSaveThreads(pShutdownData,
+                            (G_ulShutdownState != XSD_ALLCLOSED_SAVING));
+
+            if (pShutdownData->fCloseTimer)
+            {
+                WinStopTimer(hab,
+                             pShutdownData->SDConsts.hwndMain,
+                             TIMERID_CLOSETIMEOUT);
+                pShutdownData->fCloseTimer = FALSE;
+            }
+
             // in any case,
             // close the Update thread to prevent it from interfering
             // with what we're doing now
@@ -2343,7 +2539,9 @@ STATIC void _Optlink fntShutdownThread(PTHREADINFO ptiMyself)
 
             // finally, save WPS!!
 
-            // now using proper "dirty" list V0.9.9 (2001-04-04) [umoeller]
+            // now using proper "dirty" list V0.9.9 (2001-04-04) [umoeller];
+            // most objects have been saved by the save threads while
+            // the windows were closing, so this only gets the rest
             cObjectsSaved = objForAllDirtyObjects(fncbSaveImmediate,
                                                   pShutdownData);  // user param
 
@@ -2456,6 +2654,9 @@ STATIC void _Optlink fntShutdownThread(PTHREADINFO ptiMyself)
 
     doshWriteLogEntry(LogFile, "  Done releasing semaphores.");
 
+    // after exceptions, the save threads might still be running
+    StopSaveThreads(pShutdownData, TRUE);
+
     // get rid of the Update thread;
     // this got closed by fnwpShutdownThread normally,
     // but with exceptions, this might not have happened
@@ -2924,6 +3125,275 @@ STATIC VOID CloseOneItem(PSHUTDOWNDATA pShutdownData,
     }
 }
 
+/*
+ *@@ PruneClosingItems:
+ *      removes all items from SHUTDOWNDATA.aClosing which
+ *      are no longer on the shutdown list, i.e. which
+ *      have been closed.
+ *
+ *      Returns the no. of items in aClosing that are still
+ *      being waited for (that is, which have not timed out).
+ */
+
+STATIC ULONG PruneClosingItems(PSHUTDOWNDATA pShutdownData)
+{
+    ULONG   ulWaiting = 0;
+
+    if (pShutdownData->fShutdownSemOwned = !DosRequestMutexSem(pShutdownData->hmtxShutdown, 4000))
+    {
+        ULONG   ul = 0;
+        while (ul < pShutdownData->cClosing)
+        {
+            PCLOSINGITEM pClosing = &pShutdownData->aClosing[ul];
+            PLISTNODE   pNode = lstQueryFirstNode(&pShutdownData->llShutdown);
+            while (pNode)
+            {
+                PSHUTLISTITEM pItem = (PSHUTLISTITEM)pNode->pItemData;
+                if (    (pItem->pObject == pClosing->pObject)
+                     && (pItem->swctl.hwnd == pClosing->hwnd)
+                   )
+                    break;
+                pNode = pNode->pNext;
+            }
+
+            if (!pNode)
+            {
+                // item is gone: remove it from the array
+                memmove(pClosing,
+                        pClosing + 1,
+                        (--pShutdownData->cClosing - ul) * sizeof(CLOSINGITEM));
+                continue;
+            }
+
+            if (!pClosing->fTimedOut)
+                ulWaiting++;
+            ul++;
+        }
+
+        DosReleaseMutexSem(pShutdownData->hmtxShutdown);
+        pShutdownData->fShutdownSemOwned = FALSE;
+    }
+
+    return ulWaiting;
+}
+
+/*
+ *@@ CheckCloseTimeouts:
+ *      marks items in SHUTDOWNDATA.aClosing as timed out
+ *      if closing was initiated more than XSD_CLOSETIMEOUT
+ *      ms ago. Those items are no longer waited for; they
+ *      stay on the shutdown list so that the user can
+ *      still skip them.
+ *
+ *      Returns TRUE if any item has timed out just now.
+ */
+
+STATIC BOOL CheckCloseTimeouts(PSHUTDOWNDATA pShutdownData)
+{
+    BOOL    brc = FALSE;
+    ULONG   ulNow,
+            ul;
+
+    DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ulNow, sizeof(ulNow));
+
+    for (ul = 0;
+         ul < pShutdownData->cClosing;
+         ul++)
+    {
+        PCLOSINGITEM pClosing = &pShutdownData->aClosing[ul];
+        if (    (!pClosing->fTimedOut)
+             && (ulNow - pClosing->ulStarted > XSD_CLOSETIMEOUT)
+           )
+        {
+            doshWriteLogEntry(pShutdownData->ShutdownLogFile,
+                   "    Close timed out for hwnd 0x%lX (pid 0x%lX)",
+                   pClosing->hwnd,
+                   pClosing->pid);
+            pClosing->fTimedOut = TRUE;
+            brc = TRUE;
+        }
+    }
+
+    return brc;
+}
+
+/*
+ *@@ CloseNextItems:
+ *      implementation for ID_SDMI_CLOSEITEM. Instead of
+ *      closing only the first item on the shutdown list
+ *      and waiting for it to go away, this initiates
+ *      closing for as many items as there are free slots
+ *      in SHUTDOWNDATA.aClosing, in list order.
+ *
+ *      Items are considered independent and thus closed
+ *      in parallel unless
+ *
+ *      --  they are VIO sessions, which may need the
+ *          confirmation dialog: these are only closed
+ *          when they are the current item, as before;
+ *
+ *      --  they belong to a process in which another
+ *          non-WPS window is being closed already.
+ *
+ *      An item that has not closed after XSD_CLOSETIMEOUT
+ *      no longer holds a slot (see CheckCloseTimeouts).
+ */
+
+STATIC VOID CloseNextItems(PSHUTDOWNDATA pShutdownData,
+                           HWND hwndListbox)
+{
+    SHUTLISTITEM    aItems[XSD_MAXCLOSING];
+    ULONG           cItems = 0,
+                    cFree = XSD_MAXCLOSING - PruneClosingItems(pShutdownData),
+                    ulNow,
+                    ul;
+    PSHUTLISTITEM   pCurrent;
+    SHUTLISTITEM    VioItem;
+    BOOL            fVio = FALSE,
+                    fSkippedSemOwned = FALSE;
+
+    // the first non-skipped item
+    if (!(pCurrent = xsdQueryCurrentItem(pShutdownData)))
+        return;
+
+    if (    (pShutdownData->fShutdownSemOwned = !DosRequestMutexSem(pShutdownData->hmtxShutdown, 4000))
+         && (fSkippedSemOwned = !DosRequestMutexSem(pShutdownData->hmtxSkipped, 4000))
+       )
+    {
+        PLISTNODE   pNode = lstQueryFirstNode(&pShutdownData->llShutdown);
+        CHAR        szShutItem[1000],
+                    szSkipItem[1000];
+
+        while (pNode)
+        {
+            PSHUTLISTITEM   pItem = (PSHUTLISTITEM)pNode->pItemData;
+            PLISTNODE       pSkipNode;
+            BOOL            fTake = TRUE;
+
+            pNode = pNode->pNext;
+
+            // skipped?
+            xsdLongTitle(szShutItem, pItem);
+            for (pSkipNode = lstQueryFirstNode(&pShutdownData->llSkipped);
+                 pSkipNode;
+                 pSkipNode = pSkipNode->pNext)
+            {
+                xsdLongTitle(szSkipItem, (PSHUTLISTITEM)pSkipNode->pItemData);
+                if (!strcmp(szShutItem, szSkipItem))
+                    break;
+            }
+            if (pSkipNode)
+                continue;
+
+            if (    (!pItem->pObject)
+                 && (pItem->swctl.hwnd)
+                 && (    (pItem->swctl.bProgType == PROG_VDM)
+                      || (pItem->swctl.bProgType == PROG_WINDOWEDVDM)
+                      || (pItem->swctl.bProgType == PROG_FULLSCREEN)
+                      || (pItem->swctl.bProgType == PROG_WINDOWABLEVIO)
+                    )
+               )
+            {
+                // VIO: only the current item, and never tracked,
+                // CloseOneItem checks for the dialog itself
+                if (    (pItem->swctl.hwnd == pCurrent->swctl.hwnd)
+                     && (pItem->pObject == pCurrent->pObject)
+                   )
+                {
+                    memcpy(&VioItem, pItem, sizeof(SHUTLISTITEM));
+                    fVio = TRUE;
+                }
+                continue;
+            }
+
+            if (    (cItems >= cFree)
+                 || (pShutdownData->cClosing + cItems >= XSD_MAXTRACKED)
+               )
+                // no more free slots
+                break;
+
+            // already being closed?
+            for (ul = 0;
+                 ul < pShutdownData->cClosing;
+                 ul++)
+            {
+                PCLOSINGITEM pClosing = &pShutdownData->aClosing[ul];
+                if (    (pClosing->pObject == pItem->pObject)
+                     && (pClosing->hwnd == pItem->swctl.hwnd)
+                   )
+                    break;
+                if (    (!pItem->pObject)
+                     && (!pClosing->pObject)
+                     && (!pClosing->fTimedOut)
+                     && (pClosing->pid == pItem->swctl.idProcess)
+                   )
+                    // same process: wait for the other one
+                    break;
+            }
+            if (ul < pShutdownData->cClosing)
+                continue;
+
+            // same process as one we've picked just now?
+            if (!pItem->pObject)
+                for (ul = 0;
+                     ul < cItems;
+                     ul++)
+                    if (    (!aItems[ul].pObject)
+                         && (aItems[ul].swctl.idProcess == pItem->swctl.idProcess)
+                       )
+                    {
+                        fTake = FALSE;
+                        break;
+                    }
+
+            if (fTake)
+                // copy, the list can be rebuilt while we're
+                // sending messages below
+                memcpy(&aItems[cItems++], pItem, sizeof(SHUTLISTITEM));
+        }
+    }
+
+    if (fSkippedSemOwned)
+        DosReleaseMutexSem(pShutdownData->hmtxSkipped);
+
+    if (pShutdownData->fShutdownSemOwned)
+    {
+        DosReleaseMutexSem(pShutdownData->hmtxShutdown);
+        pShutdownData->fShutdownSemOwned = FALSE;
+    }
+
+    if (fVio)
+        CloseOneItem(pShutdownData,
+                     hwndListbox,
+                     &VioItem);
+
+    DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ulNow, sizeof(ulNow));
+
+    for (ul = 0;
+         ul < cItems;
+         ul++)
+    {
+        PCLOSINGITEM pClosing = &pShutdownData->aClosing[pShutdownData->cClosing++];
+        pClosing->pObject = aItems[ul].pObject;
+        pClosing->hwnd = aItems[ul].swctl.hwnd;
+        pClosing->pid = aItems[ul].swctl.idProcess;
+        pClosing->ulStarted = ulNow;
+        pClosing->fTimedOut = FALSE;
+
+        CloseOneItem(pShutdownData,
+                     hwndListbox,
+                     &aItems[ul]);
+    }
+
+    if (    (pShutdownData->cClosing)
+         && (!pShutdownData->fCloseTimer)
+       )
+        pShutdownData->fCloseTimer = !!WinStartTimer(pShutdownData->habShutdownThread,
+                                                     pShutdownData->SDConsts.hwndMain,
+                                                     TIMERID_CLOSETIMEOUT,
+                                                     1000);
+}
+
 /*
  *@@ fnwpShutdownThread:
  *      window procedure for both the main (debug) window and
@@ -3063,6 +3533,10 @@ STATIC MRESULT EXPENTRY fnwpShutdownThread(HWND hwndFrame, ULONG msg, MPARAM mp1
 
                     // mark status as "closing windows now"
                     G_ulShutdownState = XSD_CLOSINGWINDOWS;
+
+                    // start saving dirty objects while the
+                    // windows are closing
+                    StartSaveThreads(pShutdownData);
                     WinEnableControl(pShutdownData->SDConsts.hwndMain,
                                       ID_SDDI_BEGINSHUTDOWN,
                                       FALSE);
@@ -3078,11 +3552,13 @@ STATIC MRESULT EXPENTRY fnwpShutdownThread(HWND hwndFrame, ULONG msg, MPARAM mp1
                 /*
                  * ID_SDMI_CLOSEITEM:
                  *     this msg is posted first upon receiving
-                 *     ID_SDDI_BEGINSHUTDOWN and subsequently for every
-                 *     window that is to be closed; we only INITIATE
-                 *     closing the window here by posting messages
-                 *     or killing the window; we then rely on the
-                 *     update thread to realize that the window has
+                 *     ID_SDDI_BEGINSHUTDOWN and subsequently whenever
+                 *     the list has changed or a close has timed out;
+                 *     we only INITIATE closing windows here by posting
+                 *     messages or killing the window, for up to
+                 *     XSD_MAXCLOSING independent items at a time
+                 *     (see CloseNextItems); we then rely on the
+                 *     update thread to realize that the windows have
                  *     actually been removed from the Tasklist. The
                  *     Update thread then posts ID_SDMI_UPDATESHUTLIST,
                  *     which will then in turn post another ID_SDMI_CLOSEITEM.
@@ -3090,18 +3566,15 @@ STATIC MRESULT EXPENTRY fnwpShutdownThread(HWND hwndFrame, ULONG msg, MPARAM mp1
 
                 case ID_SDMI_CLOSEITEM:
                 {
-                    PSHUTLISTITEM pItem;
-
                     doshWriteLogEntry(pShutdownData->ShutdownLogFile,
                            "  ID_SDMI_CLOSEITEM");
 
-                    // get task list item to close from linked list
-                    if (pItem = xsdQueryCurrentItem(pShutdownData))
+                    // get task list items to close from linked list
+                    if (xsdQueryCurrentItem(pShutdownData))
                     {
-                        CloseOneItem(pShutdownData,
-                                     hwndListbox,
-                                     pItem);
-                    } // end if (pItem)
+                        CloseNextItems(pShutdownData,
+                                       hwndListbox);
+                    }
                     else
                     {
                         // no more items left: enter phase 2 (save WPS)
@@ -3321,6 +3794,35 @@ STATIC MRESULT EXPENTRY fnwpShutdownThread(HWND hwndFrame, ULONG msg, MPARAM mp1
         }
         break;  // end case WM_COMMAND
 
+        /*
+         * WM_TIMER:
+         *     TIMERID_CLOSETIMEOUT runs while items are being
+         *     closed; if an item has exceeded XSD_CLOSETIMEOUT,
+         *     free its slot so that closing can go on.
+         */
+
+        case WM_TIMER:
+        {
+            PSHUTDOWNDATA   pShutdownData;
+
+            if (    ((ULONG)mp1 == TIMERID_CLOSETIMEOUT)
+                 && (pShutdownData = (PSHUTDOWNDATA)WinQueryWindowPtr(hwndFrame,
+                                                                      QWL_USER))
+               )
+            {
+                if (    (G_ulShutdownState == XSD_CLOSINGWINDOWS)
+                     && (CheckCloseTimeouts(pShutdownData))
+                   )
+                    WinPostMsg(pShutdownData->SDConsts.hwndMain,
+                               WM_COMMAND,
+                               MPFROM2SHORT(ID_SDMI_CLOSEITEM, 0),
+                               MPNULL);
+            }
+            else
+                mrc = WinDefDlgProc(hwndFrame, msg, mp1, mp2);
+        }
+        break;
+
         // other msgs: have them handled by the usual WC_FRAME wnd proc
         default:
            mrc = WinDefDlgProc(hwndFrame, msg, mp1, mp2);
@@ -156,7 +156,7 @@ typedef WINQUERYDESKTOPWORKAREA *PWINQUERYDESKTOPWORKAREA;
 
 // some more forward declarations
 VOID StartAutoHide(PXCENTERWINDATA pXCenterData);
-VOID ClientPaint2(HWND hwndClient, HPS hps);
+VOID ClientPaint2(HWND hwndClient, HPS hps, PRECTL prclPaint);
 
 // width of the sizing bar... this is always drawn as
 // a 3D rectangle three pixels wide, and we need one
@@ -1685,7 +1685,7 @@ VOID ctrpDrawEmphasis(PXCENTERWINDATA pXCenterData,
         if (fRemove)
         {
             // remove emphasis:
-            ClientPaint2(pGlobals->hwndClient, hps);
+            ClientPaint2(pGlobals->hwndClient, hps, NULL);
             pXCenterData->fHasEmphasis = FALSE;
         }
         else
@@ -4413,19 +4413,30 @@ STATIC MRESULT EXPENTRY fnwpXCenterMainFrame(HWND hwnd, ULONG msg, MPARAM mp1, M
  *      called from ClientPaint and ctrpDrawEmphasis
  *      to redraw the client with a given HPS.
  *
+ *      If prclPaint is not NULL, it is the (exclusive)
+ *      update rectangle from WinBeginPaint, and we only
+ *      fill that part of the background and only draw
+ *      the spacing lines and sizing bars that fall into
+ *      it. When a single widget repaints, this leaves
+ *      the rest of the client alone.
+ *
  *@@added V0.9.7 (2001-01-18) [umoeller]
  *@@changed V0.9.13 (2001-06-19) [umoeller]: added spacing lines painting
  *@@changed V0.9.18 (2002-03-19) [umoeller]: changed bottom 3D color to black
  */
 
 STATIC VOID ClientPaint2(HWND hwndClient,
-                         HPS hps)
+                         HPS hps,
+                         PRECTL prclPaint)      // in: update rect or NULL for all
 {
     PXCENTERWINDATA pXCenterData = (PXCENTERWINDATA)WinQueryWindowPtr(hwndClient, QWL_USER);
     PXCENTERGLOBALS pGlobals = &pXCenterData->Globals;
     XCenterData     *somThis = XCenterGetData(pXCenterData->somSelf);
-    RECTL           rclWin;
+    RECTL           rclWin,
+                    rclFill;
     ULONG           ul3DBorderWidth = pGlobals->ul3DBorderWidth;
+    LONG            xPaintLeft,
+                    xPaintRight;        // inclusive
 
     // draw 3D frame
     WinQueryWindowRect(hwndClient,
@@ -4497,6 +4508,28 @@ STATIC VOID ClientPaint2(HWND hwndClient,
         }
     } // end if (ul3DBorderWidth)
 
+    // clip to the update rectangle, if we have one
+    rclFill = rclWin;
+    if (prclPaint)
+    {
+        if (rclFill.xLeft < prclPaint->xLeft)
+            rclFill.xLeft = prclPaint->xLeft;
+        if (rclFill.xRight > prclPaint->xRight - 1)
+            rclFill.xRight = prclPaint->xRight - 1;
+        if (rclFill.yBottom < prclPaint->yBottom)
+            rclFill.yBottom = prclPaint->yBottom;
+        if (rclFill.yTop > prclPaint->yTop - 1)
+            rclFill.yTop = prclPaint->yTop - 1;
+    }
+    xPaintLeft = rclFill.xLeft;
+    xPaintRight = rclFill.xRight;
+
+    if (    (rclFill.xLeft > rclFill.xRight)
+         || (rclFill.yBottom > rclFill.yTop)
+       )
+        // nothing of the inside needs painting
+        return;
+
     // fill client; rclWin has been reduced properly above
     GpiSetColor(hps,
                 _lcolClientBackground);
@@ -4504,7 +4537,7 @@ STATIC VOID ClientPaint2(HWND hwndClient,
                         // V0.9.9 (2001-03-07) [umoeller]
     gpihBox(hps,
             DRO_FILL,
-            &rclWin);
+            &rclFill);
 
     // check if we're currently doing the "unfold frame"
     // animation
@@ -4529,16 +4562,20 @@ STATIC VOID ClientPaint2(HWND hwndClient,
 
             // if spacing lines are enabled, draw these behind each
             // widget, except the last one
+            LONG    xLine =   pWidgetThis->xCurrent
+                            + pWidgetThis->szlCurrent.cx
+                            + (pGlobals->ulWidgetSpacing / 2);
+
             if (    (pGlobals->flDisplayStyle & XCS_SPACINGLINES)
                  && (pNode->pNext)
+                 && (xLine + 1 >= xPaintLeft)
+                 && (xLine <= xPaintRight)
                )
             {
                 POINTL ptl;
                 // draw dark line
                 GpiSetColor(hps, pGlobals->lcol3DDark);
-                ptl.x =    pWidgetThis->xCurrent
-                         + pWidgetThis->szlCurrent.cx
-                         + (pGlobals->ulWidgetSpacing / 2);
+                ptl.x = xLine;
                 ptl.y = rclWin.yBottom;
                 GpiMove(hps, &ptl);
                 ptl.y = rclWin.yTop;
@@ -4555,7 +4592,10 @@ STATIC VOID ClientPaint2(HWND hwndClient,
             // check pWidgetThis->xSizingBar... this has been set
             // to the xpos of the sizing bar by ReformatWidgets
             // if the widget is sizeable, otherwise it's 0
-            if (pWidgetThis->xSizingBar)
+            if (    (pWidgetThis->xSizingBar)
+                 && (pWidgetThis->xSizingBar + 2 >= xPaintLeft)
+                 && (pWidgetThis->xSizingBar <= xPaintRight)
+               )
             {
                 rcl2.xLeft = pWidgetThis->xSizingBar;
                 rcl2.xRight = rcl2.xLeft + 2;       // inclusive!
@@ -4585,7 +4625,7 @@ STATIC VOID ClientPaint(HWND hwnd)
         // switch to RGB
         gpihSwitchToRGB(hps);
 
-        ClientPaint2(hwnd, hps);
+        ClientPaint2(hwnd, hps, &rclPaint);
 
         WinEndPaint(hps);
     }
@@ -44,6 +44,14 @@
  *      --  <HTML SUBLINKS> and <HTML NOSUBLINKS> are not
  *          yet supported.
  *
+ *      Source files are converted in "waves": all files
+ *      which are known at a given time are converted in
+ *      parallel on several threads (see -t), and the links
+ *      found in them are then resolved in list order on
+ *      thread 1 to form the next wave. This produces the
+ *      same article order and resids as converting one
+ *      file after another.
+ *
  *@@header "h2i.h"
  *@@added V0.9.13 (2001-06-23) [umoeller]
  */
@@ -67,6 +75,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
 #include <setjmp.h>
 #include <io.h>
 
@@ -82,6 +91,7 @@
 #include "helpers\linklist.h"
 #include "helpers\standards.h"
 #include "helpers\stringh.h"
+#include "helpers\threads.h"
 #include "helpers\tree.h"
 #include "helpers\xstring.h"
 
@@ -169,8 +179,26 @@ typedef struct _ARTICLETREENODE
                                    // articles so we won't write the
                                    // article twice
 
+    struct _ARTICLETREENODE *pHashNext;
+                                   // next article in the same
+                                   // G_apArticles bucket
+
+    LINKLIST    llLinks;           // link targets found by ParseFile
+                                   // (strdup'ed PSZs); these are only
+                                   // turned into articles by ResolveLinks
+                                   // after the whole wave was converted
+
+    ULONG       ulReplacements;    // entities replaced in this file
+
 } ARTICLETREENODE, *PARTICLETREENODE;
 
+#define ARTICLEHASHSIZE     1024    // must be a power of two
+
+#define MAXENTITYNESTING    16      // max. nesting of #defines which
+                                    // refer to other #defines
+
+#define MAXTHREADS          16      // max. value for -t
+
 #define LIST_UL             1
 #define LIST_OL             2
 #define LIST_DL             3
@@ -228,6 +256,10 @@ typedef struct _STATUS
 
     ULONG       ulNestingIFDEFs,
                 ulNestingIFNDEFs;
+
+    XSTRING     strError;           // buffer for error messages that
+                                    // need formatting; per file since
+                                    // files are converted in parallel
 } STATUS, *PSTATUS;
 
 /* ******************************************************************
@@ -239,7 +271,8 @@ typedef struct _STATUS
 TREE        *G_DefinesTreeRoot;
 ULONG       G_cDefines = 0;
 ULONG       G_ulReplacements = 0;
-TREE        *G_LinkIDsTreeRoot;
+PARTICLETREENODE G_apArticles[ARTICLEHASHSIZE];
+                                      // all articles, hashed by file name
 
 LINKLIST    G_llFiles2Process;
 
@@ -247,6 +280,12 @@ ULONG       G_ulVerbosity = 1;
 
 BOOL        G_fNoMoveToRoot = FALSE;
 
+ULONG       G_cThreads = 4;           // -t option
+
+HMTX        G_hmtxOutput = NULLHANDLE;
+                                      // serializes Error() output while
+                                      // files are converted in parallel
+
 XSTRING     G_strError,               // string buffer for error msgs
             G_strCrashContext;
 
@@ -275,6 +314,9 @@ VOID Error(ULONG ulCategory,
            const char *pcszFormat,     // in: format string (like with printf)
            ...)                        // in: additional stuff (like with printf)
 {
+    if (G_hmtxOutput)
+        DosRequestMutexSem(G_hmtxOutput, SEM_INDEFINITE_WAIT);
+
     if (G_ulVerbosity <= 1)
         printf("\n");
     if (G_ulVerbosity)
@@ -303,6 +345,9 @@ VOID Error(ULONG ulCategory,
         printf("\nType 'h2i -h' for help.\n");
     else
         printf("\n");
+
+    if (G_hmtxOutput)
+        DosReleaseMutexSem(G_hmtxOutput);
 }
 
 #define H2I_HEADER "h2i V"BLDLEVEL_VERSION" ("__DATE__") (C) 2001-2003 Ulrich Mller"
@@ -342,7 +387,7 @@ VOID Explain(const char *pcszFormat,     // in: format string (like with printf)
     PrintHeader();
     printf("h2i (for 'html to ipf') translates a large bunch of HTML files into a\n");
     printf("single IPF file, which can then be fed into IBM's ipfc compiler.\n");
-    printf("Usage: h2i [-i<include>]... [-v[0|1|2|3]] [-s] [-r] <root.htm>\n");
+    printf("Usage: h2i [-i<include>]... [-v[0|1|2|3]] [-s] [-r] [-t<n>] <root.htm>\n");
     printf("with:\n");
     printf("   <root.htm>  the HTML file to start with. This better link to other files.\n");
     printf("   -i<include> include a C header, whose #define statements are parsed\n");
@@ -352,6 +397,8 @@ VOID Explain(const char *pcszFormat,     // in: format string (like with printf)
     printf("   -s          show some statistics when done.\n");
     printf("   -r          show only <root.htm> at level 1 in the TOC; otherwise all\n");
     printf("               second-level files are moved to level 1 as well.\n");
+    printf("   -t<n>       convert up to <n> files in parallel (1-%d, default 4).\n",
+           MAXTHREADS);
 }
 
 /*
@@ -398,118 +445,258 @@ PDEFINENODE FindDefinition(const char *pcszIdentifier)
                                   fnCompareStrings));
 }
 
+/*
+ *@@ CatRun:
+ *      appends cb characters from pcsz to pxstr.
+ *      Unlike xstrcat, this does nothing if cb is
+ *      0 instead of taking the length of pcsz.
+ */
+
+VOID CatRun(PXSTRING pxstr,
+            PCSZ pcsz,
+            ULONG cb)
+{
+    if (cb)
+        xstrcat(pxstr, pcsz, cb);
+}
+
+/*
+ *@@ CountLines:
+ *      returns the line number of pcszPos in
+ *      pcszBuf, for error messages.
+ */
+
+ULONG CountLines(PCSZ pcszBuf,
+                 PCSZ pcszPos)
+{
+    ULONG ulLine = 1;
+    while (    (pcszBuf < pcszPos)
+            && (pcszBuf = (PCSZ)memchr(pcszBuf, '\n', pcszPos - pcszBuf))
+          )
+    {
+        ulLine++;
+        pcszBuf++;
+    }
+    return ulLine;
+}
+
+/*
+ *@@ ExpandEntities:
+ *      appends pcszSource to pxstrTarget with all
+ *      entities (&name;) that have a #define replaced.
+ *      Replacement values are expanded in turn, up to
+ *      MAXENTITYNESTING levels.
+ *
+ *      pcszBuf is the top-level source buffer and pcszPos
+ *      the position of the entity being expanded (NULL at
+ *      top level); both are only used for the line number
+ *      in warnings.
+ */
+
+VOID ExpandEntities(PARTICLETREENODE pFile2Process,
+                    PXSTRING pxstrTarget,
+                    PCSZ pcszSource,
+                    PCSZ pcszBuf,
+                    PCSZ pcszPos,
+                    ULONG ulDepth)
+{
+    PCSZ    pStart = pcszSource,
+            p = pcszSource;
+
+    // extract the entity (between '&' and ';')
+    while (p = strchr(p, '&'))
+    {
+        PCSZ        p2;
+        PDEFINENODE pDef = NULL;
+        CHAR        szName[200];
+        ULONG       cbName;
+
+        if (!(p2 = strchr(p, ';')))
+            // no ';' anywhere after this, so there are
+            // no more entities either
+            break;
+
+        // find the definition for the entity in
+        // the global list; copy the name since the
+        // value strings are shared between threads
+        if ((cbName = p2 - (p + 1)) < sizeof(szName))
+        {
+            memcpy(szName, p + 1, cbName);
+            szName[cbName] = '\0';
+            pDef = FindDefinition(szName);
+        }
+
+        if (pDef)
+        {
+            if (G_ulVerbosity > 2)
+                printf("\n   found entity \"%s\" --> \"%s\"",
+                       szName, pDef->pszValue);
+
+            CatRun(pxstrTarget, pStart, p - pStart);
+
+            // replace the entity string with the
+            // definition string
+            if (ulDepth < MAXENTITYNESTING)
+                ExpandEntities(pFile2Process,
+                               pxstrTarget,
+                               pDef->pszValue,
+                               pcszBuf,
+                               (pcszPos) ? pcszPos : p,
+                               ulDepth + 1);
+            else
+                CatRun(pxstrTarget, pDef->pszValue, pDef->ulValueLength);
+
+            pFile2Process->ulReplacements++;
+
+            pStart = p2 + 1;
+        }
+        else
+        {
+            // not found:
+            // if it's not one of the standards we'll
+            // replace later, complain
+            if (    !(cbName == 2 && !memcmp(p + 1, "gt", 2))
+                 && !(cbName == 2 && !memcmp(p + 1, "lt", 2))
+                 && !(cbName == 3 && !memcmp(p + 1, "amp", 3))
+               )
+            {
+                Error(1,
+                      __FILE__, __LINE__, __FUNCTION__,
+                      "Unknown entity \"%.*s;\" at line %d in file \"%s\".",
+                      (int)(p2 - p),
+                      p,
+                      CountLines(pcszBuf, (pcszPos) ? pcszPos : p),
+                      (PSZ)pFile2Process->Tree.ulKey);      // filename
+            }
+        }
+
+        p = p2 + 1;
+    }
+
+    // rest of the source
+    CatRun(pxstrTarget, pStart, strlen(pStart));
+}
+
 /*
  *@@ ResolveEntities:
- *
+ *      replaces all entities in pstrSource for which
+ *      we have a #define.
  */
 
 APIRET ResolveEntities(PARTICLETREENODE pFile2Process,
                        PXSTRING pstrSource)
 {
-    if (G_cDefines)
+    if (    (G_cDefines)
+         && (pstrSource->psz)
+         && (strchr(pstrSource->psz, '&'))
+       )
     {
         // we have include files:
-        PSZ p = pstrSource->psz;
+        XSTRING strNew;
+        xstrInit(&strNew, pstrSource->ulLength + (pstrSource->ulLength >> 3) + 1);
+
+        ExpandEntities(pFile2Process,
+                       &strNew,
+                       pstrSource->psz,
+                       pstrSource->psz,
+                       NULL,
+                       0);
+
+        xstrClear(pstrSource);
+        *pstrSource = strNew;
+    }
+
+    return NO_ERROR;
+}
+
+/*
+ *@@ ConvertEscapes:
+ *      converts the &amp;, &lt; and &gt; escapes
+ *      for IPF. This works in place in one pass since
+ *      the result is never longer than the source.
+ */
 
-        // extract the entity (between '&' and ';')
-        while (p = strchr(p, '&'))
+const char *ConvertEscapes(PXSTRING pstr)
+{
+    PSZ     pSource,
+            pTarget;
+
+    if (    (pstr->psz)
+         && (pSource = strchr(pstr->psz, '&'))
+       )
+    {
+        CHAR c;
+        pTarget = pSource;
+
+        while (c = *pSource)
         {
-            PSZ p2;
-            if (!(p2 = strchr(p, ';')))
-                p++;
-            else
+            if (c == '&')
             {
-                // find the definition for the entity in
-                // the global list; so make this null-terminated
-                // first
-                *p2 = '\0';
-
-                PDEFINENODE pDef = 0;
-                if (pDef = FindDefinition(p + 1))
+                if (!strncmp(pSource, "&amp;", 5))
                 {
-                    if (G_ulVerbosity > 2)
-                        printf("\n   found entity \"%s\" --> \"%s\"",
-                               p + 1, pDef->pszValue);
-                    *p2 = ';';
-
-                    // replace the entity string with the
-                    // definition string
-                    ULONG ulPos = (p - pstrSource->psz),
-                          ulReplLen = pDef->ulValueLength;
-                    xstrrpl(pstrSource,
-                            // first ofs to replace:
-                            ulPos,
-                            // char count to replace:
-                            (p2 + 1) - p,       // include ';'
-                            // replacement string:
-                            pDef->pszValue,
-                            ulReplLen);
-
-                    // string buffer might have changed, so
-                    // re-adjust source position
-                    p = pstrSource->psz + ulPos;
-
-                    G_ulReplacements++;
+                    memcpy(pTarget, "&amp.", 5);
+                    pTarget += 5;
+                    pSource += 5;
+                    continue;
                 }
-                else
+                if (!strncmp(pSource, "&lt;", 4))
                 {
-                    // not found:
-                    // if it's not one of the standards we'll
-                    // replace later, complain
-                    if (    (strcmp(p + 1, "gt"))
-                         && (strcmp(p + 1, "lt"))
-                         && (strcmp(p + 1, "amp"))
-                       )
-                    {
-                        Error(1,
-                              __FILE__, __LINE__, __FUNCTION__,
-                              "Unknown entity \"%s;\" at line %d in file \"%s\".",
-                              p,
-                              strhCount(pstrSource->psz, '\n') + 1,
-                              (PSZ)pFile2Process->Tree.ulKey);      // filename
-                    }
-
-                    *p2 = ';';
-
-                    p = p2 + 1;
+                    *pTarget++ = '<';
+                    pSource += 4;
+                    continue;
+                }
+                if (!strncmp(pSource, "&gt;", 4))
+                {
+                    *pTarget++ = '>';
+                    pSource += 4;
+                    continue;
                 }
             }
+
+            *pTarget++ = *pSource++;
         }
+
+        *pTarget = '\0';
+        pstr->ulLength = pTarget - pstr->psz;
     }
+
+    return pstr->psz;
 }
 
 /*
- *@@ ConvertEscapes:
- *
+ *@@ HashFilename:
+ *      case-insensitive hash for G_apArticles, matching
+ *      the strhicmp comparison used for file names.
  */
 
-const char *ConvertEscapes(PXSTRING pstr)
+ULONG HashFilename(PCSZ pcsz)
 {
-    const char *papszSources[] =
-        {
-            "&amp;",
-            "&lt;",
-            "&gt;"
-        };
-    const char *papszTargets[] =
-        {
-            "&amp.",
-            "<",
-            ">"
-        };
-
-    ULONG ul;
-    for (ul = 0;
-         ul < ARRAYITEMCOUNT(papszSources);
-         ul++)
-    {
-        ULONG ulOfs = 0;
-        while (xstrFindReplaceC(pstr,
-                                &ulOfs,
-                                papszSources[ul],
-                                papszTargets[ul]))
-            ;
-    }
+    ULONG   ulHash = 2166136261UL;
+    CHAR    c;
+
+    while (c = *pcsz++)
+        ulHash = (ulHash ^ (UCHAR)toupper(c)) * 16777619UL;
+
+    return ulHash & (ARTICLEHASHSIZE - 1);
+}
+
+/*
+ *@@ FindArticle:
+ *      returns the article for the given file name
+ *      or NULL if there is none.
+ */
+
+PARTICLETREENODE FindArticle(PCSZ pcszFilename)
+{
+    PARTICLETREENODE p;
+
+    for (p = G_apArticles[HashFilename(pcszFilename)];
+         p;
+         p = p->pHashNext)
+        if (!strhicmp((PCSZ)p->Tree.ulKey, pcszFilename))
+            return p;
+
+    return NULL;
 }
 
 /*
@@ -543,9 +730,7 @@ PARTICLETREENODE GetOrCreateArticle(const char *pcszFilename,
     PARTICLETREENODE pMapping;
 
     // check if we have an article for this file name already
-    if (pMapping = (PARTICLETREENODE)treeFind(G_LinkIDsTreeRoot,
-                                              (ULONG)pcszFilename,
-                                              fnCompareStrings))
+    if (pMapping = FindArticle(pcszFilename))
         // exists:
         return (pMapping);
     else
@@ -563,11 +748,12 @@ PARTICLETREENODE GetOrCreateArticle(const char *pcszFilename,
 
                 xstrInit(&pMapping->strIPF, 0);
                 xstrInit(&pMapping->strTitle, 0);
+                lstInit(&pMapping->llLinks, TRUE);
+
+                ULONG ulHash = HashFilename(pcszFilename);
+                pMapping->pHashNext = G_apArticles[ulHash];
+                G_apArticles[ulHash] = pMapping;
 
-                if (!treeInsert(&G_LinkIDsTreeRoot,
-                                NULL,
-                                (TREE*)pMapping,
-                                fnCompareStrings))
                 {
                     // this is a new file...
                     // if it's not an HTML link, check if this exists
@@ -604,6 +790,45 @@ PARTICLETREENODE GetOrCreateArticle(const char *pcszFilename,
     return (0);
 }
 
+/*
+ *@@ AddLink:
+ *      records a link from pFile2Process to the given
+ *      target. The article for the target is only
+ *      looked up or created by ResolveLinks, on
+ *      thread 1, after the current wave of files has
+ *      been converted.
+ */
+
+VOID AddLink(PARTICLETREENODE pFile2Process,
+             PCSZ pcszTarget)
+{
+    lstAppendItem(&pFile2Process->llLinks,
+                  strdup(pcszTarget));
+}
+
+/*
+ *@@ ResolveLinks:
+ *      calls GetOrCreateArticle for every link that
+ *      was recorded while pFile2Process was converted,
+ *      in source order. This appends new files to
+ *      G_llFiles2Process exactly as if GetOrCreateArticle
+ *      had been called during conversion.
+ */
+
+VOID ResolveLinks(PARTICLETREENODE pFile2Process)
+{
+    PLISTNODE pNode = lstQueryFirstNode(&pFile2Process->llLinks);
+    while (pNode)
+    {
+        GetOrCreateArticle((PCSZ)pNode->pItemData,
+                           pFile2Process->ulHeaderLevel,
+                           pFile2Process);
+        pNode = pNode->pNext;
+    }
+
+    lstClear(&pFile2Process->llLinks);
+}
+
 /* ******************************************************************
  *
  *   Tag handlers
@@ -1421,10 +1646,7 @@ PCSZ HandleA(PARTICLETREENODE pFile2Process,
                                                 "AUTO",
                                                 NULL))
                 {
-                    PARTICLETREENODE patn
-                        = GetOrCreateArticle(pszAttrib,
-                                             pFile2Process->ulHeaderLevel,
-                                             pFile2Process);
+                    AddLink(pFile2Process, pszAttrib);
 
                     // V0.9.20 (2002-07-12) [umoeller]
                     xstrPrintf(&pstat->strLinkTag,
@@ -1494,10 +1716,7 @@ PCSZ HandleA(PARTICLETREENODE pFile2Process,
                     else
                     {
                         // no INF:
-                        PARTICLETREENODE patn
-                        = GetOrCreateArticle(pszAttrib,
-                                             pFile2Process->ulHeaderLevel,
-                                             pFile2Process);
+                        AddLink(pFile2Process, pszAttrib);
 
                         // V0.9.20 (2002-07-12) [umoeller]
                         xstrPrintf(&pstat->strLinkTag,
@@ -1826,12 +2045,12 @@ const char* HandleTag(PARTICLETREENODE pFile2Process,
                 }
                 else
                 {
-                    xstrcpy(&G_strError, "", 0);
-                    xstrCatf(&G_strError,
+                    xstrcpy(&pstat->strError, "", 0);
+                    xstrCatf(&pstat->strError,
                                "Unknown tag %s (%s)",
                                pStartOfTagName,
                                pStart2);
-                    pcszError = G_strError.psz;
+                    pcszError = pstat->strError.psz;
                 }
 
                 // restore char under null terminator
@@ -1869,9 +2088,11 @@ const char* HandleTag(PARTICLETREENODE pFile2Process,
  *      --  the :hX. tag will not be added here
  *          (because it depends on sublinks).
  *
- *      This adds files to G_llFiles2Process if they
- *      are linked to from this file by calling
- *      GetOrCreateArticle.
+ *      Links to other files are recorded with AddLink
+ *      and turned into articles by ResolveLinks later.
+ *
+ *      Runs of characters that need no translation are
+ *      copied in one go.
  */
 
 APIRET ParseFile(PARTICLETREENODE pFile2Process,
@@ -1882,6 +2103,7 @@ APIRET ParseFile(PARTICLETREENODE pFile2Process,
     STATUS stat = {0};
     lstInit(&stat.llListStack, FALSE);
     xstrInit(&stat.strLinkTag, 0);       // V0.9.20 (2002-07-12) [umoeller]
+    xstrInit(&stat.strError, 0);
     stat.fJustHadSpace = TRUE;
 
     // start at beginning of buffer
@@ -1961,14 +2183,24 @@ APIRET ParseFile(PARTICLETREENODE pFile2Process,
             break;
 
             default:
+            {
+                // plain text: take everything up to the next
+                // character that needs special handling
+                ULONG cbRun = strcspn(stat.pSource, "<:.\r\n ");
+
                 if (!stat.fInHead)
                 {
                     CheckP(pxstrIPF, &stat);
-                    xstrcatc(pxstrIPF,
-                             c);
-                    (stat.ulLineLength)++;
+                    xstrcat(pxstrIPF,
+                            stat.pSource,
+                            cbRun);
+                    stat.ulLineLength += cbRun;
                     stat.fJustHadSpace = FALSE;
                 }
+
+                // the loop below skips the last char of the run
+                stat.pSource += cbRun - 1;
+            }
         }
 
         if (pcszError)
@@ -1984,7 +2216,10 @@ APIRET ParseFile(PARTICLETREENODE pFile2Process,
                   pcszError);
             *pSaved = c;
             if (stat.fFatal)
+            {
+                xstrClear(&stat.strError);
                 return (1);
+            }
             // otherwise continue
         }
 
@@ -1997,6 +2232,8 @@ APIRET ParseFile(PARTICLETREENODE pFile2Process,
     ConvertEscapes(&pFile2Process->strTitle);
     ConvertEscapes(pxstrIPF);
 
+    xstrClear(&stat.strError);
+
     return (0);
 }
 
@@ -2156,15 +2393,200 @@ VOID DumpArticlesWithParent(PXSTRING pxstrIPF,
     }
 }
 
+/*
+ *@@ WAVE:
+ *      a set of files that are converted in parallel
+ *      by ConvertWave.
+ */
+
+typedef struct _WAVE
+{
+    PARTICLETREENODE *papArticles;  // files to convert
+    ULONG       cArticles;          // array item count
+
+    ULONG       ulNext;             // next file to be taken by a thread
+    APIRET      arc;                // set if any file failed
+
+    HMTX        hmtx;               // protects ulNext and arc
+} WAVE, *PWAVE;
+
+/*
+ *@@ ConvertFile:
+ *      loads one HTML file and converts it to IPF
+ *      in the article's buffer.
+ *
+ *      This may run on any thread, so it must not
+ *      touch G_llFiles2Process or G_apArticles.
+ */
+
+APIRET ConvertFile(PARTICLETREENODE pFile2Process)
+{
+    APIRET  arc;
+    PSZ     pszContents = NULL;
+    ULONG   cbRead = 0;
+
+    if (G_ulVerbosity > 1)
+    {
+        printf("processing %s... \n",
+               (PSZ)pFile2Process->Tree.ulKey); // pszFilename);
+        fflush(stdout);
+    }
+    else if (G_ulVerbosity)
+    {
+        printf(".");
+        fflush(stdout);
+    }
+
+    if (!(arc = doshLoadTextFile((PSZ)pFile2Process->Tree.ulKey, // pszFilename,
+                                 &pszContents,
+                                 &cbRead)))
+    {
+        XSTRING strSource;
+        xstrInitSet2(&strSource, pszContents, cbRead - 1);
+        xstrConvertLineFormat(&strSource, CRLF2LF);
+
+        ResolveEntities(pFile2Process,
+                        &strSource);
+
+        // now go convert this buffer to IPF
+        arc = ParseFile(pFile2Process,
+                        strSource.psz);
+
+        xstrClear(&strSource);
+
+        pFile2Process->fProcessed = TRUE;
+    }
+    else
+    {
+        Error(2,
+              __FILE__, __LINE__, __FUNCTION__,
+              "Error %d occurred reading file \"%s\".",
+              arc,
+              (PSZ)pFile2Process->Tree.ulKey); // pszFilename);
+        arc = 1;
+    }
+
+    return arc;
+}
+
+/*
+ *@@ ConvertFiles:
+ *      takes files off the wave and converts them
+ *      until none are left or one has failed.
+ *      Runs on thread 1 and on every worker thread.
+ */
+
+VOID ConvertFiles(PWAVE pWave)
+{
+    while (TRUE)
+    {
+        PARTICLETREENODE pFile2Process = NULL;
+
+        if (pWave->hmtx)
+            DosRequestMutexSem(pWave->hmtx, SEM_INDEFINITE_WAIT);
+        if (    (!pWave->arc)
+             && (pWave->ulNext < pWave->cArticles)
+           )
+            pFile2Process = pWave->papArticles[pWave->ulNext++];
+        if (pWave->hmtx)
+            DosReleaseMutexSem(pWave->hmtx);
+
+        if (!pFile2Process)
+            break;
+
+        if (ConvertFile(pFile2Process))
+        {
+            if (pWave->hmtx)
+                DosRequestMutexSem(pWave->hmtx, SEM_INDEFINITE_WAIT);
+            pWave->arc = 1;
+            if (pWave->hmtx)
+                DosReleaseMutexSem(pWave->hmtx);
+        }
+    }
+}
+
+/*
+ *@@ fntConvert:
+ *      worker thread for ConvertWave.
+ */
+
+void _Optlink fntConvert(PTHREADINFO ptiMyself)
+{
+    PWAVE pWave = (PWAVE)ptiMyself->ulData;
+
+    TRY_LOUD(excpt1)
+    {
+        ConvertFiles(pWave);
+    }
+    CATCH(excpt1)
+    {
+        Error(2,
+              __FILE__, __LINE__, __FUNCTION__,
+              "Exception caught in conversion thread.");
+        DosRequestMutexSem(pWave->hmtx, SEM_INDEFINITE_WAIT);
+        pWave->arc = 1;
+        DosReleaseMutexSem(pWave->hmtx);
+    } END_CATCH();
+}
+
+/*
+ *@@ ConvertWave:
+ *      converts all files in the wave, on up to
+ *      G_cThreads threads including the calling one.
+ */
+
+APIRET ConvertWave(PWAVE pWave)
+{
+    THREADINFO  ati[MAXTHREADS];
+    ULONG       cThreads = G_cThreads,
+                ul;
+
+    if (cThreads > pWave->cArticles)
+        cThreads = pWave->cArticles;
+
+    if (    (cThreads > 1)
+         && (!DosCreateMutexSem(NULL, &pWave->hmtx, 0, FALSE))
+       )
+    {
+        if (!G_hmtxOutput)
+            DosCreateMutexSem(NULL, &G_hmtxOutput, 0, FALSE);
+
+        for (ul = 1;
+             ul < cThreads;
+             ul++)
+            thrCreate(&ati[ul],
+                      fntConvert,
+                      NULL,
+                      "Convert",
+                      0,
+                      (ULONG)pWave);
+
+        ConvertFiles(pWave);
+
+        for (ul = 1;
+             ul < cThreads;
+             ul++)
+            thrWait(&ati[ul]);
+
+        DosCloseMutexSem(pWave->hmtx);
+        pWave->hmtx = NULLHANDLE;
+    }
+    else
+        ConvertFiles(pWave);
+
+    return pWave->arc;
+}
+
 /*
  *@@ ProcessFiles:
  *      loops through all files.
  *
  *      When this is called (from main()), G_llFiles2Process
  *      contains only the one file that was specified on
- *      the command line. This then calls ParseFile() on
- *      that file, which will add to the list for every
- *      A tag that links to another file.
+ *      the command line. This then converts the files in
+ *      waves (see ConvertWave), and after each wave
+ *      ResolveLinks adds to the list for every A tag that
+ *      links to another file.
  *
  *      After ParseFile() has been called for each such
  *      file then, we run several additional loops here
@@ -2192,78 +2614,66 @@ APIRET ProcessFiles(PXSTRING pxstrIPF)           // out: one huge IPF file
     // go thru the list of files to process and
     // translate them from HTML to IPF...
     // when this func gets called, this list
-    // contains only the root file, but ParseFile
-    // will add new files to the list, so we just
-    // keep going
-    XSTRING strSource;
-    xstrInit(&strSource, 0);
+    // contains only the root file; every wave
+    // converts the files that are in the list
+    // so far, and ResolveLinks then appends the
+    // files they link to, which form the next wave
+    xstrcpy(&G_strCrashContext, "Converting source files", 0);
 
     pNode = lstQueryFirstNode(&G_llFiles2Process);
-    while (pNode)
+    while (pNode && !arc)
     {
-        PARTICLETREENODE pFile2Process = (PARTICLETREENODE)pNode->pItemData;
-
-        // rule out special links for now
-        if (pFile2Process->ulHeaderLevel != -1)
-        {
-            PSZ pszContents = NULL;
+        WAVE        Wave;
+        PLISTNODE   pLast = pNode;
+        ULONG       ul;
 
-            if (G_ulVerbosity > 1)
-            {
-                printf("processing %s... ",
-                       (PSZ)pFile2Process->Tree.ulKey); // pszFilename);
-                fflush(stdout);
-            }
-            else if (G_ulVerbosity)
-            {
-                printf(".");
-                fflush(stdout);
-            }
+        memset(&Wave, 0, sizeof(Wave));
 
-            xstrcpy(&G_strCrashContext, "", 0);
-            xstrCatf(&G_strCrashContext,
-                       "Processing file %s",
-                       (PSZ)pFile2Process->Tree.ulKey);
+        // count the files in this wave; the list does
+        // not change until ResolveLinks below
+        PLISTNODE pNode2;
+        for (pNode2 = pNode; pNode2; pNode2 = pNode2->pNext)
+            Wave.cArticles++;
 
-            ULONG cbRead = 0;
-            if (!(arc = doshLoadTextFile((PSZ)pFile2Process->Tree.ulKey, // pszFilename,
-                                         &pszContents,
-                                         &cbRead)))
-            {
-                xstrset2(&strSource, pszContents, cbRead - 1);
-                xstrConvertLineFormat(&strSource, CRLF2LF);
+        if (!(Wave.papArticles = (PARTICLETREENODE*)malloc(Wave.cArticles * sizeof(PARTICLETREENODE))))
+        {
+            arc = ERROR_NOT_ENOUGH_MEMORY;
+            break;
+        }
 
-                ResolveEntities(pFile2Process,
-                                &strSource);
+        Wave.cArticles = 0;
+        for (pNode2 = pNode; pNode2; pNode2 = pNode2->pNext)
+        {
+            PARTICLETREENODE pFile2Process = (PARTICLETREENODE)pNode2->pItemData;
 
-                // now go convert this buffer to IPF
-                if (!(arc = ParseFile(pFile2Process,
-                                      strSource.psz)))
-                {
-                }
+            // rule out special links for now
+            if (pFile2Process->ulHeaderLevel != -1)
+                Wave.papArticles[Wave.cArticles++] = pFile2Process;
 
-                pFile2Process->fProcessed = TRUE;
+            pLast = pNode2;
+        }
 
-                if (G_ulVerbosity > 1)
-                    printf("\n");
-            }
+        arc = ConvertWave(&Wave);
 
-            if (arc)
+        // now create the articles for the links, in
+        // list order, so that the result does not
+        // depend on which thread finished first
+        for (ul = 0;
+             ul < Wave.cArticles;
+             ul++)
+        {
+            PARTICLETREENODE pFile2Process = Wave.papArticles[ul];
+            if (pFile2Process->fProcessed)
             {
-                Error(2,
-                      __FILE__, __LINE__, __FUNCTION__,
-                      "Error %d occurred reading file \"%s\".",
-                      arc,
-                      (PSZ)pFile2Process->Tree.ulKey); // pszFilename);
-                arc = 1;
+                ResolveLinks(pFile2Process);
+                G_ulReplacements += pFile2Process->ulReplacements;
             }
         }
 
-        if (arc)
-            break;
+        free(Wave.papArticles);
 
-        // next file (ParseFile has added files to list)
-        pNode = pNode->pNext;
+        // next wave (ResolveLinks has added files to list)
+        pNode = pLast->pNext;
     }
 
     if (!arc)
@@ -2319,86 +2729,72 @@ APIRET ProcessFiles(PXSTRING pxstrIPF)           // out: one huge IPF file
         while (pNode && !arc)
         {
             PARTICLETREENODE pFile2Process = (PARTICLETREENODE)pNode->pItemData;
+            PSZ pStart;
 
             // rule out special links for now
-            if (pFile2Process->ulHeaderLevel != -1)
-            {
-                PSZ pStart;
-
-                if (pStart = pFile2Process->strIPF.psz)
+            if (    (pFile2Process->ulHeaderLevel != -1)
+                 && (pStart = pFile2Process->strIPF.psz)
                         // could be empty V0.9.16 (2001-11-22) [umoeller]
+                 && (strstr(pStart, START_KEY))
+               )
+            {
+                // copy the buffer once, putting in the resids
+                // for the special ugly link keys we hacked in
+                // before
+                XSTRING strNew;
+                PSZ     p;
+                xstrInit(&strNew, pFile2Process->strIPF.ulLength + 1);
+
+                while (p = strstr(pStart, START_KEY))
                 {
-                    PSZ p;
-                    // now, find the special ugly link keys
-                    // we hacked in before; for each string
-                    // target filename now, find the resid
-
-                    while (p = (strstr(pStart,
-                                       START_KEY)))
+                    PSZ p2 = strstr(p + ulStartKeyLen,
+                                    END_KEY);
+                    if (!p2)
                     {
-                        PSZ pFirst = pFile2Process->strIPF.psz;
+                        Error(2,
+                              __FILE__, __LINE__, __FUNCTION__,
+                              "Cannot find second LINK string for \"%s\"\nFile: \"%s\"\n",
+                              p,
+                              (PSZ)pFile2Process->Tree.ulKey); // pszFilename);
+                        arc = 1;
+                        break;
+                    }
 
-                        PSZ p2 = strstr(p + ulStartKeyLen,
-                                        END_KEY);
-                        if (!p2)
-                        {
-                            Error(2,
-                                  __FILE__, __LINE__, __FUNCTION__,
-                                  "Cannot find second LINK string for \"%s\"\nFile: \"%s\"\n",
-                                  p,
-                                  (PSZ)pFile2Process->Tree.ulKey); // pszFilename);
-                            arc = 1;
-                            break;
-                        }
+                    CHAR cSaved = *p2;
+                    *p2 = '\0';
+
+                    if (G_ulVerbosity > 2)
+                        printf("   encountered link \"%s\" at %d (len %d), searching resid\n",
+                               p + ulStartKeyLen,
+                               p - pFile2Process->strIPF.psz,
+                               p2 - pFile2Process->strIPF.psz);
 
-                        CHAR cSaved = *p2;
-                        *p2 = '\0';
+                    PARTICLETREENODE pTarget = FindArticle(p + ulStartKeyLen); // filename
 
-                        if (G_ulVerbosity > 2)
-                            printf("   encountered link \"%s\" at %d (len %d), searching resid\n",
-                                   p + ulStartKeyLen,
-                                   p - pFirst,
-                                   p2 - pFirst);
+                    if (!pTarget)
+                    {
+                        Error(2,
+                              __FILE__, __LINE__, __FUNCTION__,
+                              "Cannot resolve cross reference for \"%s\"\nFile: \"%s\"\n",
+                              p + ulStartKeyLen,
+                              (PSZ)pFile2Process->Tree.ulKey); // pszFilename);
+                        arc = 1;
+                        break;
+                    }
 
-                        PARTICLETREENODE pTarget = GetOrCreateArticle(p + ulStartKeyLen, // filename
-                                                                      -1,   // do not create
-                                                                      NULL);
+                    *p2 = cSaved;
 
-                        if (!pTarget)
-                        {
-                            Error(2,
-                                  __FILE__, __LINE__, __FUNCTION__,
-                                  "Cannot resolve cross reference for \"%s\"\nFile: \"%s\"\n",
-                                  p + ulStartKeyLen,
-                                  (PSZ)pFile2Process->Tree.ulKey); // pszFilename);
-                            arc = 1;
-                            break;
-                        }
+                    CatRun(&strNew, pStart, p - pStart);
+                    xstrCatf(&strNew, "%d", pTarget->ulResID);
 
-                        *p2 = cSaved;
-
-                        CHAR szResID[30];
-                        sprintf(szResID, "%d", pTarget->ulResID);
-                        ULONG ulResIDLen = strlen(szResID);
-                        ULONG   ulFirst = p - pFirst,
-                                cReplace = (p2 + ulStartKeyLen) - p;
-                        if (G_ulVerbosity > 2)
-                            printf("     ofs %d, cReplace %d, replacing with \"%s\"\n",
-                                   ulFirst,
-                                   cReplace,
-                                   szResID);
-                        xstrrpl(&pFile2Process->strIPF,
-                                // ofs of first char to replace:
-                                ulFirst,
-                                // count of chars to replace:
-                                cReplace, // (p2 + KEYLEN) - p,
-                                // replace this with the resid
-                                szResID,
-                                ulResIDLen);
-
-                        pStart = pFile2Process->strIPF.psz + ulFirst;
-                    }
+                    pStart = p2 + ulEndKeyLen;
                 }
+
+                // rest of the buffer
+                CatRun(&strNew, pStart, strlen(pStart));
+
+                xstrClear(&pFile2Process->strIPF);
+                pFile2Process->strIPF = strNew;
             }
 
             pNode = pNode->pNext;
@@ -2817,7 +3213,6 @@ int main(int argc, char* argv[])
 
         BOOL    fShowStatistics = FALSE;
 
-        treeInit(&G_LinkIDsTreeRoot, NULL);
         treeInit(&G_DefinesTreeRoot, NULL);
         lstInit(&G_llFiles2Process, FALSE);
 
@@ -2896,6 +3291,18 @@ int main(int argc, char* argv[])
                                 G_fNoMoveToRoot = TRUE;
                             break;
 
+                            case 't':
+                                G_cThreads = atoi(&argv[i][i2+1]);
+                                if (    (G_cThreads < 1)
+                                     || (G_cThreads > MAXTHREADS)
+                                   )
+                                {
+                                    Explain("Invalid thread count with -t option.");
+                                    rc = 999;
+                                }
+                                i2 = 999999999;
+                            break;
+
                             default:  // unknown option
                                 Explain("Unknown option '%c'.",
                                         cOption);
@@ -3029,18 +3436,19 @@ int main(int argc, char* argv[])
 
                 ULONG cbWritten = 0;
 
+                // convert to CR/LF in one allocation
                 XSTRING str2;
-                xstrInit(&str2, str.ulLength * 2 / 3);
+                xstrInit(&str2, str.ulLength + strhCount(str.psz, '\n') + 1);
 
+                PSZ pEOL;
                 p = str.psz;
-                CHAR c;
-                while (c = *p++)
+                while (pEOL = strchr(p, '\n'))
                 {
-                    if (c == '\n')
-                        xstrcatc(&str2, '\r');
-                    xstrcatc(&str2, c);
+                    CatRun(&str2, p, pEOL - p);
+                    xstrcat(&str2, "\r\n", 2);
+                    p = pEOL + 1;
                 }
-                xstrcatc(&str2, '\0');
+                CatRun(&str2, p, strlen(p));
 
                 if (rc = doshWriteTextFile(szOutputFile,
                                            str2.psz,
@@ -244,6 +244,7 @@ static void     _System Delete_DL_Partition( ADDRESS AData, BOOLEAN Kill_Partiti
 static void     _System Commit_Drive_Linking_Changes( ADDRESS VData, ADDRESS PData, CARDINAL32 * Error_Code );
 static void     _System DL_Write( ADDRESS PData, LBA Starting_Sector, CARDINAL32 Sectors_To_Write, ADDRESS Buffer, CARDINAL32 * Error_Code);
 static void     _System DL_Read( ADDRESS PData, LBA Starting_Sector, CARDINAL32 Sectors_To_Read, ADDRESS Buffer, CARDINAL32 * Error_Code);
+static void              DL_Transfer( Partition_Data * Aggregate, LBA Starting_Sector, CARDINAL32 Sector_Count, BYTE * Buffer, BOOLEAN Write, CARDINAL32 * Error_Code );
 static void     _System Remove_Features(ADDRESS Aggregate, CARDINAL32 * Error_Code);
 static void     _System ReturnCurrentClass( ADDRESS PartitionRecord, LVM_Classes * Actual_Class, BOOLEAN * Top_Of_Class, CARDINAL32 * Sequence_Number );
 static void     _System PassThru( CARDINAL32 Feature_ID, ADDRESS Aggregate, ADDRESS InputBuffer, CARDINAL32 InputSize, ADDRESS * OutputBuffer, CARDINAL32 * OutputSize, CARDINAL32 * Error_Code );
@@ -1962,11 +1963,6 @@ static void _System DL_Write( ADDRESS PData, LBA Starting_Sector, CARDINAL32 Sec
 {
 
   Partition_Data *           Aggregate = (Partition_Data *) PData;
-  Plugin_Function_Table_V1 * Old_Function_Table;
-  Drive_Link_Array *         LinkTable;
-  Partition_Data *           PartitionRecord;
-  CARDINAL32                 Sector_PSN;
-  CARDINAL32                 Index;
 
   FEATURE_FUNCTION_ENTRY("DL_Write")
 
@@ -2005,94 +2001,8 @@ static void _System DL_Write( ADDRESS PData, LBA Starting_Sector, CARDINAL32 Sec
 
   }
 
-  /* We must find out where Sector really is. */
-  LinkTable = (Drive_Link_Array *) Aggregate->Feature_Data->Data;
-
-  for (Index = 0; Index < LinkTable->Links_In_Use; Index++)
-  {
-
-    /* Get the partition for this link in the array. */
-    PartitionRecord = LinkTable->LinkArray[Index].PartitionRecord;
-    /* Does the requested sector lie in this partition? */
-    if ( Starting_Sector < PartitionRecord->Usable_Size )
-    {
-
-      /* The requested sector does lie on this partition!  Translate the requested sector to a partition sector number. */
-      Sector_PSN = Starting_Sector + PartitionRecord->Starting_Sector;
-      break;
-
-    }
-    else
-      Starting_Sector -= PartitionRecord->Usable_Size;
-
-  }
-
-  if ( Index >= LinkTable->Links_In_Use )
-  {
-
-    if ( LVM_Common_Services->Logging_Enabled )
-    {
-
-      sprintf(LVM_Common_Services->Log_Buffer,"DL_Write failed to find the partition record for the\n     partition where Sector resides!");
-
-      LVM_Common_Services->Write_Log_Buffer();
-
-    }
-
-    *Error_Code = LVM_ENGINE_INTERNAL_ERROR;
-
-    FEATURE_FUNCTION_EXIT("DL_Write")
-
-    return;
-
-  }
-
-  /* Is the feature data for the specified partition available? */
-  if ( PartitionRecord->Feature_Data == NULL )
-  {
-
-    if ( LVM_Common_Services->Logging_Enabled )
-    {
-
-      sprintf(LVM_Common_Services->Log_Buffer,"DL_Write has encountered a partition with bad feature data!");
-      LVM_Common_Services->Write_Log_Buffer();
-
-    }
-
-    *Error_Code = LVM_ENGINE_BAD_PARTITION;
-
-    FEATURE_FUNCTION_EXIT("DL_Write")
-
-    return;
-
-  }
-
-
-  /* Now call the Write function of the PartitionRecord to complete the write operation. */
-  Old_Function_Table = PartitionRecord->Feature_Data->Function_Table;
-
-  /* Is the function table for the next layer available? */
-  if ( Old_Function_Table == NULL )
-  {
-
-    if ( LVM_Common_Services->Logging_Enabled )
-    {
-
-      sprintf(LVM_Common_Services->Log_Buffer,"DL_Write has encountered a partition with bad feature data!");
-      LVM_Common_Services->Write_Log_Buffer();
-
-    }
-
-    *Error_Code = LVM_ENGINE_BAD_PARTITION;
-
-    FEATURE_FUNCTION_EXIT("DL_Write")
-
-    return;
-
-  }
-
-  /* Call the write function of the next layer. */
-  Old_Function_Table->Write(PartitionRecord, Sector_PSN, Sectors_To_Write, Buffer, Error_Code );
+  /* Pass the request on to the partitions it falls in. */
+  DL_Transfer( Aggregate, Starting_Sector, Sectors_To_Write, (BYTE *) Buffer, TRUE, Error_Code );
 
   FEATURE_FUNCTION_EXIT("DL_Write")
 
@@ -2104,11 +2014,6 @@ static void _System DL_Read( ADDRESS PData, LBA Starting_Sector, CARDINAL32 Sect
 {
 
   Partition_Data *           Aggregate = (Partition_Data *) PData;
-  Plugin_Function_Table_V1 * Old_Function_Table;
-  Drive_Link_Array *         LinkTable;
-  Partition_Data *           PartitionRecord;
-  CARDINAL32                 Sector_PSN;
-  CARDINAL32                 Index;
 
   FEATURE_FUNCTION_ENTRY("DL_Read")
 
@@ -2147,93 +2052,145 @@ static void _System DL_Read( ADDRESS PData, LBA Starting_Sector, CARDINAL32 Sect
 
   }
 
-  /* We must find out where Sector really is. */
-  LinkTable = (Drive_Link_Array *) Aggregate->Feature_Data->Data;
+  /* Pass the request on to the partitions it falls in. */
+  DL_Transfer( Aggregate, Starting_Sector, Sectors_To_Read, (BYTE *) Buffer, FALSE, Error_Code );
+
+  FEATURE_FUNCTION_EXIT("DL_Read")
+
+  return;
 
-  for (Index = 0; Index < LinkTable->Links_In_Use; Index++)
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: DL_Transfer                                      */
+/*                                                                   */
+/*   Descriptive Name: Reads or writes a run of sectors of an        */
+/*                     aggregate by splitting it into one request    */
+/*                     for each partition of the aggregate that the  */
+/*                     run falls in.                                 */
+/*                                                                   */
+/*   Input: Partition_Data * Aggregate : The aggregate to use.       */
+/*          LBA Starting_Sector : The first sector of the run,       */
+/*                                relative to the aggregate.         */
+/*          CARDINAL32 Sector_Count : The number of sectors in the   */
+/*                                    run.                           */
+/*          BYTE * Buffer : The data to write, or where to put the   */
+/*                          data read.                               */
+/*          BOOLEAN Write : TRUE to write, FALSE to read.            */
+/*          CARDINAL32 * Error_Code : The address of a variable to   */
+/*                                    hold the error return code.    */
+/*                                                                   */
+/*   Output: *Error_Code will be LVM_ENGINE_NO_ERROR if the whole    */
+/*           run was transferred.                                    */
+/*                                                                   */
+/*   Error Handling: Stops at the first partition which fails and    */
+/*                   returns its error.  If the run extends past the */
+/*                   end of the aggregate, *Error_Code will be       */
+/*                   LVM_ENGINE_INTERNAL_ERROR.                      */
+/*                                                                   */
+/*   Side Effects: Sectors may be written to disk.                   */
+/*                                                                   */
+/*   Notes:  The link table is in aggregate order, so the partition  */
+/*           holding Starting_Sector is found by subtracting the     */
+/*           size of each link ahead of it.  Each piece is then      */
+/*           handed to the layer below that partition, which is      */
+/*           given the sector relative to the start of the disk.     */
+/*                                                                   */
+/*********************************************************************/
+static void DL_Transfer( Partition_Data * Aggregate, LBA Starting_Sector, CARDINAL32 Sector_Count, BYTE * Buffer, BOOLEAN Write, CARDINAL32 * Error_Code )
+{
+
+  Plugin_Function_Table_V1 * Old_Function_Table;
+  Drive_Link_Array *         LinkTable = (Drive_Link_Array *) Aggregate->Feature_Data->Data;
+  Partition_Data *           PartitionRecord;
+  CARDINAL32                 Piece_Size;          /* The number of sectors of the run which lie in the current partition. */
+  CARDINAL32                 Index;
+
+  FEATURE_FUNCTION_ENTRY("DL_Transfer")
+
+  *Error_Code = LVM_ENGINE_NO_ERROR;
+
+  for (Index = 0; ( Index < LinkTable->Links_In_Use ) && ( Sector_Count > 0 ); Index++)
   {
 
     /* Get the partition for this link in the array. */
     PartitionRecord = LinkTable->LinkArray[Index].PartitionRecord;
-    /* Does the requested sector lie in this partition? */
-    if ( Starting_Sector < PartitionRecord->Usable_Size )
-    {
 
-      /* The requested sector does lie on this partition!  Translate the requested sector to a partition sector number. */
-      Sector_PSN = Starting_Sector + PartitionRecord->Starting_Sector;
-      break;
+    /* Does the run start in a later partition? */
+    if ( Starting_Sector >= PartitionRecord->Usable_Size )
+    {
 
-    }
-    else
       Starting_Sector -= PartitionRecord->Usable_Size;
+      continue;
 
-  }
+    }
 
-  if ( Index >= LinkTable->Links_In_Use )
-  {
+    /* How much of the run is in this partition? */
+    Piece_Size = PartitionRecord->Usable_Size - Starting_Sector;
+    if ( Piece_Size > Sector_Count )
+      Piece_Size = Sector_Count;
 
-    if ( LVM_Common_Services->Logging_Enabled )
+    /* Is the function table for the layer below this partition available? */
+    if ( ( PartitionRecord->Feature_Data == NULL ) || ( PartitionRecord->Feature_Data->Function_Table == NULL ) )
     {
 
-      sprintf(LVM_Common_Services->Log_Buffer,"DL_Read failed to find the partition record for the\n     partition where Sector resides!");
+      if ( LVM_Common_Services->Logging_Enabled )
+      {
 
-      LVM_Common_Services->Write_Log_Buffer();
+        sprintf(LVM_Common_Services->Log_Buffer,"DL_Transfer has encountered a partition with bad feature data!");
+        LVM_Common_Services->Write_Log_Buffer();
 
-    }
+      }
 
-    *Error_Code = LVM_ENGINE_INTERNAL_ERROR;
+      *Error_Code = LVM_ENGINE_BAD_PARTITION;
 
-    FEATURE_FUNCTION_EXIT("DL_Read")
+      FEATURE_FUNCTION_EXIT("DL_Transfer")
 
-    return;
+      return;
 
-  }
+    }
 
-  /* Is the feature data for the next layer available? */
-  if ( PartitionRecord->Feature_Data == NULL )
-  {
+    Old_Function_Table = PartitionRecord->Feature_Data->Function_Table;
 
-    if ( LVM_Common_Services->Logging_Enabled )
+    if ( Write )
+      Old_Function_Table->Write(PartitionRecord, Starting_Sector + PartitionRecord->Starting_Sector, Piece_Size, Buffer, Error_Code );
+    else
+      Old_Function_Table->Read(PartitionRecord, Starting_Sector + PartitionRecord->Starting_Sector, Piece_Size, Buffer, Error_Code );
+
+    if ( *Error_Code != LVM_ENGINE_NO_ERROR )
     {
 
-      sprintf(LVM_Common_Services->Log_Buffer,"DL_Read has encountered a partition with bad feature data!");
-      LVM_Common_Services->Write_Log_Buffer();
+      FEATURE_FUNCTION_EXIT("DL_Transfer")
 
-    }
-
-    *Error_Code = LVM_ENGINE_BAD_PARTITION;
+      return;
 
-    FEATURE_FUNCTION_EXIT("DL_Read")
+    }
 
-    return;
+    /* The rest of the run starts at the beginning of the next partition. */
+    Buffer += Piece_Size * BYTES_PER_SECTOR;
+    Sector_Count -= Piece_Size;
+    Starting_Sector = 0;
 
   }
 
-  /* Is the function table for the next layer on the partition available? */
-  Old_Function_Table =  PartitionRecord->Feature_Data->Function_Table;
-  if ( Old_Function_Table == NULL )
+  if ( Sector_Count > 0 )
   {
 
     if ( LVM_Common_Services->Logging_Enabled )
     {
 
-      sprintf(LVM_Common_Services->Log_Buffer,"DL_Read has encountered a partition with bad feature data!");
+      sprintf(LVM_Common_Services->Log_Buffer,"DL_Transfer failed to find the partition record for the\n     partition where Sector resides!");
       LVM_Common_Services->Write_Log_Buffer();
 
     }
 
-    *Error_Code = LVM_ENGINE_BAD_PARTITION;
-
-    FEATURE_FUNCTION_EXIT("DL_Read")
-
-    return;
+    *Error_Code = LVM_ENGINE_INTERNAL_ERROR;
 
   }
 
-  /* Now call the Read function of the PartitionRecord to complete the read operation. */
-  Old_Function_Table->Read(PartitionRecord, Sector_PSN, Sectors_To_Read, Buffer, Error_Code );
-
-  FEATURE_FUNCTION_EXIT("DL_Read")
+  FEATURE_FUNCTION_EXIT("DL_Transfer")
 
   return;
 
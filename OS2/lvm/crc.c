@@ -39,6 +39,13 @@
  * Notes: Build_CRC_Table only needs to be called once.  Once the internal
  *        CRC table has been built, there is no need to build it again.
  *
+ *        CalculateCRC uses the "slicing by 8" method: eight tables of 256
+ *        entries let it fold in 8 bytes per step instead of 1.  Table 0 is
+ *        the classic byte at a time table, and is still used for any bytes
+ *        before the first 4 byte boundary and after the last full 8 bytes.
+ *        The word loads assume a little endian CPU, as LVM.DLL only runs
+ *        on x86.
+ *
  */
 
 #define NEED_BYTE_DEFINED
@@ -50,6 +57,7 @@
  * Private Constants
  --------------------------------------------------*/
 #define CRC_POLYNOMIAL     0xEDB88320L
+#define CRC_SLICES         8             /* The number of bytes CalculateCRC processes per step. */
 
 
 /*--------------------------------------------------
@@ -60,7 +68,8 @@
 /*--------------------------------------------------
  * Private Global Variables.
  --------------------------------------------------*/
-static CARDINAL32 CRC_Table[ 256 ];                     /* Used by the CalculateCRC function. */
+static CARDINAL32 CRC_Table[ CRC_SLICES ][ 256 ];       /* Used by the CalculateCRC function.  CRC_Table[ k ][ i ] is
+                                                           the CRC of byte i followed by k zero bytes.                 */
 
 static BOOLEAN CRC_Table_Built=FALSE;  /* TRUE=table is built, FALSE=table not built yet */
 
@@ -109,8 +118,20 @@ void _System Build_CRC_Table( void )
           else
             CRC >>= 1;
       }
-      CRC_Table[ i ] = CRC;
+      CRC_Table[ 0 ][ i ] = CRC;
+    }
+
+    /* Each further table advances the entry of the one before it by one more zero byte. */
+    for ( i = 0; i <= 255 ; i++ )
+    {
+      CRC = CRC_Table[ 0 ][ i ];
+      for ( j = 1; j < CRC_SLICES; j++ )
+      {
+        CRC = ( CRC >> 8 ) ^ CRC_Table[ 0 ][ CRC & 0xff ];
+        CRC_Table[ j ][ i ] = CRC;
+      }
     }
+
     CRC_Table_Built = TRUE;
 
   FUNCTION_EXIT(__FUNCTION__);
@@ -153,7 +174,8 @@ CARDINAL32 _System CalculateCRC( CARDINAL32 CRC, ADDRESS Buffer, CARDINAL32 Buff
   BYTE   *   Current_Byte;
   CARDINAL32 Temp1;
   CARDINAL32 Temp2;
-  CARDINAL32 I;             /* Used to walk the buffer. */
+  CARDINAL32 Low_Word;      /* The first 4 bytes of an 8 byte step, merged with the CRC. */
+  CARDINAL32 High_Word;     /* The last 4 bytes of an 8 byte step. */
 
   FUNCTION_ENTRY(__FUNCTION__);
 
@@ -163,13 +185,47 @@ CARDINAL32 _System CalculateCRC( CARDINAL32 CRC, ADDRESS Buffer, CARDINAL32 Buff
   /* Make sure the CRC table is available */
   if (CRC_Table_Built==FALSE)  Build_CRC_Table();
 
-  /* Process each byte in the buffer. */
-  for ( I = 0; I < BufferSize; I++ )
+  /* Process single bytes until the buffer is aligned for word loads. */
+  while ( ( BufferSize > 0 ) && ( ( (CARDINAL32) Current_Byte & 3 ) != 0 ) )
+  {
+
+    Temp1 = (CRC >> 8) & 0x00FFFFFFL;
+    Temp2 = CRC_Table[ 0 ][ ( CRC ^ (CARDINAL32) *Current_Byte ) & (CARDINAL32) 0xff ];
+    Current_Byte++;
+    BufferSize--;
+    CRC = Temp1 ^ Temp2;
+
+  }
+
+  /* Process 8 bytes at a time. */
+  while ( BufferSize >= CRC_SLICES )
+  {
+
+    Low_Word = CRC ^ *( (CARDINAL32 *) Current_Byte );
+    High_Word = *( (CARDINAL32 *) ( Current_Byte + 4 ) );
+
+    CRC = CRC_Table[ 7 ][ Low_Word & 0xff ] ^
+          CRC_Table[ 6 ][ ( Low_Word >> 8 ) & 0xff ] ^
+          CRC_Table[ 5 ][ ( Low_Word >> 16 ) & 0xff ] ^
+          CRC_Table[ 4 ][ Low_Word >> 24 ] ^
+          CRC_Table[ 3 ][ High_Word & 0xff ] ^
+          CRC_Table[ 2 ][ ( High_Word >> 8 ) & 0xff ] ^
+          CRC_Table[ 1 ][ ( High_Word >> 16 ) & 0xff ] ^
+          CRC_Table[ 0 ][ High_Word >> 24 ];
+
+    Current_Byte += CRC_SLICES;
+    BufferSize -= CRC_SLICES;
+
+  }
+
+  /* Process whatever is left a byte at a time. */
+  while ( BufferSize > 0 )
   {
 
     Temp1 = (CRC >> 8) & 0x00FFFFFFL;
-    Temp2 = CRC_Table[ ( CRC ^ (CARDINAL32) *Current_Byte ) & (CARDINAL32) 0xff ];
+    Temp2 = CRC_Table[ 0 ][ ( CRC ^ (CARDINAL32) *Current_Byte ) & (CARDINAL32) 0xff ];
     Current_Byte++;
+    BufferSize--;
     CRC = Temp1 ^ Temp2;
 
   }
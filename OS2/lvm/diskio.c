@@ -31,11 +31,17 @@
  *            void       GetDriveGeometry
  *            void       ReadSectors
  *            void       WriteSectors
+ *            void       Prefetch_Partition_Tables
+ *            void       Discard_Prefetched_Sectors
+ *            void       Flush_Sector_Cache
+ *            void       Get_IO_Counts
  *
  * Description: This module provides an LBA based means of reading and writing
  *              to the various disk drives in the system.
  *
- * Notes: This module is single threaded and is not reentrant.
+ * Notes: This module is single threaded and is not reentrant.  The only
+ *        exception is Prefetch_Partition_Tables, which reads each drive on
+ *        a thread of its own and waits for all of them before returning.
  *
  */
 
@@ -55,6 +61,7 @@
 #include "lvm_gbls.h"        /* BOOLEAN, CARDINAL16, CARDINAL32 */
 #include "lvm_type.h"       /* LBA */
 #include "lvm_cons.h"        /* BYTES_PER_SECTOR */
+#include "lvm_data.h"        /* Master_Boot_Record, EBR_INDICATOR, MBR_EBR_SIGNATURE */
 #include "lock.h"            /* SEMAPHORE, CreateSemaphore, Lock, Unlock, DestroySemaphore. */
 #include "lvm_intr.h"        /* Get_LVM_View */
 #include "dlist.h"           /* DLIST, CreateList, InsertItem */
@@ -81,11 +88,26 @@
 #define GENERIC_FEATURE_COMMAND    0x0F
 #define LVM_IOCTL_FUNCTION         0x69
 #define REDISCOVER_DRIVE_IOCTL     0x6A
+#define PREFETCH_MAX_SECTORS       128       /* The most sectors Prefetch_Partition_Tables will keep for a drive. */
+#define PREFETCH_STACK_SIZE        16384     /* Stack for each of the prefetch threads. */
+#define TRACK_CACHE_ENTRIES        16        /* The number of whole tracks ReadSectors keeps for each drive. */
+#define LARGE_TRANSFER_SECTORS     128       /* The most sectors moved by one multi-track IOCTL (64KB). */
 
 
 /*--------------------------------------------------
  * Private Type definitions
  --------------------------------------------------*/
+typedef struct _PrefetchedSector {
+                                   LBA          Sector;                    /* The LBA of the sector. */
+                                   BYTE         Data[BYTES_PER_SECTOR];    /* The contents of the sector. */
+                                 } PrefetchedSector;
+
+typedef struct _CachedTrack {
+                              LBA          First_Sector;               /* The LBA of the first sector of the track. */
+                              CARDINAL32   Last_Used;                  /* The TrackCacheClock value when this track was last used. */
+                              BYTE *       Data;                       /* The contents of the track, or NULL if this entry is empty. */
+                            } CachedTrack;
+
 typedef struct _DiskDriveData {
                                  CARDINAL16     Cylinders;               /* The number of cylinders on the drive. */
                                  CARDINAL16     Heads;                   /* The number of heads on the drive. */
@@ -93,6 +115,9 @@ typedef struct _DiskDriveData {
                                  CARDINAL16     DriveHandle;             /* The handle used to access this drive with Category 9 IOCTL commands. */
                                  CARDINAL32     TrackLayoutSize;         /* The size, in bytes, of the TrackLayoutTable pointed to by TrackLayout. */
                                  TRACKLAYOUT *  TrackLayout;             /* The track layout table for this drive for use with the Category 9 IOCTL commands. */
+                                 CARDINAL32     LargeLayoutSize;         /* The size, in bytes, of the track layout table pointed to by LargeLayout. */
+                                 TRACKLAYOUT *  LargeLayout;             /* A track layout table with LARGE_TRANSFER_SECTORS entries, for requests spanning tracks. */
+                                 BOOLEAN        Large_Transfers;         /* TRUE until the driver fails a request made with LargeLayout. */
                                  BOOLEAN        Initialized;             /* If TRUE, then this structure has been initialized. */
                                  BOOLEAN        Is_PRM;                  /* If TRUE, then the drive represented by this structure is a removable media device. */
                                  BOOLEAN        Cylinder_Limit_Applies;  /* Set to TRUE if the 1024 cylinder limit applies to this drive. */
@@ -102,6 +127,13 @@ typedef struct _DiskDriveData {
                                                                             Unfortunately, it is now too late to make all of the required changes to the
                                                                             FT code, so LVM.DLL must provide a band-aid to keep FT working.  LVM.DLL will
                                                                             now do its own locking on the I/O paths.                                              */
+                                 PrefetchedSector * Prefetch;            /* Sectors read by Prefetch_Partition_Tables, or NULL. */
+                                 CARDINAL32     PrefetchCount;           /* The number of entries in use in Prefetch. */
+                                 CachedTrack    TrackCache[TRACK_CACHE_ENTRIES];  /* Whole tracks read by ReadSectors, least recently used replaced first. */
+                                 CARDINAL32     TrackCacheClock;         /* Incremented on each use of the TrackCache. */
+                                 CARDINAL32     IOCTL_Count;             /* The number of read and write IOCTLs issued to the drive. */
+                                 CARDINAL32     Sectors_Read;            /* The number of sectors those IOCTLs asked to read. */
+                                 CARDINAL32     Sectors_Written;         /* The number of sectors those IOCTLs asked to write. */
                               } DiskDriveData;
 
 typedef struct _DDI_OS2LVMVIEW_data
@@ -155,12 +187,27 @@ static void Do_IO ( CARDINAL32   Drive_Number,
                     CARDINAL32   SectorCount,
                     ADDRESS      Buffer,
                     BOOLEAN      Write,
-                    CARDINAL32 * Error);
+                    CARDINAL32 * Error,
+                    int *        Last_IOCTL,
+                    int *        Last_Error);
+
+static void _System Prefetch_Thread( ULONG Drive_Index );
+static Master_Boot_Record * Prefetch_Sector( CARDINAL32 Drive_Index, LBA Sector );
+static void Drop_Prefetched_Sectors( CARDINAL32 Drive_Index );
+static void Cached_Read( CARDINAL32 Drive_Index, LBA Starting_Sector, CARDINAL32 SectorCount, ADDRESS Buffer,
+                         CARDINAL32 * Error, int * Last_IOCTL, int * Last_Error );
+static void Drop_Cached_Tracks( CARDINAL32 Drive_Index, LBA Starting_Sector, CARDINAL32 SectorCount );
+static BOOLEAN Cached_Copy_Matches( CARDINAL32 Drive_Index, LBA Starting_Sector, CARDINAL32 SectorCount, ADDRESS Buffer );
+static void Update_Cached_Tracks( CARDINAL32 Drive_Index, LBA Starting_Sector, CARDINAL32 SectorCount, ADDRESS Buffer );
+static void Do_Large_IO( CARDINAL32 DriveIndex, CARDINAL32 FunctionNumber, LBA * Starting_Sector, CARDINAL32 * SectorCount,
+                         ADDRESS * Buffer, int * Last_IOCTL );
 
 
 /*--------------------------------------------------
- There are no public global variables.
+ Public global variables.
 --------------------------------------------------*/
+int LastErrorIOCTL = 0;     /* The last return code from DosDevIOCtl, as seen by ReadSectors and WriteSectors. */
+int LastError      = 0;     /* The last error returned by ReadSectors or WriteSectors. */
 
 
 
@@ -568,6 +615,24 @@ BOOLEAN OpenDrives( CARDINAL32 * Error )
     /* Mark this DiskDriveData structure as being uninitialized. */
     DriveTable[I].Initialized = FALSE;
 
+    /* Nothing has been prefetched for this drive. */
+    DriveTable[I].Prefetch = NULL;
+    DriveTable[I].PrefetchCount = 0;
+
+    /* The track cache starts out empty. */
+    memset( DriveTable[I].TrackCache, 0, sizeof(DriveTable[I].TrackCache) );
+    DriveTable[I].TrackCacheClock = 0;
+
+    /* Nothing has been read from or written to this drive yet. */
+    DriveTable[I].IOCTL_Count = 0;
+    DriveTable[I].Sectors_Read = 0;
+    DriveTable[I].Sectors_Written = 0;
+
+    /* There is no multi-track layout table yet. */
+    DriveTable[I].LargeLayout = NULL;
+    DriveTable[I].LargeLayoutSize = 0;
+    DriveTable[I].Large_Transfers = FALSE;
+
 
     /* To initialize this entry in the DriveTable, we must get a handle for this drive and get its geometry. */
 
@@ -766,6 +831,28 @@ BOOLEAN OpenDrives( CARDINAL32 * Error )
 
           }
 
+          /* Allocate a second track layout table long enough for multi-track transfers.  If we can't get the memory, every
+             request will just be split at track boundaries.                                                                  */
+          DriveTable[I].LargeLayoutSize = sizeof(TRACKLAYOUT) + ( ( LARGE_TRANSFER_SECTORS - 1 ) * ( sizeof( USHORT ) * 2 ) );
+          DriveTable[I].LargeLayout = (TRACKLAYOUT *) malloc( DriveTable[I].LargeLayoutSize );
+
+          if ( DriveTable[I].LargeLayout != NULL )
+          {
+
+            DriveTable[I].LargeLayout->bCommand = 1;
+
+            for ( J = 0; J < LARGE_TRANSFER_SECTORS; J++ )
+            {
+
+               DriveTable[I].LargeLayout->TrackTable[J].usSectorNumber = J + 1;
+               DriveTable[I].LargeLayout->TrackTable[J].usSectorSize = BYTES_PER_SECTOR;
+
+            }
+
+            DriveTable[I].Large_Transfers = TRUE;
+
+          }
+
           /* Now that we have completed initializing the record for this drive, mark it as being initialized. */
           DriveTable[I].Initialized = TRUE;
 
@@ -841,14 +928,24 @@ void CloseDrives( void )
     /* Close the drive handle. */
     ReturnCode = DosPhysicalDisk(3L,NULL,0,&(DriveTable[I].DriveHandle),sizeof(DriveTable[I].DriveHandle) );
 
-    /* Free the track layout table. */
+    /* Free the track layout tables. */
     free( DriveTable[I].TrackLayout );
 
+    if ( DriveTable[I].LargeLayout != NULL )
+      free( DriveTable[I].LargeLayout );
+
+    /* Free any sectors left over from Prefetch_Partition_Tables. */
+    Drop_Prefetched_Sectors( I );
+
+    /* Free the track cache. */
+    Drop_Cached_Tracks( I, 0, 0xFFFFFFFF );
+
     /* Release the semaphore for this drive. */
     DestroySemaphore(DriveTable[I].Drive_Lock);
 
     /* Clear out the fields in this drive table entry. */
     DriveTable[I].TrackLayout = NULL;
+    DriveTable[I].LargeLayout = NULL;
     DriveTable[I].Initialized = FALSE;
     DriveTable[I].DriveHandle = 0;
 
@@ -1330,8 +1427,48 @@ void ReadSectors ( CARDINAL32   Drive_Number,
                    CARDINAL32 * Error)
 {
 
+  PrefetchedSector *  Prefetched;      /* Used to walk the sectors read by Prefetch_Partition_Tables. */
+  CARDINAL32          Index;           /* Used to walk the sectors read by Prefetch_Partition_Tables. */
+
+  /* Was this sector read ahead by Prefetch_Partition_Tables?  If so, return it as if it had just been read. */
+  if ( ( Sectors_To_Read == 1 ) && ( DriveTable != NULL ) && ( Drive_Number > 0 ) && ( Drive_Number <= DriveCount ) &&
+       ( DriveTable[Drive_Number - 1].Prefetch != NULL ) )
+  {
+
+    Prefetched = DriveTable[Drive_Number - 1].Prefetch;
+
+    for ( Index = 0; Index < DriveTable[Drive_Number - 1].PrefetchCount; Index++ )
+    {
+
+      if ( Prefetched[Index].Sector == Starting_Sector )
+      {
+
+        memcpy( Buffer, Prefetched[Index].Data, BYTES_PER_SECTOR );
+
+        LastErrorIOCTL = NO_ERROR;
+        LastError = DISKIO_NO_ERROR;
+        *Error = DISKIO_NO_ERROR;
+
+        return;
+
+      }
+
+    }
+
+  }
+
+  /* Reads which fit within a single track are served from, or added to, the track cache. */
+  if ( ( DriveTable != NULL ) && ( Drive_Number > 0 ) && ( Drive_Number <= DriveCount ) )
+  {
+
+    Cached_Read( Drive_Number - 1, Starting_Sector, Sectors_To_Read, Buffer, Error, &LastErrorIOCTL, &LastError );
+
+    return;
+
+  }
+
   /* Do_IO is our common routine for reading or writing.  Call it here and indicate that we want to Read, not write. */
-  Do_IO( Drive_Number, Starting_Sector, Sectors_To_Read, Buffer, FALSE, Error);
+  Do_IO( Drive_Number, Starting_Sector, Sectors_To_Read, Buffer, FALSE, Error, &LastErrorIOCTL, &LastError);
 
   return;
 
@@ -1379,17 +1516,268 @@ void WriteSectors ( CARDINAL32   Drive_Number,
                     CARDINAL32 * Error)
 {
 
+  BOOLEAN   Cached = ( DriveTable != NULL ) && ( Drive_Number > 0 ) && ( Drive_Number <= DriveCount );  /* TRUE if the drive has a cache. */
+
+  if ( Cached )
+  {
+
+    /* Is the disk already holding exactly this data?  If so, there is nothing to write. */
+    if ( Cached_Copy_Matches( Drive_Number - 1, Starting_Sector, Sectors_To_Write, Buffer ) )
+    {
+
+      LastErrorIOCTL = NO_ERROR;
+      LastError = DISKIO_NO_ERROR;
+      *Error = DISKIO_NO_ERROR;
+
+      return;
+
+    }
+
+    /* Anything read ahead from this drive may no longer match what is on the disk. */
+    Drop_Prefetched_Sectors( Drive_Number - 1 );
+
+  }
+
   /* Do_IO is our common routine for reading or writing.  Call it here and indicate that we want to Write, not read. */
-  Do_IO( Drive_Number, Starting_Sector, Sectors_To_Write, Buffer, TRUE, Error);
+  Do_IO( Drive_Number, Starting_Sector, Sectors_To_Write, Buffer, TRUE, Error, &LastErrorIOCTL, &LastError);
+
+  /* Bring the cached tracks up to date with the disk.  If the write failed, we no longer know what is on the disk. */
+  if ( Cached )
+  {
+
+    if ( *Error == DISKIO_NO_ERROR )
+      Update_Cached_Tracks( Drive_Number - 1, Starting_Sector, Sectors_To_Write, Buffer );
+    else
+      Drop_Cached_Tracks( Drive_Number - 1, Starting_Sector, Sectors_To_Write );
+
+  }
+
+  return;
+
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Prefetch_Partition_Tables                        */
+/*                                                                   */
+/*   Descriptive Name: This function reads the MBR/EBR chain of every*/
+/*                     drive, along with the DLA Table of each MBR/  */
+/*                     EBR and the last sector of each partition,    */
+/*                     with one thread per drive.  The sectors read  */
+/*                     are kept so that ReadSectors can return them  */
+/*                     without going to the disk again.              */
+/*                                                                   */
+/*   Input: None.                                                    */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: Sectors which can not be read are not kept, so  */
+/*                   ReadSectors will read them (and report the      */
+/*                   error) as it would have without the prefetch.   */
+/*                                                                   */
+/*   Side Effects: Memory is allocated for the sectors read.         */
+/*                                                                   */
+/*   Notes:  The threads only issue IOCTLs through Do_IO and each one*/
+/*           uses only its own entry in the DriveTable, so no        */
+/*           locking is needed between them.  All memory is          */
+/*           allocated here before they start.                       */
+/*                                                                   */
+/*********************************************************************/
+void Prefetch_Partition_Tables( void )
+{
+
+  TID *       Threads;                 /* The prefetch thread for each drive, or 0 if there is none. */
+  CARDINAL32  I;                       /* Used to traverse the DriveTable. */
+
+  if ( ( DriveTable == NULL ) || ( DriveCount == 0 ) )
+    return;
+
+  Threads = (TID *) malloc( DriveCount * sizeof(TID) );
+
+  /* Without the memory, discovery will just read each drive itself. */
+  if ( Threads == NULL )
+    return;
+
+  /* Start a thread for each drive. */
+  for ( I = 0; I < DriveCount; I++ )
+  {
+
+    Threads[I] = 0;
+
+    if ( ! DriveTable[I].Initialized )
+      continue;
+
+    /* Start from scratch in case an earlier prefetch was never discarded. */
+    Drop_Prefetched_Sectors( I );
+
+    DriveTable[I].Prefetch = (PrefetchedSector *) malloc( PREFETCH_MAX_SECTORS * sizeof(PrefetchedSector) );
+    if ( DriveTable[I].Prefetch == NULL )
+      continue;
+
+    if ( DosCreateThread( &(Threads[I]), Prefetch_Thread, I, CREATE_READY | STACK_SPARSE, PREFETCH_STACK_SIZE ) != NO_ERROR )
+      Threads[I] = 0;
+
+  }
+
+  /* Now wait for all of them to finish. */
+  for ( I = 0; I < DriveCount; I++ )
+  {
+
+    if ( Threads[I] != 0 )
+      DosWaitThread( &(Threads[I]), DCWW_WAIT );
+
+  }
+
+  free( Threads );
+
+  return;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Discard_Prefetched_Sectors                       */
+/*                                                                   */
+/*   Descriptive Name: This function frees the sectors kept by       */
+/*                     Prefetch_Partition_Tables.                    */
+/*                                                                   */
+/*   Input: None.                                                    */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: Later reads go to the disk.                       */
+/*                                                                   */
+/*   Notes:  None.                                                   */
+/*                                                                   */
+/*********************************************************************/
+void Discard_Prefetched_Sectors( void )
+{
+
+  CARDINAL32  I;                       /* Used to traverse the DriveTable. */
+
+  if ( DriveTable == NULL )
+    return;
+
+  for ( I = 0; I < DriveCount; I++ )
+    Drop_Prefetched_Sectors( I );
 
   return;
 
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Flush_Sector_Cache                               */
+/*                                                                   */
+/*   Descriptive Name: This function empties the track cache and     */
+/*                     frees any prefetched sectors for all drives.  */
+/*                                                                   */
+/*   Input: None.                                                    */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: The next read of each track goes to the disk.     */
+/*                                                                   */
+/*   Notes:  None.                                                   */
+/*                                                                   */
+/*********************************************************************/
+void Flush_Sector_Cache( void )
+{
+
+  CARDINAL32  I;                       /* Used to traverse the DriveTable. */
+
+  if ( DriveTable == NULL )
+    return;
+
+  for ( I = 0; I < DriveCount; I++ )
+  {
+
+    Drop_Prefetched_Sectors( I );
+
+    Drop_Cached_Tracks( I, 0, 0xFFFFFFFF );
+
+  }
+
+  return;
 
 }
 
 
-int LastErrorIOCTL = 0;
-int LastError      = 0;
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Get_IO_Counts                                    */
+/*                                                                   */
+/*   Descriptive Name: Returns the number of IOCTLs issued to read   */
+/*                     or write a drive, and the number of sectors   */
+/*                     read and written, since OpenDrives.           */
+/*                                                                   */
+/*   Input: CARDINAL32 Drive_Number : The number of the drive, 1 for */
+/*                                    the first drive.               */
+/*          CARDINAL32 * IOCTL_Count : Set to the number of read and */
+/*                                     write IOCTLs issued.          */
+/*          CARDINAL32 * Sectors_Read : Set to the number of sectors */
+/*                                      those IOCTLs asked to read.  */
+/*          CARDINAL32 * Sectors_Written : Set to the number of      */
+/*                                         sectors those IOCTLs      */
+/*                                         asked to write.           */
+/*          CARDINAL32 * Error : The address of a variable to hold   */
+/*                               the error return code.              */
+/*                                                                   */
+/*   Output: *Error will be 0 and the counts filled in if            */
+/*           successful.                                             */
+/*                                                                   */
+/*   Error Handling: *Error will be > 0 if the drives are not open   */
+/*                   or Drive_Number is not a valid drive.           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  Reads answered from the track cache or from             */
+/*           Prefetch_Partition_Tables are not counted, as they do   */
+/*           not reach the drive.                                    */
+/*                                                                   */
+/*********************************************************************/
+void Get_IO_Counts( CARDINAL32   Drive_Number,
+                    CARDINAL32 * IOCTL_Count,
+                    CARDINAL32 * Sectors_Read,
+                    CARDINAL32 * Sectors_Written,
+                    CARDINAL32 * Error )
+{
+
+  /* If DriveTable is NULL, then we have not been initialized yet by a call to OpenDrives, or CloseDrives has been called. */
+  if ( DriveTable == NULL )
+  {
+
+    *Error = DISKIO_DRIVES_NOT_OPEN;
+    return;
+
+  }
+
+  /* Is the Drive_Number requested valid? */
+  if ( ( Drive_Number == 0 ) || ( Drive_Number > DriveCount ) )
+  {
+
+    *Error = DISKIO_REQUEST_OUT_OF_RANGE;
+    return;
+
+  }
+
+  *IOCTL_Count = DriveTable[Drive_Number - 1].IOCTL_Count;
+  *Sectors_Read = DriveTable[Drive_Number - 1].Sectors_Read;
+  *Sectors_Written = DriveTable[Drive_Number - 1].Sectors_Written;
+
+  *Error = DISKIO_NO_ERROR;
+
+  return;
+
+}
 
 /*--------------------------------------------------
  * Private Functions Available
@@ -1421,6 +1809,9 @@ int LastError      = 0;
 /*                          FALSE, then Do_IO will perform a read.   */
 /*          CARDINAL32 * Error : The address of a variable to hold   */
 /*                               the error return code.              */
+/*          int * Last_IOCTL : Where to record the last return code  */
+/*                             from DosDevIOCtl.                     */
+/*          int * Last_Error : Where to record *Error on return.     */
 /*                                                                   */
 /*   Output: If Successful, *Error will be 0.                        */
 /*           If Unsuccessful, then *Error will be > 0.               */
@@ -1438,7 +1829,9 @@ static void Do_IO ( CARDINAL32   Drive_Number,
                     CARDINAL32   SectorCount,
                     ADDRESS      Buffer,
                     BOOLEAN      Write,
-                    CARDINAL32 * Error)
+                    CARDINAL32 * Error,
+                    int *        Last_IOCTL,
+                    int *        Last_Error)
 {
 
   APIRET         ReturnCode;                     /* Used to hold the return code from OS/2 API calls. */
@@ -1524,6 +1917,25 @@ static void Do_IO ( CARDINAL32   Drive_Number,
   /* Convert Drive_Number into an index into the DriveTable. */
   DriveIndex = Drive_Number - 1;
 
+  /* If the request crosses a track boundary, try to move it in a few large transfers rather than a track at a time.
+     Whatever Do_Large_IO could not do is left in Starting_Sector, SectorCount and Buffer for the track by track loop. */
+  if ( DriveTable[DriveIndex].Large_Transfers &&
+       ( ( Starting_Sector % (CARDINAL32) DriveTable[DriveIndex].SectorsPerTrack ) + SectorCount > (CARDINAL32) DriveTable[DriveIndex].SectorsPerTrack ) )
+  {
+
+    Do_Large_IO( DriveIndex, FunctionNumber, &Starting_Sector, &SectorCount, &Buffer, Last_IOCTL );
+
+    if ( SectorCount == 0 )
+    {
+
+      *Error = DISKIO_NO_ERROR;
+      *Last_Error = *Error;
+      return;
+
+    }
+
+  }
+
   /* CHS addresses can be a little strange.  The cylinder and head parts of a CHS address are 0 based, while the sector
      part of a CHS address is 1 based.  Thus, for a drive with 619 cylinders, 128 heads, and 63 sectors per track, the
      cylinder portion of a CHS address can range from 0 to 618, the head portion can range from 0 to 127, and the
@@ -1626,7 +2038,14 @@ if(Drive_Number == 2)
                               CurrentBufferLocation,
                               DataSize,
                               &DataSize);
-   LastErrorIOCTL = ReturnCode; //EK
+   *Last_IOCTL = ReturnCode; //EK
+
+    /* Count the I/O for Get_IO_Counts. */
+    DriveTable[DriveIndex].IOCTL_Count++;
+    if ( Write )
+      DriveTable[DriveIndex].Sectors_Written += SectorsToReadOrWrite;
+    else
+      DriveTable[DriveIndex].Sectors_Read += SectorsToReadOrWrite;
 //DEBUG EK  
 #if 0
 if(Drive_Number == 2)   
@@ -1745,7 +2164,7 @@ if(Drive_Number == 2 && ( ReturnCode == NO_ERROR ))
 //if(Drive_Number == 2)
 //  fclose(fp);
 
-  LastError = *Error;
+  *Last_Error = *Error;
 
   /* Return to caller. */
   return;
@@ -1823,6 +2242,9 @@ void Issue_Ring0_Feature_Command( CARDINAL32   Feature_ID,
                             Data_Size,
                             &Data_Size);
 
+  /* The feature may have changed what is on the disk, so nothing cached can be trusted any longer. */
+  Flush_Sector_Cache();
+
 
   /* Was the IOCTL was successful? */
   if ( Return_Code == NO_ERROR )
@@ -1844,3 +2266,674 @@ void Issue_Ring0_Feature_Command( CARDINAL32   Feature_ID,
 }
 
 
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Prefetch_Thread                                  */
+/*                                                                   */
+/*   Descriptive Name: Follows the MBR/EBR chain of one drive,       */
+/*                     reading each MBR/EBR, its DLA Table, and the  */
+/*                     last sector of each partition it describes,   */
+/*                     which is where an LVM Signature Sector lives. */
+/*                                                                   */
+/*   Input: ULONG Drive_Index : The index of the drive in the        */
+/*                              DriveTable.                          */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: Stops at the first MBR/EBR which can not be     */
+/*                   read or has no signature.  Discover_Partitions  */
+/*                   reads the rest itself and decides what is wrong.*/
+/*                                                                   */
+/*   Side Effects: Fills in the Prefetch entries for the drive.      */
+/*                                                                   */
+/*   Notes:  The offsets are interpreted the way Discover_Partitions */
+/*           interprets them.  If they disagree on anything, the only*/
+/*           cost is that Discover_Partitions reads from disk.       */
+/*                                                                   */
+/*********************************************************************/
+static void _System Prefetch_Thread( ULONG Drive_Index )
+{
+
+  Master_Boot_Record * Table;                  /* The MBR/EBR being processed. */
+  Partition_Record *   Entry;                  /* Used to walk the partition table of the MBR/EBR. */
+  LBA                  MBR_EBR_LBA = 0;        /* The LBA of the MBR/EBR being processed. */
+  LBA                  Extended_Partition_LBA = 0;  /* The LBA of the start of the extended partition, once found. */
+  LBA                  Next_EBR_LBA;           /* The LBA of the next EBR in the chain, or 0. */
+  CARDINAL32           Index;                  /* Used to walk the partition table of the MBR/EBR. */
+
+  for (;;)
+  {
+
+    Table = Prefetch_Sector( Drive_Index, MBR_EBR_LBA );
+
+    if ( ( Table == NULL ) || ( Table->Signature != MBR_EBR_SIGNATURE ) )
+      break;
+
+    /* The DLA Table is in the last sector of the track holding the MBR/EBR. */
+    Prefetch_Sector( Drive_Index, MBR_EBR_LBA + DriveTable[Drive_Index].SectorsPerTrack - 1 );
+
+    Next_EBR_LBA = 0;
+
+    for ( Index = 0; Index < 4; Index++ )
+    {
+
+      Entry = &(Table->Partition_Table[Index]);
+
+      if ( ( Entry->Format_Indicator == 0 ) || ( Entry->Sector_Count == 0 ) )
+        continue;
+
+      if ( ( Entry->Format_Indicator == EBR_INDICATOR ) || ( Entry->Format_Indicator == WINDOZE_EBR_INDICATOR ) )
+      {
+
+        /* EBRs are relative to the start of the extended partition, which is 0 while processing the MBR. */
+        if ( Next_EBR_LBA == 0 )
+          Next_EBR_LBA = Extended_Partition_LBA + Entry->Sector_Offset;
+
+      }
+      else
+      {
+
+        /* Partitions are relative to the MBR/EBR that describes them. */
+        Prefetch_Sector( Drive_Index, MBR_EBR_LBA + Entry->Sector_Offset + Entry->Sector_Count - 1 );
+
+      }
+
+    }
+
+    /* Stop at the end of the chain, or if it loops back on itself. */
+    if ( Next_EBR_LBA <= MBR_EBR_LBA )
+      break;
+
+    if ( Extended_Partition_LBA == 0 )
+      Extended_Partition_LBA = Next_EBR_LBA;
+
+    MBR_EBR_LBA = Next_EBR_LBA;
+
+  }
+
+  return;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Prefetch_Sector                                  */
+/*                                                                   */
+/*   Descriptive Name: Reads one sector into the next free Prefetch  */
+/*                     entry of a drive.                             */
+/*                                                                   */
+/*   Input: CARDINAL32 Drive_Index : The index of the drive in the   */
+/*                                   DriveTable.                     */
+/*          LBA Sector : The sector to read.                         */
+/*                                                                   */
+/*   Output: The contents of the sector if it was read, else NULL.   */
+/*                                                                   */
+/*   Error Handling: Failed reads are not kept.                      */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  Runs on a prefetch thread, so it records the results of */
+/*           Do_IO locally rather than in LastErrorIOCTL/LastError.  */
+/*           Reading through the track cache means an MBR/EBR and its*/
+/*           DLA Table cost a single I/O.                            */
+/*                                                                   */
+/*********************************************************************/
+static Master_Boot_Record * Prefetch_Sector( CARDINAL32 Drive_Index, LBA Sector )
+{
+
+  DiskDriveData *    Drive = &(DriveTable[Drive_Index]);
+  PrefetchedSector * Slot;
+  CARDINAL32         Index;
+  CARDINAL32         Error;
+  int                Last_IOCTL;
+  int                Last_Error;
+
+  /* Already read? */
+  for ( Index = 0; Index < Drive->PrefetchCount; Index++ )
+  {
+
+    if ( Drive->Prefetch[Index].Sector == Sector )
+      return (Master_Boot_Record *) Drive->Prefetch[Index].Data;
+
+  }
+
+  if ( Drive->PrefetchCount >= PREFETCH_MAX_SECTORS )
+    return NULL;
+
+  Slot = &(Drive->Prefetch[Drive->PrefetchCount]);
+
+  Cached_Read( Drive_Index, Sector, 1, Slot->Data, &Error, &Last_IOCTL, &Last_Error );
+
+  if ( Error != DISKIO_NO_ERROR )
+    return NULL;
+
+  Slot->Sector = Sector;
+  Drive->PrefetchCount++;
+
+  return (Master_Boot_Record *) Slot->Data;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Drop_Prefetched_Sectors                          */
+/*                                                                   */
+/*   Descriptive Name: Frees the sectors prefetched for a drive.     */
+/*                                                                   */
+/*   Input: CARDINAL32 Drive_Index : The index of the drive in the   */
+/*                                   DriveTable.                     */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  None.                                                   */
+/*                                                                   */
+/*********************************************************************/
+static void Drop_Prefetched_Sectors( CARDINAL32 Drive_Index )
+{
+
+  if ( DriveTable[Drive_Index].Prefetch != NULL )
+  {
+
+    free( DriveTable[Drive_Index].Prefetch );
+
+    DriveTable[Drive_Index].Prefetch = NULL;
+
+  }
+
+  DriveTable[Drive_Index].PrefetchCount = 0;
+
+  return;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Cached_Read                                      */
+/*                                                                   */
+/*   Descriptive Name: Reads sectors through the track cache of a    */
+/*                     drive.  A read which lies within one track is */
+/*                     copied from the cache, and if the track is    */
+/*                     not there, the whole track is read and kept.  */
+/*                                                                   */
+/*   Input: CARDINAL32 Drive_Index : The index of the drive in the   */
+/*                                   DriveTable.                     */
+/*          LBA Starting_Sector : The first sector to read.          */
+/*          CARDINAL32 SectorCount : The number of sectors to read.  */
+/*          ADDRESS Buffer : Where to put the sectors read.          */
+/*          CARDINAL32 * Error : The address of a variable to hold   */
+/*                               the error return code.              */
+/*          int * Last_IOCTL : Passed to Do_IO.                      */
+/*          int * Last_Error : Passed to Do_IO.                      */
+/*                                                                   */
+/*   Output: If Successful, *Error will be 0.                        */
+/*           If Unsuccessful, then *Error will be > 0.               */
+/*                                                                   */
+/*   Error Handling: If the whole track can not be read, only the    */
+/*                   sectors asked for are read, so that any error   */
+/*                   reported is for those sectors alone.            */
+/*                                                                   */
+/*   Side Effects: The least recently used track may be replaced.    */
+/*                                                                   */
+/*   Notes:  Reads which cross a track boundary, and reads from      */
+/*           removable media, go straight to Do_IO.  The Drive_Lock  */
+/*           is not held across Do_IO, since Do_IO takes it itself.  */
+/*                                                                   */
+/*********************************************************************/
+static void Cached_Read( CARDINAL32   Drive_Index,
+                         LBA          Starting_Sector,
+                         CARDINAL32   SectorCount,
+                         ADDRESS      Buffer,
+                         CARDINAL32 * Error,
+                         int *        Last_IOCTL,
+                         int *        Last_Error )
+{
+
+  DiskDriveData *  Drive = &(DriveTable[Drive_Index]);
+  CARDINAL32       Track_Size = Drive->SectorsPerTrack;    /* The number of sectors in a track. */
+  LBA              Track_Start;                            /* The first sector of the track holding Starting_Sector. */
+  BYTE *           Track_Data;                             /* A newly read track. */
+  CachedTrack *    Entry;                                  /* Used to walk the TrackCache. */
+  CachedTrack *    Victim;                                 /* The entry a newly read track replaces. */
+  CARDINAL32       Index;                                  /* Used to walk the TrackCache. */
+
+  if ( ( Track_Size == 0 ) || ( SectorCount == 0 ) || Drive->Is_PRM )
+  {
+
+    Do_IO( Drive_Index + 1, Starting_Sector, SectorCount, Buffer, FALSE, Error, Last_IOCTL, Last_Error );
+    return;
+
+  }
+
+  Track_Start = Starting_Sector - ( Starting_Sector % Track_Size );
+
+  if ( ( Starting_Sector + SectorCount ) > ( Track_Start + Track_Size ) )
+  {
+
+    Do_IO( Drive_Index + 1, Starting_Sector, SectorCount, Buffer, FALSE, Error, Last_IOCTL, Last_Error );
+    return;
+
+  }
+
+  Lock( Drive->Drive_Lock );
+
+  for ( Index = 0; Index < TRACK_CACHE_ENTRIES; Index++ )
+  {
+
+    Entry = &(Drive->TrackCache[Index]);
+
+    if ( ( Entry->Data != NULL ) && ( Entry->First_Sector == Track_Start ) )
+    {
+
+      memcpy( Buffer, Entry->Data + ( Starting_Sector - Track_Start ) * BYTES_PER_SECTOR, SectorCount * BYTES_PER_SECTOR );
+
+      Drive->TrackCacheClock++;
+      Entry->Last_Used = Drive->TrackCacheClock;
+
+      Unlock( Drive->Drive_Lock );
+
+      *Last_IOCTL = NO_ERROR;
+      *Last_Error = DISKIO_NO_ERROR;
+      *Error = DISKIO_NO_ERROR;
+
+      return;
+
+    }
+
+  }
+
+  Unlock( Drive->Drive_Lock );
+
+  /* Not in the cache.  Read the whole track, which costs the same single IOCTL as reading part of it. */
+  Track_Data = (BYTE *) malloc( Track_Size * BYTES_PER_SECTOR );
+
+  if ( Track_Data != NULL )
+  {
+
+    Do_IO( Drive_Index + 1, Track_Start, Track_Size, Track_Data, FALSE, Error, Last_IOCTL, Last_Error );
+
+    if ( *Error != DISKIO_NO_ERROR )
+    {
+
+      free( Track_Data );
+      Track_Data = NULL;
+
+    }
+
+  }
+
+  if ( Track_Data == NULL )
+  {
+
+    Do_IO( Drive_Index + 1, Starting_Sector, SectorCount, Buffer, FALSE, Error, Last_IOCTL, Last_Error );
+    return;
+
+  }
+
+  memcpy( Buffer, Track_Data + ( Starting_Sector - Track_Start ) * BYTES_PER_SECTOR, SectorCount * BYTES_PER_SECTOR );
+
+  /* Keep the track, replacing an empty entry or else the least recently used one. */
+  Lock( Drive->Drive_Lock );
+
+  Victim = &(Drive->TrackCache[0]);
+
+  for ( Index = 0; Index < TRACK_CACHE_ENTRIES; Index++ )
+  {
+
+    Entry = &(Drive->TrackCache[Index]);
+
+    if ( Entry->Data == NULL )
+    {
+
+      Victim = Entry;
+      break;
+
+    }
+
+    if ( Entry->Last_Used < Victim->Last_Used )
+      Victim = Entry;
+
+  }
+
+  if ( Victim->Data != NULL )
+    free( Victim->Data );
+
+  Drive->TrackCacheClock++;
+
+  Victim->First_Sector = Track_Start;
+  Victim->Last_Used = Drive->TrackCacheClock;
+  Victim->Data = Track_Data;
+
+  Unlock( Drive->Drive_Lock );
+
+  return;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Drop_Cached_Tracks                               */
+/*                                                                   */
+/*   Descriptive Name: Removes the tracks holding any of a range of  */
+/*                     sectors from the track cache of a drive.      */
+/*                                                                   */
+/*   Input: CARDINAL32 Drive_Index : The index of the drive in the   */
+/*                                   DriveTable.                     */
+/*          LBA Starting_Sector : The first sector of the range.     */
+/*          CARDINAL32 SectorCount : The number of sectors in the    */
+/*                                   range.  0xFFFFFFFF with a       */
+/*                                   Starting_Sector of 0 empties    */
+/*                                   the whole cache.                */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  None.                                                   */
+/*                                                                   */
+/*********************************************************************/
+static void Drop_Cached_Tracks( CARDINAL32 Drive_Index, LBA Starting_Sector, CARDINAL32 SectorCount )
+{
+
+  DiskDriveData *  Drive = &(DriveTable[Drive_Index]);
+  CachedTrack *    Entry;                                  /* Used to walk the TrackCache. */
+  CARDINAL32       Index;                                  /* Used to walk the TrackCache. */
+  LBA              Last_Sector;                            /* The last sector of the range. */
+
+  if ( SectorCount == 0 )
+    return;
+
+  Last_Sector = Starting_Sector + ( SectorCount - 1 );
+
+  /* Guard against the range wrapping past the end of the LBA space. */
+  if ( Last_Sector < Starting_Sector )
+    Last_Sector = 0xFFFFFFFF;
+
+  Lock( Drive->Drive_Lock );
+
+  for ( Index = 0; Index < TRACK_CACHE_ENTRIES; Index++ )
+  {
+
+    Entry = &(Drive->TrackCache[Index]);
+
+    if ( Entry->Data == NULL )
+      continue;
+
+    if ( ( Entry->First_Sector <= Last_Sector ) &&
+         ( ( Entry->First_Sector + Drive->SectorsPerTrack - 1 ) >= Starting_Sector ) )
+    {
+
+      free( Entry->Data );
+
+      Entry->Data = NULL;
+      Entry->Last_Used = 0;
+
+    }
+
+  }
+
+  Unlock( Drive->Drive_Lock );
+
+  return;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Cached_Copy_Matches                              */
+/*                                                                   */
+/*   Descriptive Name: Checks whether a range of sectors is in the   */
+/*                     track cache of a drive and holds the same data*/
+/*                     as a buffer.                                  */
+/*                                                                   */
+/*   Input: CARDINAL32 Drive_Index : The index of the drive in the   */
+/*                                   DriveTable.                     */
+/*          LBA Starting_Sector : The first sector of the range.     */
+/*          CARDINAL32 SectorCount : The number of sectors in the    */
+/*                                   range.                          */
+/*          ADDRESS Buffer : The data to compare against.            */
+/*                                                                   */
+/*   Output: TRUE if the whole range lies in one cached track and    */
+/*           matches Buffer, FALSE otherwise.                        */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  None.                                                   */
+/*                                                                   */
+/*********************************************************************/
+static BOOLEAN Cached_Copy_Matches( CARDINAL32 Drive_Index, LBA Starting_Sector, CARDINAL32 SectorCount, ADDRESS Buffer )
+{
+
+  DiskDriveData *  Drive = &(DriveTable[Drive_Index]);
+  CARDINAL32       Track_Size = Drive->SectorsPerTrack;    /* The number of sectors in a track. */
+  LBA              Track_Start;                            /* The first sector of the track holding Starting_Sector. */
+  CachedTrack *    Entry;                                  /* Used to walk the TrackCache. */
+  CARDINAL32       Index;                                  /* Used to walk the TrackCache. */
+  BOOLEAN          Matches = FALSE;
+
+  if ( ( Track_Size == 0 ) || ( SectorCount == 0 ) )
+    return FALSE;
+
+  Track_Start = Starting_Sector - ( Starting_Sector % Track_Size );
+
+  if ( ( Starting_Sector + SectorCount ) > ( Track_Start + Track_Size ) )
+    return FALSE;
+
+  Lock( Drive->Drive_Lock );
+
+  for ( Index = 0; Index < TRACK_CACHE_ENTRIES; Index++ )
+  {
+
+    Entry = &(Drive->TrackCache[Index]);
+
+    if ( ( Entry->Data != NULL ) && ( Entry->First_Sector == Track_Start ) )
+    {
+
+      Matches = ( memcmp( Buffer, Entry->Data + ( Starting_Sector - Track_Start ) * BYTES_PER_SECTOR, SectorCount * BYTES_PER_SECTOR ) == 0 );
+      break;
+
+    }
+
+  }
+
+  Unlock( Drive->Drive_Lock );
+
+  return Matches;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Update_Cached_Tracks                             */
+/*                                                                   */
+/*   Descriptive Name: Copies data just written to a range of        */
+/*                     sectors into any cached tracks holding those  */
+/*                     sectors.                                      */
+/*                                                                   */
+/*   Input: CARDINAL32 Drive_Index : The index of the drive in the   */
+/*                                   DriveTable.                     */
+/*          LBA Starting_Sector : The first sector written.          */
+/*          CARDINAL32 SectorCount : The number of sectors written.  */
+/*          ADDRESS Buffer : The data written.                       */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  Keeping the tracks, rather than dropping them, lets a   */
+/*           later write to the same track (such as the DLA Table    */
+/*           after its EBR) be checked against the cache too.        */
+/*                                                                   */
+/*********************************************************************/
+static void Update_Cached_Tracks( CARDINAL32 Drive_Index, LBA Starting_Sector, CARDINAL32 SectorCount, ADDRESS Buffer )
+{
+
+  DiskDriveData *  Drive = &(DriveTable[Drive_Index]);
+  CachedTrack *    Entry;                                  /* Used to walk the TrackCache. */
+  CARDINAL32       Index;                                  /* Used to walk the TrackCache. */
+  LBA              First;                                  /* The first sector written which is in the track. */
+  LBA              End;                                    /* The sector after the last sector written which is in the track. */
+
+  Lock( Drive->Drive_Lock );
+
+  for ( Index = 0; Index < TRACK_CACHE_ENTRIES; Index++ )
+  {
+
+    Entry = &(Drive->TrackCache[Index]);
+
+    if ( Entry->Data == NULL )
+      continue;
+
+    First = ( Entry->First_Sector > Starting_Sector ) ? Entry->First_Sector : Starting_Sector;
+    End = ( ( Entry->First_Sector + Drive->SectorsPerTrack ) < ( Starting_Sector + SectorCount ) ) ?
+          ( Entry->First_Sector + Drive->SectorsPerTrack ) : ( Starting_Sector + SectorCount );
+
+    if ( First < End )
+      memcpy( Entry->Data + ( First - Entry->First_Sector ) * BYTES_PER_SECTOR,
+              (BYTE *) Buffer + ( First - Starting_Sector ) * BYTES_PER_SECTOR,
+              ( End - First ) * BYTES_PER_SECTOR );
+
+  }
+
+  Unlock( Drive->Drive_Lock );
+
+  return;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Do_Large_IO                                      */
+/*                                                                   */
+/*   Descriptive Name: Reads or writes a run of sectors which crosses*/
+/*                     track boundaries using CAT 9 requests of up   */
+/*                     to LARGE_TRANSFER_SECTORS sectors each, rather*/
+/*                     than one request per track.                   */
+/*                                                                   */
+/*   Input: CARDINAL32 DriveIndex : The index of the drive in the    */
+/*                                  DriveTable.                      */
+/*          CARDINAL32 FunctionNumber : PDSK_READPHYSTRACK or        */
+/*                                      PDSK_WRITEPHYSTRACK.         */
+/*          LBA * Starting_Sector : The first sector to transfer.    */
+/*          CARDINAL32 * SectorCount : The number of sectors to      */
+/*                                     transfer.                     */
+/*          ADDRESS * Buffer : The memory to transfer to or from.    */
+/*          int * Last_IOCTL : Where to record the last return code  */
+/*                             from DosDevIOCtl.                     */
+/*                                                                   */
+/*   Output: *Starting_Sector, *SectorCount and *Buffer are advanced */
+/*           past the sectors transferred.  *SectorCount is 0 if all */
+/*           of them were.                                           */
+/*                                                                   */
+/*   Error Handling: If the driver fails a request, or moves less    */
+/*                   than was asked for, Large_Transfers is turned   */
+/*                   off for the drive and the rest is left for the  */
+/*                   caller to do a track at a time.  That way a     */
+/*                   driver which only accepts single track requests */
+/*                   costs one failed request, and a genuine media   */
+/*                   error is still found and reported by the track  */
+/*                   by track path.                                  */
+/*                                                                   */
+/*   Side Effects: Large_Transfers may be turned off for the drive.  */
+/*                                                                   */
+/*   Notes:  The request still starts at a CHS address, since that is*/
+/*           what the IOCTL takes, but the sector count runs past the*/
+/*           end of the track.  Requests which would run past the end*/
+/*           of the drive are left for the track by track path, which*/
+/*           reports them as out of range.                           */
+/*                                                                   */
+/*********************************************************************/
+static void Do_Large_IO( CARDINAL32   DriveIndex,
+                         CARDINAL32   FunctionNumber,
+                         LBA *        Starting_Sector,
+                         CARDINAL32 * SectorCount,
+                         ADDRESS *    Buffer,
+                         int *        Last_IOCTL )
+{
+
+  DiskDriveData *  Drive = &(DriveTable[DriveIndex]);
+  APIRET           ReturnCode;                     /* Used to hold the return code from DosDevIOCtl. */
+  CARDINAL32       ParameterSize;                  /* Used by DosDevIOCtl. */
+  CARDINAL32       DataSize;                       /* Used by DosDevIOCtl. */
+  CARDINAL32       Track;                          /* The track number (cylinder * heads + head) of the current request. */
+  CARDINAL32       Transfer;                       /* The number of sectors in the current request. */
+  CARDINAL32       TotalSectors;                   /* The number of sectors on the drive. */
+
+  TotalSectors = (CARDINAL32) Drive->Cylinders * (CARDINAL32) Drive->Heads * (CARDINAL32) Drive->SectorsPerTrack;
+
+  if ( ( *Starting_Sector >= TotalSectors ) || ( *SectorCount > TotalSectors - *Starting_Sector ) )
+    return;
+
+  Lock( Drive->Drive_Lock );
+
+  while ( ( *SectorCount > 0 ) && Drive->Large_Transfers )
+  {
+
+    Transfer = ( *SectorCount > LARGE_TRANSFER_SECTORS ) ? LARGE_TRANSFER_SECTORS : *SectorCount;
+
+    /* Translate the LBA into the CHS address the IOCTL wants.  See Do_IO for the formulas. */
+    Track = *Starting_Sector / (CARDINAL32) Drive->SectorsPerTrack;
+
+    Drive->LargeLayout->usHead = Track % (CARDINAL32) Drive->Heads;
+    Drive->LargeLayout->usCylinder = Track / (CARDINAL32) Drive->Heads;
+    Drive->LargeLayout->usFirstSector = *Starting_Sector % (CARDINAL32) Drive->SectorsPerTrack;
+    Drive->LargeLayout->cSectors = Transfer;
+
+    ParameterSize = Drive->LargeLayoutSize;
+    DataSize = Transfer * BYTES_PER_SECTOR;
+
+    ReturnCode = DosDevIOCtl( Drive->DriveHandle,
+                              IOCTL_PHYSICALDISK,
+                              FunctionNumber,
+                              Drive->LargeLayout,
+                              ParameterSize,
+                              &ParameterSize,
+                              *Buffer,
+                              DataSize,
+                              &DataSize);
+
+    *Last_IOCTL = ReturnCode;
+
+    /* Count the I/O for Get_IO_Counts. */
+    Drive->IOCTL_Count++;
+    if ( FunctionNumber == PDSK_WRITEPHYSTRACK )
+      Drive->Sectors_Written += Transfer;
+    else
+      Drive->Sectors_Read += Transfer;
+
+    if ( ( ReturnCode != NO_ERROR ) || ( DataSize != Transfer * BYTES_PER_SECTOR ) )
+    {
+
+      /* The driver will not do this, or hit an error doing it.  Leave the rest to the track by track path from now on. */
+      Drive->Large_Transfers = FALSE;
+      break;
+
+    }
+
+    *Starting_Sector += Transfer;
+    *SectorCount -= Transfer;
+    *Buffer = ( ADDRESS ) ( ( CARDINAL32 ) *Buffer + ( Transfer * BYTES_PER_SECTOR ) );
+
+  }
+
+  Unlock( Drive->Drive_Lock );
+
+  return;
+
+}
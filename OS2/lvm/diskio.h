@@ -31,11 +31,17 @@
  *            void       GetDriveGeometry
  *            void       ReadSectors
  *            void       WriteSectors
+ *            void       Prefetch_Partition_Tables
+ *            void       Discard_Prefetched_Sectors
+ *            void       Flush_Sector_Cache
+ *            void       Get_IO_Counts
  *
  * Description: This module provides an LBA based means of reading and writing
  *              to the various disk drives in the system.
  *
- * Notes: This module is single threaded and is not reentrant.
+ * Notes: This module is single threaded and is not reentrant.  The only
+ *        exception is Prefetch_Partition_Tables, which reads each drive on
+ *        a thread of its own and waits for all of them before returning.
  *
  */
 
@@ -357,7 +363,11 @@ void ReadSectors ( CARDINAL32   Drive_Number,
 /*                                                                   */
 /*   Side Effects: Data may be written to disk.                      */
 /*                                                                   */
-/*   Notes:  None.                                                   */
+/*   Notes:  If the sectors are in a track kept by ReadSectors and   */
+/*           already hold exactly the data at Buffer, nothing is     */
+/*           written.  Committing changes rebuilds every MBR/EBR and */
+/*           DLA Table of a changed drive, and most of them come out */
+/*           the same as before.                                     */
 /*                                                                   */
 /*********************************************************************/
 void WriteSectors ( CARDINAL32   Drive_Number,
@@ -367,6 +377,120 @@ void WriteSectors ( CARDINAL32   Drive_Number,
                     CARDINAL32 * Error);
 
 
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Prefetch_Partition_Tables                        */
+/*                                                                   */
+/*   Descriptive Name: This function reads the MBR/EBR chain of every*/
+/*                     drive, along with the DLA Table of each MBR/  */
+/*                     EBR and the last sector of each partition,    */
+/*                     with one thread per drive.  The sectors read  */
+/*                     are kept so that ReadSectors can return them  */
+/*                     without going to the disk again.              */
+/*                                                                   */
+/*   Input: None.                                                    */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: Sectors which can not be read are not kept, so  */
+/*                   ReadSectors will read them (and report the      */
+/*                   error) as it would have without the prefetch.   */
+/*                                                                   */
+/*   Side Effects: Memory is allocated for the sectors read.         */
+/*                                                                   */
+/*   Notes:  This only saves time, partition and volume discovery    */
+/*           still process the drives one at a time.  A write to a   */
+/*           drive discards the sectors kept for it.                 */
+/*                                                                   */
+/*********************************************************************/
+void Prefetch_Partition_Tables( void );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Discard_Prefetched_Sectors                       */
+/*                                                                   */
+/*   Descriptive Name: This function frees the sectors kept by       */
+/*                     Prefetch_Partition_Tables.                    */
+/*                                                                   */
+/*   Input: None.                                                    */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: Later reads go to the disk.                       */
+/*                                                                   */
+/*   Notes:  None.                                                   */
+/*                                                                   */
+/*********************************************************************/
+void Discard_Prefetched_Sectors( void );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Flush_Sector_Cache                               */
+/*                                                                   */
+/*   Descriptive Name: This function empties the track cache and     */
+/*                     frees any prefetched sectors for all drives.  */
+/*                                                                   */
+/*   Input: None.                                                    */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: The next read of each track goes to the disk.     */
+/*                                                                   */
+/*   Notes:  ReadSectors keeps the last few whole tracks read from   */
+/*           each drive.  WriteSectors updates the tracks it writes  */
+/*           to, so this is only needed when something other than    */
+/*           this module may have changed the disk.                  */
+/*                                                                   */
+/*********************************************************************/
+void Flush_Sector_Cache( void );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Get_IO_Counts                                    */
+/*                                                                   */
+/*   Descriptive Name: Returns the number of IOCTLs issued to read   */
+/*                     or write a drive, and the number of sectors   */
+/*                     read and written, since OpenDrives.           */
+/*                                                                   */
+/*   Input: CARDINAL32 Drive_Number : The number of the drive, 1 for */
+/*                                    the first drive.               */
+/*          CARDINAL32 * IOCTL_Count : Set to the number of read and */
+/*                                     write IOCTLs issued.          */
+/*          CARDINAL32 * Sectors_Read : Set to the number of sectors */
+/*                                      those IOCTLs asked to read.  */
+/*          CARDINAL32 * Sectors_Written : Set to the number of      */
+/*                                         sectors those IOCTLs      */
+/*                                         asked to write.           */
+/*          CARDINAL32 * Error : The address of a variable to hold   */
+/*                               the error return code.              */
+/*                                                                   */
+/*   Output: *Error will be 0 and the counts filled in if            */
+/*           successful.                                             */
+/*                                                                   */
+/*   Error Handling: *Error will be > 0 if the drives are not open   */
+/*                   or Drive_Number is not a valid drive.           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  Reads answered from the track cache or from             */
+/*           Prefetch_Partition_Tables are not counted, as they do   */
+/*           not reach the drive.                                    */
+/*                                                                   */
+/*********************************************************************/
+void Get_IO_Counts( CARDINAL32   Drive_Number,
+                    CARDINAL32 * IOCTL_Count,
+                    CARDINAL32 * Sectors_Read,
+                    CARDINAL32 * Sectors_Written,
+                    CARDINAL32 * Error );
+
+
 /*********************************************************************/
 /*                                                                   */
 /*   Function Name: Rediscover                                       */
@@ -63,6 +63,7 @@
  *            void        ForEachItem
  *            void        PruneList
  *            void        AppendList
+ *            void        IndexList
  *
  * Description:  This module implements a simple, generic, doubly linked list.
  *               Data objects of any type can be placed into a linked list
@@ -74,7 +75,7 @@
  */
 
 #include <stdlib.h>   /* free */
-#include <string.h>   /* memcpy */
+#include <string.h>   /* memcpy, memset */
 #include "dlist.h"    /* Import dlist.h so that the compiler can check the
                          consistency of the declarations in dlist.h against
                          those in this module.                              */
@@ -105,6 +106,13 @@
    the operation is aborted.                                                 */
 #define VerifyValue 39646966L
 
+/* An index starts out with 2 to the power IndexMinBits slots, and is rebuilt
+   with twice as many whenever it becomes half full.                          */
+#define IndexMinBits 5
+
+/* LinkNodes are allocated NodesPerBlock at a time.  See AllocateNode. */
+#define NodesPerBlock 128
+
 
 /*--------------------------------------------------
  * Private Type definitions
@@ -176,6 +184,9 @@ struct MasterListRecord
   LinkNode *      StartOfList;           /* The address of the LinkNode of the first item in the list. */
   LinkNode *      EndOfList;             /* The address of the LinkNode of the last item in the list. */
   LinkNode *      CurrentItem;           /* The address of the LinkNode of the current item in the list. */
+  LinkNode **     Index;                 /* A hash table holding the address of every LinkNode in the list,
+                                            or NULL if the list is not indexed.  See IndexList.              */
+  CARDINAL32      IndexBits;             /* Index has 2 to the power IndexBits slots. */
 #ifdef USE_POOLMAN
   POOL            NodePool;              /* The pool of LinkNodes for this DLIST. */
 #endif
@@ -184,10 +195,31 @@ struct MasterListRecord
 
 typedef struct MasterListRecord ControlNode;
 
+#ifndef USE_POOLMAN
+
+/* A block of LinkNodes.  The LinkNodes of all lists come from a chain of these. */
+struct NodeBlockRecord
+{
+  struct NodeBlockRecord *  NextBlock;             /* The next block in the chain. */
+  LinkNode                  Nodes[NodesPerBlock];
+};
+
+typedef struct NodeBlockRecord NodeBlock;
+
+#endif
+
 
 /*--------------------------------------------------
  Private global variables.
 --------------------------------------------------*/
+#ifndef USE_POOLMAN
+
+static NodeBlock *  NodeBlocks = NULL;    /* The chain of blocks the LinkNodes come from. */
+static LinkNode *   FreeNodes = NULL;     /* The unused LinkNodes in NodeBlocks, linked through NextLinkNode. */
+static CARDINAL32   NodesInUse = 0;       /* The number of LinkNodes in NodeBlocks which are in a list. */
+
+#endif
+
 BOOLEAN  ErrorsFound = FALSE; /* Used to track whether or not errors have
                                  been found.  Can be used with a memory access
                                  breakpoint to stop program execution when
@@ -196,8 +228,18 @@ BOOLEAN  ErrorsFound = FALSE; /* Used to track whether or not errors have
 
 
 /*--------------------------------------------------
- There are no private functions.
+ Private functions.
 --------------------------------------------------*/
+static CARDINAL32 IndexSlot( ControlNode * ListData, LinkNode * Node );
+static BOOLEAN    IndexRebuild( ControlNode * ListData );
+static void       IndexAdd( ControlNode * ListData, LinkNode * Node );
+static void       IndexRemove( ControlNode * ListData, LinkNode * Node );
+static void       IndexClear( ControlNode * ListData );
+static BOOLEAN    HandleInList( ControlNode * ListData, LinkNode * Node );
+#ifndef USE_POOLMAN
+static LinkNode * AllocateNode( void );
+static void       FreeNode( LinkNode * Node );
+#endif
 
 
 
@@ -290,6 +332,8 @@ DLIST _System CreateList(CARDINAL32 InitialPoolSize,
   ListData->StartOfList = NULL;    /* Since the list is empty, there is no first item */
   ListData->EndOfList = NULL;      /* Since the list is empty, there is no last item */
   ListData->CurrentItem = NULL;    /* Since the list is empty, there is no current item */
+  ListData->Index = NULL;          /* Lists are not indexed until IndexList is called. */
+  ListData->IndexBits = 0;
 
   /* Create the pool of link nodes for this list. */
   ListData->NodePool = CreatePool(sizeof(LinkNode),InitialPoolSize, MaximumPoolSize, PoolIncrement,FALSE);
@@ -377,6 +421,8 @@ DLIST _System CreateList( void )
   ListData->StartOfList = NULL;    /* Since the list is empty, there is no first item */
   ListData->EndOfList = NULL;      /* Since the list is empty, there is no last item */
   ListData->CurrentItem = NULL;    /* Since the list is empty, there is no current item */
+  ListData->Index = NULL;          /* Lists are not indexed until IndexList is called. */
+  ListData->IndexBits = 0;
 
   #ifdef DEBUG
 
@@ -697,7 +743,7 @@ ADDRESS _System InsertObject ( DLIST           ListToAddTo,
   {
 
     /* Is CurrentNode part of this list? */
-    if ( CurrentNode->ControlNodeLocation != ListData )
+    if ( ! HandleInList( ListData, CurrentNode ) )
     {
 
       /* The handle either did not point to a ControlNode or it pointed to the wrong ControlNode! */
@@ -736,7 +782,7 @@ ADDRESS _System InsertObject ( DLIST           ListToAddTo,
 #ifdef USE_POOLMAN
   NewNode = (LinkNode *) AllocateFromPool(ListData->NodePool);
 #else
-  NewNode = (LinkNode *) malloc( sizeof(LinkNode) );
+  NewNode = AllocateNode();
 #endif
 
   /* Did we get the memory? */
@@ -860,7 +906,11 @@ ADDRESS _System InsertObject ( DLIST           ListToAddTo,
       default :
                 NewNode->ControlNodeLocation = NULL;
                 free(NewNode->DataLocation);
-                free(NewNode);
+#ifdef USE_POOLMAN
+                DeallocateToPool(ListData->NodePool,NewNode);
+#else
+                FreeNode(NewNode);
+#endif
                 *Error = DLIST_INVALID_INSERTION_MODE;
                 return NULL;
 
@@ -871,6 +921,9 @@ ADDRESS _System InsertObject ( DLIST           ListToAddTo,
   /* Adjust the count of the number of items in the list. */
   ListData->ItemCount++;
 
+  /* Keep the index, if there is one, up to date. */
+  IndexAdd( ListData, NewNode );
+
   /* Should the new node become the current item in the list? */
   if ( MakeCurrent )
   {
@@ -1029,7 +1082,7 @@ void _System DeleteItem (DLIST        ListToDeleteFrom,
   {
 
     /* Does the LinkNode corresponding to the handle point to the ControlNode for this list? */
-    if (CurrentLinkNode->ControlNodeLocation != ListData)
+    if ( ! HandleInList( ListData, CurrentLinkNode ) )
     {
       /* The handle did not point to a LinkNode or the LinkNode it pointed to was not
          in ListToDeleteFrom. */
@@ -1110,11 +1163,12 @@ void _System DeleteItem (DLIST        ListToDeleteFrom,
   }
 
   /* Free the memory associated with the control structures used to manage items in the list. */
+  IndexRemove( ListData, CurrentLinkNode );
   CurrentLinkNode->ControlNodeLocation = NULL;
 #ifdef USE_POOLMAN
   DeallocateToPool(ListData->NodePool,CurrentLinkNode);    /* Return LinkNode to the Node Pool. */
 #else
-  free(CurrentLinkNode);
+  FreeNode(CurrentLinkNode);
 #endif
 
 #ifdef PARANOID
@@ -1256,7 +1310,7 @@ void _System DeleteAllItems (DLIST        ListToDeleteFrom,
 #ifdef USE_POOLMAN
     DeallocateToPool(ListData->NodePool,CurrentLinkNode);   /* Return LinkNode to the Node Pool. */
 #else
-    free(CurrentLinkNode);
+    FreeNode(CurrentLinkNode);
 #endif
   }
 
@@ -1264,6 +1318,9 @@ void _System DeleteAllItems (DLIST        ListToDeleteFrom,
   ListData->CurrentItem = NULL;
   ListData->EndOfList = NULL;
 
+  /* None of the LinkNodes in the index exist any more. */
+  IndexClear( ListData );
+
 #ifdef PARANOID
 
   assert (CheckListIntegrity( ListToDeleteFrom ) );
@@ -1421,7 +1478,7 @@ void _System GetItem( DLIST          ListToGetItemFrom,
     CurrentLinkNode = (LinkNode*) Handle;
 
     /* Is the handle valid? */
-    if ( CurrentLinkNode->ControlNodeLocation != ListData )
+    if ( ! HandleInList( ListData, CurrentLinkNode ) )
     {
 
       /* The handle is not valid!  Abort! */
@@ -1970,7 +2027,7 @@ ADDRESS _System GetObject( DLIST          ListToGetItemFrom,
     CurrentLinkNode = (LinkNode*) Handle;
 
     /* Is the handle valid? */
-    if ( CurrentLinkNode->ControlNodeLocation != ListData )
+    if ( ! HandleInList( ListData, CurrentLinkNode ) )
     {
 
       /* The handle is not valid!  Abort! */
@@ -2512,7 +2569,7 @@ void _System ExtractItem( DLIST          ListToGetItemFrom,
     CurrentLinkNode = (LinkNode*) Handle;
 
     /* Is the handle valid? */
-    if ( CurrentLinkNode->ControlNodeLocation != ListData )
+    if ( ! HandleInList( ListData, CurrentLinkNode ) )
     {
 
       /* The handle is not valid!  Abort! */
@@ -2608,11 +2665,12 @@ void _System ExtractItem( DLIST          ListToGetItemFrom,
   free(CurrentLinkNode->DataLocation);
 #endif
 
+  IndexRemove( ListData, CurrentLinkNode );
   CurrentLinkNode->ControlNodeLocation = NULL;
 #ifdef USE_POOLMAN
   DeallocateToPool(ListData->NodePool,CurrentLinkNode);    /* Return LinkNode to the Node Pool. */
 #else
-  free(CurrentLinkNode);
+  FreeNode(CurrentLinkNode);
 #endif
 
 #ifdef PARANOID
@@ -2774,7 +2832,7 @@ ADDRESS _System ExtractObject( DLIST          ListToGetItemFrom,
     CurrentLinkNode = (LinkNode*) Handle;
 
     /* Is the handle valid? */
-    if ( CurrentLinkNode->ControlNodeLocation != ListData )
+    if ( ! HandleInList( ListData, CurrentLinkNode ) )
     {
 
       /* The handle is not valid!  Abort! */
@@ -2864,11 +2922,12 @@ ADDRESS _System ExtractObject( DLIST          ListToGetItemFrom,
   ListData->ItemCount = ListData->ItemCount - 1;
 
   /* Now we must free the memory associated with the current node. */
+  IndexRemove( ListData, CurrentLinkNode );
   CurrentLinkNode->ControlNodeLocation = NULL;
 #ifdef USE_POOLMAN
   DeallocateToPool(ListData->NodePool,CurrentLinkNode);    /* Return LinkNode to the Node Pool. */
 #else
-  free(CurrentLinkNode);
+  FreeNode(CurrentLinkNode);
 #endif
 
 
@@ -3034,7 +3093,7 @@ void _System ReplaceItem( DLIST         ListToReplaceItemIn,
     CurrentLinkNode = (LinkNode*) Handle;
 
     /* Is the handle valid? */
-    if ( CurrentLinkNode->ControlNodeLocation != ListData )
+    if ( ! HandleInList( ListData, CurrentLinkNode ) )
     {
 
       /* The handle is not valid!  Abort! */
@@ -3262,7 +3321,7 @@ ADDRESS _System ReplaceObject( DLIST         ListToReplaceItemIn,
     CurrentLinkNode = (LinkNode*) Handle;
 
     /* Is the handle valid? */
-    if ( CurrentLinkNode->ControlNodeLocation != ListData )
+    if ( ! HandleInList( ListData, CurrentLinkNode ) )
     {
 
       /* The handle is not valid!  Abort! */
@@ -3420,7 +3479,7 @@ TAG _System GetTag( DLIST  ListToGetTagFrom,
     CurrentLinkNode = (LinkNode*) Handle;
 
     /* Is the handle valid? */
-    if ( CurrentLinkNode->ControlNodeLocation != ListData )
+    if ( ! HandleInList( ListData, CurrentLinkNode ) )
     {
 
       /* The handle is not valid!  Abort! */
@@ -4015,7 +4074,7 @@ void _System DestroyList( DLIST *  ListToDestroy, BOOLEAN FreeItemMemory, CARDIN
 #ifdef USE_POOLMAN
     DeallocateToPool(ListData->NodePool,CurrentLinkNode);   /* Return LinkNode to the Node Pool. */
 #else
-    free(CurrentLinkNode);
+    FreeNode(CurrentLinkNode);
 #endif
   }
 
@@ -4026,6 +4085,10 @@ void _System DestroyList( DLIST *  ListToDestroy, BOOLEAN FreeItemMemory, CARDIN
 
 #endif
 
+  /* Release the index, if there is one. */
+  if ( ListData->Index != NULL )
+    free( ListData->Index );
+
 #ifdef DEBUG
 
   /* Set Verify to 0 so that, if the same block of
@@ -4538,7 +4601,7 @@ void _System GoToSpecifiedItem( DLIST ListToReposition, ADDRESS Handle, CARDINAL
      ControlNode for ListToReposition, then the LinkNode is in ListToReposition
      and can therefore become the current item in ListToReposition. */
   if ( (CurrentNode != NULL  ) &&
-       (CurrentNode->ControlNodeLocation == ListData) )
+       HandleInList( ListData, CurrentNode ) )
   {
     /* The handle pointed to a valid LinkNode which is in ListToReposition.
        Lets make that node the current item in ListToReposition.            */
@@ -5336,11 +5399,12 @@ void _System PruneList(DLIST        ListToProcess,
       }
 
       /* Free the memory associated with the control structures used to manage items in the list. */
+      IndexRemove( ListData, CurrentLinkNode );
       CurrentLinkNode->ControlNodeLocation = NULL;
 #ifdef USE_POOLMAN
       DeallocateToPool(ListData->NodePool,CurrentLinkNode);    /* Return LinkNode to the Node Pool. */
 #else
-      free(CurrentLinkNode);
+      FreeNode(CurrentLinkNode);
 #endif
 
       /* Resume our traversal of the tree. */
@@ -5538,6 +5602,12 @@ void _System AppendList(DLIST         TargetList,
     *TargetListData = *SourceListData;
     *SourceListData = TempListData;
 
+    /* Each list keeps its own index, or lack of one. */
+    SourceListData->Index = TargetListData->Index;
+    SourceListData->IndexBits = TargetListData->IndexBits;
+    TargetListData->Index = TempListData.Index;
+    TargetListData->IndexBits = TempListData.IndexBits;
+
     /* Get the first item in the target list. */
     CurrentLinkNode = TargetListData->StartOfList;
 
@@ -5580,6 +5650,16 @@ void _System AppendList(DLIST         TargetList,
     CurrentLinkNode->ControlNodeLocation = TargetListData;
   }
 
+  /* The source list is now empty, and every item it had is now in the target list. */
+  IndexClear( SourceListData );
+
+  if ( ( TargetListData->Index != NULL ) && ! IndexRebuild( TargetListData ) )
+  {
+    /* There was not enough memory for a bigger index.  The target list will have to do without one. */
+    free( TargetListData->Index );
+    TargetListData->Index = NULL;
+  }
+
 
 #ifdef PARANOID
 
@@ -5960,7 +6040,7 @@ void _System TransferItem(DLIST             SourceList,
     SourceLinkNode = (LinkNode*) SourceHandle;
 
     /* Is the handle valid? */
-    if ( SourceLinkNode->ControlNodeLocation != SourceListData )
+    if ( ! HandleInList( SourceListData, SourceLinkNode ) )
     {
 
       /* The handle is not valid!  Abort! */
@@ -5986,7 +6066,7 @@ void _System TransferItem(DLIST             SourceList,
     TargetLinkNode = (LinkNode*) TargetHandle;
 
     /* Is the handle valid? */
-    if ( TargetLinkNode->ControlNodeLocation != TargetListData )
+    if ( ! HandleInList( TargetListData, TargetLinkNode ) )
     {
 
       /* The handle is not valid!  Abort! */
@@ -6015,6 +6095,7 @@ void _System TransferItem(DLIST             SourceList,
 
   /* Update SourceList's control data. */
   SourceListData->ItemCount -= 1;
+  IndexRemove( SourceListData, SourceLinkNode );
 
   if ( SourceListData->StartOfList == SourceLinkNode )
     SourceListData->StartOfList = NextNode;
@@ -6160,6 +6241,7 @@ void _System TransferItem(DLIST             SourceList,
 
   /* Adjust the ControlNodeLocation of SourceLinkNode so that it thinks it is now a member of TargetList. */
   SourceLinkNode->ControlNodeLocation = TargetListData;
+  IndexAdd( TargetListData, SourceLinkNode );
 
   /* Should the transferred item become the current item in TargetList? */
   if ( MakeCurrent )
@@ -6185,3 +6267,492 @@ void _System TransferItem(DLIST             SourceList,
 }
 
 
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name:  IndexList                                       */
+/*                                                                   */
+/*   Descriptive Name: Builds an index of the handles of the items   */
+/*                     in a DLIST so that handles given to this      */
+/*                     module can be checked without touching the    */
+/*                     memory they point to.                         */
+/*                                                                   */
+/*   Input:  DLIST ListToIndex : The list to index.                  */
+/*           CARDINAL32 * Error : The address of a variable to hold  */
+/*                                the error return code.             */
+/*                                                                   */
+/*   Output: *Error will be DLIST_SUCCESS if the index was built,    */
+/*           otherwise it will contain an error code.                */
+/*                                                                   */
+/*   Error Handling: If there is not enough memory for the index,    */
+/*                   *Error is set to DLIST_OUT_OF_MEMORY and the    */
+/*                   list is left as it was.                         */
+/*                                                                   */
+/*   Side Effects: From now on, every item added to or removed from  */
+/*                 the list is also added to or removed from the     */
+/*                 index, until the list is destroyed.               */
+/*                                                                   */
+/*   Notes: Without an index, a handle is checked by looking at the  */
+/*          LinkNode it points to, which fails badly if the item     */
+/*          was deleted and its memory reused.  With an index, a     */
+/*          handle which does not belong to the list is rejected     */
+/*          with DLIST_BAD_HANDLE whatever it points to.  Indexing   */
+/*          a list which is already indexed does nothing.            */
+/*                                                                   */
+/*********************************************************************/
+void _System IndexList( DLIST ListToIndex, CARDINAL32 * Error )
+{
+
+  /* Since ListToIndex is of type DLIST, we can not use it without
+     having to type cast it each time.  To avoid all of the type casting,
+     we will declare a local variable of type ControlNode * and then
+     initialize it once using ListToIndex.  This way we just do the
+     cast once.                                                            */
+  ControlNode *      ListData;
+
+  /* We will assume that ListToIndex points to a valid list.  Given this,
+     we will initialize ListData to point to the ControlNode of ListToIndex. */
+  ListData = (ControlNode *) ListToIndex;
+
+
+#ifdef DEBUG
+
+  #ifdef PARANOID
+
+  if ( !CheckListIntegrity(ListToIndex) )
+  {
+    *Error = DLIST_CORRUPTED;
+    return;
+  }
+
+  #else
+
+  /* We must now validate the list before we attempt to use it.  We will
+     do this by checking the Verify field in the ControlNode.               */
+  if ((ListData == NULL) || (ListData->Verify != VerifyValue))
+  {
+    *Error = DLIST_NOT_INITIALIZED;
+    return;
+  }
+
+  #endif
+
+#endif
+
+  /* Assume success. */
+  *Error = DLIST_SUCCESS;
+
+  /* Is the list already indexed? */
+  if ( ListData->Index != NULL )
+    return;
+
+  if ( ! IndexRebuild( ListData ) )
+    *Error = DLIST_OUT_OF_MEMORY;
+
+  /* All done! */
+  return;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name:  IndexSlot                                       */
+/*                                                                   */
+/*   Descriptive Name: Finds the slot in the index of a list where   */
+/*                     the search for a LinkNode starts.             */
+/*                                                                   */
+/*   Input:  ControlNode * ListData : The list whose index is used.  */
+/*           LinkNode * Node : The address of the LinkNode.          */
+/*                                                                   */
+/*   Output: The function return value is the slot number.           */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes: Node is never dereferenced.  LinkNodes are at least 8    */
+/*          byte aligned, so the low bits of the address are         */
+/*          dropped before it is hashed.                             */
+/*                                                                   */
+/*********************************************************************/
+static CARDINAL32 IndexSlot( ControlNode * ListData, LinkNode * Node )
+{
+
+  return ( ( ( (CARDINAL32) Node >> 3 ) * 2654435761UL ) & 0xFFFFFFFFUL ) >> ( 32 - ListData->IndexBits );
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name:  IndexRebuild                                    */
+/*                                                                   */
+/*   Descriptive Name: Makes a new index for a list, sized for the   */
+/*                     number of items now in the list, and fills it */
+/*                     with the LinkNodes of those items.            */
+/*                                                                   */
+/*   Input:  ControlNode * ListData : The list to index.             */
+/*                                                                   */
+/*   Output: The function return value is TRUE if the new index was  */
+/*           built, FALSE if there was not enough memory for it.     */
+/*                                                                   */
+/*   Error Handling: If the memory for the new index can not be      */
+/*                   allocated, the old index, if any, is left as    */
+/*                   it was.                                         */
+/*                                                                   */
+/*   Side Effects: The old index, if any, is freed.                  */
+/*                                                                   */
+/*   Notes: The new index is no more than one quarter full.          */
+/*                                                                   */
+/*********************************************************************/
+static BOOLEAN IndexRebuild( ControlNode * ListData )
+{
+
+  LinkNode **    OldIndex = ListData->Index;
+  CARDINAL32     OldBits = ListData->IndexBits;
+  LinkNode *     CurrentLinkNode;
+  CARDINAL32     Mask;
+  CARDINAL32     Slot;
+
+  /* Find the smallest index which is no more than one quarter full. */
+  ListData->IndexBits = IndexMinBits;
+  while ( ( ( 1UL << ListData->IndexBits ) / 4 ) < ListData->ItemCount )
+    ListData->IndexBits++;
+
+  ListData->Index = (LinkNode **) calloc( 1UL << ListData->IndexBits, sizeof(LinkNode *) );
+  if ( ListData->Index == NULL )
+  {
+    ListData->Index = OldIndex;
+    ListData->IndexBits = OldBits;
+    return FALSE;
+  }
+
+  Mask = ( 1UL << ListData->IndexBits ) - 1;
+
+  /* Add every LinkNode in the list to the new index. */
+  for ( CurrentLinkNode = ListData->StartOfList; CurrentLinkNode != NULL; CurrentLinkNode = CurrentLinkNode->NextLinkNode )
+  {
+    Slot = IndexSlot( ListData, CurrentLinkNode );
+    while ( ListData->Index[Slot] != NULL )
+      Slot = ( Slot + 1 ) & Mask;
+
+    ListData->Index[Slot] = CurrentLinkNode;
+  }
+
+  if ( OldIndex != NULL )
+    free( OldIndex );
+
+  return TRUE;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name:  IndexAdd                                        */
+/*                                                                   */
+/*   Descriptive Name: Adds a LinkNode which has just been put into  */
+/*                     a list to the index of that list.             */
+/*                                                                   */
+/*   Input:  ControlNode * ListData : The list Node was put into.    */
+/*           LinkNode * Node : The LinkNode to add.                  */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: If the index is half full and there is not      */
+/*                   enough memory for a bigger one, the list stops  */
+/*                   being indexed.                                  */
+/*                                                                   */
+/*   Side Effects: The index may be rebuilt.                         */
+/*                                                                   */
+/*   Notes: Node must already be linked into the list and counted    */
+/*          in ItemCount.  Does nothing if the list is not indexed.  */
+/*                                                                   */
+/*********************************************************************/
+static void IndexAdd( ControlNode * ListData, LinkNode * Node )
+{
+
+  CARDINAL32     Mask;
+  CARDINAL32     Slot;
+
+  if ( ListData->Index == NULL )
+    return;
+
+  Mask = ( 1UL << ListData->IndexBits ) - 1;
+
+  /* Is the index getting too full to search quickly?  If so, a new one is
+     built from the list, which already includes Node.                      */
+  if ( ListData->ItemCount * 2 > Mask + 1 )
+  {
+    if ( ! IndexRebuild( ListData ) )
+    {
+      free( ListData->Index );
+      ListData->Index = NULL;
+    }
+
+    return;
+  }
+
+  Slot = IndexSlot( ListData, Node );
+  while ( ListData->Index[Slot] != NULL )
+    Slot = ( Slot + 1 ) & Mask;
+
+  ListData->Index[Slot] = Node;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name:  IndexRemove                                     */
+/*                                                                   */
+/*   Descriptive Name: Removes a LinkNode which is being taken out   */
+/*                     of a list from the index of that list.        */
+/*                                                                   */
+/*   Input:  ControlNode * ListData : The list Node is leaving.      */
+/*           LinkNode * Node : The LinkNode to remove.               */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: Entries after the one removed may be moved back   */
+/*                 so that searches for them still find them.        */
+/*                                                                   */
+/*   Notes: Does nothing if the list is not indexed.                 */
+/*                                                                   */
+/*********************************************************************/
+static void IndexRemove( ControlNode * ListData, LinkNode * Node )
+{
+
+  CARDINAL32     Mask;
+  CARDINAL32     Hole;
+  CARDINAL32     Slot;
+  CARDINAL32     Home;
+
+  if ( ListData->Index == NULL )
+    return;
+
+  Mask = ( 1UL << ListData->IndexBits ) - 1;
+
+  /* Find Node. */
+  Hole = IndexSlot( ListData, Node );
+  while ( ListData->Index[Hole] != Node )
+  {
+    if ( ListData->Index[Hole] == NULL )
+      return;
+
+    Hole = ( Hole + 1 ) & Mask;
+  }
+
+  /* Fill the hole left by Node with any later entry whose search would
+     otherwise stop at the hole, then fill the hole that leaves, and so on. */
+  Slot = Hole;
+  for (;;)
+  {
+    Slot = ( Slot + 1 ) & Mask;
+    if ( ListData->Index[Slot] == NULL )
+      break;
+
+    Home = IndexSlot( ListData, ListData->Index[Slot] );
+
+    /* Does the search for this entry pass through the hole? */
+    if ( ( ( Slot - Home ) & Mask ) >= ( ( Slot - Hole ) & Mask ) )
+    {
+      ListData->Index[Hole] = ListData->Index[Slot];
+      Hole = Slot;
+    }
+  }
+
+  ListData->Index[Hole] = NULL;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name:  IndexClear                                      */
+/*                                                                   */
+/*   Descriptive Name: Empties the index of a list.                  */
+/*                                                                   */
+/*   Input:  ControlNode * ListData : The list whose index is to be  */
+/*                                    emptied.                       */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes: Does nothing if the list is not indexed.                 */
+/*                                                                   */
+/*********************************************************************/
+static void IndexClear( ControlNode * ListData )
+{
+
+  if ( ListData->Index != NULL )
+    memset( ListData->Index, 0, ( 1UL << ListData->IndexBits ) * sizeof(LinkNode *) );
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name:  HandleInList                                    */
+/*                                                                   */
+/*   Descriptive Name: Checks whether a handle is the handle of an   */
+/*                     item in a list.                               */
+/*                                                                   */
+/*   Input:  ControlNode * ListData : The list.                      */
+/*           LinkNode * Node : The handle to check.                  */
+/*                                                                   */
+/*   Output: The function return value is TRUE if Node is the        */
+/*           LinkNode of an item in the list, FALSE otherwise.       */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes: If the list is indexed, Node is looked up in the index   */
+/*          and never dereferenced.  Otherwise Node must point to    */
+/*          readable memory.                                         */
+/*                                                                   */
+/*********************************************************************/
+static BOOLEAN HandleInList( ControlNode * ListData, LinkNode * Node )
+{
+
+  CARDINAL32     Mask;
+  CARDINAL32     Slot;
+
+  if ( ListData->Index == NULL )
+    return ( Node->ControlNodeLocation == ListData );
+
+  Mask = ( 1UL << ListData->IndexBits ) - 1;
+
+  Slot = IndexSlot( ListData, Node );
+  while ( ListData->Index[Slot] != NULL )
+  {
+    if ( ListData->Index[Slot] == Node )
+      return TRUE;
+
+    Slot = ( Slot + 1 ) & Mask;
+  }
+
+  return FALSE;
+
+}
+
+
+#ifndef USE_POOLMAN
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name:  AllocateNode                                    */
+/*                                                                   */
+/*   Descriptive Name: Gets an unused LinkNode.                      */
+/*                                                                   */
+/*   Input:  None.                                                   */
+/*                                                                   */
+/*   Output: The function return value is the address of the         */
+/*           LinkNode, or NULL if there is not enough memory.        */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: A new block of LinkNodes may be allocated.        */
+/*                                                                   */
+/*   Notes: LinkNodes are allocated from the heap NodesPerBlock at a */
+/*          time rather than one at a time, as a list of partitions  */
+/*          or volumes is built up one item after another and a      */
+/*          malloc for every item is most of the cost of doing so.   */
+/*          It also keeps the LinkNodes of a list close together in  */
+/*          memory, which makes walking the list cheaper.            */
+/*                                                                   */
+/*********************************************************************/
+static LinkNode * AllocateNode( void )
+{
+
+  NodeBlock *    NewBlock;
+  LinkNode *     Node;
+  CARDINAL32     Index;
+
+  /* Are there any unused LinkNodes left? */
+  if ( FreeNodes == NULL )
+  {
+
+    NewBlock = (NodeBlock *) malloc( sizeof(NodeBlock) );
+    if ( NewBlock == NULL )
+      return NULL;
+
+    NewBlock->NextBlock = NodeBlocks;
+    NodeBlocks = NewBlock;
+
+    /* Put the LinkNodes of the new block on the free chain, in order, so that
+       consecutive allocations return consecutive LinkNodes.                   */
+    for ( Index = NodesPerBlock; Index > 0; Index-- )
+    {
+      NewBlock->Nodes[Index - 1].ControlNodeLocation = NULL;
+      NewBlock->Nodes[Index - 1].NextLinkNode = FreeNodes;
+      FreeNodes = &(NewBlock->Nodes[Index - 1]);
+    }
+
+  }
+
+  Node = FreeNodes;
+  FreeNodes = Node->NextLinkNode;
+  NodesInUse++;
+
+  return Node;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name:  FreeNode                                        */
+/*                                                                   */
+/*   Descriptive Name: Returns a LinkNode which is no longer in any  */
+/*                     list.                                         */
+/*                                                                   */
+/*   Input:  LinkNode * Node : The LinkNode to return.               */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: When the last LinkNode in use is returned, all of */
+/*                 the blocks of LinkNodes are freed.                */
+/*                                                                   */
+/*   Notes: A LinkNode which has been returned stays readable, with  */
+/*          its ControlNodeLocation set to NULL, until it is reused  */
+/*          or its block is freed, so a stale handle is more likely  */
+/*          to be caught.                                            */
+/*                                                                   */
+/*********************************************************************/
+static void FreeNode( LinkNode * Node )
+{
+
+  NodeBlock *    Block;
+
+  Node->NextLinkNode = FreeNodes;
+  FreeNodes = Node;
+  NodesInUse--;
+
+  /* If no list has any items left, as when the LVM Engine is closed, give all of the
+     LinkNodes back to the heap at once.                                               */
+  if ( NodesInUse == 0 )
+  {
+
+    while ( NodeBlocks != NULL )
+    {
+      Block = NodeBlocks;
+      NodeBlocks = Block->NextBlock;
+      free( Block );
+    }
+
+    FreeNodes = NULL;
+
+  }
+
+}
+
+#endif
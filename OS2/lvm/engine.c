@@ -88,7 +88,7 @@
 #include "engine.h"   /* Include engine.h to declare the global types and variables. */
 #include "lvm_gbls.h" /* CARDINAL32, BYTE, BOOLEAN, ADDRESS */
 #include "dlist.h"    /* CreateList, DestroyList, ForEachItem */
-#include "diskio.h"   /* OpenDrives, CloseDrives, GetDriveCount, GetDriveGeometry */
+#include "diskio.h"   /* OpenDrives, CloseDrives, GetDriveCount, GetDriveGeometry, Prefetch_Partition_Tables, Discard_Prefetched_Sectors, Flush_Sector_Cache */
 
 
 #include "lvm_cons.h" /* PARTITION_NAME_SIZE, VOLUME_NAME_SIZE, DISK_NAME_SIZE, BYTES_PER_SECTOR */
@@ -287,6 +287,7 @@ void _System Open_LVM_Engine2( BOOLEAN Ignore_CHS, LVM_Interface_Types Interface
   DDI_Rediscover_param  Rediscovery_Parameters;  /* Used to do a PRM Rediscover so that PRMs with new media will be recognized. */
   DDI_Rediscover_data   Rediscovery_Data;        /* Used to do a PRM Rediscover so that PRMs with new media will be recognized. */
   CARDINAL32            Ignore_Error;            /* Used on error paths. */
+  BOOLEAN               Drives_Opened;           /* The value returned by OpenDrives. */
 
   /* Opening the LVM Engine consists of:
 
@@ -452,10 +453,14 @@ void _System Open_LVM_Engine2( BOOLEAN Ignore_CHS, LVM_Interface_Types Interface
 
   }
 
-  API_EXIT( "Open_LVM_Engine" )
-
   /* Now we need to gather information about the drives in the system.  To do this, we must initialize the DiskIO module. */
-  if ( ! OpenDrives( Error_Code ) )
+  PROFILE_START( "OpenDrives" )
+
+  Drives_Opened = OpenDrives( Error_Code );
+
+  PROFILE_STOP( "OpenDrives" )
+
+  if ( ! Drives_Opened )
   {
 
     /* We could not open the DiskIO module!  Abort. */
@@ -770,6 +775,13 @@ void _System Open_LVM_Engine2( BOOLEAN Ignore_CHS, LVM_Interface_Types Interface
   }
 
 
+  /* Read the partition tables of all of the drives at once, rather than waiting on each drive in turn during discovery. */
+  PROFILE_START( "Prefetch_Partition_Tables" )
+
+  Prefetch_Partition_Tables();
+
+  PROFILE_STOP( "Prefetch_Partition_Tables" )
+
   /* Now that all of the setup work has been done, lets see what partitions are out there! */
   Discover_Partitions( Error_Code );
 
@@ -816,6 +828,9 @@ void _System Open_LVM_Engine2( BOOLEAN Ignore_CHS, LVM_Interface_Types Interface
   /* Now that all of the partitions have been discovered, lets see what volumes are out there! */
   Discover_Volumes( Error_Code );
 
+  /* Discovery is done with the sectors read by Prefetch_Partition_Tables. */
+  Discard_Prefetched_Sectors();
+
   /* Was there an error? */
   if ( *Error_Code != LVM_ENGINE_NO_ERROR )
   {
@@ -928,6 +943,9 @@ void _System Open_LVM_Engine2( BOOLEAN Ignore_CHS, LVM_Interface_Types Interface
 
   API_EXIT( "Open_LVM_Engine" )
 
+  /* Log where the time went while opening the engine. */
+  Log_Profile_Report();
+
   /* All done!  Indicate success and return. */
   *Error_Code = LVM_ENGINE_NO_ERROR;
 
@@ -1352,6 +1370,10 @@ void Close_LVM_Engine ( void )
   else
     Merlin_Mode = FALSE;              /* Reset Merlin_Mode to its default value. */
 
+  /* Log where the time went since the engine was opened, then start over for the next time it is opened. */
+  Log_Profile_Report();
+  Reset_Profile();
+
   /* Close the DiskIO module as we don't need it anymore. */
   CloseDrives();
 
@@ -1384,7 +1406,8 @@ void Close_LVM_Engine ( void )
 /*                   a non-zero value.                               */
 /*                                                                   */
 /*   Side Effects: Volumes which represent non-LVM devices may have  */
-/*                 their handles changed!                            */
+/*                 their handles changed!  Only those whose device   */
+/*                 has gone or changed are affected.                 */
 /*                                                                   */
 /*   Notes:  After calling this function, Get_Volume_Control_Data    */
 /*           should be called to get the updated list of volumes.    */
@@ -1415,6 +1438,9 @@ void _System  Refresh_LVM_Engine( CARDINAL32 * Error_Code )
 
   }
 
+  /* Sectors cached before the refresh may be stale by now. */
+  Flush_Sector_Cache();
+
   /* If we are NOT running on Aurora, then we must skip the call to Reconcile_Drive_Letters
      as the operating system does not support the features required for it to work correctly. */
   if ( Merlin_Mode )
@@ -6798,7 +6824,8 @@ void _Far16 _Pascal _loadds Close_LVM_Engine16 ( void )
 /*                   a non-zero value.                               */
 /*                                                                   */
 /*   Side Effects: Volumes which represent non-LVM devices may have  */
-/*                 their handles changed!                            */
+/*                 their handles changed!  Only those whose device   */
+/*                 has gone or changed are affected.                 */
 /*                                                                   */
 /*   Notes:  After calling this function, Get_Volume_Control_Data    */
 /*           should be called to get the updated list of volumes.    */
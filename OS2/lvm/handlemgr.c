@@ -40,7 +40,7 @@
 
 #include <stdlib.h>           /* NULL */
 #include "lvm_gbls.h"         /* ADDRESS, CARDINAL32 */
-#include "dlist.h"            /* TAG, InsertObject, GetObject, GetTag, GoToSpecifiedItem, GoToEndOfList, CreateList, GetHandle, DeleteItem */
+#include "dlist.h"            /* TAG, InsertObject, GetObject, GetTag, GoToSpecifiedItem, GoToEndOfList, CreateList, GetHandle, DeleteItem, IndexList */
 #include "lvm_hand.h"   /* Included to ensure that Handle_Manager.C and Handle_Manager.H are consistent. */
 
 #ifdef DEBUG
@@ -112,6 +112,8 @@ DLIST  Handles = (DLIST) NULL;           /* Used to create, track, translate, an
 BOOLEAN Initialize_Handle_Manager(void)
 {
 
+  CARDINAL32   Error;         /* Used with the IndexList function. */
+
   /* Has the Handle Manager already been initialized? */
   if ( Handles != NULL )
   {
@@ -135,6 +137,11 @@ BOOLEAN Initialize_Handle_Manager(void)
 
   }
 
+  /* Index the Handles list so that Translate_Handle can reject a stale or bogus handle without
+     touching the memory it points to.  If there is not enough memory for the index, handles
+     are still checked, just not as safely, so this is not an error.                           */
+  IndexList( Handles, &Error );
+
   /* The Handle Manager has been initialized. */
 
   /* Indicate success. */
@@ -408,13 +415,15 @@ void Destroy_All_Handles( CARDINAL32 * Error_Code )
 /*              error code.                                          */
 /*                                                                   */
 /*   Error Handling: *Error_Code will be non-zero if a recoverable   */
-/*                   error occurs.  If Handle is invalid, then a     */
-/*                   trap or exception may occur.                    */
+/*                   error occurs.  If Handle is not a handle which  */
+/*                   is currently in use, *Error_Code will be        */
+/*                   HANDLE_MANAGER_BAD_HANDLE.                      */
 /*                                                                   */
-/*   Side Effects: If Handle is invalid, a trap or exception may     */
-/*                 occur.                                            */
+/*   Side Effects: None.                                             */
 /*                                                                   */
-/*   Notes:  None.                                                   */
+/*   Notes:  Handle is only checked without being dereferenced if    */
+/*           the Handles list could be indexed when the Handle       */
+/*           Manager was initialized.                                */
 /*                                                                   */
 /*********************************************************************/
 void _System Translate_Handle( ADDRESS Handle, ADDRESS * Object, TAG * ObjectTag, CARDINAL32 * Error_Code )
@@ -449,6 +458,16 @@ void _System Translate_Handle( ADDRESS Handle, ADDRESS * Object, TAG * ObjectTag
   /* Before we can get the item, we must get its size and TAG. */
   *ObjectTag = GetTag(Handles, Handle, &ItemSize, Error_Code);
 
+  /* Was Handle one we never gave out, or one which has been destroyed? */
+  if ( ( *Error_Code == DLIST_BAD_HANDLE ) || ( *Error_Code == DLIST_EMPTY ) )
+  {
+
+    *Error_Code = HANDLE_MANAGER_BAD_HANDLE;
+
+    return;
+
+  }
+
 #ifdef DEBUG
 
 #ifdef PARANOID
@@ -62,6 +62,7 @@
  *
  */
 
+#define INCL_DOSPROFILE    /* DosTmrQueryTime, DosTmrQueryFreq */
 #define NEED_BYTE_DEFINED
 #include "engine.h"
 #include "lvm_gbls.h"  /* CARDINAL32 */
@@ -71,8 +72,11 @@
 #define DECLARE_LOGGING_GLOBALS
 #include "logging.h"
 #include "alvm.h"
+#include "diskio.h"        /* Get_IO_Counts */
 
 #include <stdio.h>         /* file I/O functions. */
+#include <stdlib.h>        /* qsort */
+#include <string.h>        /* strcmp, memset */
 #include <time.h>          /* time, ctime */
 #include <assert.h>
 
@@ -83,8 +87,15 @@
 
 
 /*--------------------------------------------------
- * There are no private Type definitions
+ * Private Type definitions
  --------------------------------------------------*/
+typedef struct _Profile_Record {
+                                 char *       Name;        /* The name given to Profile_Entry, or NULL if this entry is free. */
+                                 CARDINAL32   Calls;       /* The number of times Profile_Entry has been called for Name. */
+                                 BOOLEAN      Running;     /* TRUE between a Profile_Entry and its Profile_Exit. */
+                                 QWORD        Started;     /* The timer value at the last Profile_Entry. */
+                                 double       Ticks;       /* The timer ticks between each Profile_Entry and its Profile_Exit, added up. */
+                               } Profile_Record;
 
 
 
@@ -92,11 +103,16 @@
  * Private Global Variables.
  --------------------------------------------------*/
 static FILE   * Log_File = (FILE *) NULL;       /* Handle of the log file. */
+static Profile_Record  Profile_Table[PROFILE_TABLE_SIZE];     /* Hashed on the name of the function or phase. */
+static CARDINAL32      Profile_Records_In_Use = 0;            /* The number of entries in Profile_Table with a Name. */
 
 /*--------------------------------------------------
  * Private functions.
  --------------------------------------------------*/
 void _System Log_Volumes_And_Partitions(ADDRESS Object, TAG ObjectTag, CARDINAL32 ObjectSize, ADDRESS ObjectHandle, ADDRESS Parameters, CARDINAL32 * Error_Code);
+static Profile_Record * Find_Profile_Record( char * Name );
+static double Elapsed_Ticks( QWORD * Started );
+static int Compare_Profile_Times( const void * Record1, const void * Record2 );
 
 
 /*--------------------------------------------------
@@ -492,11 +508,321 @@ void Stop_Logging ( CARDINAL32 * Error_Code )
 
 
 
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Profile_Entry                                    */
+/*                                                                   */
+/*   Descriptive Name: Counts a call to a function or a phase of the */
+/*                     LVM Engine and starts timing it.              */
+/*                                                                   */
+/*   Input: char * Name : The name of the function or phase.  This   */
+/*                        must be a string constant, as only its     */
+/*                        address is kept.                           */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: Names beyond the first PROFILE_TABLE_SIZE - 1   */
+/*                   are not counted.                                */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  This is called by the API_ENTRY, FUNCTION_ENTRY and     */
+/*           PROFILE_START macros whenever logging is active.        */
+/*                                                                   */
+/*********************************************************************/
+void _System Profile_Entry( char * Name )
+{
+
+  Profile_Record * Record = Find_Profile_Record( Name );
+
+  if ( Record != NULL )
+  {
+
+    Record->Calls++;
+    Record->Running = TRUE;
+    DosTmrQueryTime( &(Record->Started) );
+
+  }
+
+  return;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Profile_Exit                                     */
+/*                                                                   */
+/*   Descriptive Name: Stops timing a function or phase of the LVM   */
+/*                     Engine and adds the time to its total.        */
+/*                                                                   */
+/*   Input: char * Name : The name given to Profile_Entry.           */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: An exit without a matching entry is ignored.    */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  If a function is entered again before it exits, only    */
+/*           the innermost call is timed.                            */
+/*                                                                   */
+/*********************************************************************/
+void _System Profile_Exit( char * Name )
+{
+
+  Profile_Record * Record = Find_Profile_Record( Name );
+
+  if ( ( Record != NULL ) && Record->Running )
+  {
+
+    Record->Ticks += Elapsed_Ticks( &(Record->Started) );
+    Record->Running = FALSE;
+
+  }
+
+  return;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Log_Profile_Report                               */
+/*                                                                   */
+/*   Descriptive Name: Writes the I/O counts of each drive and the   */
+/*                     call counts and times gathered by             */
+/*                     Profile_Entry and Profile_Exit to the log     */
+/*                     file.                                         */
+/*                                                                   */
+/*   Input: None.                                                    */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: If logging is active, the report is appended to   */
+/*                 the log file.                                     */
+/*                                                                   */
+/*   Notes:  The functions are listed with the most time first.      */
+/*           Times include the time spent in functions they call.    */
+/*                                                                   */
+/*********************************************************************/
+void _System Log_Profile_Report( void )
+{
+
+  static Profile_Record *  Sorted[PROFILE_TABLE_SIZE];   /* The entries of Profile_Table in use, most time first. */
+  CARDINAL32               Count = 0;                    /* The number of entries in Sorted. */
+  CARDINAL32               Index;                        /* Used to walk the Profile_Table and the drives. */
+  CARDINAL32               IOCTL_Count;                  /* The values returned by Get_IO_Counts. */
+  CARDINAL32               Sectors_Read;
+  CARDINAL32               Sectors_Written;
+  CARDINAL32               Error = DISKIO_NO_ERROR;
+  ULONG                    Frequency = 0;                /* Timer ticks per second. */
+  double                   Milliseconds;
+
+  /* Is logging enabled? */
+  if ( ! Logging_Enabled )
+    return;
+
+  fprintf(Log_File,"\n\n==========================  Performance Report  ============================\n\n");
+
+  /* First, the I/O done on each drive since the drives were opened. */
+  for ( Index = 1; Error == DISKIO_NO_ERROR; Index++ )
+  {
+
+    Get_IO_Counts( Index, &IOCTL_Count, &Sectors_Read, &Sectors_Written, &Error );
+
+    if ( Error == DISKIO_NO_ERROR )
+      fprintf(Log_File,"Drive %lu: %lu IOCTLs, %lu sectors read, %lu sectors written.\n", Index, IOCTL_Count, Sectors_Read, Sectors_Written);
+
+  }
+
+  /* Now the functions and phases, most time first. */
+  for ( Index = 0; Index < PROFILE_TABLE_SIZE; Index++ )
+  {
+
+    if ( Profile_Table[Index].Name != NULL )
+      Sorted[Count++] = &(Profile_Table[Index]);
+
+  }
+
+  qsort( Sorted, Count, sizeof(Profile_Record *), Compare_Profile_Times );
+
+  DosTmrQueryFreq( &Frequency );
+
+  fprintf(Log_File,"\n     Calls    Total ms  Function or phase\n");
+
+  for ( Index = 0; Index < Count; Index++ )
+  {
+
+    Milliseconds = ( Frequency != 0 ) ? ( Sorted[Index]->Ticks * 1000.0 ) / (double) Frequency : 0.0;
+
+    fprintf(Log_File,"%10lu  %10.3f  %s%s\n", Sorted[Index]->Calls, Milliseconds, Sorted[Index]->Name, Sorted[Index]->Running ? " (still running)" : "");
+
+  }
+
+  fprintf(Log_File,"\n============================================================================\n\n");
+
+  return;
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Reset_Profile                                    */
+/*                                                                   */
+/*   Descriptive Name: Discards the call counts and times gathered   */
+/*                     so far.                                       */
+/*                                                                   */
+/*   Input: None.                                                    */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  None.                                                   */
+/*                                                                   */
+/*********************************************************************/
+void _System Reset_Profile( void )
+{
+
+  memset( Profile_Table, 0, sizeof(Profile_Table) );
+  Profile_Records_In_Use = 0;
+
+  return;
+
+}
+
+
+
 /*--------------------------------------------------
  * Private functions.
  --------------------------------------------------*/
 
 
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Find_Profile_Record                              */
+/*                                                                   */
+/*   Descriptive Name: Finds the entry in the Profile_Table for a    */
+/*                     name, creating one if there is none yet.      */
+/*                                                                   */
+/*   Input: char * Name : The name to look for.                      */
+/*                                                                   */
+/*   Output: The entry for Name, or NULL if the table is full.       */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: An entry in Profile_Table may be claimed.         */
+/*                                                                   */
+/*   Notes:  The same name may be at a different address in each     */
+/*           module, so names are compared with strcmp.  One entry   */
+/*           is always left free so that the search ends.            */
+/*                                                                   */
+/*********************************************************************/
+static Profile_Record * Find_Profile_Record( char * Name )
+{
+
+  CARDINAL32  Hash = 0;
+  char *      Next;
+
+  for ( Next = Name; *Next != 0; Next++ )
+    Hash = ( Hash * 31 ) + (BYTE) *Next;
+
+  Hash &= ( PROFILE_TABLE_SIZE - 1 );
+
+  while ( Profile_Table[Hash].Name != NULL )
+  {
+
+    if ( ( Profile_Table[Hash].Name == Name ) || ( strcmp( Profile_Table[Hash].Name, Name ) == 0 ) )
+      return &(Profile_Table[Hash]);
+
+    Hash = ( Hash + 1 ) & ( PROFILE_TABLE_SIZE - 1 );
+
+  }
+
+  if ( Profile_Records_In_Use >= ( PROFILE_TABLE_SIZE - 1 ) )
+    return NULL;
+
+  Profile_Records_In_Use++;
+  Profile_Table[Hash].Name = Name;
+
+  return &(Profile_Table[Hash]);
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Elapsed_Ticks                                    */
+/*                                                                   */
+/*   Descriptive Name: Returns the number of timer ticks since a     */
+/*                     time read with DosTmrQueryTime.               */
+/*                                                                   */
+/*   Input: QWORD * Started : The earlier time.                      */
+/*                                                                   */
+/*   Output: The number of ticks since *Started.                     */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  None.                                                   */
+/*                                                                   */
+/*********************************************************************/
+static double Elapsed_Ticks( QWORD * Started )
+{
+
+  QWORD  Now;
+
+  DosTmrQueryTime( &Now );
+
+  return ( ( (double) Now.ulHi - (double) Started->ulHi ) * 4294967296.0 ) + ( (double) Now.ulLo - (double) Started->ulLo );
+
+}
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Compare_Profile_Times                            */
+/*                                                                   */
+/*   Descriptive Name: Orders Profile_Table entries for qsort, most  */
+/*                     time first.                                   */
+/*                                                                   */
+/*   Input: const void * Record1, Record2 : Pointers to the two      */
+/*                                          Profile_Record pointers. */
+/*                                                                   */
+/*   Output: < 0 if Record1 took more time, > 0 if it took less,     */
+/*           0 if they took the same time.                           */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  None.                                                   */
+/*                                                                   */
+/*********************************************************************/
+static int Compare_Profile_Times( const void * Record1, const void * Record2 )
+{
+
+  double  Ticks1 = ( *(Profile_Record **) Record1 )->Ticks;
+  double  Ticks2 = ( *(Profile_Record **) Record2 )->Ticks;
+
+  if ( Ticks1 > Ticks2 )
+    return -1;
+
+  if ( Ticks1 < Ticks2 )
+    return 1;
+
+  return 0;
+
+}
+
+
 /*********************************************************************/
 /*                                                                   */
 /*   Function Name: Log_Volumes_And_Partitions                       */
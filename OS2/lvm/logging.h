@@ -118,9 +118,103 @@ void _System Log_Current_Configuration( void );
 void _System Write_Log_Buffer( void );
 
 
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Profile_Entry                                    */
+/*                                                                   */
+/*   Descriptive Name: Counts a call to a function or a phase of the */
+/*                     LVM Engine and starts timing it.              */
+/*                                                                   */
+/*   Input: char * Name : The name of the function or phase.  This   */
+/*                        must be a string constant, as only its     */
+/*                        address is kept.                           */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: Names beyond the first PROFILE_TABLE_SIZE - 1   */
+/*                   are not counted.                                */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  This is called by the API_ENTRY, FUNCTION_ENTRY and     */
+/*           PROFILE_START macros whenever logging is active.        */
+/*                                                                   */
+/*********************************************************************/
+void _System Profile_Entry( char * Name );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Profile_Exit                                     */
+/*                                                                   */
+/*   Descriptive Name: Stops timing a function or phase of the LVM   */
+/*                     Engine and adds the time to its total.        */
+/*                                                                   */
+/*   Input: char * Name : The name given to Profile_Entry.           */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: An exit without a matching entry is ignored.    */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  If a function is entered again before it exits, only    */
+/*           the innermost call is timed.                            */
+/*                                                                   */
+/*********************************************************************/
+void _System Profile_Exit( char * Name );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Log_Profile_Report                               */
+/*                                                                   */
+/*   Descriptive Name: Writes the I/O counts of each drive and the   */
+/*                     call counts and times gathered by             */
+/*                     Profile_Entry and Profile_Exit to the log     */
+/*                     file.                                         */
+/*                                                                   */
+/*   Input: None.                                                    */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: If logging is active, the report is appended to   */
+/*                 the log file.                                     */
+/*                                                                   */
+/*   Notes:  The functions are listed with the most time first.      */
+/*           Times include the time spent in functions they call.    */
+/*                                                                   */
+/*********************************************************************/
+void _System Log_Profile_Report( void );
+
+
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Reset_Profile                                    */
+/*                                                                   */
+/*   Descriptive Name: Discards the call counts and times gathered   */
+/*                     so far.                                       */
+/*                                                                   */
+/*   Input: None.                                                    */
+/*                                                                   */
+/*   Output: None.                                                   */
+/*                                                                   */
+/*   Error Handling: None.                                           */
+/*                                                                   */
+/*   Side Effects: None.                                             */
+/*                                                                   */
+/*   Notes:  None.                                                   */
+/*                                                                   */
+/*********************************************************************/
+void _System Reset_Profile( void );
+
+
 #define LOG_BUFFER_SIZE   512
 #define FUNCTION_ENTRY_BORDER   "*****FUNCTION ENTRY*****\n"
 #define FUNCTION_EXIT_BORDER    "*****FUNCTION EXIT******\n"
+#define PROFILE_TABLE_SIZE      256       /* The most functions and phases Profile_Entry will keep track of.  Must be a power of 2. */
 
 
 /*--------------------------------------------------
@@ -224,55 +318,89 @@ void _System Write_Log_Buffer( void );
                                                                                                                      \
                                                             }                                                        \
 
-#define FUNCTION_ENTRY( FunctionName )  if (  Logging_Enabled >1)                                           \
+#define FUNCTION_ENTRY( FunctionName )  if (  Logging_Enabled )                                             \
                                         {                                                                   \
                                                                                                             \
-                                          sprintf( Log_Buffer,FUNCTION_ENTRY_BORDER);                       \
-                                          Write_Log_Buffer();                                               \
-                                          sprintf( Log_Buffer, "     %s", FunctionName);                    \
-                                          Write_Log_Buffer();                                               \
-                                          sprintf( Log_Buffer,FUNCTION_ENTRY_BORDER);                       \
-                                          Write_Log_Buffer();                                               \
+                                          Profile_Entry( FunctionName );                                    \
+                                                                                                            \
+                                          if ( Logging_Enabled > 1 )                                        \
+                                          {                                                                 \
+                                                                                                            \
+                                            sprintf( Log_Buffer,FUNCTION_ENTRY_BORDER);                     \
+                                            Write_Log_Buffer();                                             \
+                                            sprintf( Log_Buffer, "     %s", FunctionName);                  \
+                                            Write_Log_Buffer();                                             \
+                                            sprintf( Log_Buffer,FUNCTION_ENTRY_BORDER);                     \
+                                            Write_Log_Buffer();                                             \
+                                                                                                            \
+                                          }                                                                 \
                                                                                                             \
                                         }                                                                   \
 
-#define FUNCTION_EXIT( FunctionName )  if (  Logging_Enabled >1)                                           \
+#define FUNCTION_EXIT( FunctionName )  if (  Logging_Enabled )                                             \
                                        {                                                                   \
                                                                                                            \
-                                         sprintf(Log_Buffer,FUNCTION_EXIT_BORDER);                         \
-                                         Write_Log_Buffer();                                               \
-                                         sprintf(Log_Buffer, "     %s", FunctionName);                     \
-                                         Write_Log_Buffer();                                               \
-                                         sprintf(Log_Buffer,FUNCTION_EXIT_BORDER);                         \
-                                         Write_Log_Buffer();                                               \
+                                         Profile_Exit( FunctionName );                                     \
+                                                                                                           \
+                                         if ( Logging_Enabled > 1 )                                        \
+                                         {                                                                 \
+                                                                                                           \
+                                           sprintf( Log_Buffer,FUNCTION_EXIT_BORDER);                      \
+                                           Write_Log_Buffer();                                             \
+                                           sprintf( Log_Buffer, "     %s", FunctionName);                  \
+                                           Write_Log_Buffer();                                             \
+                                           sprintf( Log_Buffer,FUNCTION_EXIT_BORDER);                      \
+                                           Write_Log_Buffer();                                             \
+                                                                                                           \
+                                         }                                                                 \
                                                                                                            \
                                        }                                                                   \
 
-#define API_ENTRY( FunctionName )  if (  Logging_Enabled > 1)                                          \
+#define API_ENTRY( FunctionName )  if (  Logging_Enabled )                                             \
                                    {                                                                   \
                                                                                                        \
-                                     sprintf( Log_Buffer,API_ENTRY_BORDER);                            \
-                                     Write_Log_Buffer();                                               \
-                                     sprintf( Log_Buffer, "     %s", FunctionName);                    \
-                                     Write_Log_Buffer();                                               \
-                                     sprintf( Log_Buffer,API_ENTRY_BORDER);                            \
-                                     Write_Log_Buffer();                                               \
+                                     Profile_Entry( FunctionName );                                    \
+                                                                                                       \
+                                     if ( Logging_Enabled > 1 )                                        \
+                                     {                                                                 \
+                                                                                                       \
+                                       sprintf( Log_Buffer,API_ENTRY_BORDER);                          \
+                                       Write_Log_Buffer();                                             \
+                                       sprintf( Log_Buffer, "     %s", FunctionName);                  \
+                                       Write_Log_Buffer();                                             \
+                                       sprintf( Log_Buffer,API_ENTRY_BORDER);                          \
+                                       Write_Log_Buffer();                                             \
+                                                                                                       \
+                                     }                                                                 \
                                                                                                        \
                                    }                                                                   \
 
-#define API_EXIT( FunctionName )  if (  Logging_Enabled  > 1)                                         \
+#define API_EXIT( FunctionName )  if (  Logging_Enabled )                                             \
                                   {                                                                   \
                                                                                                       \
-                                    sprintf( Log_Buffer,API_EXIT_BORDER);                             \
-                                    Write_Log_Buffer();                                               \
-                                    sprintf( Log_Buffer, "     %s", FunctionName);                    \
-                                    Write_Log_Buffer();                                               \
-                                    sprintf( Log_Buffer,API_EXIT_BORDER);                             \
-                                    Write_Log_Buffer();                                               \
+                                    Profile_Exit( FunctionName );                                     \
+                                                                                                      \
+                                    if ( Logging_Enabled > 1 )                                        \
+                                    {                                                                 \
+                                                                                                      \
+                                      sprintf( Log_Buffer,API_EXIT_BORDER);                           \
+                                      Write_Log_Buffer();                                             \
+                                      sprintf( Log_Buffer, "     %s", FunctionName);                  \
+                                      Write_Log_Buffer();                                             \
+                                      sprintf( Log_Buffer,API_EXIT_BORDER);                           \
+                                      Write_Log_Buffer();                                             \
+                                                                                                      \
+                                    }                                                                 \
                                                                                                       \
                                   }                                                                   \
 
 
+#define PROFILE_START( PhaseName )  if (  Logging_Enabled )                                            \
+                                      Profile_Entry( PhaseName );                                     \
+
+#define PROFILE_STOP( PhaseName )   if (  Logging_Enabled )                                            \
+                                      Profile_Exit( PhaseName );                                      \
+
 
 #ifdef DECLARE_LOGGING_GLOBALS
 
@@ -194,13 +194,15 @@ void _System Destroy_All_Handles( CARDINAL32 * Error_Code );
 /*              error code.                                          */
 /*                                                                   */
 /*   Error Handling: *Error_Code will be non-zero if a recoverable   */
-/*                   error occurs.  If Handle is invalid, then a     */
-/*                   trap or exception may occur.                    */
+/*                   error occurs.  If Handle is not a handle which  */
+/*                   is currently in use, *Error_Code will be        */
+/*                   HANDLE_MANAGER_BAD_HANDLE.                      */
 /*                                                                   */
-/*   Side Effects: If Handle is invalid, a trap or exception may     */
-/*                 occur.                                            */
+/*   Side Effects: None.                                             */
 /*                                                                   */
-/*   Notes:  None.                                                   */
+/*   Notes:  Handle is only checked without being dereferenced if    */
+/*           the Handles list could be indexed when the Handle       */
+/*           Manager was initialized.                                */
 /*                                                                   */
 /*********************************************************************/
 void _System Translate_Handle( ADDRESS Handle, ADDRESS * Object, TAG * ObjectTag, CARDINAL32 * Error_Code );
@@ -208,6 +208,7 @@ static void          _System Check_For_Corrupt_Drive(ADDRESS Object, TAG ObjectT
 static void          _System Find_Potential_Volumes(ADDRESS Object, TAG ObjectTag, CARDINAL32 ObjectSize, ADDRESS ObjectHandle, ADDRESS Parameters, CARDINAL32 * Error);
 static void          _System Destroy_Embedded_Lists(ADDRESS Object, TAG ObjectTag, CARDINAL32 ObjectSize, ADDRESS ObjectHandle, ADDRESS Parameters, CARDINAL32 * Error);
 static BOOLEAN       _System Kill_Non_LVM_Device_Volumes(ADDRESS Object, TAG ObjectTag, CARDINAL32 ObjectSize, ADDRESS ObjectHandle, ADDRESS Parameters, BOOLEAN * FreeMemory, CARDINAL32 * Error);
+static void          _System Find_Non_LVM_Device_Volumes(ADDRESS Object, TAG ObjectTag, CARDINAL32 ObjectSize, ADDRESS ObjectHandle, ADDRESS Parameters, CARDINAL32 * Error);
 static void          _System Set_Initial_Drive_Letters(ADDRESS Object, TAG ObjectTag, CARDINAL32 ObjectSize, ADDRESS ObjectHandle, ADDRESS Parameters, CARDINAL32 * Error);
 static void          _System Check_New_Drive_Letters(ADDRESS Object, TAG ObjectTag, CARDINAL32 ObjectSize, ADDRESS ObjectHandle, ADDRESS Parameters, CARDINAL32 * Error);
 static void          _System Update_Current_Drive_Letter(ADDRESS Object, TAG ObjectTag, CARDINAL32 ObjectSize, ADDRESS ObjectHandle, ADDRESS Parameters, CARDINAL32 * Error);
@@ -10496,17 +10497,22 @@ static void _System Find_Current_Drive_Letter_Conflicts(ADDRESS Object, TAG Obje
 
 /*********************************************************************/
 /*                                                                   */
-/*   Function Name:                                                  */
+/*   Function Name: Kill_Non_LVM_Device_Volumes                      */
 /*                                                                   */
-/*   Descriptive Name:                                               */
+/*   Descriptive Name: Used with PruneList to delete the "fake"      */
+/*                     volumes which represent non-LVM devices.      */
 /*                                                                   */
-/*   Input:                                                          */
+/*   Input: Parameters : NULL, or an array of 26 Volume_Data         */
+/*                       pointers, one per drive letter.  A "fake"   */
+/*                       volume which is in this array, under its    */
+/*                       current drive letter, is not deleted.       */
 /*                                                                   */
-/*   Output:                                                         */
+/*   Output: The function return value is TRUE if the volume is to   */
+/*           be deleted.                                             */
 /*                                                                   */
-/*   Error Handling:                                                 */
+/*   Error Handling: *Error is set to a DLIST error code.            */
 /*                                                                   */
-/*   Side Effects:  None.                                            */
+/*   Side Effects:  The handles of the deleted volumes are destroyed.*/
 /*                                                                   */
 /*   Notes:  None.                                                   */
 /*                                                                   */
@@ -10557,6 +10563,20 @@ static BOOLEAN _System Kill_Non_LVM_Device_Volumes(ADDRESS Object, TAG ObjectTag
   if ( ( VolumeRecord->Device_Type != LVM_HARD_DRIVE ) && ( VolumeRecord->Device_Type != LVM_PRM ) )
   {
 
+    /* Has the caller asked us to keep this volume? */
+    if ( ( Parameters != NULL ) &&
+         ( VolumeRecord->Current_Drive_Letter >= 'A' ) &&
+         ( VolumeRecord->Current_Drive_Letter <= 'Z' ) &&
+         ( ( (Volume_Data **) Parameters )[VolumeRecord->Current_Drive_Letter - 'A'] == VolumeRecord )
+       )
+    {
+
+      FUNCTION_EXIT("Kill_Non_LVM_Device_Volumes")
+
+      return FALSE;
+
+    }
+
     /* We have a non-LVM device.  Lets begin deleting this volume. */
 
     /* Dispose of the external handle used to reference this volume. */
@@ -10603,6 +10623,88 @@ static BOOLEAN _System Kill_Non_LVM_Device_Volumes(ADDRESS Object, TAG ObjectTag
 }
 
 
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name: Find_Non_LVM_Device_Volumes                      */
+/*                                                                   */
+/*   Descriptive Name: Used with ForEachItem to find the "fake"      */
+/*                     volumes which represent non-LVM devices.      */
+/*                                                                   */
+/*   Input: Parameters : An array of 26 Volume_Data pointers, one    */
+/*                       per drive letter, all NULL to begin with.   */
+/*                                                                   */
+/*   Output: Each "fake" volume is put into the array under its      */
+/*           current drive letter.                                   */
+/*                                                                   */
+/*   Error Handling: *Error is set to a DLIST error code.            */
+/*                                                                   */
+/*   Side Effects:  None.                                            */
+/*                                                                   */
+/*   Notes:  If two "fake" volumes claim the same drive letter, only */
+/*           the first is put into the array.                        */
+/*                                                                   */
+/*********************************************************************/
+static void _System Find_Non_LVM_Device_Volumes(ADDRESS Object, TAG ObjectTag, CARDINAL32 ObjectSize, ADDRESS ObjectHandle, ADDRESS Parameters, CARDINAL32 * Error)
+{
+
+  /* Declare a local variable so that we can access the Volume_Data object without having to typecast each time. */
+  Volume_Data *    VolumeRecord = (Volume_Data *) Object;
+
+  /* Declare a local variable so that we can access our parameters without having to typecast each time. */
+  Volume_Data **   Non_LVM_Volumes = (Volume_Data **) Parameters;
+
+
+  FUNCTION_ENTRY("Find_Non_LVM_Device_Volumes")
+
+#ifdef DEBUG
+
+  /* Is Object what we think it should be? */
+  if ( ( ObjectTag != VOLUME_DATA_TAG ) || ( ObjectSize != sizeof(Volume_Data) ) )
+  {
+
+
+#ifdef PARANOID
+
+    assert(0);
+
+#endif
+
+    LOG_ERROR2("Unexpected object tag or object size!","Object Tag", ObjectTag, "Object Size", ObjectSize)
+
+    /* We have a TAG that is not what we expected!  Abort! */
+    *Error = DLIST_CORRUPTED;
+
+    FUNCTION_EXIT("Find_Non_LVM_Device_Volumes")
+
+    return;
+
+  }
+
+#endif
+
+  /* Assume success. */
+  *Error = DLIST_SUCCESS;
+
+  /* Does this volume represent a non-LVM device, and does it have a drive letter? */
+  if ( ( VolumeRecord->Device_Type != LVM_HARD_DRIVE ) &&
+       ( VolumeRecord->Device_Type != LVM_PRM ) &&
+       ( VolumeRecord->Current_Drive_Letter >= 'A' ) &&
+       ( VolumeRecord->Current_Drive_Letter <= 'Z' ) &&
+       ( Non_LVM_Volumes[VolumeRecord->Current_Drive_Letter - 'A'] == NULL )
+     )
+  {
+
+    Non_LVM_Volumes[VolumeRecord->Current_Drive_Letter - 'A'] = VolumeRecord;
+
+  }
+
+  FUNCTION_EXIT("Find_Non_LVM_Device_Volumes")
+
+  return;
+
+}
+
+
 /*********************************************************************/
 /*                                                                   */
 /*   Function Name:                                                  */
@@ -10850,6 +10952,10 @@ CARDINAL32 Reconcile_Drive_Letters( BOOLEAN Update_NON_LVM_Volumes_Only, CARDINA
   CARDINAL32                        V_Count = 1;                                            /* Used when creating unique names for "fake" volumes. */
   CARDINAL32                        CDROM_Count = 1;                                        /* Used when creating unique names for "fake" volumes. */
   CARDINAL32                        LAN_Count = 1;                                          /* Used when creating unique names for "fake" volumes. */
+  Volume_Data *                     Non_LVM_Volumes[26];                                    /* The "fake" volume for each drive letter, if there is one. */
+  Volume_Data *                     Old_Volume;                                             /* The "fake" volume for the current drive letter before this call. */
+  CARDINAL32                        Device_Size;                                            /* The size of the device at the current drive letter. */
+  char *                            Device_Filesystem;                                      /* The filesystem on the device at the current drive letter. */
 
   FUNCTION_ENTRY("Reconcile_Drive_Letters")
 
@@ -10857,23 +10963,29 @@ CARDINAL32 Reconcile_Drive_Letters( BOOLEAN Update_NON_LVM_Volumes_Only, CARDINA
    only update those volumes that represent devices which are NOT under the control of LVM.  The way we do this is
    as follows:
 
-   1.  Delete all Volumes representing non-LVM devices
+   1.  Find all Volumes representing non-LVM devices
    2.  Traverse all drive letters.  For each drive letter get the OS2LVM View of the drive letter.
    3.  Find the device which corresponds to the data returned by OS2LVM and update its
        Current_Drive_Letter field, unless Update_NON_LVM_Volumes_Only is TRUE, in which case
        just ignore it.
    4.  For all drive letters that OS2LVM returns no data for, use GET_DEV_PARMS to determine if
        there is a device at that drive letter or not.  If there is a device at that drive letter,
-       then create a "fake" volume for it.
+       then keep the "fake" volume we already have for it, if it is still the same device, or
+       create a new "fake" volume for it.
+   5.  Delete the Volumes representing non-LVM devices which were not kept in step 4.
+
+Keeping the "fake" volumes for devices which have not changed means that their handles stay
+valid across a call to Refresh_LVM_Engine.
 
 When we are done, all Volumes should have the correct Current_Drive_Letter value.
 
 */
 
-  LOG_EVENT("Deleting all Volumes representing non-LVM devices (i.e. network, cdrom, etc.).")
+  LOG_EVENT("Finding all Volumes representing non-LVM devices (i.e. network, cdrom, etc.).")
 
-  /* Delete all of the volumes representing non-LVM devices. */
-  PruneList(Volumes, &Kill_Non_LVM_Device_Volumes,NULL, Error_Code );
+  /* Find all of the volumes representing non-LVM devices. */
+  memset( Non_LVM_Volumes, 0, sizeof(Non_LVM_Volumes) );
+  ForEachItem(Volumes, &Find_Non_LVM_Device_Volumes, Non_LVM_Volumes, TRUE, Error_Code );
 
 #ifdef DEBUG
 
@@ -10912,6 +11024,10 @@ When we are done, all Volumes should have the correct Current_Drive_Letter value
 
     }
 
+    /* Whatever is at this drive letter now, the "fake" volume we had for it goes unless we decide to keep it below. */
+    Old_Volume = Non_LVM_Volumes[Drive_Letter - 'A'];
+    Non_LVM_Volumes[Drive_Letter - 'A'] = NULL;
+
     /* Save the drive letter we are currently working with.  It may be needed later by the Update_Current_Drive_Letter function. */
     LVM_Data.IFSM_Drive_Letter = Drive_Letter;
     LVM_Data.LVM_Drive_Number = 0xFFFFFFFFL;
@@ -11023,6 +11139,53 @@ When we are done, all Volumes should have the correct Current_Drive_Letter value
       /* Extract the filesystem name from the query result. */
       Filesystem_Name = (char *) ( (CARDINAL32) &(QueryResult->szName) + QueryResult->cbName + 1);
 
+      /* Is the device at this drive letter the one we already have a "fake" volume for?  We will take it to be
+         the same device if the size and filesystem that the "fake" volume would be given are the same.          */
+      if ( Old_Volume != NULL )
+      {
+
+        if ( Query_Parms_Result == NO_ERROR )
+          Device_Size = DevParms.BPB.cLargeSectors;
+        else
+          Device_Size = 0;
+
+        if ( Query_Filesystem_Result == NO_ERROR )
+          Device_Filesystem = Filesystem_Name;
+        else
+          if ( ( Query_Parms_Result == NO_ERROR ) &&
+               ( DevParms.BPB.usBytesPerSector == 2048 ) &&
+               ( DevParms.BPB.usSectorsPerTrack == (unsigned short ) -1 ) &&
+               ( DevParms.BPB.bDeviceType == 7)
+             )
+            Device_Filesystem = "CDFS";
+          else
+            Device_Filesystem = "";
+
+        if ( ( Old_Volume->Volume_Size == Device_Size ) &&
+             ( strncmp( Old_Volume->File_System_Name, Device_Filesystem, FILESYSTEM_NAME_SIZE ) == 0 )
+           )
+        {
+
+          LOG_EVENT("The device attached to the current drive letter has not changed.  Keeping its fake volume.")
+
+          Non_LVM_Volumes[Drive_Letter - 'A'] = Old_Volume;
+
+          /* LAN drives reserve their drive letter.  See below. */
+          if ( Old_Volume->Device_Type == NETWORK_DRIVE )
+          {
+
+            Drive_Letter_Mask = 0x1;
+            Drive_Letter_Mask = Drive_Letter_Mask << ( Drive_Letter - 'A' );
+            Reserved_Drive_Letters = Reserved_Drive_Letters | Drive_Letter_Mask;
+
+          }
+
+          continue;
+
+        }
+
+      }
+
       /* We must create a "fake" volume for this drive letter.  The Volume name must be unique within the system! */
 
       LOG_EVENT("Creating a fake volume for the device attached to the current drive letter.")
@@ -11235,10 +11398,41 @@ When we are done, all Volumes should have the correct Current_Drive_Letter value
 
       }
 
+      /* The new "fake" volume is the one to keep for this drive letter. */
+      Non_LVM_Volumes[Drive_Letter - 'A'] = New_Volume;
+
     }
 
   }
 
+  LOG_EVENT("Deleting the Volumes representing non-LVM devices which have gone or changed.")
+
+  /* Delete the volumes representing non-LVM devices which we did not keep. */
+  PruneList(Volumes, &Kill_Non_LVM_Device_Volumes, Non_LVM_Volumes, Error_Code );
+
+#ifdef DEBUG
+
+#ifdef PARANOID
+
+        assert(*Error_Code == DLIST_SUCCESS);
+
+#else
+
+        if ( *Error_Code != DLIST_SUCCESS)
+        {
+
+          *Error_Code = LVM_ENGINE_INTERNAL_ERROR;
+
+          FUNCTION_EXIT("Reconcile_Drive_Letters")
+
+          return 0;
+
+        }
+
+#endif
+
+#endif
+
   LOG_EVENT("Determining the list of reserved drive letters.")
 
   /* Now we must determine the list of reserved drive letters.  All of the "fake" volumes created to represent things
@@ -23,9 +23,13 @@
 #include <stdlib.h>
 #include <config.h>
 #include <setjmp.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
 #include <netdb.h>
 #include <sys/types.h>
 #include <sys/file.h>
+#include <sys/time.h>
 
 #include <general.h>
 #include <tcp.h>
@@ -52,8 +56,10 @@ extern int default_error_handling (char *progname);
 /* Possible values of the "options" to finger. */
 #define INFO 0x02
 #define VERS 0x04
+#define CONC 0x08
 
 void call_finger ();
+void call_finger_concurrent ();
 extern char *baseprefix ();
 
 
@@ -65,6 +71,7 @@ usage (argc, argv)
   fprintf (stderr,
            "Usage: %s [-v] [--version] [-lim] [--info] [-f] [--faces]\n", baseprefix (*argv));
   fprintf (stderr, "       [-sb] [--brief] [-P port#] [--port port#] [-h] [--help]\n");
+  fprintf (stderr, "       [-c] [-t seconds]\n");
   fprintf (stderr, "       [user | user@host ...]\n");
   exit (1);
 }
@@ -78,6 +85,8 @@ help ()
   fputs ("-i, -l, -m,\tdisplay full user information\n", stderr);
   fputs ("-b, -s, \topposite of -i; only display login records\n", stderr);
   fputs ("-P,    #p\tconnect to finger daemon using port or service #p\n", stderr);
+  fputs ("-c, \t\tquery all the hosts at the same time\n", stderr);
+  fputs ("-t,    #s\tgive up on a host that is silent for #s seconds\n", stderr);
   fputs ("-h, \t\tdisplay this message\n", stderr);
   fputc ('\n', stderr);
 
@@ -108,7 +117,7 @@ default_error_handling (argv[0]);
   arg_index = 1;
   port = NULL;
 
-  while ((optc = getopt (argc, argv, "vfilmP:bsh")) > 0)
+  while ((optc = getopt (argc, argv, "vfilmP:bsct:h")) > 0)
     switch (optc)
       {
       case 'i':
@@ -134,6 +143,19 @@ default_error_handling (argv[0]);
         port = optarg;
         break;
 
+      case 'c':
+
+        options |= CONC;
+        break;
+
+      case 't':
+
+        connection_timeout_counter = atoi (optarg);
+        if (connection_timeout_counter <= 0)
+          usage (argc, argv);
+        allow_time_outs = 1;
+        break;
+
       case 'h':
 
         help ();
@@ -153,6 +175,8 @@ default_error_handling (argv[0]);
 
   if (optind >= argc)
     call_finger ("", options, port);
+  else if ((options & CONC) && argc - optind > 1)
+    call_finger_concurrent (argc - optind, argv + optind, options, port);
   else
     for (arg_index = optind; arg_index < argc; arg_index++)
       call_finger (argv[arg_index], options, port, arg_index,argc);
@@ -260,3 +284,318 @@ call_finger (arg, options, portnum, arg_ind, argcount)
 if (host && n_flag)
     free (host);
 }
+
+/* **************************************************************** */
+/*                                                                  */
+/*                      Concurrent Queries                          */
+/*                                                                  */
+/* **************************************************************** */
+
+/* With -c every user@host argument gets its own non-blocking
+   connection, and up to MAX_QUERIES of them are in progress at once.
+   The replies are collected in memory and printed in the order the
+   arguments were given, so the output looks the same as that of the
+   serial loop. */
+
+/* Number of queries in progress at the same time. */
+#define MAX_QUERIES 32
+
+/* What a query is doing. */
+#define Q_WAITING     0
+#define Q_CONNECTING  1
+#define Q_SENDING     2
+#define Q_READING     3
+#define Q_DONE        4
+
+typedef struct {
+  char *hostname;               /* Name to print in the [host] line. */
+  int suppress_hostname;        /* Non-zero for a query to this host. */
+  char *request;                /* Line sent to the finger daemon. */
+  int sent;                     /* Bytes of REQUEST sent so far. */
+  int connection;               /* Filedes, or -1. */
+  int state;                    /* One of the Q_ values. */
+  time_t deadline;              /* Give up when nothing happens by then. */
+  char *output;                 /* The reply, as received. */
+  int output_len, output_size;
+  int error;                    /* errno of the failure, or 0. */
+  char *error_text;             /* Failure that has no errno. */
+} QUERY;
+
+/* Append LEN bytes at DATA to the reply of QUERY. */
+static void
+query_output (query, data, len)
+  QUERY *query;
+  char *data;
+  int len;
+{
+  if (query->output_len + len > query->output_size)
+    {
+      while (query->output_len + len > query->output_size)
+        query->output_size = query->output_size ? query->output_size * 2 : 1024;
+      query->output = query->output
+        ? (char *) xrealloc (query->output, query->output_size)
+        : (char *) xmalloc (query->output_size);
+    }
+
+  bcopy (data, query->output + query->output_len, len);
+  query->output_len += len;
+}
+
+/* End QUERY, failed with ERROR if that is non-zero. */
+static void
+query_finish (query, error)
+  QUERY *query;
+  int error;
+{
+  if (query->connection >= 0)
+    close (query->connection);
+
+  query->connection = -1;
+  query->error = error;
+  query->state = Q_DONE;
+}
+
+/* Parse ARG into QUERY and start connecting to its host. */
+static void
+query_start (query, arg, options, portnum)
+  QUERY *query;
+  char *arg, *portnum;
+  long options;
+{
+  struct hostent *host;
+  char *username, *hostname, *t;
+  long addr;
+  int port;
+
+  username = savestring (arg);
+
+  for (t = username; *t && *t != '@'; t++);
+
+  hostname = NULL;
+  if (*t)
+    hostname = t + 1;
+  *t = '\0';
+
+  if (!hostname)
+    {
+      if (!(hostname = xgethostname ()))
+        hostname = "localhost";
+      query->suppress_hostname = 1;
+    }
+
+  query->request = (char *) xmalloc (6 + strlen (username));
+  sprintf (query->request, "%s%s\r\n",
+           (options & INFO) && *username ? "/W " : "", username);
+
+  query->hostname = savestring (hostname);
+
+  if (digit (*hostname))
+    {
+      addr = (long)inet_addr (hostname);
+      host = gethostbyaddr ((const char *) &addr, 4, AF_INET);
+      if (host)
+        {
+          free (query->hostname);
+          query->hostname = savestring (host->h_name);
+        }
+    }
+  else
+    {
+      host = gethostbyname (hostname);
+      if (!host)
+        {
+          free (username);
+          query->error_text = "unknown host";
+          query->state = Q_DONE;
+          return;
+        }
+
+      free (query->hostname);
+      query->hostname = savestring (host->h_name);
+      bcopy (host->h_addr, &addr, 4);
+    }
+
+  free (username);
+
+  port = tcp_service_port (portnum ? portnum : "finger");
+  if (port == -1)
+    {
+      query->error_text = "unknown service";
+      query->state = Q_DONE;
+      return;
+    }
+
+  query->connection = tcp_connect_start (port, (char *) &addr);
+  if (query->connection < 0)
+    {
+      query_finish (query, errno);
+      return;
+    }
+
+  query->state = Q_CONNECTING;
+  query->deadline = time ((time_t *)NULL) + connection_timeout_counter;
+}
+
+/* Print the result of QUERY the way call_finger () would have. */
+static void
+query_print (query)
+  QUERY *query;
+{
+  char *p, *end;
+
+  if (!query->suppress_hostname)
+    printf ("[%s]\n", query->hostname);
+  fflush (stdout);
+
+  if (query->error || query->error_text)
+    {
+      handle_error (WARNING, "%s: %s", query->hostname,
+                    query->error_text ? query->error_text
+                                      : strerror (query->error));
+      return;
+    }
+
+  /* Drop the carriage returns the daemon puts before newlines. */
+  end = query->output + query->output_len;
+  for (p = query->output; p < end; p++)
+    if (*p != '\r' || p + 1 >= end || p[1] != '\n')
+      putc (*p, stdout);
+  fflush (stdout);
+}
+
+/* Finger the COUNT user@host arguments in ARGS at the same time. */
+void
+call_finger_concurrent (count, args, options, portnum)
+  int count;
+  char **args, *portnum;
+  long options;
+{
+  QUERY *queries;
+  fd_set reads, writes;
+  struct timeval timeout;
+  char buffer[4096];
+  int next_start, next_print, active, maxfd, i, n, len;
+  time_t now;
+
+  queries = (QUERY *) xmalloc (count * sizeof (QUERY));
+  bzero (queries, count * sizeof (QUERY));
+  for (i = 0; i < count; i++)
+    queries[i].connection = -1;
+
+  next_start = next_print = active = 0;
+
+  while (next_print < count)
+    {
+      /* Keep MAX_QUERIES connections going. */
+      while (next_start < count && active < MAX_QUERIES)
+        {
+          query_start (&queries[next_start], args[next_start],
+                       options, portnum);
+          if (queries[next_start].state != Q_DONE)
+            active++;
+          next_start++;
+        }
+
+      /* Print whatever is complete, in argument order. */
+      while (next_print < count && queries[next_print].state == Q_DONE)
+        {
+          query_print (&queries[next_print]);
+          free (queries[next_print].output);
+          free (queries[next_print].request);
+          free (queries[next_print].hostname);
+          next_print++;
+        }
+
+      if (!active)
+        continue;
+
+      FD_ZERO (&reads);
+      FD_ZERO (&writes);
+      maxfd = -1;
+      for (i = next_print; i < next_start; i++)
+        {
+          QUERY *query = &queries[i];
+
+          if (query->state == Q_CONNECTING || query->state == Q_SENDING)
+            FD_SET (query->connection, &writes);
+          else if (query->state == Q_READING)
+            FD_SET (query->connection, &reads);
+          else
+            continue;
+
+          if (query->connection > maxfd)
+            maxfd = query->connection;
+        }
+
+      timeout.tv_sec = 1;
+      timeout.tv_usec = 0;
+      n = select (maxfd + 1, &reads, &writes, (fd_set *)NULL, &timeout);
+      if (n < 0 && errno != EINTR)
+        file_error (FATAL, "select");
+
+      now = time ((time_t *)NULL);
+
+      for (i = next_print; i < next_start; i++)
+        {
+          QUERY *query = &queries[i];
+
+          if (query->state == Q_DONE)
+            continue;
+
+          if (n > 0 && FD_ISSET (query->connection, &writes))
+            {
+              if (query->state == Q_CONNECTING)
+                {
+                  if (tcp_connect_status (query->connection) < 0)
+                    {
+                      query_finish (query, errno);
+                      active--;
+                      continue;
+                    }
+                  query->state = Q_SENDING;
+                }
+
+              len = strlen (query->request) - query->sent;
+              len = send (query->connection, query->request + query->sent,
+                          len, 0);
+              if (len < 0 && errno != EWOULDBLOCK)
+                {
+                  query_finish (query, errno);
+                  active--;
+                  continue;
+                }
+              if (len > 0)
+                query->sent += len;
+              if (!query->request[query->sent])
+                query->state = Q_READING;
+              query->deadline = now + connection_timeout_counter;
+            }
+          else if (n > 0 && FD_ISSET (query->connection, &reads))
+            {
+              len = recv (query->connection, buffer, sizeof (buffer), 0);
+              if (len < 0 && errno != EWOULDBLOCK)
+                {
+                  query_finish (query, errno);
+                  active--;
+                  continue;
+                }
+              if (len == 0)
+                {
+                  query_finish (query, 0);
+                  active--;
+                  continue;
+                }
+              if (len > 0)
+                query_output (query, buffer, len);
+              query->deadline = now + connection_timeout_counter;
+            }
+          else if (now > query->deadline)
+            {
+              query_finish (query, ETIMEDOUT);
+              active--;
+            }
+        }
+    }
+
+  free (queries);
+}
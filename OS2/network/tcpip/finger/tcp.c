@@ -29,7 +29,9 @@
 #include <arpa/inet.h>
 #endif
 
-#include <signal.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/ioctl.h>
 
 #include <tcp.h>
 #include <general.h>
@@ -57,17 +59,48 @@ int connection_timeout_counter = TIME_OUT;
    succeed, instead of whatever the infernal network code allows. */
 int allow_time_outs = 0;
 
-/* Open a filedes to SERVICE at ADDRESS.  If SERVICE is the name of a
-   service, then it must exist on the local machine.  SERVICE can also
-   be the ASCII representation of a decimal number, in which case it is
-   interpreted as the port number to connect to.  Returns a valid file
-   descriptor if successful, or -1 if not. */
+/* Return the port number, in network byte order, of SERVICE, or -1
+   if there is no such service.  SERVICE is either the name of a TCP
+   service known to the local machine or the ASCII representation of
+   a decimal port number. */
 int
-tcp_to_service (service, address)
+tcp_service_port (service)
   char *service;
-  char *address;
 {
   struct servent *server;
+
+  if (strcmp (service, "cfinger") == 0)
+    return (htons (2003));
+
+  if (digit (*service))
+    return (htons (atoi (service)));
+
+  server = getservbyname (service, "tcp");
+  if (!server)
+    return (-1);
+
+  return (server->s_port);
+}
+
+/* Make CONNECTION non-blocking if ON is non-zero, blocking otherwise.
+   Returns -1 on failure. */
+int
+tcp_set_nonblocking (connection, on)
+  int connection, on;
+{
+  return (ioctl (connection, FIONBIO, (char *)&on));
+}
+
+/* Start connecting to PORT (network byte order) at ADDRESS without
+   waiting for the connection to be made.  Returns a non-blocking
+   filedes, or -1.  The connect has finished once tcp_wait () reports
+   the filedes writable; tcp_connect_status () then tells whether it
+   succeeded. */
+int
+tcp_connect_start (port, address)
+  int port;
+  char *address;
+{
   struct sockaddr_in name;
   int connection;
 
@@ -75,61 +108,135 @@ tcp_to_service (service, address)
   bzero (&name, sizeof (name));
 
   name.sin_family = AF_INET;
+  name.sin_port = port;
   bcopy (address, &name.sin_addr.s_addr, 4);
 
+  /* Make a new socket. */
+  connection = socket (PF_INET, SOCK_STREAM, IP);
+
+  if (connection < 0)
+    return (-1);
+
+  if (tcp_set_nonblocking (connection, 1) < 0
+      || (connect (connection, (struct sockaddr *)&name, sizeof (name)) < 0
+          && errno != EINPROGRESS))
+    {
+      close (connection);
+      return (-1);
+    }
+
+  return (connection);
+}
+
+/* Return 0 if the connect started on CONNECTION by tcp_connect_start ()
+   succeeded, or -1 with errno set to the reason it failed. */
+int
+tcp_connect_status (connection)
+  int connection;
+{
+  int error = 0, len = sizeof (error);
+
+  if (getsockopt (connection, SOL_SOCKET, SO_ERROR, (char *)&error, &len) < 0)
+    return (-1);
+
+  if (error)
+    {
+      errno = error;
+      return (-1);
+    }
+
+  return (0);
+}
+
+/* Wait at most SECONDS for CONNECTION to become writable if FOR_WRITE
+   is non-zero, readable otherwise.  A negative SECONDS waits forever.
+   Returns 1 when the filedes is ready, 0 on time out and -1 on error. */
+int
+tcp_wait (connection, for_write, seconds)
+  int connection, for_write, seconds;
+{
+  fd_set fds;
+  struct timeval timeout;
+
+  FD_ZERO (&fds);
+  FD_SET (connection, &fds);
+
+  timeout.tv_sec = seconds;
+  timeout.tv_usec = 0;
+
+  return (select (connection + 1,
+                  for_write ? (fd_set *)NULL : &fds,
+                  for_write ? &fds : (fd_set *)NULL,
+                  (fd_set *)NULL,
+                  seconds < 0 ? (struct timeval *)NULL : &timeout));
+}
+
+/* Open a filedes to SERVICE at ADDRESS.  If SERVICE is the name of a
+   service, then it must exist on the local machine.  SERVICE can also
+   be the ASCII representation of a decimal number, in which case it is
+   interpreted as the port number to connect to.  Returns a valid file
+   descriptor if successful, or -1 if not. */
+int
+tcp_to_service (service, address)
+  char *service;
+  char *address;
+{
+  struct sockaddr_in name;
+  int connection, port;
+
   /* Find the port to use for the requested service. */
-  if (strcmp (service, "cfinger") == 0)
-    name.sin_port = htons (2003);
-  else if (digit (*service))
-    name.sin_port = htons (atoi (service));
-  else
+  port = tcp_service_port (service);
+  if (port == -1)
+    return (-1);
+
+  /* Connect to the desired port.  We have a shorter timeout than
+     the connect call uses by default. */
+  if (allow_time_outs)
     {
-      server = getservbyname (service, "tcp");
-      if (!server)
+      connection = tcp_connect_start (port, address);
+
+      if (connection < 0)
         return (-1);
-      name.sin_port = server->s_port;
+
+      if (tcp_wait (connection, 1, connection_timeout_counter) <= 0)
+        {
+          close (connection);
+          errno = ETIMEDOUT;
+          return (-1);
+        }
+
+      if (tcp_connect_status (connection) < 0
+          || tcp_set_nonblocking (connection, 0) < 0)
+        {
+          close (connection);
+          return (-1);
+        }
+
+      return (connection);
     }
 
+  /* Prepare the socket name for binding. */
+  bzero (&name, sizeof (name));
+
+  name.sin_family = AF_INET;
+  name.sin_port = port;
+  bcopy (address, &name.sin_addr.s_addr, 4);
+
   /* Make a new socket. */
   connection = socket (PF_INET, SOCK_STREAM, IP);
 
   if (connection < 0)
     return (-1);
 
-  /* Connect to the desired port.  We have a shorter timeout than
-     the connect call uses by default. */
-  {
-    int error;
-    void connect_timed_out ();
-
-    if (allow_time_outs)
-      {
-        signal (SIGALRM, connect_timed_out);
-        alarm (TIME_OUT);
-        error = connect (connection, &name, sizeof (name));
-        alarm (0);
-        signal (SIGALRM, SIG_DFL);
-      }
-    else
-      error = connect (connection, &name, sizeof (name));
-
-    if (error < 0)
-      {
-        close (connection);
-        return (-1);
-      }
-  }
-
+  if (connect (connection, (struct sockaddr *)&name, sizeof (name)) < 0)
+    {
+      close (connection);
+      return (-1);
+    }
 
   return (connection);
 }
 
-void
-connect_timed_out ()
-{
-  alarm (0);
-}
-
 
 /* Compare hosts for equality: returns non-zero if HOST1 is the same
    as HOST2.  They are considered the same either if they have
@@ -31,8 +31,24 @@
 
 #ifdef __STDC__
 extern int host_cmp (char *, char *);
+extern int tcp_to_service (char *, char *);
+extern int tcp_service_port (char *);
+extern int tcp_set_nonblocking (int, int);
+extern int tcp_connect_start (int, char *);
+extern int tcp_connect_status (int);
+extern int tcp_wait (int, int, int);
 #else
 extern int host_cmp ();
+extern int tcp_to_service ();
+extern int tcp_service_port ();
+extern int tcp_set_nonblocking ();
+extern int tcp_connect_start ();
+extern int tcp_connect_status ();
+extern int tcp_wait ();
 #endif
 
+/* Seconds allowed for a connect (), and whether to enforce them. */
+extern int connection_timeout_counter;
+extern int allow_time_outs;
+
 #endif /* _TCP_H_ */
@@ -91,6 +91,7 @@
   #include <netinet/ip_icmp.h>
   #include <sys/socket.h>
   #include <sys/select.h>
+  #include <sys/ioctl.h>
 //  #include <unistd.h>
   #include <netdb.h>
   #include <nerrno.h>
@@ -240,7 +241,7 @@ APIRET ToolsPerfQuery(double *ps)
 
   x = x / (double)f;
 
-  ps= &x;
+  *ps = x;
 
   return NO_ERROR;
 }
@@ -283,14 +284,20 @@ typedef struct
   char fsOptionNoRouting;                        /* bypass routing tables */
   char fsOptionVerbose;                                   /* verbose mode */
   char fsOptionDumpIP;                                    /* dump IP hdr  */
+  char fsHosts;                                  /* list of targets given */
+  char fsInflight;                             /* probes in flight given */
+  char fsWait;                                     /* reply timeout given */
 
   ULONG   ulSend;                               /* number of packets to send */
   ULONG   ulInterval;                                /* time between packets */
   ULONG   ulPreload;                                              /* preload */
   USHORT  usSize;                                             /* packet size */
   UCHAR   ucTTL;                                             /* time to live */
+  ULONG   ulInflight;                 /* max. echo requests out with /HOSTS */
+  ULONG   ulWait;                            /* reply timeout in ms, /HOSTS */
 
   PSZ     pszHost;                        /* start with this base IP address */
+  PSZ     pszHosts;                 /* file with one target host per line */
 } OPTIONS, *POPTIONS;
 
 
@@ -394,10 +401,15 @@ lastpar{"/PACKETS=",  "Number of packets to transmit.",
 predlast{"/SIZE=",     "Packet size.",       &Options.usSize,      ARG_USHORT,     &Options.fsSize},
 -v{"/VERBOSE",   "Verbose mode.",      NULL,                 ARG_NULL,       &Options.fsOptionVerbose},
   {"/TTL=",      "Time to live.",      &Options.ucTTL,       ARG_UCHAR,      &Options.fsTTL},
+  {"/HOSTS=",    "Ping all hosts listed in this file.",
+                                       &Options.pszHosts,    ARG_PSZ,        &Options.fsHosts},
+  {"/INFLIGHT=", "Echo requests in flight with /HOSTS.",
+                                       &Options.ulInflight,  ARG_ULONG,      &Options.fsInflight},
+  {"/WAIT=",     "Reply timeout with /HOSTS (ms).",
+                                       &Options.ulWait,      ARG_ULONG,      &Options.fsWait},
   {"1",          "Start with this "
                  "IP address.",        &Options.pszHost,     ARG_PSZ     |
-                                                             ARG_DEFAULT |
-                                                             ARG_MUST,       &Options.fsHost},
+                                                             ARG_DEFAULT,    &Options.fsHost},
   ARG_TERMINATE
 };
 
@@ -420,6 +432,8 @@ void   help                  (void);
 
 APIRET NetPing               (void);
 
+APIRET NetPingMulti          (void);
+
 char   *pr_addr              (u_long);
 
 int    in_cksum              (u_short *addr,
@@ -1514,6 +1528,565 @@ void PacketFill(void *bp1,
 }
 
 
+/*****************************************************************************
+ * Multi-target mode                                                         *
+ *                                                                           *
+ * With /HOSTS= every host listed in the file is pinged over the one raw     *
+ * socket, with up to /INFLIGHT= echo requests outstanding at a time.  The   *
+ * sequence number of a request is the index of its probe slot plus a        *
+ * generation count, so a reply finds its probe directly and a late reply    *
+ * to a reused slot is ignored.  Reply timeouts and the /INTERVAL= wait      *
+ * before the next probe to the same host are kept on a timer wheel.         *
+ *****************************************************************************/
+
+#define MULTI_SLOTBITS    12
+#define MULTI_MAXSLOTS    (1 << MULTI_SLOTBITS)   /* max. probes in flight */
+#define MULTI_INFLIGHT    256                    /* default probes in flight */
+#define MULTI_COUNT       3                        /* default probes per host */
+#define MULTI_WAIT        1000                    /* default reply timeout ms */
+#define WHEEL_TICK        10                      /* ms per timer wheel slot */
+#define WHEEL_SIZE        1024                          /* slots, about 10 s */
+
+#define TIMER_PROBE       1                               /* reply timeout */
+#define TIMER_TARGET      2                       /* next probe to a target */
+
+typedef struct _TIMER
+{
+  struct _TIMER *pNext;                              /* list of wheel slot */
+  struct _TIMER *pPrev;
+  ULONG          ulExpire;                          /* tick it expires at */
+  UCHAR          ucKind;                         /* TIMER_PROBE or _TARGET */
+} TIMER, *PTIMER;
+
+typedef struct _TARGET
+{
+  TIMER          Timer;                             /* must be first member */
+  struct in_addr Addr;                                     /* host address */
+  PSZ            pszName;                           /* name as in the file */
+  ULONG          ulSent;                            /* echo requests sent */
+  ULONG          ulReceived;                        /* echo replies received */
+  ULONG          ulUnreach;                   /* ICMP unreachable received */
+  double         fTimeMin;                        /* round trip times (ms) */
+  double         fTimeMax;
+  double         fTimeSum;
+  struct _TARGET *pNextReady;                        /* ready to send queue */
+} TARGET, *PTARGET;
+
+typedef struct _PROBE
+{
+  TIMER          Timer;                             /* must be first member */
+  PTARGET        pTarget;                      /* NULL while slot is free */
+  USHORT         usGeneration;              /* bumped on each use of slot */
+  double         fSent;                         /* time the request was sent */
+} PROBE, *PPROBE;
+
+typedef struct
+{
+  PTARGET  pTargets;                                /* hosts, in file order */
+  ULONG    ulTargets;
+  ULONG    ulDone;                      /* hosts with all probes answered */
+  PTARGET  pReadyHead;                        /* hosts waiting to be probed */
+  PTARGET  pReadyTail;
+  PPROBE   pProbes;                                          /* probe slots */
+  USHORT  *pusFree;                               /* stack of free slots */
+  ULONG    ulFree;
+  ULONG    ulInflight;                                /* slots in use */
+  ULONG    ulCount;                                    /* probes per host */
+  ULONG    ulWaitTicks;                            /* reply timeout, ticks */
+  ULONG    ulIntervalTicks;                 /* wait between probes, ticks */
+  ULONG    ulNow;                              /* current wheel tick */
+  TIMER    Wheel[WHEEL_SIZE];                      /* list heads of slots */
+  u_char   Packet[MAXPACKET];                      /* outgoing echo request */
+} MULTI;
+
+MULTI Multi;
+
+
+/***********************************************************************
+ * Name      : ULONG MultiTick
+ * Funktion  : current time in timer wheel ticks
+ ***********************************************************************/
+
+static ULONG MultiTick(void)
+{
+  ULONG ulMs;
+
+  DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ulMs, sizeof(ulMs));
+  return (ulMs / WHEEL_TICK);
+}
+
+
+static void TimerAdd(PTIMER pTimer,
+                     ULONG  ulExpire)
+{
+  PTIMER pHead = &Multi.Wheel[ulExpire % WHEEL_SIZE];
+
+  pTimer->ulExpire = ulExpire;
+  pTimer->pNext = pHead->pNext;
+  pTimer->pPrev = pHead;
+  pHead->pNext->pPrev = pTimer;
+  pHead->pNext = pTimer;
+}
+
+
+static void TimerRemove(PTIMER pTimer)
+{
+  pTimer->pPrev->pNext = pTimer->pNext;
+  pTimer->pNext->pPrev = pTimer->pPrev;
+  pTimer->pNext = pTimer->pPrev = pTimer;
+}
+
+
+static void MultiReady(PTARGET pTarget)
+{
+  pTarget->pNextReady = NULL;
+  if (Multi.pReadyTail)
+    Multi.pReadyTail->pNextReady = pTarget;
+  else
+    Multi.pReadyHead = pTarget;
+  Multi.pReadyTail = pTarget;
+}
+
+
+/***********************************************************************
+ * Name      : void MultiProbeDone
+ * Funktion  : free a probe slot once answered or timed out and
+ *             schedule the next probe to its host
+ ***********************************************************************/
+
+static void MultiProbeDone(PPROBE pProbe)
+{
+  PTARGET pTarget = pProbe->pTarget;
+
+  TimerRemove(&pProbe->Timer);
+  pProbe->pTarget = NULL;
+  Multi.pusFree[Multi.ulFree++] = (USHORT)(pProbe - Multi.pProbes);
+  Multi.ulInflight--;
+
+  if (pTarget->ulSent >= Multi.ulCount)
+    Multi.ulDone++;
+  else
+    if (Multi.ulIntervalTicks)
+      TimerAdd(&pTarget->Timer,
+               Multi.ulNow + Multi.ulIntervalTicks);
+    else
+      MultiReady(pTarget);
+}
+
+
+/***********************************************************************
+ * Name      : void MultiSend
+ * Funktion  : send an echo request to the host in a free probe slot
+ ***********************************************************************/
+
+static void MultiSend(PTARGET pTarget)
+{
+  struct icmp        *icp = (struct icmp *)Multi.Packet;
+  struct sockaddr_in to;
+  PPROBE             pProbe;
+  USHORT             usSlot;
+  int                cc;
+  int                i;
+
+  usSlot = Multi.pusFree[--Multi.ulFree];
+  pProbe = &Multi.pProbes[usSlot];
+  pProbe->pTarget = pTarget;
+  pProbe->usGeneration++;
+  Multi.ulInflight++;
+  pTarget->ulSent++;
+
+  icp->icmp_type  = ICMP_ECHO;
+  icp->icmp_code  = 0;
+  icp->icmp_cksum = 0;
+  icp->icmp_id    = Globals.pidIdentifier;
+  icp->icmp_seq   = (USHORT)((pProbe->usGeneration << MULTI_SLOTBITS) | usSlot);
+  cc = Options.usSize + 8;
+  icp->icmp_cksum = in_cksum((u_short *)icp, cc);
+
+  memset(&to, 0, sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_addr   = pTarget->Addr;
+
+  ToolsPerfQuery(&pProbe->fSent);
+  TimerAdd(&pProbe->Timer,
+           Multi.ulNow + Multi.ulWaitTicks);
+
+  i = sendto(Globals.sockPing,
+             (char *)Multi.Packet,
+             cc,
+             0,
+             (struct sockaddr *)&to,
+             sizeof(to));
+  if (i != cc)                           /* counts as lost, try the next one */
+  {
+    if (Options.fsOptionVerbose)
+      psock_errno("sendto");
+    MultiProbeDone(pProbe);
+  }
+  else
+    Globals.fBytesSent += i;
+}
+
+
+/***********************************************************************
+ * Name      : void MultiReply
+ * Funktion  : match a received ICMP packet to its probe
+ ***********************************************************************/
+
+static void MultiReply(char               *buf,
+                       int                cc,
+                       struct sockaddr_in *from)
+{
+  struct ip   *ip = (struct ip *)buf;
+  struct ip   *hip;
+  struct icmp *icp;
+  PPROBE      pProbe;
+  PTARGET     pTarget;
+  double      fNow;
+  double      fTriptime;
+  int         hlen = ip->ip_hl << 2;
+  USHORT      usSeq;
+
+  if (cc < hlen + ICMP_MINLEN)
+    return;
+  cc -= hlen;
+  icp = (struct icmp *)(buf + hlen);
+
+  switch (icp->icmp_type)
+  {
+    case ICMP_ECHOREPLY:
+      if (icp->icmp_id != Globals.pidIdentifier)
+      {
+        Globals.ulPktReceivedForeign++;
+        return;
+      }
+      usSeq = icp->icmp_seq;
+      break;
+
+    case ICMP_UNREACH:           /* carries the header of our echo request */
+    case ICMP_TIMXCEED:
+      hip = &icp->icmp_ip;
+      hlen = hip->ip_hl << 2;
+      if (cc < 8 + hlen + 8 || hip->ip_p != IPPROTO_ICMP)
+        return;
+      icp = (struct icmp *)((u_char *)hip + hlen);
+      if (icp->icmp_type != ICMP_ECHO ||
+          icp->icmp_id != Globals.pidIdentifier)
+        return;
+      usSeq = icp->icmp_seq;
+      icp = NULL;
+      break;
+
+    default:
+      return;
+  }
+
+  pProbe = &Multi.pProbes[usSeq & (MULTI_MAXSLOTS - 1)];
+  pTarget = pProbe->pTarget;
+  if (pTarget == NULL ||                              /* late or duplicate */
+      (USHORT)(pProbe->usGeneration << MULTI_SLOTBITS) !=
+      (USHORT)(usSeq & ~(MULTI_MAXSLOTS - 1)))
+  {
+    Globals.ulPktDuplicate++;
+    return;
+  }
+
+  if (icp == NULL)
+    pTarget->ulUnreach++;
+  else
+  {
+    if (from->sin_addr.s_addr != pTarget->Addr.s_addr)
+    {
+      Globals.ulPktReceivedForeign++;
+      return;
+    }
+
+    ToolsPerfQuery(&fNow);
+    fTriptime = (fNow - pProbe->fSent) * 1000.0;
+    if (pTarget->ulReceived == 0 || fTriptime < pTarget->fTimeMin)
+      pTarget->fTimeMin = fTriptime;
+    if (fTriptime > pTarget->fTimeMax)
+      pTarget->fTimeMax = fTriptime;
+    pTarget->fTimeSum += fTriptime;
+    pTarget->ulReceived++;
+    Globals.ulPktReceived++;
+  }
+
+  MultiProbeDone(pProbe);
+}
+
+
+/***********************************************************************
+ * Name      : void MultiTimers
+ * Funktion  : run the timer wheel up to the current tick
+ ***********************************************************************/
+
+static void MultiTimers(void)
+{
+  ULONG  ulTick = MultiTick();
+  PTIMER pHead;
+  PTIMER pTimer;
+  PTIMER pNext;
+
+  for (;
+       Multi.ulNow != ulTick;
+       )
+  {
+    Multi.ulNow++;
+    pHead = &Multi.Wheel[Multi.ulNow % WHEEL_SIZE];
+
+    for (pTimer = pHead->pNext;
+         pTimer != pHead;
+         pTimer = pNext)
+    {
+      pNext = pTimer->pNext;
+      if (pTimer->ulExpire != Multi.ulNow)       /* a later turn of the wheel */
+        continue;
+
+      if (pTimer->ucKind == TIMER_PROBE)                      /* no answer */
+        MultiProbeDone((PPROBE)pTimer);
+      else
+      {
+        TimerRemove(pTimer);
+        MultiReady((PTARGET)pTimer);
+      }
+    }
+  }
+}
+
+
+static void MultiBreak(int ignore)
+{
+  Globals.fThreadQuit = TRUE;
+}
+
+
+/***********************************************************************
+ * Name      : APIRET MultiLoad
+ * Funktion  : read the target list, one host name or address per line
+ ***********************************************************************/
+
+static APIRET MultiLoad(PSZ pszFile)
+{
+  FILE           *pFile;
+  struct hostent *pHostEntry;
+  char           szLine[256];
+  char           *p;
+  char           *q;
+  ULONG          ulMax = 0;
+  PTARGET        pTarget;
+
+  pFile = fopen(pszFile, "r");
+  if (pFile == NULL)
+  {
+    fprintf(stderr, "ping: can't open %s\n", pszFile);
+    exit(2);
+  }
+
+  while (fgets(szLine, sizeof(szLine), pFile))
+  {
+    for (p = szLine; isspace(*p); p++)
+      ;
+    if (*p == '\0' || *p == '#' || *p == ';')
+      continue;
+    for (q = p; *q && !isspace(*q); q++)
+      ;
+    *q = '\0';
+
+    if (Multi.ulTargets == ulMax)
+    {
+      ulMax = ulMax ? ulMax * 2 : 256;
+      Multi.pTargets = realloc(Multi.pTargets, ulMax * sizeof(TARGET));
+      if (Multi.pTargets == NULL)
+      {
+        fprintf(stderr, "ping: out of memory.\n");
+        exit(2);
+      }
+    }
+
+    pTarget = &Multi.pTargets[Multi.ulTargets];
+    memset(pTarget, 0, sizeof(TARGET));
+    pTarget->Timer.ucKind = TIMER_TARGET;
+    pTarget->pszName = strdup(p);
+
+    pTarget->Addr.s_addr = inet_addr(p);
+    if (pTarget->Addr.s_addr == -1)
+    {
+      pHostEntry = gethostbyname(p);
+      if (!pHostEntry)
+      {
+        fprintf(stderr, "ping: unknown host %s\n", p);
+        continue;
+      }
+      memcpy(&pTarget->Addr, pHostEntry->h_addr, sizeof(pTarget->Addr));
+    }
+    Multi.ulTargets++;
+  }
+  fclose(pFile);
+
+  return (NO_ERROR);
+}
+
+
+/***********************************************************************
+ * Name      : APIRET NetPingMulti
+ * Funktion  : ping all hosts of the /HOSTS= file and print one
+ *             summary line per host
+ ***********************************************************************/
+
+APIRET NetPingMulti(void)
+{
+  struct protoent    *proto;
+  struct sockaddr_in from;
+  PTARGET            pTarget;
+  char               *packet;
+  int                packlen;
+  int                fromlen;
+  int                cc;
+  int                hold;
+  ULONG              ulCounter;
+  ULONG              ulSlots;
+  ULONG              ulAlive = 0;
+
+  MultiLoad(Options.pszHosts);
+  if (Multi.ulTargets == 0)
+  {
+    fprintf(stderr, "ping: no hosts in %s\n", Options.pszHosts);
+    exit(2);
+  }
+
+  proto = getprotobyname("icmp");
+  if (proto == NULL)
+    return (ERROR_IP_UNKNOWN_PROTOCOL);
+
+  Globals.sockPing = socket(AF_INET, SOCK_RAW, proto->p_proto);
+  if (Globals.sockPing < 0)
+    return (sockErrno);
+
+  hold = 256 * 1024;                   /* room for a burst of replies */
+  setsockopt(Globals.sockPing,
+             SOL_SOCKET,
+             SO_RCVBUF,
+             (char *)&hold,
+             sizeof(hold));
+  hold = 1;
+  if (ioctl(Globals.sockPing, FIONBIO, (char *)&hold, sizeof(hold)) < 0)
+    return (ERROR_IP_SOCKET_ERROR);
+
+  Multi.ulCount = Options.fsSend ? Options.ulSend : MULTI_COUNT;
+  ulSlots = Options.fsInflight ? Options.ulInflight : MULTI_INFLIGHT;
+  if (ulSlots < 1)              ulSlots = 1;
+  if (ulSlots > MULTI_MAXSLOTS) ulSlots = MULTI_MAXSLOTS;
+  Multi.ulWaitTicks = (Options.fsWait ? Options.ulWait : MULTI_WAIT) / WHEEL_TICK;
+  if (Multi.ulWaitTicks < 1)              Multi.ulWaitTicks = 1;
+  if (Multi.ulWaitTicks >= WHEEL_SIZE)    Multi.ulWaitTicks = WHEEL_SIZE - 1;
+  Multi.ulIntervalTicks = Options.ulInterval / WHEEL_TICK;
+  if (Multi.ulIntervalTicks >= WHEEL_SIZE) Multi.ulIntervalTicks = WHEEL_SIZE - 1;
+
+  Multi.pProbes = calloc(MULTI_MAXSLOTS, sizeof(PROBE));
+  Multi.pusFree = malloc(ulSlots * sizeof(USHORT));
+  packlen = Options.usSize + MAXIPLEN + MAXICMPLEN;
+  packet = malloc(packlen);
+  if (!Multi.pProbes || !Multi.pusFree || !packet)
+  {
+    fprintf(stderr, "ping: out of memory.\n");
+    exit(2);
+  }
+  for (ulCounter = 0; ulCounter < ulSlots; ulCounter++)
+  {
+    Multi.pusFree[Multi.ulFree++] = (USHORT)(ulSlots - 1 - ulCounter);
+    Multi.pProbes[ulCounter].Timer.ucKind = TIMER_PROBE;
+  }
+  for (ulCounter = 0; ulCounter < WHEEL_SIZE; ulCounter++)
+    Multi.Wheel[ulCounter].pNext =
+    Multi.Wheel[ulCounter].pPrev = &Multi.Wheel[ulCounter];
+  for (ulCounter = 8; ulCounter < Options.usSize + 8; ulCounter++)
+    Multi.Packet[ulCounter] = (u_char)ulCounter;
+
+  Globals.pidIdentifier = getpid() & 0xFFFF;
+  for (ulCounter = 0; ulCounter < Multi.ulTargets; ulCounter++)
+    MultiReady(&Multi.pTargets[ulCounter]);
+
+  printf("PING %lu hosts, %lu probes each, %lu in flight, %lu ms timeout\n",
+         Multi.ulTargets,
+         Multi.ulCount,
+         ulSlots,
+         Multi.ulWaitTicks * WHEEL_TICK);
+  fflush(stdout);
+
+  signal(SIGINT, MultiBreak);
+  Multi.ulNow = MultiTick();
+  ToolsPerfQuery(&Globals.psSendStart);
+
+  while (Multi.ulDone < Multi.ulTargets &&
+         Globals.fThreadQuit == FALSE)
+  {
+    while (Multi.pReadyHead && Multi.ulFree)
+    {
+      pTarget = Multi.pReadyHead;
+      Multi.pReadyHead = pTarget->pNextReady;
+      if (Multi.pReadyHead == NULL)
+        Multi.pReadyTail = NULL;
+      MultiSend(pTarget);
+    }
+
+    if (select(&Globals.sockPing, 1, 0, 0, WHEEL_TICK) > 0)
+      for (;;)                               /* drain what has arrived */
+      {
+        fromlen = sizeof(from);
+        cc = recvfrom(Globals.sockPing,
+                      packet,
+                      packlen,
+                      0,
+                      (struct sockaddr *)&from,
+                      &fromlen);
+        if (cc <= 0)
+          break;
+        Globals.fBytesReceived += cc;
+        MultiReply(packet, cc, &from);
+      }
+
+    MultiTimers();
+  }
+
+  ToolsPerfQuery(&Globals.psSendEnd);
+  soclose(Globals.sockPing);
+
+  for (ulCounter = 0; ulCounter < Multi.ulTargets; ulCounter++)
+  {
+    pTarget = &Multi.pTargets[ulCounter];
+    printf("%-24s %-15s %3lu/%-3lu",
+           pTarget->pszName,
+           inet_ntoa(pTarget->Addr),
+           pTarget->ulReceived,
+           pTarget->ulSent);
+
+    if (pTarget->ulReceived)
+    {
+      ulAlive++;
+      printf(" %3lu%% loss  %.3f/%.3f/%.3f ms\n",
+             (pTarget->ulSent - pTarget->ulReceived) * 100 / pTarget->ulSent,
+             pTarget->fTimeMin,
+             pTarget->fTimeSum / pTarget->ulReceived,
+             pTarget->fTimeMax);
+    }
+    else
+      printf(pTarget->ulUnreach ? "  unreachable\n" : "  no answer\n");
+  }
+
+  printf("--- %lu hosts, %lu alive, %lu down, %.3f s ---\n",
+         Multi.ulTargets,
+         ulAlive,
+         Multi.ulTargets - ulAlive,
+         Globals.psSendEnd - Globals.psSendStart);
+
+  if (ulAlive == 0)
+    exit(1);
+
+  return (NO_ERROR);
+}
+
+
 /***********************************************************************
  * Name      : void initialize
  * Funktion  : Initialisierung einiger Variablen
@@ -1583,7 +2156,8 @@ int main (int argc, char *argv[])
     exit(1);                                                /* abort program */
   }
 
-  if ( Options.fsHelp )                                /* user requests help */
+  if ( Options.fsHelp ||                             /* user requests help */
+       (!Options.fsHost && !Options.fsHosts) )
   {
     help();
     ArgHelp(TabArguments);
@@ -1598,7 +2172,10 @@ int main (int argc, char *argv[])
              0);
 
                                            /* perform some parameter mapping */
-  rc = NetPing();                                    /* let's ping again ... */
+  if (Options.fsHosts)
+    rc = NetPingMulti();                         /* many hosts in parallel */
+  else
+    rc = NetPing();                                  /* let's ping again ... */
   if (rc != NO_ERROR)
     cmd_ShowSystemMessage(rc, 0L);
 
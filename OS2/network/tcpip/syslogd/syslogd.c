@@ -90,9 +90,11 @@
 #include <process.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/ioctl.h>
 #include <sys/time.h>
 #include <netinet/in.h>
 #include <netdb.h>
+#include <nerrno.h>
 #include <stdio.h>
 #include <io.h>
 #include <stdlib.h>
@@ -126,11 +128,14 @@ void setlinebuf(FILE *f)
 
 int our_writev(int fd, struct iovec iov[], int vcount)
 {
-  int i;
+  int i, n = 0;
   for (i=0;i<vcount ;i++) 
   {
-    write(fd,iov[i].iov_base,iov[i].iov_len);
+    if (write(fd,iov[i].iov_base,iov[i].iov_len) < 0)
+      return -1;
+    n += iov[i].iov_len;
   } /* endfor */
+  return n;
 }
 
 /*
@@ -168,6 +173,13 @@ struct filed {
         int     f_prevlen;                      /* length of f_prevline */
         int     f_prevcount;                    /* repetition cnt of prevline */
         int     f_repeatcount;                  /* number of "repeated" msgs */
+        char    *f_wbuf;                        /* lines not written yet */
+        int     f_wlen;                         /* bytes in f_wbuf */
+        int     f_wsize;                        /* size of f_wbuf */
+        char    *f_sbuf;                        /* batch the writer is on */
+        int     f_slen;                         /* bytes in f_sbuf */
+        int     f_ssize;                        /* size of f_sbuf */
+        int     f_dropped;                      /* lines lost, buffer full */
 };
 
 /*
@@ -197,6 +209,28 @@ char    *TypeNames[5] = {
 struct  filed *Files;
 struct  filed consfile;
 
+/*
+ * Destinations for each facility and priority, built by init() from
+ * the f_pmask selectors so logmsg() does not test every entry in Files
+ * for every message.  Each list is a NULL terminated run of pointers
+ * in DispatchPool, in the order of the configuration file.
+ */
+struct  filed **Dispatch[LOG_NFACILITIES+1][LOG_PRIMASK+1];
+struct  filed **DispatchPool;
+
+/*
+ * Host names of recent senders, hashed by address, so a busy sender
+ * does not cost a name lookup for every message.
+ */
+#define NHOSTCACHE      256
+#define HOSTCACHETTL    300             /* seconds a name is kept */
+
+struct hostcache {
+        struct  in_addr hc_addr;
+        time_t  hc_time;                /* when looked up, 0 if unused */
+        char    hc_name[MAXHOSTNAMELEN+1];
+} HostCache[NHOSTCACHE];
+
 int     Debug;                  /* debug flag */
 char    LocalHostName[MAXHOSTNAMELEN+1];        /* our hostname */
 char    *LocalDomain;           /* our local domain name */
@@ -207,9 +241,38 @@ int     Initialized = 0;        /* set when we have initialized ourselves */
 int     MarkInterval = 20 * 60; /* interval between marks in seconds */
 int     MarkSeq = 0;            /* mark sequence number */
 
+/*
+ * Lines for regular files are collected in a buffer per file and
+ * written by the writer thread, when a buffer is half full or every
+ * FlushInterval ms, so receiving never waits for the disk.  With -s
+ * each file written in a batch is fsync'ed once for the whole batch.
+ * A buffer grows up to MAXWBUF times WriteBufSize while the writer is
+ * behind; past that lines are dropped and counted.  -b 0 writes every
+ * line at once, as before.
+ */
+#define MAXWBUF         16
+int     WriteBufSize = 64 * 1024;       /* bytes, -b kbytes */
+int     FlushInterval = 1000;           /* ms, -t */
+int     SyncFiles = 0;                  /* fsync after writing, -s */
+HMTX    hmtxLog;                /* Files and the f_wbuf buffers */
+HMTX    hmtxWrite;              /* held while writing f_sbuf batches */
+HEV     hevFlush;               /* wakes the writer early */
+
+/*
+ * The socket is non-blocking; after select() reports it readable, up
+ * to RECVBATCH datagrams are taken before waiting again.  -r sets the
+ * socket receive buffer, so bursts are not dropped by the stack while
+ * a batch is logged.
+ */
+#define RECVBATCH       64
+int     RcvBufSize = 0;                 /* bytes, -r kbytes, 0 = default */
+
 void init(int);
 void die(int);
 void domark(void *v);
+void writer(void *v);
+void flushall(void);
+void builddispatch(void);
 void usage(void);
 void logerror(char *);
 
@@ -220,7 +283,8 @@ int main(int argc, char **argv)
         int len;
         struct sockaddr_in sin, frominet;
         FILE *fp;
-        int ch;
+        int ch, n, on = 1;
+        int socks[1];
         char line[MSG_BSIZE + 1];
         extern int optind;
         extern char *optarg;
@@ -230,17 +294,31 @@ int main(int argc, char **argv)
  
         if (sock_init()) exit(-1);
  
-        while ((ch = getopt(argc, argv, "df:m:")) != EOF)
+        while ((ch = getopt(argc, argv, "b:df:m:r:st:")) != EOF)
                 switch((char)ch) {
+                case 'b':               /* write buffer size */
+                        WriteBufSize = atoi(optarg) * 1024;
+                        break;
                 case 'd':               /* debug */
                         Debug++;
                         break;
+                case 's':               /* fsync log files */
+                        SyncFiles = 1;
+                        break;
+                case 't':               /* flush interval */
+                        FlushInterval = atoi(optarg);
+                        if (FlushInterval < 10)
+                                FlushInterval = 10;
+                        break;
                 case 'f':               /* configuration file */
                         strcpy(ConfFile,optarg);
                         break;
                 case 'm':               /* mark interval */
                         MarkInterval = atoi(optarg) * 60;
                         break;
+                case 'r':               /* socket receive buffer */
+                        RcvBufSize = atoi(optarg) * 1024;
+                        break;
                 case '?':
                 default:
                         usage();
@@ -282,6 +360,12 @@ int main(int argc, char **argv)
                 } else {
                         InetInuse = 1;
                 }
+                if (RcvBufSize > 0 &&
+                    setsockopt(finet, SOL_SOCKET, SO_RCVBUF,
+                    (char *)&RcvBufSize, sizeof(RcvBufSize)) < 0)
+                        psock_errno("setsockopt(SO_RCVBUF)");
+                if (ioctl(finet, FIONBIO, (char *)&on, sizeof(on)) < 0)
+                        psock_errno("ioctl(FIONBIO)");
         }
 
         /* tuck my process id away */
@@ -291,33 +375,57 @@ int main(int argc, char **argv)
                 (void) fclose(fp);
         }
 
+        DosCreateMutexSem(NULL, &hmtxLog, 0, FALSE);
+        DosCreateMutexSem(NULL, &hmtxWrite, 0, FALSE);
+        DosCreateEventSem(NULL, &hevFlush, 0, FALSE);
+
         i= _beginthread(domark, NULL, 8192, NULL);
 
         dprintf("thread 2 started TID=%d...\n",i);
 
+        if (WriteBufSize > 0) {
+                i= _beginthread(writer, NULL, 16384, NULL);
+                dprintf("writer thread started TID=%d...\n",i);
+        }
+
         dprintf("off & running....\n");
 
         init(0);
 
         for (;;) {
-                errno = 0;
-                len = sizeof frominet;
-                i = recvfrom(finet, line, MAXLINE, 0,
-                    (struct sockaddr * ) &frominet, &len);
-                if (i > 0) {
-                        extern char *cvthname();
-
-                        line[i] = '\0';
-                        printmulti(cvthname(&frominet), line,i);
-		} else if (i < 0 && errno != EINTR)
-			logerror("recvfrom inet");
+                socks[0] = finet;
+                if (select(socks, 1, 0, 0, -1L) <= 0) {
+                        if (sock_errno() != SOCEINTR)
+                                psock_errno("select()");
+                        continue;
+                }
+                for (n = 0; n < RECVBATCH; n++) {
+                        len = sizeof frominet;
+                        i = recvfrom(finet, line, MAXLINE, 0,
+                            (struct sockaddr * ) &frominet, &len);
+                        if (i > 0) {
+                                extern char *cvthname();
+
+                                line[i] = '\0';
+                                printmulti(cvthname(&frominet), line,i);
+                        } else if (i < 0) {
+                                i = sock_errno();
+                                if (i == SOCEWOULDBLOCK)
+                                        break;
+                                if (i != SOCEINTR) {
+                                        errno = 0;
+                                        logerror("recvfrom inet");
+                                        break;
+                                }
+                        }
+                }
         }
 }
 
 void usage(void)
 {
         (void) fprintf(stderr,
-            "usage: syslogd [-d] [-f conffile] [-m markinterval]\n");
+            "usage: syslogd [-d] [-s] [-b kbytes] [-t flushms] [-r kbytes] [-f conffile] [-m markinterval]\n");
         exit(1);
 }
 
@@ -399,7 +507,7 @@ time_t  now;
 
 logmsg(int pri, char *msg, char *from, int flags)
 {
-        register struct filed *f;
+        register struct filed *f, **fp;
         int fac, prilev;
         int omask, msglen;
         char *timestamp;
@@ -407,6 +515,8 @@ logmsg(int pri, char *msg, char *from, int flags)
 
         dprintf("logmsg: pri %o, flags %x, from %s, msg %s\n", pri, flags, from, msg);
 
+        DosRequestMutexSem(hmtxLog, SEM_INDEFINITE_WAIT);
+
         /*
          * Check to see if msg looks non-standard.
          */
@@ -429,7 +539,7 @@ logmsg(int pri, char *msg, char *from, int flags)
                 fac = LOG_NFACILITIES;
         else
                 fac = LOG_FAC(pri);
-        prilev = 1 << (LOG_PRIMASK - LOG_PRI(pri));
+        prilev = LOG_PRI(pri);
 
         /* log the message to the particular outputs */
         if (!Initialized) {
@@ -440,13 +550,15 @@ logmsg(int pri, char *msg, char *from, int flags)
                         fprintlog(f, flags, msg);
                         (void) _close(f->f_file);
                 }
+                DosReleaseMutexSem(hmtxLog);
                 return;
         }
-        for (f = Files; f; f = f->f_nextone) {
-                /* skip messages that are incorrect priority */
-                if (!(f->f_pmask[fac] & prilev))
-                        continue;
-
+        /* facilities we have no selectors for go nowhere */
+        if (fac > LOG_NFACILITIES || (fac == LOG_NFACILITIES && !(flags & MARK))) {
+                DosReleaseMutexSem(hmtxLog);
+                return;
+        }
+        for (fp = Dispatch[fac][prilev]; fp && (f = *fp) != NULL; fp++) {
                 if (f->f_type == F_CONSOLE && (flags & IGN_CONS))
                         continue;
 
@@ -495,6 +607,140 @@ logmsg(int pri, char *msg, char *from, int flags)
                         }
                 }
         }
+        DosReleaseMutexSem(hmtxLog);
+}
+
+/*
+ * Queue a line for a log file.  Called with hmtxLog held.
+ */
+void bufferlog(struct filed *f, struct iovec iov[], int vcount)
+{
+        int i, len;
+        char *p;
+
+        for (i = len = 0; i < vcount; i++)
+                len += iov[i].iov_len;
+
+        if (f->f_wlen + len > f->f_wsize) {
+                /* the writer is behind: grow, up to a limit */
+                int size = f->f_wsize ? f->f_wsize : WriteBufSize;
+
+                while (size < f->f_wlen + len && size < MAXWBUF * WriteBufSize)
+                        size *= 2;
+                if (size < f->f_wlen + len ||
+                    (p = realloc(f->f_wbuf, size)) == NULL) {
+                        f->f_dropped++;
+                        return;
+                }
+                f->f_wbuf = p;
+                f->f_wsize = size;
+        }
+        for (i = 0, p = f->f_wbuf + f->f_wlen; i < vcount; i++) {
+                memcpy(p, iov[i].iov_base, iov[i].iov_len);
+                p += iov[i].iov_len;
+        }
+        f->f_wlen += len;
+        if (f->f_wlen >= WriteBufSize / 2)
+                DosPostEventSem(hevFlush);
+}
+
+/*
+ * Write out f_sbuf.  Called with hmtxWrite held.
+ */
+void writebatch(struct filed *f)
+{
+        if (f->f_slen == 0)
+                return;
+        if (f->f_type == F_FILE && write(f->f_file, f->f_sbuf, f->f_slen) < 0) {
+                int e = errno;
+                (void) _close(f->f_file);
+                f->f_type = F_UNUSED;
+                errno = e;
+                logerror(f->f_un.f_fname);
+        }
+        f->f_slen = 0;
+}
+
+/*
+ * Move the queued lines of every file to the writer's side, with a
+ * note of lines lost since the last batch.  Called with both
+ * semaphores held.
+ */
+void takebatch(void)
+{
+        register struct filed *f;
+        char *p;
+        int size, l;
+
+        for (f = Files; f; f = f->f_nextone) {
+                if (f->f_wlen == 0 && f->f_dropped == 0)
+                        continue;
+                p = f->f_sbuf;
+                size = f->f_ssize;
+                f->f_sbuf = f->f_wbuf;
+                f->f_ssize = f->f_wsize;
+                f->f_slen = f->f_wlen;
+                f->f_wbuf = p;
+                f->f_wsize = size;
+                f->f_wlen = 0;
+                if (f->f_dropped && f->f_wsize >= 100) {
+                        l = sprintf(f->f_wbuf, "%.15s %s syslogd: %d messages dropped, writes fell behind\n",
+                            ctime(&now) + 4, LocalHostName, f->f_dropped);
+                        f->f_wlen = l;
+                        f->f_dropped = 0;
+                }
+        }
+}
+
+/*
+ * Write all queued lines now, for init() and die().
+ */
+void flushall(void)
+{
+        register struct filed *f;
+        int pass;
+
+        DosRequestMutexSem(hmtxWrite, SEM_INDEFINITE_WAIT);
+        DosRequestMutexSem(hmtxLog, SEM_INDEFINITE_WAIT);
+        for (pass = 0; pass < 2; pass++) {      /* 2nd for a dropped note */
+                takebatch();
+                for (f = Files; f; f = f->f_nextone)
+                        writebatch(f);
+        }
+        for (f = Files; f; f = f->f_nextone)
+                if (SyncFiles && f->f_type == F_FILE)
+                        (void) fsync(f->f_file);
+        DosReleaseMutexSem(hmtxLog);
+        DosReleaseMutexSem(hmtxWrite);
+}
+
+/*
+ * Writer thread: take what has been queued, write it with the
+ * receiver free to go on queueing, then fsync the files once.
+ */
+void writer(void *v)
+{
+        register struct filed *f;
+        ULONG posts;
+
+        for (;;) {
+                DosWaitEventSem(hevFlush, FlushInterval);
+                DosResetEventSem(hevFlush, &posts);
+
+                DosRequestMutexSem(hmtxWrite, SEM_INDEFINITE_WAIT);
+                DosRequestMutexSem(hmtxLog, SEM_INDEFINITE_WAIT);
+                takebatch();
+                DosReleaseMutexSem(hmtxLog);
+
+                for (f = Files; f; f = f->f_nextone) {
+                        if (f->f_slen == 0)
+                                continue;
+                        writebatch(f);
+                        if (SyncFiles && f->f_type == F_FILE)
+                                (void) fsync(f->f_file);
+                }
+                DosReleaseMutexSem(hmtxWrite);
+        }
 }
 
 fprintlog(struct filed *f, int flags, char *msg)
@@ -574,6 +820,10 @@ fprintlog(struct filed *f, int flags, char *msg)
                         v->iov_base = "\n";
                         v->iov_len = 1;
                 }
+                if (f->f_type == F_FILE && WriteBufSize > 0) {
+                        bufferlog(f, iov, 6);
+                        break;
+                }
         again:
                 if (our_writev(f->f_file, iov, 6) < 0) {
                         int e = errno;
@@ -584,8 +834,8 @@ fprintlog(struct filed *f, int flags, char *msg)
                         f->f_type = F_UNUSED;
                         errno = e;
                         logerror(f->f_un.f_fname);
-                }
-/*                fsync(f->f_file); */
+                } else if (f->f_type == F_FILE && (SyncFiles || (flags & SYNC_FILE)))
+                        (void) fsync(f->f_file);
                 break;
 
         }
@@ -598,7 +848,9 @@ fprintlog(struct filed *f, int flags, char *msg)
 char * cvthname(struct sockaddr_in *f)
 {
         struct hostent * hp;
+        struct hostcache *hc;
         register char *p;
+        time_t t;
 
         dprintf("cvthname(%s)\n", (char *) inet_ntoa(f->sin_addr));
 
@@ -606,15 +858,26 @@ char * cvthname(struct sockaddr_in *f)
                 dprintf("Malformed from address\n");
                 return ("???");
         }
+        hc = &HostCache[ntohl(f->sin_addr.s_addr) % NHOSTCACHE];
+        t = time((time_t *)NULL);
+        if (hc->hc_time && hc->hc_addr.s_addr == f->sin_addr.s_addr &&
+            t - hc->hc_time < HOSTCACHETTL)
+                return (hc->hc_name);
         hp = gethostbyaddr((char *)&(f->sin_addr), sizeof(struct in_addr), f->sin_family);
         if (hp == 0) {
                 dprintf("Host name for your address (%s) unknown\n",
                         (char *) inet_ntoa(f->sin_addr));
-                return (inet_ntoa(f->sin_addr));
+                p = inet_ntoa(f->sin_addr);
+        } else {
+                if ((p = strchr(hp->h_name, '.')) && strcmp(p + 1, LocalDomain) == 0)
+                        *p = '\0';
+                p = hp->h_name;
         }
-        if ((p = strchr(hp->h_name, '.')) && strcmp(p + 1, LocalDomain) == 0)
-                *p = '\0';
-        return (hp->h_name);
+        hc->hc_addr = f->sin_addr;
+        hc->hc_time = t;
+        (void) strncpy(hc->hc_name, p, MAXHOSTNAMELEN);
+        hc->hc_name[MAXHOSTNAMELEN] = '\0';
+        return (hc->hc_name);
 }
 
 void domark(void *v)
@@ -631,6 +894,7 @@ void domark(void *v)
                         MarkSeq = 0;
                 }
 
+                DosRequestMutexSem(hmtxLog, SEM_INDEFINITE_WAIT);
                 for (f = Files; f; f = f->f_nextone) {
                         if (f->f_prevcount && now >= REPEATTIME(f)) {
                                 dprintf("flush %s: repeated %d times, %d sec.\n",
@@ -640,6 +904,7 @@ void domark(void *v)
                                 BACKOFF(f);
                         }
                 }
+                DosReleaseMutexSem(hmtxLog);
         } /* endfor */
 }
 
@@ -664,17 +929,20 @@ void die(int sig)
         register struct filed *f;
         char buf[100];
 
+        DosRequestMutexSem(hmtxLog, SEM_INDEFINITE_WAIT);
         for (f = Files; f != NULL; f = f->f_nextone) {
                 /* flush any pending output */
                 if (f->f_prevcount)
                         fprintlog(f, 0, (char *)NULL);
         }
+        DosReleaseMutexSem(hmtxLog);
         if (sig) {
                 dprintf("syslogd: exiting on signal %d\n", sig);
                 (void) sprintf(buf, "exiting on signal %d", sig);
                 errno = 0;
                 logerror(buf);
         }
+        flushall();
         exit(0);
 }
 
@@ -695,11 +963,19 @@ void init(int x)
         /*
          *  Close all open log files.
          */
-        Initialized = 0;
-        for (f = Files; f != NULL; f = next) {
+        DosRequestMutexSem(hmtxWrite, SEM_INDEFINITE_WAIT);
+        DosRequestMutexSem(hmtxLog, SEM_INDEFINITE_WAIT);
+        for (f = Files; f != NULL; f = f->f_nextone) {
                 /* flush any pending output */
                 if (f->f_prevcount)
                         fprintlog(f, 0, (char *)NULL);
+        }
+        flushall();
+        Initialized = 0;
+        free(DispatchPool);
+        DispatchPool = NULL;
+        memset(Dispatch, 0, sizeof(Dispatch));
+        for (f = Files; f != NULL; f = next) {
 
                 switch (f->f_type) {
                   case F_FILE:
@@ -712,6 +988,8 @@ void init(int x)
                         break;
                 }
                 next = f->f_nextone;
+                free(f->f_wbuf);
+                free(f->f_sbuf);
                 free((char *) f);
         }
         Files = NULL;
@@ -724,7 +1002,10 @@ void init(int x)
                 cfline("*.ERR\tCON", *nextp);
                 (*nextp)->f_nextone = (struct filed *)malloc(sizeof(*f));
                 cfline("*.PANIC\t*", (*nextp)->f_nextone);
+                builddispatch();
                 Initialized = 1;
+                DosReleaseMutexSem(hmtxLog);
+                DosReleaseMutexSem(hmtxWrite);
                 return;
         }
 
@@ -751,7 +1032,10 @@ void init(int x)
         /* close the configuration file */
         (void) fclose(cf);
 
+        builddispatch();
         Initialized = 1;
+        DosReleaseMutexSem(hmtxLog);
+        DosReleaseMutexSem(hmtxWrite);
 
         if (Debug) {
                 for (f = Files; f; f = f->f_nextone) {
@@ -789,6 +1073,36 @@ void init(int x)
         dprintf("syslogd: restarted\n");
 }
 
+/*
+ * Fill Dispatch from the f_pmask selectors of Files.  Called by init()
+ * with hmtxLog held, after the configuration has been read.
+ */
+void builddispatch(void)
+{
+        register struct filed *f, **fp;
+        int fac, pri, n;
+
+        n = 0;
+        for (fac = 0; fac <= LOG_NFACILITIES; fac++)
+                for (pri = 0; pri <= LOG_PRIMASK; pri++) {
+                        for (f = Files; f; f = f->f_nextone)
+                                if (f->f_pmask[fac] & (1 << (LOG_PRIMASK - pri)))
+                                        n++;
+                        n++;
+                }
+        fp = DispatchPool = (struct filed **)malloc(n * sizeof(*fp));
+        if (fp == NULL)
+                return;
+        for (fac = 0; fac <= LOG_NFACILITIES; fac++)
+                for (pri = 0; pri <= LOG_PRIMASK; pri++) {
+                        Dispatch[fac][pri] = fp;
+                        for (f = Files; f; f = f->f_nextone)
+                                if (f->f_pmask[fac] & (1 << (LOG_PRIMASK - pri)))
+                                        *fp++ = f;
+                        *fp++ = NULL;
+                }
+}
+
 /*
  * Crack a configuration file line
  */
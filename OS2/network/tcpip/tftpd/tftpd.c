@@ -1,4 +1,5 @@
 #define INCL_DOSPROCESS
+#define INCL_DOSMISC
 #include <os2.h>
 #include <time.h>
 #include "signal.h"
@@ -13,17 +14,32 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <nerrno.h>
 #include <string.h>
 #include <sys\types.h>
 #include <sys\stat.h>
 #include <tftpd.h>
 
 char path_prefix[256];
-int  default_blksize = 512;
-int  num_block = 0;
 char verbose = FALSE;
 int  Logging(char *fmt, ...);
 
+SESSION       sessions[MAX_SESSIONS];
+int           nsessions = 0;
+CACHEFILE     *cache = NULL;            /* hot files, most recent first */
+long          cache_bytes = 0;
+long          cache_limit = CACHE_LIMIT * 1024L * 1024L;
+char          sbuf[4 + MAX_BLKSIZE];    /* packet being sent            */
+
+unsigned long
+msnow(void)
+{
+    ULONG ms;
+
+    DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ms, sizeof(ms));
+    return ms;
+}
+
 int
 decode(
     char type,
@@ -40,12 +56,18 @@ decode(
             case RRQ:
                  nbr      = 0;
                  pos[nbr] = &raw[0];
-                 for (i=0;i<len_raw;i++)
+                 for (i=0;i<len_raw && nbr < 19;i++)
                  {
                       if (raw[i] == '\0') pos[++nbr] = &raw[i+1];
                  }
                  nbr--;
-                 strcpy(packet->rrq.filename,pos[0]);
+                 if (nbr < 1)
+                 {
+                     Logging("Malformed request\n");
+                     return -1;
+                 }
+                 strncpy(packet->rrq.filename,pos[0],sizeof(packet->rrq.filename)-1);
+                 packet->rrq.filename[sizeof(packet->rrq.filename)-1] = '\0';
 
                  packet->rrq.type_trf = '?';
                  if (stricmp(pos[1],"octet") == 0)    packet->rrq.type_trf = 'o';
@@ -53,12 +75,13 @@ decode(
                  if (stricmp(pos[1],"mail") == 0)     packet->rrq.type_trf = 'm';
                  if (packet->rrq.type_trf == '?')
                  {
-                     Logging("Fatal error unknown transfer type : %s\n",pos[1]);
-                     exit(-1);
+                     Logging("Unknown transfer type : %s\n",pos[1]);
+                     return -1;
                  }
                  packet->rrq.opt      = FALSE;    /* tftp without option set by default */
                  packet->rrq.tsize   = -1;
                  packet->rrq.blksize = -1;
+                 packet->rrq.windowsize = -1;
                  for (i=2; i < nbr; i += 2)
                  {
                       if (stricmp(pos[i],"tsize") == 0)
@@ -71,13 +94,19 @@ decode(
                           packet->rrq.blksize = atol(pos[i+1]);
                           packet->rrq.opt     = TRUE;
                       }
+                      if (stricmp(pos[i],"windowsize") == 0)
+                      {
+                          packet->rrq.windowsize = atol(pos[i+1]);
+                          packet->rrq.opt        = TRUE;
+                      }
                  }
                  break;
             case ACK:
                  break;
             case ERROR:
                  packet->err.rc = raw[0]*256+raw[1];
-                 strcpy(packet->err.msger,&raw[2]);
+                 strncpy(packet->err.msger,&raw[2],sizeof(packet->err.msger)-1);
+                 packet->err.msger[sizeof(packet->err.msger)-1] = '\0';
                  break;
     }
     return 0;
@@ -114,6 +143,410 @@ break_handler(
     exit(0);
 }
 
+/**
+* Send an ERROR packet
+*
+* @s      socket to send from
+* @to     client address
+* @rc     TFTP error code
+* @msg    error text
+*/
+void
+send_error(
+    int s,
+    struct sockaddr_in *to,
+    int rc,
+    char *msg)
+{
+    char buf[128];
+
+    buf[0] = 0;
+    buf[1] = ERROR;
+    buf[2] = rc / 256;
+    buf[3] = rc % 256;
+    strncpy(&buf[4], msg, sizeof(buf) - 5);
+    buf[sizeof(buf) - 1] = '\0';
+    if (sendto(s, buf, 4+strlen(&buf[4])+1, 0, (struct sockaddr *) to, sizeof(*to)) < 0)
+        psock_errno("sendto()");
+}
+
+/**
+* Take a file out of the cache list. Its data stays until the last
+* session sending it is done.
+*/
+void
+cache_drop(
+    CACHEFILE *cf)
+{
+    CACHEFILE **pp;
+
+    for (pp = &cache; *pp; pp = &(*pp)->next)
+    {
+        if (*pp == cf)
+        {
+            *pp = cf->next;
+            cache_bytes -= cf->size;
+            break;
+        }
+    }
+    cf->stale = TRUE;
+    if (cf->users == 0)
+    {
+        free(cf->data);
+        free(cf);
+    }
+}
+
+void
+cache_release(
+    CACHEFILE *cf)
+{
+    if (--cf->users > 0 || !cf->stale)
+        return;
+    if (cf->fp != NULL)
+        fclose(cf->fp);
+    free(cf->data);
+    free(cf);
+}
+
+/**
+* Open a file to send. Files that fit in the cache are read once and
+* served from memory to every client, the least recently requested
+* files make room for new ones. A file changed on disk is read again.
+* Larger files are read block by block from their own handle.
+*
+* @path   full path of the file
+* @return cache entry with one more user, NULL if it can't be read
+*/
+CACHEFILE *
+cache_open(
+    char *path)
+{
+    CACHEFILE   *cf, **pp;
+    struct stat s_stat;
+    FILE        *fp;
+
+    if (stat(path,&s_stat) != 0)
+        return NULL;
+
+    for (pp = &cache; (cf = *pp) != NULL; pp = &cf->next)
+    {
+        if (stricmp(cf->path, path) == 0)
+        {
+            if (cf->size == s_stat.st_size && cf->mtime == s_stat.st_mtime)
+            {
+                *pp = cf->next;          /* move to front */
+                cf->next = cache;
+                cache = cf;
+                cf->users++;
+                return cf;
+            }
+            cache_drop(cf);              /* changed on disk */
+            break;
+        }
+    }
+
+    if ((fp = fopen(path,"rb")) == NULL)
+        return NULL;
+
+    if ((cf = calloc(1, sizeof(CACHEFILE))) == NULL)
+    {
+        fclose(fp);
+        return NULL;
+    }
+    strncpy(cf->path, path, sizeof(cf->path)-1);
+    cf->size  = s_stat.st_size;
+    cf->mtime = s_stat.st_mtime;
+    cf->users = 1;
+
+    if (cf->size <= cache_limit)
+        cf->data = malloc(cf->size ? cf->size : 1);
+
+    if (cf->data != NULL && fread(cf->data, 1, cf->size, fp) == cf->size)
+    {
+        fclose(fp);
+
+        /* make room, the tail is the least recently requested */
+        while (cache != NULL && cache_bytes + cf->size > cache_limit)
+        {
+            CACHEFILE *tail;
+
+            for (tail = cache; tail->next; tail = tail->next)
+                ;
+            cache_drop(tail);
+        }
+        cf->next = cache;
+        cache = cf;
+        cache_bytes += cf->size;
+        if (verbose)
+            Logging("                   :cached %s (%ld bytes)\n",path,cf->size);
+    }
+    else
+    {
+        free(cf->data);
+        cf->data  = NULL;
+        cf->fp    = fp;
+        cf->stale = TRUE;                /* not in the cache list */
+    }
+    return cf;
+}
+
+/**
+* Copy block blk (1 based) of the session's file to buf
+*
+* @return bytes in the block, less than blksize for the last one
+*/
+int
+read_block(
+    SESSION *ss,
+    unsigned long blk,
+    char *buf)
+{
+    long off = (long)(blk - 1) * ss->blksize;
+    long len = ss->file->size - off;
+    CACHEFILE *cf = ss->file;
+
+    if (len > ss->blksize)
+        len = ss->blksize;
+    if (len <= 0)
+        return 0;
+    if (cf->data != NULL)
+    {
+        memcpy(buf, cf->data + off, len);
+        return len;
+    }
+    if (fseek(cf->fp, off, SEEK_SET) != 0)
+        return 0;
+    return fread(buf, 1, len, cf->fp);
+}
+
+void
+end_session(
+    SESSION *ss)
+{
+    soclose(ss->s);
+    cache_release(ss->file);
+    *ss = sessions[--nsessions];
+}
+
+/**
+* Send the blocks of the window following the last ACK, or the OACK
+* again if the options are not acknowledged yet
+*
+* @return FALSE if the session broke down and was ended
+*/
+int
+send_window(
+    SESSION *ss)
+{
+    int len;
+
+    ss->deadline = msnow() + TIMEOUT_MS;
+
+    if (ss->oacklen)
+    {
+        if (sendto(ss->s, ss->oack, ss->oacklen, 0, (struct sockaddr *) &ss->client, sizeof(ss->client)) < 0)
+        {
+            psock_errno("sendto()");
+            end_session(ss);
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    if (ss->sent < ss->acked)
+        ss->sent = ss->acked;
+    while (ss->sent < ss->last && ss->sent < ss->acked + ss->windowsize)
+    {
+        ss->sent++;
+        sbuf[0] = 0;
+        sbuf[1] = DATA;
+        sbuf[2] = (ss->sent >> 8) & 0xff;      /* block numbers wrap */
+        sbuf[3] = ss->sent & 0xff;
+        len = read_block(ss, ss->sent, &sbuf[4]);
+        if (verbose)
+            Logging(">> %15s :Data block :%lu\n",inet_ntoa(ss->client.sin_addr),ss->sent);
+        if (sendto(ss->s, sbuf, 4+len, 0, (struct sockaddr *) &ss->client, sizeof(ss->client)) < 0)
+        {
+            psock_errno("sendto()");
+            end_session(ss);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+* Start a transfer for a read request received on the tftp port.
+* Each transfer gets its own socket on an ephemeral port (its TID),
+* and its own blksize and windowsize.
+*/
+void
+new_session(
+    int s,
+    struct sockaddr_in *client,
+    char *buf,
+    int len)
+{
+    PACKET     packet;
+    SESSION    *ss;
+    char       path[256];
+    struct sockaddr_in local;
+    char       *p;
+
+    if (buf[1] != RRQ)
+    {
+        send_error(s, client, 4, "Only read requests are served");
+        return;
+    }
+    if (decode(buf[1],&buf[2],len-2,&packet) != 0)
+    {
+        send_error(s, client, 4, "Malformed request");
+        return;
+    }
+    if (verbose)
+        Logging("<< %15s :Read %s\n",inet_ntoa(client->sin_addr),packet.rrq.filename);
+    Logging("Download file : %s\n",packet.rrq.filename);
+
+    if (nsessions == MAX_SESSIONS)
+    {
+        send_error(s, client, 0, "Server busy, retry later");
+        return;
+    }
+
+    ss = &sessions[nsessions];
+    memset(ss, 0, sizeof(*ss));
+    ss->client = *client;
+    combine(path, path_prefix, packet.rrq.filename);
+    if ((ss->file = cache_open(path)) == NULL)
+    {
+        Logging("\ncannot open %s\n",path);
+        send_error(s, client, 1, "File not found");
+        return;
+    }
+
+    if ((ss->s = socket(PF_INET, SOCK_DGRAM, 0)) < 0)
+    {
+        psock_errno("socket()");
+        cache_release(ss->file);
+        return;
+    }
+    memset(&local, 0, sizeof(local));
+    local.sin_family      = AF_INET;
+    local.sin_port        = 0;          /* ephemeral */
+    local.sin_addr.s_addr = INADDR_ANY;
+    if (bind(ss->s, (struct sockaddr *)&local, sizeof(local)) < 0)
+    {
+        psock_errno("bind()");
+        soclose(ss->s);
+        cache_release(ss->file);
+        return;
+    }
+    nsessions++;
+
+    ss->blksize    = 512;
+    ss->windowsize = 1;
+
+    if (packet.rrq.opt == TRUE)     /* we receive a read with options */
+    {
+        p = &ss->oack[0];
+        *p++ = 0;
+        *p++ = OACK;
+        if (packet.rrq.tsize != -1)  /* client asks for the filesize */
+        {
+            p += sprintf(p, "tsize") + 1;
+            p += sprintf(p, "%ld", ss->file->size) + 1;
+        }
+        if (packet.rrq.blksize != -1)
+        {
+            ss->blksize = packet.rrq.blksize;
+            if (ss->blksize < MIN_BLKSIZE) ss->blksize = MIN_BLKSIZE;
+            if (ss->blksize > MAX_BLKSIZE) ss->blksize = MAX_BLKSIZE;
+            p += sprintf(p, "blksize") + 1;
+            p += sprintf(p, "%d", ss->blksize) + 1;
+        }
+        if (packet.rrq.windowsize != -1)
+        {
+            ss->windowsize = packet.rrq.windowsize;
+            if (ss->windowsize < 1)          ss->windowsize = 1;
+            if (ss->windowsize > MAX_WINDOW) ss->windowsize = MAX_WINDOW;
+            p += sprintf(p, "windowsize") + 1;
+            p += sprintf(p, "%d", ss->windowsize) + 1;
+        }
+        ss->oacklen = p - ss->oack;
+        if (verbose)
+            Logging(">> %15s :Oack size %ld blksize %d windowsize %d\n",inet_ntoa(client->sin_addr),
+                    ss->file->size,ss->blksize,ss->windowsize);
+    }
+
+    /* the last block is the one shorter than blksize, maybe empty */
+    ss->last = ss->file->size / ss->blksize + 1;
+    send_window(ss);
+}
+
+/**
+* Handle a packet that arrived on a transfer's own socket
+*/
+void
+session_packet(
+    SESSION *ss,
+    struct sockaddr_in *from,
+    char *buf,
+    int len)
+{
+    PACKET        packet;
+    unsigned long blk;
+
+    if (from->sin_port != ss->client.sin_port ||
+        from->sin_addr.s_addr != ss->client.sin_addr.s_addr)
+    {
+        send_error(ss->s, from, 5, "Unknown transfer ID");
+        return;
+    }
+    if (len < 4)
+        return;
+
+    switch (buf[1])
+    {
+        case ACK:
+             /* widen the 16 bit block number to the one in the
+              * window it can mean; older ones are duplicates */
+             blk = ss->acked + ((((unsigned char)buf[2]*256+(unsigned char)buf[3]) - ss->acked) & 0xffff);
+             if (verbose)
+                 Logging("<< %15s :Ack block :%lu \n",inet_ntoa(from->sin_addr),blk);
+             if (ss->oacklen)
+             {
+                 if (blk != 0)
+                     return;
+                 ss->oacklen = 0;
+             }
+             else if (blk <= ss->acked || blk > ss->sent)
+                 return;
+             ss->acked   = blk;
+             ss->retries = 0;
+             if (ss->acked == ss->last)
+             {
+                 end_session(ss);
+                 return;
+             }
+             /* the client acked inside the window: it lost the rest,
+              * so send on from its ACK */
+             ss->sent = ss->acked;
+             send_window(ss);
+             break;
+        case ERROR:
+             decode(buf[1],&buf[2],len-2,&packet);
+             if (verbose)
+                 Logging("<< %15s :Error rc = %d msger = %s\n",inet_ntoa(from->sin_addr),packet.err.rc,packet.err.msger);
+             else Logging("                Error --> %s\n",packet.err.msger);
+             end_session(ss);
+             break;
+        default:
+             send_error(ss->s, from, 4, "Illegal TFTP operation");
+             break;
+    }
+}
+
 int main(int argc,char **argv)
 {
   int                sockint;
@@ -122,21 +555,18 @@ int main(int argc,char **argv)
   struct sockaddr_in client;
   struct servent     *tftpd_prot;
   int                client_address_size;
-  char               buf[2048];
+  char               buf[4 + MAX_BLKSIZE];
   int                nbr_lu;
-  int                nbr_ecrit;
-  PACKET             packet;
-  struct stat        s_stat;
-  char               path[256];
-  FILE               *fichin;
-  int                i;
-  char               *p;
+  int                i, n, nsocks, rc;
+  int                socks[MAX_SESSIONS + 1];
+  long               timeout;
+  unsigned long      now;
 
   signal(SIGINT,break_handler);
   printf("**********************************************\n");
   printf("*      IBM TCP/IP for OS/2                   *\n");
   printf("*      Advanced TFTP Server (TFTPD)          *\n");
-  printf("*      Support blksize,tsize options         *\n");
+  printf("*      Support blksize,tsize,windowsize      *\n");
   printf("*      Version: %s %s         *\n",__DATE__,__TIME__);
   printf("*      (C) Copyright Serge Sterck 2002       *\n");
   printf("**********************************************\n");
@@ -149,7 +579,9 @@ int main(int argc,char **argv)
        {
           if (stricmp(argv[i],"-v") == 0)
              verbose = TRUE;
-          else strcpy(path_prefix,argv[1]);
+          else if (stricmp(argv[i],"-c") == 0 && i + 1 < argc)
+             cache_limit = atol(argv[++i]) * 1024L * 1024L;  /* MB of file cache */
+          else strcpy(path_prefix,argv[i]);
        }
     }
   if ((sockint = sock_init()) != 0)
@@ -157,7 +589,6 @@ int main(int argc,char **argv)
        Logging(" TCP/IP stack is probably not running");
        exit(1);
     }
-//loop_bind:
   if ((s = socket(PF_INET, SOCK_DGRAM, 0)) < 0)
     {
         psock_errno("socket()");
@@ -179,141 +610,83 @@ int main(int argc,char **argv)
       psock_errno("bind()");
       exit(2);
     }
-  client_address_size = sizeof(client);
-loop:
-  nbr_lu = recvfrom(s, buf, sizeof(buf), 0, (struct sockaddr *) &client,&client_address_size);
-  if (nbr_lu < 0)
-   {
-       psock_errno("recvfrom()");
-       exit(4);
-   }
-  decode(buf[1],&buf[2],nbr_lu,&packet);
-loop_req:
-  switch( buf[1] )
-   {
-     case RRQ:
-          if (verbose)
-            Logging("<< %15s :Read %s\n",inet_ntoa(client.sin_addr),packet.rrq.filename);
-          Logging("Download file : %s\n",packet.rrq.filename);
-          if (packet.rrq.opt == TRUE)     /* we receive a read with a option */
+
+  /* one thread serves all transfers: wait on the tftp port and every
+   * session socket at once, until the nearest retransmit is due */
+  for (;;)
+    {
+      socks[0] = s;
+      nsocks   = nsessions + 1;
+      timeout  = TIMEOUT_MS;
+      now      = msnow();
+      for (n = 0; n < nsessions; n++)
+        {
+          socks[n + 1] = sessions[n].s;
+          if ((long)(sessions[n].deadline - now) < timeout)
+             timeout = (long)(sessions[n].deadline - now);
+        }
+      if (timeout < 0)
+         timeout = 0;
+
+      rc = select(socks, nsocks, 0, 0, timeout);
+      if (rc < 0)
+        {
+          if (sock_errno() != SOCEINTR)
+            psock_errno("select()");
+          continue;
+        }
+
+      /* sessions end while we go, so act on copies of the sockets
+       * found ready and look their session up again */
+      for (i = 0; rc > 0 && i < nsocks; i++)
+        {
+          if (socks[i] == -1)
+             continue;
+          rc--;
+          client_address_size = sizeof(client);
+          nbr_lu = recvfrom(socks[i], buf, sizeof(buf) - 1, 0, (struct sockaddr *) &client,&client_address_size);
+          if (nbr_lu < 0)
             {
-              if (packet.rrq.tsize == 0)  /* client ask for the filesize     */
-                {
-                  combine(path, path_prefix, packet.rrq.filename);
-                  //sprintf(path,"%s\\%s",path_prefix,packet.rrq.filename);
-                  if (stat(path,&s_stat) != 0)
-                    {
-                      Logging("\ncannot stat %s\n",path);
-                      buf[0] = 0;
-                      buf[1] = ERROR;
-                      buf[2] = 0;
-                      buf[3] = 0;
-                      sprintf(&buf[4],"Cannot stat %s",path);
-                      nbr_ecrit = sendto(s, buf, 4+strlen(&buf[4])+1, 0, (struct sockaddr *) &client,client_address_size);
-                      if (nbr_ecrit < 0)
-                        {
-                          psock_errno("sendto()");
-                          exit(4);
-                        }
-                      goto loop;
-                    }
-                  if (verbose)
-                    Logging(">> %15s :Oack size of %s = %d\n",inet_ntoa(server.sin_addr),packet.rrq.filename,s_stat.st_size);
-                  buf[0] = 0;
-                  buf[1] = OACK;
-                  strcpy(&buf[2],"tsize");
-                  buf[7] = '\0';
-                  sprintf(&buf[8],"%d",s_stat.st_size);
-                  nbr_ecrit = sendto(s, buf, 8+strlen(&buf[8])+1, 0, (struct sockaddr *) &client,client_address_size);
-                  if (nbr_ecrit < 0)
-                    {
-                      psock_errno("sendto()");
-                      exit(4);
-                     }
-                }
-              if (packet.rrq.blksize != -1)  /* Initiate read with blkize       */
-                   default_blksize = packet.rrq.blksize;
-              else default_blksize = 512;
-              if (verbose)
-                Logging("                   :blksize set to :%d\n",default_blksize);
+              psock_errno("recvfrom()");
+              continue;
             }
-          else
+          buf[nbr_lu] = '\0';          /* strings in it end for sure */
+          if (i == 0)
             {
-              buf[0] = 0;      /* send ack block = 0 */
-              buf[1] = ACK;
-              buf[2] = 0;
-              buf[3] = 0;
-              nbr_ecrit = sendto(s, buf, 4, 0, (struct sockaddr *) &client,client_address_size);
-              if (nbr_ecrit < 0)
-                {
-                  psock_errno("sendto()");
-                  exit(4);
-                }
+              if (nbr_lu >= 4)
+                 new_session(s, &client, buf, nbr_lu);
+              continue;
             }
-          combine(path, path_prefix, packet.rrq.filename);
-          fichin    = fopen(path,"rb");
-          if (fichin == NULL)
-          {
-            Logging("\ncannot open %s\n",path);
-            goto loop;
-          }
-          num_block = 1;
-          buf[1] = DATA;
-          goto loop_req;
-          break;
-     case DATA:
-          buf[0] = 0;
-          buf[1] = DATA;
-          buf[2] = num_block/256;
-          buf[3] = num_block % 256;
-          nbr_lu = fread(&buf[4],1,default_blksize,fichin);
-          if (verbose)
-            Logging(">> %15s :Data block :%d\n",inet_ntoa(server.sin_addr),num_block);
-          if (nbr_lu == default_blksize)
+          for (n = 0; n < nsessions; n++)
+             if (sessions[n].s == socks[i])
+               {
+                 session_packet(&sessions[n], &client, buf, nbr_lu);
+                 break;
+               }
+        }
+
+      /* resend the window of transfers whose ACK is overdue */
+      now = msnow();
+      for (n = 0; n < nsessions; )
+        {
+          SESSION *ss = &sessions[n];
+
+          if ((long)(ss->deadline - now) > 0)
             {
-               nbr_ecrit = sendto(s, buf, 4+default_blksize, 0, (struct sockaddr *) &client,client_address_size);
-               if (nbr_ecrit < 0)
-                 {
-                   psock_errno("sendto()");
-                   exit(4);
-                 }
+              n++;
+              continue;
             }
-          else
-              {
-                nbr_ecrit = sendto(s, buf, 4+nbr_lu, 0, (struct sockaddr *) &client,client_address_size);
-                if (nbr_ecrit < 0)
-                  {
-                    psock_errno("sendto()");
-                    exit(4);
-                  }
-                fclose(fichin);
-                //soclose(s);
-                //goto loop_bind;
-                goto loop;
-              }
-          if (nbr_ecrit < 0)
+          if (++ss->retries > MAX_RETRIES)
             {
-              psock_errno("sendto()");
-              exit(4);
+              Logging("%15s :timed out\n",inet_ntoa(ss->client.sin_addr));
+              end_session(ss);     /* moves the last session here */
+              continue;
             }
-          break;
-     case ACK:
-          if (verbose)
-            Logging("<< %15s :Ack block :%d \n",inet_ntoa(client.sin_addr),buf[2]*256+buf[3]);
-          if (buf[2] == 0 && buf[3] == 0)
-            goto loop;    /* we ack the block 0 */
-          buf[1] = DATA;
-          num_block++;
-          goto loop_req;
-     case ERROR:
-          if (verbose)
-            Logging("<< %15s :Error rc = %d msger = %s\n",inet_ntoa(client.sin_addr),packet.err.rc,packet.err.msger);
-          else Logging("                Error --> %s\n",packet.err.msger);
-          default_blksize = 512;
-          fclose(fichin);
-          break;
-   }
-  goto loop;
+          ss->sent = ss->acked;
+          if (send_window(ss))
+            n++;
+        }
+    }
   soclose(s);
   return 0;
 }
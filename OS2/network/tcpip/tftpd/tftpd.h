@@ -20,6 +20,7 @@ typedef struct _RRQ_PACKET
    char opt;                            /* TRUE if tftp with opt     */
    long tsize;                          /* -1 not used               */
    long blksize;                        /* -1 not used               */
+   long windowsize;                     /* -1 not used (RFC 7440)    */
  } RRQ_PACKET;
 
 typedef struct _ERR_PACKET
@@ -32,3 +33,40 @@ typedef struct _PACKET
    RRQ_PACKET rrq;
    ERR_PACKET err;
  } PACKET;
+/**************************** LIMITS ******************************************/
+#define MAX_SESSIONS   64               /* transfers in progress     */
+#define MIN_BLKSIZE    8                /* RFC 2348 blksize range    */
+#define MAX_BLKSIZE    65464
+#define MAX_WINDOW     64               /* largest windowsize agreed */
+#define TIMEOUT_MS     1000             /* resend window after this  */
+#define MAX_RETRIES    5                /* then give the client up   */
+#define CACHE_LIMIT    64               /* default MB of file cache  */
+/**************************** FILE CACHE **************************************/
+typedef struct _CACHEFILE
+ {
+   struct _CACHEFILE *next;             /* LRU list, most recent 1st */
+   char path[256];                      /* full path of the file     */
+   long size;                           /* file size                 */
+   time_t mtime;                        /* to notice a changed file  */
+   char *data;                          /* contents, NULL if too big */
+   FILE *fp;                            /* read per block if no data */
+   int users;                           /* sessions sending it       */
+   char stale;                          /* out of the cache, free it */
+                                        /* when users drops to 0     */
+ } CACHEFILE;
+/**************************** TRANSFER SESSION ********************************/
+typedef struct _SESSION
+ {
+   int s;                               /* socket of this transfer   */
+   struct sockaddr_in client;           /* address and port (TID)    */
+   CACHEFILE *file;                     /* file being sent           */
+   int blksize;                         /* agreed block size         */
+   int windowsize;                      /* blocks sent per ACK       */
+   unsigned long acked;                 /* last block acknowledged   */
+   unsigned long sent;                  /* last block sent           */
+   unsigned long last;                  /* number of the final block */
+   char oack[128];                      /* OACK while not ACKed yet  */
+   int oacklen;                         /* 0 once block 0 is ACKed   */
+   int retries;                         /* timeouts in a row         */
+   unsigned long deadline;              /* ms count to resend at     */
+ } SESSION;
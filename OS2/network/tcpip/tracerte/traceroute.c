@@ -289,6 +289,7 @@ typedef struct
   ARGFLAG fsTTL;                                /* time to live    specified */
   ARGFLAG fsQueries;                      /* number of probe packets to send */
   ARGFLAG fsWait;                        /* how long to wait between packets */
+  ARGFLAG fsParallel;                       /* probe all hops at the same time */
 
   PSZ     pszHost;                           /* host IP or address specified */
   PSZ     pszSource;                               /* special source address */
@@ -362,6 +363,8 @@ ARGUMENT TabArguments[] =
                                                              ARG_HIDDEN,     &Options.fsVerbose},
   {"/!ROUTE",    "Disable normal rouing tables.",
                                        NULL,                 ARG_NULL,       &Options.fsDontRoute},
+  {"/PARALLEL",  "Send the probes for all "
+                 "hops at once.",      NULL,                 ARG_NULL,       &Options.fsParallel},
   {"/NUMERIC",   "Numeric mode, don't resolve"
                  "IPs to hostnames.",  NULL,                 ARG_NULL,       &Options.fsNumeric},
   {"1",          "Start with this "
@@ -380,6 +383,8 @@ void   help               (void);
 
 APIRET IPTraceRoute       (void);
 
+APIRET IPTraceRouteParallel(void);
+
 APIRET IPWaitForReply     (SOCKET             sock,
                            struct sockaddr_in *from,
                            int                reset_timer);
@@ -392,7 +397,8 @@ PSZ    IPICMPPacketType   (UCHAR ucICMPType);
 int    IPICMPPacketCheck  (u_char             *buf,
                            int                cc,
                            struct sockaddr_in *from,
-                           int                seq);
+                           int                seq,
+                           int                *pSeq);
 
 void   IPPacketHeaderPrint(u_char             *buf,
                            int                cc,
@@ -588,6 +594,9 @@ APIRET IPTraceRoute(void)
           Options.usSize);
   fflush(stderr);
 
+  if (Options.fsParallel)
+    return (IPTraceRouteParallel());
+
   for (ttl = 1;
        ttl <= Options.ucTTL;
        ++ttl)
@@ -627,7 +636,8 @@ APIRET IPTraceRoute(void)
         i = IPICMPPacketCheck(Globals.PacketBuffer,
                                    cc,
                                    &from,
-                                   seq);
+                                   seq,
+                                   NULL);
         if (i != 0)
         {
           reset_timer = 1;
@@ -699,6 +709,191 @@ APIRET IPTraceRoute(void)
 }
 
 
+/*****************************************************************************
+ * Name      : APIRET IPTraceRouteParallel
+ * Funktion  : send the probes for all hops at once, collect the replies
+ *             until every hop up to the target has answered or /WAIT=
+ *             has passed, then print the route as IPTraceRoute does
+ * Parameter :
+ * Variablen :
+ * Ergebnis  : API returncode
+ * Bemerkung : the UDP destination port tells the probe of a reply, so
+ *             sequence numbers run from 1 for the first probe at TTL 1.
+ *             Gateways that rate limit ICMP may drop some of the answers
+ *             to a burst like this; those probes are printed as "*".
+ *
+ * Autor     :
+ *****************************************************************************/
+
+typedef struct _HOPPROBE
+{
+  PERFSTRUCT     psSent;                              /* when it was sent */
+  double         fTime;                        /* round trip time in ms */
+  struct in_addr Addr;                                  /* who answered */
+  int            iCode;     /* IPICMPPacketCheck result, 0 if no answer */
+  UCHAR          ucReplyTTL;                        /* TTL of the answer */
+} HOPPROBE, *PHOPPROBE;
+
+APIRET IPTraceRouteParallel(void)
+{
+  PHOPPROBE          pProbes;
+  PHOPPROBE          pProbe;
+  struct sockaddr_in from;
+  struct timeval     wait;
+  PERFSTRUCT         psStart;
+  PERFSTRUCT         psNow;
+  fd_set             fds;
+  double             fLeft;
+  int                iProbes;
+  int                iLastHop;
+  int                iPending;
+  int                seq;
+  int                ttl;
+  int                probe;
+  int                cc;
+  int                i;
+  int                fromlen;
+
+  iProbes = Options.ucTTL * Options.ulQueries;
+  pProbes = (PHOPPROBE)calloc(iProbes, sizeof(HOPPROBE));
+  if (!pProbes)
+  {
+    perror("traceroute: malloc");
+    exit(1);
+  }
+
+  for (seq = 1;                                          /* fire them all */
+       seq <= iProbes;
+       seq++)
+  {
+    ToolsPerfQuery(&pProbes[seq - 1].psSent);
+    IPSendProbe(seq,
+                (seq - 1) / Options.ulQueries + 1);
+  }
+  ToolsPerfQuery(&psStart);
+
+  iLastHop = Options.ucTTL;
+  iPending = iProbes;
+  while (iPending)
+  {
+    ToolsPerfQuery(&psNow);
+    fLeft = Options.ulWait - (psNow.fSeconds - psStart.fSeconds);
+    if (fLeft <= 0)
+      break;
+
+    wait.tv_sec  = (long)fLeft;
+    wait.tv_usec = (long)((fLeft - wait.tv_sec) * 1000000);
+    FD_ZERO(&fds);
+    FD_SET (Globals.sockRecv,
+            &fds);
+    if (select(Globals.sockRecv + 1,
+               &fds,
+               (fd_set *)0,
+               (fd_set *)0,
+               &wait) <= 0)
+      continue;
+
+    fromlen = sizeof(from);
+    cc = recvfrom(Globals.sockRecv,
+                  (char *)Globals.PacketBuffer,
+                  sizeof(Globals.PacketBuffer),
+                  0,
+                  (struct sockaddr *)&from,
+                  &fromlen);
+    if (cc <= 0)
+      continue;
+    ToolsPerfQuery(&psNow);
+
+    i = IPICMPPacketCheck(Globals.PacketBuffer,
+                          cc,
+                          &from,
+                          0,
+                          &seq);
+    if (i == 0 || seq < 1 || seq > iProbes)
+      continue;
+
+    pProbe = &pProbes[seq - 1];
+    if (pProbe->iCode != 0)                                   /* duplicate */
+      continue;
+
+    pProbe->iCode      = i;
+    pProbe->Addr       = from.sin_addr;
+    pProbe->ucReplyTTL = ((struct ip *)Globals.PacketBuffer)->ip_ttl;
+    pProbe->fTime      = (psNow.fSeconds - pProbe->psSent.fSeconds) * 1000;
+
+    ttl = (seq - 1) / Options.ulQueries + 1;
+    if (i != -1 && ttl < iLastHop)         /* target or unreachable hop */
+      iLastHop = ttl;
+
+    for (iPending = 0, i = 0;        /* answers still missing up to there */
+         i < iLastHop * Options.ulQueries;
+         i++)
+      if (pProbes[i].iCode == 0)
+        iPending++;
+  }
+
+  for (ttl = 1;
+       ttl <= iLastHop;
+       ++ttl)
+  {
+    u_long lastaddr = 0;
+
+    printf("%2d",                                       /* print hop counter */
+           ttl);
+
+    for (probe = 0;
+         probe < Options.ulQueries;
+         ++probe)
+    {
+      pProbe = &pProbes[(ttl - 1) * Options.ulQueries + probe];
+      if (pProbe->iCode == 0)
+      {
+        printf(" *");
+        continue;
+      }
+
+      if (pProbe->Addr.s_addr != lastaddr)
+      {
+        if (Options.fsNumeric)
+          printf(" %-15s",
+                 inet_ntoa(pProbe->Addr));
+        else
+          printf(" %-39s(%-15s)",
+                 IPInterNetName(pProbe->Addr),
+                 inet_ntoa(pProbe->Addr));
+        lastaddr = pProbe->Addr.s_addr;
+      }
+
+      printf(" %7.2fms",
+             pProbe->fTime);
+
+      switch(pProbe->iCode - 1)
+      {
+        case ICMP_UNREACH_PORT:
+  #ifndef ARCHAIC
+          if (pProbe->ucReplyTTL <= 1)
+            printf(" !");
+  #endif /* ARCHAIC */
+          break;
+
+        case ICMP_UNREACH_NET:      printf(" !N"); break;
+        case ICMP_UNREACH_HOST:     printf(" !H"); break;
+        case ICMP_UNREACH_PROTOCOL: printf(" !P"); break;
+        case ICMP_UNREACH_NEEDFRAG: printf(" !F"); break;
+        case ICMP_UNREACH_SRCFAIL:  printf(" !S"); break;
+      }
+    }
+
+    putchar('\n');
+  }
+
+  fflush(stdout);
+  free(pProbes);
+
+  return (NO_ERROR);                                                   /* OK */
+}
+
+
 /*****************************************************************************
  * Name      : APIRET IPWaitForReply
  * Funktion  : wait for a reply packet
@@ -873,7 +1068,8 @@ PSZ IPICMPPacketType(UCHAR ucICMPType)
 int IPICMPPacketCheck(u_char             *buf,
                       int                cc,
                       struct sockaddr_in *from,
-                      int                seq)
+                      int                seq,
+                      int                *pSeq)
 {
    struct icmp *icp;
    u_char type, code;
@@ -905,8 +1101,13 @@ int IPICMPPacketCheck(u_char             *buf,
       up = (struct udphdr *)((u_char *)hip + hlen);
       if (hlen + 12 <= cc && hip->ip_p == IPPROTO_UDP &&
           up->uh_sport == htons(Globals.pidIdentifier) &&
-          up->uh_dport == htons(Options.usPort+seq))
+          (pSeq != NULL ||                         /* any probe of ours */
+           up->uh_dport == htons(Options.usPort+seq)))
+      {
+         if (pSeq != NULL)
+           *pSeq = (u_short)(ntohs(up->uh_dport) - Options.usPort);
          return (type == ICMP_TIMXCEED? -1 : code+1);
+      }
    }
 #ifndef ARCHAIC
    if (Options.fsVerbose) {
@@ -0,0 +1,174 @@
+/*
+ *  DosSubAllocMem / DosSubFreeMem benchmark
+ *
+ *  Times three allocation patterns on one serialized pool:
+ *    - LIFO: allocate a batch of equal blocks, free them in reverse
+ *    - random: mixed sizes, freed in random order, so the pool
+ *      fragments and allocations have to search or coalesce
+ *    - churn: fill with small blocks, free every other one, then ask
+ *      for blocks bigger than any hole until the pool has to merge
+ *  and checks the pool is whole again afterwards.
+ */
+
+#define INCL_DOSMEMMGR
+#define INCL_DOSMISC
+#define INCL_DOSERRORS
+
+#include <os2.h>
+
+#include <stdio.h>
+
+#define POOLSIZE   (1024 * 1024 + 64)
+#define NUMBLOCKS  4096
+#define ROUNDS     200
+
+static PVOID apv[NUMBLOCKS];
+static ULONG acb[NUMBLOCKS];
+static ULONG ulSeed = 12345;
+
+static ULONG Random(ULONG n)
+{
+  ulSeed = ulSeed * 1103515245 + 12345;
+  return (ulSeed >> 16) % n;
+}
+
+static ULONG Ticks(VOID)
+{
+  ULONG ms = 0;
+
+  DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ms, sizeof(ms));
+  return ms;
+}
+
+static int Lifo(PVOID pool)
+{
+  ULONG i, r;
+
+  for (r = 0; r < ROUNDS; r++)
+  {
+    for (i = 0; i < NUMBLOCKS; i++)
+      if (DosSubAllocMem(pool, &apv[i], 64))
+        return 1;
+
+    for (i = NUMBLOCKS; i--; )
+      if (DosSubFreeMem(pool, apv[i], 64))
+        return 1;
+  }
+
+  return 0;
+}
+
+static int Mixed(PVOID pool)
+{
+  ULONG i, j, r;
+
+  for (i = 0; i < NUMBLOCKS; i++)
+    apv[i] = NULL;
+
+  for (r = 0; r < ROUNDS * NUMBLOCKS; r++)
+  {
+    i = Random(NUMBLOCKS);
+
+    if (apv[i])
+    {
+      if (DosSubFreeMem(pool, apv[i], acb[i]))
+        return 1;
+      apv[i] = NULL;
+    }
+    else
+    {
+      // mostly small, some large
+      acb[i] = Random(8) ? 8 + Random(120) : 256 + Random(1024);
+
+      if (DosSubAllocMem(pool, &apv[i], acb[i]))
+        apv[i] = NULL;
+    }
+  }
+
+  for (j = 0; j < NUMBLOCKS; j++)
+    if (apv[j] && DosSubFreeMem(pool, apv[j], acb[j]))
+      return 1;
+
+  return 0;
+}
+
+static int Churn(PVOID pool)
+{
+  ULONG i, n, r;
+  PVOID pv;
+
+  for (r = 0; r < ROUNDS / 10; r++)
+  {
+    for (n = 0; n < NUMBLOCKS; n++)
+      if (DosSubAllocMem(pool, &apv[n], 128))
+        break;
+
+    for (i = 0; i < n; i += 2)
+      if (DosSubFreeMem(pool, apv[i], 128))
+        return 1;
+
+    for (i = 1; i < n; i += 2)
+      if (DosSubFreeMem(pool, apv[i], 128))
+        return 1;
+
+    // every hole is 128 bytes until they are merged
+    if (DosSubAllocMem(pool, &pv, 4096) ||
+        DosSubFreeMem(pool, pv, 4096))
+      return 1;
+  }
+
+  return 0;
+}
+
+static int Run(char *name, int (*fn)(PVOID), PVOID pool)
+{
+  ULONG t = Ticks();
+
+  if (fn(pool))
+  {
+    printf("%-8s failed\n", name);
+    return 1;
+  }
+
+  printf("%-8s %lu ms\n", name, Ticks() - t);
+  return 0;
+}
+
+int main(VOID)
+{
+  PVOID  pool;
+  PVOID  pv;
+  APIRET rc;
+  int    err = 0;
+
+  rc = DosAllocMem(&pool, POOLSIZE, PAG_READ | PAG_WRITE | PAG_COMMIT);
+  if (rc != NO_ERROR)
+  {
+    printf("DosAllocMem error: return code = %lu\n", rc);
+    return 1;
+  }
+
+  rc = DosSubSetMem(pool, DOSSUB_INIT | DOSSUB_SERIALIZE, POOLSIZE);
+  if (rc != NO_ERROR)
+  {
+    printf("DosSubSetMem error: return code = %lu\n", rc);
+    return 1;
+  }
+
+  err |= Run("lifo", Lifo, pool);
+  err |= Run("random", Mixed, pool);
+  err |= Run("churn", Churn, pool);
+
+  // everything was freed, so the whole pool must be one block again
+  rc = DosSubAllocMem(pool, &pv, POOLSIZE - 64);
+  if (rc != NO_ERROR)
+  {
+    printf("pool not whole after frees: return code = %lu\n", rc);
+    err = 1;
+  }
+
+  DosSubUnsetMem(pool);
+  DosFreeMem(pool);
+
+  return err;
+}
@@ -0,0 +1,143 @@
+/*
+ *  LVM CalculateCRC benchmark
+ *
+ *  Builds crc.c from the LVM engine into this program and checks it
+ *  against a plain bit at a time CRC for every buffer alignment and
+ *  lengths around the 8 byte steps, then times it against the old
+ *  byte at a time table loop over a DLA Table sized buffer and over
+ *  a BBR table sized one.
+ */
+
+#define INCL_DOSMISC
+#define INCL_DOSERRORS
+
+#include <os2.h>
+
+#include <stdio.h>
+
+#define DECLARE_LOGGING_GLOBALS
+#include "crc.c"
+#include "crc.h"
+
+#define BUFSIZE    (64 * 1024 + 16)
+#define ROUNDS     200
+
+static BYTE  ab[BUFSIZE];
+static ULONG ulSeed = 12345;
+
+// crc.c logs and profiles through these when logging is on, which it never is here
+void _System Write_Log_Buffer(void)
+{
+}
+
+void _System Profile_Entry(char *Name)
+{
+}
+
+void _System Profile_Exit(char *Name)
+{
+}
+
+static ULONG Random(ULONG n)
+{
+  ulSeed = ulSeed * 1103515245 + 12345;
+  return (ulSeed >> 16) % n;
+}
+
+static ULONG Ticks(VOID)
+{
+  ULONG ms = 0;
+
+  DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ms, sizeof(ms));
+  return ms;
+}
+
+static CARDINAL32 BitCRC(CARDINAL32 crc, BYTE *p, ULONG cb)
+{
+  ULONG i;
+
+  while (cb--)
+  {
+    crc ^= *p++;
+
+    for (i = 0; i < 8; i++)
+      crc = (crc & 1) ? (crc >> 1) ^ CRC_POLYNOMIAL : crc >> 1;
+  }
+
+  return crc;
+}
+
+// the loop CalculateCRC used before it took 8 bytes per step
+static CARDINAL32 ByteCRC(CARDINAL32 crc, BYTE *p, ULONG cb)
+{
+  while (cb--)
+    crc = ((crc >> 8) & 0x00FFFFFFL) ^ CRC_Table[0][(crc ^ *p++) & 0xff];
+
+  return crc;
+}
+
+static int Check(VOID)
+{
+  ULONG off, cb;
+  CARDINAL32 crc;
+
+  for (off = 0; off < 8; off++)
+    for (cb = 0; cb < 300; cb++)
+      if (CalculateCRC(INITIAL_CRC, ab + off, cb) != BitCRC(INITIAL_CRC, ab + off, cb))
+      {
+        printf("mismatch at offset %lu, length %lu\n", off, cb);
+        return 1;
+      }
+
+  // a CRC carried across calls must match one over the whole buffer
+  crc = CalculateCRC(INITIAL_CRC, ab + 3, 1001);
+  crc = CalculateCRC(crc, ab + 1004, 4000);
+
+  if (crc != BitCRC(INITIAL_CRC, ab + 3, 5001))
+  {
+    printf("mismatch across calls\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+static VOID Time(char *name, ULONG cb)
+{
+  ULONG t, r, n;
+  CARDINAL32 crc1 = INITIAL_CRC, crc2 = INITIAL_CRC;
+  ULONG tByte, tSlice;
+
+  n = ROUNDS * (BUFSIZE / cb);
+
+  t = Ticks();
+  for (r = 0; r < n; r++)
+    crc1 = ByteCRC(crc1, ab, cb);
+  tByte = Ticks() - t;
+
+  t = Ticks();
+  for (r = 0; r < n; r++)
+    crc2 = CalculateCRC(crc2, ab, cb);
+  tSlice = Ticks() - t;
+
+  printf("%-8s %6lu bytes x %6lu: byte %5lu ms, slice-by-8 %5lu ms%s\n",
+         name, cb, n, tByte, tSlice, (crc1 == crc2) ? "" : "  MISMATCH");
+}
+
+int main(VOID)
+{
+  ULONG i;
+
+  for (i = 0; i < BUFSIZE; i++)
+    ab[i] = (BYTE)Random(256);
+
+  Build_CRC_Table();
+
+  if (Check())
+    return 1;
+
+  Time("dlat", 512);
+  Time("bbr", 64 * 1024);
+
+  return 0;
+}
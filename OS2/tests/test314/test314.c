@@ -0,0 +1,233 @@
+/*
+ *  tedit batch benchmark
+ *
+ *  Generates text files of the sizes given on the command line (in MB,
+ *  default 1 16 64), then runs tedit in batch mode (-b) once per
+ *  operation with a generated profile holding the commands to time:
+ *  load only, LOCATE, CHANGE, SORT, SAVE and DELETE.  Each run is timed
+ *  from the outside and one line of comma separated results is printed
+ *  per run:
+ *
+ *    op,mb,lines,ms,net_ms,rc
+ *
+ *  where net_ms is ms less the load-only time for the same file.
+ *
+ *  tedit keeps the whole file in memory, so sizes past what a 32 bit
+ *  OS/2 process can allocate fail to load; that shows up as a non-zero
+ *  rc rather than as a time.
+ *
+ *  usage: test314 [-e tedit.exe] [mb ...]
+ */
+
+#define INCL_DOSMISC
+#define INCL_DOSPROCESS
+#define INCL_DOSERRORS
+
+#include <os2.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DATAFILE   "bench.txt"
+#define SAVEFILE   "bench.out"
+#define PROFILE    "bench.the"
+#define MAXSIZES   16
+
+typedef struct
+{
+  char *name;
+  char *commands;
+} OP;
+
+// each profile ends with QQUIT so tedit leaves without asking about changes
+static OP aOps[] =
+{
+  { "load",   "" },
+  { "locate", "top\nlocate /needle/\n" },
+  { "change", "top\nchange /alpha/ALPHA/ * *\n" },
+  { "sort",   "top\nsort * a 1 8\n" },
+  { "save",   "save " SAVEFILE "\n" },
+  { "delete", "top\ndelete *\n" }
+};
+
+#define NUMOPS (sizeof(aOps) / sizeof(aOps[0]))
+
+static char *apszWords[] =
+{
+  "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf",
+  "hotel", "india", "juliet", "kilo", "lima", "mike", "november"
+};
+
+#define NUMWORDS (sizeof(apszWords) / sizeof(apszWords[0]))
+
+static ULONG ulSeed = 12345;
+static char  szEditor[CCHMAXPATH] = "tedit.exe";
+
+static ULONG Random(ULONG n)
+{
+  ulSeed = ulSeed * 1103515245 + 12345;
+  return (ulSeed >> 16) % n;
+}
+
+static ULONG Ticks(VOID)
+{
+  ULONG ms = 0;
+
+  DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ms, sizeof(ms));
+  return ms;
+}
+
+// lines of 60 to 100 characters led by an 8 digit sort key; the last line holds the LOCATE target
+static ULONG Generate(ULONG mb)
+{
+  FILE *fp;
+  ULONG cbTotal = mb * 1024 * 1024;
+  ULONG cb = 0, cLines = 0;
+  ULONG cbLine, cbWant;
+  char  szLine[128];
+  char *w;
+
+  if ((fp = fopen(DATAFILE, "w")) == NULL)
+    return 0;
+
+  setvbuf(fp, NULL, _IOFBF, 32768);
+
+  while (cb < cbTotal)
+  {
+    cbWant = 60 + Random(40);
+    cbLine = sprintf(szLine, "%08lu", Random(100000000));
+
+    while (cbLine < cbWant)
+    {
+      w = apszWords[Random(NUMWORDS)];
+      cbLine += sprintf(szLine + cbLine, " %s", w);
+    }
+
+    if (cb + cbLine + 1 >= cbTotal)
+      cbLine = sprintf(szLine, "%08lu needle", 0UL);
+
+    fprintf(fp, "%s\n", szLine);
+    cb += cbLine + 1;
+    cLines++;
+  }
+
+  if (fclose(fp))
+    return 0;
+
+  return cLines;
+}
+
+static int WriteProfile(OP *pOp)
+{
+  FILE *fp;
+
+  if ((fp = fopen(PROFILE, "w")) == NULL)
+    return 1;
+
+  fprintf(fp, "%sqquit\n", pOp->commands);
+
+  return fclose(fp);
+}
+
+// runs tedit over the data file with the profile; returns ms, or -1 if it could not be started
+static LONG Run(ULONG *pulRc)
+{
+  RESULTCODES res;
+  char  achArgs[CCHMAXPATH + 64];
+  char  achFail[CCHMAXPATH];
+  ULONG cb;
+  ULONG t;
+  APIRET rc;
+
+  cb = sprintf(achArgs, "%s", szEditor) + 1;
+  cb += sprintf(achArgs + cb, "-b -p %s %s", PROFILE, DATAFILE) + 1;
+  achArgs[cb] = '\0';
+
+  t = Ticks();
+  rc = DosExecPgm(achFail, sizeof(achFail), EXEC_SYNC, achArgs, NULL, &res, szEditor);
+  t = Ticks() - t;
+
+  if (rc != NO_ERROR)
+  {
+    printf("# cannot start %s: rc %lu\n", szEditor, rc);
+    return -1;
+  }
+
+  *pulRc = res.codeResult;
+  return (LONG)t;
+}
+
+int main(int argc, char *argv[])
+{
+  ULONG aulMB[MAXSIZES] = { 1, 16, 64 };
+  ULONG cSizes = 3;
+  ULONG i, j, cLines, ulRc;
+  LONG  lLoad, lTime;
+  BOOL  fSizes = FALSE;
+  int   arg;
+
+  for (arg = 1; arg < argc; arg++)
+  {
+    if (!strcmp(argv[arg], "-e") && arg + 1 < argc)
+    {
+      strncpy(szEditor, argv[++arg], sizeof(szEditor) - 1);
+      continue;
+    }
+
+    // sizes given on the command line replace the defaults
+    if (!fSizes)
+    {
+      fSizes = TRUE;
+      cSizes = 0;
+    }
+
+    if (cSizes < MAXSIZES)
+      aulMB[cSizes++] = strtoul(argv[arg], NULL, 10);
+  }
+
+  printf("op,mb,lines,ms,net_ms,rc\n");
+
+  for (i = 0; i < cSizes; i++)
+  {
+    // the byte count is kept in a ULONG
+    if (aulMB[i] == 0 || aulMB[i] >= 4096)
+    {
+      printf("# %lu MB: size must be 1 to 4095\n", aulMB[i]);
+      continue;
+    }
+
+    if ((cLines = Generate(aulMB[i])) == 0)
+    {
+      printf("# cannot write %lu MB to %s\n", aulMB[i], DATAFILE);
+      return 1;
+    }
+
+    lLoad = 0;
+
+    for (j = 0; j < NUMOPS; j++)
+    {
+      if (WriteProfile(&aOps[j]))
+      {
+        printf("# cannot write %s\n", PROFILE);
+        return 1;
+      }
+
+      if ((lTime = Run(&ulRc)) < 0)
+        return 1;
+
+      if (j == 0)
+        lLoad = lTime;
+
+      printf("%s,%lu,%lu,%ld,%ld,%lu\n", aOps[j].name, aulMB[i], cLines,
+             lTime, lTime - lLoad, ulRc);
+      fflush(stdout);
+    }
+  }
+
+  remove(DATAFILE);
+  remove(SAVEFILE);
+  remove(PROFILE);
+
+  return 0;
+}
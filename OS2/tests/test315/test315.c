@@ -0,0 +1,839 @@
+/*
+ *  CPI micro-benchmark suite
+ *
+ *  Times the Dos* calls the rest of the system leans on hardest, one
+ *  call (or one round trip) per sample, and prints one line of comma
+ *  separated results per benchmark:
+ *
+ *    name,calls,ms,calls_per_sec,p50_us,p90_us,p99_us,max_us
+ *
+ *  Each benchmark runs a tenth of its iterations first as warm-up and
+ *  throws those samples away.  Samples come from the high resolution
+ *  timer, or from the TSC calibrated against QSV_MS_COUNT where that
+ *  is not available.
+ *
+ *  -o file writes the same lines to a file, to keep as a baseline.
+ *  -c file compares against such a baseline: three columns are added
+ *  (base_calls_per_sec, change_pct, status) and the exit code is 1 if
+ *  any benchmark lost more than -t percent (default 10) of its calls
+ *  per second.  Benchmarks that could not run print "skipped" and are
+ *  never counted as regressions.
+ *
+ *  usage: test315 [-n iterations] [-t pct] [-o out.csv] [-c base.csv]
+ *                 [-d workdir] [name ...]
+ *
+ *  Names select benchmarks by prefix ("read" runs all the read sizes).
+ */
+
+#define INCL_DOSFILEMGR
+#define INCL_DOSMEMMGR
+#define INCL_DOSSEMAPHORES
+#define INCL_DOSPROCESS
+#define INCL_DOSMODULEMGR
+#define INCL_DOSMISC
+#define INCL_DOSPROFILE
+#define INCL_DOSERRORS
+
+#include <os2.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXSAMPLES    100000
+#define MAXBUF        65536
+#define FINDFILES     1000
+#define MUTEXTHREADS  4
+#define MAXRESULTS    64
+#define MAXSELECT     16
+#define STACKSIZE     65536
+
+typedef unsigned long long TICKS;
+
+typedef struct _BENCH
+{
+  char  *name;
+  int   (*fn)(struct _BENCH *pb, ULONG cIter);
+  ULONG ulParm;
+  ULONG ulScale;                // iterations are divided by this
+} BENCH;
+
+typedef struct
+{
+  char   szName[32];
+  ULONG  cCalls;
+  double dMs;
+  double dCallsPerSec;
+  double dP50, dP90, dP99, dMax;        // us
+  BOOL   fSkipped;
+} RESULT;
+
+static TICKS  aSamples[MAXSAMPLES];
+static ULONG  cSamples;
+static double dTicksPerUs;
+static BOOL   fTmr;
+
+static char   abBuf[MAXBUF];
+static char   szDir[CCHMAXPATH] = "BENCH.TMP";
+static char   szPath[CCHMAXPATH];
+static char   szPath2[CCHMAXPATH];
+
+static RESULT aBase[MAXRESULTS];
+static ULONG  cBase;
+
+/* Ping-pong and contention state shared with the worker threads */
+static HEV             hevPing, hevPong, hevGo;
+static HMTX            hmtx;
+static volatile BOOL   fStop;
+static volatile ULONG  ulShared;
+static ULONG           cPerThread;
+
+/*
+ *  Timer
+ */
+
+#ifdef __WATCOMC__
+TICKS rdtsc(void);
+#pragma aux rdtsc = \
+    ".586"          \
+    "rdtsc"         \
+    value [edx eax] \
+    modify exact [edx eax];
+#else
+static TICKS rdtsc(void)
+{
+  unsigned long lo, hi;
+
+  __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((TICKS)hi << 32) | lo;
+}
+#endif
+
+static ULONG MsCount(VOID)
+{
+  ULONG ms = 0;
+
+  DosQuerySysInfo(QSV_MS_COUNT, QSV_MS_COUNT, &ms, sizeof(ms));
+  return ms;
+}
+
+static TICKS Ticks(VOID)
+{
+  QWORD qw;
+
+  if (fTmr && !DosTmrQueryTime(&qw))
+    return ((TICKS)qw.ulHi << 32) | qw.ulLo;
+  return rdtsc();
+}
+
+static VOID CalibrateTimer(VOID)
+{
+  ULONG ulFreq, ms0, ms1;
+  TICKS t0, t1;
+
+  if (!DosTmrQueryFreq(&ulFreq) && ulFreq)
+  {
+    fTmr = TRUE;
+    dTicksPerUs = ulFreq / 1000000.0;
+    return;
+  }
+
+  // line up with a millisecond edge, then count TSC ticks over 250 ms
+  ms0 = MsCount();
+  while ((ms1 = MsCount()) == ms0)
+    ;
+  t0 = rdtsc();
+  DosSleep(250);
+  while ((ms0 = MsCount()) - ms1 < 250)
+    ;
+  t1 = rdtsc();
+
+  dTicksPerUs = (double)(t1 - t0) / ((ms0 - ms1) * 1000.0);
+}
+
+static VOID Sample(TICKS t)
+{
+  if (cSamples < MAXSAMPLES)
+    aSamples[cSamples++] = t;
+}
+
+static int CompareTicks(const void *a, const void *b)
+{
+  TICKS ta = *(const TICKS *)a, tb = *(const TICKS *)b;
+
+  return ta < tb ? -1 : ta > tb;
+}
+
+static double Percentile(ULONG pct)
+{
+  ULONG i = (ULONG)(((double)cSamples * pct) / 100.0);
+
+  if (i >= cSamples)
+    i = cSamples - 1;
+  return aSamples[i] / dTicksPerUs;
+}
+
+/*
+ *  Scratch files
+ */
+
+static char *WorkFile(char *psz, char *pszName)
+{
+  sprintf(psz, "%s\\%s", szDir, pszName);
+  return psz;
+}
+
+static APIRET MakeFile(char *pszName, ULONG cb)
+{
+  HFILE  hf;
+  ULONG  ulAction, cbDone;
+  APIRET rc;
+
+  rc = DosOpen(pszName, &hf, &ulAction, cb, FILE_NORMAL,
+               OPEN_ACTION_CREATE_IF_NEW | OPEN_ACTION_REPLACE_IF_EXISTS,
+               OPEN_ACCESS_READWRITE | OPEN_SHARE_DENYNONE, NULL);
+  if (rc)
+    return rc;
+
+  while (!rc && cb)
+  {
+    ULONG n = cb < MAXBUF ? cb : MAXBUF;
+
+    rc = DosWrite(hf, abBuf, n, &cbDone);
+    cb -= n;
+  }
+
+  DosClose(hf);
+  return rc;
+}
+
+static VOID CleanDir(char *pszDir)
+{
+  FILEFINDBUF3 ffb;
+  HDIR         hdir = HDIR_CREATE;
+  ULONG        cFound = 1;
+  char         szSpec[CCHMAXPATH];
+
+  sprintf(szSpec, "%s\\*", pszDir);
+  if (!DosFindFirst(szSpec, &hdir, FILE_NORMAL, &ffb, sizeof(ffb),
+                    &cFound, FIL_STANDARD))
+  {
+    do
+    {
+      sprintf(szSpec, "%s\\%s", pszDir, ffb.achName);
+      DosDelete(szSpec);
+      cFound = 1;
+    } while (!DosFindNext(hdir, &ffb, sizeof(ffb), &cFound));
+    DosFindClose(hdir);
+  }
+
+  DosDeleteDir(pszDir);
+}
+
+/*
+ *  File benchmarks
+ */
+
+static int BenchOpen(BENCH *pb, ULONG cIter)
+{
+  HFILE hf;
+  ULONG ulAction, i;
+  TICKS t;
+
+  if (MakeFile(WorkFile(szPath, "open.dat"), 4096))
+    return 1;
+
+  for (i = 0; i < cIter; i++)
+  {
+    t = Ticks();
+    if (DosOpen(szPath, &hf, &ulAction, 0, FILE_NORMAL,
+                OPEN_ACTION_FAIL_IF_NEW | OPEN_ACTION_OPEN_IF_EXISTS,
+                OPEN_ACCESS_READONLY | OPEN_SHARE_DENYNONE, NULL))
+      return 1;
+    DosClose(hf);
+    Sample(Ticks() - t);
+  }
+
+  return 0;
+}
+
+static int BenchRead(BENCH *pb, ULONG cIter)
+{
+  HFILE  hf;
+  ULONG  ulAction, ulPos, cbDone, i;
+  TICKS  t;
+  int    err = 0;
+
+  if (MakeFile(WorkFile(szPath, "read.dat"), pb->ulParm) ||
+      DosOpen(szPath, &hf, &ulAction, 0, FILE_NORMAL,
+              OPEN_ACTION_FAIL_IF_NEW | OPEN_ACTION_OPEN_IF_EXISTS,
+              OPEN_ACCESS_READONLY | OPEN_SHARE_DENYNONE, NULL))
+    return 1;
+
+  for (i = 0; i < cIter && !err; i++)
+  {
+    DosSetFilePtr(hf, 0, FILE_BEGIN, &ulPos);
+    t = Ticks();
+    err = DosRead(hf, abBuf, pb->ulParm, &cbDone) || cbDone != pb->ulParm;
+    Sample(Ticks() - t);
+  }
+
+  DosClose(hf);
+  return err;
+}
+
+static int BenchWrite(BENCH *pb, ULONG cIter)
+{
+  HFILE  hf;
+  ULONG  ulAction, ulPos, cbDone, i;
+  TICKS  t;
+  int    err = 0;
+
+  if (DosOpen(WorkFile(szPath, "write.dat"), &hf, &ulAction, 0, FILE_NORMAL,
+              OPEN_ACTION_CREATE_IF_NEW | OPEN_ACTION_REPLACE_IF_EXISTS,
+              OPEN_ACCESS_READWRITE | OPEN_SHARE_DENYNONE, NULL))
+    return 1;
+
+  for (i = 0; i < cIter && !err; i++)
+  {
+    DosSetFilePtr(hf, 0, FILE_BEGIN, &ulPos);
+    t = Ticks();
+    err = DosWrite(hf, abBuf, pb->ulParm, &cbDone) || cbDone != pb->ulParm;
+    Sample(Ticks() - t);
+  }
+
+  DosClose(hf);
+  return err;
+}
+
+static int BenchCopy(BENCH *pb, ULONG cIter)
+{
+  ULONG i;
+  TICKS t;
+
+  if (MakeFile(WorkFile(szPath, "copy.src"), pb->ulParm))
+    return 1;
+  WorkFile(szPath2, "copy.dst");
+
+  for (i = 0; i < cIter; i++)
+  {
+    t = Ticks();
+    if (DosCopy(szPath, szPath2, DCPY_EXISTING))
+      return 1;
+    Sample(Ticks() - t);
+  }
+
+  return 0;
+}
+
+/*
+ *  One sample is a whole enumeration of a FINDFILES entry directory,
+ *  asking for ulParm entries per call
+ */
+static int BenchFind(BENCH *pb, ULONG cIter)
+{
+  static BOOL  fMade = FALSE;
+  FILEFINDBUF3 *pffb = (FILEFINDBUF3 *)abBuf;
+  HDIR         hdir;
+  ULONG        cFound, cTotal, i;
+  char         szSpec[CCHMAXPATH];
+  TICKS        t;
+
+  WorkFile(szSpec, "find");
+  if (!fMade)
+  {
+    DosCreateDir(szSpec, NULL);
+    for (i = 0; i < FINDFILES; i++)
+    {
+      sprintf(szPath, "%s\\file%04lu.dat", szSpec, i);
+      if (MakeFile(szPath, 0))
+        return 1;
+    }
+    fMade = TRUE;
+  }
+  strcat(szSpec, "\\*.dat");
+
+  for (i = 0; i < cIter; i++)
+  {
+    t = Ticks();
+    hdir = HDIR_CREATE;
+    cFound = pb->ulParm;
+    if (DosFindFirst(szSpec, &hdir, FILE_NORMAL, pffb, MAXBUF,
+                     &cFound, FIL_STANDARD))
+      return 1;
+    cTotal = cFound;
+    cFound = pb->ulParm;
+    while (!DosFindNext(hdir, pffb, MAXBUF, &cFound))
+    {
+      cTotal += cFound;
+      cFound = pb->ulParm;
+    }
+    DosFindClose(hdir);
+    Sample(Ticks() - t);
+
+    if (cTotal != FINDFILES)
+      return 1;
+  }
+
+  return 0;
+}
+
+/*
+ *  Semaphore benchmarks
+ */
+
+static VOID APIENTRY PongThread(ULONG ulArg)
+{
+  ULONG cPosts;
+
+  for (;;)
+  {
+    DosWaitEventSem(hevPing, SEM_INDEFINITE_WAIT);
+    DosResetEventSem(hevPing, &cPosts);
+    if (fStop)
+      break;
+    DosPostEventSem(hevPong);
+  }
+}
+
+/* One sample is a post to the other thread and its post back */
+static int BenchPingPong(BENCH *pb, ULONG cIter)
+{
+  TID   tid;
+  ULONG cPosts, i;
+  TICKS t;
+
+  if (DosCreateEventSem(NULL, &hevPing, 0, FALSE) ||
+      DosCreateEventSem(NULL, &hevPong, 0, FALSE))
+    return 1;
+
+  fStop = FALSE;
+  if (DosCreateThread(&tid, PongThread, 0, CREATE_READY | STACK_COMMITTED,
+                      STACKSIZE))
+    return 1;
+
+  for (i = 0; i < cIter; i++)
+  {
+    t = Ticks();
+    DosPostEventSem(hevPing);
+    DosWaitEventSem(hevPong, SEM_INDEFINITE_WAIT);
+    DosResetEventSem(hevPong, &cPosts);
+    Sample(Ticks() - t);
+  }
+
+  fStop = TRUE;
+  DosPostEventSem(hevPing);
+  DosWaitThread(&tid, DCWW_WAIT);
+
+  DosCloseEventSem(hevPing);
+  DosCloseEventSem(hevPong);
+  return 0;
+}
+
+/* Each worker fills its own stretch of aSamples */
+static VOID APIENTRY MutexThread(ULONG ulArg)
+{
+  TICKS *pt = &aSamples[ulArg * cPerThread];
+  ULONG i;
+  TICKS t;
+
+  DosWaitEventSem(hevGo, SEM_INDEFINITE_WAIT);
+
+  for (i = 0; i < cPerThread; i++)
+  {
+    t = Ticks();
+    DosRequestMutexSem(hmtx, SEM_INDEFINITE_WAIT);
+    pt[i] = Ticks() - t;
+    ulShared++;
+    DosReleaseMutexSem(hmtx);
+  }
+}
+
+/* One sample is one request, with MUTEXTHREADS threads contending */
+static int BenchMutex(BENCH *pb, ULONG cIter)
+{
+  TID   atid[MUTEXTHREADS];
+  ULONG i;
+
+  cPerThread = cIter / MUTEXTHREADS;
+  if (cPerThread * MUTEXTHREADS > MAXSAMPLES)
+    cPerThread = MAXSAMPLES / MUTEXTHREADS;
+
+  if (DosCreateMutexSem(NULL, &hmtx, 0, FALSE) ||
+      DosCreateEventSem(NULL, &hevGo, 0, FALSE))
+    return 1;
+
+  ulShared = 0;
+  for (i = 0; i < MUTEXTHREADS; i++)
+    if (DosCreateThread(&atid[i], MutexThread, i,
+                        CREATE_READY | STACK_COMMITTED, STACKSIZE))
+      return 1;
+
+  DosPostEventSem(hevGo);
+  for (i = 0; i < MUTEXTHREADS; i++)
+    DosWaitThread(&atid[i], DCWW_WAIT);
+
+  cSamples = cPerThread * MUTEXTHREADS;
+
+  DosCloseEventSem(hevGo);
+  DosCloseMutexSem(hmtx);
+
+  // a lost update means the mutex let two threads in at once
+  return ulShared != cSamples;
+}
+
+/*
+ *  Memory benchmarks
+ */
+
+static int BenchAlloc(BENCH *pb, ULONG cIter)
+{
+  PVOID pv;
+  ULONG i;
+  TICKS t;
+
+  for (i = 0; i < cIter; i++)
+  {
+    t = Ticks();
+    if (DosAllocMem(&pv, pb->ulParm, PAG_READ | PAG_WRITE | PAG_COMMIT))
+      return 1;
+    DosFreeMem(pv);
+    Sample(Ticks() - t);
+  }
+
+  return 0;
+}
+
+/* Mixed sizes in a pool kept about half full, one alloc or free a sample */
+static int BenchSubAlloc(BENCH *pb, ULONG cIter)
+{
+  static PVOID apv[1024];
+  static ULONG acb[1024];
+  PVOID pool;
+  ULONG ulSeed = 12345, i, j;
+  TICKS t;
+  int   err = 0;
+
+  if (DosAllocMem(&pool, 1024 * 1024, PAG_READ | PAG_WRITE | PAG_COMMIT))
+    return 1;
+  if (DosSubSetMem(pool, DOSSUB_INIT, 1024 * 1024))
+  {
+    DosFreeMem(pool);
+    return 1;
+  }
+
+  memset(apv, 0, sizeof(apv));
+
+  for (i = 0; i < cIter && !err; i++)
+  {
+    ulSeed = ulSeed * 1103515245 + 12345;
+    j = (ulSeed >> 16) % 1024;
+
+    t = Ticks();
+    if (apv[j])
+    {
+      err = DosSubFreeMem(pool, apv[j], acb[j]);
+      apv[j] = NULL;
+    }
+    else
+    {
+      acb[j] = 8 << ((ulSeed >> 8) % 6);
+      err = DosSubAllocMem(pool, &apv[j], acb[j]);
+    }
+    Sample(Ticks() - t);
+  }
+
+  DosSubUnsetMem(pool);
+  DosFreeMem(pool);
+  return err;
+}
+
+/*
+ *  Message and module benchmarks
+ */
+
+static int BenchGetMessage(BENCH *pb, ULONG cIter)
+{
+  ULONG cbMsg, i;
+  TICKS t;
+
+  for (i = 0; i < cIter; i++)
+  {
+    t = Ticks();
+    if (DosGetMessage(NULL, 0, abBuf, MAXBUF, pb->ulParm, "OSO001.MSG", &cbMsg))
+      return -1;
+    Sample(Ticks() - t);
+  }
+
+  return 0;
+}
+
+static int BenchLoadModule(BENCH *pb, ULONG cIter)
+{
+  HMODULE hmod;
+  char    szFail[CCHMAXPATH];
+  ULONG   i;
+  TICKS   t;
+
+  for (i = 0; i < cIter; i++)
+  {
+    t = Ticks();
+    if (DosLoadModule(szFail, sizeof(szFail), "DOSCALLS", &hmod))
+      return 1;
+    DosFreeModule(hmod);
+    Sample(Ticks() - t);
+  }
+
+  return 0;
+}
+
+/* ulParm 0 looks the entry up by name, else by that ordinal */
+static int BenchQueryProcAddr(BENCH *pb, ULONG cIter)
+{
+  HMODULE hmod;
+  PFN     pfn;
+  ULONG   i;
+  TICKS   t;
+
+  if (DosQueryModuleHandle("DOSCALLS", &hmod))
+    return 1;
+
+  for (i = 0; i < cIter; i++)
+  {
+    t = Ticks();
+    if (DosQueryProcAddr(hmod, pb->ulParm,
+                         pb->ulParm ? NULL : "DosQuerySysInfo", &pfn))
+      return 1;
+    Sample(Ticks() - t);
+  }
+
+  return 0;
+}
+
+static BENCH aBench[] =
+{
+  { "open",            BenchOpen,          0,     1 },
+  { "read_512",        BenchRead,          512,   1 },
+  { "read_4096",       BenchRead,          4096,  1 },
+  { "read_65536",      BenchRead,          65536, 4 },
+  { "write_512",       BenchWrite,         512,   1 },
+  { "write_4096",      BenchWrite,         4096,  1 },
+  { "write_65536",     BenchWrite,         65536, 4 },
+  { "copy_65536",      BenchCopy,          65536, 10 },
+  { "find_1",          BenchFind,          1,     100 },
+  { "find_64",         BenchFind,          64,    100 },
+  { "event_pingpong",  BenchPingPong,      0,     1 },
+  { "mutex_contended", BenchMutex,         0,     1 },
+  { "alloc_64k",       BenchAlloc,         65536, 1 },
+  { "alloc_1m",        BenchAlloc,         1024 * 1024, 4 },
+  { "suballoc",        BenchSubAlloc,      0,     1 },
+  { "getmessage",      BenchGetMessage,    2,     1 },
+  { "loadmodule",      BenchLoadModule,    0,     1 },
+  { "queryprocaddr",   BenchQueryProcAddr, 0,     1 },
+  { "queryprocaddr_ord", BenchQueryProcAddr, 348, 1 }   // DosQuerySysInfo
+};
+
+#define NUMBENCH (sizeof(aBench) / sizeof(aBench[0]))
+
+/*
+ *  Running and reporting
+ */
+
+static VOID RunBench(BENCH *pb, ULONG cIter, RESULT *pr)
+{
+  TICKS  t, tSum;
+  ULONG  i;
+  int    rc;
+
+  memset(pr, 0, sizeof(*pr));
+  strncpy(pr->szName, pb->name, sizeof(pr->szName) - 1);
+
+  cIter /= pb->ulScale;
+  if (!cIter)
+    cIter = 1;
+  if (cIter > MAXSAMPLES)
+    cIter = MAXSAMPLES;
+
+  // warm-up: caches, first-touch page faults, lazy initialization
+  cSamples = 0;
+  rc = pb->fn(pb, cIter / 10 ? cIter / 10 : 1);
+
+  if (!rc)
+  {
+    cSamples = 0;
+    t = Ticks();
+    rc = pb->fn(pb, cIter);
+    t = Ticks() - t;
+  }
+
+  if (rc || !cSamples)
+  {
+    pr->fSkipped = TRUE;
+    return;
+  }
+
+  for (tSum = 0, i = 0; i < cSamples; i++)
+    tSum += aSamples[i];
+  qsort(aSamples, cSamples, sizeof(aSamples[0]), CompareTicks);
+
+  pr->cCalls = cSamples;
+  pr->dMs = t / dTicksPerUs / 1000.0;
+  // from the summed samples, so the threaded ones are not undercounted
+  pr->dCallsPerSec = tSum ? cSamples / (tSum / dTicksPerUs / 1000000.0) : 0;
+  pr->dP50 = Percentile(50);
+  pr->dP90 = Percentile(90);
+  pr->dP99 = Percentile(99);
+  pr->dMax = aSamples[cSamples - 1] / dTicksPerUs;
+}
+
+static VOID PrintResult(FILE *f, RESULT *pr)
+{
+  if (pr->fSkipped)
+    fprintf(f, "%s,skipped", pr->szName);
+  else
+    fprintf(f, "%s,%lu,%.1f,%.0f,%.2f,%.2f,%.2f,%.2f",
+            pr->szName, pr->cCalls, pr->dMs, pr->dCallsPerSec,
+            pr->dP50, pr->dP90, pr->dP99, pr->dMax);
+}
+
+static int LoadBaseline(char *pszFile)
+{
+  FILE   *f;
+  char   szLine[256];
+  RESULT *pr;
+
+  if (!(f = fopen(pszFile, "r")))
+    return 1;
+
+  while (cBase < MAXRESULTS && fgets(szLine, sizeof(szLine), f))
+  {
+    pr = &aBase[cBase];
+    memset(pr, 0, sizeof(*pr));
+
+    if (sscanf(szLine, "%31[^,],%lu,%lf,%lf,%lf,%lf,%lf,%lf",
+               pr->szName, &pr->cCalls, &pr->dMs, &pr->dCallsPerSec,
+               &pr->dP50, &pr->dP90, &pr->dP99, &pr->dMax) == 8)
+      cBase++;
+  }
+
+  fclose(f);
+  return 0;
+}
+
+static RESULT *FindBaseline(char *pszName)
+{
+  ULONG i;
+
+  for (i = 0; i < cBase; i++)
+    if (!strcmp(aBase[i].szName, pszName))
+      return &aBase[i];
+  return NULL;
+}
+
+static BOOL Selected(char *pszName, char **apszSel, ULONG cSel)
+{
+  ULONG i;
+
+  if (!cSel)
+    return TRUE;
+  for (i = 0; i < cSel; i++)
+    if (!strncmp(pszName, apszSel[i], strlen(apszSel[i])))
+      return TRUE;
+  return FALSE;
+}
+
+int main(int argc, char *argv[])
+{
+  ULONG   cIter = 10000, ulThreshold = 10, cSel = 0, i;
+  char    *pszOut = NULL, *pszBase = NULL;
+  char    *apszSel[MAXSELECT];
+  FILE    *fOut = NULL;
+  RESULT  r, *pBase;
+  double  dChange;
+  int     arg, err = 0;
+
+  for (arg = 1; arg < argc; arg++)
+  {
+    if (!strcmp(argv[arg], "-n") && arg + 1 < argc)
+      cIter = strtoul(argv[++arg], NULL, 10);
+    else if (!strcmp(argv[arg], "-t") && arg + 1 < argc)
+      ulThreshold = strtoul(argv[++arg], NULL, 10);
+    else if (!strcmp(argv[arg], "-o") && arg + 1 < argc)
+      pszOut = argv[++arg];
+    else if (!strcmp(argv[arg], "-c") && arg + 1 < argc)
+      pszBase = argv[++arg];
+    else if (!strcmp(argv[arg], "-d") && arg + 1 < argc)
+      strncpy(szDir, argv[++arg], sizeof(szDir) - 1);
+    else if (argv[arg][0] == '-')
+    {
+      printf("usage: %s [-n iterations] [-t pct] [-o out.csv] [-c base.csv]\n"
+             "       [-d workdir] [name ...]\n", argv[0]);
+      return 2;
+    }
+    else if (cSel < MAXSELECT)
+      apszSel[cSel++] = argv[arg];
+  }
+
+  if (pszBase && LoadBaseline(pszBase))
+  {
+    printf("cannot read baseline %s\n", pszBase);
+    return 2;
+  }
+
+  if (pszOut && !(fOut = fopen(pszOut, "w")))
+  {
+    printf("cannot create %s\n", pszOut);
+    return 2;
+  }
+
+  memset(abBuf, 'x', sizeof(abBuf));
+  CalibrateTimer();
+  DosCreateDir(szDir, NULL);
+
+  printf("name,calls,ms,calls_per_sec,p50_us,p90_us,p99_us,max_us%s\n",
+         pszBase ? ",base_calls_per_sec,change_pct,status" : "");
+
+  for (i = 0; i < NUMBENCH; i++)
+  {
+    if (!Selected(aBench[i].name, apszSel, cSel))
+      continue;
+
+    RunBench(&aBench[i], cIter, &r);
+    PrintResult(stdout, &r);
+
+    if (fOut)
+    {
+      PrintResult(fOut, &r);
+      fprintf(fOut, "\n");
+    }
+
+    if (pszBase)
+    {
+      if (r.fSkipped)
+        printf(",,,");
+      else if (!(pBase = FindBaseline(r.szName)) || !pBase->dCallsPerSec)
+        printf(",,,new");
+      else
+      {
+        dChange = (r.dCallsPerSec - pBase->dCallsPerSec) * 100.0 /
+                  pBase->dCallsPerSec;
+        printf(",%.0f,%+.1f,%s", pBase->dCallsPerSec, dChange,
+               dChange < -(double)ulThreshold ? "REGRESSED" : "ok");
+        if (dChange < -(double)ulThreshold)
+          err = 1;
+      }
+    }
+
+    printf("\n");
+    fflush(stdout);
+  }
+
+  if (fOut)
+    fclose(fOut);
+
+  WorkFile(szPath, "find");
+  CleanDir(szPath);
+  CleanDir(szDir);
+
+  return err;
+}
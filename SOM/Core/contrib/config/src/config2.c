@@ -135,6 +135,7 @@ HAVE_SEH_TRY_EXCEPT					"Looking for __try/__except"
 HAVE_SEH_TRY_FINALLY				"Looking for __try/__finally"
 HAVE_DECLSPEC_DLLEXPORT				"Looking for __declspec(dllexport)"
 HAVE_DECLSPEC_DLLIMPORT				"Looking for __declspec(dllimport)"
+HAVE_THREAD_STORAGE					"Looking for __thread"
 HAVE_LONG_DOUBLE					"Looking for long double"
 HAVE_SOCKADDR_SA_LEN				"Looking for sockaddr.sa_len"
 HAVE_SOCKLEN_T						"Looking for socklen_t"
@@ -259,6 +260,11 @@ HAVE_SCARDLISTREADERGROUPS			"Looking for SCardListReaderGroups()"
 HAVE_WINSCARD_UNSIGNED_LONG			"Looking for SCardListReaders(unsigned long)"
 HAVE_INTERLOCKEDINCREMENT_VOLATILE	"Looking for InterlockedIncrement(volatile...)"
 HAVE_INTERLOCKEDEXCHANGE			"Looking for InterlockedExchange()"
+HAVE_ATOMIC_ADD_FETCH				"Looking for __atomic_add_fetch()"
+HAVE_SYNC_ADD_AND_FETCH				"Looking for __sync_add_and_fetch()"
+HAVE_EPOLL_CREATE					"Looking for epoll_create()"
+HAVE_KQUEUE							"Looking for kqueue()"
+HAVE_MMAP							"Looking for mmap()"
 HAVE_WAITFORSINGLEOBJECTEX			"Looking for WaitForSingleObjectEx()"
 HAVE_D2I_X509_CONST					"Looking for d2i_x509(...const...)"
 HAVE_XTDEFAULTAPPCONTEXT			"Looking for _XtDefaultAppContext()"
@@ -765,6 +771,10 @@ USE_IN6ADDR_ANY_INIT_BRACES2		"Looking for {{IN6ADDR_ANY_INIT}}"
 #	endif
 	__declspec(dllexport) int myfunc(int x) { return x; }
 	COMPLETE_PROGRAM
+#elif defined(TRY_HAVE_THREAD_STORAGE)
+	static __thread int value;
+	MAINLINE
+	{ value=argc; return argv ? (value!=argc) : 1; }
 #elif defined(TRY_HAVE_DECLSPEC_DLLIMPORT)
 #	ifdef BUILD_STATIC
 		#error BUILD_STATIC
@@ -895,6 +905,40 @@ static volatile LONG l=-2;
 	MAINLINE
 	{ LONG l=0;
 	return InterlockedExchange(&l,1); }
+#elif defined(TRY_HAVE_ATOMIC_ADD_FETCH)
+	MAINLINE
+	{ static int l=-1;
+	return __atomic_add_fetch(&l,1,__ATOMIC_ACQ_REL) ? 1 : 
+		(__atomic_sub_fetch(&l,1,__ATOMIC_ACQ_REL)==-1) ? ((argc&&argv)?0:1) : 1; }
+#elif defined(TRY_HAVE_SYNC_ADD_AND_FETCH)
+	MAINLINE
+	{ static int l=-1;
+	return __sync_add_and_fetch(&l,1) ? 1 : 
+		(__sync_sub_and_fetch(&l,1)==-1) ? ((argc&&argv)?0:1) : 1; }
+#elif defined(TRY_HAVE_EPOLL_CREATE)
+#	include <sys/epoll.h>
+	MAINLINE
+	{ struct epoll_event ev; int fd=epoll_create(1);
+	ev.events=EPOLLIN; ev.data.ptr=argv;
+	return ((fd < 0) || (argc < 0)) ? 1 : epoll_ctl(fd,EPOLL_CTL_DEL,0,&ev)==-12345; }
+#elif defined(TRY_HAVE_KQUEUE)
+#	ifdef HAVE_SYS_TYPES_H
+#		include <sys/types.h>
+#	endif
+#	include <sys/event.h>
+#	include <sys/time.h>
+	MAINLINE
+	{ struct kevent kev; int fd=kqueue();
+	EV_SET(&kev,0,EVFILT_READ,EV_ADD,0,0,argv);
+	return ((fd < 0) || (argc < 0)) ? 1 : (kevent(fd,&kev,0,NULL,0,NULL) < 0); }
+#elif defined(TRY_HAVE_MMAP)
+#	ifdef HAVE_SYS_TYPES_H
+#		include <sys/types.h>
+#	endif
+#	include <sys/mman.h>
+	MAINLINE
+	{ void *p=mmap(NULL,4096,PROT_READ,MAP_SHARED,argc,0);
+	return (p==MAP_FAILED) ? (argv ? 0 : 1) : munmap(p,4096); }
 #elif defined(TRY_HAVE_WAITFORSINGLEOBJECTEX)
 #	include <windows.h>
 	MAINLINE
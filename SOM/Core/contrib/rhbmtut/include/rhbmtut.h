@@ -187,6 +187,12 @@ parm [eax] modify [];
 
 #	define	rhbatomic_inc(x)		LockedIncrement(x)
 #	define	rhbatomic_dec(x)		LockedDecrement(x)
+#elif !defined(BUILD_RHBMTUT) && defined(HAVE_ATOMIC_ADD_FETCH)
+#	define	rhbatomic_inc(x)		__atomic_add_fetch(x,1,__ATOMIC_ACQ_REL)
+#	define	rhbatomic_dec(x)		__atomic_sub_fetch(x,1,__ATOMIC_ACQ_REL)
+#elif !defined(BUILD_RHBMTUT) && defined(HAVE_SYNC_ADD_AND_FETCH)
+#	define	rhbatomic_inc(x)		__sync_add_and_fetch(x,1)
+#	define	rhbatomic_dec(x)		__sync_sub_and_fetch(x,1)
 #else
 RHBMTUTAPI_(rhbatomic_t) rhbatomic_inc(rhbatomic_t *);
 RHBMTUTAPI_(rhbatomic_t) rhbatomic_dec(rhbatomic_t *);
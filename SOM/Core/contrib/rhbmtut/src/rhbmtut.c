@@ -52,6 +52,15 @@ static void gMutex_init(void)
 #	define 	RHBMTUT_GLOBAL_LOCK_INIT
 #endif
 
+/* the compiler's own atomics when configure found them, the lock otherwise */
+#if defined(HAVE_ATOMIC_ADD_FETCH)
+#	define RHBMTUT_ATOMIC_INC(x)		__atomic_add_fetch(x,1,__ATOMIC_ACQ_REL)
+#	define RHBMTUT_ATOMIC_DEC(x)		__atomic_sub_fetch(x,1,__ATOMIC_ACQ_REL)
+#elif defined(HAVE_SYNC_ADD_AND_FETCH)
+#	define RHBMTUT_ATOMIC_INC(x)		__sync_add_and_fetch(x,1)
+#	define RHBMTUT_ATOMIC_DEC(x)		__sync_sub_and_fetch(x,1)
+#endif
+
 #if defined(USE_PTHREADS) && defined(USE_THREADS)
 #	define RHBMTUT_GLOBAL_LOCK			pthread_mutex_lock(&gMutex);
 #	define RHBMTUT_GLOBAL_UNLOCK		pthread_mutex_unlock(&gMutex);
@@ -67,7 +76,9 @@ static void gMutex_init(void)
 
 RHBMTUTAPI_(rhbatomic_t) rhbatomic_inc(rhbatomic_t *pl)
 {
-#if defined(RHBMTUT_GLOBAL_LOCK) && defined(RHBMTUT_GLOBAL_UNLOCK)
+#if defined(RHBMTUT_ATOMIC_INC)
+	return RHBMTUT_ATOMIC_INC(pl);
+#elif defined(RHBMTUT_GLOBAL_LOCK) && defined(RHBMTUT_GLOBAL_UNLOCK)
 	register int x;
 	RHBMTUT_GLOBAL_LOCK_INIT
 	RHBMTUT_GLOBAL_LOCK
@@ -81,7 +92,9 @@ RHBMTUTAPI_(rhbatomic_t) rhbatomic_inc(rhbatomic_t *pl)
 
 RHBMTUTAPI_(rhbatomic_t) rhbatomic_dec(rhbatomic_t *pl)
 {
-#if defined(RHBMTUT_GLOBAL_LOCK) && defined(RHBMTUT_GLOBAL_UNLOCK)
+#if defined(RHBMTUT_ATOMIC_DEC)
+	return RHBMTUT_ATOMIC_DEC(pl);
+#elif defined(RHBMTUT_GLOBAL_LOCK) && defined(RHBMTUT_GLOBAL_UNLOCK)
 	register int x;
 	RHBMTUT_GLOBAL_LOCK_INIT
 	RHBMTUT_GLOBAL_LOCK
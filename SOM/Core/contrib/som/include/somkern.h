@@ -313,6 +313,13 @@ struct somClassInfoData
 	} classes;
 
 	RHBSOMUT_KeyData keyed_data;
+
+	/* hashed lookups built by SOMKERN_build_lookup(), read unlocked */
+	struct somParentClassInfo **resolve_hash;	/* by owner class, MI only */
+	unsigned long resolve_mask;
+	struct somNameHash *name_hash;				/* mtokens by name */
+
+	struct somInstanceArena *arena;				/* see somcls_somAllocate() */
 };
 
 struct somMethodTabStruct
@@ -391,9 +398,22 @@ typedef struct som_globals_t
 #endif
 } som_globals_t;
 
+/* blocks a thread keeps per SOMMalloc size class, see somalloc.c */
+#define SOMKERN_POOL_CLASSES		8
+
+struct somPoolCache
+{
+	void *free[SOMKERN_POOL_CLASSES];
+	unsigned short count[SOMKERN_POOL_CLASSES];
+	boolean closed;
+};
+
 typedef struct som_thread_globals_t
 {
 	Environment ev;
+#ifdef USE_THREADS
+	struct somPoolCache pool;
+#endif
 #ifdef RHBOPT_SHARED_DATA
 	#ifdef _WIN32
 		unsigned long tid;
@@ -462,6 +482,19 @@ extern SOMClassMgr SOMSTAR SOMClassMgrObject;
 extern void som_dump_mem(void);
 #endif
 
+/* case-folded entry of a name interned by somkern.c, or NULL */
+struct somIdEntry;
+extern struct somIdEntry *SOMKERN_id_fold(const char *name);
+
+/* how somApply() calls a method with a va_list */
+typedef void (SOMLINK *somTD_SOMKERN_apply)(SOMObject SOMSTAR,somToken,somMethodProc,va_list);
+extern somMethodPtr SOMKERN_apply_stub(somMToken m);
+
+#ifdef USE_THREADS
+extern struct somPoolCache *SOMKERN_pool_cache(void);
+extern void SOMKERN_pool_flush(struct somPoolCache *);
+#endif
+
 #ifdef _WIN32
 	#undef sprintf
 	#undef vsprintf
@@ -473,7 +506,24 @@ extern void som_dump_mem(void);
 static unsigned int SOMKERN_resolve_index_mi(somMethodTabPtr mtab,somMToken token)
 {
 	struct somMethodTabStruct *cls=token->classInfoOwner;
-	struct somParentClassInfo *buf=somClassInfoFromMtab(mtab)->classes._buffer;
+	somClassInfo info=somClassInfoFromMtab(mtab);
+	struct somParentClassInfo **hash=info->resolve_hash;
+	struct somParentClassInfo *buf=info->classes._buffer;
+
+	if (hash)
+	{
+		unsigned long i=((unsigned long)(((size_t)cls)>>4)*2654435761UL) & info->resolve_mask;
+
+		while (hash[i])
+		{
+			if (hash[i]->cls==cls)
+			{
+				return token->index+hash[i]->jump_table_offset;
+			}
+
+			i=(i+1) & info->resolve_mask;
+		}
+	}
 
 	while (cls != buf->cls)
 	{
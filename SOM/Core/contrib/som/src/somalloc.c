@@ -32,6 +32,10 @@
 
 #include <somkern.h>
 
+#if !defined(SOM_DEBUG_MEMORY) && !defined(SOM_NO_POOL_MEMORY)
+	#define SOM_POOL_MEMORY
+#endif
+
 #ifdef SOM_DEBUG_MEMORY
 	#define SOM_DEBUG_EXTRA		32
 	#define SOM_DEBUG_BEFORE	0xab
@@ -53,9 +57,12 @@ typedef struct tag_memblock
 		struct pthread_debug_snapshot *snap;
 #endif /* USE_DEBUG_SNAPSHOT */
 } memblock;
-static memblock _mem_buffer[32768<<2];
+/* open addressing on the pointer, never more than half full */
+static memblock _mem_buffer[32768<<3];
 static unsigned long _mem_max;
 #define MAGIC_END_CHAR  0xAA
+#define SOM_DEBUG_SLOTS		(sizeof(_mem_buffer)/sizeof(_mem_buffer[0]))
+#define SOM_DEBUG_SLOT(pv)	((((unsigned long)(((size_t)(pv))>>4))*2654435761UL) & (SOM_DEBUG_SLOTS-1))
 #endif
 
 #ifdef SOM_DEBUG_MEMORY
@@ -63,7 +70,7 @@ static void dump_mem(void)
 {
 	unsigned int i=0;
 
-	while (i < _mem_ptrs)
+	for (i=0; i < SOM_DEBUG_SLOTS; i++)
 	{
 		octet * pv=(octet *)_mem_buffer[i].ptr;
 #ifdef _WIN32
@@ -72,6 +79,8 @@ static void dump_mem(void)
 		long pid=getpid();
 #endif
 
+		if (!pv) continue;
+
 		somPrintf("[%ld],len=%ld,%i=%p=",
 			pid,
 			_mem_buffer[i].len,
@@ -92,7 +101,6 @@ static void dump_mem(void)
 #ifdef USE_DEBUG_SNAPSHOT
 		pthread_debug_snapshot_print(_mem_buffer[i].snap);
 #endif
-		i++;
 	}
 
 #ifdef _WIN32
@@ -106,19 +114,19 @@ static void dump_mem(void)
 #ifdef SOM_DEBUG_MEMORY
 static void SOMKERN_add_mem(void *pv,size_t len)
 {
-	unsigned int i=0;
+	unsigned long i=SOM_DEBUG_SLOT(pv);
 
-	while (i < _mem_ptrs)
+	if (_mem_ptrs >= (SOM_DEBUG_SLOTS>>1))
 	{
-		RHBOPT_ASSERT(_mem_buffer[i].ptr!=pv)
-
-		i++;
+		somPrintf("allocation overrun %d malloc'd elements\n",_mem_ptrs);
+		exit(1);
 	}
 
-	if (i > (sizeof(_mem_buffer)/sizeof(_mem_buffer[0])))
+	while (_mem_buffer[i].ptr)
 	{
-		somPrintf("allocation overrun %d malloc'd elements\n",i);
-		exit(1);
+		RHBOPT_ASSERT(_mem_buffer[i].ptr!=pv)
+
+		i=(i+1) & (SOM_DEBUG_SLOTS-1);
 	}
 
 	_mem_buffer[i].ptr=pv;
@@ -133,12 +141,12 @@ static void SOMKERN_add_mem(void *pv,size_t len)
 		memset(cp+len,SOM_DEBUG_AFTER,SOM_DEBUG_EXTRA);
 	}
 
-	if (i > _mem_max)
+	_mem_ptrs++;
+
+	if (_mem_ptrs > _mem_max)
 	{
-		_mem_max=i;
+		_mem_max=_mem_ptrs;
 	}
-
-	_mem_ptrs++;
 	
 #ifdef _WIN32
 /*	if (pv==(char *)(0xbd4d68))
@@ -187,52 +195,350 @@ static void SOMKERN_add_mem(void *pv,size_t len)
 */
 static size_t SOMKERN_remove_mem(void *pv)
 {
-	unsigned int i=0;
+	unsigned long i=SOM_DEBUG_SLOT(pv),j,k;
+	unsigned char *up;
+	size_t len;
 
-	while (i < _mem_ptrs)
+	while (_mem_buffer[i].ptr!=pv)
 	{
-		if (_mem_buffer[i].ptr==pv)
+		if (!_mem_buffer[i].ptr)
 		{
-			unsigned char *up;
-			size_t len;
+			RHBOPT_ASSERT(!pv);
+
+			return 0;
+		}
+
+		i=(i+1) & (SOM_DEBUG_SLOTS-1);
+	}
 
 #ifdef USE_DEBUG_SNAPSHOT
-			pthread_debug_snapshot_destroy(_mem_buffer[i].snap);
+	pthread_debug_snapshot_destroy(_mem_buffer[i].snap);
 #endif
-			len=_mem_buffer[i].len;
+	len=_mem_buffer[i].len;
 
-			_mem_ptrs--;
+	_mem_ptrs--;
+
+	/* close the gap so later entries stay reachable from their slot */
+	j=i;
+
+	for (;;)
+	{
+		j=(j+1) & (SOM_DEBUG_SLOTS-1);
+
+		if (!_mem_buffer[j].ptr) break;
+
+		k=SOM_DEBUG_SLOT(_mem_buffer[j].ptr);
+
+		if ((i < j) ? ((k <= i) || (k > j)) : ((k <= i) && (k > j)))
+		{
+			_mem_buffer[i]=_mem_buffer[j];
+			i=j;
+		}
+	}
+
+	_mem_buffer[i].ptr=NULL;
+
+	up=pv;
+
+	for (j=0; j < SOM_DEBUG_EXTRA; j++)
+	{
+		if (up[len+j] != SOM_DEBUG_AFTER) 
+		{
+			somPrintf("%p[%d+%d]\n",up,len,j);
+
+			RHBOPT_ASSERT(up[len+j] != SOM_DEBUG_AFTER);
+		}
+	}
+
+	return len;
+}
+#endif
+
+#ifdef SOM_POOL_MEMORY
+/*
+ * Blocks up to 256 bytes come from per-size free lists rather than
+ * the C runtime; SOM churns through a great many of them for
+ * Environments, somIds, sequences and suballocated strings.  Every
+ * block is preceded by its size class so SOMFree() and SOMRealloc()
+ * know where it came from; larger blocks carry the same header and go
+ * straight to malloc().  A thread with SOM globals keeps a few blocks
+ * of each size to itself and trades with the shared lists a batch at
+ * a time, so most SOMMalloc()/SOMFree() pairs take no lock.  Pages
+ * carved into blocks are kept until the process ends.
+ */
+
+typedef union somPoolHeader
+{
+	unsigned long sizeClass;
+	double align_d;
+	void *align_p;
+} somPoolHeader;
 
-			if (i < _mem_ptrs)
+struct somPoolBlock
+{
+	struct somPoolBlock *next;
+};
+
+#define SOMKERN_POOL_LARGE		((unsigned long)-1)
+#define SOMKERN_POOL_BATCH		32
+#define SOMKERN_POOL_PAGE		8192
+
+static const unsigned short somPoolSizes[SOMKERN_POOL_CLASSES]={16,32,48,64,96,128,192,256};
+
+/* size class by (size+15)/16 */
+static const unsigned char somPoolClassOf[17]={0,0,1,2,3,4,4,5,5,6,6,6,6,7,7,7,7};
+
+static struct somPoolBlock *somPoolShared[SOMKERN_POOL_CLASSES];
+
+/* called with the memory guard held */
+static struct somPoolBlock *SOMKERN_pool_carve(unsigned long c)
+{
+	size_t step=sizeof(somPoolHeader)+somPoolSizes[c];
+	size_t n=SOMKERN_POOL_PAGE/step;
+	char *page=malloc(n*step);
+	struct somPoolBlock *list=NULL;
+
+	if (page)
+	{
+		while (n--)
+		{
+			somPoolHeader *h=(somPoolHeader *)(page+n*step);
+			struct somPoolBlock *b=(struct somPoolBlock *)(h+1);
+
+			h->sizeClass=c;
+			b->next=list;
+			list=b;
+		}
+	}
+
+	return list;
+}
+
+/* called with the memory guard held, takes up to a batch */
+static struct somPoolBlock *SOMKERN_pool_take(unsigned long c,unsigned short *count)
+{
+	struct somPoolBlock *head,*b;
+	unsigned short n=1;
+
+	if (!somPoolShared[c])
+	{
+		somPoolShared[c]=SOMKERN_pool_carve(c);
+	}
+
+	head=somPoolShared[c];
+
+	if (!head) return NULL;
+
+	b=head;
+
+	while ((n < SOMKERN_POOL_BATCH) && b->next)
+	{
+		b=b->next;
+		n++;
+	}
+
+	somPoolShared[c]=b->next;
+	b->next=NULL;
+	*count=n;
+
+	return head;
+}
+
+static void *SOMKERN_pool_alloc(size_t s)
+{
+	struct somPoolBlock *b;
+	unsigned long c;
+#ifdef USE_THREADS
+	struct somPoolCache *cache;
+#endif
+
+	if (s > somPoolSizes[SOMKERN_POOL_CLASSES-1])
+	{
+		somPoolHeader *h=malloc(sizeof(*h)+s);
+
+		if (!h) return NULL;
+
+		h->sizeClass=SOMKERN_POOL_LARGE;
+
+		return h+1;
+	}
+
+	c=somPoolClassOf[(s+15)>>4];
+
+#ifdef USE_THREADS
+	cache=SOMKERN_pool_cache();
+
+	if (cache && !cache->closed)
+	{
+		b=cache->free[c];
+
+		if (!b)
+		{
+			SOMKERN_guard_memory
+
+			b=SOMKERN_pool_take(c,&cache->count[c]);
+
+			SOMKERN_unguard_memory
+		}
+
+		if (b)
+		{
+			cache->free[c]=b->next;
+			cache->count[c]--;
+		}
+
+		return b;
+	}
+#endif
+
+	SOMKERN_guard_memory
+
+	b=somPoolShared[c];
+
+	if (!b)
+	{
+		b=somPoolShared[c]=SOMKERN_pool_carve(c);
+	}
+
+	if (b)
+	{
+		somPoolShared[c]=b->next;
+	}
+
+	SOMKERN_unguard_memory
+
+	return b;
+}
+
+static void SOMKERN_pool_free(void *pv)
+{
+	struct somPoolBlock *b=pv;
+	somPoolHeader *h;
+	unsigned long c;
+#ifdef USE_THREADS
+	struct somPoolCache *cache;
+#endif
+
+	if (!pv) return;
+
+	h=((somPoolHeader *)pv)-1;
+	c=h->sizeClass;
+
+	if (c==SOMKERN_POOL_LARGE)
+	{
+		free(h);
+
+		return;
+	}
+
+	RHBOPT_ASSERT(c < SOMKERN_POOL_CLASSES)
+
+#ifdef USE_THREADS
+	cache=SOMKERN_pool_cache();
+
+	if (cache && !cache->closed)
+	{
+		b->next=cache->free[c];
+		cache->free[c]=b;
+
+		if (++cache->count[c] >= 2*SOMKERN_POOL_BATCH)
+		{
+			/* hand the most recent batch back */
+			struct somPoolBlock *last=b;
+			unsigned short n=1;
+
+			while (n < SOMKERN_POOL_BATCH)
 			{
-				_mem_buffer[i]=_mem_buffer[_mem_ptrs];
+				last=last->next;
+				n++;
 			}
 
-			up=pv;
+			cache->free[c]=last->next;
+			cache->count[c]-=SOMKERN_POOL_BATCH;
+
+			SOMKERN_guard_memory
+
+			last->next=somPoolShared[c];
+			somPoolShared[c]=b;
+
+			SOMKERN_unguard_memory
+		}
+
+		return;
+	}
+#endif
+
+	SOMKERN_guard_memory
+
+	b->next=somPoolShared[c];
+	somPoolShared[c]=b;
+
+	SOMKERN_unguard_memory
+}
+
+static void *SOMKERN_pool_realloc(void *pv,size_t s)
+{
+	somPoolHeader *h;
+	void *v;
+
+	if (!pv) return SOMKERN_pool_alloc(s);
+
+	h=((somPoolHeader *)pv)-1;
+
+	if (h->sizeClass==SOMKERN_POOL_LARGE)
+	{
+		h=realloc(h,sizeof(*h)+s);
+
+		return h ? h+1 : NULL;
+	}
+
+	if (s <= somPoolSizes[h->sizeClass]) return pv;
+
+	v=SOMKERN_pool_alloc(s);
+
+	if (v)
+	{
+		memcpy(v,pv,somPoolSizes[h->sizeClass]);
+		SOMKERN_pool_free(pv);
+	}
+
+	return v;
+}
+#endif
+
+#ifdef USE_THREADS
+/* a thread is going, its blocks go back to the shared lists */
+void SOMKERN_pool_flush(struct somPoolCache *cache)
+{
+	cache->closed=1;
 
-			i=0;
+#ifdef SOM_POOL_MEMORY
+	{
+		unsigned long c;
+
+		SOMKERN_guard_memory
 
-			while (i < SOM_DEBUG_EXTRA)
+		for (c=0; c < SOMKERN_POOL_CLASSES; c++)
+		{
+			struct somPoolBlock *b=cache->free[c];
+
+			while (b)
 			{
-				if (up[len+i] != SOM_DEBUG_AFTER) 
-				{
-					somPrintf("%p[%d+%d]\n",up,len,i);
+				struct somPoolBlock *next=b->next;
 
-					RHBOPT_ASSERT(up[len+i] != SOM_DEBUG_AFTER);
-				}
+				b->next=somPoolShared[c];
+				somPoolShared[c]=b;
 
-				i++;
+				b=next;
 			}
 
-			return len;
+			cache->free[c]=NULL;
+			cache->count[c]=0;
 		}
 
-		i++;
+		SOMKERN_unguard_memory
 	}
-
-	RHBOPT_ASSERT(!pv);
-
-	return 0;
+#endif
 }
 #endif
 
@@ -244,10 +550,13 @@ SOM_Scope somToken SOMLINK SOMKERN_malloc(size_t s)
 
 	RHBOPT_ASSERT(s)
 
-	SOMKERN_guard_memory
-
 /* #define MAGIC_MEMPTR    (0xa2fe48) */
 
+#ifdef SOM_POOL_MEMORY
+	v=SOMKERN_pool_alloc(s);
+#else
+	SOMKERN_guard_memory
+
 #ifdef SOM_DEBUG_MEMORY
 	v=malloc(s+SOM_DEBUG_EXTRA+SOM_DEBUG_EXTRA);
 	if (v)
@@ -261,6 +570,7 @@ SOM_Scope somToken SOMLINK SOMKERN_malloc(size_t s)
 #endif
 
 	SOMKERN_unguard_memory
+#endif
 
 #ifdef SOM_DEBUG_MEMORY_SPRINTF
 	somPrintf("SOMMalloc(%p)\n",v);
@@ -285,6 +595,13 @@ SOM_Scope somToken SOMLINK SOMKERN_calloc(size_t a,size_t b)
 	RHBOPT_ASSERT(a)
 	RHBOPT_ASSERT(b)
 
+#ifdef SOM_POOL_MEMORY
+	v=SOMKERN_pool_alloc(a*b);
+	if (v)
+	{
+		memset(v,0,(a*b));
+	}
+#else
 	SOMKERN_guard_memory
 
 #ifdef SOM_DEBUG_MEMORY
@@ -301,6 +618,7 @@ SOM_Scope somToken SOMLINK SOMKERN_calloc(size_t a,size_t b)
 #endif
 
 	SOMKERN_unguard_memory
+#endif
 
 #ifdef SOM_DEBUG_MEMORY_SPRINTF
 	somPrintf("SOMCalloc(%p)\n",v);
@@ -320,6 +638,9 @@ SOM_Scope somToken SOMLINK SOMKERN_calloc(size_t a,size_t b)
 
 SOM_Scope somToken SOMLINK SOMKERN_realloc(somToken p,size_t v)
 {
+#ifdef SOM_POOL_MEMORY
+	return SOMKERN_pool_realloc(p,v);
+#else
 	SOMKERN_guard_memory
 
 /*	bomb("Not using realloc I hope");*/
@@ -344,6 +665,7 @@ SOM_Scope somToken SOMLINK SOMKERN_realloc(somToken p,size_t v)
 	SOMKERN_unguard_memory
 
 	return p;
+#endif
 }
 
 SOM_Scope void SOMLINK SOMKERN_free(somToken p)
@@ -359,6 +681,9 @@ SOM_Scope void SOMLINK SOMKERN_free(somToken p)
 	{
 		size_t len;
 #endif
+#ifdef SOM_POOL_MEMORY
+		SOMKERN_pool_free(p);
+#else
 		SOMKERN_guard_memory
 
 #ifdef SOM_DEBUG_MEMORY
@@ -381,6 +706,7 @@ SOM_Scope void SOMLINK SOMKERN_free(somToken p)
 		free(p);
 
 		SOMKERN_unguard_memory
+#endif
 
 #ifdef _DEBUG
 	}
@@ -40,44 +40,47 @@
 	redispatch stubs for dynamic methods are not supported
   */
 
-boolean SOMLINK somApply(SOMObject SOMSTAR somSelf,
-                                somToken *retVal,
-                                somMethodDataPtr md,
-                                va_list ap)
-{
-	typedef void (SOMLINK *applyStubPtr)(SOMObject SOMSTAR,
-					somToken,somMethodProc,va_list);
+/* the apply stub for a method, picked once so a caller that keeps it
+	(see SOMKERN_dispatch_stub()) does not decode the mtoken each call */
 
-	if (-1L == (long)(md->mToken->defined.redispatchStub))
+somMethodPtr SOMKERN_apply_stub(somMToken m)
+{
+	if (-1L == (long)(m->defined.redispatchStub))
 	{
-		somApRdInfo *info=(void *)md->mToken->defined.applyStub;
+		somApRdInfo *info=(void *)m->defined.applyStub;
 
 		if (info)
 		{
 			if (info->apStub)
 			{
-				((applyStubPtr)(info->apStub))(somSelf,retVal,md->method,ap);						
-
-				return 1;
+				return info->apStub;
 			}
 
 #ifdef SOM_METHOD_STUBS
-			((applyStubPtr)(&(md->mToken->jumper.apply)))(somSelf,retVal,md->method,ap);
-			return 1;
+			return (somMethodPtr)&(m->jumper.apply);
 #endif
 		}
 
 		RHBOPT_ASSERT(!info)
+
+		return NULL;
 	}
-	else
-	{
-		if (md->mToken->defined.applyStub)
-		{
-			((applyStubPtr)(md->mToken->defined.applyStub))(somSelf,retVal,md->method,ap);						
 
-			return 1;
-		}
+	return m->defined.applyStub;
+}
+
+boolean SOMLINK somApply(SOMObject SOMSTAR somSelf,
+                                somToken *retVal,
+                                somMethodDataPtr md,
+                                va_list ap)
+{
+	somMethodPtr stub=SOMKERN_apply_stub(md->mToken);
 
+	if (stub)
+	{
+		((somTD_SOMKERN_apply)stub)(somSelf,retVal,md->method,ap);
+
+		return 1;
 	}
 
 	RHBOPT_ASSERT(!md)
@@ -105,6 +108,18 @@ int SOMLINK somCompareIds(somId id1, somId id2)
 	if (*id1) if (!*id2) return 0;
 	if (*id2) if (!*id1) return 0;
 
+	/* names from the id table are equal exactly when their folds are */
+	{
+		struct somIdEntry *f1=SOMKERN_id_fold(*id1);
+
+		if (f1)
+		{
+			struct somIdEntry *f2=SOMKERN_id_fold(*id2);
+
+			if (f2) return (f1==f2) ? 1 : 0;
+		}
+	}
+
 	return (!
 #ifdef HAVE_STRCASECMP
 		strcasecmp(*id1,*id2)
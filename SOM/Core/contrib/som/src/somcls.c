@@ -228,18 +228,45 @@ SOM_Scope somToken  SOMLINK somcls_somAllocate(
 		SOMClass SOMSTAR somSelf, 
 		long size)
 {
+	SOMClassData *somThis=SOMClassGetData(somSelf);
+	union somInstanceHeader *h;
+
 	/* default implementation does not call SOMCalloc */
 
-	SOM_IgnoreWarning(somSelf);
+	if (somThis->cimtabs && (size==somThis->cimtabs->mtab.instanceSize))
+	{
+		struct somInstanceArena *a=SOMKERN_arena_get(&somThis->cimtabs->classInfo,size);
+		somToken pv;
+
+		if (a && SOMKERN_arena_take(a,1,&pv))
+		{
+			return pv;
+		}
+	}
+
+	h=SOMMalloc(sizeof(*h)+size);
+
+	if (!h) return NULL;
+
+	h->arena=NULL;
 
-    return SOMMalloc(size);
+    return h+1;
 }
 
 SOM_Scope void  SOMLINK somcls_somDeallocate(SOMClass SOMSTAR somSelf,somToken memptr)
 {
+	union somInstanceHeader *h=((union somInstanceHeader *)memptr)-1;
+
 	((SOMObject SOMSTAR)memptr)->mtab=NULL;
 
-	SOMFree(memptr);
+	if (h->arena)
+	{
+		SOMKERN_arena_give(h);
+	}
+	else
+	{
+		SOMFree(h);
+	}
 
 #ifdef SOMClass_somRelease
 	SOMClass_somRelease(somSelf);
@@ -247,6 +274,66 @@ SOM_Scope void  SOMLINK somcls_somDeallocate(SOMClass SOMSTAR somSelf,somToken m
 	SOM_IgnoreWarning(somSelf);
 }
 
+/*
+ * Up to count new instances at once, as somNew() would make them.
+ * With the default somNew() and somAllocate() they are taken from the
+ * class arena under one lock; otherwise each is made with somNew().
+ * Returns how many were made.
+ */
+SOMEXTERN long SOMLINK somNewObjects(SOMClass SOMSTAR cls,long count,SOMObject SOMSTAR *objs)
+{
+	SOMClassData *somThis;
+	struct somInstanceArena *a=NULL;
+	long n=0;
+
+	if ((!cls) || (count <= 0) || !objs) return 0;
+
+	somThis=SOMClassGetData(cls);
+
+	if (somThis->cimtabs &&
+		(((somMethodPtr)somResolve((SOMObject SOMSTAR)(void *)cls,SOMClassClassData.somNew))==(somMethodPtr)somcls_somNew) &&
+		(((somMethodPtr)somResolve((SOMObject SOMSTAR)(void *)cls,SOMClassClassData.somAllocate))==(somMethodPtr)somcls_somAllocate))
+	{
+		a=SOMKERN_arena_get(&somThis->cimtabs->classInfo,somThis->cimtabs->mtab.instanceSize);
+	}
+
+	if (a)
+	{
+#ifdef SOMObject_somDefaultInit
+		somInitCtrl globalCtrl=somThis->cimtabs->classInfo.parents.initCtrl;
+#endif
+		long len=somThis->cimtabs->mtab.instanceSize;
+		long i;
+
+		n=SOMKERN_arena_take(a,count,(somToken *)objs);
+
+		for (i=0; i < n; i++)
+		{
+			memset(objs[i],0,len);
+
+			objs[i]=SOMClass_somRenewNoInitNoZero(cls,(void *)objs[i]);
+
+	#ifdef SOMObject_somDefaultInit
+			globalCtrl=somThis->cimtabs->classInfo.parents.initCtrl;
+			SOMObject_somDefaultInit(objs[i],&globalCtrl);
+	#else
+			SOMObject_somInit(objs[i]);
+	#endif
+		}
+	}
+
+	while (n < count)
+	{
+		objs[n]=SOMClass_somNew(cls);
+
+		if (!objs[n]) break;
+
+		n++;
+	}
+
+	return n;
+}
+
 SOM_Scope void  SOMLINK somcls_somInitClass(SOMClass SOMSTAR somSelf, 
                                                        string className, 
                                                        SOMClass SOMSTAR parentClass, 
@@ -995,6 +1082,12 @@ SOM_Scope somMToken  SOMLINK somcls_somAddStaticMethod(
 
 			info->jump_table._length++;
 			info->added_methods._length++;
+
+			/* a method added to a ready class */
+			if (info->name_hash)
+			{
+				SOMKERN_lookup_changed();
+			}
 		}
 	}
 
@@ -1742,6 +1835,8 @@ static void SOMClass_unregistered(
 
 		if (somSelf->mtab != &somThis->cimtabs->mtab)
 		{
+			SOMKERN_free_lookup(&somThis->cimtabs->classInfo);
+			SOMKERN_arena_release(&somThis->cimtabs->classInfo);
 			SOMKERN_clear_somMethodTabPtr(&somThis->cimtabs->mtab);
 			SOMFreeEx(somThis->cimtabs);
 		}
@@ -25,6 +25,10 @@
 
 #include <somirdll.h>
 
+#if !defined(_WIN32) && !defined(__OS2__) && defined(HAVE_SYS_TIME_H)
+	#include <sys/time.h>
+#endif
+
 SOM_Scope SOMClass SOMSTAR SOMLINK somcm_somLoadClassFile(SOMClassMgr SOMSTAR somSelf, 
                                                                    somId classId, 
                                                                    long majorVersion, 
@@ -624,6 +628,11 @@ SOM_Scope void  SOMLINK somcm_somMergeInto(
 		somThat->classList.dataset=somThis->classList.dataset;
 		somThis->classList.dataset=seq;
 
+		if (somcm_index_owner==somThis)
+		{
+			somcm_index_owner=somThat;
+		}
+
 		SOMClassMgrObject=targetObj;
 
 		somEndCriticalSection();
@@ -678,6 +687,8 @@ SOM_Scope long  SOMLINK somcm_somSubstituteClass(
 			{
 				somClassInfoFromMtab(original_class)->substituted_mtab=replace_class;
 
+				SOMKERN_lookup_changed();
+
 				if (somClassInfoFromMtab(original_class)->sci)
 				{
 					if (somClassInfoFromMtab(original_class)->sci->cds)
@@ -766,6 +777,151 @@ SOM_Scope boolean SOMLINK somcm_somImportObject(
 }
 #endif
 
+/*
+ * Unlocked index over the class list, so finding a registered class
+ * takes no lock.  It only changes along with the list, under the
+ * kernel critical section.  A removed class leaves its slot marked,
+ * and a table that grows replaces the old one, which is kept for any
+ * reader still in it.  Hits are checked against the class name and
+ * misses go to the locked list, so a reader racing a change just
+ * takes the old path.
+ */
+
+struct somcm_index_entry
+{
+	volatile unsigned long hash;		/* 0 while empty */
+	somMethodTabPtr volatile mtab;		/* NULL once removed */
+};
+
+struct somcm_index
+{
+	struct somcm_index *retired;
+	unsigned long mask,used;
+	struct somcm_index_entry entries[1];
+};
+
+static struct somcm_index * volatile somcm_class_index;
+static SOMClassMgrData *somcm_index_owner;
+
+static somMethodTabPtr SOMClassList_index_find(char *name)
+{
+	struct somcm_index *t=somcm_class_index;
+	unsigned long h,i;
+
+	if (!t) return NULL;
+
+	h=SOMKERN_id_hash(name,0)|1;
+
+	for (i=h & t->mask; t->entries[i].hash; i=(i+1) & t->mask)
+	{
+		if (t->entries[i].hash==h)
+		{
+			somMethodTabPtr mtab=t->entries[i].mtab;
+
+			if (mtab && !strcmp(mtab->className,name))
+			{
+				return mtab;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void SOMClassList_index_put(struct somcm_index *t,unsigned long h,somMethodTabPtr mtab)
+{
+	unsigned long i;
+
+	for (i=h & t->mask; t->entries[i].hash; i=(i+1) & t->mask)
+	{
+		somMethodTabPtr other=t->entries[i].mtab;
+
+		if (other==mtab) return;
+
+		/* a second class by the same name; leave that name to the list */
+		if (other && (t->entries[i].hash==h) && !strcmp(other->className,mtab->className))
+		{
+			t->entries[i].mtab=NULL;
+
+			return;
+		}
+	}
+
+	/* the class first, so a reader that sees the hash sees it too */
+	t->entries[i].mtab=mtab;
+	t->entries[i].hash=h;
+	t->used++;
+}
+
+/* called with the critical section held */
+static void SOMClassList_index_add(SOMClassMgrData *somThis,somMethodTabPtr mtab)
+{
+	struct somcm_index *t=somcm_class_index;
+
+	somcm_index_owner=somThis;
+
+	if ((!t) || (2*(t->used+1) > t->mask+1))
+	{
+		unsigned long n=64,live=0,i;
+		struct somcm_index *nt;
+
+		if (t)
+		{
+			for (i=0; i <= t->mask; i++)
+			{
+				if (t->entries[i].mtab) live++;
+			}
+		}
+
+		while (n < 4*(live+1)) n<<=1;
+
+		nt=SOMCalloc(SOMKERN_offsetof(struct somcm_index,entries)+n*sizeof(nt->entries[0]),1);
+
+		/* without an index finds just take the lock */
+		if (!nt) return;
+
+		nt->mask=n-1;
+
+		if (t)
+		{
+			for (i=0; i <= t->mask; i++)
+			{
+				if (t->entries[i].mtab)
+				{
+					SOMClassList_index_put(nt,t->entries[i].hash,t->entries[i].mtab);
+				}
+			}
+		}
+
+		nt->retired=t;
+		somcm_class_index=nt;
+		t=nt;
+	}
+
+	SOMClassList_index_put(t,SOMKERN_id_hash(mtab->className,0)|1,mtab);
+}
+
+/* called with the critical section held */
+static void SOMClassList_index_remove(somMethodTabPtr mtab)
+{
+	struct somcm_index *t=somcm_class_index;
+	unsigned long i;
+
+	if (!t) return;
+
+	for (i=(SOMKERN_id_hash(mtab->className,0)|1) & t->mask;
+		 t->entries[i].hash;
+		 i=(i+1) & t->mask)
+	{
+		if (t->entries[i].mtab==mtab)
+		{
+			t->entries[i].mtab=NULL;
+
+			break;
+		}
+	}
+}
+
 static void SOMClassList_create(SOMClassMgrData *somThis)
 {
 	if (RHBCDR_kds_is_empty(&somThis->classList))
@@ -804,6 +960,13 @@ static somMethodTabPtr SOMClassList_find(SOMClassMgrData *somThis,Environment *e
 		RHBSOMUT_Key key;
 		RHBSOMUT_KeyData *data;
 
+		if (somThis==somcm_index_owner)
+		{
+			result=SOMClassList_index_find(p);
+
+			if (result) return result;
+		}
+
 		somStartCriticalSection();
 
 		if (RHBCDR_kds_is_empty(&somThis->classList))
@@ -841,6 +1004,11 @@ static long SOMClassList_remove(SOMClassMgrData *somThis,Environment *ev,somMeth
 		RHBCDR_kds_remove(&somThis->classList,kdp);
 
 		retVal=kdp->count;
+
+		if (!retVal)
+		{
+			SOMClassList_index_remove(mtab);
+		}
 	}
 
 	return retVal;
@@ -851,10 +1019,19 @@ static void SOMClassList_add(SOMClassMgrData *somThis,Environment *ev,somMethodT
 	SOM_IgnoreWarning(ev);
 
 	RHBCDR_kds_add(&somThis->classList,&somClassInfoFromMtab(mtab)->keyed_data);
+
+	SOMClassList_index_add(somThis,mtab);
 }
 
 static void SOMClassList_destroy(SOMClassMgrData *somThis)
 {
+	if (somThis==somcm_index_owner)
+	{
+		/* left to readers still in it, as with a grown table */
+		somcm_index_owner=NULL;
+		somcm_class_index=NULL;
+	}
+
 	if (somThis->classList.lpVtbl)
 	{
 		RHBCDR_kds_uninit(&somThis->classList);
@@ -872,3 +1049,350 @@ SOM_Scope void SOMLINK somcm_somUninit(SOMClassMgr SOMSTAR somSelf)
 	RHBOPT_ASSERT(!somSelf);
 }
 
+
+/**************************************************
+ *
+ * somPreloadClasses, load the classes named in a manifest
+ * before anyone asks for them
+ *
+ * each line is "ClassName [dllname]", '#' starts a comment,
+ * with no dllname the class is located through the IR;
+ * classes from one DLL are one unit of work so a DLL is only
+ * initialised by one thread, other DLLs load alongside it;
+ * a parent class in another DLL is found by somBuildClass
+ * as usual, so the order of the manifest does not matter
+ *
+ * if manifest is NULL the file is named by SOMPRELOAD
+ *
+ * returns the number of classes found
+ */
+
+#define SOMCM_PRELOAD_THREADS	4
+
+struct somcm_preload_item
+{
+	char *className;
+	char *dllName;
+	unsigned long ms;
+	boolean found;
+};
+
+struct somcm_preload
+{
+	SOMClassMgr SOMSTAR mgr;
+	struct somcm_preload_item *items;
+	long count;
+	long next;
+};
+
+static unsigned long somcm_preload_clock(void)
+{
+#ifdef _WIN32
+	return GetTickCount();
+#elif defined(__OS2__)
+	ULONG ms=0;
+	DosQuerySysInfo(QSV_MS_COUNT,QSV_MS_COUNT,&ms,sizeof(ms));
+	return ms;
+#elif defined(HAVE_SYS_TIME_H)
+	struct timeval tv;
+	gettimeofday(&tv,NULL);
+	return (unsigned long)((tv.tv_sec*1000)+(tv.tv_usec/1000));
+#else
+	return 0;
+#endif
+}
+
+static char *somcm_preload_word(char **pp)
+{
+	char *p=*pp;
+	char *word;
+
+	while ((*p==' ')||(*p=='\t')) p++;
+
+	if ((!*p)||(*p=='\r')||(*p=='\n')) return NULL;
+
+	word=p;
+
+	while (*p && (*p!=' ') && (*p!='\t') && (*p!='\r') && (*p!='\n')) p++;
+
+	if (*p) *p++=0;
+
+	*pp=p;
+
+	return word;
+}
+
+static char *somcm_preload_strdup(const char *p)
+{
+	size_t len=strlen(p)+1;
+	char *q=SOMMalloc(len);
+
+	if (q) memcpy(q,p,len);
+
+	return q;
+}
+
+static long somcm_preload_read(const char *manifest,struct somcm_preload_item **pitems)
+{
+	FILE *fp=fopen(manifest,"r");
+	struct somcm_preload_item *items=NULL;
+	long count=0,max=0;
+	char buf[512];
+
+	if (!fp) return 0;
+
+	while (fgets(buf,sizeof(buf),fp))
+	{
+		char *p=strchr(buf,'#');
+		char *cls;
+		char *dll;
+
+		if (p) *p=0;
+
+		p=buf;
+		cls=somcm_preload_word(&p);
+		dll=cls ? somcm_preload_word(&p) : NULL;
+
+		if (!cls) continue;
+
+		if (count==max)
+		{
+			struct somcm_preload_item *n;
+
+			max=max ? (max<<1) : 32;
+
+			n=SOMRealloc(items,max*sizeof(*items));
+
+			if (!n)
+			{
+				SOMError(-1,__FILE__,__LINE__);
+				break;
+			}
+
+			items=n;
+		}
+
+		items[count].className=somcm_preload_strdup(cls);
+		items[count].dllName=dll ? somcm_preload_strdup(dll) : NULL;
+		items[count].ms=0;
+		items[count].found=0;
+
+		if (items[count].className)
+		{
+			count++;
+		}
+		else
+		{
+			if (items[count].dllName) SOMFree(items[count].dllName);
+		}
+	}
+
+	fclose(fp);
+
+	*pitems=items;
+
+	return count;
+}
+
+static int somcm_preload_compare(const void *pv1,const void *pv2)
+{
+	const struct somcm_preload_item *a=pv1;
+	const struct somcm_preload_item *b=pv2;
+
+	/* located through the IR go last, one unit each */
+	if (!a->dllName) return b->dllName ? 1 : 0;
+	if (!b->dllName) return -1;
+
+	return strcmp(a->dllName,b->dllName);
+}
+
+static boolean somcm_preload_claim(struct somcm_preload *p,long *pfirst,long *pend)
+{
+	boolean claimed=0;
+
+	somStartCriticalSection();
+
+	if (p->next < p->count)
+	{
+		long i=p->next;
+		const char *dll=p->items[i].dllName;
+
+		*pfirst=i++;
+
+		if (dll)
+		{
+			while ((i < p->count) && p->items[i].dllName && !strcmp(dll,p->items[i].dllName))
+			{
+				i++;
+			}
+		}
+
+		*pend=p->next=i;
+
+		claimed=1;
+	}
+
+	somEndCriticalSection();
+
+	return claimed;
+}
+
+static void somcm_preload_run(struct somcm_preload *p)
+{
+	long i,end;
+
+	while (somcm_preload_claim(p,&i,&end))
+	{
+		while (i < end)
+		{
+			struct somcm_preload_item *item=p->items+i++;
+			somId id=somIdFromString(item->className);
+			unsigned long t=somcm_preload_clock();
+			SOMClass SOMSTAR cls;
+
+			if (!id) continue;
+
+			if (item->dllName)
+			{
+				cls=SOMClassMgr_somFindClsInFile(p->mgr,id,0,0,item->dllName);
+			}
+			else
+			{
+				cls=SOMClassMgr_somFindClass(p->mgr,id,0,0);
+			}
+
+			item->ms=somcm_preload_clock()-t;
+
+			SOMFree(id);
+
+			if (cls)
+			{
+				item->found=1;
+#ifdef SOMClass_somRelease
+				SOMClass_somRelease(cls);
+#endif
+			}
+		}
+	}
+}
+
+#ifdef USE_THREADS
+	#ifdef USE_PTHREADS
+static void *somcm_preload_thread(void *pv)
+	#elif defined(__OS2__)
+static void APIENTRY somcm_preload_thread(ULONG pv)
+	#else
+static DWORD WINAPI somcm_preload_thread(void *pv)
+	#endif
+{
+	somcm_preload_run((struct somcm_preload *)pv);
+
+	somFreeThreadData();
+
+	#ifndef __OS2__
+	return 0;
+	#endif
+}
+#endif
+
+SOMEXTERN long SOMLINK somPreloadClasses(SOMClassMgr SOMSTAR mgr,const char *manifest)
+{
+	struct somcm_preload data;
+	unsigned long t;
+	long i,found=0;
+
+	if (!mgr) mgr=SOMClassMgrObject;
+	if (!manifest) manifest=getenv("SOMPRELOAD");
+	if ((!mgr) || (!manifest) || (!manifest[0])) return 0;
+
+	data.mgr=mgr;
+	data.items=NULL;
+	data.next=0;
+	data.count=somcm_preload_read(manifest,&data.items);
+
+	if (!data.count)
+	{
+		if (data.items) SOMFree(data.items);
+		return 0;
+	}
+
+	qsort(data.items,data.count,sizeof(data.items[0]),somcm_preload_compare);
+
+	t=somcm_preload_clock();
+
+#ifdef USE_THREADS
+	{
+		long n=SOMCM_PRELOAD_THREADS;
+	#ifdef USE_PTHREADS
+		pthread_t threads[SOMCM_PRELOAD_THREADS];
+	#elif defined(__OS2__)
+		TID threads[SOMCM_PRELOAD_THREADS];
+	#else
+		HANDLE threads[SOMCM_PRELOAD_THREADS];
+	#endif
+		long started=0;
+
+		if ((SOM_MaxThreads > 0) && (SOM_MaxThreads < n)) n=SOM_MaxThreads;
+
+		/* this thread is one of them */
+		while (started < (n-1))
+		{
+	#ifdef USE_PTHREADS
+			if (pthread_create(threads+started,RHBOPT_pthread_attr_default,somcm_preload_thread,&data)) break;
+	#elif defined(__OS2__)
+			if (DosCreateThread(threads+started,somcm_preload_thread,(ULONG)&data,0,65536)) break;
+	#else
+			DWORD tid;
+			threads[started]=CreateThread(0,0,somcm_preload_thread,&data,0,&tid);
+			if (!threads[started]) break;
+	#endif
+			started++;
+		}
+
+		somcm_preload_run(&data);
+
+		while (started--)
+		{
+	#ifdef USE_PTHREADS
+			pthread_join(threads[started],NULL);
+	#elif defined(__OS2__)
+			DosWaitThread(threads+started,DCWW_WAIT);
+	#else
+			WaitForSingleObject(threads[started],INFINITE);
+			CloseHandle(threads[started]);
+	#endif
+		}
+	}
+#else
+	somcm_preload_run(&data);
+#endif
+
+	t=somcm_preload_clock()-t;
+
+	for (i=0; i < data.count; i++)
+	{
+		if (data.items[i].found) found++;
+
+		if (SOM_TraceLevel > 1)
+		{
+			somPrintf("somPreloadClasses: %s %s%s %lums\n",
+					data.items[i].className,
+					data.items[i].dllName ? data.items[i].dllName : "(IR)",
+					data.items[i].found ? "" : " not found",
+					data.items[i].ms);
+		}
+
+		SOMFree(data.items[i].className);
+
+		if (data.items[i].dllName) SOMFree(data.items[i].dllName);
+	}
+
+	if (SOM_TraceLevel > 1)
+	{
+		somPrintf("somPreloadClasses: %ld of %ld classes in %lums\n",found,data.count,t);
+	}
+
+	SOMFree(data.items);
+
+	return found;
+}
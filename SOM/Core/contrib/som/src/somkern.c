@@ -136,7 +136,6 @@ static void SOMKERN_UnbootStrap(void);
 static int SOMKERN_any_mi(somMethodTabPtr);
 static int SOMKERN_count_unique_classes(somMethodTabPtr *,unsigned int);
 static int SOMKERN_count_unique_methods(somMethodTabPtr *,unsigned int);
-static int SOMKERN_is_method_in(somMethodTabPtr *,unsigned int,somMToken);
 static void SOMKERN_set_up_parents(somMethodTabPtr,somMethodTabPtr *,int num);
 
 /*static somMToken SOMKERN_find_method_by_name(somMethodTabPtr mtab,char *p,unsigned int *index);*/
@@ -480,6 +479,8 @@ void SOMLINK somEnvironmentEnd(void)
 	SOMKERN_UnbootStrap();
 }
 
+static somToken SOMKERN_class_lock(somStaticClassInfo *);
+
 struct somBuildClass
 {
 	boolean locked,failed,was_created;
@@ -488,13 +489,24 @@ struct somBuildClass
 	SOMClass SOMSTAR classObject;
 	SOMClass_SOMClassSequence seq;
 	SOMClass SOMSTAR parents[sizeof(long)<<3];
+	somToken lock;
 };
 
 RHBOPT_cleanup_begin(somBuildClass_cleanup,pv)
 
 struct somBuildClass *data=pv;
 
-	if (data->locked) somEndCriticalSection();
+	if (data->locked)
+	{
+		if (data->lock)
+		{
+			SOMReleaseMutexSem(data->lock);
+		}
+		else
+		{
+			somEndCriticalSection();
+		}
+	}
 #ifdef SOMClass_somRelease
 	if (data->meta_class)
 	{
@@ -614,7 +626,17 @@ SOMClass SOMSTAR SOMLINK somBuildClass (
 
 					if (!data.failed)
 					{
-						somStartCriticalSection();
+						/* builds of different classes no longer wait on each other */
+						data.lock=SOMKERN_class_lock(sci);
+
+						if (data.lock)
+						{
+							SOMRequestMutexSem(data.lock);
+						}
+						else
+						{
+							somStartCriticalSection();
+						}
 
 						data.locked=1;
 
@@ -754,6 +776,8 @@ SOMClass SOMSTAR SOMLINK somBuildClass (
 									sci->cif(data.classObject);
 								}
 
+								SOMKERN_build_lookup(nc);
+
 								data.failed=0;
 
 								SOMClass_somClassReady(data.classObject);
@@ -809,11 +833,61 @@ static som_thread_globals_t *make_globals(void)
 }
 #endif
 
+#if defined(USE_THREADS) && defined(HAVE_THREAD_STORAGE)
+/* this thread's globals once found, so most lookups skip the TLS API */
+static __thread som_thread_globals_t *somkern_thread_globals;
+#	define SOMKERN_THREAD_CACHE
+#endif
+
+#ifdef USE_THREADS
+/*
+ * The allocator's view of the thread globals; it must not make them,
+ * nor start the DLL, as both of those allocate.
+ */
+struct somPoolCache *SOMKERN_pool_cache(void)
+{
+	som_thread_globals_t *ev=NULL;
+
+#ifdef SOMKERN_THREAD_CACHE
+	ev=somkern_thread_globals;
+
+	if (ev) return &ev->pool;
+#endif
+
+	if (som_globals.dll_alive)
+	{
+	#ifdef USE_PTHREADS
+		#ifdef HAVE_PTHREAD_GETSPECIFIC_STD
+			ev=(som_thread_globals_t *)pthread_getspecific(som_globals.tls_key);
+		#else
+			pthread_addr_t pv;
+			if (!pthread_getspecific(som_globals.tls_key,&pv))
+			{
+				ev=(som_thread_globals_t *)pv;
+			}
+		#endif
+	#elif defined(__OS2__)
+			ev=(som_thread_globals_t *)*(void **)som_globals.tls_key;
+	#else
+			ev=(som_thread_globals_t *)TlsGetValue(som_globals.tls_key);
+	#endif
+	}
+
+	return ev ? &ev->pool : NULL;
+}
+#endif
+
 static som_thread_globals_t *SOMKERN_get_thread_globals(char make)
 {
 #ifdef USE_THREADS
 	som_thread_globals_t *ev;
 
+#ifdef SOMKERN_THREAD_CACHE
+	ev=somkern_thread_globals;
+
+	if (ev) return ev;
+#endif
+
 	SOM_THREAD_INIT_ONCE
 
 	#ifdef USE_PTHREADS
@@ -856,6 +930,9 @@ static som_thread_globals_t *SOMKERN_get_thread_globals(char make)
 				TlsSetValue(som_globals.tls_key,ev);
 			}
 	#endif
+#ifdef SOMKERN_THREAD_CACHE
+	somkern_thread_globals=ev;
+#endif
 	return ev;
 #else
 	#ifdef RHBOPT_SHARED_DATA
@@ -1029,9 +1106,577 @@ SOMEXTERN somToken SOMLINK somDataResolveChk(
 	return NULL;
 }
 
-static struct somMTokenData *SOMKERN_somMToken_by_name(somClassInfo info,somId id)
-{
-	unsigned int i=info->added_methods._length;
+/*
+ * Hashed lookups, built when somBuildClass() finishes: owner class to
+ * jump table offset for multiple inheritance, and method name or
+ * descriptor to mtoken, in the order SOMKERN_somMToken_by_name() would
+ * find them.  Both are read without locking.  The class list never
+ * changes once a class exists, but adding methods to a ready class
+ * or substituting one bumps somkern_lookup_generation, and a name
+ * table from an older generation is rebuilt on its next use.  The old
+ * one is chained off the new, since a reader may still be in it, and
+ * goes when the class does.
+ */
+
+struct somNameEntry
+{
+	unsigned long hash;
+	struct somMTokenData *token;
+	boolean descriptor;
+};
+
+/*
+ * somDispatch() by a name it has seen before, the mtoken found and
+ * its apply stub picked; the method itself is still read from the
+ * mtab each call so an override is seen.  Slots go by the address of the name's
+ * text, an interned id having just the one, and the text is kept to
+ * confirm the hit.  Records hang off the name table so a new
+ * generation starts afresh, and are only ever replaced in a slot,
+ * not freed, while the table lives.
+ */
+
+#define SOMKERN_DISPATCH_SLOTS		32
+#define SOMKERN_DISPATCH_MAX		256
+
+struct somDispatchStub
+{
+	struct somDispatchStub *next;
+	const char *name;
+	struct somMTokenData *token;
+	somMethodPtr apply;
+	char text[1];
+};
+
+struct somNameHash
+{
+	struct somNameHash *retired;
+	unsigned long generation;
+	unsigned long mask;
+	struct somDispatchStub * volatile dispatch[SOMKERN_DISPATCH_SLOTS];
+	struct somDispatchStub *dispatch_list;
+	unsigned long dispatch_count;
+	struct somNameEntry entries[1];
+};
+
+static unsigned long somkern_lookup_generation;
+
+static unsigned long SOMKERN_id_hash(const char *p,int fold);
+
+#define SOMKERN_ptr_hash(p)		((unsigned long)(((size_t)(p))>>4)*2654435761UL)
+
+#define SOMKERN_name_id(m,descriptor) \
+	((somId)((descriptor) ? (m)->defined.somId_methodDescriptor : (m)->defined.somId_methodId))
+
+static unsigned long SOMKERN_count_names(somClassInfo info)
+{
+	unsigned long n=info->added_methods._length;
+	unsigned long i=info->numParents;
+
+	while (i--)
+	{
+		n+=SOMKERN_count_names(somClassInfoFromMtab(info->parent_jump_table._buffer[i]));
+	}
+
+	return n;
+}
+
+static void SOMKERN_add_name(struct somNameHash *t,struct somMTokenData *m,boolean descriptor)
+{
+	somId id=SOMKERN_name_id(m,descriptor);
+	unsigned long h,i;
+
+	if ((!id) || (!*id)) return;
+
+	h=SOMKERN_id_hash(*id,1);
+
+	for (i=h & t->mask; t->entries[i].token; i=(i+1) & t->mask)
+	{
+		/* first one found wins, as with the scan */
+		if ((t->entries[i].hash==h) &&
+			(t->entries[i].descriptor==descriptor) &&
+			somCompareIds(SOMKERN_name_id(t->entries[i].token,descriptor),id))
+		{
+			return;
+		}
+	}
+
+	t->entries[i].hash=h;
+	t->entries[i].descriptor=descriptor;
+	t->entries[i].token=m;
+}
+
+static void SOMKERN_fill_names(struct somNameHash *t,somClassInfo info)
+{
+	unsigned long i;
+
+	for (i=0; i < info->added_methods._length; i++)
+	{
+		SOMKERN_add_name(t,info->added_methods._buffer+i,0);
+		SOMKERN_add_name(t,info->added_methods._buffer+i,1);
+	}
+
+	i=info->numParents;
+
+	while (i--)
+	{
+		SOMKERN_fill_names(t,somClassInfoFromMtab(info->parent_jump_table._buffer[i]));
+	}
+}
+
+static void SOMKERN_build_lookup(somMethodTabPtr mtab)
+{
+	somClassInfo info=somClassInfoFromMtab(mtab);
+	unsigned long n,i,j;
+
+	SOMKERN_guard
+
+	if (info->multiple_inheritance && (!info->resolve_hash) && info->classes._length)
+	{
+		struct somParentClassInfo **h;
+
+		for (n=8; n < 2*info->classes._length; n<<=1) {}
+
+		h=SOMCalloc(n,sizeof(*h));
+
+		if (h)
+		{
+			for (i=0; i < info->classes._length; i++)
+			{
+				struct somParentClassInfo *p=info->classes._buffer+i;
+
+				for (j=SOMKERN_ptr_hash(p->cls) & (n-1); h[j]; j=(j+1) & (n-1))
+				{
+					if (h[j]->cls==p->cls) break;
+				}
+
+				if (!h[j]) h[j]=p;
+			}
+
+			info->resolve_mask=n-1;
+			info->resolve_hash=h;
+		}
+	}
+
+	if ((!info->name_hash) || (info->name_hash->generation != somkern_lookup_generation))
+	{
+		struct somNameHash *t;
+
+		for (n=8; n < 4*SOMKERN_count_names(info); n<<=1) {}
+
+		t=SOMCalloc(SOMKERN_offsetof(struct somNameHash,entries)+n*sizeof(t->entries[0]),1);
+
+		if (t)
+		{
+			t->mask=n-1;
+			t->generation=somkern_lookup_generation;
+			t->retired=info->name_hash;
+
+			SOMKERN_fill_names(t,info);
+
+			info->name_hash=t;
+		}
+	}
+
+	SOMKERN_unguard
+}
+
+static void SOMKERN_free_lookup(somClassInfo info)
+{
+	struct somNameHash *t=info->name_hash;
+
+	info->name_hash=NULL;
+
+	while (t)
+	{
+		struct somNameHash *r=t->retired;
+
+		while (t->dispatch_list)
+		{
+			struct somDispatchStub *d=t->dispatch_list;
+			t->dispatch_list=d->next;
+			SOMFree(d);
+		}
+
+		SOMFree(t);
+		t=r;
+	}
+
+	if (info->resolve_hash)
+	{
+		SOMFree(info->resolve_hash);
+		info->resolve_hash=NULL;
+	}
+}
+
+/*
+ * One mutex per static class, so that somBuildClass() serializes two
+ * threads building the same class without holding up every other
+ * build.  A build takes its class lock first and the critical section
+ * only inside it, never the other way round.  The parents have been
+ * built before the lock is taken, so a thread never waits on a class
+ * it is itself building under.  Locks live until the kernel goes.
+ */
+
+struct somClassLock
+{
+	somStaticClassInfo *sci;
+	somToken lock;
+};
+
+static struct somClassLock *somkern_class_locks;
+static unsigned long somkern_class_locks_mask,somkern_class_locks_used;
+
+static somToken SOMKERN_class_lock(somStaticClassInfo *sci)
+{
+	somToken lock=NULL;
+	unsigned long i;
+
+	SOMKERN_guard
+
+	if (2*(somkern_class_locks_used+1) > somkern_class_locks_mask+1)
+	{
+		unsigned long n=somkern_class_locks ? 2*(somkern_class_locks_mask+1) : 64;
+		struct somClassLock *t=SOMCalloc(n,sizeof(*t));
+
+		if (t)
+		{
+			if (somkern_class_locks)
+			{
+				for (i=0; i <= somkern_class_locks_mask; i++)
+				{
+					struct somClassLock *p=somkern_class_locks+i;
+
+					if (p->sci)
+					{
+						unsigned long j=SOMKERN_ptr_hash(p->sci) & (n-1);
+
+						while (t[j].sci) j=(j+1) & (n-1);
+
+						t[j]=*p;
+					}
+				}
+
+				SOMFree(somkern_class_locks);
+			}
+
+			somkern_class_locks=t;
+			somkern_class_locks_mask=n-1;
+		}
+	}
+
+	if (somkern_class_locks)
+	{
+		for (i=SOMKERN_ptr_hash(sci) & somkern_class_locks_mask;
+			 somkern_class_locks[i].sci;
+			 i=(i+1) & somkern_class_locks_mask)
+		{
+			if (somkern_class_locks[i].sci==sci)
+			{
+				lock=somkern_class_locks[i].lock;
+
+				break;
+			}
+		}
+
+		if ((!lock) && (somkern_class_locks_used < somkern_class_locks_mask))
+		{
+			/* without threads this fails and builds use the critical section */
+			if (!SOMCreateMutexSem(&lock))
+			{
+				somkern_class_locks[i].sci=sci;
+				somkern_class_locks[i].lock=lock;
+				somkern_class_locks_used++;
+			}
+			else
+			{
+				lock=NULL;
+			}
+		}
+	}
+
+	SOMKERN_unguard
+
+	return lock;
+}
+
+static void SOMKERN_free_class_locks(void)
+{
+	if (somkern_class_locks)
+	{
+		unsigned long i;
+
+		for (i=0; i <= somkern_class_locks_mask; i++)
+		{
+			if (somkern_class_locks[i].lock)
+			{
+				SOMDestroyMutexSem(somkern_class_locks[i].lock);
+			}
+		}
+
+		SOMFree(somkern_class_locks);
+
+		somkern_class_locks=NULL;
+		somkern_class_locks_mask=0;
+		somkern_class_locks_used=0;
+	}
+}
+
+/*
+ * Instances come from slabs kept per class, so a class created by the
+ * thousand costs a slab allocation now and then instead of a heap call
+ * per object, and its instances sit together.  Every block the default
+ * somAllocate() returns is preceded by a header naming its arena, or
+ * NULL for blocks that came from SOMMalloc(), so somDeallocate() knows
+ * where it goes back to.  Freed instances are kept for reuse; the slabs
+ * go once the class is unregistered and none of its instances is live.
+ */
+
+union somInstanceHeader
+{
+	struct somInstanceArena *arena;
+	double align_d;
+	void *align_p;
+};
+
+struct somInstanceSlab
+{
+	union
+	{
+		struct somInstanceSlab *next;
+		union somInstanceHeader align;
+	} u;
+};
+
+struct somInstanceArena
+{
+	somToken lock;
+	boolean orphaned;
+	size_t step;
+	unsigned long per_slab,live;
+	union somInstanceHeader *free;
+	struct somInstanceSlab *slabs;
+};
+
+#define SOMKERN_ARENA_MAX_SIZE		4096
+#define SOMKERN_ARENA_SLAB_SIZE		16384
+
+/* next block on the free list, kept where the instance goes */
+#define SOMKERN_arena_next(h)		(*(union somInstanceHeader **)(void *)((h)+1))
+
+static void SOMKERN_arena_lock(struct somInstanceArena *a)
+{
+	if (a->lock)
+	{
+		SOMRequestMutexSem(a->lock);
+	}
+	else
+	{
+		SOMKERN_guard
+	}
+}
+
+static void SOMKERN_arena_unlock(struct somInstanceArena *a)
+{
+	if (a->lock)
+	{
+		SOMReleaseMutexSem(a->lock);
+	}
+	else
+	{
+		SOMKERN_unguard
+	}
+}
+
+static struct somInstanceArena *SOMKERN_arena_get(somClassInfo info,long size)
+{
+	struct somInstanceArena *a=info->arena;
+
+	if (a || (size <= 0) || (size > SOMKERN_ARENA_MAX_SIZE)) return a;
+
+	SOMKERN_guard
+
+	a=info->arena;
+
+	if (!a)
+	{
+		a=SOMCalloc(sizeof(*a),1);
+
+		if (a)
+		{
+			a->step=sizeof(union somInstanceHeader)+
+				(((size_t)size+sizeof(union somInstanceHeader)-1) & ~(sizeof(union somInstanceHeader)-1));
+			a->per_slab=(SOMKERN_ARENA_SLAB_SIZE-sizeof(struct somInstanceSlab))/a->step;
+
+			if (a->per_slab < 8) a->per_slab=8;
+
+			if (SOMCreateMutexSem(&a->lock))
+			{
+				a->lock=NULL;
+			}
+
+			info->arena=a;
+		}
+	}
+
+	SOMKERN_unguard
+
+	return a;
+}
+
+/* up to count instances, returns how many */
+static long SOMKERN_arena_take(struct somInstanceArena *a,long count,somToken *objs)
+{
+	long n=0;
+
+	SOMKERN_arena_lock(a);
+
+	while (n < count)
+	{
+		union somInstanceHeader *h=a->free;
+
+		if (!h)
+		{
+			struct somInstanceSlab *slab=SOMMalloc(sizeof(*slab)+a->per_slab*a->step);
+			unsigned long i;
+
+			if (!slab) break;
+
+			slab->u.next=a->slabs;
+			a->slabs=slab;
+
+			for (i=a->per_slab; i--; )
+			{
+				h=(union somInstanceHeader *)(void *)(((char *)(slab+1))+i*a->step);
+				SOMKERN_arena_next(h)=a->free;
+				a->free=h;
+			}
+
+			h=a->free;
+		}
+
+		a->free=SOMKERN_arena_next(h);
+		h->arena=a;
+		objs[n++]=h+1;
+	}
+
+	a->live+=n;
+
+	SOMKERN_arena_unlock(a);
+
+	return n;
+}
+
+static void SOMKERN_arena_destroy(struct somInstanceArena *a)
+{
+	while (a->slabs)
+	{
+		struct somInstanceSlab *slab=a->slabs;
+		a->slabs=slab->u.next;
+		SOMFree(slab);
+	}
+
+	if (a->lock)
+	{
+		SOMDestroyMutexSem(a->lock);
+	}
+
+	SOMFree(a);
+}
+
+static void SOMKERN_arena_give(union somInstanceHeader *h)
+{
+	struct somInstanceArena *a=h->arena;
+	boolean last;
+
+	SOMKERN_arena_lock(a);
+
+	SOMKERN_arena_next(h)=a->free;
+	a->free=h;
+	last=(boolean)((!--(a->live)) && a->orphaned);
+
+	SOMKERN_arena_unlock(a);
+
+	if (last)
+	{
+		SOMKERN_arena_destroy(a);
+	}
+}
+
+static void SOMKERN_arena_release(somClassInfo info)
+{
+	struct somInstanceArena *a=info->arena;
+	boolean idle;
+
+	if (!a) return;
+
+	info->arena=NULL;
+
+	SOMKERN_arena_lock(a);
+
+	idle=(boolean)!a->live;
+	a->orphaned=1;
+
+	SOMKERN_arena_unlock(a);
+
+	/* otherwise the last instance freed takes it */
+	if (idle)
+	{
+		SOMKERN_arena_destroy(a);
+	}
+}
+
+/* a ready class changed shape; name tables are rebuilt as they are used */
+static void SOMKERN_lookup_changed(void)
+{
+	SOMKERN_guard
+
+	somkern_lookup_generation++;
+
+	SOMKERN_unguard
+}
+
+static struct somMTokenData *SOMKERN_somMToken_by_name(somClassInfo info,somId id)
+{
+	struct somNameHash *t=info->name_hash;
+	unsigned int i;
+
+	if (t && (t->generation != somkern_lookup_generation))
+	{
+		SOMKERN_build_lookup(somMtabFromClassInfo(info));
+
+		t=info->name_hash;
+	}
+
+	if (t && (t->generation == somkern_lookup_generation) && id && *id)
+	{
+		const char *p=*id;
+		boolean descriptor=0;
+		unsigned long h=SOMKERN_id_hash(p,1);
+
+		while (*p)
+		{
+			if (*p++==':')
+			{
+				descriptor=1;
+
+				break;
+			}
+		}
+
+		for (i=h & t->mask; t->entries[i].token; i=(i+1) & t->mask)
+		{
+			if ((t->entries[i].hash==h) &&
+				(t->entries[i].descriptor==descriptor) &&
+				somCompareIds(SOMKERN_name_id(t->entries[i].token,descriptor),id))
+			{
+				return t->entries[i].token;
+			}
+		}
+
+		return NULL;
+	}
+
+	i=info->added_methods._length;
 
 	if (i)
 	{
@@ -1094,6 +1739,65 @@ static struct somMTokenData *SOMKERN_somMToken_by_name(somClassInfo info,somId i
 	return NULL;
 }
 
+static struct somDispatchStub *SOMKERN_dispatch_stub(somMethodTabPtr mtab,somId id)
+{
+	somClassInfo info=somClassInfoFromMtab(mtab);
+	struct somNameHash *t=info->name_hash;
+	struct somDispatchStub *d;
+	struct somMTokenData *m;
+	somMethodPtr apply;
+	unsigned long slot;
+	size_t len;
+
+	if ((!id) || (!*id)) return NULL;
+
+	slot=SOMKERN_ptr_hash(*id) & (SOMKERN_DISPATCH_SLOTS-1);
+
+	if (t && (t->generation == somkern_lookup_generation))
+	{
+		d=t->dispatch[slot];
+
+		if (d && (d->name==*id) && !strcmp(d->text,*id)) return d;
+	}
+
+	m=SOMKERN_somMToken_by_name(info,id);
+
+	if (!m) return NULL;
+
+	apply=SOMKERN_apply_stub(m);
+
+	if (!apply) return NULL;
+
+	len=strlen(*id);
+	d=NULL;
+
+	SOMKERN_guard
+
+	t=info->name_hash;
+
+	if (t && (t->generation == somkern_lookup_generation) &&
+		(t->dispatch_count < SOMKERN_DISPATCH_MAX))
+	{
+		d=SOMMalloc(SOMKERN_offsetof(struct somDispatchStub,text)+len+1);
+
+		if (d)
+		{
+			memcpy(d->text,*id,len+1);
+			d->name=*id;
+			d->token=m;
+			d->apply=apply;
+			d->next=t->dispatch_list;
+			t->dispatch_list=d;
+			t->dispatch_count++;
+			t->dispatch[slot]=d;
+		}
+	}
+
+	SOMKERN_unguard
+
+	return d;
+}
+
 somMethodProc * SOMLINK somResolveByName(
 		SOMObject SOMSTAR obj,
         char *methodName)
@@ -1407,33 +2111,116 @@ static struct somParentClassInfo *SOMKERN_get_this_class(somMethodTabPtr p)
 	return b;
 }
 
-static int SOMKERN_is_class_in(somMethodTabPtr *p,unsigned int i,somMethodTabPtr c)
+/*
+ * Set of method tables for flattening MI classes, so asking whether a
+ * class is already present costs a probe rather than a walk over every
+ * parent's class list.  Small sets live in the structure itself.
+ */
+struct somMtabSet
 {
-	while (i--)
+	unsigned long mask;
+	somMethodTabPtr *slots;
+	somMethodTabPtr local[64];
+};
+
+static void SOMKERN_mtab_set_init(struct somMtabSet *set,unsigned long expected)
+{
+	unsigned long n=sizeof(set->local)/sizeof(set->local[0]);
+
+	while (n < 2*expected) n<<=1;
+
+	set->slots=set->local;
+
+	if (n > sizeof(set->local)/sizeof(set->local[0]))
 	{
-		if (*p == c)
-		{
-			return 1;
-		}
-		else
+		set->slots=SOMCalloc(n,sizeof(set->slots[0]));
+
+		if (!set->slots)
 		{
-			somMethodTabPtr q=*p++;
-			somClassInfo info=somClassInfoFromMtab(q);
-			unsigned int k=info->classes._length;
+			SOMError(-1,__FILE__,__LINE__);
 
-			while (k--)
-			{
-				if (c==info->classes._buffer[k].cls)
-				{
-					return 1;
-				}
-			}
+			set->slots=set->local;
+			n=sizeof(set->local)/sizeof(set->local[0]);
 		}
 	}
 
+	if (set->slots==set->local)
+	{
+		memset(set->local,0,sizeof(set->local));
+	}
+
+	set->mask=n-1;
+}
+
+static void SOMKERN_mtab_set_uninit(struct somMtabSet *set)
+{
+	if (set->slots!=set->local)
+	{
+		SOMFree(set->slots);
+	}
+}
+
+/* returns nonzero when p was already there */
+static int SOMKERN_mtab_set_add(struct somMtabSet *set,somMethodTabPtr p)
+{
+	unsigned long i=SOMKERN_ptr_hash(p) & set->mask;
+	unsigned long n=set->mask+1;
+
+	while (set->slots[i])
+	{
+		if (set->slots[i]==p) return 1;
+
+		if (!--n) return 0;
+
+		i=(i+1) & set->mask;
+	}
+
+	set->slots[i]=p;
+
+	return 0;
+}
+
+static int SOMKERN_mtab_set_has(struct somMtabSet *set,somMethodTabPtr p)
+{
+	unsigned long i=SOMKERN_ptr_hash(p) & set->mask;
+	unsigned long n=set->mask+1;
+
+	while (set->slots[i] && n--)
+	{
+		if (set->slots[i]==p) return 1;
+
+		i=(i+1) & set->mask;
+	}
+
 	return 0;
 }
 
+/* a parent and every class it holds */
+static void SOMKERN_mtab_set_add_classes(struct somMtabSet *set,somMethodTabPtr q)
+{
+	somClassInfo info=somClassInfoFromMtab(q);
+	unsigned int k=info->classes._length;
+
+	SOMKERN_mtab_set_add(set,q);
+
+	while (k--)
+	{
+		SOMKERN_mtab_set_add(set,info->classes._buffer[k].cls);
+	}
+}
+
+static unsigned long SOMKERN_count_classes(somMethodTabPtr *p,unsigned int i)
+{
+	unsigned long total=0;
+
+	while (i--)
+	{
+		total+=1+somClassInfoFromMtab(*p++)->classes._length;
+	}
+
+	return total;
+}
+
 static void SOMKERN_copy_somMethodTab(
 			boolean inherit_var,	/* whether to inherit implementation */
 			somMethodTabPtr info,
@@ -1443,6 +2230,7 @@ static void SOMKERN_copy_somMethodTab(
 	somClassInfo cinfo=somClassInfoFromMtab(info);
 	somClassInfo finfo=somClassInfoFromMtab(from);
 	struct somParentClassInfo *parents=cinfo->classes._buffer;
+	struct somMtabSet present;
 
 	if (cinfo->classes._length)
 	{
@@ -1452,9 +2240,12 @@ static void SOMKERN_copy_somMethodTab(
 	/* for multiple inheritence, should confirm that the
 		same class does not exist twice in this list */
 
+	SOMKERN_mtab_set_init(&present,cinfo->classes._length+finfo->classes._length+1);
+	SOMKERN_mtab_set_add_classes(&present,info);
+
 	while (i < finfo->classes._length)
 	{
-		if (!SOMKERN_is_class_in(&info,1,finfo->classes._buffer[i].cls))
+		if (!SOMKERN_mtab_set_add(&present,finfo->classes._buffer[i].cls))
 		{
 			*parents=finfo->classes._buffer[i];
 
@@ -1469,6 +2260,8 @@ static void SOMKERN_copy_somMethodTab(
 		i++;
 	}
 
+	SOMKERN_mtab_set_uninit(&present);
+
 	i=cinfo->classes._length;
 	parents=cinfo->classes._buffer;
 
@@ -1621,112 +2414,83 @@ static int SOMKERN_any_mi(somMethodTabPtr p)
 	return 0;
 }
 
+/*
+ * Both counts walk the parents from the last one, keeping the classes
+ * of the parents already walked, so a class shared by several parents
+ * is counted once, with the last of them.
+ */
 static int SOMKERN_count_unique_classes(somMethodTabPtr *p,unsigned int i)
 {
+	struct somMtabSet later;
 	int total=0;
 
+	SOMKERN_mtab_set_init(&later,SOMKERN_count_classes(p,i));
+
 	while (i--)
 	{
-		somMethodTabPtr q=*p++;
+		somMethodTabPtr q=p[i];
 		somClassInfo info=somClassInfoFromMtab(q);
 		unsigned int k=info->classes._length;
 
 		while (k--)
 		{
-			somMethodTabPtr x=info->classes._buffer[k].cls;
-
-			if (!SOMKERN_is_class_in(p,i,x))
+			if (!SOMKERN_mtab_set_has(&later,info->classes._buffer[k].cls))
 			{
-/*				somPrintf("new class %s\n",x->className);*/
 				total++;
 			}
 		}
+
+		SOMKERN_mtab_set_add_classes(&later,q);
 	}
 
+	SOMKERN_mtab_set_uninit(&later);
+
 	return total;
 }
 
 static int SOMKERN_count_unique_methods(somMethodTabPtr *p,unsigned int i)
 {
+	struct somMtabSet later;
 	int total=0;
 
-	while (i--)
-	{
-		somMethodTabPtr q=*p++;
-		unsigned int k=somClassInfoFromMtab(q)->jump_table._length;
-
-		while (k--)
-		{
-			if (!SOMKERN_is_method_in(p,i,
-				/*	q->jump_table._buffer[k].mToken*/
-					SOMKERN_index_to_somMToken(q,k)
-					))
-			{
-				total++;
-			}
-		}
-	}
-
-	return total;
-}
-
-static int SOMKERN_is_method_in(somMethodTabPtr *q,unsigned int i,somMToken t)
-{
-/*	{
-		char *r;
-
-		r=somStringFromId(*(t->defined_in->methodDescriptor));
+	SOMKERN_mtab_set_init(&later,SOMKERN_count_classes(p,i));
 
-		somPrintf("Checking for %s\n",r);
-	}
-*/
 	while (i--)
 	{
-		somMethodTabPtr p=*q++;
-		somClassInfo info=somClassInfoFromMtab(p);
+		somMethodTabPtr q=p[i];
+		somClassInfo info=somClassInfoFromMtab(q);
 		struct somParentClassInfo *par=info->classes._buffer;
 		unsigned int j=info->classes._length;
 
-		/* this is Rhubarb, should actually
-			get class the method is implemented in 
-			and then zip through class list */
+		/* the jump table is a run of each class's added methods */
 
 		while (j--)
 		{
-			if (par->cls==t->classInfoOwner)
-			{
-				unsigned int k=SOMKERN_resolve_index(p,t);
-				somMethodPtr *je=p->entries+k;
+			somClassInfo ci=somClassInfoFromMtab(par->cls);
+			unsigned long k=ci->added_methods._length;
 
-#ifdef SOM_DEBUG_JUMP_TABLE
-				if (je->method)
+			if (k && (par->jump_table_offset < info->jump_table._length))
+			{
+				if (k > info->jump_table._length-par->jump_table_offset)
 				{
-					return 1;
+					k=info->jump_table._length-par->jump_table_offset;
 				}
-#else
-				RHBOPT_ASSERT(*je)
 
-				if (*je)
+				if (!SOMKERN_mtab_set_has(&later,ci->added_methods._buffer[0].classInfoOwner))
 				{
-					return 1;
+					total+=(int)k;
 				}
-#endif
 			}
 
 			par++;
 		}
 
-/*		{
-			char *r;
-
-			r=somStringFromId(*(t->defined_in->methodDescriptor));
-
-			somPrintf("%s does not contain %s\n",
-					p->className,r);
-		}*/
+		SOMKERN_mtab_set_add_classes(&later,q);
 	}
 
-	return 0;
+	SOMKERN_mtab_set_uninit(&later);
+
+	return total;
 }
 
 
@@ -1850,6 +2614,8 @@ static void SOMKERN_UnbootStrap(void)
 	if (!som_globals.apps)
 #endif
 	{
+		SOMKERN_free_class_locks();
+
 	#ifdef SOM_DEBUG_MEMORY
 		som_dump_mem();
 	#endif
@@ -2071,11 +2837,238 @@ SOMEXTERN void SOMLINK somEndCriticalSection(void)
 #endif
 }
 
+/*
+ * Registered ids.  Every name is interned once in a global table, and
+ * ids built or checked here point at the interned copy, so equal ids
+ * share one string pointer.  Entries are linked in at the head of
+ * their chains under the kernel guard and never removed, so lookups
+ * walk the chains without locking.  A second chain links names that
+ * only differ in case, for somCompareIds().
+ */
+
+struct somIdEntry
+{
+	struct somIdEntry * volatile next;			/* same exact hash bucket */
+	struct somIdEntry * volatile next_fold;		/* same folded hash bucket */
+	struct somIdEntry *fold;					/* first entry equal ignoring case */
+	unsigned long hash,fold_hash;
+	unsigned long key;							/* for somUniqueKey */
+	char *name;									/* text, or the caller's persistent string */
+	char text[1];
+};
+
+struct somIdChunk
+{
+	struct somIdChunk *next;
+	size_t used,size;
+	char *data_end;
+	union
+	{
+		double d;
+		void *p;
+	} data[1];
+};
+
+#define SOMKERN_ID_BUCKETS		4096
+#define SOMKERN_ID_CHUNK		32768
+
+static struct somIdEntry * volatile *somId_buckets;
+static struct somIdEntry * volatile *somId_fold_buckets;
+static struct somIdChunk * volatile somId_chunks;
+static unsigned long somId_nbuckets=SOMKERN_ID_BUCKETS;
+static unsigned long somId_count;
+
+static unsigned long SOMKERN_id_hash(const char *p,int fold)
+{
+	unsigned long h=2166136261UL;
+
+	while (*p)
+	{
+		unsigned char c=*p++;
+
+		if (fold && c>='A' && c<='Z') c+='a'-'A';
+
+		h=(h^c)*16777619UL;
+	}
+
+	return h;
+}
+
+static int SOMKERN_id_fold_equal(const char *a,const char *b)
+{
+	return !
+#ifdef HAVE_STRCASECMP
+		strcasecmp(a,b)
+#else
+		_stricmp(a,b)
+#endif
+		;
+}
+
+/* caller holds the guard */
+static struct somIdEntry *SOMKERN_id_alloc(size_t len)
+{
+	struct somIdChunk *c=somId_chunks;
+	size_t size=(SOMKERN_offsetof(struct somIdEntry,text)+len+1+sizeof(void *)-1)
+				& ~(sizeof(void *)-1);
+	struct somIdEntry *e;
+
+	if ((!c) || (c->used+size > c->size))
+	{
+		size_t csize=size > SOMKERN_ID_CHUNK ? size : SOMKERN_ID_CHUNK;
+
+		c=SOMMalloc(SOMKERN_offsetof(struct somIdChunk,data)+csize);
+
+		if (!c) return NULL;
+
+		c->used=0;
+		c->size=csize;
+		c->data_end=((char *)c->data)+csize;
+		c->next=somId_chunks;
+		somId_chunks=c;
+	}
+
+	e=(struct somIdEntry *)(((char *)c->data)+c->used);
+	c->used+=size;
+
+	return e;
+}
+
+/*
+ * Interned entry for a name, adding it if needed; *added says which
+ */
+static struct somIdEntry *SOMKERN_id_intern(const char *name,int *added)
+{
+	unsigned long h=SOMKERN_id_hash(name,0);
+	som_thread_globals_t *ev;
+	struct somIdEntry *e;
+	unsigned long i;
+
+	*added=0;
+
+	if (somId_buckets)
+	{
+		for (e=somId_buckets[h & (somId_nbuckets-1)]; e; e=e->next)
+		{
+			if ((e->hash==h) && !strcmp(e->name,name))
+			{
+				return e;
+			}
+		}
+	}
+
+	ev=SOMKERN_get_thread_globals(0);
+
+	SOMKERN_guard
+
+	if (!somId_buckets)
+	{
+		struct somIdEntry * volatile *b=SOMCalloc(2*somId_nbuckets,sizeof(*b));
+
+		if (!b)
+		{
+			SOMKERN_unguard
+
+			return NULL;
+		}
+
+		somId_fold_buckets=b+somId_nbuckets;
+		somId_buckets=b;
+	}
+
+	/* may have been added while we were not looking */
+	for (e=somId_buckets[h & (somId_nbuckets-1)]; e; e=e->next)
+	{
+		if ((e->hash==h) && !strcmp(e->name,name))
+		{
+			break;
+		}
+	}
+
+	if (!e)
+	{
+		int persistent=(ev && ev->persistent_ids) ? 1 : 0;
+		size_t len=strlen(name);
+
+		e=SOMKERN_id_alloc(persistent ? 0 : len);
+
+		if (e)
+		{
+			struct somIdEntry *f;
+
+			if (persistent)
+			{
+				e->name=(char *)name;
+			}
+			else
+			{
+				memcpy(e->text,name,len+1);
+				e->name=e->text;
+			}
+
+			e->hash=h;
+			e->fold_hash=SOMKERN_id_hash(name,1);
+			e->key=++somId_count;
+			e->fold=e;
+
+			i=e->fold_hash & (somId_nbuckets-1);
+
+			for (f=somId_fold_buckets[i]; f; f=f->next_fold)
+			{
+				if ((f->fold_hash==e->fold_hash) &&
+					SOMKERN_id_fold_equal(f->name,name))
+				{
+					e->fold=f->fold;
+					break;
+				}
+			}
+
+			/* complete before it becomes visible */
+			e->next_fold=somId_fold_buckets[i];
+			somId_fold_buckets[i]=e;
+			e->next=somId_buckets[h & (somId_nbuckets-1)];
+			somId_buckets[h & (somId_nbuckets-1)]=e;
+
+			*added=1;
+		}
+	}
+
+	SOMKERN_unguard
+
+	return e;
+}
+
+/*
+ * Case-folded entry of a name interned by this table, NULL for any
+ * other string.  Ids are only ever compared this way when both are.
+ */
+struct somIdEntry *SOMKERN_id_fold(const char *name)
+{
+	struct somIdChunk *c;
+
+	if (!name) return NULL;
+
+	for (c=somId_chunks; c; c=c->next)
+	{
+		if ((name >= ((char *)c->data)+SOMKERN_offsetof(struct somIdEntry,text)) &&
+			(name < c->data_end))
+		{
+			struct somIdEntry *e=(struct somIdEntry *)
+					(name-SOMKERN_offsetof(struct somIdEntry,text));
+
+			return (e->name==name) ? e->fold : NULL;
+		}
+	}
+
+	return NULL;
+}
+
 SOMEXTERN unsigned long SOMLINK somUniqueKey(somId id)
 {
-	SOM_IgnoreWarning(id);
+	int added;
+	struct somIdEntry *e=(id && *id) ? SOMKERN_id_intern(*id,&added) : NULL;
 
-	return 0;
+	return e ? e->key : 0;
 }
 
 SOMEXTERN void SOMLINK somBeginPersistentIds(void)
@@ -2094,31 +3087,55 @@ som_thread_globals_t *ev=SOMKERN_get_thread_globals(1);
 
 SOMEXTERN somId SOMLINK somCheckId (somId id)
 {
+	somRegisterId(id);
+
 	return id;
 }
 
 SOMEXTERN int SOMLINK somRegisterId(somId id)
 {
-	SOM_IgnoreWarning(id);
+	struct somIdEntry *e;
+	int added=0;
 
-	return 0;
+	if (id && *id)
+	{
+		e=SOMKERN_id_intern(*id,&added);
+
+		/* from now on the id compares by pointer */
+		if (e && (*id != e->name)) *id=e->name;
+	}
+
+	return added;
 }
 
 SOMEXTERN somId SOMLINK somIdFromString(char * aString)
 {
 	if (aString)
 	{
-		struct a
+		/* the id itself belongs to the caller, who may SOMFree() it */
+		int added;
+		struct somIdEntry *e=SOMKERN_id_intern(aString,&added);
+		char **b=SOMMalloc(sizeof(*b));
+
+		if (b)
 		{
-			char * a;
-			char n[1];
-		};
-		size_t len=strlen(aString);
-		struct a *b=SOMCalloc(sizeof(*b)+len,1);
-		memcpy(b->n,aString,len+1);
-		b->a=b->n;
+			*b=e ? e->name : NULL;
+
+			if (!e)
+			{
+				/* out of memory for the table, fall back to a private copy */
+				size_t len=strlen(aString);
+				SOMFree(b);
+				b=SOMCalloc(sizeof(*b)+len+1,1);
+				if (b)
+				{
+					memcpy(b+1,aString,len+1);
+					*b=(char *)(b+1);
+				}
+			}
+		}
 
-		return &b->a;
+		return b;
 	}
 
 	return 0;
@@ -2126,12 +3143,20 @@ SOMEXTERN somId SOMLINK somIdFromString(char * aString)
 
 SOMEXTERN unsigned long SOMLINK somTotalRegIds(void)
 {
-	return 0;
+	return somId_count;
 }
 
 SOMEXTERN void SOMLINK somSetExpectedIds(unsigned long numIds)
 {
-	SOM_IgnoreWarning(numIds);
+	/* only before the first id, the table does not rehash */
+	if (!somId_buckets)
+	{
+		unsigned long n=SOMKERN_ID_BUCKETS;
+
+		while ((n < numIds) && (n < 0x100000UL)) n<<=1;
+
+		somId_nbuckets=n;
+	}
 }
 
 SOMEXTERN void SOMLINK somTest(int condition, int severity,const char * fileName,
@@ -2239,7 +3264,14 @@ static void SOMKERN_end_thread(void *evv)
 		som_thread_globals_t *ev=evv;
 
 		somExceptionFree(&ev->ev);
+#ifdef SOMKERN_THREAD_CACHE
+		if (somkern_thread_globals==ev)
+		{
+			somkern_thread_globals=NULL;
+		}
+#endif
 #ifdef USE_THREADS
+		SOMKERN_pool_flush(&ev->pool);
 		SOMFree(ev);
 #endif
 	}
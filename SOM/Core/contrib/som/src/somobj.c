@@ -159,7 +159,29 @@ SOM_Scope boolean  SOMLINK somobj_somDispatch(SOMObject SOMSTAR somSelf,
                                                           va_list ap)
 {
 	somMethodData md;
-	boolean b=SOMClass_somGetMethodData(
+	struct somDispatchStub *d=NULL;
+	boolean b;
+
+	/* a metaclass with its own somGetMethodData() is asked each time */
+	if (((somMethodPtr)somResolve((SOMObject SOMSTAR)(void *)somMethodTabFromObject(somSelf)->classObject,
+			SOMClassClassData.somGetMethodData))==(somMethodPtr)somcls_somGetMethodData)
+	{
+		d=SOMKERN_dispatch_stub(somMethodTabFromObject(somSelf),methodId);
+	}
+
+	if (d)
+	{
+		somMethodPtr method=SOMKERN_resolve(somMethodTabFromObject(somSelf),d->token);
+
+		if (method!=d->token->defined.redispatchStub)
+		{
+			((somTD_SOMKERN_apply)(d->apply))(somSelf,retValue,method,ap);
+
+			return 1;
+		}
+	}
+
+	b=SOMClass_somGetMethodData(
 			somMethodTabFromObject(somSelf)->classObject,methodId,&md);
 
 	if (!b) 
@@ -0,0 +1,676 @@
+/**************************************************************************
+ *
+ *  Copyright 2008, Roger Brown
+ *
+ *  This file is part of Roger Brown's Toolkit.
+ *
+ *  This program is free software: you can redistribute it and/or modify it
+ *  under the terms of the GNU Lesser General Public License as published by the
+ *  Free Software Foundation, either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ *  more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/*
+ * $Id$
+ */
+
+/*
+ * SOM runtime benchmark
+ *
+ * Times object creation, each way of calling a method, class
+ * lookups, id interning, class creation from several threads at once
+ * and, given a server alias, DSOM round trips through somdd.  Prints
+ * one CSV line per benchmark:
+ *
+ *   name,threads,calls,ms,calls_per_sec,p50_us,p90_us,p99_us,max_us,
+ *   allocs_per_call,bytes_per_call
+ *
+ * Cheap calls are timed in batches, so a sample is the mean of a batch.
+ * With -m, SOMMalloc and friends are wrapped to count allocations; run
+ * against a SOM_DEBUG_MEMORY build of the kernel that also checks the
+ * guard bytes and dumps leaks at somEnvironmentEnd().
+ *
+ * usage: sombench [-n iterations] [-t threads] [-m] [-d alias] [name ...]
+ */
+
+#include <rhbopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/time.h>
+	#include <time.h>
+#endif
+
+#ifdef USE_PTHREADS
+	#include <pthread.h>
+#endif
+
+#include <som.h>
+#include <somd.h>
+#include <somdom.h>
+#include <somdserv.h>
+
+#define SOMBENCH_MAX_SAMPLES	100000
+#define SOMBENCH_MAX_THREADS	32
+#define SOMBENCH_MAX_SELECT		16
+
+typedef unsigned long long sombench_ticks;
+
+struct sombench;
+typedef int (*sombench_fn)(struct sombench *,unsigned long iter,unsigned long thread);
+
+struct sombench
+{
+	const char *name;
+	sombench_fn fn;
+	unsigned long batch;		/* calls timed as one sample */
+	unsigned long scale;		/* iterations are divided by this */
+	int threaded;				/* runs on every thread */
+};
+
+static sombench_ticks samples[SOMBENCH_MAX_SAMPLES];
+static unsigned long sample_count;
+static unsigned long threads=4;
+static unsigned long generation;
+static const char *server_alias;
+static SOMDServer SOMSTAR server;
+static somId id_somGetSize;
+static somId id_SOMObject;
+static somMethodData md_somGetSize;
+
+/*
+ * timer
+ */
+
+static sombench_ticks sombench_now(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER li;
+	QueryPerformanceCounter(&li);
+	return (sombench_ticks)li.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ((sombench_ticks)ts.tv_sec)*1000000000ULL+ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv,NULL);
+	return ((sombench_ticks)tv.tv_sec)*1000000000ULL+tv.tv_usec*1000ULL;
+#endif
+}
+
+static double sombench_ticks_per_us(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER li;
+	QueryPerformanceFrequency(&li);
+	return li.QuadPart/1000000.0;
+#else
+	return 1000.0;
+#endif
+}
+
+/* only thread 0 records, the others are there for the contention */
+static void sombench_sample(sombench_ticks t,unsigned long thread)
+{
+	if (!thread && sample_count < SOMBENCH_MAX_SAMPLES)
+	{
+		samples[sample_count++]=t;
+	}
+}
+
+/*
+ * allocation counting for -m, installed over the kernel's allocator
+ */
+
+static somTD_SOMMalloc *real_malloc;
+static somTD_SOMCalloc *real_calloc;
+static somTD_SOMRealloc *real_realloc;
+static unsigned long alloc_count,alloc_bytes;
+
+static somToken SOMLINK count_malloc(size_t n)
+{
+	alloc_count++;
+	alloc_bytes+=(unsigned long)n;
+	return real_malloc(n);
+}
+
+static somToken SOMLINK count_calloc(size_t c,size_t n)
+{
+	alloc_count++;
+	alloc_bytes+=(unsigned long)(c*n);
+	return real_calloc(c,n);
+}
+
+static somToken SOMLINK count_realloc(somToken p,size_t n)
+{
+	alloc_count++;
+	alloc_bytes+=(unsigned long)n;
+	return real_realloc(p,n);
+}
+
+static void sombench_count_allocs(void)
+{
+	real_malloc=SOMMalloc;
+	real_calloc=SOMCalloc;
+	real_realloc=SOMRealloc;
+	SOMMalloc=count_malloc;
+	SOMCalloc=count_calloc;
+	SOMRealloc=count_realloc;
+}
+
+/*
+ * object lifetime
+ */
+
+static int bench_new_free(struct sombench *b,unsigned long iter,unsigned long thread)
+{
+	unsigned long i,j;
+
+	for (i=0; i < iter; i++)
+	{
+		sombench_ticks t=sombench_now();
+
+		for (j=0; j < b->batch; j++)
+		{
+			SOMObject SOMSTAR obj=SOMClass_somNew(SOMObjectClassData.classObject);
+			if (!obj) return 1;
+			SOMObject_somFree(obj);
+		}
+
+		sombench_sample(sombench_now()-t,thread);
+	}
+
+	return 0;
+}
+
+/*
+ * dispatch - the same no-argument method four ways
+ */
+
+static SOMObject SOMSTAR target;
+
+static int bench_static(struct sombench *b,unsigned long iter,unsigned long thread)
+{
+	unsigned long i,j;
+	long sum=0;
+
+	for (i=0; i < iter; i++)
+	{
+		sombench_ticks t=sombench_now();
+
+		for (j=0; j < b->batch; j++)
+		{
+			sum+=SOMObject_somGetSize(target);
+		}
+
+		sombench_sample(sombench_now()-t,thread);
+	}
+
+	return sum ? 0 : 1;
+}
+
+static int bench_resolve_by_name(struct sombench *b,unsigned long iter,unsigned long thread)
+{
+	unsigned long i,j;
+	long sum=0;
+
+	for (i=0; i < iter; i++)
+	{
+		sombench_ticks t=sombench_now();
+
+		for (j=0; j < b->batch; j++)
+		{
+			somTD_SOMObject_somGetSize fn=(somTD_SOMObject_somGetSize)
+					somResolveByName(target,"somGetSize");
+			if (!fn) return 1;
+			sum+=fn(target);
+		}
+
+		sombench_sample(sombench_now()-t,thread);
+	}
+
+	return sum ? 0 : 1;
+}
+
+/* somApply() takes the arguments, target first, as a va_list */
+static boolean bench_apply_va(SOMObject SOMSTAR obj,somToken *ret,somMethodData *md,...)
+{
+	boolean b;
+	va_list ap;
+	va_start(ap,md);
+	b=somApply(obj,ret,md,ap);
+	va_end(ap);
+	return b;
+}
+
+static int bench_apply(struct sombench *b,unsigned long iter,unsigned long thread)
+{
+	unsigned long i,j;
+
+	for (i=0; i < iter; i++)
+	{
+		sombench_ticks t=sombench_now();
+
+		for (j=0; j < b->batch; j++)
+		{
+			somToken ret=NULL;
+			if (!bench_apply_va(target,&ret,&md_somGetSize,target)) return 1;
+		}
+
+		sombench_sample(sombench_now()-t,thread);
+	}
+
+	return 0;
+}
+
+static int bench_dispatch(struct sombench *b,unsigned long iter,unsigned long thread)
+{
+	unsigned long i,j;
+
+	for (i=0; i < iter; i++)
+	{
+		sombench_ticks t=sombench_now();
+
+		for (j=0; j < b->batch; j++)
+		{
+			somToken ret=NULL;
+			if (!somva_SOMObject_somDispatch(target,&ret,id_somGetSize,target)) return 1;
+		}
+
+		sombench_sample(sombench_now()-t,thread);
+	}
+
+	return 0;
+}
+
+/*
+ * class and id lookups
+ */
+
+static int bench_find_class(struct sombench *b,unsigned long iter,unsigned long thread)
+{
+	unsigned long i,j;
+
+	for (i=0; i < iter; i++)
+	{
+		sombench_ticks t=sombench_now();
+
+		for (j=0; j < b->batch; j++)
+		{
+			SOMClass SOMSTAR cls=SOMClassMgr_somFindClass(SOMClassMgrObject,id_SOMObject,0,0);
+			if (!cls) return 1;
+			somReleaseClassReference(cls);
+		}
+
+		sombench_sample(sombench_now()-t,thread);
+	}
+
+	return 0;
+}
+
+static int bench_id_intern(struct sombench *b,unsigned long iter,unsigned long thread)
+{
+	static const char *names[]={"somGetSize","somGetClass","somIsA","SOMObject","somDispatch"};
+	unsigned long i,j;
+
+	for (i=0; i < iter; i++)
+	{
+		sombench_ticks t=sombench_now();
+
+		for (j=0; j < b->batch; j++)
+		{
+			somId id=somIdFromString((char *)names[j%(sizeof(names)/sizeof(names[0]))]);
+			if (!id) return 1;
+			SOMFree(id);
+		}
+
+		sombench_sample(sombench_now()-t,thread);
+	}
+
+	return 0;
+}
+
+/*
+ * class creation - every thread builds, registers and drops uniquely
+ * named subclasses of SOMObject, all through the one class manager
+ */
+
+static int bench_class_create(struct sombench *b,unsigned long iter,unsigned long thread)
+{
+	unsigned long i;
+	char name[64];
+
+	for (i=0; i < iter; i++)
+	{
+		SOMClass SOMSTAR cls;
+		sombench_ticks t=sombench_now();
+
+		sprintf(name,"SOMBench_%lu_%lu_%lu",generation,thread,i);
+
+		cls=SOMClassNew();
+		if (!cls) return 1;
+		SOMClass_somInitClass(cls,name,SOMObjectClassData.classObject,0,0,1,0);
+		SOMClass_somClassReady(cls);
+		SOMClassMgr_somUnregisterClass(SOMClassMgrObject,cls);
+
+		sombench_sample(sombench_now()-t,thread);
+	}
+
+	return 0;
+}
+
+/*
+ * DSOM - a call with no arguments to the server's SOMDServer object,
+ * so each sample is one request and reply through the ORB
+ */
+
+static int bench_dsom(struct sombench *b,unsigned long iter,unsigned long thread)
+{
+	unsigned long i;
+	Environment ev;
+
+	if (!server) return -1;
+
+	SOM_InitEnvironment(&ev);
+
+	for (i=0; i < iter; i++)
+	{
+		sombench_ticks t=sombench_now();
+
+		SOMDServer_somdObjReferencesCached(server,&ev);
+
+		if (ev._major)
+		{
+			somExceptionFree(&ev);
+			SOM_UninitEnvironment(&ev);
+			return 1;
+		}
+
+		sombench_sample(sombench_now()-t,thread);
+	}
+
+	SOM_UninitEnvironment(&ev);
+
+	return 0;
+}
+
+static struct sombench benches[]={
+	{"new_free",			bench_new_free,			100,	1,		0},
+	{"new_free_mt",			bench_new_free,			100,	1,		1},
+	{"call_static",			bench_static,			1000,	1,		0},
+	{"call_resolve_by_name",bench_resolve_by_name,	100,	1,		0},
+	{"call_apply",			bench_apply,			100,	1,		0},
+	{"call_dispatch",		bench_dispatch,			100,	1,		0},
+	{"find_class",			bench_find_class,		100,	1,		0},
+	{"find_class_mt",		bench_find_class,		100,	1,		1},
+	{"id_intern",			bench_id_intern,		100,	1,		0},
+	{"class_create",		bench_class_create,		1,		10,		0},
+	{"class_create_mt",		bench_class_create,		1,		10,		1},
+	{"dsom_roundtrip",		bench_dsom,				1,		10,		0},
+	{"dsom_roundtrip_mt",	bench_dsom,				1,		10,		1}
+};
+
+/*
+ * running
+ */
+
+struct sombench_thread
+{
+	struct sombench *bench;
+	unsigned long iter,thread;
+	int rc;
+};
+
+#ifdef USE_PTHREADS
+static void *sombench_thread_start(void *pv)
+{
+	struct sombench_thread *t=pv;
+	t->rc=t->bench->fn(t->bench,t->iter,t->thread);
+	return pv;
+}
+#endif
+
+static int sombench_run_threads(struct sombench *b,unsigned long iter,unsigned long n)
+{
+#ifdef USE_PTHREADS
+	struct sombench_thread data[SOMBENCH_MAX_THREADS];
+	pthread_t tid[SOMBENCH_MAX_THREADS];
+	unsigned long i;
+	int rc=0;
+
+	for (i=0; i < n; i++)
+	{
+		data[i].bench=b;
+		data[i].iter=iter;
+		data[i].thread=i;
+		data[i].rc=0;
+
+		if (pthread_create(&tid[i],NULL,sombench_thread_start,&data[i]))
+		{
+			n=i;
+			rc=1;
+			break;
+		}
+	}
+
+	for (i=0; i < n; i++)
+	{
+		void *pv;
+		pthread_join(tid[i],&pv);
+		if (data[i].rc) rc=data[i].rc;
+	}
+
+	return rc;
+#else
+	return -1;
+#endif
+}
+
+static int sombench_compare(const void *a,const void *b)
+{
+	sombench_ticks ta=*(const sombench_ticks *)a,tb=*(const sombench_ticks *)b;
+	return ta < tb ? -1 : ta > tb;
+}
+
+static double sombench_percentile(unsigned long pct,double per_us)
+{
+	unsigned long i=(unsigned long)((double)sample_count*pct/100.0);
+	if (i >= sample_count) i=sample_count-1;
+	return samples[i]/per_us;
+}
+
+static void sombench_run(struct sombench *b,unsigned long iter,int count_allocs)
+{
+	double per_us=sombench_ticks_per_us()*b->batch;
+	unsigned long n=b->threaded ? threads : 1;
+	unsigned long allocs,bytes,calls;
+	sombench_ticks t,sum=0;
+	unsigned long i;
+	int rc;
+
+	iter/=b->scale;
+	if (!iter) iter=1;
+	if (iter > SOMBENCH_MAX_SAMPLES) iter=SOMBENCH_MAX_SAMPLES;
+
+	/* warm-up; class names are unique per run */
+	sample_count=0;
+	generation++;
+	rc=n > 1 ? sombench_run_threads(b,iter/10+1,n) : b->fn(b,iter/10+1,0);
+
+	if (!rc)
+	{
+		sample_count=0;
+		generation++;
+		allocs=alloc_count;
+		bytes=alloc_bytes;
+		t=sombench_now();
+		rc=n > 1 ? sombench_run_threads(b,iter,n) : b->fn(b,iter,0);
+		t=sombench_now()-t;
+		allocs=alloc_count-allocs;
+		bytes=alloc_bytes-bytes;
+	}
+
+	if (rc || !sample_count)
+	{
+		printf("%s,%lu,skipped\n",b->name,n);
+		return;
+	}
+
+	for (i=0; i < sample_count; i++) sum+=samples[i];
+	qsort(samples,sample_count,sizeof(samples[0]),sombench_compare);
+
+	calls=sample_count*b->batch;
+
+	printf("%s,%lu,%lu,%.1f,%.0f,%.3f,%.3f,%.3f,%.3f",
+			b->name,n,calls,
+			t/(sombench_ticks_per_us()*1000.0),
+			/* thread 0's rate, times the threads for the aggregate */
+			sum ? n*calls/(sum/(sombench_ticks_per_us()*1000000.0)) : 0.0,
+			sombench_percentile(50,per_us),
+			sombench_percentile(90,per_us),
+			sombench_percentile(99,per_us),
+			samples[sample_count-1]/per_us);
+
+	if (count_allocs)
+	{
+		/* counters are not atomic, so only single-threaded rows are exact */
+		printf(",%.2f,%.1f",
+				(double)allocs/(calls*n),
+				(double)bytes/(calls*n));
+	}
+	else
+	{
+		printf(",,");
+	}
+
+	printf("\n");
+	fflush(stdout);
+}
+
+static int sombench_selected(const char *name,char **sel,int nsel)
+{
+	int i;
+	if (!nsel) return 1;
+	for (i=0; i < nsel; i++)
+	{
+		if (!strncmp(name,sel[i],strlen(sel[i]))) return 1;
+	}
+	return 0;
+}
+
+int main(int argc,char **argv)
+{
+	unsigned long iter=10000;
+	int count_allocs=0,nsel=0,i;
+	char *sel[SOMBENCH_MAX_SELECT];
+	Environment ev;
+
+	for (i=1; i < argc; i++)
+	{
+		if (!strcmp(argv[i],"-n") && i+1 < argc)
+		{
+			iter=strtoul(argv[++i],NULL,10);
+		}
+		else if (!strcmp(argv[i],"-t") && i+1 < argc)
+		{
+			threads=strtoul(argv[++i],NULL,10);
+			if (!threads) threads=1;
+			if (threads > SOMBENCH_MAX_THREADS) threads=SOMBENCH_MAX_THREADS;
+		}
+		else if (!strcmp(argv[i],"-m"))
+		{
+			count_allocs=1;
+		}
+		else if (!strcmp(argv[i],"-d") && i+1 < argc)
+		{
+			server_alias=argv[++i];
+		}
+		else if (argv[i][0]=='-')
+		{
+			fprintf(stderr,"usage: %s [-n iterations] [-t threads] [-m] [-d alias] [name ...]\n",argv[0]);
+			return 1;
+		}
+		else if (nsel < SOMBENCH_MAX_SELECT)
+		{
+			sel[nsel++]=argv[i];
+		}
+	}
+
+	if (!somEnvironmentNew())
+	{
+		fprintf(stderr,"%s: somEnvironmentNew failed\n",argv[0]);
+		return 1;
+	}
+
+	if (count_allocs) sombench_count_allocs();
+
+	id_somGetSize=somIdFromString("somGetSize");
+	id_SOMObject=somIdFromString("SOMObject");
+	SOMClass_somGetMethodData(SOMObjectClassData.classObject,id_somGetSize,&md_somGetSize);
+	target=SOMClass_somNew(SOMObjectClassData.classObject);
+
+	SOM_InitEnvironment(&ev);
+
+	if (server_alias)
+	{
+		SOMD_Init(&ev);
+
+		if (!ev._major)
+		{
+			server=SOMDObjectMgr_somdFindServerByName(SOMD_ObjectMgr,&ev,(char *)server_alias);
+		}
+
+		if (ev._major || !server)
+		{
+			fprintf(stderr,"%s: no server \"%s\", start somdd and register it with regimpl\n",
+					argv[0],server_alias);
+			somExceptionFree(&ev);
+			server=NULL;
+		}
+	}
+
+	printf("name,threads,calls,ms,calls_per_sec,p50_us,p90_us,p99_us,max_us,allocs_per_call,bytes_per_call\n");
+
+	for (i=0; i < (int)(sizeof(benches)/sizeof(benches[0])); i++)
+	{
+		if (sombench_selected(benches[i].name,sel,nsel))
+		{
+			sombench_run(&benches[i],iter,count_allocs);
+		}
+	}
+
+	if (server)
+	{
+		somReleaseObjectReference(server);
+	}
+
+	if (server_alias)
+	{
+		SOMD_Uninit(&ev);
+	}
+
+	SOM_UninitEnvironment(&ev);
+
+	SOMObject_somFree(target);
+	SOMFree(id_somGetSize);
+	SOMFree(id_SOMObject);
+
+	somEnvironmentEnd();
+
+	return 0;
+}
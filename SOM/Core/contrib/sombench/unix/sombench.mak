@@ -0,0 +1,50 @@
+#
+#  Copyright 2008, Roger Brown
+#
+#  This file is part of Roger Brown's Toolkit.
+#
+#  This program is free software: you can redistribute it and/or modify it
+#  under the terms of the GNU Lesser General Public License as published by the
+#  Free Software Foundation, either version 3 of the License, or (at your
+#  option) any later version.
+# 
+#  This program is distributed in the hope that it will be useful, but WITHOUT
+#  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+#  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+#  more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>
+#
+#  $Id$
+
+include $(MAKEDEFS)
+
+TARGET=$(OUTDIR_BIN)/sombench$(EXESUFFIX)
+INCL=	-I. \
+		-I.. \
+		-I../../somidl/$(PLATFORM) \
+		-I../../somkpub/include	\
+		-I../../somtk/include \
+		$(STDINCL)
+OBJS=$(INTDIR)/sombench.o
+
+all: $(TARGET)
+
+clean:
+	$(CLEAN) $(OBJS) $(TARGET)
+
+$(INTDIR)/sombench.o: ../src/sombench.c
+	$(CC_EXE) $(STDOPT) $(INCL)  -c ../src/sombench.c -o $@
+
+$(TARGET): $(OBJS)
+	$(LINKAPP) $(LINKAPP_HEAD) $(OBJS) -o $@ \
+		`$(SHLB_REF) somd somd` \
+		`$(SHLB_REF) somu somu` \
+		`$(SHLB_REF) som som` \
+		$(UUIDLIBS) $(STDLIB) $(LINKAPP_TAIL)
+
+test:
+	$(EXEC_TEST) $(TARGET) -n 1000
+
+dist install:
@@ -255,6 +255,493 @@ RHBCDR_unmarshal_cleanup_begin(struct)
 
 RHBCDR_unmarshal_cleanup_end
 
+/* fixed size numbers go through the stream's array methods so that
+	a whole sequence is aligned, copied and byte swapped in one go */
+
+static void RHBCDR_read_numbers(
+				CORBA_DataInputStream SOMSTAR stream,
+				Environment *ev,
+				TCKind kind,
+				void *buffer,
+				unsigned long count)
+{
+	_IDL_SEQUENCE_octet seq;
+
+	seq._length=count;
+	seq._maximum=count;
+	seq._buffer=buffer;
+
+	switch (kind)
+	{
+	case tk_short:
+		CORBA_DataInputStream_read_short_array(stream,ev,(CORBA_ShortSeq *)(void *)&seq,0,count);
+		break;
+	case tk_ushort:
+		CORBA_DataInputStream_read_ushort_array(stream,ev,(CORBA_UShortSeq *)(void *)&seq,0,count);
+		break;
+	case tk_long:
+		CORBA_DataInputStream_read_long_array(stream,ev,(CORBA_LongSeq *)(void *)&seq,0,count);
+		break;
+	case tk_ulong:
+		CORBA_DataInputStream_read_ulong_array(stream,ev,(CORBA_ULongSeq *)(void *)&seq,0,count);
+		break;
+	case tk_float:
+		CORBA_DataInputStream_read_float_array(stream,ev,(CORBA_FloatSeq *)(void *)&seq,0,count);
+		break;
+	case tk_double:
+		CORBA_DataInputStream_read_double_array(stream,ev,(CORBA_DoubleSeq *)(void *)&seq,0,count);
+		break;
+	default:
+		break;
+	}
+}
+
+static void RHBCDR_write_numbers(
+				CORBA_DataOutputStream SOMSTAR stream,
+				Environment *ev,
+				TCKind kind,
+				void *buffer,
+				unsigned long count)
+{
+	_IDL_SEQUENCE_octet seq;
+
+	seq._length=count;
+	seq._maximum=count;
+	seq._buffer=buffer;
+
+	switch (kind)
+	{
+	case tk_short:
+		CORBA_DataOutputStream_write_short_array(stream,ev,(CORBA_ShortSeq *)(void *)&seq,0,count);
+		break;
+	case tk_ushort:
+		CORBA_DataOutputStream_write_ushort_array(stream,ev,(CORBA_UShortSeq *)(void *)&seq,0,count);
+		break;
+	case tk_long:
+		CORBA_DataOutputStream_write_long_array(stream,ev,(CORBA_LongSeq *)(void *)&seq,0,count);
+		break;
+	case tk_ulong:
+		CORBA_DataOutputStream_write_ulong_array(stream,ev,(CORBA_ULongSeq *)(void *)&seq,0,count);
+		break;
+	case tk_float:
+		CORBA_DataOutputStream_write_float_array(stream,ev,(CORBA_FloatSeq *)(void *)&seq,0,count);
+		break;
+	case tk_double:
+		CORBA_DataOutputStream_write_double_array(stream,ev,(CORBA_DoubleSeq *)(void *)&seq,0,count);
+		break;
+	default:
+		break;
+	}
+}
+
+/* structs and arrays made only of numbers, enums and strings are
+	compiled once into a flat list of operations with the member offsets
+	worked out, and runs of like members merged, the plan is cached
+	against the TypeCode so later values skip the TypeCode walk,
+	anything else gets an empty plan and is walked as before */
+
+#define RHBCDR_PLAN_MAX_OPS		64
+
+typedef struct RHBCDR_plan_op
+{
+	TCKind kind;
+	TypeCode type;
+	unsigned long offset;
+	unsigned long count;
+	unsigned long size;
+	unsigned long bound;
+} RHBCDR_plan_op;
+
+typedef struct RHBCDR_plan
+{
+	unsigned long count;
+	boolean strings;
+	RHBCDR_plan_op ops[1];
+} RHBCDR_plan;
+
+struct RHBCDR_plan_builder
+{
+	unsigned long count;
+	boolean strings;
+	RHBCDR_plan_op ops[RHBCDR_PLAN_MAX_OPS];
+};
+
+RHBCDR_unmarshal_data(plan)
+{
+	boolean cleanup;
+	SOMCDR_unmarshal_filter *filter;
+	RHBCDR_plan *plan;
+	octet *base;
+};
+
+static void SOMLINK RHBCDR_plan_free(void *pv)
+{
+	SOMFree(pv);
+}
+
+static boolean RHBCDR_plan_emit(
+				struct RHBCDR_plan_builder *b,
+				TCKind kind,
+				TypeCode type,
+				unsigned long offset,
+				unsigned long size,
+				unsigned long bound)
+{
+	RHBCDR_plan_op *op;
+
+	if (b->count)
+	{
+		op=b->ops+b->count-1;
+
+		if ((op->kind==kind) &&
+			(op->offset+(op->count*op->size)==offset) &&
+			(op->bound==bound) &&
+			((kind!=tk_enum)||(op->type==type)))
+		{
+			op->count++;
+
+			return 1;
+		}
+	}
+
+	if (b->count==RHBCDR_PLAN_MAX_OPS) return 0;
+
+	op=b->ops+b->count++;
+
+	op->kind=kind;
+	op->type=type;
+	op->offset=offset;
+	op->count=1;
+	op->size=size;
+	op->bound=bound;
+
+	if (kind==tk_string) b->strings=1;
+
+	return 1;
+}
+
+static boolean RHBCDR_plan_build(
+				struct RHBCDR_plan_builder *b,
+				Environment *ev,
+				TypeCode type,
+				unsigned long offset)
+{
+	TCKind kind=TypeCode_kind(type,ev);
+
+	if (ev->_major) return 0;
+
+	switch (kind)
+	{
+	case tk_short:
+	case tk_ushort:
+	case tk_long:
+	case tk_ulong:
+	case tk_float:
+	case tk_double:
+	case tk_char:
+	case tk_octet:
+	case tk_boolean:
+	case tk_enum:
+		return RHBCDR_plan_emit(b,kind,type,offset,TypeCode_size(type,ev),0);
+	case tk_string:
+		{
+			any a=TypeCode_parameter(type,ev,0);
+			unsigned long bound=RHBCDR_cast_any_to_ulong(ev,&a);
+
+			return RHBCDR_plan_emit(b,kind,type,offset,sizeof(corbastring),bound);
+		}
+	case tk_struct:
+		{
+			long params=TypeCode_param_count(type,ev);
+			long i=2;
+			unsigned long struct_offset=0;
+
+			while ((i < params) && !ev->_major)
+			{
+				any a=TypeCode_parameter(type,ev,i);
+				TypeCode t=RHBCDR_cast_any_to_TypeCode(ev,&a);
+				short align=TypeCode_alignment(t,ev);
+
+				RHBCDR_align_pos(&struct_offset,align);
+
+				if (!RHBCDR_plan_build(b,ev,t,offset+struct_offset)) return 0;
+
+				struct_offset+=TypeCode_size(t,ev);
+
+				i+=2;
+			}
+		}
+		return (boolean)!ev->_major;
+	case tk_array:
+		{
+			any a=TypeCode_parameter(type,ev,0);
+			TypeCode t=RHBCDR_cast_any_to_TypeCode(ev,&a);
+			unsigned long size=TypeCode_size(t,ev);
+			long n;
+
+			a=TypeCode_parameter(type,ev,1);
+			n=RHBCDR_cast_any_to_long(ev,&a);
+
+			while ((n-- > 0) && !ev->_major)
+			{
+				if (!RHBCDR_plan_build(b,ev,t,offset)) return 0;
+
+				offset+=size;
+			}
+		}
+		return (boolean)!ev->_major;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static RHBCDR_plan *RHBCDR_get_plan(Environment *ev,TypeCode type)
+{
+	RHBCDR_plan *plan=tcGetPlan(type,ev,RHBCDR_plan_free);
+
+	if (!plan)
+	{
+		struct RHBCDR_plan_builder *b=SOMMalloc(sizeof(*b));
+
+		if (!b) return NULL;
+
+		b->count=0;
+		b->strings=0;
+
+		if (!RHBCDR_plan_build(b,ev,type,0))
+		{
+			b->count=0;
+		}
+
+		if (ev->_major)
+		{
+			SOMFree(b);
+
+			return NULL;
+		}
+
+		plan=SOMMalloc(sizeof(*plan)+(b->count*sizeof(plan->ops[0])));
+
+		if (plan)
+		{
+			plan->count=b->count;
+			plan->strings=b->strings;
+
+			if (b->count)
+			{
+				memcpy(plan->ops,b->ops,b->count*sizeof(b->ops[0]));
+			}
+
+			plan=tcSetPlan(type,ev,RHBCDR_plan_free,plan);
+		}
+
+		SOMFree(b);
+	}
+
+	return (plan && plan->count) ? plan : NULL;
+}
+
+static void RHBCDR_plan_marshal(
+				RHBCDR_plan *plan,
+				Environment *ev,
+				octet *base,
+				CORBA_DataOutputStream SOMSTAR stream)
+{
+	RHBCDR_plan_op *op=plan->ops;
+	unsigned long n=plan->count;
+
+	while (n-- && !ev->_major)
+	{
+		octet *p=base+op->offset;
+		unsigned long i=op->count;
+
+		switch (op->kind)
+		{
+		case tk_char:
+		case tk_octet:
+		case tk_boolean:
+			{
+				_IDL_SEQUENCE_octet seq;
+
+				seq._length=i;
+				seq._maximum=i;
+				seq._buffer=p;
+
+				CORBA_DataOutputStream_write_octet_array(stream,ev,&seq,0,i);
+			}
+			break;
+		case tk_enum:
+			{
+				CORBA_Enum *ep=(void *)p;
+
+				while (i-- && !ev->_major)
+				{
+					CORBA_Enum l=RHBCDR_IDLenumToGIOPenum(*ep++,ev,op->type);
+
+					if (!ev->_major)
+					{
+						CORBA_DataOutputStream_write_ulong(stream,ev,l);
+					}
+				}
+			}
+			break;
+		case tk_string:
+			{
+				corbastring *sp=(void *)p;
+
+				while (i-- && !ev->_major)
+				{
+					CORBA_DataOutputStream_write_string(stream,ev,*sp++);
+				}
+			}
+			break;
+		default:
+			RHBCDR_write_numbers(stream,ev,op->kind,p,i);
+			break;
+		}
+
+		op++;
+	}
+}
+
+static void RHBCDR_plan_strings(RHBCDR_plan *plan,octet *base,boolean release)
+{
+	RHBCDR_plan_op *op=plan->ops;
+	unsigned long n=plan->count;
+
+	while (n--)
+	{
+		if (op->kind==tk_string)
+		{
+			corbastring *sp=(void *)(base+op->offset);
+			unsigned long i=op->count;
+
+			while (i--)
+			{
+				corbastring s=*sp;
+
+				*sp++=NULL;
+
+				if (release && s) SOMFree(s);
+			}
+		}
+
+		op++;
+	}
+}
+
+RHBCDR_unmarshal_cleanup_begin(plan)
+
+	if (data->cleanup)
+	{
+		RHBCDR_plan_strings(data->plan,data->base,1);
+	}
+
+RHBCDR_unmarshal_cleanup_end
+
+static void RHBCDR_plan_read(
+				RHBCDR_plan *plan,
+				Environment *ev,
+				octet *base,
+				CORBA_DataInputStream SOMSTAR stream)
+{
+	RHBCDR_plan_op *op=plan->ops;
+	unsigned long n=plan->count;
+
+	while (n-- && !ev->_major)
+	{
+		octet *p=base+op->offset;
+		unsigned long i=op->count;
+
+		switch (op->kind)
+		{
+		case tk_char:
+		case tk_octet:
+		case tk_boolean:
+			{
+				_IDL_SEQUENCE_octet seq;
+
+				seq._length=i;
+				seq._maximum=i;
+				seq._buffer=p;
+
+				CORBA_DataInputStream_read_octet_array(stream,ev,&seq,0,i);
+			}
+			break;
+		case tk_enum:
+			{
+				CORBA_Enum *ep=(void *)p;
+
+				while (i-- && !ev->_major)
+				{
+					GIOP_enum l=CORBA_DataInputStream_read_ulong(stream,ev);
+
+					if (ev->_major) break;
+
+					*ep++=RHBCDR_GIOPenumToIDLenum(l,ev,op->type);
+				}
+			}
+			break;
+		case tk_string:
+			{
+				corbastring *sp=(void *)p;
+
+				while (i-- && !ev->_major)
+				{
+					*sp=CORBA_DataInputStream_read_string(stream,ev);
+
+					if (*sp && op->bound && !ev->_major)
+					{
+						if (strlen(*sp) > op->bound)
+						{
+							RHBOPT_throw_StExcep(ev,MARSHAL,Boundary,MAYBE);
+						}
+					}
+
+					sp++;
+				}
+			}
+			break;
+		default:
+			RHBCDR_read_numbers(stream,ev,op->kind,p,i);
+			break;
+		}
+
+		op++;
+	}
+}
+
+static void RHBCDR_plan_unmarshal(
+				SOMCDR_unmarshal_filter *filter,
+				RHBCDR_plan *plan,
+				Environment *ev,
+				octet *base,
+				CORBA_DataInputStream SOMSTAR stream)
+{
+	if (plan->strings)
+	{
+		RHBCDR_unmarshal_data(plan) data={1,NULL,NULL,NULL};
+
+		data.plan=plan;
+		data.base=base;
+
+		/* so a failure part way through knows which strings to free */
+		RHBCDR_plan_strings(plan,base,0);
+
+		RHBCDR_unmarshal_push(plan);
+
+		RHBCDR_plan_read(plan,ev,base,stream);
+
+		RHBCDR_unmarshal_pop();
+	}
+	else
+	{
+		RHBCDR_plan_read(plan,ev,base,stream);
+	}
+}
+
 SOMEXTERN void SOMLINK RHBCDR_unmarshal(
 				SOMCDR_unmarshal_filter *filter,
 				Environment *ev,
@@ -283,6 +770,27 @@ SOMEXTERN void SOMLINK RHBCDR_unmarshal(
 
 	if (ev->_major) return;
 
+	switch (TypeCode_kind(type,ev))
+	{
+	case tk_struct:
+	case tk_array:
+		{
+			RHBCDR_plan *plan=RHBCDR_get_plan(ev,type);
+
+			if (plan)
+			{
+				RHBCDR_plan_unmarshal(filter,plan,ev,value,stream);
+
+				return;
+			}
+
+			if (ev->_major) return;
+		}
+		break;
+	default:
+		break;
+	}
+
 	switch (TypeCode_kind(type,ev))
 	{
 	case tk_objref:
@@ -383,6 +891,27 @@ SOMEXTERN void SOMLINK RHBCDR_unmarshal(
 						RHBOPT_throw_StExcep(ev,MARSHAL,NoMemory,MAYBE);
 					}
 
+					break;
+				case tk_short:
+				case tk_ushort:
+				case tk_long:
+				case tk_ulong:
+				case tk_float:
+				case tk_double:
+					data.seqPtr->_buffer=SOMMalloc(data.element_size * len);
+					data.seqPtr->_length=len;
+
+					if (data.seqPtr->_buffer)
+					{
+						RHBCDR_read_numbers(stream,ev,
+								TypeCode_kind(data.element_type,ev),
+								data.seqPtr->_buffer,len);
+					}
+					else
+					{
+						RHBOPT_throw_StExcep(ev,MARSHAL,NoMemory,MAYBE);
+					}
+
 					break;
 				default:
 					data.seqPtr->_buffer=SOMMalloc(data.element_size * len);
@@ -496,6 +1025,16 @@ SOMEXTERN void SOMLINK RHBCDR_unmarshal(
 									l);
 					}
 					break;
+				case tk_short:
+				case tk_ushort:
+				case tk_long:
+				case tk_ulong:
+				case tk_float:
+				case tk_double:
+					RHBCDR_read_numbers(stream,ev,
+							TypeCode_kind(data.element_type,ev),
+							value,l);
+					break;
 				default:
 					{
 						octet * RHBOPT_volatile op=data.array_base;
@@ -772,6 +1311,27 @@ SOMEXTERN void SOMLINK RHBCDR_marshal(
 
 /*	SOMCDR_CDROutputStream__set_marshal_filter(stream,ev,filter);*/
 
+	switch (TypeCode_kind(type,ev))
+	{
+	case tk_struct:
+	case tk_array:
+		{
+			RHBCDR_plan *plan=RHBCDR_get_plan(ev,type);
+
+			if (plan)
+			{
+				RHBCDR_plan_marshal(plan,ev,value,stream);
+
+				return;
+			}
+
+			if (ev->_major) return;
+		}
+		break;
+	default:
+		break;
+	}
+
 	switch(TypeCode_kind(type,ev))
 	{
 	case tk_void:
@@ -887,6 +1447,16 @@ SOMEXTERN void SOMLINK RHBCDR_marshal(
 					CORBA_DataOutputStream_write_octet_array(stream,ev,&seq,0,element_count);
 				}
 				break;
+			case tk_short:
+			case tk_ushort:
+			case tk_long:
+			case tk_ulong:
+			case tk_float:
+			case tk_double:
+				RHBCDR_write_numbers(stream,ev,
+						TypeCode_kind(element_type,ev),
+						value,element_count);
+				break;
 			default:
 				while (element_count-- && !ev->_major)
 				{
@@ -927,6 +1497,16 @@ SOMEXTERN void SOMLINK RHBCDR_marshal(
 						CORBA_DataOutputStream_write_octet_array(stream,ev,&seq,0,seq._length);
 					}
 					break;
+				case tk_short:
+				case tk_ushort:
+				case tk_long:
+				case tk_ulong:
+				case tk_float:
+				case tk_double:
+					RHBCDR_write_numbers(stream,ev,
+							TypeCode_kind(sequence_of,ev),
+							seq._buffer,seq._length);
+					break;
 				default:
 					while (ul-- && !ev->_major)
 					{
@@ -90,6 +90,19 @@ static void stream_write_align(SOMCDR_marshalling_stream *st,Environment *ev,sho
 	}
 }
 
+/* primitive arrays are contiguous and each element is aligned
+	to its own size, so after aligning the first they go as one block,
+	output is always in native byte order */
+
+static void stream_write_array(SOMCDR_marshalling_stream *st,Environment *ev,void *pv,unsigned long count,short size)
+{
+	if (count)
+	{
+		stream_write_align(st,ev,size);
+		stream_write(st,ev,pv,count*size);
+	}
+}
+
 static void stream_write_octet(SOMCDR_marshalling_stream *st,Environment *ev,GIOP_octet value)
 {
 	stream_write(st,ev,&value,sizeof(value));
@@ -969,7 +982,17 @@ SOM_Scope void SOMLINK cdrostr_write_double_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDROutputStreamData *somThis=SOMCDR_CDROutputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length)
+
+	if (sizeof(seq->_buffer[0])==8)
+	{
+		stream_write_array(&somThis->data,ev,seq->_buffer+offset,length,8);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		CORBA_DataOutputStream_write_double(somSelf,ev,seq->_buffer[offset]);
@@ -1152,7 +1175,17 @@ SOM_Scope void SOMLINK cdrostr_write_float_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDROutputStreamData *somThis=SOMCDR_CDROutputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length)
+
+	if (sizeof(seq->_buffer[0])==4)
+	{
+		stream_write_array(&somThis->data,ev,seq->_buffer+offset,length,4);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		CORBA_DataOutputStream_write_float(somSelf,ev,seq->_buffer[offset]);
@@ -1167,7 +1200,17 @@ SOM_Scope void SOMLINK cdrostr_write_ushort_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDROutputStreamData *somThis=SOMCDR_CDROutputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length)
+
+	if (sizeof(seq->_buffer[0])==2)
+	{
+		stream_write_array(&somThis->data,ev,seq->_buffer+offset,length,2);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		CORBA_DataOutputStream_write_ushort(somSelf,ev,seq->_buffer[offset]);
@@ -1182,7 +1225,17 @@ SOM_Scope void SOMLINK cdrostr_write_short_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDROutputStreamData *somThis=SOMCDR_CDROutputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length)
+
+	if (sizeof(seq->_buffer[0])==2)
+	{
+		stream_write_array(&somThis->data,ev,seq->_buffer+offset,length,2);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		CORBA_DataOutputStream_write_short(somSelf,ev,seq->_buffer[offset]);
@@ -1198,7 +1251,17 @@ SOM_Scope void SOMLINK cdrostr_write_ulong_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDROutputStreamData *somThis=SOMCDR_CDROutputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length)
+
+	if (sizeof(seq->_buffer[0])==4)
+	{
+		stream_write_array(&somThis->data,ev,seq->_buffer+offset,length,4);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		CORBA_DataOutputStream_write_ulong(somSelf,ev,seq->_buffer[offset]);
@@ -1213,7 +1276,17 @@ SOM_Scope void SOMLINK cdrostr_write_long_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDROutputStreamData *somThis=SOMCDR_CDROutputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length)
+
+	if (sizeof(seq->_buffer[0])==4)
+	{
+		stream_write_array(&somThis->data,ev,seq->_buffer+offset,length,4);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		CORBA_DataOutputStream_write_long(somSelf,ev,seq->_buffer[offset]);
@@ -1351,6 +1424,56 @@ static void stream_read_align(SOMCDR_CDRInputStream_StreamState *st,Environment
 	}
 }
 
+static void stream_swap_array(octet *p,unsigned long count,short size)
+{
+	octet c;
+
+	switch (size)
+	{
+	case 2:
+		while (count--)
+		{
+			c=p[0]; p[0]=p[1]; p[1]=c;
+			p+=2;
+		}
+		break;
+	case 4:
+		while (count--)
+		{
+			c=p[0]; p[0]=p[3]; p[3]=c;
+			c=p[1]; p[1]=p[2]; p[2]=c;
+			p+=4;
+		}
+		break;
+	case 8:
+		while (count--)
+		{
+			c=p[0]; p[0]=p[7]; p[7]=c;
+			c=p[1]; p[1]=p[6]; p[6]=c;
+			c=p[2]; p[2]=p[5]; p[5]=c;
+			c=p[3]; p[3]=p[4]; p[4]=c;
+			p+=8;
+		}
+		break;
+	}
+}
+
+/* read as one block then swap in place if the sender's order differs */
+
+static void stream_read_array(SOMCDR_CDRInputStream_StreamState *st,Environment *ev,void *pv,unsigned long count,short size)
+{
+	if (count && !ev->_major)
+	{
+		stream_read_align(st,ev,size);
+		stream_read(st,ev,pv,count*size);
+
+		if (st->swap && !ev->_major)
+		{
+			stream_swap_array(pv,count,size);
+		}
+	}
+}
+
 static GIOP_octet stream_read_octet(SOMCDR_CDRInputStream_StreamState *st,Environment *ev)
 {
 	GIOP_octet o=0;
@@ -2493,7 +2616,17 @@ SOM_Scope void SOMLINK cdristr_read_float_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDRInputStreamData *somThis=SOMCDR_CDRInputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length);
+
+	if (sizeof(seq->_buffer[0])==4)
+	{
+		stream_read_array(&somThis->state,ev,seq->_buffer+offset,length,4);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		seq->_buffer[offset++]=CORBA_DataInputStream_read_float(somSelf,ev);
@@ -2507,7 +2640,17 @@ SOM_Scope void SOMLINK cdristr_read_double_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDRInputStreamData *somThis=SOMCDR_CDRInputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length);
+
+	if (sizeof(seq->_buffer[0])==8)
+	{
+		stream_read_array(&somThis->state,ev,seq->_buffer+offset,length,8);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		seq->_buffer[offset++]=CORBA_DataInputStream_read_double(somSelf,ev);
@@ -2559,7 +2702,17 @@ SOM_Scope void SOMLINK cdristr_read_ushort_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDRInputStreamData *somThis=SOMCDR_CDRInputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length);
+
+	if (sizeof(seq->_buffer[0])==2)
+	{
+		stream_read_array(&somThis->state,ev,seq->_buffer+offset,length,2);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		seq->_buffer[offset++]=CORBA_DataInputStream_read_ushort(somSelf,ev);
@@ -2573,7 +2726,17 @@ SOM_Scope void SOMLINK cdristr_read_short_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDRInputStreamData *somThis=SOMCDR_CDRInputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length);
+
+	if (sizeof(seq->_buffer[0])==2)
+	{
+		stream_read_array(&somThis->state,ev,seq->_buffer+offset,length,2);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		seq->_buffer[offset++]=CORBA_DataInputStream_read_short(somSelf,ev);
@@ -2587,7 +2750,17 @@ SOM_Scope void SOMLINK cdristr_read_long_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDRInputStreamData *somThis=SOMCDR_CDRInputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length);
+
+	if (sizeof(seq->_buffer[0])==4)
+	{
+		stream_read_array(&somThis->state,ev,seq->_buffer+offset,length,4);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		seq->_buffer[offset++]=CORBA_DataInputStream_read_long(somSelf,ev);
@@ -2601,7 +2774,17 @@ SOM_Scope void SOMLINK cdristr_read_ulong_array(
 	unsigned long offset,
 	unsigned long length)
 {
+	SOMCDR_CDRInputStreamData *somThis=SOMCDR_CDRInputStreamGetData(somSelf);
+
 	ARRAY_BOUNDS_CHECK(ev,seq,offset,length);
+
+	if (sizeof(seq->_buffer[0])==4)
+	{
+		stream_read_array(&somThis->state,ev,seq->_buffer+offset,length,4);
+
+		return;
+	}
+
 	while (length-- && !ev->_major)
 	{
 		seq->_buffer[offset++]=CORBA_DataInputStream_read_ulong(somSelf,ev);
@@ -125,7 +125,17 @@ struct RHBORB_thread_task
 	RHBORB_ThreadFunction start;
 	RHBORB_ThreadFailFunction failed;
 	void *param;
+	int lane;					/* RHBORB_TASK_* */
+	unsigned long queued;		/* ms clock when queued */
 };
+
+/* lanes in the order queued tasks are taken, only system tasks
+	are given a thread regardless of SOMDMAXTHREADS as they
+	run for the life of a socket or resolver */
+#define RHBORB_TASK_SYSTEM		0
+#define RHBORB_TASK_LOCATE		1
+#define RHBORB_TASK_INVOKE		2
+#define RHBORB_TASK_LANES		3
 #endif
 
 #define USE_RHBSOCKET
@@ -470,12 +480,15 @@ SOMEXTERN RHBORB *SOMLINK RHBORBNew(struct SOMD_Globals *globals,Environment *ev
 #ifdef USE_THREADS
 	#define RHBORB_wait_server_state_changed(a)				(a)->lpVtbl->wait_server_state_changed(a)
 	#define RHBORB_StartThreadTask(a,b)						(a)->lpVtbl->StartThreadTask(a,b)
+	SOMEXTERN void RHBORB_get_task_stats(RHBORB *,SOMD_TaskStats *);
 #else
 	SOMEXTERN RHBServerRequest * RHBORB_pop_first_queued_request(
 			RHBORB *somThis);
 	SOMEXTERN void RHBORB_ProcessEvents(RHBORB *somThis,Environment *ev);
 #endif
 
+SOMEXTERN boolean RHBORB_park_impl(RHBORB *,RHBGIOPRequestStream *);
+
 #ifdef USE_THREADS
 	extern struct rhbmutex_t somd_mutex;
 
@@ -572,6 +585,7 @@ struct RHBORB
 	Principal SOMSTAR principal;
 
 	RHBSOMUT_KeyDataSet contained_by_abs;
+	struct RHBORB_oidl_cache *oidl_cache;
 	rhbatomic_t lUsage;
 	RHBEventManager events;
 
@@ -582,6 +596,12 @@ struct RHBORB
 
 	RHBGIOPRequestStream *impls;
 
+	struct
+	{
+		RHBGIOPRequestStream *list;
+		long timeout;				/* SOMDIDLETIMEOUT seconds, zero to not pool */
+	} idle_impls;
+
 	RHBORB_request_pool_t pool;
 
 	struct
@@ -622,7 +642,14 @@ struct RHBORB
 	struct
 	{
 		boolean running;
-		struct RHBORB_thread_task *tasks;
+		struct
+		{
+			struct RHBORB_thread_task *head,*tail;
+		} lanes[RHBORB_TASK_LANES];
+		long max_workers;			/* SOMDMAXTHREADS, zero for no limit */
+		long workers;				/* threads alive */
+		long system;				/* of those, running system tasks */
+		SOMD_TaskStats stats;
 #ifdef USE_PTHREADS
 		pthread_cond_t pEvent;
 		pthread_t pThread;
@@ -638,11 +665,34 @@ struct RHBORB
 #endif
 };
 
+/* GIOP 1.1 added Fragment after MessageError, and bit 1 of the
+	header flags to say more fragments follow */
+#ifndef GIOP_Fragment
+	#define GIOP_Fragment				((GIOP_MsgType)(GIOP_MessageError+1))
+#endif
+#define RHBGIOP_FLAG_FRAGMENTS		2
+
+/* a message being put back together from fragments, keyed by
+	request_id for GIOP 1.2, only one can be open for GIOP 1.1 */
+typedef struct RHBGIOPFragment
+{
+	struct RHBGIOPFragment *next;
+	unsigned long request_id;
+	GIOP_MessageHeader header;
+	boolean doSwap;
+	_IDL_SEQUENCE_octet data;
+} RHBGIOPFragment;
+
+/* a queued GIOP message, the header is held inline and
+	the marshalled body is sent from its own buffer so it
+	is not copied a second time */
 typedef struct RHBSendData
 {
 	struct RHBSendData *next;
-	octet *seekPtr;
+	unsigned long offset;		/* bytes already sent */
 	unsigned long toGo;
+	unsigned long headLength;
+	_IDL_SEQUENCE_octet body;
 	octet _buffer[1];
 } RHBSendData;
 
@@ -797,6 +847,7 @@ struct RHBGIOPRequestStream
 /*	any receive_header;*/
 	GIOP_MessageHeader GIOP_header;
 	boolean receive_doSwap;
+	RHBGIOPFragment *fragments;
 	RHBServerRequest *server_requests;
 #ifdef USE_SELECT
 	RHBServerRequest *queued_request_list;
@@ -832,6 +883,14 @@ struct RHBGIOPRequestStream
 		boolean transmitting;
 	} connection;
 
+	struct
+	{
+		boolean parked;				/* held by the ORB with no other user */
+		boolean retired;			/* timed out, do not park again */
+		time_t since;
+		RHBGIOPRequestStream *next;
+	} idle;
+
 	struct
 	{
 		unsigned long nextSequence;
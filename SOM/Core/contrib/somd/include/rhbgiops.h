@@ -45,6 +45,15 @@ typedef long RHBSocketLength;		/* for SOM Sockets */
 typedef struct sockaddr  RHBSocketAddress;
 struct RHBGIOPRequestStream;
 
+/* one piece of a gathered send */
+typedef struct RHBSocketBuffer
+{
+	const void *data;
+	int len;
+} RHBSocketBuffer;
+
+#define RHBSOCKET_MAX_BUFFERS	16
+
 struct RHBSocketSinkJumpTable
 {
 	int (RHBLINK * QueryInterface)(RHBSocketSink *,void *,void **);
@@ -76,6 +85,7 @@ struct RHBSocketJumpTable
 	boolean (RHBLINK *IsConnected)(struct RHBSocket * sock,RHBSocketError *);
 	int (RHBLINK *SendData)(struct RHBSocket * sock,RHBSocketError *,const void *data,int len);
 	int (RHBLINK *RecvData)(struct RHBSocket * sock,RHBSocketError *,void *data,int len);
+	int (RHBLINK *SendDataV)(struct RHBSocket * sock,RHBSocketError *,const RHBSocketBuffer *bufs,int count);
 	struct RHBSocket * (RHBLINK *Accept)(struct RHBSocket * sock,RHBSocketError *,
 				RHBSocketAddress *,RHBSocketLength *len,
 				RHBSocketAddress *,RHBSocketLength *);
@@ -96,6 +106,7 @@ SOM_Scope void RHBLINK x##_Shutdown(RHBSocketRef sock,RHBSocketError *,int); \
 SOM_Scope boolean RHBLINK x##_IsConnected(RHBSocketRef sock,RHBSocketError *); \
 SOM_Scope int RHBLINK x##_SendData(RHBSocketRef sock,RHBSocketError *,const void *data,int len); \
 SOM_Scope int RHBLINK x##_RecvData(RHBSocketRef sock,RHBSocketError *,void *data,int len); \
+SOM_Scope int RHBLINK x##_SendDataV(RHBSocketRef sock,RHBSocketError *,const RHBSocketBuffer *bufs,int count); \
 SOM_Scope RHBSocketRef RHBLINK x##_Accept(RHBSocketRef sock,RHBSocketError *,RHBSocketAddress *,RHBSocketLength *len,RHBSocketAddress *,RHBSocketLength *); \
 SOM_Scope void RHBLINK x##_Close(RHBSocketRef sock); \
 SOM_Scope void RHBLINK x##_EnableWrites(RHBSocketRef sock,boolean how); \
@@ -105,7 +116,7 @@ SOM_Scope void RHBLINK x##_dump(RHBSocketRef sock); \
 static struct RHBSocketJumpTable x##_JumpTable={ \
 x##_QueryInterface,x##_AddRef,x##_Release,  \
 	x##_StartConnect,x##_StartListen,x##_Shutdown,x##_IsConnected,  \
-	x##_SendData,x##_RecvData,x##_Accept,x##_Close, \
+	x##_SendData,x##_RecvData,x##_SendDataV,x##_Accept,x##_Close, \
 	x##_EnableWrites,x##_IsNonBlocking,x##_IsOneShot,x##_dump \
 			};
 
@@ -123,6 +134,7 @@ struct RHBSocket
 #define RHBSocket_IsConnected(x)		x->vtbl->IsConnected(x)
 #define RHBSocket_SendData(x,a,b,c)     x->vtbl->SendData(x,a,b,c)
 #define RHBSocket_RecvData(x,a,b,c)     x->vtbl->RecvData(x,a,b,c)
+#define RHBSocket_SendDataV(x,a,b,c)    x->vtbl->SendDataV(x,a,b,c)
 #define RHBSocket_Accept(x,a,b,c,d,e)   x->vtbl->Accept(x,a,b,c,d,e)
 #define RHBSocket_Close(x)				x->vtbl->Close(x)
 #define RHBSocket_EnableWrites(x,y)	    x->vtbl->EnableWrites(x,y)
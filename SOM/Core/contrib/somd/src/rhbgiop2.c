@@ -245,6 +245,7 @@ RHBLocateRequest * RHBLocateRequestNew(
 	somThis->task.start=rhbLocateRequest_exec_mt,
 	somThis->task.failed=rhbLocateRequest_exec_mt_failed;
 	somThis->task.param=somThis;
+	somThis->task.lane=RHBORB_TASK_LOCATE;
 #else
 	somThis->exec_st=rhbLocateRequest_exec_st;
 #endif
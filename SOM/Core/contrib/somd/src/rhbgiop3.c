@@ -242,12 +242,164 @@ static void RHBORB_join(RHBORB *somThis)
 	}
 }
 
+static unsigned long rhbORB_task_clock(void)
+{
+#ifdef _WIN32
+	return GetTickCount();
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv,NULL);
+
+	return (unsigned long)((tv.tv_sec*1000)+(tv.tv_usec/1000));
+#endif
+}
+
+/* queued tasks are kept per lane, a lane is first in first out
+	except for a task that could not be started going back in front */
+
+static int rhbORB_task_lane(struct RHBORB_thread_task *task)
+{
+	if ((task->lane < 0) || (task->lane >= RHBORB_TASK_LANES))
+	{
+		return RHBORB_TASK_INVOKE;
+	}
+
+	return task->lane;
+}
+
+static void RHBORB_push_task(RHBORB *somThis,struct RHBORB_thread_task *task,boolean front)
+{
+	int lane=rhbORB_task_lane(task);
+	unsigned long depth=0;
+	int i;
+
+	RHBSOMD_must_be_guarded
+
+	if (front)
+	{
+		task->next=somThis->child.lanes[lane].head;
+		somThis->child.lanes[lane].head=task;
+
+		if (!somThis->child.lanes[lane].tail)
+		{
+			somThis->child.lanes[lane].tail=task;
+		}
+	}
+	else
+	{
+		task->next=NULL;
+
+		if (somThis->child.lanes[lane].tail)
+		{
+			somThis->child.lanes[lane].tail->next=task;
+		}
+		else
+		{
+			somThis->child.lanes[lane].head=task;
+		}
+
+		somThis->child.lanes[lane].tail=task;
+	}
+
+	somThis->child.stats.queued[lane]++;
+
+	for (i=0; i < RHBORB_TASK_LANES; i++)
+	{
+		depth+=somThis->child.stats.queued[i];
+	}
+
+	if (depth > somThis->child.stats.max_queued)
+	{
+		somThis->child.stats.max_queued=depth;
+	}
+}
+
+static boolean RHBORB_remove_task(RHBORB *somThis,struct RHBORB_thread_task *task)
+{
+	int lane=rhbORB_task_lane(task);
+	struct RHBORB_thread_task *p=somThis->child.lanes[lane].head,*q=NULL;
+
+	while (p)
+	{
+		if (p==task)
+		{
+			if (q)
+			{
+				q->next=p->next;
+			}
+			else
+			{
+				somThis->child.lanes[lane].head=p->next;
+			}
+
+			if (somThis->child.lanes[lane].tail==p)
+			{
+				somThis->child.lanes[lane].tail=q;
+			}
+
+			p->next=NULL;
+
+			somThis->child.stats.queued[lane]--;
+
+			return 1;
+		}
+
+		q=p;
+		p=p->next;
+	}
+
+	return 0;
+}
+
+static boolean RHBORB_tasks_pending(RHBORB *somThis)
+{
+	int i;
+
+	for (i=0; i < RHBORB_TASK_LANES; i++)
+	{
+		if (somThis->child.lanes[i].head) return 1;
+	}
+
+	return 0;
+}
+
+/* could a new thread be made for a task in this lane */
+static boolean RHBORB_worker_allowed(RHBORB *somThis,int lane)
+{
+	if (lane==RHBORB_TASK_SYSTEM) return 1;
+
+	if (!somThis->child.max_workers) return 1;
+
+	return (boolean)((somThis->child.workers-somThis->child.system) < somThis->child.max_workers);
+}
+
+SOMEXTERN void RHBORB_get_task_stats(RHBORB *somThis,SOMD_TaskStats *stats)
+{
+	RHBORB_guard(somThis)
+
+	*stats=somThis->child.stats;
+	stats->threads=somThis->child.workers;
+
+	RHBORB_unguard(somThis)
+}
+
 static struct RHBORB_thread_task *RHBORB_pop_task(RHBORB *somThis)
 {
-	if (somThis->child.tasks)
+	struct RHBORB_thread_task *task=NULL;
+	int i;
+
+	for (i=0; i < RHBORB_TASK_LANES; i++)
 	{
-		struct RHBORB_thread_task *task=somThis->child.tasks;
-		somThis->child.tasks=task->next;
+		task=somThis->child.lanes[i].head;
+
+		if (task) break;
+	}
+
+	if (task)
+	{
+		RHBORB_remove_task(somThis,task);
+
 		if (somThis->child.killer)
 		{
 #ifdef USE_PTHREADS
@@ -277,7 +429,7 @@ static void RHBORB_CloseThreads(RHBORB *somThis)
 #endif
 
 	while (somThis->threads ||
-			somThis->child.tasks ||
+			RHBORB_tasks_pending(somThis) ||
 			killer.pending)
 	{
 		RHBORB_ThreadTask *t=somThis->threads;
@@ -311,7 +463,7 @@ static void RHBORB_CloseThreads(RHBORB *somThis)
 			t=n;
 		}
 
-		if (somThis->child.tasks)
+		if (RHBORB_tasks_pending(somThis))
 		{
 #ifdef USE_PTHREADS
 			pthread_cond_signal(&somThis->child.pEvent);
@@ -323,7 +475,7 @@ static void RHBORB_CloseThreads(RHBORB *somThis)
 #endif
 		}
 
-		if (killer.pending || somThis->child.tasks || somThis->threads)
+		if (killer.pending || RHBORB_tasks_pending(somThis) || somThis->threads)
 		{
 			RHBOPT_ASSERT(!somThis->child.killer)
 
@@ -382,6 +534,8 @@ RHBOPT_cleanup_begin(RHBORB_ThreadTaskCleanup,pv)
 		data->guarded=1;
 	}
 
+	orb->child.workers--;
+
 	if (thread_list_remove(somThis,&(somThis->orb_ptr->threads)))
 	{
 		RHBOPT_ASSERT(!somThis->killer)
@@ -496,8 +650,22 @@ RHBOPT_cleanup_end
 	while (somThis->task)
 	{
 		struct RHBORB_thread_task task;
+		unsigned long started;
 		task=somThis->task[0];
 
+		started=rhbORB_task_clock();
+
+		somThis->orb_ptr->child.stats.busy++;
+
+		if (task.lane==RHBORB_TASK_SYSTEM)
+		{
+			somThis->orb_ptr->child.system++;
+		}
+		else
+		{
+			somThis->orb_ptr->child.stats.wait_ms+=(started-task.queued);
+		}
+
 		data.guarded=0;
 
 		RHBOPT_ASSERT(!somThis->server_request);
@@ -523,6 +691,18 @@ RHBOPT_cleanup_end
 
 		data.guarded=1;
 
+		somThis->orb_ptr->child.stats.busy--;
+
+		if (task.lane==RHBORB_TASK_SYSTEM)
+		{
+			somThis->orb_ptr->child.system--;
+		}
+		else
+		{
+			somThis->orb_ptr->child.stats.service_ms+=(rhbORB_task_clock()-started);
+			somThis->orb_ptr->child.stats.completed++;
+		}
+
 		somThis->task=RHBORB_pop_task(somThis->orb_ptr);
 
 		if (!somThis->task)
@@ -603,7 +783,7 @@ static boolean RHBORB_begin_task(RHBORB *somThis,
 		{
 			task=NULL;
 		}
-		else
+		else if (RHBORB_worker_allowed(somThis,rhbORB_task_lane(task)))
 		{
 			RHBORB_ThreadTask *t=SOMMalloc(sizeof(*t));
 
@@ -649,6 +829,7 @@ static boolean RHBORB_begin_task(RHBORB *somThis,
 			{
 				t->next=somThis->threads;
 				somThis->threads=t;
+				somThis->child.workers++;
 				task=NULL;
 			}
 			else
@@ -659,8 +840,7 @@ static boolean RHBORB_begin_task(RHBORB *somThis,
 
 		if (task)
 		{
-			task->next=somThis->child.tasks;
-			somThis->child.tasks=task;
+			RHBORB_push_task(somThis,task,1);
 		}
 	}
 
@@ -719,6 +899,14 @@ rhborb_child(void *pv)
 			{
 				if (!RHBORB_begin_task(somThis,task))
 				{
+					/* at the worker limit a busy thread will take
+						it when it finishes, no need to retry */
+
+					if (!RHBORB_worker_allowed(somThis,rhbORB_task_lane(task)))
+					{
+						task=NULL;
+					}
+
 					break;
 				}
 			}
@@ -746,11 +934,24 @@ rhborb_child(void *pv)
 			}
 			else
 			{
+				long idle=somThis->idle_impls.list ? rhbORB_close_idle(somThis,0) : 0;
+
+				if (idle)
+				{
+	#if defined(USE_PTHREADS) 
+					somd_timed_wait(&somThis->child.pEvent,idle,__FILE__,__LINE__);
+	#else
+					somd_timed_wait(somThis->child.hEvent,idle,__FILE__,__LINE__);
+	#endif
+				}
+				else
+				{
 #if defined(USE_PTHREADS)
-				somd_wait(&somThis->child.pEvent,__FILE__,__LINE__);
+					somd_wait(&somThis->child.pEvent,__FILE__,__LINE__);
 #else
-				somd_wait(somThis->child.hEvent,__FILE__,__LINE__);
+					somd_wait(somThis->child.hEvent,__FILE__,__LINE__);
 #endif
+				}
 			}
 		}
 	}
@@ -1329,6 +1530,144 @@ static SOMDObject SOMSTAR rhbORB_get_object(
 	return somobj;
 }
 
+/* a client connection whose last user has gone is kept open by
+	the ORB for SOMDIDLETIMEOUT seconds so a new proxy to the
+	same endpoint can reuse it rather than connect again */
+
+SOMEXTERN boolean RHBORB_park_impl(RHBORB *somThis,RHBImplementationDef *im)
+{
+	boolean parked=0;
+
+	RHBORB_guard(somThis)
+
+	if ((!somThis->closing)
+		&&
+		(somThis->idle_impls.timeout > 0)
+		&&
+		(!im->lUsage)
+		&&
+		(!im->idle.parked)
+		&&
+		(!im->idle.retired)
+		&&
+		(!im->deleting)
+		&&
+		(!im->is_closing)
+		&&
+		(im->connection.connected)
+		&&
+		(!im->connection.is_listener)
+		&&
+		(!im->connection.is_server)
+		&&
+		(!im->server.data)
+		&&
+		(im->address.host)
+		&&
+		(im->address.port))
+	{
+		somd_atomic_inc(&im->lUsage);
+
+		im->idle.parked=1;
+		im->idle.since=time(NULL);
+		im->idle.next=somThis->idle_impls.list;
+		somThis->idle_impls.list=im;
+
+		parked=1;
+
+#ifdef USE_THREADS
+		/* so the child thread knows to time it out */
+	#ifdef USE_PTHREADS
+		pthread_cond_signal(&somThis->child.pEvent);
+	#else
+		SetEvent(somThis->child.hEvent);
+	#endif
+#endif
+	}
+
+	RHBORB_unguard(somThis)
+
+	return parked;
+}
+
+static void rhbORB_unpark_impl(RHBORB *somThis,RHBImplementationDef *im)
+{
+	RHBImplementationDef **h=&somThis->idle_impls.list;
+
+	RHBSOMD_must_be_guarded
+
+	while (*h)
+	{
+		if (*h==im)
+		{
+			*h=im->idle.next;
+			break;
+		}
+
+		h=&((*h)->idle.next);
+	}
+
+	im->idle.parked=0;
+	im->idle.next=NULL;
+}
+
+/* releases parked connections that have been idle too long, or
+	all of them, called guarded but drops the guard to release;
+	returns seconds until the next one is due or zero for none */
+
+static long rhbORB_close_idle(RHBORB *somThis,boolean all)
+{
+	RHBImplementationDef *expired=NULL;
+	RHBImplementationDef **h=&somThis->idle_impls.list;
+	time_t now=time(NULL);
+	long next=0;
+
+	RHBSOMD_must_be_guarded
+
+	while (*h)
+	{
+		RHBImplementationDef *im=*h;
+		long age=(long)(now-im->idle.since);
+
+		if (all || im->is_closing || (age >= somThis->idle_impls.timeout))
+		{
+			*h=im->idle.next;
+			im->idle.parked=0;
+			im->idle.retired=1;
+			im->idle.next=expired;
+			expired=im;
+		}
+		else
+		{
+			age=somThis->idle_impls.timeout-age;
+
+			if ((!next) || (age < next))
+			{
+				next=age;
+			}
+
+			h=&(im->idle.next);
+		}
+	}
+
+	if (expired)
+	{
+		RHBORB_unguard(somThis)
+
+		while (expired)
+		{
+			RHBImplementationDef *im=expired;
+			expired=im->idle.next;
+			im->idle.next=NULL;
+			RHBImplementationDef_Release(im);
+		}
+
+		RHBORB_guard(somThis)
+	}
+
+	return next;
+}
+
 static RHBImplementationDef * rhbORB_get_impl(
 		RHBORB *somThis,
 		Environment *ev,
@@ -1338,6 +1677,15 @@ static RHBImplementationDef * rhbORB_get_impl(
 
 	if (ev->_major) return 0;
 
+	if (somThis->idle_impls.list)
+	{
+		RHBORB_guard(somThis)
+
+		rhbORB_close_idle(somThis,0);
+
+		RHBORB_unguard(somThis)
+	}
+
 	if (!iop->port)
 	{
 		/* always return new one if zero 'port' */
@@ -1378,7 +1726,15 @@ static RHBImplementationDef * rhbORB_get_impl(
 											}
 										}
 
-										RHBImplementationDef_AddRef(i);
+										if (i->idle.parked)
+										{
+											/* take over the reference the ORB held */
+											rhbORB_unpark_impl(somThis,i);
+										}
+										else
+										{
+											RHBImplementationDef_AddRef(i);
+										}
 	
 										RHBORB_unguard(somThis)
 
@@ -1675,6 +2031,8 @@ static void rhbORB_Close(
 
 	somThis->closing=1;
 
+	rhbORB_close_idle(somThis,1);
+
 	RHBORB_unguard(somThis)
 
 	RHBORB_shutdown(somThis,ev);
@@ -1757,6 +2115,12 @@ static void rhbORB_Close(
 		}
 	}
 
+	if (somThis->oidl_cache)
+	{
+		SOMFree(somThis->oidl_cache);
+		somThis->oidl_cache=NULL;
+	}
+
 	RHBSOM_Trace("finished clearing up operations")
 
 #define ZAP_OBJECT(x)  if (x) { SOMObject SOMSTAR y=x; x=NULL; if (y) { somReleaseObjectReference(y); } }
@@ -2799,24 +3163,13 @@ static void rhbORB_StartThreadTask(
 	if (!somThis->closing)
 	{
 		t->next=NULL;
+		t->queued=rhbORB_task_clock();
 
 		started=RHBORB_queue_task(somThis,t);
 
 		if (!started)
 		{
-			if (somThis->child.tasks)
-			{
-				struct RHBORB_thread_task *p=somThis->child.tasks;
-				while (p->next) 
-				{
-					p=p->next; 
-				}
-				p->next=t;
-			}
-			else
-			{
-				somThis->child.tasks=t;
-			}
+			RHBORB_push_task(somThis,t,0);
 
 	#ifdef USE_PTHREADS
 			if (!pthread_cond_signal(&somThis->child.pEvent))
@@ -2828,7 +3181,7 @@ static void rhbORB_StartThreadTask(
 			}
 			else
 			{
-				somThis->child.tasks=t->next;
+				RHBORB_remove_task(somThis,t);
 			}
 		}
 	}
@@ -3316,6 +3669,17 @@ static SOMDServer SOMSTAR rhbORB_get_local_server(
 	return NULL;
 }
 
+/* is_method_oidl() answers by the method's mtoken, so a server
+	dispatching the same operation again skips the IR walk */
+
+#define RHBORB_OIDL_CACHE		64
+
+struct RHBORB_oidl_cache
+{
+	somMToken token;
+	boolean is;
+};
+
 struct rhbORB_is_method_oidl
 {
 	somId method,desc;
@@ -3347,12 +3711,42 @@ static boolean rhbORB_is_method_oidl(
 
 	if (id)
 	{
-		if (id[0]==':') if (id[1]==':') id+=2;
+		boolean cached=0;
+#ifndef USE_APPLE_SOM
+		somMToken token=NULL;
+		unsigned int slot=0;
+#endif
 
-		data.method=somIdFromString(id);
+		if (id[0]==':') if (id[1]==':') id+=2;
 
+#ifndef USE_APPLE_SOM
 		if (target)
 		{
+			char *name=id;
+			somMethodData md;
+
+			if (SOMClass_somGetMethodData(target->mtab->classObject,&name,&md))
+			{
+				token=md.mToken;
+				slot=(unsigned int)((((size_t)token)>>4)%RHBORB_OIDL_CACHE);
+
+				RHBORB_guard(orb)
+
+				if (orb->oidl_cache && (orb->oidl_cache[slot].token==token))
+				{
+					is=orb->oidl_cache[slot].is;
+					cached=1;
+				}
+
+				RHBORB_unguard(orb)
+			}
+		}
+#endif
+
+		if (!cached) data.method=somIdFromString(id);
+
+		if (target && !cached)
+		{
 #ifdef USE_APPLE_SOM
 			somKernelId kid=SOMClass_somGetMethodDescriptor(target->mtab->classObject,data.method);
 			if (kid) data.desc=somConvertAndFreeKernelId(kid);
@@ -3386,6 +3780,26 @@ static boolean rhbORB_is_method_oidl(
 
 				is=RHBORB_is_oidl(orb,data.defined_in);
 			}
+
+#ifndef USE_APPLE_SOM
+			if (token)
+			{
+				RHBORB_guard(orb)
+
+				if (!orb->oidl_cache)
+				{
+					orb->oidl_cache=SOMCalloc(RHBORB_OIDL_CACHE,sizeof(orb->oidl_cache[0]));
+				}
+
+				if (orb->oidl_cache)
+				{
+					orb->oidl_cache[slot].token=token;
+					orb->oidl_cache[slot].is=is;
+				}
+
+				RHBORB_unguard(orb)
+			}
+#endif
 		}
 	}
 
@@ -3708,6 +4122,7 @@ SOMEXTERN RHBORB * SOMLINK RHBORBNew(
 #endif
 
 	RHBCDR_kds_init(&somThis->contained_by_abs);
+	somThis->oidl_cache=NULL;
 	RHBCDR_kds_init(&somThis->ifaces_by_id);
 	RHBCDR_kds_init(&somThis->ifaces_by_abs);
 
@@ -3721,6 +4136,14 @@ SOMEXTERN RHBORB * SOMLINK RHBORBNew(
 
 	somThis->lUsage=1;
 	somThis->impls=NULL;
+	somThis->idle_impls.list=NULL;
+
+	{
+		const char *p=somutgetshellenv("SOMDIDLETIMEOUT","[somd]");
+
+		somThis->idle_impls.timeout=p ? atol(p) : 15;
+	}
+
 	somThis->iface=NULL;
 	somThis->closing=0;
 
@@ -3756,9 +4179,25 @@ static IOP_Encoding encoding={IOP_ENCODING_CDR_ENCAPS,1,0};
 
 #ifdef USE_THREADS
 	somThis->child.running=0;
-	somThis->child.tasks=NULL;
 	somThis->child.killer=NULL;
 	somThis->child.dead_list=NULL;
+	somThis->child.workers=0;
+	somThis->child.system=0;
+	memset(&somThis->child.lanes,0,sizeof(somThis->child.lanes));
+	memset(&somThis->child.stats,0,sizeof(somThis->child.stats));
+
+	{
+		/* SOMDMAXTHREADS limits threads serving requests,
+			zero leaves it open, a nested callback may need one more */
+		const char *p=somutgetshellenv("SOMDMAXTHREADS","[somd]");
+
+		somThis->child.max_workers=p ? atol(p) : 0;
+
+		if (somThis->child.max_workers < 0)
+		{
+			somThis->child.max_workers=0;
+		}
+	}
 
 	{
 		RHBORB_guard(somThis)
@@ -152,13 +152,23 @@ static void throw_RHBSocketError(Environment *ev,RHBSocketError err,const char *
 	}
 }
 
+static void RHBSendData_free(RHBSendData *somThis)
+{
+	if (somThis->body._buffer)
+	{
+		SOMFree(somThis->body._buffer);
+	}
+
+	SOMFree(somThis);
+}
+
 static void RHBSendData_delete(RHBSendData *somThis,RHBGIOPRequestStream *impl)
 {
 	while (somThis)
 	{
-		void *pv=somThis;
+		RHBSendData *pv=somThis;
 		somThis=somThis->next;
-		SOMFree(pv);
+		RHBSendData_free(pv);
 
 		if (!somd_atomic_dec(&impl->lUsage))
 		{
@@ -193,6 +203,133 @@ static void RHBImplementationDef_free_receive_buffer(
 		}
 		somThis->receiving_header=0;
 	}
+
+	while (somThis->fragments)
+	{
+		RHBGIOPFragment *frag=somThis->fragments;
+		somThis->fragments=frag->next;
+		if (frag->data._buffer) SOMFree(frag->data._buffer);
+		SOMFree(frag);
+	}
+}
+
+static unsigned long RHBImplementationDef_peek_ulong(
+		_IDL_SEQUENCE_octet *data,
+		boolean doSwap)
+{
+	octet *p=data->_buffer;
+
+	if (doSwap)
+	{
+		return (((unsigned long)p[3])<<24)|(((unsigned long)p[2])<<16)|
+				(((unsigned long)p[1])<<8)|((unsigned long)p[0]);
+	}
+
+	return (((unsigned long)p[0])<<24)|(((unsigned long)p[1])<<16)|
+			(((unsigned long)p[2])<<8)|((unsigned long)p[3]);
+}
+
+/* returns 1 if the message was kept as part of a fragmented message,
+	0 if it should be handled as is, in which case a completed
+	message replaces *header and *rx, or -1 for a protocol error */
+
+static int RHBImplementationDef_fragment(
+		RHBImplementationDef *somThis,
+		GIOP_MessageHeader *header,
+		boolean doSwap,
+		_IDL_SEQUENCE_octet *rx)
+{
+	boolean more=(boolean)(header->flags & RHBGIOP_FLAG_FRAGMENTS);
+	boolean keyed=(boolean)(header->protocol_version.minor > 1);
+	unsigned long request_id=0;
+	RHBGIOPFragment *frag,*prev=NULL;
+
+	RHBSOMD_must_be_guarded
+
+	if (header->protocol_version.minor < 1) return 0;
+
+	if ((header->message_type!=GIOP_Fragment) && !more) return 0;
+
+	if (keyed)
+	{
+		/* GIOP 1.2 headers and fragment headers start with request_id */
+
+		if (rx->_length < 4) return -1;
+
+		request_id=RHBImplementationDef_peek_ulong(rx,doSwap);
+	}
+
+	frag=somThis->fragments;
+
+	while (frag && (frag->request_id != request_id))
+	{
+		prev=frag;
+		frag=frag->next;
+	}
+
+	if (header->message_type!=GIOP_Fragment)
+	{
+		if (frag) return -1;
+
+		frag=SOMMalloc(sizeof(*frag));
+
+		if (!frag) return -1;
+
+		frag->request_id=request_id;
+		frag->header=*header;
+		frag->doSwap=doSwap;
+		frag->data=*rx;
+		frag->next=somThis->fragments;
+		somThis->fragments=frag;
+
+		rx->_buffer=NULL;
+		rx->_length=0;
+		rx->_maximum=0;
+
+		return 1;
+	}
+
+	if (!frag) return -1;
+
+	{
+		unsigned long skip=keyed ? 4 : 0;
+		unsigned long len=rx->_length-skip;
+
+		if (len)
+		{
+			octet *p=SOMRealloc(frag->data._buffer,frag->data._length+len);
+
+			if (!p) return -1;
+
+			memcpy(p+frag->data._length,rx->_buffer+skip,len);
+
+			frag->data._buffer=p;
+			frag->data._length+=len;
+			frag->data._maximum=frag->data._length;
+		}
+	}
+
+	if (more) return 1;
+
+	if (prev)
+	{
+		prev->next=frag->next;
+	}
+	else
+	{
+		somThis->fragments=frag->next;
+	}
+
+	if (rx->_buffer) SOMFree(rx->_buffer);
+
+	*rx=frag->data;
+	*header=frag->header;
+	header->flags&=~RHBGIOP_FLAG_FRAGMENTS;
+	header->message_size=rx->_length;
+
+	SOMFree(frag);
+
+	return 0;
 }
 
 static void RHBImplementationDef_delete(RHBImplementationDef *somThis)
@@ -484,29 +621,65 @@ static void RHBImplementationDef_perform_transmit(
 	{
 		if (somThis->transmitting.head)
 		{
+			/* gather the header and body of as many queued
+				messages as fit into the one send */
+			RHBSocketBuffer bufs[RHBSOCKET_MAX_BUFFERS];
 			RHBSendData *data=somThis->transmitting.head;
-			octet *p=data->seekPtr;
-			long i=data->toGo;
+			int count=0;
+			long i=0;
 			RHBSocketRef fd=somThis->connection.fd;
 			RHBSocketError sendError=0;
 
 			writes_wanted=1;
 
-			if (i > GIOP_LIMIT_XFER)
+			while (data && (count < (RHBSOCKET_MAX_BUFFERS-1)) && (i < (long)GIOP_LIMIT_XFER))
 			{
-				i=GIOP_LIMIT_XFER;
+				unsigned long offset=data->offset;
+
+				if (!data->toGo)
+				{
+					SOMD_bomb("zero bytes on transmit");
+				}
+
+				if (offset < data->headLength)
+				{
+					bufs[count].data=data->_buffer+offset;
+					bufs[count].len=(int)(data->headLength-offset);
+					i+=bufs[count++].len;
+					offset=data->headLength;
+				}
+
+				if (data->body._length > (offset-data->headLength))
+				{
+					bufs[count].data=data->body._buffer+(offset-data->headLength);
+					bufs[count].len=(int)(data->body._length-(offset-data->headLength));
+					i+=bufs[count++].len;
+				}
+
+				data=data->next;
 			}
 
-			if (!i)
+			while (i > (long)GIOP_LIMIT_XFER)
 			{
-				SOMD_bomb("zero bytes on transmit");
+				/* trim from the end, the first piece is always kept */
+				long over=i-(long)GIOP_LIMIT_XFER;
+
+				if ((count > 1) && (over >= bufs[count-1].len))
+				{
+					i-=bufs[--count].len;
+				}
+				else
+				{
+					bufs[count-1].len-=(int)over;
+					i=GIOP_LIMIT_XFER;
+				}
 			}
 
 			somThis->connection.writeable=0;
 
 			if (fd)
 			{
-				i=RHBSocket_SendData(fd,&sendError,p,i);
+				i=RHBSocket_SendDataV(fd,&sendError,bufs,count);
 			}
 			else
 			{
@@ -520,23 +693,36 @@ static void RHBImplementationDef_perform_transmit(
 					somThis->connection.writeable=1;
 				}
 
-				data->toGo-=i;
-				data->seekPtr+=i;
-
-				if (!data->toGo)
+				while (i)
 				{
-					somThis->transmitting.head=data->next;
+					long k=i;
+
+					data=somThis->transmitting.head;
 
-					if (!data->next)
+					if (k > (long)data->toGo)
 					{
-						somThis->transmitting.tail=NULL;
+						k=data->toGo;
 					}
 
-					SOMFree(data);
+					data->toGo-=k;
+					data->offset+=k;
+					i-=k;
+
+					if (!data->toGo)
+					{
+						somThis->transmitting.head=data->next;
+
+						if (!data->next)
+						{
+							somThis->transmitting.tail=NULL;
+						}
 
-					/* need to drop impl usage at end of this */
+						RHBSendData_free(data);
 
-					release_count++;
+						/* need to drop impl usage at end of this */
+
+						release_count++;
+					}
 				}
 			}
 			else
@@ -1283,7 +1469,7 @@ static void RHBImplementationDef_write_giop(
 {
 	somd_atomic_inc(&somThis->lUsage);
 
-	data->seekPtr=data->_buffer;
+	data->offset=0;
 	data->next=NULL;
 
 	if (somThis->transmitting.tail)
@@ -1738,11 +1924,31 @@ static void RHBImplementationDef_kick_receiver(RHBImplementationDef *somThis,Env
 						_IDL_SEQUENCE_octet rx=somThis->receiving;
 						GIOP_MessageHeader header=somThis->GIOP_header;
 						boolean doSwap=somThis->receive_doSwap;
+						int frag;
 				
 						somThis->receiving._length=0;
 						somThis->receiving._maximum=0;
 						somThis->receiving._buffer=NULL;
 
+						frag=RHBImplementationDef_fragment(somThis,&header,doSwap,&rx);
+
+						if (frag)
+						{
+							if (rx._buffer) SOMFree(rx._buffer);
+
+							if (frag < 0)
+							{
+								close_on_exit=1;
+
+								break;
+							}
+
+							continue;
+						}
+
+						/* a completed message keeps the byte order of its first part */
+						doSwap=(boolean)(((header.flags & 1)==RHBCDR_machine_type()) ? 0 : 1);
+
 						RHBORB_unguard(somThis);
 
 						RHBImplementationDef_received_message(
@@ -2677,6 +2883,13 @@ static void rhbGIOPRequestStream_Release(RHBGIOPRequestStream *somThis)
 {
 	if (!somd_atomic_dec(&somThis->lUsage)) 
 	{
+		RHBORB *orb=somThis->orb;
+
+		if (orb && RHBORB_park_impl(orb,somThis))
+		{
+			return;
+		}
+
 		rhbGIOPRequestStream_Close(somThis);
 	}
 }
@@ -3062,22 +3275,24 @@ static RHBSendData *SOMLINK RHBSendDataNew(_IDL_SEQUENCE_octet *header,_IDL_SEQU
 {
 	if (header && data)
 	{
-		RHBSendData *somThis=SOMMalloc(sizeof(*somThis)+header->_length+data->_length);
+		RHBSendData *somThis=SOMMalloc(sizeof(*somThis)+header->_length);
 
 		if (somThis)
 		{
 			somThis->toGo=header->_length+data->_length;
-			somThis->seekPtr=somThis->_buffer;
+			somThis->offset=0;
+			somThis->headLength=header->_length;
 			somThis->next=NULL;
 
-			memcpy(somThis->seekPtr,header->_buffer,header->_length);
-			memcpy(somThis->seekPtr+header->_length,data->_buffer,data->_length);
+			memcpy(somThis->_buffer,header->_buffer,header->_length);
 
 			SOMFree(header->_buffer);
 			header->_buffer=NULL;
 			header->_length=0;
 			header->_maximum=0;
-			SOMFree(data->_buffer);
+
+			/* take the marshalled body as it is */
+			somThis->body=*data;
 			data->_buffer=NULL;
 			data->_length=0;
 			data->_maximum=0;
@@ -3321,6 +3536,11 @@ RHBGIOPRequestStream *RHBGIOPRequestStreamNew(
 
 	somThis->outstanding_request_list=NULL;
 	somThis->receiving._buffer=NULL;
+	somThis->fragments=NULL;
+	somThis->idle.parked=0;
+	somThis->idle.retired=0;
+	somThis->idle.since=0;
+	somThis->idle.next=NULL;
 
 	somThis->lUsage=1;
 
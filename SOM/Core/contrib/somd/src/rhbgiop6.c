@@ -446,6 +446,7 @@ static ORBStatus rhbRequest_send_local(
 		somThis->local.task.start=rhbRequest_exec_local;
 		somThis->local.task.failed=rhbRequest_exec_failed;
 		somThis->local.task.param=somThis;
+		somThis->local.task.lane=RHBORB_TASK_SYSTEM;
 		RHBORB_guard(orb)
 		if (somThis->pending)
 		{
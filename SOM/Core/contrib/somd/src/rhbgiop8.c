@@ -1675,6 +1675,7 @@ RHBServerRequest * RHBServerRequestNew(
 	somThis->task.start=rhbServerRequest_exec_mt,
 	somThis->task.failed=rhbServerRequest_exec_mt_failed;
 	somThis->task.param=somThis;
+	somThis->task.lane=RHBORB_TASK_INVOKE;
 #else
 	somThis->exec_st=rhbServerRequest_Execute;
 #endif
@@ -46,6 +46,9 @@
 		#include <unistd.h>
 		#include <netinet/in.h>
 		#include <netinet/tcp.h>  /* port to glibc */
+		#ifdef HAVE_SYS_UIO_H
+			#include <sys/uio.h>
+		#endif
 	#else
 		#define DISABLE_SOCKETS
 	#endif
@@ -142,6 +145,25 @@
 #	include <somserr.h>
 #endif
 
+/* the selector threads wait on epoll or kqueue where there is one,
+	otherwise select() */
+
+#if defined(USE_THREADS) && defined(_PLATFORM_UNIX_)
+#	if defined(HAVE_EPOLL_CREATE)
+#		include <sys/epoll.h>
+#		define RHBSOMD_EVENTS_EPOLL
+#	elif defined(HAVE_KQUEUE)
+#		include <sys/event.h>
+#		define RHBSOMD_EVENTS_KQUEUE
+#	endif
+#endif
+
+#if defined(RHBSOMD_EVENTS_EPOLL) || defined(RHBSOMD_EVENTS_KQUEUE)
+#	define RHBSOMD_EVENTS
+#	define RHBSOMD_EVENTS_BATCH			64
+#	define RHBSOMD_EVENTS_TASKS			4096
+#endif
+
 #define RHBSOCK_STATE_IDLE			0	/* nothing */
 #define RHBSOCK_STATE_PASSIVE		1	/* listening */
 #define RHBSOCK_STATE_ACTIVE		2	/* connecting */
@@ -533,7 +555,18 @@ struct thread_task
 	void (*notify)(struct rhbbsd_thread_selector *,struct thread_task *,int);
 	struct RHBSocketData *data;
 	void (*removed_locked)(struct thread_task *);
+#ifdef RHBSOMD_EVENTS
+	int pollFlags; /* what the event backend is waiting for */
+#endif
+};
+
+#ifdef RHBSOMD_EVENTS
+struct thread_ready
+{
+	struct thread_task *task;
+	int flags;
 };
+#endif
 
 struct thread_select
 {
@@ -549,6 +582,11 @@ struct thread_select
 	fd_set *fdw;
 	fd_set *fde;
 	int blip_write,blip_read;
+#ifdef RHBSOMD_EVENTS
+	int poll_fd;
+	struct thread_ready *ready;
+	int nready;
+#endif
 #ifdef USE_PTHREADS
 	pthread_t tid;
 #else
@@ -577,6 +615,134 @@ static boolean thread_match(struct thread_select *somThis)
 	return 0;
 }
 
+#ifdef RHBSOMD_EVENTS
+static void close_on_exec(SOCKET fd);
+
+/* the interest set lives in the kernel, and a task's entry is only
+	touched when its selectFlags no longer match it */
+
+static int rhbbsd_events_open(struct thread_select *somThis)
+{
+#ifdef RHBSOMD_EVENTS_EPOLL
+	struct epoll_event ev;
+
+	somThis->poll_fd=epoll_create(RHBSOMD_EVENTS_BATCH);
+
+	if (somThis->poll_fd < 0) return -1;
+
+	close_on_exec(somThis->poll_fd);
+
+	memset(&ev,0,sizeof(ev));
+	ev.events=EPOLLIN;
+	ev.data.ptr=NULL;
+
+	return epoll_ctl(somThis->poll_fd,EPOLL_CTL_ADD,somThis->fd_signal_read,&ev);
+#else
+	struct kevent kev;
+
+	somThis->poll_fd=kqueue();
+
+	if (somThis->poll_fd < 0) return -1;
+
+	close_on_exec(somThis->poll_fd);
+
+	EV_SET(&kev,somThis->fd_signal_read,EVFILT_READ,EV_ADD,0,0,NULL);
+
+	return kevent(somThis->poll_fd,&kev,1,NULL,0,NULL);
+#endif
+}
+
+static void rhbbsd_events_set(struct thread_select *somThis,struct thread_task *task,int want)
+{
+	if (want != task->pollFlags)
+	{
+#ifdef RHBSOMD_EVENTS_EPOLL
+		struct epoll_event ev;
+
+		memset(&ev,0,sizeof(ev));
+
+		if (want & RHBSocket_select_read) ev.events|=EPOLLIN;
+		if (want & RHBSocket_select_write) ev.events|=EPOLLOUT;
+		if (want & RHBSocket_select_except) ev.events|=EPOLLPRI;
+
+		ev.data.ptr=task;
+
+		if (!want)
+		{
+			epoll_ctl(somThis->poll_fd,EPOLL_CTL_DEL,task->fd,&ev);
+		}
+		else
+		{
+			if (task->pollFlags)
+			{
+				epoll_ctl(somThis->poll_fd,EPOLL_CTL_MOD,task->fd,&ev);
+			}
+			else
+			{
+				if (epoll_ctl(somThis->poll_fd,EPOLL_CTL_ADD,task->fd,&ev))
+				{
+					/* descriptor reused before the old entry went */
+					epoll_ctl(somThis->poll_fd,EPOLL_CTL_MOD,task->fd,&ev);
+				}
+			}
+		}
+#else
+		/* except only comes with write, and is seen as EV_EOF on it */
+		struct kevent kev[2];
+		int n=0;
+		int r=want & RHBSocket_select_read;
+		int w=want & (RHBSocket_select_write|RHBSocket_select_except);
+
+		if (r != (task->pollFlags & RHBSocket_select_read))
+		{
+			EV_SET(&kev[n],task->fd,EVFILT_READ,r ? EV_ADD : EV_DELETE,0,0,(void *)task);
+			n++;
+		}
+
+		if ((!w) != (!(task->pollFlags & (RHBSocket_select_write|RHBSocket_select_except))))
+		{
+			EV_SET(&kev[n],task->fd,EVFILT_WRITE,w ? EV_ADD : EV_DELETE,0,0,(void *)task);
+			n++;
+		}
+
+		if (n) kevent(somThis->poll_fd,kev,n,NULL,0,NULL);
+#endif
+
+		task->pollFlags=want;
+	}
+}
+
+static void rhbbsd_events_forget(struct thread_select *somThis,struct thread_task *task)
+{
+	int i=somThis->nready;
+
+	if ((somThis->poll_fd >= 0) && (task->fd != INVALID_SOCKET))
+	{
+		rhbbsd_events_set(somThis,task,0);
+	}
+
+	task->pollFlags=0;
+
+	/* may be in the batch being notified */
+	while (i--)
+	{
+		if (somThis->ready[i].task==task)
+		{
+			somThis->ready[i].task=NULL;
+		}
+	}
+}
+
+static void rhbbsd_events_close(struct thread_select *somThis)
+{
+	if (somThis->poll_fd >= 0)
+	{
+		close(somThis->poll_fd);
+		somThis->poll_fd=-1;
+	}
+}
+#endif
+
 static boolean thread_task_detach(struct thread_task *task)
 {
 	struct thread_select *thread=task->task_thread;
@@ -605,6 +771,10 @@ static boolean thread_task_detach(struct thread_task *task)
 				if (thread->fde) FD_CLR(task->fd,thread->fde);
 			}
 
+#ifdef RHBSOMD_EVENTS
+			rhbbsd_events_forget(thread,task);
+#endif
+
 			task->task_thread=NULL;
 
 			if (thread->tasks==task)
@@ -773,6 +943,17 @@ typedef struct RHBSocketData
 	struct RHBSocketData *next;
 } RHBSocketData; 
 
+/* resolved names are kept for SOMDDNSTTL seconds */
+#define RHBBSDR_CACHE_SIZE		16
+
+struct rhbbsdr_cache_entry
+{
+	char *name;
+	unsigned short port;
+	time_t expires;
+	_IDL_SEQUENCE_SOMD_NetworkAddress addrSeq;
+};
+
 struct RHBProtocolData
 {
 	rhbatomic_t lUsage;
@@ -781,6 +962,8 @@ struct RHBProtocolData
 	boolean closing;
 	RHBSocketData *socket_impl_list;
 	struct RHBResolverData *resolvers;
+	long dnr_ttl;
+	struct rhbbsdr_cache_entry dnr_cache[RHBBSDR_CACHE_SIZE];
 #ifdef USE_THREADS
 	struct thread_select *threads;
 #else
@@ -871,6 +1054,9 @@ struct thread_select *somThis=pv;
 		}
 	}
 
+#ifdef RHBSOMD_EVENTS
+	rhbbsd_events_close(somThis);
+#endif
 	soclose(somThis->fd_signal_write);
 	soclose(somThis->fd_signal_read);
 	SOMFree(somThis);
@@ -908,6 +1094,142 @@ struct rhbbsd_thread_selector *data=pv;
 
 RHBOPT_cleanup_end
 
+#ifdef RHBSOMD_EVENTS
+/* one pass of the selector loop on the event backend,
+	returns nonzero when the thread should finish */
+
+static int rhbbsd_events_wait(struct rhbbsd_thread_selector *data,struct thread_select *somThis)
+{
+	struct thread_ready ready[RHBSOMD_EVENTS_BATCH];
+#ifdef RHBSOMD_EVENTS_EPOLL
+	struct epoll_event events[RHBSOMD_EVENTS_BATCH];
+#else
+	struct kevent events[RHBSOMD_EVENTS_BATCH];
+#endif
+	struct thread_task *task=somThis->tasks;
+	int i,n;
+
+	while (task)
+	{
+		if (task->fd!=INVALID_SOCKET)
+		{
+			rhbbsd_events_set(somThis,task,task->selectFlags &
+						(RHBSocket_select_read|
+						RHBSocket_select_write|
+						RHBSocket_select_except));
+		}
+
+		task=task->task_next;
+	}
+
+	data->locked=0;
+
+	RHBORB_unguard(0)
+
+#ifdef RHBSOMD_EVENTS_EPOLL
+	n=epoll_wait(somThis->poll_fd,events,RHBSOMD_EVENTS_BATCH,-1);
+#else
+	n=kevent(somThis->poll_fd,NULL,0,events,RHBSOMD_EVENTS_BATCH,NULL);
+#endif
+
+	RHBORB_guard(0)
+
+	data->locked=1;
+
+	if (n < 0)
+	{
+		if (errno==EINTR) return 0;
+
+		debug_somPrintf(("event wait error %d\n",errno));
+
+		return 1;
+	}
+
+	somThis->ready=ready;
+	somThis->nready=0;
+
+	for (i=0; i < n; i++)
+	{
+		int flags=0,j;
+#ifdef RHBSOMD_EVENTS_EPOLL
+		unsigned int e=events[i].events;
+
+		task=events[i].data.ptr;
+
+		/* select() has an error show up as readable and writable */
+		if (e & (EPOLLIN|EPOLLHUP|EPOLLERR)) flags|=RHBSocket_select_read;
+		if (e & (EPOLLOUT|EPOLLERR)) flags|=RHBSocket_select_write;
+		if (e & (EPOLLPRI|EPOLLERR)) flags|=RHBSocket_select_except;
+#else
+		task=(struct thread_task *)(void *)events[i].udata;
+
+		if (events[i].filter==EVFILT_READ) flags|=RHBSocket_select_read;
+
+		if (events[i].filter==EVFILT_WRITE)
+		{
+			flags|=RHBSocket_select_write;
+
+			if (events[i].flags & (EV_EOF|EV_ERROR)) flags|=RHBSocket_select_except;
+		}
+#endif
+
+		if (!task)
+		{
+			char buf[256];
+
+			j=read(somThis->fd_signal_read,buf,sizeof(buf));
+
+			if (j==0) return 1;
+
+			if (j > 0) somThis->blip_read+=j;
+
+			continue;
+		}
+
+		/* kqueue reports read and write separately */
+		for (j=0; j < somThis->nready; j++)
+		{
+			if (ready[j].task==task) break;
+		}
+
+		if (j==somThis->nready)
+		{
+			ready[j].task=task;
+			ready[j].flags=0;
+			somThis->nready++;
+		}
+
+		ready[j].flags|=flags;
+	}
+
+	for (i=0; i < somThis->nready; i++)
+	{
+		task=ready[i].task;
+
+		if (task)
+		{
+			/* what is wanted now, it may have changed since the wait */
+			int flags=ready[i].flags & task->selectFlags &
+						(RHBSocket_select_read|
+						RHBSocket_select_write|
+						RHBSocket_select_except);
+
+			ready[i].task=NULL;
+
+			if (flags && !(task->selectFlags & RHBSocket_select_remove))
+			{
+				task->notify(data,task,flags);
+			}
+		}
+	}
+
+	somThis->ready=NULL;
+	somThis->nready=0;
+
+	return 0;
+}
+#endif
+
 static void SOMLINK rhbbsd_thread_selector(void *pv,Environment *ev)
 {
 struct rhbbsd_thread_selector data={0,NULL};
@@ -961,6 +1283,9 @@ struct thread_select *somThis=pv;
 
 			if (task->selectFlags & RHBSocket_select_remove)
 			{
+#ifdef RHBSOMD_EVENTS
+				rhbbsd_events_forget(somThis,task);
+#endif
 				task->task_thread=NULL;
 
 				if (q)
@@ -997,6 +1322,13 @@ struct thread_select *somThis=pv;
 			}
 		}
 		else
+#ifdef RHBSOMD_EVENTS
+		if (somThis->poll_fd >= 0)
+		{
+			if (rhbbsd_events_wait(&data,somThis)) break;
+		}
+		else
+#endif
 		{
 			fd_set fdr,fdw,fde;
 			SOCKET n=somThis->fd_signal_read;
@@ -1191,7 +1523,7 @@ static struct thread_select *rhbbsdp_get_thread(RHBProtocol *proto,struct thread
 
 	while (t)
 	{
-		long i=0;
+		long i=0,max;
 		struct thread_task *p=t->tasks;
 #ifdef _WIN32
 		fd_set fds;
@@ -1204,9 +1536,15 @@ static struct thread_select *rhbbsdp_get_thread(RHBProtocol *proto,struct thread
 	#define NUMBER_TASKS_PER_THREAD		((sizeof(fd_set)<<3)-5)
 #endif
 
+		max=NUMBER_TASKS_PER_THREAD;
+
+#ifdef RHBSOMD_EVENTS
+		if (t->poll_fd >= 0) max=RHBSOMD_EVENTS_TASKS;
+#endif
+
 		if (t->family != family) 
 		{
-			i=NUMBER_TASKS_PER_THREAD;
+			i=max;
 		}
 		else
 		{
@@ -1221,7 +1559,7 @@ static struct thread_select *rhbbsdp_get_thread(RHBProtocol *proto,struct thread
 		}
 
 
-		if (i < NUMBER_TASKS_PER_THREAD)
+		if (i < max)
 		{
 			RHBOPT_ASSERT(t->tasks != task)
 
@@ -1269,6 +1607,17 @@ static struct thread_select *rhbbsdp_get_thread(RHBProtocol *proto,struct thread
 			task->task_thread=t;
 			t->fdr=t->fde=t->fdw=NULL;
 			t->blip_write=t->blip_read=0;
+#ifdef RHBSOMD_EVENTS
+			t->ready=NULL;
+			t->nready=0;
+			task->pollFlags=0;
+
+			if (rhbbsd_events_open(t))
+			{
+				/* select() will do */
+				rhbbsd_events_close(t);
+			}
+#endif
 
 			set_non_blocking(t->fd_signal_read);
 			set_non_blocking(t->fd_signal_write);
@@ -1276,6 +1625,7 @@ static struct thread_select *rhbbsdp_get_thread(RHBProtocol *proto,struct thread
 			t->task.start=rhbbsd_thread_selector;
 			t->task.param=t;
 			t->task.failed=rhbbsd_thread_selector_final;
+			t->task.lane=RHBORB_TASK_SYSTEM;
 			RHBORB_StartThreadTask(proto->impl->orb,&t->task);
 		}
 	}
@@ -1499,7 +1849,10 @@ int i,err=0;
 	static void catch_sigpipe(int i) { }
 #endif
 
-static int RHBLINK rhbbsd_SendData(RHBSocket *somSelf,RHBSocketError *ev,const void *data,int len)
+/* sends as much of the buffers as the socket will take in one call,
+	without gathered writes only the first buffer is sent */
+
+static int rhbbsd_send(RHBSocket *somSelf,RHBSocketError *ev,const RHBSocketBuffer *bufs,int count)
 {
 RHBSocketData *somThis=RHBSocketGetData(somSelf);
 int i;
@@ -1548,11 +1901,47 @@ Environment ev2=RHBSOMD_EnvironmentInit;
 #endif
 
 #ifdef USE_THREADS
-	i=send(somThis->fd,data,len,0);
+	if (count > 1)
+	{
+	#if defined(_WIN32)
+		WSABUF vec[RHBSOCKET_MAX_BUFFERS];
+		DWORD sent=0;
+		int k;
+
+		if (count > RHBSOCKET_MAX_BUFFERS) count=RHBSOCKET_MAX_BUFFERS;
+
+		for (k=0; k < count; k++)
+		{
+			vec[k].buf=(char *)bufs[k].data;
+			vec[k].len=bufs[k].len;
+		}
+
+		i=WSASend(somThis->fd,vec,count,&sent,0,NULL,NULL) ? -1 : (int)sent;
+	#elif defined(HAVE_SYS_UIO_H)
+		struct iovec vec[RHBSOCKET_MAX_BUFFERS];
+		int k;
+
+		if (count > RHBSOCKET_MAX_BUFFERS) count=RHBSOCKET_MAX_BUFFERS;
+
+		for (k=0; k < count; k++)
+		{
+			vec[k].iov_base=(void *)bufs[k].data;
+			vec[k].iov_len=bufs[k].len;
+		}
+
+		i=writev(somThis->fd,vec,count);
+	#else
+		i=send(somThis->fd,bufs->data,bufs->len,0);
+	#endif
+	}
+	else
+	{
+		i=send(somThis->fd,bufs->data,bufs->len,0);
+	}
 #else
 	RHBOPT_ASSERT(somThis->socketObject);
 	{
-		i=Sockets_somsSend(somThis->socketObject,&ev2,somThis->fd,(void *)data,len,0);
+		i=Sockets_somsSend(somThis->socketObject,&ev2,somThis->fd,(void *)bufs->data,bufs->len,0);
 	}
 #endif
 
@@ -1600,6 +1989,28 @@ Environment ev2=RHBSOMD_EnvironmentInit;
 	return i;
 }
 
+static int RHBLINK rhbbsd_SendData(RHBSocket *somSelf,RHBSocketError *ev,const void *data,int len)
+{
+	RHBSocketBuffer buf;
+
+	buf.data=data;
+	buf.len=len;
+
+	return rhbbsd_send(somSelf,ev,&buf,1);
+}
+
+static int RHBLINK rhbbsd_SendDataV(RHBSocket *somSelf,RHBSocketError *ev,const RHBSocketBuffer *bufs,int count)
+{
+	if (count < 1)
+	{
+		*ev=SOMS_EINVAL;
+
+		return -1;
+	}
+
+	return rhbbsd_send(somSelf,ev,bufs,count);
+}
+
 static RHBSocket * RHBLINK rhbbsd_Accept(RHBSocket *somSelf,
 			RHBSocketError *ev,
 			RHBSocketAddress *addr,
@@ -2162,6 +2573,9 @@ static RHBSocketRef rhbbsd_create_from_fd(RHBProtocolRef protocol,SOCKET fd,int
 		a->data.task.removed_locked=rhbbsd_removed_locked;
 		a->data.task.data=&a->data;
 		a->data.task.fd=fd;
+#ifdef RHBSOMD_EVENTS
+		a->data.task.pollFlags=0;
+#endif
 
 		if (!rhbbsdp_get_thread(protocol,&a->data.task,family))
 		{
@@ -2762,6 +3176,173 @@ typedef struct RHBProtocolData RHBProtocolData;
 
 #define RHBProtocolGetData(x)   x->impl
 
+static void rhbbsdr_addr_free(_IDL_SEQUENCE_SOMD_NetworkAddress *seq)
+{
+	if (seq->_buffer)
+	{
+		unsigned long i=seq->_length;
+		SOMD_NetworkAddress *p=seq->_buffer;
+
+		while (i--)
+		{
+			if (p->name) SOMFree(p->name);
+			if (p->value._buffer) SOMFree(p->value._buffer);
+			p++;
+		}
+
+		SOMFree(seq->_buffer);
+	}
+
+	seq->_buffer=NULL;
+	seq->_length=0;
+	seq->_maximum=0;
+}
+
+static boolean rhbbsdr_addr_copy(_IDL_SEQUENCE_SOMD_NetworkAddress *dst,
+								 _IDL_SEQUENCE_SOMD_NetworkAddress *src)
+{
+	unsigned long i=0;
+
+	dst->_length=0;
+	dst->_maximum=src->_length;
+	dst->_buffer=NULL;
+
+	if (!src->_length) return 1;
+
+	dst->_buffer=SOMMalloc(src->_length*sizeof(dst->_buffer[0]));
+
+	if (!dst->_buffer) return 0;
+
+	while (i < src->_length)
+	{
+		SOMD_NetworkAddress *s=src->_buffer+i;
+		SOMD_NetworkAddress *d=dst->_buffer+i;
+
+		d->family=s->family;
+		d->name=s->name ? somd_dupl_string(s->name) : NULL;
+		d->value._length=s->value._length;
+		d->value._maximum=s->value._length;
+		d->value._buffer=NULL;
+
+		dst->_length++;
+
+		if (s->value._length)
+		{
+			d->value._buffer=SOMMalloc(s->value._length);
+
+			if (!d->value._buffer)
+			{
+				rhbbsdr_addr_free(dst);
+
+				return 0;
+			}
+
+			memcpy(d->value._buffer,s->value._buffer,s->value._length);
+		}
+
+		i++;
+	}
+
+	return 1;
+}
+
+static void rhbbsdr_cache_free(struct rhbbsdr_cache_entry *e)
+{
+	if (e->name)
+	{
+		SOMFree(e->name);
+		e->name=NULL;
+	}
+
+	rhbbsdr_addr_free(&e->addrSeq);
+}
+
+static void rhbbsdr_cache_flush(RHBProtocolData *somThis)
+{
+	int i=RHBBSDR_CACHE_SIZE;
+
+	while (i--)
+	{
+		rhbbsdr_cache_free(&somThis->dnr_cache[i]);
+	}
+}
+
+/* both called guarded, a hit is a private copy for the caller to free */
+
+static boolean rhbbsdr_cache_lookup(RHBProtocolData *somThis,
+									const char *name,unsigned short port,
+									_IDL_SEQUENCE_SOMD_NetworkAddress *seq)
+{
+	time_t now=time(NULL);
+	int i=RHBBSDR_CACHE_SIZE;
+
+	if (!name) return 0;
+
+	while (i--)
+	{
+		struct rhbbsdr_cache_entry *e=&somThis->dnr_cache[i];
+
+		if (e->name && (e->port==port) && !strcmp(e->name,name))
+		{
+			if (e->expires <= now)
+			{
+				rhbbsdr_cache_free(e);
+
+				return 0;
+			}
+
+			return rhbbsdr_addr_copy(seq,&e->addrSeq);
+		}
+	}
+
+	return 0;
+}
+
+static void rhbbsdr_cache_store(RHBProtocolData *somThis,
+								const char *name,unsigned short port,
+								_IDL_SEQUENCE_SOMD_NetworkAddress *seq)
+{
+	struct rhbbsdr_cache_entry *e=NULL;
+	int i=RHBBSDR_CACHE_SIZE;
+
+	if ((somThis->dnr_ttl <= 0) || (!name) || (!seq) || (!seq->_length)) return;
+
+	/* same name, else an empty slot, else the one expiring first */
+
+	while (i--)
+	{
+		struct rhbbsdr_cache_entry *p=&somThis->dnr_cache[i];
+
+		if (p->name && (p->port==port) && !strcmp(p->name,name))
+		{
+			e=p;
+			break;
+		}
+
+		if ((!e) || (e->name && ((!p->name) || (p->expires < e->expires))))
+		{
+			e=p;
+		}
+	}
+
+	rhbbsdr_cache_free(e);
+
+	e->name=somd_dupl_string(name);
+
+	if (e->name)
+	{
+		if (rhbbsdr_addr_copy(&e->addrSeq,seq))
+		{
+			e->port=port;
+			e->expires=time(NULL)+somThis->dnr_ttl;
+		}
+		else
+		{
+			rhbbsdr_cache_free(e);
+		}
+	}
+}
+
 RHBProtocolRef SOMLINK RHBORB_create_protocol(RHBORB *orb)
 {
 	struct 
@@ -2787,6 +3368,12 @@ RHBProtocolRef SOMLINK RHBORB_create_protocol(RHBORB *orb)
 	a->protocol.impl=&a->data;
 	a->protocol.vtbl=&rhbbsdp_JumpTable;
 
+	{
+		const char *p=somutgetshellenv("SOMDDNSTTL","[somd]");
+
+		a->data.dnr_ttl=p ? atol(p) : 60;
+	}
+
 #ifdef USE_THREADS
 #else
 	a->data.socketObject=orb->events.socketObject;
@@ -2836,6 +3423,8 @@ RHBProtocolData *somThis=RHBProtocolGetData(somSelf);
 #endif
 		RHBOPT_ASSERT(!somThis->resolvers)
 
+		rhbbsdr_cache_flush(somThis);
+
 		while (somThis->socket_impl_list) 
 		{
 			struct RHBSocketData *sock=somThis->socket_impl_list;
@@ -3401,11 +3990,27 @@ RHBResolverData *somThis=somSelf->impl;
 	}
 #endif
 
+	{
+		_IDL_SEQUENCE_SOMD_NetworkAddress addrSeq={0,0,NULL};
+
+		if (rhbbsdr_cache_lookup(somThis->protocol->impl,somThis->name,somThis->port,&addrSeq))
+		{
+			RHBORB_unguard(0)
+
+			cb(impl,0,&addrSeq);
+
+			rhbbsdr_addr_free(&addrSeq);
+
+			return;
+		}
+	}
+
 #ifdef USE_THREADS
 	RHBResolver_AddRef(somSelf);
 	somThis->task.start=rhbbsdr_thread;
 	somThis->task.param=somSelf;
 	somThis->task.failed=rhbbsdr_thread_failed;
+	somThis->task.lane=RHBORB_TASK_SYSTEM;
 	RHBORB_StartThreadTask(impl->orb,&somThis->task);
 #else
 	if (somThis->name)
@@ -3426,6 +4031,7 @@ RHBResolverData *somThis=somSelf->impl;
 			{
 				_IDL_SEQUENCE_SOMD_NetworkAddress addr={0,0,NULL};
 				build_addrSeq(&addr,hp,somThis->port);
+				rhbbsdr_cache_store(somThis->protocol->impl,somThis->name,somThis->port,&addr);
 				cb(impl,0,&addr);
 
 				SOMD_FreeType(&ev,&addr,somdTC_sequence_SOMD_NetworkAddress);
@@ -3963,6 +4569,17 @@ FORK_STATUS
 	RHBORB_guard(orb)
 	data.impl=data.ref->impl->impl;
 	data.ref->impl->impl=NULL;
+	if (data.impl && data.ref->impl->protocol)
+	{
+		rhbbsdr_cache_store(data.ref->impl->protocol->impl,
+				data.ref->impl->name,data.ref->impl->port,
+#ifdef USE_RESOLVER_CHILD
+				data.addrSeqAny._value
+#else
+				&data.addrSeq
+#endif
+				);
+	}
 	RHBORB_unguard(orb)
 
 	if (data.impl)
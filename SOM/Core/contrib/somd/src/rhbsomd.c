@@ -413,6 +413,27 @@ SOMEXTERN unsigned char SOMLINK SOMD_QueryORBfree(void)
 	return 0;
 }
 
+SOMEXTERN void SOMLINK SOMD_QueryTaskStats(
+			Environment *ev,
+			SOMD_TaskStats *stats)
+{
+	memset(stats,0,sizeof(*stats));
+
+#ifdef USE_THREADS
+	if (SOMD_ORBObject)
+	{
+		RHBORB *orb=ORB__get_c_orb(SOMD_ORBObject,ev);
+
+		if (orb)
+		{
+			RHBORB_get_task_stats(orb,stats);
+		}
+	}
+#else
+	RHBOPT_unused(ev)
+#endif
+}
+
 
 SOMEXTERN void SOMLINK SOMD_FlushInterfaceCache(
 			Environment *ev,
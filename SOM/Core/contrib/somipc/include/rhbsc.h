@@ -973,13 +973,17 @@ typedef int (* myFunc)(int x,int y);
 class SOMIR_element;
 class SOMIR_record;
 class SOMIR_free;
+class SOMIR_index;
 
 class RHBir_file : public RHBoutput
 {
 	FILE *fp;
 	SOMIR_free *freeListItems;
 	long fileLength;
+	long indexOffset;
 	char filename[256];
+	void release(long,long);
+	boolean index_container(SOMIR_index *,long,const char *,long);
 public:
 	long _get_fileLength() { return fileLength; }
 	RHBir_file(const char *name);
@@ -996,6 +1000,7 @@ public:
 	boolean load(void);
 	void free(long,long);
 	long alloc(long,const char *,int);
+	void write_index(void);
 };
 
 class RHBir_emitter : public RHBemitter
@@ -32,6 +32,12 @@
 #	include <signal.h>
 #endif
 
+#ifdef _PLATFORM_UNIX_
+#	include <sys/types.h>
+#	include <sys/wait.h>
+#	include <unistd.h>
+#endif
+
 #include <rhbsc.h>
 
 static boolean default_emitflag;
@@ -73,30 +79,209 @@ public:
 	}
 };
 
+static const char *valid_emitter[]={
+	"xh","xih","h","ih","api","kih","ir","tc"
+};
+
+#define MAX_EMITTERS	(sizeof(valid_emitter)/sizeof(valid_emitter[0]))
+
+static int emit_one(
+	RHBrepository *r,
+	const char *root_idl,
+	const char *emitter_name,
+	const char *output_filename)
+{
+	if (!strcmp(emitter_name,"ir"))
+	{
+		boolean old_emit=default_emitflag;
+		default_emitflag=1;
+		RHBir_file out(output_filename);
+/*		printf("This should be the IR generator\n",buf);*/
+		RHBir_emitter emitter(r,&out);
+		emitter.generate(&out,root_idl);
+#ifdef _PLATFORM_MACINTOSH_
+		fsetfileinfo(buf,SOMIR_CREATOR,SOMIR_TYPE);
+#endif
+		default_emitflag=old_emit;
+	}
+	else
+	{
+		RHBtextfile out(output_filename);
+
+		if (!strcmp(emitter_name,"tc"))
+		{
+			RHBtc_emitter emitter(r);
+
+			emitter.generate(&out,root_idl);
+		}
+		else
+		{
+			if (!strcmp(emitter_name,"kih"))
+			{
+				RHBkernel_emitter emitter(r);
+
+				emitter.generate(&out,root_idl);
+			}
+			else
+			{
+				if (!strcmp(emitter_name,"api"))
+				{
+					RHBapi_emitter emitter(r);
+
+					emitter.generate(&out,root_idl);
+				}
+				else
+				{
+					RHBheader_emitter emitter(r);
+
+					emitter.cplusplus=0;
+					emitter.internal=0;
+					emitter.testonly=0;
+
+					if (0==strcmp(emitter_name,"ih"))
+					{
+						emitter.internal=1;
+					}
+		
+					if (0==strcmp(emitter_name,"xih"))
+					{
+						emitter.internal=1;
+						emitter.cplusplus=1;
+					}
+
+					if (0==strcmp(emitter_name,"xh"))
+					{
+						emitter.cplusplus=1;
+					}
+
+					emitter.generate(&out,root_idl);
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+/* with several emitters the output name is a stem, each
+	emitter writes its own extension on to it */
+
+static void output_name(
+	char *buf,
+	size_t buflen,
+	const char *output_filename,
+	const char *emitter_name,
+	size_t count)
+{
+	size_t n=strlen(output_filename);
+
+	if (count > 1)
+	{
+		size_t k=n;
+
+		while (k--)
+		{
+			char c=output_filename[k];
+
+			if ((c=='/')
+#if defined(_WIN32) || defined(_PLATFORM_OS2_)
+				||(c=='\\')||(c==':')
+#endif
+				)
+			{
+				break;
+			}
+
+			if (c=='.')
+			{
+				n=k;
+				break;
+			}
+		}
+
+		snprintf(buf,buflen,"%.*s.%s",(int)n,output_filename,emitter_name);
+	}
+	else
+	{
+		strncpy(buf,output_filename,buflen);
+		buf[buflen-1]=0;
+	}
+}
+
 static int do_emit(
 	modifier_arg * /* mod_list */ ,
-	const char *emitter_name,
+	const char *emitter_list,
 	const char *output_filename,
+	int jobs,
 	int argc,
 	char **argv)
 {
 	int rc=1;
-	static const char *valid_emitter[]={
-		"xh","xih","h","ih","api","kih","ir","tc"
-	};
-	int i=sizeof(valid_emitter)/sizeof(valid_emitter[0]);
+	const char *emitter_name[MAX_EMITTERS];
+	char emitter_buf[64];
+	size_t count=0;
+
+	/* emitters may be given together as in "-sh;ih", the
+		source is then parsed once and each emitter run over it */
+
+	strncpy(emitter_buf,emitter_list,sizeof(emitter_buf));
+	emitter_buf[sizeof(emitter_buf)-1]=0;
 
-	while (i--)
 	{
-		if (!strcmp(emitter_name,valid_emitter[i]))
+		char *p=emitter_buf;
+
+		while (*p)
 		{
-			break;
+			char *q=p;
+			int i=MAX_EMITTERS;
+
+			while (*q && (*q!=';') && (*q!=','))
+			{
+				q++;
+			}
+
+			if (*q)
+			{
+				*q++=0;
+			}
+
+			if (*p)
+			{
+				while (i--)
+				{
+					if (!strcmp(p,valid_emitter[i]))
+					{
+						break;
+					}
+				}
+
+				if (i < 0)
+				{
+					fprintf(stderr,"Unknown emitter %s\n",p);
+					return 1;
+				}
+
+				if (count==MAX_EMITTERS)
+				{
+					fprintf(stderr,"Too many emitters\n");
+					return 1;
+				}
+
+				emitter_name[count++]=valid_emitter[i];
+			}
+
+			p=q;
 		}
 	}
 
-	if (i < 0)
+	if (!count)
+	{
+		fprintf(stderr,"Unknown emitter %s\n",emitter_list);
+		return 1;
+	}
+
+	if ((count > 1) && !output_filename)
 	{
-		fprintf(stderr,"Unknown emitter %s\n",emitter_name);
+		fprintf(stderr,"An output file is required for more than one emitter\n");
 		return 1;
 	}
 
@@ -169,76 +354,89 @@ static int do_emit(
 		}
 		else
 		{
+			size_t i=0;
+			char buf[1024];
+
 			rc=0;
 
-			if (!strcmp(emitter_name,"ir"))
-			{
-				boolean old_emit=default_emitflag;
-				default_emitflag=1;
-				RHBir_file out(output_filename);
-		/*		printf("This should be the IR generator\n",buf);*/
-				RHBir_emitter emitter(&r,&out);
-				emitter.generate(&out,root_idl);
-#ifdef _PLATFORM_MACINTOSH_
-				fsetfileinfo(buf,SOMIR_CREATOR,SOMIR_TYPE);
-#endif
-				default_emitflag=old_emit;
-			}
-			else
+#ifdef _PLATFORM_UNIX_
+			/* the emitters only read the parsed tree, so each
+				child gets it copy-on-write without reparsing */
+
+			if ((jobs > 1) && (count > 1))
 			{
-				RHBtextfile out(output_filename);
+				int running=0;
 
-				if (!strcmp(emitter_name,"tc"))
-				{
-					RHBtc_emitter emitter(&r);
+				fflush(stdout);
+				fflush(stderr);
 
-					emitter.generate(&out,root_idl);
-				}
-				else
+				while ((i < count) || running)
 				{
-					if (!strcmp(emitter_name,"kih"))
-					{
-						RHBkernel_emitter emitter(&r);
+					int s=0;
 
-						emitter.generate(&out,root_idl);
-					}
-					else
+					if ((i < count) && (running < jobs))
 					{
-						if (!strcmp(emitter_name,"api"))
+						pid_t pid;
+
+						output_name(buf,sizeof(buf),output_filename,emitter_name[i],count);
+
+						pid=fork();
+
+						if (pid==0)
 						{
-							RHBapi_emitter emitter(&r);
+							int child_rc=emit_one(&r,root_idl,emitter_name[i],buf);
+							fflush(stdout);
+							fflush(stderr);
+							_exit(child_rc);
+						}
 
-							emitter.generate(&out,root_idl);
+						if (pid==-1)
+						{
+							perror("fork");
+							rc=1;
+							i=count;
 						}
 						else
 						{
-							RHBheader_emitter emitter(&r);
+							running++;
+							i++;
+						}
 
-							emitter.cplusplus=0;
-							emitter.internal=0;
-							emitter.testonly=0;
+						continue;
+					}
 
-							if (0==strcmp(emitter_name,"ih"))
-							{
-								emitter.internal=1;
-							}
-				
-							if (0==strcmp(emitter_name,"xih"))
-							{
-								emitter.internal=1;
-								emitter.cplusplus=1;
-							}
+					if (wait(&s)==-1)
+					{
+						perror("wait");
+						rc=1;
+						break;
+					}
 
-							if (0==strcmp(emitter_name,"xh"))
-							{
-								emitter.cplusplus=1;
-							}
+					running--;
 
-							emitter.generate(&out,root_idl);
-						}
+					if (!WIFEXITED(s) || WEXITSTATUS(s))
+					{
+						rc=1;
 					}
 				}
 			}
+#endif
+
+			while ((i < count) && !rc)
+			{
+				if (output_filename)
+				{
+					output_name(buf,sizeof(buf),output_filename,emitter_name[i],count);
+
+					rc=emit_one(&r,root_idl,emitter_name[i],buf);
+				}
+				else
+				{
+					rc=emit_one(&r,root_idl,emitter_name[i],NULL);
+				}
+
+				i++;
+			}
 		}
 
 		r.destroy();
@@ -377,6 +575,7 @@ int main(int argc,char **argv)
 	int i=0;
 	const char *emitter_name=NULL;
 	const char *output_filename=NULL;
+	int jobs=1;
 #if defined(HAVE_SIGNAL_H) && defined(SIG_BLOCK)
 	sigset_t sigs;
 	sigfillset(&sigs);
@@ -485,8 +684,30 @@ int main(int argc,char **argv)
 								}
 								else
 								{
-									fprintf(stderr,"%s: Unknown switch \'%s\'\n",appname,p);
-									return 1;
+									if ((p[1]=='j'))
+									{
+										if (p[2])
+										{
+											jobs=atoi(p+2);
+											drop=1;
+										}
+										else
+										{
+											jobs=argv[i+1] ? atoi(argv[i+1]) : 0;
+											drop=2;
+										}
+
+										if (jobs < 1)
+										{
+											fprintf(stderr,"%s: bad job count \'%s\'\n",appname,p);
+											return 1;
+										}
+									}
+									else
+									{
+										fprintf(stderr,"%s: Unknown switch \'%s\'\n",appname,p);
+										return 1;
+									}
 								}
 							}
 						}
@@ -521,7 +742,7 @@ int main(int argc,char **argv)
 			return 1;
 		}
 
-		i=do_emit(a.mods,emitter_name,output_filename,argc,argv);
+		i=do_emit(a.mods,emitter_name,output_filename,jobs,argc,argv);
 	}
 
 #if defined(_WIN32) && defined(_DEBUG) && (_MSC_VER >= 1200) && !defined(_WIN32_WCE) && !defined(_WIN64)
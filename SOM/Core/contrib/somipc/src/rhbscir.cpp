@@ -722,6 +722,7 @@ RHBir_file::RHBir_file(const char *name)
 
 	freeListItems=NULL;
 	fileLength=0;
+	indexOffset=0;
 
 	fp=fopen(name,rdwr_mode);
 
@@ -783,6 +784,8 @@ boolean RHBir_emitter::generate(RHBoutput *,const char *f)
 	irRepository.update_modifiers();
 	irRepository.update_depends();
 
+	irFile->write_index();
+
 	return 1;
 }
 
@@ -950,6 +953,11 @@ boolean RHBir_file::load()
 	rootContainer=r.read_long();
 	long freeList=r.read_long();
 
+	r.read_long();
+	r.read_long();
+	r.read_long();
+	indexOffset=r.read_long();
+
 	if ((magic1==kSOMIR_Magic1)
 		&&
 		(magic2==kSOMIR_Magic2))
@@ -1346,7 +1354,6 @@ void RHBir_file::free(long off,long
 #endif
 					  )
 {
-	long write_off=kSOMIR_free_root;
 	long len=0;
 
 	SOMIPC_ASSERT(typ!=kSOMIR_Empty);
@@ -1370,6 +1377,12 @@ void RHBir_file::free(long off,long
 /*		fprintf(stderr,"freeing %ld bytes\n",len);*/
 	}
 
+	release(off,len);
+}
+
+void RHBir_file::release(long off,long len)
+{
+	long write_off=kSOMIR_free_root;
 	SOMIR_record r;
 
 	r.write_long(kSOMIR_Empty);
@@ -1574,6 +1587,346 @@ long RHBir_file::alloc(long len,
 	return retVal;
 }
 
+/* id index, see somirfmt.h for the layout, rebuilt from the whole
+	file after each update as other IDL files share the repository */
+
+static unsigned long SOMIR_index_hash(const char *id,unsigned long seed)
+{
+	unsigned long h=(kSOMIR_IndexBasis ^ seed) & 0xffffffffUL;
+
+	while (*id)
+	{
+		h^=(octet)*id++;
+		h=(h*kSOMIR_IndexPrime) & 0xffffffffUL;
+	}
+
+	return h;
+}
+
+class SOMIR_index
+{
+public:
+	struct entry
+	{
+		char *id;
+		long offset,type,parent;
+		unsigned long slot,next;
+	};
+
+	unsigned long count,alloc;
+	entry *entries;
+
+	SOMIR_index() : count(0),alloc(0),entries(NULL)
+	{
+	}
+
+	~SOMIR_index()
+	{
+		unsigned long i=count;
+
+		while (i--)
+		{
+			delete [] entries[i].id;
+		}
+
+		if (entries) delete [] entries;
+	}
+
+	long add(char *id,long offset,long type,long parent)
+	{
+		if (count==alloc)
+		{
+			unsigned long n=alloc ? (alloc << 1) : 256;
+			entry *p=new entry[n];
+
+			if (count) memcpy(p,entries,count*sizeof(entries[0]));
+			if (entries) delete [] entries;
+
+			entries=p;
+			alloc=n;
+		}
+
+		entries[count].id=id;
+		entries[count].offset=offset;
+		entries[count].type=type;
+		entries[count].parent=parent;
+		entries[count].slot=0;
+		entries[count].next=0;
+
+		return (long)count++;
+	}
+
+	/* hash and displace, biggest buckets first, single entries
+		then go straight into whatever slots are left */
+
+	boolean place(long *disp,unsigned long buckets)
+	{
+		unsigned long n=count;
+		unsigned long *first=new unsigned long[buckets];
+		unsigned long *sizes=new unsigned long[buckets];
+		unsigned long *slots=new unsigned long[n];
+		boolean *taken=new boolean[n];
+		unsigned long i,b,size,maxSize=0,freeSlot=0;
+		boolean ok=1;
+
+		for (b=0; b < buckets; b++)
+		{
+			first[b]=n;
+			sizes[b]=0;
+			disp[b]=0;
+		}
+
+		for (i=0; i < n; i++)
+		{
+			b=SOMIR_index_hash(entries[i].id,0) % buckets;
+
+			taken[i]=0;
+			entries[i].next=first[b];
+			first[b]=i;
+
+			if (++sizes[b] > maxSize) maxSize=sizes[b];
+		}
+
+		for (size=maxSize; ok && (size > 1); size--)
+		{
+			for (b=0; ok && (b < buckets); b++)
+			{
+				long d;
+
+				if (sizes[b]!=size) continue;
+
+				for (d=1; d < 0x100000; d++)
+				{
+					unsigned long k=0;
+
+					for (i=first[b]; i < n; i=entries[i].next)
+					{
+						unsigned long s=SOMIR_index_hash(entries[i].id,d) % n;
+						unsigned long m=0;
+
+						if (taken[s]) break;
+
+						while ((m < k) && (slots[m]!=s)) m++;
+
+						if (m < k) break;
+
+						slots[k++]=s;
+					}
+
+					if (i >= n) break;
+				}
+
+				if (d==0x100000)
+				{
+					ok=0;
+				}
+				else
+				{
+					disp[b]=d;
+
+					for (i=first[b]; i < n; i=entries[i].next)
+					{
+						entries[i].slot=SOMIR_index_hash(entries[i].id,d) % n;
+						taken[entries[i].slot]=1;
+					}
+				}
+			}
+		}
+
+		for (b=0; ok && (b < buckets); b++)
+		{
+			if (sizes[b]==1)
+			{
+				while (taken[freeSlot]) freeSlot++;
+
+				i=first[b];
+				entries[i].slot=freeSlot;
+				taken[freeSlot]=1;
+				disp[b]=-(long)(freeSlot+1);
+			}
+		}
+
+		delete [] first;
+		delete [] sizes;
+		delete [] slots;
+		delete [] taken;
+
+		return ok;
+	}
+};
+
+boolean RHBir_file::index_container(SOMIR_index *ix,long offset,const char *prefix,long parent)
+{
+	SOMIR_record r;
+	long n;
+
+	if (!offset) return 1;
+
+	r.load(this,offset);
+
+	r.read_long();
+
+	if (r.read_long()!=kSOMIR_Container) return 0;
+
+	n=r.read_long();
+
+	while (n-- > 0)
+	{
+		long off=r.read_long();
+		long typ=r.read_long();
+		const char *name=r.read_string();
+		size_t len;
+		char *id;
+		long entry;
+
+		if (!name) return 0;
+
+		len=strlen(name)+1+(prefix ? strlen(prefix)+2 : 0);
+		id=new char[len];
+
+		if (prefix)
+		{
+			snprintf(id,len,"%s::%s",prefix,name);
+		}
+		else
+		{
+			memcpy(id,name,len);
+		}
+
+		entry=ix->add(id,off,typ,parent);
+
+		switch (typ)
+		{
+		case kSOMIR_InterfaceDef:
+		case kSOMIR_ModuleDef:
+		case kSOMIR_OperationDef:
+			{
+				SOMIR_record c;
+
+				c.load(this,off);
+
+				SOMIR_Contained cnd(&c);
+
+				if (!index_container(ix,cnd.contentsOffset(),id,entry)) return 0;
+			}
+			break;
+		}
+	}
+
+	return 1;
+}
+
+void RHBir_file::write_index(void)
+{
+	SOMIR_index ix;
+	SOMIR_record r;
+
+	if (indexOffset)
+	{
+		octet buf[8];
+		long len,typ;
+
+		seek(indexOffset);
+		read(buf,sizeof(buf));
+
+		len=(((long)buf[0])<<24)|(((long)buf[1])<<16)|(((long)buf[2])<<8)|((long)buf[3]);
+		typ=(((long)buf[4])<<24)|(((long)buf[5])<<16)|(((long)buf[6])<<8)|((long)buf[7]);
+
+		if ((typ==kSOMIR_Index) && (len >= 12))
+		{
+			release(indexOffset,len);
+		}
+
+		indexOffset=0;
+	}
+
+	if (index_container(&ix,rootContainer,NULL,-1) && ix.count)
+	{
+		unsigned long buckets=(ix.count+3)/4;
+		long *disp=new long[buckets];
+
+		if (ix.place(disp,buckets))
+		{
+			unsigned long *bySlot=new unsigned long[ix.count];
+			unsigned long i;
+			long pool=0;
+			long len,off,idOffset,master,freeList;
+
+			for (i=0; i < ix.count; i++)
+			{
+				bySlot[ix.entries[i].slot]=i;
+				pool+=(long)strlen(ix.entries[i].id)+1;
+			}
+
+			len=kSOMIR_IndexHeader+(4*buckets)+(kSOMIR_IndexEntry*ix.count)+pool;
+
+			off=alloc(len,__FILE__,__LINE__);
+
+			{
+				SOMIR_record hdr;
+
+				hdr.load(this,0);
+				hdr.read_long();
+				hdr.read_long();
+				master=hdr.read_long();
+				freeList=hdr.read_long();
+			}
+
+			r.fileOffset=off;
+
+			r.write_long(len);
+			r.write_long(kSOMIR_Index);
+			r.write_long(fileLength);
+			r.write_long(master);
+			r.write_long(freeList);
+			r.write_long((long)ix.count);
+			r.write_long((long)buckets);
+
+			for (i=0; i < buckets; i++)
+			{
+				r.write_long(disp[i]);
+			}
+
+			idOffset=kSOMIR_IndexHeader+(4*buckets)+(kSOMIR_IndexEntry*ix.count);
+
+			for (i=0; i < ix.count; i++)
+			{
+				SOMIR_index::entry *e=ix.entries+bySlot[i];
+
+				r.write_long(idOffset);
+				r.write_long(e->offset);
+				r.write_long(e->type);
+				r.write_long((e->parent < 0) ? -1 : (long)ix.entries[e->parent].slot);
+
+				idOffset+=(long)strlen(e->id)+1;
+			}
+
+			for (i=0; i < ix.count; i++)
+			{
+				const char *id=ix.entries[bySlot[i]].id;
+
+				r.write(id,strlen(id)+1);
+			}
+
+			SOMIPC_ASSERT(r._length==(unsigned long)len);
+
+			r.save(this);
+
+			indexOffset=off;
+
+			delete [] bySlot;
+		}
+
+		delete [] disp;
+	}
+
+	r.empty();
+	r.write_long(indexOffset);
+
+	seek(kSOMIR_index_root);
+	write(r._buffer,r._length);
+}
+
 void SOMIR_element::write_element_record(SOMIR_record *r)
 {
 	long type=_get_SOMIR_type();
@@ -35,7 +35,7 @@ long freeList=start of free chain
 long unknown=
 long unknown
 long unknown=0x30FC1200/0x31FF3E27= date stamp of emitter?
-long unknown
+long indexOffset=offset of id index record, zero in older files
 
 example headers
 
@@ -147,6 +147,39 @@ if (kind != -1)
 	}
 }
 
+Index
+=====
+written by this emitter after every update so a reader can map the
+file and go from a repository id straight to its record, the counts
+and offsets let a reader tell when another tool has since changed
+the file, in which case the index is ignored
+
+long lengthOfRecord
+long type=13
+long fileLength
+long rootOffset
+long freeList
+long nEntries
+long nBuckets
+long displacement[nBuckets]
+struct
+{
+	long idOffset;			start of id within this record
+	long recordOffset;		the Contained record
+	long type;
+	long parent;			entry of the container, -1 for the root
+} entries[nEntries]
+char ids[]					without leading "::", each nul terminated
+
+the index is a minimal perfect hash, h(id,seed) is 32 bit FNV-1a
+starting from (basis ^ seed), displacement[h(id,0) % nBuckets] is
+
+	0		no such id
+	d < 0	id is at entries[-d-1]
+	d > 0	id is at entries[h(id,d) % nEntries]
+
+and the id at that entry must still be compared
+
 Empty
 =====
 long lengthOfRecord
@@ -322,7 +355,15 @@ case OperationDef:
 #define kSOMIR_Empty			10
 #define kSOMIR_Contained		11
 
+#define kSOMIR_Index			13
+
 #define kSOMIR_free_root		12
+#define kSOMIR_index_root		28
+
+#define kSOMIR_IndexHeader		28
+#define kSOMIR_IndexEntry		16
+#define kSOMIR_IndexBasis		2166136261UL
+#define kSOMIR_IndexPrime		16777619UL
 #define kSOMIR_free_next		8
 
 #ifndef __cplusplus
@@ -505,7 +546,7 @@ struct SOMIRheader
 	long unknown1;
 	long unknown2;
 	long timeStamp;
-	long zero2;
+	long indexOffset;
 };
 
 struct SOMIR_Repository
@@ -532,6 +573,10 @@ struct SOMIRfile
 	struct SOMIRheader header;
 	struct SOMIR_ContainerData containerData;
 	rhbatomic_t usage;
+	const octet *map;				/* whole file, read-only */
+	unsigned long mapLength;
+	const octet *index;				/* index record within map */
+	unsigned long indexLength,indexEntries,indexBuckets;
 	char name[1];
 };
 
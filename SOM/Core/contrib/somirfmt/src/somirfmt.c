@@ -37,6 +37,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 #include <rhbsomir.h>
 #include <somtcint.h>
 
@@ -61,6 +65,8 @@ static long read_long(struct SOMIR_read_data *data)
 			(buf[3]) ) : -1L;
 }
 
+static struct SOMIR_read_stream_vtbl mapped_read_vtbl;
+
 static char *read_string(struct SOMIR_read_data *data)
 {
 	long len=data->lpVtbl->read_long(data);
@@ -70,6 +76,26 @@ static char *read_string(struct SOMIR_read_data *data)
 	{
 		data->stream->lpVtbl->read(data->stream,NULL,1);
 	}
+	else if (data->stream->lpVtbl==&mapped_read_vtbl)
+	{
+		/* the file is mapped and strings are stored nul terminated,
+			so refer to it where it is */
+		struct SOMIR_read_stream_buffer *buf=(void *)data->stream;
+
+		p=(char *)buf->data._buffer+buf->data._length;
+
+		if ((len < 0) || 
+			((buf->data._length+len) > buf->data._maximum) ||
+			p[len-1])
+		{
+			p=data->allocator->lpVtbl->alloc(data->allocator,len,1);
+			data->stream->lpVtbl->read(data->stream,p,len);
+		}
+		else
+		{
+			data->stream->lpVtbl->read(data->stream,NULL,len);
+		}
+	}
 	else
 	{
 		p=data->allocator->lpVtbl->alloc(data->allocator,len,1);
@@ -1234,6 +1260,32 @@ static struct SOMIR_read_stream_vtbl buffer_read_vtbl={
 	read_buffer_read
 };
 
+/* same as above but the data is in the file mapping, not our own */
+
+static struct SOMIR_read_stream_vtbl mapped_read_vtbl={
+	read_buffer_read
+};
+
+static long peek_long(const octet *p)
+{
+	return (long)((((unsigned long)p[0])<<24)|
+				  (((unsigned long)p[1])<<16)|
+				  (((unsigned long)p[2])<<8)|
+				  ((unsigned long)p[3]));
+}
+
+static void release_record(struct SOMIR_read_stream_buffer *buffer)
+{
+	octet *p=buffer->data._buffer;
+
+	buffer->data._buffer=NULL;
+
+	if (p && (buffer->stream.lpVtbl!=&mapped_read_vtbl))
+	{
+		SOMFree(p);
+	}
+}
+
 static long read_record(
 	struct SOMIR_read_stream_buffer *buffer,
 	struct SOMIRfile *file,
@@ -1246,6 +1298,22 @@ static long read_record(
 
 	buffer->data._length=0;
 
+	if ((!buffer->stream.lpVtbl) && file->map)
+	{
+		if ((record > 0) && (((unsigned long)record+4) <= file->mapLength))
+		{
+			long length=peek_long(file->map+record);
+
+			if ((length >= 4) && 
+				(((unsigned long)length) <= (file->mapLength-record)))
+			{
+				buffer->stream.lpVtbl=&mapped_read_vtbl;
+				buffer->data._maximum=length;
+				buffer->data._buffer=(octet *)file->map+record;
+			}
+		}
+	}
+
 	if (!buffer->stream.lpVtbl)
 	{
 		long length;
@@ -1696,25 +1764,13 @@ struct SOMIR_Acquire
 RHBOPT_cleanup_begin(SOMIR_Acquire_cleanup,pv)
 struct SOMIR_Acquire *data=pv;
 
-	if (data->mainRecord.data._buffer)
-	{
-		SOMFree(data->mainRecord.data._buffer);
-	}
+	release_record(&data->mainRecord);
 
-	if (data->modifiersRecord.data._buffer)
-	{
-		SOMFree(data->modifiersRecord.data._buffer);
-	}
+	release_record(&data->modifiersRecord);
 
-	if (data->containerRecord.data._buffer)
-	{
-		SOMFree(data->containerRecord.data._buffer);
-	}
+	release_record(&data->containerRecord);
 
-	if (data->descendantsRecord.data._buffer)
-	{
-		SOMFree(data->descendantsRecord.data._buffer);
-	}
+	release_record(&data->descendantsRecord);
 
 	if (data->allocator.data._buffer)
 	{
@@ -2515,10 +2571,14 @@ static void irDetach(struct SOMIRfile *somThis)
 	}
 }
 
+static void irUnmap(struct SOMIRfile *somThis);
+
 static void irDestroy(struct SOMIRfile *somThis)
 {
 	irDetach(somThis);
 
+	irUnmap(somThis);
+
 #ifdef _WIN32
 	if (somThis->fd!=INVALID_HANDLE_VALUE)
 	{
@@ -2576,10 +2636,7 @@ RHBOPT_cleanup_begin(SOMIR_RepositoryInit_cleanup,pv)
 
 struct SOMIR_RepositoryInit *data=pv;
 
-	if (data->mainRecord.data._buffer)
-	{
-		SOMFree(data->mainRecord.data._buffer);
-	}
+	release_record(&data->mainRecord);
 
 RHBOPT_cleanup_end
 
@@ -2621,7 +2678,7 @@ static boolean SOMIR_RepositoryInit(struct SOMIRfile *file,struct SOMIR_Containe
 		file->header.unknown1=reader.lpVtbl->read_long(&reader);
 		file->header.unknown2=reader.lpVtbl->read_long(&reader);
 		file->header.timeStamp=reader.lpVtbl->read_long(&reader);
-		file->header.zero2=reader.lpVtbl->read_long(&reader);
+		file->header.indexOffset=reader.lpVtbl->read_long(&reader);
 
 		if ((file->header.magic1==kSOMIR_Magic1)
 			&&(file->header.magic2==kSOMIR_Magic2)
@@ -2881,11 +2938,245 @@ static struct SOMIR_ContainedData *container_lookup(struct SOMIR_ContainerData *
 	return retVal;
 }
 
+static unsigned long index_hash(const char *id,unsigned long seed)
+{
+	unsigned long h=(kSOMIR_IndexBasis ^ seed) & 0xffffffffUL;
+
+	while (*id)
+	{
+		h^=(octet)*id++;
+		h=(h*kSOMIR_IndexPrime) & 0xffffffffUL;
+	}
+
+	return h;
+}
+
+/* entry number for the id, or -1 */
+
+static long index_find(struct SOMIRfile *file,const char *id)
+{
+	const octet *ix=file->index;
+	unsigned long h=index_hash(id,0);
+	long d=peek_long(ix+kSOMIR_IndexHeader+(4*(h % file->indexBuckets)));
+	unsigned long entry;
+	long idOffset;
+
+	if (!d) return -1;
+
+	entry=(d < 0) ? (unsigned long)(-(d+1)) : (index_hash(id,d) % file->indexEntries);
+
+	if (entry >= file->indexEntries) return -1;
+
+	idOffset=peek_long(ix+kSOMIR_IndexHeader+(4*file->indexBuckets)+(kSOMIR_IndexEntry*entry));
+
+	if ((idOffset <= 0) || ((unsigned long)idOffset >= file->indexLength)) return -1;
+
+	{
+		const char *p=(const char *)ix+idOffset;
+		const char *e=(const char *)ix+file->indexLength;
+
+		while ((p < e) && *id && (*p==*id))
+		{
+			p++;
+			id++;
+		}
+
+		if ((p==e) || *p || *id) return -1;
+	}
+
+	return (long)entry;
+}
+
+/* acquire each enclosing container down from the root as
+	container_lookup does, but by offset rather than by name */
+
+static struct SOMIR_ContainedData *index_lookup(struct SOMIRfile *file,const char *id)
+{
+	struct SOMIR_ContainerData *somThis=&file->containerData;
+	struct SOMIR_ContainedData *retVal=NULL;
+	long chain[32];
+	int depth=0;
+	long nesting=0;
+	long entry;
+
+	SOMIR_ASSERT_LOCKED
+
+	while (*id==':') id++;
+
+	entry=index_find(file,id);
+
+	while ((entry >= 0) && (depth < (int)(sizeof(chain)/sizeof(chain[0]))))
+	{
+		const octet *e=file->index+kSOMIR_IndexHeader+
+				(4*file->indexBuckets)+(kSOMIR_IndexEntry*entry);
+
+		chain[depth++]=entry;
+
+		entry=peek_long(e+12);
+
+		if (entry >= (long)file->indexEntries) return NULL;
+	}
+
+	if (entry >= 0) return container_lookup(somThis,id);
+
+	while (depth--)
+	{
+		const octet *e=file->index+kSOMIR_IndexHeader+
+				(4*file->indexBuckets)+(kSOMIR_IndexEntry*chain[depth]);
+		struct SOMIR_ContainerData *cnr;
+
+		retVal=somThis->lpVtbl->Acquire(somThis,peek_long(e+4),peek_long(e+8));
+
+		if ((!retVal) || !depth) break;
+
+		cnr=retVal->lpVtbl->IsContainer(retVal);
+
+		if (!cnr)
+		{
+			retVal->lpVtbl->Release(retVal);
+			retVal=NULL;
+
+			break;
+		}
+
+		somThis=cnr;
+
+		nesting++;
+
+		retVal=NULL;
+	}
+
+	while (nesting--)
+	{
+		struct SOMIR_ContainedData *cnd=somThis->defined_in;
+		somThis=cnd->defined_in;
+		cnd->lpVtbl->Release(cnd);
+	}
+
+	return retVal;
+}
+
 static struct SOMIR_ContainedData *irLookup(struct SOMIRfile *file,const char *id)
 {
+	if (file->index)
+	{
+		return index_lookup(file,id);
+	}
+
 	return container_lookup(&file->containerData,id);
 }
 
+/* map the whole file, if it carries an index that still matches
+	the file then lookups go through that */
+
+static void irMap(struct SOMIRfile *somThis)
+{
+	unsigned long length=0;
+	const octet *ix=NULL;
+
+#ifdef _WIN32
+	if (somThis->fd!=INVALID_HANDLE_VALUE)
+	{
+		DWORD high=0;
+		DWORD low=GetFileSize(somThis->fd,&high);
+
+		if ((low!=0xFFFFFFFFUL) && !high && (low > sizeof(somThis->header)))
+		{
+			HANDLE h=CreateFileMapping(somThis->fd,NULL,PAGE_READONLY,0,0,NULL);
+
+			if (h)
+			{
+				void *pv=MapViewOfFile(h,FILE_MAP_READ,0,0,0);
+
+				CloseHandle(h);
+
+				if (pv)
+				{
+					somThis->map=pv;
+					length=low;
+				}
+			}
+		}
+	}
+#else
+#	ifdef HAVE_MMAP
+	if (somThis->fd!=-1)
+	{
+		off_t len=lseek(somThis->fd,0,SEEK_END);
+
+		somThis->fileOffset=-1L;
+
+		if ((len > (off_t)sizeof(somThis->header)) && (len==(off_t)(unsigned long)len))
+		{
+			void *pv=mmap(NULL,(size_t)len,PROT_READ,MAP_SHARED,somThis->fd,0);
+
+			if (pv!=MAP_FAILED)
+			{
+				somThis->map=pv;
+				length=(unsigned long)len;
+			}
+		}
+	}
+#	endif
+#endif
+
+	somThis->mapLength=length;
+
+	if (somThis->map && (somThis->header.indexOffset > 0))
+	{
+		unsigned long off=(unsigned long)somThis->header.indexOffset;
+
+		if ((off+kSOMIR_IndexHeader) <= length)
+		{
+			ix=somThis->map+off;
+		}
+	}
+
+	if (ix)
+	{
+		unsigned long ixLength=(unsigned long)peek_long(ix);
+		long entries=peek_long(ix+20);
+		long buckets=peek_long(ix+24);
+
+		if ((ixLength <= (length-(unsigned long)(ix-somThis->map))) &&
+			(peek_long(ix+4)==kSOMIR_Index) &&
+			((unsigned long)peek_long(ix+8)==length) &&
+			(peek_long(ix+12)==somThis->header.masterOffset) &&
+			(peek_long(ix+16)==somThis->header.freeList) &&
+			(entries > 0) && (buckets > 0) &&
+			(entries < 0x1000000) && (buckets < 0x1000000) &&
+			((kSOMIR_IndexHeader+(4*(unsigned long)buckets)+
+					(kSOMIR_IndexEntry*(unsigned long)entries)) <= ixLength))
+		{
+			somThis->index=ix;
+			somThis->indexLength=ixLength;
+			somThis->indexEntries=entries;
+			somThis->indexBuckets=buckets;
+		}
+	}
+}
+
+static void irUnmap(struct SOMIRfile *somThis)
+{
+	const octet *map=somThis->map;
+
+	somThis->map=NULL;
+	somThis->index=NULL;
+
+	if (map)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile((void *)map);
+#else
+#	ifdef HAVE_MMAP
+		munmap((void *)map,somThis->mapLength);
+#	endif
+#endif
+	}
+
+	somThis->mapLength=0;
+}
+
 static void irRelease(struct SOMIRfile *file)
 {
 	file->containerData.lpVtbl->Release(&(file->containerData));
@@ -2977,6 +3268,8 @@ struct SOMIRfile *SOMIRopen(struct SOMIR_Repository *repository,
 		{
 			if (SOMIR_RepositoryInit(somThis,&somThis->containerData))
 			{
+				irMap(somThis);
+
 				somThis->repository=repository;
 
 				if (repository->last)
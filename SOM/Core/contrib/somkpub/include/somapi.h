@@ -429,6 +429,8 @@ SOMEXTERN SOM_IMPORTEXPORT_som char * SOMLINK somExceptionId(Environment *ev);
 SOMEXTERN SOM_IMPORTEXPORT_som void * SOMLINK somExceptionValue(Environment *ev);
 SOMEXTERN SOM_IMPORTEXPORT_som void SOMLINK somSetOutChar(somTD_SOMOutCharRoutine *outch);
 SOMEXTERN SOM_IMPORTEXPORT_som SOMClassMgr SOMSTAR SOMLINK somMainProgram(void);
+SOMEXTERN SOM_IMPORTEXPORT_som long SOMLINK somNewObjects(SOMClass SOMSTAR cls,long count,SOMObject SOMSTAR *objs);
+SOMEXTERN SOM_IMPORTEXPORT_som long SOMLINK somPreloadClasses(SOMClassMgr SOMSTAR mgr,const char *manifest);
 SOMEXTERN SOM_IMPORTEXPORT_som SOMClassMgr SOMSTAR SOMLINK somEnvironmentNew(void);
 SOMEXTERN SOM_IMPORTEXPORT_som Environment * SOMLINK somGetGlobalEnvironment(void);
 SOMEXTERN SOM_IMPORTEXPORT_som void SOMLINK somEnvironmentEnd(void);
@@ -791,6 +791,64 @@ boolean SOMLINK tcEqual(TypeCode tc,Environment *ev,TypeCode t)
 	return 1;
 }
 
+/* marshalling plans are kept here keyed by TypeCode rather than in
+	the TypeCode itself, the constant ones live in read-only data */
+
+typedef struct SOMTC_plan SOMTC_plan;
+
+struct SOMTC_plan
+{
+	SOMTC_plan *next;
+	TypeCode tc;
+	somTC_planFree owner;
+	void *plan;
+};
+
+#define SOMTC_PLAN_BUCKETS		64
+#define SOMTC_plan_hash(tc)		((((size_t)(tc))>>4)&(SOMTC_PLAN_BUCKETS-1))
+
+static SOMTC_plan *SOMTC_plans[SOMTC_PLAN_BUCKETS];
+static long SOMTC_plan_count;
+
+static void SOMTC_drop_plans(TypeCode tc)
+{
+	SOMTC_plan *dead=NULL;
+
+	somStartCriticalSection();
+
+	if (SOMTC_plan_count)
+	{
+		SOMTC_plan **h=&SOMTC_plans[SOMTC_plan_hash(tc)];
+
+		while (*h)
+		{
+			SOMTC_plan *p=*h;
+
+			if (p->tc==tc)
+			{
+				*h=p->next;
+				p->next=dead;
+				dead=p;
+				SOMTC_plan_count--;
+			}
+			else
+			{
+				h=&p->next;
+			}
+		}
+	}
+
+	somEndCriticalSection();
+
+	while (dead)
+	{
+		SOMTC_plan *p=dead;
+		dead=p->next;
+		p->owner(p->plan);
+		SOMFree(p);
+	}
+}
+
 void SOMLINK tcFree(TypeCode tc,Environment *ev)
 {
 	RHBOPT_ASSERT(ev)
@@ -843,6 +901,11 @@ void SOMLINK tcFree(TypeCode tc,Environment *ev)
 				break;
 		}
 
+		if (SOMTC_plan_count)
+		{
+			SOMTC_drop_plans(tc);
+		}
+
 		SOMFree(tc);
 	}
 }
@@ -2175,6 +2238,102 @@ SOMEXTERN boolean SOMLINK tcGetZeroOriginEnum(TypeCode t,Environment *ev)
 }
 
 
+SOMEXTERN void * SOMLINK tcGetPlan(TypeCode tc,Environment *ev,somTC_planFree owner)
+{
+	void *plan=NULL;
+
+	RHBSOMTC_unused(ev)
+
+	if (tc && SOMTC_plan_count)
+	{
+		SOMTC_plan *p;
+
+		somStartCriticalSection();
+
+		p=SOMTC_plans[SOMTC_plan_hash(tc)];
+
+		while (p)
+		{
+			if ((p->tc==tc)&&(p->owner==owner))
+			{
+				plan=p->plan;
+				break;
+			}
+
+			p=p->next;
+		}
+
+		somEndCriticalSection();
+	}
+
+	return plan;
+}
+
+/* returns the plan now held for the TypeCode, if another thread got
+	there first then the one given is released and theirs returned */
+
+SOMEXTERN void * SOMLINK tcSetPlan(TypeCode tc,Environment *ev,somTC_planFree owner,void *plan)
+{
+	SOMTC_plan *p;
+	SOMTC_plan *n;
+
+	if (!tc || !owner || !plan)
+	{
+		SOMTC_throw_BadParm(ev);
+
+		return NULL;
+	}
+
+	n=SOMMalloc(sizeof(*n));
+
+	if (!n)
+	{
+		owner(plan);
+
+		return NULL;
+	}
+
+	n->tc=tc;
+	n->owner=owner;
+	n->plan=plan;
+
+	somStartCriticalSection();
+
+	p=SOMTC_plans[SOMTC_plan_hash(tc)];
+
+	while (p)
+	{
+		if ((p->tc==tc)&&(p->owner==owner))
+		{
+			break;
+		}
+
+		p=p->next;
+	}
+
+	if (p)
+	{
+		plan=p->plan;
+	}
+	else
+	{
+		n->next=SOMTC_plans[SOMTC_plan_hash(tc)];
+		SOMTC_plans[SOMTC_plan_hash(tc)]=n;
+		SOMTC_plan_count++;
+		n=NULL;
+	}
+
+	somEndCriticalSection();
+
+	if (n)
+	{
+		owner(n->plan);
+		SOMFree(n);
+	}
+
+	return plan;
+}
+
 #ifdef SOM_RESOLVE_DATA
 	#define SOM_PUBLIC_DATA(x) TypeCode SOMLINK resolve_##x(void) { return (TypeCode)(void *)&x; }
 
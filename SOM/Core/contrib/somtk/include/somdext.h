@@ -84,6 +84,23 @@ SOMEXTERN SOMDEXT_IMPORT int SOMLINK somdStartProcess(Environment *ev,char *path
 SOMEXTERN SOMDEXT_IMPORT SOMObject SOMSTAR SOMLINK somdCreate(Environment *ev,char *clsName,boolean doInit);
 SOMEXTERN SOMDEXT_IMPORT ImplId SOMLINK somdExtractUUID(Environment * ev,ReferenceData * id);
 
+/* task dispatch counters of the ORB, queued is per lane,
+	system threads such as socket selectors, locate requests
+	and then method invocations, times are in milliseconds */
+
+typedef struct SOMD_TaskStats
+{
+	unsigned long threads;
+	unsigned long busy;
+	unsigned long queued[3];
+	unsigned long max_queued;
+	unsigned long completed;
+	unsigned long wait_ms;
+	unsigned long service_ms;
+} SOMD_TaskStats;
+
+SOMEXTERN SOMDEXT_IMPORT void SOMLINK SOMD_QueryTaskStats(Environment *ev,SOMD_TaskStats *stats);
+
 #ifdef SOM_RESOLVE_DATA
 	SOMEXTERN SOMDEXT_IMPORT ORB				SOMSTAR * SOMLINK resolve_SOMD_ORBObject(void);
 	SOMEXTERN SOMDEXT_IMPORT SOMDServer			SOMSTAR * SOMLINK resolve_SOMD_ServerObject(void);
@@ -143,7 +160,8 @@ SOMEXTERN SOMDEXT_IMPORT ImplId SOMLINK somdExtractUUID(Environment * ev,Referen
 					somdGetDefaultObjectKey,send_multiple_requests,get_next_response,\
 					SOMD_DefaultContext,somdCreateDynProxyClass,SOMD_NoORBfree,\
 					SOMD_QueryORBfree,SOMD_FlushInterfaceCache,ORBfree,\
-					somdDaemonReady,somdDaemonRequired,somdCreate
+					somdDaemonReady,somdDaemonRequired,somdCreate,\
+					SOMD_QueryTaskStats
 		#else
 			#pragma import list SOMD_Init,SOMD_Uninit,SOMD_ORBObject,SOMD_ServerObject, \
 					SOMD_ObjectMgr,SOMD_SOMOAObject,SOMD_ImplDefObject,SOMD_ImplRepObject, \
@@ -151,7 +169,8 @@ SOMEXTERN SOMDEXT_IMPORT ImplId SOMLINK somdExtractUUID(Environment * ev,Referen
 					somdGetDefaultObjectKey,send_multiple_requests,get_next_response,\
 					SOMD_DefaultContext,somdCreateDynProxyClass,SOMD_NoORBfree,\
 					SOMD_QueryORBfree,SOMD_FlushInterfaceCache,ORBfree,\
-					somdDaemonReady,somdDaemonRequired,somdCreate
+					somdDaemonReady,somdDaemonRequired,somdCreate,\
+					SOMD_QueryTaskStats
 		#endif
 		#ifdef SOM_DLL_somdcomm
 			#pragma export list SOMD_FreeType
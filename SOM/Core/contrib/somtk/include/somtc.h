@@ -65,6 +65,12 @@ SOM_IMPORTEXPORT_somtc long     SOMLINK tcSetZeroOriginEnum(TypeCode t, Environm
 SOM_IMPORTEXPORT_somtc boolean  SOMLINK tcGetZeroOriginEnum(TypeCode t, Environment *ev);	
 SOM_IMPORTEXPORT_somtc _IDL_SEQUENCE_string SOMLINK tcSeqFromListString(const char *str);
 
+/* private per TypeCode data such as compiled marshalling plans,
+	owner both identifies the user and frees the data with the TypeCode */
+typedef void (SOMLINK *somTC_planFree)(void *plan);
+SOM_IMPORTEXPORT_somtc void *   SOMLINK tcGetPlan(TypeCode tc, Environment *ev, somTC_planFree owner);
+SOM_IMPORTEXPORT_somtc void *   SOMLINK tcSetPlan(TypeCode tc, Environment *ev, somTC_planFree owner, void *plan);
+
 #define TypeCodeNew						tcNew
 #define TypeCodeNewVL(tag,ap)			tcNewVL(tag,ap)
 #define TypeCode_kind(tc,ev)			tcKind(tc,ev)
@@ -100,12 +106,14 @@ SOM_IMPORTEXPORT_somtc _IDL_SEQUENCE_string SOMLINK tcSeqFromListString(const ch
 			#pragma export list tcAlignment,tcNew,tcCopy,tcNewVL, \
 				tcFree,tcKind,tcParmCount,tcParameter,tcSetZeroOriginEnum, \
 				tcPrint,tcSetAlignment,tcSize,tcEqual,tcSequenceNew,tcGetZeroOriginEnum,\
+				tcGetPlan,tcSetPlan,\
 				somVaBuf_create,somVaBuf_get_valist,somVaBuf_destroy,\
 				somVaBuf_add,somvalistGetTarget,somvalistSetTarget
 		#else
 			#pragma import list tcAlignment,tcNew,tcCopy,tcNewVL, \
 				tcFree,tcKind,tcParmCount,tcParameter,tcSetZeroOriginEnum, \
 				tcPrint,tcSetAlignment,tcSize,tcEqual,tcSequenceNew,tcGetZeroOriginEnum,\
+				tcGetPlan,tcSetPlan,\
 				somVaBuf_create,somVaBuf_get_valist,somVaBuf_destroy,\
 				somVaBuf_add,somvalistGetTarget,somvalistSetTarget
 		#endif
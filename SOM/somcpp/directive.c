@@ -209,6 +209,11 @@ void    directive( void)
     macro_line = 0;                         /* Reset error flag     */
     file = infile;                  /* Remember the current file    */
 
+    /* Only #ifndef may open an include guard, nothing may follow it    */
+    if (file->guard_stat == GUARD_CLOSED
+            || (file->guard_stat == GUARD_START && hash != L_ifndef))
+        file->guard_stat = GUARD_NONE;
+
     switch (hash) {
 
     case L_if:
@@ -235,6 +240,8 @@ void    directive( void)
         }
         if (ifptr->stat & ELSE_SEEN)
             goto  else_seen_err;
+        if (ifptr == infile->initif + 1)    /* #elif of the guard   */
+            infile->guard_stat = GUARD_NONE;
         if ((ifptr->stat & (WAS_COMPILING | TRUE_SEEN)) != WAS_COMPILING) {
             compiling = FALSE;              /* Done compiling stuff */
             goto  skip_line;                /* Skip this group      */
@@ -265,6 +272,8 @@ ifdo:
         }
         if (ifptr->stat & ELSE_SEEN)
             goto  else_seen_err;
+        if (ifptr == infile->initif + 1)    /* #else of the guard   */
+            infile->guard_stat = GUARD_NONE;
         ifptr->stat |= ELSE_SEEN;
         ifptr->elseline = src_line;
         if (ifptr->stat & WAS_COMPILING) {
@@ -297,6 +306,8 @@ ifdo:
             mcpp_fprintf( OUT, "/*endif %ld*/\n", src_line);
             /* Show that #if block has ended    */
         }
+        if (ifptr == infile->initif + 1 && infile->guard_stat == GUARD_OPEN)
+            infile->guard_stat = GUARD_CLOSED;  /* End of the guard */
         --ifptr;
         break;
 
@@ -454,6 +465,11 @@ static int  do_if( int hash, const char * directive_name)
             return  FALSE;      /* Next token is not an identifier  */
         }
         found = ((defp = look_id( identifier)) != NULL);    /* Look in table*/
+        if (hash == L_ifndef && infile->guard_stat == GUARD_START
+                && ifptr == infile->initif + 1) {
+            infile->guard = save_string( identifier);
+            infile->guard_stat = GUARD_OPEN;    /* Possible guard   */
+        }
         if (mcpp_debug & MACRO_CALL) {
             if (found)
                 mcpp_fprintf( OUT, "/*%s*/", defp->name);
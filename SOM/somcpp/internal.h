@@ -241,6 +241,8 @@ typedef struct fileinfo {
         const char *    full_fname; /* Real full path list          */
         char *          filename;   /* File/macro name (maybe changed)      */
         char *          buffer;     /* Buffer of current input line */
+        int             guard_stat; /* Include guard detection      */
+        char *          guard;      /* Macro name of include guard  */
 #if MCPP_LIB
         /* Save output functions during push/pop of #includes   */
         int (* last_fputc)  ( int c, OUTDEST od);
@@ -249,6 +251,16 @@ typedef struct fileinfo {
 #endif
 } FILEINFO;
 
+/*
+ * FILEINFO.guard_stat tracks whether a file is wholly enclosed in
+ * #ifndef GUARD ... #endif, so that a later #include of it can be skipped
+ * while GUARD stays defined.
+ */
+#define GUARD_NONE      0           /* Not guarded (or a macro)     */
+#define GUARD_START     1           /* Nothing but white spaces yet */
+#define GUARD_OPEN      2           /* In the #ifndef GUARD group   */
+#define GUARD_CLOSED    3           /* The group ended, expect EOF  */
+
 /*
  * IFINFO stores information of conditional compilation.
  */
@@ -518,6 +530,8 @@ extern int      do_include( int next);
 extern void     add_file( FILE * fp, const char * src_dir
         , const char * filename, const char * fullname, int include_opt);
                 /* Chain the included file      */
+extern void     guard_file( FILEINFO * file);
+                /* Register an include guard    */
 extern void     sharp( FILEINFO * sharp_file, int marker);
                 /* Output # line number         */
 extern void     do_pragma( void);
@@ -679,6 +679,8 @@ static void mcpp_main( void)
 
         if (c == CHAR_EOF)                  /* Exit process at      */
             break;                          /*   end of input       */
+        if (infile->guard_stat != GUARD_OPEN)
+            infile->guard_stat = GUARD_NONE;    /* Not guarded      */
 
         /*
          * If the loop didn't terminate because of end of file, we
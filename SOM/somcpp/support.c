@@ -1577,6 +1577,9 @@ int     get_ch( void)
      */
     infile = file->parent;                  /* Unwind file chain    */
     free( file->buffer);                    /* Free buffer          */
+    if (file->guard_stat == GUARD_CLOSED)   /* Wholly guarded file  */
+        guard_file( file);                  /* Takes file->guard    */
+    free( file->guard);
     if (infile == NULL) {                   /* If at end of input   */
         free( file->filename);
         free( (void *)file->src_dir);
@@ -2284,6 +2287,8 @@ FILEINFO *  get_file(
     file->dirp = NULL;                      /* No include dir yet   */
     file->real_fname = name;                /* Save file/macro name */
     file->full_fname = fullname;            /* Full path list       */
+    file->guard_stat = GUARD_NONE;          /* Not a file (yet)     */
+    file->guard = NULL;
     if (name) {
         file->filename = xmalloc( strlen( name) + 1);
         strcpy( file->filename, name);      /* Copy for #line       */
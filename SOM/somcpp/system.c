@@ -214,6 +214,8 @@ static void     do_once( const char * fullname);
                 /* Process #pragma once             */
 static int      included( const char * fullname);
                 /* The file has been once included? */
+static int      guarded( const char * fullname);
+                /* The file's include guard is defined?     */
 static void     push_or_pop( int direction);
                 /* Push or pop a macro definition   */
 static int      do_prestd_directive( void);
@@ -265,9 +267,25 @@ static INC_LIST *   once_list;          /* Once opened file         */
 static INC_LIST *   once_end;           /* -> active end of once_list   */
 static int          max_once;           /* Number of once_list[]    */
 
+/*
+ * guard_list[] stores the files wholly enclosed in #ifndef GUARD ... #endif
+ * with the name of the GUARD, so re-including them while GUARD is defined
+ * need not reopen nor rescan them.
+ */
+typedef struct guard_list {
+    const char *    name;       /* Full path list of the file       */
+    size_t      len;                    /* Length of 'name'         */
+    char *      guard;          /* Macro name of the include guard  */
+} GUARD_LIST;
+
+static GUARD_LIST * guard_list;         /* Guarded files            */
+static GUARD_LIST * guard_end;          /* -> active end of guard_list  */
+static int          max_guard;          /* Number of guard_list[]   */
+
 #define INIT_NUM_INCLUDE    32          /* Initial number of incdir[]   */
 #define INIT_NUM_FNAMELIST  256         /* Initial number of fnamelist[]    */
 #define INIT_NUM_ONCE       64          /* Initial number of once_list[]    */
+#define INIT_NUM_GUARD      64          /* Initial number of guard_list[]   */
 
 /*
  * 'search_rule' holds searching rule of #include "header.h" to search first
@@ -369,6 +387,7 @@ void    init_system( void)
     sharp_filename = NULL;
     incend = incdir = NULL;
     fnamelist = once_list = NULL;
+    guard_list = NULL;
     search_rule = SEARCH_INIT;
     mb_changed = nflag = ansi = compat_mode = FALSE;
     mkdep_fp = NULL;
@@ -3355,6 +3374,8 @@ static int  open_file(
         return  FALSE;
     if (standard && included( fullname))        /* Once included    */
         goto  true;
+    if (guarded( fullname))         /* Include guard is defined     */
+        goto  true;
 
     if ((max_open != 0 && max_open <= include_nest)
                             /* Exceed the known limit of open files */
@@ -3460,6 +3481,7 @@ void    add_file(
     file = get_file( filename, src_dir, fullname, (size_t) NBUFF, include_opt);
                                         /* file == infile           */
     file->fp = fp;                      /* Better remember FILE *   */
+    file->guard_stat = GUARD_START;     /* Look for include guard   */
     cur_fname = filename;
 
     if (include_nest >= INCLUDE_NEST)   /* Probably recursive #include      */
@@ -4191,6 +4213,71 @@ static int  included(
     return  FALSE;                          /* Not yet included     */
 }
 
+void    guard_file(
+    FILEINFO *  file
+)
+/*
+ * Register the file just finished as guarded by file->guard, of which
+ * guard_list[] takes the ownership.
+ * This routine is called from get_ch() at end of the file.
+ */
+{
+    GUARD_LIST *    gp;
+    size_t      fnamelen;
+
+    fnamelen = strlen( file->full_fname);
+    for (gp = guard_list; gp < guard_end; gp++) {
+        if (gp->len == fnamelen && str_case_eq( gp->name, file->full_fname))
+            return;                         /* Already registered   */
+    }
+    if (guard_list == NULL) {               /* Should initialize    */
+        max_guard = INIT_NUM_GUARD;
+        guard_list = (GUARD_LIST *) xmalloc( sizeof (GUARD_LIST) * max_guard);
+        guard_end = &guard_list[ 0];
+    } else if (guard_end - guard_list >= max_guard) {
+                                            /* Double the elements  */
+        guard_list = (GUARD_LIST *) xrealloc( (void *) guard_list
+                , sizeof (GUARD_LIST) * max_guard * 2);
+        guard_end = &guard_list[ max_guard];
+        max_guard *= 2;
+    }
+    if (mcpp_debug & PATH)
+        mcpp_fprintf( DBG, "Include guard %s of \"%s\"\n", file->guard
+                , file->full_fname);
+    guard_end->name = file->full_fname;     /* Points into fnamelist[]  */
+    guard_end->len = fnamelen;
+    guard_end->guard = file->guard;
+    guard_end++;
+    file->guard = NULL;
+}
+
+static int  guarded(
+    const char *    fullname
+)
+/*
+ * Is the file guarded by a macro which is now defined ?
+ * This routine is only called from open_file().
+ */
+{
+    GUARD_LIST *    gp;
+    size_t      fnamelen;
+
+    if (guard_list == NULL)             /* No guarded file registered   */
+        return  FALSE;
+    fnamelen = strlen( fullname);
+    for (gp = guard_list; gp < guard_end; gp++) {
+        if (gp->len == fnamelen && str_case_eq( gp->name, fullname)) {
+            if (look_id( gp->guard) == NULL)
+                return  FALSE;              /* Guard is undefined   */
+            if (mcpp_debug & PATH)
+                mcpp_fprintf( DBG, "Guarded by %s \"%s\"\n", gp->guard
+                        , fullname);
+            return  TRUE;
+        }
+    }
+    return  FALSE;                          /* Not a guarded file   */
+}
+
 static void push_or_pop(
     int     direction
 )
@@ -4819,6 +4906,7 @@ void    clear_filelist( void)
 {
     const char **   incp;
     INC_LIST *  namep;
+    GUARD_LIST *    gp;
 
     for (incp = incdir; incp < incend; incp++)
         free( (void *) *incp);
@@ -4828,6 +4916,9 @@ void    clear_filelist( void)
     free( (void *) fnamelist);
     if (standard)
         free( (void *) once_list);
+    for (gp = guard_list; gp < guard_end; gp++)
+        free( gp->guard);
+    free( (void *) guard_list);
 }
 #endif
 
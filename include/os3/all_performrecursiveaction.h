@@ -28,6 +28,7 @@
 #define all_RECURSE_NOFILES    0x010 /*!< no files to perform action (callback action code only)*/
 #define all_RECURSE_NODIRS     0x020 /*!< no directories to perform action (callback action code only) */
 #define all_RECURSE_NOSUBDIRS  0x040 /*!< no directories to recurse (callback action code) */
+#define all_RECURSE_PARALLEL   0x080 /*!< process sibling subtrees on several threads (32-bit only) */
 
 int all_PerformRecursiveAction(char *fileMask,int file_options,int fileAttrs,
             int (*action_callback)(char*,char *,int,void *),void *action_callback_data,
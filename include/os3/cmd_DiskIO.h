@@ -0,0 +1,82 @@
+/*!
+   @file cmd_diskio.h
+
+   @brief sector I/O, readahead, parallel scanning and progress reporting
+   for the file system utilities, shared along all command line tools
+
+   (c) osFree Project 2002, <http://www.osFree.org>
+   for licence see licence.txt in root directory, or project website
+*/
+
+#ifndef _CMD_DISKIO_H_
+#define _CMD_DISKIO_H_
+
+/* needs INCL_DOSDEVIOCTL, INCL_DOSPROCESS and INCL_DOSSEMAPHORES, so it is
+   not part of cmd_shared.h; include it after that */
+
+#define cmd_DISK_MAXTRANSFER   128 /*< most sectors read with one IOCtl */
+#define cmd_DISK_READAHEADS    4   /*< readahead regions per volume */
+#define cmd_DISK_MAXTHREADS    8   /*< most threads for cmd_DiskScanGroups */
+#define cmd_PROGRESS_INTERVAL  250 /*< ms between progress updates */
+
+struct _CMDDISK;
+
+/* one background read started by cmd_DiskReadAhead */
+typedef struct _CMDREADAHEAD
+{
+  struct _CMDDISK *pDisk;
+  ULONG  ulSector;          /*< first sector of the region */
+  ULONG  cSectors;          /*< sectors in the region */
+  PBYTE  pbData;            /*< region data, NULL if the slot is free */
+  HEV    hevDone;           /*< posted when the read is done */
+  TID    tid;
+  APIRET rc;                /*< result of the read */
+} CMDREADAHEAD, *PCMDREADAHEAD;
+
+/* volume opened by cmd_DiskOpen */
+typedef struct _CMDDISK
+{
+  HFILE  hDisk;             /*< DASD handle */
+  BOOL   fLocked;           /*< volume is locked */
+  ULONG  cbSector;          /*< bytes per sector */
+  ULONG  cSectorsPerTrack;
+  ULONG  cHeads;
+  ULONG  cSectors;          /*< sectors on the volume */
+  BOOL   fLargeIO;          /*< driver takes multi-track reads */
+  CMDREADAHEAD aReadAhead[cmd_DISK_READAHEADS];
+} CMDDISK, *PCMDDISK;
+
+typedef VOID APIENTRY CMDPROGRESSFN(ULONG ulPercent, PVOID pUser);
+typedef CMDPROGRESSFN *PCMDPROGRESSFN;
+
+/* progress state for cmd_ProgressAdd */
+typedef struct _CMDPROGRESS
+{
+  ULONG  ulTotal;
+  ULONG  ulDone;
+  ULONG  ulShown;           /*< last percentage shown */
+  ULONG  ulLastTime;        /*< ms count when it was shown */
+  PCMDPROGRESSFN pfnShow;
+  PVOID  pUser;
+  HMTX   hmtx;
+} CMDPROGRESS, *PCMDPROGRESS;
+
+typedef APIRET CMDSCANFN(PCMDDISK pDisk, ULONG ulGroup, PVOID pUser);
+typedef CMDSCANFN *PCMDSCANFN;
+
+APIRET cmd_DiskOpen(PSZ pszDrive, BOOL fLock, PCMDDISK pDisk);
+APIRET cmd_DiskRead(PCMDDISK pDisk, ULONG ulSector, ULONG cSectors, PVOID pBuf);
+APIRET cmd_DiskReadAhead(PCMDDISK pDisk, ULONG ulSector, ULONG cSectors);
+VOID   cmd_DiskClose(PCMDDISK pDisk);
+
+APIRET cmd_DiskScanGroups(PCMDDISK pDisk, ULONG cGroups, ULONG cThreads,
+                          PCMDSCANFN pfnScan, PVOID pUser,
+                          PCMDPROGRESS pProgress);
+
+APIRET cmd_ProgressInit(PCMDPROGRESS pProgress, ULONG ulTotal,
+                        PCMDPROGRESSFN pfnShow, PVOID pUser);
+VOID   cmd_ProgressAdd(PCMDPROGRESS pProgress, ULONG ulDone);
+VOID   cmd_ProgressDone(PCMDPROGRESS pProgress);
+VOID APIENTRY cmd_ProgressPrint(ULONG ulPercent, PVOID pUser);
+
+#endif /* _CMD_DISKIO_H_ */
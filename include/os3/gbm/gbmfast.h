@@ -0,0 +1,53 @@
+/*
+
+gbmfast.h - Interface to the fast conversion and scaling paths
+
+Word-at-a-time colour swizzles, 24/32 bpp conversion, error diffusion
+to an RGB cube palette and a separable fixed-point scaler. Large
+bitmaps are split into row bands which run on several threads.
+
+Include gbm.h and gbmscale.h first.
+
+*/
+
+#ifndef GBMFAST_H
+#define GBMFAST_H
+
+#ifdef __cplusplus
+  extern "C"
+  {
+#endif
+
+/* Threads used for row bands: 0 picks one per CPU, 1 disables threading */
+extern void gbm_fast_set_threads(int n);
+
+/* RGB <-> BGR, in place, for 24 and 32 bpp bitmaps */
+extern void gbm_fast_swap_rb(const GBM *gbm, gbm_u8 *data);
+
+/* 24 bpp -> 32 bpp (alpha set to 0xff), and back (alpha dropped).
+   gbm describes the source bitmap. */
+extern void gbm_fast_24_to_32(const GBM *gbm, const gbm_u8 *data24, gbm_u8 *data32);
+extern void gbm_fast_32_to_24(const GBM *gbm, const gbm_u8 *data32, gbm_u8 *data24);
+
+/* Floyd-Steinberg error diffusion of 24 bpp data to an nr x ng x nb
+   colour cube (nr * ng * nb <= 256, each at least 2). Index is
+   (r * ng + g) * nb + b; gbm_fast_errdiff_pal_rgb fills in the palette. */
+extern void        gbm_fast_errdiff_pal_rgb(GBMRGB *gbmrgb, int nr, int ng, int nb);
+extern gbm_boolean gbm_fast_errdiff_rgb(const GBM *gbm, const gbm_u8 *data24, gbm_u8 *data8,
+                                        int nr, int ng, int nb);
+
+/* Separable resampling of 24 or 32 bpp bitmaps with fixed-point
+   weights. Supports GBM_SCALE_FILTER_NEARESTNEIGHBOR, _BILINEAR,
+   _BSPLINE, _MITCHELL, _CATMULLROM and _LANCZOS; returns
+   GBM_ERR_NOT_SUPP for the others (use gbm_quality_scale_bgra). */
+extern GBM_ERR gbm_fast_scale_bgra(
+    const gbm_u8 *s, int sw, int sh,
+          gbm_u8 *d, int dw, int dh,
+          int  bpp,
+    const GBM_SCALE_FILTER filter);
+
+#ifdef __cplusplus
+  }  /* extern "C" */
+#endif
+
+#endif
@@ -824,7 +824,8 @@ Feature_Information_Array _System Get_Available_Features( CARDINAL32 * Error_Cod
 /*                   a non-zero value.                               */
 /*                                                                   */
 /*   Side Effects: Volumes which represent non-LVM devices may have  */
-/*                 their handles changed!                            */
+/*                 their handles changed!  Only those whose device   */
+/*                 has gone or changed are affected.                 */
 /*                                                                   */
 /*   Notes:  After calling this function, Get_Volume_Control_Data    */
 /*           should be called to get the updated list of volumes.    */
@@ -3102,7 +3103,8 @@ void _Far16 _Pascal _loadds CLOSE_LVM_ENGINE16 ( void );
 /*                   a non-zero value.                               */
 /*                                                                   */
 /*   Side Effects: Volumes which represent non-LVM devices may have  */
-/*                 their handles changed!                            */
+/*                 their handles changed!  Only those whose device   */
+/*                 has gone or changed are affected.                 */
 /*                                                                   */
 /*   Notes:  After calling this function, Get_Volume_Control_Data    */
 /*           should be called to get the updated list of volumes.    */
@@ -5235,7 +5237,8 @@ void far pascal _loadds CLOSE_LVM_ENGINE16 ( void );
 /*                   a non-zero value.                               */
 /*                                                                   */
 /*   Side Effects: Volumes which represent non-LVM devices may have  */
-/*                 their handles changed!                            */
+/*                 their handles changed!  Only those whose device   */
+/*                 has gone or changed are affected.                 */
 /*                                                                   */
 /*   Notes:  After calling this function, Get_Volume_Control_Data    */
 /*           should be called to get the updated list of volumes.    */
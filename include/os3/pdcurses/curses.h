@@ -323,6 +323,8 @@ typedef struct
 	int	sb_cur_x;
 #endif
 	short	line_color;	/* color of line attributes - default -1 */
+	bool	hash_lines;	/* TRUE if doupdate() skips lines whose
+				   hash has not changed			*/
 } SCREEN;
 
 /*----------------------------------------------------------------------
@@ -1324,6 +1326,7 @@ unsigned long PDC_get_input_fd(void);
 unsigned long PDC_get_key_modifiers(void);
 int	PDC_return_key_modifiers(bool);
 int	PDC_save_key_modifiers(bool);
+int	PDC_hash_lines(bool);
 
 #ifdef XCURSES
 WINDOW *Xinitscr(int, char **);
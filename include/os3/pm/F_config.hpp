@@ -23,6 +23,8 @@
 #define USE_CIRCLE_QUEUES       1
 #define MAX_PIPE_BUF            4096
 #define FREEPMS_MAX_NUM_THREADS 32
+/* longest the server holds F_CMD_WINWAIT_MSG, msec; about one DosSleep(1) tick */
+#define FREEPMS_MSG_WAIT        32
 /* #define THREAD_STACK_SIZE    32000 */
 #define THREAD_STACK_SIZE       65536
 #define USE_SOCKETS             0
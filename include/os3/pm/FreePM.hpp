@@ -113,6 +113,8 @@ public:
 /* ⥪騥 祭 */
    int color;
    int x,y,z;
+   int hwnd;    /* window the PS draws in */
+   int fPaint;  /* got while the window had an update region: draws there only */
 //todo
 };
 
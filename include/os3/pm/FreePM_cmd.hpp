@@ -15,6 +15,7 @@
 
 #define F_CMD_WINQUERY_MSG	0x20
 #define F_CMD_WINGET_MSG	0x21
+#define F_CMD_WINWAIT_MSG	0x22
 
 #define F_CMD_GET_HPS		0x40
 #define F_CMD_RELEASE_HPS	0x41
@@ -30,6 +31,17 @@
 #define F_CMD_GPI_LINE		0x102
 #define F_CMD_GPI_DRAW_LINE	0x103
 #define F_CMD_GPI_DRAW_RECT	0x104
+#define F_CMD_GPI_BATCH		0x105
+
+/* F_CMD_GPI_BATCH data: ints, each record an op and its arguments,
+   run by the server in order with one answer for the lot */
+#define F_GPI_OP_SET_COLOR	1	/* color */
+#define F_GPI_OP_MOVE		2	/* x, y */
+#define F_GPI_OP_LINE		3	/* x, y */
+#define F_GPI_OP_BOX		4	/* control, x, y, hround, vround */
+#define F_GPI_OP_CHARSTR	5	/* count, chars 4 to an int, first lowest */
+#define F_GPI_OP_CHARSTR_AT	6	/* x, y, count, chars as above */
+#define F_GPI_BATCH_LEN		1024	/* max ints in one batch */
 
 #define F_CMD_DB_PRINT	        0x200
 #define F_CMD_FATAL_COMMON	0x201
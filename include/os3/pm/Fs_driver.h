@@ -1,3 +1,60 @@
+#ifndef FS_DRIVER_H
+#define FS_DRIVER_H
+
 typedef void (FPM_DeviceStart_FN)(void *param);
 typedef FPM_DeviceStart_FN * PFPM_DeviceStart_FN;
+/* a driver that defines FPM_DRIVER gets the types only */
+#ifndef FPM_DRIVER
 extern PFPM_DeviceStart_FN FPM_DeviceStart;
+#endif
+
+/* Accelerated drawing primitives, optionally exported by a display
+   driver as FPM_DeviceQueryAccel.  Device coordinates: pixels, origin
+   at the top left of the screen.  Colors are 0xRRGGBB.  Drawing shows
+   up on screen at the next Present(). */
+#define FPM_ACCEL_HW  0x0001   /* done by hardware, not the CPU */
+
+/* A glyph as an alpha mask: cx * cy bytes, 0 (clear) to 255 (solid),
+   top row first.  xOrg, yOrg place the top left of the mask relative
+   to the pen on the baseline (y up); dx moves the pen on */
+typedef struct _FPM_GLYPH
+{
+   int cx, cy;
+   int xOrg, yOrg;
+   int dx;
+} FPM_GLYPH;
+typedef FPM_GLYPH * PFPM_GLYPH;
+
+#define FPM_FONT_DEFAULT  0    /* font and size 0: the driver's own */
+
+typedef struct _FPM_ACCEL
+{
+   unsigned long cb;           /* sizeof(FPM_ACCEL) */
+   unsigned long fl;           /* FPM_ACCEL_* */
+   int cx, cy;                 /* screen size */
+   int (*FillRect)(int x, int y, int cx, int cy, unsigned long color);
+   int (*CopyRect)(int xSrc, int ySrc, int xDst, int yDst, int cx, int cy);
+   int (*Scroll)(int x, int y, int cx, int cy, int dx, int dy,
+                 unsigned long fill);
+   int (*Present)(void);
+   /* Text; either may be NULL.  Glyph describes character ch (0-255)
+      of a font at a size in pels and, if pMask is not NULL, copies its
+      mask there when it fits in cbMask; 0 if there is no such glyph.
+      BlendMask draws color through a mask with stride bytes a row */
+   int (*Glyph)(int font, int size, int ch, PFPM_GLYPH pg,
+                unsigned char *pMask, int cbMask);
+   int (*BlendMask)(int x, int y, int cx, int cy,
+                    const unsigned char *pMask, int stride,
+                    unsigned long color);
+} FPM_ACCEL;
+typedef FPM_ACCEL * PFPM_ACCEL;
+
+typedef PFPM_ACCEL (FPM_DeviceQueryAccel_FN)(void);
+typedef FPM_DeviceQueryAccel_FN * PFPM_DeviceQueryAccel_FN;
+
+#ifndef FPM_DRIVER
+/* NULL when the driver has no acceleration */
+extern PFPM_ACCEL FPM_Accel;
+#endif
+
+#endif
@@ -184,6 +184,14 @@ BOOL APIENTRY  F_GpiSetColor(HPS hps, LONG lColor);
 
 BOOL APIENTRY  F_GpiMove(HPS hps, PPOINTL pptlPoint);
 LONG APIENTRY  F_GpiLine(HPS hps, PPOINTL pptlEndPoint);
+LONG APIENTRY  F_GpiBox(HPS hps, LONG lControl, PPOINTL pptlPoint,
+                        LONG lHRound, LONG lVRound);
+LONG APIENTRY  F_GpiCharString(HPS hps, LONG lCount, PCH pchString);
+LONG APIENTRY  F_GpiCharStringAt(HPS hps, PPOINTL pptlPoint,
+                                 LONG lCount, PCH pchString);
+LONG APIENTRY  F_GpiQueryColor(HPS hps);
+/* send the primitives batched for hps to the server now */
+BOOL APIENTRY  F_GpiFlush(HPS hps);
 
 
 #ifdef __cplusplus
@@ -9,6 +9,13 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#ifdef __x86_64__
+#include <immintrin.h>  // SSE2/AVX2 span kernels
+#endif
+
+#include "Fs_driver.h"  // FreePM accelerated primitive table
+#include <os3/boot_timeline.h>  // boot_begin/boot_end marks
+
 // ============================================================================
 // REGISTER DEFINITIONS (Gen 9+ offsets from BAR0)
 // ============================================================================
@@ -53,6 +60,7 @@
 #define PLANE_SIZE_A            0x70190
 #define PLANE_SURF_A            0x7019C
 #define PLANE_OFFSET_A          0x701A4
+#define PLANE_SURFLIVE_A        0x701AC   // Surface currently being scanned out
 
 // Transcoder/DDI
 #define TRANS_CONF_A            0x70008
@@ -60,13 +68,59 @@
 #define TRANS_VTOTAL_A          0x6000C
 #define DDI_BUF_CTL_A           0x64000
 
+// Blitter engine (BCS) command ring
+#define BCS_RING_TAIL           0x22030
+#define BCS_RING_HEAD           0x22034
+#define BCS_RING_START          0x22038
+#define BCS_RING_CTL            0x2203C
+#define BCS_HWS_PGA             0x22080   // Hardware status page address
+#define   RING_VALID            (1 << 0)
+#define   RING_ADDR_MASK        0x001FFFFC
+
+// MI/BLT commands (Gen 8+ layouts with 64-bit addresses)
+#define MI_NOOP                 0x00000000
+#define MI_FLUSH_DW             ((0x26 << 23) | 2)          // 4 dwords
+#define   MI_FLUSH_DW_STORE     (1 << 14)                   // Post-sync dword write
+#define   MI_FLUSH_DW_USE_GTT   (1 << 2)
+#define XY_COLOR_BLT            ((2 << 29) | (0x50 << 22) | 5)  // 7 dwords
+#define XY_SRC_COPY_BLT         ((2 << 29) | (0x53 << 22) | 8)  // 10 dwords
+#define   BLT_WRITE_RGBA        (3 << 20)
+#define   BLT_DEPTH_32          (3 << 24)
+#define   BLT_ROP_PATCOPY       (0xF0 << 16)
+#define   BLT_ROP_SRCCOPY       (0xCC << 16)
+
+#define BLT_RING_SIZE           (16 * 1024)
+#define BLT_HWS_SEQNO           0x30      // Status page dword the seqno lands in
+
 // GTT (Graphics Translation Table)
 #define GTT_BASE                0x800000  // Offset within BAR0
+#define GTT_SURF_ALIGN_PAGES    64        // PLANE_SURF needs 256KB alignment
+#define GTT_PTE_VALID           (1 << 0)
+#define GTT_PTE_UNCACHED        (3 << 3)  // PPAT 3: uncached (display, ring)
+                                          // PPAT 0 (no bits): LLC-coherent
+
+// Memory types (x86 PAT)
+#define IA32_PAT                0x277
+#define PAT_WC                  0x01      // Write-combining
+#define PAT_ENTRY1_SHIFT        8         // Entry selected by PWT=1 in a PTE
 
 // ============================================================================
 // DATA STRUCTURES
 // ============================================================================
 
+typedef struct {
+    volatile uint32_t* ring;  // Command ring, CPU mapping (write-combining)
+    uint64_t ring_phys;
+    uint32_t ring_gtt;
+    uint32_t tail;            // Next free byte in the ring
+    uint32_t space;           // Bytes known free at tail
+    volatile uint32_t* hws;   // Hardware status page (uncached)
+    uint64_t hws_phys;
+    uint32_t hws_gtt;
+    uint32_t seqno;           // Last seqno emitted
+    bool ready;
+} blt_engine;
+
 typedef struct {
     uint32_t vendor_id;
     uint32_t device_id;
@@ -78,6 +132,8 @@ typedef struct {
     uint64_t aperture_size;
     void* gtt_base;       // GTT location in BAR0
     uint32_t gtt_entries;
+    uint32_t gtt_next;    // Next free GTT entry
+    blt_engine blt;
 } intel_gpu_device;
 
 typedef struct {
@@ -106,12 +162,40 @@ typedef struct {
     // Simplified - real EDID has much more data
 } edid_info;
 
+#define FB_MAX_DAMAGE           16  // Rects tracked before merging into one
+
 typedef struct {
-    void* virtual_addr;   // CPU-visible address
+    int32_t x1, y1;       // Top-left (inclusive)
+    int32_t x2, y2;       // Bottom-right (exclusive)
+} fb_rect;
+
+typedef struct {
+    fb_rect rects[FB_MAX_DAMAGE];
+    uint32_t count;
+} fb_damage;
+
+typedef struct {
+    void* virtual_addr;   // CPU mapping (write-combining)
+    uint64_t physical_addr;
+    uint32_t gtt_offset;  // Address programmed into PLANE_SURF
+} fb_surface;
+
+typedef struct {
+    void* virtual_addr;   // Back buffer (cached) - all drawing goes here
     uint64_t physical_addr;
-    uint32_t gtt_offset;  // GTT entry offset
-    uint32_t size;
+    uint32_t gtt_offset;  // Back buffer address for the blitter
+    uint32_t size;        // Bytes per buffer
     uint32_t stride;      // Bytes per row
+    uint16_t width;
+    uint16_t height;
+    int pipe;             // Pipe the surfaces are flipped on
+    fb_surface surface[2]; // Scanout buffers
+    int front;            // Index of the surface being scanned out
+    fb_damage damage;     // Drawn since the last present
+    fb_damage stale;      // Sent to the front surface only, by the last present
+    bool flip_pending;    // Front surface written to PLANE_SURF, maybe not latched
+    intel_gpu_device* gpu;// Blitter owner; NULL while drawing on the CPU only
+    bool gpu_busy;        // Blits queued since the last fb_sync()
 } framebuffer;
 
 // ============================================================================
@@ -189,9 +273,11 @@ bool map_gpu_resources(intel_gpu_device* gpu) {
         bar2_addr |= ((uint64_t)bar2_high << 32);
     }
     
-    // Map BARs into kernel virtual address space
+    // Map BARs into kernel virtual address space.  Registers must stay
+    // uncached; the aperture only ever holds pixels, so write-combining it
+    // lets CPU writes go out as full-line bursts instead of single dwords.
     gpu->mmio_base = map_physical_memory(bar0_addr, 16 * 1024 * 1024); // 16MB
-    gpu->aperture_base = map_physical_memory(bar2_addr, 256 * 1024 * 1024); // 256MB
+    gpu->aperture_base = map_physical_memory_wc(bar2_addr, 256 * 1024 * 1024); // 256MB
     gpu->aperture_size = 256 * 1024 * 1024;
     
     if (!gpu->mmio_base || !gpu->aperture_base) {
@@ -391,35 +477,60 @@ void init_gtt(intel_gpu_device* gpu) {
     for (uint32_t i = 0; i < gpu->gtt_entries; i++) {
         gtt[i] = 0; // Invalid entry
     }
+    gpu->gtt_next = 0;
     
     printf("Initialized GTT with %d entries\n", gpu->gtt_entries);
 }
 
-bool map_framebuffer_to_gtt(intel_gpu_device* gpu, framebuffer* fb) {
-    // Allocate physical pages for framebuffer
-    uint32_t num_pages = (fb->size + 4095) / 4096;
+// Map physically contiguous memory at the next free GTT entries.
+// align_pages is a power of two; pte_flags selects the caching mode.
+bool gtt_map(intel_gpu_device* gpu, uint64_t phys_addr, uint32_t size,
+             uint32_t align_pages, uint64_t pte_flags, uint32_t* gtt_offset) {
+    uint32_t num_pages = (size + 4095) / 4096;
+    uint32_t first = ALIGN_UP(gpu->gtt_next, align_pages);
+    
+    if (first + num_pages > gpu->gtt_entries) {
+        printf("GTT full (%d pages requested)\n", num_pages);
+        return false;
+    }
     
     // Get GTT base
     volatile uint64_t* gtt = (uint64_t*)gpu->gtt_base;
     
-    // Find free GTT space (simplified - should use proper allocator)
-    uint32_t gtt_start = 0; // Start at beginning for simplicity
-    fb->gtt_offset = gtt_start * 4096;
-    
     // Map each page into GTT
-    uint64_t phys_addr = fb->physical_addr;
     for (uint32_t i = 0; i < num_pages; i++) {
         // GTT entry format (Gen 9+):
         // Bits 0: Valid
-        // Bits 1-11: Reserved/caching
+        // Bits 1-11: Reserved/caching (PPAT index in bits 3, 4, 7)
         // Bits 12+: Physical page frame number
-        uint64_t entry = (phys_addr & ~0xFFF) | 0x1; // Valid bit
-        gtt[gtt_start + i] = entry;
+        uint64_t entry = (phys_addr & ~0xFFF) | pte_flags | GTT_PTE_VALID;
+        gtt[first + i] = entry;
         phys_addr += 4096;
     }
     
-    printf("Mapped framebuffer to GTT offset 0x%x (%d pages)\n", 
-           fb->gtt_offset, num_pages);
+    gpu->gtt_next = first + num_pages;
+    *gtt_offset = first * 4096;
+    return true;
+}
+
+bool map_framebuffer_to_gtt(intel_gpu_device* gpu, framebuffer* fb) {
+    // Scanout surfaces: uncached (the display engine does not snoop),
+    // each starting on a PLANE_SURF boundary
+    for (int s = 0; s < 2; s++) {
+        fb_surface* surf = &fb->surface[s];
+        
+        if (!gtt_map(gpu, surf->physical_addr, fb->size, GTT_SURF_ALIGN_PAGES,
+                     GTT_PTE_UNCACHED, &surf->gtt_offset)) {
+            return false;
+        }
+        printf("Mapped surface %d to GTT offset 0x%x\n", s, surf->gtt_offset);
+    }
+    
+    // Back buffer: LLC-coherent, so the blitter sees CPU drawing in cache
+    if (!gtt_map(gpu, fb->physical_addr, fb->size, 1, 0, &fb->gtt_offset)) {
+        return false;
+    }
+    printf("Mapped back buffer to GTT offset 0x%x\n", fb->gtt_offset);
     
     return true;
 }
@@ -548,15 +659,44 @@ bool configure_plane(intel_gpu_device* gpu, int pipe, display_mode* mode,
     
     // Set surface address (GTT offset)
     // This must be written LAST to trigger the plane update
-    mmio_write32(gpu, PLANE_SURF_A + plane_offset, fb->gtt_offset);
+    uint32_t surf = fb->surface[fb->front].gtt_offset;
+    mmio_write32(gpu, PLANE_SURF_A + plane_offset, surf);
     
     // Enable the plane
     mmio_write32(gpu, PLANE_CTL_A + plane_offset, plane_ctl);
     
-    printf("Plane %c configured at GTT 0x%x\n", 'A' + pipe, fb->gtt_offset);
+    // fb_present() flips this plane from now on
+    fb->pipe = pipe;
+    
+    printf("Plane %c configured at GTT 0x%x\n", 'A' + pipe, surf);
     return true;
 }
 
+// Page flip: point a configured plane at another surface.  PLANE_SURF is
+// double-buffered by the hardware and latches at the next vblank, so the
+// switch never tears.  Returns at once; wait_flip() waits for the latch.
+void flip_plane(intel_gpu_device* gpu, int pipe, uint32_t gtt_offset) {
+    uint32_t plane_offset = pipe * 0x1000;
+    
+    mmio_write32(gpu, PLANE_SURF_A + plane_offset, gtt_offset);
+}
+
+// Wait until the plane scans out gtt_offset, i.e. the surface it left is
+// safe to write into.  50ms covers one frame at any refresh rate we set.
+bool wait_flip(intel_gpu_device* gpu, int pipe, uint32_t gtt_offset) {
+    uint32_t plane_offset = pipe * 0x1000;
+    
+    for (int i = 0; i < 50; i++) {
+        if (mmio_read32(gpu, PLANE_SURFLIVE_A + plane_offset) == gtt_offset) {
+            return true;
+        }
+        usleep(1000);
+    }
+    
+    printf("Plane %c flip timeout\n", 'A' + pipe);
+    return false;
+}
+
 bool enable_ddi_output(intel_gpu_device* gpu, int ddi_port) {
     // Enable DDI buffer (simplified - real version needs proper configuration)
     uint32_t ddi_offset = ddi_port * 0x100; // DDI A = 0, B = 0x100, etc.
@@ -580,37 +720,96 @@ bool allocate_framebuffer(intel_gpu_device* gpu, display_mode* mode,
     uint32_t bytes_per_pixel = 4;
     fb->stride = ALIGN_UP(mode->hdisplay * bytes_per_pixel, 64); // 64-byte alignment
     fb->size = fb->stride * mode->vdisplay;
+    fb->width = mode->hdisplay;
+    fb->height = mode->vdisplay;
     
-    // Allocate physical memory (contiguous or use GTT to make it appear contiguous)
+    // Back buffer in ordinary cached memory.  Drawing reads pixels back
+    // (scrolling, blending) and reads from write-combined memory are
+    // uncached, so the CPU never draws into a scanout surface directly.
+    // It is GTT-mapped too, so the blitter can draw into it.
     fb->physical_addr = allocate_physical_pages(fb->size);
     if (!fb->physical_addr) {
-        printf("Failed to allocate framebuffer memory\n");
+        printf("Failed to allocate back buffer\n");
         return false;
     }
-    
-    // Map to kernel virtual address space
-    fb->virtual_addr = map_physical_memory(fb->physical_addr, fb->size);
+    fb->virtual_addr = map_physical_memory_wb(fb->physical_addr, fb->size);
     if (!fb->virtual_addr) {
-        printf("Failed to map framebuffer\n");
-        free_physical_pages(fb->physical_addr, fb->size);
+        printf("Failed to map back buffer\n");
+        free_framebuffer(fb);
         return false;
     }
-    
-    // Clear framebuffer (black screen)
     memset(fb->virtual_addr, 0, fb->size);
     
-    printf("Allocated framebuffer: %dx%d, stride=%d, size=%d bytes\n",
+    // Two scanout surfaces to flip between
+    for (int s = 0; s < 2; s++) {
+        fb_surface* surf = &fb->surface[s];
+        
+        // Allocate physical memory (contiguous or use GTT to make it appear contiguous)
+        surf->physical_addr = allocate_physical_pages(fb->size);
+        if (!surf->physical_addr) {
+            printf("Failed to allocate framebuffer memory\n");
+            free_framebuffer(fb);
+            return false;
+        }
+        
+        // Map write-combining: fb_present() only ever streams into these
+        surf->virtual_addr = map_physical_memory_wc(surf->physical_addr, fb->size);
+        if (!surf->virtual_addr) {
+            printf("Failed to map framebuffer\n");
+            free_framebuffer(fb);
+            return false;
+        }
+        
+        // Clear framebuffer (black screen)
+        memset(surf->virtual_addr, 0, fb->size);
+    }
+    
+    fb->front = 0;
+    fb->damage.count = 0;
+    fb->stale.count = 0;
+    fb->flip_pending = false;
+    fb->gpu = NULL;
+    fb->gpu_busy = false;
+    
+    printf("Allocated framebuffer: %dx%d, stride=%d, size=%d bytes x 3\n",
            mode->hdisplay, mode->vdisplay, fb->stride, fb->size);
     
     return true;
 }
 
+void free_framebuffer(framebuffer* fb) {
+    for (int s = 0; s < 2; s++) {
+        fb_surface* surf = &fb->surface[s];
+        
+        if (surf->virtual_addr) {
+            unmap_physical_memory(surf->virtual_addr, fb->size);
+            surf->virtual_addr = NULL;
+        }
+        if (surf->physical_addr) {
+            free_physical_pages(surf->physical_addr, fb->size);
+            surf->physical_addr = 0;
+        }
+    }
+    
+    if (fb->virtual_addr) {
+        unmap_physical_memory(fb->virtual_addr, fb->size);
+        fb->virtual_addr = NULL;
+    }
+    if (fb->physical_addr) {
+        free_physical_pages(fb->physical_addr, fb->size);
+        fb->physical_addr = 0;
+    }
+}
+
 // ============================================================================
 // 7. MAIN INITIALIZATION SEQUENCE
 // ============================================================================
 
-bool init_intel_framebuffer(intel_gpu_device* gpu, framebuffer* fb) {
+static bool intel_framebuffer_bringup(intel_gpu_device* gpu, framebuffer* fb) {
     // Step 1: Detect and map GPU
+    setup_pat_wc(); // Before any write-combining mapping is made
+    fb_init_kernels();
+    
     if (!detect_intel_gpu(gpu)) {
         printf("No Intel GPU found\n");
         return false;
@@ -661,6 +860,7 @@ bool init_intel_framebuffer(intel_gpu_device* gpu, framebuffer* fb) {
     // Step 6: Map framebuffer into GTT
     if (!map_framebuffer_to_gtt(gpu, fb)) {
         printf("Failed to map framebuffer to GTT\n");
+        free_framebuffer(fb);
         return false;
     }
     
@@ -689,6 +889,12 @@ bool init_intel_framebuffer(intel_gpu_device* gpu, framebuffer* fb) {
         return false;
     }
     
+    // Step 11: Start the blitter - optional, drawing stays on the CPU without it
+    if (blt_init(gpu)) {
+        fb->gpu = gpu;
+    }
+    fpm_accel_attach(gpu, fb);
+    
     printf("Intel framebuffer initialized successfully!\n");
     printf("Framebuffer at %p, size %dx%d\n", 
            fb->virtual_addr, 
@@ -698,76 +904,903 @@ bool init_intel_framebuffer(intel_gpu_device* gpu, framebuffer* fb) {
     return true;
 }
 
+// Timed as one boot step - EDID reads and PLL lock dominate
+bool init_intel_framebuffer(intel_gpu_device* gpu, framebuffer* fb) {
+    boot_begin(BOOT_EV_FB_INIT, 0);
+    bool ok = intel_framebuffer_bringup(gpu, fb);
+    boot_end(BOOT_EV_FB_INIT, 0);
+    
+    return ok;
+}
+
 // ============================================================================
-// 8. TEST FUNCTIONS - DRAWING TO FRAMEBUFFER
+// 8. BACK BUFFER, DAMAGE TRACKING AND PRESENT
 // ============================================================================
 
-void draw_test_pattern(framebuffer* fb, display_mode* mode) {
-    uint32_t* pixels = (uint32_t*)fb->virtual_addr;
+/*
+ * Drawing never touches scanout memory.  Everything goes into the cached
+ * back buffer and records a damage rect; fb_present() then streams only
+ * the damaged pixels into the hidden surface and flips to it.  At 4K a
+ * full-screen redraw is 32MB, so the span kernels below move 16/32 bytes
+ * per instruction with non-temporal stores once a job is too big to be
+ * worth keeping in cache.
+ */
+
+#define FB_STREAM_MIN_BYTES     (256 * 1024)  // Bypass the cache above this
+
+// Span kernels: 'stream' selects non-temporal stores.  Scanout surfaces are
+// write-combining, and streaming full lines into them is the fast path.
+typedef void (*fill_span_fn)(uint32_t* dst, uint32_t n, uint32_t color, bool stream);
+typedef void (*copy_span_fn)(uint32_t* dst, const uint32_t* src, uint32_t n, bool stream);
+
+#ifdef __x86_64__
+
+static void fill_span_sse2(uint32_t* dst, uint32_t n, uint32_t color, bool stream) {
+    // Align the destination for the vector stores
+    while (n && ((uintptr_t)dst & 15)) {
+        *dst++ = color;
+        n--;
+    }
     
-    for (int y = 0; y < mode->vdisplay; y++) {
-        for (int x = 0; x < mode->hdisplay; x++) {
-            uint32_t color;
-            
-            // Draw color bars
-            if (x < mode->hdisplay / 8) {
-                color = 0xFFFFFFFF; // White
-            } else if (x < mode->hdisplay * 2 / 8) {
-                color = 0xFFFFFF00; // Yellow
-            } else if (x < mode->hdisplay * 3 / 8) {
-                color = 0xFF00FFFF; // Cyan
-            } else if (x < mode->hdisplay * 4 / 8) {
-                color = 0xFF00FF00; // Green
-            } else if (x < mode->hdisplay * 5 / 8) {
-                color = 0xFFFF00FF; // Magenta
-            } else if (x < mode->hdisplay * 6 / 8) {
-                color = 0xFFFF0000; // Red
-            } else if (x < mode->hdisplay * 7 / 8) {
-                color = 0xFF0000FF; // Blue
-            } else {
-                color = 0xFF000000; // Black
+    __m128i v = _mm_set1_epi32((int)color);
+    if (stream) {
+        for (; n >= 16; n -= 16, dst += 16) {
+            _mm_stream_si128((__m128i*)dst + 0, v);
+            _mm_stream_si128((__m128i*)dst + 1, v);
+            _mm_stream_si128((__m128i*)dst + 2, v);
+            _mm_stream_si128((__m128i*)dst + 3, v);
+        }
+        for (; n >= 4; n -= 4, dst += 4) {
+            _mm_stream_si128((__m128i*)dst, v);
+        }
+    } else {
+        for (; n >= 16; n -= 16, dst += 16) {
+            _mm_store_si128((__m128i*)dst + 0, v);
+            _mm_store_si128((__m128i*)dst + 1, v);
+            _mm_store_si128((__m128i*)dst + 2, v);
+            _mm_store_si128((__m128i*)dst + 3, v);
+        }
+        for (; n >= 4; n -= 4, dst += 4) {
+            _mm_store_si128((__m128i*)dst, v);
+        }
+    }
+    
+    while (n--) {
+        *dst++ = color;
+    }
+}
+
+// Forward copy - also safe for overlapping spans with dst below src
+static void copy_span_sse2(uint32_t* dst, const uint32_t* src, uint32_t n, bool stream) {
+    while (n && ((uintptr_t)dst & 15)) {
+        *dst++ = *src++;
+        n--;
+    }
+    
+    for (; n >= 16; n -= 16, dst += 16, src += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)src + 0);
+        __m128i b = _mm_loadu_si128((const __m128i*)src + 1);
+        __m128i c = _mm_loadu_si128((const __m128i*)src + 2);
+        __m128i d = _mm_loadu_si128((const __m128i*)src + 3);
+        if (stream) {
+            _mm_stream_si128((__m128i*)dst + 0, a);
+            _mm_stream_si128((__m128i*)dst + 1, b);
+            _mm_stream_si128((__m128i*)dst + 2, c);
+            _mm_stream_si128((__m128i*)dst + 3, d);
+        } else {
+            _mm_store_si128((__m128i*)dst + 0, a);
+            _mm_store_si128((__m128i*)dst + 1, b);
+            _mm_store_si128((__m128i*)dst + 2, c);
+            _mm_store_si128((__m128i*)dst + 3, d);
+        }
+    }
+    for (; n >= 4; n -= 4, dst += 4, src += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i*)src);
+        if (stream) {
+            _mm_stream_si128((__m128i*)dst, a);
+        } else {
+            _mm_store_si128((__m128i*)dst, a);
+        }
+    }
+    
+    while (n--) {
+        *dst++ = *src++;
+    }
+}
+
+__attribute__((target("avx2")))
+static void fill_span_avx2(uint32_t* dst, uint32_t n, uint32_t color, bool stream) {
+    while (n && ((uintptr_t)dst & 31)) {
+        *dst++ = color;
+        n--;
+    }
+    
+    __m256i v = _mm256_set1_epi32((int)color);
+    if (stream) {
+        for (; n >= 32; n -= 32, dst += 32) {
+            _mm256_stream_si256((__m256i*)dst + 0, v);
+            _mm256_stream_si256((__m256i*)dst + 1, v);
+            _mm256_stream_si256((__m256i*)dst + 2, v);
+            _mm256_stream_si256((__m256i*)dst + 3, v);
+        }
+        for (; n >= 8; n -= 8, dst += 8) {
+            _mm256_stream_si256((__m256i*)dst, v);
+        }
+    } else {
+        for (; n >= 32; n -= 32, dst += 32) {
+            _mm256_store_si256((__m256i*)dst + 0, v);
+            _mm256_store_si256((__m256i*)dst + 1, v);
+            _mm256_store_si256((__m256i*)dst + 2, v);
+            _mm256_store_si256((__m256i*)dst + 3, v);
+        }
+        for (; n >= 8; n -= 8, dst += 8) {
+            _mm256_store_si256((__m256i*)dst, v);
+        }
+    }
+    
+    while (n--) {
+        *dst++ = color;
+    }
+}
+
+__attribute__((target("avx2")))
+static void copy_span_avx2(uint32_t* dst, const uint32_t* src, uint32_t n, bool stream) {
+    while (n && ((uintptr_t)dst & 31)) {
+        *dst++ = *src++;
+        n--;
+    }
+    
+    for (; n >= 32; n -= 32, dst += 32, src += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)src + 0);
+        __m256i b = _mm256_loadu_si256((const __m256i*)src + 1);
+        __m256i c = _mm256_loadu_si256((const __m256i*)src + 2);
+        __m256i d = _mm256_loadu_si256((const __m256i*)src + 3);
+        if (stream) {
+            _mm256_stream_si256((__m256i*)dst + 0, a);
+            _mm256_stream_si256((__m256i*)dst + 1, b);
+            _mm256_stream_si256((__m256i*)dst + 2, c);
+            _mm256_stream_si256((__m256i*)dst + 3, d);
+        } else {
+            _mm256_store_si256((__m256i*)dst + 0, a);
+            _mm256_store_si256((__m256i*)dst + 1, b);
+            _mm256_store_si256((__m256i*)dst + 2, c);
+            _mm256_store_si256((__m256i*)dst + 3, d);
+        }
+    }
+    for (; n >= 8; n -= 8, dst += 8, src += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)src);
+        if (stream) {
+            _mm256_stream_si256((__m256i*)dst, a);
+        } else {
+            _mm256_store_si256((__m256i*)dst, a);
+        }
+    }
+    
+    while (n--) {
+        *dst++ = *src++;
+    }
+}
+
+// Backward copy for overlapping spans with dst above src (scrolling right).
+// Each block is loaded before it is stored, so walking down from the end
+// never overwrites source pixels that are still to be read.
+static void copy_span_backward(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    dst += n;
+    src += n;
+    
+    for (; n >= 4; n -= 4) {
+        dst -= 4;
+        src -= 4;
+        _mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+    }
+    
+    while (n--) {
+        *--dst = *--src;
+    }
+}
+
+static fill_span_fn fill_span = fill_span_sse2;
+static copy_span_fn copy_span = copy_span_sse2;
+
+#else // !__x86_64__
+
+static void fill_span_scalar(uint32_t* dst, uint32_t n, uint32_t color, bool stream) {
+    while (n--) {
+        *dst++ = color;
+    }
+}
+
+static void copy_span_scalar(uint32_t* dst, const uint32_t* src, uint32_t n, bool stream) {
+    while (n--) {
+        *dst++ = *src++;
+    }
+}
+
+static void copy_span_backward(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    while (n--) {
+        dst[n] = src[n];
+    }
+}
+
+static fill_span_fn fill_span = fill_span_scalar;
+static copy_span_fn copy_span = copy_span_scalar;
+
+#endif
+
+// Select the widest kernels the CPU supports (SSE2 is baseline on x86-64)
+void fb_init_kernels() {
+#ifdef __x86_64__
+    if (cpu_has_avx2()) {
+        fill_span = fill_span_avx2;
+        copy_span = copy_span_avx2;
+        printf("Framebuffer: using AVX2 span kernels\n");
+    }
+#endif
+}
+
+// Write-combining buffers drain in any order; call before the GPU reads
+static inline void flush_streaming_stores() {
+#ifdef __x86_64__
+    _mm_sfence();
+#endif
+}
+
+static inline uint32_t* fb_row(void* base, uint32_t stride, int y) {
+    return (uint32_t*)((uint8_t*)base + (uint64_t)y * stride);
+}
+
+// Clip a rect to the screen; false if nothing is left
+static bool clip_rect(framebuffer* fb, fb_rect* r) {
+    if (r->x1 < 0) r->x1 = 0;
+    if (r->y1 < 0) r->y1 = 0;
+    if (r->x2 > fb->width) r->x2 = fb->width;
+    if (r->y2 > fb->height) r->y2 = fb->height;
+    return r->x1 < r->x2 && r->y1 < r->y2;
+}
+
+static inline bool rects_touch(const fb_rect* a, const fb_rect* b) {
+    return a->x1 <= b->x2 && b->x1 <= a->x2 &&
+           a->y1 <= b->y2 && b->y1 <= a->y2;
+}
+
+static inline void rect_union(fb_rect* a, const fb_rect* b) {
+    if (b->x1 < a->x1) a->x1 = b->x1;
+    if (b->y1 < a->y1) a->y1 = b->y1;
+    if (b->x2 > a->x2) a->x2 = b->x2;
+    if (b->y2 > a->y2) a->y2 = b->y2;
+}
+
+// Record a (clipped) rect.  Touching rects are merged so no pixel is copied
+// twice; once the list is full everything collapses into one bounding box.
+void damage_add(fb_damage* d, const fb_rect* rect) {
+    fb_rect r = *rect;
+    
+    for (uint32_t i = 0; i < d->count; ) {
+        if (!rects_touch(&d->rects[i], &r)) {
+            i++;
+            continue;
+        }
+        
+        // Absorb it and rescan - the grown rect may reach others
+        rect_union(&r, &d->rects[i]);
+        d->rects[i] = d->rects[--d->count];
+        i = 0;
+    }
+    
+    if (d->count == FB_MAX_DAMAGE) {
+        for (uint32_t i = 1; i < d->count; i++) {
+            rect_union(&r, &d->rects[i]);
+        }
+        rect_union(&r, &d->rects[0]);
+        d->count = 0;
+    }
+    
+    d->rects[d->count++] = r;
+}
+
+// Clip a copy against the destination, then the source, keeping the two
+// rects the same size; false if nothing is left
+static bool clip_copy(framebuffer* fb, int src_x, int src_y, int dst_x, int dst_y,
+                      int width, int height, fb_rect* dst, fb_rect* src) {
+    fb_rect r = {dst_x, dst_y, dst_x + width, dst_y + height};
+    if (!clip_rect(fb, &r)) return false;
+    src_x += r.x1 - dst_x;
+    src_y += r.y1 - dst_y;
+    
+    fb_rect s = {src_x, src_y, src_x + (r.x2 - r.x1), src_y + (r.y2 - r.y1)};
+    if (!clip_rect(fb, &s)) return false;
+    r.x1 += s.x1 - src_x;
+    r.y1 += s.y1 - src_y;
+    r.x2 = r.x1 + (s.x2 - s.x1);
+    r.y2 = r.y1 + (s.y2 - s.y1);
+    
+    *dst = r;
+    *src = s;
+    return true;
+}
+
+void fb_fill_rect(framebuffer* fb, int x, int y, int width, int height,
+                  uint32_t color) {
+    fb_rect r = {x, y, x + width, y + height};
+    if (!clip_rect(fb, &r)) return;
+    fb_sync(fb);
+    
+    uint32_t w = r.x2 - r.x1;
+    bool stream = (uint64_t)w * (r.y2 - r.y1) * 4 >= FB_STREAM_MIN_BYTES;
+    
+    for (int py = r.y1; py < r.y2; py++) {
+        fill_span(fb_row(fb->virtual_addr, fb->stride, py) + r.x1, w, color, stream);
+    }
+    if (stream) flush_streaming_stores();
+    
+    damage_add(&fb->damage, &r);
+}
+
+// Move pixels within the back buffer - overlap is fine (scrolling)
+void fb_copy_rect(framebuffer* fb, int src_x, int src_y,
+                  int dst_x, int dst_y, int width, int height) {
+    fb_rect r, s;
+    if (!clip_copy(fb, src_x, src_y, dst_x, dst_y, width, height, &r, &s)) return;
+    fb_sync(fb);
+    
+    uint32_t w = r.x2 - r.x1;
+    int rows = r.y2 - r.y1;
+    bool stream = (uint64_t)w * rows * 4 >= FB_STREAM_MIN_BYTES;
+    
+    // Walk rows away from the overlap
+    int dy = 1, first = 0;
+    if (r.y1 > s.y1) {
+        dy = -1;
+        first = rows - 1;
+    }
+    
+    for (int i = 0, row = first; i < rows; i++, row += dy) {
+        uint32_t* dst = fb_row(fb->virtual_addr, fb->stride, r.y1 + row) + r.x1;
+        const uint32_t* src = fb_row(fb->virtual_addr, fb->stride, s.y1 + row) + s.x1;
+        
+        if (r.y1 == s.y1 && dst > src && dst < src + w) {
+            copy_span_backward(dst, src, w);
+        } else {
+            copy_span(dst, src, w, stream);
+        }
+    }
+    if (stream) flush_streaming_stores();
+    
+    damage_add(&fb->damage, &r);
+}
+
+// Upload 32bpp pixels (glyphs, bitmaps, PM surfaces) into the back buffer
+void fb_blit(framebuffer* fb, int x, int y, int width, int height,
+             const uint32_t* pixels, uint32_t src_stride) {
+    fb_rect r = {x, y, x + width, y + height};
+    if (!clip_rect(fb, &r)) return;
+    fb_sync(fb);
+    
+    uint32_t w = r.x2 - r.x1;
+    bool stream = (uint64_t)w * (r.y2 - r.y1) * 4 >= FB_STREAM_MIN_BYTES;
+    const uint8_t* src = (const uint8_t*)pixels +
+                         (uint64_t)(r.y1 - y) * src_stride + (r.x1 - x) * 4;
+    
+    for (int py = r.y1; py < r.y2; py++, src += src_stride) {
+        copy_span(fb_row(fb->virtual_addr, fb->stride, py) + r.x1,
+                  (const uint32_t*)src, w, stream);
+    }
+    if (stream) flush_streaming_stores();
+    
+    damage_add(&fb->damage, &r);
+}
+
+// Make everything drawn since the last call visible.  Only waits if the
+// previous flip has not latched yet, i.e. when called faster than vblank.
+bool fb_present(intel_gpu_device* gpu, framebuffer* fb) {
+    if (!fb->damage.count) return true;
+    
+    int back = fb->front ^ 1;
+    fb_surface* surf = &fb->surface[back];
+    
+    // The hidden surface is the one the last flip moved away from
+    if (fb->flip_pending) {
+        if (!wait_flip(gpu, fb->pipe, fb->surface[fb->front].gtt_offset)) {
+            return false;
+        }
+        fb->flip_pending = false;
+    }
+    
+    // The hidden surface was last brought up to date one present ago, so it
+    // is also missing what that present sent to the other surface
+    fb_damage todo = fb->damage;
+    for (uint32_t i = 0; i < fb->stale.count; i++) {
+        damage_add(&todo, &fb->stale.rects[i]);
+    }
+    
+    if (fb->gpu) {
+        // Queued behind any blits still drawing into the back buffer
+        for (uint32_t i = 0; i < todo.count; i++) {
+            fb_rect* r = &todo.rects[i];
+            blt_emit_copy(gpu, fb->stride, surf->gtt_offset, fb->gtt_offset,
+                          r, r->x1, r->y1);
+        }
+        fb->gpu_busy = true;
+        fb_sync(fb);
+    }
+    
+    // No blitter (or it just hung and fb_sync() dropped it)
+    if (!fb->gpu) {
+        for (uint32_t i = 0; i < todo.count; i++) {
+            fb_rect* r = &todo.rects[i];
+            for (int y = r->y1; y < r->y2; y++) {
+                copy_span(fb_row(surf->virtual_addr, fb->stride, y) + r->x1,
+                          fb_row(fb->virtual_addr, fb->stride, y) + r->x1,
+                          r->x2 - r->x1, true);
             }
-            
-            // Calculate pixel offset
-            uint32_t offset = y * (fb->stride / 4) + x;
-            pixels[offset] = color;
         }
+        flush_streaming_stores();
     }
     
-    printf("Drew test pattern\n");
+    flip_plane(gpu, fb->pipe, surf->gtt_offset);
+    fb->flip_pending = true;
+    
+    fb->front = back;
+    fb->stale = fb->damage;
+    fb->damage.count = 0;
+    return true;
 }
 
-void fill_screen(framebuffer* fb, display_mode* mode, uint32_t color) {
-    uint32_t* pixels = (uint32_t*)fb->virtual_addr;
+// ============================================================================
+// 9. BLT ENGINE (HARDWARE BLITTER)
+// ============================================================================
+
+/*
+ * The blitter runs fills and copies from a command ring, so the CPU only
+ * writes a few dwords per rectangle instead of touching every pixel.  It
+ * draws into the same back buffer as the CPU paths and also does the
+ * damage copies in fb_present().  CPU drawing calls fb_sync() first, so
+ * the two never work on the back buffer at the same time.
+ *
+ * This is legacy ring-buffer submission (execlists disabled): a single
+ * submitter and no contexts, which is all the console and PM server need.
+ */
+
+static inline bool seqno_passed(uint32_t seqno, uint32_t target) {
+    return (int32_t)(seqno - target) >= 0;
+}
+
+// Bytes free between our tail and the engine's head.  head == tail means
+// empty, so a qword is always left unused.
+static uint32_t blt_ring_space(intel_gpu_device* gpu) {
+    uint32_t head = mmio_read32(gpu, BCS_RING_HEAD) & RING_ADDR_MASK;
+    int32_t space = (int32_t)head - (int32_t)gpu->blt.tail - 8;
+    
+    if (space < 0) space += BLT_RING_SIZE;
+    return (uint32_t)space;
+}
+
+static bool blt_wait_space(intel_gpu_device* gpu, uint32_t bytes) {
+    blt_engine* blt = &gpu->blt;
+    
+    // Re-read HEAD (an uncached MMIO read) only once the cached count runs out
+    for (int i = 0; blt->space < bytes; i++) {
+        if (i == 100000) { // ~1s
+            printf("BLT: ring stalled (head 0x%x, tail 0x%x)\n",
+                   mmio_read32(gpu, BCS_RING_HEAD), blt->tail);
+            return false;
+        }
+        if (i) usleep(10);
+        blt->space = blt_ring_space(gpu);
+    }
+    return true;
+}
+
+static inline void blt_out(blt_engine* blt, uint32_t dw) {
+    blt->ring[blt->tail / 4] = dw;
+    blt->tail += 4;
+    blt->space -= 4;
+}
+
+// Reserve room for a command of 'dwords', plus the qword pad
+// blt_ring_advance() may add.  Commands never wrap around the ring end.
+static bool blt_ring_begin(intel_gpu_device* gpu, uint32_t dwords) {
+    blt_engine* blt = &gpu->blt;
+    uint32_t bytes = (dwords + 1) * 4;
+    
+    if (!blt->ready) return false;
+    
+    if (blt->tail + bytes > BLT_RING_SIZE) {
+        uint32_t pad = BLT_RING_SIZE - blt->tail;
+        if (!blt_wait_space(gpu, pad)) return false;
+        while (blt->tail < BLT_RING_SIZE) {
+            blt_out(blt, MI_NOOP);
+        }
+        blt->tail = 0;
+    }
+    
+    return blt_wait_space(gpu, bytes);
+}
+
+// Hand everything written since blt_ring_begin() to the engine
+static void blt_ring_advance(intel_gpu_device* gpu) {
+    blt_engine* blt = &gpu->blt;
+    
+    // TAIL must be qword aligned
+    if (blt->tail & 7) {
+        blt_out(blt, MI_NOOP);
+    }
+    if (blt->tail == BLT_RING_SIZE) {
+        blt->tail = 0;
+    }
     
-    for (int y = 0; y < mode->vdisplay; y++) {
-        for (int x = 0; x < mode->hdisplay; x++) {
-            uint32_t offset = y * (fb->stride / 4) + x;
-            pixels[offset] = color;
+    // The ring is write-combining: commands must land before TAIL moves
+    flush_streaming_stores();
+    mmio_write32(gpu, BCS_RING_TAIL, blt->tail);
+}
+
+bool blt_init(intel_gpu_device* gpu) {
+    blt_engine* blt = &gpu->blt;
+    
+    blt->ready = false;
+    blt->ring_phys = allocate_physical_pages(BLT_RING_SIZE);
+    blt->hws_phys = allocate_physical_pages(4096);
+    if (!blt->ring_phys || !blt->hws_phys) {
+        printf("BLT: failed to allocate ring\n");
+        return false;
+    }
+    
+    // The CPU only writes the ring and only reads the status page
+    blt->ring = (volatile uint32_t*)map_physical_memory_wc(blt->ring_phys, BLT_RING_SIZE);
+    blt->hws = (volatile uint32_t*)map_physical_memory(blt->hws_phys, 4096);
+    if (!blt->ring || !blt->hws) {
+        printf("BLT: failed to map ring\n");
+        return false;
+    }
+    
+    if (!gtt_map(gpu, blt->ring_phys, BLT_RING_SIZE, 1, GTT_PTE_UNCACHED, &blt->ring_gtt) ||
+        !gtt_map(gpu, blt->hws_phys, 4096, 1, GTT_PTE_UNCACHED, &blt->hws_gtt)) {
+        return false;
+    }
+    
+    for (int i = 0; i < 1024; i++) {
+        blt->hws[i] = 0;
+    }
+    blt->seqno = 0;
+    blt->tail = 0;
+    
+    // Stop the ring, then program it from empty
+    mmio_write32(gpu, BCS_RING_CTL, 0);
+    mmio_write32(gpu, BCS_HWS_PGA, blt->hws_gtt);
+    mmio_write32(gpu, BCS_RING_HEAD, 0);
+    mmio_write32(gpu, BCS_RING_TAIL, 0);
+    mmio_write32(gpu, BCS_RING_START, blt->ring_gtt);
+    mmio_write32(gpu, BCS_RING_CTL, ((BLT_RING_SIZE - 4096) & 0x1FF000) | RING_VALID);
+    
+    for (int i = 0; i < 100; i++) {
+        if ((mmio_read32(gpu, BCS_RING_CTL) & RING_VALID) &&
+            (mmio_read32(gpu, BCS_RING_HEAD) & RING_ADDR_MASK) == 0) {
+            blt->space = blt_ring_space(gpu);
+            blt->ready = true;
+            printf("BLT: ring at GTT 0x%x, %d bytes\n", blt->ring_gtt, BLT_RING_SIZE);
+            return true;
         }
+        usleep(10);
     }
+    
+    printf("BLT: ring failed to start\n");
+    return false;
 }
 
-void draw_rectangle(framebuffer* fb, display_mode* mode, 
-                    int x, int y, int width, int height, uint32_t color) {
-    uint32_t* pixels = (uint32_t*)fb->virtual_addr;
+// Solid fill of 'r' in a 32bpp surface
+bool blt_emit_fill(intel_gpu_device* gpu, uint32_t pitch, uint32_t dst_gtt,
+                   const fb_rect* r, uint32_t color) {
+    blt_engine* blt = &gpu->blt;
+    
+    if (!blt_ring_begin(gpu, 7)) return false;
+    
+    blt_out(blt, XY_COLOR_BLT | BLT_WRITE_RGBA);
+    blt_out(blt, BLT_DEPTH_32 | BLT_ROP_PATCOPY | pitch);
+    blt_out(blt, (r->y1 << 16) | r->x1);
+    blt_out(blt, (r->y2 << 16) | r->x2);
+    blt_out(blt, dst_gtt);
+    blt_out(blt, 0);                    // Address bits 63:32
+    blt_out(blt, color);
+    
+    blt_ring_advance(gpu);
+    return true;
+}
+
+// Copy to 'dst' from the same-sized rect at (src_x, src_y).  Source and
+// destination must not overlap - see fb_accel_copy_rect().
+bool blt_emit_copy(intel_gpu_device* gpu, uint32_t pitch, uint32_t dst_gtt,
+                   uint32_t src_gtt, const fb_rect* dst, int src_x, int src_y) {
+    blt_engine* blt = &gpu->blt;
+    
+    if (!blt_ring_begin(gpu, 10)) return false;
+    
+    blt_out(blt, XY_SRC_COPY_BLT | BLT_WRITE_RGBA);
+    blt_out(blt, BLT_DEPTH_32 | BLT_ROP_SRCCOPY | pitch);
+    blt_out(blt, (dst->y1 << 16) | dst->x1);
+    blt_out(blt, (dst->y2 << 16) | dst->x2);
+    blt_out(blt, dst_gtt);
+    blt_out(blt, 0);
+    blt_out(blt, (src_y << 16) | src_x);
+    blt_out(blt, pitch);
+    blt_out(blt, src_gtt);
+    blt_out(blt, 0);
+    
+    blt_ring_advance(gpu);
+    return true;
+}
+
+// Make earlier blits complete before later ones start (dependent copies)
+static bool blt_emit_flush(intel_gpu_device* gpu) {
+    blt_engine* blt = &gpu->blt;
+    
+    if (!blt_ring_begin(gpu, 4)) return false;
+    
+    blt_out(blt, MI_FLUSH_DW);
+    blt_out(blt, 0);
+    blt_out(blt, 0);
+    blt_out(blt, 0);
+    
+    blt_ring_advance(gpu);
+    return true;
+}
+
+// Flush all blits to memory and have the engine write a new seqno to the
+// status page once they are done.  Returns the seqno, 0 on failure.
+static uint32_t blt_emit_seqno(intel_gpu_device* gpu) {
+    blt_engine* blt = &gpu->blt;
+    
+    if (!blt_ring_begin(gpu, 4)) return 0;
+    
+    if (++blt->seqno == 0) blt->seqno = 1; // 0 means failure
+    
+    blt_out(blt, MI_FLUSH_DW | MI_FLUSH_DW_STORE);
+    blt_out(blt, (blt->hws_gtt + BLT_HWS_SEQNO * 4) | MI_FLUSH_DW_USE_GTT);
+    blt_out(blt, 0);
+    blt_out(blt, blt->seqno);
+    
+    blt_ring_advance(gpu);
+    return blt->seqno;
+}
+
+bool blt_wait(intel_gpu_device* gpu, uint32_t seqno) {
+    blt_engine* blt = &gpu->blt;
+    
+    for (int i = 0; i < 100000; i++) { // ~1s
+        if (seqno_passed(blt->hws[BLT_HWS_SEQNO], seqno)) {
+            return true;
+        }
+        usleep(10);
+    }
+    
+    printf("BLT: timeout waiting for seqno %u (at %u)\n",
+           seqno, blt->hws[BLT_HWS_SEQNO]);
+    return false;
+}
+
+// Wait for queued blits before the CPU touches the back buffer.  A hung
+// or failed blitter is dropped and drawing carries on on the CPU.
+void fb_sync(framebuffer* fb) {
+    if (!fb->gpu || !fb->gpu_busy) return;
+    
+    uint32_t seqno = blt_emit_seqno(fb->gpu);
+    if (!seqno || !blt_wait(fb->gpu, seqno)) {
+        printf("BLT: engine not responding, drawing on the CPU\n");
+        fb->gpu->blt.ready = false;
+        fb->gpu = NULL;
+    }
+    fb->gpu_busy = false;
+}
+
+/*
+ * Accelerated primitives.  Same results as the fb_* CPU versions, which
+ * they fall back to when there is no blitter.
+ */
+
+void fb_accel_fill_rect(framebuffer* fb, int x, int y, int width, int height,
+                        uint32_t color) {
+    fb_rect r = {x, y, x + width, y + height};
+    
+    if (!fb->gpu) {
+        fb_fill_rect(fb, x, y, width, height, color);
+        return;
+    }
+    if (!clip_rect(fb, &r)) return;
     
-    for (int dy = 0; dy < height; dy++) {
-        for (int dx = 0; dx < width; dx++) {
-            int px = x + dx;
-            int py = y + dy;
+    if (!blt_emit_fill(fb->gpu, fb->stride, fb->gtt_offset, &r, color)) {
+        fb_sync(fb);
+        fb->gpu = NULL;
+        fb_fill_rect(fb, x, y, width, height, color);
+        return;
+    }
+    
+    fb->gpu_busy = true;
+    damage_add(&fb->damage, &r);
+}
+
+// Screen-to-screen copy within the back buffer.  The blitter gives no
+// ordering guarantee for overlapping rects, so an overlapping copy is cut
+// into bands as tall (or wide) as the distance moved: no band overlaps its
+// own source, and the bands run away from the overlap, flushed in between.
+void fb_accel_copy_rect(framebuffer* fb, int src_x, int src_y,
+                        int dst_x, int dst_y, int width, int height) {
+    if (!fb->gpu) {
+        fb_copy_rect(fb, src_x, src_y, dst_x, dst_y, width, height);
+        return;
+    }
+    
+    fb_rect r, s;
+    if (!clip_copy(fb, src_x, src_y, dst_x, dst_y, width, height, &r, &s)) return;
+    
+    int move_x = r.x1 - s.x1;
+    int move_y = r.y1 - s.y1;
+    if (!move_x && !move_y) return;
+    
+    bool ok = true;
+    if (r.x2 <= s.x1 || s.x2 <= r.x1 || r.y2 <= s.y1 || s.y2 <= r.y1) {
+        // Disjoint
+        ok = blt_emit_copy(fb->gpu, fb->stride, fb->gtt_offset, fb->gtt_offset,
+                           &r, s.x1, s.y1);
+    } else if (move_y) {
+        int band = move_y > 0 ? move_y : -move_y;
+        int rows = r.y2 - r.y1;
+        
+        for (int done = 0; ok && done < rows; done += band) {
+            int n = rows - done < band ? rows - done : band;
+            // Moving down: start at the bottom
+            int off = move_y > 0 ? rows - done - n : done;
+            fb_rect b = {r.x1, r.y1 + off, r.x2, r.y1 + off + n};
             
-            if (px >= 0 && px < mode->hdisplay && 
-                py >= 0 && py < mode->vdisplay) {
-                uint32_t offset = py * (fb->stride / 4) + px;
-                pixels[offset] = color;
-            }
+            ok = blt_emit_copy(fb->gpu, fb->stride, fb->gtt_offset, fb->gtt_offset,
+                               &b, s.x1, s.y1 + off) &&
+                 blt_emit_flush(fb->gpu);
+        }
+    } else {
+        int band = move_x > 0 ? move_x : -move_x;
+        int cols = r.x2 - r.x1;
+        
+        for (int done = 0; ok && done < cols; done += band) {
+            int n = cols - done < band ? cols - done : band;
+            // Moving right: start at the right edge
+            int off = move_x > 0 ? cols - done - n : done;
+            fb_rect b = {r.x1 + off, r.y1, r.x1 + off + n, r.y2};
+            
+            ok = blt_emit_copy(fb->gpu, fb->stride, fb->gtt_offset, fb->gtt_offset,
+                               &b, s.x1 + off, s.y1) &&
+                 blt_emit_flush(fb->gpu);
         }
     }
+    
+    if (!ok) {
+        // Bands already done are harmless to repeat on the CPU
+        fb_sync(fb);
+        fb->gpu = NULL;
+        fb_copy_rect(fb, src_x, src_y, dst_x, dst_y, width, height);
+        return;
+    }
+    
+    fb->gpu_busy = true;
+    damage_add(&fb->damage, &r);
+}
+
+// Scroll the contents of a rect by (dx, dy) and fill the strips it uncovers,
+// e.g. a VIO window moving up one text line: dy = -cell height.
+void fb_accel_scroll(framebuffer* fb, int x, int y, int width, int height,
+                     int dx, int dy, uint32_t fill) {
+    int adx = dx < 0 ? -dx : dx;
+    int ady = dy < 0 ? -dy : dy;
+    
+    if (adx >= width || ady >= height) {
+        fb_accel_fill_rect(fb, x, y, width, height, fill);
+        return;
+    }
+    
+    // The part of the rect that is still inside it after the move
+    int src_x = x + (dx < 0 ? adx : 0);
+    int src_y = y + (dy < 0 ? ady : 0);
+    fb_accel_copy_rect(fb, src_x, src_y, src_x + dx, src_y + dy,
+                       width - adx, height - ady);
+    
+    if (dy > 0) fb_accel_fill_rect(fb, x, y, width, dy, fill);
+    if (dy < 0) fb_accel_fill_rect(fb, x, y + height - ady, width, ady, fill);
+    if (dx > 0) fb_accel_fill_rect(fb, x, y, dx, height, fill);
+    if (dx < 0) fb_accel_fill_rect(fb, x + width - adx, y, adx, height, fill);
 }
 
 // ============================================================================
-// 9. EXAMPLE USAGE
+// 10. FREEPM ACCELERATION INTERFACE
+// ============================================================================
+
+/*
+ * The FreePM server queries this table through FPM_DeviceQueryAccel()
+ * (see Fs_driver.h) and routes GpiBox/GpiLine and window scrolling through
+ * it.  FreePM works in PM coordinates and converts to device coordinates
+ * (origin top left) before calling in.
+ */
+
+static intel_gpu_device* fpm_gpu = NULL;
+static framebuffer* fpm_fb = NULL;
+static FPM_ACCEL fpm_accel;
+
+static int fpm_fill_rect(int x, int y, int cx, int cy, unsigned long color) {
+    fb_accel_fill_rect(fpm_fb, x, y, cx, cy, (uint32_t)color | 0xFF000000);
+    return 1;
+}
+
+static int fpm_copy_rect(int xSrc, int ySrc, int xDst, int yDst, int cx, int cy) {
+    fb_accel_copy_rect(fpm_fb, xSrc, ySrc, xDst, yDst, cx, cy);
+    return 1;
+}
+
+static int fpm_scroll(int x, int y, int cx, int cy, int dx, int dy,
+                      unsigned long fill) {
+    fb_accel_scroll(fpm_fb, x, y, cx, cy, dx, dy, (uint32_t)fill | 0xFF000000);
+    return 1;
+}
+
+static int fpm_present(void) {
+    intel_gpu_device* gpu = fpm_fb->gpu;
+    
+    // Without a blitter the plane registers are still ours to flip
+    if (!gpu) gpu = fpm_gpu;
+    return fb_present(gpu, fpm_fb);
+}
+
+void fpm_accel_attach(intel_gpu_device* gpu, framebuffer* fb) {
+    fpm_gpu = gpu;
+    fpm_fb = fb;
+    
+    fpm_accel.cb = sizeof(FPM_ACCEL);
+    fpm_accel.cx = fb->width;
+    fpm_accel.cy = fb->height;
+    fpm_accel.fl = fb->gpu ? FPM_ACCEL_HW : 0;
+    fpm_accel.FillRect = fpm_fill_rect;
+    fpm_accel.CopyRect = fpm_copy_rect;
+    fpm_accel.Scroll = fpm_scroll;
+    fpm_accel.Present = fpm_present;
+}
+
+// Exported by the display driver DLL, looked up by name like FPM_DeviceStart
+extern "C" PFPM_ACCEL FPM_DeviceQueryAccel(void) {
+    return fpm_fb ? &fpm_accel : NULL;
+}
+
+// ============================================================================
+// 11. TEST FUNCTIONS - DRAWING TO FRAMEBUFFER
+// ============================================================================
+
+void draw_test_pattern(framebuffer* fb, display_mode* mode) {
+    // Draw color bars
+    static const uint32_t colors[8] = {
+        0xFFFFFFFF, // White
+        0xFFFFFF00, // Yellow
+        0xFF00FFFF, // Cyan
+        0xFF00FF00, // Green
+        0xFFFF00FF, // Magenta
+        0xFFFF0000, // Red
+        0xFF0000FF, // Blue
+        0xFF000000, // Black
+    };
+    
+    for (int i = 0; i < 8; i++) {
+        int x1 = mode->hdisplay * i / 8;
+        int x2 = mode->hdisplay * (i + 1) / 8;
+        fb_fill_rect(fb, x1, 0, x2 - x1, mode->vdisplay, colors[i]);
+    }
+    
+    printf("Drew test pattern\n");
+}
+
+void fill_screen(framebuffer* fb, display_mode* mode, uint32_t color) {
+    fb_fill_rect(fb, 0, 0, mode->hdisplay, mode->vdisplay, color);
+}
+
+void draw_rectangle(framebuffer* fb, display_mode* mode, 
+                    int x, int y, int width, int height, uint32_t color) {
+    fb_fill_rect(fb, x, y, width, height, color);
+}
+
+// ============================================================================
+// 12. EXAMPLE USAGE
 // ============================================================================
 
 void example_main() {
@@ -784,6 +1817,7 @@ void example_main() {
     edid_info edid;
     read_edid(&gpu, 3, &edid); // Re-read for mode info
     draw_test_pattern(&fb, &edid.preferred_mode);
+    fb_present(&gpu, &fb);
     
     // Wait a bit
     usleep(2000000); // 2 seconds
@@ -796,11 +1830,14 @@ void example_main() {
     draw_rectangle(&fb, &edid.preferred_mode, 350, 200, 300, 200, 0xFF00FF00); // Green
     draw_rectangle(&fb, &edid.preferred_mode, 200, 400, 400, 100, 0xFFFFFFFF); // White
     
+    // One flip shows the clear and all three rectangles together
+    fb_present(&gpu, &fb);
+    
     printf("Display test complete\n");
 }
 
 // ============================================================================
-// 10. UTILITY MACROS AND HELPERS
+// 13. UTILITY MACROS AND HELPERS
 // ============================================================================
 
 #define ALIGN_UP(x, align) (((x) + ((align) - 1)) & ~((align) - 1))
@@ -847,6 +1884,22 @@ void* map_physical_memory(uint64_t physical_addr, uint64_t size) {
     return NULL; // Replace with actual implementation
 }
 
+void* map_physical_memory_wc(uint64_t physical_addr, uint64_t size) {
+    // As map_physical_memory(), but with PWT set (PCD clear) in each PTE,
+    // which selects the PAT entry setup_pat_wc() made write-combining.
+    // Use only for pixel memory - never for registers.
+    return NULL; // Replace with actual implementation
+}
+
+void unmap_physical_memory(void* virtual_addr, uint64_t size) {
+    // Remove the mapping and flush the TLB for the range
+}
+
+void* map_physical_memory_wb(uint64_t physical_addr, uint64_t size) {
+    // As map_physical_memory(), but ordinary write-back cacheable (PAT 0)
+    return NULL; // Replace with actual implementation
+}
+
 uint64_t allocate_physical_pages(uint64_t size) {
     // Allocate contiguous physical memory
     // Return physical address of allocated memory
@@ -857,6 +1910,35 @@ void free_physical_pages(uint64_t physical_addr, uint64_t size) {
     // Free previously allocated physical memory
 }
 
+// Reprogram PAT entry 1 (power-on default: write-through) as
+// write-combining.  Must run on every CPU with the same value, before any
+// mapping that uses it.
+void setup_pat_wc() {
+    #ifdef __x86_64__
+    uint32_t lo, hi;
+    __asm__ volatile ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(IA32_PAT));
+    lo = (lo & ~(0x7 << PAT_ENTRY1_SHIFT)) | (PAT_WC << PAT_ENTRY1_SHIFT);
+    __asm__ volatile ("wrmsr" : : "a"(lo), "d"(hi), "c"(IA32_PAT));
+    #endif
+}
+
+// AVX2 needs both the CPU feature and the OS saving YMM state (XCR0)
+bool cpu_has_avx2() {
+    #ifdef __x86_64__
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ volatile ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1), "c"(0));
+    if (!(ecx & (1 << 27))) return false; // OSXSAVE
+    
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__ volatile ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 0x6) != 0x6) return false; // XMM and YMM state enabled
+    
+    __asm__ volatile ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+    return (ebx & (1 << 5)) != 0;
+    #endif
+    return false;
+}
+
 // I/O port access - implement based on your architecture
 void outl(uint16_t port, uint32_t value) {
     #ifdef __x86_64__
@@ -916,8 +1998,12 @@ uint32_t inl(uint16_t port) {
  *    - Audio over HDMI/DP needs separate configuration
  * 
  * 8. PERFORMANCE:
- *    - Consider using write-combining memory for framebuffer
- *    - Implement double/triple buffering for smooth updates
+ *    - Scanout surfaces are write-combining and are only ever written
+ *      with streaming stores by fb_present(); never read them back
+ *    - Drawing goes to a cached back buffer and only damaged rects are
+ *      copied out, then the plane is flipped at vblank (section 8)
+ *    - The span kernels use SSE/AVX registers: kernel callers must save
+ *      the interrupted FPU state first (or own it, e.g. a display thread)
  *    - Use hardware cursor for mouse pointer
  * 
  * 9. TESTING:
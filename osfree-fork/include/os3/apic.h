@@ -252,6 +252,8 @@ void lapic_send_ipi_all(uint32_t vector);
 void lapic_send_ipi_all_excluding_self(uint32_t vector);
 void lapic_send_init(uint32_t dest_apic_id);
 void lapic_send_startup(uint32_t dest_apic_id, uint32_t vector);
+void lapic_send_init_all(void);
+void lapic_send_startup_all(uint32_t vector);
 
 /* Wait for IPI delivery */
 void lapic_wait_ipi(void);
@@ -261,6 +263,7 @@ int ioapic_route_irq(uint32_t irq, uint32_t vector, uint32_t dest_cpu,
                      int level_triggered, int active_low);
 int ioapic_mask_irq(uint32_t irq);
 int ioapic_unmask_irq(uint32_t irq);
+int ioapic_irq_in_flight(uint32_t irq);
 
 /* Find I/O APIC for given GSI */
 ioapic_t *ioapic_for_gsi(uint32_t gsi);
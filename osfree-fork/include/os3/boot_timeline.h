@@ -0,0 +1,96 @@
+/*
+ * osFree Boot Timeline
+ * Copyright (c) 2024 osFree Project
+ *
+ * TSC-stamped begin/end marks around the kernel init steps, kept in
+ * a static buffer that is still there when user space starts
+ */
+
+#ifndef _OS3_BOOT_TIMELINE_H_
+#define _OS3_BOOT_TIMELINE_H_
+
+#include <os3/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Init steps (arg is the CPU for the per-CPU ones) */
+#define BOOT_EV_NUMA_INIT           1
+#define BOOT_EV_SMP_INIT            2
+#define BOOT_EV_LAPIC_INIT          3
+#define BOOT_EV_LAPIC_CALIBRATE     4
+#define BOOT_EV_IOAPIC_INIT         5
+#define BOOT_EV_SCHED_INIT          6
+#define BOOT_EV_SCHED_INIT_CPU      7   /* arg = cpu */
+#define BOOT_EV_SMP_BOOT_CPU        8   /* arg = cpu */
+#define BOOT_EV_SMP_BOOT_PARALLEL   9
+#define BOOT_EV_AP_ENTRY            10  /* arg = cpu, trampoline -> online */
+#define BOOT_EV_AP_CALIBRATE        11  /* arg = cpu */
+#define BOOT_EV_FB_INIT             12
+#define BOOT_EV_MAX                 13
+
+/* Set in 'event' on the record that closes a step */
+#define BOOT_EV_END                 0x8000
+
+/* Records kept; later marks are counted as dropped */
+#define BOOT_TIMELINE_SIZE          512
+
+/*
+ * One mark (stable layout for export)
+ */
+typedef struct boot_timeline_entry {
+    uint64_t tsc;
+    uint32_t arg;
+    uint16_t event;                 /* BOOT_EV_*, | BOOT_EV_END */
+    uint16_t reserved;
+} boot_timeline_entry_t;
+
+/*
+ * Export header
+ */
+typedef struct boot_timeline_info {
+    uint32_t count;                 /* Records in the buffer */
+    uint32_t dropped;               /* Marks that did not fit */
+    uint64_t tsc_freq;              /* Hz, 0 if not known yet */
+} boot_timeline_info_t;
+
+static inline uint64_t boot_timeline_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t cnt;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(cnt));
+    return cnt;
+#else
+    return 0;
+#endif
+}
+
+#ifdef CONFIG_BOOT_TIMELINE
+
+void boot_mark(uint16_t event, uint32_t arg);
+
+/* Copy out up to 'max' records; returns the number copied */
+uint32_t boot_timeline_export(boot_timeline_entry_t *buf, uint32_t max,
+                              boot_timeline_info_t *info);
+void boot_timeline_dump(void);
+
+#else
+
+#define boot_mark(event, arg)                   do { } while (0)
+#define boot_timeline_export(buf, max, info)    (0)
+#define boot_timeline_dump()                    do { } while (0)
+
+#endif /* CONFIG_BOOT_TIMELINE */
+
+#define boot_begin(event, arg)      boot_mark((event), (arg))
+#define boot_end(event, arg)        boot_mark((event) | BOOT_EV_END, (arg))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OS3_BOOT_TIMELINE_H_ */
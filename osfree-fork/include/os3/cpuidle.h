@@ -0,0 +1,85 @@
+/*
+ * osFree CPU Idle States
+ * Copyright (c) 2024 osFree Project
+ *
+ * C-state selection for the idle loop and per-CPU residency and
+ * frequency statistics
+ */
+
+#ifndef _OS3_CPUIDLE_H_
+#define _OS3_CPUIDLE_H_
+
+#include <os3/types.h>
+#include <os3/smp.h>
+
+#define CPUIDLE_MAX_STATES      8
+
+/* How a state is entered */
+#define CPUIDLE_ENTER_HLT       0
+#define CPUIDLE_ENTER_MWAIT     1
+
+/* State flags */
+#define CPUIDLE_FLAG_TIMER_STOP 0x0001  /* LAPIC timer stops (no ARAT) */
+
+/* Governor correction factor, fixed point */
+#define CPUIDLE_CORR_SHIFT      10
+#define CPUIDLE_CORR_ONE        (1U << CPUIDLE_CORR_SHIFT)
+
+/*
+ * Idle state - C1 first, deeper states after it
+ */
+typedef struct cpuidle_state {
+    char name[8];
+    uint32_t enter;                 /* CPUIDLE_ENTER_* */
+    uint32_t mwait_hint;            /* EAX for MWAIT */
+    uint32_t flags;                 /* CPUIDLE_FLAG_* */
+    uint32_t exit_latency_us;       /* Wakeup cost */
+    uint32_t target_residency_us;   /* Break-even sleep length */
+} cpuidle_state_t;
+
+/*
+ * Per-CPU statistics
+ */
+typedef struct cpuidle_cpu {
+    uint64_t usage[CPUIDLE_MAX_STATES];
+    uint64_t residency_ns[CPUIDLE_MAX_STATES];
+    uint64_t nr_above;              /* Woke before target residency */
+    uint64_t nr_below;              /* A deeper state would have paid off */
+
+    /* Governor state */
+    uint32_t correction;            /* Actual / timer-predicted idle */
+    uint64_t avg_idle_ns;           /* Recent idle periods, averaged */
+    uint32_t last_state;
+
+    /* Effective frequency while busy (APERF/MPERF) */
+    uint64_t aperf;
+    uint64_t mperf;
+    uint64_t idle_exit_ns;
+} PERCPU_ALIGNED cpuidle_cpu_t;
+
+/* Wakeup latency limit for all CPUs; 0 means no limit */
+extern uint32_t cpuidle_latency_limit_us;
+
+/* Probe MWAIT states - on the BSP, after ACPI tables are parsed */
+void cpuidle_init(void);
+
+/*
+ * Replace the probed table, e.g. with states read from ACPI _CST.
+ * Only callable before the APs start idling.
+ */
+int cpuidle_register_states(const cpuidle_state_t *states, uint32_t count);
+
+/* Pick a state, enter it, and account the time spent */
+void cpuidle_enter(uint32_t cpu);
+
+/* Idle loop for a CPU's boot context and idle thread; never returns */
+void cpu_idle_loop(uint32_t cpu);
+void idle_thread_func(void *arg);
+
+/* Statistics */
+uint32_t cpuidle_state_count(void);
+const cpuidle_state_t *cpuidle_get_state(uint32_t state);
+int cpuidle_get_stats(uint32_t cpu, uint32_t state,
+                      uint64_t *usage, uint64_t *residency_ns);
+
+#endif /* _OS3_CPUIDLE_H_ */
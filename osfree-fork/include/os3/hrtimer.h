@@ -0,0 +1,71 @@
+/*
+ * osFree High-Resolution Timers
+ * Copyright (c) 2024 osFree Project
+ *
+ * Per-CPU one-shot timer queues driving the Local APIC timer,
+ * with the scheduler tick stopped on idle CPUs
+ */
+
+#ifndef _OS3_HRTIMER_H_
+#define _OS3_HRTIMER_H_
+
+#include <os3/types.h>
+#include <os3/spinlock.h>
+
+/* Scheduler tick period (100 Hz, same as the periodic LAPIC setup) */
+#define TICK_NS                 10000000ULL
+
+/* Shortest delta programmed into the LAPIC */
+#define HRTIMER_MIN_DELTA_NS    2000ULL
+
+/* Pending timers per CPU */
+#define HRTIMER_MAX_PER_CPU     1024
+
+struct hrtimer;
+typedef void (*hrtimer_fn_t)(struct hrtimer *timer);
+
+/*
+ * Timer - expiry is absolute, in get_time_ns() time.
+ * Callbacks run in interrupt context on the CPU the timer was
+ * started on, with the timer queue unlocked.
+ */
+typedef struct hrtimer {
+    uint64_t expires;
+    hrtimer_fn_t fn;
+    void *data;
+    int32_t heap_idx;               /* Position in queue, -1 if idle */
+    uint32_t cpu;                   /* Queue the timer is on */
+} hrtimer_t;
+
+/*
+ * Per-CPU timer queue (binary min-heap on expires)
+ */
+typedef struct hrtimer_base {
+    spinlock_t lock;
+    hrtimer_t **heap;
+    uint32_t count;
+    uint32_t capacity;
+    hrtimer_t * volatile running;   /* Callback in progress */
+    
+    hrtimer_t tick;                 /* Scheduler tick */
+    int tick_stopped;               /* Idle: tick not queued */
+    
+    uint64_t nr_events;             /* Timer interrupts */
+    uint64_t nr_idle_stops;         /* Times the tick was stopped */
+} PERCPU_ALIGNED hrtimer_base_t;
+
+int hrtimer_init_cpu(void);
+void hrtimer_setup(hrtimer_t *timer, hrtimer_fn_t fn, void *data);
+int hrtimer_start(hrtimer_t *timer, uint64_t expires);
+int hrtimer_cancel(hrtimer_t *timer);
+int hrtimer_active(const hrtimer_t *timer);
+uint64_t hrtimer_next_event(uint32_t cpu);
+
+/* Timer interrupt entry (from apic_timer_handler) */
+int hrtimer_interrupt(void);
+
+/* Tickless idle */
+void tick_nohz_idle_enter(void);
+void tick_nohz_idle_exit(void);
+
+#endif /* _OS3_HRTIMER_H_ */
@@ -0,0 +1,80 @@
+/*
+ * osFree Interrupt Balancing
+ * Copyright (c) 2024 osFree Project
+ *
+ * Periodically spreads device interrupts over the CPUs of the node
+ * the device sits on, based on per-CPU interrupt counts
+ */
+
+#ifndef _OS3_IRQBALANCE_H_
+#define _OS3_IRQBALANCE_H_
+
+#include <os3/types.h>
+#include <os3/smp.h>
+
+/* Legacy IRQs / GSIs tracked */
+#define IRQB_MAX_IRQS           128
+
+/* Rebalance period */
+#define IRQB_INTERVAL_NS        2000000000ULL
+
+/* Interrupts per period below which an IRQ is left where it is */
+#define IRQB_MIN_RATE           200
+
+/* Device classes - IRQs of a class are spread before being stacked */
+#define IRQ_CLASS_OTHER         0
+#define IRQ_CLASS_NET           1
+#define IRQ_CLASS_STORAGE       2
+#define IRQ_CLASS_COUNT         3
+
+/* irqbalance_register() flags */
+#define IRQB_LEVEL              0x0001  /* Level triggered */
+#define IRQB_ACTIVE_LOW         0x0002
+#define IRQB_PINNED             0x0004  /* Counted, never moved */
+
+/* Device's node unknown - any online CPU will do */
+#define IRQB_NODE_ANY           (-1)
+
+/*
+ * Retarget hook for interrupts not routed through the I/O APIC
+ * (MSI).  Returns 0 once new interrupts go to 'cpu'.
+ */
+typedef int (*irq_set_affinity_fn)(uint32_t irq, uint32_t vector,
+                                   uint32_t cpu, void *data);
+
+/*
+ * Per-CPU interrupt counts
+ */
+typedef struct irq_stat {
+    uint32_t count[IRQB_MAX_IRQS];
+} PERCPU_ALIGNED irq_stat_t;
+
+extern irq_stat_t irq_stats[MAX_CPUS];
+
+/*
+ * Count a device interrupt on this CPU - from the IRQ entry path,
+ * before the handler runs
+ */
+static inline void irq_account(uint32_t irq) {
+    uint32_t cpu = smp_processor_id();
+
+    if (irq < IRQB_MAX_IRQS)
+        irq_stats[cpu].count[irq]++;
+    smp_info.cpus[cpu]->irq_count++;
+}
+
+void irqbalance_init(void);
+
+/* Hand an IRQ to the balancer; routes it right away */
+int irqbalance_register(uint32_t irq, uint32_t vector, uint32_t irq_class,
+                        int32_t node, uint32_t flags,
+                        irq_set_affinity_fn set_affinity, void *data);
+void irqbalance_unregister(uint32_t irq);
+
+/* CPU an IRQ currently targets, or -1 if not registered */
+int irqbalance_irq_cpu(uint32_t irq);
+
+/* Periodic pass - from apic_timer_handler() */
+void irqbalance_tick(void);
+
+#endif /* _OS3_IRQBALANCE_H_ */
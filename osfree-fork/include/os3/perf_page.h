@@ -0,0 +1,139 @@
+/*
+ * osFree Performance Counter Pages
+ * Copyright (c) 2024 osFree Project
+ *
+ * Per-CPU and per-node counters exported read-only to user space, so
+ * monitors can sample CPU load, IPIs and free memory without a kernel
+ * call.  DosPerfSysCall() in DOSCALLS answers CMD_KI_RDCNT from here.
+ */
+
+#ifndef _OS3_PERF_PAGE_H_
+#define _OS3_PERF_PAGE_H_
+
+#include <os3/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Named shared memory the pages are exported as (read-only) */
+#define PERF_PAGE_NAME          "\\SHAREMEM\\OS3PERF"
+
+#define PERF_PAGE_MAGIC         0x46524550      /* 'PERF' */
+#define PERF_PAGE_VERSION       1
+
+/*
+ * Records are two cache lines each, so a CPU refreshing its own
+ * never shares a line (or an adjacent-line prefetch) with another
+ */
+#define PERF_RECORD_SIZE        128
+
+#define PERF_MAX_CPUS           256
+#define PERF_MAX_NODES          64
+#define PERF_NODE_ORDERS        16
+
+/* Nodes are refreshed at most this often (the walk takes no locks) */
+#define PERF_NODE_INTERVAL_NS   100000000ULL
+
+/*
+ * Region layout - user-visible ABI, only ever append fields.  The
+ * header page is followed by the CPU records, then the node records;
+ * readers should use the offsets in the header rather than assume.
+ */
+typedef struct perf_page_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;               /* PERF_RECORD_SIZE */
+    uint32_t cpu_offset;                /* From the header, in bytes */
+    uint32_t cpu_count;                 /* Records in use */
+    uint32_t node_offset;
+    uint32_t node_count;
+    uint32_t node_orders;               /* Entries used in free_blocks[] */
+} perf_page_header_t;
+
+/*
+ * One CPU, written only by that CPU.  Readers retry while seq is odd
+ * or changed under them.  Times are nanoseconds up to timestamp_ns;
+ * a CPU that sleeps with its tick stopped stops advancing it, which
+ * reads as no load.
+ */
+typedef struct perf_cpu_record {
+    volatile uint32_t seq;
+    uint32_t cpu;
+    uint32_t node;
+    uint32_t online;
+    uint64_t timestamp_ns;              /* get_time_ns() at refresh */
+    uint64_t busy_ns;
+    uint64_t idle_ns;
+    uint64_t irqs;                      /* Device interrupts taken */
+    uint64_t ipis_sent;
+    uint64_t ipis_received;
+    uint64_t context_switches;
+    uint64_t remote_wakeups;            /* Threads woken from other CPUs */
+    uint64_t steals;                    /* Threads pulled while idle */
+    uint64_t load;                      /* Run queue weighted load */
+    uint32_t nr_running;
+    uint32_t idle;                      /* In the idle loop at refresh */
+} __attribute__((aligned(PERF_RECORD_SIZE))) perf_cpu_record_t;
+
+/*
+ * One NUMA node, written by whichever CPU's tick got there first
+ */
+typedef struct perf_node_record {
+    volatile uint32_t seq;
+    uint32_t node;
+    uint64_t timestamp_ns;
+    uint64_t total_pages;
+    uint64_t free_pages;
+    uint32_t free_blocks[PERF_NODE_ORDERS];     /* Buddy blocks per order */
+} __attribute__((aligned(PERF_RECORD_SIZE))) perf_node_record_t;
+
+static inline const perf_cpu_record_t *
+perf_page_cpu(const perf_page_header_t *hdr, uint32_t cpu) {
+    return (const perf_cpu_record_t *)((const uint8_t *)hdr + hdr->cpu_offset +
+                                       cpu * hdr->record_size);
+}
+
+static inline const perf_node_record_t *
+perf_page_node(const perf_page_header_t *hdr, uint32_t node) {
+    return (const perf_node_record_t *)((const uint8_t *)hdr + hdr->node_offset +
+                                        node * hdr->record_size);
+}
+
+/* Consistent copy of one CPU record */
+static inline void perf_page_read_cpu(const perf_page_header_t *hdr,
+                                      uint32_t cpu, perf_cpu_record_t *out) {
+    const perf_cpu_record_t *rec = perf_page_cpu(hdr, cpu);
+    uint32_t seq;
+
+    do {
+        seq = rec->seq;
+        *out = *rec;
+    } while ((seq & 1) || seq != rec->seq);
+}
+
+/* Kernel side */
+void perf_page_init(void);
+const perf_page_header_t *perf_page_get(void);   /* For the shared memory export */
+void perf_page_set_topology(uint32_t cpu_count);
+
+/* Refresh this CPU's record (and the nodes when due) - from apic_timer_handler() */
+void perf_page_tick(void);
+
+/* Idle loop transitions, so busy and idle time split exactly */
+void perf_page_idle_enter(uint32_t cpu, uint64_t now);
+void perf_page_idle_exit(uint32_t cpu, uint64_t now);
+
+/* IPI accounting, on the sending and the receiving CPU */
+void perf_count_ipi_sent(void);
+void perf_count_ipi_received(void);
+
+/* From numa.c - free memory of one node, -1 if there is no such node */
+int numa_node_stats(uint32_t node, uint64_t *total_pages, uint64_t *free_pages,
+                    uint32_t *free_blocks, uint32_t max_orders);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OS3_PERF_PAGE_H_ */
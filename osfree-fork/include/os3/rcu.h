@@ -0,0 +1,93 @@
+/*
+ * osFree Read-Copy-Update
+ * Copyright (c) 2024 osFree Project
+ *
+ * Quiescent-state based deferred reclamation for read-mostly kernel
+ * data.  Readers only disable preemption; a grace period has elapsed
+ * once every online CPU has context switched or gone idle.
+ */
+
+#ifndef _OS3_RCU_H_
+#define _OS3_RCU_H_
+
+#include <os3/types.h>
+#include <os3/spinlock.h>
+
+/* synchronize_rcu() poll interval */
+#define RCU_SYNC_POLL_NS        1000000ULL
+
+struct rcu_head;
+typedef void (*rcu_callback_t)(struct rcu_head *head);
+
+/*
+ * Embedded in objects freed through call_rcu()
+ */
+typedef struct rcu_head {
+    struct rcu_head *next;
+    rcu_callback_t func;
+} rcu_head_t;
+
+/*
+ * Per-CPU state
+ */
+typedef struct rcu_data {
+    volatile uint64_t qs_count;     /* Quiescent states passed */
+    volatile int idle;              /* In the idle loop (quiescent) */
+
+    /* Callbacks not yet assigned a grace period */
+    rcu_head_t *next_list;
+    rcu_head_t **next_tail;
+
+    /* Callbacks waiting for grace period wait_gp */
+    rcu_head_t *wait_list;
+    rcu_head_t **wait_tail;
+    uint64_t wait_gp;
+
+    uint64_t nr_queued;
+    uint64_t nr_invoked;
+} PERCPU_ALIGNED rcu_data_t;
+
+/* Read side - from scheduler.c */
+void preempt_disable(void);
+void preempt_enable(void);
+
+/*
+ * Read-side critical section.  Must not sleep or block.
+ */
+static inline void rcu_read_lock(void) {
+    preempt_disable();
+}
+
+static inline void rcu_read_unlock(void) {
+    preempt_enable();
+}
+
+/* Load a pointer published with rcu_assign_pointer() */
+#define rcu_dereference(p)      (*(volatile __typeof__(p) *)&(p))
+
+/* Publish a pointer once the object it points to is initialized */
+#define rcu_assign_pointer(p, v) \
+    do { wmb(); (p) = (v); } while (0)
+
+/* Initialization */
+void rcu_init(void);
+void rcu_init_cpu(uint32_t cpu);
+
+/* Update side */
+void call_rcu(rcu_head_t *head, rcu_callback_t func);
+void synchronize_rcu(void);
+
+/*
+ * Quiescent state reporting (scheduler and idle loop).  An idle CPU
+ * counts as quiescent throughout, so interrupt handlers that run
+ * between rcu_idle_enter() and rcu_idle_exit() must not use RCU.
+ */
+void rcu_note_context_switch(uint32_t cpu);
+void rcu_idle_enter(void);
+void rcu_idle_exit(void);
+
+/* Grace period and callback processing, from the scheduler tick */
+void rcu_check_callbacks(uint32_t cpu);
+int rcu_needs_cpu(uint32_t cpu);
+
+#endif /* _OS3_RCU_H_ */
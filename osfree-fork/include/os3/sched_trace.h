@@ -0,0 +1,83 @@
+/*
+ * osFree Scheduler Tracing
+ * Copyright (c) 2024 osFree Project
+ *
+ * Per-CPU binary trace rings for scheduler events, plus
+ * run-queue latency and time-slice histograms
+ */
+
+#ifndef _OS3_SCHED_TRACE_H_
+#define _OS3_SCHED_TRACE_H_
+
+#include <os3/types.h>
+#include <os3/smp.h>
+
+/* Event types */
+#define TRACE_SWITCH            1   /* arg0 = prev tid, arg1 = prev state */
+#define TRACE_ENQUEUE           2   /* arg0 = priority */
+#define TRACE_DEQUEUE           3   /* arg0 = priority */
+#define TRACE_REMOTE_WAKE       4   /* arg0 = target cpu */
+#define TRACE_MIGRATE           5   /* arg0 = source cpu, arg1 = dest cpu */
+#define TRACE_STEAL             6   /* arg0 = source cpu */
+#define TRACE_IPI               7   /* arg0 = target cpu, arg1 = IPI_* */
+
+/* Entries per CPU ring (power of two) */
+#define TRACE_RING_ORDER        12
+#define TRACE_RING_SIZE         (1U << TRACE_RING_ORDER)
+
+/* Log2 histogram buckets: bucket N counts values in [2^N, 2^(N+1)) ns */
+#define TRACE_HIST_BUCKETS      40
+
+/*
+ * Binary trace record (stable layout for export)
+ */
+typedef struct sched_trace_entry {
+    uint64_t timestamp;             /* get_time_ns() */
+    uint32_t tid;                   /* Subject thread */
+    uint16_t type;                  /* TRACE_* */
+    uint16_t cpu;                   /* CPU that logged it */
+    uint32_t arg0;
+    uint32_t arg1;
+} sched_trace_entry_t;
+
+/*
+ * Per-CPU ring - written only by its own CPU with interrupts off,
+ * so the writer needs no lock.  'head' counts every record ever
+ * written; readers copy out and detect overwrites by re-reading it.
+ */
+typedef struct sched_trace_ring {
+    volatile uint64_t head;
+    uint64_t dropped;               /* Overwritten before export */
+    sched_trace_entry_t entries[TRACE_RING_SIZE];
+
+    /* Histograms, updated at switch time */
+    uint64_t rq_latency[TRACE_HIST_BUCKETS];   /* enqueue -> run */
+    uint64_t timeslice[TRACE_HIST_BUCKETS];    /* run -> switch out */
+} PERCPU_ALIGNED sched_trace_ring_t;
+
+#ifdef CONFIG_SCHED_TRACE
+
+extern int sched_trace_enabled;
+
+int sched_trace_init_cpu(uint32_t cpu);
+void __sched_trace(uint16_t type, uint32_t tid, uint32_t arg0, uint32_t arg1);
+void sched_trace_switch(struct thread *prev, struct thread *next, uint64_t now);
+
+/* Copy out up to 'max' of the most recent records of a CPU */
+uint32_t sched_trace_export(uint32_t cpu, sched_trace_entry_t *buf,
+                            uint32_t max);
+void sched_trace_reset(void);
+void sched_trace_print_histograms(void);
+
+#define sched_trace(type, tid, a0, a1) \
+    do { if (sched_trace_enabled) __sched_trace(type, tid, a0, a1); } while (0)
+
+#else
+
+#define sched_trace_init_cpu(cpu)               (0)
+#define sched_trace(type, tid, a0, a1)          do { } while (0)
+#define sched_trace_switch(prev, next, now)     do { } while (0)
+
+#endif /* CONFIG_SCHED_TRACE */
+
+#endif /* _OS3_SCHED_TRACE_H_ */
@@ -13,6 +13,9 @@
 #include <os3/smp.h>
 #include <os3/spinlock.h>
 #include <os3/list.h>
+#include <os3/slab.h>
+#include <os3/rcu.h>
+#include <os3/hrtimer.h>
 
 /* Scheduling classes (OS/2 compatible priority classes) */
 #define SCHED_CLASS_IDLE        0   /* Idle time only (class 1) */
@@ -22,6 +25,9 @@
 #define SCHED_CLASS_REALTIME    4   /* Real-time (internal) */
 #define NUM_SCHED_CLASSES       5
 
+/* Deadline (EDF) reservations - own queue, picked before all classes */
+#define SCHED_CLASS_DEADLINE    NUM_SCHED_CLASSES
+
 /* Priority levels within each class */
 #define PRIO_LEVELS_PER_CLASS   32
 #define MAX_PRIORITY            ((NUM_SCHED_CLASSES * PRIO_LEVELS_PER_CLASS) - 1)
@@ -36,6 +42,42 @@
 #define LOAD_BALANCE_INTERVAL   100
 #define IDLE_BALANCE_INTERVAL   1
 
+/* Deadline class limits */
+#define DL_MIN_RUNTIME_NS       100000ULL       /* 100us */
+#define DL_MAX_PERIOD_NS        4000000000ULL   /* 4s */
+#define DL_BW_SHIFT             20              /* Bandwidth fixed point */
+
+/* Thread ID lookup table */
+#define TID_HASH_BITS           8
+#define TID_HASH_SIZE           (1 << TID_HASH_BITS)
+
+/* Work stealing (idle CPU pulls from the busiest sibling) */
+#define STEAL_MAX_ATTEMPTS      3       /* Victims tried per idle pass */
+#define STEAL_CACHE_HOT_NS      500000  /* Leave threads that ran < 0.5ms ago */
+
+/* NUMA placement policies (thread_t.numa_policy) */
+#define NUMA_POLICY_NONE        0       /* Placement ignores memory */
+#define NUMA_POLICY_AUTO        1       /* Follow the node pages came from */
+#define NUMA_POLICY_PREFERRED   2       /* Run on a caller-chosen node */
+#define NUMA_POLICY_MODE_MASK   0x0F
+#define NUMA_POLICY_MIGRATE     0x80    /* Flag: pull memory to where we run */
+
+/* NUMA sampling */
+#define NUMA_SCAN_TICKS         100     /* Sample period (1s at 100 Hz) */
+#define NUMA_MIGRATE_SCANS      4       /* Remote periods before migrating */
+#define NUMA_MIGRATE_BATCH      256     /* Pages moved per period */
+#define NUMA_STEAL_MIN_QUEUE    2       /* Leave home threads on short queues */
+
+/* Wait channel hash table (thread_block/thread_wake) */
+#define WAIT_HASH_BITS          8
+#define WAIT_HASH_SIZE          (1 << WAIT_HASH_BITS)
+
+/* Wait results */
+#define WAIT_RESULT_WOKEN       0
+#define WAIT_RESULT_INTERRUPTED (-1)
+#define WAIT_RESULT_TIMEDOUT    (-2)
+#define WAIT_RESULT_AGAIN       (-3)    /* Word changed, never slept */
+
 /* CPU affinity */
 #define CPU_AFFINITY_ALL        ((uint64_t)-1)  /* Can run on any CPU */
 
@@ -65,6 +107,10 @@ typedef struct thread {
     /* Linkage */
     struct list_head run_list;      /* Link in run queue */
     struct list_head thread_list;   /* Link in process thread list */
+    struct thread *wake_next;       /* Link in remote wake list */
+    struct list_head wait_list;     /* Link in wait channel bucket */
+    struct thread *tid_next;        /* Link in TID hash chain (RCU) */
+    rcu_head_t rcu;                 /* Deferred free after exit */
     
     /* Identity */
     uint32_t tid;                   /* Thread ID */
@@ -84,11 +130,34 @@ typedef struct thread {
     uint64_t total_runtime;         /* Total CPU time (ns) */
     uint64_t last_run;              /* Last time scheduled (ns) */
     uint64_t wait_time;             /* Time spent waiting */
+    uint64_t enqueue_time;          /* Made runnable (tracing only) */
     
     /* CPU affinity */
     uint64_t cpu_affinity;          /* Bitmask of allowed CPUs */
     uint32_t last_cpu;              /* Last CPU this ran on */
     uint32_t preferred_cpu;         /* Preferred CPU (cache hot) */
+    volatile uint32_t on_cpu;       /* last_cpu is still on this stack */
+    volatile uint32_t waking;       /* On wake_cpu's wake list, not queued */
+    uint32_t wake_cpu;
+    
+    /* NUMA placement */
+    uint8_t numa_policy;            /* NUMA_POLICY_* */
+    uint8_t numa_home;              /* Node placement steers towards */
+    uint8_t numa_remote_scans;      /* Consecutive periods run off home */
+    uint16_t numa_pages[MAX_NUMA_NODES];    /* Decayed pages per node */
+    
+    /* Deadline reservation (SCHED_CLASS_DEADLINE) */
+    uint64_t dl_runtime;            /* Budget per period (ns) */
+    uint64_t dl_deadline;           /* Relative deadline (ns) */
+    uint64_t dl_period;             /* Replenishment period (ns) */
+    uint64_t dl_abs_deadline;       /* Current absolute deadline */
+    int64_t dl_remaining;           /* Budget left before dl_abs_deadline */
+    uint64_t dl_bw;                 /* runtime/period << DL_BW_SHIFT */
+    uint32_t dl_cpu;                /* CPU the bandwidth is reserved on */
+    uint8_t dl_throttled;           /* Out of budget until replenished */
+    uint8_t dl_saved_class;         /* Class to return to on clear */
+    uint8_t dl_saved_prio;
+    hrtimer_t dl_timer;             /* Replenishment */
     
     /* Priority boost tracking */
     int8_t priority_boost;          /* Current boost value */
@@ -146,10 +215,25 @@ typedef struct run_queue {
     uint64_t last_balance;          /* Last balance timestamp */
     uint32_t push_cpu;              /* CPU to push tasks to */
     uint32_t pull_cpu;              /* CPU to pull tasks from */
+    uint64_t nr_steals;             /* Threads stolen while idle */
+    
+    /* Deadline class - queued threads in absolute deadline order */
+    struct list_head dl_queue;
+    uint32_t dl_nr_running;
+    uint64_t dl_bw;                 /* Admitted bandwidth on this CPU */
+    uint64_t dl_nr_throttled;       /* Budget overruns */
+    hrtimer_t dl_enforce;           /* Fires when current budget runs out */
+    struct thread *dl_enforce_thread;   /* Reservation dl_enforce is for */
+    
+    /* Remote wakeups (lock-free MPSC stack, drained by owner CPU) */
+    struct thread * volatile wake_list;
+    atomic_t wake_ipi;              /* IPI_RESCHEDULE sent, not yet drained */
+    uint64_t nr_remote_wakeups;     /* Threads received via wake_list */
     
     /* Current thread */
     thread_t *current;              /* Currently running */
     thread_t *idle;                 /* Idle thread for this CPU */
+    thread_t *switched_from;        /* prev of the switch in progress */
     
     /* Time tracking */
     uint64_t clock;                 /* Run queue clock (ns) */
@@ -165,7 +249,7 @@ typedef struct scheduler {
     run_queue_t *runqueues[MAX_CPUS];
     
     /* Global scheduling state */
-    spinlock_t global_lock;         /* For global operations */
+    mcs_lock_t global_lock;         /* For global operations */
     atomic_t total_threads;         /* System-wide thread count */
     
     /* Load balancing domains */
@@ -181,6 +265,9 @@ typedef struct scheduler {
 /* Global scheduler instance */
 extern scheduler_t scheduler;
 
+/* Object cache thread_create() allocates thread_t from */
+extern kmem_cache_t *thread_cache;
+
 /* Convert OS/2 priority class to internal representation */
 static inline uint8_t os2_to_internal_priority(uint8_t prtyclass, uint8_t prtylevel) {
     uint8_t sched_class;
@@ -204,14 +291,32 @@ static inline uint8_t os2_to_internal_priority(uint8_t prtyclass, uint8_t prtyle
 int sched_init(void);
 int sched_init_cpu(uint32_t cpu_id);
 
-/* Thread management */
+/*
+ * Thread management
+ *
+ * thread_create() must build the new thread's initial context so that
+ * the first context_switch() to it lands in sched_thread_entry(entry,
+ * arg), never in entry directly: the CPU switching to it still holds
+ * the previous thread's on_cpu and has interrupts disabled.
+ */
 thread_t *thread_create(struct process *proc, void (*entry)(void*), 
                         void *arg, uint32_t flags);
+void sched_thread_entry(void (*entry)(void *), void *arg);
 void thread_destroy(thread_t *thread);
 void thread_exit(int exit_code);
 
+/*
+ * TID table - lookups are lock-free under rcu_read_lock(), and the
+ * thread_t stays valid until rcu_read_unlock()
+ */
+void tid_hash_insert(thread_t *thread);
+void tid_hash_remove(thread_t *thread);
+thread_t *tid_lookup(uint32_t tid);
+void thread_free_rcu(thread_t *thread);     /* Free after a grace period */
+
 /* Scheduling operations */
 void schedule(void);                        /* Main scheduler entry */
+void sched_finish_switch(void);             /* After context_switch() */
 void sched_tick(void);                      /* Timer tick handler */
 void sched_yield(void);                     /* Voluntary yield */
 
@@ -229,17 +334,53 @@ int set_thread_affinity(thread_t *thread, uint64_t mask);
 uint64_t get_thread_affinity(thread_t *thread);
 int migrate_thread(thread_t *thread, uint32_t dest_cpu);
 
+/*
+ * NUMA placement and balancing.  The VM layer can register hooks to
+ * report sampled page accesses (via sched_numa_account_thread()) and
+ * to move a thread's pages; without them placement follows allocations.
+ */
+typedef struct sched_numa_ops {
+    void (*sample)(thread_t *thread);
+    uint32_t (*migrate)(thread_t *thread, uint32_t node, uint32_t max_pages);
+} sched_numa_ops_t;
+
+void sched_numa_init_thread(thread_t *thread, uint32_t node);
+void sched_numa_register(const sched_numa_ops_t *ops);
+void sched_numa_account(uint32_t node, uint32_t order);
+void sched_numa_account_thread(thread_t *thread, uint32_t node, uint32_t pages);
+uint32_t sched_numa_select_cpu(thread_t *thread, uint32_t cpu);
+void sched_numa_tick(thread_t *curr, uint32_t cpu);
+int sched_numa_set_policy(thread_t *thread, uint32_t policy, uint32_t node);
+
+/*
+ * Deadline class.  Threads are partitioned: admission reserves their
+ * bandwidth on one CPU and they only ever run there.
+ */
+int sched_set_deadline(thread_t *thread, uint64_t runtime_ns,
+                       uint64_t deadline_ns, uint64_t period_ns);
+void sched_clear_deadline(thread_t *thread);
+
+/* Deadline class hooks for the core scheduler (rq->lock held) */
+void sched_dl_init_rq(run_queue_t *rq);
+int sched_dl_enqueue(run_queue_t *rq, thread_t *thread, uint64_t now);
+void sched_dl_account(run_queue_t *rq, thread_t *thread, uint64_t now);
+void sched_dl_start(run_queue_t *rq, thread_t *thread, uint64_t now);
+void sched_dl_stop(run_queue_t *rq);
+
 /* Blocking/waking */
+void wait_table_init(void);
 void thread_block(void *channel);
 void thread_unblock(thread_t *thread);
 void thread_wake(void *channel);            /* Wake all on channel */
 void thread_wake_one(void *channel);        /* Wake one on channel */
+int thread_block_if(void *channel, const volatile uint32_t *word,
+                    uint32_t expected, uint64_t deadline);
 int thread_sleep(uint64_t nanoseconds);
 int thread_sleep_until(uint64_t abs_time);
 
 /* Load balancing */
 void trigger_load_balance(void);
-void idle_balance(uint32_t cpu_id);
+int idle_balance(uint32_t cpu_id);        /* Returns threads pulled */
 uint64_t calc_cpu_load(uint32_t cpu_id);
 
 /* Preemption control */
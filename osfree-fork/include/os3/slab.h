@@ -0,0 +1,92 @@
+/*
+ * osFree Slab Allocator
+ * Copyright (c) 2024 osFree Project
+ *
+ * Object caches for fixed-size kernel objects (threads, run queues,
+ * semaphore records) with per-CPU magazines and NUMA-local slabs
+ */
+
+#ifndef _OS3_SLAB_H_
+#define _OS3_SLAB_H_
+
+#include <os3/types.h>
+#include <os3/smp.h>
+#include <os3/spinlock.h>
+#include <os3/list.h>
+
+/* Objects per per-CPU magazine */
+#define SLAB_MAG_SIZE           32
+
+/* Minimum objects per slab (slab order grows until this fits) */
+#define SLAB_MIN_OBJECTS        8
+#define SLAB_MAX_ORDER          3
+
+/* Empty slabs kept per node before pages go back to the buddy lists */
+#define SLAB_FREE_LIMIT         1
+
+/* Cache creation flags */
+#define SLAB_HWCACHE_ALIGN      (1 << 0)  /* Align objects to cache lines */
+
+/* Object constructor, run once when a slab is populated */
+typedef void (*kmem_ctor_t)(void *obj);
+
+/*
+ * Per-CPU magazine - a small stack of ready objects
+ * Only touched by its CPU with interrupts disabled
+ */
+typedef struct kmem_magazine {
+    uint32_t avail;                 /* Objects on the stack */
+    uint32_t limit;                 /* Capacity */
+    uint64_t hits;                  /* Allocations served here */
+    uint64_t allocs;
+    uint64_t frees;
+    void *objs[SLAB_MAG_SIZE];
+} PERCPU_ALIGNED kmem_magazine_t;
+
+/*
+ * Per-node slab lists
+ */
+typedef struct kmem_node {
+    spinlock_t lock;
+    struct list_head partial;       /* Some objects free */
+    struct list_head full;          /* No objects free */
+    struct list_head free;          /* All objects free */
+    uint32_t nr_slabs;
+    uint32_t nr_free_slabs;
+    uint64_t active_objs;           /* Objects handed out of slabs */
+} kmem_node_t;
+
+/*
+ * Object cache
+ */
+typedef struct kmem_cache {
+    const char *name;
+    uint32_t obj_size;              /* Size including alignment padding */
+    uint32_t align;
+    uint32_t flags;                 /* SLAB_* */
+    uint32_t slab_order;            /* Pages per slab (as buddy order) */
+    uint32_t objs_per_slab;
+    uint32_t first_obj;             /* Offset of first object in a slab */
+    kmem_ctor_t ctor;
+
+    struct list_head cache_list;    /* Link in global cache list */
+
+    kmem_node_t nodes[MAX_NUMA_NODES];
+    kmem_magazine_t *mags[MAX_CPUS];
+} kmem_cache_t;
+
+/* Cache management */
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, size_t align,
+                                uint32_t flags, kmem_ctor_t ctor);
+void kmem_cache_destroy(kmem_cache_t *cache);
+void kmem_cache_shrink(kmem_cache_t *cache);
+
+/* Object allocation */
+void *kmem_cache_alloc(kmem_cache_t *cache);
+void *kmem_cache_alloc_node(kmem_cache_t *cache, uint32_t node);
+void kmem_cache_free(kmem_cache_t *cache, void *obj);
+
+/* Statistics */
+void kmem_cache_print_stats(void);
+
+#endif /* _OS3_SLAB_H_ */
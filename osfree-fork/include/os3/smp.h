@@ -21,6 +21,9 @@
 #define CPU_STATE_ONLINE    2
 #define CPU_STATE_HALTED    3
 
+/* Below this many possible CPUs, APs are started one at a time */
+#define SMP_PARALLEL_MIN_CPUS   4
+
 /* IPI (Inter-Processor Interrupt) Types */
 #define IPI_RESCHEDULE      0x01
 #define IPI_TLB_FLUSH       0x02
@@ -46,6 +49,9 @@
 #define CPU_FEATURE_X2APIC  (1 << 14)
 #define CPU_FEATURE_PCID    (1 << 15)
 #define CPU_FEATURE_INVPCID (1 << 16)
+#define CPU_FEATURE_MONITOR (1 << 17)     /* MONITOR/MWAIT */
+#define CPU_FEATURE_ARAT    (1 << 18)     /* LAPIC timer runs in deep C-states */
+#define CPU_FEATURE_APERFMPERF (1 << 19)
 
 /* Cache line size for alignment */
 #define CACHE_LINE_SIZE     64
@@ -145,11 +151,6 @@ typedef struct smp_info {
     atomic_t startup_count;
     atomic_t ready_count;
     
-    /* IPI function call */
-    void (*ipi_func)(void *arg);
-    void *ipi_arg;
-    atomic_t ipi_pending;
-    
 } smp_info_t;
 
 /* Global SMP info structure */
@@ -195,6 +196,8 @@ static inline int cpu_isset(uint32_t cpu, const uint32_t *mask) {
 /* SMP initialization functions */
 int smp_init(void);
 int smp_boot_cpu(uint32_t cpu_id);
+int smp_boot_cpus_parallel(void);
+extern int smp_parallel_boot;      /* 0 forces serial AP startup */
 void smp_halt_cpu(uint32_t cpu_id);
 int smp_online_cpu(uint32_t cpu_id);
 int smp_offline_cpu(uint32_t cpu_id);
@@ -207,15 +210,91 @@ void smp_send_ipi_mask(const uint32_t *mask, uint32_t ipi_type);
 
 /* Cross-CPU function calls */
 typedef void (*smp_call_func_t)(void *arg);
+
+/* Pending calls per target CPU before senders have to wait */
+#define SMP_CALL_QUEUE_LEN  64
+
+/* smp_call_t flags */
+#define SMP_CALL_ALLOCATED  (1 << 0)    /* Freed by the last reference */
+
+/*
+ * Cross-CPU call.  refs is one per target that has yet to run it,
+ * plus one held by the caller (or an async handle) until put.
+ */
+typedef struct smp_call {
+    smp_call_func_t func;
+    void *arg;
+    atomic_t refs;
+    uint32_t flags;                 /* SMP_CALL_* */
+} smp_call_t;
+
+void smp_call_init_cpu(void);
+void smp_call_process_queue(void);
+
 int smp_call_function(smp_call_func_t func, void *arg, int wait);
 int smp_call_function_single(uint32_t cpu, smp_call_func_t func, 
                              void *arg, int wait);
+int smp_call_function_mask(const uint32_t *mask, smp_call_func_t func,
+                           void *arg, int wait);
+
+/* Async calls: poll or wait on the handle, then drop it */
+smp_call_t *smp_call_function_async(const uint32_t *mask,
+                                    smp_call_func_t func, void *arg);
+int smp_call_done(smp_call_t *call);
+void smp_call_wait(smp_call_t *call);
+void smp_call_put(smp_call_t *call);
 
 /* TLB management */
 void smp_flush_tlb_all(void);
 void smp_flush_tlb_page(void *addr);
 void smp_flush_tlb_range(void *start, void *end);
 
+/* Pages gathered per shootdown before falling back to a full flush */
+#define TLB_BATCH_MAX       32
+
+/* Queued requests past which a target just flushes everything */
+#define TLB_QUEUE_LEN       16
+
+/*
+ * Address space TLB state (embedded in the process address space)
+ *
+ * cpu_mask holds the CPUs that may have TLB entries for this address
+ * space; only those are ever sent a shootdown.  CPUs that are not
+ * actively running it (switched away with PCID, or in lazy TLB mode
+ * running a kernel thread) are marked in stale_mask instead and flush
+ * when they next switch to it.
+ */
+typedef struct tlb_mm {
+    uint64_t cr3;                   /* Page table root */
+    uint16_t pcid;                  /* Process context ID (0 = none) */
+    volatile uint32_t cpu_mask[MAX_CPUS / 32];
+    volatile uint32_t stale_mask[MAX_CPUS / 32];
+} tlb_mm_t;
+
+/*
+ * Shootdown request - a batch of unmapped pages in one address space
+ * (mm == NULL means kernel/global mappings)
+ */
+typedef struct tlb_flush_req {
+    tlb_mm_t *mm;
+    uint32_t nr_pages;
+    int full;                       /* Flush everything instead */
+    uintptr_t pages[TLB_BATCH_MAX];
+    atomic_t pending;               /* CPUs yet to acknowledge */
+} tlb_flush_req_t;
+
+/* Batched shootdown: gather unmaps, then one IPI per target CPU */
+typedef tlb_flush_req_t tlb_gather_t;
+
+void tlb_init_cpu(void);
+void tlb_switch_mm(tlb_mm_t *next);         /* NULL = kernel thread (lazy) */
+void tlb_gather_init(tlb_gather_t *tlb, tlb_mm_t *mm);
+void tlb_gather_page(tlb_gather_t *tlb, uintptr_t addr);
+void tlb_gather_range(tlb_gather_t *tlb, uintptr_t start, uintptr_t end);
+void tlb_gather_finish(tlb_gather_t *tlb);
+void tlb_shootdown(tlb_flush_req_t *req);
+void tlb_process_queue(void);
+
 /* CPU hotplug notifiers */
 typedef int (*cpu_hotplug_callback_t)(uint32_t cpu_id, int online);
 int register_cpu_hotplug_callback(cpu_hotplug_callback_t cb);
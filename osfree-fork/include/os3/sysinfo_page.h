@@ -0,0 +1,83 @@
+/*
+ * osFree System Information Page
+ * Copyright (c) 2024 osFree Project
+ *
+ * Read-only page shared with every process so that DosQuerySysInfo()
+ * can answer the frequently polled QSV indices without a kernel call
+ */
+
+#ifndef _OS3_SYSINFO_PAGE_H_
+#define _OS3_SYSINFO_PAGE_H_
+
+#include <os3/types.h>
+
+/* Named shared memory the page is exported as (read-only) */
+#define SYSINFO_PAGE_NAME       "\\SHAREMEM\\OS3SYSINF"
+
+#define SYSINFO_PAGE_MAGIC      0x464E4953      /* 'SINF' */
+#define SYSINFO_PAGE_VERSION    1
+
+/* QSV indices held in the page */
+#define SYSINFO_QSV_BOOT_DRIVE      5
+#define SYSINFO_QSV_MS_COUNT        14
+#define SYSINFO_QSV_TIME_LOW        15
+#define SYSINFO_QSV_TIME_HIGH       16
+#define SYSINFO_QSV_NUMPROCESSORS   26
+
+/*
+ * Page layout - user-visible ABI, only ever append fields.
+ * Readers retry while seq is odd or changed under them.
+ */
+typedef struct sysinfo_page {
+    uint32_t magic;
+    uint32_t version;
+    volatile uint32_t seq;
+    volatile uint32_t ms_count;         /* QSV_MS_COUNT */
+    volatile uint32_t time_low;         /* QSV_TIME_LOW, seconds since 1980 */
+    volatile uint32_t time_high;        /* QSV_TIME_HIGH */
+    volatile uint32_t boot_drive;       /* QSV_BOOT_DRIVE, 1 = A: */
+    volatile uint32_t num_processors;   /* QSV_NUMPROCESSORS */
+} sysinfo_page_t;
+
+/*
+ * Fill pul[] for iStart..iLast from the page.  Returns -1, leaving
+ * the rest to the full API path, if any index is not held here.
+ */
+static inline int sysinfo_page_query(const sysinfo_page_t *page,
+                                     uint32_t iStart, uint32_t iLast,
+                                     uint32_t *pul) {
+    uint32_t seq, i;
+
+    for (i = iStart; i <= iLast; i++) {
+        if (i != SYSINFO_QSV_BOOT_DRIVE && i != SYSINFO_QSV_NUMPROCESSORS &&
+            (i < SYSINFO_QSV_MS_COUNT || i > SYSINFO_QSV_TIME_HIGH))
+            return -1;
+    }
+
+    do {
+        seq = page->seq;
+        for (i = iStart; i <= iLast; i++) {
+            switch (i) {
+            case SYSINFO_QSV_BOOT_DRIVE:    pul[i - iStart] = page->boot_drive; break;
+            case SYSINFO_QSV_MS_COUNT:      pul[i - iStart] = page->ms_count; break;
+            case SYSINFO_QSV_TIME_LOW:      pul[i - iStart] = page->time_low; break;
+            case SYSINFO_QSV_TIME_HIGH:     pul[i - iStart] = page->time_high; break;
+            case SYSINFO_QSV_NUMPROCESSORS: pul[i - iStart] = page->num_processors; break;
+            }
+        }
+    } while ((seq & 1) || seq != page->seq);
+
+    return 0;
+}
+
+/* Kernel side */
+void sysinfo_page_init(void);
+const sysinfo_page_t *sysinfo_page_get(void);     /* For the shared memory export */
+void sysinfo_page_set_time(uint64_t secs_since_1980);
+void sysinfo_page_set_boot_drive(uint32_t drive);
+void sysinfo_page_set_cpus(uint32_t count);
+
+/* Refresh the counters - from apic_timer_handler() on any CPU */
+void sysinfo_page_tick(void);
+
+#endif /* _OS3_SYSINFO_PAGE_H_ */
@@ -10,6 +10,12 @@
 #include <os3/smp.h>
 #include <os3/memory.h>
 #include <os3/io.h>
+#include <os3/hrtimer.h>
+#include <os3/spinlock.h>
+#include <os3/irqbalance.h>
+#include <os3/sysinfo_page.h>
+#include <os3/perf_page.h>
+#include <os3/boot_timeline.h>
 #include <os3/debug.h>
 
 /* Global Local APIC base address */
@@ -145,6 +151,7 @@ int lapic_init_ap(void) {
 uint64_t lapic_timer_calibrate(void) {
     uint32_t start, end;
     
+    boot_begin(BOOT_EV_LAPIC_CALIBRATE, 0);
     kprintf("APIC: Calibrating timer...\n");
     
     /* Setup timer in one-shot mode with max divider */
@@ -169,6 +176,7 @@ uint64_t lapic_timer_calibrate(void) {
     lapic_write(LAPIC_TIMER_LVT, APIC_TIMER_PERIODIC | VECTOR_TIMER);
     lapic_write(LAPIC_TIMER_ICR, lapic_ticks_per_ms * 10);
     
+    boot_end(BOOT_EV_LAPIC_CALIBRATE, 0);
     return lapic_ticks_per_ms * 1000;  /* Return frequency */
 }
 
@@ -176,10 +184,14 @@ uint64_t lapic_timer_calibrate(void) {
  * Setup one-shot timer
  */
 void lapic_timer_oneshot(uint64_t ns) {
-    uint32_t ticks = (ns * lapic_ticks_per_ms) / 1000000;
+    uint64_t ticks = (ns * lapic_ticks_per_ms) / 1000000;
+    
+    /* A zero count would never fire; clamp long waits to the counter */
+    if (ticks == 0) ticks = 1;
+    if (ticks > 0xFFFFFFFF) ticks = 0xFFFFFFFF;
     
     lapic_write(LAPIC_TIMER_LVT, APIC_TIMER_ONESHOT | VECTOR_TIMER);
-    lapic_write(LAPIC_TIMER_ICR, ticks);
+    lapic_write(LAPIC_TIMER_ICR, (uint32_t)ticks);
 }
 
 /*
@@ -248,6 +260,43 @@ void lapic_send_startup(uint32_t dest_apic_id, uint32_t vector) {
     }
 }
 
+/*
+ * Broadcast INIT to all other CPUs (parallel AP startup)
+ */
+void lapic_send_init_all(void) {
+    if (x2apic_enabled) {
+        uint64_t icr = APIC_DM_INIT | APIC_DEST_ALL_EX |
+                       APIC_LEVEL_ASSERT | APIC_TM_LEVEL;
+        __asm__ volatile("wrmsr" : : "A"(icr), "c"(MSR_X2APIC_ICR));
+    } else {
+        lapic_write(LAPIC_ICR_HI, 0);
+        lapic_write(LAPIC_ICR_LO, APIC_DM_INIT | APIC_DEST_ALL_EX |
+                    APIC_LEVEL_ASSERT | APIC_TM_LEVEL);
+        lapic_wait_ipi();
+        
+        /* Deassert INIT */
+        lapic_write(LAPIC_ICR_LO, APIC_DM_INIT | APIC_DEST_ALL_EX |
+                    APIC_LEVEL_DEASSERT | APIC_TM_LEVEL);
+        lapic_wait_ipi();
+    }
+}
+
+/*
+ * Broadcast STARTUP IPI to all other CPUs
+ */
+void lapic_send_startup_all(uint32_t vector) {
+    if (x2apic_enabled) {
+        uint64_t icr = APIC_DM_STARTUP | APIC_DEST_ALL_EX |
+                       APIC_LEVEL_ASSERT | (vector & 0xFF);
+        __asm__ volatile("wrmsr" : : "A"(icr), "c"(MSR_X2APIC_ICR));
+    } else {
+        lapic_write(LAPIC_ICR_HI, 0);
+        lapic_write(LAPIC_ICR_LO, APIC_DM_STARTUP | APIC_DEST_ALL_EX |
+                    APIC_LEVEL_ASSERT | (vector & 0xFF));
+        lapic_wait_ipi();
+    }
+}
+
 /*
  * Wait for IPI delivery (xAPIC only)
  */
@@ -316,6 +365,9 @@ int ioapic_init(void) {
     return 0;
 }
 
+/* Redirection entries are rewritten at runtime by irqbalance */
+static spinlock_t ioapic_lock = SPINLOCK_INIT("ioapic");
+
 /*
  * Route an IRQ through I/O APIC
  */
@@ -323,6 +375,7 @@ int ioapic_route_irq(uint32_t irq, uint32_t vector, uint32_t dest_cpu,
                      int level_triggered, int active_low) {
     ioapic_t *io;
     ioapic_redir_t redir;
+    irqflags_t flags;
     uint32_t gsi;
     
     /* Convert IRQ to GSI using overrides */
@@ -342,7 +395,9 @@ int ioapic_route_irq(uint32_t irq, uint32_t vector, uint32_t dest_cpu,
     redir.mask = 0;      /* Enabled */
     redir.dest = smp_info.cpus[dest_cpu]->apic_id;
     
+    spin_lock_irqsave(&ioapic_lock, &flags);
     ioapic_write_redir(io, gsi - io->gsi_base, redir.raw);
+    spin_unlock_irqrestore(&ioapic_lock, flags);
     
     return 0;
 }
@@ -354,13 +409,16 @@ int ioapic_mask_irq(uint32_t irq) {
     ioapic_t *io;
     uint32_t gsi = acpi_irq_to_gsi(irq);
     uint64_t redir;
+    irqflags_t flags;
     
     io = ioapic_for_gsi(gsi);
     if (!io) return -1;
     
+    spin_lock_irqsave(&ioapic_lock, &flags);
     redir = ioapic_read_redir(io, gsi - io->gsi_base);
     redir |= (1ULL << 16);  /* Set mask bit */
     ioapic_write_redir(io, gsi - io->gsi_base, redir);
+    spin_unlock_irqrestore(&ioapic_lock, flags);
     
     return 0;
 }
@@ -372,17 +430,39 @@ int ioapic_unmask_irq(uint32_t irq) {
     ioapic_t *io;
     uint32_t gsi = acpi_irq_to_gsi(irq);
     uint64_t redir;
+    irqflags_t flags;
     
     io = ioapic_for_gsi(gsi);
     if (!io) return -1;
     
+    spin_lock_irqsave(&ioapic_lock, &flags);
     redir = ioapic_read_redir(io, gsi - io->gsi_base);
     redir &= ~(1ULL << 16);  /* Clear mask bit */
     ioapic_write_redir(io, gsi - io->gsi_base, redir);
+    spin_unlock_irqrestore(&ioapic_lock, flags);
     
     return 0;
 }
 
+/*
+ * Level IRQ delivered but not yet EOI'd (Remote IRR set)
+ */
+int ioapic_irq_in_flight(uint32_t irq) {
+    ioapic_t *io;
+    ioapic_redir_t redir;
+    irqflags_t flags;
+    uint32_t gsi = acpi_irq_to_gsi(irq);
+    
+    io = ioapic_for_gsi(gsi);
+    if (!io) return 0;
+    
+    spin_lock_irqsave(&ioapic_lock, &flags);
+    redir.raw = ioapic_read_redir(io, gsi - io->gsi_base);
+    spin_unlock_irqrestore(&ioapic_lock, flags);
+    
+    return redir.trigger && redir.remoteirr;
+}
+
 /*
  * Find I/O APIC responsible for a GSI
  */
@@ -404,8 +484,19 @@ ioapic_t *ioapic_for_gsi(uint32_t gsi) {
  * Timer interrupt handler
  */
 void apic_timer_handler(void) {
-    /* Call scheduler tick */
-    sched_tick();
+    /* Expired timers (includes the scheduler tick); periodic until set up */
+    if (!hrtimer_interrupt()) {
+        sched_tick();
+    }
+    
+    /* Device IRQ rebalancing (BSP, once per period) */
+    irqbalance_tick();
+    
+    /* QSV counters in the shared sysinfo page */
+    sysinfo_page_tick();
+    
+    /* This CPU's record in the perf pages (and the nodes when due) */
+    perf_page_tick();
     
     /* Send EOI */
     lapic_eoi();
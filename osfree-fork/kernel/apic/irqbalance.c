@@ -0,0 +1,343 @@
+/*
+ * osFree Interrupt Balancing
+ * Copyright (c) 2024 osFree Project
+ *
+ * Device interrupts are all routed to the BSP at boot, which becomes
+ * the bottleneck under network or disk load.  Drivers register their
+ * IRQs here with a class and the device's NUMA node; every period the
+ * BSP sums the per-CPU counts, then hands the IRQs out busiest first
+ * to the least loaded CPU of their node, spreading same-class IRQs
+ * (NIC queues, disk controllers) before stacking them.  An IRQ stays
+ * put unless moving it clearly evens things out, so quiet systems
+ * keep their routing and caches stay warm.
+ */
+
+#include <os3/irqbalance.h>
+#include <os3/apic.h>
+#include <os3/smp.h>
+#include <os3/spinlock.h>
+#include <os3/time.h>
+#include <os3/debug.h>
+
+irq_stat_t irq_stats[MAX_CPUS];
+
+/*
+ * Registered IRQ
+ */
+typedef struct irqb_desc {
+    int registered;
+    uint32_t vector;
+    uint32_t irq_class;
+    uint32_t flags;                 /* IRQB_* */
+    int32_t node;                   /* Device node or IRQB_NODE_ANY */
+    uint32_t cpu;                   /* Current target */
+    irq_set_affinity_fn set_affinity;
+    void *data;
+    uint32_t rate;                  /* Interrupts in the last period */
+    uint64_t nr_moves;
+} irqb_desc_t;
+
+/* Serializes registration and balancing passes */
+static spinlock_t irqb_lock = SPINLOCK_INIT("irqbalance");
+
+static struct {
+    irqb_desc_t irqs[IRQB_MAX_IRQS];
+    uint32_t last[IRQB_MAX_IRQS];   /* Summed counts at the last pass */
+    uint32_t unmanaged;             /* Unregistered IRQ load, on the BSP */
+    uint64_t next_pass;
+    int enabled;
+
+    /* Pass scratch - too big for the interrupt stack */
+    uint64_t load[MAX_CPUS];
+    uint32_t nr_class[MAX_CPUS][IRQ_CLASS_COUNT];
+    uint8_t order[IRQB_MAX_IRQS];
+} irqb;
+
+/*
+ * May 'd' be delivered to 'cpu'?  A node with no online CPU left
+ * falls back to any CPU.
+ */
+static int irqb_cpu_ok(const irqb_desc_t *d, uint32_t cpu, int node_any) {
+    if (!cpu_isset(cpu, smp_info.online_mask))
+        return 0;
+    return node_any || (uint32_t)cpu_to_node(cpu) == (uint32_t)d->node;
+}
+
+static int irqb_node_any(const irqb_desc_t *d) {
+    uint32_t cpu;
+
+    if (d->node == IRQB_NODE_ANY)
+        return 1;
+
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+        if (cpu_isset(cpu, smp_info.online_mask) &&
+            cpu_to_node(cpu) == d->node)
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * Least loaded allowed CPU; ties go to the one with fewer IRQs of
+ * the same class (caller holds irqb_lock)
+ */
+static uint32_t irqb_pick_cpu(const irqb_desc_t *d) {
+    uint32_t cpu, best = smp_info.bsp_id;
+    uint64_t best_load = (uint64_t)-1;
+    uint32_t best_nr = (uint32_t)-1;
+    int node_any = irqb_node_any(d);
+
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+        uint32_t nr = irqb.nr_class[cpu][d->irq_class];
+
+        if (!irqb_cpu_ok(d, cpu, node_any))
+            continue;
+        if (irqb.load[cpu] < best_load ||
+            (irqb.load[cpu] == best_load && nr < best_nr)) {
+            best_load = irqb.load[cpu];
+            best_nr = nr;
+            best = cpu;
+        }
+    }
+
+    return best;
+}
+
+/*
+ * Point an IRQ at 'cpu' (caller holds irqb_lock)
+ */
+static int irqb_route(uint32_t irq, irqb_desc_t *d, uint32_t cpu) {
+    int ret;
+
+    if (d->set_affinity)
+        ret = d->set_affinity(irq, d->vector, cpu, d->data);
+    else
+        ret = ioapic_route_irq(irq, d->vector, cpu,
+                               (d->flags & IRQB_LEVEL) != 0,
+                               (d->flags & IRQB_ACTIVE_LOW) != 0);
+    if (ret < 0)
+        return -1;
+
+    d->cpu = cpu;
+    return 0;
+}
+
+/*
+ * Rebuild load figures from the current routing (caller holds irqb_lock)
+ */
+static void irqb_current_load(void) {
+    uint32_t cpu, irq, i;
+
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+        irqb.load[cpu] = 0;
+        for (i = 0; i < IRQ_CLASS_COUNT; i++)
+            irqb.nr_class[cpu][i] = 0;
+    }
+    irqb.load[smp_info.bsp_id] = irqb.unmanaged;
+
+    for (irq = 0; irq < IRQB_MAX_IRQS; irq++) {
+        irqb_desc_t *d = &irqb.irqs[irq];
+
+        if (!d->registered)
+            continue;
+        irqb.load[d->cpu] += d->rate;
+        irqb.nr_class[d->cpu][d->irq_class]++;
+    }
+}
+
+/*
+ * One balancing pass (BSP, interrupt context, caller holds irqb_lock)
+ */
+static void irqb_rebalance(void) {
+    uint32_t cpu, irq, i, j, n = 0, sum, best;
+    irqb_desc_t *d;
+
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+        irqb.load[cpu] = 0;
+        for (i = 0; i < IRQ_CLASS_COUNT; i++)
+            irqb.nr_class[cpu][i] = 0;
+    }
+    irqb.unmanaged = 0;
+
+    /* Rates since the last pass; counters wrap, differences do not */
+    for (irq = 0; irq < IRQB_MAX_IRQS; irq++) {
+        sum = 0;
+        for (cpu = 0; cpu < smp_info.cpu_count; cpu++)
+            sum += irq_stats[cpu].count[irq];
+
+        d = &irqb.irqs[irq];
+        if (!d->registered) {
+            /* Whoever routed it did so at boot - to the BSP */
+            irqb.unmanaged += sum - irqb.last[irq];
+            irqb.last[irq] = sum;
+            continue;
+        }
+
+        d->rate = sum - irqb.last[irq];
+        irqb.last[irq] = sum;
+
+        /* Fixed load: pinned or too quiet to be worth a move */
+        if ((d->flags & IRQB_PINNED) || d->rate < IRQB_MIN_RATE) {
+            irqb.load[d->cpu] += d->rate;
+            irqb.nr_class[d->cpu][d->irq_class]++;
+            continue;
+        }
+
+        /* Busiest first - insertion sort, there are only a few */
+        for (i = n; i > 0 && irqb.irqs[irqb.order[i - 1]].rate < d->rate; i--)
+            irqb.order[i] = irqb.order[i - 1];
+        irqb.order[i] = (uint8_t)irq;
+        n++;
+    }
+    irqb.load[smp_info.bsp_id] += irqb.unmanaged;
+
+    for (j = 0; j < n; j++) {
+        irq = irqb.order[j];
+        d = &irqb.irqs[irq];
+        best = irqb_pick_cpu(d);
+
+        /*
+         * Stay unless the gap to the target is over half of our own
+         * rate - smaller moves just swap which CPU is the busy one
+         */
+        if (best != d->cpu &&
+            irqb_cpu_ok(d, d->cpu, irqb_node_any(d)) &&
+            irqb.load[d->cpu] <= irqb.load[best] + d->rate / 2)
+            best = d->cpu;
+
+        /* Rerouting a level IRQ awaiting EOI could lose the EOI */
+        if (best != d->cpu && (d->flags & IRQB_LEVEL) &&
+            !d->set_affinity && ioapic_irq_in_flight(irq))
+            best = d->cpu;
+
+        if (best != d->cpu) {
+            uint32_t from = d->cpu;
+
+            if (irqb_route(irq, d, best) == 0) {
+                d->nr_moves++;
+                kprintf("IRQB: IRQ%d (%d/s) CPU %d -> %d\n", irq,
+                        (uint32_t)(d->rate * 1000000000ULL / IRQB_INTERVAL_NS),
+                        from, best);
+            }
+        }
+
+        irqb.load[d->cpu] += d->rate;
+        irqb.nr_class[d->cpu][d->irq_class]++;
+    }
+}
+
+/*
+ * Start balancing - after the APs are online
+ */
+void irqbalance_init(void) {
+    irqflags_t flags;
+
+    spin_lock_irqsave(&irqb_lock, &flags);
+    irqb.next_pass = get_time_ns() + IRQB_INTERVAL_NS;
+    irqb.enabled = 1;
+    spin_unlock_irqrestore(&irqb_lock, flags);
+
+    kprintf("IRQB: Balancing device interrupts over %d CPUs\n",
+            smp_info.cpu_count);
+}
+
+/*
+ * Register a device IRQ.  'vector' is what it is to be delivered on;
+ * 'set_affinity' is NULL for I/O APIC routed IRQs, and is called with
+ * interrupts off, so it must not block.
+ */
+int irqbalance_register(uint32_t irq, uint32_t vector, uint32_t irq_class,
+                        int32_t node, uint32_t flags,
+                        irq_set_affinity_fn set_affinity, void *data) {
+    irqb_desc_t *d;
+    irqflags_t iflags;
+    uint32_t cpu, sum = 0;
+
+    if (irq >= IRQB_MAX_IRQS || irq_class >= IRQ_CLASS_COUNT)
+        return -1;
+    if (node != IRQB_NODE_ANY && (node < 0 || node >= MAX_NUMA_NODES))
+        return -1;
+
+    spin_lock_irqsave(&irqb_lock, &iflags);
+
+    d = &irqb.irqs[irq];
+    if (d->registered) {
+        spin_unlock_irqrestore(&irqb_lock, iflags);
+        return -1;
+    }
+
+    d->vector = vector;
+    d->irq_class = irq_class;
+    d->flags = flags;
+    d->node = node;
+    d->cpu = smp_info.bsp_id;
+    d->set_affinity = set_affinity;
+    d->data = data;
+    d->rate = 0;
+    d->nr_moves = 0;
+
+    /* Rate is measured from here on */
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++)
+        sum += irq_stats[cpu].count[irq];
+    irqb.last[irq] = sum;
+
+    /* No rate yet - place it by class so queues start out spread */
+    irqb_current_load();
+    if (irqb_route(irq, d, irqb_pick_cpu(d)) < 0) {
+        spin_unlock_irqrestore(&irqb_lock, iflags);
+        return -1;
+    }
+    d->registered = 1;
+
+    spin_unlock_irqrestore(&irqb_lock, iflags);
+    return 0;
+}
+
+/*
+ * Stop balancing an IRQ; its routing is left as it is
+ */
+void irqbalance_unregister(uint32_t irq) {
+    irqflags_t flags;
+
+    if (irq >= IRQB_MAX_IRQS)
+        return;
+
+    spin_lock_irqsave(&irqb_lock, &flags);
+    irqb.irqs[irq].registered = 0;
+    spin_unlock_irqrestore(&irqb_lock, flags);
+}
+
+int irqbalance_irq_cpu(uint32_t irq) {
+    if (irq >= IRQB_MAX_IRQS || !irqb.irqs[irq].registered)
+        return -1;
+    return (int)irqb.irqs[irq].cpu;
+}
+
+/*
+ * Periodic check - every CPU's timer interrupt calls this, the BSP
+ * does the work once per IRQB_INTERVAL_NS
+ */
+void irqbalance_tick(void) {
+    irqflags_t flags;
+    uint64_t now;
+
+    if (!irqb.enabled || !smp_is_bsp())
+        return;
+
+    now = get_time_ns();
+    if (now < irqb.next_pass)
+        return;
+    irqb.next_pass = now + IRQB_INTERVAL_NS;
+
+    /* Registration in progress - try again next period */
+    flags = local_irq_save();
+    if (!spin_trylock(&irqb_lock)) {
+        local_irq_restore(flags);
+        return;
+    }
+
+    irqb_rebalance();
+
+    spin_unlock(&irqb_lock);
+    local_irq_restore(flags);
+}
@@ -9,7 +9,10 @@
 #include <os3/numa.h>
 #include <os3/acpi.h>
 #include <os3/smp.h>
+#include <os3/scheduler.h>
 #include <os3/spinlock.h>
+#include <os3/boot_timeline.h>
+#include <os3/perf_page.h>
 #include <os3/debug.h>
 
 /* Maximum NUMA nodes */
@@ -26,7 +29,18 @@ typedef struct numa_mem_info {
     struct list_head free_list[MAX_ORDER];
     uint32_t free_count[MAX_ORDER];
     
-    spinlock_t lock;
+    /* Bit N set = free_list[N] is non-empty */
+    uint32_t order_mask;
+    
+    /*
+     * Free-area bitmaps: bit ((pfn - start_pfn) >> order) in
+     * free_map[order] is set while that block heads a free list, so
+     * merges never have to read a (cold) struct page to find out.
+     */
+    unsigned long *free_map[MAX_ORDER];
+    
+    /* Queued lock - every CPU on the node hammers it on pcp refill */
+    mcs_lock_t lock;
     
 } numa_mem_info_t;
 
@@ -52,10 +66,35 @@ typedef struct numa_topology {
 static numa_topology_t numa_topo;
 static int numa_enabled = 0;
 
+/*
+ * Per-CPU order-0 page cache (pcplist)
+ *
+ * Single pages are handed out and taken back without touching the
+ * node lock; the list is refilled from and drained to the node buddy
+ * lists PCP_BATCH pages at a time.  Hot (recently freed) pages sit at
+ * the head, so the next allocation gets a cache-warm page; drains take
+ * the coldest pages from the tail.  Only accessed by the owning CPU
+ * with interrupts disabled.
+ */
+#define PCP_BATCH       31
+#define PCP_HIGH        (PCP_BATCH * 6)
+
+typedef struct per_cpu_pages {
+    struct list_head list;      /* Hot at head, cold at tail */
+    uint32_t count;             /* Pages on list */
+    uint32_t high;              /* Drain when count exceeds this */
+    uint32_t batch;             /* Refill/drain chunk */
+    uint32_t node;              /* Node the pages belong to */
+    uint64_t hits;              /* Allocations served from list */
+    uint64_t refills;           /* Batched refills from buddy */
+} PERCPU_ALIGNED per_cpu_pages_t;
+
+static per_cpu_pages_t pcp_lists[MAX_CPUS];
+
 /*
  * Initialize NUMA topology from ACPI
  */
-int numa_init(void)
+static int __numa_init(void)
 {
     int i, j;
     
@@ -81,12 +120,14 @@ int numa_init(void)
     
     /* Initialize per-node structures */
     for (i = 0; i < numa_topo.num_nodes; i++) {
-        spin_lock_init(&numa_topo.nodes[i].lock);
+        mcs_lock_init(&numa_topo.nodes[i].lock);
         
         for (j = 0; j < MAX_ORDER; j++) {
             INIT_LIST_HEAD(&numa_topo.nodes[i].free_list[j]);
             numa_topo.nodes[i].free_count[j] = 0;
+            numa_topo.nodes[i].free_map[j] = NULL;
         }
+        numa_topo.nodes[i].order_mask = 0;
     }
     
     /* Build CPU to node mapping */
@@ -114,6 +155,15 @@ int numa_init(void)
     /* Build fallback order for each node */
     numa_build_fallback_order();
     
+    /* Per-CPU page caches, each bound to its CPU's home node */
+    for (i = 0; i < MAX_CPUS; i++) {
+        INIT_LIST_HEAD(&pcp_lists[i].list);
+        pcp_lists[i].count = 0;
+        pcp_lists[i].high = PCP_HIGH;
+        pcp_lists[i].batch = PCP_BATCH;
+        pcp_lists[i].node = numa_topo.cpu_to_node[i];
+    }
+    
     numa_enabled = 1;
     
     kprintf("NUMA: %d nodes detected\n", numa_topo.num_nodes);
@@ -131,6 +181,17 @@ int numa_init(void)
     return 0;
 }
 
+int numa_init(void)
+{
+    int ret;
+    
+    boot_begin(BOOT_EV_NUMA_INIT, 0);
+    ret = __numa_init();
+    boot_end(BOOT_EV_NUMA_INIT, 0);
+    
+    return ret;
+}
+
 /*
  * Build fallback order based on distances
  */
@@ -192,14 +253,269 @@ void numa_add_memory(uint32_t node, uint64_t start, uint64_t size)
             node, size / (1024 * 1024), start);
 }
 
+#define MAP_BITS_PER_LONG   (sizeof(unsigned long) * 8)
+
+static inline uint64_t free_map_index(numa_mem_info_t *nmi, uint64_t pfn,
+                                      uint32_t order)
+{
+    return (pfn - nmi->start_pfn) >> order;
+}
+
+static inline int free_area_test(numa_mem_info_t *nmi, uint64_t pfn,
+                                 uint32_t order)
+{
+    unsigned long *map = nmi->free_map[order];
+    struct page *page;
+    uint64_t idx;
+    
+    /* Buddy outside this node's span is never ours to merge */
+    if (pfn < nmi->start_pfn || pfn + (1ULL << order) > nmi->end_pfn)
+        return 0;
+    
+    if (!map) {
+        /* Maps not set up yet - fall back to page flags */
+        page = pfn_to_page(pfn);
+        return (page->flags & PAGE_FLAG_BUDDY) && page->order == order;
+    }
+    
+    idx = free_map_index(nmi, pfn, order);
+    return (map[idx / MAP_BITS_PER_LONG] >> (idx % MAP_BITS_PER_LONG)) & 1;
+}
+
+/*
+ * Free-area list maintenance (caller holds nmi->lock)
+ */
+static inline void free_area_add(numa_mem_info_t *nmi, struct page *page,
+                                 uint32_t order)
+{
+    unsigned long *map = nmi->free_map[order];
+    
+    page->order = order;
+    page->flags |= PAGE_FLAG_BUDDY;
+    list_add(&page->list, &nmi->free_list[order]);
+    nmi->free_count[order]++;
+    nmi->order_mask |= (1U << order);
+    
+    if (map) {
+        uint64_t idx = free_map_index(nmi, page_to_pfn(page), order);
+        map[idx / MAP_BITS_PER_LONG] |= 1UL << (idx % MAP_BITS_PER_LONG);
+    }
+}
+
+static inline void free_area_del(numa_mem_info_t *nmi, struct page *page,
+                                 uint32_t order)
+{
+    unsigned long *map = nmi->free_map[order];
+    
+    page->flags &= ~PAGE_FLAG_BUDDY;
+    list_del(&page->list);
+    if (--nmi->free_count[order] == 0)
+        nmi->order_mask &= ~(1U << order);
+    
+    if (map) {
+        uint64_t idx = free_map_index(nmi, page_to_pfn(page), order);
+        map[idx / MAP_BITS_PER_LONG] &= ~(1UL << (idx % MAP_BITS_PER_LONG));
+    }
+}
+
+/*
+ * Remove a block of the given order from the node free lists,
+ * splitting the smallest larger block if needed.  One find-first-set
+ * over order_mask replaces probing each order in turn.
+ * Caller holds nmi->lock.
+ */
+static struct page *__rmqueue(numa_mem_info_t *nmi, uint32_t order)
+{
+    struct page *page;
+    uint32_t mask, i;
+    
+    mask = nmi->order_mask & ~((1U << order) - 1);
+    if (!mask)
+        return NULL;
+    
+    i = __builtin_ctz(mask);
+    page = list_first_entry(&nmi->free_list[i], struct page, list);
+    free_area_del(nmi, page, i);
+    
+    /* Split the block, returning upper halves to the free lists */
+    while (i > order) {
+        i--;
+        free_area_add(nmi, page + (1 << i), i);
+    }
+    
+    page->order = order;
+    nmi->free_pages -= (1 << order);
+    return page;
+}
+
+/*
+ * Return a block to the node free lists, merging with free buddies.
+ * Caller holds nmi->lock.
+ */
+static void __free_one_page(numa_mem_info_t *nmi, struct page *page,
+                            uint32_t order)
+{
+    uint64_t pfn = page_to_pfn(page);
+    
+    nmi->free_pages += (1 << order);
+    
+    while (order < MAX_ORDER - 1) {
+        uint64_t buddy_pfn = pfn ^ (1ULL << order);
+        struct page *buddy;
+        
+        if (!free_area_test(nmi, buddy_pfn, order))
+            break;
+        
+        buddy = pfn_to_page(buddy_pfn);
+        free_area_del(nmi, buddy, order);
+        
+        /* Merge: use lower address as new block */
+        if (buddy_pfn < pfn) {
+            page = buddy;
+            pfn = buddy_pfn;
+        }
+        order++;
+    }
+    
+    free_area_add(nmi, page, order);
+}
+
+/*
+ * Allocate the per-order free-area bitmaps.  Call once after all
+ * numa_add_memory() calls and before memory is released to the
+ * node free lists.
+ */
+int numa_init_free_area_maps(void)
+{
+    uint32_t node, order, map_order;
+    uint64_t bits, bytes;
+    
+    for (node = 0; node < numa_topo.num_nodes; node++) {
+        numa_mem_info_t *nmi = &numa_topo.nodes[node];
+        
+        if (nmi->total_pages == 0)
+            continue;
+        
+        for (order = 0; order < MAX_ORDER; order++) {
+            bits = ((nmi->end_pfn - nmi->start_pfn) >> order) + 1;
+            bytes = ((bits + MAP_BITS_PER_LONG - 1) / MAP_BITS_PER_LONG) *
+                    sizeof(unsigned long);
+            
+            for (map_order = 0; ((uint64_t)PAGE_SIZE << map_order) < bytes;
+                 map_order++)
+                ;
+            
+            nmi->free_map[order] = alloc_pages(map_order);
+            if (!nmi->free_map[order]) {
+                kprintf("NUMA: Node %d: no memory for order %d free map\n",
+                        node, order);
+                return -1;
+            }
+            memset(nmi->free_map[order], 0, bytes);
+        }
+    }
+    
+    return 0;
+}
+
+/*
+ * Refill a per-CPU list with one batch under a single lock hold
+ */
+static uint32_t pcp_refill(per_cpu_pages_t *pcp)
+{
+    numa_mem_info_t *nmi = &numa_topo.nodes[pcp->node];
+    struct page *page;
+    mcs_node_t qnode;
+    uint32_t n;
+    
+    mcs_lock(&nmi->lock, &qnode);
+    for (n = 0; n < pcp->batch; n++) {
+        page = __rmqueue(nmi, 0);
+        if (!page)
+            break;
+        list_add_tail(&page->list, &pcp->list);
+    }
+    mcs_unlock(&nmi->lock, &qnode);
+    
+    pcp->count += n;
+    pcp->refills++;
+    return n;
+}
+
+/*
+ * Give 'count' of the coldest pages back to the buddy lists
+ */
+static void pcp_drain(per_cpu_pages_t *pcp, uint32_t count)
+{
+    numa_mem_info_t *nmi = &numa_topo.nodes[pcp->node];
+    struct page *page;
+    mcs_node_t qnode;
+    
+    mcs_lock(&nmi->lock, &qnode);
+    while (count-- > 0 && pcp->count > 0) {
+        page = list_last_entry(&pcp->list, struct page, list);
+        list_del(&page->list);
+        pcp->count--;
+        __free_one_page(nmi, page, 0);
+    }
+    mcs_unlock(&nmi->lock, &qnode);
+}
+
+/*
+ * Order-0 allocation from the local CPU's page cache
+ */
+static void *pcp_alloc_page(void)
+{
+    per_cpu_pages_t *pcp;
+    struct page *page = NULL;
+    irqflags_t flags;
+    
+    flags = local_irq_save();
+    pcp = &pcp_lists[smp_processor_id()];
+    
+    if (pcp->count == 0)
+        pcp_refill(pcp);
+    
+    if (pcp->count > 0) {
+        page = list_first_entry(&pcp->list, struct page, list);
+        list_del(&page->list);
+        pcp->count--;
+        pcp->hits++;
+    }
+    
+    local_irq_restore(flags);
+    
+    return page ? page_to_virt(page) : NULL;
+}
+
+/*
+ * Drain one CPU's page cache completely (low memory, CPU offline).
+ * Must run on the CPU that owns the list.
+ */
+void numa_drain_local_pages(void)
+{
+    per_cpu_pages_t *pcp;
+    irqflags_t flags;
+    
+    if (!numa_enabled)
+        return;
+    
+    flags = local_irq_save();
+    pcp = &pcp_lists[smp_processor_id()];
+    pcp_drain(pcp, pcp->count);
+    local_irq_restore(flags);
+}
+
 /*
  * Allocate pages from specific NUMA node
  */
-void *numa_alloc_pages(uint32_t node, uint32_t order)
+static void *__numa_alloc_pages(uint32_t node, uint32_t order)
 {
     numa_mem_info_t *nmi;
     struct page *page;
     irqflags_t flags;
+    mcs_node_t qnode;
+    void *ptr;
     int i;
     
     if (!numa_enabled) {
@@ -207,54 +523,28 @@ void *numa_alloc_pages(uint32_t node, uint32_t order)
         return alloc_pages(order);
     }
     
-    /* Try requested node first */
+    /* Single local pages come from the per-CPU cache */
+    if (order == 0 && node == numa_node_id()) {
+        ptr = pcp_alloc_page();
+        if (ptr)
+            return ptr;
+    }
+    
+    /* Try requested node first, splitting larger blocks as needed */
     nmi = &numa_topo.nodes[node];
     
-    spin_lock_irqsave(&nmi->lock, &flags);
+    mcs_lock_irqsave(&nmi->lock, &qnode, &flags);
+    page = __rmqueue(nmi, order);
+    mcs_unlock_irqrestore(&nmi->lock, &qnode, flags);
     
-    if (nmi->free_count[order] > 0) {
-        page = list_first_entry(&nmi->free_list[order], 
-                                struct page, list);
-        list_del(&page->list);
-        nmi->free_count[order]--;
-        nmi->free_pages -= (1 << order);
-        
-        spin_unlock_irqrestore(&nmi->lock, flags);
+    if (page) {
         return page_to_virt(page);
     }
     
-    spin_unlock_irqrestore(&nmi->lock, flags);
-    
-    /* Try higher orders on same node (splitting) */
-    for (i = order + 1; i < MAX_ORDER; i++) {
-        spin_lock_irqsave(&nmi->lock, &flags);
-        
-        if (nmi->free_count[i] > 0) {
-            page = list_first_entry(&nmi->free_list[i], 
-                                    struct page, list);
-            list_del(&page->list);
-            nmi->free_count[i]--;
-            
-            /* Split the block */
-            while (i > order) {
-                i--;
-                struct page *buddy = page + (1 << i);
-                list_add(&buddy->list, &nmi->free_list[i]);
-                nmi->free_count[i]++;
-            }
-            
-            nmi->free_pages -= (1 << order);
-            spin_unlock_irqrestore(&nmi->lock, flags);
-            return page_to_virt(page);
-        }
-        
-        spin_unlock_irqrestore(&nmi->lock, flags);
-    }
-    
     /* Try fallback nodes in distance order */
     for (i = 1; i < numa_topo.num_nodes; i++) {
         uint32_t fallback_node = numa_topo.fallback[node][i];
-        void *ptr = numa_alloc_pages_strict(fallback_node, order);
+        ptr = numa_alloc_pages_strict(fallback_node, order);
         if (ptr) {
             return ptr;
         }
@@ -263,6 +553,18 @@ void *numa_alloc_pages(uint32_t node, uint32_t order)
     return NULL;
 }
 
+void *numa_alloc_pages(uint32_t node, uint32_t order)
+{
+    void *ptr = __numa_alloc_pages(node, order);
+    
+    /* The running thread's placement follows where its pages land */
+    if (ptr && numa_enabled) {
+        sched_numa_account(virt_to_page(ptr)->numa_node, order);
+    }
+    
+    return ptr;
+}
+
 /*
  * Allocate from specific node only (no fallback)
  */
@@ -271,6 +573,7 @@ void *numa_alloc_pages_strict(uint32_t node, uint32_t order)
     numa_mem_info_t *nmi;
     struct page *page;
     irqflags_t flags;
+    mcs_node_t qnode;
     
     if (node >= numa_topo.num_nodes) {
         return NULL;
@@ -278,21 +581,11 @@ void *numa_alloc_pages_strict(uint32_t node, uint32_t order)
     
     nmi = &numa_topo.nodes[node];
     
-    spin_lock_irqsave(&nmi->lock, &flags);
+    mcs_lock_irqsave(&nmi->lock, &qnode, &flags);
+    page = __rmqueue(nmi, order);
+    mcs_unlock_irqrestore(&nmi->lock, &qnode, flags);
     
-    if (nmi->free_count[order] > 0) {
-        page = list_first_entry(&nmi->free_list[order], 
-                                struct page, list);
-        list_del(&page->list);
-        nmi->free_count[order]--;
-        nmi->free_pages -= (1 << order);
-        
-        spin_unlock_irqrestore(&nmi->lock, flags);
-        return page_to_virt(page);
-    }
-    
-    spin_unlock_irqrestore(&nmi->lock, flags);
-    return NULL;
+    return page ? page_to_virt(page) : NULL;
 }
 
 /*
@@ -303,42 +596,30 @@ void numa_free_pages(void *ptr, uint32_t order)
     struct page *page = virt_to_page(ptr);
     uint32_t node = page->numa_node;
     numa_mem_info_t *nmi = &numa_topo.nodes[node];
+    per_cpu_pages_t *pcp;
     irqflags_t flags;
+    mcs_node_t qnode;
     
-    spin_lock_irqsave(&nmi->lock, &flags);
-    
-    /* Try to merge with buddy */
-    while (order < MAX_ORDER - 1) {
-        uint64_t pfn = page_to_pfn(page);
-        uint64_t buddy_pfn = pfn ^ (1 << order);
-        struct page *buddy = pfn_to_page(buddy_pfn);
+    /* Local single pages go back to the per-CPU cache as hot pages */
+    if (numa_enabled && order == 0) {
+        flags = local_irq_save();
+        pcp = &pcp_lists[smp_processor_id()];
         
-        /* Check if buddy is free and same order */
-        if (buddy->flags & PAGE_FLAG_BUDDY &&
-            buddy->order == order) {
-            /* Remove buddy from free list */
-            list_del(&buddy->list);
-            nmi->free_count[order]--;
-            buddy->flags &= ~PAGE_FLAG_BUDDY;
-            
-            /* Merge: use lower address as new block */
-            if (buddy_pfn < pfn) {
-                page = buddy;
-            }
-            order++;
-        } else {
-            break;
+        if (pcp->node == node) {
+            list_add(&page->list, &pcp->list);
+            pcp->count++;
+            if (pcp->count > pcp->high)
+                pcp_drain(pcp, pcp->batch);
+            local_irq_restore(flags);
+            return;
         }
+        
+        local_irq_restore(flags);
     }
     
-    /* Add merged block to free list */
-    page->order = order;
-    page->flags |= PAGE_FLAG_BUDDY;
-    list_add(&page->list, &nmi->free_list[order]);
-    nmi->free_count[order]++;
-    nmi->free_pages += (1 << order);
-    
-    spin_unlock_irqrestore(&nmi->lock, flags);
+    mcs_lock_irqsave(&nmi->lock, &qnode, &flags);
+    __free_one_page(nmi, page, order);
+    mcs_unlock_irqrestore(&nmi->lock, &qnode, flags);
 }
 
 /*
@@ -402,6 +683,31 @@ uint32_t numa_num_nodes(void)
     return numa_enabled ? numa_topo.num_nodes : 1;
 }
 
+/*
+ * Free memory of one node for the perf pages.  Read without the node
+ * lock, so the counts are a snapshot that may be off by a block.
+ */
+int numa_node_stats(uint32_t node, uint64_t *total_pages, uint64_t *free_pages,
+                    uint32_t *free_blocks, uint32_t max_orders)
+{
+    numa_mem_info_t *nmi;
+    uint32_t i;
+    
+    if (node >= numa_num_nodes()) {
+        return -1;
+    }
+    
+    nmi = &numa_topo.nodes[node];
+    *total_pages = nmi->total_pages;
+    *free_pages = nmi->free_pages;
+    
+    for (i = 0; i < max_orders; i++) {
+        free_blocks[i] = i < MAX_ORDER ? nmi->free_count[i] : 0;
+    }
+    
+    return 0;
+}
+
 /*
  * Check if NUMA is enabled
  */
@@ -427,4 +733,13 @@ void numa_print_stats(void)
                 i, nmi->free_pages, nmi->total_pages,
                 (nmi->total_pages * PAGE_SIZE) / (1024 * 1024));
     }
+    
+    if (!numa_enabled)
+        return;
+    
+    for (i = 0; i < smp_info.cpu_count; i++) {
+        per_cpu_pages_t *pcp = &pcp_lists[i];
+        kprintf("  CPU %d pcp: %u pages (node %u), %llu hits, %llu refills\n",
+                i, pcp->count, pcp->node, pcp->hits, pcp->refills);
+    }
 }
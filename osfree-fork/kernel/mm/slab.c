@@ -0,0 +1,545 @@
+/*
+ * osFree Slab Allocator
+ * Copyright (c) 2024 osFree Project
+ *
+ * Object caches layered on the NUMA page allocator.  Each cache keeps
+ * per-node lists of slabs (a naturally aligned buddy block holding a
+ * header, a free-index stack and the objects) and a per-CPU magazine
+ * that serves most allocations and frees without taking any lock.
+ *
+ * Objects are constructed once when their slab is populated and are
+ * returned to the cache in constructed state, so the free index stack
+ * lives in the slab header rather than inside the objects.
+ */
+
+#include <os3/slab.h>
+#include <os3/memory.h>
+#include <os3/numa.h>
+#include <os3/smp.h>
+#include <os3/spinlock.h>
+#include <os3/debug.h>
+
+/*
+ * Slab header, at the start of every slab block
+ */
+typedef struct slab {
+    struct list_head list;          /* Link in node partial/full/free */
+    kmem_cache_t *cache;
+    uint32_t node;                  /* Node the pages came from */
+    uint32_t inuse;                 /* Objects handed out */
+    uint32_t free_top;              /* Entries on free[] */
+    uint16_t free[];                /* Free object index stack */
+} slab_t;
+
+/* All caches, for statistics */
+static struct list_head cache_chain = { &cache_chain, &cache_chain };
+static DEFINE_SPINLOCK(cache_chain_lock);
+
+/* Bootstrap cache the per-CPU magazines are allocated from */
+static kmem_cache_t mag_cache;
+static int slab_bootstrapped = 0;
+
+#define ALIGN_UP(x, a)  (((x) + (a) - 1) & ~((uintptr_t)(a) - 1))
+
+static inline size_t slab_bytes(kmem_cache_t *cache) {
+    return (size_t)PAGE_SIZE << cache->slab_order;
+}
+
+static inline slab_t *obj_to_slab(kmem_cache_t *cache, void *obj) {
+    return (slab_t *)((uintptr_t)obj & ~((uintptr_t)slab_bytes(cache) - 1));
+}
+
+static inline void *slab_obj(kmem_cache_t *cache, slab_t *slab, uint32_t idx) {
+    return (uint8_t *)slab + cache->first_obj + (size_t)idx * cache->obj_size;
+}
+
+static inline uint32_t slab_index(kmem_cache_t *cache, slab_t *slab, void *obj) {
+    return ((uint8_t *)obj - (uint8_t *)slab - cache->first_obj) /
+           cache->obj_size;
+}
+
+/*
+ * Choose the slab order and object layout for a cache
+ */
+static int cache_compute_layout(kmem_cache_t *cache) {
+    uint32_t order, objs;
+    size_t bytes, first;
+
+    for (order = 0; order <= SLAB_MAX_ORDER; order++) {
+        bytes = (size_t)PAGE_SIZE << order;
+        objs = (bytes - sizeof(slab_t)) / (cache->obj_size + sizeof(uint16_t));
+
+        while (objs > 0) {
+            first = ALIGN_UP(sizeof(slab_t) + objs * sizeof(uint16_t),
+                             cache->align);
+            if (first + (size_t)objs * cache->obj_size <= bytes)
+                break;
+            objs--;
+        }
+
+        if (objs >= SLAB_MIN_OBJECTS ||
+            (order == SLAB_MAX_ORDER && objs > 0)) {
+            cache->slab_order = order;
+            cache->objs_per_slab = objs;
+            cache->first_obj = first;
+            return 0;
+        }
+    }
+
+    return -1;  /* Object too large - use kmalloc_node() */
+}
+
+static int cache_setup(kmem_cache_t *cache, const char *name, size_t size,
+                       size_t align, uint32_t flags, kmem_ctor_t ctor) {
+    uint32_t i;
+
+    if (align < sizeof(void *))
+        align = sizeof(void *);
+    if ((flags & SLAB_HWCACHE_ALIGN) && align < CACHE_LINE_SIZE)
+        align = CACHE_LINE_SIZE;
+
+    cache->name = name;
+    cache->align = align;
+    cache->flags = flags;
+    cache->obj_size = ALIGN_UP(size, align);
+    cache->ctor = ctor;
+
+    if (cache_compute_layout(cache) < 0)
+        return -1;
+
+    for (i = 0; i < MAX_NUMA_NODES; i++) {
+        kmem_node_t *kn = &cache->nodes[i];
+        spin_lock_init(&kn->lock);
+        INIT_LIST_HEAD(&kn->partial);
+        INIT_LIST_HEAD(&kn->full);
+        INIT_LIST_HEAD(&kn->free);
+        kn->nr_slabs = 0;
+        kn->nr_free_slabs = 0;
+        kn->active_objs = 0;
+    }
+
+    for (i = 0; i < MAX_CPUS; i++)
+        cache->mags[i] = NULL;
+
+    return 0;
+}
+
+/*
+ * Allocate and populate a new slab on a node (no locks held)
+ */
+static slab_t *slab_grow(kmem_cache_t *cache, uint32_t node) {
+    slab_t *slab;
+    uint32_t i;
+    void *mem;
+
+    mem = numa_alloc_pages(node, cache->slab_order);
+    if (!mem)
+        return NULL;
+
+    slab = mem;
+    INIT_LIST_HEAD(&slab->list);
+    slab->cache = cache;
+    slab->node = virt_to_page(mem)->numa_node;  /* May have fallen back */
+    slab->inuse = 0;
+    slab->free_top = cache->objs_per_slab;
+
+    /* Lowest index on top so objects are handed out in address order */
+    for (i = 0; i < cache->objs_per_slab; i++) {
+        slab->free[i] = cache->objs_per_slab - 1 - i;
+        if (cache->ctor)
+            cache->ctor(slab_obj(cache, slab, i));
+    }
+
+    return slab;
+}
+
+/*
+ * Take one object from a node's slabs (caller holds kn->lock)
+ */
+static void *slab_take_locked(kmem_cache_t *cache, kmem_node_t *kn) {
+    slab_t *slab;
+    void *obj;
+
+    if (!list_empty(&kn->partial)) {
+        slab = list_first_entry(&kn->partial, slab_t, list);
+    } else if (!list_empty(&kn->free)) {
+        slab = list_first_entry(&kn->free, slab_t, list);
+        list_del(&slab->list);
+        list_add(&slab->list, &kn->partial);
+        kn->nr_free_slabs--;
+    } else {
+        return NULL;
+    }
+
+    obj = slab_obj(cache, slab, slab->free[--slab->free_top]);
+    slab->inuse++;
+    kn->active_objs++;
+
+    if (slab->free_top == 0) {
+        list_del(&slab->list);
+        list_add(&slab->list, &kn->full);
+    }
+
+    return obj;
+}
+
+/*
+ * Return one object to its slab (caller holds kn->lock).
+ * Returns a slab whose pages should be released, or NULL.
+ */
+static slab_t *slab_put_locked(kmem_cache_t *cache, kmem_node_t *kn,
+                               void *obj) {
+    slab_t *slab = obj_to_slab(cache, obj);
+    int was_full = (slab->free_top == 0);
+
+    slab->free[slab->free_top++] = slab_index(cache, slab, obj);
+    slab->inuse--;
+    kn->active_objs--;
+
+    if (slab->inuse == 0) {
+        list_del(&slab->list);
+        if (kn->nr_free_slabs >= SLAB_FREE_LIMIT) {
+            kn->nr_slabs--;
+            return slab;
+        }
+        list_add(&slab->list, &kn->free);
+        kn->nr_free_slabs++;
+    } else if (was_full) {
+        list_del(&slab->list);
+        list_add(&slab->list, &kn->partial);
+    }
+
+    return NULL;
+}
+
+/* Buddy order of the kmem_cache_t descriptor itself */
+static uint32_t cache_desc_order(void) {
+    uint32_t order = 0;
+
+    while (((size_t)PAGE_SIZE << order) < sizeof(kmem_cache_t))
+        order++;
+    return order;
+}
+
+static void slab_release(kmem_cache_t *cache, slab_t *slab) {
+    numa_free_pages(slab, cache->slab_order);
+}
+
+/*
+ * Slow path - allocate straight from the node slab lists
+ */
+static void *cache_alloc_node_slow(kmem_cache_t *cache, uint32_t node) {
+    kmem_node_t *kn = &cache->nodes[node];
+    irqflags_t flags;
+    slab_t *slab;
+    void *obj;
+
+    spin_lock_irqsave(&kn->lock, &flags);
+    obj = slab_take_locked(cache, kn);
+    spin_unlock_irqrestore(&kn->lock, flags);
+
+    if (obj)
+        return obj;
+
+    slab = slab_grow(cache, node);
+    if (!slab)
+        return NULL;
+
+    kn = &cache->nodes[slab->node];
+
+    spin_lock_irqsave(&kn->lock, &flags);
+    list_add(&slab->list, &kn->free);
+    kn->nr_slabs++;
+    kn->nr_free_slabs++;
+    obj = slab_take_locked(cache, kn);
+    spin_unlock_irqrestore(&kn->lock, flags);
+
+    return obj;
+}
+
+static void cache_free_slow(kmem_cache_t *cache, void *obj) {
+    slab_t *slab = obj_to_slab(cache, obj);
+    kmem_node_t *kn = &cache->nodes[slab->node];
+    irqflags_t flags;
+    slab_t *dead;
+
+    spin_lock_irqsave(&kn->lock, &flags);
+    dead = slab_put_locked(cache, kn, obj);
+    spin_unlock_irqrestore(&kn->lock, flags);
+
+    if (dead)
+        slab_release(cache, dead);
+}
+
+/*
+ * Refill half a magazine under one node lock hold
+ * (interrupts already disabled)
+ */
+static void mag_refill(kmem_cache_t *cache, kmem_magazine_t *mag,
+                       uint32_t node) {
+    kmem_node_t *kn = &cache->nodes[node];
+    uint32_t want = mag->limit / 2;
+    void *obj;
+
+    spin_lock(&kn->lock);
+    while (mag->avail < want) {
+        obj = slab_take_locked(cache, kn);
+        if (!obj)
+            break;
+        mag->objs[mag->avail++] = obj;
+    }
+    spin_unlock(&kn->lock);
+}
+
+/*
+ * Flush the oldest half of a magazine back to the node slabs
+ * (interrupts already disabled)
+ */
+static void mag_flush(kmem_cache_t *cache, kmem_magazine_t *mag,
+                      uint32_t node, uint32_t count) {
+    kmem_node_t *kn = &cache->nodes[node];
+    slab_t *dead[SLAB_MAG_SIZE];
+    uint32_t i, ndead = 0;
+
+    if (count > mag->avail)
+        count = mag->avail;
+
+    spin_lock(&kn->lock);
+    for (i = 0; i < count; i++) {
+        slab_t *s = slab_put_locked(cache, kn, mag->objs[i]);
+        if (s)
+            dead[ndead++] = s;
+    }
+    spin_unlock(&kn->lock);
+
+    /* Keep the most recently freed (cache hot) objects */
+    for (i = count; i < mag->avail; i++)
+        mag->objs[i - count] = mag->objs[i];
+    mag->avail -= count;
+
+    for (i = 0; i < ndead; i++)
+        slab_release(cache, dead[i]);
+}
+
+static void cache_init_magazines(kmem_cache_t *cache) {
+    uint32_t cpu, ncpus = smp_info.cpu_possible ? smp_info.cpu_possible : 1;
+    kmem_magazine_t *mag;
+
+    for (cpu = 0; cpu < ncpus && cpu < MAX_CPUS; cpu++) {
+        mag = cache_alloc_node_slow(&mag_cache, cpu_to_node(cpu));
+        if (!mag)
+            continue;   /* This CPU just uses the slow path */
+        mag->avail = 0;
+        mag->limit = SLAB_MAG_SIZE;
+        mag->hits = 0;
+        mag->allocs = 0;
+        mag->frees = 0;
+        cache->mags[cpu] = mag;
+    }
+}
+
+/*
+ * Create an object cache
+ */
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, size_t align,
+                                uint32_t flags, kmem_ctor_t ctor) {
+    kmem_cache_t *cache;
+    irqflags_t iflags;
+
+    spin_lock_irqsave(&cache_chain_lock, &iflags);
+    if (!slab_bootstrapped) {
+        cache_setup(&mag_cache, "kmem_magazine", sizeof(kmem_magazine_t),
+                    CACHE_LINE_SIZE, 0, NULL);
+        list_add_tail(&mag_cache.cache_list, &cache_chain);
+        slab_bootstrapped = 1;
+    }
+    spin_unlock_irqrestore(&cache_chain_lock, iflags);
+
+    cache = numa_alloc_pages(0, cache_desc_order());
+    if (!cache)
+        return NULL;
+
+    if (cache_setup(cache, name, size, align, flags, ctor) < 0) {
+        kprintf("SLAB: %s: object size %u too large for a slab\n",
+                name, (uint32_t)size);
+        numa_free_pages(cache, cache_desc_order());
+        return NULL;
+    }
+
+    cache_init_magazines(cache);
+
+    spin_lock_irqsave(&cache_chain_lock, &iflags);
+    list_add_tail(&cache->cache_list, &cache_chain);
+    spin_unlock_irqrestore(&cache_chain_lock, iflags);
+
+    return cache;
+}
+
+/*
+ * Release all empty slabs of a cache
+ */
+void kmem_cache_shrink(kmem_cache_t *cache) {
+    uint32_t node;
+    irqflags_t flags;
+    slab_t *slab;
+
+    for (node = 0; node < numa_num_nodes(); node++) {
+        kmem_node_t *kn = &cache->nodes[node];
+
+        spin_lock_irqsave(&kn->lock, &flags);
+        while (!list_empty(&kn->free)) {
+            slab = list_first_entry(&kn->free, slab_t, list);
+            list_del(&slab->list);
+            kn->nr_free_slabs--;
+            kn->nr_slabs--;
+            spin_unlock_irqrestore(&kn->lock, flags);
+            slab_release(cache, slab);
+            spin_lock_irqsave(&kn->lock, &flags);
+        }
+        spin_unlock_irqrestore(&kn->lock, flags);
+    }
+}
+
+/*
+ * Destroy a cache.  The caller guarantees no allocations are live
+ * and no CPU is using the cache any more.
+ */
+void kmem_cache_destroy(kmem_cache_t *cache) {
+    uint32_t cpu, node;
+    irqflags_t flags;
+
+    spin_lock_irqsave(&cache_chain_lock, &flags);
+    list_del(&cache->cache_list);
+    spin_unlock_irqrestore(&cache_chain_lock, flags);
+
+    for (cpu = 0; cpu < MAX_CPUS; cpu++) {
+        kmem_magazine_t *mag = cache->mags[cpu];
+        if (!mag)
+            continue;
+        while (mag->avail > 0)
+            cache_free_slow(cache, mag->objs[--mag->avail]);
+        cache_free_slow(&mag_cache, mag);
+        cache->mags[cpu] = NULL;
+    }
+
+    kmem_cache_shrink(cache);
+
+    for (node = 0; node < numa_num_nodes(); node++) {
+        if (cache->nodes[node].nr_slabs)
+            kprintf("SLAB: %s: %u slabs still in use on node %u\n",
+                    cache->name, cache->nodes[node].nr_slabs, node);
+    }
+
+    numa_free_pages(cache, cache_desc_order());
+}
+
+/*
+ * Allocate an object, preferring the given node
+ */
+void *kmem_cache_alloc_node(kmem_cache_t *cache, uint32_t node) {
+    kmem_magazine_t *mag;
+    irqflags_t flags;
+    void *obj = NULL;
+
+    if (node >= numa_num_nodes())
+        node = numa_node_id();
+
+    /* Magazines only hold objects from the CPU's own node */
+    if (node == numa_node_id()) {
+        flags = local_irq_save();
+        mag = cache->mags[smp_processor_id()];
+
+        if (mag) {
+            mag->allocs++;
+            if (mag->avail == 0)
+                mag_refill(cache, mag, node);
+            else
+                mag->hits++;
+            if (mag->avail > 0)
+                obj = mag->objs[--mag->avail];
+        }
+
+        local_irq_restore(flags);
+
+        if (obj)
+            return obj;
+    }
+
+    return cache_alloc_node_slow(cache, node);
+}
+
+void *kmem_cache_alloc(kmem_cache_t *cache) {
+    return kmem_cache_alloc_node(cache, numa_node_id());
+}
+
+/*
+ * Free an object back to its cache
+ */
+void kmem_cache_free(kmem_cache_t *cache, void *obj) {
+    slab_t *slab = obj_to_slab(cache, obj);
+    kmem_magazine_t *mag;
+    irqflags_t flags;
+    uint32_t node = numa_node_id();
+
+    /* Remote objects go straight home */
+    if (slab->node != node) {
+        cache_free_slow(cache, obj);
+        return;
+    }
+
+    flags = local_irq_save();
+    mag = cache->mags[smp_processor_id()];
+
+    if (mag) {
+        if (mag->avail == mag->limit)
+            mag_flush(cache, mag, node, mag->limit / 2);
+        mag->objs[mag->avail++] = obj;
+        mag->frees++;
+        local_irq_restore(flags);
+        return;
+    }
+
+    local_irq_restore(flags);
+    cache_free_slow(cache, obj);
+}
+
+/*
+ * Print per-cache statistics
+ */
+void kmem_cache_print_stats(void) {
+    kmem_cache_t *cache;
+    irqflags_t flags;
+    uint32_t node, cpu;
+
+    kprintf("Slab Statistics:\n");
+    kprintf("  %-20s %6s %5s %5s %10s %7s %6s %10s\n",
+            "cache", "objsz", "order", "per", "active", "slabs",
+            "free", "mag hits");
+
+    spin_lock_irqsave(&cache_chain_lock, &flags);
+
+    list_for_each_entry(cache, &cache_chain, cache_list) {
+        uint64_t active = 0, hits = 0;
+        uint32_t slabs = 0, free = 0;
+
+        for (node = 0; node < numa_num_nodes(); node++) {
+            active += cache->nodes[node].active_objs;
+            slabs += cache->nodes[node].nr_slabs;
+            free += cache->nodes[node].nr_free_slabs;
+        }
+
+        for (cpu = 0; cpu < MAX_CPUS; cpu++) {
+            if (cache->mags[cpu]) {
+                hits += cache->mags[cpu]->hits;
+                /* Objects parked in magazines are not in use */
+                active -= cache->mags[cpu]->avail;
+            }
+        }
+
+        kprintf("  %-20s %6u %5u %5u %10llu %7u %6u %10llu\n",
+                cache->name, cache->obj_size, cache->slab_order,
+                cache->objs_per_slab, active, slabs, free, hits);
+    }
+
+    spin_unlock_irqrestore(&cache_chain_lock, flags);
+}
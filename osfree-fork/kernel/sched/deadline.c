@@ -0,0 +1,284 @@
+/*
+ * osFree Deadline Scheduling Class
+ * Copyright (c) 2024 osFree Project
+ *
+ * Earliest-deadline-first reservations for periodic work such as
+ * audio streams.  A thread reserves 'runtime' every 'period', to be
+ * used before 'deadline'; admission keeps the reserved bandwidth on
+ * each CPU under the rt_runtime/rt_period cap, which is what makes
+ * EDF able to meet every deadline.  Budgets are enforced with a
+ * per-CPU timer (constant bandwidth server), so a reservation that
+ * overruns is throttled until its next period instead of starving
+ * the classes below it.
+ */
+
+#include <os3/scheduler.h>
+#include <os3/hrtimer.h>
+#include <os3/smp.h>
+#include <os3/spinlock.h>
+#include <os3/time.h>
+#include <os3/debug.h>
+
+/* Serializes admission and the per-CPU dl_bw totals */
+static spinlock_t dl_admit_lock = SPINLOCK_INIT("dl_admit");
+
+/* Bandwidth one CPU may hand out to reservations */
+static inline uint64_t dl_bw_cap(void) {
+    return ((uint64_t)scheduler.rt_runtime_us << DL_BW_SHIFT) /
+           scheduler.rt_period_us;
+}
+
+/*
+ * Top the budget up for as many periods as the overrun cost
+ */
+static void dl_replenish(thread_t *thread, uint64_t now) {
+    while (thread->dl_remaining <= 0) {
+        thread->dl_abs_deadline += thread->dl_period;
+        thread->dl_remaining += thread->dl_runtime;
+    }
+
+    /* Far behind (long overrun) - start a fresh period */
+    if (thread->dl_abs_deadline <= now) {
+        thread->dl_abs_deadline = now + thread->dl_deadline;
+        thread->dl_remaining = thread->dl_runtime;
+    }
+}
+
+/*
+ * CBS wakeup rule: keep the current deadline only if the leftover
+ * budget would not exceed the reserved bandwidth before it
+ */
+static void dl_wakeup(thread_t *thread, uint64_t now) {
+    if (thread->dl_abs_deadline <= now ||
+        (uint64_t)thread->dl_remaining * thread->dl_period >
+        (thread->dl_abs_deadline - now) * thread->dl_runtime) {
+        thread->dl_abs_deadline = now + thread->dl_deadline;
+        thread->dl_remaining = thread->dl_runtime;
+    }
+}
+
+/*
+ * Replenishment timer - runs on dl_cpu, like everything else that
+ * touches a reservation's budget
+ */
+static void dl_replenish_fn(hrtimer_t *t) {
+    thread_t *thread = t->data;
+
+    dl_replenish(thread, get_time_ns());
+    thread->dl_throttled = 0;
+
+    /* Parked by sched_dl_enqueue() while throttled */
+    if (thread->state == THREAD_STATE_READY && list_empty(&thread->run_list))
+        enqueue_thread(thread);
+}
+
+/*
+ * Budget enforcement timer - only for the reservation that armed it,
+ * in case it fires while being cancelled
+ */
+static void dl_enforce_fn(hrtimer_t *t) {
+    run_queue_t *rq = t->data;
+
+    if (rq->current && rq->current == rq->dl_enforce_thread)
+        set_need_resched();
+}
+
+void sched_dl_init_rq(run_queue_t *rq) {
+    INIT_LIST_HEAD(&rq->dl_queue);
+    rq->dl_nr_running = 0;
+    rq->dl_bw = 0;
+    rq->dl_nr_throttled = 0;
+    rq->dl_enforce_thread = NULL;
+    hrtimer_setup(&rq->dl_enforce, dl_enforce_fn, rq);
+}
+
+/*
+ * Queue a reservation in deadline order.
+ * Returns 0 if it is throttled and was parked instead.
+ */
+int sched_dl_enqueue(run_queue_t *rq, thread_t *thread, uint64_t now) {
+    thread_t *pos;
+
+    if (thread->dl_throttled)
+        return 0;
+
+    /* Woken up, as opposed to a preempted runner being put back */
+    if (thread->state != THREAD_STATE_RUNNING)
+        dl_wakeup(thread, now);
+
+    /* Linear insert - a CPU only ever holds a few reservations */
+    list_for_each_entry(pos, &rq->dl_queue, run_list) {
+        if (thread->dl_abs_deadline < pos->dl_abs_deadline) {
+            list_add_tail(&thread->run_list, &pos->run_list);
+            rq->dl_nr_running++;
+            return 1;
+        }
+    }
+
+    list_add_tail(&thread->run_list, &rq->dl_queue);
+    rq->dl_nr_running++;
+    return 1;
+}
+
+/*
+ * Charge the time since it was picked to a reservation that is
+ * being switched out, throttling it once the budget is gone
+ */
+void sched_dl_account(run_queue_t *rq, thread_t *thread, uint64_t now) {
+    if (thread->last_run)
+        thread->dl_remaining -= (int64_t)(now - thread->last_run);
+
+    if (thread->dl_remaining > 0)
+        return;
+
+    thread->dl_throttled = 1;
+    rq->dl_nr_throttled++;
+
+    if (hrtimer_start(&thread->dl_timer, thread->dl_abs_deadline -
+                      thread->dl_deadline + thread->dl_period) < 0) {
+        /* No timer slot - better late replenishment than none */
+        dl_replenish(thread, now);
+        thread->dl_throttled = 0;
+    }
+}
+
+/*
+ * A reservation was picked - interrupt it when its budget runs out
+ */
+void sched_dl_start(run_queue_t *rq, thread_t *thread, uint64_t now) {
+    rq->dl_enforce_thread = thread;
+    hrtimer_start(&rq->dl_enforce, now + thread->dl_remaining);
+}
+
+/*
+ * No reservation runs next - disarm the budget timer of the last one
+ */
+void sched_dl_stop(run_queue_t *rq) {
+    rq->dl_enforce_thread = NULL;
+    hrtimer_cancel(&rq->dl_enforce);
+}
+
+/*
+ * Admit a thread into the deadline class (or change its parameters).
+ * deadline_ns 0 means deadline == period.  Returns -1 if the
+ * parameters are invalid or no allowed CPU has the bandwidth left.
+ */
+int sched_set_deadline(thread_t *thread, uint64_t runtime_ns,
+                       uint64_t deadline_ns, uint64_t period_ns) {
+    uint64_t bw, cap, used, best_bw = (uint64_t)-1;
+    uint32_t cpu, best = (uint32_t)-1;
+    run_queue_t *rq;
+    irqflags_t flags;
+    int running, queued;
+
+    if (!deadline_ns)
+        deadline_ns = period_ns;
+
+    if (runtime_ns < DL_MIN_RUNTIME_NS || runtime_ns > deadline_ns ||
+        deadline_ns > period_ns || period_ns > DL_MAX_PERIOD_NS)
+        return -1;
+    if (thread->flags & THREAD_FLAG_IDLE)
+        return -1;
+
+    bw = (runtime_ns << DL_BW_SHIFT) / period_ns;
+    cap = dl_bw_cap();
+
+    spin_lock_irqsave(&dl_admit_lock, &flags);
+
+    /* A running thread cannot be moved from here - it keeps its CPU */
+    running = (thread->state == THREAD_STATE_RUNNING);
+
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+        rq = scheduler.runqueues[cpu];
+        if (!rq || !cpu_isset(cpu, smp_info.online_mask))
+            continue;
+        if (!(thread->cpu_affinity & (1ULL << cpu)))
+            continue;
+        if (running && cpu != thread->last_cpu)
+            continue;
+
+        used = rq->dl_bw;
+        if (thread->sched_class == SCHED_CLASS_DEADLINE &&
+            thread->dl_cpu == cpu)
+            used -= thread->dl_bw;
+        if (used + bw > cap)
+            continue;
+
+        /* Worst fit keeps headroom spread across CPUs */
+        if (used < best_bw) {
+            best_bw = used;
+            best = cpu;
+        }
+    }
+
+    if (best == (uint32_t)-1) {
+        spin_unlock_irqrestore(&dl_admit_lock, flags);
+        return -1;
+    }
+
+    if (thread->sched_class == SCHED_CLASS_DEADLINE)
+        scheduler.runqueues[thread->dl_cpu]->dl_bw -= thread->dl_bw;
+    scheduler.runqueues[best]->dl_bw += bw;
+
+    spin_unlock_irqrestore(&dl_admit_lock, flags);
+
+    queued = (thread->state == THREAD_STATE_READY);
+    if (queued)
+        dequeue_thread(thread);
+
+    if (thread->sched_class != SCHED_CLASS_DEADLINE) {
+        thread->dl_saved_class = thread->sched_class;
+        thread->dl_saved_prio = thread->dynamic_priority;
+        hrtimer_setup(&thread->dl_timer, dl_replenish_fn, thread);
+    } else {
+        hrtimer_cancel(&thread->dl_timer);
+    }
+
+    thread->dl_runtime = runtime_ns;
+    thread->dl_deadline = deadline_ns;
+    thread->dl_period = period_ns;
+    thread->dl_bw = bw;
+    thread->dl_cpu = best;
+    thread->dl_abs_deadline = get_time_ns() + deadline_ns;
+    thread->dl_remaining = runtime_ns;
+    thread->dl_throttled = 0;
+
+    thread->sched_class = SCHED_CLASS_DEADLINE;
+    thread->dynamic_priority = MAX_PRIORITY;
+    thread->preferred_cpu = best;
+
+    if (queued)
+        enqueue_thread(thread);
+
+    return 0;
+}
+
+/*
+ * Leave the deadline class and release the reservation
+ */
+void sched_clear_deadline(thread_t *thread) {
+    irqflags_t flags;
+    int queued;
+
+    if (thread->sched_class != SCHED_CLASS_DEADLINE)
+        return;
+
+    hrtimer_cancel(&thread->dl_timer);
+
+    spin_lock_irqsave(&dl_admit_lock, &flags);
+    scheduler.runqueues[thread->dl_cpu]->dl_bw -= thread->dl_bw;
+    spin_unlock_irqrestore(&dl_admit_lock, flags);
+
+    /* Also covers a throttled thread parked off the queue */
+    queued = (thread->state == THREAD_STATE_READY);
+    if (queued)
+        dequeue_thread(thread);
+
+    thread->sched_class = thread->dl_saved_class;
+    thread->dynamic_priority = thread->dl_saved_prio;
+    thread->dl_bw = 0;
+    thread->dl_throttled = 0;
+
+    if (queued)
+        enqueue_thread(thread);
+}
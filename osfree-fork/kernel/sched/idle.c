@@ -0,0 +1,320 @@
+/*
+ * osFree CPU Idle
+ * Copyright (c) 2024 osFree Project
+ *
+ * The idle loop picks how deep to sleep from how long it expects to
+ * stay idle: the next timer deadline, scaled by how often interrupts
+ * have cut recent sleeps short, and capped by the recent average so
+ * a core taking frequent wakeups stays in a shallow, fast-exit state.
+ * States come from the MWAIT leaf of CPUID (HLT only without it), or
+ * from whoever registers an ACPI _CST table.  Each CPU counts entries
+ * and residency per state, plus its effective busy frequency from
+ * APERF/MPERF.
+ */
+
+#include <os3/cpuidle.h>
+#include <os3/scheduler.h>
+#include <os3/hrtimer.h>
+#include <os3/rcu.h>
+#include <os3/acpi.h>
+#include <os3/smp.h>
+#include <os3/time.h>
+#include <os3/perf_page.h>
+#include <os3/debug.h>
+
+#define MSR_IA32_MPERF          0xE7
+#define MSR_IA32_APERF          0xE8
+
+/* MWAIT ECX: wake on interrupts even with IF clear */
+#define MWAIT_ECX_INTERRUPT_BREAK   0x1
+
+static cpuidle_state_t cpuidle_states[CPUIDLE_MAX_STATES];
+static uint32_t cpuidle_nr_states;
+
+static cpuidle_cpu_t cpuidle_cpus[MAX_CPUS];
+
+uint32_t cpuidle_latency_limit_us;
+
+/*
+ * Defaults for MWAIT C-states without an ACPI table, indexed by the
+ * hint's C-state field: exit latency and break-even residency (us)
+ */
+static const uint32_t mwait_default_lat[8]  = { 2, 10, 80, 150, 200, 250, 300, 350 };
+static const uint32_t mwait_default_res[8]  = { 2, 20, 200, 600, 800, 1000, 1200, 1400 };
+
+static inline uint64_t cpuidle_rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+
+    __asm__ volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static void cpuidle_add_state(uint32_t cstate, uint32_t enter, uint32_t hint,
+                              uint32_t flags, uint32_t lat, uint32_t res) {
+    cpuidle_state_t *s = &cpuidle_states[cpuidle_nr_states++];
+
+    s->name[0] = 'C';
+    s->name[1] = '0' + cstate;
+    s->name[2] = '\0';
+    s->enter = enter;
+    s->mwait_hint = hint;
+    s->flags = flags;
+    s->exit_latency_us = lat;
+    s->target_residency_us = res;
+}
+
+/*
+ * Probe idle states from CPUID leaf 5
+ */
+void cpuidle_init(void) {
+    cpu_info_t *bsp = smp_info.cpus[smp_info.bsp_id];
+    uint32_t eax, ebx, ecx, edx, c, lat, flags;
+    acpi_fadt_t *fadt = acpi_info.fadt;
+    uint32_t i, cpu;
+
+    for (cpu = 0; cpu < MAX_CPUS; cpu++)
+        cpuidle_cpus[cpu].correction = CPUIDLE_CORR_ONE;
+
+    cpuidle_nr_states = 0;
+
+    if (!(bsp->features & CPU_FEATURE_MONITOR)) {
+        cpuidle_add_state(1, CPUIDLE_ENTER_HLT, 0, 0, 1, 1);
+        goto out;
+    }
+
+    __asm__ volatile("cpuid"
+        : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+        : "a"(5), "c"(0));
+
+    /* Need the sub-state enumeration and interrupt break-event */
+    if ((ecx & 0x3) != 0x3) {
+        cpuidle_add_state(1, CPUIDLE_ENTER_HLT, 0, 0, 1, 1);
+        goto out;
+    }
+
+    /* EDX[4n+3:4n] = number of MWAIT sub-states of C-state n */
+    for (c = 1; c < 8 && cpuidle_nr_states < CPUIDLE_MAX_STATES; c++) {
+        if (!((edx >> (c * 4)) & 0xF))
+            continue;
+
+        lat = mwait_default_lat[c - 1];
+        if (c == 2 && fadt && fadt->p_lvl2_lat && fadt->p_lvl2_lat <= 100)
+            lat = fadt->p_lvl2_lat;
+        if (c == 3 && fadt && fadt->p_lvl3_lat && fadt->p_lvl3_lat <= 1000)
+            lat = fadt->p_lvl3_lat;
+
+        /* Below C1 the LAPIC timer may stop unless it is always-running */
+        flags = (c > 1 && !(bsp->features & CPU_FEATURE_ARAT)) ?
+                CPUIDLE_FLAG_TIMER_STOP : 0;
+
+        cpuidle_add_state(c, CPUIDLE_ENTER_MWAIT, (c - 1) << 4, flags, lat,
+                          lat > mwait_default_res[c - 1] ? lat :
+                          mwait_default_res[c - 1]);
+    }
+
+    if (!cpuidle_nr_states)
+        cpuidle_add_state(1, CPUIDLE_ENTER_HLT, 0, 0, 1, 1);
+
+out:
+    for (i = 0; i < cpuidle_nr_states; i++) {
+        kprintf("IDLE: %s %s latency %dus residency %dus%s\n",
+                cpuidle_states[i].name,
+                cpuidle_states[i].enter == CPUIDLE_ENTER_MWAIT ? "mwait" : "hlt",
+                cpuidle_states[i].exit_latency_us,
+                cpuidle_states[i].target_residency_us,
+                (cpuidle_states[i].flags & CPUIDLE_FLAG_TIMER_STOP) ?
+                " (unused, timer stops)" : "");
+    }
+}
+
+int cpuidle_register_states(const cpuidle_state_t *states, uint32_t count) {
+    uint32_t i;
+
+    if (!count || count > CPUIDLE_MAX_STATES)
+        return -1;
+
+    /* Deeper must never be cheaper, or selection stops making sense */
+    for (i = 1; i < count; i++) {
+        if (states[i].target_residency_us < states[i - 1].target_residency_us)
+            return -1;
+    }
+
+    for (i = 0; i < count; i++)
+        cpuidle_states[i] = states[i];
+    cpuidle_nr_states = count;
+    return 0;
+}
+
+/*
+ * Deepest state worth entering for 'predicted_ns' of idle
+ */
+static uint32_t cpuidle_select(uint64_t predicted_ns) {
+    uint32_t i;
+
+    for (i = cpuidle_nr_states; i-- > 1; ) {
+        cpuidle_state_t *s = &cpuidle_states[i];
+
+        /* No broadcast timer to wake us if the LAPIC stops */
+        if (s->flags & CPUIDLE_FLAG_TIMER_STOP)
+            continue;
+        if (cpuidle_latency_limit_us &&
+            s->exit_latency_us > cpuidle_latency_limit_us)
+            continue;
+        if ((uint64_t)s->target_residency_us * 1000 <= predicted_ns)
+            return i;
+    }
+
+    return 0;
+}
+
+/*
+ * Sleep in state 's'.  The check for work and the sleep instruction
+ * run with interrupts off, so a wakeup in between cannot be missed;
+ * MWAIT also wakes on a remote write to the wake list.
+ */
+static void cpuidle_do_enter(run_queue_t *rq, const cpuidle_state_t *s) {
+    local_irq_disable();
+
+    if (s->enter == CPUIDLE_ENTER_MWAIT) {
+        __asm__ volatile("monitor" : : "a"(&rq->wake_list), "c"(0), "d"(0));
+        if (rq->nr_running || rq->wake_list) {
+            local_irq_enable();
+            return;
+        }
+        __asm__ volatile("sti; mwait"
+                         : : "a"(s->mwait_hint), "c"(MWAIT_ECX_INTERRUPT_BREAK)
+                         : "memory");
+    } else {
+        if (rq->nr_running || rq->wake_list) {
+            local_irq_enable();
+            return;
+        }
+        __asm__ volatile("sti; hlt" ::: "memory");
+    }
+}
+
+/*
+ * One idle period - from cpu_idle_loop() with the tick already stopped
+ */
+void cpuidle_enter(uint32_t cpu) {
+    cpuidle_cpu_t *st = &cpuidle_cpus[cpu];
+    cpu_info_t *ci = smp_info.cpus[cpu];
+    run_queue_t *rq = scheduler.runqueues[cpu];
+    uint64_t now, next, timer_ns, predicted, actual, ratio;
+    uint64_t aperf, mperf;
+    uint32_t state;
+
+    now = get_time_ns();
+
+    /* Busy time and effective frequency since the last wakeup */
+    if (st->idle_exit_ns)
+        ci->busy_time += now - st->idle_exit_ns;
+    perf_page_idle_enter(cpu, now);
+    if (ci->features & CPU_FEATURE_APERFMPERF) {
+        aperf = cpuidle_rdmsr(MSR_IA32_APERF);
+        mperf = cpuidle_rdmsr(MSR_IA32_MPERF);
+        if (st->mperf && mperf != st->mperf && ci->base_freq)
+            ci->current_freq = (uint32_t)((uint64_t)ci->base_freq * 1000 *
+                               (aperf - st->aperf) / (mperf - st->mperf));
+    }
+
+    /* Expected idle length from the next timer, corrected by history */
+    next = hrtimer_next_event(cpu);
+    timer_ns = next == (uint64_t)-1 ? (uint64_t)-1 :
+               next > now ? next - now : 0;
+
+    if (timer_ns == (uint64_t)-1)
+        predicted = st->avg_idle_ns ? st->avg_idle_ns * 2 : (uint64_t)-1;
+    else
+        predicted = (timer_ns * st->correction) >> CPUIDLE_CORR_SHIFT;
+    if (st->avg_idle_ns && st->avg_idle_ns * 2 < predicted)
+        predicted = st->avg_idle_ns * 2;
+
+    state = cpuidle_select(predicted);
+    st->last_state = state;
+
+    cpuidle_do_enter(rq, &cpuidle_states[state]);
+
+    st->idle_exit_ns = get_time_ns();
+    actual = st->idle_exit_ns - now;
+
+    if (ci->features & CPU_FEATURE_APERFMPERF) {
+        st->aperf = cpuidle_rdmsr(MSR_IA32_APERF);
+        st->mperf = cpuidle_rdmsr(MSR_IA32_MPERF);
+    }
+
+    /* Residency and how good the choice was */
+    st->usage[state]++;
+    st->residency_ns[state] += actual;
+    ci->idle_time += actual;
+    perf_page_idle_exit(cpu, st->idle_exit_ns);
+
+    if (actual < (uint64_t)cpuidle_states[state].target_residency_us * 1000)
+        st->nr_above++;
+    else if (state + 1 < cpuidle_nr_states &&
+             actual >= (uint64_t)cpuidle_states[state + 1].target_residency_us * 1000)
+        st->nr_below++;
+
+    /* Averages over the last ~8 periods */
+    if (timer_ns && timer_ns != (uint64_t)-1) {
+        ratio = (actual << CPUIDLE_CORR_SHIFT) / timer_ns;
+        if (ratio > CPUIDLE_CORR_ONE)
+            ratio = CPUIDLE_CORR_ONE;
+        st->correction = (uint32_t)((st->correction * 7 + ratio) / 8);
+    }
+    st->avg_idle_ns = (st->avg_idle_ns * 7 + actual) / 8;
+}
+
+/*
+ * Idle loop - AP boot context and per-CPU idle threads
+ */
+void cpu_idle_loop(uint32_t cpu) {
+    for (;;) {
+        run_queue_t *rq = smp_info.cpus[cpu]->runqueue;
+
+        /* Pairs with rq_push_remote(): it either sees us idle and
+         * sends an IPI, or we see its thread on wake_list here */
+        mb();
+        if (rq->nr_running > 0 || rq->wake_list) {
+            schedule();
+            continue;
+        }
+
+        /* Idle - try to pull work from other CPUs */
+        if (idle_balance(cpu))
+            continue;
+
+        /* Sleep until the next real deadline, not the next tick */
+        rcu_idle_enter();
+        tick_nohz_idle_enter();
+        cpuidle_enter(cpu);
+        tick_nohz_idle_exit();
+        rcu_idle_exit();
+    }
+}
+
+void idle_thread_func(void *arg) {
+    /* First run: schedule() switched here with interrupts off */
+    sched_finish_switch();
+    local_irq_enable();
+
+    cpu_idle_loop(smp_processor_id());
+}
+
+uint32_t cpuidle_state_count(void) {
+    return cpuidle_nr_states;
+}
+
+const cpuidle_state_t *cpuidle_get_state(uint32_t state) {
+    return state < cpuidle_nr_states ? &cpuidle_states[state] : NULL;
+}
+
+int cpuidle_get_stats(uint32_t cpu, uint32_t state,
+                      uint64_t *usage, uint64_t *residency_ns) {
+    if (cpu >= MAX_CPUS || state >= cpuidle_nr_states)
+        return -1;
+
+    *usage = cpuidle_cpus[cpu].usage[state];
+    *residency_ns = cpuidle_cpus[cpu].residency_ns[state];
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * osFree NUMA Thread Placement
+ * Copyright (c) 2024 osFree Project
+ *
+ * Each thread counts the pages it allocates per node, decayed every
+ * sample period.  The node holding most of them becomes its home, and
+ * enqueue_thread() steers the thread onto a CPU of that node.  With
+ * NUMA_POLICY_MIGRATE, a thread that keeps running elsewhere has its
+ * memory moved towards the node it actually runs on instead.
+ */
+
+#include <os3/scheduler.h>
+#include <os3/smp.h>
+#include <os3/numa.h>
+#include <os3/debug.h>
+
+static const sched_numa_ops_t *numa_ops;
+
+/*
+ * Reset placement state for a new thread homed on 'node'
+ */
+void sched_numa_init_thread(thread_t *thread, uint32_t node) {
+    uint32_t i;
+
+    thread->numa_policy = NUMA_POLICY_AUTO;
+    thread->numa_home = node;
+    thread->numa_remote_scans = 0;
+    for (i = 0; i < MAX_NUMA_NODES; i++)
+        thread->numa_pages[i] = 0;
+}
+
+/*
+ * Install VM sampling/migration hooks (NULL to remove)
+ */
+void sched_numa_register(const sched_numa_ops_t *ops) {
+    numa_ops = ops;
+}
+
+void sched_numa_account_thread(thread_t *thread, uint32_t node, uint32_t pages) {
+    uint32_t n;
+
+    if (node >= MAX_NUMA_NODES)
+        return;
+
+    n = thread->numa_pages[node] + pages;
+    thread->numa_pages[node] = n > 0xFFFF ? 0xFFFF : n;
+}
+
+/*
+ * Charge a numa_alloc_pages() block to the running user thread
+ */
+void sched_numa_account(uint32_t node, uint32_t order) {
+    thread_t *curr = current_thread();
+
+    if (!curr || (curr->flags & THREAD_FLAG_KERNEL) ||
+        curr->numa_policy == NUMA_POLICY_NONE)
+        return;
+
+    sched_numa_account_thread(curr, node, 1U << order);
+}
+
+/*
+ * Node with the most recently allocated pages, or 'cur' unless
+ * another node leads it by a quarter (avoids flip-flopping)
+ */
+static uint32_t numa_busiest_node(thread_t *thread, uint32_t cur) {
+    uint32_t i, best = cur, nodes = numa_num_nodes();
+
+    for (i = 0; i < nodes; i++) {
+        if (thread->numa_pages[i] > thread->numa_pages[best])
+            best = i;
+    }
+
+    if (thread->numa_pages[best] <=
+        thread->numa_pages[cur] + thread->numa_pages[cur] / 4)
+        return cur;
+
+    return best;
+}
+
+/*
+ * Steer an enqueue towards the thread's home node.  'cpu' is the
+ * cache-hot choice and is kept whenever it is already on that node.
+ */
+uint32_t sched_numa_select_cpu(thread_t *thread, uint32_t cpu) {
+    uint32_t i, home, best = cpu, best_load = (uint32_t)-1;
+    run_queue_t *rq;
+
+    if (!numa_is_enabled() ||
+        (thread->numa_policy & NUMA_POLICY_MODE_MASK) == NUMA_POLICY_NONE ||
+        (thread->flags & THREAD_FLAG_BOUND))
+        return cpu;
+
+    home = thread->numa_home;
+    if (cpu_to_node(cpu) == home)
+        return cpu;
+
+    for (i = 0; i < smp_info.cpu_count; i++) {
+        if (cpu_to_node(i) != home)
+            continue;
+        if (!(thread->cpu_affinity & (1ULL << i)))
+            continue;
+        if (!cpu_isset(i, smp_info.online_mask))
+            continue;
+
+        rq = scheduler.runqueues[i];
+        if (rq && rq->nr_running < best_load) {
+            best_load = rq->nr_running;
+            best = i;
+        }
+    }
+
+    /* Later wakeups take the fast path above */
+    thread->preferred_cpu = best;
+    return best;
+}
+
+/*
+ * Periodic sample for the running thread - from sched_tick()
+ */
+void sched_numa_tick(thread_t *curr, uint32_t cpu) {
+    uint32_t i, node, mode, moved;
+
+    mode = curr->numa_policy & NUMA_POLICY_MODE_MASK;
+    if (mode == NUMA_POLICY_NONE || !numa_is_enabled())
+        return;
+
+    if (numa_ops && numa_ops->sample)
+        numa_ops->sample(curr);
+
+    if (mode == NUMA_POLICY_AUTO)
+        curr->numa_home = numa_busiest_node(curr, curr->numa_home);
+
+    /* Halve the counts so the home follows recent behaviour */
+    for (i = 0; i < numa_num_nodes(); i++)
+        curr->numa_pages[i] >>= 1;
+
+    node = cpu_to_node(cpu);
+    if (node == curr->numa_home) {
+        curr->numa_remote_scans = 0;
+        return;
+    }
+
+    /*
+     * Still running remote after several periods - affinity or load
+     * keeps us here, so bring the memory over instead
+     */
+    if (!(curr->numa_policy & NUMA_POLICY_MIGRATE) ||
+        ++curr->numa_remote_scans < NUMA_MIGRATE_SCANS)
+        return;
+
+    curr->numa_remote_scans = 0;
+    if (!numa_ops || !numa_ops->migrate)
+        return;
+
+    moved = numa_ops->migrate(curr, node, NUMA_MIGRATE_BATCH);
+    if (moved) {
+        sched_numa_account_thread(curr, node, moved);
+        if (mode == NUMA_POLICY_AUTO)
+            curr->numa_home = node;
+    }
+}
+
+/*
+ * Set a thread's placement policy (DosSetThreadNumaPolicy)
+ */
+int sched_numa_set_policy(thread_t *thread, uint32_t policy, uint32_t node) {
+    uint32_t mode = policy & NUMA_POLICY_MODE_MASK;
+
+    if (policy & ~(NUMA_POLICY_MODE_MASK | NUMA_POLICY_MIGRATE))
+        return -1;
+    if (mode > NUMA_POLICY_PREFERRED)
+        return -1;
+
+    if (mode == NUMA_POLICY_PREFERRED) {
+        if (node >= numa_num_nodes())
+            return -1;
+        thread->numa_home = node;
+    }
+
+    thread->numa_remote_scans = 0;
+    thread->numa_policy = policy;
+    return 0;
+}
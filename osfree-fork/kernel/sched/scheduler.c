@@ -9,15 +9,25 @@
 #include <os3/smp.h>
 #include <os3/spinlock.h>
 #include <os3/memory.h>
+#include <os3/numa.h>
 #include <os3/time.h>
+#include <os3/sched_trace.h>
+#include <os3/cpuidle.h>
 #include <os3/debug.h>
 
 /* Global scheduler instance */
 scheduler_t scheduler;
 
+/* Thread control blocks */
+kmem_cache_t *thread_cache;
+
 /* Per-CPU preemption counter */
 static __percpu int preempt_counter;
 
+/* TID hash - readers walk chains under RCU, writers take tid_lock */
+static thread_t *tid_hash[TID_HASH_SIZE];
+static spinlock_t tid_lock;
+
 /*
  * Bitmap operations for O(1) priority lookup
  */
@@ -62,7 +72,14 @@ static void init_run_queue(run_queue_t *rq, uint32_t cpu_id) {
     
     rq->current = NULL;
     rq->idle = NULL;
+    rq->switched_from = NULL;
     rq->last_balance = 0;
+    rq->nr_steals = 0;
+    rq->wake_list = NULL;
+    atomic_set(&rq->wake_ipi, 0);
+    rq->nr_remote_wakeups = 0;
+    
+    sched_dl_init_rq(rq);
 }
 
 /*
@@ -71,7 +88,7 @@ static void init_run_queue(run_queue_t *rq, uint32_t cpu_id) {
 int sched_init(void) {
     uint32_t i;
     
-    spin_lock_init(&scheduler.global_lock);
+    mcs_lock_init(&scheduler.global_lock);
     atomic_set(&scheduler.total_threads, 0);
     atomic_set(&scheduler.need_balance, 0);
     
@@ -79,6 +96,16 @@ int sched_init(void) {
     scheduler.rt_period_us = 1000000;   /* 1 second */
     scheduler.rt_runtime_us = 950000;   /* 95% max RT */
     
+    wait_table_init();
+    rcu_init();
+    spin_lock_init(&tid_lock);
+    
+    thread_cache = kmem_cache_create("thread_t", sizeof(thread_t), 0,
+                                     SLAB_HWCACHE_ALIGN, NULL);
+    if (!thread_cache) {
+        return -1;
+    }
+    
     /* Initialize run queue pointers */
     for (i = 0; i < MAX_CPUS; i++) {
         scheduler.runqueues[i] = NULL;
@@ -102,6 +129,10 @@ int sched_init_cpu(uint32_t cpu_id) {
     
     init_run_queue(rq, cpu_id);
     
+    /* Tracing is optional - a failed ring allocation is not fatal */
+    sched_trace_init_cpu(cpu_id);
+    rcu_init_cpu(cpu_id);
+    
     /* Create idle thread for this CPU */
     idle = thread_create(NULL, idle_thread_func, NULL, 
                          THREAD_FLAG_KERNEL | THREAD_FLAG_IDLE);
@@ -116,6 +147,7 @@ int sched_init_cpu(uint32_t cpu_id) {
     idle->cpu_affinity = (1ULL << cpu_id);  /* Bound to this CPU */
     idle->flags |= THREAD_FLAG_BOUND;
     idle->preferred_cpu = cpu_id;
+    idle->numa_policy = NUMA_POLICY_NONE;
     
     rq->idle = idle;
     scheduler.runqueues[cpu_id] = rq;
@@ -127,6 +159,285 @@ int sched_init_cpu(uint32_t cpu_id) {
     return 0;
 }
 
+/*
+ * Unlink a queued thread from a run queue (caller holds rq->lock)
+ */
+static void rq_remove_locked(run_queue_t *rq, thread_t *thread) {
+    uint8_t c = thread->sched_class;
+    uint8_t p = thread->dynamic_priority % PRIO_LEVELS_PER_CLASS;
+    prio_queue_t *pq;
+    
+    if (c == SCHED_CLASS_DEADLINE) {
+        /* Throttled reservations wait off the queue */
+        if (list_empty(&thread->run_list))
+            return;
+        list_del_init(&thread->run_list);
+        rq->dl_nr_running--;
+        rq->nr_running--;
+        sched_trace(TRACE_DEQUEUE, thread->tid, thread->dynamic_priority, 0);
+        return;
+    }
+    
+    pq = &rq->queues[c][p];
+    list_del_init(&thread->run_list);
+    pq->count--;
+    rq->nr_running--;
+    
+    if (pq->count == 0) {
+        rq->active_bitmap[c] &= ~(1 << (31 - p));
+        if (rq->active_bitmap[c] == 0) {
+            rq->class_bitmap &= ~(1 << c);
+        }
+    }
+    
+    sched_trace(TRACE_DEQUEUE, thread->tid, thread->dynamic_priority, 0);
+}
+
+/*
+ * Append a thread to a run queue (caller holds rq->lock)
+ */
+static void rq_insert_locked(run_queue_t *rq, thread_t *thread) {
+    uint8_t c = thread->sched_class;
+    uint8_t p = thread->dynamic_priority % PRIO_LEVELS_PER_CLASS;
+    prio_queue_t *pq;
+    
+    if (c == SCHED_CLASS_DEADLINE) {
+        /* Parked instead if throttled */
+        if (sched_dl_enqueue(rq, thread, get_time_ns()))
+            rq->nr_running++;
+    } else {
+        pq = &rq->queues[c][p];
+        list_add_tail(&thread->run_list, &pq->queue);
+        pq->count++;
+        rq->nr_running++;
+        rq->active_bitmap[c] |= (1 << (31 - p));
+        rq->class_bitmap |= (1 << c);
+    }
+    
+    thread->state = THREAD_STATE_READY;
+    
+#ifdef CONFIG_SCHED_TRACE
+    if (sched_trace_enabled && !thread->enqueue_time)
+        thread->enqueue_time = get_time_ns();
+#endif
+    sched_trace(TRACE_ENQUEUE, thread->tid, thread->dynamic_priority, 0);
+}
+
+/*
+ * Does a newly queued thread beat the one running?
+ */
+static inline int should_preempt(thread_t *thread, thread_t *curr) {
+    if (thread->sched_class == SCHED_CLASS_DEADLINE) {
+        return curr->sched_class != SCHED_CLASS_DEADLINE ||
+               thread->dl_abs_deadline < curr->dl_abs_deadline;
+    }
+    if (curr->sched_class == SCHED_CLASS_DEADLINE)
+        return 0;
+    
+    return thread->dynamic_priority > curr->dynamic_priority;
+}
+
+/*
+ * Does a thread pushed to rq's wake list need the CPU interrupted?
+ *
+ * An idle CPU always does.  A busy one only if the thread would preempt
+ * what it runs; otherwise the list is drained at its next schedule().
+ * rq->current is read without the lock, so this is only a hint: an
+ * idle loop rechecks wake_list before it sleeps.
+ */
+static int wake_needs_ipi(run_queue_t *rq, thread_t *thread) {
+    thread_t *curr;
+    int ipi;
+    
+    rcu_read_lock();
+    curr = rq->current;
+    ipi = !curr || curr == rq->idle || curr == thread ||
+          should_preempt(thread, curr);
+    rcu_read_unlock();
+    
+    return ipi;
+}
+
+/*
+ * Queue a wakeup for another CPU without touching its rq->lock.
+ *
+ * Producers push onto the target's wake_list with a CAS.  Until the
+ * list is drained the thread is READY but on no priority queue, which
+ * 'waking' tells dequeue_thread().  IPI_RESCHEDULE goes out only for a
+ * thread that should run now, and at most once per drain, so a burst of
+ * wakeups to one CPU costs a single interrupt.
+ */
+static void rq_push_remote(run_queue_t *rq, thread_t *thread) {
+    thread_t *head;
+    
+    thread->state = THREAD_STATE_READY;
+    thread->wake_cpu = rq->cpu_id;
+    thread->waking = 1;
+    sched_trace(TRACE_REMOTE_WAKE, thread->tid, rq->cpu_id, 0);
+    
+    do {
+        head = rq->wake_list;
+        thread->wake_next = head;
+    } while (atomic_cmpxchg_ptr((void * volatile *)&rq->wake_list,
+                                head, thread) != head);
+    
+    if (wake_needs_ipi(rq, thread) && !atomic_xchg(&rq->wake_ipi, 1)) {
+        smp_send_ipi(rq->cpu_id, IPI_RESCHEDULE);
+    }
+}
+
+/*
+ * Move remotely woken threads onto the run queue (caller holds rq->lock)
+ *
+ * A thread that was woken while still switching out is only ever pushed
+ * to its own last_cpu, and that CPU gets here after the switch is done,
+ * so nothing on the list can still be on a stack.
+ */
+static void rq_drain_wake_list(run_queue_t *rq) {
+    thread_t *list, *prev = NULL, *next;
+    
+    /* Pushes after this point need their own IPI */
+    if (atomic_read(&rq->wake_ipi))
+        atomic_set(&rq->wake_ipi, 0);
+    
+    if (!rq->wake_list)
+        return;
+    
+    list = atomic_xchg_ptr((void * volatile *)&rq->wake_list, NULL);
+    
+    /* The stack is LIFO - reverse it to keep wakeup order */
+    while (list) {
+        next = list->wake_next;
+        list->wake_next = prev;
+        prev = list;
+        list = next;
+    }
+    
+    for (list = prev; list; list = next) {
+        next = list->wake_next;
+        list->wake_next = NULL;
+        list->waking = 0;
+        rq_insert_locked(rq, list);
+        rq->nr_remote_wakeups++;
+    }
+}
+
+/*
+ * Pick the sibling run queue to steal from.
+ *
+ * Queue depth is scaled by NUMA distance (local distance is 10), so a
+ * deep queue on the same node wins over an equally deep remote one, but
+ * a remote queue that is much deeper can still be chosen.  CPUs set in
+ * 'tried' are skipped.
+ */
+static run_queue_t *find_steal_victim(uint32_t this_cpu, const uint32_t *tried) {
+    uint32_t cpu, this_node;
+    uint64_t score, best_score = 0;
+    run_queue_t *rq, *best = NULL;
+    
+    this_node = cpu_to_node(this_cpu);
+    
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+        if (cpu == this_cpu) continue;
+        if (!cpu_isset(cpu, smp_info.online_mask)) continue;
+        if (cpu_isset(cpu, tried)) continue;
+        
+        rq = scheduler.runqueues[cpu];
+        if (!rq || rq->nr_running == 0)
+            continue;
+        
+        score = ((uint64_t)rq->nr_running * 10 * 256) /
+                numa_distance(this_node, cpu_to_node(cpu));
+        if (score > best_score) {
+            best_score = score;
+            best = rq;
+        }
+    }
+    
+    return best;
+}
+
+/*
+ * Move one runnable thread from 'src' to 'this_rq'.
+ *
+ * Called with this_rq->lock held and interrupts disabled.  The victim
+ * lock is only try-acquired so two idle CPUs stealing from each other
+ * cannot deadlock; a contended victim is simply skipped.
+ */
+static int steal_from(run_queue_t *this_rq, run_queue_t *src) {
+    thread_t *thread;
+    uint32_t this_cpu = this_rq->cpu_id;
+    uint64_t now = get_time_ns();
+    int c, p;
+    
+    if (!spin_trylock(&src->lock))
+        return 0;
+    
+    /* Take the highest priority thread that is allowed to move */
+    for (c = NUM_SCHED_CLASSES - 1; c >= 0; c--) {
+        if (!(src->class_bitmap & (1 << c)))
+            continue;
+        
+        for (p = PRIO_LEVELS_PER_CLASS - 1; p >= 0; p--) {
+            prio_queue_t *pq = &src->queues[c][p];
+            
+            if (pq->count == 0)
+                continue;
+            
+            list_for_each_entry(thread, &pq->queue, run_list) {
+                if (!(thread->cpu_affinity & (1ULL << this_cpu)))
+                    continue;
+                if (thread->flags & THREAD_FLAG_BOUND)
+                    continue;
+                /* Queued by a wakeup before its CPU switched away */
+                if (thread->on_cpu)
+                    continue;
+                if (now - thread->last_run < STEAL_CACHE_HOT_NS)
+                    continue;
+                /* Don't drag a thread off its memory for a short queue */
+                if (thread->numa_policy != NUMA_POLICY_NONE &&
+                    thread->numa_home != cpu_to_node(this_cpu) &&
+                    src->nr_running <= NUMA_STEAL_MIN_QUEUE)
+                    continue;
+                
+                rq_remove_locked(src, thread);
+                spin_unlock(&src->lock);
+                
+                /* Its queue and cache are here now */
+                thread->preferred_cpu = this_cpu;
+                thread->last_cpu = this_cpu;
+                rq_insert_locked(this_rq, thread);
+                this_rq->nr_steals++;
+                sched_trace(TRACE_STEAL, thread->tid, src->cpu_id, 0);
+                return 1;
+            }
+        }
+    }
+    
+    spin_unlock(&src->lock);
+    return 0;
+}
+
+/*
+ * Steal work for an empty run queue (caller holds this_rq->lock)
+ */
+static int steal_thread(run_queue_t *this_rq) {
+    uint32_t tried[MAX_CPUS / 32] = { 0 };
+    run_queue_t *victim;
+    int attempt;
+    
+    for (attempt = 0; attempt < STEAL_MAX_ATTEMPTS; attempt++) {
+        victim = find_steal_victim(this_rq->cpu_id, tried);
+        if (!victim)
+            break;
+        if (steal_from(this_rq, victim))
+            return 1;
+        cpu_set(victim->cpu_id, tried);
+    }
+    
+    return 0;
+}
+
 /*
  * Find highest priority runnable thread
  */
@@ -135,10 +446,15 @@ static thread_t *pick_next_thread(run_queue_t *rq) {
     prio_queue_t *pq;
     thread_t *next;
     
-    if (rq->nr_running == 0) {
+    if (rq->nr_running == 0 && !steal_thread(rq)) {
         return rq->idle;
     }
     
+    /* Deadline reservations run before every priority class */
+    if (rq->dl_nr_running) {
+        return list_first_entry(&rq->dl_queue, thread_t, run_list);
+    }
+    
     /* Find highest priority class with threads */
     for (c = NUM_SCHED_CLASSES - 1; c >= 0; c--) {
         if (!(rq->class_bitmap & (1 << c)))
@@ -169,47 +485,47 @@ static thread_t *pick_next_thread(run_queue_t *rq) {
  */
 void enqueue_thread(thread_t *thread) {
     run_queue_t *rq;
-    prio_queue_t *pq;
     uint32_t cpu;
-    uint8_t c, p;
     irqflags_t flags;
     
-    /* Select CPU for this thread */
-    cpu = thread->preferred_cpu;
-    if (!(thread->cpu_affinity & (1ULL << cpu))) {
-        /* Find first allowed CPU */
-        for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
-            if (thread->cpu_affinity & (1ULL << cpu))
-                break;
+    /*
+     * A thread that blocked can be woken before its CPU has switched
+     * away from it.  Until sched_finish_switch() that CPU is still on
+     * its stack, so it must stay on that CPU's queue; any other CPU
+     * could pick it up and run it on the same stack.
+     */
+    if (thread->on_cpu) {
+        cpu = thread->last_cpu;
+    } else {
+        /* Select CPU for this thread, near its memory if NUMA */
+        if (thread->sched_class == SCHED_CLASS_DEADLINE)
+            cpu = thread->dl_cpu;
+        else
+            cpu = sched_numa_select_cpu(thread, thread->preferred_cpu);
+        if (!(thread->cpu_affinity & (1ULL << cpu))) {
+            /* Find first allowed CPU */
+            for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+                if (thread->cpu_affinity & (1ULL << cpu))
+                    break;
+            }
         }
     }
     
     rq = scheduler.runqueues[cpu];
-    c = thread->sched_class;
-    p = thread->dynamic_priority % PRIO_LEVELS_PER_CLASS;
-    pq = &rq->queues[c][p];
-    
-    spin_lock_irqsave(&rq->lock, &flags);
-    
-    list_add_tail(&thread->run_list, &pq->queue);
-    pq->count++;
-    rq->nr_running++;
     
-    /* Update bitmaps */
-    rq->active_bitmap[c] |= (1 << (31 - p));
-    rq->class_bitmap |= (1 << c);
-    
-    thread->state = THREAD_STATE_READY;
+    /* Foreign run queue: hand off through its wake list */
+    if (cpu != smp_processor_id()) {
+        rq_push_remote(rq, thread);
+        return;
+    }
     
+    spin_lock_irqsave(&rq->lock, &flags);
+    rq_insert_locked(rq, thread);
     spin_unlock_irqrestore(&rq->lock, flags);
     
     /* Check if we should preempt current thread */
-    if (rq->current && 
-        thread->dynamic_priority > rq->current->dynamic_priority) {
+    if (rq->current && should_preempt(thread, rq->current)) {
         set_need_resched();
-        if (cpu != smp_processor_id()) {
-            smp_send_ipi(cpu, IPI_RESCHEDULE);
-        }
     }
 }
 
@@ -218,29 +534,33 @@ void enqueue_thread(thread_t *thread) {
  */
 void dequeue_thread(thread_t *thread) {
     run_queue_t *rq;
-    prio_queue_t *pq;
-    uint8_t c, p;
     irqflags_t flags;
     
-    rq = scheduler.runqueues[thread->last_cpu];
-    c = thread->sched_class;
-    p = thread->dynamic_priority % PRIO_LEVELS_PER_CLASS;
-    pq = &rq->queues[c][p];
-    
-    spin_lock_irqsave(&rq->lock, &flags);
-    
-    list_del_init(&thread->run_list);
-    pq->count--;
-    rq->nr_running--;
-    
-    /* Update bitmaps if queue is empty */
-    if (pq->count == 0) {
-        rq->active_bitmap[c] &= ~(1 << (31 - p));
-        if (rq->active_bitmap[c] == 0) {
-            rq->class_bitmap &= ~(1 << c);
+    /*
+     * Still on a wake list: READY, but on no queue yet.  Drain that list
+     * so the thread is queued once, then take it off again.  Only the
+     * drain clears 'waking', and it runs under this lock.
+     */
+    if (thread->waking) {
+        rq = scheduler.runqueues[thread->wake_cpu];
+        spin_lock_irqsave(&rq->lock, &flags);
+        if (thread->waking) {
+            rq_drain_wake_list(rq);
+            rq_remove_locked(rq, thread);
+            spin_unlock_irqrestore(&rq->lock, flags);
+            return;
         }
+        spin_unlock_irqrestore(&rq->lock, flags);
     }
     
+    /* Reservations are queued on their own CPU, even before first run */
+    if (thread->sched_class == SCHED_CLASS_DEADLINE)
+        rq = scheduler.runqueues[thread->dl_cpu];
+    else
+        rq = scheduler.runqueues[thread->last_cpu];
+    
+    spin_lock_irqsave(&rq->lock, &flags);
+    rq_remove_locked(rq, thread);
     spin_unlock_irqrestore(&rq->lock, flags);
 }
 
@@ -262,11 +582,17 @@ void schedule(void) {
     cpu = smp_processor_id();
     rq = scheduler.runqueues[cpu];
     
+    /* Not inside a read-side section if we got here */
+    rcu_note_context_switch(cpu);
+    
     spin_lock_irqsave(&rq->lock, &flags);
     
     now = get_time_ns();
     rq->clock = now;
     
+    /* Pick up threads other CPUs woke for us */
+    rq_drain_wake_list(rq);
+    
     prev = rq->current;
     
     /* Clear reschedule flag */
@@ -274,22 +600,16 @@ void schedule(void) {
         prev->flags &= ~THREAD_FLAG_NEED_RESCHED;
         
         /* Account time */
+        if (prev->sched_class == SCHED_CLASS_DEADLINE) {
+            sched_dl_account(rq, prev, now);
+        }
         if (prev->last_run) {
             prev->total_runtime += now - prev->last_run;
         }
         
         /* Re-enqueue if still runnable */
         if (prev->state == THREAD_STATE_RUNNING) {
-            prev->state = THREAD_STATE_READY;
-            uint8_t c = prev->sched_class;
-            uint8_t p = prev->dynamic_priority % PRIO_LEVELS_PER_CLASS;
-            prio_queue_t *pq = &rq->queues[c][p];
-            
-            list_add_tail(&prev->run_list, &pq->queue);
-            pq->count++;
-            rq->nr_running++;
-            rq->active_bitmap[c] |= (1 << (31 - p));
-            rq->class_bitmap |= (1 << c);
+            rq_insert_locked(rq, prev);
         }
     }
     
@@ -298,27 +618,22 @@ void schedule(void) {
     
     /* Dequeue next if not idle */
     if (next != rq->idle && next->state == THREAD_STATE_READY) {
-        uint8_t c = next->sched_class;
-        uint8_t p = next->dynamic_priority % PRIO_LEVELS_PER_CLASS;
-        prio_queue_t *pq = &rq->queues[c][p];
-        
-        list_del_init(&next->run_list);
-        pq->count--;
-        rq->nr_running--;
-        
-        if (pq->count == 0) {
-            rq->active_bitmap[c] &= ~(1 << (31 - p));
-            if (rq->active_bitmap[c] == 0) {
-                rq->class_bitmap &= ~(1 << c);
-            }
-        }
+        rq_remove_locked(rq, next);
     }
     
+    sched_trace_switch(prev, next, now);
+    
     next->state = THREAD_STATE_RUNNING;
     next->last_run = now;
     next->last_cpu = cpu;
     next->timeslice = next->timeslice_max;
     
+    if (next->sched_class == SCHED_CLASS_DEADLINE) {
+        sched_dl_start(rq, next, now);
+    } else if (rq->dl_enforce_thread) {
+        sched_dl_stop(rq);
+    }
+    
     rq->current = next;
     get_cpu_info()->current_thread = next;
     
@@ -332,15 +647,60 @@ void schedule(void) {
             prev->voluntary_switches++;
         }
         
-        spin_unlock_irqrestore(&rq->lock, flags);
+        /* prev stays on_cpu until we are off its stack */
+        next->on_cpu = 1;
+        rq->switched_from = prev;
+        
+        /*
+         * Keep interrupts off across the switch, so no reschedule can
+         * start on this CPU before switched_from has been released.
+         */
+        spin_unlock(&rq->lock);
         
         /* Actual context switch */
         context_switch(prev, next);
+        
+        sched_finish_switch();
+        local_irq_restore(flags);
     } else {
         spin_unlock_irqrestore(&rq->lock, flags);
     }
 }
 
+/*
+ * Release the thread this CPU just switched away from.
+ *
+ * Runs on the new thread's stack with interrupts still disabled: at the
+ * end of schedule() for a thread that switched out earlier, and from
+ * sched_thread_entry() for one that runs for the first time.  Until then
+ * the previous thread is pinned to this CPU by on_cpu and skipped by
+ * stealing.  Calling it again after that is harmless.
+ */
+void sched_finish_switch(void) {
+    run_queue_t *rq = scheduler.runqueues[smp_processor_id()];
+    thread_t *prev = rq->switched_from;
+    
+    rq->switched_from = NULL;
+    if (prev) {
+        /* Everything written on prev's stack is visible first */
+        wmb();
+        prev->on_cpu = 0;
+    }
+}
+
+/*
+ * First code a new thread runs.  It never returned from a schedule(),
+ * so it finishes the switch that brought it here and turns interrupts
+ * back on before calling its entry function.
+ */
+void sched_thread_entry(void (*entry)(void *), void *arg) {
+    sched_finish_switch();
+    local_irq_enable();
+    
+    entry(arg);
+    thread_exit(0);
+}
+
 /*
  * Timer tick handler
  */
@@ -353,6 +713,9 @@ void sched_tick(void) {
     rq = scheduler.runqueues[cpu];
     curr = rq->current;
     
+    /* Idle CPUs still have to push their RCU callbacks along */
+    rcu_check_callbacks(cpu);
+    
     if (!curr || curr == rq->idle)
         return;
     
@@ -378,6 +741,11 @@ void sched_tick(void) {
         set_need_resched();
     }
     
+    /* Sample NUMA placement for whatever is running now */
+    if ((rq->tick_count % NUMA_SCAN_TICKS) == 0) {
+        sched_numa_tick(curr, cpu);
+    }
+    
     /* Periodic load balancing check */
     if ((rq->tick_count % scheduler.balance_interval) == 0) {
         atomic_set(&scheduler.need_balance, 1);
@@ -462,6 +830,7 @@ void trigger_load_balance(void) {
                 
                 thread->preferred_cpu = this_cpu;
                 thread->flags |= THREAD_FLAG_MIGRATING;
+                sched_trace(TRACE_MIGRATE, thread->tid, busiest_cpu, this_cpu);
                 
                 spin_unlock_irqrestore(&busiest_rq->lock, flags);
                 
@@ -482,42 +851,87 @@ void trigger_load_balance(void) {
 
 /*
  * Idle balance - called when CPU goes idle
+ *
+ * Steals directly instead of waiting for the next periodic
+ * trigger_load_balance() pass.
  */
-void idle_balance(uint32_t cpu_id) {
-    /* More aggressive balancing when idle */
-    trigger_load_balance();
+int idle_balance(uint32_t cpu_id) {
+    run_queue_t *rq = scheduler.runqueues[cpu_id];
+    irqflags_t flags;
+    int pulled = 0;
+    
+    if (!rq)
+        return 0;
+    
+    spin_lock_irqsave(&rq->lock, &flags);
+    if (rq->nr_running == 0) {
+        pulled = steal_thread(rq);
+    }
+    spin_unlock_irqrestore(&rq->lock, flags);
+    
+    return pulled;
 }
 
 /*
- * Thread blocking
+ * TID table
  */
-void thread_block(void *channel) {
-    thread_t *curr = current_thread();
-    
-    preempt_disable();
-    
-    curr->state = THREAD_STATE_BLOCKED;
-    curr->wait_channel = channel;
-    curr->voluntary_switches++;
+static inline uint32_t tid_hashfn(uint32_t tid) {
+    return (tid * 0x9E3779B1U) >> (32 - TID_HASH_BITS);
+}
+
+void tid_hash_insert(thread_t *thread) {
+    thread_t **head = &tid_hash[tid_hashfn(thread->tid)];
+    irqflags_t flags;
     
-    preempt_enable();
+    spin_lock_irqsave(&tid_lock, &flags);
+    thread->tid_next = *head;
+    rcu_assign_pointer(*head, thread);
+    spin_unlock_irqrestore(&tid_lock, flags);
+}
+
+/*
+ * Unhash an exiting thread.  Readers may still hold it, so the
+ * thread_t itself must go through thread_free_rcu().
+ */
+void tid_hash_remove(thread_t *thread) {
+    thread_t **pp = &tid_hash[tid_hashfn(thread->tid)];
+    irqflags_t flags;
     
-    schedule();
+    spin_lock_irqsave(&tid_lock, &flags);
+    while (*pp) {
+        if (*pp == thread) {
+            /* thread->tid_next is left intact for readers on it */
+            rcu_assign_pointer(*pp, thread->tid_next);
+            break;
+        }
+        pp = &(*pp)->tid_next;
+    }
+    spin_unlock_irqrestore(&tid_lock, flags);
 }
 
 /*
- * Wake threads waiting on channel
+ * Find a thread by TID (caller holds rcu_read_lock)
  */
-void thread_wake(void *channel) {
-    uint32_t cpu;
-    run_queue_t *rq;
-    /* In practice, you'd have a hash table of wait channels */
-    /* This is simplified - real implementation needs wait queues */
+thread_t *tid_lookup(uint32_t tid) {
+    thread_t *thread;
     
-    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
-        /* Search for blocked threads on this channel */
-        /* ... implementation depends on wait queue structure ... */
+    thread = rcu_dereference(tid_hash[tid_hashfn(tid)]);
+    while (thread) {
+        if (thread->tid == tid)
+            return thread;
+        thread = rcu_dereference(thread->tid_next);
     }
+    return NULL;
+}
+
+static void thread_free_cb(rcu_head_t *head) {
+    thread_t *thread = container_of(head, thread_t, rcu);
+    
+    kmem_cache_free(thread_cache, thread);
+}
+
+void thread_free_rcu(thread_t *thread) {
+    call_rcu(&thread->rcu, thread_free_cb);
 }
 
 /*
@@ -546,6 +960,7 @@ int preempt_count(void) {
  */
 int set_thread_affinity(thread_t *thread, uint64_t mask) {
     irqflags_t flags;
+    mcs_node_t qnode;
     
     /* Validate mask has at least one online CPU */
     int valid = 0;
@@ -557,7 +972,7 @@ int set_thread_affinity(thread_t *thread, uint64_t mask) {
     }
     if (!valid) return -1;
     
-    spin_lock_irqsave(&scheduler.global_lock, &flags);
+    mcs_lock_irqsave(&scheduler.global_lock, &qnode, &flags);
     thread->cpu_affinity = mask;
     
     /* Check if current CPU is still valid */
@@ -570,7 +985,7 @@ int set_thread_affinity(thread_t *thread, uint64_t mask) {
         }
     }
     
-    spin_unlock_irqrestore(&scheduler.global_lock, flags);
+    mcs_unlock_irqrestore(&scheduler.global_lock, &qnode, flags);
     return 0;
 }
 
@@ -578,6 +993,10 @@ int set_thread_affinity(thread_t *thread, uint64_t mask) {
  * Priority boost for interactive threads
  */
 void boost_thread_priority(thread_t *thread, int8_t boost, uint8_t duration) {
+    /* Reservations are ordered by deadline, not priority */
+    if (thread->sched_class == SCHED_CLASS_DEADLINE)
+        return;
+    
     thread->priority_boost = boost;
     thread->boost_ticks = duration;
     thread->dynamic_priority = thread->base_priority + boost;
@@ -0,0 +1,197 @@
+/*
+ * osFree Scheduler Tracing
+ * Copyright (c) 2024 osFree Project
+ *
+ * Lock-free per-CPU trace rings and latency histograms.
+ * Built with CONFIG_SCHED_TRACE; enabled at run time by setting
+ * sched_trace_enabled.
+ */
+
+#include <os3/sched_trace.h>
+#include <os3/scheduler.h>
+#include <os3/smp.h>
+#include <os3/spinlock.h>
+#include <os3/memory.h>
+#include <os3/time.h>
+#include <os3/debug.h>
+
+#ifdef CONFIG_SCHED_TRACE
+
+int sched_trace_enabled = 0;
+
+static sched_trace_ring_t *trace_rings[MAX_CPUS];
+
+/*
+ * Allocate the ring for one CPU (NUMA local)
+ */
+int sched_trace_init_cpu(uint32_t cpu) {
+    sched_trace_ring_t *ring;
+
+    ring = kmalloc_node(sizeof(sched_trace_ring_t), cpu_to_node(cpu));
+    if (!ring)
+        return -1;
+
+    memset(ring, 0, sizeof(sched_trace_ring_t));
+    trace_rings[cpu] = ring;
+    return 0;
+}
+
+/*
+ * Append a record to the local ring
+ */
+void __sched_trace(uint16_t type, uint32_t tid, uint32_t arg0, uint32_t arg1) {
+    uint32_t cpu = smp_processor_id();
+    sched_trace_ring_t *ring = trace_rings[cpu];
+    sched_trace_entry_t *e;
+    irqflags_t flags;
+
+    if (!ring)
+        return;
+
+    flags = local_irq_save();
+
+    e = &ring->entries[ring->head & (TRACE_RING_SIZE - 1)];
+    e->timestamp = get_time_ns();
+    e->tid = tid;
+    e->type = type;
+    e->cpu = cpu;
+    e->arg0 = arg0;
+    e->arg1 = arg1;
+
+    /* Publish after the record is complete */
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+
+    local_irq_restore(flags);
+}
+
+static inline uint32_t hist_bucket(uint64_t ns) {
+    uint32_t b;
+
+    if (ns == 0)
+        return 0;
+    b = 63 - __builtin_clzll(ns);
+    return b < TRACE_HIST_BUCKETS ? b : TRACE_HIST_BUCKETS - 1;
+}
+
+/*
+ * Context switch hook (called from schedule() with rq->lock held)
+ */
+void sched_trace_switch(thread_t *prev, thread_t *next, uint64_t now) {
+    sched_trace_ring_t *ring = trace_rings[smp_processor_id()];
+
+    if (!sched_trace_enabled || !ring)
+        return;
+
+    if (prev && prev != next && prev->last_run)
+        ring->timeslice[hist_bucket(now - prev->last_run)]++;
+
+    if (next->enqueue_time) {
+        ring->rq_latency[hist_bucket(now - next->enqueue_time)]++;
+        next->enqueue_time = 0;
+    }
+
+    __sched_trace(TRACE_SWITCH, next->tid,
+                  prev ? prev->tid : 0, prev ? prev->state : 0);
+}
+
+/*
+ * Copy out the newest records of a CPU, oldest first.
+ * Records the writer overwrote during the copy are discarded.
+ */
+uint32_t sched_trace_export(uint32_t cpu, sched_trace_entry_t *buf,
+                            uint32_t max) {
+    sched_trace_ring_t *ring;
+    uint64_t head, start, end, i;
+    uint32_t n = 0;
+
+    if (cpu >= MAX_CPUS || !(ring = trace_rings[cpu]))
+        return 0;
+
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    start = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    if (head - start > max)
+        start = head - max;
+
+    for (i = start; i < head; i++)
+        buf[n++] = ring->entries[i & (TRACE_RING_SIZE - 1)];
+
+    /* Drop the prefix that was overwritten while copying */
+    end = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (end - start > TRACE_RING_SIZE) {
+        uint64_t lost = end - start - TRACE_RING_SIZE;
+        if (lost >= n)
+            return 0;
+        memmove(buf, buf + lost, (n - lost) * sizeof(*buf));
+        n -= lost;
+        ring->dropped += lost;
+    }
+
+    return n;
+}
+
+void sched_trace_reset(void) {
+    uint32_t cpu;
+
+    for (cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (trace_rings[cpu]) {
+            memset(trace_rings[cpu]->rq_latency, 0,
+                   sizeof(trace_rings[cpu]->rq_latency));
+            memset(trace_rings[cpu]->timeslice, 0,
+                   sizeof(trace_rings[cpu]->timeslice));
+        }
+    }
+}
+
+static void print_histogram(const char *title, const uint64_t *hist) {
+    uint64_t total = 0, max = 0;
+    uint32_t b, lo = TRACE_HIST_BUCKETS, hi = 0, i, bar;
+
+    for (b = 0; b < TRACE_HIST_BUCKETS; b++) {
+        total += hist[b];
+        if (hist[b] > max) max = hist[b];
+        if (hist[b]) {
+            if (b < lo) lo = b;
+            hi = b;
+        }
+    }
+
+    kprintf("  %s (%llu samples)\n", title, total);
+    if (total == 0)
+        return;
+
+    for (b = lo; b <= hi; b++) {
+        bar = (uint32_t)((hist[b] * 40) / max);
+        kprintf("    >= %12llu ns %10llu |", 1ULL << b, hist[b]);
+        for (i = 0; i < bar; i++)
+            kprintf("#");
+        kprintf("\n");
+    }
+}
+
+/*
+ * Print summed histograms over all CPUs
+ */
+void sched_trace_print_histograms(void) {
+    uint64_t lat[TRACE_HIST_BUCKETS] = { 0 };
+    uint64_t ts[TRACE_HIST_BUCKETS] = { 0 };
+    uint64_t dropped = 0;
+    uint32_t cpu, b;
+
+    for (cpu = 0; cpu < MAX_CPUS; cpu++) {
+        sched_trace_ring_t *ring = trace_rings[cpu];
+        if (!ring)
+            continue;
+        for (b = 0; b < TRACE_HIST_BUCKETS; b++) {
+            lat[b] += ring->rq_latency[b];
+            ts[b] += ring->timeslice[b];
+        }
+        dropped += ring->dropped;
+    }
+
+    kprintf("Scheduler Trace:\n");
+    print_histogram("Run-queue latency", lat);
+    print_histogram("Time slice", ts);
+    kprintf("  Records dropped during export: %llu\n", dropped);
+}
+
+#endif /* CONFIG_SCHED_TRACE */
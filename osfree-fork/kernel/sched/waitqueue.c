@@ -0,0 +1,234 @@
+/*
+ * osFree Wait Channel Table
+ * Copyright (c) 2024 osFree Project
+ *
+ * Sleeping threads are keyed on an opaque channel pointer and kept in
+ * a hashed table with one lock per bucket, so a wakeup only walks the
+ * threads that hash to the same bucket as its channel.
+ *
+ * thread_block_if() is the compare-and-sleep half of user-space
+ * semaphores: only contended requests come here, the rest are
+ * settled with atomics on the semaphore word.
+ */
+
+#include <os3/scheduler.h>
+#include <os3/smp.h>
+#include <os3/spinlock.h>
+#include <os3/hrtimer.h>
+#include <os3/time.h>
+#include <os3/list.h>
+
+/*
+ * Hash bucket - cache line aligned so neighbouring buckets
+ * do not share a line under contention
+ */
+typedef struct wait_bucket {
+    spinlock_t lock;
+    struct list_head sleepers;      /* thread_t.wait_list */
+} PERCPU_ALIGNED wait_bucket_t;
+
+static wait_bucket_t wait_table[WAIT_HASH_SIZE];
+
+/*
+ * Map a channel to its bucket (multiplicative hash)
+ */
+static inline wait_bucket_t *wait_bucket(void *channel) {
+    uint64_t key = (uint64_t)(uintptr_t)channel;
+
+    key *= 0x9E3779B97F4A7C15ULL;
+    return &wait_table[key >> (64 - WAIT_HASH_BITS)];
+}
+
+/*
+ * Initialize the wait channel table
+ */
+void wait_table_init(void) {
+    int i;
+
+    for (i = 0; i < WAIT_HASH_SIZE; i++) {
+        spin_lock_init(&wait_table[i].lock);
+        INIT_LIST_HEAD(&wait_table[i].sleepers);
+    }
+}
+
+/*
+ * Thread blocking
+ *
+ * A waker may collect us as soon as the bucket lock is dropped, before
+ * schedule() has switched away; on_cpu keeps us on this CPU until then.
+ */
+void thread_block(void *channel) {
+    thread_t *curr = current_thread();
+    wait_bucket_t *b = wait_bucket(channel);
+    irqflags_t flags;
+
+    spin_lock_irqsave(&b->lock, &flags);
+
+    curr->state = THREAD_STATE_BLOCKED;
+    curr->wait_channel = channel;
+    curr->wait_result = WAIT_RESULT_WOKEN;
+    list_add_tail(&curr->wait_list, &b->sleepers);
+
+    spin_unlock_irqrestore(&b->lock, flags);
+
+    curr->voluntary_switches++;
+    schedule();
+}
+
+static void wait_unblock(thread_t *thread, int result);
+
+static void block_timeout_fn(hrtimer_t *t) {
+    wait_unblock(t->data, WAIT_RESULT_TIMEDOUT);
+}
+
+/*
+ * Block on channel only while *word still holds 'expected', until
+ * 'deadline' (get_time_ns() time, 0 for none).  The word is read
+ * under the bucket lock, so a thread that changes it and then wakes
+ * the channel cannot slip in between the check and the sleep.
+ */
+int thread_block_if(void *channel, const volatile uint32_t *word,
+                    uint32_t expected, uint64_t deadline) {
+    thread_t *curr = current_thread();
+    wait_bucket_t *b = wait_bucket(channel);
+    hrtimer_t timer;
+    irqflags_t flags;
+
+    if (deadline) {
+        if (deadline <= get_time_ns())
+            return WAIT_RESULT_TIMEDOUT;
+        hrtimer_setup(&timer, block_timeout_fn, curr);
+    }
+
+    /* As in thread_sleep_until(): the timer cannot fire on this CPU
+     * before schedule() has taken us off it */
+    flags = local_irq_save();
+    if (deadline && hrtimer_start(&timer, deadline) < 0) {
+        local_irq_restore(flags);
+        return WAIT_RESULT_INTERRUPTED;
+    }
+
+    spin_lock(&b->lock);
+
+    if (*word != expected) {
+        spin_unlock(&b->lock);
+        local_irq_restore(flags);
+        if (deadline)
+            hrtimer_cancel(&timer);
+        return WAIT_RESULT_AGAIN;
+    }
+
+    curr->state = THREAD_STATE_BLOCKED;
+    curr->wait_channel = channel;
+    curr->wait_result = WAIT_RESULT_WOKEN;
+    list_add_tail(&curr->wait_list, &b->sleepers);
+
+    spin_unlock(&b->lock);
+
+    curr->voluntary_switches++;
+    schedule();
+    local_irq_restore(flags);
+
+    if (deadline)
+        hrtimer_cancel(&timer);
+
+    return curr->wait_result;
+}
+
+/*
+ * Detach up to 'max' sleepers on channel into 'out' (max 0 = all)
+ */
+static void wait_collect(void *channel, struct list_head *out, int max) {
+    wait_bucket_t *b = wait_bucket(channel);
+    thread_t *thread, *tmp;
+    irqflags_t flags;
+    int n = 0;
+
+    spin_lock_irqsave(&b->lock, &flags);
+
+    list_for_each_entry_safe(thread, tmp, &b->sleepers, wait_list) {
+        if (thread->wait_channel != channel)
+            continue;
+
+        list_del_init(&thread->wait_list);
+        thread->wait_channel = NULL;
+        list_add_tail(&thread->wait_list, out);
+
+        if (max && ++n >= max)
+            break;
+    }
+
+    spin_unlock_irqrestore(&b->lock, flags);
+}
+
+/*
+ * Put collected threads back on a run queue.
+ * Done outside the bucket lock so it never nests inside rq->lock.
+ */
+static void wait_release(struct list_head *woken) {
+    thread_t *thread, *tmp;
+
+    list_for_each_entry_safe(thread, tmp, woken, wait_list) {
+        list_del_init(&thread->wait_list);
+        enqueue_thread(thread);
+    }
+}
+
+/*
+ * Wake threads waiting on channel
+ */
+void thread_wake(void *channel) {
+    struct list_head woken;
+
+    INIT_LIST_HEAD(&woken);
+    wait_collect(channel, &woken, 0);
+    wait_release(&woken);
+}
+
+/*
+ * Wake the longest waiting thread on channel
+ */
+void thread_wake_one(void *channel) {
+    struct list_head woken;
+
+    INIT_LIST_HEAD(&woken);
+    wait_collect(channel, &woken, 1);
+    wait_release(&woken);
+}
+
+/*
+ * Take a blocked thread off its channel with 'result'
+ */
+static void wait_unblock(thread_t *thread, int result) {
+    wait_bucket_t *b;
+    irqflags_t flags;
+    void *channel = thread->wait_channel;
+
+    if (!channel)
+        return;
+
+    b = wait_bucket(channel);
+
+    spin_lock_irqsave(&b->lock, &flags);
+
+    /* Lost a race with a wakeup on the same channel */
+    if (thread->wait_channel != channel) {
+        spin_unlock_irqrestore(&b->lock, flags);
+        return;
+    }
+
+    list_del_init(&thread->wait_list);
+    thread->wait_channel = NULL;
+    thread->wait_result = result;
+
+    spin_unlock_irqrestore(&b->lock, flags);
+
+    enqueue_thread(thread);
+}
+
+/*
+ * Force a blocked thread off its channel (e.g. DosKillThread)
+ */
+void thread_unblock(thread_t *thread) {
+    wait_unblock(thread, WAIT_RESULT_INTERRUPTED);
+}
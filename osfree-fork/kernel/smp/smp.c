@@ -9,7 +9,16 @@
 #include <os3/apic.h>
 #include <os3/acpi.h>
 #include <os3/scheduler.h>
+#include <os3/hrtimer.h>
+#include <os3/rcu.h>
+#include <os3/irqbalance.h>
+#include <os3/sysinfo_page.h>
+#include <os3/perf_page.h>
+#include <os3/cpuidle.h>
+#include <os3/sched_trace.h>
+#include <os3/boot_timeline.h>
 #include <os3/memory.h>
+#include <os3/slab.h>
 #include <os3/spinlock.h>
 #include <os3/debug.h>
 
@@ -17,15 +26,38 @@
 smp_info_t smp_info;
 
 /* AP (Application Processor) boot synchronization */
-static volatile int ap_boot_cpu_id;
-static volatile int ap_boot_done;
 static spinlock_t ap_boot_lock = SPINLOCK_INIT("ap_boot");
 
+/* Start all APs with one broadcast SIPI instead of one at a time */
+int smp_parallel_boot = 1;
+
 /* AP trampoline code address (must be in low memory < 1MB) */
 #define AP_TRAMPOLINE_ADDR  0x8000
 extern char ap_trampoline_start[];
 extern char ap_trampoline_end[];
 
+/* Offsets of the BSP-filled slots within the trampoline */
+extern uint64_t ap_trampoline_pml4;
+extern uint64_t ap_trampoline_boot_info;
+
+/*
+ * Trampoline lookup table - an AP finds its entry by APIC ID, so
+ * any number of them can come up at once
+ */
+typedef struct ap_boot_entry {
+    uint32_t apic_id;
+    uint32_t cpu_id;
+    uint64_t stack;                 /* Stack base; trampoline adds the size */
+} ap_boot_entry_t;
+
+static ap_boot_entry_t ap_boot_table[MAX_CPUS];
+
+/* TSC rate measured by the first AP, shared when the TSC is invariant */
+static spinlock_t ap_tsc_lock = SPINLOCK_INIT("ap_tsc");
+static uint64_t ap_tsc_freq;
+
+static void ap_trampoline_setup(void);
+
 /* Per-CPU GDT/IDT pointers for AP startup */
 extern void setup_cpu_gdt(uint32_t cpu_id);
 extern void setup_cpu_idt(void);
@@ -34,7 +66,7 @@ extern void setup_cpu_tss(uint32_t cpu_id);
 /*
  * Initialize SMP subsystem
  */
-int smp_init(void) {
+static int __smp_init(void) {
     uint32_t i;
     int ret;
     
@@ -45,6 +77,10 @@ int smp_init(void) {
     atomic_set(&smp_info.startup_count, 0);
     atomic_set(&smp_info.ready_count, 0);
     
+    /* Shared QSV page (reports one CPU until the APs are up) */
+    sysinfo_page_init();
+    perf_page_init();
+    
     /* Parse ACPI tables to discover CPUs */
     ret = acpi_parse_madt();
     if (ret < 0) {
@@ -78,42 +114,74 @@ int smp_init(void) {
     /* Detect CPU features */
     detect_cpu_features(smp_info.cpus[0]);
     
+    /* Idle states (APs are assumed to match the BSP) */
+    cpuidle_init();
+    
     /* Mark BSP as online */
     cpu_set(0, smp_info.online_mask);
     cpu_set(0, smp_info.active_mask);
     smp_info.cpu_count = 1;
     
     /* Initialize BSP's Local APIC */
+    boot_begin(BOOT_EV_LAPIC_INIT, 0);
     ret = lapic_init();
+    boot_end(BOOT_EV_LAPIC_INIT, 0);
     if (ret < 0) {
         kprintf("SMP: Failed to initialize Local APIC\n");
         return ret;
     }
     
     /* Initialize I/O APICs */
+    boot_begin(BOOT_EV_IOAPIC_INIT, 0);
     ret = ioapic_init();
+    boot_end(BOOT_EV_IOAPIC_INIT, 0);
     if (ret < 0) {
         kprintf("SMP: Failed to initialize I/O APIC(s)\n");
         return ret;
     }
     
     /* Initialize BSP scheduler */
+    boot_begin(BOOT_EV_SCHED_INIT, 0);
     sched_init();
+    boot_end(BOOT_EV_SCHED_INIT, 0);
+    boot_begin(BOOT_EV_SCHED_INIT_CPU, 0);
     sched_init_cpu(0);
+    boot_end(BOOT_EV_SCHED_INIT_CPU, 0);
     
     /* Setup per-CPU segment (GS/FS) for fast CPU ID access */
     setup_percpu_segment(0);
     
+    /* Per-CPU TLB state (needs CPU ID and features for PCID) */
+    tlb_init_cpu();
+    
+    /* Cross-CPU call queue */
+    smp_call_init_cpu();
+    
+    /* One-shot timers and the scheduler tick */
+    hrtimer_init_cpu();
+    
     /* Copy AP trampoline to low memory */
     memcpy((void*)AP_TRAMPOLINE_ADDR, ap_trampoline_start,
            ap_trampoline_end - ap_trampoline_start);
+    ap_trampoline_setup();
     
     /* Boot Application Processors */
-    for (i = 1; i < smp_info.cpu_possible; i++) {
-        if (acpi_info.cpus[i].flags & MADT_LAPIC_ENABLED) {
-            ret = smp_boot_cpu(i);
-            if (ret == 0) {
-                smp_info.cpu_count++;
+    ret = -1;
+    if (smp_parallel_boot && smp_info.cpu_possible >= SMP_PARALLEL_MIN_CPUS) {
+        boot_begin(BOOT_EV_SMP_BOOT_PARALLEL, 0);
+        ret = smp_boot_cpus_parallel();
+        boot_end(BOOT_EV_SMP_BOOT_PARALLEL, 0);
+    }
+    
+    if (ret < 0) {
+        for (i = 1; i < smp_info.cpu_possible; i++) {
+            if (acpi_info.cpus[i].flags & MADT_LAPIC_ENABLED) {
+                boot_begin(BOOT_EV_SMP_BOOT_CPU, i);
+                ret = smp_boot_cpu(i);
+                boot_end(BOOT_EV_SMP_BOOT_CPU, i);
+                if (ret == 0) {
+                    smp_info.cpu_count++;
+                }
             }
         }
     }
@@ -121,9 +189,24 @@ int smp_init(void) {
     kprintf("SMP: %d of %d CPUs online\n", 
             smp_info.cpu_count, smp_info.cpu_possible);
     
+    /* Spread device interrupts now that there are CPUs to take them */
+    irqbalance_init();
+    sysinfo_page_set_cpus(smp_info.cpu_count);
+    perf_page_set_topology(smp_info.cpu_count);
+    
     return 0;
 }
 
+int smp_init(void) {
+    int ret;
+    
+    boot_begin(BOOT_EV_SMP_INIT, 0);
+    ret = __smp_init();
+    boot_end(BOOT_EV_SMP_INIT, 0);
+    
+    return ret;
+}
+
 /*
  * Detect CPU features via CPUID
  */
@@ -148,6 +231,7 @@ static void detect_cpu_features(cpu_info_t *cpu) {
     if (ecx & (1 << 30)) cpu->features |= CPU_FEATURE_RDRAND;
     if (ecx & (1 << 21)) cpu->features |= CPU_FEATURE_X2APIC;
     if (ecx & (1 << 17)) cpu->features |= CPU_FEATURE_PCID;
+    if (ecx & (1 << 3))  cpu->features |= CPU_FEATURE_MONITOR;
     
     /* Extended CPUID for AVX2, AVX512, invariant TSC */
     __asm__ volatile("cpuid"
@@ -165,6 +249,14 @@ static void detect_cpu_features(cpu_info_t *cpu) {
     
     if (edx & (1 << 8)) cpu->features |= CPU_FEATURE_INVARIANT_TSC;
     
+    /* Power management leaf: always-running APIC timer, APERF/MPERF */
+    __asm__ volatile("cpuid"
+        : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+        : "a"(6), "c"(0));
+    
+    if (eax & (1 << 2)) cpu->features |= CPU_FEATURE_ARAT;
+    if (ecx & (1 << 0)) cpu->features |= CPU_FEATURE_APERFMPERF;
+    
     /* Get frequency info if available */
     __asm__ volatile("cpuid"
         : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
@@ -175,26 +267,46 @@ static void detect_cpu_features(cpu_info_t *cpu) {
 }
 
 /*
- * Boot an Application Processor
+ * Point the trampoline at the kernel page tables and the boot table
  */
-int smp_boot_cpu(uint32_t cpu_id) {
-    cpu_info_t *cpu;
-    uint32_t apic_id;
-    int timeout;
+static void ap_trampoline_setup(void) {
+    uint64_t cr3;
+    uint32_t i;
     
-    if (cpu_id >= MAX_CPUS || cpu_id >= smp_info.cpu_possible) {
-        return -1;
+    for (i = 0; i < MAX_CPUS; i++) {
+        ap_boot_table[i].apic_id = 0xFFFFFFFF;
     }
     
-    apic_id = acpi_info.cpus[cpu_id].apic_id;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    *(volatile uint32_t*)(AP_TRAMPOLINE_ADDR + ap_trampoline_pml4) =
+        (uint32_t)cr3;
+    *(volatile uint64_t*)(AP_TRAMPOLINE_ADDR + ap_trampoline_boot_info) =
+        (uint64_t)ap_boot_table;
+}
+
+/*
+ * Atomic CPU state transition - the BSP giving up on an AP and the AP
+ * checking in can race, exactly one of them wins
+ */
+static int ap_set_state(cpu_info_t *cpu, uint32_t from, uint32_t to) {
+    uint32_t old = from;
     
-    kprintf("SMP: Booting CPU %d (APIC ID %d)\n", cpu_id, apic_id);
+    return __atomic_compare_exchange_n(&cpu->state, &old, to, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Allocate and describe an AP's per-CPU state before it is started
+ */
+static cpu_info_t *ap_prepare(uint32_t cpu_id) {
+    cpu_info_t *cpu;
+    uint32_t apic_id = acpi_info.cpus[cpu_id].apic_id;
     
     /* Allocate CPU info structure */
     cpu = kmalloc_node(sizeof(cpu_info_t), 
                        acpi_get_numa_node(apic_id));
     if (!cpu) {
-        return -1;
+        return NULL;
     }
     memset(cpu, 0, sizeof(cpu_info_t));
     
@@ -204,25 +316,75 @@ int smp_boot_cpu(uint32_t cpu_id) {
     cpu->state = CPU_STATE_STARTING;
     cpu->numa_node = acpi_get_numa_node(apic_id);
     
-    smp_info.cpus[cpu_id] = cpu;
-    
-    /* Setup boot parameters for AP */
-    spin_lock(&ap_boot_lock);
-    ap_boot_cpu_id = cpu_id;
-    ap_boot_done = 0;
-    
     /* Allocate stack for this CPU */
     cpu->stack_base = kmalloc_node(KERNEL_STACK_SIZE, cpu->numa_node);
     if (!cpu->stack_base) {
-        spin_unlock(&ap_boot_lock);
         kfree(cpu);
-        return -1;
+        return NULL;
     }
     
+    smp_info.cpus[cpu_id] = cpu;
+    
     /* Setup GDT, IDT, TSS for this CPU */
     setup_cpu_gdt(cpu_id);
     setup_cpu_tss(cpu_id);
     
+    ap_boot_table[cpu_id].cpu_id = cpu_id;
+    ap_boot_table[cpu_id].stack = (uint64_t)cpu->stack_base;
+    wmb();
+    ap_boot_table[cpu_id].apic_id = apic_id;
+    
+    return cpu;
+}
+
+/*
+ * Give up on an AP that did not check in.  Its memory is kept, a late
+ * AP may still be running on that stack.
+ */
+static int ap_abort(cpu_info_t *cpu) {
+    if (!ap_set_state(cpu, CPU_STATE_STARTING, CPU_STATE_OFFLINE)) {
+        return 0;   /* Made it after all */
+    }
+    
+    ap_boot_table[cpu->cpu_id].apic_id = 0xFFFFFFFF;
+    kprintf("SMP: CPU %d failed to start\n", cpu->cpu_id);
+    return -1;
+}
+
+/*
+ * Publish an AP that checked in (BSP only - masks are not atomic)
+ */
+static void ap_online(cpu_info_t *cpu) {
+    cpu_set(cpu->cpu_id, smp_info.online_mask);
+    cpu_set(cpu->cpu_id, smp_info.active_mask);
+    
+    kprintf("SMP: CPU %d online\n", cpu->cpu_id);
+}
+
+/*
+ * Boot an Application Processor
+ */
+int smp_boot_cpu(uint32_t cpu_id) {
+    cpu_info_t *cpu;
+    uint32_t apic_id;
+    int timeout;
+    
+    if (cpu_id >= MAX_CPUS || cpu_id >= smp_info.cpu_possible) {
+        return -1;
+    }
+    
+    apic_id = acpi_info.cpus[cpu_id].apic_id;
+    
+    kprintf("SMP: Booting CPU %d (APIC ID %d)\n", cpu_id, apic_id);
+    
+    spin_lock(&ap_boot_lock);
+    
+    cpu = ap_prepare(cpu_id);
+    if (!cpu) {
+        spin_unlock(&ap_boot_lock);
+        return -1;
+    }
+    
     /* Send INIT IPI */
     lapic_send_init(apic_id);
     
@@ -237,37 +399,125 @@ int smp_boot_cpu(uint32_t cpu_id) {
     
     /* Wait for AP to signal it's running */
     timeout = 1000;  /* 1 second timeout */
-    while (!ap_boot_done && timeout > 0) {
+    while (cpu->state == CPU_STATE_STARTING && timeout > 0) {
         mdelay(1);
         timeout--;
     }
     
+    if (ap_abort(cpu) < 0) {
+        spin_unlock(&ap_boot_lock);
+        return -1;
+    }
+    
     spin_unlock(&ap_boot_lock);
     
-    if (!ap_boot_done) {
-        kprintf("SMP: CPU %d failed to start\n", cpu_id);
-        cpu->state = CPU_STATE_OFFLINE;
-        kfree(cpu->stack_base);
+    ap_online(cpu);
+    
+    return 0;
+}
+
+/*
+ * Boot every enabled AP at once: one broadcast INIT/SIPI/SIPI, then
+ * the APs run their per-CPU setup concurrently while the BSP waits
+ * for all of them to check in.  Returns -1 if none came up.
+ */
+int smp_boot_cpus_parallel(void) {
+    cpu_info_t *cpu;
+    uint32_t i, started = 0, online = 0;
+    int timeout;
+    
+    kprintf("SMP: Starting APs in parallel\n");
+    
+    spin_lock(&ap_boot_lock);
+    atomic_set(&smp_info.ready_count, 0);
+    
+    for (i = 1; i < smp_info.cpu_possible && i < MAX_CPUS; i++) {
+        if (!(acpi_info.cpus[i].flags & MADT_LAPIC_ENABLED)) {
+            continue;
+        }
+        if (ap_prepare(i)) {
+            started++;
+        }
+    }
+    
+    if (!started) {
+        spin_unlock(&ap_boot_lock);
         return -1;
     }
     
-    /* Mark CPU as online */
-    cpu->state = CPU_STATE_ONLINE;
-    cpu_set(cpu_id, smp_info.online_mask);
-    cpu_set(cpu_id, smp_info.active_mask);
+    /* APs without a table entry park themselves in the trampoline */
+    lapic_send_init_all();
+    udelay(10000);
     
-    kprintf("SMP: CPU %d online\n", cpu_id);
+    lapic_send_startup_all(AP_TRAMPOLINE_ADDR >> 12);
+    udelay(200);
+    lapic_send_startup_all(AP_TRAMPOLINE_ADDR >> 12);
     
-    return 0;
+    /* Completion barrier - same 1s budget one serial AP gets */
+    timeout = 1000;
+    while ((uint32_t)atomic_read(&smp_info.ready_count) < started &&
+           timeout > 0) {
+        mdelay(1);
+        timeout--;
+    }
+    
+    for (i = 1; i < smp_info.cpu_possible && i < MAX_CPUS; i++) {
+        cpu = smp_info.cpus[i];
+        if (!cpu || ap_boot_table[i].apic_id == 0xFFFFFFFF) {
+            continue;
+        }
+        if (ap_abort(cpu) < 0) {
+            continue;
+        }
+        
+        ap_online(cpu);
+        smp_info.cpu_count++;
+        online++;
+    }
+    
+    spin_unlock(&ap_boot_lock);
+    
+    return online ? 0 : -1;
+}
+
+/*
+ * AP TSC calibration.  The PIT is shared, so APs booting in parallel
+ * take turns; with an invariant TSC one measurement covers them all.
+ */
+static uint64_t ap_calibrate_tsc(cpu_info_t *cpu) {
+    irqflags_t flags;
+    uint64_t freq;
+    
+    spin_lock_irqsave(&ap_tsc_lock, &flags);
+    if (ap_tsc_freq && (cpu->features & CPU_FEATURE_INVARIANT_TSC)) {
+        freq = ap_tsc_freq;
+    } else {
+        freq = calibrate_tsc();
+        if (cpu->features & CPU_FEATURE_INVARIANT_TSC) {
+            ap_tsc_freq = freq;
+        }
+    }
+    spin_unlock_irqrestore(&ap_tsc_lock, flags);
+    
+    return freq;
 }
 
 /*
- * AP entry point (called from trampoline)
+ * AP entry point (called from trampoline with the cpu_id from its
+ * boot table entry)
  */
-void ap_entry(void) {
-    uint32_t cpu_id = ap_boot_cpu_id;
+void ap_entry(uint32_t cpu_id) {
     cpu_info_t *cpu = smp_info.cpus[cpu_id];
     
+    boot_begin(BOOT_EV_AP_ENTRY, cpu_id);
+    
+    /* Too late - the BSP has given up on us */
+    if (cpu->state != CPU_STATE_STARTING) {
+        for (;;) {
+            __asm__ volatile("cli; hlt");
+        }
+    }
+    
     /* Initialize Local APIC */
     lapic_init_ap();
     
@@ -276,16 +526,28 @@ void ap_entry(void) {
     
     /* Detect features */
     detect_cpu_features(cpu);
+    tlb_init_cpu();
+    smp_call_init_cpu();
     
     /* Calibrate TSC */
-    cpu->tsc_freq = calibrate_tsc();
+    boot_begin(BOOT_EV_AP_CALIBRATE, cpu_id);
+    cpu->tsc_freq = ap_calibrate_tsc(cpu);
+    boot_end(BOOT_EV_AP_CALIBRATE, cpu_id);
     
     /* Initialize scheduler for this CPU */
+    boot_begin(BOOT_EV_SCHED_INIT_CPU, cpu_id);
     sched_init_cpu(cpu_id);
+    boot_end(BOOT_EV_SCHED_INIT_CPU, cpu_id);
+    hrtimer_init_cpu();
     
     /* Signal BSP we're ready */
+    if (!ap_set_state(cpu, CPU_STATE_STARTING, CPU_STATE_ONLINE)) {
+        for (;;) {
+            __asm__ volatile("cli; hlt");
+        }
+    }
+    boot_end(BOOT_EV_AP_ENTRY, cpu_id);
     atomic_inc(&smp_info.ready_count);
-    ap_boot_done = 1;
     
     /* Enable interrupts and enter scheduler */
     local_irq_enable();
@@ -294,17 +556,272 @@ void ap_entry(void) {
     kprintf("SMP: CPU %d entering scheduler\n", cpu_id);
     
     /* Enter idle loop */
-    while (1) {
-        if (smp_info.cpus[cpu_id]->runqueue->nr_running > 0) {
-            schedule();
-        } else {
-            /* Idle - try to pull work from other CPUs */
-            idle_balance(cpu_id);
+    cpu_idle_loop(cpu_id);
+}
+
+/*
+ * TLB shootdown
+ *
+ * Unmaps are gathered into a tlb_flush_req_t and sent with one IPI to
+ * each CPU that really holds entries for the address space.  Targets
+ * queue the request pointer, flush with INVLPG (or a full flush when
+ * the batch overflowed) and acknowledge through req->pending.
+ */
+#define CR3_NOFLUSH     (1ULL << 63)
+#define CR4_PGE         (1UL << 7)
+#define CR4_PCIDE       (1UL << 17)
+
+typedef struct tlb_cpu_state {
+    tlb_mm_t *active_mm;            /* Address space loaded in CR3 */
+    volatile int lazy;              /* Running a kernel thread on it */
+    int pcid;                       /* PCID enabled on this CPU */
+    
+    spinlock_t lock;                /* Protects queue */
+    uint32_t count;
+    /* Senders wait for completion, so at most one entry per CPU */
+    tlb_flush_req_t *queue[MAX_CPUS];
+} PERCPU_ALIGNED tlb_cpu_state_t;
+
+static tlb_cpu_state_t tlb_state[MAX_CPUS];
+
+static inline void tlb_mask_set(volatile uint32_t *mask, uint32_t cpu) {
+    __atomic_fetch_or(&mask[cpu / 32], 1U << (cpu % 32), __ATOMIC_SEQ_CST);
+}
+
+static inline int tlb_mask_test_and_clear(volatile uint32_t *mask,
+                                          uint32_t cpu) {
+    uint32_t bit = 1U << (cpu % 32);
+    return (__atomic_fetch_and(&mask[cpu / 32], ~bit,
+                               __ATOMIC_SEQ_CST) & bit) != 0;
+}
+
+static inline void local_flush_tlb_one(uintptr_t addr) {
+    __asm__ volatile("invlpg (%0)" :: "r"(addr) : "memory");
+}
+
+/* Flush non-global entries of the current address space */
+static inline void local_flush_tlb_mm(void) {
+    __asm__ volatile(
+        "movq %%cr3, %%rax\n\t"
+        "movq %%rax, %%cr3"
+        ::: "rax", "memory"
+    );
+}
+
+/* Flush everything including global (kernel) entries */
+static inline void local_flush_tlb_global(void) {
+    unsigned long cr4;
+    
+    __asm__ volatile("movq %%cr4, %0" : "=r"(cr4));
+    __asm__ volatile("movq %0, %%cr4" :: "r"(cr4 & ~CR4_PGE) : "memory");
+    __asm__ volatile("movq %0, %%cr4" :: "r"(cr4) : "memory");
+}
+
+static void tlb_flush_local(tlb_flush_req_t *req) {
+    uint32_t i;
+    
+    if (req->full) {
+        if (req->mm)
+            local_flush_tlb_mm();
+        else
+            local_flush_tlb_global();
+        return;
+    }
+    
+    for (i = 0; i < req->nr_pages; i++)
+        local_flush_tlb_one(req->pages[i]);
+}
+
+/*
+ * Per-CPU TLB setup: enable PCID where detect_cpu_features() found it
+ */
+void tlb_init_cpu(void) {
+    uint32_t cpu = smp_processor_id();
+    tlb_cpu_state_t *st = &tlb_state[cpu];
+    unsigned long cr4;
+    
+    spin_lock_init(&st->lock);
+    st->active_mm = NULL;
+    st->lazy = 0;
+    st->count = 0;
+    st->pcid = 0;
+    
+    if (smp_info.cpus[cpu]->features & CPU_FEATURE_PCID) {
+        __asm__ volatile("movq %%cr4, %0" : "=r"(cr4));
+        __asm__ volatile("movq %0, %%cr4" :: "r"(cr4 | CR4_PCIDE) : "memory");
+        st->pcid = 1;
+    }
+}
+
+/*
+ * Switch this CPU to another address space (called on context switch)
+ */
+void tlb_switch_mm(tlb_mm_t *next) {
+    uint32_t cpu = smp_processor_id();
+    tlb_cpu_state_t *st = &tlb_state[cpu];
+    tlb_mm_t *prev = st->active_mm;
+    int flush;
+    
+    /* Kernel thread: keep the old tables loaded, stop taking IPIs */
+    if (!next) {
+        st->lazy = 1;
+        return;
+    }
+    
+    st->lazy = 0;
+    flush = tlb_mask_test_and_clear(next->stale_mask, cpu);
+    
+    if (prev == next) {
+        if (flush)
+            local_flush_tlb_mm();
+        return;
+    }
+    
+    tlb_mask_set(next->cpu_mask, cpu);
+    st->active_mm = next;
+    
+    if (st->pcid) {
+        /* Old tagged entries survive; only flush what went stale */
+        uint64_t cr3 = next->cr3 | next->pcid | (flush ? 0 : CR3_NOFLUSH);
+        __asm__ volatile("movq %0, %%cr3" :: "r"(cr3) : "memory");
+    } else {
+        __asm__ volatile("movq %0, %%cr3" :: "r"(next->cr3) : "memory");
+        /* Reload dropped every entry of prev on this CPU */
+        if (prev)
+            tlb_mask_test_and_clear(prev->cpu_mask, cpu);
+    }
+}
+
+void tlb_gather_init(tlb_gather_t *tlb, tlb_mm_t *mm) {
+    tlb->mm = mm;
+    tlb->nr_pages = 0;
+    tlb->full = 0;
+    atomic_set(&tlb->pending, 0);
+}
+
+void tlb_gather_page(tlb_gather_t *tlb, uintptr_t addr) {
+    if (tlb->full)
+        return;
+    if (tlb->nr_pages == TLB_BATCH_MAX) {
+        tlb->full = 1;
+        return;
+    }
+    tlb->pages[tlb->nr_pages++] = addr & ~((uintptr_t)PAGE_SIZE - 1);
+}
+
+void tlb_gather_range(tlb_gather_t *tlb, uintptr_t start, uintptr_t end) {
+    uintptr_t addr;
+    
+    if ((end - start) / PAGE_SIZE > TLB_BATCH_MAX) {
+        tlb->full = 1;
+        return;
+    }
+    for (addr = start; addr < end && !tlb->full; addr += PAGE_SIZE)
+        tlb_gather_page(tlb, addr);
+}
+
+/*
+ * Queue a request on a remote CPU.  Returns 1 if an IPI is needed
+ * (requests queued behind an undelivered IPI ride along with it).
+ */
+static int tlb_queue_remote(uint32_t cpu, tlb_flush_req_t *req) {
+    tlb_cpu_state_t *st = &tlb_state[cpu];
+    irqflags_t flags;
+    int kick;
+    
+    spin_lock_irqsave(&st->lock, &flags);
+    kick = (st->count == 0);
+    st->queue[st->count++] = req;
+    spin_unlock_irqrestore(&st->lock, flags);
+    
+    return kick;
+}
+
+/*
+ * Drain this CPU's flush queue (IPI context)
+ */
+void tlb_process_queue(void) {
+    tlb_cpu_state_t *st = &tlb_state[smp_processor_id()];
+    tlb_flush_req_t *reqs[MAX_CPUS];
+    uint32_t i, n, pages = 0;
+    int full = 0;
+    
+    spin_lock(&st->lock);
+    n = st->count;
+    for (i = 0; i < n; i++)
+        reqs[i] = st->queue[i];
+    st->count = 0;
+    spin_unlock(&st->lock);
+    
+    for (i = 0; i < n; i++) {
+        pages += reqs[i]->nr_pages;
+        if (reqs[i]->full && !reqs[i]->mm)
+            full = 1;
+    }
+    
+    /* Many small batches queued at once: one global flush is cheaper */
+    if (full || n > TLB_QUEUE_LEN || pages > TLB_BATCH_MAX * 2) {
+        local_flush_tlb_global();
+    } else {
+        for (i = 0; i < n; i++)
+            tlb_flush_local(reqs[i]);
+    }
+    
+    /* Acknowledge only after the flush is done */
+    for (i = 0; i < n; i++)
+        atomic_dec(&reqs[i]->pending);
+}
+
+/*
+ * Send a gathered request to every CPU that needs it and wait
+ */
+void tlb_shootdown(tlb_flush_req_t *req) {
+    uint32_t self = smp_processor_id();
+    uint32_t kick[MAX_CPUS / 32] = { 0 };
+    uint32_t cpu, targets = 0;
+    tlb_mm_t *mm = req->mm;
+    
+    if (!mm || tlb_state[self].active_mm == mm)
+        tlb_flush_local(req);
+    
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+        if (cpu == self || !cpu_isset(cpu, smp_info.online_mask))
+            continue;
+        
+        if (mm) {
+            if (!cpu_isset(cpu, (const uint32_t *)mm->cpu_mask))
+                continue;
             
-            /* Enable interrupts and halt until next interrupt */
-            __asm__ volatile("sti; hlt" ::: "memory");
+            /* Not running it right now: flush on next switch instead */
+            if (tlb_state[cpu].active_mm != mm || tlb_state[cpu].lazy) {
+                tlb_mask_set(mm->stale_mask, cpu);
+                continue;
+            }
         }
+        
+        cpu_set(cpu, kick);
+        targets++;
+    }
+    
+    if (targets == 0)
+        return;
+    
+    atomic_set(&req->pending, targets);
+    
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+        if (cpu_isset(cpu, kick) && tlb_queue_remote(cpu, req))
+            smp_send_ipi(cpu, IPI_TLB_FLUSH);
     }
+    
+    /* Caller may free the pages once every target has flushed */
+    while (atomic_read(&req->pending) > 0)
+        cpu_relax();
+}
+
+void tlb_gather_finish(tlb_gather_t *tlb) {
+    if (tlb->nr_pages == 0 && !tlb->full)
+        return;
+    tlb_shootdown(tlb);
 }
 
 /*
@@ -323,6 +840,9 @@ void smp_send_ipi(uint32_t cpu_id, uint32_t ipi_type) {
         default: return;
     }
     
+    sched_trace(TRACE_IPI, current_thread() ? current_thread()->tid : 0,
+                cpu_id, ipi_type);
+    perf_count_ipi_sent();
     lapic_send_ipi(smp_info.cpus[cpu_id]->apic_id, vector);
 }
 
@@ -352,10 +872,24 @@ void smp_send_ipi_others(uint32_t ipi_type) {
     }
 }
 
+/*
+ * Send IPI to the online CPUs in mask
+ */
+void smp_send_ipi_mask(const uint32_t *mask, uint32_t ipi_type) {
+    uint32_t i;
+    
+    for (i = 0; i < smp_info.cpu_count; i++) {
+        if (cpu_isset(i, mask) && cpu_isset(i, smp_info.online_mask)) {
+            smp_send_ipi(i, ipi_type);
+        }
+    }
+}
+
 /*
  * IPI handler for reschedule
  */
 void ipi_reschedule_handler(void) {
+    perf_count_ipi_received();
     set_need_resched();
     lapic_eoi();
 }
@@ -364,67 +898,288 @@ void ipi_reschedule_handler(void) {
  * IPI handler for TLB flush
  */
 void ipi_tlb_flush_handler(void) {
-    /* Invalidate entire TLB */
-    __asm__ volatile(
-        "movq %%cr3, %%rax\n\t"
-        "movq %%rax, %%cr3"
-        ::: "rax", "memory"
-    );
+    perf_count_ipi_received();
+    tlb_process_queue();
     lapic_eoi();
 }
 
 /*
- * IPI handler for cross-CPU function call
+ * Cross-CPU function calls
+ *
+ * Every CPU has a queue of pending calls.  A sender only raises
+ * IPI_CALL_FUNC when it finds the target queue empty, so calls issued
+ * back to back before the target gets to them share one interrupt.
+ * Calls are reference counted, which lets async callers return before
+ * the targets have run them.
  */
-void ipi_call_handler(void) {
-    if (smp_info.ipi_func) {
-        smp_info.ipi_func(smp_info.ipi_arg);
+typedef struct call_queue {
+    spinlock_t lock;
+    uint32_t head;                  /* Oldest pending call */
+    uint32_t count;
+    smp_call_t *ring[SMP_CALL_QUEUE_LEN];
+    
+    uint64_t nr_calls;              /* Calls run from the queue */
+    uint64_t nr_ipis;               /* Interrupts that ran them */
+} PERCPU_ALIGNED call_queue_t;
+
+static call_queue_t call_queues[MAX_CPUS];
+
+/* Async calls outlive the caller's stack */
+static kmem_cache_t *call_cache;
+
+void smp_call_init_cpu(void) {
+    call_queue_t *q = &call_queues[smp_processor_id()];
+    
+    spin_lock_init(&q->lock);
+    q->head = 0;
+    q->count = 0;
+    q->nr_calls = 0;
+    q->nr_ipis = 0;
+    
+    /* First CPU through (the BSP) sets up the cache; async calls
+     * degrade to synchronous ones if it could not be created */
+    if (!call_cache)
+        call_cache = kmem_cache_create("smp_call", sizeof(smp_call_t), 0,
+                                       0, NULL);
+}
+
+static void smp_call_put_ref(smp_call_t *call) {
+    /* Read first - a caller's on-stack call can go away after the drop */
+    uint32_t allocated = call->flags & SMP_CALL_ALLOCATED;
+    
+    if (atomic_dec_and_test(&call->refs) && allocated)
+        kmem_cache_free(call_cache, call);
+}
+
+/*
+ * Run every call queued for this CPU
+ */
+void smp_call_process_queue(void) {
+    call_queue_t *q = &call_queues[smp_processor_id()];
+    smp_call_t *call;
+    irqflags_t flags;
+    
+    flags = local_irq_save();
+    for (;;) {
+        spin_lock(&q->lock);
+        if (q->count == 0) {
+            spin_unlock(&q->lock);
+            break;
+        }
+        call = q->ring[q->head];
+        q->head = (q->head + 1) % SMP_CALL_QUEUE_LEN;
+        q->count--;
+        spin_unlock(&q->lock);
+        
+        call->func(call->arg);
+        q->nr_calls++;
+        smp_call_put_ref(call);
     }
-    atomic_dec(&smp_info.ipi_pending);
-    lapic_eoi();
+    local_irq_restore(flags);
 }
 
 /*
- * Call function on all CPUs
+ * Append a call to a remote CPU's queue.
+ * Returns 1 if the queue was empty and the target needs an IPI.
  */
-int smp_call_function(smp_call_func_t func, void *arg, int wait) {
+static int smp_call_enqueue(uint32_t cpu, smp_call_t *call) {
+    call_queue_t *q = &call_queues[cpu];
+    int kick;
+    
+    for (;;) {
+        spin_lock(&q->lock);
+        if (q->count < SMP_CALL_QUEUE_LEN)
+            break;
+        spin_unlock(&q->lock);
+        
+        /* Target is behind - keep our own queue moving so two CPUs
+         * filling each other's queues cannot deadlock */
+        smp_call_process_queue();
+        cpu_relax();
+    }
+    
+    q->ring[(q->head + q->count) % SMP_CALL_QUEUE_LEN] = call;
+    kick = (q->count++ == 0);
+    spin_unlock(&q->lock);
+    
+    return kick;
+}
+
+/*
+ * Deliver a call to every online CPU in mask (caller holds a ref)
+ */
+static void smp_call_many(const uint32_t *mask, smp_call_t *call) {
+    uint32_t self = smp_processor_id();
+    uint32_t kick[MAX_CPUS / 32] = { 0 };
+    uint32_t cpu, targets = 0;
+    int run_self = 0;
     irqflags_t flags;
     
-    spin_lock_irqsave(&smp_info.global_lock, &flags);
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+        if (!cpu_isset(cpu, mask) || !cpu_isset(cpu, smp_info.online_mask))
+            continue;
+        if (cpu == self)
+            run_self = 1;
+        else
+            targets++;
+    }
+    
+    /* Take every target's reference before any of them can drop it */
+    atomic_add(targets + run_self, &call->refs);
+    
+    for (cpu = 0; cpu < smp_info.cpu_count && targets; cpu++) {
+        if (cpu == self || !cpu_isset(cpu, mask) ||
+            !cpu_isset(cpu, smp_info.online_mask))
+            continue;
+        if (smp_call_enqueue(cpu, call))
+            cpu_set(cpu, kick);
+    }
+    
+    for (cpu = 0; cpu < smp_info.cpu_count && targets; cpu++) {
+        if (cpu_isset(cpu, kick))
+            smp_send_ipi(cpu, IPI_CALL_FUNC);
+    }
     
-    smp_info.ipi_func = func;
-    smp_info.ipi_arg = arg;
-    atomic_set(&smp_info.ipi_pending, smp_info.cpu_count - 1);
+    /* Run the local share like a target would, with interrupts off */
+    if (run_self) {
+        flags = local_irq_save();
+        call->func(call->arg);
+        smp_call_put_ref(call);
+        local_irq_restore(flags);
+    }
+}
+
+/*
+ * IPI handler for cross-CPU function call
+ */
+void ipi_call_handler(void) {
+    call_queues[smp_processor_id()].nr_ipis++;
+    perf_count_ipi_received();
+    smp_call_process_queue();
+    lapic_eoi();
+}
+
+/*
+ * Async call handles
+ */
+int smp_call_done(smp_call_t *call) {
+    return atomic_read(&call->refs) <= 1;
+}
+
+void smp_call_wait(smp_call_t *call) {
+    while (!smp_call_done(call)) {
+        /* Someone may be waiting on us with interrupts off */
+        smp_call_process_queue();
+        cpu_relax();
+    }
+}
+
+void smp_call_put(smp_call_t *call) {
+    smp_call_put_ref(call);
+}
+
+/*
+ * Start a call on the CPUs in mask without waiting for it.
+ * Returns NULL if no call could be allocated.
+ */
+smp_call_t *smp_call_function_async(const uint32_t *mask,
+                                    smp_call_func_t func, void *arg) {
+    smp_call_t *call;
     
-    smp_send_ipi_others(IPI_CALL_FUNC);
+    call = call_cache ? kmem_cache_alloc(call_cache) : NULL;
+    if (!call)
+        return NULL;
     
-    /* Also call on this CPU */
-    func(arg);
+    call->func = func;
+    call->arg = arg;
+    call->flags = SMP_CALL_ALLOCATED;
+    atomic_set(&call->refs, 1);
     
-    if (wait) {
-        while (atomic_read(&smp_info.ipi_pending) > 0) {
-            cpu_relax();
+    smp_call_many(mask, call);
+    return call;
+}
+
+/*
+ * Call function on the CPUs in mask (including this one if set)
+ */
+int smp_call_function_mask(const uint32_t *mask, smp_call_func_t func,
+                           void *arg, int wait) {
+    smp_call_t local, *call;
+    
+    if (!wait) {
+        call = smp_call_function_async(mask, func, arg);
+        if (call) {
+            smp_call_put(call);
+            return 0;
         }
+        /* Out of memory - fall back to a synchronous call */
     }
     
-    spin_unlock_irqrestore(&smp_info.global_lock, flags);
+    call = &local;
+    call->func = func;
+    call->arg = arg;
+    call->flags = 0;
+    atomic_set(&call->refs, 1);
+    
+    smp_call_many(mask, call);
+    smp_call_wait(call);
     
     return 0;
 }
 
+/*
+ * Call function on one CPU
+ */
+int smp_call_function_single(uint32_t cpu, smp_call_func_t func,
+                             void *arg, int wait) {
+    uint32_t mask[MAX_CPUS / 32] = { 0 };
+    
+    if (cpu >= smp_info.cpu_count || !cpu_isset(cpu, smp_info.online_mask))
+        return -1;
+    
+    cpu_set(cpu, mask);
+    return smp_call_function_mask(mask, func, arg, wait);
+}
+
+/*
+ * Call function on all CPUs
+ */
+int smp_call_function(smp_call_func_t func, void *arg, int wait) {
+    return smp_call_function_mask((const uint32_t *)smp_info.online_mask,
+                                  func, arg, wait);
+}
+
 /*
  * Flush TLB on all CPUs
  */
 void smp_flush_tlb_all(void) {
-    /* Flush local TLB */
-    __asm__ volatile(
-        "movq %%cr3, %%rax\n\t"
-        "movq %%rax, %%cr3"
-        ::: "rax", "memory"
-    );
+    tlb_flush_req_t req;
+    
+    tlb_gather_init(&req, NULL);
+    req.full = 1;
+    tlb_shootdown(&req);
+}
+
+/*
+ * Flush one kernel page on all CPUs
+ */
+void smp_flush_tlb_page(void *addr) {
+    tlb_flush_req_t req;
+    
+    tlb_gather_init(&req, NULL);
+    tlb_gather_page(&req, (uintptr_t)addr);
+    tlb_shootdown(&req);
+}
+
+/*
+ * Flush a kernel address range on all CPUs
+ */
+void smp_flush_tlb_range(void *start, void *end) {
+    tlb_flush_req_t req;
     
-    /* Send TLB flush IPI to others */
-    smp_send_ipi_others(IPI_TLB_FLUSH);
+    tlb_gather_init(&req, NULL);
+    tlb_gather_range(&req, (uintptr_t)start, (uintptr_t)end);
+    tlb_shootdown(&req);
 }
 
 /*
@@ -0,0 +1,246 @@
+/*
+ * osFree Read-Copy-Update
+ * Copyright (c) 2024 osFree Project
+ *
+ * Each CPU counts its quiescent states (context switches and idle
+ * entries).  A grace period starts by snapshotting those counts and
+ * ends once every online CPU has moved past its snapshot or is idle;
+ * callbacks queued before the start can then run.  Grace periods are
+ * driven from the scheduler tick, so readers never touch shared state.
+ */
+
+#include <os3/rcu.h>
+#include <os3/scheduler.h>
+#include <os3/hrtimer.h>
+#include <os3/smp.h>
+#include <os3/spinlock.h>
+#include <os3/debug.h>
+
+static rcu_data_t rcu_data[MAX_CPUS];
+
+/*
+ * Global grace period state
+ */
+static struct {
+    spinlock_t lock;
+    volatile uint64_t gp_seq;       /* Last grace period started */
+    volatile uint64_t gp_completed; /* Last grace period finished */
+    int gp_requested;               /* Another one wanted after gp_seq */
+    uint64_t snap[MAX_CPUS];        /* qs_count at start of gp_seq */
+} rcu_state;
+
+static inline int rcu_gp_done(uint64_t gp) {
+    return (int64_t)(rcu_state.gp_completed - gp) >= 0;
+}
+
+/*
+ * Begin a new grace period (caller holds rcu_state.lock)
+ */
+static void rcu_start_gp_locked(void) {
+    uint32_t cpu;
+
+    rcu_state.gp_seq++;
+
+    /* Order updaters' unpublish stores before the snapshot */
+    mb();
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++)
+        rcu_state.snap[cpu] = rcu_data[cpu].qs_count;
+}
+
+/*
+ * Return the grace period a callback queued now has to wait for,
+ * starting one if none is running (caller holds rcu_state.lock)
+ */
+static uint64_t rcu_request_gp_locked(void) {
+    if (rcu_state.gp_seq != rcu_state.gp_completed) {
+        /* The running one may have missed readers that began earlier */
+        rcu_state.gp_requested = 1;
+        return rcu_state.gp_seq + 1;
+    }
+
+    rcu_start_gp_locked();
+    return rcu_state.gp_seq;
+}
+
+/*
+ * Finish the current grace period if every CPU has been quiescent
+ */
+static void rcu_gp_poll(void) {
+    irqflags_t flags;
+    uint32_t cpu;
+
+    if (rcu_state.gp_seq == rcu_state.gp_completed)
+        return;
+
+    /* One CPU doing the scan per tick is enough */
+    flags = local_irq_save();
+    if (!spin_trylock(&rcu_state.lock)) {
+        local_irq_restore(flags);
+        return;
+    }
+
+    if (rcu_state.gp_seq == rcu_state.gp_completed)
+        goto out;
+
+    for (cpu = 0; cpu < smp_info.cpu_count; cpu++) {
+        rcu_data_t *rd = &rcu_data[cpu];
+
+        if (!cpu_isset(cpu, smp_info.online_mask))
+            continue;
+        if (rd->idle || rd->qs_count != rcu_state.snap[cpu])
+            continue;
+        goto out;
+    }
+
+    rcu_state.gp_completed = rcu_state.gp_seq;
+
+    if (rcu_state.gp_requested) {
+        rcu_state.gp_requested = 0;
+        rcu_start_gp_locked();
+    }
+
+out:
+    spin_unlock(&rcu_state.lock);
+    local_irq_restore(flags);
+}
+
+/*
+ * Initialize global RCU state
+ */
+void rcu_init(void) {
+    spin_lock_init(&rcu_state.lock);
+    rcu_state.gp_seq = 0;
+    rcu_state.gp_completed = 0;
+    rcu_state.gp_requested = 0;
+}
+
+/*
+ * Initialize per-CPU RCU state
+ */
+void rcu_init_cpu(uint32_t cpu) {
+    rcu_data_t *rd = &rcu_data[cpu];
+
+    rd->qs_count = 0;
+    rd->idle = 0;
+    rd->next_list = NULL;
+    rd->next_tail = &rd->next_list;
+    rd->wait_list = NULL;
+    rd->wait_tail = &rd->wait_list;
+    rd->wait_gp = 0;
+    rd->nr_queued = 0;
+    rd->nr_invoked = 0;
+}
+
+/*
+ * Quiescent states
+ */
+void rcu_note_context_switch(uint32_t cpu) {
+    /* Complete this CPU's read-side accesses before reporting */
+    mb();
+    rcu_data[cpu].qs_count++;
+}
+
+void rcu_idle_enter(void) {
+    rcu_data_t *rd = &rcu_data[smp_processor_id()];
+
+    mb();
+    rd->idle = 1;
+}
+
+void rcu_idle_exit(void) {
+    rcu_data_t *rd = &rcu_data[smp_processor_id()];
+
+    rd->idle = 0;
+
+    /* Pollers must see us busy before we read any RCU pointer */
+    mb();
+}
+
+/*
+ * Queue func(head) to run after a grace period.
+ * Callbacks run from the timer interrupt and must not block.
+ */
+void call_rcu(rcu_head_t *head, rcu_callback_t func) {
+    rcu_data_t *rd;
+    irqflags_t flags;
+
+    head->next = NULL;
+    head->func = func;
+
+    flags = local_irq_save();
+    rd = &rcu_data[smp_processor_id()];
+    *rd->next_tail = head;
+    rd->next_tail = &head->next;
+    rd->nr_queued++;
+    local_irq_restore(flags);
+}
+
+/*
+ * Wait for a full grace period (process context only)
+ */
+void synchronize_rcu(void) {
+    irqflags_t flags;
+    uint64_t gp;
+
+    spin_lock_irqsave(&rcu_state.lock, &flags);
+    gp = rcu_request_gp_locked();
+    spin_unlock_irqrestore(&rcu_state.lock, flags);
+
+    while (!rcu_gp_done(gp)) {
+        /* The caller cannot be inside a read-side section */
+        flags = local_irq_save();
+        rcu_note_context_switch(smp_processor_id());
+        local_irq_restore(flags);
+
+        rcu_gp_poll();
+        if (rcu_gp_done(gp))
+            break;
+
+        thread_sleep(RCU_SYNC_POLL_NS);
+    }
+}
+
+/*
+ * Drive grace periods and run ready callbacks - from sched_tick()
+ */
+void rcu_check_callbacks(uint32_t cpu) {
+    rcu_data_t *rd = &rcu_data[cpu];
+    rcu_head_t *list, *next;
+
+    if (!rd->next_list && !rd->wait_list)
+        return;
+
+    rcu_gp_poll();
+
+    if (rd->wait_list && rcu_gp_done(rd->wait_gp)) {
+        list = rd->wait_list;
+        rd->wait_list = NULL;
+        rd->wait_tail = &rd->wait_list;
+
+        while (list) {
+            next = list->next;
+            list->func(list);
+            rd->nr_invoked++;
+            list = next;
+        }
+    }
+
+    /* Hand the next batch a grace period of its own */
+    if (!rd->wait_list && rd->next_list) {
+        rd->wait_list = rd->next_list;
+        rd->wait_tail = rd->next_tail;
+        rd->next_list = NULL;
+        rd->next_tail = &rd->next_list;
+
+        spin_lock(&rcu_state.lock);
+        rd->wait_gp = rcu_request_gp_locked();
+        spin_unlock(&rcu_state.lock);
+    }
+}
+
+/*
+ * An idle CPU with callbacks pending keeps its tick
+ */
+int rcu_needs_cpu(uint32_t cpu) {
+    return rcu_data[cpu].next_list || rcu_data[cpu].wait_list;
+}
@@ -0,0 +1,161 @@
+/*
+ * osFree Boot Timeline
+ * Copyright (c) 2024 osFree Project
+ *
+ * Records when each kernel init step starts and ends, straight from
+ * the TSC, so it works before the timers are calibrated.  Marks go
+ * into a static buffer through one atomic slot counter - APs coming
+ * up in parallel record their own steps without a lock.  The buffer
+ * is never freed, so user space can read it back through
+ * DosQueryBootTimeline().  Built with CONFIG_BOOT_TIMELINE.
+ */
+
+#include <os3/boot_timeline.h>
+#include <os3/atomic.h>
+#include <os3/smp.h>
+#include <os3/debug.h>
+
+#ifdef CONFIG_BOOT_TIMELINE
+
+static boot_timeline_entry_t boot_timeline[BOOT_TIMELINE_SIZE];
+static atomic_t boot_timeline_next = ATOMIC_INIT(0);
+static atomic_t boot_timeline_dropped = ATOMIC_INIT(0);
+
+static const char *const boot_event_names[BOOT_EV_MAX] = {
+    [BOOT_EV_NUMA_INIT]         = "numa_init",
+    [BOOT_EV_SMP_INIT]          = "smp_init",
+    [BOOT_EV_LAPIC_INIT]        = "lapic_init",
+    [BOOT_EV_LAPIC_CALIBRATE]   = "lapic_timer_calibrate",
+    [BOOT_EV_IOAPIC_INIT]       = "ioapic_init",
+    [BOOT_EV_SCHED_INIT]        = "sched_init",
+    [BOOT_EV_SCHED_INIT_CPU]    = "sched_init_cpu",
+    [BOOT_EV_SMP_BOOT_CPU]      = "smp_boot_cpu",
+    [BOOT_EV_SMP_BOOT_PARALLEL] = "smp_boot_cpus_parallel",
+    [BOOT_EV_AP_ENTRY]          = "ap_entry",
+    [BOOT_EV_AP_CALIBRATE]      = "ap_calibrate_tsc",
+    [BOOT_EV_FB_INIT]           = "framebuffer_init",
+};
+
+/*
+ * Record a mark.  The event field is written last, a reader skips
+ * slots that are still zero.
+ */
+void boot_mark(uint16_t event, uint32_t arg) {
+    boot_timeline_entry_t *e;
+    uint32_t slot;
+
+    slot = (uint32_t)atomic_add_return(1, &boot_timeline_next) - 1;
+    if (slot >= BOOT_TIMELINE_SIZE) {
+        atomic_inc(&boot_timeline_dropped);
+        return;
+    }
+
+    e = &boot_timeline[slot];
+    e->tsc = boot_timeline_clock();
+    e->arg = arg;
+    wmb();
+    e->event = event;
+}
+
+/*
+ * TSC rate from whichever CPU calibrated it, else the CPUID base
+ * frequency
+ */
+static uint64_t boot_timeline_tsc_freq(void) {
+    uint32_t i;
+
+    for (i = 0; i < MAX_CPUS; i++) {
+        if (smp_info.cpus[i] && smp_info.cpus[i]->tsc_freq)
+            return smp_info.cpus[i]->tsc_freq;
+    }
+
+    if (smp_info.cpus[0] && smp_info.cpus[0]->base_freq)
+        return (uint64_t)smp_info.cpus[0]->base_freq * 1000000ULL;
+
+    return 0;
+}
+
+uint32_t boot_timeline_export(boot_timeline_entry_t *buf, uint32_t max,
+                              boot_timeline_info_t *info) {
+    uint32_t count = (uint32_t)atomic_read(&boot_timeline_next);
+    uint32_t i, n = 0;
+
+    if (count > BOOT_TIMELINE_SIZE)
+        count = BOOT_TIMELINE_SIZE;
+
+    for (i = 0; i < count && n < max; i++) {
+        if (!boot_timeline[i].event)
+            continue;               /* Being written */
+        buf[n++] = boot_timeline[i];
+    }
+
+    if (info) {
+        info->count = count;
+        info->dropped = (uint32_t)atomic_read(&boot_timeline_dropped);
+        info->tsc_freq = boot_timeline_tsc_freq();
+    }
+
+    return n;
+}
+
+static uint64_t tsc_to_us(uint64_t delta, uint64_t freq) {
+    if (!freq)
+        return 0;
+    return (delta / freq) * 1000000ULL + ((delta % freq) * 1000000ULL) / freq;
+}
+
+/*
+ * Print every step with its start (relative to the first mark) and
+ * duration.  Begin and end marks are paired by event and arg.
+ */
+void boot_timeline_dump(void) {
+    uint32_t count = (uint32_t)atomic_read(&boot_timeline_next);
+    uint64_t freq = boot_timeline_tsc_freq();
+    uint64_t base;
+    uint32_t i, j;
+
+    if (count > BOOT_TIMELINE_SIZE)
+        count = BOOT_TIMELINE_SIZE;
+    if (!count)
+        return;
+
+    base = boot_timeline[0].tsc;
+    for (i = 1; i < count; i++) {
+        if (boot_timeline[i].event && boot_timeline[i].tsc < base)
+            base = boot_timeline[i].tsc;
+    }
+
+    kprintf("Boot timeline (TSC %llu Hz):\n", freq);
+
+    for (i = 0; i < count; i++) {
+        boot_timeline_entry_t *b = &boot_timeline[i];
+        boot_timeline_entry_t *e = NULL;
+        uint16_t ev = b->event;
+
+        if (!ev || (ev & BOOT_EV_END) || ev >= BOOT_EV_MAX)
+            continue;
+
+        for (j = i + 1; j < count; j++) {
+            if (boot_timeline[j].event == (ev | BOOT_EV_END) &&
+                boot_timeline[j].arg == b->arg) {
+                e = &boot_timeline[j];
+                break;
+            }
+        }
+
+        if (e) {
+            kprintf("  +%10llu us %-24s %3u %10llu us\n",
+                    tsc_to_us(b->tsc - base, freq), boot_event_names[ev],
+                    b->arg, tsc_to_us(e->tsc - b->tsc, freq));
+        } else {
+            kprintf("  +%10llu us %-24s %3u   (no end)\n",
+                    tsc_to_us(b->tsc - base, freq), boot_event_names[ev],
+                    b->arg);
+        }
+    }
+
+    if (atomic_read(&boot_timeline_dropped))
+        kprintf("  %d marks dropped\n", atomic_read(&boot_timeline_dropped));
+}
+
+#endif /* CONFIG_BOOT_TIMELINE */
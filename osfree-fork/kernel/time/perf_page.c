@@ -0,0 +1,240 @@
+/*
+ * osFree Performance Counter Pages
+ * Copyright (c) 2024 osFree Project
+ *
+ * A header page, one record per CPU and one per NUMA node, exported
+ * read-only to every process.  Each CPU refreshes only its own record
+ * from its timer tick and around idle, so the records never bounce
+ * between caches and need no lock; readers use the per-record
+ * sequence count.  The node records are refreshed by whichever CPU's
+ * tick finds them due first.  DosPerfSysCall() and the monitors read
+ * these instead of entering the kernel.
+ */
+
+#include <os3/perf_page.h>
+#include <os3/smp.h>
+#include <os3/scheduler.h>
+#include <os3/spinlock.h>
+#include <os3/time.h>
+#include <os3/memory.h>
+#include <os3/debug.h>
+
+typedef struct perf_region {
+    perf_page_header_t hdr;
+    perf_cpu_record_t cpus[PERF_MAX_CPUS] __attribute__((aligned(4096)));
+    perf_node_record_t nodes[PERF_MAX_NODES];
+} perf_region_t;
+
+static perf_region_t perf_region __attribute__((aligned(4096)));
+
+/*
+ * Kernel-only per-CPU state, kept out of the exported records
+ */
+typedef struct perf_cpu_state {
+    uint64_t ipis_sent;
+    uint64_t ipis_received;
+    uint64_t since_ns;          /* Start of the current busy/idle stretch */
+    uint64_t last_ns;           /* Last refresh */
+    uint32_t idle;
+} PERCPU_ALIGNED perf_cpu_state_t;
+
+static perf_cpu_state_t perf_cpus[MAX_CPUS];
+
+/* One node walker at a time; readers never take it */
+static spinlock_t perf_node_lock = SPINLOCK_INIT("perf_node");
+static uint64_t perf_node_last_ns;
+
+static inline void perf_write_begin(volatile uint32_t *seq) {
+    (*seq)++;
+    wmb();
+}
+
+static inline void perf_write_end(volatile uint32_t *seq) {
+    wmb();
+    (*seq)++;
+}
+
+/*
+ * Refresh one CPU's record - only ever on that CPU, interrupts off
+ */
+static void perf_update_cpu(uint32_t cpu, uint64_t now) {
+    perf_cpu_record_t *rec = &perf_region.cpus[cpu];
+    perf_cpu_state_t *st = &perf_cpus[cpu];
+    cpu_info_t *ci = smp_info.cpus[cpu];
+    run_queue_t *rq = scheduler.runqueues[cpu];
+    uint64_t busy, idle;
+
+    if (!ci)
+        return;
+
+    /* Fold in the stretch the idle loop has not accounted yet */
+    busy = ci->busy_time;
+    idle = ci->idle_time;
+    if (st->since_ns && now > st->since_ns) {
+        if (st->idle)
+            idle += now - st->since_ns;
+        else
+            busy += now - st->since_ns;
+    }
+
+    perf_write_begin(&rec->seq);
+    rec->timestamp_ns = now;
+    rec->busy_ns = busy;
+    rec->idle_ns = idle;
+    rec->irqs = ci->irq_count;
+    rec->ipis_sent = st->ipis_sent;
+    rec->ipis_received = st->ipis_received;
+    rec->idle = st->idle;
+    if (rq) {
+        rec->context_switches = rq->nr_switches;
+        rec->remote_wakeups = rq->nr_remote_wakeups;
+        rec->steals = rq->nr_steals;
+        rec->load = rq->load;
+        rec->nr_running = rq->nr_running;
+    }
+    perf_write_end(&rec->seq);
+
+    st->last_ns = now;
+}
+
+/*
+ * Refresh the node records (caller holds perf_node_lock)
+ */
+static void perf_update_nodes(uint64_t now) {
+    uint32_t i, n = perf_region.hdr.node_count;
+
+    for (i = 0; i < n; i++) {
+        perf_node_record_t *rec = &perf_region.nodes[i];
+        uint32_t blocks[PERF_NODE_ORDERS];
+        uint64_t total, free;
+
+        if (numa_node_stats(i, &total, &free, blocks, PERF_NODE_ORDERS) < 0)
+            continue;
+
+        perf_write_begin(&rec->seq);
+        rec->timestamp_ns = now;
+        rec->total_pages = total;
+        rec->free_pages = free;
+        memcpy(rec->free_blocks, blocks, sizeof(blocks));
+        perf_write_end(&rec->seq);
+    }
+
+    perf_node_last_ns = now;
+}
+
+void perf_page_init(void) {
+    perf_page_header_t *hdr = &perf_region.hdr;
+    uint32_t i;
+
+    memset(&perf_region, 0, sizeof(perf_region));
+    memset(perf_cpus, 0, sizeof(perf_cpus));
+
+    hdr->magic = PERF_PAGE_MAGIC;
+    hdr->version = PERF_PAGE_VERSION;
+    hdr->record_size = PERF_RECORD_SIZE;
+    hdr->cpu_offset = (uint32_t)((uint8_t *)perf_region.cpus - (uint8_t *)hdr);
+    hdr->cpu_count = 1;
+    hdr->node_offset = (uint32_t)((uint8_t *)perf_region.nodes - (uint8_t *)hdr);
+    hdr->node_orders = PERF_NODE_ORDERS;
+
+    for (i = 0; i < PERF_MAX_CPUS; i++)
+        perf_region.cpus[i].cpu = i;
+    for (i = 0; i < PERF_MAX_NODES; i++)
+        perf_region.nodes[i].node = i;
+}
+
+const perf_page_header_t *perf_page_get(void) {
+    return &perf_region.hdr;
+}
+
+/*
+ * Publish the CPUs that came up and the nodes they sit on (from
+ * smp_init once the APs are in)
+ */
+void perf_page_set_topology(uint32_t count) {
+    uint32_t i, nodes = numa_num_nodes();
+
+    if (count > PERF_MAX_CPUS)
+        count = PERF_MAX_CPUS;
+    if (nodes > PERF_MAX_NODES)
+        nodes = PERF_MAX_NODES;
+
+    for (i = 0; i < count; i++) {
+        perf_cpu_record_t *rec = &perf_region.cpus[i];
+
+        perf_write_begin(&rec->seq);
+        rec->node = cpu_to_node(i);
+        rec->online = smp_info.cpus[i] != NULL;
+        perf_write_end(&rec->seq);
+    }
+
+    wmb();
+    perf_region.hdr.cpu_count = count;
+    perf_region.hdr.node_count = nodes;
+}
+
+/*
+ * Own record at most once a millisecond, nodes every
+ * PERF_NODE_INTERVAL_NS by whoever gets the lock
+ */
+void perf_page_tick(void) {
+    uint32_t cpu = smp_processor_id();
+    irqflags_t flags;
+    uint64_t now = get_time_ns();
+
+    if (cpu >= PERF_MAX_CPUS)
+        return;
+
+    flags = local_irq_save();
+
+    if (now - perf_cpus[cpu].last_ns >= 1000000ULL)
+        perf_update_cpu(cpu, now);
+
+    if (now - perf_node_last_ns >= PERF_NODE_INTERVAL_NS &&
+        spin_trylock(&perf_node_lock)) {
+        if (now - perf_node_last_ns >= PERF_NODE_INTERVAL_NS)
+            perf_update_nodes(now);
+        spin_unlock(&perf_node_lock);
+    }
+
+    local_irq_restore(flags);
+}
+
+/*
+ * The idle loop has just added the busy stretch to busy_time; publish
+ * it now, since the tick may stay off for the whole sleep
+ */
+void perf_page_idle_enter(uint32_t cpu, uint64_t now) {
+    perf_cpu_state_t *st;
+
+    if (cpu >= PERF_MAX_CPUS)
+        return;
+
+    st = &perf_cpus[cpu];
+    st->idle = 1;
+    st->since_ns = now;
+    perf_update_cpu(cpu, now);
+}
+
+void perf_page_idle_exit(uint32_t cpu, uint64_t now) {
+    perf_cpu_state_t *st;
+
+    if (cpu >= PERF_MAX_CPUS)
+        return;
+
+    st = &perf_cpus[cpu];
+    st->idle = 0;
+    st->since_ns = now;
+}
+
+/*
+ * Plain increments on the current CPU's slot - a sender preempted
+ * between reading the CPU and the add can at worst credit a neighbour
+ */
+void perf_count_ipi_sent(void) {
+    perf_cpus[smp_processor_id()].ipis_sent++;
+}
+
+void perf_count_ipi_received(void) {
+    perf_cpus[smp_processor_id()].ipis_received++;
+}
@@ -0,0 +1,120 @@
+/*
+ * osFree System Information Page
+ * Copyright (c) 2024 osFree Project
+ *
+ * One page, exported read-only to every process, carrying the values
+ * applications poll through DosQuerySysInfo() - the millisecond count,
+ * the time of day, the boot drive and the CPU count.  The kernel is
+ * the only writer and brackets updates with a sequence count, so
+ * readers need neither a lock nor a kernel entry.  Any CPU's timer
+ * interrupt may refresh it, so it keeps ticking while the BSP idles
+ * with its tick stopped.
+ */
+
+#include <os3/sysinfo_page.h>
+#include <os3/smp.h>
+#include <os3/spinlock.h>
+#include <os3/time.h>
+#include <os3/debug.h>
+
+static sysinfo_page_t sysinfo_page __attribute__((aligned(4096)));
+
+/* Serializes writers; readers never take it */
+static spinlock_t sysinfo_lock = SPINLOCK_INIT("sysinfo");
+
+/* Seconds since 1980 at get_time_ns() == 0 */
+static uint64_t sysinfo_time_base;
+
+/* get_time_ns() at the last counter refresh */
+static uint64_t sysinfo_last_ns;
+
+static inline void sysinfo_write_begin(void) {
+    sysinfo_page.seq++;
+    wmb();
+}
+
+static inline void sysinfo_write_end(void) {
+    wmb();
+    sysinfo_page.seq++;
+}
+
+/*
+ * Counters from the current time (caller holds sysinfo_lock)
+ */
+static void sysinfo_update_time(uint64_t now) {
+    uint64_t secs = sysinfo_time_base + now / 1000000000ULL;
+
+    sysinfo_write_begin();
+    sysinfo_page.ms_count = (uint32_t)(now / 1000000ULL);
+    sysinfo_page.time_low = (uint32_t)secs;
+    sysinfo_page.time_high = (uint32_t)(secs >> 32);
+    sysinfo_write_end();
+
+    sysinfo_last_ns = now;
+}
+
+void sysinfo_page_init(void) {
+    sysinfo_page.magic = SYSINFO_PAGE_MAGIC;
+    sysinfo_page.version = SYSINFO_PAGE_VERSION;
+    sysinfo_page.seq = 0;
+    sysinfo_page.boot_drive = 3;    /* C: until the loader says otherwise */
+    sysinfo_page.num_processors = smp_info.cpu_count ? smp_info.cpu_count : 1;
+    sysinfo_update_time(get_time_ns());
+}
+
+const sysinfo_page_t *sysinfo_page_get(void) {
+    return &sysinfo_page;
+}
+
+/*
+ * Set the time of day (RTC read at boot, DosSetDateTime)
+ */
+void sysinfo_page_set_time(uint64_t secs_since_1980) {
+    irqflags_t flags;
+    uint64_t now;
+
+    spin_lock_irqsave(&sysinfo_lock, &flags);
+    now = get_time_ns();
+    sysinfo_time_base = secs_since_1980 - now / 1000000000ULL;
+    sysinfo_update_time(now);
+    spin_unlock_irqrestore(&sysinfo_lock, flags);
+}
+
+void sysinfo_page_set_boot_drive(uint32_t drive) {
+    irqflags_t flags;
+
+    spin_lock_irqsave(&sysinfo_lock, &flags);
+    sysinfo_write_begin();
+    sysinfo_page.boot_drive = drive;
+    sysinfo_write_end();
+    spin_unlock_irqrestore(&sysinfo_lock, flags);
+}
+
+void sysinfo_page_set_cpus(uint32_t count) {
+    irqflags_t flags;
+
+    spin_lock_irqsave(&sysinfo_lock, &flags);
+    sysinfo_write_begin();
+    sysinfo_page.num_processors = count;
+    sysinfo_write_end();
+    spin_unlock_irqrestore(&sysinfo_lock, flags);
+}
+
+/*
+ * Refresh at most once a millisecond; a CPU that finds another one
+ * updating just leaves it to that one
+ */
+void sysinfo_page_tick(void) {
+    irqflags_t flags;
+    uint64_t now = get_time_ns();
+
+    if (now - sysinfo_last_ns < 1000000ULL)
+        return;
+
+    flags = local_irq_save();
+    if (spin_trylock(&sysinfo_lock)) {
+        sysinfo_update_time(now);
+        spin_unlock(&sysinfo_lock);
+    }
+    local_irq_restore(flags);
+}
@@ -0,0 +1,321 @@
+/*
+ * osFree High-Resolution Timers
+ * Copyright (c) 2024 osFree Project
+ *
+ * Each CPU keeps its pending timers in a min-heap and programs the
+ * Local APIC in one-shot mode for the earliest one.  The scheduler
+ * tick is itself a timer, so an idle CPU can drop it and sleep until
+ * the next real deadline instead of waking every tick.
+ */
+
+#include <os3/hrtimer.h>
+#include <os3/apic.h>
+#include <os3/scheduler.h>
+#include <os3/rcu.h>
+#include <os3/smp.h>
+#include <os3/memory.h>
+#include <os3/time.h>
+#include <os3/debug.h>
+
+static hrtimer_base_t hrtimer_bases[MAX_CPUS];
+
+/*
+ * Heap helpers (caller holds base->lock)
+ */
+static inline void heap_set(hrtimer_base_t *base, uint32_t i, hrtimer_t *t) {
+    base->heap[i] = t;
+    t->heap_idx = i;
+}
+
+static void heap_sift_up(hrtimer_base_t *base, uint32_t i) {
+    hrtimer_t *t = base->heap[i];
+
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (base->heap[parent]->expires <= t->expires)
+            break;
+        heap_set(base, i, base->heap[parent]);
+        i = parent;
+    }
+    heap_set(base, i, t);
+}
+
+static void heap_sift_down(hrtimer_base_t *base, uint32_t i) {
+    hrtimer_t *t = base->heap[i];
+
+    for (;;) {
+        uint32_t child = i * 2 + 1;
+        if (child >= base->count)
+            break;
+        if (child + 1 < base->count &&
+            base->heap[child + 1]->expires < base->heap[child]->expires)
+            child++;
+        if (t->expires <= base->heap[child]->expires)
+            break;
+        heap_set(base, i, base->heap[child]);
+        i = child;
+    }
+    heap_set(base, i, t);
+}
+
+static void heap_remove(hrtimer_base_t *base, hrtimer_t *t) {
+    uint32_t i = t->heap_idx;
+    hrtimer_t *last = base->heap[--base->count];
+
+    t->heap_idx = -1;
+    if (i == base->count)
+        return;
+
+    heap_set(base, i, last);
+    if (i > 0 && base->heap[(i - 1) / 2]->expires > last->expires)
+        heap_sift_up(base, i);
+    else
+        heap_sift_down(base, i);
+}
+
+/*
+ * Program the LAPIC for the earliest pending timer
+ * (local CPU, caller holds base->lock)
+ */
+static void hrtimer_reprogram(hrtimer_base_t *base, uint64_t now) {
+    uint64_t delta;
+
+    if (base->count == 0) {
+        lapic_timer_stop();
+        return;
+    }
+
+    delta = base->heap[0]->expires > now ? base->heap[0]->expires - now : 0;
+    if (delta < HRTIMER_MIN_DELTA_NS)
+        delta = HRTIMER_MIN_DELTA_NS;
+
+    lapic_timer_oneshot(delta);
+}
+
+void hrtimer_setup(hrtimer_t *timer, hrtimer_fn_t fn, void *data) {
+    timer->expires = 0;
+    timer->fn = fn;
+    timer->data = data;
+    timer->heap_idx = -1;
+    timer->cpu = 0;
+}
+
+int hrtimer_active(const hrtimer_t *timer) {
+    return timer->heap_idx >= 0;
+}
+
+/*
+ * Arm (or re-arm) a timer on the current CPU
+ */
+int hrtimer_start(hrtimer_t *timer, uint64_t expires) {
+    hrtimer_base_t *base;
+    irqflags_t flags;
+
+    /* Re-arming a timer queued elsewhere moves it here */
+    if (hrtimer_active(timer) && timer->cpu != smp_processor_id())
+        hrtimer_cancel(timer);
+
+    base = &hrtimer_bases[smp_processor_id()];
+    spin_lock_irqsave(&base->lock, &flags);
+
+    if (hrtimer_active(timer))
+        heap_remove(base, timer);
+
+    if (base->count == base->capacity) {
+        spin_unlock_irqrestore(&base->lock, flags);
+        return -1;
+    }
+
+    timer->expires = expires;
+    timer->cpu = smp_processor_id();
+    base->heap[base->count] = timer;
+    timer->heap_idx = base->count++;
+    heap_sift_up(base, timer->heap_idx);
+
+    /* New earliest deadline - move the LAPIC interrupt up */
+    if (base->heap[0] == timer)
+        hrtimer_reprogram(base, get_time_ns());
+
+    spin_unlock_irqrestore(&base->lock, flags);
+    return 0;
+}
+
+/*
+ * Cancel a timer, waiting for a running callback to finish.
+ * Returns 1 if the timer was pending.
+ */
+int hrtimer_cancel(hrtimer_t *timer) {
+    hrtimer_base_t *base = &hrtimer_bases[timer->cpu];
+    irqflags_t flags;
+    int was_active = 0;
+
+    spin_lock_irqsave(&base->lock, &flags);
+    if (hrtimer_active(timer)) {
+        heap_remove(base, timer);
+        was_active = 1;
+    }
+    spin_unlock_irqrestore(&base->lock, flags);
+
+    /* An early interrupt for a cancelled head is harmless */
+    while (base->running == timer)
+        cpu_relax();
+
+    return was_active;
+}
+
+uint64_t hrtimer_next_event(uint32_t cpu) {
+    hrtimer_base_t *base = &hrtimer_bases[cpu];
+
+    return base->count ? base->heap[0]->expires : (uint64_t)-1;
+}
+
+/*
+ * Run expired timers - called from apic_timer_handler().
+ * Returns 0 if this CPU has not switched to one-shot timers yet.
+ */
+int hrtimer_interrupt(void) {
+    hrtimer_base_t *base = &hrtimer_bases[smp_processor_id()];
+    hrtimer_t *t;
+    uint64_t now;
+
+    if (!base->heap)
+        return 0;
+
+    spin_lock(&base->lock);
+    base->nr_events++;
+    now = get_time_ns();
+
+    while (base->count && base->heap[0]->expires <= now) {
+        t = base->heap[0];
+        heap_remove(base, t);
+        base->running = t;
+        spin_unlock(&base->lock);
+
+        t->fn(t);
+
+        spin_lock(&base->lock);
+        base->running = NULL;
+        now = get_time_ns();
+    }
+
+    hrtimer_reprogram(base, now);
+    spin_unlock(&base->lock);
+    return 1;
+}
+
+/*
+ * Scheduler tick timer
+ */
+static void tick_timer_fn(hrtimer_t *t) {
+    hrtimer_base_t *base = t->data;
+
+    sched_tick();
+
+    /* Advance by whole periods so ticks do not drift */
+    if (!base->tick_stopped)
+        hrtimer_start(t, t->expires + TICK_NS);
+}
+
+/*
+ * Switch this CPU from the periodic LAPIC tick to one-shot timers
+ */
+int hrtimer_init_cpu(void) {
+    uint32_t cpu = smp_processor_id();
+    hrtimer_base_t *base = &hrtimer_bases[cpu];
+
+    spin_lock_init(&base->lock);
+    base->count = 0;
+    base->capacity = HRTIMER_MAX_PER_CPU;
+    base->running = NULL;
+    base->tick_stopped = 0;
+    base->nr_events = 0;
+    base->nr_idle_stops = 0;
+    base->heap = kmalloc_node(HRTIMER_MAX_PER_CPU * sizeof(hrtimer_t *),
+                              cpu_to_node(cpu));
+    if (!base->heap) {
+        kprintf("TIMER: CPU %d staying on periodic tick\n", cpu);
+        return -1;
+    }
+
+    hrtimer_setup(&base->tick, tick_timer_fn, base);
+    return hrtimer_start(&base->tick, get_time_ns() + TICK_NS);
+}
+
+/*
+ * Stop the tick while idle; the LAPIC only fires for real deadlines
+ */
+void tick_nohz_idle_enter(void) {
+    hrtimer_base_t *base = &hrtimer_bases[smp_processor_id()];
+    irqflags_t flags;
+
+    if (!base->heap || base->tick_stopped)
+        return;
+
+    /* Pending RCU callbacks are driven from the tick */
+    if (rcu_needs_cpu(smp_processor_id()))
+        return;
+
+    base->tick_stopped = 1;
+    base->nr_idle_stops++;
+    hrtimer_cancel(&base->tick);
+
+    spin_lock_irqsave(&base->lock, &flags);
+    hrtimer_reprogram(base, get_time_ns());
+    spin_unlock_irqrestore(&base->lock, flags);
+}
+
+/*
+ * Restart the tick on the next period boundary after leaving idle
+ */
+void tick_nohz_idle_exit(void) {
+    hrtimer_base_t *base = &hrtimer_bases[smp_processor_id()];
+    uint64_t now;
+
+    if (!base->heap || !base->tick_stopped)
+        return;
+
+    base->tick_stopped = 0;
+    now = get_time_ns();
+    hrtimer_start(&base->tick, now - (now % TICK_NS) + TICK_NS);
+}
+
+/*
+ * Timed sleeps
+ */
+static void sleep_timer_fn(hrtimer_t *t) {
+    thread_wake(t);
+}
+
+int thread_sleep_until(uint64_t abs_time) {
+    thread_t *curr = current_thread();
+    hrtimer_t timer;
+    irqflags_t flags;
+
+    if (abs_time <= get_time_ns())
+        return 0;
+
+    hrtimer_setup(&timer, sleep_timer_fn, curr);
+    curr->wake_time = abs_time;
+
+    /*
+     * The timer fires on this CPU, so keeping interrupts off until
+     * schedule() switches away closes the window in which it could
+     * expire before we are on its wait channel.
+     */
+    flags = local_irq_save();
+    if (hrtimer_start(&timer, abs_time) < 0) {
+        local_irq_restore(flags);
+        return -1;
+    }
+    thread_block(&timer);
+    local_irq_restore(flags);
+
+    hrtimer_cancel(&timer);
+    curr->wake_time = 0;
+
+    return curr->wait_result;
+}
+
+int thread_sleep(uint64_t nanoseconds) {
+    return thread_sleep_until(get_time_ns() + nanoseconds);
+}
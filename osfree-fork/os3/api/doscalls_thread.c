@@ -11,6 +11,25 @@
 #include <os3/process.h>
 #include <os3/spinlock.h>
 #include <os3/memory.h>
+#include <os3/rcu.h>
+#include <os3/sysinfo_page.h>
+#include <os3/boot_timeline.h>
+
+/*
+ * Find a thread of proc by TID (caller holds rcu_read_lock).
+ * Lock-free against thread exit: thread_t is only freed after
+ * a grace period, so the result is valid until rcu_read_unlock().
+ */
+static thread_t *lookup_thread_rcu(process_t *proc, TID tid)
+{
+    thread_t *thread = tid_lookup(tid);
+    
+    if (!thread || thread->process != proc) {
+        return NULL;
+    }
+    
+    return thread;
+}
 
 /*
  * DosCreateThread - Create a new thread
@@ -57,6 +76,7 @@ APIRET APIENTRY DosCreateThread(PTID ptid, PFNTHREAD pfn,
     /* SMP: Allow thread to run on any CPU by default */
     thread->cpu_affinity = CPU_AFFINITY_ALL;
     thread->preferred_cpu = smp_processor_id();  /* Start on current CPU */
+    sched_numa_init_thread(thread, cpu_to_node(thread->preferred_cpu));
     
     /* Handle creation flags */
     if (flag & CREATE_READY) {
@@ -81,14 +101,18 @@ APIRET APIENTRY DosKillThread(TID tid)
     thread_t *thread;
     process_t *proc = current_process();
     
+    rcu_read_lock();
+    
     /* Find thread in current process */
-    thread = find_thread_by_tid(proc, tid);
+    thread = lookup_thread_rcu(proc, tid);
     if (!thread) {
+        rcu_read_unlock();
         return ERROR_INVALID_THREADID;
     }
     
     /* Cannot kill self this way */
     if (thread == current_thread()) {
+        rcu_read_unlock();
         return ERROR_INVALID_THREADID;
     }
     
@@ -108,6 +132,7 @@ APIRET APIENTRY DosKillThread(TID tid)
         }
     }
     
+    rcu_read_unlock();
     return NO_ERROR;
 }
 
@@ -120,8 +145,11 @@ APIRET APIENTRY DosSuspendThread(TID tid)
     process_t *proc = current_process();
     irqflags_t flags;
     
-    thread = find_thread_by_tid(proc, tid);
+    rcu_read_lock();
+    
+    thread = lookup_thread_rcu(proc, tid);
     if (!thread) {
+        rcu_read_unlock();
         return ERROR_INVALID_THREADID;
     }
     
@@ -136,6 +164,7 @@ APIRET APIENTRY DosSuspendThread(TID tid)
         thread->state = THREAD_STATE_SUSPENDED;
         if (thread == current_thread()) {
             spin_unlock_irqrestore(&thread->lock, flags);
+            rcu_read_unlock();
             schedule();
             return NO_ERROR;
         } else {
@@ -145,6 +174,7 @@ APIRET APIENTRY DosSuspendThread(TID tid)
     }
     
     spin_unlock_irqrestore(&thread->lock, flags);
+    rcu_read_unlock();
     return NO_ERROR;
 }
 
@@ -157,8 +187,11 @@ APIRET APIENTRY DosResumeThread(TID tid)
     process_t *proc = current_process();
     irqflags_t flags;
     
-    thread = find_thread_by_tid(proc, tid);
+    rcu_read_lock();
+    
+    thread = lookup_thread_rcu(proc, tid);
     if (!thread) {
+        rcu_read_unlock();
         return ERROR_INVALID_THREADID;
     }
     
@@ -166,6 +199,7 @@ APIRET APIENTRY DosResumeThread(TID tid)
     
     if (thread->suspend_count == 0) {
         spin_unlock_irqrestore(&thread->lock, flags);
+        rcu_read_unlock();
         return ERROR_NOT_FROZEN;
     }
     
@@ -176,10 +210,12 @@ APIRET APIENTRY DosResumeThread(TID tid)
         thread->state = THREAD_STATE_READY;
         spin_unlock_irqrestore(&thread->lock, flags);
         enqueue_thread(thread);
+        rcu_read_unlock();
         return NO_ERROR;
     }
     
     spin_unlock_irqrestore(&thread->lock, flags);
+    rcu_read_unlock();
     return NO_ERROR;
 }
 
@@ -261,11 +297,14 @@ APIRET APIENTRY DosSetPriority(ULONG scope, ULONG ulClass,
         case PRTYS_THREAD:
             /* Set priority for specific thread */
             proc = current_process();
-            thread = find_thread_by_tid(proc, id);
+            rcu_read_lock();
+            thread = lookup_thread_rcu(proc, id);
             if (!thread) {
+                rcu_read_unlock();
                 return ERROR_INVALID_THREADID;
             }
             apply_priority_change(thread, sched_class, prio_delta);
+            rcu_read_unlock();
             break;
             
         default:
@@ -394,11 +433,7 @@ APIRET APIENTRY DosSetThreadAffinity(TID tid, ULONG64 affinity_mask)
 {
     thread_t *thread;
     process_t *proc = current_process();
-    
-    thread = tid ? find_thread_by_tid(proc, tid) : current_thread();
-    if (!thread) {
-        return ERROR_INVALID_THREADID;
-    }
+    APIRET rc;
     
     /* Validate mask - at least one online CPU must be set */
     ULONG64 valid_mask = 0;
@@ -412,7 +447,18 @@ APIRET APIENTRY DosSetThreadAffinity(TID tid, ULONG64 affinity_mask)
         return ERROR_INVALID_PARAMETER;
     }
     
-    return set_thread_affinity(thread, affinity_mask);
+    rcu_read_lock();
+    
+    thread = tid ? lookup_thread_rcu(proc, tid) : current_thread();
+    if (!thread) {
+        rcu_read_unlock();
+        return ERROR_INVALID_THREADID;
+    }
+    
+    rc = set_thread_affinity(thread, affinity_mask);
+    rcu_read_unlock();
+    
+    return rc;
 }
 
 /*
@@ -427,35 +473,151 @@ APIRET APIENTRY DosGetThreadAffinity(TID tid, PULONG64 paffinity_mask)
         return ERROR_INVALID_PARAMETER;
     }
     
-    thread = tid ? find_thread_by_tid(proc, tid) : current_thread();
+    /* Monitors poll this constantly - no lock against thread exit */
+    rcu_read_lock();
+    
+    thread = tid ? lookup_thread_rcu(proc, tid) : current_thread();
     if (!thread) {
+        rcu_read_unlock();
         return ERROR_INVALID_THREADID;
     }
     
     *paffinity_mask = thread->cpu_affinity;
+    rcu_read_unlock();
+    
+    return NO_ERROR;
+}
+
+/*
+ * NEW API: DosSetThreadNumaPolicy - Set NUMA placement (SMP extension)
+ *
+ * ulPolicy is NUMA_POLICY_NONE, _AUTO or _PREFERRED, optionally or'd
+ * with NUMA_POLICY_MIGRATE.  ulNode is only used with _PREFERRED.
+ */
+APIRET APIENTRY DosSetThreadNumaPolicy(TID tid, ULONG ulPolicy, ULONG ulNode)
+{
+    thread_t *thread;
+    process_t *proc = current_process();
+    APIRET rc = NO_ERROR;
+    
+    rcu_read_lock();
+    
+    thread = tid ? lookup_thread_rcu(proc, tid) : current_thread();
+    if (!thread) {
+        rcu_read_unlock();
+        return ERROR_INVALID_THREADID;
+    }
+    
+    if (sched_numa_set_policy(thread, ulPolicy, ulNode) < 0) {
+        rc = ERROR_INVALID_PARAMETER;
+    }
+    
+    rcu_read_unlock();
+    return rc;
+}
+
+/*
+ * NEW API: DosGetThreadNumaPolicy - Get NUMA placement (SMP extension)
+ *
+ * Returns the policy and the node the thread is currently homed on.
+ */
+APIRET APIENTRY DosGetThreadNumaPolicy(TID tid, PULONG pulPolicy, PULONG pulNode)
+{
+    thread_t *thread;
+    process_t *proc = current_process();
+    
+    if (!pulPolicy || !pulNode) {
+        return ERROR_INVALID_PARAMETER;
+    }
+    
+    rcu_read_lock();
+    
+    thread = tid ? lookup_thread_rcu(proc, tid) : current_thread();
+    if (!thread) {
+        rcu_read_unlock();
+        return ERROR_INVALID_THREADID;
+    }
+    
+    *pulPolicy = thread->numa_policy;
+    *pulNode = thread->numa_home;
+    rcu_read_unlock();
+    
     return NO_ERROR;
 }
 
+/*
+ * NEW API: DosSetThreadDeadline - Reserve CPU time per period (SMP extension)
+ *
+ * The thread gets ulRuntime microseconds of CPU every ulPeriod, used
+ * before ulDeadline (0 = end of period), ahead of all priority classes.
+ * ulRuntime 0 releases the reservation.  Fails with ERROR_BUSY when
+ * no allowed CPU has enough unreserved bandwidth left.
+ */
+APIRET APIENTRY DosSetThreadDeadline(TID tid, ULONG ulRuntime,
+                                     ULONG ulDeadline, ULONG ulPeriod)
+{
+    thread_t *thread;
+    process_t *proc = current_process();
+    APIRET rc = NO_ERROR;
+    
+    rcu_read_lock();
+    
+    thread = tid ? lookup_thread_rcu(proc, tid) : current_thread();
+    if (!thread) {
+        rcu_read_unlock();
+        return ERROR_INVALID_THREADID;
+    }
+    
+    if (ulRuntime == 0) {
+        sched_clear_deadline(thread);
+    } else if (ulRuntime < DL_MIN_RUNTIME_NS / 1000 || ulRuntime > ulPeriod ||
+               (uint64_t)ulPeriod * 1000 > DL_MAX_PERIOD_NS ||
+               (ulDeadline && (ulDeadline < ulRuntime || ulDeadline > ulPeriod))) {
+        rc = ERROR_INVALID_PARAMETER;
+    } else if (sched_set_deadline(thread, (uint64_t)ulRuntime * 1000,
+                                  (uint64_t)ulDeadline * 1000,
+                                  (uint64_t)ulPeriod * 1000) < 0) {
+        rc = ERROR_BUSY;
+    }
+    
+    rcu_read_unlock();
+    return rc;
+}
+
 /*
  * NEW API: DosQuerySysInfo extension for SMP
  *
  * QSV_NUMPROCESSORS - Number of CPUs
  * QSV_PROCESSOR_ID  - Current CPU ID
+ *
+ * The time counters, boot drive and CPU count come from the shared
+ * sysinfo page, so this path and the user-space one cannot disagree.
  */
 APIRET APIENTRY DosQuerySysInfo(ULONG iStart, ULONG iLast,
                                  PVOID pBuf, ULONG cbBuf)
 {
+    const sysinfo_page_t *page = sysinfo_page_get();
     PULONG pul = (PULONG)pBuf;
     ULONG i;
     
-    if (!pBuf || cbBuf < (iLast - iStart + 1) * sizeof(ULONG)) {
+    if (!pBuf || iStart > iLast ||
+        cbBuf < (iLast - iStart + 1) * sizeof(ULONG)) {
         return ERROR_INVALID_PARAMETER;
     }
     
+    /* Whole range held in the page - no per-index work */
+    if (sysinfo_page_query(page, iStart, iLast, (uint32_t *)pul) == 0) {
+        return NO_ERROR;
+    }
+    
     for (i = iStart; i <= iLast; i++, pul++) {
         switch (i) {
+            case QSV_BOOT_DRIVE:
+            case QSV_MS_COUNT:
+            case QSV_TIME_LOW:
+            case QSV_TIME_HIGH:
             case QSV_NUMPROCESSORS:
-                *pul = smp_info.cpu_count;
+                sysinfo_page_query(page, i, i, (uint32_t *)pul);
                 break;
                 
             case QSV_PROCESSOR_ID:
@@ -487,3 +649,30 @@ APIRET APIENTRY DosQuerySysInfo(ULONG iStart, ULONG iLast,
     
     return NO_ERROR;
 }
+
+/*
+ * NEW API: DosQueryBootTimeline - Read back the boot timeline (debug extension)
+ *
+ * pBuf receives a boot_timeline_info_t followed by as many
+ * boot_timeline_entry_t records as fit in cbBuf; *pcEntries is set to
+ * the number of records copied.  Times are raw TSC values, info.tsc_freq
+ * converts them.
+ */
+APIRET APIENTRY DosQueryBootTimeline(PVOID pBuf, ULONG cbBuf, PULONG pcEntries)
+{
+#ifdef CONFIG_BOOT_TIMELINE
+    boot_timeline_info_t *info = (boot_timeline_info_t *)pBuf;
+    
+    if (!pBuf || !pcEntries || cbBuf < sizeof(boot_timeline_info_t)) {
+        return ERROR_INVALID_PARAMETER;
+    }
+    
+    *pcEntries = boot_timeline_export((boot_timeline_entry_t *)(info + 1),
+                                      (cbBuf - sizeof(boot_timeline_info_t)) /
+                                          sizeof(boot_timeline_entry_t),
+                                      info);
+    return NO_ERROR;
+#else
+    return ERROR_NOT_SUPPORTED;
+#endif
+}
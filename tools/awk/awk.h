@@ -222,6 +222,7 @@ typedef struct fa {
 	int	*posns[NSTATES];
 	int	anchor;
 	int	use;
+	struct	fa *hnext;	/* next in makedfa's lookup hash */
 	int	initstat;
 	int	curstat;
 	int	accept;
@@ -71,14 +71,30 @@ static	int poscnt;
 char	*patbeg;
 int	patlen;
 
-#define	NFA	20	/* cache this many dynamic fa's */
-fa	*fatab[NFA];
+#define	NFA	20	/* cache this many dynamic fa's to start with */
+#define	NFAMAX	640	/* and up to this many if they keep being reused */
+#define	NFAHASH	1021	/* buckets for looking them up by reg expr */
+
+fa	**fatab	= NULL;
 int	nfatab	= 0;	/* entries in fatab */
+int	sizefatab = 0;	/* slots in fatab */
+static fa *fahash[NFAHASH];	/* fatab entries chained by hash of restr */
+
+static void unhashfa(fa *f)	/* take f out of the lookup hash */
+{
+	fa **pp;
+
+	for (pp = &fahash[hash((const char *) f->restr, NFAHASH)]; *pp; pp = &(*pp)->hnext)
+		if (*pp == f) {
+			*pp = f->hnext;
+			break;
+		}
+}
 
 fa *makedfa(const char *s, int anchor)	/* returns dfa for reg expr s */
 {
-	int i, use, nuse;
-	fa *pfa;
+	int i, h, use, nuse;
+	fa *pfa, **np;
 	static int now = 1;
 
 	if (setvec == 0) {	/* first time through any RE */
@@ -91,28 +107,48 @@ fa *makedfa(const char *s, int anchor)	/* returns dfa for reg expr s */
 
 	if (compile_time)	/* a constant for sure */
 		return mkdfa(s, anchor);
-	for (i = 0; i < nfatab; i++)	/* is it there already? */
-		if (fatab[i]->anchor == anchor
-		  && strcmp((const char *) fatab[i]->restr, s) == 0) {
-			fatab[i]->use = now++;
-			return fatab[i];
+	h = hash(s, NFAHASH);
+	for (pfa = fahash[h]; pfa != NULL; pfa = pfa->hnext)	/* is it there already? */
+		if (pfa->anchor == anchor
+		  && strcmp((const char *) pfa->restr, s) == 0) {
+			pfa->use = now++;
+			return pfa;
 		}
 	pfa = mkdfa(s, anchor);
-	if (nfatab < NFA) {	/* room for another */
-		fatab[nfatab] = pfa;
-		fatab[nfatab]->use = now++;
-		nfatab++;
-		return pfa;
-	}
-	use = fatab[0]->use;	/* replace least-recently used */
 	nuse = 0;
-	for (i = 1; i < nfatab; i++)
-		if (fatab[i]->use < use) {
-			use = fatab[i]->use;
-			nuse = i;
-		}
-	freefa(fatab[nuse]);
-	fatab[nuse] = pfa;
+	if (nfatab == sizefatab && nfatab > 0) {	/* find least-recently used */
+		use = fatab[0]->use;
+		for (i = 1; i < nfatab; i++)
+			if (fatab[i]->use < use) {
+				use = fatab[i]->use;
+				nuse = i;
+			}
+	}
+	/* grow while even the least-recently used one was wanted during
+	 * the last sizefatab lookups: the program cycles through more
+	 * dynamic reg exprs than the cache holds, and evicting would mean
+	 * rebuilding one on nearly every lookup */
+	if (nfatab == sizefatab && sizefatab < NFAMAX
+	  && (sizefatab == 0 || now - fatab[nuse]->use <= sizefatab)) {
+		i = sizefatab ? 2 * sizefatab : NFA;
+		if (i > NFAMAX)
+			i = NFAMAX;
+		np = (fa **) realloc(fatab, i * sizeof(fa *));
+		if (np != NULL) {
+			fatab = np;
+			sizefatab = i;
+		} else if (sizefatab == 0)
+			return pfa;	/* can't cache it, but can keep running */
+	}
+	if (nfatab < sizefatab)	/* room for another */
+		fatab[nfatab++] = pfa;
+	else {			/* replace least-recently used */
+		unhashfa(fatab[nuse]);
+		freefa(fatab[nuse]);
+		fatab[nuse] = pfa;
+	}
+	pfa->hnext = fahash[h];
+	fahash[h] = pfa;
 	pfa->use = now++;
 	return pfa;
 }
@@ -313,6 +313,7 @@ void fldbld(void)	/* create fields from current record */
 		 * this variable is tested in the inner while loop.
 		 */
 		int rtest = '\n';  /* normal case */
+		char *end = r + n, *q;
 		if (strlen(*RS) > 0)
 			rtest = '\0';
 		for (;;) {
@@ -323,8 +324,15 @@ void fldbld(void)	/* create fields from current record */
 				xfree(fldtab[i]->sval);
 			fldtab[i]->sval = fr;
 			fldtab[i]->tval = FLD | STR | DONTFREE;
-			while (*r != sep && *r != rtest && *r != '\0')	/* \n is always a separator */
-				*fr++ = *r++;
+			if (rtest == '\0') {	/* only sep: let memchr find it */
+				if ((q = (char *) memchr(r, sep, end - r)) == NULL)
+					q = end;
+				memcpy(fr, r, q - r);
+				fr += q - r;
+				r = q;
+			} else
+				while (*r != sep && *r != rtest && *r != '\0')	/* \n is always a separator */
+					*fr++ = *r++;
 			*fr++ = 0;
 			if (*r++ == 0)
 				break;
@@ -31,7 +31,7 @@ THIS SOFTWARE.
 #include "awk.h"
 #include "ytab.h"
 
-#define	FULLTAB	2	/* rehash when table gets this x full */
+#define	FULLTAB	1	/* rehash when table gets this x full */
 #define	GROWTAB 4	/* grow table by this factor */
 
 Array	*symtab;	/* main symbol table */
@@ -41,15 +41,23 @@
 #include "newexe.h"
 #include "omf.h"
 
-char func[255];
 typedef struct _apientry {
 	char mod[9];				/*!< Module name */
 	WORD ord;					/*!< Function ordinal */
 	char func[21];				/*!< Function name */
 	DWORD offset;	  			/*!< Offset of pointer to fixup */
 	struct _apientry * next;	/*!< Next entry */
+	struct _apientry * hnext;	/*!< Next entry in hash chain */
 } apientry;
 
+/*! @brief Ordinal import found in import library */
+typedef struct _impentry {
+	char * mod;					/*!< Module name */
+	WORD ord;					/*!< Function ordinal */
+	char * func;				/*!< Function name */
+	struct _impentry * next;	/*!< Next entry in hash chain */
+} impentry;
+
 typedef struct _opts {
 	int quiet;					/*!< Quiet mode */
 	int logo;					/*!< Show logo */
@@ -67,8 +75,20 @@ typedef struct _opts {
 } opts;
 
 apientry * apiroot;
+apientry * apitail;
 opts options;
 
+/* Imports are looked up by hash: the import library is read and indexed
+ * once instead of being scanned again for every relocation, and the
+ * import list is checked for duplicates without walking it. */
+#define APIHASHSIZE 256
+#define IMPHASHSIZE 1024
+#define RLCCHUNK    64
+
+apientry * apihash[APIHASHSIZE];
+impentry * imphash[IMPHASHSIZE];
+char implib[_MAX_PATH];			/* library imphash was built from */
+
 /*! @brief Output usage help information */
 void printhlp(void);
 /*! @brief Check required environment to run */
@@ -79,6 +99,12 @@ int addtolist(char * mod, char * func);
 int bind(char * fname);
 /*! @brief Find function name in lib by ordinal and module name */
 char * findfunctionname(char * module, WORD ordinal, char * lib);
+/*! @brief Read import library and index its ordinal imports */
+int loadimplib(char * lib);
+/*! @brief Free import library index */
+void freeimplib(void);
+/*! @brief Hash module or function name */
+unsigned hashname(const char * name, unsigned seed);
 /*! @brief Search library in lib paths */
 int searchlib(char * libname, char * fullpath);
 /*! @brief Concatecate path separator */
@@ -413,34 +439,37 @@ void generate_imptable(void)
 	fclose(f);
 }
 
+/*! @brief Hash module or function name */
+unsigned hashname(const char * name, unsigned seed)
+{
+	unsigned h=seed;
+
+	while (*name) h=h*31+(BYTE)*name++;
+	return h;
+}
+
 int addtolist(char * mod, char * func)
 {
 	apientry * current;
+	unsigned h=hashname(func, hashname(mod, 0)) % APIHASHSIZE;
 	
-	if (apiroot)
+	// Search is exists
+	for (current=apihash[h]; current; current=current->hnext)
 	{
-		current=apiroot;
-		
-		// Search is exists
-		while (current)
-		{
-			// Exit if found
-			if ((!strcmp(current->mod, mod))&&(!strcmp(current->func, func))) return 0;
-			// next entry
-			if (current->next) current=current->next; else break;
-		}
-
-		current->next=malloc(sizeof(apientry));
-		current=current->next;
-		memset(current, 0, sizeof(apientry));
-		strcpy(current->mod, mod);
-		strcpy(current->func, func);
-	} else {
-		apiroot=malloc(sizeof(apientry));
-		memset(apiroot, 0, sizeof(apientry));
-		strcpy(apiroot->mod, mod);
-		strcpy(apiroot->func, func);
-	};
+		// Exit if found
+		if ((!strcmp(current->mod, mod))&&(!strcmp(current->func, func))) return 0;
+	}
+
+	current=malloc(sizeof(apientry));
+	memset(current, 0, sizeof(apientry));
+	strcpy(current->mod, mod);
+	strcpy(current->func, func);
+
+	// Keep list in order of first use, it is the import table order
+	if (apiroot) apitail->next=current; else apiroot=current;
+	apitail=current;
+	current->hnext=apihash[h];
+	apihash[h]=current;
 	return 0;
 }
 
@@ -578,90 +607,133 @@ int bind(char * fname)
   return rc;
 }
 
-char * findfunctionname(char * module, WORD ordinal, char * lib)
+/*! @brief Free import library index */
+void freeimplib(void)
 {
-  FILE * f;
-  omf_record_header head;
-  int result;
-  char buf[512];
+  impentry * e;
   int i;
-  long pos;
-  char mod[255];
+
+  for (i=0; i<IMPHASHSIZE; i++)
+  {
+    while (e=imphash[i])
+    {
+      imphash[i]=e->next;
+      free(e);
+    }
+  }
+  implib[0]=0;
+}
+
+/*! @brief Read import library and index its ordinal imports */
+/* The library is read into memory at once and its records are walked in
+ * a single pass. */
+int loadimplib(char * lib)
+{
+  FILE * f;
+  BYTE * data;
+  long size, pos;
+  BYTE * rec;
+  BYTE type;
+  WORD length;
+  int name_len, mod_len, mod_offset, ord_offset;
   WORD ord;
-  
+  unsigned h;
+  impentry * e;
+
+  freeimplib();
+
   // Open os2.lib/doscalls.lib for read
-  if(f=fopen(lib, "rb"))
+  if (!(f=fopen(lib, "rb"))) return 0;
+  fseek(f, 0, SEEK_END);
+  size=ftell(f);
+  rewind(f);
+  if ((size<=0) || !(data=malloc(size)))
+  {
+    fclose(f);
+    return 0;
+  }
+  if (fread(data, 1, size, f)!=(size_t)size)
   {
-    for (;1;)
+    free(data);
+    fclose(f);
+    return 0;
+  }
+  fclose(f);
+
+  for (pos=0; pos+3<=size; )
+  {
+    type=data[pos];
+    rec=data+pos+3;
+    length=*(WORD *)(data+pos+1);
+    if (pos+3+length>size) break;
+
+    if ((type==0x88) && (length>4) && (rec[1]==0xa0) && (rec[2]==0x01)) // comment, impdef
     {
-      if ( (result = fread(&head, 1, sizeof(head), f)) == sizeof(head) )
+      if (rec[3]!=0)
       {
-        //printf ("type=%02x length=%d\n", head.type, head.length);
-        fread(&buf, 1, head.length, f);
+        name_len = rec[4];
+        mod_offset = 5 + name_len;
 
-        if (head.type==0x88) // comment
-        {
-          if (buf[1]==0xa0) // comment class
-          {
-            if (buf[2]==0x01) // impdef
-            {
-              if (buf[3]!=0)
-              {
-#if 0
-                memcpy(&func, &buf[5], buf[4]);   // function name
-                func[buf[4]]=0;
-                memcpy(&mod, &buf[5+buf[4]+1], buf[5+buf[4]]); // module name
-                mod[buf[5+buf[4]]]=0;
-                ord=buf[5+buf[4]+1+buf[5+buf[4]]]+0xff*buf[5+buf[4]+1+buf[5+buf[4]]+1];                       // ordinal
-#else
-                                // FIXED:   
-                                int name_len = buf[4];
-                                int mod_offset = 5 + name_len;
-                                
-                                if (mod_offset < head.length) {
-                                    int mod_len = buf[mod_offset];
-                                    int ord_offset = mod_offset + 1 + mod_len;
-                                    
-                                    //  
-                                    if (ord_offset + 1 < head.length) {
-                                        //   
-                                        memcpy(func, &buf[5], name_len);
-                                        func[name_len] = '\0';
-                                        
-                                        //   
-                                        memcpy(mod, &buf[mod_offset + 1], mod_len);
-                                        mod[mod_len] = '\0';
-                                        
-                                        //  
-                                        ord = *(WORD*)(buf + ord_offset);
-#endif
-                if ((!strcmp(mod, module)) && (ord==ordinal)) 
-                {
-                  fclose(f);
+        if (mod_offset < length) {
+          mod_len = rec[mod_offset];
+          ord_offset = mod_offset + 1 + mod_len;
 
-                  return func;//printf("%s %s %d\n", func, mod, ord);
-                                        }
-                                    }
-                }
-              } else {
-                printf("panic!\n");
-              }
+          if (ord_offset + 1 < length) {
+            ord = *(WORD*)(rec + ord_offset);
+
+            e=malloc(sizeof(impentry)+mod_len+1+name_len+1);
+            if (!e)
+            {
+              free(data);
+              freeimplib();
+              return 0;
             }
+            e->mod=(char *)(e+1);
+            memcpy(e->mod, &rec[mod_offset + 1], mod_len);
+            e->mod[mod_len]=0;
+            e->func=e->mod+mod_len+1;
+            memcpy(e->func, &rec[5], name_len);
+            e->func[name_len]=0;
+            e->ord=ord;
+            h=(hashname(e->mod, 0)+ord) % IMPHASHSIZE;
+            e->next=imphash[h];
+            imphash[h]=e;
           }
         }
+      } else {
+        printf("panic!\n");
+      }
+    }
 
-        if (head.type==0xf1) break; // End of lib
+    pos+=3+length;
 
-        if (head.type==0x8a) // end of obj
-        {
-          fgetpos(f, &pos);
-          if ((16-pos%16)!=16) fread(&buf, 1, 16-pos%16, f);
-        }
-      }
+    if (type==0xf1) break; // End of lib
+
+    if (type==0x8a) // end of obj
+    {
+      if (pos%16) pos+=16-pos%16;
     }
-    fclose(f);
   }
-  return NULL;
+
+  free(data);
+  strncpy(implib, lib, sizeof(implib)-1);
+  return 1;
+}
+
+char * findfunctionname(char * module, WORD ordinal, char * lib)
+{
+  impentry * e;
+  impentry * found=NULL;
+
+  if (strcmp(implib, lib) && !loadimplib(lib)) return NULL;
+
+  // Chains are in reverse library order, the last match is the one
+  // a sequential search of the library would find
+  for (e=imphash[(hashname(module, 0)+ordinal) % IMPHASHSIZE]; e; e=e->next)
+  {
+    if ((e->ord==ordinal) && !strcmp(e->mod, module)) found=e;
+  }
+  return found?found->func:NULL;
 }
 
 /*! @brief Search library in lib paths */
@@ -815,6 +887,8 @@ int main(int argc, char *argv[])
   struct new_seg seg;
   int j;
   struct new_rlc rlc;
+  struct new_rlc rlcs[RLCCHUNK];
+  int n;
   int rc=1; // Error exit code by default
   signed char ch;
 
@@ -1064,9 +1138,12 @@ int main(int argc, char *argv[])
                                     //printf("%d pos=%d %d\n", i, (seg.ns_sector<<NEHeader.ne_align)+(seg.ns_cbseg?seg.ns_cbseg:0x10000), count);
                                     for (j = 0; j < count; j++)
                                     {
-                                      // Read relocation table entry
-                                      if (fread(&rlc, 1, sizeof(struct new_rlc), f)==sizeof(struct new_rlc))
+                                      // Read relocation table entries, RLCCHUNK at a time
+                                      if (!(j % RLCCHUNK))
+                                        n=(count-j < RLCCHUNK)?count-j:RLCCHUNK;
+                                      if ((j % RLCCHUNK) || (fread(rlcs, sizeof(struct new_rlc), n, f)==n))
                                       {
+                                        rlc=rlcs[j % RLCCHUNK];
                                         if (((rlc.nr_flags & NRRTYP)==NRRORD) || ((rlc.nr_flags & NRRTYP)==NRRNAM))
                                         {
                                           if ((rlc.nr_flags & NRRTYP)==NRRNAM)
@@ -93,6 +93,10 @@
 #include <unistd.h>
 #endif
 
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
 struct stats {
         unsigned long nblocks;
         unsigned long ninodes;
@@ -529,21 +533,68 @@ typedef struct
 #define utdecl32(x,n) { int i; for(i=0; i<n; i++) this->x[i] = swab32(this->x[i]); }
 
 #define HDLINK_CNT   16
+#define HDLINK_HASH  1024       // hash buckets for source inode numbers
+#define FILE_CHUNK   1024       // blocks read from a file at a time
+#define PREFETCH     16         // files ahead of the one being copied
 static int32 hdlink_cnt = HDLINK_CNT;
 struct hdlink_s
 {
         uint32  src_inode;
         uint32  dst_nod;
+        int32   next;           // next link in the same hash bucket
 };
 
 struct hdlinks_s
 {
         int32 count;
         struct hdlink_s *hdl;
+        int32 hash[HDLINK_HASH];
 };
 
 static struct hdlinks_s hdlinks;
 
+// in-memory indexes, only kept while the filesystem is built, so that
+// adding the n-th entry to a directory or the n-th block to a group
+// doesn't cost a scan of the n-1 before it
+
+#define DIRHASH_SIZE    1024                                    // initial hash size
+#define DIR_CLASSES     ((sizeof(directory) + 256) / 4 + 1)     // entry sizes / 4
+
+// an entry name, hashed on (directory inode, name)
+struct dirhash_s
+{
+        struct dirhash_s *next;
+        uint32 dnod;
+        uint32 nod;
+        int nlen;
+        char name[1];
+};
+
+// the blocks of a directory, with the room left in each
+struct dirindex_s
+{
+        uint32 nblocks;
+        uint32 maxblocks;
+        uint32 *blk;
+        uint16 *room;                   // longest entry still fitting in the block
+        uint32 first[DIR_CLASSES];      // no room for 4*n bytes in the blocks before
+        blockwalker end;                // where the next block is appended
+};
+
+struct fsindex_s
+{
+        uint32 ngroups;
+        uint32 *bbm_first;              // bitmap bytes before it are all allocated
+        uint32 *ibm_first;
+        uint32 ninodes;
+        struct dirindex_s **dirs;       // by inode, built on first use
+        uint32 hash_mask;
+        uint32 hash_count;
+        struct dirhash_s **hash;
+};
+
+static struct fsindex_s fsindex;
+
 static void
 swap_sb(superblock *sb)
 {
@@ -678,6 +729,15 @@ xrealloc(void *ptr, size_t size)
         return ptr;
 }
 
+static void *
+xcalloc(size_t nmemb, size_t size)
+{
+        void *ptr = calloc(nmemb, size);
+        if (ptr == NULL && nmemb != 0 && size != 0)
+                error_msg_and_die(memory_exhausted);
+        return ptr;
+}
+
 #ifndef __CPM__
 #include <unistd.h>
 int readlink(const char *path, char *buf, size_t bufsiz);
@@ -708,8 +768,8 @@ is_hardlink(ino_t inode)
 {
         int i;
 
-        for(i = 0; i < hdlinks.count; i++) {
-                if(hdlinks.hdl[i].src_inode == inode)
+        for(i = hdlinks.hash[(uint32)inode % HDLINK_HASH]; i >= 0; i = hdlinks.hdl[i].next) {
+                if(hdlinks.hdl[i].src_inode == (uint32)inode)
                         return i;
 
         }
@@ -799,6 +859,25 @@ deallocate(block b, uint32 item)
         b[(item-1) / 8] &= ~(1 << ((item-1) % 8));
 }
 
+// allocate the first free block/inode in the bitmap like allocate(b, 0),
+// but start looking at byte *first, everything before being allocated
+static uint32
+allocate_first(block b, uint32 *first)
+{
+        uint32 i;
+        int j;
+        for(i = *first; i < BLOCKSIZE; i++)
+                if(b[i] != (uint8)-1)
+                        break;
+        *first = i;
+        if(i == BLOCKSIZE)
+                return 0;
+        for(j = 0; j < 8; j++)
+                if(!(b[i] & (1 << j)))
+                        break;
+        return allocate(b, i * 8 + j + 1);
+}
+
 // allocate a block
 static uint32
 alloc_blk(filesystem *fs, uint32 nod)
@@ -809,9 +888,9 @@ alloc_blk(filesystem *fs, uint32 nod)
         grp = nod/fs->sb.s_inodes_per_group;
         nbgroups = ( fs->sb.s_blocks_count - fs->sb.s_first_data_block + fs->sb.s_blocks_per_group -1 ) /
                                         fs->sb.s_blocks_per_group;
-        if(!(bk = allocate(get_blk(fs,fs->gd[grp].bg_block_bitmap), 0))) {
+        if(!(bk = allocate_first(get_blk(fs,fs->gd[grp].bg_block_bitmap), &fsindex.bbm_first[grp]))) {
                 for(grp=0;grp<nbgroups && !bk;grp++)
-                        bk=allocate(get_blk(fs,fs->gd[grp].bg_block_bitmap),0);
+                        bk=allocate_first(get_blk(fs,fs->gd[grp].bg_block_bitmap),&fsindex.bbm_first[grp]);
                 grp--;
         }
         if (!bk)
@@ -832,6 +911,8 @@ free_blk(filesystem *fs, uint32 bk)
         grp = bk / fs->sb.s_blocks_per_group;
         bk %= fs->sb.s_blocks_per_group;
         deallocate(get_blk(fs,fs->gd[grp].bg_block_bitmap), bk);
+        if(bk && (bk - 1) / 8 < fsindex.bbm_first[grp])
+                fsindex.bbm_first[grp] = (bk - 1) / 8;
         fs->gd[grp].bg_free_blocks_count++;
         fs->sb.s_free_blocks_count++;
 }
@@ -859,7 +940,7 @@ alloc_nod(filesystem *fs)
                         fs->gd[grp].bg_free_blocks_count > fs->gd[best_group].bg_free_blocks_count)
                         best_group = grp;
         }
-        if (!(nod = allocate(get_blk(fs,fs->gd[best_group].bg_inode_bitmap),0)))
+        if (!(nod = allocate_first(get_blk(fs,fs->gd[best_group].bg_inode_bitmap),&fsindex.ibm_first[best_group])))
                 error_msg_and_die("couldn't allocate an inode (no free inode)");
         if(!(fs->gd[best_group].bg_free_inodes_count--))
                 error_msg_and_die("group descr. free blocks count == 0 (corrupted fs?)");
@@ -1131,6 +1212,32 @@ walk_bw(filesystem *fs, uint32 nod, blockwalker *bw, int32 *create, uint32 hole)
         return *bkref;
 }
 
+// add blocks to an inode, bw being at its end; returns the last one
+static uint32
+append_blk(filesystem *fs, uint32 nod, blockwalker *bw, block b, int amount)
+{
+        int create = amount;
+        uint32 bk = WALK_END;
+        while(create)
+        {
+                int i, copyb = 0;
+                if(!(fs->sb.s_reserved[200] & OP_HOLES))
+                        copyb = 1;
+                else
+                        for(i = 0; i < BLOCKSIZE / 4; i++)
+                                if(((int32*)(b + BLOCKSIZE * (amount - create)))[i])
+                                {
+                                        copyb = 1;
+                                        break;
+                                }
+                if((bk = walk_bw(fs, nod, bw, &create, !copyb)) == WALK_END)
+                        break;
+                if(copyb)
+                        memcpy(get_blk(fs, bk), b + BLOCKSIZE * (amount - create - 1), BLOCKSIZE);
+        }
+        return bk;
+}
+
 // add blocks to an inode (file/dir/etc...)
 static void
 extend_blk(filesystem *fs, uint32 nod, block b, int amount)
@@ -1152,32 +1259,189 @@ extend_blk(filesystem *fs, uint32 nod, block b, int amount)
         lbw = bw;
         while((bk = walk_bw(fs, nod, &bw, 0, 0)) != WALK_END)
                 lbw = bw;
-        bw = lbw;
-        while(create)
+        append_blk(fs, nod, &lbw, b, amount);
+}
+
+// set up the indexes for a new or loaded filesystem
+static void
+init_index(filesystem *fs)
+{
+        // alloc_blk() may look one group past the last
+        fsindex.ngroups = fs->sb.s_inodes_count / fs->sb.s_inodes_per_group + 1;
+        if(fsindex.ngroups < GRP_NBGROUPS(fs) + 1)
+                fsindex.ngroups = GRP_NBGROUPS(fs) + 1;
+        fsindex.bbm_first = xcalloc(fsindex.ngroups, sizeof(uint32));
+        fsindex.ibm_first = xcalloc(fsindex.ngroups, sizeof(uint32));
+        fsindex.ninodes = fs->sb.s_inodes_count;
+        fsindex.dirs = xcalloc(fsindex.ninodes + 1, sizeof(struct dirindex_s *));
+        fsindex.hash_mask = DIRHASH_SIZE - 1;
+        fsindex.hash_count = 0;
+        fsindex.hash = xcalloc(DIRHASH_SIZE, sizeof(struct dirhash_s *));
+}
+
+// forget the index of a directory, to be rebuilt from its blocks
+static void
+drop_dirindex(uint32 dnod)
+{
+        struct dirindex_s *di = fsindex.dirs[dnod];
+        if(di)
         {
-                int i, copyb = 0;
-                if(!(fs->sb.s_reserved[200] & OP_HOLES))
-                        copyb = 1;
+                free(di->blk);
+                free(di->room);
+                free(di);
+                fsindex.dirs[dnod] = 0;
+        }
+}
+
+static void
+free_index(void)
+{
+        struct dirhash_s *e;
+        uint32 i;
+        for(i = 0; i <= fsindex.ninodes; i++)
+                drop_dirindex(i);
+        for(i = 0; i <= fsindex.hash_mask; i++)
+                while((e = fsindex.hash[i]))
+                {
+                        fsindex.hash[i] = e->next;
+                        free(e);
+                }
+        free(fsindex.hash);
+        free(fsindex.dirs);
+        free(fsindex.ibm_first);
+        free(fsindex.bbm_first);
+        memset(&fsindex, 0, sizeof(fsindex));
+}
+
+static uint32
+dirhash(uint32 dnod, const char *name, int nlen)
+{
+        uint32 h = dnod * 0x9E3779B1;
+        while(nlen--)
+                h = (h ^ (uint8)*name++) * 0x01000193;
+        return h;
+}
+
+static struct dirhash_s *
+dirhash_find(uint32 dnod, const char *name, int nlen)
+{
+        struct dirhash_s *e;
+        for(e = fsindex.hash[dirhash(dnod, name, nlen) & fsindex.hash_mask]; e; e = e->next)
+                if(e->dnod == dnod && e->nlen == nlen && !memcmp(e->name, name, nlen))
+                        return e;
+        return 0;
+}
+
+// hash an entry name; for a name that is there twice the first one
+// found when walking the blocks wins, as it did with the plain search
+static void
+dirhash_add(uint32 dnod, uint32 nod, const char *name, int nlen)
+{
+        struct dirhash_s *e, **h;
+        uint32 i, size;
+        if(dirhash_find(dnod, name, nlen))
+                return;
+        if(fsindex.hash_count > fsindex.hash_mask)
+        {
+                size = (fsindex.hash_mask + 1) * 2;
+                h = xcalloc(size, sizeof(*h));
+                for(i = 0; i <= fsindex.hash_mask; i++)
+                        while((e = fsindex.hash[i]))
+                        {
+                                fsindex.hash[i] = e->next;
+                                e->next = h[dirhash(e->dnod, e->name, e->nlen) & (size - 1)];
+                                h[dirhash(e->dnod, e->name, e->nlen) & (size - 1)] = e;
+                        }
+                free(fsindex.hash);
+                fsindex.hash = h;
+                fsindex.hash_mask = size - 1;
+        }
+        e = xrealloc(0, sizeof(*e) + nlen);
+        e->dnod = dnod;
+        e->nod = nod;
+        e->nlen = nlen;
+        memcpy(e->name, name, nlen);
+        h = &fsindex.hash[dirhash(dnod, name, nlen) & fsindex.hash_mask];
+        e->next = *h;
+        *h = e;
+        fsindex.hash_count++;
+}
+
+// the longest entry add2dir() can still put in a directory block
+static uint32
+dir_room(uint8 *b)
+{
+        directory *d;
+        int r, room = 0;
+        for(d = (directory*)b; (int8*)d + sizeof(*d) < (int8*)b + BLOCKSIZE; d = (directory*)((int8*)d + d->d_rec_len))
+        {
+                if(!d->d_inode)
+                        r = d->d_rec_len;
                 else
-                        for(i = 0; i < BLOCKSIZE / 4; i++)
-                                if(((int32*)(b + BLOCKSIZE * (amount - create)))[i])
-                                {
-                                        copyb = 1;
-                                        break;
-                                }
-                if((bk = walk_bw(fs, nod, &bw, &create, !copyb)) == WALK_END)
-                        break;
-                if(copyb)
-                        memcpy(get_blk(fs, bk), b + BLOCKSIZE * (amount - create - 1), BLOCKSIZE);
+                        r = d->d_rec_len - (int)(sizeof(directory) + rndup(d->d_name_len, 4));
+                if(r > room)
+                        room = r;
         }
+        return room;
+}
+
+static void
+dirindex_addblk(struct dirindex_s *di, uint32 bk, uint32 room)
+{
+        if(di->nblocks == di->maxblocks)
+        {
+                di->maxblocks = di->maxblocks ? di->maxblocks * 2 : 4;
+                di->blk = xrealloc(di->blk, di->maxblocks * sizeof(uint32));
+                di->room = xrealloc(di->room, di->maxblocks * sizeof(uint16));
+        }
+        di->blk[di->nblocks] = bk;
+        di->room[di->nblocks++] = room;
+}
+
+// the index of a directory, read from its blocks the first time
+static struct dirindex_s *
+get_dirindex(filesystem *fs, uint32 dnod)
+{
+        struct dirindex_s *di;
+        directory *d;
+        uint8 *b;
+        uint32 bk;
+        if((di = fsindex.dirs[dnod]))
+                return di;
+        di = xcalloc(1, sizeof(*di));
+        init_bw(fs, dnod, &di->end);
+        while((bk = walk_bw(fs, dnod, &di->end, 0, 0)) != WALK_END)
+        {
+                b = get_blk(fs, bk);
+                dirindex_addblk(di, bk, dir_room(b));
+                for(d = (directory*)b; (int8*)d + sizeof(*d) < (int8*)b + BLOCKSIZE; d = (directory*)((int8*)d + d->d_rec_len))
+                        if(d->d_inode)
+                                dirhash_add(dnod, d->d_inode, d->d_name, d->d_name_len);
+        }
+        fsindex.dirs[dnod] = di;
+        return di;
+}
+
+// the first block of a directory with room for a reclen bytes entry;
+// blocks only ever fill up, so what was too full once stays so
+static uint32
+dirindex_fit(struct dirindex_s *di, int reclen)
+{
+        uint32 i, c = reclen / 4;
+        i = c < DIR_CLASSES ? di->first[c] : 0;
+        while(i < di->nblocks && di->room[i] < reclen)
+                i++;
+        if(c < DIR_CLASSES)
+                di->first[c] = i;
+        return i;
 }
 
 // link an entry (inode #) to a directory
 static void
 add2dir(filesystem *fs, uint32 dnod, uint32 nod, const char* name)
 {
-        blockwalker bw;
-        uint32 bk;
+        struct dirindex_s *di;
+        uint32 i, bk;
         uint8 *b;
         directory *d;
         int reclen, nlen;
@@ -1195,10 +1459,10 @@ add2dir(filesystem *fs, uint32 dnod, uint32 nod, const char* name)
         reclen = sizeof(directory) + rndup(nlen, 4);
         if(reclen > BLOCKSIZE)
                 error_msg_and_die("bad name '%s' (too long)", name);
-        init_bw(fs, dnod, &bw);
-        while((bk = walk_bw(fs, dnod, &bw, 0, 0)) != WALK_END) // for all blocks in dir
+        di = get_dirindex(fs, dnod);
+        if((i = dirindex_fit(di, reclen)) < di->nblocks) // first block with room
         {
-                b = get_blk(fs, bk);
+                b = get_blk(fs, di->blk[i]);
                 // for all dir entries in block
                 for(d = (directory*)b; (int8*)d + sizeof(*d) < (int8*)b + BLOCKSIZE; d = (directory*)((int8*)d + d->d_rec_len))
                 {
@@ -1216,6 +1480,8 @@ add2dir(filesystem *fs, uint32 dnod, uint32 nod, const char* name)
                                 } 
                                 d->d_file_type = dir_file_type;
                                 strncpy(d->d_name, name, nlen);
+                                di->room[i] = dir_room(b);
+                                dirhash_add(dnod, nod, name, nlen);
                                 return;
                         }
                         // if entry with enough room (last one?), shrink it & use it
@@ -1238,6 +1504,8 @@ add2dir(filesystem *fs, uint32 dnod, uint32 nod, const char* name)
                                 d->d_file_type = dir_file_type;
                                 d->d_name_len = nlen;
                                 strncpy(d->d_name, name, nlen);
+                                di->room[i] = dir_room(b);
+                                dirhash_add(dnod, nod, name, nlen);
                                 return;
                         }
                 }
@@ -1257,7 +1525,9 @@ add2dir(filesystem *fs, uint32 dnod, uint32 nod, const char* name)
         } 
         d->d_file_type = dir_file_type;
         strncpy(d->d_name, name, nlen);
-        extend_blk(fs, dnod, b, 1);
+        bk = append_blk(fs, dnod, &di->end, b, 1);
+        dirindex_addblk(di, bk, dir_room(get_blk(fs, bk)));
+        dirhash_add(dnod, nod, name, nlen);
         get_nod(fs, dnod)->i_size += BLOCKSIZE;
         free_workblk(b);
 }
@@ -1266,20 +1536,12 @@ add2dir(filesystem *fs, uint32 dnod, uint32 nod, const char* name)
 static uint32
 find_dir(filesystem *fs, uint32 nod, const char * name)
 {
-        blockwalker bw;
-        uint32 bk;
-        int nlen = strlen(name);
-        init_bw(fs, nod, &bw);
-        while((bk = walk_bw(fs, nod, &bw, 0, 0)) != WALK_END)
-        {
-                directory *d;
-                uint8 *b;
-                b = get_blk(fs, bk);
-                for(d = (directory*)b; (int8*)d + sizeof(*d) < (int8*)b + BLOCKSIZE; d = (directory*)((int8*)d + d->d_rec_len))
-                        if(d->d_inode && (nlen == d->d_name_len) && !strncmp(d->d_name, name, nlen))
-                                return d->d_inode;
-        }
-        return 0;
+        struct dirhash_s *e;
+        if((get_nod(fs, nod)->i_mode & FM_IFMT) != FM_IFDIR)
+                return 0;
+        get_dirindex(fs, nod);
+        e = dirhash_find(nod, name, strlen(name));
+        return e ? e->nod : 0;
 }
 
 // find the inode of a full path
@@ -1378,26 +1640,53 @@ mklink_fs(filesystem *fs, uint32 parent_nod, const char *name, size_t size, uint
 
 // make a file from a FILE*
 static uint32
-mkfile_fs(filesystem *fs, uint32 parent_nod, const char *name, uint32 mode, size_t size, FILE *f, uid_t uid, gid_t gid, uint32 ctime, uint32 mtime)
+mkfile_fs(filesystem *fs, uint32 parent_nod, const char *name, uint32 mode, size_t size, int fd, uid_t uid, gid_t gid, uint32 ctime, uint32 mtime)
 {
-        uint8 * b;
+        static uint8 * b;
+        size_t n, got;
+        int r;
+        blockwalker bw;
         uint32 nod = mknod_fs(fs, parent_nod, name, mode|FM_IFREG, uid, gid, 0, 0, ctime, mtime);
         extend_blk(fs, nod, 0, - (int)get_nod(fs, nod)->i_blocks / INOBLK);
         get_nod(fs, nod)->i_size = size;
         if (size) {
-                if(!(b = (uint8*)malloc(rndup(size, BLOCKSIZE))))
+                // the file is copied in pieces with read(), big files
+                // needn't fit in memory twice nor go through stdio
+                if(!b && !(b = (uint8*)malloc(FILE_CHUNK * BLOCKSIZE)))
                         error_msg_and_die("not enough mem to read file '%s'", name);
-                memset(b, 0,rndup(size, BLOCKSIZE));
-                if(f)
-                        fread(b, size, 1, f); // FIXME: ugly. use mmap() ...
-                else
-                        memset(b, 0, size); // .. or handle b = 0
-                extend_blk(fs, nod, b, rndup(size, BLOCKSIZE) / BLOCKSIZE);
-                free(b);
+                init_bw(fs, nod, &bw);
+                while (size) {
+                        n = size < FILE_CHUNK * BLOCKSIZE ? size : FILE_CHUNK * BLOCKSIZE;
+                        for(got = 0; fd >= 0 && got < n; got += r)
+                                if((r = read(fd, b + got, n - got)) <= 0)
+                                        break;
+                        // a file that shrank since stat() ends with zeros
+                        memset(b + got, 0, rndup(n, BLOCKSIZE) - got);
+                        append_blk(fs, nod, &bw, b, rndup(n, BLOCKSIZE) / BLOCKSIZE);
+                        size -= n;
+                }
         }
         return nod;
 }
 
+// have the system start reading a file that will be copied soon, so
+// the disk is busy while the entries before it are added
+static void
+prefetch_file(const char *name)
+{
+#ifdef POSIX_FADV_WILLNEED
+        struct stat st;
+        int fd;
+
+        if(lstat(name, &st) || !S_ISREG(st.st_mode) || !st.st_size)
+                return;
+        if((fd = open(name, O_RDONLY | O_NONBLOCK)) < 0)
+                return;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+#endif
+}
+
 // retrieves a mode info from a struct stat
 static uint32
 get_mode(struct stat *st)
@@ -1565,26 +1854,40 @@ add2fs_from_dir(filesystem *fs, uint32 this_nod, int squash_uids, int squash_per
         uint32 nod;
         uint32 uid, gid, mode, ctime, mtime;
         const char *name;
-        FILE *fh;
+        int fd;
         DIR *dh;
         struct dirent *dent;
         struct stat st;
         uint8 *b;
         uint32 save_nod;
+        char **names = NULL;
+        int nnames = 0, maxnames = 0, i, ahead = 0;
 
+        // the names are read first, so that the directory isn't held
+        // open while we recurse and we can look ahead to prefetch
         if(!(dh = opendir(".")))
                 perror_msg_and_die(".");
         while((dent = readdir(dh)))
         {
                 if((!strcmp(dent->d_name, ".")) || (!strcmp(dent->d_name, "..")))
                         continue;
-                printf("Adding %s\n",dent->d_name);
-                lstat(dent->d_name, &st);
+                if(nnames == maxnames)
+                        names = xrealloc(names, (maxnames += 64) * sizeof(char *));
+                names[nnames++] = xstrdup(dent->d_name);
+        }
+        closedir(dh);
+        for(i = 0; i < nnames; i++)
+        {
+                name = names[i];
+                if(!stats)
+                        for(; ahead < nnames && ahead <= i + PREFETCH; ahead++)
+                                prefetch_file(names[ahead]);
+                printf("Adding %s\n",name);
+                lstat(name, &st);
                 uid = st.st_uid;
                 gid = st.st_gid;
                 ctime = fs_timestamp;
                 mtime = st.st_mtime;
-                name = dent->d_name;
                 mode = get_mode(&st);
                 if(squash_uids)
                         uid = gid = 0;
@@ -1604,8 +1907,8 @@ add2fs_from_dir(filesystem *fs, uint32 this_nod, int squash_uids, int squash_per
                                         break;
                                 case S_IFDIR:
                                         stats->ninodes++;
-                                        if(chdir(dent->d_name) < 0)
-                                                perror_msg_and_die(dent->d_name);
+                                        if(chdir(name) < 0)
+                                                perror_msg_and_die(name);
                                         add2fs_from_dir(fs, nod, squash_uids, squash_perms, fs_timestamp, stats);
                                         chdir("..");
                                         break;
@@ -1640,23 +1943,20 @@ add2fs_from_dir(filesystem *fs, uint32 this_nod, int squash_uids, int squash_per
                                         break;
 #ifndef __CPM__
                                 case S_IFLNK:
-                                        b = xreadlink(dent->d_name);
+                                        b = xreadlink(name);
                                         mklink_fs(fs, this_nod, name, st.st_size, b, uid, gid, ctime, mtime);
                                         free(b);
                                         break;
 #endif
                                 case S_IFREG:
-#ifdef __CPM__
-                                        fh = xfopen(dent->d_name, "rb");
-#else
-                                        fh = xfopen(dent->d_name, "r");
-#endif
-                                        nod = mkfile_fs(fs, this_nod, name, mode, st.st_size, fh, uid, gid, ctime, mtime);
-                                        fclose(fh);
+                                        if((fd = open(name, O_RDONLY | O_BINARY)) < 0)
+                                                perror_msg_and_die("%s", name);
+                                        nod = mkfile_fs(fs, this_nod, name, mode, st.st_size, fd, uid, gid, ctime, mtime);
+                                        close(fd);
                                         break;
                                 case S_IFDIR:
                                         nod = mkdir_fs(fs, this_nod, name, mode, uid, gid, ctime, mtime);
-                                        if(chdir(dent->d_name) < 0)
+                                        if(chdir(name) < 0)
                                                 perror_msg_and_die(name);
                                         add2fs_from_dir(fs, nod, squash_uids, squash_perms, fs_timestamp, stats);
                                         chdir("..");
@@ -1667,19 +1967,23 @@ add2fs_from_dir(filesystem *fs, uint32 this_nod, int squash_uids, int squash_per
                         if (save_nod) {
                                 if (hdlinks.count == hdlink_cnt) {
                                         if ((hdlinks.hdl =
-                                                 realloc (hdlinks.hdl, (hdlink_cnt + HDLINK_CNT) *
+                                                 realloc (hdlinks.hdl, hdlink_cnt * 2 *
                                                                   sizeof (struct hdlink_s))) == NULL) {
                                                 error_msg_and_die("Not enough memory");
                                         }
-                                        hdlink_cnt += HDLINK_CNT;
+                                        hdlink_cnt *= 2;
                                 }
                                 hdlinks.hdl[hdlinks.count].src_inode = st.st_ino;
                                 hdlinks.hdl[hdlinks.count].dst_nod = nod;
+                                hdlinks.hdl[hdlinks.count].next = hdlinks.hash[(uint32)st.st_ino % HDLINK_HASH];
+                                hdlinks.hash[(uint32)st.st_ino % HDLINK_HASH] = hdlinks.count;
                                 hdlinks.count++;
                         }
                 }
         }
-        closedir(dh);
+        for(i = 0; i < nnames; i++)
+                free(names[i]);
+        free(names);
 }
 
 // endianness swap of x-indirect blocks
@@ -1930,6 +2234,7 @@ init_fs(int nbblocks, int nbinodes, int nbresrvd, int holes, uint32 fs_timestamp
                 fs->gd[i].bg_inode_bitmap = ibmpos;
                 fs->gd[i].bg_inode_table = itblpos;
         }
+        init_index(fs);
 
         /* Mark non-filesystem blocks and inodes as allocated */
         /* Mark system blocks and inodes as allocated         */
@@ -1997,6 +2302,7 @@ init_fs(int nbblocks, int nbinodes, int nbresrvd, int holes, uint32 fs_timestamp
                         fs->sb.s_r_blocks_count = fs->sb.s_blocks_count * MAX_RESERVED_BLOCKS;
                 for(i = 1; i < fs->sb.s_r_blocks_count; i++)
                         extend_blk(fs, nod, b, 1);
+                drop_dirindex(nod);
                 get_nod(fs, nod)->i_size = fs->sb.s_r_blocks_count * BLOCKSIZE;
         }
         free_workblk(b);
@@ -2032,12 +2338,14 @@ load_fs(FILE * fh, int swapit)
                 swap_badfs(fs);
         if(fs->sb.s_rev_level || (fs->sb.s_magic != EXT2_MAGIC_NUMBER))
                 error_msg_and_die("not a suitable ext2 filesystem");
+        init_index(fs);
         return fs;
 }
 
 static void
 free_fs(filesystem *fs)
 {
+        free_index();
         free(fs);
 }
 
@@ -2479,6 +2787,8 @@ main(int argc, char **argv)
         if (!hdlinks.hdl)
                 error_msg_and_die("Not enough memory");
         hdlinks.count = 0 ;
+        for(i = 0; i < HDLINK_HASH; i++)
+                hdlinks.hash[i] = -1;
 
         if(fsin)
         {
@@ -16,6 +16,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "hllfuncs.h"
 
@@ -23,6 +24,8 @@
 #include "hll.h"
 #pragma pack(pop)
 
+#include "hllindex.h"
+
 
 // -----
 
@@ -40,12 +43,26 @@ extern ULONG ulDirOffset;
 void * pvFile; /* pointer to buffer cointaing file */
 BYTE bDebugFormat; /* debug format */
 ULONG ulDebugOff;
+BOOL fDumpFiles=TRUE; /* write the *.dat dumps */
 
 void main(int argc, char *argv[])
 {
+ BOOL fResolve=FALSE;
+ FILE *pLog=stdin;
+
+ if ((argc>1) && (strcmp(argv[1],"-r")==0))
+ {
+   fResolve=TRUE;
+   fDumpFiles=FALSE;
+   argc--;
+   argv++;
+ };
+
  if (argc==1)
  {
-   printf("Usage: hlldump file");
+   printf("Usage: hlldump file\n"
+          "       hlldump -r file [traplog]\n"
+          "  -r  resolve object:offset addresses read from traplog (or stdin)\n");
    return;
  };
 
@@ -60,6 +77,21 @@ void main(int argc, char *argv[])
 
  /* these two are required for rest to work properly */
  ProcessDirectory();
+
+ if (fResolve)
+ {
+   if (!HllBuildIndex()) goto error;
+   if ((argc>2) && ((pLog=fopen(argv[2],"r"))==NULL))
+   {
+     printf("*** Error while opening: %s\n",argv[2]);
+     goto error;
+   };
+   printf("    - addresses resolved: %u\n",HllResolveLog(pLog,stdout));
+   if (pLog!=stdin) fclose(pLog);
+   HllFreeIndex();
+   goto ok;
+ };
+
  ProcessModules();
  /* all below can be commented out to turn off dumps generation */
    ProcessPublics();
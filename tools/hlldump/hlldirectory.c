@@ -16,6 +16,7 @@ extern BYTE bDebugFormat; /* debug format */
 extern ULONG ulDebugOff;
 extern ULONG ulModules;
 extern MODULE *pModules;
+extern BOOL fDumpFiles;
 /*extern ULONG ulDirOffset;
 extern ULONG ulDirEntries;*/
 
@@ -78,7 +79,7 @@ BOOL ProcessDirectory()
 
  pModules=(MODULE *)calloc(sizeof(MODULE),ulModules);
 
- dmp=fopen("directory.dat","a"); // !!
+ dmp=fDumpFiles ? fopen("directory.dat","a") : NULL; // !!
 
  /* for each entry in directory */
  for (i = 0; i < ulDirEntries; i++)
@@ -107,7 +108,7 @@ BOOL ProcessDirectory()
                               ? apsz[usSubSect - HLL_DE_MODULES]
                               : "unknown";
 
-  fprintf(dmp,"\n\ndirectory entry: 0x%08x (%u)\n",i+1,i+1);
+  if (dmp) fprintf(dmp,"\n\ndirectory entry: 0x%08x (%u)\n",i+1,i+1);
 
   if (bDebugFormat!=DBGTYPE_32IBM)
   {
@@ -120,7 +121,7 @@ BOOL ProcessDirectory()
     memcpy(&tmpHllDirEntry,&(pHllDir->aEntries[i]),sizeof(HLLDIRENTRY));
   };
 
-        fprintf(dmp, "    usType   0x%08x (%d) %s\n"
+        if (dmp) fprintf(dmp, "    usType   0x%08x (%d) %s\n"
                        "    ModIndex 0x%08x (%d)\n"
                        "    offset   0x%08x (%d)\n"
                        "    length   0x%08x (%d)\n",
@@ -182,7 +183,7 @@ BOOL ProcessDirectory()
   }; // end: switch (usSubSect)
  }; // end: for (i = 0; i < ulDirEntries; i++)
 
- fclose(dmp);
+ if (dmp) fclose(dmp);
 
  /* dump created, and module table too, now fill it up with additional info */
  for (i = 0; i < ulDirEntries; i++)
@@ -0,0 +1,384 @@
+/*
+   Indexed HLL debug info lookups
+
+   The dump passes walk the records once and print them. For
+   symbolizing trap logs the same records are instead gathered once
+   into tables sorted by object:offset, so that each address costs a
+   binary search:
+
+     - publics, the nearest one at or below an address
+     - line numbers (HL03 and 109_32, like the dump)
+     - type records, by module and type index
+
+   Needs HllLoadFile(), ProcessLx() and ProcessDirectory() first.
+*/
+
+#include <os2.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "hllfuncs.h"
+
+#pragma pack(push, 1)
+#include "hll.h"
+#include "$$TYPES.H"
+#pragma pack(pop)
+
+#include "hllindex.h"
+
+extern void *pvFile;
+extern ULONG ulDebugOff;
+extern ULONG ulModules;
+extern MODULE *pModules;
+
+typedef struct _PUBENTRY
+{
+ USHORT          usObject;
+ ULONG           ulOffset;
+ ULONG           ulModule;
+ PHLLPUBLICSYM32 pPub;
+} PUBENTRY;
+
+typedef struct _LINEENTRY
+{
+ USHORT usObject;
+ ULONG  ulOffset;
+ ULONG  ulModule;
+ ULONG  ulLine;
+ UCHAR *pchName;        /* length prefixed file name */
+} LINEENTRY;
+
+typedef struct _TYPETABLE
+{
+ ULONG  cTypes;
+ PBYTE *apType;         /* records in order, type index 512 first */
+} TYPETABLE;
+
+#define FIRST_TYPE_INDEX 512    /* lower indexes are primitive types */
+
+static PUBENTRY  *pPubs;
+static ULONG      cPubs, cPubsMax;
+static LINEENTRY *pLines;
+static ULONG      cLines, cLinesMax;
+static TYPETABLE *pTypes;
+
+static int CompareAddr(USHORT usObj1, ULONG ulOff1, USHORT usObj2, ULONG ulOff2)
+{
+  if (usObj1!=usObj2) return usObj1<usObj2 ? -1 : 1;
+  if (ulOff1!=ulOff2) return ulOff1<ulOff2 ? -1 : 1;
+  return 0;
+};
+
+static int ComparePubs(const void *p1, const void *p2)
+{
+  const PUBENTRY *pPub1=p1, *pPub2=p2;
+  return CompareAddr(pPub1->usObject,pPub1->ulOffset,pPub2->usObject,pPub2->ulOffset);
+};
+
+static int CompareLines(const void *p1, const void *p2)
+{
+  const LINEENTRY *pLine1=p1, *pLine2=p2;
+  int rc=CompareAddr(pLine1->usObject,pLine1->ulOffset,pLine2->usObject,pLine2->ulOffset);
+  /* keep equal addresses in table order, qsort() is not stable */
+  if (rc==0) rc=pLine1<pLine2 ? -1 : pLine1>pLine2;
+  return rc;
+};
+
+static void *Grow(void *p, ULONG *pcMax, ULONG cb)
+{
+  *pcMax=*pcMax ? *pcMax*2 : 256;
+  p=realloc(p,*pcMax*cb);
+  if (p==NULL)
+  {
+    printf("*** Error: out of memory building index\n");
+    exit(1);
+  };
+  return p;
+};
+
+static void AddLine(USHORT usObject, ULONG ulOffset, ULONG ulModule,
+                    ULONG ulLine, UCHAR *pchName)
+{
+  if (cLines==cLinesMax)
+    pLines=Grow(pLines,&cLinesMax,sizeof(LINEENTRY));
+  pLines[cLines].usObject=usObject;
+  pLines[cLines].ulOffset=ulOffset;
+  pLines[cLines].ulModule=ulModule;
+  pLines[cLines].ulLine=ulLine;
+  pLines[cLines].pchName=pchName;
+  cLines++;
+};
+
+static void IndexPublics(ULONG i)
+{
+  PBYTE pbStart=(PBYTE)pvFile+ulDebugOff+pModules[i].Publics;
+  PHLLPUBLICSYM32 pPubSym=(PHLLPUBLICSYM32)pbStart;
+
+  while ((PBYTE)pPubSym-pbStart<pModules[i].PubLen)
+  {
+    if (cPubs==cPubsMax)
+      pPubs=Grow(pPubs,&cPubsMax,sizeof(PUBENTRY));
+    pPubs[cPubs].usObject=pPubSym->usObject;
+    pPubs[cPubs].ulOffset=pPubSym->ulOffset;
+    pPubs[cPubs].ulModule=i+1;
+    pPubs[cPubs].pPub=pPubSym;
+    cPubs++;
+    pPubSym=(PHLLPUBLICSYM32)&pPubSym->achName[pPubSym->cchNameLen];
+  };
+};
+
+/* same layout as ProcessHL03Lines(); the offsets count from the
+   module's first segment contribution */
+static void IndexHL03Lines(ULONG i)
+{
+  UCHAR *pLineNumberTable=(UCHAR*)pvFile+ulDebugOff+pModules[i].LineNums;
+  PHLL04MODULE pHllModule=(PHLL04MODULE)((PBYTE)pvFile+ulDebugOff+pModules[i].FileName);
+  PHL03FIRSTENTRY pFirstEntry=(PHL03FIRSTENTRY)pLineNumberTable;
+  PLINE_NUMBER_TABLE_ENTRY_HL03 pLineEntry;
+  PFILE_NAME_TABLE_ENTRY_HL03 pFileEntry;
+  UCHAR **apchNames;
+  UCHAR *fileName;
+  ULONG ulBase=0;
+  ULONG j;
+
+  if (pModules[i].FileName!=0)
+    ulBase=pHllModule->SegInfo0.ulOffset;
+
+  pLineEntry=(PLINE_NUMBER_TABLE_ENTRY_HL03)((UCHAR*)pFirstEntry+sizeof(HL03FIRSTENTRY));
+  pFileEntry=(PFILE_NAME_TABLE_ENTRY_HL03)((UCHAR*)pLineEntry+
+    pFirstEntry->NumEntries*sizeof(LINE_NUMBER_TABLE_ENTRY_HL03));
+
+  /* file names by index, 1 based */
+  apchNames=calloc(pFileEntry->NumberOfSourceFiles+1,sizeof(UCHAR *));
+  if (apchNames==NULL) return;
+  fileName=(UCHAR*)pFileEntry+sizeof(FILE_NAME_TABLE_ENTRY_HL03)-1;
+  for (j=0;j<pFileEntry->NumberOfSourceFiles;j++)
+  {
+    apchNames[j+1]=fileName;
+    fileName+=*fileName+1;
+  };
+
+  for (j=0;j<pFirstEntry->NumEntries;j++)
+  {
+    USHORT usFile=pLineEntry[j].SourceFileIndex;
+    AddLine(pFirstEntry->SegNum,ulBase+pLineEntry[j].Offset,i+1,
+            pLineEntry[j].LineNumber,
+            usFile<=pFileEntry->NumberOfSourceFiles ? apchNames[usFile] : NULL);
+  };
+
+  free(apchNames);
+};
+
+/* same layout as Process109_32Lines(): one file, object relative */
+static void Index109_32Lines(ULONG i)
+{
+  UCHAR *pLineNumberTable=(UCHAR*)pvFile+ulDebugOff+pModules[i].LineNums;
+  UCHAR *pchName=pLineNumberTable;
+  PFIRST_ENTRY_109_32 pFirstEntry;
+  PLINE_NUMBER_TABLE_ENTRY_109_32 pLineEntry;
+  ULONG j;
+
+  pFirstEntry=(PFIRST_ENTRY_109_32)(pLineNumberTable+*pchName+1);
+  pLineEntry=(PLINE_NUMBER_TABLE_ENTRY_109_32)((UCHAR*)pFirstEntry+sizeof(FIRST_ENTRY_109_32));
+
+  for (j=0;j<pFirstEntry->NumEntries;j++)
+    AddLine(pFirstEntry->SegNum,pLineEntry[j].Offset,i+1,
+            pLineEntry[j].LineNumber,pchName);
+};
+
+/* same walk as ProcessMsTypes() */
+static void IndexTypes(ULONG i)
+{
+  PBYTE pbStart=(PBYTE)pvFile+ulDebugOff+pModules[i].TypeDefs+1;
+  PBYTE pbEnd=pbStart+pModules[i].TypeLen;
+  PBYTE pb;
+  ULONG cTypes=0;
+
+  for (pb=pbStart;pb<pbEnd;pb+=((Trec*)pb)->RecLen+3)
+    cTypes++;
+
+  pTypes[i].apType=malloc(cTypes*sizeof(PBYTE));
+  if (pTypes[i].apType==NULL) return;
+  pTypes[i].cTypes=cTypes;
+
+  cTypes=0;
+  for (pb=pbStart;pb<pbEnd;pb+=((Trec*)pb)->RecLen+3)
+    pTypes[i].apType[cTypes++]=pb;
+};
+
+BOOL HllBuildIndex()
+{
+  ULONG i;
+
+  printf("+++ Building lookup tables\n");
+
+  HllFreeIndex();
+  pTypes=calloc(ulModules+1,sizeof(TYPETABLE));
+  if (pTypes==NULL)
+  {
+    printf("*** Error: out of memory building index\n");
+    return FALSE;
+  };
+
+  for (i=0;i<ulModules;i++)
+  {
+    if ((pModules[i].Publics!=0) && (pModules[i].PubLen!=0))
+      IndexPublics(i);
+
+    if ((pModules[i].LineNums!=0) && (pModules[i].LineNumsLen!=0))
+      switch(pModules[i].DbgFormatFlags.Lins)
+      {
+        case TYPE10B_HL03:
+          IndexHL03Lines(i);
+        break;
+        case TYPE109_32:
+          Index109_32Lines(i);
+        break;
+      };
+
+    if ((pModules[i].TypeDefs!=0) && (pModules[i].TypeLen!=0))
+      IndexTypes(i);
+  }; //end: for (i=0;i<ulModules;i++)
+
+  qsort(pPubs,cPubs,sizeof(PUBENTRY),ComparePubs);
+  qsort(pLines,cLines,sizeof(LINEENTRY),CompareLines);
+
+  printf("    - publics: %u, line numbers: %u\n",cPubs,cLines);
+  printf("--- Processed\n");
+  return TRUE;
+};
+
+void HllFreeIndex()
+{
+  ULONG i;
+
+  if (pTypes!=NULL)
+    for (i=0;i<ulModules;i++)
+      free(pTypes[i].apType);
+  free(pTypes);
+  free(pLines);
+  free(pPubs);
+  pTypes=NULL;
+  pLines=NULL;
+  pPubs=NULL;
+  cPubs=cPubsMax=cLines=cLinesMax=0;
+};
+
+/* the last public at or below the address in the same object */
+static PUBENTRY *FindPub(USHORT usObject, ULONG ulOffset)
+{
+  ULONG lo=0, hi=cPubs, mid;
+
+  while (lo<hi)
+  {
+    mid=(lo+hi)/2;
+    if (CompareAddr(pPubs[mid].usObject,pPubs[mid].ulOffset,usObject,ulOffset)<=0)
+      lo=mid+1;
+    else
+      hi=mid;
+  };
+  if (lo==0 || pPubs[lo-1].usObject!=usObject) return NULL;
+  return &pPubs[lo-1];
+};
+
+/* the last line at or below the address in the same object */
+static LINEENTRY *FindLine(USHORT usObject, ULONG ulOffset)
+{
+  ULONG lo=0, hi=cLines, mid;
+
+  while (lo<hi)
+  {
+    mid=(lo+hi)/2;
+    if (CompareAddr(pLines[mid].usObject,pLines[mid].ulOffset,usObject,ulOffset)<=0)
+      lo=mid+1;
+    else
+      hi=mid;
+  };
+  if (lo==0 || pLines[lo-1].usObject!=usObject) return NULL;
+  return &pLines[lo-1];
+};
+
+BOOL HllLookupAddr(USHORT usObject, ULONG ulOffset, PHLLADDRINFO pInfo)
+{
+  PUBENTRY *pPub=FindPub(usObject,ulOffset);
+  LINEENTRY *pLine=FindLine(usObject,ulOffset);
+
+  memset(pInfo,0,sizeof(*pInfo));
+  if (pPub!=NULL)
+  {
+    pInfo->ulModule=pPub->ulModule;
+    pInfo->pPub=pPub->pPub;
+    pInfo->ulPubDisp=ulOffset-pPub->ulOffset;
+  };
+  /* a line of another module than the public is stale: the address
+     is past the end of the code that line belongs to */
+  if (pLine!=NULL && (pPub==NULL || pLine->ulModule==pPub->ulModule))
+  {
+    pInfo->ulModule=pLine->ulModule;
+    pInfo->ulLine=pLine->ulLine;
+    if (pLine->pchName!=NULL)
+    {
+      pInfo->cchFile=*pLine->pchName;
+      pInfo->pchFile=pLine->pchName+1;
+    };
+  };
+  return pInfo->ulModule!=0;
+};
+
+PBYTE HllLookupType(ULONG ulModule, USHORT usTypeIndex)
+{
+  if (pTypes==NULL || ulModule==0 || ulModule>ulModules) return NULL;
+  if (usTypeIndex<FIRST_TYPE_INDEX) return NULL;
+  if (usTypeIndex-FIRST_TYPE_INDEX>=pTypes[ulModule-1].cTypes) return NULL;
+  return pTypes[ulModule-1].apType[usTypeIndex-FIRST_TYPE_INDEX];
+};
+
+/* is p at an address written as oooo:xxxxxxxx (object:offset in hex) */
+static BOOL ParseAddr(const char *p, USHORT *pusObject, ULONG *pulOffset)
+{
+  int i;
+
+  for (i=0;i<13;i++)
+    if (i==4 ? p[i]!=':' : !isxdigit((UCHAR)p[i])) return FALSE;
+  if (isxdigit((UCHAR)p[13])) return FALSE;
+  *pusObject=(USHORT)strtoul(p,NULL,16);
+  *pulOffset=strtoul(p+5,NULL,16);
+  return TRUE;
+};
+
+/* print every object:offset address found in a trap log with what it
+   resolves to; returns the number of addresses found */
+ULONG HllResolveLog(FILE *pLog, FILE *pOut)
+{
+  static char szLine[1024];
+  HLLADDRINFO info;
+  USHORT usObject;
+  ULONG ulOffset;
+  ULONG cAddrs=0;
+  char *p;
+
+  while (fgets(szLine,sizeof(szLine),pLog)!=NULL)
+    for (p=szLine;*p;p++)
+    {
+      if (p!=szLine && isxdigit((UCHAR)p[-1])) continue;
+      if (!ParseAddr(p,&usObject,&ulOffset)) continue;
+      cAddrs++;
+
+      fprintf(pOut,"%04x:%08x",usObject,ulOffset);
+      if (!HllLookupAddr(usObject,ulOffset,&info))
+      {
+        fprintf(pOut,"  ?\n");
+        continue;
+      };
+      if (info.pPub!=NULL)
+        fprintf(pOut,"  %.*s+%#x",info.pPub->cchNameLen,info.pPub->achName,info.ulPubDisp);
+      if (info.ulLine!=0)
+        fprintf(pOut,"  %.*s(%u)",info.cchFile,info.pchFile!=NULL ? (char *)info.pchFile : "",info.ulLine);
+      fprintf(pOut,"\n");
+      p+=12;
+    };
+
+  return cAddrs;
+};
@@ -0,0 +1,18 @@
+/* indexed lookups in loaded HLL debug info (hllindex.c) */
+
+/* what is known about an address */
+typedef struct _HLLADDRINFO
+{
+ ULONG           ulModule;   /* module number (1 based), 0 if not found */
+ PHLLPUBLICSYM32 pPub;       /* nearest public at or below, or NULL */
+ ULONG           ulPubDisp;  /* distance from that public */
+ ULONG           ulLine;     /* source line, 0 if not known */
+ UCHAR          *pchFile;    /* source file name, not terminated */
+ UCHAR           cchFile;
+} HLLADDRINFO, *PHLLADDRINFO;
+
+BOOL  HllBuildIndex();
+void  HllFreeIndex();
+BOOL  HllLookupAddr(USHORT usObject, ULONG ulOffset, PHLLADDRINFO pInfo);
+PBYTE HllLookupType(ULONG ulModule, USHORT usTypeIndex);
+ULONG HllResolveLog(FILE *pLog, FILE *pOut);
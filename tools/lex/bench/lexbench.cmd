@@ -0,0 +1,40 @@
+/* Generate lexbench.l once per table compression mode and time each
+ * scanner over the same input.
+ *
+ *   lexbench input [reps]
+ *
+ * LEX and CC in the environment name the scanner generator and the
+ * compiler (lex, wcl386).
+ */
+
+parse arg infile reps
+
+if infile = '' then do
+  say 'usage: lexbench input [reps]'
+  exit 1
+end
+if reps = '' then reps = 20
+
+lex = value('LEX',, 'OS2ENVIRONMENT')
+if lex = '' then lex = 'lex'
+cc = value('CC',, 'OS2ENVIRONMENT')
+if cc = '' then cc = 'wcl386'
+
+parse source . . me
+dir = filespec('drive', me) || filespec('path', me)
+
+say 'mode     bytes tokens seconds MB/s'
+
+modes = '-Cem -Ce -Cm -Cf -Cfe -Cfp -Cfep -CF -CFe'
+do i = 1 to words(modes)
+  mode = word(modes, i)
+  '@'lex mode '-olexbtmp.c' dir || 'lexbench.l'
+  if rc \= 0 then exit rc
+  '@'cc '-ox -q -fe=lexbtmp.exe lexbtmp.c >nul'
+  if rc \= 0 then exit rc
+  '@lexbtmp.exe -n' reps '-m' mode infile
+end
+
+'@del lexbtmp.c lexbtmp.obj lexbtmp.exe >nul 2>&1'
+
+exit 0
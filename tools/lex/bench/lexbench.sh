@@ -0,0 +1,30 @@
+#! /bin/sh
+#
+# Generate lexbench.l once per table compression mode and time each
+# scanner over the same input.
+#
+#   lexbench.sh input [reps]
+#
+# LEX and CC name the scanner generator and compiler (lex, cc).
+
+LEX=${LEX:-lex}
+CC=${CC:-cc}
+DIR=`dirname $0`
+IN=$1
+REPS=${2:-20}
+TMP=${TMPDIR:-/tmp}/lexbench.$$
+
+if [ -z "$IN" ]; then
+  echo "usage: lexbench.sh input [reps]" >&2
+  exit 1
+fi
+
+echo "mode     bytes tokens seconds MB/s"
+
+for mode in -Cem -Ce -Cm -Cf -Cfe -Cfp -Cfep -CF -CFe; do
+  $LEX $mode -o$TMP.c $DIR/lexbench.l || exit 1
+  $CC -O2 -o $TMP $TMP.c || exit 1
+  $TMP -n $REPS -m $mode $IN
+done
+
+rm -f $TMP $TMP.c
@@ -397,6 +397,7 @@ void ntod()
 	int *accset, ds, nacc, newds;
 	int sym, hashval, numstates, dsize;
 	int num_full_table_rows;	/* used only for -f */
+	int full_table_width;		/* ditto, rows padded for -Cp */
 	int *nset, *dset;
 	int targptr, totaltrans, i, comstate, comfreq, targ;
 	int symlist[CSIZE + 1];
@@ -529,17 +530,30 @@ void ntod()
 			 */
 			num_full_table_rows = numecs + 1;
 
+		/* With -Cp each row is padded to a power of two, so the
+		 * compiler indexes the table with a shift rather than a
+		 * multiply and no row straddles more cache lines than its
+		 * size needs.  The padding is never read.
+		 */
+		full_table_width = num_full_table_rows;
+
+		if ( padtbl )
+			for ( full_table_width = 1;
+			      full_table_width < num_full_table_rows;
+			      full_table_width <<= 1 )
+				;
+
 		/* Unless -Ca, declare it "short" because it's a real
 		 * long-shot that that won't be large enough.
 		 */
 		out_str_dec( "static yyconst %s yy_nxt[][%d] =\n    {\n",
 			/* '}' so vi doesn't get too confused */
-			long_align ? "long" : "short", num_full_table_rows );
+			long_align ? "long" : "short", full_table_width );
 
 		outn( "    {" );
 
 		/* Generate 0 entries for state #0. */
-		for ( i = 0; i < num_full_table_rows; ++i )
+		for ( i = 0; i < full_table_width; ++i )
 			mk2data( 0 );
 
 		dataflush();
@@ -722,6 +736,9 @@ void ntod()
 				 */
 				mk2data( state[i] ? state[i] : -ds );
 
+			for ( ; i < full_table_width; ++i )
+				mk2data( -ds );
+
 			dataflush();
 			outn( "    },\n" );
 			}
@@ -356,6 +356,8 @@ extern struct hash_entry *ccltab[CCL_HASH_SIZE];
  * do_yylineno - if true, generate code to maintain yylineno
  * useecs - if true (-Ce flag), use equivalence classes
  * fulltbl - if true (-Cf flag), don't compress the DFA state table
+ * padtbl - if true (-Cp flag), pad the rows of the -Cf table to a power of
+ *   two so a transition is found by shift and add
  * usemecs - if true (-Cm flag), use meta-equivalence classes
  * fullspd - if true (-F flag), use Jacobson method of table representation
  * gen_line_dirs - if true (i.e., no -L flag), generate #line directives
@@ -389,7 +391,7 @@ extern struct hash_entry *ccltab[CCL_HASH_SIZE];
 
 extern int printstats, syntaxerror, eofseen, ddebug, trace, nowarn, spprdflt;
 extern int interactive, caseins, lex_compat, do_yylineno;
-extern int useecs, fulltbl, usemecs, fullspd;
+extern int useecs, fulltbl, usemecs, fullspd, padtbl;
 extern int gen_line_dirs, performance_report, backing_up_report;
 extern int C_plus_plus, long_align, use_read, yytext_is_array, do_yywrap;
 extern int csize;
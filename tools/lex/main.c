@@ -57,7 +57,7 @@ extern void argv_fixup PROTO((int *, char ***));
 /* these globals are all defined and commented in flexdef.h */
 int printstats, syntaxerror, eofseen, ddebug, trace, nowarn, spprdflt;
 int interactive, caseins, lex_compat, do_yylineno, useecs, fulltbl, usemecs;
-int fullspd, gen_line_dirs, performance_report, backing_up_report;
+int fullspd, padtbl, gen_line_dirs, performance_report, backing_up_report;
 int C_plus_plus, long_align, use_read, yytext_is_array, do_yywrap, csize;
 int yymore_used, reject, real_reject, continued_action, in_rule;
 int yymore_really_used, reject_really_used;
@@ -237,6 +237,9 @@ void check_options()
 			flexerror( _( "-Cf and -CF are mutually exclusive" ) );
 		}
 
+	if ( padtbl && ! fulltbl )
+		flexerror( _( "-Cp requires -Cf" ) );
+
 	if ( C_plus_plus && fullspd )
 		flexerror( _( "Can't use -+ with -CF option" ) );
 
@@ -466,6 +469,8 @@ int exit_status;
 			putc( 'e', stderr );
 		if ( usemecs )
 			putc( 'm', stderr );
+		if ( padtbl )
+			putc( 'p', stderr );
 		if ( use_read )
 			putc( 'r', stderr );
 
@@ -592,6 +597,7 @@ char **argv;
 	printstats = syntaxerror = trace = spprdflt = caseins = false;
 	lex_compat = C_plus_plus = backing_up_report = ddebug = fulltbl = false;
 	fullspd = long_align = nowarn = yymore_used = continued_action = false;
+	padtbl = false;
 	do_yylineno = yytext_is_array = in_rule = reject = do_stdinit = false;
 	yymore_really_used = reject_really_used = unspecified;
 	interactive = csize = unspecified;
@@ -701,6 +707,10 @@ char **argv;
 								usemecs = true;
 								break;
 
+							case 'p':
+								padtbl = true;
+								break;
+
 							case 'r':
 								use_read = true;
 								break;
@@ -1177,6 +1187,8 @@ _( "\t\t-Cf  do not compress scanner tables; use -f representation\n" ) );
 _( "\t\t-CF  do not compress scanner tables; use -F representation\n" ) );
 	fprintf( f, _( "\t\t-Cm  construct meta-equivalence classes\n" ) );
 	fprintf( f,
+	_( "\t\t-Cp  pad -Cf table rows to a power of two\n" ) );
+	fprintf( f,
 	_( "\t\t-Cr  use read() instead of stdio for scanner input\n" ) );
 	fprintf( f, _( "\t-o  specify output filename\n" ) );
 	fprintf( f, _( "\t-P  specify scanner prefix other than \"yy\"\n" ) );
@@ -0,0 +1,593 @@
+/*
+ * LXPAR - parallel lxlite driver
+ * (c) osFree project
+ *
+ * Packs a set of LX executables by running several lxlite processes
+ * at once, one file per process.  Packed results are kept in a cache
+ * directory keyed by a hash of the unpacked file and the lxlite
+ * options, so rebuilding a distribution in which most modules did not
+ * change copies the packed files from the cache instead of packing
+ * them again.
+ *
+ * With -x every file is packed twice, once with each of the two
+ * EXEPACK:2 variants (LXPAR_VARIANT1 and LXPAR_VARIANT2 below), and the
+ * smaller result is kept.
+ *
+ * Usage: lxpar [-j jobs] [-c cachedir] [-l lxlite] [-o "options"] [-x]
+ *              file|pattern ...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#ifdef __UNIX__
+#include <unistd.h>
+#include <sys/wait.h>
+#define PATHSEP   '/'
+#else
+#include <process.h>
+#include <io.h>
+#define PATHSEP   '\\'
+#endif
+
+#define VERSION         "v1.0.0"
+
+#define RC_OK           0
+#define RC_PARAM_ERROR  1
+#define RC_FILE_ERROR   2
+#define RC_PACK_ERROR   3
+
+#define MAXJOBS         32
+#define MAXPATH         1024
+#define MAXARGS         64
+
+/* the two EXEPACK:2 variants tried with -x */
+#define LXPAR_VARIANT1  "/ML1"
+#define LXPAR_VARIANT2  "/ML2"
+
+typedef unsigned long long hash_t;
+
+/*
+ * One file being packed.  With -x a file runs as two processes, each
+ * on its own temporary copy; the file is finished when both are done.
+ */
+typedef struct
+{
+  char   szFile[MAXPATH];
+  char   aszTemp[2][MAXPATH];
+  hash_t hash;
+  int    cRunning;
+  int    fFailed;
+} JOB;
+
+/* one running lxlite process */
+typedef struct
+{
+  long   pid;
+  JOB   *pJob;
+  int    iVariant;
+} PROC;
+
+static const char *G_pcszLxlite  = "lxlite";
+static const char *G_pcszOptions = "";
+static const char *G_pcszCache   = NULL;
+static int         G_cJobs       = 2;
+static int         G_fExhaustive = 0;
+
+static PROC        G_aProcs[MAXJOBS];
+static int         G_cProcs      = 0;
+
+static int         G_cPacked     = 0,
+                   G_cCached     = 0,
+                   G_cFailed     = 0;
+
+static int ShowUsage(void)
+{
+  printf("Usage: lxpar [-j jobs] [-c cachedir] [-l lxlite] [-o \"options\"] [-x] file|pattern ...\n");
+  printf(" -j  number of lxlite processes to run at once (default 2, max %d)\n", MAXJOBS);
+  printf(" -c  directory for the packed file cache (default: no cache)\n");
+  printf(" -l  lxlite executable (default: lxlite from PATH)\n");
+  printf(" -o  options passed to lxlite for every file\n");
+  printf(" -x  pack with both %s and %s and keep the smaller file\n",
+         LXPAR_VARIANT1, LXPAR_VARIANT2);
+  return RC_PARAM_ERROR;
+}
+
+/*
+ * 64-bit FNV-1a, continued from h.
+ */
+static hash_t HashBytes(hash_t h, const unsigned char *p, size_t cb)
+{
+  while (cb--)
+  {
+    h ^= *p++;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+/*
+ * Hashes the file contents together with everything that changes the
+ * packed output: the lxlite options and the -x mode.
+ */
+static int HashFile(const char *pcszFile, hash_t *phash)
+{
+  static unsigned char ab[65536];
+  FILE   *f;
+  size_t cb;
+  hash_t h = 0xcbf29ce484222325ULL;
+
+  if (!(f = fopen(pcszFile, "rb")))
+    return RC_FILE_ERROR;
+
+  while ((cb = fread(ab, 1, sizeof(ab), f)) != 0)
+    h = HashBytes(h, ab, cb);
+
+  if (ferror(f))
+  {
+    fclose(f);
+    return RC_FILE_ERROR;
+  }
+  fclose(f);
+
+  h = HashBytes(h, (const unsigned char *)G_pcszOptions, strlen(G_pcszOptions) + 1);
+  h = HashBytes(h, (const unsigned char *)(G_fExhaustive ? "x" : "-"), 1);
+
+  *phash = h;
+  return RC_OK;
+}
+
+static void CachePath(char *pszBuf, hash_t h)
+{
+  sprintf(pszBuf, "%s%c%08lx%08lx.lx", G_pcszCache, PATHSEP,
+          (unsigned long)(h >> 32), (unsigned long)(h & 0xFFFFFFFFUL));
+}
+
+static long FileSize(const char *pcszFile)
+{
+  struct stat st;
+
+  if (stat(pcszFile, &st))
+    return -1;
+  return (long)st.st_size;
+}
+
+/*
+ * Copies pcszFrom to pcszTo through a temporary name next to pcszTo,
+ * so that an interrupted copy never leaves a truncated file behind.
+ */
+static int CopyFile(const char *pcszFrom, const char *pcszTo)
+{
+  static unsigned char ab[65536];
+  char   szTemp[MAXPATH];
+  FILE   *fIn, *fOut;
+  size_t cb;
+  int    rc = RC_OK;
+
+  sprintf(szTemp, "%s.lpc", pcszTo);
+
+  if (!(fIn = fopen(pcszFrom, "rb")))
+    return RC_FILE_ERROR;
+  if (!(fOut = fopen(szTemp, "wb")))
+  {
+    fclose(fIn);
+    return RC_FILE_ERROR;
+  }
+
+  while ((cb = fread(ab, 1, sizeof(ab), fIn)) != 0)
+    if (fwrite(ab, 1, cb, fOut) != cb)
+    {
+      rc = RC_FILE_ERROR;
+      break;
+    }
+
+  if (ferror(fIn))
+    rc = RC_FILE_ERROR;
+  fclose(fIn);
+  if (fclose(fOut))
+    rc = RC_FILE_ERROR;
+
+  if (rc == RC_OK)
+  {
+    remove(pcszTo);
+    if (rename(szTemp, pcszTo))
+      rc = RC_FILE_ERROR;
+  }
+  if (rc != RC_OK)
+    remove(szTemp);
+
+  return rc;
+}
+
+/*
+ * Splits the option string into argv[] after the lxlite name and the
+ * file name.  Quoting is not supported; lxlite options never need it.
+ */
+static void BuildArgs(char *pszBuf, char **papsz, const char *pcszFile, const char *pcszVariant)
+{
+  int  c = 0;
+  char *p;
+
+  papsz[c++] = (char *)G_pcszLxlite;
+
+  strcpy(pszBuf, G_pcszOptions);
+  for (p = strtok(pszBuf, " \t"); p && c < MAXARGS - 3; p = strtok(NULL, " \t"))
+    papsz[c++] = p;
+
+  if (pcszVariant)
+    papsz[c++] = (char *)pcszVariant;
+
+  papsz[c++] = (char *)pcszFile;
+  papsz[c] = NULL;
+}
+
+static long StartLxlite(const char *pcszFile, const char *pcszVariant)
+{
+  static char szArgs[MAXPATH];
+  char        *apsz[MAXARGS];
+  long        pid;
+
+  BuildArgs(szArgs, apsz, pcszFile, pcszVariant);
+
+#ifdef __UNIX__
+  fflush(stdout);
+  if ((pid = fork()) == 0)
+  {
+    execvp(apsz[0], apsz);
+    _exit(127);
+  }
+#else
+  pid = spawnvp(P_NOWAIT, apsz[0], (const char * const *)apsz);
+#endif
+
+  return pid;
+}
+
+/*
+ * Waits for one running process to end.  On Unix this takes whichever
+ * process ends first; elsewhere the oldest one is waited for, which
+ * still keeps all the others running meanwhile.
+ */
+static PROC *WaitLxlite(int *prc)
+{
+  int  status = 0,
+       i;
+  long pid;
+
+#ifdef __UNIX__
+  do
+    pid = waitpid(-1, &status, 0);
+  while (pid == -1 && errno == EINTR);
+  *prc = (WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+#else
+  pid = cwait(&status, G_aProcs[0].pid, WAIT_CHILD);
+  *prc = (status >> 8) & 0xFF;
+#endif
+
+  for (i = 0; i < G_cProcs; i++)
+    if (G_aProcs[i].pid == pid)
+    {
+      static PROC Proc;
+      Proc = G_aProcs[i];
+      memmove(&G_aProcs[i], &G_aProcs[i + 1], (G_cProcs - i - 1) * sizeof(PROC));
+      G_cProcs--;
+      return &Proc;
+    }
+
+  *prc = -1;
+  return NULL;
+}
+
+/*
+ * Called when all processes of a job have ended: picks the smaller
+ * variant, replaces the original and stores the result in the cache.
+ */
+static void FinishJob(JOB *pJob)
+{
+  int  iBest = 0;
+  char szCache[MAXPATH];
+
+  if (pJob->fFailed)
+  {
+    fprintf(stderr, "lxpar: packing %s failed\n", pJob->szFile);
+    G_cFailed++;
+  }
+  else
+  {
+    if (G_fExhaustive)
+    {
+      if (FileSize(pJob->aszTemp[1]) < FileSize(pJob->aszTemp[0]))
+        iBest = 1;
+      remove(pJob->szFile);
+      if (rename(pJob->aszTemp[iBest], pJob->szFile))
+      {
+        fprintf(stderr, "lxpar: cannot replace %s\n", pJob->szFile);
+        G_cFailed++;
+      }
+      else
+        pJob->aszTemp[iBest][0] = '\0';
+    }
+
+    if (G_pcszCache)
+    {
+      CachePath(szCache, pJob->hash);
+      if (CopyFile(pJob->szFile, szCache) != RC_OK)
+        fprintf(stderr, "lxpar: cannot write cache file %s\n", szCache);
+    }
+
+    G_cPacked++;
+  }
+
+  if (G_fExhaustive)
+  {
+    if (pJob->aszTemp[0][0])
+      remove(pJob->aszTemp[0]);
+    if (pJob->aszTemp[1][0])
+      remove(pJob->aszTemp[1]);
+  }
+
+  free(pJob);
+}
+
+static void ReapOne(void)
+{
+  int  rc;
+  PROC *pProc;
+
+  if (!(pProc = WaitLxlite(&rc)))
+    return;
+
+  if (rc != 0)
+    pProc->pJob->fFailed = 1;
+
+  if (--pProc->pJob->cRunning == 0)
+    FinishJob(pProc->pJob);
+}
+
+static void AddProc(JOB *pJob, const char *pcszFile, const char *pcszVariant, int iVariant)
+{
+  long pid;
+
+  while (G_cProcs >= G_cJobs)
+    ReapOne();
+
+  if ((pid = StartLxlite(pcszFile, pcszVariant)) == -1)
+  {
+    fprintf(stderr, "lxpar: cannot start %s\n", G_pcszLxlite);
+    pJob->fFailed = 1;
+    return;
+  }
+
+  G_aProcs[G_cProcs].pid = pid;
+  G_aProcs[G_cProcs].pJob = pJob;
+  G_aProcs[G_cProcs].iVariant = iVariant;
+  G_cProcs++;
+  pJob->cRunning++;
+}
+
+static void PackFile(const char *pcszFile)
+{
+  JOB  *pJob;
+  char szCache[MAXPATH];
+
+  if (!(pJob = (JOB *)calloc(1, sizeof(JOB))))
+    return;
+  strncpy(pJob->szFile, pcszFile, MAXPATH - 5);
+
+  if (HashFile(pcszFile, &pJob->hash) != RC_OK)
+  {
+    fprintf(stderr, "lxpar: cannot read %s\n", pcszFile);
+    G_cFailed++;
+    free(pJob);
+    return;
+  }
+
+  if (G_pcszCache)
+  {
+    CachePath(szCache, pJob->hash);
+    if (    (FileSize(szCache) > 0)
+         && (CopyFile(szCache, pcszFile) == RC_OK)
+       )
+    {
+      G_cCached++;
+      free(pJob);
+      return;
+    }
+  }
+
+  if (!G_fExhaustive)
+    AddProc(pJob, pJob->szFile, NULL, 0);
+  else
+  {
+    int i;
+    for (i = 0; i < 2; i++)
+    {
+      sprintf(pJob->aszTemp[i], "%s.lp%d", pJob->szFile, i + 1);
+      if (CopyFile(pJob->szFile, pJob->aszTemp[i]) != RC_OK)
+      {
+        pJob->fFailed = 1;
+        pJob->aszTemp[i][0] = '\0';
+        break;
+      }
+    }
+
+    /* start both only after both copies exist, so that the
+       first process cannot finish the job early */
+    if (!pJob->fFailed)
+    {
+      pJob->cRunning++;
+      AddProc(pJob, pJob->aszTemp[0], LXPAR_VARIANT1, 0);
+      AddProc(pJob, pJob->aszTemp[1], LXPAR_VARIANT2, 1);
+      pJob->cRunning--;
+    }
+  }
+
+  if (pJob->cRunning == 0)
+    FinishJob(pJob);
+}
+
+/*
+ * Wildcard match with '*' and '?'; case-insensitive except on Unix.
+ */
+static int Match(const char *pcszPattern, const char *pcszName)
+{
+  while (*pcszPattern)
+  {
+    if (*pcszPattern == '*')
+    {
+      while (*pcszPattern == '*')
+        pcszPattern++;
+      if (!*pcszPattern)
+        return 1;
+      for (; *pcszName; pcszName++)
+        if (Match(pcszPattern, pcszName))
+          return 1;
+      return 0;
+    }
+
+    if (!*pcszName)
+      return 0;
+
+#ifdef __UNIX__
+    if (*pcszPattern != '?' && *pcszPattern != *pcszName)
+#else
+    if (*pcszPattern != '?' && toupper(*pcszPattern) != toupper(*pcszName))
+#endif
+      return 0;
+
+    pcszPattern++;
+    pcszName++;
+  }
+
+  return !*pcszName;
+}
+
+/*
+ * Packs a single file, or all files matching a pattern in the last
+ * path component (the shell does not expand those on OS/2).
+ */
+static void PackSpec(const char *pcszSpec)
+{
+  char          szDir[MAXPATH],
+                szFile[MAXPATH];
+  const char    *pcszPattern;
+  DIR           *pDir;
+  struct dirent *pEnt;
+  int           cMatches = 0;
+
+  if (!strpbrk(pcszSpec, "*?"))
+  {
+    PackFile(pcszSpec);
+    return;
+  }
+
+  strncpy(szDir, pcszSpec, MAXPATH - 1);
+  szDir[MAXPATH - 1] = '\0';
+  if ((pcszPattern = strrchr(pcszSpec, PATHSEP)) != NULL
+#ifndef __UNIX__
+      || (pcszPattern = strrchr(pcszSpec, '/')) != NULL
+#endif
+     )
+  {
+    szDir[pcszPattern - pcszSpec] = '\0';
+    pcszPattern++;
+  }
+  else
+  {
+    strcpy(szDir, ".");
+    pcszPattern = pcszSpec;
+  }
+
+  if (!(pDir = opendir(szDir)))
+  {
+    fprintf(stderr, "lxpar: cannot read directory %s\n", szDir);
+    G_cFailed++;
+    return;
+  }
+
+  while ((pEnt = readdir(pDir)) != NULL)
+    if (Match(pcszPattern, pEnt->d_name)
+        && strlen(szDir) + strlen(pEnt->d_name) + 2 <= sizeof(szFile))
+    {
+      sprintf(szFile, "%s%c%s", szDir, PATHSEP, pEnt->d_name);
+      PackFile(szFile);
+      cMatches++;
+    }
+
+  closedir(pDir);
+
+  if (!cMatches)
+    fprintf(stderr, "lxpar: no files match %s\n", pcszSpec);
+}
+
+int main(int argc, char **argv)
+{
+  int i;
+
+  printf("LXPAR %s\n", VERSION);
+
+  for (i = 1; i < argc && (argv[i][0] == '-' || argv[i][0] == '/') && argv[i][1]; i++)
+  {
+    switch (tolower(argv[i][1]))
+    {
+      case 'j':
+        if (++i >= argc)
+          return ShowUsage();
+        G_cJobs = atoi(argv[i]);
+        if (G_cJobs < 1)
+          G_cJobs = 1;
+        if (G_cJobs > MAXJOBS)
+          G_cJobs = MAXJOBS;
+        break;
+
+      case 'c':
+        if (++i >= argc)
+          return ShowUsage();
+        G_pcszCache = argv[i];
+        break;
+
+      case 'l':
+        if (++i >= argc)
+          return ShowUsage();
+        G_pcszLxlite = argv[i];
+        break;
+
+      case 'o':
+        if (++i >= argc || strlen(argv[i]) >= MAXPATH - 1)
+          return ShowUsage();
+        G_pcszOptions = argv[i];
+        break;
+
+      case 'x':
+        G_fExhaustive = 1;
+        break;
+
+      default:
+        return ShowUsage();
+    }
+  }
+
+  if (i >= argc)
+    return ShowUsage();
+
+  /* -x needs a process per variant */
+  if (G_fExhaustive && G_cJobs < 2)
+    G_cJobs = 2;
+
+  for (; i < argc; i++)
+    PackSpec(argv[i]);
+
+  while (G_cProcs)
+    ReapOne();
+
+  printf("lxpar: %d packed, %d from cache, %d failed\n",
+         G_cPacked, G_cCached, G_cFailed);
+
+  return G_cFailed ? RC_PACK_ERROR : RC_OK;
+}
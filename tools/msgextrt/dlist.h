@@ -55,6 +55,7 @@
 *            void        PruneList
 *            void        AppendList
 *            void        TransferItem
+*            void        IndexList
 *
 * Description:  This module implements a simple, generic, doubly linked list.
 *               Data objects of any type can be placed into a linked list
@@ -2097,6 +2098,40 @@ Insertion_Modes   TransferMode,
 BOOLEAN           MakeCurrent,
 CARDINAL32 *      Error);
 
+/*********************************************************************/
+/*                                                                   */
+/*   Function Name:  IndexList                                       */
+/*                                                                   */
+/*   Descriptive Name: Builds an index of the handles of the items   */
+/*                     in a DLIST so that handles given to this      */
+/*                     module can be checked without touching the    */
+/*                     memory they point to.                         */
+/*                                                                   */
+/*   Input:  DLIST ListToIndex : The list to index.                  */
+/*           CARDINAL32 * Error : The address of a variable to hold  */
+/*                                the error return code.             */
+/*                                                                   */
+/*   Output: *Error will be DLIST_SUCCESS if the index was built,    */
+/*           otherwise it will contain an error code.                */
+/*                                                                   */
+/*   Error Handling: If there is not enough memory for the index,    */
+/*                   *Error is set to DLIST_OUT_OF_MEMORY and the    */
+/*                   list is left as it was.                         */
+/*                                                                   */
+/*   Side Effects: From now on, every item added to or removed from  */
+/*                 the list is also added to or removed from the     */
+/*                 index, until the list is destroyed.               */
+/*                                                                   */
+/*   Notes: Without an index, a handle is checked by looking at the  */
+/*          LinkNode it points to, which fails badly if the item     */
+/*          was deleted and its memory reused.  With an index, a     */
+/*          handle which does not belong to the list is rejected     */
+/*          with DLIST_BAD_HANDLE whatever it points to.  Indexing   */
+/*          a list which is already indexed does nothing.            */
+/*                                                                   */
+/*********************************************************************/
+void _System IndexList( DLIST ListToIndex, CARDINAL32 * Error );
+
 /*********************************************************************/
 /*                                                                   */
 /*   Function Name:  CheckListIntegrity                              */
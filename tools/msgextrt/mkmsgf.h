@@ -39,7 +39,6 @@
 #define MKMSGF_H
 
 #include <stdint.h>
-#include <dlist.h>
 
 /* Basic msg file layout:
 
@@ -192,9 +191,12 @@ typedef struct _MESSAGEINFO
     uint8_t langfamilyIDcode;    // Save array position for easy lookup
     uint8_t fakeextend;          // Append a fake extended header
     uint8_t fixlastline;         // Try and fix last line issues
-	DLIST msgids;				 // Message IDs constants from include files or in extract control file
+    uint8_t *msgids;             // Times each message number is listed in extract control file
 } MESSAGEINFO;
 
+// message numbers are 4 digits
+#define MAXMSGNUM 10000
+
 // mkmsgf header signature - a valid MSG file alway starts with
 // these 8 bytes 0xFF MKMSGF 0x00
 char signature[] = {0xFF, 0x4D, 0x4B, 0x4D, 0x53, 0x47, 0x46, 0x00};
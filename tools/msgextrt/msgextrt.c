@@ -48,7 +48,6 @@
 #include "mkmsgf.h"
 #include "mkmsgerr.h"
 #include "version.h"
-#include "dlist.h"
 
 int readheader(MESSAGEINFO *messageinfo);
 int readmessages(MESSAGEINFO *messageinfo);
@@ -181,7 +180,6 @@ getline (lineptr, n, stream)
 int main(int argc, char *argv[])
 {
     int rc = 0; // return code
-    unsigned long dlrc = 0; // return code
     int ch = 0; // getopt variable
 
     MESSAGEINFO messageinfo;     // holds all the info
@@ -255,7 +253,6 @@ int main(int argc, char *argv[])
 
     // ************ done with args ************
 	
-	messageinfo.msgids=CreateList();
 	// Parse control file
 	rc = readcontrol(&messageinfo);
     if (rc != MKMSG_NOERROR)
@@ -279,7 +276,7 @@ int main(int argc, char *argv[])
     if (rc != MKMSG_NOERROR)
         ProgError(rc, "MSGEXTRT: Error read MSG messages");
 
-	DestroyList(&messageinfo.msgids, FALSE, &dlrc);
+	free(messageinfo.msgids);
 
     // if you don't see this then I screwed up
     if (messageinfo.verbose) printf("\r\nEnd Decompile\r\n");
@@ -295,7 +292,7 @@ int readcontrol(MESSAGEINFO *messageinfo)
 	char *line = NULL;
 	char msgnum[5]={0};
 	int rc = 0;
-	unsigned long dlrc = 0;
+	int num;
 
     getline(&line, &n, fp);
     getline(&line, &n, fp);
@@ -311,6 +308,12 @@ int readcontrol(MESSAGEINFO *messageinfo)
     }
     *dst = '\0';
 	strncpy(messageinfo->infile, &line[1], sizeof(messageinfo->infile));
+
+	// count of each wanted message, looked up directly by number when
+	// the messages are written out
+	messageinfo->msgids = (uint8_t *)calloc(MAXMSGNUM, sizeof(uint8_t));
+	if (messageinfo->msgids == NULL)
+		return (MKMSG_MEM_ERROR1);
 	
 	while(!feof(fp))
 	{
@@ -325,14 +328,9 @@ int readcontrol(MESSAGEINFO *messageinfo)
 
         strncpy(msgnum, &line[3], 4);
 
-		InsertItem (messageinfo->msgids,
-					sizeof(msgnum),
-					msgnum,
-					atoi(msgnum),
-					NULL,
-					AppendToList,
-					FALSE,
-					&dlrc);
+		num = atoi(msgnum);
+		if ((num >= 0) && (num < MAXMSGNUM) && (messageinfo->msgids[num] < UINT8_MAX))
+			messageinfo->msgids[num]++;
 
 	}
 
@@ -638,24 +636,23 @@ int outputheader(MESSAGEINFO *messageinfo)
  * Function:  readmessages()
  *
  * 1. Opens input and output message files
- * 2. Setup buffers for index, read, and write
- * 3. Read in full index
+ * 2. Read in the whole input file, setup buffers for read and write
+ * 3. Point to index in file buffer
  * 4. Write out idenifier -- needs 0x0D 0x0A ending
  * 5. Setup for uint8 or uint32 index read
  * 6. Main loop
- * 6.1 Calculate message number
+ * 6.1 Calculate message number, skip it if not in control file
  * 6.2 If last message - get final pointer for read
  * 6.3 Calculate message length from index
- * 6.4 Seek to message start
- * 6.5 Resize read buffer if needed
- * 6.6 Clear read buffer with all 0x00
- * 6.7 Read in the current message
+ * 6.4 Resize read buffer if needed
+ * 6.5 Clear read buffer with all 0x00
+ * 6.6 Copy the current message from the file buffer
  * 6.8 Verify msg length (current_msg_len) using strlen
  * 6.9 Check for no 0x0D 0x0A end - if not add %, 0, 0x0D, 0x0A
  * 6.10 Setup scratch pointer and move past msg_type
  * 6.11 Resize write buffer if needed
  * 6.12 Generate message header and write
- * 6.13 Write message
+ * 6.13 Write message, once for each time it is in control file
  * 6.14 If V option print to screen
  * 7 Close files and free buffers
  * 8 Return
@@ -664,25 +661,16 @@ int outputheader(MESSAGEINFO *messageinfo)
  *
  *************************************************************************/
 
-typedef
-struct tagParam
+// copy len bytes at offset off of the file buffer, the part past the end
+// of file is left alone like fread() would
+static void copymsg(char *dst, char *file_buffer, unsigned long file_size,
+                    unsigned long off, unsigned long len)
 {
-	int num;
-	FILE * f;
-	char * msg;
-	MESSAGEINFO *messageinfo;
-} Param;
-
-void handleitem(ADDRESS Object, TAG ObjectTag, CARDINAL32 ObjectSize, ADDRESS ObjectHandle, ADDRESS Parameters, CARDINAL32 * Error)
-{
-	if (((Param *)Parameters)->num==ObjectTag)
-	{
-        fwrite(((Param *)Parameters)->msg, strlen(((Param *)Parameters)->msg), 1, ((Param *)Parameters)->f);
-        // print to screen if you really want it
-        if (((Param *)Parameters)->messageinfo->verbose == 2)
-            printf("%s", ((Param *)Parameters)->msg);
-	}
-
+    if (off >= file_size)
+        return;
+    if (len > file_size - off)
+        len = file_size - off;
+    memcpy(dst, file_buffer + off, len);
 }
 
 int readmessages(MESSAGEINFO *messageinfo)
@@ -698,6 +686,7 @@ int readmessages(MESSAGEINFO *messageinfo)
     unsigned long intial_len = 0;      // save intial length
     unsigned long current_msg_len = 0; // current msg length
     unsigned long last_message;        // track last message
+    unsigned long file_size = 0;       // size of input file
 
     // open input file
     FILE *fpi = fopen(messageinfo->infile, "rb");
@@ -709,7 +698,16 @@ int readmessages(MESSAGEINFO *messageinfo)
     if (fpo == NULL)
         return (MKMSG_OPEN_ERROR);
 
-    // buffer to read in index
+    // buffer to read in the whole input file, messages are taken from
+    // here instead of seeking to each one
+    fseek(fpi, 0L, SEEK_END);
+    file_size = (unsigned long)ftell(fpi);
+    rewind(fpi);
+    char *file_buffer = (char *)malloc(file_size + 1);
+    if (file_buffer == NULL)
+        return (MKMSG_MEM_ERROR5);
+
+    // buffer for index
     char *index_buffer = (char *)calloc(messageinfo->indexsize, sizeof(char));
     if (index_buffer == NULL)
         return (MKMSG_MEM_ERROR5);
@@ -726,15 +724,15 @@ int readmessages(MESSAGEINFO *messageinfo)
     if (write_buffer == NULL)
         return (MKMSG_MEM_ERROR7);
 
-    // *** get full index into buffer (index_buffer)
-
-    // seek to the start of index for read
-    fseek(fpi, messageinfo->indexoffset, SEEK_SET);
-
-    // read index into buffer
-    fread(index_buffer, sizeof(char), messageinfo->indexsize, fpi);
+    // *** get whole file into buffer (file_buffer)
+    fread(file_buffer, sizeof(char), file_size, fpi);
     if (ferror(fpi))
         return (MKMSG_READ_ERROR);
+    fclose(fpi);
+
+    // *** get full index into buffer (index_buffer)
+    copymsg(index_buffer, file_buffer, file_size,
+            messageinfo->indexoffset, messageinfo->indexsize);
 
     // not pretty, but the old IBM MKMSGF expects this
     // line to end with 0x0D 0x0A
@@ -774,6 +772,10 @@ int readmessages(MESSAGEINFO *messageinfo)
             msg_next = *large_index;
         }
 
+        // nothing to do if control file does not want it
+        if ((current_msg >= MAXMSGNUM) || !messageinfo->msgids[current_msg])
+            continue;
+
         // if we are on the last message then the msg_next
         // needs to be the end of the message block + 1 as calculated
         // with the fseek to end above.
@@ -786,9 +788,6 @@ int readmessages(MESSAGEINFO *messageinfo)
         current_msg_len = (msg_next - msg_curr);
         intial_len = current_msg_len; // for fix last line
 
-        // seek to the start of message to read
-        fseek(fpi, msg_curr, SEEK_SET);
-
         // Read buffer sizing **********************************
         //
         // check read buffer size -- Do we need a bigger buffer?
@@ -810,8 +809,8 @@ int readmessages(MESSAGEINFO *messageinfo)
         // give me a clean strlen return
         memset(read_buffer, 0x00, _msize(read_buffer));
 
-        // read in the message to the read buffer
-        fread(read_buffer, sizeof(char), current_msg_len, fpi);
+        // copy the message to the read buffer
+        copymsg(read_buffer, file_buffer, file_size, msg_curr, current_msg_len);
 
         // had a couple questionable messages (which could have been
         // my fault) so this will give me a know string to change
@@ -884,33 +883,22 @@ int readmessages(MESSAGEINFO *messageinfo)
         // needed (see +15 above) and I memset to fill with 0x00
         // given this, we will get the write size using strlen()
         // which returns a size up to the 0x00
-		Param p;
-		unsigned long dlrc=0;
-		p.num=current_msg;
-		p.f=fpo;
-		p.msg=write_buffer;
-		p.messageinfo=messageinfo;
-		
-				ForEachItem(messageinfo->msgids,
-					&handleitem,
-					(ADDRESS)&p,
-					TRUE,
-					&dlrc);
-#if 0		
-        fwrite(write_buffer, strlen(write_buffer), 1, fpo);
+        for (int n = 0; n < messageinfo->msgids[current_msg]; n++)
+        {
+            fwrite(write_buffer, strlen(write_buffer), 1, fpo);
 
-        // print to screen if you really want it
-        if (messageinfo->verbose == 2)
-            printf("%s", write_buffer);
-#endif
+            // print to screen if you really want it
+            if (messageinfo->verbose == 2)
+                printf("%s", write_buffer);
+        }
     }
 
     // close up and get out
     fclose(fpo);
-    fclose(fpi);
     free(read_buffer);
     free(write_buffer);
     free(index_buffer);
+    free(file_buffer);
 
     return (MKMSG_NOERROR);
 }
@@ -54,7 +54,19 @@ typedef struct QCowHeader {
     uint64_t l1_table_offset;
 } QCowHeader;
 
-#define L2_CACHE_SIZE 16
+/* L2 cache size: by default enough tables to cover the whole image, but
+   no more than L2_CACHE_DEFAULT_MAX bytes; QCOW_L2_CACHE_SIZE in the
+   environment (bytes, or with a K, M or G suffix) overrides it */
+#define L2_CACHE_MIN 16
+#define L2_CACHE_DEFAULT_MAX (32 * 1024 * 1024)
+
+typedef struct L2CacheEntry {
+    uint64_t offset;            /* of the table in the file */
+    uint64_t *table;
+    int dirty;                  /* entries changed since it was read */
+    int prev, next;             /* LRU list, most recently used first */
+    int hash_next;
+} L2CacheEntry;
 
 typedef struct BDRVQcowState {
     int fd;
@@ -67,9 +79,12 @@ typedef struct BDRVQcowState {
     uint64_t cluster_offset_mask;
     uint64_t l1_table_offset;
     uint64_t *l1_table;
-    uint64_t *l2_cache;
-    uint64_t l2_cache_offsets[L2_CACHE_SIZE];
-    uint32_t l2_cache_counts[L2_CACHE_SIZE];
+    L2CacheEntry *l2_cache;
+    int l2_cache_size;          /* entries */
+    int l2_cache_used;          /* entries with a table */
+    int l2_lru_first, l2_lru_last;
+    int *l2_hash;               /* first entry of each chain, or -1 */
+    int l2_hash_mask;
     uint8_t *cluster_cache;
     uint8_t *cluster_data;
     uint64_t cluster_cache_offset;
@@ -93,6 +108,201 @@ static int qcow_probe(const uint8_t *buf, int buf_size, const char *filename)
         return 0;
 }
 
+static int64_t l2_cache_bytes(BDRVQcowState *s)
+{
+    const char *env;
+    char *end;
+    int64_t size;
+
+    env = getenv("QCOW_L2_CACHE_SIZE");
+    if (!env) {
+        size = (int64_t)s->l1_size * s->l2_size * sizeof(uint64_t);
+        return size < L2_CACHE_DEFAULT_MAX ? size : L2_CACHE_DEFAULT_MAX;
+    }
+    size = strtoul(env, &end, 0);
+    switch(*end) {
+    case 'g':
+    case 'G':
+        size <<= 10;
+        /* fall through */
+    case 'm':
+    case 'M':
+        size <<= 10;
+        /* fall through */
+    case 'k':
+    case 'K':
+        size <<= 10;
+        break;
+    }
+    return size;
+}
+
+static int l2_cache_init(BDRVQcowState *s)
+{
+    int64_t n;
+    int i, hash_size;
+
+    n = l2_cache_bytes(s) / (s->l2_size * sizeof(uint64_t));
+    if (n > s->l1_size)
+        n = s->l1_size;
+    if (n < L2_CACHE_MIN)
+        n = L2_CACHE_MIN;
+    s->l2_cache_size = n;
+    s->l2_cache_used = 0;
+    s->l2_lru_first = -1;
+    s->l2_lru_last = -1;
+    /* tables are allocated as they are first needed */
+    s->l2_cache = qemu_mallocz(n * sizeof(L2CacheEntry));
+    if (!s->l2_cache)
+        return -1;
+
+    for(hash_size = 1; hash_size < n; hash_size <<= 1)
+        ;
+    s->l2_hash = qemu_malloc(hash_size * sizeof(int));
+    if (!s->l2_hash)
+        return -1;
+    for(i = 0; i < hash_size; i++)
+        s->l2_hash[i] = -1;
+    s->l2_hash_mask = hash_size - 1;
+    return 0;
+}
+
+static void l2_cache_free(BDRVQcowState *s)
+{
+    int i;
+
+    if (s->l2_cache) {
+        for(i = 0; i < s->l2_cache_used; i++)
+            qemu_free(s->l2_cache[i].table);
+    }
+    qemu_free(s->l2_cache);
+    qemu_free(s->l2_hash);
+    s->l2_cache = NULL;
+    s->l2_hash = NULL;
+}
+
+static int l2_cache_writeback(BDRVQcowState *s, L2CacheEntry *e)
+{
+    int len = s->l2_size * sizeof(uint64_t);
+
+    if (!e->dirty)
+        return 0;
+    lseek(s->fd, e->offset, SEEK_SET);
+    if (write(s->fd, e->table, len) != len)
+        return -1;
+    e->dirty = 0;
+    return 0;
+}
+
+static int l2_cache_flush(BDRVQcowState *s)
+{
+    int i, ret = 0;
+
+    for(i = 0; i < s->l2_cache_used; i++) {
+        if (l2_cache_writeback(s, &s->l2_cache[i]) < 0)
+            ret = -1;
+    }
+    return ret;
+}
+
+static void l2_lru_unlink(BDRVQcowState *s, int i)
+{
+    L2CacheEntry *e = &s->l2_cache[i];
+
+    if (e->prev >= 0)
+        s->l2_cache[e->prev].next = e->next;
+    else
+        s->l2_lru_first = e->next;
+    if (e->next >= 0)
+        s->l2_cache[e->next].prev = e->prev;
+    else
+        s->l2_lru_last = e->prev;
+}
+
+static void l2_lru_push(BDRVQcowState *s, int i)
+{
+    L2CacheEntry *e = &s->l2_cache[i];
+
+    e->prev = -1;
+    e->next = s->l2_lru_first;
+    if (s->l2_lru_first >= 0)
+        s->l2_cache[s->l2_lru_first].prev = i;
+    else
+        s->l2_lru_last = i;
+    s->l2_lru_first = i;
+}
+
+static int *l2_hash_head(BDRVQcowState *s, uint64_t l2_offset)
+{
+    return &s->l2_hash[(l2_offset >> s->cluster_bits) & s->l2_hash_mask];
+}
+
+/* Return the cache entry of the L2 table at l2_offset, reading it in
+   if need be. A new table is cleared in memory and on disk instead. */
+static L2CacheEntry *l2_cache_get(BDRVQcowState *s, uint64_t l2_offset,
+                                  int new_l2_table)
+{
+    L2CacheEntry *e, *ret = NULL;
+    int i, *pi, len;
+
+    len = s->l2_size * sizeof(uint64_t);
+    for(i = *l2_hash_head(s, l2_offset); i >= 0; i = e->hash_next) {
+        e = &s->l2_cache[i];
+        if (e->offset == l2_offset) {
+            if (s->l2_lru_first != i) {
+                l2_lru_unlink(s, i);
+                l2_lru_push(s, i);
+            }
+            return e;
+        }
+    }
+
+    /* not found: take a free entry, or the least recently used one */
+    if (s->l2_cache_used < s->l2_cache_size) {
+        i = s->l2_cache_used;
+        e = &s->l2_cache[i];
+        e->table = qemu_malloc(len);
+        if (!e->table)
+            return NULL;
+        s->l2_cache_used++;
+    } else {
+        i = s->l2_lru_last;
+        e = &s->l2_cache[i];
+        if (l2_cache_writeback(s, e) < 0)
+            return NULL;
+        for(pi = l2_hash_head(s, e->offset); *pi != i;
+            pi = &s->l2_cache[*pi].hash_next)
+            ;
+        *pi = e->hash_next;
+        l2_lru_unlink(s, i);
+    }
+
+    lseek(s->fd, l2_offset, SEEK_SET);
+    if (new_l2_table) {
+        memset(e->table, 0, len);
+        if (write(s->fd, e->table, len) != len)
+            goto fail;
+    } else {
+        if (read(s->fd, e->table, len) != len)
+            goto fail;
+    }
+    ret = e;
+ insert:
+    e->offset = l2_offset;
+    e->dirty = 0;
+    pi = l2_hash_head(s, l2_offset);
+    e->hash_next = *pi;
+    *pi = i;
+    l2_lru_push(s, i);
+    return ret;
+
+ fail:
+    /* keep the entry under offset 0, which no table has, until it
+       ages out */
+    l2_offset = 0;
+    goto insert;
+}
+
 static int qcow_open(BlockDriverState *bs, const char *filename)
 {
     BDRVQcowState *s = bs->opaque;
@@ -150,8 +360,7 @@ static int qcow_open(BlockDriverState *bs, const char *filename)
         be64_to_cpus(&s->l1_table[i]);
     }
     /* alloc L2 cache */
-    s->l2_cache = qemu_malloc(s->l2_size * L2_CACHE_SIZE * sizeof(uint64_t));
-    if (!s->l2_cache)
+    if (l2_cache_init(s) < 0)
         goto fail;
     s->cluster_cache = qemu_malloc(s->cluster_size);
     if (!s->cluster_cache)
@@ -175,7 +384,7 @@ static int qcow_open(BlockDriverState *bs, const char *filename)
 
  fail:
     qemu_free(s->l1_table);
-    qemu_free(s->l2_cache);
+    l2_cache_free(s);
     qemu_free(s->cluster_cache);
     qemu_free(s->cluster_data);
     close(fd);
@@ -268,9 +477,9 @@ static uint64_t get_cluster_offset(BlockDriverState *bs,
                                    int n_start, int n_end)
 {
     BDRVQcowState *s = bs->opaque;
-    int min_index, i, j, l1_index, l2_index;
+    int i, l1_index, l2_index;
     uint64_t l2_offset, *l2_table, cluster_offset, tmp;
-    uint32_t min_count;
+    L2CacheEntry *e;
     int new_l2_table;
     
     l1_index = offset >> (s->l2_bits + s->cluster_bits);
@@ -291,42 +500,10 @@ static uint64_t get_cluster_offset(BlockDriverState *bs,
             return 0;
         new_l2_table = 1;
     }
-    for(i = 0; i < L2_CACHE_SIZE; i++) {
-        if (l2_offset == s->l2_cache_offsets[i]) {
-            /* increment the hit count */
-            if (++s->l2_cache_counts[i] == 0xffffffff) {
-                for(j = 0; j < L2_CACHE_SIZE; j++) {
-                    s->l2_cache_counts[j] >>= 1;
-                }
-            }
-            l2_table = s->l2_cache + (i << s->l2_bits);
-            goto found;
-        }
-    }
-    /* not found: load a new entry in the least used one */
-    min_index = 0;
-    min_count = 0xffffffff;
-    for(i = 0; i < L2_CACHE_SIZE; i++) {
-        if (s->l2_cache_counts[i] < min_count) {
-            min_count = s->l2_cache_counts[i];
-            min_index = i;
-        }
-    }
-    l2_table = s->l2_cache + (min_index << s->l2_bits);
-    lseek(s->fd, l2_offset, SEEK_SET);
-    if (new_l2_table) {
-        memset(l2_table, 0, s->l2_size * sizeof(uint64_t));
-        if (write(s->fd, l2_table, s->l2_size * sizeof(uint64_t)) !=
-            s->l2_size * sizeof(uint64_t))
-            return 0;
-    } else {
-        if (read(s->fd, l2_table, s->l2_size * sizeof(uint64_t)) != 
-            s->l2_size * sizeof(uint64_t))
-            return 0;
-    }
-    s->l2_cache_offsets[min_index] = l2_offset;
-    s->l2_cache_counts[min_index] = 1;
- found:
+    e = l2_cache_get(s, l2_offset, new_l2_table);
+    if (!e)
+        return 0;
+    l2_table = e->table;
     l2_index = (offset >> s->cluster_bits) & (s->l2_size - 1);
     cluster_offset = be64_to_cpu(l2_table[l2_index]);
     if (!cluster_offset || 
@@ -380,12 +557,10 @@ static uint64_t get_cluster_offset(BlockDriverState *bs,
                     (uint64_t)compressed_size << (63 - s->cluster_bits);
             }
         }
-        /* update L2 table */
+        /* update L2 table, written back with the whole table later */
         tmp = cpu_to_be64(cluster_offset);
         l2_table[l2_index] = tmp;
-        lseek(s->fd, l2_offset + l2_index * sizeof(tmp), SEEK_SET);
-        if (write(s->fd, &tmp, sizeof(tmp)) != sizeof(tmp))
-            return 0;
+        e->dirty = 1;
     }
     return cluster_offset;
 }
@@ -529,8 +704,9 @@ static int qcow_write(BlockDriverState *bs, int64_t sector_num,
 static void qcow_close(BlockDriverState *bs)
 {
     BDRVQcowState *s = bs->opaque;
+    l2_cache_flush(s);
     qemu_free(s->l1_table);
-    qemu_free(s->l2_cache);
+    l2_cache_free(s);
     qemu_free(s->cluster_cache);
     qemu_free(s->cluster_data);
     close(s->fd);
@@ -539,10 +715,10 @@ static void qcow_close(BlockDriverState *bs)
 static int qcow_create(const char *filename, int64_t total_size,
                       const char *backing_file, int flags)
 {
-    int fd, header_size, backing_filename_len, l1_size, i, shift;
+    int fd, header_size, backing_filename_len, l1_size, i, n, shift;
     QCowHeader header;
     char backing_filename[1024];
-    uint64_t tmp;
+    uint8_t zero[4096];
     struct stat st;
 
     fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY | O_LARGEFILE, 
@@ -599,9 +775,12 @@ static int qcow_create(const char *filename, int64_t total_size,
         write(fd, backing_filename, backing_filename_len);
     }
     lseek(fd, header_size, SEEK_SET);
-    tmp = 0;
-    for(i = 0;i < l1_size; i++) {
-        write(fd, &tmp, sizeof(tmp));
+    memset(zero, 0, sizeof(zero));
+    for(i = 0; i < l1_size; i += n) {
+        n = l1_size - i;
+        if (n > (int)(sizeof(zero) / sizeof(uint64_t)))
+            n = (int)(sizeof(zero) / sizeof(uint64_t));
+        write(fd, zero, n * sizeof(uint64_t));
     }
     close(fd);
     return 0;
@@ -615,33 +794,28 @@ int qcow_get_cluster_size(BlockDriverState *bs)
     return s->cluster_size;
 }
 
-/* XXX: put compressed sectors first, then all the cluster aligned
-   tables to avoid losing bytes in alignment */
-int qcow_compress_cluster(BlockDriverState *bs, int64_t sector_num, 
-                          const uint8_t *buf)
+/* Deflate one cluster from buf into out_buf, which holds cluster_size
+   bytes. Returns the compressed size, 0 if the cluster does not get
+   smaller, or -1 on error. Only reads the cluster size from the driver
+   state, so several clusters can be compressed on different threads
+   while another one is being written. */
+int qcow_deflate_cluster(BlockDriverState *bs, uint8_t *out_buf,
+                         const uint8_t *buf)
 {
     BDRVQcowState *s = bs->opaque;
     z_stream strm;
     int ret, out_len;
-    uint8_t *out_buf;
-    uint64_t cluster_offset;
 
     if (bs->drv != &bdrv_qcow)
         return -1;
 
-    out_buf = qemu_malloc(s->cluster_size + (s->cluster_size / 1000) + 128);
-    if (!out_buf)
-        return -1;
-
     /* best compression, small window, no zlib header */
     memset(&strm, 0, sizeof(strm));
     ret = deflateInit2(&strm, Z_DEFAULT_COMPRESSION,
                        Z_DEFLATED, -12, 
                        9, Z_DEFAULT_STRATEGY);
-    if (ret != 0) {
-        qemu_free(out_buf);
+    if (ret != 0)
         return -1;
-    }
 
     strm.avail_in = s->cluster_size;
     strm.next_in = (uint8_t *)buf;
@@ -650,7 +824,6 @@ int qcow_compress_cluster(BlockDriverState *bs, int64_t sector_num,
 
     ret = deflate(&strm, Z_FINISH);
     if (ret != Z_STREAM_END && ret != Z_OK) {
-        qemu_free(out_buf);
         deflateEnd(&strm);
         return -1;
     }
@@ -658,7 +831,26 @@ int qcow_compress_cluster(BlockDriverState *bs, int64_t sector_num,
 
     deflateEnd(&strm);
 
-    if (ret != Z_STREAM_END || out_len >= s->cluster_size) {
+    if (ret != Z_STREAM_END || out_len >= s->cluster_size)
+        return 0;
+    return out_len;
+}
+
+/* Store a cluster deflated by qcow_deflate_cluster(): out_len bytes of
+   out_buf, or the plain cluster in buf if out_len is 0.
+   XXX: put compressed sectors first, then all the cluster aligned
+   tables to avoid losing bytes in alignment */
+int qcow_write_compressed(BlockDriverState *bs, int64_t sector_num,
+                          const uint8_t *buf, const uint8_t *out_buf,
+                          int out_len)
+{
+    BDRVQcowState *s = bs->opaque;
+    uint64_t cluster_offset;
+
+    if (bs->drv != &bdrv_qcow)
+        return -1;
+
+    if (out_len == 0) {
         /* could not compress: write normal cluster */
         qcow_write(bs, sector_num, buf, s->cluster_sectors);
     } else {
@@ -666,16 +858,36 @@ int qcow_compress_cluster(BlockDriverState *bs, int64_t sector_num,
                                             out_len, 0, 0);
         cluster_offset &= s->cluster_offset_mask;
         lseek(s->fd, cluster_offset, SEEK_SET);
-        if (write(s->fd, out_buf, out_len) != out_len) {
-            qemu_free(out_buf);
+        if (write(s->fd, out_buf, out_len) != out_len)
             return -1;
-        }
     }
-    
-    qemu_free(out_buf);
     return 0;
 }
 
+int qcow_compress_cluster(BlockDriverState *bs, int64_t sector_num, 
+                          const uint8_t *buf)
+{
+    BDRVQcowState *s = bs->opaque;
+    int ret, out_len;
+    uint8_t *out_buf;
+
+    if (bs->drv != &bdrv_qcow)
+        return -1;
+
+    out_buf = qemu_malloc(s->cluster_size);
+    if (!out_buf)
+        return -1;
+
+    out_len = qcow_deflate_cluster(bs, out_buf, buf);
+    if (out_len < 0)
+        ret = -1;
+    else
+        ret = qcow_write_compressed(bs, sector_num, buf, out_buf, out_len);
+
+    qemu_free(out_buf);
+    return ret;
+}
+
 BlockDriver bdrv_qcow = {
     "qcow",
     sizeof(BDRVQcowState),
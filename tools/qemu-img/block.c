@@ -538,9 +538,36 @@ void bdrv_info(void)
 }
 
 
+/* Return 1 if the sectors from sector_num are stored in the image or
+   one of its backing files and 0 if they read as zeros without being
+   stored anywhere, and in *pnum how many of the nb_sectors share that
+   state. Drivers that cannot tell say everything is there. */
+int bdrv_is_allocated(BlockDriverState *bs, int64_t sector_num, 
+                      int nb_sectors, int *pnum)
+{
+    BlockDriver *drv = bs->drv;
+
+    if (!drv->bdrv_is_allocated) {
+        *pnum = nb_sectors;
+        return 1;
+    }
+    if (drv->bdrv_is_allocated(bs, sector_num, nb_sectors, pnum))
+        return 1;
+    if (bs->backing_hd)
+        return bdrv_is_allocated(bs->backing_hd, sector_num, *pnum, pnum);
+    return 0;
+}
+
 /**************************************************************/
 /* RAW block driver */
 
+/* glibc hides these unless _GNU_SOURCE; Linux has had them since 3.1
+   and older kernels fail the lseek with EINVAL */
+#if defined(LINUX) && !defined(SEEK_DATA)
+#define SEEK_DATA 3
+#define SEEK_HOLE 4
+#endif
+
 typedef struct BDRVRawState {
     int fd;
 } BDRVRawState;
@@ -614,6 +641,44 @@ static int raw_write(BlockDriverState *bs, int64_t sector_num,
     return 0;
 }
 
+/* Holes in a sparse file read as zeros and are not allocated */
+static int raw_is_allocated(BlockDriverState *bs, int64_t sector_num, 
+                            int nb_sectors, int *pnum)
+{
+#ifdef SEEK_DATA
+    BDRVRawState *s = bs->opaque;
+    int64_t start, end, data, hole;
+
+    start = sector_num * 512;
+    end = start + (int64_t)nb_sectors * 512;
+    data = lseek(s->fd, start, SEEK_DATA);
+    if (data < 0 && errno == ENXIO) {
+        /* no data from here to the end of the file */
+        *pnum = nb_sectors;
+        return 0;
+    }
+    if (data >= start + 512) {
+        if (data > end)
+            data = end;
+        *pnum = (data - start) / 512;
+        return 0;
+    }
+    if (data == start) {
+        hole = lseek(s->fd, start, SEEK_HOLE);
+        if (hole > start) {
+            if (hole > end)
+                hole = end;
+            *pnum = (hole - start + 511) / 512;
+            return 1;
+        }
+    }
+    /* no support from the file system, or a hole that ends
+       inside the first sector */
+#endif
+    *pnum = nb_sectors;
+    return 1;
+}
+
 static void raw_close(BlockDriverState *bs)
 {
     BDRVRawState *s = bs->opaque;
@@ -633,6 +698,18 @@ static int raw_create(const char *filename, int64_t total_size,
     if (fd < 0)
         return -EIO;
     ftruncate(fd, total_size * 512);
+    /* convert leaves zero sectors unwritten, so the size must be right
+       from the start; some ftruncate()s cannot make a file longer */
+    if (total_size > 0 && lseek(fd, 0, SEEK_END) < total_size * 512) {
+        uint8_t sector[512];
+
+        memset(sector, 0, sizeof(sector));
+        lseek(fd, (total_size - 1) * 512, SEEK_SET);
+        if (write(fd, sector, sizeof(sector)) != sizeof(sector)) {
+            close(fd);
+            return -EIO;
+        }
+    }
     close(fd);
     return 0;
 }
@@ -646,6 +723,7 @@ BlockDriver bdrv_raw = {
     raw_write,
     raw_close,
     raw_create,
+    raw_is_allocated,
 };
 
 void bdrv_init(void)
@@ -4,6 +4,12 @@
 #else
 #include <unistd.h>
 #endif
+#if defined(__OS2__)
+#define INCL_DOSFILEMGR
+#include <os2.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
 
 
 int ftruncate( int handle, long size )
@@ -26,3 +32,24 @@ char *realpath(const char *path, char *resolved_path)
     return resolved_path;
 }
 
+/* Bytes the file takes on disk, -1 if the host cannot tell. On OS/2
+   the count is 32 bits wide, so it only means anything below 4 GB. */
+long long file_allocated_size(const char *filename)
+{
+#if defined(__OS2__)
+    FILESTATUS3 fs;
+
+    if (DosQueryPathInfo((PSZ)filename, FIL_STANDARD, &fs, sizeof(fs)))
+        return -1;
+    return fs.cbFileAlloc;
+#elif defined(_WIN32)
+    DWORD low, high;
+
+    low = GetCompressedFileSizeA(filename, &high);
+    if (low == 0xffffffff && GetLastError() != NO_ERROR)
+        return -1;
+    return ((long long)high << 32) | low;
+#else
+    return -1;
+#endif
+}
@@ -11,3 +11,4 @@
 
 int  ftruncate( int handle, long size );
 char *realpath(const char *path, char *resolved_path);
+long long file_allocated_size(const char *filename);
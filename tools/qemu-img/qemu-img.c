@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include "vl.h"
+#include "qemu-thread.h"
 
 #ifdef __WATCOMC__
 #include "porting.h"
@@ -142,7 +143,7 @@ void help(void)
            "Command syntax:\n"
            "  create [-e] [-b base_image] [-f fmt] filename [size]\n"
            "  commit [-f fmt] filename\n"
-           "  convert [-c] [-e] [-f fmt] filename [-O output_fmt] output_filename\n"
+           "  convert [-c] [-e] [-m num] [-f fmt] filename [-O output_fmt] output_filename\n"
            "  info [-f fmt] filename\n"
            "\n"
            "Command parameters:\n"
@@ -156,6 +157,8 @@ void help(void)
            "  'output_fmt' is the destination format\n"
            "  '-c' indicates that target image must be compressed (qcow format only)\n"
            "  '-e' indicates that the target image must be encrypted (qcow format only)\n"
+           "  '-m' sets how many threads compress or convert (default: one per CPU,\n"
+           "    0 for none)\n"
            );
     printf("\nSupported format:");
     bdrv_iterate_format(format_print, NULL);
@@ -452,10 +455,18 @@ static int img_commit(int argc, char **argv)
 
 static int is_not_zero(const uint8_t *sector, int len)
 {
+    const uint32_t *p = (const uint32_t *)sector;
     int i;
+
+    /* OR eight words at a time so there is one branch per 32 bytes */
     len >>= 2;
-    for(i = 0;i < len; i++) {
-        if (((uint32_t *)sector)[i] != 0)
+    for(i = 0; i + 8 <= len; i += 8) {
+        if (p[i] | p[i + 1] | p[i + 2] | p[i + 3] |
+            p[i + 4] | p[i + 5] | p[i + 6] | p[i + 7])
+            return 1;
+    }
+    for(; i < len; i++) {
+        if (p[i] != 0)
             return 1;
     }
     return 0;
@@ -479,24 +490,394 @@ static int is_allocated_sectors(const uint8_t *buf, int n, int *pnum)
     return v;
 }
 
-#define IO_BUF_SIZE 65536
+/* Convert runs as a pipeline: a reader thread fills buffers in turn,
+   worker threads compress the clusters of full buffers (-c only) and
+   the main thread writes the buffers out in order, helping with the
+   compression while it waits. Output is the same as converting one
+   buffer at a time, which is what happens when there are no threads. */
+
+#define IO_BUF_SIZE (2 * 1024 * 1024)
+#define NB_BUFS 4
+#define MAX_WORKERS 16
+
+enum {
+    BUF_FREE,
+    BUF_READ,       /* read, clusters being compressed */
+    BUF_DONE        /* ready to write */
+};
+
+typedef struct ConvertBuf {
+    int state;
+    int64_t sector_num;
+    int nb_sectors;
+    int nb_clusters;
+    int hole;           /* nothing stored in the source, buf not filled */
+    int next_cluster;   /* next cluster to hand out for compression */
+    int clusters_done;
+    uint8_t *buf;
+    uint8_t *zbuf;      /* compressed clusters, cluster_size apart */
+    int *zlen;          /* compressed size, 0 to store plain, -1 if zero */
+} ConvertBuf;
+
+typedef struct ConvertState {
+    BlockDriverState *bs;
+    BlockDriverState *out_bs;
+    int64_t total_sectors;
+    int compress;
+    int cluster_size;
+    int cluster_sectors;
+    int nb_bufs;
+    ConvertBuf bufs[NB_BUFS];
+    QemuMutex *lock;
+    /* every thread sleeps on an event of its own: it resets the event
+       before it sleeps, which would lose wakeups meant for others if
+       the event were shared */
+    QemuEvent *reader_ev;
+    QemuEvent *writer_ev;
+    QemuEvent *worker_ev[MAX_WORKERS];
+    int nb_workers;
+    int next_worker;
+    int threads;            /* threads still running */
+    int quit;
+} ConvertState;
+
+/* Read n sectors into buf. What the source does not store reads as
+   zeros, so it is cleared instead of read, which for a sparse raw file
+   saves reading gigabytes of holes. Returns 0 if nothing at all was
+   stored and buf was left alone. */
+static int convert_read_sectors(ConvertState *s, int64_t sector_num,
+                                uint8_t *buf, int n)
+{
+    int n1;
+
+    if (!bdrv_is_allocated(s->bs, sector_num, n, &n1) && n1 >= n)
+        return 0;
+    while (n > 0) {
+        if (bdrv_is_allocated(s->bs, sector_num, n, &n1)) {
+            if (bdrv_read(s->bs, sector_num, buf, n1) < 0)
+                error("error while reading");
+        } else {
+            memset(buf, 0, n1 * 512);
+        }
+        sector_num += n1;
+        n -= n1;
+        buf += n1 * 512;
+    }
+    return 1;
+}
+
+static void convert_read(ConvertState *s, ConvertBuf *b, int64_t sector_num)
+{
+    int64_t nb_sectors;
+    int n;
+
+    nb_sectors = s->total_sectors - sector_num;
+    n = nb_sectors < IO_BUF_SIZE / 512 ? nb_sectors : IO_BUF_SIZE / 512;
+    b->hole = !convert_read_sectors(s, sector_num, b->buf, n);
+    b->sector_num = sector_num;
+    b->nb_sectors = n;
+    b->next_cluster = 0;
+    b->clusters_done = 0;
+    if (s->compress) {
+        b->nb_clusters = (n + s->cluster_sectors - 1) / s->cluster_sectors;
+        if (n % s->cluster_sectors && !b->hole)
+            memset(b->buf + n * 512, 0,
+                   b->nb_clusters * s->cluster_size - n * 512);
+    }
+}
+
+static void convert_cluster(ConvertState *s, ConvertBuf *b, int i)
+{
+    const uint8_t *p = b->buf + i * s->cluster_size;
+
+    if (b->hole || !is_not_zero(p, s->cluster_size)) {
+        b->zlen[i] = -1;
+        return;
+    }
+    b->zlen[i] = qcow_deflate_cluster(s->out_bs,
+                                      b->zbuf + i * s->cluster_size, p);
+    if (b->zlen[i] < 0)
+        error("error while compressing sector %lld",
+              b->sector_num + i * s->cluster_sectors);
+}
+
+static void convert_write(ConvertState *s, ConvertBuf *b)
+{
+    const uint8_t *buf1;
+    int64_t sector_num;
+    int i, n, n1;
+
+    if (b->hole)
+        return;
+    sector_num = b->sector_num;
+    if (s->compress) {
+        for(i = 0; i < b->nb_clusters; i++) {
+            if (b->zlen[i] < 0)
+                continue;
+            if (qcow_write_compressed(s->out_bs,
+                                      sector_num + i * s->cluster_sectors,
+                                      b->buf + i * s->cluster_size,
+                                      b->zbuf + i * s->cluster_size,
+                                      b->zlen[i]) != 0)
+                error("error while compressing sector %lld",
+                      sector_num + i * s->cluster_sectors);
+        }
+        return;
+    }
+
+    /* NOTE: at the same time we convert, we do not write zero
+       sectors to have a chance to compress the image. Ideally, we
+       should add a specific call to have the info to go faster */
+    buf1 = b->buf;
+    n = b->nb_sectors;
+    while (n > 0) {
+        if (is_allocated_sectors(buf1, n, &n1)) {
+            if (bdrv_write(s->out_bs, sector_num, buf1, n1) < 0)
+                error("error while writing");
+        }
+        sector_num += n1;
+        n -= n1;
+        buf1 += n1 * 512;
+    }
+}
+
+/* Sleep on ev until another thread sets it. Called and returns with
+   s->lock held. */
+static void convert_wait(ConvertState *s, QemuEvent *ev)
+{
+    qemu_event_reset(ev);
+    qemu_mutex_unlock(s->lock);
+    qemu_event_wait(ev);
+    qemu_mutex_lock(s->lock);
+}
+
+static void convert_wake_workers(ConvertState *s)
+{
+    int i;
+
+    for(i = 0; i < s->nb_workers; i++)
+        qemu_event_set(s->worker_ev[i]);
+}
+
+/* Compress the next cluster of b that nobody has taken yet. Called and
+   returns with s->lock held. */
+static void convert_take_cluster(ConvertState *s, ConvertBuf *b)
+{
+    int i = b->next_cluster++;
+
+    qemu_mutex_unlock(s->lock);
+    convert_cluster(s, b, i);
+    qemu_mutex_lock(s->lock);
+    if (++b->clusters_done == b->nb_clusters) {
+        b->state = BUF_DONE;
+        qemu_event_set(s->writer_ev);
+    }
+}
+
+static void convert_reader(void *opaque)
+{
+    ConvertState *s = opaque;
+    ConvertBuf *b;
+    int64_t sector_num;
+    int i, n;
+
+    i = 0;
+    for(sector_num = 0; sector_num < s->total_sectors; sector_num += n) {
+        b = &s->bufs[i];
+        i = (i + 1) % s->nb_bufs;
+        qemu_mutex_lock(s->lock);
+        while (b->state != BUF_FREE)
+            convert_wait(s, s->reader_ev);
+        qemu_mutex_unlock(s->lock);
+
+        convert_read(s, b, sector_num);
+        n = b->nb_sectors;
+
+        qemu_mutex_lock(s->lock);
+        b->state = s->compress ? BUF_READ : BUF_DONE;
+        qemu_event_set(s->writer_ev);
+        convert_wake_workers(s);
+        qemu_mutex_unlock(s->lock);
+    }
+
+    qemu_mutex_lock(s->lock);
+    s->threads--;
+    qemu_event_set(s->writer_ev);
+    qemu_mutex_unlock(s->lock);
+}
+
+static void convert_worker(void *opaque)
+{
+    ConvertState *s = opaque;
+    ConvertBuf *b, *first;
+    QemuEvent *ev;
+    int i;
+
+    qemu_mutex_lock(s->lock);
+    ev = s->worker_ev[s->next_worker++];
+    while (!s->quit) {
+        /* the buffer the writer needs soonest */
+        first = NULL;
+        for(i = 0; i < s->nb_bufs; i++) {
+            b = &s->bufs[i];
+            if (b->state == BUF_READ && b->next_cluster < b->nb_clusters &&
+                (!first || b->sector_num < first->sector_num))
+                first = b;
+        }
+        if (first)
+            convert_take_cluster(s, first);
+        else
+            convert_wait(s, ev);
+    }
+    s->threads--;
+    qemu_event_set(s->writer_ev);
+    qemu_mutex_unlock(s->lock);
+}
+
+static void convert_serial(ConvertState *s)
+{
+    ConvertBuf *b = &s->bufs[0];
+    int64_t sector_num;
+    int i;
+
+    for(sector_num = 0; sector_num < s->total_sectors;
+        sector_num += b->nb_sectors) {
+        convert_read(s, b, sector_num);
+        if (s->compress) {
+            for(i = 0; i < b->nb_clusters; i++)
+                convert_cluster(s, b, i);
+        }
+        convert_write(s, b);
+    }
+}
+
+static void convert_threaded(ConvertState *s)
+{
+    ConvertBuf *b;
+    int64_t sector_num;
+    int i, n;
+
+    i = 0;
+    for(sector_num = 0; sector_num < s->total_sectors; sector_num += n) {
+        b = &s->bufs[i];
+        i = (i + 1) % s->nb_bufs;
+        qemu_mutex_lock(s->lock);
+        while (b->state != BUF_DONE) {
+            if (b->state == BUF_READ && b->next_cluster < b->nb_clusters)
+                convert_take_cluster(s, b);
+            else
+                convert_wait(s, s->writer_ev);
+        }
+        qemu_mutex_unlock(s->lock);
+
+        convert_write(s, b);
+        n = b->nb_sectors;
+
+        qemu_mutex_lock(s->lock);
+        b->state = BUF_FREE;
+        qemu_event_set(s->reader_ev);
+        qemu_mutex_unlock(s->lock);
+    }
+
+    qemu_mutex_lock(s->lock);
+    s->quit = 1;
+    convert_wake_workers(s);
+    while (s->threads > 0)
+        convert_wait(s, s->writer_ev);
+    qemu_mutex_unlock(s->lock);
+}
+
+static void convert_run(ConvertState *s, int nb_workers)
+{
+    ConvertBuf *b;
+    int i, n, threaded;
+
+    memset(s->bufs, 0, sizeof(s->bufs));
+    s->lock = NULL;
+    s->reader_ev = NULL;
+    s->writer_ev = NULL;
+    s->nb_workers = 0;
+    s->next_worker = 0;
+    s->threads = 0;
+    s->quit = 0;
+
+    threaded = 0;
+    if (nb_workers >= 0) {
+        if (!s->compress)
+            nb_workers = 0;
+        s->lock = qemu_mutex_new();
+        s->reader_ev = qemu_event_new();
+        s->writer_ev = qemu_event_new();
+        while (s->nb_workers < nb_workers &&
+               (s->worker_ev[s->nb_workers] = qemu_event_new()) != NULL)
+            s->nb_workers++;
+        threaded = s->lock && s->reader_ev && s->writer_ev;
+    }
+    s->nb_bufs = threaded ? NB_BUFS : 1;
+
+    n = IO_BUF_SIZE / s->cluster_size;
+    for(i = 0; i < s->nb_bufs; i++) {
+        b = &s->bufs[i];
+        b->buf = qemu_malloc(IO_BUF_SIZE);
+        if (s->compress) {
+            b->zbuf = qemu_malloc(IO_BUF_SIZE);
+            b->zlen = qemu_malloc(n * sizeof(int));
+        }
+        if (!b->buf || (s->compress && (!b->zbuf || !b->zlen)))
+            error("not enough memory");
+    }
+
+    /* counted before they start, as they may be done before we look */
+    s->threads = 1;
+    if (threaded && qemu_thread_create(convert_reader, s) == 0) {
+        for(i = 0; i < s->nb_workers; i++) {
+            qemu_mutex_lock(s->lock);
+            s->threads++;
+            qemu_mutex_unlock(s->lock);
+            if (qemu_thread_create(convert_worker, s) < 0) {
+                qemu_mutex_lock(s->lock);
+                s->threads--;
+                qemu_mutex_unlock(s->lock);
+                break;
+            }
+        }
+        convert_threaded(s);
+    } else {
+        convert_serial(s);
+    }
+
+    for(i = 0; i < s->nb_bufs; i++) {
+        b = &s->bufs[i];
+        qemu_free(b->buf);
+        qemu_free(b->zbuf);
+        qemu_free(b->zlen);
+    }
+    for(i = 0; i < s->nb_workers; i++)
+        qemu_event_free(s->worker_ev[i]);
+    if (s->writer_ev)
+        qemu_event_free(s->writer_ev);
+    if (s->reader_ev)
+        qemu_event_free(s->reader_ev);
+    if (s->lock)
+        qemu_mutex_free(s->lock);
+}
 
 static int img_convert(int argc, char **argv)
 {
-    int c, ret, n, n1, compress, cluster_size, cluster_sectors, encrypt;
+    int c, ret, compress, cluster_size, encrypt, nb_workers;
     const char *filename, *fmt, *out_fmt, *out_filename;
     BlockDriver *drv;
     BlockDriverState *bs, *out_bs;
-    int64_t total_sectors, nb_sectors, sector_num;
-    uint8_t buf[IO_BUF_SIZE];
-    const uint8_t *buf1;
+    int64_t total_sectors;
+    ConvertState s;
 
     fmt = NULL;
     out_fmt = "raw";
     compress = 0;
     encrypt = 0;
+    nb_workers = qemu_get_ncpus() - 1;
     for(;;) {
-        c = getopt(argc, argv, "f:O:hce");
+        c = getopt(argc, argv, "f:O:hcem:");
         if (c == -1)
             break;
         switch(c) {
@@ -515,8 +896,15 @@ static int img_convert(int argc, char **argv)
         case 'e':
             encrypt = 1;
             break;
+        case 'm':
+            /* threads compressing, this one included; 0 for no
+               threads at all */
+            nb_workers = atoi(optarg) - 1;
+            break;
         }
     }
+    if (nb_workers > MAX_WORKERS)
+        nb_workers = MAX_WORKERS;
     if (optind >= argc) 
         help();
     filename = argv[optind++];
@@ -547,57 +935,21 @@ static int img_convert(int argc, char **argv)
     
     out_bs = bdrv_new_open(out_filename, out_fmt);
 
+    cluster_size = 512;
     if (compress) {
         cluster_size = qcow_get_cluster_size(out_bs);
         if (cluster_size <= 0 || cluster_size > IO_BUF_SIZE)
             error("invalid cluster size");
-        cluster_sectors = cluster_size >> 9;
-        sector_num = 0;
-        for(;;) {
-            nb_sectors = total_sectors - sector_num;
-            if (nb_sectors <= 0)
-                break;
-            if (nb_sectors >= cluster_sectors)
-                n = cluster_sectors;
-            else
-                n = nb_sectors;
-            if (bdrv_read(bs, sector_num, buf, n) < 0) 
-                error("error while reading");
-            if (n < cluster_sectors)
-                memset(buf + n * 512, 0, cluster_size - n * 512);
-            if (is_not_zero(buf, cluster_size)) {
-                if (qcow_compress_cluster(out_bs, sector_num, buf) != 0)
-                    error("error while compressing sector %lld", sector_num);
-            }
-            sector_num += n;
-        }
-    } else {
-        sector_num = 0;
-        for(;;) {
-            nb_sectors = total_sectors - sector_num;
-            if (nb_sectors <= 0)
-                break;
-            if (nb_sectors >= (IO_BUF_SIZE / 512))
-                n = (IO_BUF_SIZE / 512);
-            else
-                n = nb_sectors;
-            if (bdrv_read(bs, sector_num, buf, n) < 0) 
-                error("error while reading");
-            /* NOTE: at the same time we convert, we do not write zero
-               sectors to have a chance to compress the image. Ideally, we
-               should add a specific call to have the info to go faster */
-            buf1 = buf;
-            while (n > 0) {
-                if (is_allocated_sectors(buf1, n, &n1)) {
-                    if (bdrv_write(out_bs, sector_num, buf1, n1) < 0) 
-                        error("error while writing");
-                }
-                sector_num += n1;
-                n -= n1;
-                buf1 += n1 * 512;
-            }
-        }
     }
+
+    s.bs = bs;
+    s.out_bs = out_bs;
+    s.total_sectors = total_sectors;
+    s.compress = compress;
+    s.cluster_size = cluster_size;
+    s.cluster_sectors = cluster_size >> 9;
+    convert_run(&s, nb_workers);
+
     bdrv_delete(out_bs);
     bdrv_delete(bs);
     return 0;
@@ -607,8 +959,16 @@ static int img_convert(int argc, char **argv)
 static int64_t get_allocated_file_size(const char *filename)
 {
     struct _stati64 st;
+#ifdef __WATCOMC__
+    int64_t size;
+#endif
     if (_stati64(filename, &st) < 0) 
         return -1;
+#ifdef __WATCOMC__
+    size = file_allocated_size(filename);
+    if (size >= 0 && (st.st_size < 0xffffffff || size > 0xffffffff))
+        return size;
+#endif
     return st.st_size;
 }
 #else
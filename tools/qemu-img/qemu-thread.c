@@ -0,0 +1,367 @@
+/*
+ * Threads for qemu-img
+ */
+#include <stdlib.h>
+
+#include "qemu-thread.h"
+
+#define THREAD_STACK_SIZE 65536
+
+#if defined(__OS2__)
+
+#define INCL_DOSPROCESS
+#define INCL_DOSSEMAPHORES
+#define INCL_DOSMISC
+#include <os2.h>
+#include <process.h>
+
+#ifndef QSV_NUMPROCESSORS
+#define QSV_NUMPROCESSORS 26
+#endif
+
+struct QemuMutex {
+    HMTX hmtx;
+};
+
+struct QemuEvent {
+    HEV hev;
+};
+
+int qemu_thread_create(void (*fn)(void *), void *opaque)
+{
+    return _beginthread(fn, NULL, THREAD_STACK_SIZE, opaque) == -1 ? -1 : 0;
+}
+
+int qemu_get_ncpus(void)
+{
+    ULONG n;
+
+    if (DosQuerySysInfo(QSV_NUMPROCESSORS, QSV_NUMPROCESSORS, &n, sizeof(n)) ||
+        n < 1)
+        return 1;
+    return n;
+}
+
+QemuMutex *qemu_mutex_new(void)
+{
+    QemuMutex *m = malloc(sizeof(*m));
+
+    if (m && DosCreateMutexSem(NULL, &m->hmtx, 0, FALSE)) {
+        free(m);
+        m = NULL;
+    }
+    return m;
+}
+
+void qemu_mutex_free(QemuMutex *m)
+{
+    DosCloseMutexSem(m->hmtx);
+    free(m);
+}
+
+void qemu_mutex_lock(QemuMutex *m)
+{
+    DosRequestMutexSem(m->hmtx, SEM_INDEFINITE_WAIT);
+}
+
+void qemu_mutex_unlock(QemuMutex *m)
+{
+    DosReleaseMutexSem(m->hmtx);
+}
+
+QemuEvent *qemu_event_new(void)
+{
+    QemuEvent *e = malloc(sizeof(*e));
+
+    if (e && DosCreateEventSem(NULL, &e->hev, 0, FALSE)) {
+        free(e);
+        e = NULL;
+    }
+    return e;
+}
+
+void qemu_event_free(QemuEvent *e)
+{
+    DosCloseEventSem(e->hev);
+    free(e);
+}
+
+void qemu_event_set(QemuEvent *e)
+{
+    DosPostEventSem(e->hev);
+}
+
+void qemu_event_reset(QemuEvent *e)
+{
+    ULONG count;
+
+    DosResetEventSem(e->hev, &count);
+}
+
+void qemu_event_wait(QemuEvent *e)
+{
+    DosWaitEventSem(e->hev, SEM_INDEFINITE_WAIT);
+}
+
+#elif defined(_WIN32)
+
+#include <windows.h>
+#include <process.h>
+
+struct QemuMutex {
+    CRITICAL_SECTION cs;
+};
+
+struct QemuEvent {
+    HANDLE h;
+};
+
+int qemu_thread_create(void (*fn)(void *), void *opaque)
+{
+#ifdef __WATCOMC__
+    return _beginthread(fn, NULL, THREAD_STACK_SIZE, opaque) == -1 ? -1 : 0;
+#else
+    return _beginthread(fn, THREAD_STACK_SIZE, opaque) == (uintptr_t)-1L ? -1 : 0;
+#endif
+}
+
+int qemu_get_ncpus(void)
+{
+    SYSTEM_INFO si;
+
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors < 1 ? 1 : si.dwNumberOfProcessors;
+}
+
+QemuMutex *qemu_mutex_new(void)
+{
+    QemuMutex *m = malloc(sizeof(*m));
+
+    if (m)
+        InitializeCriticalSection(&m->cs);
+    return m;
+}
+
+void qemu_mutex_free(QemuMutex *m)
+{
+    DeleteCriticalSection(&m->cs);
+    free(m);
+}
+
+void qemu_mutex_lock(QemuMutex *m)
+{
+    EnterCriticalSection(&m->cs);
+}
+
+void qemu_mutex_unlock(QemuMutex *m)
+{
+    LeaveCriticalSection(&m->cs);
+}
+
+QemuEvent *qemu_event_new(void)
+{
+    QemuEvent *e = malloc(sizeof(*e));
+
+    if (e && !(e->h = CreateEvent(NULL, TRUE, FALSE, NULL))) {
+        free(e);
+        e = NULL;
+    }
+    return e;
+}
+
+void qemu_event_free(QemuEvent *e)
+{
+    CloseHandle(e->h);
+    free(e);
+}
+
+void qemu_event_set(QemuEvent *e)
+{
+    SetEvent(e->h);
+}
+
+void qemu_event_reset(QemuEvent *e)
+{
+    ResetEvent(e->h);
+}
+
+void qemu_event_wait(QemuEvent *e)
+{
+    WaitForSingleObject(e->h, INFINITE);
+}
+
+#elif defined(LINUX)
+
+#include <pthread.h>
+#include <unistd.h>
+
+struct QemuMutex {
+    pthread_mutex_t lock;
+};
+
+struct QemuEvent {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int set;
+};
+
+typedef struct ThreadStart {
+    void (*fn)(void *);
+    void *opaque;
+} ThreadStart;
+
+static void *thread_start(void *opaque)
+{
+    ThreadStart start = *(ThreadStart *)opaque;
+
+    free(opaque);
+    start.fn(start.opaque);
+    return NULL;
+}
+
+int qemu_thread_create(void (*fn)(void *), void *opaque)
+{
+    ThreadStart *start = malloc(sizeof(*start));
+    pthread_t tid;
+
+    if (!start)
+        return -1;
+    start->fn = fn;
+    start->opaque = opaque;
+    if (pthread_create(&tid, NULL, thread_start, start)) {
+        free(start);
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+int qemu_get_ncpus(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n < 1 ? 1 : n;
+}
+
+QemuMutex *qemu_mutex_new(void)
+{
+    QemuMutex *m = malloc(sizeof(*m));
+
+    if (m)
+        pthread_mutex_init(&m->lock, NULL);
+    return m;
+}
+
+void qemu_mutex_free(QemuMutex *m)
+{
+    pthread_mutex_destroy(&m->lock);
+    free(m);
+}
+
+void qemu_mutex_lock(QemuMutex *m)
+{
+    pthread_mutex_lock(&m->lock);
+}
+
+void qemu_mutex_unlock(QemuMutex *m)
+{
+    pthread_mutex_unlock(&m->lock);
+}
+
+QemuEvent *qemu_event_new(void)
+{
+    QemuEvent *e = malloc(sizeof(*e));
+
+    if (e) {
+        pthread_mutex_init(&e->lock, NULL);
+        pthread_cond_init(&e->cond, NULL);
+        e->set = 0;
+    }
+    return e;
+}
+
+void qemu_event_free(QemuEvent *e)
+{
+    pthread_cond_destroy(&e->cond);
+    pthread_mutex_destroy(&e->lock);
+    free(e);
+}
+
+void qemu_event_set(QemuEvent *e)
+{
+    pthread_mutex_lock(&e->lock);
+    e->set = 1;
+    pthread_cond_broadcast(&e->cond);
+    pthread_mutex_unlock(&e->lock);
+}
+
+void qemu_event_reset(QemuEvent *e)
+{
+    pthread_mutex_lock(&e->lock);
+    e->set = 0;
+    pthread_mutex_unlock(&e->lock);
+}
+
+void qemu_event_wait(QemuEvent *e)
+{
+    pthread_mutex_lock(&e->lock);
+    while (!e->set)
+        pthread_cond_wait(&e->cond, &e->lock);
+    pthread_mutex_unlock(&e->lock);
+}
+
+#else
+
+/* no threads: callers see the create fail and run everything inline */
+
+static int dummy;
+
+int qemu_thread_create(void (*fn)(void *), void *opaque)
+{
+    return -1;
+}
+
+int qemu_get_ncpus(void)
+{
+    return 1;
+}
+
+QemuMutex *qemu_mutex_new(void)
+{
+    return (QemuMutex *)&dummy;
+}
+
+void qemu_mutex_free(QemuMutex *m)
+{
+}
+
+void qemu_mutex_lock(QemuMutex *m)
+{
+}
+
+void qemu_mutex_unlock(QemuMutex *m)
+{
+}
+
+QemuEvent *qemu_event_new(void)
+{
+    return (QemuEvent *)&dummy;
+}
+
+void qemu_event_free(QemuEvent *e)
+{
+}
+
+void qemu_event_set(QemuEvent *e)
+{
+}
+
+void qemu_event_reset(QemuEvent *e)
+{
+}
+
+void qemu_event_wait(QemuEvent *e)
+{
+}
+
+#endif
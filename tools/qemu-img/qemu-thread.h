@@ -0,0 +1,31 @@
+/*
+ * Threads for qemu-img
+ *
+ * Just what the convert pipeline needs: detached threads, a mutex and
+ * a manual reset event that stays set until it is reset. A waiter
+ * resets its event before it sleeps, so each waiting thread needs an
+ * event of its own or it could clear a set meant for another. Where
+ * the host has no threads (DOS extenders) qemu_thread_create() fails
+ * and the caller does the work itself.
+ */
+#ifndef QEMU_THREAD_H
+#define QEMU_THREAD_H
+
+typedef struct QemuMutex QemuMutex;
+typedef struct QemuEvent QemuEvent;
+
+int qemu_thread_create(void (*fn)(void *), void *opaque);
+int qemu_get_ncpus(void);
+
+QemuMutex *qemu_mutex_new(void);
+void qemu_mutex_free(QemuMutex *m);
+void qemu_mutex_lock(QemuMutex *m);
+void qemu_mutex_unlock(QemuMutex *m);
+
+QemuEvent *qemu_event_new(void);
+void qemu_event_free(QemuEvent *e);
+void qemu_event_set(QemuEvent *e);
+void qemu_event_reset(QemuEvent *e);
+void qemu_event_wait(QemuEvent *e);
+
+#endif
@@ -413,6 +413,8 @@ int bdrv_write(BlockDriverState *bs, int64_t sector_num,
                const uint8_t *buf, int nb_sectors);
 void bdrv_get_geometry(BlockDriverState *bs, int64_t *nb_sectors_ptr);
 int bdrv_commit(BlockDriverState *bs);
+int bdrv_is_allocated(BlockDriverState *bs, int64_t sector_num, 
+                      int nb_sectors, int *pnum);
 void bdrv_set_boot_sector(BlockDriverState *bs, const uint8_t *data, int size);
 
 #define BDRV_TYPE_HD     0
@@ -450,6 +452,11 @@ const char *bdrv_get_device_name(BlockDriverState *bs);
 int qcow_get_cluster_size(BlockDriverState *bs);
 int qcow_compress_cluster(BlockDriverState *bs, int64_t sector_num,
                           const uint8_t *buf);
+int qcow_deflate_cluster(BlockDriverState *bs, uint8_t *out_buf,
+                         const uint8_t *buf);
+int qcow_write_compressed(BlockDriverState *bs, int64_t sector_num,
+                          const uint8_t *buf, const uint8_t *out_buf,
+                          int out_len);
 
 #ifndef QEMU_TOOL
 
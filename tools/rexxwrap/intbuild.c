@@ -33,6 +33,7 @@
 #endif
 #if defined(USE_ZLIB)
 # include "zlib.h"
+# include "rxzdict.h"
 #endif
 #if defined(USE_DES)
 # include "des.h"
@@ -77,6 +78,46 @@ int encode(unsigned char *out, unsigned char *in, int len)
    return j;
 }
 
+#if defined(USE_ZLIB)
+/*
+ * Deflate the program straight from the input stream into out, which
+ * must hold deflateBound() bytes. The file is never held in memory as
+ * a whole. Returns the compressed length, or -1 on error.
+ */
+long compress_stream(FILE *fp, unsigned char *out, long outlen, long *inlen)
+{
+   static unsigned char inbuf[RXZ_CHUNK];
+   z_stream zs;
+   int rc=Z_OK, flush;
+
+   memset(&zs,0,sizeof(zs));
+   if (deflateInit2(&zs,RXZ_LEVEL,Z_DEFLATED,RXZ_WBITS,RXZ_MEMLEVEL,RXZ_STRATEGY) != Z_OK)
+      return -1;
+# if !defined(USE_TOKENIZED)
+   deflateSetDictionary(&zs,(const Bytef *)rexx_zdict,sizeof(rexx_zdict)-1);
+# endif
+   zs.next_out = out;
+   zs.avail_out = (uInt)outlen;
+   *inlen = 0;
+   do
+   {
+      zs.next_in = inbuf;
+      zs.avail_in = (uInt)fread(inbuf,sizeof(unsigned char),sizeof(inbuf),fp);
+      if (ferror(fp))
+         break;
+      *inlen += zs.avail_in;
+      flush = feof(fp) ? Z_FINISH : Z_NO_FLUSH;
+      rc = deflate(&zs,flush);
+      /* out was sized for the whole file, so deflate never stalls */
+      if (rc == Z_STREAM_ERROR || zs.avail_in != 0)
+         break;
+   } while (flush != Z_FINISH);
+   deflateEnd(&zs);
+   if (rc != Z_STREAM_END)
+      return -1;
+   return (long)zs.total_out;
+}
+#endif
 
 int main(int argc, char *argv[])
 {
@@ -132,6 +173,27 @@ int main(int argc, char *argv[])
    fseek( fp, 0, SEEK_END );
    size = ftell( fp );
    rewind( fp );
+#if defined(USE_ZLIB)
+   /*
+    * Compress the file as it is read to produce compressed_code
+    */
+   compressed_length = (long)deflateBound(NULL,(uLong)size) + 64;
+   compressed_code = (unsigned char *)malloc(compressed_length);
+   if (compressed_code == NULL)
+   {
+      fprintf(stderr,"No memory at line %d\n",__LINE__);
+      fclose(fp);
+      exit(1);
+   }
+   compressed_length = compress_stream(fp,compressed_code,compressed_length,&original_length);
+   fclose(fp);
+   if (compressed_length < 0)
+   {
+      fprintf(stderr,"Error compressing program code\n");
+      free(compressed_code);
+      exit(1);
+   }
+#else
    original_code = (unsigned char *)malloc(size+5);
    if (original_code == NULL)
    {
@@ -152,41 +214,6 @@ int main(int argc, char *argv[])
       exit(1);
    }
    fclose(fp);
-
-#if defined(USE_ZLIB)
-   /*
-    * Compress original_code to produce compressed_code
-    */
-   compressed_length = (12 + ((original_length * 101 / 100)));
-   compressed_code = (unsigned char *)malloc(compressed_length);
-   if (compressed_code == NULL)
-   {
-      fprintf(stderr,"No memory at line %d\n",__LINE__);
-      if (original_code)
-      {
-         free(original_code);
-         original_code = NULL;
-      }
-      exit(1);
-   }
-   rc = compress(compressed_code, (uLongf *)&compressed_length,
-                 original_code, original_length);
-   if (rc != Z_OK)
-   {
-      fprintf(stderr,"Error compressing program code\n");
-      if (original_code)
-      {
-         free(original_code);
-         original_code = NULL;
-      }
-      if (compressed_code)
-      {
-         free(compressed_code);
-         compressed_code = NULL;
-      }
-      exit(1);
-   }
-#else
    compressed_length = original_length;
    compressed_code = original_code;
 #endif
@@ -60,6 +60,7 @@
 
 #if defined(USE_ZLIB)
 # include "zlib.h"
+# include "rxzdict.h"
 #endif
 #if defined(USE_DES)
 # include "des.h"
@@ -225,20 +226,53 @@ int decode(unsigned char *out, unsigned char *in, int len)
    return j;
 }
 
+#if defined(USE_ZLIB)
+/*
+ * Inflate the whole program in one pass straight into out.
+ * Programs packed with the Rexx preset dictionary ask for it here.
+ */
+int inflate_program( unsigned char *out, long outlen, unsigned char *in, long inlen )
+{
+   z_stream zs;
+   int rc;
+
+   memset( &zs, 0, sizeof(zs) );
+   zs.next_in = in;
+   zs.avail_in = (uInt)inlen;
+   zs.next_out = out;
+   zs.avail_out = (uInt)outlen;
+   rc = inflateInit2( &zs, RXZ_WBITS );
+   if ( rc != Z_OK )
+      return rc;
+   rc = inflate( &zs, Z_FINISH );
+   if ( rc == Z_NEED_DICT )
+   {
+      rc = inflateSetDictionary( &zs, (const Bytef *)rexx_zdict, sizeof(rexx_zdict)-1 );
+      if ( rc == Z_OK )
+         rc = inflate( &zs, Z_FINISH );
+   }
+   if ( rc == Z_STREAM_END && (long)zs.total_out != outlen )
+      rc = Z_DATA_ERROR;
+   inflateEnd( &zs );
+   return ( rc == Z_STREAM_END ) ? Z_OK : rc;
+}
+#endif
+
 /*
  * Expand the program.
- * UUdecode, then decrypt, then uncompress
+ * UUdecode, then decrypt, then uncompress.
+ * Every embedded line holds whole 4 byte groups, so the lines are
+ * decoded straight into one buffer and decrypted in place; the only
+ * other allocation is the program itself.
  */
 unsigned char *expand_program( char *str, int *len )
 {
-   unsigned char *encoded_code=NULL;
    unsigned char *encrypted_code=NULL;
    unsigned char *compressed_code=NULL;
    unsigned char *original_code=NULL;
    int i,tot;
 #if defined(USE_ZLIB)
    int rc;
-   long new_original_length=0;
 #endif
 #if defined(USE_DES)
    des_cblock deskey;
@@ -250,13 +284,6 @@ unsigned char *expand_program( char *str, int *len )
    /*
     * decoded to encrypted
     */
-   encoded_code = (unsigned char *)malloc(encoded_length+10);
-   if (encoded_code == NULL)
-   {
-      STARTUPCONSOLE();
-      fprintf( stderr, "No memory at line %d\n", __LINE__ );
-      return NULL;
-   }
    encrypted_code = (unsigned char *)malloc(encrypted_length+10);
    if (encrypted_code == NULL)
    {
@@ -266,11 +293,8 @@ unsigned char *expand_program( char *str, int *len )
    }
    for (i=0,tot=0;progline[i].len != 0;i++)
    {
-      memcpy(encoded_code+tot,progline[i].line,progline[i].len);
-      tot += progline[i].len;
+      tot += decode(encrypted_code+tot,(unsigned char *)progline[i].line,progline[i].len);
    }
-   decode(encrypted_code,encoded_code,encoded_length);
-   free(encoded_code);
 #if defined(USE_DES)
    /*
     * Convert the DES key into a DES key schedule
@@ -278,27 +302,17 @@ unsigned char *expand_program( char *str, int *len )
    des_string_to_key(str,&deskey);
    des_set_key((des_cblock *)&deskey,ks);
    /*
-    * Decrypt encrypted_code to produce compressed_code
-    */
-   compressed_code = (unsigned char *)malloc(compressed_length+10);
-   if (compressed_code == NULL)
-   {
-      STARTUPCONSOLE();
-      fprintf( stderr, "No memory at line %d\n", __LINE__ );
-      free(encrypted_code);
-      return NULL;
-   }
-   /*
-    * Now decrypt encrypted_code in 8byte chunks
+    * Now decrypt encrypted_code in place in 8byte chunks to produce
+    * compressed_code
     */
    num_chunks = encrypted_length / 8; /* this should ALWAYS be a multiple of 8 */
    for (i=0;i<num_chunks;i++)
    {
       memcpy(in_cblock,encrypted_code+(i*8),8);
       des_ecb_encrypt(&in_cblock,&out_cblock,ks,DES_DECRYPT);
-      memcpy(compressed_code+(i*8),out_cblock,8);
+      memcpy(encrypted_code+(i*8),out_cblock,8);
    }
-   free(encrypted_code);
+   compressed_code = encrypted_code;
 #else
    compressed_code = encrypted_code;
    compressed_length = encrypted_length;
@@ -314,28 +328,19 @@ unsigned char *expand_program( char *str, int *len )
    {
       STARTUPCONSOLE();
       fprintf( stderr, "No memory at line %d\n", __LINE__ );
+      free(compressed_code);
       return NULL;
    }
-   new_original_length = original_length;
-   rc = uncompress(original_code, (uLongf *)&new_original_length,
-                 compressed_code, compressed_length);
+   rc = inflate_program(original_code, original_length,
+                        compressed_code, compressed_length);
+   free(compressed_code);
    if (rc != Z_OK)
    {
       STARTUPCONSOLE();
       fprintf( stderr, "Error (%d) decompressing program code.\n", rc );
       free(original_code);
-      free(compressed_code);
-      return NULL;
-   }
-   if ( new_original_length != original_length)
-   {
-      STARTUPCONSOLE();
-      fprintf( stderr, "Error decompressing program code. Original length: %ld Decompressed length: %ld\n", original_length, new_original_length );
-      free(original_code);
-      free(compressed_code);
       return NULL;
    }
-   free(compressed_code);
 #else
    original_code = compressed_code;
    original_length = compressed_length;
@@ -61,7 +61,7 @@ End
 _debug = Value( 'REXXWRAPPER_DEBUG', , 'ENVIRONMENT' )
 if _debug = '' Then _debug = 0
 
-!zlib_modules = "compress uncompr deflate inflate adler32 zutil trees inftrees inffast crc32"
+!zlib_modules = "deflate inflate adler32 zutil trees inftrees inffast crc32"
 !des_modules = "rand_key set_key str2key ecb_enc cbc_cksm des_enc"
 !my_modules = "rand_key set_key str2key ecb_enc cbc_cksm des_enc"
 defines. = ''
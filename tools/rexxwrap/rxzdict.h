@@ -0,0 +1,34 @@
+/*
+ * zlib settings shared by intbuild (the packer) and the rexxwrap.c
+ * template (the unpacker).
+ *
+ * Rexx source is short, keyword heavy text, so it is deflated at the
+ * best level with the largest window and hash table, primed with a
+ * preset dictionary of the words almost every program uses. deflate
+ * finds the dictionary through the normal window search, so the most
+ * frequent words go last where the match distances are shortest.
+ * The unpacker learns that a dictionary is needed from the zlib
+ * header (inflate() returns Z_NEED_DICT), so tokenised programs that
+ * are packed without one unpack the same way.
+ */
+#define RXZ_LEVEL    Z_BEST_COMPRESSION
+#define RXZ_WBITS    MAX_WBITS
+#define RXZ_MEMLEVEL MAX_MEM_LEVEL
+#define RXZ_STRATEGY Z_DEFAULT_STRATEGY
+#define RXZ_CHUNK    16384
+
+static const char rexx_zdict[] =
+   "Signal On Syntax Signal On Halt Signal On NoValue Numeric Digits "
+   "Trace Options Interpret Address CMD Parse Upper Arg Parse Source "
+   "Parse Version Parse Pull Parse Value With Queued() Pull "
+   "Call RxFuncAdd 'SysLoadFuncs', 'RexxUtil', 'SysLoadFuncs' "
+   "Call SysLoadFuncs SysFileTree SysFileDelete SysMkDir SysSleep "
+   "Stream(,'C','QUERY EXISTS') Stream(,'C','OPEN READ') "
+   "Stream(,'C','CLOSE') Lines() LineIn() LineOut() CharIn() CharOut() "
+   "Translate() Reverse() Verify() Insert() Overlay() Center() "
+   "DataType() Abbrev() WordPos() Words() Word() SubWord() "
+   "Space() Strip() Right() Left() Length() SubStr() Pos() LastPos() "
+   "Value( , , 'ENVIRONMENT') Date() Time() Format() Max() Min() "
+   "Procedure Expose Return Exit Iterate Leave Nop Select "
+   "When Otherwise Forever While Until Then Else End; "
+   "Call Do i = 1 To Say If ";
@@ -0,0 +1,350 @@
+/*
+ * trcdump - decode the doscalls trace buffer
+ *
+ * doscalls records enabled log() calls in binary into a ring in named
+ * shared memory, \SHAREMEM\DOSTRC\<pid in hex> (see
+ * OS2/CPI/doscalls/log.c).  On OS/2 this tool can snapshot that ring
+ * from a running process into a file; anywhere, it can decode such a
+ * file back into text, oldest record first.
+ *
+ * Usage: trcdump -p pid [-o file]     snapshot (OS/2), decode unless -o
+ *        trcdump file                 decode a snapshot
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __OS2__
+#define INCL_DOSMEMMGR
+#include <os2.h>
+#endif
+
+/* Layout written by doscalls, little endian, 32-bit fields */
+#define TRACE_NAME      "\\SHAREMEM\\DOSTRC\\"
+#define TRACE_MAGIC     0x43525444UL
+#define TRACE_VERSION   1
+
+#define HDR_SIZE        64
+#define FMT_SIZE        16
+#define REC_SIZE        64
+
+#define TRACE_ARGS      6
+#define TRACE_STR       28
+
+#define TRACE_STR_NULL  0xFFFFFFFFUL
+#define TRACE_STR_LOST  0xFFFFFFFEUL
+#define TRACE_NONE      0xFFFF
+
+static const char *subsys_names[] = {
+    "file", "mem", "mod", "msg", "nls", "sem", "proc", "misc"
+};
+
+static unsigned long get32(const unsigned char *p)
+{
+    return p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static unsigned get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static const char *subsys_name(unsigned long bits)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof(subsys_names) / sizeof(subsys_names[0]); i++)
+        if (bits & (1UL << i))
+            return subsys_names[i];
+    return "?";
+}
+
+/*
+ * Print one record: walk the format the way doscalls did when it
+ * counted argument words, and print each conversion on its own
+ */
+static void print_record(const unsigned char *rec, const char *fmt)
+{
+    const unsigned char *args = rec + 12;
+    const char *str = (const char *)rec + 12 + TRACE_ARGS * 4;
+    unsigned word = 0;
+    char spec[32], *q;
+    unsigned long v, hi;
+    int is_long;
+
+    while (*fmt) {
+        if (*fmt != '%') {
+            putchar(*fmt++);
+            continue;
+        }
+        if (fmt[1] == '%') {
+            putchar('%');
+            fmt += 2;
+            continue;
+        }
+
+        q = spec;
+        *q++ = *fmt++;
+
+        /* Width and precision taken from arguments become literal */
+        while (*fmt && strchr("-+ #0", *fmt) && q < spec + 8)
+            *q++ = *fmt++;
+        if (*fmt == '*') {
+            q += sprintf(q, "%ld",
+                         word < TRACE_ARGS ? (long)get32(args + word * 4) : 0L);
+            word++, fmt++;
+        }
+        while (*fmt >= '0' && *fmt <= '9' && q < spec + 16)
+            *q++ = *fmt++;
+        if (*fmt == '.') {
+            *q++ = *fmt++;
+            if (*fmt == '*') {
+                q += sprintf(q, "%ld",
+                             word < TRACE_ARGS ? (long)get32(args + word * 4) : 0L);
+                word++, fmt++;
+            }
+            while (*fmt >= '0' && *fmt <= '9' && q < spec + 24)
+                *q++ = *fmt++;
+        }
+
+        /* Length modifiers are dropped, values are printed as long */
+        for (is_long = 0; *fmt && strchr("hlLwNFIj", *fmt); fmt++) {
+            if (*fmt == 'L' || (*fmt == 'l' && fmt[1] == 'l'))
+                is_long = 1;
+            if (*fmt == 'I' && fmt[1] == '6' && fmt[2] == '4')
+                is_long = 1, fmt += 2;
+        }
+        if (!*fmt)
+            break;
+        if (strchr("eEfgG", *fmt))
+            is_long = 1;
+
+        if (word + is_long >= TRACE_ARGS) {
+            fputs("<?>", stdout);
+            word += 1 + is_long;
+            fmt++;
+            continue;
+        }
+
+        v = get32(args + word * 4);
+        hi = is_long ? get32(args + word * 4 + 4) : 0;
+        word += 1 + is_long;
+
+        switch (*fmt) {
+        case 's':
+            if (v == TRACE_STR_NULL)
+                fputs("(null)", stdout);
+            else if (v == TRACE_STR_LOST || v >= TRACE_STR)
+                fputs("<...>", stdout);
+            else {
+                strcpy(q, "s");
+                printf(spec, str + v);
+            }
+            break;
+
+        case 'e': case 'E': case 'f': case 'g': case 'G': {
+            unsigned char b[8];
+            double d;
+            int i;
+
+            for (i = 0; i < 4; i++) {
+                b[i] = (unsigned char)(v >> (i * 8));
+                b[i + 4] = (unsigned char)(hi >> (i * 8));
+            }
+            memcpy(&d, b, sizeof(d));
+            q[0] = *fmt, q[1] = '\0';
+            printf(spec, d);
+            break;
+        }
+
+        case 'p':
+            printf("%08lX", v);
+            break;
+
+        case 'c':
+            strcpy(q, "c");
+            printf(spec, (int)(v & 0xFF));
+            break;
+
+        case 'n':
+            break;
+
+        default:
+            if (is_long) {
+                /* 64-bit values: hex in full, decimal when they fit */
+                if (*fmt == 'x' || *fmt == 'X')
+                    printf(hi ? "%lX%08lX" : "%lX", hi ? hi : v, v);
+                else if (!hi)
+                    printf("%lu", v);
+                else
+                    printf("0x%lX%08lX", hi, v);
+            } else {
+                q[0] = 'l', q[1] = *fmt, q[2] = '\0';
+                if (*fmt == 'd' || *fmt == 'i')
+                    printf(spec, (long)(v & 0x80000000UL ?
+                                        -(long)(~v & 0x7FFFFFFFUL) - 1 : (long)v));
+                else
+                    printf(spec, v);
+            }
+            break;
+        }
+        fmt++;
+    }
+}
+
+static int decode(const unsigned char *buf, unsigned long size)
+{
+    unsigned long recs, fmts, pool, next, first, n;
+    const unsigned char *fmt_tab, *pool_p, *rec_tab, *rec, *f;
+    unsigned ifmt, off;
+
+    if (size < HDR_SIZE || get32(buf) != TRACE_MAGIC) {
+        fprintf(stderr, "trcdump: not a doscalls trace buffer\n");
+        return 1;
+    }
+    if (get32(buf + 4) != TRACE_VERSION) {
+        fprintf(stderr, "trcdump: unknown version %lu\n", get32(buf + 4));
+        return 1;
+    }
+
+    recs = get32(buf + 8);
+    fmts = get32(buf + 12);
+    pool = get32(buf + 16);
+    next = get32(buf + 28);
+
+    if (size < HDR_SIZE + fmts * FMT_SIZE + pool + recs * REC_SIZE) {
+        fprintf(stderr, "trcdump: buffer truncated\n");
+        return 1;
+    }
+
+    fmt_tab = buf + HDR_SIZE;
+    pool_p = fmt_tab + fmts * FMT_SIZE;
+    rec_tab = pool_p + pool;
+
+    printf("pid %lX, %lu records, last %lu kept\n",
+           get32(buf + 20), next, next < recs ? next : recs);
+
+    first = next > recs ? next - recs : 0;
+    for (n = first; n < next; n++) {
+        rec = rec_tab + (n % recs) * REC_SIZE;
+
+        /* Overwritten since, or caught half written */
+        if (get32(rec) != n + 1)
+            continue;
+
+        printf("%10lu %4u ", get32(rec + 4), get16(rec + 8));
+
+        ifmt = get16(rec + 10);
+        if (ifmt == TRACE_NONE || ifmt >= fmts) {
+            printf("     <format table full> %08lX %08lX %08lX\n",
+                   get32(rec + 12), get32(rec + 16), get32(rec + 20));
+            continue;
+        }
+
+        f = fmt_tab + ifmt * FMT_SIZE;
+        printf("%-4s ", subsys_name(get32(f + 4)));
+
+        off = get16(f + 8);
+        if (off == TRACE_NONE || off >= pool) {
+            printf("<format pool full> %08lX %08lX %08lX\n",
+                   get32(rec + 12), get32(rec + 16), get32(rec + 20));
+            continue;
+        }
+
+        print_record(rec, (const char *)pool_p + off);
+
+        /* Most formats end in a newline; keep one record per line */
+        if (!*(const char *)(pool_p + off) ||
+            ((const char *)pool_p + off)[strlen((const char *)pool_p + off) - 1] != '\n')
+            putchar('\n');
+    }
+
+    return 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: trcdump file\n"
+#ifdef __OS2__
+            "       trcdump -p pid [-o file]\n"
+#endif
+            );
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char *buf;
+    unsigned long size;
+    const char *out = NULL, *pid = NULL;
+    FILE *fp;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (argv[i][1] == 'p' && i + 1 < argc)
+            pid = argv[++i];
+        else if (argv[i][1] == 'o' && i + 1 < argc)
+            out = argv[++i];
+        else
+            usage();
+    }
+
+    if (pid) {
+#ifdef __OS2__
+        char name[32];
+        PVOID pb;
+        APIRET rc;
+
+        sprintf(name, "%s%lX", TRACE_NAME, strtoul(pid, NULL, 16));
+        if ((rc = DosGetNamedSharedMem(&pb, name, PAG_READ))) {
+            fprintf(stderr, "trcdump: no trace buffer for pid %s (rc=%lu)\n",
+                    pid, rc);
+            return 1;
+        }
+
+        /* Copy first, the process keeps writing */
+        buf = (unsigned char *)pb;
+        size = HDR_SIZE + get32(buf + 12) * FMT_SIZE + get32(buf + 16) +
+               get32(buf + 8) * REC_SIZE;
+        if (get32(buf) != TRACE_MAGIC || !(buf = malloc(size))) {
+            fprintf(stderr, "trcdump: bad trace buffer\n");
+            return 1;
+        }
+        memcpy(buf, pb, size);
+        DosFreeMem(pb);
+
+        if (out) {
+            if (!(fp = fopen(out, "wb")) || fwrite(buf, 1, size, fp) != size) {
+                fprintf(stderr, "trcdump: cannot write %s\n", out);
+                return 1;
+            }
+            fclose(fp);
+            return 0;
+        }
+        return decode(buf, size);
+#else
+        usage();
+#endif
+    }
+
+    if (i + 1 != argc || out)
+        usage();
+
+    if (!(fp = fopen(argv[i], "rb"))) {
+        fprintf(stderr, "trcdump: cannot open %s\n", argv[i]);
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (!(buf = malloc(size ? size : 1)) || fread(buf, 1, size, fp) != size) {
+        fprintf(stderr, "trcdump: cannot read %s\n", argv[i]);
+        return 1;
+    }
+    fclose(fp);
+
+    return decode(buf, size);
+}